@@ -35,13 +35,17 @@ folly::rcu_domain& GetRcuDomain() {
   return domain;
 }
 
+// Result of a lookup. It holds the handle returned by find(), which is not
+// ready until NvmCache has read the item when it missed in DRAM, so the reads
+// of all the lookups issued by a MultiGet are in flight at the same time.
+// The value is created from the item once the handle is ready.
 class RocksCachelibWrapperHandle : public rocksdb::SecondaryCacheResultHandle {
  public:
-  RocksCachelibWrapperHandle(folly::SemiFuture<FbCacheReadHandle>&& future,
+  RocksCachelibWrapperHandle(FbCacheReadHandle&& handle,
                              const rocksdb::Cache::CacheItemHelper* helper,
                              rocksdb::Cache::CreateContext* create_context,
                              std::unique_lock<folly::rcu_domain>&& guard)
-      : future_(std::move(future)),
+      : handle_(std::move(handle)),
         helper_(helper),
         create_context_(create_context),
         val_(nullptr),
@@ -55,49 +59,30 @@ class RocksCachelibWrapperHandle : public rocksdb::SecondaryCacheResultHandle {
       delete;
 
   bool IsReady() override {
-    bool ready = true;
-    if (!is_value_ready_) {
-      ready = future_.isReady();
-      if (ready) {
-        handle_ = std::move(future_).value();
-        CalcValue();
-      }
+    if (!is_value_ready_ && handle_.isReady()) {
+      CalcValue();
     }
-    return ready;
+    return is_value_ready_;
   }
 
   void Wait() override {
     if (!is_value_ready_) {
-      future_.wait();
-      handle_ = std::move(future_).value();
+      handle_.wait();
       CalcValue();
     }
   }
 
+  // All the reads were issued by the lookups, so waiting for them one after
+  // the other takes as long as the slowest one. Values of the items that are
+  // already read are created first, while the other reads are still in
+  // flight.
   static void WaitAll(
-      std::vector<rocksdb::SecondaryCacheResultHandle*> handles) {
-    std::vector<folly::SemiFuture<FbCacheReadHandle>> h_semi;
+      const std::vector<rocksdb::SecondaryCacheResultHandle*>& handles) {
     for (auto h_ptr : handles) {
-      RocksCachelibWrapperHandle* hdl =
-          static_cast<RocksCachelibWrapperHandle*>(h_ptr);
-      if (hdl->is_value_ready_) {
-        continue;
-      }
-      h_semi.emplace_back(std::move(hdl->future_));
+      static_cast<RocksCachelibWrapperHandle*>(h_ptr)->IsReady();
     }
-    auto all_handles = folly::collectAll(std::move(h_semi));
-    auto new_handles = std::move(all_handles).get();
-    assert(new_handles.size() == h_semi.size());
-    int result_idx = 0;
-    for (size_t i = 0; i < handles.size(); ++i) {
-      RocksCachelibWrapperHandle* hdl =
-          static_cast<RocksCachelibWrapperHandle*>(handles[i]);
-      if (hdl->is_value_ready_) {
-        continue;
-      }
-      hdl->handle_ = std::move(new_handles[result_idx]).value();
-      result_idx++;
-      hdl->CalcValue();
+    for (auto h_ptr : handles) {
+      static_cast<RocksCachelibWrapperHandle*>(h_ptr)->Wait();
     }
   }
 
@@ -107,7 +92,6 @@ class RocksCachelibWrapperHandle : public rocksdb::SecondaryCacheResultHandle {
 
  private:
   FbCacheReadHandle handle_;
-  folly::SemiFuture<FbCacheReadHandle> future_;
   const rocksdb::Cache::CacheItemHelper* const helper_;
   rocksdb::Cache::CreateContext* const create_context_;
   void* val_;
@@ -122,6 +106,11 @@ class RocksCachelibWrapperHandle : public rocksdb::SecondaryCacheResultHandle {
       uint32_t size = handle_->getSize();
       rocksdb::Status s;
 
+      // The value is a copy of the item. SecondaryCache has no way to hand
+      // RocksDB a value that refers to memory it does not own: create_cb
+      // always copies the block into memory from its own allocator, and the
+      // value must outlive any handle we could keep. The handle is released
+      // right after the copy so the item is not pinned by RocksDB.
       const char* item = static_cast<const char*>(handle_->getMemory());
       s = helper_->create_cb(rocksdb::Slice(item, size),
                              rocksdb::CompressionType::kNoCompression,
@@ -133,8 +122,8 @@ class RocksCachelibWrapperHandle : public rocksdb::SecondaryCacheResultHandle {
       if (!s.ok()) {
         val_ = nullptr;
       }
-      handle_.reset();
     }
+    handle_.reset();
   }
 };
 } // namespace
@@ -189,23 +178,18 @@ RocksCachelibWrapper::Lookup(const rocksdb::Slice& key,
 
   if (cache) {
     auto handle = cache->find(FbCacheKey(key.data(), key.size()));
-    // We cannot dereference the handle in anyway. Any dereference will make it
-    // synchronous, so get the SamiFuture right away
+    // We cannot dereference the handle in anyway before it is ready. Any
+    // dereference will make it synchronous.
     // std::move the std::unique_lock<rcu_domain> (reader lock) to the
     // RocksCachelibWrapperHandle, and will be released when the handle is
     // destroyed.
     hdl = std::make_unique<RocksCachelibWrapperHandle>(
-        std::move(handle).toSemiFuture(),
-        helper,
-        create_context,
-        std::move(guard));
-    if (hdl->IsReady() || wait) {
-      if (!hdl->IsReady()) { // WART: double-call IsReady()
-        hdl->Wait();
-      }
-      if (hdl->Value() == nullptr) {
-        hdl.reset();
-      }
+        std::move(handle), helper, create_context, std::move(guard));
+    if (wait) {
+      hdl->Wait();
+    }
+    if (hdl->IsReady() && hdl->Value() == nullptr) {
+      hdl.reset();
     }
   }
 
@@ -118,6 +118,9 @@ class RocksCachelibWrapper : public rocksdb::SecondaryCache {
     return rocksdb::Status::NotSupported();
   }
 
+  // Without wait, a lookup that misses in DRAM returns a handle that is not
+  // ready while the item is read from flash, so that the reads of several
+  // lookups overlap. WaitAll() then waits for all of them.
   std::unique_ptr<rocksdb::SecondaryCacheResultHandle> Lookup(
       const rocksdb::Slice& key,
       const rocksdb::Cache::CacheItemHelper* helper,
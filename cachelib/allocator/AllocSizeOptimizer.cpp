@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/AllocSizeOptimizer.h"
+
+#include <folly/logging/xlog.h>
+
+namespace facebook::cachelib {
+
+AllocSizeOptimizer::~AllocSizeOptimizer() { stop(std::chrono::seconds(0)); }
+
+void AllocSizeOptimizer::work() {
+  try {
+    cache_.updateAllocSizeRecommendations();
+    numRuns_.fetch_add(1, std::memory_order_relaxed);
+  } catch (const std::exception& ex) {
+    XLOGF(CRITICAL, "Alloc size tuning interrupted due to exception: {}",
+          ex.what());
+    XDCHECK(false);
+  }
+}
+
+} // namespace facebook::cachelib
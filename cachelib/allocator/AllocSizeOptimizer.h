@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "cachelib/allocator/Cache.h"
+#include "cachelib/common/PeriodicWorker.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Periodic worker that recomputes the allocation sizes recommended for each
+// pool from the allocation sizes the cache sampled.
+class AllocSizeOptimizer : public PeriodicWorker {
+ public:
+  // @param cache   the cache interface
+  explicit AllocSizeOptimizer(CacheBase& cache) : cache_(cache) {}
+
+  ~AllocSizeOptimizer() override;
+
+  // number of times the recommendations were updated
+  uint64_t getNumRuns() const noexcept {
+    return numRuns_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // cache's interface for updating the recommendations
+  CacheBase& cache_;
+
+  std::atomic<uint64_t> numRuns_{0};
+
+  void work() final;
+};
+} // namespace cachelib
+} // namespace facebook
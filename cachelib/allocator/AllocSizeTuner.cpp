@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/AllocSizeTuner.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace facebook::cachelib {
+
+AllocSizeTuner::AllocSizeTuner(uint32_t sampleRate) : sampleRate_(sampleRate) {
+  if (sampleRate_ == 0) {
+    throw std::invalid_argument("Sample rate for alloc size tuning is 0");
+  }
+}
+
+size_t AllocSizeTuner::getBucketIdx(uint32_t size) noexcept {
+  const uint64_t units =
+      (static_cast<uint64_t>(size) + kAlignment - 1) / kAlignment;
+  if (units < 2 * kNumSubBuckets) {
+    return static_cast<size_t>(units);
+  }
+  // the kSubBucketBits bits after the most significant one pick the bucket
+  // within the power of two range.
+  const unsigned int shift = folly::findLastSet(units) - 1 - kSubBucketBits;
+  const size_t subBucket = (units >> shift) - kNumSubBuckets;
+  return kNumSubBuckets * (shift + 1) + subBucket;
+}
+
+uint32_t AllocSizeTuner::getBucketSize(size_t idx) noexcept {
+  if (idx < 2 * kNumSubBuckets) {
+    return static_cast<uint32_t>(idx * kAlignment);
+  }
+  const size_t shift = idx / kNumSubBuckets - 1;
+  const uint64_t subBucket = idx % kNumSubBuckets;
+  const uint64_t maxUnits = ((kNumSubBuckets + subBucket + 1) << shift) - 1;
+  return static_cast<uint32_t>(
+      std::min<uint64_t>(maxUnits * kAlignment,
+                         std::numeric_limits<uint32_t>::max() / kAlignment *
+                             kAlignment));
+}
+
+std::map<uint32_t, uint64_t> AllocSizeTuner::getSizeDistribution() const {
+  std::map<uint32_t, uint64_t> distribution;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    const auto count = counts_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      distribution[getBucketSize(i)] += count;
+    }
+  }
+  return distribution;
+}
+
+void AllocSizeTuner::decay() noexcept {
+  for (auto& count : counts_) {
+    // racing with recordAllocation at worst loses a few samples.
+    count.store(count.load(std::memory_order_relaxed) / 2,
+                std::memory_order_relaxed);
+  }
+}
+
+AllocSizeRecommendation AllocSizeTuner::recommend(
+    const std::set<uint32_t>& currentAllocSizes,
+    size_t maxNumAllocSizes,
+    uint32_t minAllocSize) const {
+  AllocSizeRecommendation recommendation;
+  if (currentAllocSizes.empty() || maxNumAllocSizes == 0) {
+    return recommendation;
+  }
+
+  const auto distribution = getSizeDistribution();
+  const uint32_t maxAllocSize = *currentAllocSizes.rbegin();
+  for (const auto& [size, count] : distribution) {
+    if (size <= maxAllocSize) {
+      recommendation.numSamples += count;
+    }
+  }
+  if (recommendation.numSamples == 0) {
+    return recommendation;
+  }
+
+  recommendation.allocSizes =
+      computeAllocSizes(distribution, maxNumAllocSizes,
+                        std::min(minAllocSize, maxAllocSize), maxAllocSize);
+  recommendation.currentWastedBytes =
+      computeWastedBytes(distribution, currentAllocSizes);
+  recommendation.recommendedWastedBytes =
+      computeWastedBytes(distribution, recommendation.allocSizes);
+  return recommendation;
+}
+
+std::set<uint32_t> AllocSizeTuner::computeAllocSizes(
+    const std::map<uint32_t, uint64_t>& distribution,
+    size_t maxNumAllocSizes,
+    uint32_t minAllocSize,
+    uint32_t maxAllocSize) {
+  if (maxNumAllocSizes == 0) {
+    throw std::invalid_argument("Need at least one allocation size");
+  }
+  if (maxAllocSize < minAllocSize) {
+    throw std::invalid_argument(
+        folly::sformat("Max alloc size {} is less than min alloc size {}",
+                       maxAllocSize, minAllocSize));
+  }
+
+  // an optimal set of allocation sizes only uses sizes that some allocation
+  // fits exactly after alignment, so those are the candidates. Allocations
+  // are grouped by the smallest candidate they fit in.
+  std::vector<uint32_t> candidates;
+  std::vector<double> counts;
+  std::vector<double> bytes;
+  for (const auto& [size, count] : distribution) {
+    if (size > maxAllocSize || count == 0) {
+      continue;
+    }
+    const uint32_t candidate = std::min(
+        maxAllocSize,
+        std::max(minAllocSize,
+                 (size + kAlignment - 1) / kAlignment * kAlignment));
+    if (candidates.empty() || candidates.back() != candidate) {
+      candidates.push_back(candidate);
+      counts.push_back(0);
+      bytes.push_back(0);
+    }
+    counts.back() += count;
+    bytes.back() += static_cast<double>(count) * size;
+  }
+  if (candidates.empty() || candidates.back() != maxAllocSize) {
+    candidates.push_back(maxAllocSize);
+    counts.push_back(0);
+    bytes.push_back(0);
+  }
+
+  const size_t n = candidates.size();
+  const size_t k = std::min(maxNumAllocSizes, n);
+
+  // prefix sums over the candidates so that the bytes wasted by serving the
+  // allocations of candidates (i, j] with candidate j is computed in O(1).
+  std::vector<double> prefixCounts(n + 1, 0);
+  std::vector<double> prefixBytes(n + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    prefixCounts[i + 1] = prefixCounts[i] + counts[i];
+    prefixBytes[i + 1] = prefixBytes[i] + bytes[i];
+  }
+  auto wasted = [&](size_t i, size_t j) {
+    return candidates[j - 1] * (prefixCounts[j] - prefixCounts[i]) -
+           (prefixBytes[j] - prefixBytes[i]);
+  };
+
+  // cost[c][j] is the least waste for the allocations of the first j
+  // candidates using c allocation sizes, the largest being candidate j.
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> cost(k + 1, std::vector<double>(n + 1, kInf));
+  std::vector<std::vector<size_t>> prev(k + 1, std::vector<size_t>(n + 1, 0));
+  cost[0][0] = 0;
+  for (size_t c = 1; c <= k; c++) {
+    for (size_t j = c; j <= n; j++) {
+      for (size_t i = c - 1; i < j; i++) {
+        if (cost[c - 1][i] == kInf) {
+          continue;
+        }
+        const double total = cost[c - 1][i] + wasted(i, j);
+        if (total < cost[c][j]) {
+          cost[c][j] = total;
+          prev[c][j] = i;
+        }
+      }
+    }
+  }
+
+  // more sizes never waste more, but stop adding sizes that do not help.
+  size_t best = 1;
+  for (size_t c = 2; c <= k; c++) {
+    if (cost[c][n] < cost[best][n]) {
+      best = c;
+    }
+  }
+
+  std::set<uint32_t> allocSizes;
+  for (size_t c = best, j = n; c > 0; j = prev[c][j], c--) {
+    allocSizes.insert(candidates[j - 1]);
+  }
+  return allocSizes;
+}
+
+double AllocSizeTuner::computeWastedBytes(
+    const std::map<uint32_t, uint64_t>& distribution,
+    const std::set<uint32_t>& allocSizes) {
+  double wastedBytes = 0;
+  uint64_t numAllocs = 0;
+  for (const auto& [size, count] : distribution) {
+    const auto it = allocSizes.lower_bound(size);
+    if (it == allocSizes.end()) {
+      continue;
+    }
+    wastedBytes += static_cast<double>(count) * (*it - size);
+    numAllocs += count;
+  }
+  return numAllocs == 0 ? 0 : wastedBytes / numAllocs;
+}
+
+} // namespace facebook::cachelib
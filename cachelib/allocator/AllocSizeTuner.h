@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <set>
+
+namespace facebook {
+namespace cachelib {
+
+// Allocation sizes recommended for a pool from the sizes sampled from it.
+struct AllocSizeRecommendation {
+  // the recommended allocation sizes. Empty when nothing was sampled.
+  std::set<uint32_t> allocSizes{};
+
+  // number of sampled allocations the recommendation is based on.
+  uint64_t numSamples{0};
+
+  // average bytes wasted per sampled allocation by rounding it up to its
+  // allocation size, with the pool's current sizes and the recommended ones.
+  double currentWastedBytes{0};
+  double recommendedWastedBytes{0};
+};
+
+// Samples the sizes of the allocations made from a pool and computes the
+// allocation sizes that minimize their internal fragmentation.
+//
+// Sampled sizes are kept in buckets that are exact up to 1KB, in steps of
+// 8 bytes. Past that every power of two range is split into 64 buckets, so a
+// size is accounted as at most 1/64th larger than it is.
+class AllocSizeTuner {
+ public:
+  // @param sampleRate  one out of this many allocations is sampled
+  //
+  // @throw std::invalid_argument if sampleRate is 0
+  explicit AllocSizeTuner(uint32_t sampleRate);
+
+  // record the size of an allocation if it is picked by the sampling.
+  void recordAllocation(uint32_t size) noexcept {
+    static thread_local uint32_t numAllocations = 0;
+    if (++numAllocations % sampleRate_ != 0) {
+      return;
+    }
+    counts_[getBucketIdx(size)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // @return  map from the largest size of each non empty bucket to the number
+  //          of samples in it.
+  std::map<uint32_t, uint64_t> getSizeDistribution() const;
+
+  // halve the number of samples so that older samples weigh less than newer
+  // ones.
+  void decay() noexcept;
+
+  // @param currentAllocSizes   the allocation sizes the pool uses now
+  // @param maxNumAllocSizes    upper bound on the recommended sizes
+  // @param minAllocSize        smallest allocation size allowed
+  //
+  // @return recommendation for the sampled sizes. The recommended sizes
+  //         always include the largest current size so that everything
+  //         allocatable from the pool stays allocatable.
+  AllocSizeRecommendation recommend(const std::set<uint32_t>& currentAllocSizes,
+                                    size_t maxNumAllocSizes,
+                                    uint32_t minAllocSize) const;
+
+  // Compute the allocation sizes that minimize the bytes wasted by rounding
+  // every size in the distribution up to its allocation size.
+  //
+  // @param distribution      map from size to number of allocations
+  // @param maxNumAllocSizes  upper bound on the number of sizes
+  // @param minAllocSize      smallest allocation size allowed
+  // @param maxAllocSize      largest allocation size. Always part of the
+  //                          result, and sizes above it are ignored.
+  //
+  // @return  the allocation sizes. Sizes other than minAllocSize and
+  //          maxAllocSize are multiples of 8.
+  //
+  // @throw std::invalid_argument if maxNumAllocSizes is 0 or maxAllocSize is
+  //        less than minAllocSize
+  static std::set<uint32_t> computeAllocSizes(
+      const std::map<uint32_t, uint64_t>& distribution,
+      size_t maxNumAllocSizes,
+      uint32_t minAllocSize,
+      uint32_t maxAllocSize);
+
+  // @return  average bytes wasted per allocation in the distribution when
+  //          using allocSizes. Sizes above the largest allocation size are
+  //          ignored.
+  static double computeWastedBytes(
+      const std::map<uint32_t, uint64_t>& distribution,
+      const std::set<uint32_t>& allocSizes);
+
+ private:
+  // sizes are tracked in units of the allocation alignment.
+  static constexpr uint32_t kAlignment = 8;
+  static constexpr unsigned int kSubBucketBits = 6;
+  static constexpr uint32_t kNumSubBuckets = 1u << kSubBucketBits;
+  // exact buckets for the first 2 * kNumSubBuckets units, then
+  // kNumSubBuckets per power of two up to 2^32 bytes.
+  static constexpr size_t kNumBuckets =
+      kNumSubBuckets * (2 + 32 - 3 - kSubBucketBits);
+
+  static size_t getBucketIdx(uint32_t size) noexcept;
+
+  // largest size that falls into the bucket.
+  static uint32_t getBucketSize(size_t idx) noexcept;
+
+  const uint32_t sampleRate_;
+
+  std::array<std::atomic<uint64_t>, kNumBuckets> counts_{};
+};
+} // namespace cachelib
+} // namespace facebook
@@ -16,6 +16,14 @@
 
 #pragma once
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
 #include "cachelib/allocator/BackgroundMoverStrategy.h"
 #include "cachelib/allocator/CacheStats.h"
 #include "cachelib/common/AtomicCounter.h"
@@ -64,6 +72,9 @@ class BackgroundMover : public PeriodicWorker {
 
   void setAssignedMemory(std::vector<MemoryDescriptorType>&& assignedMemory);
 
+  // pin the worker thread to @cpu from its next run on
+  void setCpu(uint32_t cpu) noexcept { cpu_ = cpu; }
+
   // return id of the worker responsible for promoting/evicting from particlar
   // pool and allocation calss (id is in range [0, numWorkers))
   static size_t workerId(PoolId pid, ClassId cid, size_t numWorkers);
@@ -83,12 +94,21 @@ class BackgroundMover : public PeriodicWorker {
   void work() override final;
   void checkAndRun();
 
+  // pins the calling thread to cpu_ if it is not pinned to it yet
+  void pinToCpu();
+
   AtomicCounter numMovedItems_{0};
   AtomicCounter numTraversals_{0};
   AtomicCounter totalBytesMoved_{0};
 
   std::vector<MemoryDescriptorType> assignedMemory_;
   folly::DistributedMutex mutex_;
+
+  static constexpr int64_t kNoCpu = -1;
+  // cpu to run on, kNoCpu for any
+  std::atomic<int64_t> cpu_{kNoCpu};
+  // cpu the worker thread is pinned to, only touched by the worker thread
+  int64_t pinnedCpu_{kNoCpu};
 };
 
 template <typename CacheT>
@@ -113,12 +133,33 @@ BackgroundMover<CacheT>::~BackgroundMover() {
 template <typename CacheT>
 void BackgroundMover<CacheT>::work() {
   try {
+    pinToCpu();
     checkAndRun();
   } catch (const std::exception& ex) {
     XLOGF(ERR, "BackgroundMover interrupted due to exception: {}", ex.what());
   }
 }
 
+template <typename CacheT>
+void BackgroundMover<CacheT>::pinToCpu() {
+  const auto cpu = cpu_.load(std::memory_order_relaxed);
+  if (cpu == pinnedCpu_) {
+    return;
+  }
+  // whatever the outcome, do not retry every run
+  pinnedCpu_ = cpu;
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(static_cast<int>(cpu), &cpuSet);
+  const auto ret =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+  if (ret != 0) {
+    XLOGF(ERR, "Failed to pin background mover to cpu {}: {}", cpu, ret);
+    return;
+  }
+  XLOGF(INFO, "Pinned background mover to cpu {}", cpu);
+}
+
 template <typename CacheT>
 void BackgroundMover<CacheT>::setAssignedMemory(
     std::vector<MemoryDescriptorType>&& assignedMemory) {
@@ -141,7 +182,18 @@ void BackgroundMover<CacheT>::checkAndRun() {
   unsigned int moves = 0;
   auto batches = strategy_->calculateBatchSizes(cache_, assignedMemory);
 
+  // make room in the pools of higher weights first
+  std::vector<std::pair<uint32_t, size_t>> order;
+  order.reserve(batches.size());
   for (size_t i = 0; i < batches.size(); i++) {
+    order.emplace_back(cache_.getPoolSloHint(assignedMemory[i].pid_).weight,
+                       i);
+  }
+  std::stable_sort(
+      order.begin(), order.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  for (const auto& [weight, i] : order) {
     const auto [pid, cid] = assignedMemory[i];
     const auto batch = batches[i];
 
@@ -97,6 +97,9 @@ CCacheAllocator::SerializationType CCacheAllocator::saveState() {
   *object.ccMetadata() = ccType_.saveState();
 
   std::lock_guard<std::mutex> guard(resizeLock_);
+  // a resize in progress is only tracked in memory, the restored compact
+  // cache would read the chunks with the new layout
+  finishCompactCacheResizeLocked();
   for (auto chunk : getCurrentChunks()) {
     // TODO : pass multi-tier flag when compact cache supports multi-tier config
     object.chunks()->push_back(
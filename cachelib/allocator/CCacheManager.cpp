@@ -25,41 +25,45 @@ CCacheManager::CCacheManager(const SerializationType& object,
 
   for (const auto& allocator : *object.allocators()) {
     auto id = memoryAllocator_.getPoolId(allocator.first);
-    allocators_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(allocator.first),
-        std::forward_as_tuple(memoryAllocator_, id, allocator.second));
+    addAllocatorLocked(allocator.first, memoryAllocator_, id,
+                       allocator.second);
   }
 }
 
-CCacheAllocator& CCacheManager::addAllocator(const std::string& name,
-                                             PoolId poolId) {
-  std::lock_guard<std::mutex> guard(lock_);
-  auto result =
-      allocators_.emplace(std::piecewise_construct,
-                          std::forward_as_tuple(name),
-                          std::forward_as_tuple(memoryAllocator_, poolId));
-  if (!result.second) {
+template <typename... Args>
+CCacheAllocator& CCacheManager::addAllocatorLocked(const std::string& name,
+                                                   Args&&... args) {
+  if (allocators_.read()->count(name)) {
     throw std::invalid_argument(
         folly::sformat("Duplicate allocator named {}", name));
   }
-  return result.first->second;
+  ownedAllocators_.push_back(
+      std::make_unique<CCacheAllocator>(std::forward<Args>(args)...));
+  auto* allocator = ownedAllocators_.back().get();
+  allocators_.update(
+      [&](AllocatorMap& allocators) { allocators.emplace(name, allocator); });
+  return *allocator;
 }
 
-CCacheAllocator& CCacheManager::getAllocator(const std::string& name) {
+CCacheAllocator& CCacheManager::addAllocator(const std::string& name,
+                                             PoolId poolId) {
   std::lock_guard<std::mutex> guard(lock_);
-  return allocators_.at(name);
+  return addAllocatorLocked(name, memoryAllocator_, poolId);
+}
+
+CCacheAllocator& CCacheManager::getAllocator(const std::string& name) {
+  return *allocators_.read()->at(name);
 }
 
 void CCacheManager::resizeAll() {
-  // put all allocator pointers into a vector Before starting resizing because
+  // put all allocator pointers into a vector before starting resizing because
   // resizing compact cache involves rehashing which can take a long time, and
-  // we don't want to hold the lock for the entire duration
+  // we don't want to hold back adding an allocator for the entire duration
   std::vector<CCacheAllocator*> allAllocators;
   {
-    std::lock_guard<std::mutex> guard(lock_);
-    for (auto& allocator : allocators_) {
-      allAllocators.push_back(&allocator.second);
+    auto allocators = allocators_.read();
+    for (auto& allocator : *allocators) {
+      allAllocators.push_back(allocator.second);
     }
   }
 
@@ -75,12 +79,29 @@ void CCacheManager::resizeAll() {
   }
 }
 
-CCacheManager::SerializationType CCacheManager::saveState() {
-  std::lock_guard<std::mutex> guard(lock_);
+std::unordered_map<std::string, CCacheResizeStats>
+CCacheManager::getResizeStats() {
+  std::vector<std::pair<std::string, CCacheAllocator*>> allAllocators;
+  {
+    auto allocators = allocators_.read();
+    allAllocators.assign(allocators->begin(), allocators->end());
+  }
 
+  // a resize step holds the allocator lock, so don't keep adding an
+  // allocator waiting meanwhile
+  std::unordered_map<std::string, CCacheResizeStats> stats;
+  for (auto& [name, allocator] : allAllocators) {
+    stats.emplace(name, allocator->getCompactCacheResizeStats());
+  }
+  return stats;
+}
+
+CCacheManager::SerializationType CCacheManager::saveState() {
   SerializationType object;
-  for (auto& allocator : allocators_) {
-    object.allocators()->emplace(allocator.first, allocator.second.saveState());
+  auto allocators = allocators_.read();
+  for (auto& allocator : *allocators) {
+    object.allocators()->emplace(allocator.first,
+                                 allocator.second->saveState());
   }
   return object;
 }
@@ -16,8 +16,15 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "cachelib/allocator/CCacheAllocator.h"
 #include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/Cohort.h"
 
 namespace facebook {
 namespace cachelib {
@@ -58,6 +65,13 @@ class CCacheManager {
    */
   void resizeAll();
 
+  /**
+   * Get the resize progress of all compact caches
+   *
+   * @return resize stats keyed by the names of the pools
+   */
+  std::unordered_map<std::string, CCacheResizeStats> getResizeStats();
+
   /**
    * Save the state of all compact cache allocators in an object
    *
@@ -66,16 +80,22 @@ class CCacheManager {
   SerializationType saveState();
 
  private:
+  using AllocatorMap = std::unordered_map<std::string, CCacheAllocator*>;
+
+  // Creates the allocator and publishes it under @name
+  template <typename... Args>
+  CCacheAllocator& addAllocatorLocked(const std::string& name, Args&&... args);
+
+  // serializes adding allocators
   std::mutex lock_;
   MemoryAllocator& memoryAllocator_;
 
-  // Mapping from pool names to allocators
-  // Compact cache will have direct reference of the allocator, which is fine
-  // according to http://en.cppreference.com/w/cpp/container/unordered_map
-  // "References and pointers to either key or data stored in the container are
-  // only invalidated by erasing that element, even when the corresponding
-  // iterator is invalidated."
-  std::unordered_map<std::string, CCacheAllocator> allocators_;
+  // The allocators, never removed. Compact caches keep direct references to
+  // them.
+  std::vector<std::unique_ptr<CCacheAllocator>> ownedAllocators_;
+
+  // Mapping from pool names to allocators, read without taking lock_
+  CohortRcu<AllocatorMap> allocators_;
 };
 
 } // namespace cachelib
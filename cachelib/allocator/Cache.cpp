@@ -16,7 +16,10 @@
 
 #include "cachelib/allocator/Cache.h"
 
+#include <folly/Format.h>
+
 #include <mutex>
+#include <stdexcept>
 
 #include "cachelib/allocator/RebalanceStrategy.h"
 #include "cachelib/common/PercentileStats.h"
@@ -67,6 +70,23 @@ std::shared_ptr<PoolOptimizeStrategy> CacheBase::getPoolOptimizeStrategy()
   return poolOptimizeStrategy_;
 }
 
+void CacheBase::setPoolSloHint(PoolId pid, PoolSloHint hint) {
+  if (hint.weight == 0 ||
+      !(hint.minFreeAllocPct >= 0 && hint.minFreeAllocPct < 100)) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid slo hint for pool {}. weight: {}, min free alloc pct: {}",
+        static_cast<int>(pid), hint.weight, hint.minFreeAllocPct));
+  }
+  std::unique_lock<std::mutex> l(lock_);
+  poolSloHints_[pid] = hint;
+}
+
+PoolSloHint CacheBase::getPoolSloHint(PoolId pid) const {
+  std::unique_lock<std::mutex> l(lock_);
+  auto it = poolSloHints_.find(pid);
+  return it != poolSloHints_.end() ? it->second : PoolSloHint{};
+}
+
 void CacheBase::visitEstimates(const util::CounterVisitor& v,
                                const util::PercentileStats::Estimates& est,
                                folly::StringPiece name) {
@@ -134,6 +154,35 @@ void CacheBase::updatePoolStats(const std::string& statPrefix,
   // these will be populated irrespective of whether evictions happen.
   counters_.updateCount(prefix + "evictions.age.min", stats.minEvictionAge());
   counters_.updateCount(prefix + "evictions.age.max", stats.maxEvictionAge());
+
+  // predicted miss ratios around the current size, to size the pool and the
+  // host
+  const auto curve = getPoolMissRatioCurve(pid);
+  if (!curve.empty()) {
+    const auto missPct = [&](uint64_t bytes) {
+      return static_cast<uint64_t>(curve.getMissRatio(bytes) * 100);
+    };
+    counters_.updateCount(prefix + "mrc.miss_pct_half_size",
+                          missPct(stats.poolSize / 2));
+    counters_.updateCount(prefix + "mrc.miss_pct", missPct(stats.poolSize));
+    counters_.updateCount(prefix + "mrc.miss_pct_double_size",
+                          missPct(stats.poolSize * 2));
+  }
+
+  // contention on the mm container lock of each class, when it is tracked.
+  for (const auto& [cid, cacheStat] : stats.cacheStats) {
+    const auto& containerStat = cacheStat.containerStat;
+    if (containerStat.numLockContended == 0) {
+      continue;
+    }
+    const std::string lockPrefix =
+        prefix + "class." + std::to_string(cacheStat.allocSize) + ".mm_lock.";
+    counters_.updateDelta(lockPrefix + "contended",
+                          containerStat.numLockContended);
+    counters_.updateDelta(lockPrefix + "wait_sampled",
+                          containerStat.numLockWaitSampled);
+    counters_.updateDelta(lockPrefix + "wait_ns", containerStat.lockWaitNs);
+  }
 }
 
 void CacheBase::updateCompactCacheStats(const std::string& statPrefix,
@@ -307,6 +356,14 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
   counters_.updateDelta(statPrefix + "cache.gets.miss", stats.numCacheGetMiss);
   counters_.updateDelta(statPrefix + "cache.gets.expiries",
                         stats.numCacheGetExpiries);
+  counters_.updateDelta(statPrefix + "cache.gets.hot_key_replica_hits",
+                        stats.numHotKeyReplicaHits);
+  counters_.updateDelta(statPrefix + "cache.hot_key_replicas",
+                        stats.numHotKeyReplicasCreated);
+  counters_.updateDelta(statPrefix + "cache.gets.striped_refcount_hits",
+                        stats.numStripedRefcountHits);
+  counters_.updateDelta(statPrefix + "cache.striped_refcounts",
+                        stats.numStripedRefcountsCreated);
   counters_.updateDelta(statPrefix + "cache.removes", stats.numCacheRemoves);
   counters_.updateDelta(statPrefix + "cache.removes.ram_hits",
                         stats.numCacheRemoveRamHits);
@@ -323,6 +380,8 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
                         stats.reaperStats.numReapedItems);
   counters_.updateDelta(statPrefix + "reaper.visit_errs",
                         stats.reaperStats.numVisitErrs);
+  counters_.updateDelta(statPrefix + "reaper.index_skipped_slabs",
+                        stats.reaperStats.numIndexSkippedSlabs);
   counters_.updateDelta(statPrefix + "reaper.traverses",
                         stats.reaperStats.numTraversals);
   counters_.updateCount(statPrefix + "reaper.latency.traverse_last_ms",
@@ -368,6 +427,11 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
                         slabReleaseStats.numEvictionSuccesses);
   counters_.updateCount(statPrefix + "slabs.release_stuck",
                         slabReleaseStats.numSlabReleaseStuck);
+  counters_.updateDelta(statPrefix + "slabs.move_batches",
+                        slabReleaseStats.numMoveBatches);
+  counters_.updateCount(
+      statPrefix + "slabs.moved_pct",
+      static_cast<uint64_t>(slabReleaseStats.getMovedRatio() * 100));
 
   counters_.updateDelta(statPrefix + "evictions.concurrent_fill_failure",
                         stats.numEvictionFailureFromConcurrentFill);
@@ -411,10 +475,22 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
                           stats.numNvmGetMissDueToInflightRemove);
     counters_.updateDelta(statPrefix + "nvm.gets.miss.fast",
                           stats.numNvmGetMissFast);
+    counters_.updateDelta(statPrefix + "nvm.gets.miss.negative_cache",
+                          stats.numNvmGetMissNegativeCache);
     counters_.updateDelta(statPrefix + "nvm.gets.miss.expired",
                           stats.numNvmGetMissExpired);
     counters_.updateDelta(statPrefix + "nvm.gets.coalesced",
                           stats.numNvmGetCoalesced);
+    counters_.updateDelta(statPrefix + "nvm.prefetches",
+                          stats.numNvmPrefetches);
+    counters_.updateDelta(statPrefix + "nvm.prefetches.skipped",
+                          stats.numNvmPrefetchSkipped);
+    counters_.updateDelta(statPrefix + "nvm.prefetches.filled",
+                          stats.numNvmPrefetchFilled);
+    counters_.updateDelta(statPrefix + "nvm.prefetches.cancelled",
+                          stats.numNvmPrefetchCancelled);
+    counters_.updateDelta(statPrefix + "nvm.gets.served_without_fill",
+                          stats.numNvmGetServedWithoutFill);
 
     counters_.updateDelta(statPrefix + "nvm.puts", stats.numNvmPuts);
     counters_.updateDelta(statPrefix + "nvm.puts.clean",
@@ -426,6 +502,20 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
                           stats.numNvmAbortedPutOnInflightGet);
     counters_.updateDelta(statPrefix + "nvm.puts.encode_failure",
                           stats.numNvmPutEncodeFailure);
+    counters_.updateDelta(statPrefix + "nvm.puts.compressed",
+                          stats.numNvmCompressed);
+    counters_.updateDelta(statPrefix + "nvm.puts.compress_skipped",
+                          stats.numNvmCompressSkipped);
+    counters_.updateDelta(statPrefix + "nvm.puts.compress_bytes_in",
+                          stats.nvmCompressBytesIn);
+    counters_.updateDelta(statPrefix + "nvm.puts.compress_bytes_out",
+                          stats.nvmCompressBytesOut);
+    counters_.updateDelta(statPrefix + "nvm.puts.compress_ns",
+                          stats.nvmCompressNs);
+    counters_.updateDelta(statPrefix + "nvm.gets.decompress_ns",
+                          stats.nvmDecompressNs);
+    counters_.updateDelta(statPrefix + "nvm.gets.decompress_errs",
+                          stats.numNvmDecompressErrors);
 
     counters_.updateDelta(statPrefix + "nvm.evictions.clean",
                           stats.numNvmCleanEvict);
@@ -469,6 +559,27 @@ void CacheBase::updateGlobalCacheStats(const std::string& statPrefix) const {
     }
   }
 
+  const auto& lockContention = stats.accessContainerLockContention;
+  if (lockContention.numContended > 0) {
+    const std::string lockPrefix = statPrefix + "access_container.lock.";
+    counters_.updateDelta(lockPrefix + "contended",
+                          lockContention.numContended);
+    counters_.updateDelta(lockPrefix + "wait_sampled",
+                          lockContention.numSampled);
+    counters_.updateDelta(lockPrefix + "wait_ns", lockContention.waitNs);
+    if (lockContention.numSampled > 0) {
+      visitEstimates(uploadStats, lockContention.waitNsEstimates,
+                     lockPrefix + "wait_ns");
+    }
+    // the most contended locks, hottest first.
+    for (size_t i = 0; i < lockContention.hotStripes.size(); i++) {
+      const auto& hot = lockContention.hotStripes[i];
+      const std::string hotPrefix = lockPrefix + "hot." + std::to_string(i);
+      counters_.updateCount(hotPrefix + ".id", hot.stripe);
+      counters_.updateCount(hotPrefix + ".contended", hot.numContended);
+    }
+  }
+
   counters_.updateCount(statPrefix + "items.total", stats.numItems);
   counters_.updateCount(statPrefix + "items.chained_child",
                         stats.numChainedChildItems);
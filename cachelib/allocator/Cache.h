@@ -24,6 +24,7 @@
 #include "cachelib/allocator/CacheDetails.h"
 #include "cachelib/allocator/CacheStats.h"
 #include "cachelib/allocator/ICompactCache.h"
+#include "cachelib/allocator/MissRatioCurveEstimator.h"
 #include "cachelib/allocator/memory/MemoryAllocator.h"
 #include "cachelib/common/Hash.h"
 #include "cachelib/common/Utils.h"
@@ -35,6 +36,8 @@ class PoolResizer;
 class PoolRebalancer;
 class PoolOptimizer;
 class MemoryMonitor;
+class AllocSizeOptimizer;
+class AccessContainerResizer;
 
 // Forward declaration.
 class RebalanceStrategy;
@@ -73,6 +76,22 @@ enum class DestructorContext {
   kRemovedFromNVM
 };
 
+// Hint about how sensitive the allocations of a pool are to latency, so that
+// a latency sensitive pool sharing the cache with noisy neighbors does not
+// end up evicting in the foreground of its allocations.
+struct PoolSloHint {
+  // Weight of the pool against the others. The pool optimizer does not move
+  // memory from a pool to a pool of a lower weight, the pool resizer shrinks
+  // the pools of lower weights first, and the background evictors run for
+  // the pools of higher weights first.
+  uint32_t weight{1};
+
+  // Percentage of the allocations of every class of the pool that the
+  // background evictor keeps free, on top of the free allocations its
+  // strategy asks for.
+  double minFreeAllocPct{0};
+};
+
 // A base class of cache exposing members and status agnostic of template type.
 class CacheBase {
  public:
@@ -116,6 +135,14 @@ class CacheBase {
   virtual PoolEvictionAgeStats getPoolEvictionAgeStats(
       PoolId pid, unsigned int slabProjectionLength) const = 0;
 
+  // @param pid   pool id
+  //
+  // @return miss ratio curve estimated from the accesses of the regular pool
+  //         so far. Empty unless the curves are enabled.
+  virtual MissRatioCurve getPoolMissRatioCurve(PoolId /* pid */) const {
+    return {};
+  }
+
   // @return a map of <stat name -> stat value> representation for all the nvm
   // cache stats. This is useful for our monitoring to directly upload them.
   virtual util::StatsMap getNvmCacheStatsMap() const = 0;
@@ -185,6 +212,21 @@ class CacheBase {
   // @return The optimizing strategy of the specifid pool.
   std::shared_ptr<PoolOptimizeStrategy> getPoolOptimizeStrategy() const;
 
+  // Set the latency hint of a pool
+  //
+  // @param pid Pool id of the pool to set this hint on.
+  // @param hint The hint
+  //
+  // @throw std::invalid_argument if the weight is 0 or the percentage is
+  //        not in [0, 100)
+  void setPoolSloHint(PoolId pid, PoolSloHint hint);
+
+  // @param pid The pool id.
+  //
+  // @return The latency hint of the specified pool, the default hint if it
+  //         was not set.
+  PoolSloHint getPoolSloHint(PoolId pid) const;
+
   // return the list of currently active pools that are oversized
   virtual std::set<PoolId> getRegularPoolIdsForResize() const = 0;
 
@@ -297,6 +339,20 @@ class CacheBase {
   // @return The number of slabs that were actually reclaimed (<= numSlabs)
   virtual unsigned int reclaimSlabs(PoolId id, size_t numSlabs) = 0;
 
+  // Advise away the slabs released in SlabReleaseMode::kAdvise mode that
+  // are still waiting for a batch to fill up.
+  //
+  // @return The number of slabs advised away
+  virtual size_t adviseReleasedSlabs() { return 0; }
+
+  // Recompute the allocation sizes recommended for each pool from the
+  // allocation sizes sampled since the last call.
+  virtual void updateAllocSizeRecommendations() {}
+
+  // Make progress on growing the access containers that hold too many keys
+  // for their buckets.
+  virtual void resizeAccessContainers() {}
+
   // Update pool stats
   //   @param pid    the poolId that needs updating
   void updatePoolStats(const std::string& statPrefix, PoolId pid) const;
@@ -330,19 +386,22 @@ class CacheBase {
   };
   CacheHitRate calculateCacheHitRate(const std::string& statPrefix) const;
 
-  // Protect 'poolRebalanceStragtegies_' and `poolResizeStrategies_`
-  // and `poolOptimizeStrategy_`
+  // Protect 'poolRebalanceStragtegies_' and `poolResizeStrategies_`,
+  // `poolOptimizeStrategy_` and `poolSloHints_`
   mutable std::mutex lock_;
   std::unordered_map<PoolId, std::shared_ptr<RebalanceStrategy>>
       poolRebalanceStrategies_;
   std::unordered_map<PoolId, std::shared_ptr<RebalanceStrategy>>
       poolResizeStrategies_;
   std::shared_ptr<PoolOptimizeStrategy> poolOptimizeStrategy_;
+  std::unordered_map<PoolId, PoolSloHint> poolSloHints_;
 
   friend PoolResizer;
   friend PoolRebalancer;
   friend PoolOptimizer;
   friend MemoryMonitor;
+  friend AllocSizeOptimizer;
+  friend AccessContainerResizer;
   friend AllocatorConfigExporter;
 };
 } // namespace cachelib
@@ -21,18 +21,25 @@
 #include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/fibers/TimedMutex.h>
+#include <folly/hash/Hash.h>
 #include <folly/json/DynamicConverter.h>
 #include <folly/logging/xlog.h>
 #include <folly/synchronization/SanitizeThread.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <functional>
+#include <future>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -40,6 +47,9 @@
 #include <folly/Range.h>
 #pragma GCC diagnostic pop
 
+#include "cachelib/allocator/AccessContainerResizer.h"
+#include "cachelib/allocator/AllocSizeOptimizer.h"
+#include "cachelib/allocator/AllocSizeTuner.h"
 #include "cachelib/allocator/BackgroundMover.h"
 #include "cachelib/allocator/CCacheManager.h"
 #include "cachelib/allocator/Cache.h"
@@ -51,19 +61,29 @@
 #include "cachelib/allocator/CacheTraits.h"
 #include "cachelib/allocator/CacheVersion.h"
 #include "cachelib/allocator/ChainedAllocs.h"
+#include "cachelib/allocator/DeferredReleaser.h"
+#include "cachelib/allocator/EvictionAgeSampler.h"
+#include "cachelib/allocator/LargeItem.h"
+#include "cachelib/allocator/FormatUpgrades.h"
+#include "cachelib/allocator/HotKeyReplicas.h"
 #include "cachelib/allocator/ICompactCache.h"
 #include "cachelib/allocator/KAllocation.h"
 #include "cachelib/allocator/MemoryMonitor.h"
+#include "cachelib/allocator/MissRatioCurveEstimator.h"
 #include "cachelib/allocator/NvmAdmissionPolicy.h"
 #include "cachelib/allocator/NvmCacheState.h"
 #include "cachelib/allocator/PoolOptimizeStrategy.h"
 #include "cachelib/allocator/PoolOptimizer.h"
 #include "cachelib/allocator/PoolRebalancer.h"
 #include "cachelib/allocator/PoolResizer.h"
+#include "cachelib/allocator/PromotionStrategy.h"
 #include "cachelib/allocator/ReadOnlySharedCacheView.h"
 #include "cachelib/allocator/Reaper.h"
 #include "cachelib/allocator/RebalanceStrategy.h"
 #include "cachelib/allocator/Refcount.h"
+#include "cachelib/allocator/SlabExpiryIndex.h"
+#include "cachelib/allocator/StatsSnapshotter.h"
+#include "cachelib/allocator/StripedRefcounts.h"
 #include "cachelib/allocator/TempShmMapping.h"
 #include "cachelib/allocator/TlsActiveItemRing.h"
 #include "cachelib/allocator/TypedHandle.h"
@@ -73,6 +93,7 @@
 #include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
 #include "cachelib/allocator/nvmcache/NvmCache.h"
 #include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/CountMinSketch.h"
 #include "cachelib/common/Exceptions.h"
 #include "cachelib/common/Hash.h"
 #include "cachelib/common/Mutex.h"
@@ -80,6 +101,7 @@
 #include "cachelib/common/Serialization.h"
 #include "cachelib/common/Throttler.h"
 #include "cachelib/common/Time.h"
+#include "cachelib/common/Tracepoints.h"
 #include "cachelib/common/Utils.h"
 #include "cachelib/shm/ShmManager.h"
 
@@ -217,6 +239,8 @@ class CacheAllocator : public CacheBase {
   using ChainedAllocs = CacheChainedAllocs<CacheT, ReadHandle, ChainedItemIter>;
   using WritableChainedAllocs =
       CacheChainedAllocs<CacheT, WriteHandle, WritableChainedItemIter>;
+  using LargeItem = CacheLargeItem<CacheT, ReadHandle>;
+  using WritableLargeItem = CacheLargeItem<CacheT, WriteHandle>;
 
   using Key = typename Item::Key;
   using PoolIds = std::set<PoolId>;
@@ -340,6 +364,14 @@ class CacheAllocator : public CacheBase {
   using NvmCacheConfig = typename NvmCacheT::Config;
   using DeleteTombStoneGuard = typename NvmCacheT::DeleteTombStoneGuard;
 
+  // the optional features compiled into the allocator by the cache trait,
+  // see CacheItem.h
+  static constexpr bool kHasNvmCache =
+      detail::HasNvmCacheFeature<CacheTrait>::value;
+  static constexpr bool kHasChainedItems = Item::kHasChainedItems;
+  static constexpr bool kHasItemCallbacks =
+      detail::HasItemCallbacksFeature<CacheTrait>::value;
+
   // Interface for the sync object provided by the user if movingSync is turned
   // on.
   // SyncObj is for CacheLib to obtain exclusive access to an item when
@@ -411,7 +443,8 @@ class CacheAllocator : public CacheBase {
   //              and can not find an eviction.
   // @throw   std::invalid_argument if the poolId is invalid or the size
   //          requested is invalid or if the key is invalid(key.size() == 0 or
-  //          key.size() > 255)
+  //          key.size() > 255), or if a TTL is given to a cache whose items
+  //          have no expiry time
   WriteHandle allocate(PoolId id,
                        Key key,
                        uint32_t size,
@@ -445,6 +478,60 @@ class CacheAllocator : public CacheBase {
   // @throw std::invalid_argument if parent is nullptr
   void addChainedItem(WriteHandle& parent, WriteHandle child);
 
+  // Allocate a large item, whose value is split into chunks of chained items
+  // that the parent indexes in order (see LargeItem.h). The value is written
+  // and read through viewAsWritableLargeItem and viewAsLargeItem, which do
+  // not walk the chain. The item is inserted like any other item. Its chunks
+  // must not be popped.
+  //
+  // @param id          the pool id for the allocation
+  // @param key         the key for the item
+  // @param size        the size of the value
+  // @param chunkSize   the size of every chunk but the last one. Chunks are
+  //                    allocated from the pool, so a chunk and its chained
+  //                    item header must fit its largest allocation class.
+  // @param ttlSecs     Time To Live(second) for the item
+  //
+  // @return      the handle for the parent or an invalid handle(nullptr) if
+  //              any allocation failed
+  // @throw   std::invalid_argument if the chunk size is 0 or too small for
+  //          the value, or for the same reasons as allocate()
+  WriteHandle allocateLargeItem(PoolId id,
+                                Key key,
+                                uint64_t size,
+                                uint32_t chunkSize,
+                                uint32_t ttlSecs = 0);
+
+  // @return true if the item is the parent of a large item. Large items are
+  //         told apart by an item flag set by allocateLargeItem(), never by
+  //         their payload, which a regular item could forge.
+  bool isLargeItem(const Item& item) const noexcept {
+    return item.isLargeItem() && item.hasChainedItem() &&
+           LargeItemLayout<CompressedPtrType>::getHeader(
+               item.getMemory(), item.getSize()) != nullptr;
+  }
+
+  // view the value of a large item as its chunks in order. This blocks
+  // replacing its chunks until the view is released.
+  //
+  // @param parent  the parent of the large item
+  // @return        read-only view of the chunks
+  //
+  // @throw std::invalid_argument if the item is not a large item
+  LargeItem viewAsLargeItem(const ReadHandle& parent) {
+    return viewAsLargeItemT<ReadHandle>(parent);
+  }
+
+  // view the value of a writable large item as its chunks in order
+  //
+  // @param parent  the parent of the large item
+  // @return        writable view of the chunks
+  //
+  // @throw std::invalid_argument if the item is not a large item
+  WritableLargeItem viewAsWritableLargeItem(const WriteHandle& parent) {
+    return viewAsLargeItemT<WriteHandle>(parent);
+  }
+
   // Pop the first chained item assocaited with this parent and unmark this
   // parent handle as having chained allocations.
   // The parent handle is not reset (to become a null handle) so that the caller
@@ -540,6 +627,43 @@ class CacheAllocator : public CacheBase {
   //                  key does not exist.
   ReadHandle find(Key key);
 
+  // look up an item by its key across the nvm cache as well if enabled,
+  // without blocking. The returned future is ready right away on a DRAM hit
+  // or miss. Otherwise it completes once the item is loaded from the nvm
+  // cache, from the thread that finishes the lookup. Continuations should be
+  // scheduled on an executor of the caller's choosing (e.g. via()) rather
+  // than run inline on cachelib's nvm cache threads.
+  //
+  // @param key       the key for lookup
+  //
+  // @return          a future for the read handle of the item, set to a
+  //                  handle to nullptr if the key does not exist.
+  folly::SemiFuture<ReadHandle> findAsync(Key key);
+
+  // look up a batch of items by their keys across the nvm cache as well if
+  // enabled. This is equivalent to calling find() for every key, but hashes
+  // and prefetches all the keys up front and acquires each access container
+  // lock at most once for the batch. The keys that miss in dram are looked up
+  // in the nvm cache together.
+  //
+  // @param keys      the keys for lookup
+  //
+  // @return          vector of read handles in the same order as keys. A
+  //                  handle is nullptr if the key does not exist.
+  std::vector<ReadHandle> findBatch(folly::Range<const Key*> keys);
+
+  // bring a batch of items from the nvm cache into dram in the background,
+  // ahead of the finds expected for them. Does not wait for the items to be
+  // loaded. The nvm lookups run at a lower priority than the ones of finds.
+  // The keys already in dram or being fetched are skipped, and so are the
+  // keys beyond the in flight prefetch limit of the nvm cache config.
+  //
+  // @param keys      the keys to prefetch
+  //
+  // @return          the number of keys looked up in the nvm cache. 0 if nvm
+  //                  cache is not enabled.
+  size_t prefetch(folly::Range<const Key*> keys);
+
   // Warning: this API is synchronous today with HybridCache. This means as
   //          opposed to find(), we will block on an item being read from
   //          flash until it is loaded into DRAM-cache. In find(), if an item
@@ -632,6 +756,19 @@ class CacheAllocator : public CacheBase {
 
   AccessIterator end() { return accessContainer_->end(); }
 
+  // returns handles to up to @maxItems of the most recently used items of
+  // the allocation class, hottest first, in the order of its MMContainer.
+  // Used to stream the hot items of the cache elsewhere, such as to warm up
+  // a replacement host. The MMContainer lock is held only while the keys
+  // are copied; the items are then looked up like peek() does, so items
+  // removed meanwhile are skipped and their position is not bumped. With
+  // several MMContainer shards, each contributes its share of the items.
+  //
+  // @param pid       the pool of the items
+  // @param cid       the allocation class of the items
+  // @param maxItems  the most items to return
+  std::vector<ReadHandle> getHotItems(PoolId pid, ClassId cid, size_t maxItems);
+
   enum class RemoveRes : uint8_t {
     kSuccess,
     kNotFoundInRam,
@@ -647,6 +784,23 @@ class CacheAllocator : public CacheBase {
   //              check nvm)
   RemoveRes remove(Key key);
 
+  using RemoveBatchResult = typename NvmCacheT::RemoveBatchResult;
+  using RemoveBatchCallback = typename NvmCacheT::RemoveBatchCallback;
+
+  // removes a batch of keys. This is equivalent to calling remove() for every
+  // key, except that the removes from the nvm cache are submitted together
+  // instead of as one job per key, which is cheaper for bulk invalidations.
+  // The keys are removed from memory before this returns.
+  //
+  // @param keys  the keys to remove
+  // @param cb    invoked once the keys are removed from the nvm cache with
+  //              the outcome there, on a navy worker thread or before this
+  //              returns. Invoked with an empty outcome if nvm cache is not
+  //              enabled. Optional.
+  // @return      the number of keys removed from memory
+  size_t removeBatch(folly::Range<const Key*> keys,
+                     RemoveBatchCallback cb = {});
+
   // remove the key that the iterator is pointing to. The element will
   // not be accessible upon success. However, the elemenet will not actually be
   // recycled until the iterator destroys the internal handle.
@@ -732,6 +886,7 @@ class CacheAllocator : public CacheBase {
   //
   // When the read handle has one or more chained items attached to it,
   // user will also get a series of IOBufs (first of which is the Parent).
+  // For a large item, the IOBufs are its chunks in order, without the parent.
   //
   // **WARNING**: folly::IOBuf allows mutation to a cachelib item even when the
   // item is read-only. User is responsible to ensure no mutation occurs (i.e.
@@ -904,10 +1059,14 @@ class CacheAllocator : public CacheBase {
   //                              RemoveCb removeCb,
   //                              ReplaceCb replaceCb,
   //                              ValidCb validCb,
-  //                              bool allowPromotions = true);
+  //                              bool allowPromotions = true,
+  //                              uint32_t lockHashPower = 10,
+  //                              bool optimisticReads = false);
   //              addCompactCache(folly::StringPiece name,
   //                              size_t size,
-  //                              bool allowPromotions = true);
+  //                              bool allowPromotions = true,
+  //                              uint32_t lockHashPower = 10,
+  //                              bool optimisticReads = false);
   //
   // @return pointer to CompactCache instance of the template type
   //
@@ -930,9 +1089,13 @@ class CacheAllocator : public CacheBase {
   //                                 RemoveCb removeCb,
   //                                 ReplaceCb replaceCb,
   //                                 ValidCb validCb,
-  //                                 bool allowPromotions = true);
+  //                                 bool allowPromotions = true,
+  //                                 uint32_t lockHashPower = 10,
+  //                                 bool optimisticReads = false);
   //              attachCompactCache(folly::StringPiece name,
-  //                                 bool allowPromotions = true);
+  //                                 bool allowPromotions = true,
+  //                                 uint32_t lockHashPower = 10,
+  //                                 bool optimisticReads = false);
   //
   // @return  pointer to CompactCache instance of the template type.
   //
@@ -977,6 +1140,24 @@ class CacheAllocator : public CacheBase {
   //          kSavedOnlyDRAM and kSavedOnlyNvmCache - partial content saved
   ShutDownStatus shutDown();
 
+  // Time spent in each phase of the last shutDown(). With parallel shutdown,
+  // persisting the NvmCache overlaps with persisting the DRAM cache.
+  struct ShutDownTimings {
+    std::chrono::milliseconds stopWorkers{0};
+    // flushing the NvmCache and persisting its index
+    std::chrono::milliseconds saveNvmCache{0};
+    // serializing the DRAM cache metadata and writing it to shared memory
+    std::chrono::milliseconds saveRamCache{0};
+    // detaching the shared memory segments
+    std::chrono::milliseconds shmShutDown{0};
+    std::chrono::milliseconds total{0};
+  };
+
+  // @return the timings of the last shutDown(), all 0 if it was not called
+  const ShutDownTimings& getShutDownTimings() const noexcept {
+    return shutDownTimings_;
+  }
+
   // No-op for workers that are already running. Typically user uses this in
   // conjunction with `config.delayWorkerStart()` to avoid initialization
   // ordering issues with user callback for cachelib's workers.
@@ -992,11 +1173,14 @@ class CacheAllocator : public CacheBase {
   // allocation divided by the number of allocations in one slab. Only
   // allocation classes with a higher free-alloc-slab than the threshold would
   // be picked as a victim.
+  // @param numThreads          number of slabs of different pools released
+  // concurrently.
   //
   //
   bool startNewPoolRebalancer(std::chrono::milliseconds interval,
                               std::shared_ptr<RebalanceStrategy> strategy,
-                              unsigned int freeAllocThreshold);
+                              unsigned int freeAllocThreshold,
+                              unsigned int numThreads = 1);
 
   // start pool resizer
   // @param interval                the period this worker fires.
@@ -1018,6 +1202,21 @@ class CacheAllocator : public CacheBase {
                              std::chrono::seconds ccacheInterval,
                              std::shared_ptr<PoolOptimizeStrategy> strategy,
                              unsigned int ccacheStepSizePercent);
+
+  // start alloc size optimizer. Allocation sizes are only sampled when alloc
+  // size tuning was enabled in the config the cache was created with.
+  // @param interval   the period for recomputing the recommendations
+  bool startNewAllocSizeOptimizer(std::chrono::milliseconds interval);
+
+  // start growing the access containers in the background.
+  // @param interval   the period for checking the access containers
+  bool startNewAccessContainerResizer(std::chrono::milliseconds interval);
+
+  // start taking stats snapshots in the background.
+  // @param interval    the period between snapshots
+  // @param statPrefix  prefix of the names of the counters
+  bool startNewStatsSnapshotter(std::chrono::seconds interval,
+                                std::string statPrefix);
   // start memory monitor
   // @param memMonitorMode                  memory monitor mode
   // @param interval                        the period this worker fires
@@ -1099,6 +1298,15 @@ class CacheAllocator : public CacheBase {
   bool stopPoolResizer(std::chrono::seconds timeout = std::chrono::seconds{0});
   bool stopPoolOptimizer(std::chrono::seconds timeout = std::chrono::seconds{
                              0});
+  bool stopAllocSizeOptimizer(
+      std::chrono::seconds timeout = std::chrono::seconds{0});
+  bool stopAccessContainerResizer(
+      std::chrono::seconds timeout = std::chrono::seconds{0});
+  bool stopStatsSnapshotter(
+      std::chrono::seconds timeout = std::chrono::seconds{0});
+  // releases the items that are still pending before returning
+  bool stopDeferredReleaser(
+      std::chrono::seconds timeout = std::chrono::seconds{0});
   bool stopMemMonitor(std::chrono::seconds timeout = std::chrono::seconds{0});
   bool stopReaper(std::chrono::seconds timeout = std::chrono::seconds{0});
   bool stopBackgroundEvictor(
@@ -1189,6 +1397,12 @@ class CacheAllocator : public CacheBase {
     return stats;
   }
 
+  // returns the stats of the items released in the background
+  DeferredReleaserStats getDeferredReleaserStats() const {
+    return deferredReleaser_ ? deferredReleaser_->getStats()
+                             : DeferredReleaserStats{};
+  }
+
   // returns the pool rebalancer stats
   RebalancerStats getRebalancerStats() const {
     auto stats =
@@ -1219,6 +1433,25 @@ class CacheAllocator : public CacheBase {
   PoolEvictionAgeStats getPoolEvictionAgeStats(
       PoolId pid, unsigned int slabProjectionLength) const override final;
 
+  // allocation sizes recommended for the pool from the sizes of the
+  // allocations sampled from it. Empty unless alloc size tuning is enabled
+  // and the AllocSizeOptimizer ran at least once.
+  //
+  // @throw std::invalid_argument if the pool id is invalid
+  AllocSizeRecommendation getAllocSizeRecommendation(PoolId pid) const;
+
+  // miss ratio curve of the regular pool estimated from the hits and
+  // allocations of its sampled keys. Empty unless miss ratio curves are
+  // enabled.
+  MissRatioCurve getPoolMissRatioCurve(PoolId pid) const override final;
+
+  // the stats of the cache as of the latest snapshot taken in the
+  // background. Reading it does not compute any stats.
+  //
+  // @return the snapshot, or nullptr if stats snapshots are not enabled or
+  //         the first one was not taken yet
+  std::shared_ptr<const CacheStatsSnapshot> getStatsSnapshot() const;
+
   // return the cache's metadata
   CacheMetadata getCacheMetadata() const noexcept override final;
 
@@ -1244,9 +1477,27 @@ class CacheAllocator : public CacheBase {
   // Whether this cache allocator was created on shared memory.
   bool isOnShm() const noexcept { return isOnShm_; }
 
+  // Page size in bytes that the kernel backs each memory segment of the cache
+  // with, keyed by the segment name. This tells whether the huge pages asked
+  // for through setMemoryPageSize() were obtained. Only the slab memory is
+  // reported when the cache is not on shared memory. This reads
+  // /proc/self/smaps and is not meant for the fast path.
+  std::map<std::string, size_t> getMemoryPageSizes() const;
+
+  // Number of slabs of every pool backed by each NUMA node, as reported by the
+  // kernel for the first page of the slab. Slabs whose memory is not resident
+  // yet are counted under node -1. This walks all the slabs and is meant for
+  // periodic stats collection.
+  //
+  // @throw std::system_error if the NUMA nodes can not be queried
+  std::unordered_map<PoolId, std::map<int, uint64_t>> getNumSlabsPerNumaNode()
+      const {
+    return allocator_->getNumSlabsPerNumaNode();
+  }
+
   // Whether NvmCache is currently enabled
   bool isNvmCacheEnabled() const noexcept {
-    return nvmCache_ && nvmCache_->isEnabled();
+    return hasNvmCache() && nvmCache_->isEnabled();
   }
 
   // unix timestamp when the cache was created. If 0, the cache creation
@@ -1334,12 +1585,17 @@ class CacheAllocator : public CacheBase {
   // inheriting from the Hooks and their bool interface.
   static_assert((sizeof(typename MMType::template Hook<Item>) +
                  sizeof(typename AccessType::template Hook<Item>) +
-                 sizeof(typename RefcountWithFlags::Value) + sizeof(uint32_t) +
-                 sizeof(uint32_t) + sizeof(KAllocation)) == sizeof(Item),
+                 sizeof(typename RefcountWithFlags::Value) +
+                 sizeof(typename Item::Timestamps) + sizeof(KAllocation)) ==
+                    sizeof(Item),
                 "vtable overhead");
-  static_assert((20 + (3 * sizeof(CompressedPtrType))) == sizeof(Item),
+  static_assert((12 + sizeof(typename Item::Timestamps) +
+                 (2 * sizeof(CompressedPtrType)) +
+                 sizeof(typename AccessType::template Hook<Item>)) ==
+                    sizeof(Item),
                 "item overhead is 32 bytes for 4 byte compressed pointer and "
-                "35 bytes for 5 bytes compressed pointer.");
+                "35 bytes for 5 bytes compressed pointer with a chained hash "
+                "table, and 4 bytes less without an expiry time.");
 
   // make sure there is no overhead in ChainedItem on top of a regular Item
   static_assert(sizeof(Item) == sizeof(ChainedItem),
@@ -1414,6 +1670,17 @@ class CacheAllocator : public CacheBase {
                                     bool nascent = false,
                                     const Item* toRecycle = nullptr);
 
+  // run the remove callback and the item destructor of an item leaving the
+  // cache. For an evicted item this may run on the deferred releaser, with a
+  // copy of the item.
+  //
+  // @param runDestructor  false for an item that is still in nvmcache
+  // @param pid            the pool the item belonged to
+  void runItemCallbacks(Item& it,
+                        RemoveContext ctx,
+                        bool runDestructor,
+                        PoolId pid);
+
   // acquires an handle on the item. returns an empty handle if it is null.
   // @param it    pointer to an item
   // @return WriteHandle   return a handle to this item
@@ -1432,9 +1699,10 @@ class CacheAllocator : public CacheBase {
   }
 
   using MMContainerPtr = std::unique_ptr<MMContainer>;
-  using MMContainers =
-      std::array<std::array<MMContainerPtr, MemoryAllocator::kMaxClasses>,
-                 MemoryPoolManager::kMaxPools>;
+  // every (pool, class) owns config_.numMMContainerShards MMContainers
+  using MMContainers = std::array<
+      std::array<std::vector<MMContainerPtr>, MemoryAllocator::kMaxClasses>,
+      MemoryPoolManager::kMaxPools>;
 
   void createMMContainers(const PoolId pid, MMConfig config);
 
@@ -1445,7 +1713,23 @@ class CacheAllocator : public CacheBase {
   // allocation from the memory allocator.
   MMContainer& getMMContainer(const Item& item) const noexcept;
 
-  MMContainer& getMMContainer(PoolId pid, ClassId cid) const noexcept;
+  // acquire the given shard of the MMContainers for the class and pool.
+  MMContainer& getMMContainer(PoolId pid,
+                              ClassId cid,
+                              size_t shard = 0) const noexcept;
+
+  // the shard of the MMContainers for the Item's class and pool that the
+  // Item belongs to. This is derived from the location of the Item's memory,
+  // so it stays fixed for as long as the item is allocated.
+  size_t getMMContainerShard(const Item& item) const noexcept;
+
+  // number of MMContainer shards in each (pool, class)
+  size_t getNumMMContainerShards() const noexcept {
+    return config_.numMMContainerShards;
+  }
+
+  // stats of all the MMContainer shards of the class and pool combined
+  MMContainerStat getMMContainerStat(PoolId pid, ClassId cid) const noexcept;
 
   // create a new cache allocation. The allocation can be initialized
   // appropriately and made accessible through insert or insertOrReplace.
@@ -1535,6 +1819,18 @@ class CacheAllocator : public CacheBase {
   //        creating this item handle.
   WriteHandle findInternalWithExpiration(Key key, AllocatorApiEvent event);
 
+  // internal helper that checks expiration and bumps the lookup stats on a
+  // handle that has already been looked up from the access container.
+  //
+  // @param key     key that was looked up
+  // @param handle  result of the access container lookup
+  // @param event   cachelib lookup operation
+  //
+  // @return handle if item is found and not expired, nullptr otherwise
+  WriteHandle processLookupResult(Key key,
+                                  WriteHandle handle,
+                                  AllocatorApiEvent event);
+
   // look up an item by its key across the nvm cache as well if enabled.
   //
   // @param key         the key for lookup
@@ -1557,9 +1853,10 @@ class CacheAllocator : public CacheBase {
   FOLLY_ALWAYS_INLINE WriteHandle findFastImpl(Key key, AccessMode mode);
 
   // Moves a regular item to a different slab. This should only be used during
-  // slab release after the item's exclusive bit has been set. The user supplied
-  // callback is responsible for copying the contents and fixing the semantics
-  // of chained item.
+  // slab release or when moving items between memory tiers, after the item's
+  // exclusive bit has been set. The user supplied callback is responsible for
+  // copying the contents and fixing the semantics of chained item. Without a
+  // callback, the contents are copied.
   //
   // @param oldItem     Reference to the item being moved
   // @param newItemHdl  Reference to the handle of the new item being moved into
@@ -1579,6 +1876,25 @@ class CacheAllocator : public CacheBase {
   template <typename Handle>
   folly::IOBuf convertToIOBufT(Handle& handle);
 
+  // template class for viewAsLargeItem that takes either ReadHandle or
+  // WriteHandle
+  template <typename Handle>
+  CacheLargeItem<CacheT, Handle> viewAsLargeItemT(const Handle& parent);
+
+  // point the index of a large item to the chained item that replaced one of
+  // its chunks. Must hold the chained item lock.
+  void replaceLargeItemChunkLocked(Item& parent,
+                                   const Item& oldChunk,
+                                   const Item& newChunk);
+
+  // index the chunks of a large item whose chain was rebuilt, e.g. when it
+  // is filled from nvmcache, and mark the parent as a large item. Only call
+  // this for items that were large items when they were written.
+  //
+  // @return false if the parent is not laid out as a large item or the chain
+  //         does not match the index
+  bool rebuildLargeItemIndex(Item& parent);
+
   // Moves a chained item to a different slab. This should only be used during
   // slab release after the item's exclusive bit has been set. The user supplied
   // callback is responsible for copying the contents and fixing the semantics
@@ -1622,7 +1938,7 @@ class CacheAllocator : public CacheBase {
   // @return handle to the oldItem
   WriteHandle replaceChainedItemLocked(Item& oldItem,
                                        WriteHandle newItemHdl,
-                                       const Item& parent);
+                                       Item& parent);
 
   //
   // Performs the actual inplace replace - it is called from
@@ -1639,7 +1955,7 @@ class CacheAllocator : public CacheBase {
   // @return handle to the oldItem
   void replaceInChainLocked(Item& oldItem,
                             WriteHandle& newItemHdl,
-                            const Item& parent,
+                            Item& parent,
                             bool fromMove);
 
   // Insert an item into MM container. The caller must hold a valid handle for
@@ -1713,11 +2029,14 @@ class CacheAllocator : public CacheBase {
   //                         not enable, or removeFromNvm is false
   // @param removeFromNvm    if true clear key from nvm
   // @param recordApiEvent   should we record API event for this operation.
+  // @param nvmBatch         if set, the nvm remove is added to the batch
+  //                         instead of being submitted.
   RemoveRes removeImpl(HashedKey hk,
                        Item& it,
                        DeleteTombStoneGuard tombstone,
                        bool removeFromNvm = true,
-                       bool recordApiEvent = true);
+                       bool recordApiEvent = true,
+                       typename NvmCacheT::RemoveBatchKeys* nvmBatch = nullptr);
 
   // Must be called by the thread which called markForEviction and
   // succeeded. After this call, the item is unlinked from Access and
@@ -1734,6 +2053,100 @@ class CacheAllocator : public CacheBase {
   // within the configured number of attempts.
   Item* findEviction(PoolId pid, ClassId cid);
 
+  // Get the memory for a new allocation in a full allocation class. When
+  // eviction batching is enabled, this hands out an allocation evicted by an
+  // earlier pass if there is one. Otherwise it evicts a whole batch, returns
+  // the first allocation and stashes the rest for the following calls.
+  //
+  // @param  pid  the id of the pool to look for evictions inside
+  // @param  cid  the id of the class to look for evictions inside
+  // @return memory for the new allocation or nullptr if nothing could be
+  // evicted.
+  void* allocateFromEviction(PoolId pid, ClassId cid);
+
+  // Free the allocations stashed by eviction batching for the given
+  // pool and allocation class back to the allocator. Stashed allocations do
+  // not hold an item, so this must be done before anything that expects every
+  // allocation to be either free or an item owned by the cache.
+  void flushEvictedAllocs(PoolId pid, ClassId cid);
+
+  // Free the allocations stashed by eviction batching for all pools and
+  // allocation classes.
+  void flushAllEvictedAllocs();
+
+  // find() of a cache with hot key replication. Lookups of hot keys are
+  // served from a replica on the current cpu, and make one if there is none.
+  ReadHandle findWithHotKeyReplicas(Key key);
+
+  // @return a handle to the replica of a hot key on the current cpu, or an
+  //         empty handle if there is no fresh one
+  ReadHandle findHotKeyReplica(Key key, uint64_t hash);
+
+  // copy an item into a replica on the current cpu if it can be replicated
+  //
+  // @param generation  generation of the key hash read before the item was
+  //                    looked up
+  void replicateHotKey(const Item& item, uint64_t hash, uint64_t generation);
+
+  // make the replicas of a key stale after it changed in the cache
+  void invalidateHotKeyReplicas(Key key) noexcept {
+    if (UNLIKELY(hotKeyReplicas_ != nullptr)) {
+      hotKeyReplicas_->invalidate(HashedKey{key}.keyHash());
+    }
+  }
+
+  // Drop all the hot key replicas. Replicas are allocations that are neither
+  // free nor in the cache, so like the stashed allocations this must be done
+  // before saving the cache. Releasing a slab drops only the replicas of its
+  // class, see releaseHeldAllocs().
+  void dropHotKeyReplicas();
+
+  // hand an item whose last handle was dropped to the deferred releaser
+  //
+  // @return false if the item must be released by the caller
+  bool deferRelease(Item& it, bool nascent);
+
+  // find() of a cache with striped refcounts. Lookups of hot keys take a
+  // reference on the stripe of the current cpu, and give the item a striped
+  // refcount if it has none.
+  ReadHandle findWithStripedRefcount(Key key);
+
+  // @return a handle whose reference is counted on a stripe, or an empty
+  //         handle if the key has no striped refcount
+  ReadHandle findStriped(Key key, uint64_t hash);
+
+  // give an item a striped refcount, pinning it with a reference of its own
+  void stripeRefcount(Item& item, uint64_t hash);
+
+  // release the reference of a handle that is counted on a stripe
+  //
+  // @param keepItemRef  turn it into a reference on the item instead, for
+  //                     the caller that takes over the item from the handle
+  void releaseStripedRef(Item* it, detail::StripedRef ref, bool keepItemRef);
+
+  // drop the pin of an item whose striped refcount was folded back
+  void unpinStripedItem(Item* item);
+
+  // fold the striped refcount of a key back into its item once the item
+  // left the cache
+  void foldStripedRefcount(Key key) {
+    if (UNLIKELY(stripedRefcounts_ != nullptr)) {
+      unpinStripedItem(stripedRefcounts_->fold(HashedKey{key}.keyHash()));
+    }
+  }
+
+  // Fold all the striped refcounts back. Pinned items can not be moved or
+  // evicted, and the pins would leak across a restart, so this must be done
+  // before saving the cache. Releasing a slab folds only the refcounts of
+  // its class, see releaseHeldAllocs().
+  void foldAllStripedRefcounts();
+
+  // Drop the hot key replicas, fold the striped refcounts and release the
+  // deferred items that hold an allocation of the class, or that have
+  // chained items, which may be allocated from it. This is what a slab
+  // release of the class needs, without the work for the rest of the cache.
+  void releaseHeldAllocs(PoolId pid, ClassId cid);
+
   // Get next eviction candidate from MMContainer, remove from AccessContainer,
   // MMContainer and insert into NVMCache if enabled.
   //
@@ -1746,8 +2159,78 @@ class CacheAllocator : public CacheBase {
   // within the configured number of attempts
   std::pair<Item*, Item*> getNextCandidate(PoolId pid,
                                            ClassId cid,
+                                           size_t shard,
                                            unsigned int& searchTries);
 
+  // Same as getNextCandidate() for up to @maxCandidates candidates, all
+  // picked under a single acquisition of the MMContainer lock.
+  //
+  // @param searchLimit   the search stops once searchTries reaches it. 0
+  //                      means no limit.
+  // @param candidates    the pairs of [candidate, toRecycle] found are
+  //                      appended to it
+  void getNextCandidates(PoolId pid,
+                         ClassId cid,
+                         size_t shard,
+                         size_t maxCandidates,
+                         unsigned int searchLimit,
+                         unsigned int& searchTries,
+                         std::vector<std::pair<Item*, Item*>>& candidates);
+
+  // Moves the eviction iterator @itr, @pos items away from the start of the
+  // eviction queue, to the item with the lowest cost per byte among the next
+  // @numCandidates ones. The cost level of the items it passes over decays
+  // by one. @pos is updated to the new position.
+  template <typename EvictionIterator>
+  void seekLowestCostCandidate(EvictionIterator& itr,
+                               size_t& pos,
+                               size_t numCandidates);
+
+  // Same as getNextCandidate() for a pool with a lower memory tier. The item
+  // at the tail of the eviction queue is moved to the paired pool of the
+  // lower tier when it can be, and evicted otherwise.
+  //
+  // @return pair of [candidate, toRecycle]. The candidate is null when it was
+  // demoted, in which case toRecycle is its memory, free to reuse.
+  std::pair<Item*, Item*> getNextCandidateForDemotion(
+      PoolId pid, ClassId cid, size_t shard, unsigned int& searchTries);
+
+  // Moves a regular item marked as moving to a new item allocated from the
+  // given pool of the other memory tier, and wakes up the waiters with it.
+  //
+  // @return true if the item was moved. The old item is then unlinked and its
+  //         memory belongs to the caller. Otherwise the old item is left
+  //         marked as moving.
+  bool moveItemToTier(Item& oldItem, PoolId pid, bool fromBgThread);
+
+  // Promotes the item of the lower memory tier with the given key to the
+  // paired pool of the top tier.
+  //
+  // @return true if the item was promoted
+  bool promoteItem(folly::StringPiece key);
+
+  // Counts a lookup of an item of the lower memory tier, and queues the item
+  // for promotion once it has been hit often enough.
+  void recordLowerTierAccess(const Item& item, PoolId pid, ClassId cid);
+
+  // pool of the lower memory tier paired with the pool, kInvalidPoolId if the
+  // pool has none
+  PoolId getLowerTierPool(PoolId pid) const noexcept {
+    return memoryTiers_ ? memoryTiers_->lowerTierPools[pid]
+                        : Slab::kInvalidPoolId;
+  }
+
+  // pool of the top memory tier paired with the pool, kInvalidPoolId if the
+  // pool is not on the lower tier
+  PoolId getUpperTierPool(PoolId pid) const noexcept {
+    return memoryTiers_ ? memoryTiers_->upperTierPools[pid]
+                        : Slab::kInvalidPoolId;
+  }
+
+  // Creates the state of the memory tiers when two tiers are configured and
+  // pairs up the pools of the two tiers that already exist.
+  void initMemoryTiers();
+
   using EvictionIterator = typename MMContainer::LockedIterator;
 
   // Wakes up waiters if there are any
@@ -1778,6 +2261,18 @@ class CacheAllocator : public CacheBase {
     return allocator_->reclaimSlabsAndGrow(id, numSlabs);
   }
 
+  size_t adviseReleasedSlabs() final {
+    return allocator_->adviseReleasedSlabs();
+  }
+
+  void updateAllocSizeRecommendations() final;
+
+  void resizeAccessContainers() final {
+    accessContainer_->resizeStep(config_.accessContainerResizeBucketsPerRun);
+    chainedItemAccessContainer_->resizeStep(
+        config_.accessContainerResizeBucketsPerRun);
+  }
+
   FOLLY_ALWAYS_INLINE EventTracker* getEventTracker() const {
     return config_.eventTracker.get();
   }
@@ -1849,6 +2344,16 @@ class CacheAllocator : public CacheBase {
   //            false if we have exhausted moving attempts
   bool moveForSlabRelease(Item& item);
 
+  // Same as above, with the destination already allocated in @newItemHdl.
+  // Fails if @newItemHdl is empty.
+  bool moveForSlabRelease(Item& item, WriteHandle newItemHdl);
+
+  // Moves the regular items of @batch, marked moving for the release of a
+  // slab, and evicts the ones that could not be moved. The destinations are
+  // allocated first, then the items are moved grouped by the lock of their
+  // key.
+  void moveBatchForSlabRelease(std::vector<Item*>& batch);
+
   // Evict an item from access and mm containers and
   // ensure it is safe for freeing.
   //
@@ -1881,22 +2386,45 @@ class CacheAllocator : public CacheBase {
     stats().numReaperSkippedSlabs.add(slabsSkipped);
   }
 
-  // exposed for the background evictor to iterate through the memory and evict
-  // in batch. This should improve insertion path for tiered memory config
-  size_t traverseAndEvictItems(unsigned int /* pid */,
-                               unsigned int /* cid */,
-                               size_t /* batch */) {
-    throw std::runtime_error("Not supported yet!");
+  // Same as above, but only walks the slabs @shouldVisit returns true for and
+  // calls @onSlabDone once a slab is walked. See
+  // MemoryAllocator::forEachAllocation.
+  template <typename FilterFn, typename Fn, typename DoneFn>
+  void traverseAndExpireItems(FilterFn&& shouldVisit,
+                              Fn&& f,
+                              DoneFn&& onSlabDone) {
+    folly::annotate_ignore_thread_sanitizer_guard g(__FILE__, __LINE__);
+    auto slabsSkipped = allocator_->forEachAllocation(
+        std::forward<FilterFn>(shouldVisit), std::forward<Fn>(f),
+        std::forward<DoneFn>(onSlabDone));
+    stats().numReaperSkippedSlabs.add(slabsSkipped);
   }
 
-  // exposed for the background promoter to iterate through the memory and
-  // promote in batch. This should improve find latency
-  size_t traverseAndPromoteItems(unsigned int /* pid */,
-                                 unsigned int /* cid */,
-                                 size_t /* batch */) {
-    throw std::runtime_error("Not supported yet!");
+  // expiry index of the slabs for the reaper, nullptr if not enabled
+  SlabExpiryIndex* getSlabExpiryIndex() const noexcept {
+    return expiryIndex_.get();
   }
 
+  // exposed for the background evictor to iterate through the memory and evict
+  // in batch. This should improve insertion path for tiered memory config.
+  // The candidates are picked a batch at a time under a single acquisition of
+  // the MMContainer lock. Items of a pool with a lower memory tier are demoted
+  // rather than evicted, one at a time.
+  //
+  // @return the number of items evicted or demoted
+  size_t traverseAndEvictItems(unsigned int pid,
+                               unsigned int cid,
+                               size_t batch);
+
+  // exposed for the background promoter to promote in batch the items of the
+  // lower memory tier that were queued by lookups. This should improve find
+  // latency
+  //
+  // @return the number of items promoted
+  size_t traverseAndPromoteItems(unsigned int pid,
+                                 unsigned int cid,
+                                 size_t batch);
+
   // returns true if nvmcache is enabled and we should write this item to
   // nvmcache.
   bool shouldWriteToNvmCache(const Item& item);
@@ -1912,7 +2440,7 @@ class CacheAllocator : public CacheBase {
 
   static typename MemoryAllocator::Config getAllocatorConfig(
       const Config& config) {
-    return MemoryAllocator::Config{
+    MemoryAllocator::Config allocConfig{
         config.defaultAllocSizes.empty()
             ? util::generateAllocSizes(
                   config.allocationClassSizeFactor,
@@ -1921,7 +2449,13 @@ class CacheAllocator : public CacheBase {
                   config.reduceFragmentationInAllocationClass)
             : config.defaultAllocSizes,
         config.enableZeroedSlabAllocs, config.disableFullCoredump,
-        config.lockMemory};
+        config.lockMemory, config.allocMagazineSize};
+    allocConfig.hugePageSize =
+        config.getMemoryPageSize() == PageSizeT::NORMAL
+            ? 0
+            : detail::getPageSize(config.getMemoryPageSize());
+    allocConfig.hugePageFallback = config.memoryPageSizeFallback;
+    return allocConfig;
   }
 
   // starts one of the cache workers passing the current instance and the args
@@ -1931,13 +2465,20 @@ class CacheAllocator : public CacheBase {
                       std::chrono::milliseconds interval,
                       Args&&... args);
 
-  // stops one of the workers belonging to this instance.
+  // stops one of the workers belonging to this instance. The worker is
+  // stopped outside of workersMutex_ so that workers can be stopped
+  // concurrently.
   template <typename T>
   bool stopWorker(folly::StringPiece name,
                   std::unique_ptr<T>& worker,
                   std::chrono::seconds timeout = std::chrono::seconds{0});
 
-  ShmSegmentOpts createShmCacheOpts();
+  ShmSegmentOpts createShmCacheOpts(PageSizeT pageSize = PageSizeT::NORMAL);
+
+  // apply the NUMA policy configured for the pool's name, if any. Otherwise
+  // the pool is bound to the NUMA nodes of its memory tier when there are
+  // several tiers.
+  void applyPoolNumaPolicy(PoolId pid);
   std::unique_ptr<MemoryAllocator> createNewMemoryAllocator();
   std::unique_ptr<MemoryAllocator> restoreMemoryAllocator();
   std::unique_ptr<CCacheManager> restoreCCacheManager();
@@ -2003,6 +2544,10 @@ class CacheAllocator : public CacheBase {
   void initNvmCache(bool dramCacheAttached);
   void initWorkers();
 
+  // Populates the attached shm segments. See
+  // CacheAllocatorConfig::setShmPrefaultThreads
+  void prefaultShm();
+
   // @param type        the type of initialization
   // @return nullptr if the type is invalid
   // @return pointer to memory allocator
@@ -2063,8 +2608,9 @@ class CacheAllocator : public CacheBase {
   // returns true if update successfully
   //         false if no AdmissionPolicy is set or it is not DynamicRandom
   bool updateMaxRateForDynamicRandomAP(uint64_t maxRate) {
-    return nvmCache_ ? nvmCache_->updateMaxRateForDynamicRandomAP(maxRate)
-                     : false;
+    return hasNvmCache()
+               ? nvmCache_->updateMaxRateForDynamicRandomAP(maxRate)
+               : false;
   }
 
   // returns the background mover stats
@@ -2238,6 +2784,85 @@ class CacheAllocator : public CacheBase {
   // we need mmcontainer per allocator pool/allocation class.
   MMContainers mmContainers_;
 
+  // allocations evicted ahead of time by eviction batching, waiting to be
+  // handed out to new items of the same pool and allocation class.
+  struct EvictedAllocs {
+    std::mutex mutex;
+    std::vector<void*> allocs;
+  };
+  using EvictedAllocsArray =
+      std::array<std::array<EvictedAllocs, MemoryAllocator::kMaxClasses>,
+                 MemoryPoolManager::kMaxPools>;
+
+  // only created when config_.evictionBatchSize is larger than 1
+  std::unique_ptr<EvictedAllocsArray> evictedAllocs_;
+
+  // per cpu copies of the hot keys, only created when hot key replication is
+  // enabled
+  std::unique_ptr<HotKeyReplicas<CacheT>> hotKeyReplicas_;
+
+  // releases the removed items in the background. Created with the cache
+  // when deferred release is enabled and never reset after, since releases
+  // may race with stopping it.
+  std::unique_ptr<DeferredReleaser<CacheT>> deferredReleaser_;
+
+  // per cpu refcounts of the hot items, only created when striped refcounts
+  // are enabled
+  std::unique_ptr<StripedRefcounts<Item>> stripedRefcounts_;
+
+  // keeps the clock of the items running while the cache is alive, only
+  // created when the coarse clock is enabled
+  std::unique_ptr<util::CoarseClock> coarseClock_;
+
+  // State of the memory tiers. Every pool added by the user is paired with a
+  // pool of the lower tier in the same allocator. Its memory is bound to the
+  // NUMA nodes of that tier, and it holds the items demoted from the pool.
+  struct MemoryTierState {
+    // name suffix of the pools on the lower tier
+    static constexpr folly::StringPiece kLowerTierPoolSuffix{"#tier1"};
+
+    static constexpr size_t kNumAccessShards = 16;
+    static constexpr uint32_t kAccessSketchWidth = 8192;
+    static constexpr uint32_t kAccessSketchDepth = 4;
+
+    // promotions queued per allocation class at most
+    static constexpr size_t kMaxQueuedPromotions = 1024;
+
+    MemoryTierState() {
+      lowerTierPools.fill(Slab::kInvalidPoolId);
+      upperTierPools.fill(Slab::kInvalidPoolId);
+    }
+
+    // pool of the other tier each pool is paired with
+    std::array<PoolId, MemoryPoolManager::kMaxPools> lowerTierPools;
+    std::array<PoolId, MemoryPoolManager::kMaxPools> upperTierPools;
+
+    // lookups of the items of the lower tier, counted by key. Counts are
+    // halved whenever a shard has counted as many lookups as its width, so
+    // that only the recently hot items get promoted.
+    struct AccessShard {
+      std::mutex mutex;
+      util::CountMinSketch16 sketch{kAccessSketchWidth, kAccessSketchDepth};
+      uint32_t numAccesses{0};
+    };
+    std::array<AccessShard, kNumAccessShards> accessShards;
+
+    // keys of the items waiting for the background promoter
+    struct PromotionQueue {
+      std::mutex mutex;
+      std::vector<std::string> keys;
+    };
+    std::array<std::array<PromotionQueue, MemoryAllocator::kMaxClasses>,
+               MemoryPoolManager::kMaxPools>
+        promotionQueues;
+
+    mutable util::PercentileStats demoteLatency;
+    mutable util::PercentileStats promoteLatency;
+  };
+
+  // only created when two memory tiers are configured
+  std::unique_ptr<MemoryTierState> memoryTiers_;
+
   // container that is used for accessing the allocations by their key.
   std::unique_ptr<AccessContainer> accessContainer_;
 
@@ -2246,6 +2871,8 @@ class CacheAllocator : public CacheBase {
 
   friend ChainedAllocs;
   friend WritableChainedAllocs;
+  friend LargeItem;
+  friend WritableLargeItem;
   // ensure any modification to a chain of chained items are synchronized
   using ChainedItemLock = facebook::cachelib::SharedMutexBuckets;
   ChainedItemLock chainedItemLocks_;
@@ -2253,6 +2880,12 @@ class CacheAllocator : public CacheBase {
   // nvmCache
   std::unique_ptr<NvmCacheT> nvmCache_;
 
+  // @return true if nvmcache is set up. A constant false when the trait
+  //         turns nvmcache off, so that its paths compile away.
+  bool hasNvmCache() const noexcept {
+    return kHasNvmCache && nvmCache_ != nullptr;
+  }
+
   // rebalancer for the pools
   std::unique_ptr<PoolRebalancer> poolRebalancer_;
 
@@ -2262,6 +2895,37 @@ class CacheAllocator : public CacheBase {
   // automatic arena resizing i.e. pool optimization
   std::unique_ptr<PoolOptimizer> poolOptimizer_;
 
+  // recomputes the recommended allocation sizes
+  std::unique_ptr<AllocSizeOptimizer> allocSizeOptimizer_;
+
+  // grows the access containers
+  std::unique_ptr<AccessContainerResizer> accessContainerResizer_;
+
+  // takes the stats snapshots
+  std::unique_ptr<StatsSnapshotter> statsSnapshotter_;
+
+  // samplers of the allocation sizes of each pool. Created with the cache
+  // when alloc size tuning is enabled and never reset after.
+  std::array<std::unique_ptr<AllocSizeTuner>, MemoryPoolManager::kMaxPools>
+      allocSizeTuners_{};
+
+  // samplers of the eviction ages of each pool. Created with the cache when
+  // sampled eviction ages are enabled and never reset after.
+  std::array<std::unique_ptr<EvictionAgeSampler>, MemoryPoolManager::kMaxPools>
+      evictionAgeSamplers_{};
+
+  // estimators of the miss ratio curve of each pool. Created with the cache
+  // when miss ratio curves are enabled and never reset after.
+  std::array<std::unique_ptr<MissRatioCurveEstimator>,
+             MemoryPoolManager::kMaxPools>
+      missRatioCurves_{};
+
+  // latest recommendation for each pool, guarded by
+  // allocSizeRecommendationsLock_
+  std::array<AllocSizeRecommendation, MemoryPoolManager::kMaxPools>
+      allocSizeRecommendations_{};
+  mutable std::mutex allocSizeRecommendationsLock_;
+
   // free memory monitor
   std::unique_ptr<MemoryMonitor> memMonitor_;
 
@@ -2312,6 +2976,10 @@ class CacheAllocator : public CacheBase {
   // allocator's items reaper to evict expired items in bg checking
   std::unique_ptr<Reaper<CacheT>> reaper_;
 
+  // earliest expiry time of the items of every slab, for the reaper. See
+  // CacheAllocatorConfig::enableReaperExpiryIndex
+  std::unique_ptr<SlabExpiryIndex> expiryIndex_;
+
   class DummyTlsActiveItemRingTag {};
   folly::ThreadLocal<TlsActiveItemRing, DummyTlsActiveItemRingTag> ring_;
 
@@ -2324,11 +2992,15 @@ class CacheAllocator : public CacheBase {
   // indicates if the shutdown of cache is in progress or not
   std::atomic<bool> shutDownInProgress_{false};
 
+  // timings of the last shutDown()
+  ShutDownTimings shutDownTimings_{};
+
   // END private members
 
   // Make this friend to give access to acquire and release
   friend ReadHandle;
   friend ReaperAPIWrapper<CacheT>;
+  friend DeferredReleaserAPIWrapper<CacheT>;
   friend BackgroundMoverAPIWrapper<CacheT>;
   friend class CacheAPIWrapperForNvm<CacheT>;
   friend class FbInternalRuntimeUpdateWrapper<CacheT>;
@@ -2393,6 +3065,10 @@ CacheAllocator<CacheTrait>::CacheAllocator(SharedMemAttachT, Config config)
     isCompactCachePool_[pid] = true;
   }
 
+  if (config_.shmPrefaultThreads > 0) {
+    prefaultShm();
+  }
+
   initCommon(true);
 
   // We will create a new info shm segment on shutDown(). If we don't remove
@@ -2448,7 +3124,16 @@ CacheAllocator<CacheTrait>::CacheAllocator(
       // nvmCacheState's current time in sync
       nvmCacheState_{cacheInstanceCreationTime_, config_.cacheDir,
                      config_.isNvmCacheEncryptionEnabled(),
-                     config_.isNvmCacheTruncateAllocSizeEnabled()} {}
+                     config_.isNvmCacheTruncateAllocSizeEnabled()} {
+  if (!kHasNvmCache && config_.nvmConfig.has_value()) {
+    throw std::invalid_argument("NvmCache is turned off by the cache trait");
+  }
+  if (!kHasItemCallbacks && (config_.removeCb || config_.itemDestructor)) {
+    throw std::invalid_argument(
+        "Remove callbacks and item destructors are turned off by the cache "
+        "trait");
+  }
+}
 
 template <typename CacheTrait>
 CacheAllocator<CacheTrait>::~CacheAllocator() {
@@ -2457,31 +3142,55 @@ CacheAllocator<CacheTrait>::~CacheAllocator() {
   // terminate all background workers and nvmCache before member variables
   // go out of scope.
   stopWorkers();
+  dropHotKeyReplicas();
+  foldAllStripedRefcounts();
   nvmCache_.reset();
 }
 
 template <typename CacheTrait>
-ShmSegmentOpts CacheAllocator<CacheTrait>::createShmCacheOpts() {
-  ShmSegmentOpts opts;
-  opts.alignment = sizeof(Slab);
-  // TODO: we support single tier so far
-  if (config_.memoryTierConfigs.size() > 1) {
-    throw std::invalid_argument("CacheLib only supports a single memory tier");
+ShmSegmentOpts CacheAllocator<CacheTrait>::createShmCacheOpts(
+    PageSizeT pageSize) {
+  ShmSegmentOpts opts{pageSize};
+  opts.alignment = std::max(sizeof(Slab), detail::getPageSize(pageSize));
+  // with several tiers, the memory of each tier is bound through the NUMA
+  // policy of its pools instead. See applyPoolNumaPolicy()
+  if (config_.memoryTierConfigs.size() == 1) {
+    opts.memBindNumaNodes = config_.memoryTierConfigs[0].getMemBind();
   }
-  opts.memBindNumaNodes = config_.memoryTierConfigs[0].getMemBind();
+  // only apply to the creation of the segment
+  opts.populateThreads = config_.shmPopulateThreads;
+  opts.preallocate = config_.shmPreallocate;
   return opts;
 }
 
 template <typename CacheTrait>
 std::unique_ptr<MemoryAllocator>
 CacheAllocator<CacheTrait>::createNewMemoryAllocator() {
+  auto opts = createShmCacheOpts(config_.getMemoryPageSize());
+  void* memory = nullptr;
+  try {
+    memory = shmManager_
+                 ->createShm(detail::kShmCacheName, config_.getCacheSize(),
+                             config_.slabMemoryBaseAddr, opts)
+                 .addr;
+  } catch (const std::exception& e) {
+    if (opts.pageSize == PageSizeT::NORMAL || !config_.memoryPageSizeFallback) {
+      throw;
+    }
+    XLOGF(WARN,
+          "Unable to create the cache memory with {} byte pages, falling back "
+          "to regular pages: {}",
+          detail::getPageSize(opts.pageSize), e.what());
+    opts = createShmCacheOpts(PageSizeT::NORMAL);
+    memory = shmManager_
+                 ->createShm(detail::kShmCacheName, config_.getCacheSize(),
+                             config_.slabMemoryBaseAddr, opts)
+                 .addr;
+  }
+  // posix segments have to be mapped with the same page size on attach
+  *metadata_.memoryPageSize() = static_cast<int64_t>(opts.pageSize);
   return std::make_unique<MemoryAllocator>(
-      getAllocatorConfig(config_),
-      shmManager_
-          ->createShm(detail::kShmCacheName, config_.getCacheSize(),
-                      config_.slabMemoryBaseAddr, createShmCacheOpts())
-          .addr,
-      config_.getCacheSize());
+      getAllocatorConfig(config_), memory, config_.getCacheSize());
 }
 
 template <typename CacheTrait>
@@ -2491,10 +3200,12 @@ CacheAllocator<CacheTrait>::restoreMemoryAllocator() {
       deserializer_->deserialize<MemoryAllocator::SerializationType>(),
       shmManager_
           ->attachShm(detail::kShmCacheName, config_.slabMemoryBaseAddr,
-                      createShmCacheOpts())
+                      createShmCacheOpts(static_cast<PageSizeT>(
+                          *metadata_.memoryPageSize())))
           .addr,
       config_.getCacheSize(),
-      config_.disableFullCoredump);
+      config_.disableFullCoredump,
+      config_.allocMagazineSize);
 }
 
 template <typename CacheTrait>
@@ -2510,6 +3221,9 @@ void CacheAllocator<CacheTrait>::initCommon(bool dramCacheAttached) {
   if (config_.nvmConfig.has_value()) {
     if (config_.nvmCacheAP) {
       nvmAdmissionPolicy_ = config_.nvmCacheAP;
+    } else if (config_.writeBudgetAPConfig) {
+      nvmAdmissionPolicy_ =
+          std::make_shared<WriteBudgetAP<CacheT>>(*config_.writeBudgetAPConfig);
     } else if (config_.rejectFirstAPNumEntries) {
       nvmAdmissionPolicy_ = std::make_shared<RejectFirstAP<CacheT>>(
           config_.rejectFirstAPNumEntries, config_.rejectFirstAPNumSplits,
@@ -2524,8 +3238,72 @@ void CacheAllocator<CacheTrait>::initCommon(bool dramCacheAttached) {
     }
   }
   initStats();
+  initMemoryTiers();
+  if (dramCacheAttached) {
+    for (auto pid : allocator_->getPoolIds()) {
+      applyPoolNumaPolicy(pid);
+    }
+  }
   initNvmCache(dramCacheAttached);
 
+  if (config_.evictionBatchSize > 1) {
+    evictedAllocs_ = std::make_unique<EvictedAllocsArray>();
+  }
+
+  if (config_.hotKeyReplicationConfig) {
+    hotKeyReplicas_ = std::make_unique<HotKeyReplicas<CacheT>>(
+        *config_.hotKeyReplicationConfig);
+  }
+
+  if (config_.deferredItemReleaseEnabled()) {
+    deferredReleaser_ = std::make_unique<DeferredReleaser<CacheT>>(
+        *this, config_.deferredReleaseMaxPending,
+        config_.deferredReleaseBatchSize);
+  }
+
+  if (config_.useCoarseClock) {
+    coarseClock_ = std::make_unique<util::CoarseClock>();
+  }
+
+  if (config_.stripedRefcountConfig) {
+    stripedRefcounts_ = std::make_unique<StripedRefcounts<Item>>(
+        *config_.stripedRefcountConfig);
+  }
+
+  if (config_.reaperExpiryIndex) {
+    expiryIndex_ = std::make_unique<SlabExpiryIndex>(allocator_->getNumSlabs());
+  }
+
+  if (config_.allocSizeTuningEnabled()) {
+    for (auto& tuner : allocSizeTuners_) {
+      tuner =
+          std::make_unique<AllocSizeTuner>(config_.allocSizeTuningSampleRate);
+    }
+  }
+
+  if (config_.sampledEvictionAgesEnabled()) {
+    for (auto& sampler : evictionAgeSamplers_) {
+      sampler = std::make_unique<EvictionAgeSampler>(
+          config_.evictionAgeSampleRate, config_.evictionAgeWindowSize);
+    }
+  }
+
+  if (config_.missRatioCurvesEnabled()) {
+    // the curves cover up to the whole cache, in whole slabs
+    const size_t numSlabs =
+        std::max<size_t>(config_.getCacheSize() / Slab::kSize, 1);
+    const size_t bucketSlabs =
+        (numSlabs + config_.missRatioCurveNumBuckets - 1) /
+        config_.missRatioCurveNumBuckets;
+    for (auto& curve : missRatioCurves_) {
+      curve = std::make_unique<MissRatioCurveEstimator>(
+          config_.missRatioCurveSamplingRate,
+          config_.missRatioCurveMaxSamples,
+          bucketSlabs * Slab::kSize,
+          (numSlabs + bucketSlabs - 1) / bucketSlabs);
+    }
+  }
+
   if (!config_.delayCacheWorkersStart) {
     initWorkers();
   }
@@ -2548,13 +3326,40 @@ void CacheAllocator<CacheTrait>::initNvmCache(bool dramCacheAttached) {
     nvmCacheState_.markTruncated();
   }
 
-  nvmCache_ = std::make_unique<NvmCacheT>(*this, *config_.nvmConfig, truncate,
-                                          config_.itemDestructor);
+  auto nvmConfig = *config_.nvmConfig;
+  if (config_.deferredAttachRestore) {
+    nvmConfig.asyncRecovery = true;
+  }
+  nvmCache_ = std::make_unique<NvmCacheT>(*this, std::move(nvmConfig),
+                                          truncate, config_.itemDestructor);
   if (!config_.cacheDir.empty()) {
     nvmCacheState_.clearPrevState();
   }
 }
 
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::prefaultShm() {
+  const auto startMs = util::getCurrentTimeMs();
+  // the hash tables are hit by every lookup, then the slab headers at the
+  // start of the cache memory by every allocation
+  const std::pair<const std::string&, PageSizeT> segments[] = {
+      {detail::kShmHashTableName, config_.accessConfig.getPageSize()},
+      {detail::kShmChainedItemHashTableName,
+       config_.chainedItemAccessConfig.getPageSize()},
+      {detail::kShmCacheName,
+       static_cast<PageSizeT>(*metadata_.memoryPageSize())}};
+  size_t totalSize = 0;
+  for (const auto& [name, pageSize] : segments) {
+    const auto& mapping = shmManager_->getShmByName(name).getCurrentMapping();
+    detail::prefaultPages(mapping.addr, mapping.size, pageSize,
+                          config_.shmPrefaultThreads);
+    totalSize += mapping.size;
+  }
+  XLOGF(INFO, "Prefaulted {} bytes of shared memory with {} threads in {} ms",
+        totalSize, config_.shmPrefaultThreads,
+        util::getCurrentTimeMs() - startMs);
+}
+
 template <typename CacheTrait>
 void CacheAllocator<CacheTrait>::initWorkers() {
   if (config_.poolResizingEnabled() && !poolResizer_) {
@@ -2566,7 +3371,8 @@ void CacheAllocator<CacheTrait>::initWorkers() {
   if (config_.poolRebalancingEnabled() && !poolRebalancer_) {
     startNewPoolRebalancer(config_.poolRebalanceInterval,
                            config_.defaultPoolRebalanceStrategy,
-                           config_.poolRebalancerFreeAllocThreshold);
+                           config_.poolRebalancerFreeAllocThreshold,
+                           config_.poolRebalancerThreads);
   }
 
   if (config_.memMonitoringEnabled() && !memMonitor_) {
@@ -2592,6 +3398,25 @@ void CacheAllocator<CacheTrait>::initWorkers() {
                           config_.ccacheOptimizeStepSizePercent);
   }
 
+  if (config_.allocSizeTuningEnabled() && !allocSizeOptimizer_) {
+    startNewAllocSizeOptimizer(config_.allocSizeTuningInterval);
+  }
+
+  if (config_.accessContainerResizingEnabled() && !accessContainerResizer_) {
+    startNewAccessContainerResizer(config_.accessContainerResizeInterval);
+  }
+
+  if (config_.statsSnapshotsEnabled() && !statsSnapshotter_) {
+    startNewStatsSnapshotter(config_.statsSnapshotInterval,
+                             config_.statsSnapshotPrefix);
+  }
+
+  if (deferredReleaser_ &&
+      deferredReleaser_->start(config_.deferredReleaseInterval,
+                               "DeferredReleaser")) {
+    deferredReleaser_->setAccepting(true);
+  }
+
   if (config_.backgroundEvictorEnabled()) {
     startNewBackgroundEvictor(config_.backgroundEvictorInterval,
                               config_.backgroundEvictorStrategy,
@@ -2602,6 +3427,39 @@ void CacheAllocator<CacheTrait>::initWorkers() {
     startNewBackgroundPromoter(config_.backgroundPromoterInterval,
                                config_.backgroundPromoterStrategy,
                                config_.backgroundPromoterThreads);
+  } else if (memoryTiers_ && backgroundPromoter_.empty()) {
+    // items of the lower memory tier are only promoted by the background
+    // promoter
+    startNewBackgroundPromoter(config_.memoryTierPromotionInterval,
+                               std::make_shared<PromotionStrategy>(
+                                   4 /* promotionAcWatermark */,
+                                   40 /* maxPromotionBatch */,
+                                   5 /* minPromotionBatch */),
+                               1);
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::initMemoryTiers() {
+  if (config_.memoryTierConfigs.size() < 2) {
+    return;
+  }
+
+  memoryTiers_ = std::make_unique<MemoryTierState>();
+  const auto suffix = MemoryTierState::kLowerTierPoolSuffix;
+  for (auto pid : allocator_->getPoolIds()) {
+    const auto poolName = allocator_->getPoolName(pid);
+    folly::StringPiece name{poolName};
+    if (!name.endsWith(suffix)) {
+      continue;
+    }
+    name.removeSuffix(suffix);
+    const auto upperPid = allocator_->getPoolId(name.str());
+    if (upperPid == Slab::kInvalidPoolId) {
+      continue;
+    }
+    memoryTiers_->lowerTierPools[upperPid] = pid;
+    memoryTiers_->upperTierPools[pid] = upperPid;
   }
 }
 
@@ -2644,7 +3502,7 @@ CacheAllocator<CacheTrait>::initAccessContainer(InitMemType type,
         shmManager_
             ->createShm(
                 name,
-                AccessContainer::getRequiredSize(config.getNumBuckets()),
+                AccessContainer::getRequiredSize(config.getMaxNumBuckets()),
                 nullptr,
                 ShmSegmentOpts(config.getPageSize()))
             .addr,
@@ -2680,6 +3538,10 @@ CacheAllocator<CacheTrait>::allocate(PoolId poolId,
                                      uint32_t size,
                                      uint32_t ttlSecs,
                                      uint32_t creationTime) {
+  if (!Item::kHasExpiryTime && ttlSecs != 0) {
+    throw std::invalid_argument(folly::sformat(
+        "TTL of {} seconds for an item without an expiry time", ttlSecs));
+  }
   if (creationTime == 0) {
     creationTime = util::getCurrentTimeSec();
   }
@@ -2712,6 +3574,9 @@ CacheAllocator<CacheTrait>::allocateInternal(PoolId pid,
   const auto cid = allocator_->getAllocationClassId(pid, requiredSize);
 
   (*stats_.allocAttempts)[pid][cid].inc();
+  if (allocSizeTuners_[pid] && !fromBgThread) {
+    allocSizeTuners_[pid]->recordAllocation(requiredSize);
+  }
 
   void* memory = allocator_->allocate(pid, requiredSize);
 
@@ -2723,7 +3588,7 @@ CacheAllocator<CacheTrait>::allocateInternal(PoolId pid,
   }
 
   if (memory == nullptr) {
-    memory = findEviction(pid, cid);
+    memory = allocateFromEviction(pid, cid);
   }
 
   WriteHandle handle;
@@ -2740,6 +3605,12 @@ CacheAllocator<CacheTrait>::allocateInternal(PoolId pid,
     handle = acquire(new (memory) Item(key, size, creationTime, expiryTime));
     if (handle) {
       handle.markNascent();
+      if (missRatioCurves_[pid] && !fromBgThread) {
+        missRatioCurves_[pid]->recordAccess(folly::Hash()(key), requiredSize);
+      }
+      if (expiryIndex_) {
+        expiryIndex_->recordExpiry(allocator_->getSlabIdx(memory), expiryTime);
+      }
       (*stats_.fragmentationSize)[pid][cid].add(
           util::getFragmentation(*this, *handle));
     }
@@ -2752,6 +3623,7 @@ CacheAllocator<CacheTrait>::allocateInternal(PoolId pid,
     }
   }
 
+  CACHELIB_TRACEPOINT(allocate, pid, cid, size, handle ? 1 : 0);
   if (auto eventTracker = getEventTracker()) {
     const auto result =
         handle ? AllocatorApiResult::ALLOCATED : AllocatorApiResult::FAILED;
@@ -2785,6 +3657,11 @@ template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::WriteHandle
 CacheAllocator<CacheTrait>::allocateChainedItemInternal(const Item& parent,
                                                         uint32_t size) {
+  if (!kHasChainedItems) {
+    throw std::invalid_argument("Chained items are turned off by the cache "
+                                "trait");
+  }
+
   util::LatencyTracker tracker{stats().allocateLatency_};
 
   SCOPE_FAIL { stats_.invalidAllocs.inc(); };
@@ -2796,10 +3673,13 @@ CacheAllocator<CacheTrait>::allocateChainedItemInternal(const Item& parent,
   const auto cid = allocator_->getAllocationClassId(pid, requiredSize);
 
   (*stats_.allocAttempts)[pid][cid].inc();
+  if (allocSizeTuners_[pid]) {
+    allocSizeTuners_[pid]->recordAllocation(requiredSize);
+  }
 
   void* memory = allocator_->allocate(pid, requiredSize);
   if (memory == nullptr) {
-    memory = findEviction(pid, cid);
+    memory = allocateFromEviction(pid, cid);
   }
   if (memory == nullptr) {
     (*stats_.allocFailures)[pid][cid].inc();
@@ -2862,6 +3742,7 @@ void CacheAllocator<CacheTrait>::addChainedItem(WriteHandle& parent,
   insertInMMContainer(*child);
 
   invalidateNvm(*parent);
+  invalidateHotKeyReplicas(parent->getKey());
   if (auto eventTracker = getEventTracker()) {
     eventTracker->record(AllocatorApiEvent::ADD_CHAINED, parent->getKey(),
                          AllocatorApiResult::INSERTED, child->getSize(),
@@ -2876,6 +3757,10 @@ CacheAllocator<CacheTrait>::popChainedItem(WriteHandle& parent) {
     throw std::invalid_argument(folly::sformat(
         "Invalid parent {}", parent ? parent->toString() : nullptr));
   }
+  if (isLargeItem(*parent)) {
+    throw std::invalid_argument(folly::sformat(
+        "Can not pop the chunks of a large item {}", parent->toString()));
+  }
 
   WriteHandle head;
   { // scope of chained item lock.
@@ -3007,6 +3892,7 @@ bool CacheAllocator<CacheTrait>::replaceIfAccessible(Item& oldItem,
     removeFromMMContainer(newItem);
     return false;
   }
+  invalidateHotKeyReplicas(newItem.getKey());
   return true;
 }
 
@@ -3040,7 +3926,7 @@ CacheAllocator<CacheTrait>::replaceChainedItem(Item& oldItem,
 template <typename CacheTrait>
 void CacheAllocator<CacheTrait>::replaceInChainLocked(Item& oldItem,
                                                       WriteHandle& newItemHdl,
-                                                      const Item& parent,
+                                                      Item& parent,
                                                       bool fromMove) {
   auto head = findChainedItem(parent);
   XDCHECK(head != nullptr);
@@ -3069,6 +3955,7 @@ void CacheAllocator<CacheTrait>::replaceInChainLocked(Item& oldItem,
   newItemHdl->asChainedItem().setNext(
       oldItem.asChainedItem().getNext(compressor_), compressor_);
   oldItem.asChainedItem().setNext(nullptr, compressor_);
+  replaceLargeItemChunkLocked(parent, oldItem, *newItemHdl);
 
   // if called from moveChainedItem then ref will be zero, else
   // greater than 0
@@ -3100,7 +3987,7 @@ template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::WriteHandle
 CacheAllocator<CacheTrait>::replaceChainedItemLocked(Item& oldItem,
                                                      WriteHandle newItemHdl,
-                                                     const Item& parent) {
+                                                     Item& parent) {
   XDCHECK(newItemHdl != nullptr);
   XDCHECK_GE(1u, oldItem.getRefCount());
 
@@ -3150,6 +4037,9 @@ CacheAllocator<CacheTrait>::releaseBackToAllocator(Item& it,
     stats_.ramEvictionAgeSecs_.trackValue(refreshTime);
     stats_.ramItemLifeTimeSecs_.trackValue(lifeTime);
     stats_.perPoolEvictionAgeSecs_[allocInfo.poolId].trackValue(refreshTime);
+    if (auto& sampler = evictionAgeSamplers_[allocInfo.poolId]) {
+      sampler->recordEviction(allocInfo.classId, refreshTime);
+    }
   }
 
   (*stats_.fragmentationSize)[allocInfo.poolId][allocInfo.classId].sub(
@@ -3170,13 +4060,6 @@ CacheAllocator<CacheTrait>::releaseBackToAllocator(Item& it,
     return ReleaseRes::kReleased;
   }
 
-  // nascent items represent items that were allocated but never inserted into
-  // the cache. We should not be executing removeCB for them since they were
-  // not initialized from the user perspective and never part of the cache.
-  if (!nascent && config_.removeCb) {
-    config_.removeCb(RemoveCbData{ctx, it, viewAsChainedAllocsRange(it)});
-  }
-
   // only skip destructor for evicted items that are either in the queue to put
   // into nvm or already in nvm
   bool skipDestructor =
@@ -3185,21 +4068,24 @@ CacheAllocator<CacheTrait>::releaseBackToAllocator(Item& it,
                   // as clean and the NvmEvicted bit will also be set to false.
                   // Refer to NvmCache::put()
                   it.isNvmClean() && !it.isNvmEvicted());
-  if (!skipDestructor) {
-    if (ctx == RemoveContext::kEviction) {
-      stats().numCacheEvictions.inc();
-    }
-    // execute ItemDestructor
-    if (config_.itemDestructor) {
-      try {
-        config_.itemDestructor(DestructorData{
-            ctx, it, viewAsChainedAllocsRange(it), allocInfo.poolId});
-        stats().numRamDestructorCalls.inc();
-      } catch (const std::exception& e) {
-        stats().numDestructorExceptions.inc();
-        XLOG_EVERY_N(INFO, 100)
-            << "Catch exception from user's item destructor: " << e.what();
-      }
+  if (!skipDestructor && ctx == RemoveContext::kEviction) {
+    stats().numCacheEvictions.inc();
+  }
+
+  // nascent items represent items that were allocated but never inserted into
+  // the cache. We should not be executing removeCB for them since they were
+  // not initialized from the user perspective and never part of the cache.
+  if (kHasItemCallbacks && !nascent &&
+      (config_.removeCb || config_.itemDestructor)) {
+    // the memory of an evicted item is reused right away, so its callbacks
+    // are deferred on a copy. The chained items would have to be copied as
+    // well, so the items that have them run their callbacks here.
+    const bool deferred =
+        ctx == RemoveContext::kEviction && deferredReleaser_ &&
+        !it.hasChainedItem() &&
+        deferredReleaser_->deferEvicted(it, !skipDestructor, allocInfo.poolId);
+    if (!deferred) {
+      runItemCallbacks(it, ctx, !skipDestructor, allocInfo.poolId);
     }
   }
 
@@ -3271,6 +4157,29 @@ CacheAllocator<CacheTrait>::releaseBackToAllocator(Item& it,
   return res;
 }
 
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::runItemCallbacks(Item& it,
+                                                  RemoveContext ctx,
+                                                  bool runDestructor,
+                                                  PoolId pid) {
+  if (config_.removeCb) {
+    config_.removeCb(RemoveCbData{ctx, it, viewAsChainedAllocsRange(it)});
+  }
+
+  // execute ItemDestructor
+  if (runDestructor && config_.itemDestructor) {
+    try {
+      config_.itemDestructor(
+          DestructorData{ctx, it, viewAsChainedAllocsRange(it), pid});
+      stats().numRamDestructorCalls.inc();
+    } catch (const std::exception& e) {
+      stats().numDestructorExceptions.inc();
+      XLOG_EVERY_N(INFO, 100)
+          << "Catch exception from user's item destructor: " << e.what();
+    }
+  }
+}
+
 template <typename CacheTrait>
 RefcountWithFlags::IncResult CacheAllocator<CacheTrait>::incRef(Item& it) {
   auto ret = it.incRef();
@@ -3324,7 +4233,7 @@ void CacheAllocator<CacheTrait>::release(Item* it, bool isNascent) {
 
   const auto ref = decRef(*it);
 
-  if (UNLIKELY(ref == 0)) {
+  if (UNLIKELY(ref == 0) && !deferRelease(*it, isNascent)) {
     const auto res =
         releaseBackToAllocator(*it, RemoveContext::kNormal, isNascent);
     XDCHECK(res == ReleaseRes::kReleased);
@@ -3409,7 +4318,7 @@ bool CacheAllocator<CacheTrait>::insertImpl(const WriteHandle& handle,
     throw std::invalid_argument("Handle is already accessible");
   }
 
-  if (nvmCache_ != nullptr && !handle->isNvmClean()) {
+  if (hasNvmCache() && !handle->isNvmClean()) {
     throw std::invalid_argument("Can't use insert API with nvmCache enabled");
   }
 
@@ -3448,8 +4357,8 @@ CacheAllocator<CacheTrait>::insertOrReplace(const WriteHandle& handle) {
   insertInMMContainer(*(handle.getInternal()));
   WriteHandle replaced;
   try {
-    auto lock = nvmCache_ ? nvmCache_->getItemDestructorLock(hk)
-                          : std::unique_lock<TimedMutex>();
+    auto lock = hasNvmCache() ? nvmCache_->getItemDestructorLock(hk)
+                              : std::unique_lock<TimedMutex>();
 
     replaced = accessContainer_->insertOrReplace(*(handle.getInternal()));
 
@@ -3474,9 +4383,11 @@ CacheAllocator<CacheTrait>::insertOrReplace(const WriteHandle& handle) {
   // Remove from LRU as well if we do have a handle of old item
   if (replaced) {
     removeFromMMContainer(*replaced);
+    invalidateHotKeyReplicas(replaced->getKey());
+    foldStripedRefcount(replaced->getKey());
   }
 
-  if (UNLIKELY(nvmCache_ != nullptr)) {
+  if (UNLIKELY(hasNvmCache())) {
     // We can avoid nvm delete only if we have non nvm clean item in cache.
     // In all other cases we must enqueue delete.
     if (!replaced || replaced->isNvmClean()) {
@@ -3572,6 +4483,10 @@ bool CacheAllocator<CacheTrait>::moveRegularItem(Item& oldItem,
   if (oldItem.isNvmClean()) {
     newItemHdl->markNvmClean();
   }
+  if (oldItem.isLargeItem()) {
+    newItemHdl->markLargeItem();
+  }
+  newItemHdl->setCostLevel(oldItem.getCostLevel());
 
   // Execute the move callback. We cannot make any guarantees about the
   // consistency of the old item beyond this point, because the callback can
@@ -3580,7 +4495,12 @@ bool CacheAllocator<CacheTrait>::moveRegularItem(Item& oldItem,
   // responsibility to invalidate them. The move can only fail after this
   // statement if the old item has been removed or replaced, in which case it
   // should be fine for it to be left in an inconsistent state.
-  config_.moveCb(oldItem, *newItemHdl, nullptr);
+  if (config_.moveCb) {
+    config_.moveCb(oldItem, *newItemHdl, nullptr);
+  } else {
+    std::memcpy(newItemHdl->getMemory(), oldItem.getMemory(),
+                oldItem.getSize());
+  }
 
   // Adding the item to mmContainer has to succeed since no one can remove the
   // item
@@ -3670,6 +4590,7 @@ void CacheAllocator<CacheTrait>::unlinkItemForEviction(Item& it) {
   XDCHECK_EQ(0u, it.getRefCount());
   accessContainer_->remove(it);
   removeFromMMContainer(it);
+  invalidateHotKeyReplicas(it.getKey());
 
   // Since we managed to mark the item for eviction we must be the only
   // owner of the item.
@@ -3682,24 +4603,46 @@ std::pair<typename CacheAllocator<CacheTrait>::Item*,
           typename CacheAllocator<CacheTrait>::Item*>
 CacheAllocator<CacheTrait>::getNextCandidate(PoolId pid,
                                              ClassId cid,
+                                             size_t shard,
                                              unsigned int& searchTries) {
-  typename NvmCacheT::PutToken token;
-  Item* toRecycle = nullptr;
-  Item* candidate = nullptr;
-  auto& mmContainer = getMMContainer(pid, cid);
-
-  mmContainer.withEvictionIterator([this, pid, cid, &candidate, &toRecycle,
-                                    &searchTries, &mmContainer,
-                                    &token](auto&& itr) {
+  std::vector<std::pair<Item*, Item*>> candidates;
+  getNextCandidates(pid, cid, shard, 1, config_.evictionSearchTries,
+                    searchTries, candidates);
+  if (candidates.empty()) {
+    return {nullptr, nullptr};
+  }
+  return candidates.front();
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::getNextCandidates(
+    PoolId pid,
+    ClassId cid,
+    size_t shard,
+    size_t maxCandidates,
+    unsigned int searchLimit,
+    unsigned int& searchTries,
+    std::vector<std::pair<Item*, Item*>>& candidates) {
+  std::vector<typename NvmCacheT::PutToken> tokens;
+  const size_t first = candidates.size();
+  auto& mmContainer = getMMContainer(pid, cid, shard);
+
+  mmContainer.withEvictionIterator([this, pid, cid, maxCandidates, searchLimit,
+                                    first, &candidates, &tokens, &searchTries,
+                                    &mmContainer](auto&& itr) {
     if (!itr) {
       ++searchTries;
       (*stats_.evictionAttempts)[pid][cid].inc();
       return;
     }
 
-    while ((config_.evictionSearchTries == 0 ||
-            config_.evictionSearchTries > searchTries) &&
-           itr) {
+    // items between the start of the eviction queue and itr
+    size_t pos = 0;
+    while ((searchLimit == 0 || searchLimit > searchTries) && itr &&
+           candidates.size() - first < maxCandidates) {
+      if (config_.costAwareEvictionCandidates > 1) {
+        seekLowestCostCandidate(itr, pos, config_.costAwareEvictionCandidates);
+      }
       ++searchTries;
       (*stats_.evictionAttempts)[pid][cid].inc();
 
@@ -3732,7 +4675,7 @@ CacheAllocator<CacheTrait>::getNextCandidate(PoolId pid,
 
         if (!putTokenRv) {
           switch (putTokenRv.error()) {
-          case InFlightPuts::PutTokenError::TRY_LOCK_FAIL:
+          case InFlightPuts::PutTokenError::TABLE_FULL:
             stats_.evictFailPutTokenLock.inc();
             break;
           case InFlightPuts::PutTokenError::TOKEN_EXISTS:
@@ -3743,6 +4686,7 @@ CacheAllocator<CacheTrait>::getNextCandidate(PoolId pid,
             break;
           }
           ++itr;
+          ++pos;
           continue;
         }
         putToken = std::move(*putTokenRv);
@@ -3750,59 +4694,113 @@ CacheAllocator<CacheTrait>::getNextCandidate(PoolId pid,
       } else {
         if (!markForEviction()) {
           ++itr;
+          ++pos;
           continue;
         }
       }
 
       // markForEviction to make sure no other thead is evicting the item
       // nor holding a handle to that item
-      toRecycle = toRecycle_;
-      candidate = candidate_;
-      token = std::move(putToken);
+      candidates.emplace_back(candidate_, toRecycle_);
+      tokens.push_back(std::move(putToken));
 
       // Check if parent changed for chained items - if yes, we cannot
       // remove the child from the mmContainer as we will not be evicting
       // it. We could abort right here, but we need to cleanup in case
       // unmarkForEviction() returns 0 - so just go through normal path.
       if (!toRecycle_->isChainedItem() ||
-          &toRecycle->asChainedItem().getParentItem(compressor_) == candidate) {
+          &toRecycle_->asChainedItem().getParentItem(compressor_) ==
+              candidate_) {
         mmContainer.remove(itr);
+      } else {
+        ++itr;
+        ++pos;
       }
-      return;
     }
   });
 
-  if (!toRecycle) {
-    return {candidate, toRecycle};
-  }
-
-  XDCHECK(toRecycle);
-  XDCHECK(candidate);
-  XDCHECK(candidate->isMarkedForEviction());
+  for (size_t i = first; i < candidates.size(); i++) {
+    auto& candidate = *candidates[i].first;
+    XDCHECK(candidates[i].second);
+    XDCHECK(candidate.isMarkedForEviction());
 
-  unlinkItemForEviction(*candidate);
+    unlinkItemForEviction(candidate);
 
-  if (token.isValid() && shouldWriteToNvmCacheExclusive(*candidate)) {
-    nvmCache_->put(*candidate, std::move(token));
+    auto& token = tokens[i - first];
+    if (token.isValid() && shouldWriteToNvmCacheExclusive(candidate)) {
+      nvmCache_->put(candidate, std::move(token));
+    }
   }
-  return {candidate, toRecycle};
 }
 
 template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::Item*
-CacheAllocator<CacheTrait>::findEviction(PoolId pid, ClassId cid) {
-  // Keep searching for a candidate until we were able to evict it
-  // or until the search limit has been exhausted
+template <typename EvictionIterator>
+void CacheAllocator<CacheTrait>::seekLowestCostCandidate(
+    EvictionIterator& itr, size_t& pos, size_t numCandidates) {
+  auto getParent = [this](Item* item) -> Item& {
+    return item->isChainedItem()
+               ? item->asChainedItem().getParentItem(compressor_)
+               : *item;
+  };
+
+  size_t best = 0;
+  double bestCost = std::numeric_limits<double>::max();
+  for (size_t i = 0; itr && i < numCandidates; ++i, ++itr) {
+    const auto& item = getParent(itr.get());
+    // every level costs 4 times the previous one
+    const double cost =
+        static_cast<double>(1u << (2 * item.getCostLevel())) /
+        static_cast<double>(std::max(1u, item.getTotalSize()));
+    if (cost < bestCost) {
+      best = i;
+      bestCost = cost;
+    }
+  }
+  if (best == 0 && pos == 0) {
+    itr.resetToBegin();
+    return;
+  }
+
+  // the iterator only moves forward; walk again from the start of the queue
+  itr.resetToBegin();
+  for (size_t i = 0; itr && i < pos + best; ++i, ++itr) {
+    if (i >= pos) {
+      auto& item = getParent(itr.get());
+      if (const auto level = item.getCostLevel(); level > 0) {
+        item.setCostLevel(level - 1);
+      }
+    }
+  }
+  pos += best;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::Item*
+CacheAllocator<CacheTrait>::findEviction(PoolId pid, ClassId cid) {
+  // Keep searching for a candidate until we were able to evict it
+  // or until the search limit has been exhausted
   unsigned int searchTries = 0;
+  // with multiple shards, start from a random one and move on to the next
+  // shard after every attempt so that evictions are spread evenly.
+  const size_t numShards = config_.numMMContainerShards;
+  size_t shard = numShards == 1 ? 0 : folly::Random::rand32(numShards);
   while (config_.evictionSearchTries == 0 ||
          config_.evictionSearchTries > searchTries) {
-    auto [candidate, toRecycle] = getNextCandidate(pid, cid, searchTries);
+    auto [candidate, toRecycle] =
+        getLowerTierPool(pid) != Slab::kInvalidPoolId
+            ? getNextCandidateForDemotion(pid, cid, shard, searchTries)
+            : getNextCandidate(pid, cid, shard, searchTries);
+    shard = (shard + 1) & (numShards - 1);
 
     // Reached the end of the eviction queue but doulen't find a candidate,
     // start again.
     if (!toRecycle) {
       continue;
     }
+    // the candidate moved to the lower memory tier and left its memory behind
+    if (!candidate) {
+      return toRecycle;
+    }
     // recycle the item. it's safe to do so, even if toReleaseHandle was
     // NULL. If `ref` == 0 then it means that we are the last holder of
     // that item.
@@ -3811,6 +4809,8 @@ CacheAllocator<CacheTrait>::findEviction(PoolId pid, ClassId cid) {
     } else {
       (*stats_.regularItemEvictions)[pid][cid].inc();
     }
+    CACHELIB_TRACEPOINT(dram_evict, pid, cid, candidate->getKey().data(),
+                        candidate->getKey().size());
 
     if (auto eventTracker = getEventTracker()) {
       eventTracker->record(AllocatorApiEvent::DRAM_EVICT, candidate->getKey(),
@@ -3829,6 +4829,356 @@ CacheAllocator<CacheTrait>::findEviction(PoolId pid, ClassId cid) {
   return nullptr;
 }
 
+template <typename CacheTrait>
+std::pair<typename CacheAllocator<CacheTrait>::Item*,
+          typename CacheAllocator<CacheTrait>::Item*>
+CacheAllocator<CacheTrait>::getNextCandidateForDemotion(
+    PoolId pid, ClassId cid, size_t shard, unsigned int& searchTries) {
+  Item* candidate = nullptr;
+  auto& mmContainer = getMMContainer(pid, cid, shard);
+
+  mmContainer.withEvictionIterator([this, pid, cid, &candidate, &searchTries,
+                                    &mmContainer](auto&& itr) {
+    while ((config_.evictionSearchTries == 0 ||
+            config_.evictionSearchTries > searchTries) &&
+           itr) {
+      // only regular items are demoted. Chained items and expired items are
+      // left to the regular eviction.
+      auto* item = itr.get();
+      if (item->isChainedItem() || item->hasChainedItem() ||
+          item->isExpired()) {
+        return;
+      }
+
+      ++searchTries;
+      (*stats_.evictionAttempts)[pid][cid].inc();
+
+      if (item->markMoving()) {
+        candidate = item;
+        mmContainer.remove(itr);
+        return;
+      }
+      stats_.evictFailAC.inc();
+      ++itr;
+    }
+  });
+
+  if (!candidate) {
+    return getNextCandidate(pid, cid, shard, searchTries);
+  }
+
+  {
+    util::LatencyTracker tracker{memoryTiers_->demoteLatency};
+    if (moveItemToTier(*candidate, getLowerTierPool(pid), false)) {
+      stats_.numMemoryTierDemotions.inc();
+      return {nullptr, candidate};
+    }
+  }
+
+  // the lower tier had no room for the item, or the item was removed in the
+  // meanwhile. Evict it like the slab release does.
+  stats_.numMemoryTierDemotionFailures.inc();
+  auto token = createPutToken(*candidate);
+  const auto marked = candidate->markForEvictionWhenMoving();
+  XDCHECK(marked);
+  unlinkItemForEviction(*candidate);
+  wakeUpWaiters(candidate->getKey(), {});
+
+  if (token.isValid() && shouldWriteToNvmCacheExclusive(*candidate)) {
+    nvmCache_->put(*candidate, std::move(token));
+  }
+  return {candidate, candidate};
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::moveItemToTier(Item& oldItem,
+                                                PoolId pid,
+                                                bool fromBgThread) {
+  XDCHECK(oldItem.isMoving());
+  XDCHECK(!oldItem.isChainedItem());
+
+  auto newItemHdl = allocateInternal(pid,
+                                     oldItem.getKey(),
+                                     oldItem.getSize(),
+                                     oldItem.getCreationTime(),
+                                     oldItem.getExpiryTime(),
+                                     fromBgThread);
+  if (!newItemHdl || !moveRegularItem(oldItem, newItemHdl)) {
+    return false;
+  }
+  removeFromMMContainer(oldItem);
+
+  const auto allocInfo = allocator_->getAllocInfo(oldItem.getMemory());
+  (*stats_.fragmentationSize)[allocInfo.poolId][allocInfo.classId].sub(
+      util::getFragmentation(*this, oldItem));
+
+  auto ref = unmarkMovingAndWakeUpWaiters(oldItem, std::move(newItemHdl));
+  XDCHECK_EQ(0u, ref);
+  return true;
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::promoteItem(folly::StringPiece key) {
+  auto handle = findInternal(key);
+  // the item is gone, or is being moved by someone else
+  if (!handle.isReady() || !handle) {
+    return false;
+  }
+
+  auto& item = *handle.getInternal();
+  const auto upperPid =
+      getUpperTierPool(allocator_->getAllocInfo(item.getMemory()).poolId);
+  if (upperPid == Slab::kInvalidPoolId || item.hasChainedItem() ||
+      item.isExpired()) {
+    return false;
+  }
+
+  // Turn our handle into the moving ref of the item, so that it can not be
+  // accessed until the move completes. This fails if anyone else is holding
+  // a handle to the item, in which case it is promoted on a later hit.
+  if (!item.markMovingWhenOnlyRef()) {
+    stats_.numMemoryTierPromotionFailures.inc();
+    return false;
+  }
+  handle.release();
+  --handleCount_.tlStats();
+
+  {
+    util::LatencyTracker tracker{memoryTiers_->promoteLatency};
+    if (moveItemToTier(item, upperPid, true)) {
+      allocator_->free(&item);
+      stats_.numMemoryTierPromotions.inc();
+      return true;
+    }
+  }
+  stats_.numMemoryTierPromotionFailures.inc();
+
+  // The item stays in the lower tier, unless it was removed in the meanwhile.
+  // Then nobody else holds it anymore and it is up to us to release it.
+  const auto ref = item.unmarkMoving();
+  if (ref == 0) {
+    wakeUpWaiters(key, {});
+    const auto res =
+        releaseBackToAllocator(item, RemoveContext::kNormal, false);
+    XDCHECK(res == ReleaseRes::kReleased);
+    return false;
+  }
+
+  // We do another lookup here because once we unmark moving, another thread
+  // is free to remove or evict the item.
+  auto lookupHdl = findInternal(key);
+  if (lookupHdl && !lookupHdl.isReady()) {
+    lookupHdl.wait();
+  }
+  wakeUpWaiters(key, std::move(lookupHdl));
+  return false;
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::recordLowerTierAccess(const Item& item,
+                                                       PoolId pid,
+                                                       ClassId cid) {
+  const auto hash = folly::hasher<folly::StringPiece>()(item.getKey());
+  auto& shard =
+      memoryTiers_->accessShards[hash % MemoryTierState::kNumAccessShards];
+  {
+    // lookups are not held back on a busy shard, the access just goes
+    // uncounted
+    std::unique_lock<std::mutex> l(shard.mutex, std::try_to_lock);
+    if (!l.owns_lock()) {
+      return;
+    }
+    shard.sketch.increment(hash);
+    if (++shard.numAccesses >= MemoryTierState::kAccessSketchWidth) {
+      shard.sketch.decayCountsBy(0.5);
+      shard.numAccesses = 0;
+    }
+    if (shard.sketch.getCount(hash) < config_.memoryTierPromotionMinHits) {
+      return;
+    }
+    shard.sketch.resetCount(hash);
+  }
+
+  auto& queue = memoryTiers_->promotionQueues[pid][cid];
+  std::lock_guard<std::mutex> l(queue.mutex);
+  if (queue.keys.size() >= MemoryTierState::kMaxQueuedPromotions) {
+    stats_.numMemoryTierPromotionsDropped.inc();
+    return;
+  }
+  queue.keys.emplace_back(item.getKey().data(), item.getKey().size());
+  stats_.numMemoryTierPromotionsQueued.inc();
+}
+
+template <typename CacheTrait>
+size_t CacheAllocator<CacheTrait>::traverseAndEvictItems(unsigned int pid,
+                                                         unsigned int cid,
+                                                         size_t batch) {
+  size_t evicted = 0;
+  if (getLowerTierPool(static_cast<PoolId>(pid)) != Slab::kInvalidPoolId) {
+    while (evicted < batch) {
+      void* memory =
+          findEviction(static_cast<PoolId>(pid), static_cast<ClassId>(cid));
+      if (memory == nullptr) {
+        break;
+      }
+      allocator_->free(memory);
+      ++evicted;
+    }
+    return evicted;
+  }
+
+  // the search budget of the batch is that of as many single evictions
+  const unsigned int searchLimit = static_cast<unsigned int>(
+      std::min<size_t>(config_.evictionSearchTries * batch,
+                       std::numeric_limits<unsigned int>::max()));
+  unsigned int searchTries = 0;
+  const size_t numShards = config_.numMMContainerShards;
+  size_t shard = numShards == 1 ? 0 : folly::Random::rand32(numShards);
+  // give up once every shard came back empty in a row
+  size_t numEmptyShards = 0;
+  std::vector<std::pair<Item*, Item*>> candidates;
+  while (evicted < batch && numEmptyShards < numShards &&
+         (searchLimit == 0 || searchLimit > searchTries)) {
+    candidates.clear();
+    getNextCandidates(static_cast<PoolId>(pid), static_cast<ClassId>(cid),
+                      shard, batch - evicted, searchLimit, searchTries,
+                      candidates);
+    shard = (shard + 1) & (numShards - 1);
+    numEmptyShards = candidates.empty() ? numEmptyShards + 1 : 0;
+
+    for (auto [candidate, toRecycle] : candidates) {
+      if (candidate->hasChainedItem()) {
+        (*stats_.chainedItemEvictions)[pid][cid].inc();
+      } else {
+        (*stats_.regularItemEvictions)[pid][cid].inc();
+      }
+      CACHELIB_TRACEPOINT(dram_evict, pid, cid, candidate->getKey().data(),
+                          candidate->getKey().size());
+      if (auto eventTracker = getEventTracker()) {
+        eventTracker->record(AllocatorApiEvent::DRAM_EVICT,
+                             candidate->getKey(), AllocatorApiResult::EVICTED,
+                             candidate->getSize(),
+                             candidate->getConfiguredTTL().count());
+      }
+      if (releaseBackToAllocator(*candidate, RemoveContext::kEviction,
+                                 /* isNascent */ false,
+                                 toRecycle) == ReleaseRes::kRecycled) {
+        allocator_->free(toRecycle);
+        ++evicted;
+      }
+    }
+  }
+  return evicted;
+}
+
+template <typename CacheTrait>
+size_t CacheAllocator<CacheTrait>::traverseAndPromoteItems(unsigned int pid,
+                                                           unsigned int cid,
+                                                           size_t batch) {
+  if (getUpperTierPool(static_cast<PoolId>(pid)) == Slab::kInvalidPoolId) {
+    return 0;
+  }
+
+  // take the most recently queued keys first
+  std::vector<std::string> keys;
+  {
+    auto& queue = memoryTiers_->promotionQueues[pid][cid];
+    std::lock_guard<std::mutex> l(queue.mutex);
+    const size_t num = std::min(batch, queue.keys.size());
+    keys.assign(std::make_move_iterator(queue.keys.end() - num),
+                std::make_move_iterator(queue.keys.end()));
+    queue.keys.resize(queue.keys.size() - num);
+  }
+
+  size_t promoted = 0;
+  for (const auto& key : keys) {
+    if (promoteItem(key)) {
+      ++promoted;
+    }
+  }
+  return promoted;
+}
+
+template <typename CacheTrait>
+void* CacheAllocator<CacheTrait>::allocateFromEviction(PoolId pid,
+                                                       ClassId cid) {
+  if (!evictedAllocs_) {
+    return findEviction(pid, cid);
+  }
+
+  auto& evicted = (*evictedAllocs_)[pid][cid];
+  {
+    std::lock_guard<std::mutex> l(evicted.mutex);
+    if (!evicted.allocs.empty()) {
+      void* memory = evicted.allocs.back();
+      evicted.allocs.pop_back();
+      return memory;
+    }
+  }
+
+  void* memory = findEviction(pid, cid);
+  if (memory == nullptr) {
+    return nullptr;
+  }
+
+  // evict the rest of the batch without holding the stash lock so that other
+  // threads can keep taking allocations from it in the meanwhile.
+  const size_t numToStash = config_.evictionBatchSize - 1;
+  std::vector<void*> batch;
+  batch.reserve(numToStash);
+  while (batch.size() < numToStash) {
+    void* alloc = findEviction(pid, cid);
+    if (alloc == nullptr) {
+      break;
+    }
+    batch.push_back(alloc);
+  }
+
+  // several threads might have refilled the stash concurrently. Keep it at
+  // most one batch large and give the surplus back to the allocator.
+  {
+    std::lock_guard<std::mutex> l(evicted.mutex);
+    while (!batch.empty() && evicted.allocs.size() < numToStash) {
+      evicted.allocs.push_back(batch.back());
+      batch.pop_back();
+    }
+  }
+  for (void* alloc : batch) {
+    allocator_->free(alloc);
+  }
+  return memory;
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::flushEvictedAllocs(PoolId pid, ClassId cid) {
+  if (!evictedAllocs_) {
+    return;
+  }
+
+  std::vector<void*> allocs;
+  {
+    auto& evicted = (*evictedAllocs_)[pid][cid];
+    std::lock_guard<std::mutex> l(evicted.mutex);
+    allocs.swap(evicted.allocs);
+  }
+  for (void* alloc : allocs) {
+    allocator_->free(alloc);
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::flushAllEvictedAllocs() {
+  if (!evictedAllocs_) {
+    return;
+  }
+
+  for (size_t pid = 0; pid < evictedAllocs_->size(); ++pid) {
+    for (size_t cid = 0; cid < (*evictedAllocs_)[pid].size(); ++cid) {
+      flushEvictedAllocs(static_cast<PoolId>(pid), static_cast<ClassId>(cid));
+    }
+  }
+}
+
 template <typename CacheTrait>
 folly::Range<typename CacheAllocator<CacheTrait>::ChainedItemIter>
 CacheAllocator<CacheTrait>::viewAsChainedAllocsRange(const Item& parent) const {
@@ -3844,7 +5194,7 @@ template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::shouldWriteToNvmCache(const Item& item) {
   // write to nvmcache when it is enabled and the item says that it is not
   // nvmclean or evicted by nvm while present in DRAM.
-  bool doWrite = nvmCache_ && nvmCache_->isEnabled();
+  bool doWrite = hasNvmCache() && nvmCache_->isEnabled();
   if (!doWrite) {
     return false;
   }
@@ -3927,11 +5277,12 @@ CacheAllocator<CacheTrait>::remove(typename Item::Key key) {
   HashedKey hk{key};
 
   using Guard = typename NvmCacheT::DeleteTombStoneGuard;
-  auto tombStone = nvmCache_ ? nvmCache_->createDeleteTombStone(hk) : Guard{};
+  auto tombStone =
+      hasNvmCache() ? nvmCache_->createDeleteTombStone(hk) : Guard{};
 
   auto handle = findInternal(key);
   if (!handle) {
-    if (nvmCache_) {
+    if (hasNvmCache()) {
       nvmCache_->remove(hk, std::move(tombStone));
     }
     if (auto eventTracker = getEventTracker()) {
@@ -3944,6 +5295,47 @@ CacheAllocator<CacheTrait>::remove(typename Item::Key key) {
   return removeImpl(hk, *handle, std::move(tombStone));
 }
 
+template <typename CacheTrait>
+size_t CacheAllocator<CacheTrait>::removeBatch(folly::Range<const Key*> keys,
+                                               RemoveBatchCallback cb) {
+  // same as remove() for each key, see there about the races with nvm.
+  typename NvmCacheT::RemoveBatchKeys nvmBatch;
+  size_t numRemoved = 0;
+  for (const auto& key : keys) {
+    stats_.numCacheRemoves.inc();
+    HashedKey hk{key};
+
+    using Guard = typename NvmCacheT::DeleteTombStoneGuard;
+    auto tombStone =
+        hasNvmCache() ? nvmCache_->createDeleteTombStone(hk) : Guard{};
+
+    auto handle = findInternal(key);
+    if (!handle) {
+      if (hasNvmCache()) {
+        nvmBatch.emplace_back(hk, std::move(tombStone));
+      }
+      if (auto eventTracker = getEventTracker()) {
+        eventTracker->record(AllocatorApiEvent::REMOVE, key,
+                             AllocatorApiResult::NOT_FOUND);
+      }
+      continue;
+    }
+
+    if (removeImpl(hk, *handle, std::move(tombStone), true /* removeFromNvm */,
+                   true /* recordApiEvent */,
+                   &nvmBatch) == RemoveRes::kSuccess) {
+      numRemoved++;
+    }
+  }
+
+  if (hasNvmCache()) {
+    nvmCache_->removeBatch(std::move(nvmBatch), std::move(cb));
+  } else if (cb) {
+    cb(RemoveBatchResult{});
+  }
+  return numRemoved;
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::removeFromRamForTesting(
     typename Item::Key key) {
@@ -3954,7 +5346,7 @@ bool CacheAllocator<CacheTrait>::removeFromRamForTesting(
 template <typename CacheTrait>
 void CacheAllocator<CacheTrait>::removeFromNvmForTesting(
     typename Item::Key key) {
-  if (nvmCache_) {
+  if (hasNvmCache()) {
     HashedKey hk{key};
     nvmCache_->remove(hk, nvmCache_->createDeleteTombStone(hk));
   }
@@ -3965,7 +5357,7 @@ bool CacheAllocator<CacheTrait>::pushToNvmCacheFromRamForTesting(
     typename Item::Key key) {
   auto handle = findInternal(key);
 
-  if (handle && nvmCache_ && shouldWriteToNvmCache(*handle) &&
+  if (handle && hasNvmCache() && shouldWriteToNvmCache(*handle) &&
       shouldWriteToNvmCacheExclusive(*handle)) {
     auto putTokenRv =
         nvmCache_->createPutToken(handle->getKey(), []() { return true; });
@@ -3981,7 +5373,7 @@ bool CacheAllocator<CacheTrait>::pushToNvmCacheFromRamForTesting(
 
 template <typename CacheTrait>
 void CacheAllocator<CacheTrait>::flushNvmCache() {
-  if (nvmCache_) {
+  if (hasNvmCache()) {
     nvmCache_->flushPendingOps();
   }
 }
@@ -3996,8 +5388,8 @@ CacheAllocator<CacheTrait>::remove(AccessIterator& it) {
                          it->getConfiguredTTL().count());
   }
   HashedKey hk{it->getKey()};
-  auto tombstone =
-      nvmCache_ ? nvmCache_->createDeleteTombStone(hk) : DeleteTombStoneGuard{};
+  auto tombstone = hasNvmCache() ? nvmCache_->createDeleteTombStone(hk)
+                                  : DeleteTombStoneGuard{};
   return removeImpl(hk, *it, std::move(tombstone));
 }
 
@@ -4009,22 +5401,24 @@ CacheAllocator<CacheTrait>::remove(const ReadHandle& it) {
     throw std::invalid_argument("Trying to remove a null item handle");
   }
   HashedKey hk{it->getKey()};
-  auto tombstone =
-      nvmCache_ ? nvmCache_->createDeleteTombStone(hk) : DeleteTombStoneGuard{};
+  auto tombstone = hasNvmCache() ? nvmCache_->createDeleteTombStone(hk)
+                                  : DeleteTombStoneGuard{};
   return removeImpl(hk, *(it.getInternal()), std::move(tombstone));
 }
 
 template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::RemoveRes
-CacheAllocator<CacheTrait>::removeImpl(HashedKey hk,
-                                       Item& item,
-                                       DeleteTombStoneGuard tombstone,
-                                       bool removeFromNvm,
-                                       bool recordApiEvent) {
+CacheAllocator<CacheTrait>::removeImpl(
+    HashedKey hk,
+    Item& item,
+    DeleteTombStoneGuard tombstone,
+    bool removeFromNvm,
+    bool recordApiEvent,
+    typename NvmCacheT::RemoveBatchKeys* nvmBatch) {
   bool success = false;
   {
-    auto lock = nvmCache_ ? nvmCache_->getItemDestructorLock(hk)
-                          : std::unique_lock<TimedMutex>();
+    auto lock = hasNvmCache() ? nvmCache_->getItemDestructorLock(hk)
+                              : std::unique_lock<TimedMutex>();
 
     success = accessContainer_->remove(item);
 
@@ -4040,13 +5434,21 @@ CacheAllocator<CacheTrait>::removeImpl(HashedKey hk,
   // remove it from the mm container. this will be no-op if it is already
   // removed.
   removeFromMMContainer(item);
+  if (success) {
+    invalidateHotKeyReplicas(hk.key());
+    foldStripedRefcount(hk.key());
+  }
 
   // Enqueue delete to nvmCache if we know from the item that it was pulled in
   // from NVM. If the item was not pulled in from NVM, it is not possible to
   // have it be written to NVM.
   if (removeFromNvm && item.isNvmClean()) {
     XDCHECK(tombstone);
-    nvmCache_->remove(hk, std::move(tombstone));
+    if (nvmBatch) {
+      nvmBatch->emplace_back(hk, std::move(tombstone));
+    } else {
+      nvmCache_->remove(hk, std::move(tombstone));
+    }
   }
 
   auto eventTracker = getEventTracker();
@@ -4068,7 +5470,7 @@ CacheAllocator<CacheTrait>::removeImpl(HashedKey hk,
 
 template <typename CacheTrait>
 void CacheAllocator<CacheTrait>::invalidateNvm(Item& item) {
-  if (nvmCache_ != nullptr && item.isAccessible() && item.isNvmClean()) {
+  if (hasNvmCache() && item.isAccessible() && item.isNvmClean()) {
     HashedKey hk{item.getKey()};
     {
       auto lock = nvmCache_->getItemDestructorLock(hk);
@@ -4088,16 +5490,56 @@ typename CacheAllocator<CacheTrait>::MMContainer&
 CacheAllocator<CacheTrait>::getMMContainer(const Item& item) const noexcept {
   const auto allocInfo =
       allocator_->getAllocInfo(static_cast<const void*>(&item));
-  return getMMContainer(allocInfo.poolId, allocInfo.classId);
+  return getMMContainer(allocInfo.poolId, allocInfo.classId,
+                        getMMContainerShard(item));
 }
 
 template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::MMContainer&
 CacheAllocator<CacheTrait>::getMMContainer(PoolId pid,
-                                           ClassId cid) const noexcept {
+                                           ClassId cid,
+                                           size_t shard) const noexcept {
   XDCHECK_LT(static_cast<size_t>(pid), mmContainers_.size());
   XDCHECK_LT(static_cast<size_t>(cid), mmContainers_[pid].size());
-  return *mmContainers_[pid][cid];
+  XDCHECK_LT(shard, mmContainers_[pid][cid].size());
+  return *mmContainers_[pid][cid][shard];
+}
+
+template <typename CacheTrait>
+size_t CacheAllocator<CacheTrait>::getMMContainerShard(
+    const Item& item) const noexcept {
+  const size_t numShards = config_.numMMContainerShards;
+  if (numShards == 1) {
+    return 0;
+  }
+  // use the compressed pointer rather than the address so that the shard of
+  // an item is preserved across a warm roll.
+  const auto compressed = compressor_.compress(&item).saveState();
+  return folly::hash::twang_mix64(static_cast<uint64_t>(compressed)) &
+         (numShards - 1);
+}
+
+template <typename CacheTrait>
+MMContainerStat CacheAllocator<CacheTrait>::getMMContainerStat(
+    PoolId pid, ClassId cid) const noexcept {
+  const auto& shards = mmContainers_[pid][cid];
+  XDCHECK(!shards.empty());
+  MMContainerStat stat = shards[0]->getStats();
+  for (size_t i = 1; i < shards.size(); i++) {
+    const auto shardStat = shards[i]->getStats();
+    stat.size += shardStat.size;
+    stat.oldestTimeSec = std::min(stat.oldestTimeSec, shardStat.oldestTimeSec);
+    stat.lruRefreshTime = std::max(stat.lruRefreshTime,
+                                   shardStat.lruRefreshTime);
+    stat.numHotAccesses += shardStat.numHotAccesses;
+    stat.numColdAccesses += shardStat.numColdAccesses;
+    stat.numWarmAccesses += shardStat.numWarmAccesses;
+    stat.numTailAccesses += shardStat.numTailAccesses;
+    stat.numLockContended += shardStat.numLockContended;
+    stat.numLockWaitSampled += shardStat.numLockWaitSampled;
+    stat.lockWaitNs += shardStat.lockWaitNs;
+  }
+  return stat;
 }
 
 template <typename CacheTrait>
@@ -4106,6 +5548,37 @@ CacheAllocator<CacheTrait>::peek(typename Item::Key key) {
   return findInternalWithExpiration(key, AllocatorApiEvent::PEEK);
 }
 
+template <typename CacheTrait>
+std::vector<typename CacheAllocator<CacheTrait>::ReadHandle>
+CacheAllocator<CacheTrait>::getHotItems(PoolId pid,
+                                        ClassId cid,
+                                        size_t maxItems) {
+  const size_t numShards = getNumMMContainerShards();
+  const size_t perShard = (maxItems + numShards - 1) / numShards;
+  std::vector<std::string> keys;
+  keys.reserve(maxItems);
+  for (size_t shard = 0; shard < numShards && keys.size() < maxItems;
+       shard++) {
+    const size_t shardEnd = std::min(maxItems, keys.size() + perShard);
+    getMMContainer(pid, cid, shard).forEachFromMRU([&](Item& item) {
+      // chained items are reached through their parent
+      if (!item.isChainedItem() && item.isAccessible()) {
+        keys.emplace_back(item.getKey().data(), item.getKey().size());
+      }
+      return keys.size() < shardEnd;
+    });
+  }
+
+  std::vector<ReadHandle> handles;
+  handles.reserve(keys.size());
+  for (const auto& key : keys) {
+    if (auto handle = peek(key)) {
+      handles.push_back(std::move(handle));
+    }
+  }
+  return handles;
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::couldExistFast(typename Item::Key key) {
   // At this point, a key either definitely exists or does NOT exist in cache
@@ -4117,7 +5590,7 @@ bool CacheAllocator<CacheTrait>::couldExistFast(typename Item::Key key) {
     return true;
   }
 
-  if (!nvmCache_) {
+  if (!hasNvmCache()) {
     return false;
   }
 
@@ -4132,7 +5605,7 @@ std::pair<typename CacheAllocator<CacheTrait>::ReadHandle,
 CacheAllocator<CacheTrait>::inspectCache(typename Item::Key key) {
   std::pair<ReadHandle, ReadHandle> res;
   res.first = findInternal(key);
-  res.second = nvmCache_ ? nvmCache_->peek(key) : nullptr;
+  res.second = hasNvmCache() ? nvmCache_->peek(key) : nullptr;
   return res;
 }
 
@@ -4140,6 +5613,14 @@ template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::WriteHandle
 CacheAllocator<CacheTrait>::findInternalWithExpiration(
     Key key, AllocatorApiEvent event) {
+  return processLookupResult(key, findInternal(key), event);
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::WriteHandle
+CacheAllocator<CacheTrait>::processLookupResult(Key key,
+                                                WriteHandle handle,
+                                                AllocatorApiEvent event) {
   bool needToBumpStats =
       event == AllocatorApiEvent::FIND || event == AllocatorApiEvent::FIND_FAST;
   if (needToBumpStats) {
@@ -4152,17 +5633,17 @@ CacheAllocator<CacheTrait>::findInternalWithExpiration(
           event == AllocatorApiEvent::PEEK)
       << toString(event);
 
-  auto handle = findInternal(key);
   if (UNLIKELY(!handle)) {
     if (needToBumpStats) {
       stats_.numCacheGetMiss.inc();
+      CACHELIB_TRACEPOINT(find_miss, key.data(), key.size(), 0);
     }
     if (eventTracker) {
       // If caller issued a regular find and we have nvm-cache enabled,
       // it is expected a nvm-cache lookup will follow. We don't know
       // for sure if the lookup will be a hit or miss, so we only record
       // a NOT_FOUND_IN_MEMORY result for now.
-      if (event == AllocatorApiEvent::FIND && nvmCache_ != nullptr) {
+      if (event == AllocatorApiEvent::FIND && hasNvmCache()) {
         eventTracker->record(event, key,
                              AllocatorApiResult::NOT_FOUND_IN_MEMORY);
       } else {
@@ -4177,6 +5658,7 @@ CacheAllocator<CacheTrait>::findInternalWithExpiration(
     if (needToBumpStats) {
       stats_.numCacheGetMiss.inc();
       stats_.numCacheGetExpiries.inc();
+      CACHELIB_TRACEPOINT(find_miss, key.data(), key.size(), 1);
     }
     if (eventTracker) {
       eventTracker->record(event, key, AllocatorApiResult::EXPIRED);
@@ -4202,64 +5684,388 @@ CacheAllocator<CacheTrait>::findFastImpl(typename Item::Key key,
   if (!handle) {
     return handle;
   }
-
-  markUseful(handle, mode);
-  return handle;
+
+  markUseful(handle, mode);
+  return handle;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::findFast(typename Item::Key key) {
+  return findFastImpl(key, AccessMode::kRead);
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::WriteHandle
+CacheAllocator<CacheTrait>::findFastToWrite(typename Item::Key key) {
+  auto handle = findFastImpl(key, AccessMode::kWrite);
+  if (handle == nullptr) {
+    return nullptr;
+  }
+
+  invalidateNvm(*handle);
+  invalidateHotKeyReplicas(key);
+  return handle;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::WriteHandle
+CacheAllocator<CacheTrait>::findImpl(typename Item::Key key, AccessMode mode) {
+  auto handle = findInternalWithExpiration(key, AllocatorApiEvent::FIND);
+  if (handle) {
+    markUseful(handle, mode);
+    return handle;
+  }
+
+  if (!hasNvmCache()) {
+    return handle;
+  }
+
+  // Hybrid-cache's dram miss-path. Handle becomes async once we look up from
+  // nvm-cache. Naively accessing the memory directly after this can be slow.
+  // We also don't need to call `markUseful()` as if we have a hit, we will
+  // have promoted this item into DRAM cache at the front of eviction queue.
+  return nvmCache_->find(HashedKey{key}, mode == AccessMode::kWrite);
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::WriteHandle
+CacheAllocator<CacheTrait>::findToWrite(typename Item::Key key) {
+  auto handle = findImpl(key, AccessMode::kWrite);
+  if (handle == nullptr) {
+    return nullptr;
+  }
+  invalidateNvm(*handle);
+  invalidateHotKeyReplicas(key);
+  return handle;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::find(typename Item::Key key) {
+  if (LIKELY(hotKeyReplicas_ == nullptr && stripedRefcounts_ == nullptr)) {
+    return findImpl(key, AccessMode::kRead);
+  }
+  if (hotKeyReplicas_ != nullptr) {
+    return findWithHotKeyReplicas(key);
+  }
+  return findWithStripedRefcount(key);
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::findWithHotKeyReplicas(typename Item::Key key) {
+  const auto hash = HashedKey{key}.keyHash();
+  if (!hotKeyReplicas_->bumpHash(hash)) {
+    return findImpl(key, AccessMode::kRead);
+  }
+
+  if (auto replica = findHotKeyReplica(key, hash)) {
+    return replica;
+  }
+
+  // the generation must be read before the lookup, so that a change of the
+  // key racing with it leaves the replica stale.
+  const auto generation = hotKeyReplicas_->getGeneration(hash);
+  auto handle = findImpl(key, AccessMode::kRead);
+  // items looked up from nvm are replicated by the following lookups, once
+  // they are in dram.
+  if (handle && handle.isReady() && handle->isAccessible()) {
+    replicateHotKey(*handle, hash, generation);
+  }
+  return handle;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::findHotKeyReplica(typename Item::Key key,
+                                              uint64_t hash) {
+  ReadHandle handle = hotKeyReplicas_->find(key, hash, [this](Item* replica) {
+    auto replicaHandle = acquire(replica);
+    // the replica is not in the cache, so releasing it must not run the
+    // remove callback whoever releases it last.
+    replicaHandle.markNascent();
+    return replicaHandle;
+  });
+  if (!handle) {
+    return handle;
+  }
+
+  stats_.numCacheGets.inc();
+  stats_.numHotKeyReplicaHits.inc();
+  const auto allocInfo = allocator_->getAllocInfo(handle->getMemory());
+  (*stats_.cacheHits)[allocInfo.poolId][allocInfo.classId].inc();
+  if (auto eventTracker = getEventTracker()) {
+    eventTracker->record(AllocatorApiEvent::FIND, key,
+                         AllocatorApiResult::FOUND,
+                         folly::Optional<uint32_t>(handle->getSize()),
+                         handle->getConfiguredTTL().count());
+  }
+  return handle;
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::replicateHotKey(const Item& item,
+                                                 uint64_t hash,
+                                                 uint64_t generation) {
+  if (item.isChainedItem() || item.hasChainedItem() ||
+      item.getSize() > hotKeyReplicas_->getConfig().maxValueSize) {
+    return;
+  }
+
+  // replicas are not allocations of the user, keep them out of the
+  // allocation size tuning and the miss ratio curves.
+  const auto pid = allocator_->getAllocInfo(item.getMemory()).poolId;
+  auto replica =
+      allocateInternal(pid, item.getKey(), item.getSize(),
+                       item.getCreationTime(), item.getExpiryTime(),
+                       /* fromBgThread */ true);
+  if (!replica) {
+    return;
+  }
+  std::memcpy(replica->getMemory(), item.getMemory(), item.getSize());
+  stats_.numHotKeyReplicasCreated.inc();
+
+  // the handles held by the replicas do not belong to any thread
+  adjustHandleCountForThread_private(-1);
+  const Item* replicaItem = replica.get();
+  auto displaced = hotKeyReplicas_->add(hash, generation, std::move(replica));
+  if (displaced) {
+    adjustHandleCountForThread_private(1);
+  }
+
+  // a replica allocated before its slab was marked for release, but added
+  // after the release dropped the replicas of the class, would hold the
+  // release up. Both sides take the shard lock, so either the release saw
+  // it or this sees the mark.
+  if (UNLIKELY(allocator_->isMarkedForRelease(replicaItem))) {
+    auto dropped = hotKeyReplicas_->clear(
+        [replicaItem](const Item& it) { return &it == replicaItem; });
+    adjustHandleCountForThread_private(static_cast<int64_t>(dropped.size()));
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::dropHotKeyReplicas() {
+  if (!hotKeyReplicas_) {
+    return;
+  }
+
+  auto replicas = hotKeyReplicas_->clear();
+  adjustHandleCountForThread_private(static_cast<int64_t>(replicas.size()));
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::deferRelease(Item& it, bool nascent) {
+  // nascent and chained items run neither the callback nor the destructor,
+  // so there is nothing worth deferring
+  if (LIKELY(deferredReleaser_ == nullptr) || nascent ||
+      it.isChainedItem() || (!config_.removeCb && !config_.itemDestructor)) {
+    return false;
+  }
+  return deferredReleaser_->defer(it, RemoveContext::kNormal);
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::findWithStripedRefcount(typename Item::Key key) {
+  const auto hash = HashedKey{key}.keyHash();
+  if (!stripedRefcounts_->bumpHash(hash)) {
+    return findImpl(key, AccessMode::kRead);
+  }
+
+  if (auto handle = findStriped(key, hash)) {
+    return handle;
+  }
+
+  auto handle = findImpl(key, AccessMode::kRead);
+  // items looked up from nvm get a striped refcount on the following
+  // lookups, once they are in dram.
+  if (handle && handle.isReady() && handle->isAccessible()) {
+    stripeRefcount(*handle, hash);
+  }
+  return handle;
+}
+
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::ReadHandle
+CacheAllocator<CacheTrait>::findStriped(typename Item::Key key,
+                                        uint64_t hash) {
+  detail::StripedRef ref;
+  Item* it = stripedRefcounts_->acquire(key, hash, ref);
+  if (it == nullptr) {
+    return ReadHandle{};
+  }
+
+  ++handleCount_.tlStats();
+  ReadHandle handle{it, *this};
+  handle.setStripedRef(ref);
+  // removed or expired, but not folded back yet. The regular lookup takes
+  // care of it.
+  if (!it->isAccessible() || it->isExpired()) {
+    return ReadHandle{};
+  }
+
+  stats_.numCacheGets.inc();
+  stats_.numStripedRefcountHits.inc();
+  const auto allocInfo = allocator_->getAllocInfo(it->getMemory());
+  (*stats_.cacheHits)[allocInfo.poolId][allocInfo.classId].inc();
+  if (auto eventTracker = getEventTracker()) {
+    eventTracker->record(AllocatorApiEvent::FIND, key,
+                         AllocatorApiResult::FOUND,
+                         folly::Optional<uint32_t>(it->getSize()),
+                         it->getConfiguredTTL().count());
+  }
+  return handle;
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::stripeRefcount(Item& item, uint64_t hash) {
+  // the handle of the caller keeps the item from being moved or evicted, so
+  // this can not fail
+  const auto res = item.incRef();
+  XDCHECK(res == RefcountWithFlags::IncResult::kIncOk);
+
+  Item* unpin = stripedRefcounts_->add(hash, item);
+  if (unpin != &item) {
+    stats_.numStripedRefcountsCreated.inc();
+  }
+  unpinStripedItem(unpin);
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::releaseStripedRef(Item* it,
+                                                   detail::StripedRef ref,
+                                                   bool keepItemRef) {
+  if (keepItemRef) {
+    // the stripe, or the item itself once the refcount was folded back,
+    // still holds the reference, so the item can not be moved or evicted
+    const auto res = it->incRef();
+    XDCHECK(res == RefcountWithFlags::IncResult::kIncOk);
+  }
+
+  if (stripedRefcounts_->release(ref)) {
+    if (!keepItemRef) {
+      --handleCount_.tlStats();
+    }
+    return;
+  }
+
+  // the refcount was folded back, which moved the reference to the item
+  if (keepItemRef) {
+    it->decRef();
+    return;
+  }
+  release(it, /* isNascent */ false);
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::unpinStripedItem(Item* item) {
+  if (item == nullptr) {
+    return;
+  }
+
+  // the pin is not the reference of a handle, so it is not counted in the
+  // handle count
+  const auto ref = item->decRef();
+  if (UNLIKELY(ref == 0)) {
+    const auto res = releaseBackToAllocator(*item, RemoveContext::kNormal,
+                                            /* isNascent */ false);
+    XDCHECK(res == ReleaseRes::kReleased);
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::foldAllStripedRefcounts() {
+  if (!stripedRefcounts_) {
+    return;
+  }
+
+  for (auto* item : stripedRefcounts_->foldAll()) {
+    unpinStripedItem(item);
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::releaseHeldAllocs(PoolId pid, ClassId cid) {
+  const auto isHeld = [this, pid, cid](const Item& item) {
+    if (item.hasChainedItem()) {
+      return true;
+    }
+    const auto allocInfo = allocator_->getAllocInfo(item.getMemory());
+    return allocInfo.poolId == pid && allocInfo.classId == cid;
+  };
+
+  if (hotKeyReplicas_) {
+    auto replicas = hotKeyReplicas_->clear(isHeld);
+    adjustHandleCountForThread_private(static_cast<int64_t>(replicas.size()));
+  }
+  if (stripedRefcounts_) {
+    for (auto* item : stripedRefcounts_->foldAll(isHeld)) {
+      unpinStripedItem(item);
+    }
+  }
+  if (deferredReleaser_) {
+    deferredReleaser_->flush(isHeld);
+  }
 }
 
 template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::ReadHandle
-CacheAllocator<CacheTrait>::findFast(typename Item::Key key) {
-  return findFastImpl(key, AccessMode::kRead);
+folly::SemiFuture<typename CacheAllocator<CacheTrait>::ReadHandle>
+CacheAllocator<CacheTrait>::findAsync(typename Item::Key key) {
+  return find(key).toSemiFuture();
 }
 
 template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::WriteHandle
-CacheAllocator<CacheTrait>::findFastToWrite(typename Item::Key key) {
-  auto handle = findFastImpl(key, AccessMode::kWrite);
-  if (handle == nullptr) {
-    return nullptr;
-  }
+std::vector<typename CacheAllocator<CacheTrait>::ReadHandle>
+CacheAllocator<CacheTrait>::findBatch(folly::Range<const Key*> keys) {
+  auto found = accessContainer_->findBatch(keys);
+  XDCHECK_EQ(found.size(), keys.size());
 
-  invalidateNvm(*handle);
-  return handle;
-}
+  std::vector<ReadHandle> handles(keys.size());
+  std::vector<size_t> missIdx;
+  std::vector<HashedKey> missKeys;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto handle = processLookupResult(keys[i], std::move(found[i]),
+                                      AllocatorApiEvent::FIND);
+    if (handle) {
+      markUseful(handle, AccessMode::kRead);
+      handles[i] = std::move(handle);
+      continue;
+    }
 
-template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::WriteHandle
-CacheAllocator<CacheTrait>::findImpl(typename Item::Key key, AccessMode mode) {
-  auto handle = findInternalWithExpiration(key, AllocatorApiEvent::FIND);
-  if (handle) {
-    markUseful(handle, mode);
-    return handle;
+    if (!hasNvmCache()) {
+      handles[i] = std::move(handle);
+      continue;
+    }
+    missIdx.push_back(i);
+    missKeys.push_back(HashedKey{keys[i]});
   }
 
-  if (!nvmCache_) {
-    return handle;
+  if (!missKeys.empty()) {
+    // same as find(), the handles become async on a dram miss. The misses
+    // are looked up in nvmcache together.
+    auto nvmHandles = nvmCache_->findBatch(folly::range(missKeys));
+    XDCHECK_EQ(nvmHandles.size(), missKeys.size());
+    for (size_t i = 0; i < missIdx.size(); ++i) {
+      handles[missIdx[i]] = std::move(nvmHandles[i]);
+    }
   }
-
-  // Hybrid-cache's dram miss-path. Handle becomes async once we look up from
-  // nvm-cache. Naively accessing the memory directly after this can be slow.
-  // We also don't need to call `markUseful()` as if we have a hit, we will
-  // have promoted this item into DRAM cache at the front of eviction queue.
-  return nvmCache_->find(HashedKey{key});
+  return handles;
 }
 
 template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::WriteHandle
-CacheAllocator<CacheTrait>::findToWrite(typename Item::Key key) {
-  auto handle = findImpl(key, AccessMode::kWrite);
-  if (handle == nullptr) {
-    return nullptr;
+size_t CacheAllocator<CacheTrait>::prefetch(folly::Range<const Key*> keys) {
+  if (!hasNvmCache()) {
+    return 0;
   }
-  invalidateNvm(*handle);
-  return handle;
-}
 
-template <typename CacheTrait>
-typename CacheAllocator<CacheTrait>::ReadHandle
-CacheAllocator<CacheTrait>::find(typename Item::Key key) {
-  return findImpl(key, AccessMode::kRead);
+  std::vector<HashedKey> hks;
+  hks.reserve(keys.size());
+  for (const auto& key : keys) {
+    hks.emplace_back(key);
+  }
+  return nvmCache_->prefetch(folly::range(hks));
 }
 
 template <typename CacheTrait>
@@ -4272,6 +6078,12 @@ void CacheAllocator<CacheTrait>::markUseful(const ReadHandle& handle,
   auto& item = *(handle.getInternal());
   bool recorded = recordAccessInMMContainer(item, mode);
 
+  if (UNLIKELY(config_.missRatioCurvesEnabled())) {
+    const auto pid = allocator_->getAllocInfo(&item).poolId;
+    missRatioCurves_[pid]->recordAccess(folly::Hash()(item.getKey()),
+                                        item.getTotalSize());
+  }
+
   // if parent is not recorded, skip children as well when the config is set
   if (LIKELY(!item.hasChainedItem() ||
              (!recorded && config_.isSkipPromoteChildrenWhenParentFailed()))) {
@@ -4295,7 +6107,13 @@ bool CacheAllocator<CacheTrait>::recordAccessInMMContainer(Item& item,
     ring_->trackItem(reinterpret_cast<uintptr_t>(&item), item.getSize());
   }
 
-  auto& mmContainer = getMMContainer(allocInfo.poolId, allocInfo.classId);
+  if (UNLIKELY(memoryTiers_ != nullptr) && !item.isChainedItem() &&
+      getUpperTierPool(allocInfo.poolId) != Slab::kInvalidPoolId) {
+    recordLowerTierAccess(item, allocInfo.poolId, allocInfo.classId);
+  }
+
+  auto& mmContainer = getMMContainer(allocInfo.poolId, allocInfo.classId,
+                                     getMMContainerShard(item));
   return mmContainer.recordAccess(item, mode);
 }
 
@@ -4311,7 +6129,7 @@ uint32_t CacheAllocator<CacheTrait>::getUsableSize(const Item& item) const {
 template <typename CacheTrait>
 typename CacheAllocator<CacheTrait>::SampleItem
 CacheAllocator<CacheTrait>::getSampleItem() {
-  size_t nvmCacheSize = nvmCache_ ? nvmCache_->getUsableSize() : 0;
+  size_t nvmCacheSize = hasNvmCache() ? nvmCache_->getUsableSize() : 0;
   size_t ramCacheSize = allocator_->getMemorySizeInclAdvised();
 
   bool fromNvm =
@@ -4365,13 +6183,12 @@ std::vector<std::string> CacheAllocator<CacheTrait>::dumpEvictionIterator(
 
   std::vector<std::string> content;
 
-  auto& mm = *mmContainers_[pid][cid];
-  auto evictItr = mm.getEvictionIterator();
-  size_t i = 0;
-  while (evictItr && i < numItems) {
-    content.push_back(evictItr->toString());
-    ++evictItr;
-    ++i;
+  for (auto& mm : mmContainers_[pid][cid]) {
+    auto evictItr = mm->getEvictionIterator();
+    while (evictItr && content.size() < numItems) {
+      content.push_back(evictItr->toString());
+      ++evictItr;
+    }
   }
 
   return content;
@@ -4384,6 +6201,13 @@ folly::IOBuf CacheAllocator<CacheTrait>::convertToIOBufT(Handle& handle) {
     throw std::invalid_argument("null item handle for converting to IOBUf");
   }
 
+  if (isLargeItem(*handle)) {
+    // the payload of the parent is the chunk index, not part of the value
+    folly::IOBuf iobuf{std::move(*viewAsLargeItemT<Handle>(handle).toIOBuf())};
+    handle.reset();
+    return iobuf;
+  }
+
   Item* item = handle.getInternal();
   const uint32_t dataOffset = item->getOffsetForMemory();
 
@@ -4549,10 +6373,33 @@ PoolId CacheAllocator<CacheTrait>::addPool(
     std::shared_ptr<RebalanceStrategy> resizeStrategy,
     bool ensureProvisionable) {
   std::unique_lock w(poolsResizeAndRebalanceLock_);
-  auto pid = allocator_->addPool(name, size, allocSizes, ensureProvisionable);
-  createMMContainers(pid, std::move(config));
-  setRebalanceStrategy(pid, std::move(rebalanceStrategy));
-  setResizeStrategy(pid, std::move(resizeStrategy));
+  // with memory tiers, the pool is split by the tier ratios between the two
+  // tiers, and its lower tier part is added as a separate pool.
+  size_t lowerTierSize = 0;
+  if (memoryTiers_) {
+    const auto& tiers = config_.memoryTierConfigs;
+    lowerTierSize = tiers[1].calculateTierSize(
+        size, tiers[0].getRatio() + tiers[1].getRatio());
+  }
+
+  auto pid = allocator_->addPool(name, size - lowerTierSize, allocSizes,
+                                 ensureProvisionable);
+  applyPoolNumaPolicy(pid);
+  createMMContainers(pid, config);
+  setRebalanceStrategy(pid, rebalanceStrategy);
+  setResizeStrategy(pid, resizeStrategy);
+
+  if (memoryTiers_) {
+    auto lowerPid = allocator_->addPool(
+        folly::sformat("{}{}", name, MemoryTierState::kLowerTierPoolSuffix),
+        lowerTierSize, allocSizes, ensureProvisionable);
+    memoryTiers_->lowerTierPools[pid] = lowerPid;
+    memoryTiers_->upperTierPools[lowerPid] = pid;
+    applyPoolNumaPolicy(lowerPid);
+    createMMContainers(lowerPid, std::move(config));
+    setRebalanceStrategy(lowerPid, std::move(rebalanceStrategy));
+    setResizeStrategy(lowerPid, std::move(resizeStrategy));
+  }
 
   if (backgroundEvictor_.size()) {
     auto memoryAssignments =
@@ -4573,6 +6420,24 @@ PoolId CacheAllocator<CacheTrait>::addPool(
   return pid;
 }
 
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::applyPoolNumaPolicy(PoolId pid) {
+  auto it = config_.poolNumaPolicies.find(allocator_->getPoolName(pid));
+  if (it != config_.poolNumaPolicies.end()) {
+    allocator_->setPoolNumaPolicy(pid, it->second);
+    return;
+  }
+
+  if (memoryTiers_) {
+    const bool isLowerTier = getUpperTierPool(pid) != Slab::kInvalidPoolId;
+    const auto& nodes =
+        config_.memoryTierConfigs[isLowerTier ? 1 : 0].getMemBind();
+    if (!nodes.empty()) {
+      allocator_->setPoolNumaPolicy(pid, NumaPolicy::bind(nodes));
+    }
+  }
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::provisionPool(
     PoolId poolId, const std::vector<uint32_t>& slabsDistribution) {
@@ -4622,8 +6487,10 @@ void CacheAllocator<CacheTrait>::overridePoolConfig(PoolId pid,
             ? pool.getAllocationClass(static_cast<ClassId>(cid))
                   .getAllocsPerSlab()
             : 0);
-    DCHECK_NOTNULL(mmContainers_[pid][cid].get());
-    mmContainers_[pid][cid]->setConfig(mmConfig);
+    DCHECK(!mmContainers_[pid][cid].empty());
+    for (auto& mmContainer : mmContainers_[pid][cid]) {
+      mmContainer->setConfig(mmConfig);
+    }
   }
 }
 
@@ -4637,7 +6504,11 @@ void CacheAllocator<CacheTrait>::createMMContainers(const PoolId pid,
             ? pool.getAllocationClass(static_cast<ClassId>(cid))
                   .getAllocsPerSlab()
             : 0);
-    mmContainers_[pid][cid].reset(new MMContainer(config, compressor_));
+    auto& shards = mmContainers_[pid][cid];
+    shards.clear();
+    for (size_t i = 0; i < config_.numMMContainerShards; i++) {
+      shards.emplace_back(new MMContainer(config, compressor_));
+    }
   }
 }
 
@@ -4747,7 +6618,7 @@ PoolStats CacheAllocator<CacheTrait>::getPoolStats(PoolId poolId) const {
   if (!isCompactCache) {
     for (const ClassId cid : classIds) {
       uint64_t classHits = (*stats_.cacheHits)[poolId][cid].get();
-      XDCHECK(mmContainers_[poolId][cid],
+      XDCHECK(!mmContainers_[poolId][cid].empty(),
               folly::sformat("Pid {}, Cid {} not initialized.", poolId, cid));
       cacheStats.insert(
           {cid,
@@ -4757,7 +6628,7 @@ PoolStats CacheAllocator<CacheTrait>::getPoolStats(PoolId poolId) const {
             (*stats_.fragmentationSize)[poolId][cid].get(), classHits,
             (*stats_.chainedItemEvictions)[poolId][cid].get(),
             (*stats_.regularItemEvictions)[poolId][cid].get(),
-            mmContainers_[poolId][cid]->getStats()}
+            getMMContainerStat(poolId, cid)}
 
           });
       totalHits += classHits;
@@ -4778,6 +6649,60 @@ PoolStats CacheAllocator<CacheTrait>::getPoolStats(PoolId poolId) const {
   return ret;
 }
 
+template <typename CacheTrait>
+AllocSizeRecommendation CacheAllocator<CacheTrait>::getAllocSizeRecommendation(
+    PoolId pid) const {
+  if (pid < 0 || static_cast<size_t>(pid) >= MemoryPoolManager::kMaxPools) {
+    throw std::invalid_argument(
+        folly::sformat("Invalid pool id {}", static_cast<int>(pid)));
+  }
+  std::lock_guard<std::mutex> l(allocSizeRecommendationsLock_);
+  return allocSizeRecommendations_[pid];
+}
+
+template <typename CacheTrait>
+MissRatioCurve CacheAllocator<CacheTrait>::getPoolMissRatioCurve(
+    PoolId pid) const {
+  if (pid < 0 || static_cast<size_t>(pid) >= MemoryPoolManager::kMaxPools) {
+    throw std::invalid_argument(
+        folly::sformat("Invalid pool id {}", static_cast<int>(pid)));
+  }
+  const auto& curve = missRatioCurves_[pid];
+  return curve ? curve->getCurve() : MissRatioCurve{};
+}
+
+template <typename CacheTrait>
+std::shared_ptr<const CacheStatsSnapshot>
+CacheAllocator<CacheTrait>::getStatsSnapshot() const {
+  std::lock_guard<std::mutex> l(workersMutex_);
+  return statsSnapshotter_ ? statsSnapshotter_->getSnapshot() : nullptr;
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::updateAllocSizeRecommendations() {
+  for (const auto pid : getRegularPoolIds()) {
+    auto& tuner = allocSizeTuners_[pid];
+    if (!tuner) {
+      continue;
+    }
+    const auto& allocSizes = allocator_->getPool(pid).getAllocSizes();
+    const std::set<uint32_t> currentAllocSizes{allocSizes.begin(),
+                                               allocSizes.end()};
+    const size_t maxNumAllocSizes = config_.allocSizeTuningMaxClasses
+                                        ? config_.allocSizeTuningMaxClasses
+                                        : currentAllocSizes.size();
+    auto recommendation = tuner->recommend(currentAllocSizes, maxNumAllocSizes,
+                                           Slab::kMinAllocSize);
+    // older samples weigh less in the next round
+    tuner->decay();
+    if (recommendation.numSamples == 0) {
+      continue;
+    }
+    std::lock_guard<std::mutex> l(allocSizeRecommendationsLock_);
+    allocSizeRecommendations_[pid] = std::move(recommendation);
+  }
+}
+
 template <typename CacheTrait>
 PoolEvictionAgeStats CacheAllocator<CacheTrait>::getPoolEvictionAgeStats(
     PoolId pid, unsigned int slabProjectionLength) const {
@@ -4788,12 +6713,32 @@ PoolEvictionAgeStats CacheAllocator<CacheTrait>::getPoolEvictionAgeStats(
   const auto& pool = allocator_->getPool(pid);
   const auto& allocSizes = pool.getAllocSizes();
   for (ClassId cid = 0; cid < static_cast<ClassId>(allocSizes.size()); ++cid) {
-    auto& mmContainer = getMMContainer(pid, cid);
     const auto numItemsPerSlab =
         allocator_->getPool(pid).getAllocationClass(cid).getAllocsPerSlab();
     const auto projectionLength = numItemsPerSlab * slabProjectionLength;
-    stats.classEvictionAgeStats[cid] =
-        mmContainer.getEvictionAgeStat(projectionLength);
+    const auto& shards = mmContainers_[pid][cid];
+    // evictions are spread evenly across the shards, so each shard gives up
+    // its share of the projected elements. The class is as old as its oldest
+    // shard.
+    const auto shardProjectionLength = projectionLength / shards.size();
+    auto& classStat = stats.classEvictionAgeStats[cid];
+    for (const auto& mmContainer : shards) {
+      const auto shardStat =
+          mmContainer->getEvictionAgeStat(shardProjectionLength);
+      auto merge = [](EvictionStatPerType& to,
+                      const EvictionStatPerType& from) {
+        to.oldestElementAge = std::max(to.oldestElementAge,
+                                       from.oldestElementAge);
+        to.size += from.size;
+        to.projectedAge = std::max(to.projectedAge, from.projectedAge);
+      };
+      merge(classStat.warmQueueStat, shardStat.warmQueueStat);
+      merge(classStat.hotQueueStat, shardStat.hotQueueStat);
+      merge(classStat.coldQueueStat, shardStat.coldQueueStat);
+    }
+    if (evictionAgeSamplers_[pid]) {
+      classStat.sampledStat = evictionAgeSamplers_[pid]->getStat(cid);
+    }
   }
 
   return stats;
@@ -4832,17 +6777,37 @@ void CacheAllocator<CacheTrait>::releaseSlab(PoolId pid,
     stats_.numReleasedForAdvise.inc();
     break;
   }
+  CACHELIB_TRACEPOINT(slab_release, pid, victim, receiver,
+                      static_cast<int>(mode));
 
+  // allocations stashed by eviction batching do not hold an item and can
+  // not be moved or evicted, so give them back before releasing the slab.
+  if (victim != Slab::kInvalidClassId) {
+    flushEvictedAllocs(pid, victim);
+  }
+  // lock-free lookups may still dereference items removed from the access
+  // containers, so the slab's memory is reused only once they are done.
+  const auto waitForReaders = [this]() {
+    accessContainer_->synchronizeOptimisticReads();
+    chainedItemAccessContainer_->synchronizeOptimisticReads();
+  };
   try {
     auto releaseContext = allocator_->startSlabRelease(
         pid, victim, receiver, mode, hint,
-        [this]() -> bool { return shutDownInProgress_; });
+        [this]() -> bool { return shutDownInProgress_; }, waitForReaders);
 
     // No work needed if the slab is already released
     if (releaseContext.isReleased()) {
       return;
     }
 
+    // neither can the hot key replicas, which are made again on demand, the
+    // items pinned by striped refcounts, nor the items waiting to be
+    // released. Only those of the class are given back, once the slab is
+    // marked so that no new allocation lands in it.
+    releaseHeldAllocs(releaseContext.getPoolId(),
+                      releaseContext.getClassId());
+
     releaseSlabImpl(releaseContext);
     if (!allocator_->allAllocsFreed(releaseContext)) {
       throw std::runtime_error(
@@ -4851,6 +6816,13 @@ void CacheAllocator<CacheTrait>::releaseSlab(PoolId pid,
                          releaseContext.getClassId()));
     }
 
+    // the slab's memory is about to be handed to a different allocation
+    // class, so promotions still buffered for its items must be discarded.
+    for (auto& mmContainer : mmContainers_[releaseContext.getPoolId()]
+                                          [releaseContext.getClassId()]) {
+      mmContainer->invalidateBufferedAccesses();
+    }
+    waitForReaders();
     allocator_->completeSlabRelease(releaseContext);
   } catch (const exception::SlabReleaseAborted& e) {
     stats_.numAbortedSlabReleases.inc();
@@ -4877,7 +6849,8 @@ SlabReleaseStats CacheAllocator<CacheTrait>::getSlabReleaseStats()
                           stats_.numMoveSuccesses.get(),
                           stats_.numEvictionAttempts.get(),
                           stats_.numEvictionSuccesses.get(),
-                          stats_.numSlabReleaseStuck.get()};
+                          stats_.numSlabReleaseStuck.get(),
+                          stats_.numMoveBatches.get()};
 }
 
 template <typename CacheTrait>
@@ -4908,9 +6881,21 @@ void CacheAllocator<CacheTrait>::releaseSlabImpl(
   //  2. Under AC lock, acquire ownership of this active allocation
   //  3. If 2 is successful, Move or Evict
   //  4. Move on to the next item if current item is freed
+  const size_t batchSize =
+      config_.moveCb ? config_.slabReleaseMoveBatchSize : 1;
+  std::vector<Item*> batch;
+  batch.reserve(batchSize);
   for (auto alloc : releaseContext.getActiveAllocations()) {
     Item& item = *static_cast<Item*>(alloc);
 
+    // Marking a chained item marks its parent, which may be one of the
+    // batch, so the batch goes first. No allocation is handed out from the
+    // slab being released, so the chained flag can not change under us
+    // unless the item is freed.
+    if (!batch.empty() && item.isChainedItem()) {
+      moveBatchForSlabRelease(batch);
+    }
+
     // Need to mark an item for release before proceeding
     // If we can't mark as moving, it means the item is already freed
     const bool isAlreadyFreed =
@@ -4919,6 +6904,14 @@ void CacheAllocator<CacheTrait>::releaseSlabImpl(
       continue;
     }
 
+    if (batchSize > 1 && !item.isChainedItem()) {
+      batch.push_back(&item);
+      if (batch.size() == batchSize) {
+        moveBatchForSlabRelease(batch);
+      }
+      continue;
+    }
+
     // Try to move this item and make sure we can free the memory
     if (!moveForSlabRelease(item)) {
       // If moving fails, evict it
@@ -4926,6 +6919,38 @@ void CacheAllocator<CacheTrait>::releaseSlabImpl(
     }
     XDCHECK(allocator_->isAllocFreed(releaseContext, alloc));
   }
+  if (!batch.empty()) {
+    moveBatchForSlabRelease(batch);
+  }
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::moveBatchForSlabRelease(
+    std::vector<Item*>& batch) {
+  stats_.numMoveBatches.inc();
+
+  // allocate every destination first, back to back from the same class
+  std::vector<std::pair<uint32_t, size_t>> order;
+  std::vector<WriteHandle> newItemHdls;
+  order.reserve(batch.size());
+  newItemHdls.reserve(batch.size());
+  for (size_t i = 0; i < batch.size(); i++) {
+    XDCHECK(batch[i]->isMoving());
+    XDCHECK(!batch[i]->isChainedItem());
+    newItemHdls.push_back(allocateNewItemForOldItem(*batch[i]));
+    order.emplace_back(accessContainer_->getLockIdx(batch[i]->getKey()), i);
+  }
+
+  // then move the items sharing a lock one after the other
+  std::sort(order.begin(), order.end());
+  for (const auto& entry : order) {
+    const auto i = entry.second;
+    Item& item = *batch[i];
+    if (!moveForSlabRelease(item, std::move(newItemHdls[i]))) {
+      evictForSlabRelease(item);
+    }
+  }
+  batch.clear();
 }
 
 template <typename CacheTrait>
@@ -4952,7 +6977,12 @@ bool CacheAllocator<CacheTrait>::moveForSlabRelease(Item& oldItem) {
   if (!config_.moveCb) {
     return false;
   }
+  return moveForSlabRelease(oldItem, allocateNewItemForOldItem(oldItem));
+}
 
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::moveForSlabRelease(Item& oldItem,
+                                                    WriteHandle newItemHdl) {
   Item* parentItem;
   bool chainedItem = oldItem.isChainedItem();
 
@@ -4966,7 +6996,6 @@ bool CacheAllocator<CacheTrait>::moveForSlabRelease(Item& oldItem) {
   } else {
     XDCHECK(oldItem.isMoving());
   }
-  WriteHandle newItemHdl = allocateNewItemForOldItem(oldItem);
 
   // if we have a valid handle, try to move, if not, we attemp to evict.
   if (newItemHdl) {
@@ -5058,8 +7087,9 @@ CacheAllocator<CacheTrait>::allocateNewItemForOldItem(const Item& oldItem) {
   }
 
   XDCHECK_EQ(newItemHdl->getSize(), oldItem.getSize());
-  XDCHECK_EQ(reinterpret_cast<uintptr_t>(&getMMContainer(oldItem)),
-             reinterpret_cast<uintptr_t>(&getMMContainer(*newItemHdl)));
+  // the new item may land in a different shard of the same class
+  XDCHECK_EQ(allocInfo.classId,
+             allocator_->getAllocInfo(newItemHdl.getInternal()).classId);
 
   return newItemHdl;
 }
@@ -5095,6 +7125,8 @@ void CacheAllocator<CacheTrait>::evictForSlabRelease(Item& item) {
   } else {
     (*stats_.regularItemEvictions)[allocInfo.poolId][allocInfo.classId].inc();
   }
+  CACHELIB_TRACEPOINT(dram_evict, allocInfo.poolId, allocInfo.classId,
+                      evicted->getKey().data(), evicted->getKey().size());
 
   stats_.numEvictionSuccesses.inc();
 
@@ -5116,6 +7148,8 @@ bool CacheAllocator<CacheTrait>::removeIfExpired(const ReadHandle& handle) {
       accessContainer_->removeIf(*(handle.getInternal()), itemExpiryPredicate);
   if (removedHandle) {
     removeFromMMContainer(*(handle.getInternal()));
+    invalidateHotKeyReplicas(handle->getKey());
+    foldStripedRefcount(handle->getKey());
     return true;
   }
 
@@ -5138,12 +7172,19 @@ bool CacheAllocator<CacheTrait>::markMovingForSlabRelease(
   // At first, we assume this item was already freed
   bool itemFreed = true;
   bool markedMoving = false;
-  const auto fn = [this, &markedMoving, &itemFreed](void* memory) {
+  // whether the item was in its mmContainer, and the key hash of the item
+  // marked moving, if it could be pinned by a striped refcount
+  bool inMMContainer = false;
+  folly::Optional<uint64_t> pinnedKeyHash;
+  const auto fn = [this, &markedMoving, &itemFreed, &inMMContainer,
+                   &pinnedKeyHash](void* memory) {
     // Since this callback is executed, the item is not yet freed
     itemFreed = false;
+    inMMContainer = false;
+    pinnedKeyHash.reset();
     Item* item = static_cast<Item*>(memory);
     auto& mmContainer = getMMContainer(*item);
-    mmContainer.withContainerLock([this, &mmContainer, &item, &markedMoving]() {
+    mmContainer.withContainerLock([&]() {
       // we rely on the mmContainer lock to safely check that the item is
       // currently in the mmContainer (no other threads are currently
       // allocating this item). This is needed to sync on the case where a
@@ -5154,11 +7195,14 @@ bool CacheAllocator<CacheTrait>::markMovingForSlabRelease(
       if (!item->isInMMContainer()) {
         return;
       }
+      inMMContainer = true;
 
       XDCHECK_EQ(&getMMContainer(*item), &mmContainer);
       if (!item->isChainedItem()) {
         if (item->markMoving()) {
           markedMoving = true;
+        } else if (stripedRefcounts_) {
+          pinnedKeyHash = HashedKey{item->getKey()}.keyHash();
         }
         return;
       }
@@ -5174,6 +7218,8 @@ bool CacheAllocator<CacheTrait>::markMovingForSlabRelease(
       }
       if (parentItem->markMoving()) {
         markedMoving = true;
+      } else if (stripedRefcounts_) {
+        pinnedKeyHash = HashedKey{parentItem->getKey()}.keyHash();
       }
     });
   };
@@ -5194,6 +7240,20 @@ bool CacheAllocator<CacheTrait>::markMovingForSlabRelease(
     // when checking with the AllocationClass
     itemFreed = true;
 
+    // the allocation might have been stashed by eviction batching after the
+    // slab release started, or the item might have been pinned by a striped
+    // refcount since, which is folded back for this key only. An item out of
+    // its mmContainer might be waiting to be released, so the deferred
+    // releaser is woken up for it. Replicas added once the slab was marked
+    // drop themselves, see replicateHotKey().
+    flushEvictedAllocs(ctx.getPoolId(), ctx.getClassId());
+    if (pinnedKeyHash) {
+      unpinStripedItem(stripedRefcounts_->fold(*pinnedKeyHash));
+    }
+    if (!inMMContainer && deferredReleaser_) {
+      deferredReleaser_->wakeUp();
+    }
+
     if (shutDownInProgress_) {
       allocator_->abortSlabRelease(ctx);
       throw exception::SlabReleaseAborted(
@@ -5225,6 +7285,7 @@ CCacheT* CacheAllocator<CacheTrait>::addCompactCache(folly::StringPiece name,
 
   std::unique_lock lock(compactCachePoolsLock_);
   auto poolId = allocator_->addPool(name, size, {Slab::kSize});
+  applyPoolNumaPolicy(poolId);
   isCompactCachePool_[poolId] = true;
 
   auto ptr = std::make_unique<CCacheT>(
@@ -5307,6 +7368,12 @@ folly::IOBufQueue CacheAllocator<CacheTrait>::saveStateToIOBuf() {
         "There are still slabs being released at the moment");
   }
 
+  // stashed allocations and replicas do not hold an item and would leak
+  // across a restart, and so would the pins of striped refcounts
+  flushAllEvictedAllocs();
+  dropHotKeyReplicas();
+  foldAllStripedRefcounts();
+
   *metadata_.allocatorVersion() = kCachelibVersion;
   *metadata_.ramFormatVersion() = kCacheRamFormatVersion;
   *metadata_.cacheCreationTime() = static_cast<int64_t>(cacheCreationTime_);
@@ -5337,8 +7404,11 @@ folly::IOBufQueue CacheAllocator<CacheTrait>::saveStateToIOBuf() {
     MMSerializationTypeContainer state;
     for (unsigned int i = 0; i < mmContainers.size(); ++i) {
       for (unsigned int j = 0; j < mmContainers[i].size(); ++j) {
-        if (mmContainers[i][j]) {
-          state.pools_ref()[i][j] = mmContainers[i][j]->saveState();
+        // shards beyond the first are keyed past the range of class ids so
+        // that an unsharded cache keeps its format.
+        for (unsigned int k = 0; k < mmContainers[i][j].size(); ++k) {
+          state.pools_ref()[i][j + k * MemoryAllocator::kMaxClasses] =
+              mmContainers[i][j][k]->saveState();
         }
       }
     }
@@ -5368,13 +7438,34 @@ folly::IOBufQueue CacheAllocator<CacheTrait>::saveStateToIOBuf() {
 
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::stopWorkers(std::chrono::seconds timeout) {
+  using StopFn = bool (CacheAllocator::*)(std::chrono::seconds);
+  const StopFn stops[] = {&CacheAllocator::stopPoolRebalancer,
+                          &CacheAllocator::stopPoolResizer,
+                          &CacheAllocator::stopMemMonitor,
+                          &CacheAllocator::stopReaper,
+                          &CacheAllocator::stopAllocSizeOptimizer,
+                          &CacheAllocator::stopAccessContainerResizer,
+                          &CacheAllocator::stopStatsSnapshotter,
+                          &CacheAllocator::stopDeferredReleaser,
+                          &CacheAllocator::stopBackgroundEvictor,
+                          &CacheAllocator::stopBackgroundPromoter};
   bool success = true;
-  success &= stopPoolRebalancer(timeout);
-  success &= stopPoolResizer(timeout);
-  success &= stopMemMonitor(timeout);
-  success &= stopReaper(timeout);
-  success &= stopBackgroundEvictor(timeout);
-  success &= stopBackgroundPromoter(timeout);
+  if (!config_.parallelShutdown) {
+    for (auto stop : stops) {
+      success &= (this->*stop)(timeout);
+    }
+    return success;
+  }
+
+  // a worker in the middle of its work takes a while to stop, so the
+  // stop time is the slowest worker instead of the sum of all
+  std::vector<std::future<bool>> results;
+  for (auto stop : stops) {
+    results.push_back(std::async(std::launch::async, stop, this, timeout));
+  }
+  for (auto& result : results) {
+    success &= result.get();
+  }
   return success;
 }
 
@@ -5396,7 +7487,18 @@ CacheAllocator<CacheTrait>::shutDown() {
     shutDownInProgress_ = true;
   }
 
+  using Clock = std::chrono::steady_clock;
+  auto elapsedSince = [](Clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                                 begin);
+  };
+  const auto shutDownBegin = Clock::now();
+  shutDownTimings_ = ShutDownTimings{};
+
   stopWorkers();
+  dropHotKeyReplicas();
+  foldAllStripedRefcounts();
+  shutDownTimings_.stopWorkers = elapsedSince(shutDownBegin);
 
   const auto handleCount = getNumActiveHandles();
   if (handleCount != 0) {
@@ -5405,12 +7507,49 @@ CacheAllocator<CacheTrait>::shutDown() {
     return ShutDownStatus::kFailed;
   }
 
-  const auto nvmShutDownStatusOpt = saveNvmCache();
+  // The NvmCache does not reference the DRAM cache once its workers are
+  // drained, so it can flush while the DRAM cache metadata is serialized.
+  auto saveNvmCacheTimed = [this, &elapsedSince]() {
+    const auto begin = Clock::now();
+    auto res = saveNvmCache();
+    shutDownTimings_.saveNvmCache = elapsedSince(begin);
+    return res;
+  };
+  std::future<std::optional<bool>> nvmShutDownFuture;
+  std::optional<bool> nvmShutDownStatusOpt;
+  if (config_.parallelShutdown && hasNvmCache()) {
+    nvmShutDownFuture = std::async(std::launch::async, saveNvmCacheTimed);
+  } else {
+    nvmShutDownStatusOpt = saveNvmCacheTimed();
+  }
+
+  const auto saveRamCacheBegin = Clock::now();
+  // wait for the NvmCache even if the DRAM cache can not be saved
+  auto nvmGuard = folly::makeGuard([&nvmShutDownFuture]() {
+    if (nvmShutDownFuture.valid()) {
+      nvmShutDownFuture.wait();
+    }
+  });
   saveRamCache();
+  shutDownTimings_.saveRamCache = elapsedSince(saveRamCacheBegin);
+  if (nvmShutDownFuture.valid()) {
+    nvmShutDownStatusOpt = nvmShutDownFuture.get();
+  }
+
+  const auto shmShutDownBegin = Clock::now();
   const auto shmShutDownStatus = shmManager_->shutDown();
   const auto shmShutDownSucceeded =
       (shmShutDownStatus == ShmShutDownRes::kSuccess);
   shmManager_.reset();
+  shutDownTimings_.shmShutDown = elapsedSince(shmShutDownBegin);
+  shutDownTimings_.total = elapsedSince(shutDownBegin);
+  XLOGF(INFO,
+        "Shut down in {}ms: stopping workers {}ms, saving nvmcache {}ms, "
+        "saving dram cache {}ms, shutting down shm {}ms",
+        shutDownTimings_.total.count(), shutDownTimings_.stopWorkers.count(),
+        shutDownTimings_.saveNvmCache.count(),
+        shutDownTimings_.saveRamCache.count(),
+        shutDownTimings_.shmShutDown.count());
 
   if (shmShutDownSucceeded) {
     if (!nvmShutDownStatusOpt || *nvmShutDownStatusOpt)
@@ -5433,7 +7572,7 @@ CacheAllocator<CacheTrait>::shutDown() {
 
 template <typename CacheTrait>
 std::optional<bool> CacheAllocator<CacheTrait>::saveNvmCache() {
-  if (!nvmCache_) {
+  if (!hasNvmCache()) {
     return std::nullopt;
   }
 
@@ -5481,7 +7620,8 @@ CacheAllocator<CacheTrait>::deserializeMMContainers(
     auto i = static_cast<PoolId>(kvPool.first);
     auto& pool = getPool(i);
     for (auto& kv : kvPool.second) {
-      auto j = static_cast<ClassId>(kv.first);
+      auto j = static_cast<ClassId>(kv.first % MemoryAllocator::kMaxClasses);
+      auto k = static_cast<size_t>(kv.first / MemoryAllocator::kMaxClasses);
       MMContainerPtr ptr =
           std::make_unique<typename MMContainerPtr::element_type>(kv.second,
                                                                   compressor);
@@ -5490,7 +7630,28 @@ CacheAllocator<CacheTrait>::deserializeMMContainers(
                                 ? pool.getAllocationClass(j).getAllocsPerSlab()
                                 : 0);
       ptr->setConfig(config);
-      mmContainers[i][j] = std::move(ptr);
+      auto& shards = mmContainers[i][j];
+      if (shards.size() <= k) {
+        shards.resize(k + 1);
+      }
+      shards[k] = std::move(ptr);
+    }
+  }
+
+  // items are assigned to shards based on the number of shards, so it can not
+  // change across restarts.
+  for (const auto& pool : mmContainers) {
+    for (const auto& shards : pool) {
+      if (shards.empty()) {
+        continue;
+      }
+      if (shards.size() != config_.numMMContainerShards ||
+          std::any_of(shards.begin(), shards.end(),
+                      [](const auto& ptr) { return ptr == nullptr; })) {
+        throw std::invalid_argument(folly::sformat(
+            "Number of MMContainer shards changed. Saved: {}, configured: {}",
+            shards.size(), config_.numMMContainerShards));
+      }
     }
   }
   // We need to drop the unevictableMMContainer in the desierializer.
@@ -5509,6 +7670,14 @@ CacheAllocator<CacheTrait>::deserializeCacheAllocatorMetadata(
   // TODO:
   // Once everyone is on v8 or later, remove the outter if.
   if (kCachelibVersion > 8) {
+    const auto version = static_cast<uint64_t>(*meta.ramFormatVersion());
+    auto& upgrader = getRamFormatUpgrader();
+    if (version != kCacheRamFormatVersion && upgrader.canUpgrade(version)) {
+      upgrader.upgrade(version, meta);
+      *meta.ramFormatVersion() = kCacheRamFormatVersion;
+      XLOGF(INFO, "Upgraded cache ram format version {} to {}", version,
+            kCacheRamFormatVersion);
+    }
     if (*meta.ramFormatVersion() != kCacheRamFormatVersion) {
       throw std::runtime_error(
           folly::sformat("Expected cache ram format version {}. But found {}.",
@@ -5617,6 +7786,112 @@ CacheAllocator<CacheTrait>::viewAsChainedAllocsT(const Handle& parent) {
       std::move(l), std::move(handle), *head, compressor_};
 }
 
+template <typename CacheTrait>
+typename CacheAllocator<CacheTrait>::WriteHandle
+CacheAllocator<CacheTrait>::allocateLargeItem(PoolId id,
+                                              Key key,
+                                              uint64_t size,
+                                              uint32_t chunkSize,
+                                              uint32_t ttlSecs) {
+  using Layout = LargeItemLayout<CompressedPtrType>;
+  const uint64_t numChunks = chunkSize == 0 ? 0 : (size + chunkSize - 1) /
+                                                      chunkSize;
+  if (numChunks == 0 || numChunks > Slab::kSize / sizeof(CompressedPtrType)) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid chunk size {} for a large item of {} bytes", chunkSize,
+        size));
+  }
+
+  auto parent = allocate(id, key,
+                         Layout::getParentSize(static_cast<uint32_t>(numChunks)),
+                         ttlSecs);
+  if (!parent) {
+    return parent;
+  }
+
+  // chunks are prepended to the chain, so the chain is in the reverse order
+  // of the value
+  uint64_t remaining = size;
+  for (uint32_t i = 0; i < numChunks; i++) {
+    const auto thisChunk =
+        static_cast<uint32_t>(std::min<uint64_t>(remaining, chunkSize));
+    auto chunk = allocateChainedItem(parent, thisChunk);
+    if (!chunk) {
+      // releasing the parent frees the chunks added so far
+      return WriteHandle{};
+    }
+    Layout::setChunk(parent->getMemory(), i, compressor_.compress(chunk.get()));
+    addChainedItem(parent, std::move(chunk));
+    remaining -= thisChunk;
+  }
+  // written last so that the chunks are only indexed once they are complete
+  Layout::initHeader(parent->getMemory(), size,
+                     static_cast<uint32_t>(numChunks));
+  parent->markLargeItem();
+  return parent;
+}
+
+template <typename CacheTrait>
+template <typename Handle>
+CacheLargeItem<CacheAllocator<CacheTrait>, Handle>
+CacheAllocator<CacheTrait>::viewAsLargeItemT(const Handle& parent) {
+  XDCHECK(parent);
+  auto handle = parent.clone();
+  if (!handle) {
+    throw std::invalid_argument("Failed to clone item handle");
+  }
+
+  auto l = chainedItemLocks_.lockShared(handle->getKey());
+  return CacheLargeItem<CacheAllocator<CacheTrait>, Handle>{
+      std::move(l), std::move(handle), compressor_};
+}
+
+template <typename CacheTrait>
+void CacheAllocator<CacheTrait>::replaceLargeItemChunkLocked(
+    Item& parent, const Item& oldChunk, const Item& newChunk) {
+  using Layout = LargeItemLayout<CompressedPtrType>;
+  if (!parent.isLargeItem()) {
+    return;
+  }
+  const auto* header = Layout::getHeader(parent.getMemory(), parent.getSize());
+  if (!header) {
+    return;
+  }
+  const auto oldPtr = compressor_.compress(&oldChunk);
+  for (uint32_t i = 0; i < header->numChunks; i++) {
+    if (Layout::getChunk(parent.getMemory(), i) == oldPtr) {
+      Layout::setChunk(parent.getMemory(), i, compressor_.compress(&newChunk));
+      return;
+    }
+  }
+  XDCHECK(false) << "Chunk not indexed by its large item " << parent.toString();
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::rebuildLargeItemIndex(Item& parent) {
+  using Layout = LargeItemLayout<CompressedPtrType>;
+  const auto* header = Layout::getHeader(parent.getMemory(), parent.getSize());
+  if (!header || !parent.hasChainedItem()) {
+    return false;
+  }
+
+  auto l = chainedItemLocks_.lockExclusive(parent.getKey());
+  auto head = findChainedItem(parent);
+  uint32_t idx = header->numChunks;
+  for (auto* curr = head ? &head->asChainedItem() : nullptr; curr != nullptr;
+       curr = curr->getNext(compressor_)) {
+    if (idx == 0) {
+      return false;
+    }
+    Layout::setChunk(parent.getMemory(), --idx, compressor_.compress(curr));
+  }
+  if (idx != 0) {
+    return false;
+  }
+  parent.markLargeItem();
+  return true;
+}
+
 template <typename CacheTrait>
 GlobalCacheStats CacheAllocator<CacheTrait>::getGlobalCacheStats() const {
   stats().numExpensiveStatsPolled.inc();
@@ -5630,11 +7905,31 @@ GlobalCacheStats CacheAllocator<CacheTrait>::getGlobalCacheStats() const {
   ret.cacheInstanceUpTime = currTime - cacheInstanceCreationTime_;
   ret.ramUpTime = currTime - cacheCreationTime_;
   ret.nvmUpTime = currTime - nvmCacheState_.getCreationTime();
-  ret.nvmCacheEnabled = nvmCache_ ? nvmCache_->isEnabled() : false;
+  ret.nvmCacheEnabled = hasNvmCache() ? nvmCache_->isEnabled() : false;
   ret.reaperStats = getReaperStats();
   ret.rebalancerStats = getRebalancerStats();
   ret.evictionStats = getBackgroundMoverStats(MoverDir::Evict);
   ret.promotionStats = getBackgroundMoverStats(MoverDir::Promote);
+  if (memoryTiers_) {
+    ret.memoryTierStats.resize(config_.memoryTierConfigs.size());
+    for (auto pid : allocator_->getPoolIds()) {
+      const bool isLowerTier = getUpperTierPool(pid) != Slab::kInvalidPoolId;
+      auto& tierStats = ret.memoryTierStats[isLowerTier ? 1 : 0];
+      for (size_t cid = 0; cid < MemoryAllocator::kMaxClasses; ++cid) {
+        tierStats.numHits += (*stats_.cacheHits)[pid][cid].get();
+      }
+      tierStats.poolSize += allocator_->getPool(pid).getPoolSize();
+    }
+    ret.memoryTierStats[0].numDemotions = ret.numMemoryTierDemotions;
+    ret.memoryTierStats[0].numPromotions = ret.numMemoryTierPromotions;
+    ret.memoryTierDemoteLatencyNs = memoryTiers_->demoteLatency.estimate();
+    ret.memoryTierPromoteLatencyNs = memoryTiers_->promoteLatency.estimate();
+  }
+  if (const auto* contention = accessContainer_->getLockContentionStats()) {
+    // a handful of locks is enough to tell a hot key from too few locks.
+    constexpr size_t kNumHotLocks = 8;
+    ret.accessContainerLockContention = contention->getSnapshot(kNumHotLocks);
+  }
   ret.numActiveHandles = getNumActiveHandles();
 
   ret.isNewRamCache = cacheCreationTime_ == cacheInstanceCreationTime_;
@@ -5668,11 +7963,42 @@ CacheMemoryStats CacheAllocator<CacheTrait>::getCacheMemoryStats() const {
                           allocator_->getAdvisedMemorySize(),
                           memMonitor_ ? memMonitor_->getMaxAdvisePct() : 0,
                           allocator_->getUnreservedMemorySize(),
-                          nvmCache_ ? nvmCache_->getSize() : 0,
+                          hasNvmCache() ? nvmCache_->getSize() : 0,
                           util::getMemAvailable(),
                           util::getRSSBytes()};
 }
 
+template <typename CacheTrait>
+std::map<std::string, size_t> CacheAllocator<CacheTrait>::getMemoryPageSizes()
+    const {
+  auto getPageSize = [](const void* addr) {
+    return detail::getPageSize(
+        detail::getPageSizeInSMap(const_cast<void*>(addr)));
+  };
+
+  std::map<std::string, size_t> pageSizes;
+  if (!shmManager_) {
+    pageSizes[detail::kShmCacheName] =
+        getPageSize(allocator_->getMemoryStart());
+    return pageSizes;
+  }
+
+  for (const auto& name :
+       {detail::kShmCacheName, detail::kShmHashTableName,
+        detail::kShmChainedItemHashTableName}) {
+    try {
+      const auto& mapping =
+          shmManager_->getShmByName(name).getCurrentMapping();
+      if (mapping.addr != nullptr) {
+        pageSizes[name] = getPageSize(mapping.addr);
+      }
+    } catch (const std::invalid_argument&) {
+      // segment is not attached
+    }
+  }
+  return pageSizes;
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::autoResizeEnabledForPool(PoolId pid) const {
   std::shared_lock lock(compactCachePoolsLock_);
@@ -5695,10 +8021,12 @@ template <typename T>
 bool CacheAllocator<CacheTrait>::stopWorker(folly::StringPiece name,
                                             std::unique_ptr<T>& worker,
                                             std::chrono::seconds timeout) {
-  std::lock_guard<std::mutex> l(workersMutex_);
-  auto ret = util::stopPeriodicWorker(name, worker, timeout);
-  worker.reset();
-  return ret;
+  std::unique_ptr<T> stopping;
+  {
+    std::lock_guard<std::mutex> l(workersMutex_);
+    stopping = std::move(worker);
+  }
+  return util::stopPeriodicWorker(name, stopping, timeout);
 }
 
 template <typename CacheTrait>
@@ -5721,15 +8049,17 @@ template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::startNewPoolRebalancer(
     std::chrono::milliseconds interval,
     std::shared_ptr<RebalanceStrategy> strategy,
-    unsigned int freeAllocThreshold) {
+    unsigned int freeAllocThreshold,
+    unsigned int numThreads) {
   if (!startNewWorker("PoolRebalancer", poolRebalancer_, interval, *this,
-                      strategy, freeAllocThreshold)) {
+                      strategy, freeAllocThreshold, numThreads)) {
     return false;
   }
 
   config_.poolRebalanceInterval = interval;
   config_.defaultPoolRebalanceStrategy = strategy;
   config_.poolRebalancerFreeAllocThreshold = freeAllocThreshold;
+  config_.poolRebalancerThreads = numThreads;
 
   return true;
 }
@@ -5774,11 +8104,50 @@ bool CacheAllocator<CacheTrait>::startNewPoolOptimizer(
   return true;
 }
 
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::startNewAllocSizeOptimizer(
+    std::chrono::milliseconds interval) {
+  if (!startNewWorker("AllocSizeOptimizer", allocSizeOptimizer_, interval,
+                      *this)) {
+    return false;
+  }
+
+  config_.allocSizeTuningInterval = interval;
+  return true;
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::startNewAccessContainerResizer(
+    std::chrono::milliseconds interval) {
+  if (!startNewWorker("AccessContainerResizer", accessContainerResizer_,
+                      interval, *this)) {
+    return false;
+  }
+
+  config_.accessContainerResizeInterval = interval;
+  return true;
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::startNewStatsSnapshotter(
+    std::chrono::seconds interval, std::string statPrefix) {
+  if (!stopStatsSnapshotter() ||
+      !startNewWorker("StatsSnapshotter", statsSnapshotter_, interval, *this,
+                      statPrefix, interval)) {
+    return false;
+  }
+
+  config_.statsSnapshotInterval = interval;
+  config_.statsSnapshotPrefix = std::move(statPrefix);
+  return true;
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::startNewMemMonitor(
     std::chrono::milliseconds interval,
     MemoryMonitor::Config config,
     std::shared_ptr<RebalanceStrategy> strategy) {
+  allocator_->setSlabAdviseBatchSize(config.adviseBatchSize);
   if (!startNewWorker("MemoryMonitor", memMonitor_, interval, *this, config,
                       strategy)) {
     return false;
@@ -5837,6 +8206,10 @@ bool CacheAllocator<CacheTrait>::startNewBackgroundEvictor(
 
     if (result) {
       backgroundEvictor_[i]->setAssignedMemory(std::move(memoryAssignments[i]));
+      const auto& cpus = config_.backgroundMoverCpus;
+      if (!cpus.empty()) {
+        backgroundEvictor_[i]->setCpu(cpus[i % cpus.size()]);
+      }
     }
   }
   return result;
@@ -5861,6 +8234,10 @@ bool CacheAllocator<CacheTrait>::startNewBackgroundPromoter(
     if (result) {
       backgroundPromoter_[i]->setAssignedMemory(
           std::move(memoryAssignments[i]));
+      const auto& cpus = config_.backgroundMoverCpus;
+      if (!cpus.empty()) {
+        backgroundPromoter_[i]->setCpu(cpus[i % cpus.size()]);
+      }
     }
   }
   return result;
@@ -5896,6 +8273,47 @@ bool CacheAllocator<CacheTrait>::stopPoolOptimizer(
   return res;
 }
 
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::stopAllocSizeOptimizer(
+    std::chrono::seconds timeout) {
+  return stopWorker("AllocSizeOptimizer", allocSizeOptimizer_, timeout);
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::stopAccessContainerResizer(
+    std::chrono::seconds timeout) {
+  return stopWorker("AccessContainerResizer", accessContainerResizer_,
+                    timeout);
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::stopStatsSnapshotter(
+    std::chrono::seconds timeout) {
+  // the snapshotter reads the slab release stats, which lock workersMutex_,
+  // so it is stopped without holding the lock
+  std::unique_ptr<StatsSnapshotter> snapshotter;
+  {
+    std::lock_guard<std::mutex> l(workersMutex_);
+    snapshotter = std::move(statsSnapshotter_);
+  }
+  auto res = util::stopPeriodicWorker("StatsSnapshotter", snapshotter, timeout);
+  if (res) {
+    config_.statsSnapshotInterval = std::chrono::seconds{0};
+  }
+  return res;
+}
+
+template <typename CacheTrait>
+bool CacheAllocator<CacheTrait>::stopDeferredReleaser(
+    std::chrono::seconds timeout) {
+  if (!deferredReleaser_) {
+    return true;
+  }
+  // items dropped from now on are released inline
+  deferredReleaser_->setAccepting(false);
+  return deferredReleaser_->stop(timeout);
+}
+
 template <typename CacheTrait>
 bool CacheAllocator<CacheTrait>::stopMemMonitor(std::chrono::seconds timeout) {
   auto res = stopWorker("MemoryMonitor", memMonitor_, timeout);
@@ -5985,7 +8403,7 @@ template <typename CacheTrait>
 util::StatsMap CacheAllocator<CacheTrait>::getNvmCacheStatsMap() const {
   stats().numExpensiveStatsPolled.inc();
 
-  auto ret = nvmCache_ ? nvmCache_->getStatsMap() : util::StatsMap{};
+  auto ret = hasNvmCache() ? nvmCache_->getStatsMap() : util::StatsMap{};
   if (nvmAdmissionPolicy_) {
     nvmAdmissionPolicy_->getCounters(ret.createCountVisitor());
   }
@@ -5999,6 +8417,15 @@ extern template class CacheAllocator<LruCacheTrait>;
 extern template class CacheAllocator<LruCacheWithSpinBucketsTrait>;
 extern template class CacheAllocator<Lru2QCacheTrait>;
 extern template class CacheAllocator<TinyLFUCacheTrait>;
+extern template class CacheAllocator<SieveCacheTrait>;
+extern template class CacheAllocator<Lru5BCacheTrait>;
+extern template class CacheAllocator<Lru5BCacheWithSpinBucketsTrait>;
+extern template class CacheAllocator<Lru5B2QCacheTrait>;
+extern template class CacheAllocator<TinyLFU5BCacheTrait>;
+extern template class CacheAllocator<Sieve5BCacheTrait>;
+extern template class CacheAllocator<LruOpenAddressingCacheTrait>;
+extern template class CacheAllocator<LruCompactItemCacheTrait>;
+extern template class CacheAllocator<LruDramOnlyCacheTrait>;
 
 // CacheAllocator with an LRU eviction policy
 // LRU policy can be configured to act as a segmented LRU as well
@@ -6021,4 +8448,39 @@ using Lru2QAllocator = CacheAllocator<Lru2QCacheTrait>;
 // inserted items. And eventually it will onl admit items that are accessed
 // beyond a threshold into the warm cache.
 using TinyLFUAllocator = CacheAllocator<TinyLFUCacheTrait>;
+
+// CacheAllocator with SIEVE eviction policy
+// Items are never moved on access, hits only set a visited bit without
+// taking the container lock. Evictions move a hand over the insertion ordered
+// queue and evict the first item that was not visited since the hand last
+// passed it.
+using SieveAllocator = CacheAllocator<SieveCacheTrait>;
+
+// The allocators above with 5 byte compressed pointers. They address up to
+// 32 TB of cache instead of 256 GB at the cost of a byte per compressed
+// pointer in every item and a few more instructions per decompression. Use
+// getMinCompressedPtrBytes() to pick one for a given cache size.
+using Lru5BAllocator = CacheAllocator<Lru5BCacheTrait>;
+using Lru5BAllocatorSpinBuckets =
+    CacheAllocator<Lru5BCacheWithSpinBucketsTrait>;
+using Lru5B2QAllocator = CacheAllocator<Lru5B2QCacheTrait>;
+using TinyLFU5BAllocator = CacheAllocator<TinyLFU5BCacheTrait>;
+using Sieve5BAllocator = CacheAllocator<Sieve5BCacheTrait>;
+
+// CacheAllocator with an LRU eviction policy and an open addressing hash
+// table for lookups. Items are a compressed pointer smaller and lookups touch
+// fewer cachelines, but the table has to be sized for the number of items
+// since inserts fail once it is full.
+using LruOpenAddressingAllocator =
+    CacheAllocator<LruOpenAddressingCacheTrait>;
+
+// CacheAllocator with an LRU eviction policy whose items have no expiry
+// time. Items are 4 bytes smaller, and allocating them with a TTL throws.
+using LruCompactItemAllocator = CacheAllocator<LruCompactItemCacheTrait>;
+
+// CacheAllocator with an LRU eviction policy for DRAM only caches. Its items
+// have no expiry time and can not be chained, and it has no nvmcache, remove
+// callback or item destructor. The checks for these features compile away
+// from its hot paths, and configs or calls that need them throw.
+using LruDramOnlyAllocator = CacheAllocator<LruDramOnlyCacheTrait>;
 } // namespace facebook::cachelib
@@ -19,23 +19,29 @@
 #include <folly/Optional.h>
 #include <folly/json/DynamicConverter.h>
 #include <folly/json/json.h>
+#include <folly/lang/Bits.h>
 
 #include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "cachelib/allocator/BackgroundMoverStrategy.h"
 #include "cachelib/allocator/Cache.h"
+#include "cachelib/allocator/HotKeyReplicas.h"
 #include "cachelib/allocator/MM2Q.h"
 #include "cachelib/allocator/MemoryMonitor.h"
 #include "cachelib/allocator/MemoryTierCacheConfig.h"
 #include "cachelib/allocator/NvmAdmissionPolicy.h"
 #include "cachelib/allocator/PoolOptimizeStrategy.h"
 #include "cachelib/allocator/RebalanceStrategy.h"
+#include "cachelib/allocator/StripedRefcounts.h"
 #include "cachelib/allocator/Util.h"
+#include "cachelib/allocator/memory/NumaPolicy.h"
 #include "cachelib/common/EventInterface.h"
 #include "cachelib/common/Throttler.h"
 
@@ -95,6 +101,23 @@ class CacheAllocatorConfig {
   // explicitly from cache (both RAM and NVM)
   CacheAllocatorConfig& setItemDestructor(ItemDestructor destructor);
 
+  // Release the items removed from RAM on a background thread, so that the
+  // remove callback and the item destructor run there in batches instead of
+  // on the thread that dropped the last handle. The memory of an item is
+  // only reused once it is released. The memory of an evicted item is needed
+  // right away, so its callbacks get a copy of the item instead, unless it
+  // has chained items.
+  //
+  // @param interval    how often the pending items are released
+  // @param maxPending  items waiting at most. Beyond it, callers release
+  //                    their items themselves.
+  // @param batchSize   the worker is woken up early once a cpu has this many
+  //                    items waiting
+  CacheAllocatorConfig& enableDeferredItemRelease(
+      std::chrono::milliseconds interval = std::chrono::milliseconds{10},
+      size_t maxPending = 1024,
+      size_t batchSize = 64);
+
   // Config for NvmCache. If enabled, cachelib will also make use of flash.
   CacheAllocatorConfig& enableNvmCache(NvmCacheConfig config);
 
@@ -111,6 +134,13 @@ class CacheAllocatorConfig {
                                                   size_t suffixIgnoreLength,
                                                   bool useDramHitSignal);
 
+  // enable an admission policy for NvmCache that admits the items with the
+  // highest value from their DRAM access history within a write budget. See
+  // WriteBudgetAP for details. Takes precedence over enableRejectFirstAP.
+  //
+  // @throw std::invalid_argument if the config is invalid
+  CacheAllocatorConfig& enableWriteBudgetAPForNvm(WriteBudgetAPConfig config);
+
   // enable an admission policy for NvmCache. If this is set, other supported
   // options like enableRejectFirstAP etc are overlooked.
   //
@@ -182,6 +212,11 @@ class CacheAllocatorConfig {
   // completed sooner for shutdown to take place fast.
   CacheAllocatorConfig& disableFastShutdownMode();
 
+  // Shut down in parallel: the workers are stopped concurrently, and the
+  // DRAM cache metadata is serialized while the NvmCache flushes and
+  // persists its index. See CacheAllocator::getShutDownTimings().
+  CacheAllocatorConfig& enableParallelShutdown();
+
   // when disabling full core dump, turning this option on will enable
   // cachelib to track recently accessed items and keep them in the partial
   // core dump. See CacheAllocator::madviseRecentItems()
@@ -205,11 +240,39 @@ class CacheAllocatorConfig {
   // cachePersistence()
   CacheAllocatorConfig& usePosixForShm();
 
+  // Back the slab memory with 2MB or 1GB huge pages to cut down on TLB misses
+  // for large caches. This applies to the shared memory segment when cache
+  // persistence is enabled and to the memory mapped by the cache otherwise.
+  // The huge pages must be reserved by the system administrator (e.g. through
+  // /proc/sys/vm/nr_hugepages). If they can not be obtained, the cache falls
+  // back to regular pages when fallbackToNormalPages is true and fails to
+  // create otherwise. The page size a cache was created with is persisted and
+  // reused when the cache is attached after a restart. Use
+  // CacheAllocator::getMemoryPageSizes() to find out what was obtained.
+  CacheAllocatorConfig& setMemoryPageSize(PageSizeT pageSize,
+                                          bool fallbackToNormalPages = true);
+
+  // Place the slabs of the pool with the given name according to the NUMA
+  // policy: bind them to a set of nodes, interleave them across a set of
+  // nodes, or put them on the node local to the thread that first allocates
+  // from them. The policy is applied whenever the pool acquires a slab,
+  // including after attaching to a persisted cache. Pools without a policy
+  // follow the memory binding of their memory tier.
+  CacheAllocatorConfig& setPoolNumaPolicy(std::string poolName,
+                                          NumaPolicy policy);
+
   // Configures cache memory tiers. Each tier represents a cache region inside
   // byte-addressable memory such as DRAM, Pmem, CXLmem.
   // Accepts vector of MemoryTierCacheConfig. Each vector element describes
   // configuration for a single memory cache tier. Tier sizes are specified as
   // ratios, the number of parts of total cache size each tier would occupy.
+  //
+  // With two tiers, every pool is split by the tier ratios into a pool on the
+  // first tier and a pool on the second one, each bound to the NUMA nodes of
+  // its tier. Items evicted from the first tier are demoted to the second
+  // tier instead of being dropped or written to NvmCache, and items that are
+  // hit often in the second tier are promoted back. See
+  // setMemoryTierPromotion().
   // @throw std::invalid_argument if:
   // - the size of configs is 0
   // - the size of configs is greater than kMaxCacheMemoryTiers
@@ -218,11 +281,26 @@ class CacheAllocatorConfig {
   // Return reference to MemoryTierCacheConfigs.
   const MemoryTierConfigs& getMemoryTierConfigs() const noexcept;
 
+  // With two memory tiers, promote an item of the second tier back to the
+  // first one once it has been looked up @minHits times since it was
+  // demoted. Promotions are carried out by the background promoter. If none
+  // was set up through enableBackgroundPromoter(), one running a
+  // PromotionStrategy every @interval is started.
+  CacheAllocatorConfig& setMemoryTierPromotion(
+      uint32_t minHits, std::chrono::milliseconds interval);
+
   // This turns on a background worker that periodically scans through the
   // access container and look for expired items and remove them.
   CacheAllocatorConfig& enableItemReaperInBackground(
       std::chrono::milliseconds interval, util::Throttler::Config config = {});
 
+  // Keeps the earliest expiry time of the items of every slab, so that the
+  // reaper only walks the slabs holding items due to expire. Every
+  // @fullScanInterval runs, the reaper walks the whole cache anyway to reap
+  // the items whose expiry time was lowered through
+  // Item::updateExpiryTime(). 0 never walks the whole cache.
+  CacheAllocatorConfig& enableReaperExpiryIndex(uint32_t fullScanInterval = 10);
+
   // When using free memory monitoring mode, CacheAllocator shrinks the cache
   // size when the system is under memory pressure. Cache will grow back when
   // the memory pressure goes down.
@@ -271,6 +349,68 @@ class CacheAllocatorConfig {
       std::chrono::seconds ccacheInterval,
       uint32_t ccacheStepSizePercent);
 
+  // Enable sampling the sizes of the allocations made from each regular pool
+  // and periodically computing the allocation sizes that would minimize their
+  // internal fragmentation. The allocation sizes of existing pools are not
+  // changed; the recommendations are exposed through
+  // CacheAllocator::getAllocSizeRecommendation and can be passed to addPool
+  // when the cache is next created.
+  //
+  // @param interval        how often the recommendations are recomputed
+  // @param sampleRate      one out of this many allocations is sampled
+  // @param maxNumClasses   upper bound on the number of recommended sizes. 0
+  //                        means as many as the pool has now.
+  CacheAllocatorConfig& enableAllocSizeTuning(
+      std::chrono::milliseconds interval,
+      uint32_t sampleRate = 100,
+      uint32_t maxNumClasses = 0);
+
+  // Estimate the miss ratio curve of every regular pool from the hits and
+  // allocations of a sample of the keys. The curves are exposed through
+  // CacheAllocator::getPoolMissRatioCurve and drive the
+  // MissRatioCurveOptimizeStrategy.
+  //
+  // @param samplingRate  fraction of the keys sampled initially
+  // @param maxSamples    upper bound on the keys sampled per pool. The
+  //                      sampling rate drops once it is reached.
+  // @param numBuckets    number of points of every curve, evenly spread up
+  //                      to the cache size
+  CacheAllocatorConfig& enableMissRatioCurves(double samplingRate = 0.01,
+                                              uint32_t maxSamples = 4096,
+                                              uint32_t numBuckets = 128);
+
+  // Sample the ages of the items evicted from every allocation class into a
+  // histogram per class, without taking the locks of the MM containers. The
+  // percentiles are reported by getPoolEvictionAgeStats and can be used by
+  // the LruTailAgeStrategy in place of the tail of the eviction queues.
+  //
+  // @param sampleRate  one out of this many evictions is sampled
+  // @param windowSize  number of samples of a class after which its older
+  //                    samples are halved
+  CacheAllocatorConfig& enableSampledEvictionAges(uint32_t sampleRate = 16,
+                                                  uint32_t windowSize = 1024);
+
+  // Grow the access containers in the background once they hold more keys
+  // per bucket than their max load factor. Only the access containers
+  // configured with a max bucket power above their bucket power grow.
+  //
+  // @param interval          how often the access containers are checked
+  // @param numBucketsPerRun  upper bound on the buckets split per check
+  CacheAllocatorConfig& enableAccessContainerResizing(
+      std::chrono::milliseconds interval, size_t numBucketsPerRun = 1 << 16);
+
+  // Compute the stats of the cache in the background and publish them as a
+  // snapshot, read through CacheAllocator::getStatsSnapshot. The counters of
+  // exportStats() are exported into the snapshot, so the application should
+  // read them from there instead of calling exportStats() itself.
+  //
+  // @param interval    how often the snapshot is taken. The deltas of the
+  //                    counters are computed over it.
+  // @param statPrefix  prefix of the names of the counters
+  CacheAllocatorConfig& enableStatsSnapshots(
+      std::chrono::seconds interval = std::chrono::seconds{1},
+      std::string statPrefix = "cachelib.");
+
   // Enable the background evictor - scans a tier to look for objects
   // to evict to the next tier
   CacheAllocatorConfig& enableBackgroundEvictor(
@@ -283,6 +423,12 @@ class CacheAllocatorConfig {
       std::chrono::milliseconds regularInterval,
       size_t threads);
 
+  // Pin the background evictor and promoter threads to @cpus: the i-th
+  // thread of each to cpus[i % cpus.size()]. Each thread moves the items of
+  // its own allocation classes, so pinning keeps their MMContainers in the
+  // caches of a core.
+  CacheAllocatorConfig& setBackgroundMoverCpus(std::vector<uint32_t> cpus);
+
   // This enables an optimization for Pool rebalancing and resizing.
   // The rough idea is to ensure only the least useful items are evicted when
   // we move slab memory around. Come talk to Cache Library team if you think
@@ -296,6 +442,12 @@ class CacheAllocatorConfig {
   CacheAllocatorConfig& setSlabReleaseStuckThreashold(
       std::chrono::milliseconds threshold);
 
+  // With moving enabled, moves the items of a released slab in batches of up
+  // to @batchSize: the destinations of a batch are allocated together and the
+  // items are moved in the order of their access container lock. Chained
+  // items are still moved one at a time. 1 moves every item on its own.
+  CacheAllocatorConfig& setSlabReleaseMoveBatchSize(uint32_t batchSize);
+
   // This customizes how many items we try to evict before giving up.s
   // We may fail to evict if someone else (another thread) is using an item.
   // Setting this to a high limit leads to a higher chance of successful
@@ -304,6 +456,69 @@ class CacheAllocatorConfig {
   // before you start customizing this option.
   CacheAllocatorConfig& setEvictionSearchLimit(uint32_t limit);
 
+  // Split the MMContainer of every (pool, allocation class) into the given
+  // number of shards, each with its own lock, so that a hot allocation class
+  // does not serialize all its accesses on one lock. Items are spread across
+  // the shards and evictions rotate through them. Must be a power of two no
+  // larger than kMaxMMContainerShards and can not change across restarts.
+  CacheAllocatorConfig& setNumMMContainerShards(uint32_t numShards);
+
+  // Evict up to this many items per eviction pass when an allocation class is
+  // full. The allocations freed beyond the one that is needed are kept in a
+  // per (pool, allocation class) stash and handed out to the following
+  // allocations without going through the eviction path again. The default
+  // of 1 evicts one item per allocation. Must be between 1 and
+  // kMaxEvictionBatchSize.
+  CacheAllocatorConfig& setEvictionBatchSize(uint32_t batchSize);
+
+  // Evict by cost instead of recency alone. Every eviction looks at the
+  // given number of items at the tail of the MMContainer and evicts the one
+  // with the lowest cost per byte, from the cost level of the items (see
+  // Item::setCostLevel). The level of the items passed over decays by one,
+  // so that an expensive item that is not accessed still ages out, like in
+  // GreedyDual. 1 or less evicts in the order of the MMContainer.
+  CacheAllocatorConfig& enableCostAwareEviction(uint32_t numCandidates = 5);
+
+  // Cache up to this many free allocations per thread and allocation class,
+  // so that most allocations and frees do not take the allocation class
+  // lock. Allocations are moved between a thread's cache and its allocation
+  // class in batches of half this size. Free memory held by the caches of
+  // other threads is not available to a thread, so this trades a little
+  // memory for less contention. 0 (the default) disables the caches. Must be
+  // at most AllocationClass::kMaxMagazineSize.
+  CacheAllocatorConfig& setAllocMagazineSize(uint32_t magazineSize);
+
+  // Serve the lookups of very hot keys from read-only copies of their items
+  // kept per cpu, so that the readers of a viral key do not all contend on
+  // its access container lock and refcount. Keys are found hot by a
+  // HotHashDetector per thread. Copies are made in the pool of the item, for
+  // items without chained items, and are dropped as soon as the key is
+  // inserted, removed, evicted, looked up for write or gets chained items.
+  // Values mutated in place through a handle that was not obtained for write
+  // may be served stale for up to the replica lifetime. Replicas are not
+  // passed to the remove callback, so this can not be used together with an
+  // item destructor or a move callback that owns resources outside the item.
+  CacheAllocatorConfig& enableHotKeyReplication(
+      HotKeyReplicationConfig config = {});
+
+  // Count the references of handles to very hot items on per cpu stripes
+  // instead of the refcount of the item, so that the readers of a viral key
+  // do not all bounce the cacheline of its refcount. Keys are found hot by a
+  // HotHashDetector per thread. An item with a striped refcount is pinned in
+  // the cache: it can not be evicted or moved until its refcount is folded
+  // back, which happens when it is replaced or removed, when its lifetime
+  // is over and before slabs are released. Can not be used together with
+  // hot key replication.
+  CacheAllocatorConfig& enableStripedRefcounts(
+      StripedRefcountConfig config = {});
+
+  // Keep the second granularity clock used for the access times and the
+  // expiry of the items in a background thread, instead of reading it from
+  // the vdso on every access and allocation. The clock is shared by all the
+  // caches that enable it and lags by at most
+  // util::CoarseClock::kUpdateInterval.
+  CacheAllocatorConfig& enableCoarseClock();
+
   // Specify a threshold for per-item outstanding references, beyond which,
   // shared_ptr will be allocated instead of handles to support having  more
   // outstanding iobuf
@@ -331,6 +546,26 @@ class CacheAllocatorConfig {
   // CacheAllocator::startCacheWorkers()
   CacheAllocatorConfig& setDelayCacheWorkersStart();
 
+  // Make the cache usable as soon as the DRAM cache is attached on a warm
+  // restart, and restore the nvmcache in the background: until it is
+  // recovered, lookups are served from DRAM only. See
+  // NvmCache::Config::asyncRecovery.
+  CacheAllocatorConfig& setDeferredAttachRestore();
+
+  // On a warm restart, fault in the pages of the attached shared memory with
+  // @numThreads threads before the cache is returned, hash tables first, so
+  // that the first accesses after the restart don't each take a page fault.
+  // 0 disables it.
+  CacheAllocatorConfig& setShmPrefaultThreads(uint32_t numThreads);
+
+  // When the cache is created, allocate and zero the pages of its shared
+  // memory with @numThreads threads before the cache is returned, instead of
+  // on first touch while serving. With @preallocate, the memory of a posix
+  // segment is reserved upfront instead, so that a shortage fails the
+  // creation; the kernel zeroes it serially then.
+  CacheAllocatorConfig& setShmPopulate(uint32_t numThreads,
+                                       bool preallocate = false);
+
   // skip promote children items in chained when parent fail to promote
   bool isSkipPromoteChildrenWhenParentFailed() const noexcept {
     return skipPromoteChildrenWhenParentFailed;
@@ -357,6 +592,36 @@ class CacheAllocatorConfig {
            poolOptimizeStrategy != nullptr;
   }
 
+  // @return whether the miss ratio curves of the pools are estimated
+  bool missRatioCurvesEnabled() const noexcept {
+    return missRatioCurveSamplingRate > 0;
+  }
+
+  // @return whether the eviction ages of the classes are sampled
+  bool sampledEvictionAgesEnabled() const noexcept {
+    return evictionAgeSampleRate > 0;
+  }
+
+  // @return whether allocation size tuning is enabled
+  bool allocSizeTuningEnabled() const noexcept {
+    return allocSizeTuningInterval.count() > 0;
+  }
+
+  // @return whether the access containers are resized in the background
+  bool accessContainerResizingEnabled() const noexcept {
+    return accessContainerResizeInterval.count() > 0;
+  }
+
+  // @return whether stats snapshots are taken in the background
+  bool statsSnapshotsEnabled() const noexcept {
+    return statsSnapshotInterval.count() > 0;
+  }
+
+  // @return whether dropped items are released on a background thread
+  bool deferredItemReleaseEnabled() const noexcept {
+    return deferredReleaseInterval.count() > 0;
+  }
+
   // @return whether background evictor thread is enabled
   bool backgroundEvictorEnabled() const noexcept {
     return backgroundEvictorInterval.count() > 0 &&
@@ -387,6 +652,8 @@ class CacheAllocatorConfig {
 
   bool isUsingPosixShm() const noexcept { return usePosixShm; }
 
+  PageSizeT getMemoryPageSize() const noexcept { return memoryPageSize; }
+
   // validate the config, and return itself if valid
   const CacheAllocatorConfig& validate() const;
 
@@ -422,6 +689,15 @@ class CacheAllocatorConfig {
   // Attach shared memory to a fixed base address
   void* slabMemoryBaseAddr = nullptr;
 
+  // page size backing the slab memory
+  PageSizeT memoryPageSize{PageSizeT::NORMAL};
+
+  // whether to use regular pages when memoryPageSize can not be obtained
+  bool memoryPageSizeFallback{true};
+
+  // NUMA placement of the slabs for pools by name
+  std::map<std::string, NumaPolicy> poolNumaPolicies;
+
   // User defined default alloc sizes. If empty, we'll generate a default one.
   // This set of alloc sizes will be used for pools that user do not supply
   // a custom set of alloc sizes.
@@ -434,6 +710,10 @@ class CacheAllocatorConfig {
   // release process, or not.
   bool enableFastShutdown{true};
 
+  // whether to stop the workers and persist the DRAM cache and the NvmCache
+  // concurrently on shutdown
+  bool parallelShutdown{false};
+
   // if we want to track recent items for dumping them in core when we disable
   // full core dump.
   bool trackRecentItemsForDump{false};
@@ -473,6 +753,11 @@ class CacheAllocatorConfig {
   // A value of 0 means, this feature is disabled.
   unsigned int poolRebalancerFreeAllocThreshold{0};
 
+  // Number of slabs of different pools the PoolRebalancer releases
+  // concurrently. With more than 1, the slabs of all the pools are picked
+  // before they are released by as many threads.
+  unsigned int poolRebalancerThreads{1};
+
   // rebalancing strategy for all pools. By default the strategy will
   // rebalance to avoid alloc fialures.
   std::shared_ptr<RebalanceStrategy> defaultPoolRebalanceStrategy{
@@ -482,6 +767,9 @@ class CacheAllocatorConfig {
   // make any progress for the below threshold
   std::chrono::milliseconds slabReleaseStuckThreshold{std::chrono::seconds(60)};
 
+  // number of items of a released slab moved as a batch
+  uint32_t slabReleaseMoveBatchSize{1};
+
   // the background eviction strategy to be used
   std::shared_ptr<BackgroundMoverStrategy> backgroundEvictorStrategy{nullptr};
 
@@ -502,6 +790,19 @@ class CacheAllocatorConfig {
   // number of thread used by background promoter
   size_t backgroundPromoterThreads{1};
 
+  // cpus the background evictor and promoter threads are pinned to. Empty
+  // leaves them unpinned.
+  std::vector<uint32_t> backgroundMoverCpus;
+
+  // number of lookups in the second memory tier after which an item is
+  // promoted back to the first tier
+  uint32_t memoryTierPromotionMinHits{2};
+
+  // interval of the background promoter started for memory tiers when none
+  // is configured
+  std::chrono::milliseconds memoryTierPromotionInterval{
+      std::chrono::milliseconds{10}};
+
   // time interval to sleep between iterations of pool size optimization,
   // for regular pools and compact caches
   std::chrono::seconds regularPoolOptimizeInterval{0};
@@ -514,6 +815,54 @@ class CacheAllocatorConfig {
   // optimization strategy
   std::shared_ptr<PoolOptimizeStrategy> poolOptimizeStrategy{nullptr};
 
+  // time interval to sleep between recomputing the recommended allocation
+  // sizes. 0 disables the sampling of allocation sizes.
+  std::chrono::milliseconds allocSizeTuningInterval{0};
+
+  // one out of this many allocations has its size sampled
+  uint32_t allocSizeTuningSampleRate{100};
+
+  // upper bound on the number of recommended allocation sizes per pool. 0
+  // means as many as the pool has.
+  uint32_t allocSizeTuningMaxClasses{0};
+
+  // fraction of the keys sampled for the miss ratio curves. 0 disables them.
+  double missRatioCurveSamplingRate{0};
+
+  // upper bound on the keys sampled per pool for the miss ratio curves
+  uint32_t missRatioCurveMaxSamples{4096};
+
+  // number of points of the miss ratio curves
+  uint32_t missRatioCurveNumBuckets{128};
+
+  // one out of this many evictions has its age sampled. 0 disables sampling
+  // the eviction ages.
+  uint32_t evictionAgeSampleRate{0};
+
+  // number of samples of a class after which its older samples are halved
+  uint32_t evictionAgeWindowSize{1024};
+
+  // time interval to sleep between growing the access containers. 0
+  // disables growing them.
+  std::chrono::milliseconds accessContainerResizeInterval{0};
+
+  // upper bound on the buckets split per access container in each run
+  size_t accessContainerResizeBucketsPerRun{1 << 16};
+
+  // time interval between stats snapshots. 0 disables them.
+  std::chrono::seconds statsSnapshotInterval{0};
+
+  // prefix of the names of the counters in the stats snapshots
+  std::string statsSnapshotPrefix{"cachelib."};
+
+  // time interval between releasing the items dropped from RAM in the
+  // background. 0 releases them inline.
+  std::chrono::milliseconds deferredReleaseInterval{0};
+
+  // items waiting to be released at most, and how many wake the worker up
+  size_t deferredReleaseMaxPending{1024};
+  size_t deferredReleaseBatchSize{64};
+
   // Callback for initializing the eventTracker on CacheAllocator construction.
   EventTrackerSharedPtr eventTracker{nullptr};
 
@@ -533,6 +882,12 @@ class CacheAllocatorConfig {
   // time to sleep between each reaping period.
   std::chrono::milliseconds reaperInterval{5000};
 
+  // whether the reaper skips the slabs with no item due to expire
+  bool reaperExpiryIndex{false};
+
+  // runs of the reaper between full walks of the cache with the expiry index
+  uint32_t reaperFullScanInterval{10};
+
   // interval during which we adjust dynamically the refresh ratio.
   std::chrono::milliseconds mmReconfigureInterval{0};
 
@@ -545,6 +900,20 @@ class CacheAllocatorConfig {
   // 0 means it's infinite
   unsigned int evictionSearchTries{50};
 
+  // number of MMContainer shards per (pool, allocation class)
+  uint32_t numMMContainerShards{1};
+  static constexpr uint32_t kMaxMMContainerShards{64};
+
+  // number of items evicted per eviction pass
+  uint32_t evictionBatchSize{1};
+  static constexpr uint32_t kMaxEvictionBatchSize{64};
+
+  // number of items at the tail compared by the cost aware eviction
+  uint32_t costAwareEvictionCandidates{0};
+
+  // number of free allocations cached per thread and allocation class
+  uint32_t allocMagazineSize{0};
+
   // If refcount is larger than this threshold, we will use shared_ptr
   // for handles in IOBuf chains.
   unsigned int thresholdForConvertingToIOBuf{
@@ -609,6 +978,18 @@ class CacheAllocatorConfig {
   // admit
   bool rejectFirstUseDramHitSignal{true};
 
+  // configuration for the write budget admission policy to nvmcache
+  folly::Optional<WriteBudgetAPConfig> writeBudgetAPConfig;
+
+  // configuration of the per cpu replicas of hot keys
+  folly::Optional<HotKeyReplicationConfig> hotKeyReplicationConfig;
+
+  // configuration of the per cpu refcounts of hot items
+  folly::Optional<StripedRefcountConfig> stripedRefcountConfig;
+
+  // keep the clock of the items in a background thread
+  bool useCoarseClock{false};
+
   // Must enable this in order to call `allocateZeroedSlab`.
   // Otherwise, it will throw.
   // This is required for compact cache
@@ -641,6 +1022,21 @@ class CacheAllocatorConfig {
   // CacheAllocator::startCacheWorkers()
   bool delayCacheWorkersStart{false};
 
+  // If true, the nvmcache is recovered in the background instead of while
+  // constructing the CacheAllocator.
+  bool deferredAttachRestore{false};
+
+  // Number of threads populating the attached shared memory on a warm
+  // restart. 0 to not populate it.
+  uint32_t shmPrefaultThreads{0};
+
+  // Number of threads populating the shared memory of a new cache. 0 to not
+  // populate it.
+  uint32_t shmPopulateThreads{0};
+
+  // If true, the shared memory of a new cache is reserved with fallocate().
+  bool shmPreallocate{false};
+
   friend CacheT;
 
  private:
@@ -724,6 +1120,15 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setItemDestructor(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableDeferredItemRelease(
+    std::chrono::milliseconds interval, size_t maxPending, size_t batchSize) {
+  deferredReleaseInterval = interval;
+  deferredReleaseMaxPending = maxPending;
+  deferredReleaseBatchSize = batchSize;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableRejectFirstAPForNvm(
     uint64_t numEntries,
@@ -741,6 +1146,14 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableRejectFirstAPForNvm(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableWriteBudgetAPForNvm(
+    WriteBudgetAPConfig config) {
+  config.validate();
+  writeBudgetAPConfig.assign(std::move(config));
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableNvmCache(
     NvmCacheConfig config) {
@@ -872,6 +1285,12 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::disableFastShutdownMode() {
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableParallelShutdown() {
+  parallelShutdown = true;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setTrackRecentItemsForDump(
     bool enable) {
@@ -904,6 +1323,21 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::usePosixForShm() {
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setPoolNumaPolicy(
+    std::string poolName, NumaPolicy policy) {
+  poolNumaPolicies[std::move(poolName)] = std::move(policy);
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setMemoryPageSize(
+    PageSizeT pageSize, bool fallbackToNormalPages) {
+  memoryPageSize = pageSize;
+  memoryPageSizeFallback = fallbackToNormalPages;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableItemReaperInBackground(
     std::chrono::milliseconds interval, util::Throttler::Config config) {
@@ -912,6 +1346,14 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableItemReaperInBackground(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableReaperExpiryIndex(
+    uint32_t fullScanInterval) {
+  reaperExpiryIndex = true;
+  reaperFullScanInterval = fullScanInterval;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::configureMemoryTiers(
     const MemoryTierConfigs& config) {
@@ -934,6 +1376,14 @@ CacheAllocatorConfig<T>::getMemoryTierConfigs() const noexcept {
   return memoryTierConfigs;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setMemoryTierPromotion(
+    uint32_t minHits, std::chrono::milliseconds interval) {
+  memoryTierPromotionMinHits = minHits;
+  memoryTierPromotionInterval = interval;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableMemoryMonitor(
     std::chrono::milliseconds interval,
@@ -963,6 +1413,50 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enablePoolOptimizer(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableMissRatioCurves(
+    double samplingRate, uint32_t maxSamples, uint32_t numBuckets) {
+  missRatioCurveSamplingRate = samplingRate;
+  missRatioCurveMaxSamples = maxSamples;
+  missRatioCurveNumBuckets = numBuckets;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableAllocSizeTuning(
+    std::chrono::milliseconds interval,
+    uint32_t sampleRate,
+    uint32_t maxNumClasses) {
+  allocSizeTuningInterval = interval;
+  allocSizeTuningSampleRate = sampleRate;
+  allocSizeTuningMaxClasses = maxNumClasses;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableSampledEvictionAges(
+    uint32_t sampleRate, uint32_t windowSize) {
+  evictionAgeSampleRate = sampleRate;
+  evictionAgeWindowSize = windowSize;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableAccessContainerResizing(
+    std::chrono::milliseconds interval, size_t numBucketsPerRun) {
+  accessContainerResizeInterval = interval;
+  accessContainerResizeBucketsPerRun = numBucketsPerRun;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableStatsSnapshots(
+    std::chrono::seconds interval, std::string statPrefix) {
+  statsSnapshotInterval = interval;
+  statsSnapshotPrefix = std::move(statPrefix);
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enablePoolRebalancing(
     std::shared_ptr<RebalanceStrategy> defaultRebalanceStrategy,
@@ -1001,6 +1495,13 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableBackgroundPromoter(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setBackgroundMoverCpus(
+    std::vector<uint32_t> cpus) {
+  backgroundMoverCpus = std::move(cpus);
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enablePoolResizing(
     std::shared_ptr<RebalanceStrategy> resizeStrategy,
@@ -1033,6 +1534,13 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setSlabReleaseStuckThreashold(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setSlabReleaseMoveBatchSize(
+    uint32_t batchSize) {
+  slabReleaseMoveBatchSize = std::max(batchSize, 1u);
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setEvictionSearchLimit(
     uint32_t limit) {
@@ -1040,6 +1548,56 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setEvictionSearchLimit(
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setNumMMContainerShards(
+    uint32_t numShards) {
+  numMMContainerShards = numShards;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setEvictionBatchSize(
+    uint32_t batchSize) {
+  evictionBatchSize = batchSize;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableCostAwareEviction(
+    uint32_t numCandidates) {
+  costAwareEvictionCandidates = numCandidates;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setAllocMagazineSize(
+    uint32_t magazineSize) {
+  allocMagazineSize = magazineSize;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableHotKeyReplication(
+    HotKeyReplicationConfig config) {
+  config.validate();
+  hotKeyReplicationConfig.assign(std::move(config));
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableStripedRefcounts(
+    StripedRefcountConfig config) {
+  config.validate();
+  stripedRefcountConfig.assign(std::move(config));
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::enableCoarseClock() {
+  useCoarseClock = true;
+  return *this;
+}
+
 template <typename T>
 CacheAllocatorConfig<T>&
 CacheAllocatorConfig<T>::setRefcountThresholdForConvertingToIOBuf(
@@ -1087,6 +1645,27 @@ CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setDelayCacheWorkersStart() {
   return *this;
 }
 
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setDeferredAttachRestore() {
+  deferredAttachRestore = true;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setShmPrefaultThreads(
+    uint32_t numThreads) {
+  shmPrefaultThreads = numThreads;
+  return *this;
+}
+
+template <typename T>
+CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::setShmPopulate(
+    uint32_t numThreads, bool preallocate) {
+  shmPopulateThreads = numThreads;
+  shmPreallocate = preallocate;
+  return *this;
+}
+
 template <typename T>
 const CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::validate() const {
   // we can track tail hits only if MMType is MM2Q
@@ -1111,6 +1690,91 @@ const CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::validate() const {
         "It's not allowed to enable both RemoveCB and ItemDestructor.");
   }
 
+  if (!folly::isPowTwo(numMMContainerShards) ||
+      numMMContainerShards > kMaxMMContainerShards) {
+    throw std::invalid_argument(folly::sformat(
+        "Number of MMContainer shards must be a power of two no larger than "
+        "{}, but got {}",
+        kMaxMMContainerShards,
+        numMMContainerShards));
+  }
+
+  if (evictionBatchSize == 0 || evictionBatchSize > kMaxEvictionBatchSize) {
+    throw std::invalid_argument(folly::sformat(
+        "Eviction batch size must be between 1 and {}, but got {}",
+        kMaxEvictionBatchSize,
+        evictionBatchSize));
+  }
+
+  if (memoryPageSize != PageSizeT::NORMAL &&
+      memoryPageSize != PageSizeT::TWO_MB &&
+      memoryPageSize != PageSizeT::ONE_GB) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid memory page size {}", static_cast<int>(memoryPageSize)));
+  }
+
+  for (const auto& [poolName, policy] : poolNumaPolicies) {
+    policy.validate();
+  }
+
+  if (allocMagazineSize > AllocationClass::kMaxMagazineSize) {
+    throw std::invalid_argument(folly::sformat(
+        "Alloc magazine size must be at most {}, but got {}",
+        AllocationClass::kMaxMagazineSize,
+        allocMagazineSize));
+  }
+
+  // replicas share the memory of the values they copy but never run their
+  // destructor
+  if (hotKeyReplicationConfig && (itemDestructor || moveCb)) {
+    throw std::invalid_argument(
+        "Hot key replication can not be enabled with an item destructor or a "
+        "move callback.");
+  }
+
+  // both take over the lookups of the hot keys
+  if (hotKeyReplicationConfig && stripedRefcountConfig) {
+    throw std::invalid_argument(
+        "Hot key replication and striped refcounts can not be enabled "
+        "together.");
+  }
+
+  if (allocSizeTuningEnabled() &&
+      (allocSizeTuningSampleRate == 0 ||
+       allocSizeTuningMaxClasses > MemoryAllocator::kMaxClasses)) {
+    throw std::invalid_argument(folly::sformat(
+        "Alloc size tuning needs a non zero sample rate and at most {} "
+        "classes, but got sample rate {} and {} classes",
+        MemoryAllocator::kMaxClasses,
+        allocSizeTuningSampleRate,
+        allocSizeTuningMaxClasses));
+  }
+
+  if (missRatioCurvesEnabled() &&
+      (missRatioCurveSamplingRate > 1 || missRatioCurveMaxSamples == 0 ||
+       missRatioCurveNumBuckets == 0)) {
+    throw std::invalid_argument(folly::sformat(
+        "Miss ratio curves need a sampling rate of at most 1, samples and "
+        "buckets, but got sampling rate {}, {} samples and {} buckets",
+        missRatioCurveSamplingRate,
+        missRatioCurveMaxSamples,
+        missRatioCurveNumBuckets));
+  }
+
+  if (sampledEvictionAgesEnabled() && evictionAgeWindowSize < 2) {
+    throw std::invalid_argument(folly::sformat(
+        "Sampled eviction ages need a window of at least 2 samples, but got "
+        "{}",
+        evictionAgeWindowSize));
+  }
+
+  if (accessContainerResizingEnabled() &&
+      accessContainerResizeBucketsPerRun == 0) {
+    throw std::invalid_argument(
+        "Access container resizing needs to split at least one bucket per "
+        "run");
+  }
+
   return validateMemoryTiers();
 }
 
@@ -1135,7 +1799,9 @@ bool CacheAllocatorConfig<T>::validateStrategy(
 
   auto type = strategy->getType();
   return type != PoolOptimizeStrategy::NumTypes &&
-         (type != PoolOptimizeStrategy::MarginalHits || trackTailHits);
+         (type != PoolOptimizeStrategy::MarginalHits || trackTailHits) &&
+         (type != PoolOptimizeStrategy::PredictedHits ||
+          missRatioCurvesEnabled());
 }
 
 template <typename T>
@@ -1149,6 +1815,18 @@ const CacheAllocatorConfig<T>& CacheAllocatorConfig<T>::validateMemoryTiers()
     parts += tierConfig.getRatio();
   }
 
+  if (memoryTierConfigs.size() > 1) {
+    if (memoryTierPromotionMinHits == 0) {
+      throw std::invalid_argument(
+          "Memory tier promotion needs at least one hit.");
+    }
+    if (!backgroundPromoterEnabled() &&
+        memoryTierPromotionInterval.count() == 0) {
+      throw std::invalid_argument(
+          "Memory tier promotion interval must be positive.");
+    }
+  }
+
   if (parts > size) {
     throw std::invalid_argument(
         "Sum of tier ratios must be less than total cache size.");
@@ -1163,6 +1841,23 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   configMap["size"] = std::to_string(size);
   configMap["cacheDir"] = cacheDir;
   configMap["posixShm"] = isUsingPosixShm() ? "set" : "empty";
+  configMap["memoryPageSize"] =
+      std::to_string(detail::getPageSize(memoryPageSize));
+  configMap["memoryPageSizeFallback"] =
+      memoryPageSizeFallback ? "true" : "false";
+  configMap["poolNumaPolicies"] = "";
+  for (const auto& [poolName, policy] : poolNumaPolicies) {
+    if (configMap["poolNumaPolicies"] != "") {
+      configMap["poolNumaPolicies"] += ", ";
+    }
+    configMap["poolNumaPolicies"] +=
+        folly::sformat("{}:{}", poolName, policy.toString());
+  }
+  configMap["memoryTiers"] = std::to_string(memoryTierConfigs.size());
+  configMap["memoryTierPromotionMinHits"] =
+      std::to_string(memoryTierPromotionMinHits);
+  configMap["memoryTierPromotionInterval"] =
+      util::toString(memoryTierPromotionInterval);
 
   configMap["defaultAllocSizes"] = "";
   // Stringify std::set
@@ -1182,6 +1877,8 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   configMap["poolRebalanceInterval"] = util::toString(poolRebalanceInterval);
   configMap["slabReleaseStuckThreshold"] =
       util::toString(slabReleaseStuckThreshold);
+  configMap["slabReleaseMoveBatchSize"] =
+      std::to_string(slabReleaseMoveBatchSize);
   configMap["trackTailHits"] = std::to_string(trackTailHits);
   // Stringify enum
   switch (memMonitorConfig.mode) {
@@ -1191,6 +1888,9 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   case MemoryMonitor::ResidentMemory:
     configMap["memMonitorMode"] = "Resident Memory";
     break;
+  case MemoryMonitor::CgroupMemory:
+    configMap["memMonitorMode"] = "Cgroup Memory";
+    break;
   case MemoryMonitor::Disabled:
     configMap["memMonitorMode"] = "Disabled";
     break;
@@ -1208,9 +1908,57 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   configMap["memUpperLimitGB"] = std::to_string(memMonitorConfig.upperLimitGB);
   configMap["reclaimRateLimitWindowSecs"] =
       std::to_string(memMonitorConfig.reclaimRateLimitWindowSecs.count());
+  configMap["memCgroupDir"] = memMonitorConfig.cgroupDir;
+  configMap["memPressureThresholdPct"] =
+      std::to_string(memMonitorConfig.pressureThresholdPct);
+  configMap["memPressureAdviseMultiplier"] =
+      std::to_string(memMonitorConfig.pressureAdviseMultiplier);
+  configMap["memAdviseBatchSize"] =
+      std::to_string(memMonitorConfig.adviseBatchSize);
+  configMap["poolRebalancerThreads"] = std::to_string(poolRebalancerThreads);
   configMap["reaperInterval"] = util::toString(reaperInterval);
+  configMap["reaperExpiryIndex"] = reaperExpiryIndex ? "true" : "false";
+  configMap["reaperFullScanInterval"] = std::to_string(reaperFullScanInterval);
   configMap["mmReconfigureInterval"] = util::toString(mmReconfigureInterval);
   configMap["evictionSearchTries"] = std::to_string(evictionSearchTries);
+  configMap["numMMContainerShards"] = std::to_string(numMMContainerShards);
+  configMap["evictionBatchSize"] = std::to_string(evictionBatchSize);
+  configMap["costAwareEvictionCandidates"] =
+      std::to_string(costAwareEvictionCandidates);
+  configMap["allocMagazineSize"] = std::to_string(allocMagazineSize);
+  configMap["hotKeyReplication"] =
+      hotKeyReplicationConfig
+          ? std::to_string(hotKeyReplicationConfig->replicasPerShard)
+          : "empty";
+  configMap["useCoarseClock"] = useCoarseClock ? "true" : "false";
+  configMap["stripedRefcounts"] =
+      stripedRefcountConfig ? std::to_string(stripedRefcountConfig->maxItems)
+                            : "empty";
+  configMap["allocSizeTuningInterval"] =
+      util::toString(allocSizeTuningInterval);
+  configMap["allocSizeTuningSampleRate"] =
+      std::to_string(allocSizeTuningSampleRate);
+  configMap["allocSizeTuningMaxClasses"] =
+      std::to_string(allocSizeTuningMaxClasses);
+  configMap["missRatioCurveSamplingRate"] =
+      std::to_string(missRatioCurveSamplingRate);
+  configMap["missRatioCurveMaxSamples"] =
+      std::to_string(missRatioCurveMaxSamples);
+  configMap["missRatioCurveNumBuckets"] =
+      std::to_string(missRatioCurveNumBuckets);
+  configMap["evictionAgeSampleRate"] = std::to_string(evictionAgeSampleRate);
+  configMap["evictionAgeWindowSize"] = std::to_string(evictionAgeWindowSize);
+  configMap["accessContainerResizeInterval"] =
+      util::toString(accessContainerResizeInterval);
+  configMap["accessContainerResizeBucketsPerRun"] =
+      std::to_string(accessContainerResizeBucketsPerRun);
+  configMap["statsSnapshotInterval"] = util::toString(statsSnapshotInterval);
+  configMap["deferredReleaseInterval"] =
+      util::toString(deferredReleaseInterval);
+  configMap["deferredReleaseMaxPending"] =
+      std::to_string(deferredReleaseMaxPending);
+  configMap["deferredReleaseBatchSize"] =
+      std::to_string(deferredReleaseBatchSize);
   configMap["thresholdForConvertingToIOBuf"] =
       std::to_string(thresholdForConvertingToIOBuf);
   configMap["movingTries"] = std::to_string(movingTries);
@@ -1218,6 +1966,10 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   configMap["removeCb"] = removeCb ? "set" : "empty";
   configMap["nvmAP"] = nvmCacheAP ? "custom" : "empty";
   configMap["nvmAPRejectFirst"] = rejectFirstAPNumEntries ? "set" : "empty";
+  configMap["nvmAPWriteBudget"] =
+      writeBudgetAPConfig
+          ? std::to_string(writeBudgetAPConfig->targetBytesPerSec)
+          : "empty";
   configMap["moveCb"] = moveCb ? "set" : "empty";
   configMap["enableZeroedSlabAllocs"] = std::to_string(enableZeroedSlabAllocs);
   configMap["lockMemory"] = std::to_string(lockMemory);
@@ -1238,6 +1990,11 @@ std::map<std::string, std::string> CacheAllocatorConfig<T>::serialize() const {
   configMap["nvmAdmissionMinTTL"] = std::to_string(nvmAdmissionMinTTL);
   configMap["delayCacheWorkersStart"] =
       delayCacheWorkersStart ? "true" : "false";
+  configMap["deferredAttachRestore"] =
+      deferredAttachRestore ? "true" : "false";
+  configMap["shmPrefaultThreads"] = std::to_string(shmPrefaultThreads);
+  configMap["shmPopulateThreads"] = std::to_string(shmPopulateThreads);
+  configMap["shmPreallocate"] = shmPreallocate ? "true" : "false";
   mergeWithPrefix(configMap, throttleConfig.serialize(), "throttleConfig");
   mergeWithPrefix(configMap,
                   chainedItemAccessConfig.serialize(),
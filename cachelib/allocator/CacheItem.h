@@ -20,6 +20,8 @@
 #include <folly/String.h>
 
 #include <atomic>
+#include <chrono>
+#include <type_traits>
 #include <utility>
 
 #include "cachelib/allocator/Cache.h"
@@ -65,9 +67,111 @@ class NvmCache;
 template <typename Cache, typename Handle, typename Iter>
 class CacheChainedAllocs;
 
+template <typename Cache, typename Handle>
+class CacheLargeItem;
+
 template <typename K, typename V, typename C>
 class Map;
 
+namespace detail {
+// Creation and expiry timestamps of an item, in seconds. An expiry time of 0
+// means the item never expires.
+template <bool kHasExpiryTime>
+class CACHELIB_PACKED_ATTR ItemTimestamps {
+ public:
+  ItemTimestamps(uint32_t creationTime, uint32_t expiryTime) noexcept
+      : creationTime_(creationTime), expiryTime_(expiryTime) {}
+
+  uint32_t getCreationTime() const noexcept { return creationTime_; }
+
+  uint32_t getExpiryTime() const noexcept { return expiryTime_; }
+
+  // atomically replace the expiry time.
+  //
+  // @return true
+  bool setExpiryTime(uint32_t expiryTime) noexcept {
+    while (true) {
+      uint32_t currExpTime = expiryTime_;
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Watomic-alignment"
+      if (__atomic_compare_exchange_n(&expiryTime_, &currExpTime, expiryTime,
+                                      false, __ATOMIC_SEQ_CST,
+                                      __ATOMIC_SEQ_CST)) {
+#pragma clang diagnostic pop
+        return true;
+      }
+    }
+  }
+
+ private:
+  const uint32_t creationTime_{0};
+  uint32_t expiryTime_{0};
+};
+
+// Timestamps of the items of a cache without TTLs. They only keep the
+// creation time, which saves 4 bytes per item.
+template <>
+class CACHELIB_PACKED_ATTR ItemTimestamps<false> {
+ public:
+  ItemTimestamps(uint32_t creationTime,
+                 uint32_t /* expiryTime */ = 0) noexcept
+      : creationTime_(creationTime) {}
+
+  uint32_t getCreationTime() const noexcept { return creationTime_; }
+
+  uint32_t getExpiryTime() const noexcept { return 0; }
+
+  // @return false, the items never expire
+  bool setExpiryTime(uint32_t /* expiryTime */) noexcept { return false; }
+
+ private:
+  const uint32_t creationTime_{0};
+};
+
+// Items keep an expiry time unless their cache trait declares
+// `static constexpr bool kItemExpiryTime = false;`.
+template <typename CacheTrait, typename = void>
+struct HasItemExpiryTime : std::true_type {};
+
+template <typename CacheTrait>
+struct HasItemExpiryTime<CacheTrait,
+                         std::void_t<decltype(CacheTrait::kItemExpiryTime)>>
+    : std::integral_constant<bool, CacheTrait::kItemExpiryTime> {};
+
+// The same goes for the optional features of the allocator, which a cache
+// trait turns off by declaring them false:
+//   kNvmCache       the hybrid cache with navy
+//   kChainedItems   chained items, and the large items made of them
+//   kItemCallbacks  the remove callback and the item destructor
+// The allocator throws on the configs and calls that need a feature its trait
+// turned off, and the checks for it on the hot paths compile away.
+template <typename CacheTrait, typename = void>
+struct HasNvmCacheFeature : std::true_type {};
+
+template <typename CacheTrait>
+struct HasNvmCacheFeature<CacheTrait,
+                          std::void_t<decltype(CacheTrait::kNvmCache)>>
+    : std::integral_constant<bool, CacheTrait::kNvmCache> {};
+
+template <typename CacheTrait, typename = void>
+struct HasChainedItemsFeature : std::true_type {};
+
+template <typename CacheTrait>
+struct HasChainedItemsFeature<
+    CacheTrait,
+    std::void_t<decltype(CacheTrait::kChainedItems)>>
+    : std::integral_constant<bool, CacheTrait::kChainedItems> {};
+
+template <typename CacheTrait, typename = void>
+struct HasItemCallbacksFeature : std::true_type {};
+
+template <typename CacheTrait>
+struct HasItemCallbacksFeature<
+    CacheTrait,
+    std::void_t<decltype(CacheTrait::kItemCallbacks)>>
+    : std::integral_constant<bool, CacheTrait::kItemCallbacks> {};
+} // namespace detail
+
 // This is the actual representation of the cache item. It has two member
 // hooks of type MMType::Hook and AccessType::Hook to ensure that the CacheItem
 // can be put in the MMType::Container and AccessType::Container.
@@ -103,7 +207,7 @@ class CACHELIB_PACKED_ATTR CacheItem {
    *  | Intrusive Hooks   |
    *  | Reference & Flags |
    *  | Creation Time     |
-   *  | Expiry Time       |
+   *  | Expiry Time       | (unless the cache trait disables it)
    *  | Payload           |
    *  ---------------------
    *
@@ -119,6 +223,17 @@ class CACHELIB_PACKED_ATTR CacheItem {
   using MMHook = typename CacheTrait::MMType::template Hook<Item>;
   using Key = KAllocation::Key;
 
+  // whether the items keep an expiry time. Without it items can not be
+  // given a TTL and are 4 bytes smaller.
+  static constexpr bool kHasExpiryTime =
+      detail::HasItemExpiryTime<CacheTrait>::value;
+  using Timestamps = detail::ItemTimestamps<kHasExpiryTime>;
+
+  // whether the items can be chained. Without it isChainedItem and
+  // hasChainedItem are constants.
+  static constexpr bool kHasChainedItems =
+      detail::HasChainedItemsFeature<CacheTrait>::value;
+
   /**
    * User primarily interacts with an item through its handle.
    * An item handle is essentially a std::shared_ptr like structure
@@ -224,6 +339,10 @@ class CACHELIB_PACKED_ATTR CacheItem {
   bool isChainedItem() const noexcept;
   bool hasChainedItem() const noexcept;
 
+  // whether the item was allocated as the parent of a large item. Only the
+  // cache marks items this way, never the payload.
+  bool isLargeItem() const noexcept;
+
   /**
    * Keep track of whether the item was modified while in ram cache
    */
@@ -239,6 +358,19 @@ class CACHELIB_PACKED_ATTR CacheItem {
   void unmarkNvmEvicted() noexcept;
   bool isNvmEvicted() const noexcept;
 
+  /**
+   * Hint of how expensive the item is to recompute on a miss, used by the
+   * cost aware eviction (CacheAllocatorConfig::enableCostAwareEviction).
+   * Levels go from 0, the default and cheapest, to kMaxCostLevel on a log
+   * scale: an item of a level costs about 4 times more than one of the
+   * previous level. getCostLevelFor() maps a recompute time to a level.
+   * The level of an item passed over by an eviction decays by one.
+   */
+  static constexpr uint8_t kMaxCostLevel = RefcountWithFlags::kMaxCostLevel;
+  void setCostLevel(uint8_t level) noexcept;
+  uint8_t getCostLevel() const noexcept;
+  static uint8_t getCostLevelFor(std::chrono::microseconds cost) noexcept;
+
   /**
    * Function to set the timestamp for when to expire an item
    *
@@ -250,7 +382,7 @@ class CACHELIB_PACKED_ATTR CacheItem {
    *
    * @return boolean indicating whether expiry time was successfully updated
    *         false when item is not linked in cache, or in exclusive state, or a
-   *         chained item
+   *         chained item, or when the items have no expiry time
    */
   bool updateExpiryTime(uint32_t expiryTimeSecs) noexcept;
 
@@ -316,6 +448,20 @@ class CACHELIB_PACKED_ATTR CacheItem {
     }
   }
 
+  // Increments item's ref count only if the item is accessible and not
+  // marked as exclusive.
+  //
+  // @return true on success
+  // @throw exception::RefcountOverflow on ref count overflow
+  FOLLY_ALWAYS_INLINE bool incRefIfAccessible() {
+    try {
+      return ref_.incRefIfAccessible();
+    } catch (exception::RefcountOverflow& e) {
+      throw exception::RefcountOverflow(
+          folly::sformat("{} item: {}", e.what(), toString()));
+    }
+  }
+
   FOLLY_ALWAYS_INLINE RefcountWithFlags::Value decRef() {
     return ref_.decRef();
   }
@@ -377,6 +523,11 @@ class CACHELIB_PACKED_ATTR CacheItem {
   RefcountWithFlags::Value unmarkMoving() noexcept;
   bool isMoving() const noexcept;
 
+  /** Marks the item moving on behalf of the holder of its only handle. The
+   * handle's ref becomes the moving ref. See markMovingWhenOnlyRef() in
+   * Refcount.h */
+  bool markMovingWhenOnlyRef();
+
   /** This function attempts to mark item as exclusive.
    * Can only be called on the item that is moving.*/
   bool markForEvictionWhenMoving();
@@ -389,6 +540,7 @@ class CACHELIB_PACKED_ATTR CacheItem {
   void unmarkIsChainedItem() noexcept;
   void markHasChainedItem() noexcept;
   void unmarkHasChainedItem() noexcept;
+  void markLargeItem() noexcept;
   ChainedItem& asChainedItem() noexcept;
   const ChainedItem& asChainedItem() const noexcept;
 
@@ -430,12 +582,9 @@ class CACHELIB_PACKED_ATTR CacheItem {
   // Refcount for the item and also flags on the items state
   RefcountWithFlags ref_;
 
-  // Time when this cache item is created
-  const uint32_t creationTime_{0};
-
-  // Expiry timestamp for the item
-  // 0 means no time limitation
-  uint32_t expiryTime_{0};
+  // Time when this cache item is created and its expiry timestamp. An expiry
+  // time of 0 means no time limitation.
+  Timestamps timestamps_;
 
   // The actual allocation.
   KAllocation alloc_;
@@ -447,6 +596,8 @@ class CACHELIB_PACKED_ATTR CacheItem {
   friend NvmCacheT;
   template <typename Cache, typename Handle, typename Iter>
   friend class CacheChainedAllocs;
+  template <typename Cache, typename Handle>
+  friend class CacheLargeItem;
   template <typename Cache, typename Item>
   friend class CacheChainedItemIterator;
   friend class facebook::cachelib::tests::CacheAllocatorTestWrapper;
@@ -463,6 +614,7 @@ class CACHELIB_PACKED_ATTR CacheItem {
   FRIEND_TEST(ItemTest, ToString);
   FRIEND_TEST(ItemTest, CreationTime);
   FRIEND_TEST(ItemTest, ExpiryTime);
+  FRIEND_TEST(ItemTest, NoExpiryTime);
   FRIEND_TEST(ItemTest, ChainedItemConstruction);
   FRIEND_TEST(ItemTest, NonStringKey);
   template <typename AllocatorT>
@@ -478,7 +630,7 @@ class CACHELIB_PACKED_ATTR CacheItem {
 // | AccessHook            |
 // | MMHook                |
 // | RefCountWithFlags     |
-// | creationTime_         |
+// | timestamps_           |
 // | --------------------- |
 // |  K | size_            |
 // |  A | ---------------- |
@@ -569,6 +721,8 @@ class CACHELIB_PACKED_ATTR CacheChainedItem : public CacheItem<CacheTrait> {
   friend CacheAllocator<CacheTrait>;
   template <typename Cache, typename Handle, typename Iter>
   friend class CacheChainedAllocs;
+  template <typename Cache, typename Handle>
+  friend class CacheLargeItem;
   template <typename Cache, typename Item>
   friend class CacheChainedItemIterator;
   friend NvmCache<CacheAllocator<CacheTrait>>;
@@ -604,7 +758,9 @@ CacheItem<CacheTrait>::CacheItem(Key key,
                                  uint32_t size,
                                  uint32_t creationTime,
                                  uint32_t expiryTime)
-    : creationTime_(creationTime), expiryTime_(expiryTime), alloc_(key, size) {}
+    : timestamps_(creationTime, expiryTime), alloc_(key, size) {
+  XDCHECK(kHasExpiryTime || expiryTime == 0);
+}
 
 template <typename CacheTrait>
 CacheItem<CacheTrait>::CacheItem(Key key, uint32_t size, uint32_t creationTime)
@@ -659,18 +815,19 @@ uint32_t CacheItem<CacheTrait>::getTotalSize() const noexcept {
 
 template <typename CacheTrait>
 uint32_t CacheItem<CacheTrait>::getExpiryTime() const noexcept {
-  return expiryTime_;
+  return timestamps_.getExpiryTime();
 }
 
 template <typename CacheTrait>
 bool CacheItem<CacheTrait>::isExpired() const noexcept {
   thread_local uint32_t staleTime = 0;
 
-  if (expiryTime_ == 0) {
+  const uint32_t expiryTime = getExpiryTime();
+  if (expiryTime == 0) {
     return false;
   }
 
-  if (expiryTime_ < staleTime) {
+  if (expiryTime < staleTime) {
     return true;
   }
 
@@ -678,23 +835,25 @@ bool CacheItem<CacheTrait>::isExpired() const noexcept {
   if (currentTime != staleTime) {
     staleTime = currentTime;
   }
-  return expiryTime_ < currentTime;
+  return expiryTime < currentTime;
 }
 
 template <typename CacheTrait>
 bool CacheItem<CacheTrait>::isExpired(uint32_t currentTimeSec) const noexcept {
-  return (expiryTime_ > 0 && expiryTime_ < currentTimeSec);
+  const uint32_t expiryTime = getExpiryTime();
+  return (expiryTime > 0 && expiryTime < currentTimeSec);
 }
 
 template <typename CacheTrait>
 uint32_t CacheItem<CacheTrait>::getCreationTime() const noexcept {
-  return creationTime_;
+  return timestamps_.getCreationTime();
 }
 
 template <typename CacheTrait>
 std::chrono::seconds CacheItem<CacheTrait>::getConfiguredTTL() const noexcept {
-  return std::chrono::seconds(expiryTime_ > 0 ? expiryTime_ - creationTime_
-                                              : 0);
+  const uint32_t expiryTime = getExpiryTime();
+  return std::chrono::seconds(expiryTime > 0 ? expiryTime - getCreationTime()
+                                             : 0);
 }
 
 template <typename CacheTrait>
@@ -804,6 +963,11 @@ bool CacheItem<CacheTrait>::markMoving() {
   return ref_.markMoving();
 }
 
+template <typename CacheTrait>
+bool CacheItem<CacheTrait>::markMovingWhenOnlyRef() {
+  return ref_.markMovingWhenOnlyRef();
+}
+
 template <typename CacheTrait>
 RefcountWithFlags::Value CacheItem<CacheTrait>::unmarkMoving() noexcept {
   return ref_.unmarkMoving();
@@ -844,6 +1008,29 @@ bool CacheItem<CacheTrait>::isNvmEvicted() const noexcept {
   return ref_.isNvmEvicted();
 }
 
+template <typename CacheTrait>
+void CacheItem<CacheTrait>::setCostLevel(uint8_t level) noexcept {
+  ref_.setCostLevel(level);
+}
+
+template <typename CacheTrait>
+uint8_t CacheItem<CacheTrait>::getCostLevel() const noexcept {
+  return ref_.getCostLevel();
+}
+
+template <typename CacheTrait>
+uint8_t CacheItem<CacheTrait>::getCostLevelFor(
+    std::chrono::microseconds cost) noexcept {
+  // level 0 up to 10us, then 4 times more per level: 40us, 160us, 640us,
+  // 2.56ms, 10.24ms, 40.96ms and beyond
+  uint8_t level = 0;
+  for (auto limit = std::chrono::microseconds{10};
+       cost > limit && level < kMaxCostLevel; limit *= 4) {
+    ++level;
+  }
+  return level;
+}
+
 template <typename CacheTrait>
 void CacheItem<CacheTrait>::markIsChainedItem() noexcept {
   XDCHECK(!hasChainedItem());
@@ -868,6 +1055,17 @@ void CacheItem<CacheTrait>::unmarkHasChainedItem() noexcept {
   ref_.unmarkHasChainedItem();
 }
 
+template <typename CacheTrait>
+void CacheItem<CacheTrait>::markLargeItem() noexcept {
+  XDCHECK(!isChainedItem());
+  ref_.markLargeItem();
+}
+
+template <typename CacheTrait>
+bool CacheItem<CacheTrait>::isLargeItem() const noexcept {
+  return ref_.isLargeItem();
+}
+
 template <typename CacheTrait>
 typename CacheItem<CacheTrait>::ChainedItem&
 CacheItem<CacheTrait>::asChainedItem() noexcept {
@@ -882,12 +1080,12 @@ CacheItem<CacheTrait>::asChainedItem() const noexcept {
 
 template <typename CacheTrait>
 bool CacheItem<CacheTrait>::isChainedItem() const noexcept {
-  return ref_.isChainedItem();
+  return kHasChainedItems && ref_.isChainedItem();
 }
 
 template <typename CacheTrait>
 bool CacheItem<CacheTrait>::hasChainedItem() const noexcept {
-  return ref_.hasChainedItem();
+  return kHasChainedItems && ref_.hasChainedItem();
 }
 
 template <typename CacheTrait>
@@ -918,17 +1116,7 @@ bool CacheItem<CacheTrait>::updateExpiryTime(uint32_t expiryTimeSecs) noexcept {
     return false;
   }
   // attempt to atomically update the value of expiryTime
-  while (true) {
-    uint32_t currExpTime = expiryTime_;
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Watomic-alignment"
-    if (__atomic_compare_exchange_n(&expiryTime_, &currExpTime, expiryTimeSecs,
-                                    false, __ATOMIC_SEQ_CST,
-                                    __ATOMIC_SEQ_CST)) {
-#pragma clang diagnostic pop
-      return true;
-    }
-  }
+  return timestamps_.setExpiryTime(expiryTimeSecs);
 }
 
 template <typename CacheTrait>
@@ -50,12 +50,16 @@ struct SizeVerify {};
 
 void Stats::populateGlobalCacheStats(GlobalCacheStats& ret) const {
 #ifndef SKIP_SIZE_VERIFY
-  SizeVerify<sizeof(Stats)> a = SizeVerify<16368>{};
+  SizeVerify<sizeof(Stats)> a = SizeVerify<16544>{};
   std::ignore = a;
 #endif
   ret.numCacheGets = numCacheGets.get();
   ret.numCacheGetMiss = numCacheGetMiss.get();
   ret.numCacheGetExpiries = numCacheGetExpiries.get();
+  ret.numHotKeyReplicaHits = numHotKeyReplicaHits.get();
+  ret.numHotKeyReplicasCreated = numHotKeyReplicasCreated.get();
+  ret.numStripedRefcountHits = numStripedRefcountHits.get();
+  ret.numStripedRefcountsCreated = numStripedRefcountsCreated.get();
   ret.numCacheRemoves = numCacheRemoves.get();
   ret.numCacheRemoveRamHits = numCacheRemoveRamHits.get();
   ret.numCacheEvictions = numCacheEvictions.get();
@@ -65,15 +69,28 @@ void Stats::populateGlobalCacheStats(GlobalCacheStats& ret) const {
   ret.numNvmGets = numNvmGets.get();
   ret.numNvmGetMiss = numNvmGetMiss.get();
   ret.numNvmGetMissFast = numNvmGetMissFast.get();
+  ret.numNvmGetMissNegativeCache = numNvmGetMissNegativeCache.get();
   ret.numNvmGetMissExpired = numNvmGetMissExpired.get();
   ret.numNvmGetMissDueToInflightRemove = numNvmGetMissDueToInflightRemove.get();
   ret.numNvmGetMissErrs = numNvmGetMissErrs.get();
   ret.numNvmGetCoalesced = numNvmGetCoalesced.get();
+  ret.numNvmPrefetches = numNvmPrefetches.get();
+  ret.numNvmPrefetchSkipped = numNvmPrefetchSkipped.get();
+  ret.numNvmPrefetchFilled = numNvmPrefetchFilled.get();
+  ret.numNvmPrefetchCancelled = numNvmPrefetchCancelled.get();
+  ret.numNvmGetServedWithoutFill = numNvmGetServedWithoutFill.get();
   ret.numNvmPuts = numNvmPuts.get();
   ret.numNvmDeletes = numNvmDeletes.get();
   ret.numNvmSkippedDeletes = numNvmSkippedDeletes.get();
   ret.numNvmPutErrs = numNvmPutErrs.get();
   ret.numNvmPutEncodeFailure = numNvmPutEncodeFailure.get();
+  ret.numNvmCompressed = numNvmCompressed.get();
+  ret.numNvmCompressSkipped = numNvmCompressSkipped.get();
+  ret.nvmCompressBytesIn = nvmCompressBytesIn.get();
+  ret.nvmCompressBytesOut = nvmCompressBytesOut.get();
+  ret.nvmCompressNs = nvmCompressNs.get();
+  ret.nvmDecompressNs = nvmDecompressNs.get();
+  ret.numNvmDecompressErrors = numNvmDecompressErrors.get();
   ret.numNvmAbortedPutOnTombstone += numNvmAbortedPutOnTombstone.get();
   ret.numNvmCompactionFiltered += numNvmCompactionFiltered.get();
   ret.numNvmAbortedPutOnInflightGet = numNvmAbortedPutOnInflightGet.get();
@@ -141,6 +158,13 @@ void Stats::populateGlobalCacheStats(GlobalCacheStats& ret) const {
   ret.numAbortedSlabReleases = numAbortedSlabReleases.get();
   ret.numReaperSkippedSlabs = numReaperSkippedSlabs.get();
 
+  ret.numMemoryTierDemotions = numMemoryTierDemotions.get();
+  ret.numMemoryTierDemotionFailures = numMemoryTierDemotionFailures.get();
+  ret.numMemoryTierPromotionsQueued = numMemoryTierPromotionsQueued.get();
+  ret.numMemoryTierPromotionsDropped = numMemoryTierPromotionsDropped.get();
+  ret.numMemoryTierPromotions = numMemoryTierPromotions.get();
+  ret.numMemoryTierPromotionFailures = numMemoryTierPromotionFailures.get();
+
   ret.numHandleWaitBlocks = numHandleWaitBlocks.get();
   ret.numExpensiveStatsPolled = numExpensiveStatsPolled.get();
 }
@@ -201,6 +225,9 @@ PoolStats& PoolStats::operator+=(const PoolStats& other) {
       d.numHotAccesses += s.numHotAccesses;
       d.numColdAccesses += s.numColdAccesses;
       d.numWarmAccesses += s.numWarmAccesses;
+      d.numLockContended += s.numLockContended;
+      d.numLockWaitSampled += s.numLockWaitSampled;
+      d.lockWaitNs += s.lockWaitNs;
     }
 
     // aggregate ac stats
@@ -26,6 +26,7 @@
 #include "cachelib/allocator/memory/MemoryAllocatorStats.h"
 #include "cachelib/allocator/memory/Slab.h"
 #include "cachelib/common/FastStats.h"
+#include "cachelib/common/LockContentionStats.h"
 #include "cachelib/common/PercentileStats.h"
 #include "cachelib/common/Time.h"
 
@@ -44,6 +45,20 @@ struct EvictionStatPerType {
   uint64_t projectedAge = 0ULL;
 };
 
+// percentiles of the ages of the items recently evicted from an allocation
+// class, sampled by the EvictionAgeSampler without locking the MM container.
+// Empty unless sampled eviction ages are enabled.
+struct SampledEvictionAgeStat {
+  // number of samples the percentiles are estimated from
+  uint64_t numSamples = 0ULL;
+
+  // percentiles of the eviction ages in seconds
+  uint64_t p10 = 0ULL;
+  uint64_t p50 = 0ULL;
+  uint64_t p90 = 0ULL;
+  uint64_t p99 = 0ULL;
+};
+
 // stats class for one MM container (a.k.a one allocation class) related to
 // evictions
 struct EvictionAgeStat {
@@ -52,6 +67,8 @@ struct EvictionAgeStat {
   EvictionStatPerType hotQueueStat;
 
   EvictionStatPerType coldQueueStat;
+
+  SampledEvictionAgeStat sampledStat;
 };
 
 // stats related to evictions for a pool
@@ -74,6 +91,10 @@ struct PoolEvictionAgeStats {
   const EvictionStatPerType& getColdEvictionStat(ClassId cid) const {
     return classEvictionAgeStats.at(cid).coldQueueStat;
   }
+
+  const SampledEvictionAgeStat& getSampledEvictionStat(ClassId cid) const {
+    return classEvictionAgeStats.at(cid).sampledStat;
+  }
 };
 
 // Stats for MM container
@@ -95,6 +116,13 @@ struct MMContainerStat {
   uint64_t numColdAccesses;
   uint64_t numWarmAccesses;
   uint64_t numTailAccesses;
+
+  // contention on the container lock. Only tracked by MMLru when its
+  // lockContentionSampleRate is set. numLockContended acquisitions found the
+  // lock held and numLockWaitSampled of them waited lockWaitNs in total.
+  uint64_t numLockContended{0};
+  uint64_t numLockWaitSampled{0};
+  uint64_t lockWaitNs{0};
 };
 
 // cache related stats for a given allocation class.
@@ -258,6 +286,21 @@ struct SlabReleaseStats {
   uint64_t numEvictionAttempts;
   uint64_t numEvictionSuccesses;
   uint64_t numSlabReleaseStuck;
+  // number of batches the items of released slabs were moved in
+  uint64_t numMoveBatches;
+
+  // fraction of the items of released slabs that were moved rather than
+  // evicted
+  double getMovedRatio() const {
+    const auto total = numMoveSuccesses + numEvictionSuccesses;
+    return total ? static_cast<double>(numMoveSuccesses) / total : 0;
+  }
+
+  // fraction of the items of released slabs that were evicted
+  double getEvictedRatio() const {
+    const auto total = numMoveSuccesses + numEvictionSuccesses;
+    return total ? static_cast<double>(numEvictionSuccesses) / total : 0;
+  }
 };
 
 // Stats for reaper
@@ -270,6 +313,10 @@ struct ReaperStats {
 
   uint64_t numVisitErrs{0};
 
+  // number of slabs not walked because the expiry index had no item due to
+  // expire in them
+  uint64_t numIndexSkippedSlabs{0};
+
   // number of times we went through the whole cache
   uint64_t numTraversals{0};
 
@@ -322,6 +369,21 @@ struct BackgroundMoverStats {
   }
 };
 
+// Stats of one memory tier of a cache configured with several tiers
+struct MemoryTierStats {
+  // number of lookups that hit an item while it was in this tier
+  uint64_t numHits{0};
+
+  // number of items demoted from this tier to the next one on eviction
+  uint64_t numDemotions{0};
+
+  // number of items promoted into this tier from the next one
+  uint64_t numPromotions{0};
+
+  // total size in bytes of the pools placed on this tier
+  uint64_t poolSize{0};
+};
+
 // CacheMetadata type to export
 struct CacheMetadata {
   // allocator_version
@@ -357,6 +419,20 @@ struct GlobalCacheStats {
   // in the numCacheGetMiss stats above.
   uint64_t numCacheGetExpiries{0};
 
+  // number of such calls served from a replica of a hot key. These are also
+  // included in numCacheGets.
+  uint64_t numHotKeyReplicaHits{0};
+
+  // number of replicas of hot keys made
+  uint64_t numHotKeyReplicasCreated{0};
+
+  // number of such calls whose reference is counted on a striped refcount.
+  // These are also included in numCacheGets.
+  uint64_t numStripedRefcountHits{0};
+
+  // number of items given a striped refcount
+  uint64_t numStripedRefcountsCreated{0};
+
   // number of remove calls to CacheAllocator::remove that requires
   // a lookup first and then remove the item
   uint64_t numCacheRemoves{0};
@@ -382,12 +458,34 @@ struct GlobalCacheStats {
   // number of nvm misses that happened synchronously
   uint64_t numNvmGetMissFast{0};
 
+  // number of nvm misses answered by the negative lookup cache. These are
+  // also counted as fast misses.
+  uint64_t numNvmGetMissNegativeCache{0};
+
   // number of nvm gets that are expired
   uint64_t numNvmGetMissExpired{0};
 
   // number of gets that joined a concurrent fill for same item
   uint64_t numNvmGetCoalesced{0};
 
+  // number of prefetches looked up in nvm. These are also counted as nvm gets
+  // and their misses as nvm get misses.
+  uint64_t numNvmPrefetches{0};
+
+  // number of prefetched keys skipped: already in dram or being fetched,
+  // written or removed, known to miss, or over the inflight limit
+  uint64_t numNvmPrefetchSkipped{0};
+
+  // number of prefetches that filled the item into dram
+  uint64_t numNvmPrefetchFilled{0};
+
+  // number of prefetches cancelled because they did not start in time
+  uint64_t numNvmPrefetchCancelled{0};
+
+  // number of nvm hits handed out without inserting the item into dram
+  // during the warm up
+  uint64_t numNvmGetServedWithoutFill{0};
+
   // number of deletes issues to nvm
   uint64_t numNvmDeletes{0};
 
@@ -403,6 +501,25 @@ struct GlobalCacheStats {
   // number of put failures due to encode call back
   uint64_t numNvmPutEncodeFailure{0};
 
+  // number of values written to nvm compressed
+  uint64_t numNvmCompressed{0};
+
+  // number of values of compressed pools written uncompressed because they
+  // were too small or did not compress well enough
+  uint64_t numNvmCompressSkipped{0};
+
+  // uncompressed and compressed bytes of the values written compressed. Their
+  // ratio is the compression ratio.
+  uint64_t nvmCompressBytesIn{0};
+  uint64_t nvmCompressBytesOut{0};
+
+  // time spent compressing and decompressing values, in nanoseconds
+  uint64_t nvmCompressNs{0};
+  uint64_t nvmDecompressNs{0};
+
+  // number of values read from nvm that could not be decompressed
+  uint64_t numNvmDecompressErrors{0};
+
   // number of puts that observed an inflight delete and aborted
   uint64_t numNvmAbortedPutOnTombstone{0};
 
@@ -551,6 +668,29 @@ struct GlobalCacheStats {
   // Number of times slab was skipped when reaper runs
   uint64_t numReaperSkippedSlabs{0};
 
+  // stats of every memory tier, top tier first. Empty when the cache is
+  // configured with a single tier.
+  std::vector<MemoryTierStats> memoryTierStats;
+
+  // items moved between memory tiers. A failed demotion evicts the item
+  // instead, and a failed promotion leaves it in the lower tier. Promotions
+  // are dropped when too many of them are already queued.
+  uint64_t numMemoryTierDemotions{0};
+  uint64_t numMemoryTierDemotionFailures{0};
+  uint64_t numMemoryTierPromotionsQueued{0};
+  uint64_t numMemoryTierPromotionsDropped{0};
+  uint64_t numMemoryTierPromotions{0};
+  uint64_t numMemoryTierPromotionFailures{0};
+
+  // latency of moving one item down or up a memory tier
+  util::PercentileStats::Estimates memoryTierDemoteLatencyNs{};
+  util::PercentileStats::Estimates memoryTierPromoteLatencyNs{};
+
+  // sampled contention on the access container locks, with its most
+  // contended locks. Empty unless the access config sets a lock contention
+  // sample rate.
+  util::LockContentionStats::Snapshot accessContainerLockContention{};
+
   // current active handles outstanding. This stat should
   // not go to negative. If it's negative, it means we have
   // leaked handles (or some sort of accounting bug internally)
@@ -658,6 +798,20 @@ struct CCacheStats {
   }
 };
 
+// Progress of the resize of a compact cache
+struct CCacheResizeStats {
+  // whether a resize is migrating entries
+  bool inProgress{false};
+
+  // chunks rehashed by the current resize and the total it has to rehash.
+  // Every old chunk is rehashed twice, to copy and then delete entries.
+  uint64_t chunksRehashed{0};
+  uint64_t chunksToRehash{0};
+
+  // number of resizes that completed
+  uint64_t resizesCompleted{0};
+};
+
 class RateMap {
  public:
   static constexpr std::chrono::seconds kRateInterval{60};
@@ -44,6 +44,18 @@ struct Stats {
   // in the numCacheGetMiss stats above.
   TLCounter numCacheGetExpiries{0};
 
+  // number of such calls served from a replica of a hot key
+  TLCounter numHotKeyReplicaHits{0};
+
+  // number of replicas of hot keys made
+  TLCounter numHotKeyReplicasCreated{0};
+
+  // number of such calls whose reference is counted on a striped refcount
+  TLCounter numStripedRefcountHits{0};
+
+  // number of items given a striped refcount
+  TLCounter numStripedRefcountsCreated{0};
+
   // number of remove calls to CacheAllocator::remove that requires
   // a lookup first and then remove the item
   TLCounter numCacheRemoves{0};
@@ -63,6 +75,9 @@ struct Stats {
   // number of nvm get miss that happened synchronously
   TLCounter numNvmGetMissFast{0};
 
+  // number of nvm get misses answered by the negative lookup cache
+  AtomicCounter numNvmGetMissNegativeCache{0};
+
   // number of nvm misses
   TLCounter numNvmGetMiss{0};
 
@@ -78,6 +93,23 @@ struct Stats {
   // number of gets that joined a concurrent fill for same item
   AtomicCounter numNvmGetCoalesced{0};
 
+  // number of prefetches looked up in nvm, also counted as nvm gets
+  AtomicCounter numNvmPrefetches{0};
+
+  // number of prefetched keys skipped: already in dram or being fetched,
+  // written or removed, known to miss, or over the inflight limit
+  AtomicCounter numNvmPrefetchSkipped{0};
+
+  // number of prefetches that filled the item into dram
+  AtomicCounter numNvmPrefetchFilled{0};
+
+  // number of prefetches cancelled because they did not start in time
+  AtomicCounter numNvmPrefetchCancelled{0};
+
+  // number of nvm hits handed out without inserting the item into dram
+  // during the warm up
+  AtomicCounter numNvmGetServedWithoutFill{0};
+
   // number of deletes issues to nvm
   TLCounter numNvmDeletes{0};
 
@@ -93,6 +125,24 @@ struct Stats {
   // number of put failures due to encode call back
   AtomicCounter numNvmPutEncodeFailure{0};
 
+  // number of values written to nvm compressed
+  AtomicCounter numNvmCompressed{0};
+
+  // number of values of compressed pools written uncompressed because they
+  // were too small or did not compress well enough
+  AtomicCounter numNvmCompressSkipped{0};
+
+  // uncompressed and compressed bytes of the values written compressed
+  AtomicCounter nvmCompressBytesIn{0};
+  AtomicCounter nvmCompressBytesOut{0};
+
+  // time spent compressing and decompressing values, in nanoseconds
+  AtomicCounter nvmCompressNs{0};
+  AtomicCounter nvmDecompressNs{0};
+
+  // number of values read from nvm that could not be decompressed
+  AtomicCounter numNvmDecompressErrors{0};
+
   // number of puts that observed an inflight delete and aborted
   AtomicCounter numNvmAbortedPutOnTombstone{0};
 
@@ -162,6 +212,7 @@ struct Stats {
   AtomicCounter numMoveSuccesses{0};
   AtomicCounter numEvictionAttempts{0};
   AtomicCounter numEvictionSuccesses{0};
+  AtomicCounter numMoveBatches{0};
 
   // the number times a refcount overflow occurred, resulting in an exception
   // being thrown
@@ -183,6 +234,16 @@ struct Stats {
   // Flag indicating the slab release stuck
   AtomicCounter numSlabReleaseStuck{0};
 
+  // items moved between memory tiers. Demotions move items evicted from the
+  // first tier to the second one. Promotions move hot items of the second
+  // tier back to the first one after being queued by lookups.
+  AtomicCounter numMemoryTierDemotions{0};
+  AtomicCounter numMemoryTierDemotionFailures{0};
+  AtomicCounter numMemoryTierPromotionsQueued{0};
+  AtomicCounter numMemoryTierPromotionsDropped{0};
+  AtomicCounter numMemoryTierPromotions{0};
+  AtomicCounter numMemoryTierPromotionFailures{0};
+
   // allocations with invalid parameters
   AtomicCounter invalidAllocs{0};
 
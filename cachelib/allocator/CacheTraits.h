@@ -18,7 +18,9 @@
 #include "cachelib/allocator/ChainedHashTable.h"
 #include "cachelib/allocator/MM2Q.h"
 #include "cachelib/allocator/MMLru.h"
+#include "cachelib/allocator/MMSieve.h"
 #include "cachelib/allocator/MMTinyLFU.h"
+#include "cachelib/allocator/OpenAddressingHashTable.h"
 #include "cachelib/allocator/memory/CompressedPtr.h"
 #include "cachelib/common/Mutex.h"
 
@@ -60,6 +62,13 @@ struct TinyLFUCacheTrait {
   using CompressedPtrType = CompressedPtr4B;
 };
 
+struct SieveCacheTrait {
+  using MMType = MMSieve;
+  using AccessType = ChainedHashTable;
+  using AccessTypeLocks = SharedMutexBuckets;
+  using CompressedPtrType = CompressedPtr4B;
+};
+
 struct Lru5BCacheTrait {
   using MMType = MMLru;
   using AccessType = ChainedHashTable;
@@ -88,5 +97,44 @@ struct TinyLFU5BCacheTrait {
   using CompressedPtrType = CompressedPtr5B;
 };
 
+struct Sieve5BCacheTrait {
+  using MMType = MMSieve;
+  using AccessType = ChainedHashTable;
+  using AccessTypeLocks = SharedMutexBuckets;
+  using CompressedPtrType = CompressedPtr5B;
+};
+
+struct LruOpenAddressingCacheTrait {
+  using MMType = MMLru;
+  using AccessType = OpenAddressingHashTable;
+  using AccessTypeLocks = SharedMutexBuckets;
+  using CompressedPtrType = CompressedPtr4B;
+};
+
+// Items without an expiry time, for caches that never set a TTL. Traits
+// keep the expiry time unless they set kItemExpiryTime to false.
+struct LruCompactItemCacheTrait {
+  using MMType = MMLru;
+  using AccessType = ChainedHashTable;
+  using AccessTypeLocks = SharedMutexBuckets;
+  using CompressedPtrType = CompressedPtr4B;
+  static constexpr bool kItemExpiryTime = false;
+};
+
+// DRAM only caches whose items have no expiry time, no chained items and no
+// remove callback or destructor. The allocator compiles these paths out of
+// its allocations, lookups, removes and evictions. Traits keep every feature
+// unless they set it to false, see CacheItem.h.
+struct LruDramOnlyCacheTrait {
+  using MMType = MMLru;
+  using AccessType = ChainedHashTable;
+  using AccessTypeLocks = SharedMutexBuckets;
+  using CompressedPtrType = CompressedPtr4B;
+  static constexpr bool kItemExpiryTime = false;
+  static constexpr bool kNvmCache = false;
+  static constexpr bool kChainedItems = false;
+  static constexpr bool kItemCallbacks = false;
+};
+
 } // namespace cachelib
 } // namespace facebook
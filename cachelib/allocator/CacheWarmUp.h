@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/Range.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include "cachelib/allocator/memory/Slab.h"
+#include "cachelib/common/Time.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Streams the hot items of a live cache to another cache, so that a host
+// replacing another one does not start cold. The sender walks the
+// MMContainers of every pool from the most recently used item and hands the
+// items to a sink in batches; the receiver inserts the batches with
+// insertWarmUpBatch(). The transport is up to the user.
+//
+// A batch is a header of magic, version and number of items followed by the
+// items, each as key size, value size and remaining ttl in seconds followed
+// by the key and the value. Integers are big endian.
+struct WarmUpConfig {
+  // pools to stream, by id on the sending cache. All the regular pools when
+  // empty.
+  std::set<PoolId> pools;
+
+  // the most items streamed from each allocation class of each pool,
+  // hottest first
+  size_t maxItemsPerClass{100'000};
+
+  // items per batch handed to the sink
+  size_t batchSize{1'000};
+};
+
+struct WarmUpStats {
+  // items sent or inserted
+  uint64_t numItems{0};
+
+  // batches sent or received
+  uint64_t numBatches{0};
+
+  // key and value bytes sent or inserted
+  uint64_t numBytes{0};
+
+  // items not sent because they have chained items
+  uint64_t numChainedSkipped{0};
+
+  // items not inserted because the key was already in the cache
+  uint64_t numExisting{0};
+
+  // items not inserted because the allocation failed
+  uint64_t numAllocFailures{0};
+};
+
+// Receives a batch of items from @pool, the name of their pool on the
+// sending cache. Returns false to stop the stream.
+using WarmUpSink = std::function<bool(folly::StringPiece pool,
+                                      std::unique_ptr<folly::IOBuf> batch)>;
+
+namespace detail {
+constexpr uint32_t kWarmUpBatchMagic = 0x57524d55;
+constexpr uint32_t kWarmUpBatchVersion = 1;
+constexpr uint64_t kWarmUpBatchGrowth = 64 * 1024;
+} // namespace detail
+
+// Streams the hottest items of the pools in @config through @sink, pool by
+// pool and allocation class by allocation class. Items with chained items
+// and expired items are not sent. The sending cache keeps serving; only a
+// batch of handles is held at a time.
+//
+// @return stats of what was sent
+template <typename CacheT>
+WarmUpStats streamHotItems(CacheT& cache,
+                           const WarmUpConfig& config,
+                           const WarmUpSink& sink) {
+  if (config.batchSize == 0) {
+    throw std::invalid_argument("warm up batch size must be positive");
+  }
+  WarmUpStats stats;
+  const auto pools =
+      config.pools.empty() ? cache.getRegularPoolIds() : config.pools;
+  for (const auto pid : pools) {
+    const auto poolName = cache.getPoolName(pid);
+    const auto classIds = cache.getPool(pid).getStats().classIds;
+
+    std::unique_ptr<folly::IOBuf> batch;
+    uint32_t batchItems = 0;
+    auto flush = [&]() {
+      if (batchItems == 0) {
+        return true;
+      }
+      // the item count is patched in once the batch is full
+      folly::io::RWPrivateCursor count{batch.get()};
+      count.skip(2 * sizeof(uint32_t));
+      count.writeBE<uint32_t>(batchItems);
+      batchItems = 0;
+      stats.numBatches++;
+      return sink(poolName, std::move(batch));
+    };
+
+    for (const auto cid : classIds) {
+      for (const auto& handle :
+           cache.getHotItems(pid, cid, config.maxItemsPerClass)) {
+        if (handle->hasChainedItem()) {
+          stats.numChainedSkipped++;
+          continue;
+        }
+        uint32_t ttlSecs = 0;
+        if (const auto expiry = handle->getExpiryTime(); expiry > 0) {
+          const auto now = util::getCurrentTimeSec();
+          if (expiry <= now) {
+            continue;
+          }
+          ttlSecs = expiry - now;
+        }
+
+        if (batchItems == 0) {
+          batch = folly::IOBuf::create(detail::kWarmUpBatchGrowth);
+          folly::io::Appender header{batch.get(), detail::kWarmUpBatchGrowth};
+          header.writeBE<uint32_t>(detail::kWarmUpBatchMagic);
+          header.writeBE<uint32_t>(detail::kWarmUpBatchVersion);
+          header.writeBE<uint32_t>(0);
+        }
+        const auto key = handle->getKey();
+        const auto value = folly::StringPiece{
+            reinterpret_cast<const char*>(handle->getMemory()),
+            handle->getSize()};
+        folly::io::Appender appender{batch.get(), detail::kWarmUpBatchGrowth};
+        appender.writeBE<uint32_t>(static_cast<uint32_t>(key.size()));
+        appender.writeBE<uint32_t>(static_cast<uint32_t>(value.size()));
+        appender.writeBE<uint32_t>(ttlSecs);
+        appender.push(folly::ByteRange{folly::StringPiece{key}});
+        appender.push(folly::ByteRange{value});
+        stats.numItems++;
+        stats.numBytes += key.size() + value.size();
+
+        if (++batchItems == config.batchSize && !flush()) {
+          return stats;
+        }
+      }
+    }
+    if (!flush()) {
+      return stats;
+    }
+  }
+  return stats;
+}
+
+// Inserts a batch produced by streamHotItems() into @pid. Items whose key is
+// already in the cache are left alone, since the receiving cache may have
+// started serving and its values are newer.
+//
+// @return stats of what was inserted
+// @throw std::invalid_argument if the batch is not a warm up batch
+// @throw std::out_of_range if the batch is truncated
+template <typename CacheT>
+WarmUpStats insertWarmUpBatch(CacheT& cache,
+                              PoolId pid,
+                              const folly::IOBuf& batch) {
+  folly::io::Cursor cursor{&batch};
+  const auto magic = cursor.readBE<uint32_t>();
+  const auto version = cursor.readBE<uint32_t>();
+  if (magic != detail::kWarmUpBatchMagic ||
+      version != detail::kWarmUpBatchVersion) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid warm up batch. magic: {:#x}, version: {}", magic, version));
+  }
+
+  WarmUpStats stats;
+  stats.numBatches = 1;
+  const auto numItems = cursor.readBE<uint32_t>();
+  std::string key;
+  for (uint32_t i = 0; i < numItems; i++) {
+    const auto keySize = cursor.readBE<uint32_t>();
+    const auto valueSize = cursor.readBE<uint32_t>();
+    const auto ttlSecs = cursor.readBE<uint32_t>();
+    key = cursor.readFixedString(keySize);
+
+    auto handle = cache.allocate(pid, key, valueSize, ttlSecs);
+    if (!handle) {
+      stats.numAllocFailures++;
+      cursor.skip(valueSize);
+      continue;
+    }
+    cursor.pull(handle->getMemory(), valueSize);
+    if (!cache.insert(handle)) {
+      stats.numExisting++;
+      continue;
+    }
+    stats.numItems++;
+    stats.numBytes += keySize + valueSize;
+  }
+  return stats;
+}
+
+} // namespace cachelib
+} // namespace facebook
@@ -17,16 +17,28 @@
 #pragma once
 
 #include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
+#include <folly/portability/Asm.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstdlib>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 #include "cachelib/allocator/Cache.h"
 #include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
 #include "cachelib/common/CompilerUtils.h"
 #include "cachelib/common/Mutex.h"
+#include "cachelib/common/ReadEpochs.h"
 #include "cachelib/common/Throttler.h"
 #include "cachelib/shm/Shm.h"
 
@@ -68,9 +80,12 @@ class ChainedHashTable {
     // @param numBuckets    the number of buckets to be allocated, power of two
     // @param compressor    object used to compress/decompress node pointers
     // @param hasher        object used to hash the key for its bucket id
+    // @param lazyInit      initialize the buckets on their first insert
+    //                      instead of upfront
     Impl(size_t numBuckets,
          const PtrCompressor& compressor,
-         const Hasher& hasher);
+         const Hasher& hasher,
+         bool lazyInit = false);
 
     // allocate memory for hash table; the memory is managed by the user.
     //
@@ -80,15 +95,18 @@ class ChainedHashTable {
     // @param compressor    object used to compress/decompress node pointers
     // @param hasher        object used to hash the key for its bucket id
     // @param resetMem      fill memory with CompressedPtrType{}
+    // @param lazyInit      when resetMem is set, fill the buckets on their
+    //                      first insert instead of upfront
     Impl(size_t numBuckets,
          void* memStart,
          const PtrCompressor& compressor,
          const Hasher& hasher,
-         bool resetMem = false);
+         bool resetMem = false,
+         bool lazyInit = false);
 
     // hash table memory is not released if managed by user.
     // i.e. Impl::isRestorable() == true
-    ~Impl();
+    ~Impl() = default;
 
     // prohibit copying
     Impl(const Impl&) = delete;
@@ -142,8 +160,63 @@ class ChainedHashTable {
     //          node with the key in the bucket.
     T* findInBucket(Key key, BucketId bucket) const noexcept;
 
-    // gets the bucket for the key by using the corresponding hash function.
-    BucketId getBucket(Key k) const noexcept;
+    // same as findInBucket(), but gives up after visiting maxHops nodes. This
+    // is meant for walking a chain without holding its lock, where a racing
+    // modification can make the walk observe an inconsistent chain. Every
+    // pointer read from the chain is validated before it is followed, so
+    // that the walk never dereferences a pointer read from a node that was
+    // freed and reused meanwhile, which could point anywhere.
+    //
+    // @param key       the key for the node we are looking for.
+    // @param bucket    the hashtable bucket that the key belongs to
+    // @param maxHops   maximum number of nodes to visit
+    // @param validate  returns false if the chain may have changed since the
+    //                  walk started
+    // @return  pair of whether the walk completed and the node found. The
+    //          node is meaningful only if the walk completed.
+    template <typename F>
+    std::pair<bool, T*> findInBucketBounded(Key key,
+                                            BucketId bucket,
+                                            size_t maxHops,
+                                            const F& validate) const;
+
+    // finds the nodes for a group of keys by walking their hash chains in an
+    // interleaved fashion. Every lookup prefetches its next node and then
+    // yields to the next in-flight lookup, so that the cache misses of
+    // independent chains overlap instead of being serialized. The result for
+    // each key is identical to that of findInBucket().
+    //
+    // @param keys         the keys for the nodes we are looking for
+    // @param buckets      the hashtable buckets for each of the keys
+    // @param indices      positions in keys/buckets to look up
+    // @param numIndices   number of entries in indices
+    // @param maxInFlight  maximum number of chains walked concurrently
+    // @param func         invoked as func(index, T*) once for every index
+    template <typename F>
+    void findInBucketsInterleaved(const Key* keys,
+                                  const BucketId* buckets,
+                                  const uint32_t* indices,
+                                  size_t numIndices,
+                                  size_t maxInFlight,
+                                  F&& func) const;
+
+    // moves the nodes of bucket 'from' whose hash has 'bit' set to bucket
+    // 'to', keeping the order of both chains. The 'to' bucket is overwritten,
+    // so it can hold anything before the split.
+    //
+    // @param from  the bucket being split
+    // @param to    the bucket getting the nodes with the bit set
+    // @param bit   the hash bit that tells the two buckets apart
+    void splitBucket(BucketId from, BucketId to, uint32_t bit) noexcept;
+
+    // prefetch the head of the bucket so that the cache miss on it can be
+    // overlapped with other work.
+    //
+    // @param bucket  the bucket id to prefetch.
+    void prefetchBucket(BucketId bucket) const noexcept {
+      XDCHECK_LT(bucket, numBuckets_);
+      __builtin_prefetch(&hashTable_[bucket], 0 /* read */, 3 /* locality */);
+    }
 
     // Call 'func' on each element in the given bucket.
     //
@@ -167,7 +240,51 @@ class ChainedHashTable {
     // return the number of buckets in hash table
     size_t getNumBuckets() const noexcept { return numBuckets_; }
 
+    // initialize the first numBuckets buckets that are still waiting for
+    // their first insert. Those buckets are valid in memory afterwards and
+    // can be persisted.
+    void initializeBuckets(size_t numBuckets) const;
+
+    // number of buckets initialized so far. Equals getNumBuckets() when lazy
+    // initialization is disabled.
+    size_t getNumInitializedBuckets() const noexcept;
+
    private:
+    // buckets are lazily initialized in blocks of this many, a 4KB page for
+    // 4 byte compressed pointers.
+    static constexpr size_t kLazyInitBlockSize = 1024;
+
+    // states of a lazily initialized block of buckets
+    enum LazyInitState : uint8_t { kUninitialized, kInitializing, kReady };
+
+    // head of the hash chain for the bucket. Buckets that were never
+    // initialized are empty.
+    CompressedPtrType getHead(BucketId bucket) const noexcept {
+      if (lazyInitStates_ != nullptr &&
+          lazyInitStates_[bucket / kLazyInitBlockSize].load(
+              std::memory_order_acquire) != kReady) {
+        return CompressedPtrType{};
+      }
+      return hashTable_[bucket];
+    }
+
+    // set the head of the hash chain for the bucket, initializing its block
+    // first if needed.
+    void setHead(BucketId bucket, CompressedPtrType head) noexcept {
+      if (lazyInitStates_ != nullptr) {
+        initializeBlock(bucket / kLazyInitBlockSize);
+      }
+      hashTable_[bucket] = head;
+    }
+
+    // fill the block of buckets with CompressedPtrType{} unless that was
+    // done already. Concurrent callers for the same block wait for the one
+    // that fills it.
+    void initializeBlock(size_t block) const noexcept;
+
+    // allocate memory for numBuckets buckets without touching it.
+    static CompressedPtrType* allocateBuckets(size_t numBuckets);
+
     // finds the previous node in the hash chain for this node if one exists
     // such that prev->next is node.
     //
@@ -180,11 +297,18 @@ class ChainedHashTable {
     // number of buckets we have in the hashtable, must be power of two
     const size_t numBuckets_{0};
 
-    // materialized value of numBuckets_ - 1
-    const size_t numBucketsMask_{0};
+    // memory for the buckets when it is managed by Impl.
+    std::unique_ptr<void, void (*)(void*)> ownedMemory_{nullptr, std::free};
 
     // actual buckets.
-    std::unique_ptr<CompressedPtrType[]> hashTable_;
+    CompressedPtrType* const hashTable_;
+
+    // one state per block for lazily initialized buckets. nullptr when the
+    // buckets are initialized upfront.
+    mutable std::unique_ptr<std::atomic<uint8_t>[]> lazyInitStates_;
+
+    // number of lazily initialized blocks that are ready
+    mutable std::atomic<size_t> numInitializedBlocks_{0};
 
     // indicate whether or not the hash table uses user-managed memory and
     // is thus restorable from serialized state
@@ -304,10 +428,112 @@ class ChainedHashTable {
 
     const Hasher& getHasher() const noexcept { return hasher_; }
 
+    // Set the number of lookups that findBatch() walks through the hash
+    // chains concurrently, prefetching the next node of each chain before
+    // moving on to the next lookup. 0 disables the interleaved mode.
+    //
+    // @throw std::invalid_argument if n is more than kMaxInterleavedLookups
+    Config& setNumInterleavedLookups(unsigned int n) {
+      if (n > kMaxInterleavedLookups) {
+        throw std::invalid_argument(folly::sformat(
+            "Invalid number of interleaved lookups = {}, max = {}", n,
+            kMaxInterleavedLookups));
+      }
+      numInterleavedLookups_ = n;
+      return *this;
+    }
+
+    unsigned int getNumInterleavedLookups() const noexcept {
+      return numInterleavedLookups_;
+    }
+
+    // Enable lock-free reads. find() walks the hash chain without the bucket
+    // lock and validates the walk against a per-lock version that writers
+    // bump. It falls back to the shared lock only on a version conflict.
+    // This requires T to provide incRefIfAccessible(), and the owner of the
+    // nodes to call synchronizeOptimisticReads() before the memory of a
+    // removed node is reused for anything but a node.
+    Config& setOptimisticReads(bool enable) noexcept {
+      optimisticReads_ = enable;
+      return *this;
+    }
+
+    bool isOptimisticReadsEnabled() const noexcept { return optimisticReads_; }
+
+    // Initialize the buckets on demand, a block at a time on the first
+    // insert into the block, instead of filling the whole bucket array when
+    // the hash table is created. This cuts the start up time of caches with
+    // large hash tables at the cost of a check on every bucket access.
+    Config& setLazyBucketInit(bool enable) noexcept {
+      lazyBucketInit_ = enable;
+      return *this;
+    }
+
+    bool isLazyBucketInitEnabled() const noexcept { return lazyBucketInit_; }
+
+    // Let the hash table double its buckets while it is in use, until it
+    // has 2^maxBucketsPower buckets. Container::resizeStep() starts doubling
+    // once there are more than maxLoadFactor keys per bucket and splits the
+    // buckets one at a time under their lock, so lookups and updates go on
+    // during the resize. The memory for the largest table is reserved
+    // upfront, but the buckets are only touched as the table grows into them.
+    //
+    // @throw std::invalid_argument if maxBucketsPower is more than 32 or less
+    //        than the buckets power, or if maxLoadFactor is not positive.
+    Config& setMaxBucketsPower(unsigned int maxBucketsPower,
+                               double maxLoadFactor = 1.0) {
+      if (maxBucketsPower > kMaxBucketPower ||
+          maxBucketsPower < bucketsPower_ || !(maxLoadFactor > 0)) {
+        throw std::invalid_argument(folly::sformat(
+            "Invalid max bucket power = {} for bucket power = {}, max load "
+            "factor = {}",
+            maxBucketsPower, bucketsPower_, maxLoadFactor));
+      }
+      maxBucketsPower_ = maxBucketsPower;
+      maxLoadFactor_ = maxLoadFactor;
+      return *this;
+    }
+
+    // number of buckets the hash table can grow to, expressed as a power of
+    // two. Same as the buckets power when the hash table does not grow.
+    unsigned int getMaxBucketsPower() const noexcept {
+      return std::max(bucketsPower_, maxBucketsPower_);
+    }
+
+    size_t getMaxNumBuckets() const noexcept {
+      return static_cast<size_t>(1) << getMaxBucketsPower();
+    }
+
+    bool isResizable() const noexcept {
+      return getMaxBucketsPower() > bucketsPower_;
+    }
+
+    double getMaxLoadFactor() const noexcept { return maxLoadFactor_; }
+
+    // Track the contention on the bucket locks. Acquisitions that find their
+    // lock held are counted per lock and the wait of one out of sampleRate
+    // of them is timed. 0 disables the tracking.
+    // See Container::getLockContentionStats().
+    Config& setLockContentionSampleRate(uint32_t sampleRate) noexcept {
+      lockContentionSampleRate_ = sampleRate;
+      return *this;
+    }
+
+    uint32_t getLockContentionSampleRate() const noexcept {
+      return lockContentionSampleRate_;
+    }
+
     std::map<std::string, std::string> serialize() const {
       std::map<std::string, std::string> configMap;
       configMap["BucketsPower"] = std::to_string(bucketsPower_);
       configMap["LocksPower"] = std::to_string(locksPower_);
+      configMap["InterleavedLookups"] = std::to_string(numInterleavedLookups_);
+      configMap["OptimisticReads"] = optimisticReads_ ? "true" : "false";
+      configMap["LazyBucketInit"] = lazyBucketInit_ ? "true" : "false";
+      configMap["MaxBucketsPower"] = std::to_string(getMaxBucketsPower());
+      configMap["MaxLoadFactor"] = std::to_string(maxLoadFactor_);
+      configMap["LockContentionSampleRate"] =
+          std::to_string(lockContentionSampleRate_);
       configMap["Hasher"] =
           hasher_->getMagicId() == 1 ? "FNVHash" : "MurmurHash2";
       return configMap;
@@ -315,6 +541,10 @@ class ChainedHashTable {
 
     PageSizeT getPageSize() const { return pageSize_; }
 
+    // upper bound on the number of concurrently walked chains. Past this,
+    // the in-flight prefetches exceed what the cpu can track anyway.
+    static constexpr unsigned int kMaxInterleavedLookups = 16;
+
    private:
     // 4 billion buckets should be good enough for everyone.
     static constexpr unsigned int kMaxBucketPower = 32;
@@ -331,6 +561,26 @@ class ChainedHashTable {
 
     PageSizeT pageSize_{PageSizeT::NORMAL};
 
+    // number of lookups interleaved by findBatch(). 0 means disabled.
+    unsigned int numInterleavedLookups_{0};
+
+    // whether find() first tries a lock-free, version validated lookup.
+    bool optimisticReads_{false};
+
+    // whether the buckets are initialized on demand.
+    bool lazyBucketInit_{false};
+
+    // number of buckets the hashtable can grow to, expressed as a power of
+    // two. Does not grow when not above bucketsPower_.
+    unsigned int maxBucketsPower_{0};
+
+    // keys per bucket past which the hashtable starts growing.
+    double maxLoadFactor_{1.0};
+
+    // one out of this many contended bucket lock acquisitions is timed. 0
+    // means contention is not tracked.
+    uint32_t lockContentionSampleRate_{0};
+
     Hasher hasher_ = std::make_shared<MurmurHash2>();
   };
 
@@ -367,13 +617,18 @@ class ChainedHashTable {
               HandleMaker hm = kDefaultHandleMaker)
         : config_(std::move(c)),
           handleMaker_(std::move(hm)),
-          ht_{config_.getNumBuckets(), compressor, config_.getHasher()},
-          locks_{config_.getLocksPower(), config_.getHasher()} {}
+          ht_{config_.getMaxNumBuckets(), compressor, config_.getHasher(),
+              config_.isLazyBucketInitEnabled() || config_.isResizable()},
+          locks_{config_.getLocksPower(), config_.getHasher(),
+                 config_.getLockContentionSampleRate()},
+          versions_{createVersions(config_)},
+          readEpochs_{createReadEpochs(config_)} {}
 
     // create hash table container with user-managed memory
     //
     // @param c           config for hash table
-    // @param memStart    hash table memory managed by the user
+    // @param memStart    hash table memory managed by the user, of
+    //                    getRequiredSize(c.getMaxNumBuckets()) bytes
     // @param compressor  object used to compress/decompress node pointers
     // @param hm          the functor that creates a Handle from T*
     Container(Config c,
@@ -382,9 +637,13 @@ class ChainedHashTable {
               HandleMaker hm = kDefaultHandleMaker)
         : config_(std::move(c)),
           handleMaker_(std::move(hm)),
-          ht_{config_.getNumBuckets(), memStart, compressor,
-              config_.getHasher(), true /* resetMem */},
-          locks_{config_.getLocksPower(), config_.getHasher()} {}
+          ht_{config_.getMaxNumBuckets(), memStart, compressor,
+              config_.getHasher(), true /* resetMem */,
+              config_.isLazyBucketInitEnabled() || config_.isResizable()},
+          locks_{config_.getLocksPower(), config_.getHasher(),
+                 config_.getLockContentionSampleRate()},
+          versions_{createVersions(config_)},
+          readEpochs_{createReadEpochs(config_)} {}
 
     // restore hash table from serialized data.
     //
@@ -396,7 +655,9 @@ class ChainedHashTable {
     //
     // @throw std::invalid argument if the bucket power in new config does not
     //        match the previous state or the size of the memSegment does not
-    //        match the old state.
+    //        match the old state. A hash table that grew is restored with as
+    //        many buckets as it had, so the new config must have the same max
+    //        bucket power and at most as many buckets.
     Container(const serialization::ChainedHashTableObject& object,
               const Config& newConfig,
               ShmAddr memSegment,
@@ -505,6 +766,20 @@ class ChainedHashTable {
     //        creating this item handle.
     Handle find(Key key) const;
 
+    // finds the nodes corresponding to the keys in the hashtable. All the
+    // keys are hashed and their buckets prefetched up front. The lookups are
+    // then grouped by lock so that each lock is acquired only once for the
+    // entire batch.
+    //
+    // @param keys  the lookup keys
+    //
+    // @return  vector of Handles in the same order as keys. A Handle is
+    //          nullptr if there is no node corresponding to the key.
+    //
+    // @throw std::overflow_error is the maximum item refcount is execeeded by
+    //        creating an item handle.
+    std::vector<Handle> findBatch(folly::Range<const Key*> keys) const;
+
     // for saving the state of the hash table
     //
     // precondition:  serialization must happen without any reader or writer
@@ -522,10 +797,28 @@ class ChainedHashTable {
 
     const Config& getConfig() const noexcept { return config_; }
 
+    // current number of buckets, expressed as a power of two. Only the
+    // buckets split so far by a resize in progress are beyond it.
     unsigned int getHashpower() const noexcept {
-      return config_.getBucketsPower();
+      return getBucketsPower(splitState_.load(std::memory_order_acquire));
     }
 
+    // Start doubling the number of buckets, whatever the load factor.
+    //
+    // @return  false if a resize is already in progress or the hash table
+    //          has reached its max buckets power.
+    bool startResize();
+
+    // Make progress on growing the hash table. Starts doubling the buckets
+    // once there are more keys per bucket than the configured max load
+    // factor, then splits up to maxBuckets of them. Each split moves the
+    // nodes of a bucket into its new sibling while holding the bucket's
+    // lock. Buckets are not split while there are iterators.
+    //
+    // @param maxBuckets  upper bound on the buckets split by this call
+    // @return  the number of buckets split
+    size_t resizeStep(size_t maxBuckets);
+
     // Iterator interface for the hashtable. Iterates over the hashtable
     // bucket by bucket and takes a snapshot of the bucket to iterate over. It
     // guarantees that all keys that were present when the iteration started
@@ -534,7 +827,8 @@ class ChainedHashTable {
     // to be either visited or not-visited. Adding/Removing from the hash
     // table while the iterator is alive will not invalidate any iterator or
     // the element that the iterator points at currently. The iterator
-    // internally holds a Handle to the item.
+    // internally holds a Handle to the item. The hash table does not grow
+    // while there are iterators, since that moves nodes between buckets.
     class Iterator {
      public:
       ~Iterator() {
@@ -608,8 +902,13 @@ class ChainedHashTable {
             "Iterator in invalid state with curSor_: " +
             folly::to<std::string>(curSor_) + ", currBucket_: " +
             folly::to<std::string>(currBucket_) + ", total buckets: " +
-            folly::to<std::string>(container_->config_.getNumBuckets()));
+            folly::to<std::string>(container_->getNumActiveBuckets()));
       }
+
+      // position of the end iterator. The number of buckets can change
+      // between creating the end iterator and reaching the end.
+      static constexpr BucketId kEndBucket =
+          std::numeric_limits<BucketId>::max();
     };
 
     // Iterator interface to the container.
@@ -630,6 +929,16 @@ class ChainedHashTable {
     struct Stats {
       uint64_t numKeys;
       uint64_t numBuckets;
+      // buckets that were initialized so far. Less than numBuckets only
+      // when the buckets are lazily initialized.
+      uint64_t numInitializedBuckets;
+      // whether the buckets are being doubled. numBucketsSplit out of the
+      // numBucketsToSplit buckets the resize started with were split so far.
+      bool resizing;
+      uint64_t numBucketsSplit;
+      uint64_t numBucketsToSplit;
+      // number of times the buckets were doubled
+      uint64_t numResizes;
     };
 
     // Get the distribution stats. This function will use cached results
@@ -643,16 +952,161 @@ class ChainedHashTable {
 
     // lightweight stats that give the number of keys and buckets inside the
     // container. This is guaranteed to be fast.
-    Stats getStats() const noexcept { return {numKeys_, ht_.getNumBuckets()}; }
+    Stats getStats() const noexcept {
+      const auto state = splitState_.load(std::memory_order_acquire);
+      const bool resizing = resizing_.load(std::memory_order_relaxed);
+      const uint64_t numBuckets = getNumActiveBuckets(state);
+      return {numKeys_,
+              numBuckets,
+              std::min<uint64_t>(ht_.getNumInitializedBuckets(), numBuckets),
+              resizing,
+              getNumSplitBuckets(state),
+              resizing ? getNumLowerBuckets(state) : 0,
+              numResizes_.load(std::memory_order_relaxed)};
+    }
 
     // Get the total number of keys inserted into the hash table
     uint64_t getNumKeys() const noexcept {
       return numKeys_.load(std::memory_order_relaxed);
     }
 
+    // @return  contention stats of the bucket locks, indexed by lock, or
+    //          nullptr if Config::setLockContentionSampleRate was not set.
+    const util::LockContentionStats* getLockContentionStats() const noexcept {
+      return locks_.getContentionStats();
+    }
+
+    // @return  index of the lock guarding @key. Operations on keys sharing
+    //          a lock can be grouped to keep the lock and its buckets hot.
+    uint32_t getLockIdx(Key key) const noexcept {
+      return getHash(key) & ((1u << config_.getLocksPower()) - 1);
+    }
+
+    // Wait until the lock-free lookups in progress are done. Lookups that
+    // start afterwards can not reach a node removed before the call, so its
+    // memory may then be reused for something other than a node. No-op
+    // when lock-free reads are not enabled.
+    void synchronizeOptimisticReads() const {
+      if (readEpochs_) {
+        readEpochs_->synchronize();
+      }
+    }
+
    private:
     using Hashtable = Impl<T, HookPtr>;
 
+    // The buckets in use are tracked in a single word so that they can be
+    // read without any lock: the buckets power p in the upper half and the
+    // number s of buckets below 2^p that were split in the lower half.
+    // Buckets [0, s) and [2^p, 2^p + s) are addressed with the low p + 1
+    // bits of the hash, the remaining buckets below 2^p with p bits.
+    static uint64_t makeSplitState(unsigned int bucketsPower,
+                                   size_t numSplit) noexcept {
+      return (static_cast<uint64_t>(bucketsPower) << 32) | numSplit;
+    }
+
+    static unsigned int getBucketsPower(uint64_t state) noexcept {
+      return static_cast<unsigned int>(state >> 32);
+    }
+
+    static size_t getNumSplitBuckets(uint64_t state) noexcept {
+      return static_cast<size_t>(state & 0xffffffff);
+    }
+
+    static size_t getNumLowerBuckets(uint64_t state) noexcept {
+      return static_cast<size_t>(1) << getBucketsPower(state);
+    }
+
+    static size_t getNumActiveBuckets(uint64_t state) noexcept {
+      return getNumLowerBuckets(state) + getNumSplitBuckets(state);
+    }
+
+    size_t getNumActiveBuckets() const noexcept {
+      return getNumActiveBuckets(splitState_.load(std::memory_order_acquire));
+    }
+
+    uint32_t getHash(Key key) const noexcept {
+      return (*config_.getHasher())(key.data(), key.size());
+    }
+
+    // bucket for the hash. The locks are picked by the low bits of the hash,
+    // which are the same bits of the bucket for every buckets power since
+    // there are never more locks than buckets. Hence the bucket is stable
+    // while holding the lock for the hash; without it, it is a hint.
+    BucketId getBucket(uint32_t hash) const noexcept {
+      const auto state = splitState_.load(std::memory_order_acquire);
+      const size_t numLower = getNumLowerBuckets(state);
+      const BucketId bucket = hash & (numLower - 1);
+      return bucket < getNumSplitBuckets(state) ? hash & (2 * numLower - 1)
+                                                : bucket;
+    }
+
+    // start a resize. Must hold resizeLock_.
+    bool startResizeLocked() noexcept;
+
+    // split the next bucket of the resize in progress. Must hold
+    // resizeLock_.
+    void splitNextBucket() noexcept;
+
+    // upper bound on the nodes visited by a lock-free lookup before giving
+    // up and taking the lock.
+    static constexpr size_t kMaxOptimisticHops = 64;
+
+    // Bumps the version for the lock of a bucket before and after a
+    // modification so that lock-free readers can detect it. Must be held
+    // under the exclusive lock of the bucket.
+    class VersionWriteGuard {
+     public:
+      explicit VersionWriteGuard(std::atomic<uint32_t>* version) noexcept
+          : version_(version) {
+        if (version_) {
+          version_->fetch_add(1, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_release);
+        }
+      }
+
+      ~VersionWriteGuard() {
+        if (version_) {
+          version_->fetch_add(1, std::memory_order_release);
+        }
+      }
+
+      VersionWriteGuard(const VersionWriteGuard&) = delete;
+      VersionWriteGuard& operator=(const VersionWriteGuard&) = delete;
+
+     private:
+      std::atomic<uint32_t>* const version_;
+    };
+
+    static std::unique_ptr<std::atomic<uint32_t>[]> createVersions(
+        const Config& config) {
+      if (!config.isOptimisticReadsEnabled()) {
+        return nullptr;
+      }
+      return std::make_unique<std::atomic<uint32_t>[]>(config.getNumLocks());
+    }
+
+    static std::unique_ptr<ReadEpochs> createReadEpochs(const Config& config) {
+      if (!config.isOptimisticReadsEnabled()) {
+        return nullptr;
+      }
+      return std::make_unique<ReadEpochs>();
+    }
+
+    // version for the lock protecting the bucket, nullptr if lock-free reads
+    // are not enabled.
+    std::atomic<uint32_t>* getVersion(BucketId bucket) const noexcept {
+      return versions_ ? &versions_[bucket & (config_.getNumLocks() - 1)]
+                       : nullptr;
+    }
+
+    // lock-free lookup of the key. The item is pinned through
+    // incRefIfAccessible() before a handle is made for it.
+    //
+    // @return  handle for the key (possibly nullptr) if the lookup did not
+    //          race with a writer, folly::none otherwise.
+    folly::Optional<Handle> findOptimistic(Key key, uint32_t hash) const;
+
     // Fetch a vector of handle to the items belonging to a given bucket. This
     // is for use by the iterator. 'handles' will be cleared and then populated
     // with handles for the items in the given bucket. Items will be skipped if
@@ -671,6 +1125,15 @@ class ChainedHashTable {
     // locks protecting the hashtable buckets
     mutable LockT locks_;
 
+    // per lock versions validating lock-free reads. Only allocated when
+    // enabled through the config.
+    std::unique_ptr<std::atomic<uint32_t>[]> versions_;
+
+    // epochs of the lock-free readers, which may still dereference a node
+    // after it has been removed. Only allocated when enabled through the
+    // config.
+    std::unique_ptr<ReadEpochs> readEpochs_;
+
     std::atomic<unsigned int> numIterators_{0};
 
     // Cached stats for distribution
@@ -688,6 +1151,19 @@ class ChainedHashTable {
 
     // number of the keys stored in this hash table
     std::atomic<uint64_t> numKeys_{0};
+
+    // buckets in use, see makeSplitState().
+    std::atomic<uint64_t> splitState_{
+        makeSplitState(config_.getBucketsPower(), 0)};
+
+    // whether the buckets are being doubled.
+    std::atomic<bool> resizing_{false};
+
+    // number of times the buckets were doubled.
+    std::atomic<uint64_t> numResizes_{0};
+
+    // serializes the resizes.
+    mutable std::mutex resizeLock_;
   };
 };
 
@@ -706,9 +1182,11 @@ const typename T::HandleMaker
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
 ChainedHashTable::Impl<T, HookPtr>::Impl(size_t numBuckets,
                                          const PtrCompressor& compressor,
-                                         const Hasher& hasher)
+                                         const Hasher& hasher,
+                                         bool lazyInit)
     : numBuckets_(numBuckets),
-      numBucketsMask_(numBuckets - 1),
+      ownedMemory_(allocateBuckets(numBuckets), std::free),
+      hashTable_(static_cast<CompressedPtrType*>(ownedMemory_.get())),
       compressor_(compressor),
       hasher_(hasher) {
   if (numBuckets == 0) {
@@ -717,9 +1195,12 @@ ChainedHashTable::Impl<T, HookPtr>::Impl(size_t numBuckets,
   if (numBuckets & (numBuckets - 1)) {
     throw std::invalid_argument("Number of buckets must be a power of two");
   }
-  hashTable_ = std::make_unique<CompressedPtrType[]>(numBuckets_);
-  CompressedPtrType* memStart = hashTable_.get();
-  std::fill(memStart, memStart + numBuckets_, CompressedPtrType{});
+  if (lazyInit) {
+    lazyInitStates_ = std::make_unique<std::atomic<uint8_t>[]>(
+        (numBuckets_ + kLazyInitBlockSize - 1) / kLazyInitBlockSize);
+  } else {
+    std::fill(hashTable_, hashTable_ + numBuckets_, CompressedPtrType{});
+  }
 }
 
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
@@ -727,9 +1208,9 @@ ChainedHashTable::Impl<T, HookPtr>::Impl(size_t numBuckets,
                                          void* memStart,
                                          const PtrCompressor& compressor,
                                          const Hasher& hasher,
-                                         bool resetMem)
+                                         bool resetMem,
+                                         bool lazyInit)
     : numBuckets_(numBuckets),
-      numBucketsMask_(numBuckets - 1),
       hashTable_(static_cast<CompressedPtrType*>(memStart)),
       restorable_(true),
       compressor_(compressor),
@@ -740,26 +1221,105 @@ ChainedHashTable::Impl<T, HookPtr>::Impl(size_t numBuckets,
   if (numBuckets & (numBuckets - 1)) {
     throw std::invalid_argument("Number of buckets must be a power of two");
   }
-  if (resetMem) {
-    CompressedPtrType* memStartBucket =
-        static_cast<CompressedPtrType*>(memStart);
-    std::fill(memStartBucket, memStartBucket + numBuckets_,
-              CompressedPtrType{});
+  if (resetMem && lazyInit) {
+    lazyInitStates_ = std::make_unique<std::atomic<uint8_t>[]>(
+        (numBuckets_ + kLazyInitBlockSize - 1) / kLazyInitBlockSize);
+  } else if (resetMem) {
+    std::fill(hashTable_, hashTable_ + numBuckets_, CompressedPtrType{});
+  }
+}
+
+template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
+typename ChainedHashTable::Impl<T, HookPtr>::CompressedPtrType*
+ChainedHashTable::Impl<T, HookPtr>::allocateBuckets(size_t numBuckets) {
+  // large allocations are mmaped and only faulted in when first written to.
+  void* memory = std::malloc(numBuckets * sizeof(CompressedPtrType));
+  if (memory == nullptr) {
+    throw std::bad_alloc();
   }
+  return static_cast<CompressedPtrType*>(memory);
 }
 
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
-ChainedHashTable::Impl<T, HookPtr>::Impl::~Impl() {
-  if (restorable_) {
-    hashTable_.release();
+void ChainedHashTable::Impl<T, HookPtr>::initializeBlock(
+    size_t block) const noexcept {
+  auto& state = lazyInitStates_[block];
+  if (state.load(std::memory_order_acquire) == kReady) {
+    return;
+  }
+  uint8_t expected = kUninitialized;
+  if (state.compare_exchange_strong(expected, kInitializing,
+                                    std::memory_order_acq_rel)) {
+    const size_t begin = block * kLazyInitBlockSize;
+    const size_t end = std::min(begin + kLazyInitBlockSize, numBuckets_);
+    std::fill(hashTable_ + begin, hashTable_ + end, CompressedPtrType{});
+    state.store(kReady, std::memory_order_release);
+    numInitializedBlocks_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  while (state.load(std::memory_order_acquire) != kReady) {
+    folly::asm_volatile_pause();
   }
 }
 
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
-typename ChainedHashTable::Impl<T, HookPtr>::BucketId
-ChainedHashTable::Impl<T, HookPtr>::getBucket(
-    typename T::Key k) const noexcept {
-  return (*hasher_)(k.data(), k.size()) & numBucketsMask_;
+void ChainedHashTable::Impl<T, HookPtr>::initializeBuckets(
+    size_t numBuckets) const {
+  if (lazyInitStates_ == nullptr) {
+    return;
+  }
+  XDCHECK_LE(numBuckets, numBuckets_);
+  const size_t numBlocks =
+      (numBuckets + kLazyInitBlockSize - 1) / kLazyInitBlockSize;
+  for (size_t block = 0; block < numBlocks; ++block) {
+    initializeBlock(block);
+  }
+}
+
+template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
+size_t ChainedHashTable::Impl<T, HookPtr>::getNumInitializedBuckets()
+    const noexcept {
+  if (lazyInitStates_ == nullptr) {
+    return numBuckets_;
+  }
+  return std::min(
+      numInitializedBlocks_.load(std::memory_order_relaxed) *
+          kLazyInitBlockSize,
+      numBuckets_);
+}
+
+template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
+void ChainedHashTable::Impl<T, HookPtr>::splitBucket(BucketId from,
+                                                     BucketId to,
+                                                     uint32_t bit) noexcept {
+  XDCHECK_LT(from, numBuckets_);
+  XDCHECK_LT(to, numBuckets_);
+
+  // heads and tails of the nodes staying and moving.
+  CompressedPtrType heads[2] = {CompressedPtrType{}, CompressedPtrType{}};
+  T* tails[2] = {nullptr, nullptr};
+
+  T* curr = compressor_.unCompress(getHead(from));
+  while (curr != nullptr) {
+    T* const next = getHashNext(*curr);
+    const auto key = curr->getKey();
+    const int i = ((*hasher_)(key.data(), key.size()) & bit) ? 1 : 0;
+    if (tails[i] == nullptr) {
+      heads[i] = compressor_.compress(curr);
+    } else {
+      setHashNext(*tails[i], curr);
+    }
+    tails[i] = curr;
+    curr = next;
+  }
+
+  for (T* tail : tails) {
+    if (tail != nullptr) {
+      setHashNext(*tail, CompressedPtrType{});
+    }
+  }
+  setHead(from, heads[0]);
+  setHead(to, heads[1]);
 }
 
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
@@ -773,8 +1333,8 @@ bool ChainedHashTable::Impl<T, HookPtr>::insertInBucket(
   }
 
   // insert at the head of the bucket
-  const auto head = hashTable_[bucket];
-  hashTable_[bucket] = compressor_.compress(&node);
+  const auto head = getHead(bucket);
+  setHead(bucket, compressor_.compress(&node));
   setHashNext(node, head);
   return true;
 }
@@ -785,7 +1345,7 @@ T* ChainedHashTable::Impl<T, HookPtr>::insertOrReplaceInBucket(
   XDCHECK_LT(bucket, numBuckets_);
 
   // See if we can find the key and the previous node
-  T* curr = compressor_.unCompress(hashTable_[bucket]);
+  T* curr = compressor_.unCompress(getHead(bucket));
   T* prev = nullptr;
 
   const auto key = node.getKey();
@@ -796,8 +1356,8 @@ T* ChainedHashTable::Impl<T, HookPtr>::insertOrReplaceInBucket(
 
   // insert if the key doesn't exist
   if (!curr) {
-    const auto head = hashTable_[bucket];
-    hashTable_[bucket] = compressor_.compress(&node);
+    const auto head = getHead(bucket);
+    setHead(bucket, compressor_.compress(&node));
     setHashNext(node, head);
     return nullptr;
   }
@@ -806,7 +1366,7 @@ T* ChainedHashTable::Impl<T, HookPtr>::insertOrReplaceInBucket(
   if (prev) {
     setHashNext(*prev, &node);
   } else {
-    hashTable_[bucket] = compressor_.compress(&node);
+    setHead(bucket, compressor_.compress(&node));
   }
   setHashNext(node, getHashNext(*curr));
 
@@ -827,8 +1387,8 @@ void ChainedHashTable::Impl<T, HookPtr>::removeFromBucket(
   } else {
     XDCHECK_EQ(reinterpret_cast<uintptr_t>(&node),
                reinterpret_cast<uintptr_t>(
-                   compressor_.unCompress(hashTable_[bucket])));
-    hashTable_[bucket] = getHashNextCompressed(node);
+                   compressor_.unCompress(getHead(bucket))));
+    setHead(bucket, getHashNextCompressed(node));
   }
 }
 
@@ -836,18 +1396,95 @@ template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
 T* ChainedHashTable::Impl<T, HookPtr>::findInBucket(
     Key key, BucketId bucket) const noexcept {
   XDCHECK_LT(bucket, numBuckets_);
-  T* curr = compressor_.unCompress(hashTable_[bucket]);
+  T* curr = compressor_.unCompress(getHead(bucket));
   while (curr != nullptr && curr->getKey() != key) {
     curr = getHashNext(*curr);
   }
   return curr;
 }
 
+template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
+template <typename F>
+std::pair<bool, T*> ChainedHashTable::Impl<T, HookPtr>::findInBucketBounded(
+    Key key, BucketId bucket, size_t maxHops, const F& validate) const {
+  XDCHECK_LT(bucket, numBuckets_);
+  T* curr = compressor_.unCompress(getHead(bucket));
+  for (size_t hops = 0; curr != nullptr; ++hops) {
+    if (hops == maxHops || !validate()) {
+      return {false, nullptr};
+    }
+    if (curr->getKey() == key) {
+      break;
+    }
+    curr = getHashNext(*curr);
+  }
+  return {true, curr};
+}
+
+template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
+template <typename F>
+void ChainedHashTable::Impl<T, HookPtr>::findInBucketsInterleaved(
+    const Key* keys,
+    const BucketId* buckets,
+    const uint32_t* indices,
+    size_t numIndices,
+    size_t maxInFlight,
+    F&& func) const {
+  struct Lookup {
+    uint32_t index;
+    T* curr;
+  };
+  std::array<Lookup, Config::kMaxInterleavedLookups> inFlight;
+
+  size_t next = 0;
+  const auto startLookup = [&](Lookup& l) {
+    if (next == numIndices) {
+      return false;
+    }
+    l.index = indices[next++];
+    XDCHECK_LT(buckets[l.index], numBuckets_);
+    l.curr = compressor_.unCompress(getHead(buckets[l.index]));
+    if (l.curr != nullptr) {
+      __builtin_prefetch(l.curr, 0 /* read */, 3 /* locality */);
+    }
+    return true;
+  };
+
+  const size_t width = std::min<size_t>(
+      std::max<size_t>(maxInFlight, 1), Config::kMaxInterleavedLookups);
+  size_t numActive = 0;
+  while (numActive < width && startLookup(inFlight[numActive])) {
+    ++numActive;
+  }
+
+  size_t slot = 0;
+  while (numActive > 0) {
+    auto& l = inFlight[slot];
+    if (l.curr == nullptr || l.curr->getKey() == keys[l.index]) {
+      func(l.index, l.curr);
+      if (!startLookup(l)) {
+        // retire this slot by moving the last active lookup into it.
+        l = inFlight[--numActive];
+        if (slot == numActive) {
+          slot = 0;
+        }
+        continue;
+      }
+    } else {
+      l.curr = getHashNext(*l.curr);
+      if (l.curr != nullptr) {
+        __builtin_prefetch(l.curr, 0 /* read */, 3 /* locality */);
+      }
+    }
+    slot = (slot + 1 == numActive) ? 0 : slot + 1;
+  }
+}
+
 template <typename T, typename ChainedHashTable::Hook<T> T::*HookPtr>
 T* ChainedHashTable::Impl<T, HookPtr>::findPrevInBucket(
     const T& node, BucketId bucket) const noexcept {
   XDCHECK_LT(bucket, numBuckets_);
-  T* curr = compressor_.unCompress(hashTable_[bucket]);
+  T* curr = compressor_.unCompress(getHead(bucket));
   T* prev = nullptr;
 
   const auto key = node.getKey();
@@ -865,7 +1502,7 @@ template <typename F>
 void ChainedHashTable::Impl<T, HookPtr>::forEachBucketElem(BucketId bucket,
                                                            F&& func) const {
   XDCHECK_LT(bucket, numBuckets_);
-  T* curr = compressor_.unCompress(hashTable_[bucket]);
+  T* curr = compressor_.unCompress(getHead(bucket));
 
   while (curr != nullptr) {
     func(curr);
@@ -878,7 +1515,7 @@ unsigned int ChainedHashTable::Impl<T, HookPtr>::getBucketNumElems(
     BucketId bucket) const {
   XDCHECK_LT(bucket, numBuckets_);
 
-  T* curr = compressor_.unCompress(hashTable_[bucket]);
+  T* curr = compressor_.unCompress(getHead(bucket));
 
   unsigned int numElems = 0;
   while (curr != nullptr) {
@@ -917,16 +1554,37 @@ ChainedHashTable::Container<T, HookPtr, LockT>::Container(
     HandleMaker hm)
     : config_{config},
       handleMaker_(std::move(hm)),
-      ht_{config_.getNumBuckets(), memStart, compressor, config_.getHasher(),
-          false /* resetMem */},
-      locks_{config_.getLocksPower(), config_.getHasher()},
-      numKeys_(*object.numKeys()) {
-  if (config_.getBucketsPower() !=
-      static_cast<uint32_t>(*object.bucketsPower())) {
+      ht_{config_.getMaxNumBuckets(), memStart, compressor,
+          config_.getHasher(), false /* resetMem */},
+      locks_{config_.getLocksPower(), config_.getHasher(),
+             config_.getLockContentionSampleRate()},
+      versions_{createVersions(config_)},
+      readEpochs_{createReadEpochs(config_)},
+      numKeys_(*object.numKeys()),
+      splitState_{makeSplitState(
+          static_cast<unsigned int>(*object.bucketsPower()),
+          static_cast<size_t>(*object.numBucketsSplit()))},
+      resizing_{*object.numBucketsSplit() > 0} {
+  // a hash table that grew keeps its buckets, so it only needs the same
+  // reserved memory and no more buckets than it had to start from.
+  const auto maxBucketsPower = *object.maxBucketsPower() != 0
+                                   ? *object.maxBucketsPower()
+                                   : *object.bucketsPower();
+  if (config_.getMaxBucketsPower() !=
+          static_cast<uint32_t>(maxBucketsPower) ||
+      config_.getBucketsPower() >
+          static_cast<uint32_t>(*object.bucketsPower()) ||
+      *object.bucketsPower() > maxBucketsPower ||
+      *object.numBucketsSplit() < 0 ||
+      static_cast<uint64_t>(*object.numBucketsSplit()) >=
+          (static_cast<uint64_t>(1) << *object.bucketsPower())) {
     throw std::invalid_argument(folly::sformat(
-        "Hashtable bucket power not compatible. old = {}, new = {}",
+        "Hashtable bucket power not compatible. old = {} (max {}), new = {} "
+        "(max {})",
         *object.bucketsPower(),
-        config.getBucketsPower()));
+        maxBucketsPower,
+        config.getBucketsPower(),
+        config_.getMaxBucketsPower()));
   }
 
   if (nBytes != ht_.size()) {
@@ -981,7 +1639,8 @@ ChainedHashTable::Container<T, HookPtr, LockT>::getDistributionStats() const {
 
   // compute the distribution
   std::map<unsigned int, uint64_t> distribution;
-  const auto numBuckets = ht_.getNumBuckets();
+  // buckets are only ever added, so all of these stay in use.
+  const auto numBuckets = getNumActiveBuckets();
   for (BucketId currBucket = 0; currBucket < numBuckets; ++currBucket) {
     auto l = locks_.lockShared(currBucket);
     ++distribution[ht_.getBucketNumElems(currBucket)];
@@ -991,7 +1650,7 @@ ChainedHashTable::Container<T, HookPtr, LockT>::getDistributionStats() const {
   statsLockGuard.lock();
   cachedStats_.numKeys = numKeys;
   cachedStats_.itemDistribution = std::move(distribution);
-  cachedStats_.numBuckets = ht_.getNumBuckets();
+  cachedStats_.numBuckets = numBuckets;
   cachedStatsUpdateTime_ = now;
   canRecomputeDistributionStats_ = true;
   return cachedStats_;
@@ -1006,8 +1665,10 @@ bool ChainedHashTable::Container<T, HookPtr, LockT>::insert(T& node) noexcept {
     return false;
   }
 
-  const auto bucket = ht_.getBucket(node.getKey());
-  auto l = locks_.lockExclusive(bucket);
+  const auto hash = getHash(node.getKey());
+  auto l = locks_.lockExclusive(hash);
+  const auto bucket = getBucket(hash);
+  VersionWriteGuard g{getVersion(bucket)};
   const bool res = ht_.insertInBucket(node, bucket);
 
   if (res) {
@@ -1027,8 +1688,16 @@ ChainedHashTable::Container<T, HookPtr, LockT>::insertOrReplace(T& node) {
     return handleMaker_(nullptr);
   }
 
-  const auto bucket = ht_.getBucket(node.getKey());
-  auto l = locks_.lockExclusive(bucket);
+  const auto hash = getHash(node.getKey());
+  if (config_.getNumInterleavedLookups() > 0) {
+    // overlap the miss on the bucket head with acquiring the lock. A split
+    // can change the bucket until the lock is held, but the prefetch is
+    // only a hint.
+    ht_.prefetchBucket(getBucket(hash));
+  }
+  auto l = locks_.lockExclusive(hash);
+  const auto bucket = getBucket(hash);
+  VersionWriteGuard g{getVersion(bucket)};
   T* oldNode = ht_.insertOrReplaceInBucket(node, bucket);
   XDCHECK_NE(reinterpret_cast<uintptr_t>(&node),
              reinterpret_cast<uintptr_t>(oldNode));
@@ -1074,11 +1743,12 @@ template <typename F>
 bool ChainedHashTable::Container<T, HookPtr, LockT>::replaceIf(T& oldNode,
                                                                T& newNode,
                                                                F&& predicate) {
-  const auto key = newNode.getKey();
-  const auto bucket = ht_.getBucket(key);
-  auto l = locks_.lockExclusive(bucket);
+  const auto hash = getHash(newNode.getKey());
+  auto l = locks_.lockExclusive(hash);
+  const auto bucket = getBucket(hash);
 
   if (oldNode.isAccessible() && predicate(oldNode)) {
+    VersionWriteGuard g{getVersion(bucket)};
     ht_.insertOrReplaceInBucket(newNode, bucket);
     oldNode.unmarkAccessible();
     newNode.markAccessible();
@@ -1091,14 +1761,16 @@ template <typename T,
           typename ChainedHashTable::Hook<T> T::*HookPtr,
           typename LockT>
 bool ChainedHashTable::Container<T, HookPtr, LockT>::remove(T& node) noexcept {
-  const auto bucket = ht_.getBucket(node.getKey());
-  auto l = locks_.lockExclusive(bucket);
+  const auto hash = getHash(node.getKey());
+  auto l = locks_.lockExclusive(hash);
+  const auto bucket = getBucket(hash);
 
   // check inside the lock to prevent from racing removes
   if (!node.isAccessible()) {
     return false;
   }
 
+  VersionWriteGuard g{getVersion(bucket)};
   ht_.removeFromBucket(node, bucket);
   node.unmarkAccessible();
 
@@ -1111,8 +1783,9 @@ template <typename T,
           typename LockT>
 typename T::Handle ChainedHashTable::Container<T, HookPtr, LockT>::removeIf(
     T& node, const std::function<bool(const T& node)>& predicate) {
-  const auto bucket = ht_.getBucket(node.getKey());
-  auto l = locks_.lockExclusive(bucket);
+  const auto hash = getHash(node.getKey());
+  auto l = locks_.lockExclusive(hash);
+  const auto bucket = getBucket(hash);
 
   // check inside the lock to prevent from racing removes
   if (node.isAccessible() && predicate(node)) {
@@ -1120,6 +1793,7 @@ typename T::Handle ChainedHashTable::Container<T, HookPtr, LockT>::removeIf(
     // if handle maker throws an exception, we leave the item in a consistent
     // state.
     auto handle = handleMaker_(&node);
+    VersionWriteGuard g{getVersion(bucket)};
     ht_.removeFromBucket(node, bucket);
     node.unmarkAccessible();
     numKeys_.fetch_sub(1, std::memory_order_relaxed);
@@ -1134,9 +1808,145 @@ template <typename T,
           typename LockT>
 typename T::Handle ChainedHashTable::Container<T, HookPtr, LockT>::find(
     Key key) const {
-  const auto bucket = ht_.getBucket(key);
-  auto l = locks_.lockShared(bucket);
-  return handleMaker_(ht_.findInBucket(key, bucket));
+  const auto hash = getHash(key);
+  if (versions_) {
+    auto handle = findOptimistic(key, hash);
+    if (handle) {
+      return std::move(*handle);
+    }
+  }
+  auto l = locks_.lockShared(hash);
+  return handleMaker_(ht_.findInBucket(key, getBucket(hash)));
+}
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+folly::Optional<typename T::Handle>
+ChainedHashTable::Container<T, HookPtr, LockT>::findOptimistic(
+    Key key, uint32_t hash) const {
+  // the nodes visited below may be removed and freed at any time. The epoch
+  // keeps their memory from being reused for anything but a node until the
+  // lookup is done, see synchronizeOptimisticReads().
+  const auto ticket = readEpochs_->enter();
+  SCOPE_EXIT { readEpochs_->exit(ticket); };
+
+  const auto& version = *getVersion(hash);
+  const auto before = version.load(std::memory_order_acquire);
+  if (before & 1) {
+    // a writer is modifying the chain
+    return folly::none;
+  }
+
+  // splitting a bucket bumps the same version, so the bucket read after it
+  // is the right one unless the validation fails.
+  const auto bucket = getBucket(hash);
+
+  const auto validate = [&]() {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) == before;
+  };
+
+  const auto [completed, node] =
+      ht_.findInBucketBounded(key, bucket, kMaxOptimisticHops, validate);
+  if (!completed || !validate()) {
+    return folly::none;
+  }
+
+  if (node == nullptr) {
+    return handleMaker_(nullptr);
+  }
+
+  // the memory is still a node even if it has been removed since it was
+  // validated, so pinning fails if it is not accessible anymore or if it is
+  // being evicted or moved. The locked lookup handles those cases. A node
+  // freed and allocated again is pinned, but fails the validation below.
+  if (!node->incRefIfAccessible()) {
+    return folly::none;
+  }
+
+  // the pin keeps the node from becoming exclusive, so the handle maker can
+  // not fail to acquire it. The handle holds its own reference, hence
+  // dropping the pin can never release the node.
+  Handle handle;
+  try {
+    handle = handleMaker_(node);
+  } catch (const std::exception&) {
+    node->decRef();
+    throw;
+  }
+  node->decRef();
+
+  if (!validate()) {
+    return folly::none;
+  }
+  return std::move(handle);
+}
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+std::vector<typename T::Handle>
+ChainedHashTable::Container<T, HookPtr, LockT>::findBatch(
+    folly::Range<const Key*> keys) const {
+  const size_t numKeys = keys.size();
+  std::vector<uint32_t> hashes(numKeys);
+  for (size_t i = 0; i < numKeys; ++i) {
+    hashes[i] = getHash(keys[i]);
+    ht_.prefetchBucket(getBucket(hashes[i]));
+  }
+
+  // locks are picked by masking the hash. Sort the lookups by their lock so
+  // that all the keys sharing a lock are looked up under one acquisition.
+  const size_t locksMask = config_.getNumLocks() - 1;
+  std::vector<uint32_t> order(numKeys);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return (hashes[a] & locksMask) < (hashes[b] & locksMask);
+  });
+
+  std::vector<Handle> handles(numKeys);
+  const size_t maxInFlight = config_.getNumInterleavedLookups();
+  if (maxInFlight > 0) {
+    // walk the chains of a window of keys concurrently. All the distinct
+    // locks for the window are held at once; they are acquired in increasing
+    // order and writers only ever hold a single lock, so this can not
+    // deadlock.
+    using ReadLockHolder = typename LockT::ReadLockHolder;
+    std::vector<ReadLockHolder> holders;
+    holders.reserve(maxInFlight);
+    std::vector<BucketId> buckets(numKeys);
+    for (size_t start = 0; start < numKeys; start += maxInFlight) {
+      const size_t end = std::min(numKeys, start + maxInFlight);
+      for (size_t j = start; j < end; ++j) {
+        const auto hash = hashes[order[j]];
+        if (j == start ||
+            (hashes[order[j - 1]] & locksMask) != (hash & locksMask)) {
+          holders.push_back(locks_.lockShared(hash));
+        }
+        buckets[order[j]] = getBucket(hash);
+      }
+      ht_.findInBucketsInterleaved(
+          keys.data(), buckets.data(), order.data() + start, end - start,
+          maxInFlight,
+          [&](uint32_t idx, T* node) { handles[idx] = handleMaker_(node); });
+      holders.clear();
+    }
+    return handles;
+  }
+
+  size_t i = 0;
+  while (i < numKeys) {
+    const auto lockId = hashes[order[i]] & locksMask;
+    auto l = locks_.lockShared(hashes[order[i]]);
+    do {
+      const auto idx = order[i];
+      handles[idx] =
+          handleMaker_(ht_.findInBucket(keys[idx], getBucket(hashes[idx])));
+      ++i;
+    } while (i < numKeys && (hashes[order[i]] & locksMask) == lockId);
+  }
+  return handles;
 }
 
 template <typename T,
@@ -1154,8 +1964,18 @@ ChainedHashTable::Container<T, HookPtr, LockT>::saveState() const {
         folly::sformat("There are {} pending iterators", numIterators_.load()));
   }
 
+  // no split can start or finish while the state is captured.
+  std::lock_guard<std::mutex> resizeGuard(resizeLock_);
+  const auto state = splitState_.load(std::memory_order_acquire);
+
+  // the saved memory is restored as is, so it can not have buckets in use
+  // that are still waiting to be initialized.
+  ht_.initializeBuckets(getNumActiveBuckets(state));
+
   serialization::ChainedHashTableObject object;
-  *object.bucketsPower() = config_.getBucketsPower();
+  *object.bucketsPower() = getBucketsPower(state);
+  *object.maxBucketsPower() = config_.getMaxBucketsPower();
+  *object.numBucketsSplit() = getNumSplitBuckets(state);
   *object.locksPower() = config_.getLocksPower();
   *object.numKeys() = numKeys_;
   *object.hasherMagicId() = config_.getHasher()->getMagicId();
@@ -1200,7 +2020,7 @@ ChainedHashTable::Container<T, HookPtr, LockT>::Iterator::operator++() {
   }
 
   ++currBucket_;
-  for (; currBucket_ < container_->config_.getNumBuckets(); ++currBucket_) {
+  for (; currBucket_ < container_->getNumActiveBuckets(); ++currBucket_) {
     container_->getBucketElems(currBucket_, bucketElems_);
     if (!bucketElems_.empty()) {
       curSor_ = 0;
@@ -1213,6 +2033,7 @@ ChainedHashTable::Container<T, HookPtr, LockT>::Iterator::operator++() {
   // reach the end
   bucketElems_.clear();
   curSor_ = 0;
+  currBucket_ = kEndBucket;
   return *this;
 }
 
@@ -1270,7 +2091,7 @@ template <typename T,
           typename LockT>
 ChainedHashTable::Container<T, HookPtr, LockT>::Iterator::Iterator(
     Container<T, HookPtr, LockT>& container, EndIterT)
-    : container_(&container), currBucket_{container_->config_.getNumBuckets()} {
+    : container_(&container), currBucket_{kEndBucket} {
   // increment the iterator for both the end and begin() types so that the
   // destructor can just blindly decrement.
   ++container_->numIterators_;
@@ -1294,12 +2115,93 @@ void ChainedHashTable::Container<T, HookPtr, LockT>::Iterator::reset() {
   currBucket_ = 0;
   container_->getBucketElems(currBucket_, bucketElems_);
   while (bucketElems_.empty() &&
-         ++currBucket_ < container_->config_.getNumBuckets()) {
+         ++currBucket_ < container_->getNumActiveBuckets()) {
     if (throttler_) {
       throttler_->throttle();
     }
     container_->getBucketElems(currBucket_, bucketElems_);
   }
+  if (bucketElems_.empty()) {
+    currBucket_ = kEndBucket;
+  }
   XDCHECK_EQ(0u, curSor_);
 }
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+bool ChainedHashTable::Container<T, HookPtr, LockT>::startResize() {
+  std::lock_guard<std::mutex> g(resizeLock_);
+  return startResizeLocked();
+}
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+bool ChainedHashTable::Container<T, HookPtr,
+                                 LockT>::startResizeLocked() noexcept {
+  if (resizing_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  const auto state = splitState_.load(std::memory_order_relaxed);
+  if (getBucketsPower(state) >= config_.getMaxBucketsPower()) {
+    return false;
+  }
+  resizing_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+size_t ChainedHashTable::Container<T, HookPtr, LockT>::resizeStep(
+    size_t maxBuckets) {
+  std::lock_guard<std::mutex> g(resizeLock_);
+  if (!resizing_.load(std::memory_order_relaxed)) {
+    const auto numBuckets =
+        getNumLowerBuckets(splitState_.load(std::memory_order_relaxed));
+    if (static_cast<double>(getNumKeys()) <=
+            config_.getMaxLoadFactor() * static_cast<double>(numBuckets) ||
+        !startResizeLocked()) {
+      return 0;
+    }
+  }
+
+  // iterators walk the buckets in order and would miss the nodes moved
+  // into the buckets they have already passed.
+  size_t numSplit = 0;
+  while (numSplit < maxBuckets && resizing_.load(std::memory_order_relaxed) &&
+         numIterators_ == 0) {
+    splitNextBucket();
+    ++numSplit;
+  }
+  return numSplit;
+}
+
+template <typename T,
+          typename ChainedHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+void ChainedHashTable::Container<T, HookPtr,
+                                 LockT>::splitNextBucket() noexcept {
+  const auto state = splitState_.load(std::memory_order_relaxed);
+  const auto bucketsPower = getBucketsPower(state);
+  const size_t numLower = getNumLowerBuckets(state);
+  const BucketId bucket = getNumSplitBuckets(state);
+
+  // the bucket and its sibling share the lock and the version since there
+  // are never more locks than buckets.
+  auto l = locks_.lockExclusive(bucket);
+  VersionWriteGuard vg{getVersion(bucket)};
+  ht_.splitBucket(bucket, bucket + numLower, static_cast<uint32_t>(numLower));
+
+  if (bucket + 1 == numLower) {
+    splitState_.store(makeSplitState(bucketsPower + 1, 0),
+                      std::memory_order_release);
+    resizing_.store(false, std::memory_order_relaxed);
+    numResizes_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    splitState_.store(makeSplitState(bucketsPower, bucket + 1),
+                      std::memory_order_release);
+  }
+}
 } // namespace facebook::cachelib
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/lang/Align.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cachelib/allocator/Cache.h"
+#include "cachelib/common/PeriodicWorker.h"
+
+namespace facebook::cachelib {
+// wrapper that exposes the private APIs of CacheType that are specifically
+// needed for the DeferredReleaser.
+template <typename C>
+struct DeferredReleaserAPIWrapper {
+  using Item = typename C::Item;
+
+  static void releaseBackToAllocator(C& cache, Item& item, RemoveContext ctx) {
+    cache.releaseBackToAllocator(item, ctx, /* nascent */ false);
+  }
+
+  static void runEvictionCallbacks(C& cache,
+                                   Item& copy,
+                                   bool runDestructor,
+                                   PoolId pid) {
+    cache.runItemCallbacks(copy, RemoveContext::kEviction, runDestructor, pid);
+  }
+};
+
+struct DeferredReleaserStats {
+  // items released after being deferred
+  uint64_t numDeferred{0};
+
+  // items released inline because too many were pending
+  uint64_t numOverflows{0};
+
+  // items waiting to be released
+  uint64_t numPending{0};
+};
+
+// Releases the items removed from the cache on a background thread, in
+// batches, so that the remove callback and the item destructor do not run on
+// the thread that dropped the last handle. The items keep their memory until
+// they are released.
+//
+// Items are queued on the shard of the current cpu. The worker wakes up once
+// a shard holds a batch, or every interval otherwise. Once maxPending items
+// wait, callers release their items themselves, which bounds the memory held
+// back and pushes back on the threads dropping items faster than the worker
+// releases them. Every item is released exactly once: either by the caller
+// when defer() fails, or by whoever takes it off its shard.
+//
+// The memory of an evicted item is reused right away, so the callbacks of an
+// evicted item run on a copy of it instead, see deferEvicted().
+template <typename CacheT>
+class DeferredReleaser : public PeriodicWorker {
+ public:
+  using Item = typename CacheT::Item;
+
+  // @param cache       the cache the items are released to
+  // @param maxPending  items waiting at most, beyond which defer() fails
+  // @param batchSize   items queued on a shard before the worker is woken up
+  DeferredReleaser(CacheT& cache, size_t maxPending, size_t batchSize)
+      : cache_(cache),
+        maxPending_(maxPending),
+        batchSize_(std::max<size_t>(batchSize, 1)),
+        shards_(std::max(1u, std::thread::hardware_concurrency())) {}
+
+  ~DeferredReleaser() override { stop(std::chrono::seconds(0)); }
+
+  // hand over an item whose last reference was dropped
+  //
+  // @return false if the item was not taken and has to be released by the
+  //         caller
+  bool defer(Item& item, RemoveContext ctx) {
+    if (!accepting_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (numPending_.fetch_add(1, std::memory_order_acq_rel) >= maxPending_) {
+      numPending_.fetch_sub(1, std::memory_order_acq_rel);
+      numOverflows_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    auto& shard = getShard();
+    size_t queued = 0;
+    {
+      std::lock_guard<std::mutex> l(shard.mutex);
+      // checked again under the lock, see setAccepting()
+      if (!accepting_.load(std::memory_order_acquire)) {
+        numPending_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+      }
+      shard.items.emplace_back(&item, ctx);
+      queued = shard.items.size() + shard.evicted.size();
+    }
+    if (queued == batchSize_) {
+      wakeUp();
+    }
+    return true;
+  }
+
+  // hand over an evicted item without chained items, whose callbacks run on
+  // a copy of it, so that its memory can be freed by the caller right away
+  //
+  // @param runDestructor  whether the item destructor runs after the remove
+  //                       callback
+  // @param pid            the pool the item was evicted from
+  //
+  // @return false if the item was not taken and its callbacks have to be
+  //         run by the caller
+  bool deferEvicted(const Item& item, bool runDestructor, PoolId pid) {
+    XDCHECK(!item.hasChainedItem());
+    if (!accepting_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (numPending_.fetch_add(1, std::memory_order_acq_rel) >= maxPending_) {
+      numPending_.fetch_sub(1, std::memory_order_acq_rel);
+      numOverflows_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // the key and the value follow the header, so the copy is read through
+    // the same accessors as the item
+    const auto size = item.getTotalSize();
+    std::unique_ptr<uint8_t[]> bytes{new uint8_t[size]};
+    std::memcpy(bytes.get(), &item, size);
+
+    auto& shard = getShard();
+    size_t queued = 0;
+    {
+      std::lock_guard<std::mutex> l(shard.mutex);
+      if (!accepting_.load(std::memory_order_acquire)) {
+        numPending_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+      }
+      shard.evicted.push_back(
+          EvictedCopy{std::move(bytes), runDestructor, pid});
+      queued = shard.items.size() + shard.evicted.size();
+    }
+    if (queued == batchSize_) {
+      wakeUp();
+    }
+    return true;
+  }
+
+  // release the items waiting on every shard on the calling thread, and run
+  // the callbacks of the evicted ones
+  //
+  // @return the number of items released
+  size_t flush() {
+    return flushImpl([](auto& items, auto& batch) { batch.swap(items); }) +
+           flushEvicted();
+  }
+
+  // release the waiting items that shouldRelease returns true for on the
+  // calling thread, leaving the others on their shards. The copies of the
+  // evicted items hold no memory of the cache and are left alone.
+  //
+  // @return the number of items released
+  template <typename Fn>
+  size_t flush(Fn&& shouldRelease) {
+    return flushImpl([&shouldRelease](auto& items, auto& batch) {
+      auto it = std::partition(
+          items.begin(), items.end(),
+          [&](const auto& entry) { return !shouldRelease(*entry.first); });
+      batch.assign(it, items.end());
+      items.erase(it, items.end());
+    });
+  }
+
+  // Start or stop taking items. Once stopped, the items already taken are
+  // released before returning. An item is added to its shard under the
+  // shard lock after checking the flag there, so flush() takes every item
+  // that was accepted.
+  void setAccepting(bool accepting) {
+    accepting_.store(accepting, std::memory_order_release);
+    if (!accepting) {
+      flush();
+    }
+  }
+
+  DeferredReleaserStats getStats() const noexcept {
+    DeferredReleaserStats stats;
+    stats.numDeferred = numDeferred_.load(std::memory_order_relaxed);
+    stats.numOverflows = numOverflows_.load(std::memory_order_relaxed);
+    stats.numPending = numPending_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  // copy of an evicted item, whose memory was freed already
+  struct EvictedCopy {
+    std::unique_ptr<uint8_t[]> bytes;
+    bool runDestructor{false};
+    PoolId pid{Slab::kInvalidPoolId};
+  };
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    std::mutex mutex;
+    std::vector<std::pair<Item*, RemoveContext>> items;
+    std::vector<EvictedCopy> evicted;
+  };
+
+  void work() override final { flush(); }
+
+  // release the items that take moves from every shard into the batch
+  template <typename TakeFn>
+  size_t flushImpl(TakeFn&& take) {
+    size_t released = 0;
+    std::vector<std::pair<Item*, RemoveContext>> batch;
+    for (auto& shard : shards_) {
+      {
+        std::lock_guard<std::mutex> l(shard.mutex);
+        take(shard.items, batch);
+      }
+      for (auto [item, ctx] : batch) {
+        try {
+          DeferredReleaserAPIWrapper<CacheT>::releaseBackToAllocator(
+              cache_, *item, ctx);
+        } catch (const std::exception& e) {
+          XLOGF(CRITICAL, "Failed to release item {}: {}", item->toString(),
+                e.what());
+          XDCHECK(false);
+        }
+      }
+      released += batch.size();
+      numPending_.fetch_sub(batch.size(), std::memory_order_acq_rel);
+      batch.clear();
+    }
+    numDeferred_.fetch_add(released, std::memory_order_relaxed);
+    return released;
+  }
+
+  // run the callbacks of the evicted items waiting on every shard
+  size_t flushEvicted() {
+    size_t released = 0;
+    std::vector<EvictedCopy> batch;
+    for (auto& shard : shards_) {
+      {
+        std::lock_guard<std::mutex> l(shard.mutex);
+        batch.swap(shard.evicted);
+      }
+      for (auto& copy : batch) {
+        auto& item = *reinterpret_cast<Item*>(copy.bytes.get());
+        try {
+          DeferredReleaserAPIWrapper<CacheT>::runEvictionCallbacks(
+              cache_, item, copy.runDestructor, copy.pid);
+        } catch (const std::exception& e) {
+          XLOGF(CRITICAL, "Failed to run the callbacks of evicted item {}: {}",
+                item.toString(), e.what());
+          XDCHECK(false);
+        }
+      }
+      released += batch.size();
+      numPending_.fetch_sub(batch.size(), std::memory_order_acq_rel);
+      batch.clear();
+    }
+    numDeferred_.fetch_add(released, std::memory_order_relaxed);
+    return released;
+  }
+
+  Shard& getShard() {
+    return shards_[folly::AccessSpreader<>::cachedCurrent(shards_.size())];
+  }
+
+  CacheT& cache_;
+  const size_t maxPending_;
+  const size_t batchSize_;
+
+  std::atomic<bool> accepting_{false};
+  std::atomic<size_t> numPending_{0};
+  std::atomic<uint64_t> numDeferred_{0};
+  std::atomic<uint64_t> numOverflows_{0};
+
+  std::vector<Shard> shards_;
+};
+} // namespace facebook::cachelib
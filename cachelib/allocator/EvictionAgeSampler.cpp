@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/EvictionAgeSampler.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace facebook::cachelib {
+
+EvictionAgeSampler::EvictionAgeSampler(uint32_t sampleRate,
+                                       uint32_t windowSize)
+    : sampleRate_(sampleRate), windowSize_(windowSize) {
+  if (sampleRate_ == 0 || windowSize_ < 2) {
+    throw std::invalid_argument(folly::sformat(
+        "Sampled eviction ages need a non zero sample rate and a window of "
+        "at least 2 samples, but got sample rate {} and window {}",
+        sampleRate_, windowSize_));
+  }
+}
+
+size_t EvictionAgeSampler::getBucketIdx(uint32_t ageSecs) noexcept {
+  if (ageSecs < kNumSubBuckets) {
+    return static_cast<size_t>(ageSecs);
+  }
+  // the kSubBucketBits bits after the most significant one pick the bucket
+  // within the power of two range.
+  const unsigned int shift = folly::findLastSet(ageSecs) - 1 - kSubBucketBits;
+  const size_t subBucket = (ageSecs >> shift) - kNumSubBuckets;
+  return kNumSubBuckets * (shift + 1) + subBucket;
+}
+
+uint32_t EvictionAgeSampler::getBucketAge(size_t idx) noexcept {
+  if (idx < kNumSubBuckets) {
+    return static_cast<uint32_t>(idx);
+  }
+  const size_t shift = idx / kNumSubBuckets - 1;
+  const uint64_t subBucket = idx % kNumSubBuckets;
+  const uint64_t maxAge = ((kNumSubBuckets + subBucket + 1) << shift) - 1;
+  return static_cast<uint32_t>(
+      std::min<uint64_t>(maxAge, std::numeric_limits<uint32_t>::max()));
+}
+
+SampledEvictionAgeStat EvictionAgeSampler::getStat(ClassId cid) const {
+  const auto& histogram = histograms_[cid];
+  std::array<uint64_t, kNumBuckets> counts;
+  uint64_t total = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    counts[i] = histogram.counts[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+
+  SampledEvictionAgeStat stat;
+  stat.numSamples = total;
+  if (total == 0) {
+    return stat;
+  }
+
+  // age of the first bucket at which the samples so far reach the percentile
+  auto getPercentile = [&](double pct) -> uint64_t {
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(pct * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        return getBucketAge(i);
+      }
+    }
+    return getBucketAge(kNumBuckets - 1);
+  };
+  stat.p10 = getPercentile(0.1);
+  stat.p50 = getPercentile(0.5);
+  stat.p90 = getPercentile(0.9);
+  stat.p99 = getPercentile(0.99);
+  return stat;
+}
+
+void EvictionAgeSampler::decay(Histogram& histogram) noexcept {
+  for (auto& count : histogram.counts) {
+    count.fetch_sub(count.load(std::memory_order_relaxed) / 2,
+                    std::memory_order_relaxed);
+  }
+  histogram.numSamples.fetch_sub(windowSize_ / 2, std::memory_order_relaxed);
+}
+} // namespace facebook::cachelib
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cachelib/allocator/CacheStats.h"
+#include "cachelib/allocator/memory/MemoryAllocator.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Samples the ages of the items evicted from each allocation class of a pool
+// into a histogram per class. Recording a sample bumps two atomic counters
+// and never takes the lock of an MM container, unlike walking the tail of the
+// eviction queue, so the eviction ages are always at hand.
+//
+// A histogram only covers the recent evictions: once a class has windowSize
+// samples, all its counts are halved. Ages below 8 seconds have a bucket
+// each. Past that every power of two range is split into 8 buckets, so an
+// estimate is within 1/8th of the age.
+class EvictionAgeSampler {
+ public:
+  // @param sampleRate  one out of this many evictions is sampled
+  // @param windowSize  number of samples after which the histogram of a
+  //                    class is halved
+  //
+  // @throw std::invalid_argument if sampleRate is 0 or windowSize is less
+  //        than 2
+  EvictionAgeSampler(uint32_t sampleRate, uint32_t windowSize);
+
+  // record the age of an evicted item if it is picked by the sampling.
+  void recordEviction(ClassId cid, uint32_t ageSecs) noexcept {
+    static thread_local uint32_t numEvictions = 0;
+    if (++numEvictions % sampleRate_ != 0) {
+      return;
+    }
+    auto& histogram = histograms_[cid];
+    histogram.counts[getBucketIdx(ageSecs)].fetch_add(
+        1, std::memory_order_relaxed);
+    if (histogram.numSamples.fetch_add(1, std::memory_order_relaxed) + 1 ==
+        windowSize_) {
+      decay(histogram);
+    }
+  }
+
+  // @return the percentiles of the sampled eviction ages of the class
+  SampledEvictionAgeStat getStat(ClassId cid) const;
+
+  // @return the bucket an age is tracked in
+  static size_t getBucketIdx(uint32_t ageSecs) noexcept;
+
+  // @return the largest age that falls into the bucket
+  static uint32_t getBucketAge(size_t idx) noexcept;
+
+ private:
+  static constexpr unsigned int kSubBucketBits = 3;
+  static constexpr uint32_t kNumSubBuckets = 1u << kSubBucketBits;
+  // exact buckets for the first kNumSubBuckets seconds, then kNumSubBuckets
+  // per power of two up to 2^32 seconds.
+  static constexpr size_t kNumBuckets =
+      kNumSubBuckets * (32 - kSubBucketBits + 1);
+
+  struct Histogram {
+    // samples recorded since the histogram was last halved, plus the ones
+    // that were left by halving it
+    std::atomic<uint32_t> numSamples{0};
+    std::array<std::atomic<uint32_t>, kNumBuckets> counts{};
+  };
+
+  // halve the counts of the histogram. Only the thread whose sample filled
+  // the window does this, so no two threads halve the same histogram at
+  // once. Racing with recordEviction at worst loses a few samples.
+  void decay(Histogram& histogram) noexcept;
+
+  const uint32_t sampleRate_;
+  const uint32_t windowSize_;
+
+  std::array<Histogram, MemoryAllocator::kMaxClasses> histograms_{};
+};
+} // namespace cachelib
+} // namespace facebook
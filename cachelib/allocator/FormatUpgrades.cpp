@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/FormatUpgrades.h"
+
+#include "cachelib/allocator/CacheVersion.h"
+
+namespace facebook::cachelib {
+
+FormatUpgrader<serialization::CacheAllocatorMetadata>& getRamFormatUpgrader() {
+  static auto* upgrader = [] {
+    auto* ret = new FormatUpgrader<serialization::CacheAllocatorMetadata>(
+        kCacheRamFormatVersion);
+    // Register the steps from older ram format versions here, e.g.
+    //   ret->addStep(3, [](serialization::CacheAllocatorMetadata& meta) {...});
+    return ret;
+  }();
+  return *upgrader;
+}
+
+FormatUpgrader<serialization::NvmCacheMetadata>& getNvmFormatUpgrader() {
+  static auto* upgrader = [] {
+    auto* ret = new FormatUpgrader<serialization::NvmCacheMetadata>(
+        kCacheNvmFormatVersion);
+    // Register the steps from older nvm format versions here.
+    return ret;
+  }();
+  return *upgrader;
+}
+} // namespace facebook::cachelib
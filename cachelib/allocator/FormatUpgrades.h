@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/FormatUpgrader.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Upgrade paths for the metadata persisted by a previous cachelib version, so
+// that bumping kCacheRamFormatVersion or kCacheNvmFormatVersion does not drop
+// the cache of every user when the change can be translated.
+//
+// When bumping one of the versions for a change that the previous layout can
+// be translated into, register a step in FormatUpgrades.cpp upgrading from
+// the previous version. The step gets the deserialized metadata of the
+// previous version and must leave it as the current version would have
+// persisted it; the version field is set by the restore path. Data that the
+// metadata describes (slabs in shared memory, regions on flash) is not
+// translated, so a bump that changes their layout must not register a step.
+// Without a step the cache is dropped on a version mismatch, as before.
+
+// Upgrades CacheAllocatorMetadata to kCacheRamFormatVersion on a shared memory
+// attach.
+FormatUpgrader<serialization::CacheAllocatorMetadata>& getRamFormatUpgrader();
+
+// Upgrades NvmCacheMetadata to kCacheNvmFormatVersion when the nvm cache is
+// recovered.
+FormatUpgrader<serialization::NvmCacheMetadata>& getNvmFormatUpgrader();
+} // namespace cachelib
+} // namespace facebook
@@ -19,11 +19,13 @@
 #include <folly/Function.h>
 #include <folly/fibers/Baton.h>
 #include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
 #include <gtest/gtest.h>
 
 #include <iostream>
 #include <mutex>
+#include <utility>
 
 #include "cachelib/allocator/nvmcache/WaitContext.h"
 #include "cachelib/common/Exceptions.h"
@@ -44,6 +46,16 @@ enum class HandleFlags : uint8_t {
   kWentToNvm = 1 << 2,
 };
 
+// A reference of a handle that is counted on a stripe of a striped refcount
+// rather than on the item (see StripedRefcounts).
+struct StripedRef {
+  static constexpr uint8_t kNoStripe = 0xff;
+
+  uint8_t slot{0};
+  uint8_t stripe{kNoStripe};
+  uint16_t generation{0};
+};
+
 template <typename T>
 struct WriteHandleImpl;
 
@@ -70,7 +82,12 @@ struct ReadHandleImpl {
 
     assert(alloc_ != nullptr);
     try {
-      alloc_->release(it_, isNascent());
+      if (hasStripedRef()) {
+        alloc_->releaseStripedRef(it_, std::exchange(stripedRef_, {}),
+                                  /* keepItemRef */ false);
+      } else {
+        alloc_->release(it_, isNascent());
+      }
     } catch (const std::exception& e) {
       XLOGF(CRITICAL, "Failed to release {} : {}", static_cast<void*>(it_),
             e.what());
@@ -86,6 +103,11 @@ struct ReadHandleImpl {
       waitContext_->releaseHandle();
       waitContext_.reset();
     } else {
+      // the caller takes over a reference on the item itself
+      if (hasStripedRef()) {
+        alloc_->releaseStripedRef(it_, std::exchange(stripedRef_, {}),
+                                  /* keepItemRef */ true);
+      }
       it_ = nullptr;
     }
     return ret;
@@ -100,7 +122,8 @@ struct ReadHandleImpl {
       : alloc_(other.alloc_),
         it_(other.releaseItem()),
         waitContext_(std::move(other.waitContext_)),
-        flags_(other.getFlags()) {}
+        flags_(other.getFlags()),
+        stripedRef_(std::exchange(other.stripedRef_, {})) {}
 
   FOLLY_ALWAYS_INLINE ReadHandleImpl& operator=(
       ReadHandleImpl&& other) noexcept {
@@ -193,6 +216,17 @@ struct ReadHandleImpl {
     }
   }
 
+#if FOLLY_HAS_COROUTINES
+  // Lets a folly::coro::Task co_await a handle moved into it, e.g.
+  // `auto hdl = co_await cache.find(key);`. The task is suspended until an
+  // nvm fill makes the handle ready, instead of blocking its thread, and is
+  // resumed on its executor with the ready handle.
+  friend folly::Future<ReadHandleImpl> co_viaIfAsync(
+      folly::Executor::KeepAlive<> executor, ReadHandleImpl&& handle) {
+    return std::move(handle).toSemiFuture().via(std::move(executor));
+  }
+#endif
+
   WriteHandleImpl<T> toWriteHandle() && {
     XDCHECK_NE(alloc_, nullptr);
     XDCHECK_NE(getInternal(), nullptr);
@@ -221,7 +255,9 @@ struct ReadHandleImpl {
     return getFlags() & static_cast<uint8_t>(HandleFlags::kExpired);
   }
 
-  // blocks until `isReady() == true`.
+  // blocks until `isReady() == true`. On a fiber, only the fiber is
+  // suspended and its thread runs the other fibers meanwhile. Coroutines
+  // should co_await the handle instead.
   void wait() const noexcept {
     if (isReady()) {
       return;
@@ -243,6 +279,21 @@ struct ReadHandleImpl {
     return hdl;
   }
 
+  // Convert the handle into a chain of IOBufs over the memory of the item
+  // and its chained items, or over the chunks of a large item, for zero copy
+  // writes such as writev. The IOBufs take over the reference of the
+  // handle, which becomes empty, and release it once they are destroyed.
+  // See CacheAllocator::convertToIOBuf.
+  //
+  // @throw std::invalid_argument if the handle is empty
+  folly::IOBuf toIOBuf() && {
+    if (!alloc_) {
+      throw std::invalid_argument("null item handle for converting to IOBuf");
+    }
+    auto& alloc = *alloc_;
+    return alloc.convertToIOBuf(std::move(*this));
+  }
+
  protected:
   // accessor. Calling getInternal() on handle with isReady() == false blocks
   // the thread until the handle is ready.
@@ -395,7 +446,9 @@ struct ReadHandleImpl {
       // refcount so that alloc_.release does not decrement it to negative.
       alloc_.adjustHandleCountForThread_private(1);
       try {
-        alloc_.release(it, /* isNascent */ false);
+        // nvmcache hands out items it did not insert as nascent
+        alloc_.release(
+            it, flags_ & static_cast<uint8_t>(HandleFlags::kNascent));
       } catch (const std::exception& e) {
         XLOGF(CRITICAL, "Failed to release {:#10x} : {}",
               static_cast<void*>(it), e.what());
@@ -471,6 +524,11 @@ struct ReadHandleImpl {
   }
   void cloneFlags(const ReadHandleImpl& other) { flags_ = other.getFlags(); }
 
+  bool hasStripedRef() const noexcept {
+    return stripedRef_.stripe != StripedRef::kNoStripe;
+  }
+  void setStripedRef(StripedRef ref) noexcept { stripedRef_ = ref; }
+
   Item* releaseItem() noexcept { return std::exchange(it_, nullptr); }
 
   // User of a handle can access cache via this accessor
@@ -529,6 +587,9 @@ struct ReadHandleImpl {
 
   mutable uint8_t flags_{};
 
+  // set when the reference of the handle is counted on a stripe
+  StripedRef stripedRef_{};
+
   // Only CacheAllocator and NvmCache can create non-default constructed handles
   friend CacheT;
   friend typename CacheT::NvmCacheT;
@@ -571,6 +632,17 @@ struct WriteHandleImpl : public ReadHandleImpl<T> {
   //        creating this item handle.
   WriteHandleImpl clone() const { return WriteHandleImpl{ReadHandle::clone()}; }
 
+#if FOLLY_HAS_COROUTINES
+  // Same as for ReadHandleImpl, resuming with a write handle.
+  friend folly::Future<WriteHandleImpl> co_viaIfAsync(
+      folly::Executor::KeepAlive<> executor, WriteHandleImpl&& handle) {
+    return std::move(handle)
+        .toSemiFuture()
+        .deferValue([](ReadHandle h) { return WriteHandleImpl{std::move(h)}; })
+        .via(std::move(executor));
+  }
+#endif
+
   // Friends
   friend ReadHandle;
   // Only CacheAllocator and NvmCache can create non-default constructed handles
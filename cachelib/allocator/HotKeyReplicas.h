@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/ThreadLocal.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/lang/Align.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "cachelib/common/Time.h"
+#include "cachelib/common/hothash/HotHashDetector.h"
+
+namespace facebook {
+namespace cachelib {
+
+struct HotKeyReplicationConfig {
+  // number of buckets of the hot hash detector of every thread, a power of
+  // two
+  size_t detectorBuckets{1024};
+
+  // size of the warm set of the detectors. A key is hot when it is looked up
+  // at least hotnessMultiplier times more than the keys of the warm set.
+  size_t detectorWarmItems{100};
+  size_t detectorHotnessMultiplier{10};
+
+  // number of per core shards of replicas. 0 picks the number of cpus.
+  uint32_t numShards{0};
+
+  // number of replicas kept by every shard
+  uint32_t replicasPerShard{8};
+
+  // items with a larger value are not replicated
+  uint32_t maxValueSize{4096};
+
+  // number of generation counters that replicas are invalidated through, a
+  // power of two. Keys sharing a counter invalidate each other's replicas.
+  size_t numGenerations{1 << 16};
+
+  // replicas older than this are not served. This bounds how long a reader
+  // can see an older copy of an item whose value was mutated in place.
+  std::chrono::milliseconds replicaLifetime{1000};
+
+  // @throw std::invalid_argument if the config is invalid
+  void validate() const {
+    auto isPowerOfTwo = [](size_t n) { return n != 0 && (n & (n - 1)) == 0; };
+    if (!isPowerOfTwo(detectorBuckets) || !isPowerOfTwo(numGenerations)) {
+      throw std::invalid_argument(folly::sformat(
+          "Hot key detector buckets ({}) and generations ({}) must be powers "
+          "of two",
+          detectorBuckets, numGenerations));
+    }
+    if (detectorWarmItems == 0 || detectorHotnessMultiplier == 0 ||
+        replicasPerShard == 0) {
+      throw std::invalid_argument(
+          "Hot key detector warm items, hotness multiplier and replicas per "
+          "shard must be positive");
+    }
+  }
+};
+
+// Read-only copies of the items of very hot keys, kept per core so that the
+// readers of a key that is looked up from every core do not all go through
+// the same access container lock and bump the same refcount.
+//
+// Keys are found hot by a HotHashDetector per thread. A replica is a copy of
+// the item that is never inserted into the cache. It is only valid while the
+// generation counter of its key hash is unchanged, and every change of the
+// key in the cache bumps that counter. A replica that is made from an item
+// looked up after the generation was read is therefore never served once
+// the item is replaced, removed, evicted or expired.
+//
+// Replicas are held through nascent handles, so releasing them does not run
+// the remove callback or the item destructor.
+template <typename CacheT>
+class HotKeyReplicas {
+ public:
+  using Item = typename CacheT::Item;
+  using Key = typename Item::Key;
+  using WriteHandle = typename CacheT::WriteHandle;
+
+  explicit HotKeyReplicas(const HotKeyReplicationConfig& config)
+      : config_(config),
+        detectors_([config]() {
+          return new HotHashDetector(config.detectorBuckets,
+                                     config.detectorWarmItems,
+                                     config.detectorHotnessMultiplier);
+        }),
+        shards_(getNumShards(config)),
+        generationsMask_(config.numGenerations - 1),
+        generations_(std::make_unique<std::atomic<uint64_t>[]>(
+            config.numGenerations)) {
+    config_.validate();
+    for (auto& shard : shards_) {
+      shard.replicas.resize(config_.replicasPerShard);
+    }
+  }
+
+  const HotKeyReplicationConfig& getConfig() const noexcept { return config_; }
+
+  // bump the hash on the detector of the calling thread
+  //
+  // @return true if the key of the hash is very hot
+  bool bumpHash(uint64_t hash) { return detectors_->bumpHash(hash) != 0; }
+
+  // @return  the generation of the key hash. Read it before looking up the
+  //          item to replicate and pass it to add().
+  uint64_t getGeneration(uint64_t hash) const noexcept {
+    return generations_[hash & generationsMask_].load(
+        std::memory_order_acquire);
+  }
+
+  // make the replicas of the key hash stale. Call it after the change of the
+  // key is visible in the cache.
+  void invalidate(uint64_t hash) noexcept {
+    generations_[hash & generationsMask_].fetch_add(1,
+                                                    std::memory_order_acq_rel);
+  }
+
+  // look up a fresh replica of the key on the shard of the current cpu
+  //
+  // @param acquire   called with the replica under the shard lock to get a
+  //                  handle to it
+  //
+  // @return  the handle returned by acquire, or an empty handle if the shard
+  //          has no fresh replica of the key
+  template <typename AcquireFn>
+  WriteHandle find(Key key, uint64_t hash, AcquireFn&& acquire) {
+    auto& shard = getShard();
+    const auto now = util::getCurrentTimeMs();
+    std::lock_guard<std::mutex> l(shard.mutex);
+    for (auto& replica : shard.replicas) {
+      if (replica.hash != hash || !replica.handle ||
+          replica.handle->getKey() != key) {
+        continue;
+      }
+      if (replica.generation != getGeneration(hash) ||
+          now - replica.creationTimeMs >
+              static_cast<uint64_t>(config_.replicaLifetime.count()) ||
+          replica.handle->isExpired()) {
+        return WriteHandle{};
+      }
+      return acquire(replica.handle.get());
+    }
+    return WriteHandle{};
+  }
+
+  // keep a replica of a key on the shard of the current cpu, in place of the
+  // stale or the oldest replica of the shard.
+  //
+  // @param generation  the generation of the key hash read before the item
+  //                    that was copied into the replica was looked up
+  //
+  // @return  the handle that was displaced, or the replica itself if the key
+  //          changed since the generation was read
+  WriteHandle add(uint64_t hash, uint64_t generation, WriteHandle handle) {
+    auto& shard = getShard();
+    std::lock_guard<std::mutex> l(shard.mutex);
+    if (getGeneration(hash) != generation) {
+      return handle;
+    }
+
+    Replica* victim = &shard.replicas[0];
+    for (auto& replica : shard.replicas) {
+      if (!replica.handle || replica.hash == hash ||
+          replica.generation != getGeneration(replica.hash)) {
+        victim = &replica;
+        break;
+      }
+      if (replica.creationTimeMs < victim->creationTimeMs) {
+        victim = &replica;
+      }
+    }
+    auto displaced = std::move(victim->handle);
+    victim->hash = hash;
+    victim->generation = generation;
+    victim->creationTimeMs = util::getCurrentTimeMs();
+    victim->handle = std::move(handle);
+    return displaced;
+  }
+
+  // drop all the replicas
+  //
+  // @return the handles of the replicas
+  std::vector<WriteHandle> clear() {
+    return clear([](const Item&) { return true; });
+  }
+
+  // drop the replicas that shouldDrop returns true for
+  //
+  // @return the handles of the dropped replicas
+  template <typename Fn>
+  std::vector<WriteHandle> clear(Fn&& shouldDrop) {
+    std::vector<WriteHandle> handles;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> l(shard.mutex);
+      for (auto& replica : shard.replicas) {
+        if (replica.handle && shouldDrop(*replica.handle)) {
+          handles.push_back(std::move(replica.handle));
+        }
+      }
+    }
+    return handles;
+  }
+
+ private:
+  struct Replica {
+    uint64_t hash{0};
+    uint64_t generation{0};
+    uint64_t creationTimeMs{0};
+    WriteHandle handle{};
+  };
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    std::mutex mutex;
+    std::vector<Replica> replicas;
+  };
+
+  static size_t getNumShards(const HotKeyReplicationConfig& config) {
+    if (config.numShards != 0) {
+      return config.numShards;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  Shard& getShard() {
+    return shards_[folly::AccessSpreader<>::cachedCurrent(shards_.size())];
+  }
+
+  HotKeyReplicationConfig config_;
+
+  // not thread safe, hence one per thread
+  folly::ThreadLocal<HotHashDetector> detectors_;
+
+  std::vector<Shard> shards_;
+
+  const size_t generationsMask_;
+  std::unique_ptr<std::atomic<uint64_t>[]> generations_;
+};
+
+} // namespace cachelib
+} // namespace facebook
@@ -42,11 +42,18 @@ class ICompactCache {
   // get the config size of the compact cache
   virtual size_t getConfiguredSize() const = 0;
 
+  // get the memory held by the entries whose hits count as tail hits, i.e.
+  // the marginal memory of the compact cache (in bytes)
+  virtual size_t getTailSize() const = 0;
+
   // get the stats about the compact cache
   virtual CCacheStats getStats() const = 0;
 
   // resize the compact cache according to configured size
   virtual void resize() = 0;
+
+  // get the progress of resizing the compact cache
+  virtual CCacheResizeStats getResizeStats() const = 0;
 };
 } // namespace cachelib
 } // namespace facebook
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/common/CompilerUtils.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Layout of the parent of a large item. The value of a large item is split
+// into chunks that are chained items of the parent, and the parent holds the
+// compressed pointers of the chunks in the order of the value:
+//
+// | Header | chunk 0 | chunk 1 | ... | chunk n - 1 |
+//
+// Readers decompress the pointers and prefetch all the chunks up front
+// instead of following the chain one dependent miss at a time, in reverse
+// order. The cache updates the pointer of a chunk whenever the chunk is
+// moved or replaced in the chain.
+template <typename CompressedPtrType>
+class LargeItemLayout {
+ public:
+  // the payload of an item is not necessarily aligned
+  struct CACHELIB_PACKED_ATTR Header {
+    uint64_t magic;
+    uint64_t valueSize;
+    uint32_t numChunks;
+    uint32_t reserved;
+  };
+
+  static constexpr uint64_t kMagic = 0x4c61726765497478; // "LargeItx"
+
+  // @return the size of the parent of a large item with that many chunks
+  static uint32_t getParentSize(uint32_t numChunks) noexcept {
+    return static_cast<uint32_t>(sizeof(Header) +
+                                 numChunks * sizeof(CompressedPtrType));
+  }
+
+  // @return the header of the parent with this payload, nullptr if it is
+  //         not the parent of a large item
+  static const Header* getHeader(const void* payload, uint32_t size) noexcept {
+    if (size < sizeof(Header)) {
+      return nullptr;
+    }
+    const auto* header = reinterpret_cast<const Header*>(payload);
+    if (header->magic != kMagic ||
+        size != getParentSize(header->numChunks)) {
+      return nullptr;
+    }
+    return header;
+  }
+
+  static void initHeader(void* payload,
+                         uint64_t valueSize,
+                         uint32_t numChunks) noexcept {
+    auto* header = reinterpret_cast<Header*>(payload);
+    header->magic = kMagic;
+    header->valueSize = valueSize;
+    header->numChunks = numChunks;
+    header->reserved = 0;
+  }
+
+  // compressed pointers are packed, hence copied in and out
+  static CompressedPtrType getChunk(const void* payload, uint32_t idx) noexcept {
+    CompressedPtrType ptr;
+    std::memcpy(&ptr, getChunkAddr(payload, idx), sizeof(ptr));
+    return ptr;
+  }
+
+  static void setChunk(void* payload,
+                       uint32_t idx,
+                       CompressedPtrType ptr) noexcept {
+    std::memcpy(const_cast<uint8_t*>(getChunkAddr(payload, idx)), &ptr,
+                sizeof(ptr));
+  }
+
+ private:
+  static const uint8_t* getChunkAddr(const void* payload,
+                                     uint32_t idx) noexcept {
+    return reinterpret_cast<const uint8_t*>(payload) + sizeof(Header) +
+           idx * sizeof(CompressedPtrType);
+  }
+};
+
+// exposes the value of a large item as its chunks in order. The chunks are
+// resolved and prefetched when the view is created. Like CacheChainedAllocs,
+// the view blocks replacing the chunks of the item until it is released.
+template <typename Cache, typename Handle>
+class CacheLargeItem {
+ public:
+  using Item = typename Cache::Item;
+  using ChainedItem = typename Cache::ChainedItem;
+  using Layout = LargeItemLayout<typename Item::CompressedPtrType>;
+
+  CacheLargeItem(CacheLargeItem&&) = default;
+  CacheLargeItem& operator=(CacheLargeItem&&) = default;
+
+  // return the parent of the chunks
+  const Item& getParentItem() const noexcept { return *parent_; }
+
+  // @return the size of the value
+  uint64_t getSize() const noexcept { return size_; }
+
+  size_t getNumChunks() const noexcept { return chunks_.size(); }
+
+  // @return the nth chunk of the value, n = 0 being the beginning
+  ChainedItem& getChunk(size_t n) const { return *chunks_.at(n); }
+
+  // copy the value into a buffer of at least getSize() bytes
+  void copyTo(void* dst) const {
+    auto* out = reinterpret_cast<uint8_t*>(dst);
+    for (const auto* chunk : chunks_) {
+      std::memcpy(out, chunk->getMemory(), chunk->getSize());
+      out += chunk->getSize();
+    }
+  }
+
+  // @return a chain of IOBufs over the chunks in order. The IOBufs share a
+  //         handle to the parent, which keeps the chunks alive, and do not
+  //         block replacing chunks.
+  std::unique_ptr<folly::IOBuf> toIOBuf() const {
+    auto sharedHdl = std::make_shared<Handle>(parent_.clone());
+    std::unique_ptr<folly::IOBuf> head;
+    for (auto* chunk : chunks_) {
+      auto buf = folly::IOBuf::takeOwnership(
+          chunk->getMemory(), chunk->getSize(),
+          [](void*, void* userData) {
+            delete reinterpret_cast<std::shared_ptr<Handle>*>(userData);
+          } /* freeFunc */,
+          new std::shared_ptr<Handle>{sharedHdl} /* userData for freeFunc */);
+      buf->markExternallySharedOne();
+      if (head) {
+        head->prependChain(std::move(buf));
+      } else {
+        head = std::move(buf);
+      }
+    }
+    return head;
+  }
+
+ private:
+  friend Cache;
+  using LockType = typename Cache::ChainedItemLock;
+  using ReadLockHolder = typename LockType::ReadLockHolder;
+  using PtrCompressor = typename Item::PtrCompressor;
+
+  CacheLargeItem(const CacheLargeItem&) = delete;
+  CacheLargeItem& operator=(const CacheLargeItem&) = delete;
+
+  // only the cache can create this view of a large item
+  //
+  // @param l       the lock to be held while the chunks are accessed
+  // @param parent  handle to the parent
+  // @param c       pointer compressor to resolve the chunks
+  //
+  // @throw std::invalid_argument if the parent is not a large item
+  CacheLargeItem(ReadLockHolder l, Handle parent, const PtrCompressor& c)
+      : lock_(std::move(l)), parent_(std::move(parent)) {
+    const auto* header =
+        Layout::getHeader(parent_->getMemory(), parent_->getSize());
+    if (!header || !parent_->isLargeItem() || !parent_->hasChainedItem()) {
+      throw std::invalid_argument("Parent is not a large item");
+    }
+    size_ = header->valueSize;
+    chunks_.reserve(header->numChunks);
+    for (uint32_t i = 0; i < header->numChunks; i++) {
+      auto* chunk = &c.unCompress(Layout::getChunk(parent_->getMemory(), i))
+                         ->asChainedItem();
+      // the chunks do not depend on each other, so their misses overlap
+      __builtin_prefetch(chunk, 0 /* read */, 3 /* locality */);
+      chunks_.push_back(chunk);
+    }
+  }
+
+  // lock protecting the chunks from being replaced
+  ReadLockHolder lock_;
+
+  // handle to the parent item. holding this ensures that the chunks are not
+  // evicted or moved.
+  Handle parent_;
+
+  uint64_t size_{0};
+  std::vector<ChainedItem*> chunks_;
+};
+} // namespace cachelib
+} // namespace facebook
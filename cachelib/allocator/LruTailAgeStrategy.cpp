@@ -28,8 +28,18 @@ namespace facebook::cachelib {
 LruTailAgeStrategy::LruTailAgeStrategy(Config config)
     : RebalanceStrategy(LruTailAge), config_(std::move(config)) {}
 
+bool LruTailAgeStrategy::useSampledAge(
+    const PoolEvictionAgeStats& poolEvictionAgeStats, ClassId cid) const {
+  return config_.useSampledEvictionAges &&
+         poolEvictionAgeStats.getSampledEvictionStat(cid).numSamples >=
+             config_.minEvictionAgeSamples;
+}
+
 uint64_t LruTailAgeStrategy::getOldestElementAge(
     const PoolEvictionAgeStats& poolEvictionAgeStats, ClassId cid) const {
+  if (useSampledAge(poolEvictionAgeStats, cid)) {
+    return poolEvictionAgeStats.getSampledEvictionStat(cid).p50;
+  }
   switch (config_.queueSelector) {
   case Config::QueueSelector::kHot:
     return poolEvictionAgeStats.classEvictionAgeStats.at(cid)
@@ -48,6 +58,9 @@ uint64_t LruTailAgeStrategy::getOldestElementAge(
 
 uint64_t LruTailAgeStrategy::getProjectedAge(
     const PoolEvictionAgeStats& poolEvictionAgeStats, ClassId cid) const {
+  if (useSampledAge(poolEvictionAgeStats, cid)) {
+    return poolEvictionAgeStats.getSampledEvictionStat(cid).p50;
+  }
   switch (config_.queueSelector) {
   case Config::QueueSelector::kHot:
     return poolEvictionAgeStats.classEvictionAgeStats.at(cid)
@@ -151,7 +164,7 @@ RebalanceContext LruTailAgeStrategy::pickVictimAndReceiverImpl(
   const auto config = getConfigCopy();
 
   const auto poolEvictionAgeStats =
-      cache.getPoolEvictionAgeStats(pid, config.slabProjectionLength);
+      cache.getPoolEvictionAgeStats(pid, getSlabProjectionLength(config));
 
   RebalanceContext ctx;
   ctx.victimClassId = pickVictim(config, pid, poolStats, poolEvictionAgeStats);
@@ -193,7 +206,7 @@ ClassId LruTailAgeStrategy::pickVictimImpl(const CacheBase& cache,
                                            const PoolStats& poolStats) {
   const auto config = getConfigCopy();
   const auto poolEvictionAgeStats =
-      cache.getPoolEvictionAgeStats(pid, config.slabProjectionLength);
+      cache.getPoolEvictionAgeStats(pid, getSlabProjectionLength(config));
   return pickVictim(config, pid, poolStats, poolEvictionAgeStats);
 }
 } // namespace facebook::cachelib
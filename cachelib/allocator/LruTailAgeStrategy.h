@@ -61,6 +61,16 @@ class LruTailAgeStrategy : public RebalanceStrategy {
     enum class QueueSelector { kHot, kWarm, kCold };
     QueueSelector queueSelector{QueueSelector::kWarm};
 
+    // Use the median of the sampled eviction ages of a class as both its tail
+    // age and its projected age, which is less noisy than the age of the one
+    // item at the tail and is read without locking the MM containers. The
+    // eviction queues are then only peeked at, never walked for the
+    // projection, and only classes with fewer than minEvictionAgeSamples
+    // samples use the queues. Needs sampled eviction ages to be enabled on
+    // the cache.
+    bool useSampledEvictionAges{false};
+    uint64_t minEvictionAgeSamples{32};
+
     // The free memory threshold to be used to pick victim class.
     size_t getFreeMemThreshold() const noexcept {
       return numSlabsFreeMem * Slab::kSize;
@@ -98,7 +108,11 @@ class LruTailAgeStrategy : public RebalanceStrategy {
         {"slab_projection_length",
          folly::sformat("{}", config_.slabProjectionLength)},
         {"queue_selector",
-         folly::sformat("{}", static_cast<int>(config_.queueSelector))}};
+         folly::sformat("{}", static_cast<int>(config_.queueSelector))},
+        {"use_sampled_eviction_ages",
+         folly::sformat("{}", config_.useSampledEvictionAges)},
+        {"min_eviction_age_samples",
+         folly::sformat("{}", config_.minEvictionAgeSamples)}};
   }
 
  protected:
@@ -143,6 +157,16 @@ class LruTailAgeStrategy : public RebalanceStrategy {
   uint64_t getProjectedAge(const PoolEvictionAgeStats& poolEvictionAgeStats,
                            ClassId cid) const;
 
+  // @return whether the sampled eviction ages of the class are used in place
+  //         of its eviction queue
+  bool useSampledAge(const PoolEvictionAgeStats& poolEvictionAgeStats,
+                     ClassId cid) const;
+
+  // @return number of slabs worth of items to walk for the projected ages
+  static unsigned int getSlabProjectionLength(const Config& config) {
+    return config.useSampledEvictionAges ? 0 : config.slabProjectionLength;
+  }
+
   // Config for this strategy, this can be updated anytime.
   // Do not access this directly, always use `getConfig()` to
   // obtain a copy first
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 
 #pragma GCC diagnostic push
@@ -23,6 +24,7 @@
 #include <folly/Format.h>
 #pragma GCC diagnostic pop
 
+#include <folly/ThreadLocal.h>
 #include <folly/lang/Align.h>
 #include <folly/synchronization/DistributedMutex.h>
 
@@ -352,8 +354,28 @@ class MM2Q {
 
     // Whether to use combined locking for withEvictionIterator.
     bool useCombinedLockForIterators{false};
+
+    // Number of Warm and Cold promotions each thread buffers before applying
+    // them to the lrus in a batch under a single lock acquisition. 0
+    // disables buffering. If tryLockUpdate is set and the lock can not be
+    // grabbed when the buffer is full, the buffered promotions are dropped.
+    // This is only honored when the container is created and is capped at
+    // kMaxPromotionBufferSize.
+    uint32_t promotionBufferSize{0};
+
+    // If set, hits on items in the Hot queue only mark the item accessed,
+    // and only the first hit after the item was last looked at takes the
+    // lru lock. When rebalance() shrinks Hot, an item at its tail that was
+    // accessed since it was last looked at goes back to the head of Hot
+    // instead of to Cold (CLOCK). The accessed bit is the tail bit of the
+    // item, so this is ignored when tail hits tracking is on. It is also
+    // ignored when Hot is the whole cache, since Hot is then never shrunk.
+    bool hotClockHits{false};
   };
 
+  // upper bound for Config::promotionBufferSize
+  static constexpr uint32_t kMaxPromotionBufferSize = 32;
+
   // The container object which can be used to keep track of objects of type
   // T. T must have a public member of type Hook. This object is wrapper
   // around DList, is thread safe and can be accessed from multiple threads.
@@ -382,6 +404,7 @@ class MM2Q {
               ? std::numeric_limits<Time>::max()
               : static_cast<Time>(util::getCurrentTimeSec()) +
                     config_.mmReconfigureIntervalSecs.count();
+      initPromotionBuffers();
     }
 
     // If the serialized data has 3 lists and we want to expand to 5 lists
@@ -504,6 +527,13 @@ class MM2Q {
     template <typename F>
     void withContainerLock(F&& f);
 
+    // Calls fun with the nodes from the most recently used one until it
+    // returns false, under the container lock: the warm queue, then the hot
+    // and the cold ones, each from its head. fun must not call back into
+    // the container.
+    template <typename F>
+    void forEachFromMRU(F&& fun);
+
     // get the current config as a copy
     Config getConfig() const;
 
@@ -535,7 +565,52 @@ class MM2Q {
     //       Since we need to always turn on the Tail feature.
     LruType getLruType(const T& node) const noexcept;
 
+    // Drop the promotions that are buffered by all threads. This must be
+    // called once the memory of nodes that were in this container could be
+    // handed over to a different container (e.g. after releasing a slab),
+    // since buffered promotions refer to nodes by pointer.
+    void invalidateBufferedAccesses() noexcept;
+
    private:
+    // promotions buffered by a thread. Entries are only valid if epoch
+    // matches the container's bufferEpoch_.
+    struct PromotionBuffer {
+      std::array<std::pair<T*, Time>, kMaxPromotionBufferSize> entries;
+      uint32_t size{0};
+      uint64_t epoch{0};
+    };
+    struct PromotionBufferTag {};
+    using PromotionBuffers =
+        folly::ThreadLocal<PromotionBuffer, PromotionBufferTag>;
+
+    void initPromotionBuffers() {
+      if (config_.promotionBufferSize > 0) {
+        promotionBuffers_ = std::make_unique<PromotionBuffers>();
+      }
+    }
+
+    // buffer the promotion of the node in this thread's buffer. Applies all
+    // the buffered promotions once the buffer is full.
+    //
+    // @return  true if the promotion is buffered or applied, false if it was
+    //          dropped
+    bool bufferPromotion(T& node, Time curr) noexcept;
+
+    // apply the buffered promotions and empty the buffer. Must be called
+    // with the lru lock held.
+    void drainPromotionBufferLocked(PromotionBuffer& buffer,
+                                    Time curr) noexcept;
+
+    // move the node to the head of its lru, or of Warm if it is in Cold.
+    // Must be called with the lru lock held.
+    void promoteLocked(T& node, Time curr) noexcept;
+
+    // whether hits on hot nodes only mark them accessed
+    bool useHotClock() const noexcept {
+      return config_.hotClockHits && config_.tailSize == 0 &&
+             config_.hotSizePercent < 100;
+    }
+
     // reconfigure the MMContainer: update LRU refresh time according to current
     // tail age
     void reconfigureLocked(const Time& currTime);
@@ -573,6 +648,23 @@ class MM2Q {
       return node.template isFlagSet<RefFlags::kMMFlag0>();
     }
 
+    // In the hot clock mode, MM_Bit_1 records whether a hot node was
+    // accessed since rebalance() last looked at it. Hot nodes are never in
+    // a tail, and the tail bit is unused when tail hits tracking is off.
+    // Since the bit doubles as the tail bit, it is only set with the lru
+    // lock held while the node is hot, and cleared when the node leaves Hot.
+    void markHotAccessed(T& node) noexcept {
+      node.template setFlag<RefFlags::kMMFlag1>();
+    }
+
+    void unmarkHotAccessed(T& node) noexcept {
+      node.template unSetFlag<RefFlags::kMMFlag1>();
+    }
+
+    bool isHotAccessed(const T& node) const noexcept {
+      return node.template isFlagSet<RefFlags::kMMFlag1>();
+    }
+
     // Bit MM_BIT_2 is used to record if the item is cold.
     void markCold(T& node) noexcept {
       node.template setFlag<RefFlags::kMMFlag2>();
@@ -667,6 +759,12 @@ class MM2Q {
     // Reads may be racy.
     Config config_{};
 
+    // Per thread promotion buffers. nullptr if buffering is disabled.
+    std::unique_ptr<PromotionBuffers> promotionBuffers_;
+
+    // Bumped under the lru lock to invalidate all buffered promotions.
+    std::atomic<uint64_t> bufferEpoch_{0};
+
     // Max lruFreshTime.
     static constexpr uint32_t kLruRefreshTimeCap{900};
 
@@ -700,6 +798,7 @@ MM2Q::Container<T, HookPtr>::Container(const serialization::MM2QObject& object,
     lru_.insertEmptyListAt(LruType::WarmTail, compressor);
     lru_.insertEmptyListAt(LruType::ColdTail, compressor);
   }
+  initPromotionBuffers();
 }
 
 template <typename T, MM2Q::Hook<T> T::*HookPtr>
@@ -711,46 +810,47 @@ bool MM2Q::Container<T, HookPtr>::recordAccess(T& node,
   }
 
   const auto curr = static_cast<Time>(util::getCurrentTimeSec());
+  if (useHotClock() && isHot(node)) {
+    // the hot queue is only reordered when it is shrunk
+    if (!node.isInMMContainer()) {
+      return false;
+    }
+    // further hits until rebalance() looks at the node take no lock
+    if (isHotAccessed(node)) {
+      return true;
+    }
+
+    // the node may have left Hot since it was checked
+    auto mark = [&]() {
+      if (!node.isInMMContainer() || !isHot(node) || !useHotClock()) {
+        return false;
+      }
+      markHotAccessed(node);
+      return true;
+    };
+    if (config_.tryLockUpdate) {
+      if (auto lck = LockHolder{*lruMutex_, std::try_to_lock}) {
+        return mark();
+      }
+      return false;
+    }
+    return lruMutex_->lock_combine(mark);
+  }
+
   // check if the node is still being memory managed
   if (node.isInMMContainer() &&
       ((curr >= getUpdateTime(node) +
                     lruRefreshTime_.load(std::memory_order_relaxed)))) {
+    if (promotionBuffers_) {
+      return bufferPromotion(node, curr);
+    }
+
     auto func = [&]() {
       reconfigureLocked(curr);
       if (!node.isInMMContainer()) {
         return false;
       }
-      if (isHot(node)) {
-        lru_.getList(LruType::Hot).moveToHead(node);
-        ++numHotAccesses_;
-      } else if (isCold(node)) {
-        if (inTail(node)) {
-          unmarkTail(node);
-          lru_.getList(LruType::ColdTail).remove(node);
-          ++numColdTailAccesses_;
-        } else {
-          lru_.getList(LruType::Cold).remove(node);
-        }
-        lru_.getList(LruType::Warm).linkAtHead(node);
-        unmarkCold(node);
-        ++numColdAccesses_;
-        // only rebalance if config says so. recordAccess is called mostly on
-        // latency sensitive cache get operations.
-        if (config_.rebalanceOnRecordAccess) {
-          rebalance();
-        }
-      } else {
-        if (inTail(node)) {
-          unmarkTail(node);
-          lru_.getList(LruType::WarmTail).remove(node);
-          lru_.getList(LruType::Warm).linkAtHead(node);
-          ++numWarmTailAccesses_;
-        } else {
-          lru_.getList(LruType::Warm).moveToHead(node);
-        }
-        ++numWarmAccesses_;
-      }
-      setUpdateTime(node, curr);
+      promoteLocked(node, curr);
       return true;
     };
 
@@ -771,6 +871,103 @@ bool MM2Q::Container<T, HookPtr>::recordAccess(T& node,
   return false;
 }
 
+template <typename T, MM2Q::Hook<T> T::*HookPtr>
+void MM2Q::Container<T, HookPtr>::promoteLocked(T& node, Time curr) noexcept {
+  if (isHot(node)) {
+    lru_.getList(LruType::Hot).moveToHead(node);
+    ++numHotAccesses_;
+  } else if (isCold(node)) {
+    if (inTail(node)) {
+      unmarkTail(node);
+      lru_.getList(LruType::ColdTail).remove(node);
+      ++numColdTailAccesses_;
+    } else {
+      lru_.getList(LruType::Cold).remove(node);
+    }
+    lru_.getList(LruType::Warm).linkAtHead(node);
+    unmarkCold(node);
+    ++numColdAccesses_;
+    // only rebalance if config says so. recordAccess is called mostly on
+    // latency sensitive cache get operations.
+    if (config_.rebalanceOnRecordAccess) {
+      rebalance();
+    }
+  } else {
+    if (inTail(node)) {
+      unmarkTail(node);
+      lru_.getList(LruType::WarmTail).remove(node);
+      lru_.getList(LruType::Warm).linkAtHead(node);
+      ++numWarmTailAccesses_;
+    } else {
+      lru_.getList(LruType::Warm).moveToHead(node);
+    }
+    ++numWarmAccesses_;
+  }
+  setUpdateTime(node, curr);
+}
+
+template <typename T, MM2Q::Hook<T> T::*HookPtr>
+bool MM2Q::Container<T, HookPtr>::bufferPromotion(T& node,
+                                                  Time curr) noexcept {
+  auto& buffer = **promotionBuffers_;
+  if (buffer.size == 0) {
+    buffer.epoch = bufferEpoch_.load(std::memory_order_relaxed);
+  }
+  buffer.entries[buffer.size++] = std::make_pair(&node, curr);
+
+  const uint32_t capacity =
+      std::min(config_.promotionBufferSize, kMaxPromotionBufferSize);
+  if (buffer.size < capacity) {
+    return true;
+  }
+
+  auto func = [this, &buffer, curr]() {
+    reconfigureLocked(curr);
+    drainPromotionBufferLocked(buffer, curr);
+  };
+
+  if (config_.tryLockUpdate) {
+    if (auto lck = LockHolder{*lruMutex_, std::try_to_lock}) {
+      func();
+      return true;
+    }
+    // drop the buffered promotions rather than waiting for the lock
+    buffer.size = 0;
+    return false;
+  }
+
+  lruMutex_->lock_combine(func);
+  return true;
+}
+
+template <typename T, MM2Q::Hook<T> T::*HookPtr>
+void MM2Q::Container<T, HookPtr>::drainPromotionBufferLocked(
+    PromotionBuffer& buffer, Time curr) noexcept {
+  // nodes buffered before the last invalidation may no longer belong to this
+  // container and must not be touched.
+  if (buffer.epoch == bufferEpoch_.load(std::memory_order_relaxed)) {
+    for (uint32_t i = 0; i < buffer.size; i++) {
+      auto& [node, time] = buffer.entries[i];
+      // the node might have been removed or promoted since it was buffered
+      if (node->isInMMContainer() &&
+          curr >= getUpdateTime(*node) +
+                      lruRefreshTime_.load(std::memory_order_relaxed)) {
+        promoteLocked(*node, time);
+      }
+    }
+  }
+  buffer.size = 0;
+}
+
+template <typename T, MM2Q::Hook<T> T::*HookPtr>
+void MM2Q::Container<T, HookPtr>::invalidateBufferedAccesses() noexcept {
+  if (!promotionBuffers_) {
+    return;
+  }
+  lruMutex_->lock_combine(
+      [this]() { bufferEpoch_.fetch_add(1, std::memory_order_relaxed); });
+}
+
 template <typename T, MM2Q::Hook<T> T::*HookPtr>
 cachelib::EvictionAgeStat MM2Q::Container<T, HookPtr>::getEvictionAgeStat(
     uint64_t projectedLength) const noexcept {
@@ -865,14 +1062,30 @@ void MM2Q::Container<T, HookPtr>::rebalance() noexcept {
     markCold(*node);
   }
 
-  // shrink Hot if its size is larger than expected
+  // shrink Hot if its size is larger than expected. In the hot clock mode,
+  // nodes accessed since they were last looked at get a second chance at the
+  // head of Hot, at most once per node of Hot in a rebalance.
   expectedSize = config_.hotSizePercent * lru_.size() / 100;
+  const bool hotClock = useHotClock();
+  size_t numSecondChances = 0;
   while (lru_.getList(LruType::Hot).size() > expectedSize) {
     auto node = lru_.getList(LruType::Hot).getTail();
     XDCHECK(node);
     XDCHECK(isHot(*node));
+    if (hotClock && isHotAccessed(*node) &&
+        numSecondChances < lru_.getList(LruType::Hot).size()) {
+      unmarkHotAccessed(*node);
+      lru_.getList(LruType::Hot).moveToHead(*node);
+      setUpdateTime(*node, static_cast<Time>(util::getCurrentTimeSec()));
+      ++numHotAccesses_;
+      ++numSecondChances;
+      continue;
+    }
     lru_.getList(LruType::Hot).remove(*node);
     lru_.getList(LruType::Cold).linkAtHead(*node);
+    // hot nodes are never in a tail, so this only clears a stale accessed
+    // bit, whatever the config is now
+    unmarkHotAccessed(*node);
     unmarkHot(*node);
     markCold(*node);
   }
@@ -926,6 +1139,20 @@ void MM2Q::Container<T, HookPtr>::withContainerLock(F&& fun) {
   lruMutex_->lock_combine([&fun]() { fun(); });
 }
 
+template <typename T, MM2Q::Hook<T> T::*HookPtr>
+template <typename F>
+void MM2Q::Container<T, HookPtr>::forEachFromMRU(F&& fun) {
+  lruMutex_->lock_combine([this, &fun]() {
+    for (int type = 0; type < LruType::NumTypes; type++) {
+      for (auto it = lru_.getList(type).begin(); it; ++it) {
+        if (!fun(*it)) {
+          return;
+        }
+      }
+    }
+  });
+}
+
 template <typename T, MM2Q::Hook<T> T::*HookPtr>
 void MM2Q::Container<T, HookPtr>::removeLocked(T& node,
                                                bool doRebalance) noexcept {
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cstring>
 
@@ -23,6 +24,7 @@
 #pragma GCC diagnostic ignored "-Wconversion"
 #include <folly/Format.h>
 #pragma GCC diagnostic pop
+#include <folly/ThreadLocal.h>
 #include <folly/container/Array.h>
 #include <folly/lang/Aligned.h>
 #include <folly/synchronization/DistributedMutex.h>
@@ -234,8 +236,35 @@ class MMLru {
 
     // Whether to use combined locking for withEvictionIterator.
     bool useCombinedLockForIterators{false};
+
+    // Number of promotions each thread buffers before applying them to the
+    // lru in a batch under a single lock acquisition. 0 disables buffering.
+    // If tryLockUpdate is set and the lock can not be grabbed when the buffer
+    // is full, the buffered promotions are dropped. This is only honored when
+    // the container is created and is capped at kMaxPromotionBufferSize.
+    uint32_t promotionBufferSize{0};
+
+    // Track the contention on the lru lock. Acquisitions by add, remove,
+    // replace, promotions and eviction iterators that find the lock held are
+    // counted, and the wait of one out of this many of them is timed. 0
+    // disables the tracking. Sampled acquisitions take the lock without
+    // combining their critical section with the lock holder's. This is only
+    // honored when the container is created.
+    uint32_t lockContentionSampleRate{0};
+
+    // Sampled eviction, like Redis. If non-zero, accesses never take the lru
+    // lock: they only stamp the update time of the node and mark it accessed.
+    // Every eviction iterator first looks at this many nodes at the tail of
+    // the lru, moves the ones accessed since they were last looked at to the
+    // head and the least recently updated of the others to the tail, where
+    // the eviction starts. lruRefreshTime and the promotion buffers are not
+    // used in this mode.
+    uint32_t evictionSampleSize{0};
   };
 
+  // upper bound for Config::promotionBufferSize
+  static constexpr uint32_t kMaxPromotionBufferSize = 32;
+
   // The container object which can be used to keep track of objects of type
   // T. T must have a public member of type Hook. This object is wrapper
   // around DList, is thread safe and can be accessed from multiple threads.
@@ -264,6 +293,8 @@ class MMLru {
               ? std::numeric_limits<Time>::max()
               : static_cast<Time>(util::getCurrentTimeSec()) +
                     config_.mmReconfigureIntervalSecs.count();
+      initPromotionBuffers();
+      initLockContentionStats();
     }
     Container(serialization::MMLruObject object, PtrCompressor compressor);
 
@@ -378,6 +409,12 @@ class MMLru {
     template <typename F>
     void withContainerLock(F&& f);
 
+    // Calls fun with the nodes from the most recently used one until it
+    // returns false, under the container lock. fun must not call back into
+    // the container.
+    template <typename F>
+    void forEachFromMRU(F&& fun);
+
     // get copy of current config
     Config getConfig() const;
 
@@ -413,7 +450,98 @@ class MMLru {
       return LruType{};
     }
 
+    // Drop the promotions that are buffered by all threads. This must be
+    // called once the memory of nodes that were in this container could be
+    // handed over to a different container (e.g. after releasing a slab),
+    // since buffered promotions refer to nodes by pointer.
+    void invalidateBufferedAccesses() noexcept;
+
    private:
+    // promotions buffered by a thread. Entries are only valid if epoch
+    // matches the container's bufferEpoch_.
+    struct PromotionBuffer {
+      std::array<std::pair<T*, Time>, kMaxPromotionBufferSize> entries;
+      uint32_t size{0};
+      uint64_t epoch{0};
+    };
+    struct PromotionBufferTag {};
+    using PromotionBuffers =
+        folly::ThreadLocal<PromotionBuffer, PromotionBufferTag>;
+
+    void initPromotionBuffers() {
+      if (config_.promotionBufferSize > 0) {
+        promotionBuffers_ = std::make_unique<PromotionBuffers>();
+      }
+    }
+
+    void initLockContentionStats() {
+      if (config_.lockContentionSampleRate > 0) {
+        lockContentionStats_ = std::make_unique<util::LockContentionStats>(
+            1, config_.lockContentionSampleRate);
+      }
+    }
+
+    // grab the lru lock, timing the wait if the acquisition is contended and
+    // sampled.
+    LockHolder lockLru() const {
+      if (lockContentionStats_) {
+        if (auto l = LockHolder{*lruMutex_, std::try_to_lock}) {
+          return l;
+        }
+        if (lockContentionStats_->recordContention(0)) {
+          return lockLruTimed();
+        }
+      }
+      return LockHolder{*lruMutex_};
+    }
+
+    // run fun under the lru lock. Same as lruMutex_->lock_combine when the
+    // contention is not tracked.
+    template <typename F>
+    auto lockCombine(F&& fun) const {
+      if (lockContentionStats_) {
+        if (auto l = LockHolder{*lruMutex_, std::try_to_lock}) {
+          return fun();
+        }
+        if (lockContentionStats_->recordContention(0)) {
+          auto l = lockLruTimed();
+          return fun();
+        }
+      }
+      return lruMutex_->lock_combine(fun);
+    }
+
+    LockHolder lockLruTimed() const {
+      const auto begin = std::chrono::steady_clock::now();
+      LockHolder l{*lruMutex_};
+      lockContentionStats_->recordWait(
+          0, std::chrono::steady_clock::now() - begin);
+      return l;
+    }
+
+    // count a promotion dropped because the lru lock was held.
+    void recordTryLockFailure() const noexcept {
+      if (lockContentionStats_) {
+        lockContentionStats_->recordContention(0);
+      }
+    }
+
+    // buffer the promotion of the node in this thread's buffer. Applies all
+    // the buffered promotions once the buffer is full.
+    //
+    // @return  true if the promotion is buffered or applied, false if it was
+    //          dropped
+    bool bufferPromotion(T& node, Time curr) noexcept;
+
+    // apply the buffered promotions and empty the buffer. Must be called
+    // with the lru lock held.
+    void drainPromotionBufferLocked(PromotionBuffer& buffer,
+                                    Time curr) noexcept;
+
+    // move the node to the head of the lru and adjust the insertion point.
+    // Must be called with the lru lock held.
+    void promoteLocked(T& node, Time curr) noexcept;
+
     EvictionAgeStat getEvictionAgeStatLocked(
         uint64_t projectedLength) const noexcept;
 
@@ -440,6 +568,10 @@ class MMLru {
     // @param node          node to remove
     void removeLocked(T& node);
 
+    // reorders the nodes at the tail of the lru for the sampled eviction, see
+    // Config::evictionSampleSize
+    void sampleTailLocked() noexcept;
+
     // Bit MM_BIT_0 is used to record if the item is in tail. This
     // is used to implement LRU insertion points
     void markTail(T& node) noexcept {
@@ -496,6 +628,15 @@ class MMLru {
     // Reads may be racy.
     Config config_{};
 
+    // Per thread promotion buffers. nullptr if buffering is disabled.
+    std::unique_ptr<PromotionBuffers> promotionBuffers_;
+
+    // Bumped under the lru lock to invalidate all buffered promotions.
+    std::atomic<uint64_t> bufferEpoch_{0};
+
+    // Contention on lruMutex_. nullptr if it is not tracked.
+    std::unique_ptr<util::LockContentionStats> lockContentionStats_;
+
     // Max lruFreshTime.
     static constexpr uint32_t kLruRefreshTimeCap{900};
 
@@ -525,6 +666,8 @@ MMLru::Container<T, HookPtr>::Container(serialization::MMLruObject object,
                              ? std::numeric_limits<Time>::max()
                              : static_cast<Time>(util::getCurrentTimeSec()) +
                                    config_.mmReconfigureIntervalSecs.count();
+  initPromotionBuffers();
+  initLockContentionStats();
 }
 
 template <typename T, MMLru::Hook<T> T::*HookPtr>
@@ -536,6 +679,20 @@ bool MMLru::Container<T, HookPtr>::recordAccess(T& node,
   }
 
   const auto curr = static_cast<Time>(util::getCurrentTimeSec());
+  if (config_.evictionSampleSize > 0) {
+    // the lru is reordered lazily by the evictions
+    if (!node.isInMMContainer()) {
+      return false;
+    }
+    if (getUpdateTime(node) != curr) {
+      setUpdateTime(node, curr);
+    }
+    if (!isAccessed(node)) {
+      markAccessed(node);
+    }
+    return true;
+  }
+
   // check if the node is still being memory managed
   if (node.isInMMContainer() &&
       ((curr >= getUpdateTime(node) +
@@ -545,19 +702,13 @@ bool MMLru::Container<T, HookPtr>::recordAccess(T& node,
       markAccessed(node);
     }
 
+    if (promotionBuffers_) {
+      return bufferPromotion(node, curr);
+    }
+
     auto func = [this, &node, curr]() {
       reconfigureLocked(curr);
-      ensureNotInsertionPoint(node);
-      if (node.isInMMContainer()) {
-        lru_.moveToHead(node);
-        setUpdateTime(node, curr);
-      }
-      if (isTail(node)) {
-        unmarkTail(node);
-        tailSize_--;
-        XDCHECK_LE(0u, tailSize_);
-        updateLruInsertionPoint();
-      }
+      promoteLocked(node, curr);
     };
 
     // if the tryLockUpdate optimization is on, and we were able to grab the
@@ -571,15 +722,94 @@ bool MMLru::Container<T, HookPtr>::recordAccess(T& node,
         return true;
       }
 
+      recordTryLockFailure();
       return false;
     }
 
-    lruMutex_->lock_combine(func);
+    lockCombine(func);
     return true;
   }
   return false;
 }
 
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+void MMLru::Container<T, HookPtr>::promoteLocked(T& node, Time curr) noexcept {
+  ensureNotInsertionPoint(node);
+  if (node.isInMMContainer()) {
+    lru_.moveToHead(node);
+    setUpdateTime(node, curr);
+  }
+  if (isTail(node)) {
+    unmarkTail(node);
+    tailSize_--;
+    XDCHECK_LE(0u, tailSize_);
+    updateLruInsertionPoint();
+  }
+}
+
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+bool MMLru::Container<T, HookPtr>::bufferPromotion(T& node,
+                                                   Time curr) noexcept {
+  auto& buffer = **promotionBuffers_;
+  if (buffer.size == 0) {
+    buffer.epoch = bufferEpoch_.load(std::memory_order_relaxed);
+  }
+  buffer.entries[buffer.size++] = std::make_pair(&node, curr);
+
+  const uint32_t capacity =
+      std::min(config_.promotionBufferSize, kMaxPromotionBufferSize);
+  if (buffer.size < capacity) {
+    return true;
+  }
+
+  auto func = [this, &buffer, curr]() {
+    reconfigureLocked(curr);
+    drainPromotionBufferLocked(buffer, curr);
+  };
+
+  if (config_.tryLockUpdate) {
+    if (auto lck = LockHolder{*lruMutex_, std::try_to_lock}) {
+      func();
+      return true;
+    }
+    // drop the buffered promotions rather than waiting for the lock
+    buffer.size = 0;
+    recordTryLockFailure();
+    return false;
+  }
+
+  lockCombine(func);
+  return true;
+}
+
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+void MMLru::Container<T, HookPtr>::drainPromotionBufferLocked(
+    PromotionBuffer& buffer, Time curr) noexcept {
+  // nodes buffered before the last invalidation may no longer belong to this
+  // container and must not be touched.
+  if (buffer.epoch == bufferEpoch_.load(std::memory_order_relaxed)) {
+    for (uint32_t i = 0; i < buffer.size; i++) {
+      auto& [node, time] = buffer.entries[i];
+      // the node might have been removed since it was buffered
+      if (node->isInMMContainer() &&
+          curr >= getUpdateTime(*node) +
+                      lruRefreshTime_.load(std::memory_order_relaxed)) {
+        promoteLocked(*node, time);
+      }
+    }
+  }
+  buffer.size = 0;
+}
+
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+void MMLru::Container<T, HookPtr>::invalidateBufferedAccesses() noexcept {
+  if (!promotionBuffers_) {
+    return;
+  }
+  lruMutex_->lock_combine(
+      [this]() { bufferEpoch_.fetch_add(1, std::memory_order_relaxed); });
+}
+
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 cachelib::EvictionAgeStat MMLru::Container<T, HookPtr>::getEvictionAgeStat(
     uint64_t projectedLength) const noexcept {
@@ -681,7 +911,7 @@ template <typename T, MMLru::Hook<T> T::*HookPtr>
 bool MMLru::Container<T, HookPtr>::add(T& node) noexcept {
   const auto currTime = static_cast<Time>(util::getCurrentTimeSec());
 
-  return lruMutex_->lock_combine([this, &node, currTime]() {
+  return lockCombine([this, &node, currTime]() {
     if (node.isInMMContainer()) {
       return false;
     }
@@ -701,27 +931,74 @@ bool MMLru::Container<T, HookPtr>::add(T& node) noexcept {
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 typename MMLru::Container<T, HookPtr>::LockedIterator
 MMLru::Container<T, HookPtr>::getEvictionIterator() const noexcept {
-  LockHolder l(*lruMutex_);
-  return LockedIterator{std::move(l), lru_.rbegin()};
+  return LockedIterator{lockLru(), lru_.rbegin()};
 }
 
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 template <typename F>
 void MMLru::Container<T, HookPtr>::withEvictionIterator(F&& fun) {
   if (config_.useCombinedLockForIterators) {
-    lruMutex_->lock_combine([this, &fun]() { fun(Iterator{lru_.rbegin()}); });
+    lockCombine([this, &fun]() {
+      sampleTailLocked();
+      fun(Iterator{lru_.rbegin()});
+    });
   } else {
-    LockHolder lck{*lruMutex_};
+    auto lck = lockLru();
+    sampleTailLocked();
     fun(Iterator{lru_.rbegin()});
   }
 }
 
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+void MMLru::Container<T, HookPtr>::sampleTailLocked() noexcept {
+  const auto sampleSize = config_.evictionSampleSize;
+  if (sampleSize == 0) {
+    return;
+  }
+
+  T* oldest = nullptr;
+  T* node = lru_.getTail();
+  for (uint32_t i = 0; node != nullptr && i < sampleSize; i++) {
+    T* prev = lru_.getPrev(*node);
+    if (isAccessed(*node)) {
+      // the lazy promotion of the accesses since the node was last sampled
+      unmarkAccessed(*node);
+      promoteLocked(*node, getUpdateTime(*node));
+    } else if (oldest == nullptr ||
+               getUpdateTime(*node) < getUpdateTime(*oldest)) {
+      oldest = node;
+    }
+    node = prev;
+  }
+  if (oldest == nullptr || oldest == lru_.getTail()) {
+    return;
+  }
+
+  ensureNotInsertionPoint(*oldest);
+  lru_.remove(*oldest);
+  lru_.linkAtTail(*oldest);
+  if (config_.lruInsertionPointSpec != 0 && !isTail(*oldest)) {
+    markTail(*oldest);
+    tailSize_++;
+  }
+  updateLruInsertionPoint();
+}
+
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 template <typename F>
 void MMLru::Container<T, HookPtr>::withContainerLock(F&& fun) {
   lruMutex_->lock_combine([&fun]() { fun(); });
 }
 
+template <typename T, MMLru::Hook<T> T::*HookPtr>
+template <typename F>
+void MMLru::Container<T, HookPtr>::forEachFromMRU(F&& fun) {
+  lruMutex_->lock_combine([this, &fun]() {
+    for (auto it = lru_.begin(); it && fun(*it); ++it) {
+    }
+  });
+}
+
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 void MMLru::Container<T, HookPtr>::ensureNotInsertionPoint(T& node) noexcept {
   // If we are removing the insertion point node, grow tail before we remove
@@ -753,7 +1030,7 @@ void MMLru::Container<T, HookPtr>::removeLocked(T& node) {
 
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 bool MMLru::Container<T, HookPtr>::remove(T& node) noexcept {
-  return lruMutex_->lock_combine([this, &node]() {
+  return lockCombine([this, &node]() {
     if (!node.isInMMContainer()) {
       return false;
     }
@@ -772,7 +1049,7 @@ void MMLru::Container<T, HookPtr>::remove(Iterator& it) noexcept {
 
 template <typename T, MMLru::Hook<T> T::*HookPtr>
 bool MMLru::Container<T, HookPtr>::replace(T& oldNode, T& newNode) noexcept {
-  return lruMutex_->lock_combine([this, &oldNode, &newNode]() {
+  return lockCombine([this, &oldNode, &newNode]() {
     if (!oldNode.isInMMContainer() || newNode.isInMMContainer()) {
       return false;
     }
@@ -836,13 +1113,20 @@ MMContainerStat MMLru::Container<T, HookPtr>::getStats() const noexcept {
                              tail == nullptr ? 0 : getUpdateTime(*tail),
                              lruRefreshTime_.load(std::memory_order_relaxed));
   });
-  return {stat[0] /* lru size */,
-          stat[1] /* tail time */,
-          stat[2] /* refresh time */,
-          0,
-          0,
-          0,
-          0};
+  MMContainerStat ret{stat[0] /* lru size */,
+                      stat[1] /* tail time */,
+                      stat[2] /* refresh time */,
+                      0,
+                      0,
+                      0,
+                      0};
+  if (lockContentionStats_) {
+    const auto contention = lockContentionStats_->getStripeStats(0);
+    ret.numLockContended = contention.numContended;
+    ret.numLockWaitSampled = contention.numSampled;
+    ret.lockWaitNs = contention.waitNs;
+  }
+  return ret;
 }
 
 template <typename T, MMLru::Hook<T> T::*HookPtr>
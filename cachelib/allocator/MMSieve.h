@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <folly/Format.h>
+#pragma GCC diagnostic pop
+#include <folly/container/Array.h>
+#include <folly/lang/Aligned.h>
+#include <folly/synchronization/DistributedMutex.h>
+
+#include "cachelib/allocator/Cache.h"
+#include "cachelib/allocator/CacheStats.h"
+#include "cachelib/allocator/Util.h"
+#include "cachelib/allocator/datastruct/DList.h"
+#include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/CompilerUtils.h"
+#include "cachelib/common/Mutex.h"
+
+namespace facebook::cachelib {
+// SIEVE eviction policy.
+// Items are kept in a queue in insertion order and are never moved on access.
+// Instead, an access only sets a visited bit on the item, which does not need
+// the container lock. Eviction is driven by a hand that moves from the tail
+// towards the head, wrapping around at the head. Visited items that the hand
+// passes get their bit cleared and stay where they are; the first unvisited
+// item becomes the eviction candidate. The hand stays in place across
+// evictions so that items it has recently passed get another chance.
+class MMSieve {
+ public:
+  // unique identifier per MMType
+  static const int kId;
+
+  // forward declaration;
+  template <typename T>
+  using Hook = DListHook<T>;
+  using SerializationType = serialization::MMSieveObject;
+  using SerializationConfigType = serialization::MMSieveConfig;
+  using SerializationTypeContainer = serialization::MMSieveCollection;
+
+  // This is not applicable for MMSieve, just for compile of cache allocator
+  enum LruType { NumTypes };
+
+  // Config class for MMSieve
+  struct Config {
+    // create from serialized config
+    explicit Config(SerializationConfigType configState)
+        : Config(*configState.updateOnWrite(), *configState.updateOnRead()) {}
+
+    // @param udpateOnW   whether to mark the item as visited on write
+    // @param updateOnR   whether to mark the item as visited on read
+    Config(bool updateOnW, bool updateOnR)
+        : updateOnWrite(updateOnW), updateOnRead(updateOnR) {}
+
+    Config() = default;
+    Config(const Config& rhs) = default;
+    Config(Config&& rhs) = default;
+
+    Config& operator=(const Config& rhs) = default;
+    Config& operator=(Config&& rhs) = default;
+
+    template <typename... Args>
+    void addExtraConfig(Args...) {}
+
+    // whether writes through recordAccess mark the item as visited.
+    bool updateOnWrite{false};
+
+    // whether reads through recordAccess mark the item as visited.
+    bool updateOnRead{true};
+  };
+
+  // The container object which can be used to keep track of objects of type
+  // T. T must have a public member of type Hook. This object is wrapper
+  // around DList, is thread safe and can be accessed from multiple threads.
+  template <typename T, Hook<T> T::*HookPtr>
+  struct Container {
+   private:
+    using LruList = DList<T, HookPtr>;
+    using Mutex = folly::DistributedMutex;
+    using LockHolder = std::unique_lock<Mutex>;
+    using PtrCompressor = typename T::PtrCompressor;
+    using Time = typename Hook<T>::Time;
+    using CompressedPtrType = typename T::CompressedPtrType;
+    using RefFlags = typename T::Flags;
+
+   public:
+    Container() = default;
+    Container(Config c, PtrCompressor compressor)
+        : compressor_(std::move(compressor)),
+          lru_(compressor_),
+          config_(std::move(c)) {}
+    Container(serialization::MMSieveObject object, PtrCompressor compressor);
+
+    Container(const Container&) = delete;
+    Container& operator=(const Container&) = delete;
+
+    // Iterator over the eviction candidates. It starts at the hand and moves
+    // towards the head, wrapping around to the tail, for at most one lap.
+    // Visited nodes are skipped and their visited bit is cleared on the way.
+    // Must only be used with the container lock held.
+    class Iterator {
+     public:
+      explicit Iterator(const Container<T, HookPtr>& c) noexcept : c_(&c) {
+        resetToBegin();
+      }
+      virtual ~Iterator() = default;
+
+      // copyable and movable
+      Iterator(const Iterator&) = default;
+      Iterator& operator=(const Iterator&) = default;
+      Iterator(Iterator&&) noexcept = default;
+      Iterator& operator=(Iterator&&) noexcept = default;
+
+      // moves the iterator to the next unvisited node. Calling ++ once the
+      // iterator has reached the end is undefined.
+      Iterator& operator++() noexcept {
+        advance();
+        skipVisited();
+        return *this;
+      }
+
+      T* operator->() const noexcept { return curr_; }
+      T& operator*() const noexcept { return *curr_; }
+
+      explicit operator bool() const noexcept { return curr_ != nullptr; }
+
+      T* get() const noexcept { return curr_; }
+
+      // Invalidates this iterator
+      void reset() noexcept { curr_ = nullptr; }
+
+      // Reset the iterator back to the hand
+      void resetToBegin() noexcept {
+        curr_ = c_->hand_ != nullptr ? c_->hand_ : c_->lru_.getTail();
+        remaining_ = c_->lru_.size() > 0 ? c_->lru_.size() - 1 : 0;
+        skipVisited();
+      }
+
+     private:
+      // move to the previous node, wrapping around from the head to the tail
+      void advance() noexcept {
+        T* next = c_->lru_.getPrev(*curr_);
+        if (next == nullptr) {
+          next = c_->lru_.getTail();
+        }
+        if (remaining_ == 0 || next == curr_) {
+          curr_ = nullptr;
+          return;
+        }
+        --remaining_;
+        curr_ = next;
+      }
+
+      void skipVisited() noexcept {
+        while (curr_ != nullptr && isVisited(*curr_)) {
+          unmarkVisited(*curr_);
+          advance();
+        }
+      }
+
+      const Container<T, HookPtr>* c_{nullptr};
+
+      // the current position of the iterator in the list
+      T* curr_{nullptr};
+
+      // number of steps left before completing a lap
+      size_t remaining_{0};
+    };
+
+    // context for iterating the MM container. At any given point of time,
+    // there can be only one iterator active since we need to lock the
+    // container for iteration.
+    class LockedIterator : public Iterator {
+     public:
+      // noncopyable but movable.
+      LockedIterator(const LockedIterator&) = delete;
+      LockedIterator& operator=(const LockedIterator&) = delete;
+
+      LockedIterator(LockedIterator&&) noexcept = default;
+
+      // 1. Invalidate this iterator
+      // 2. Unlock
+      void destroy() {
+        Iterator::reset();
+        if (l_.owns_lock()) {
+          l_.unlock();
+        }
+      }
+
+      // Reset this iterator to the beginning
+      void resetToBegin() {
+        if (!l_.owns_lock()) {
+          l_.lock();
+        }
+        Iterator::resetToBegin();
+      }
+
+     private:
+      // private because it's easy to misuse and cause deadlock
+      LockedIterator& operator=(LockedIterator&&) noexcept = default;
+
+      // create an iterator with the lock being held.
+      LockedIterator(LockHolder l, const Iterator& iter) noexcept
+          : Iterator(iter), l_(std::move(l)) {}
+
+      // only the container can create iterators
+      friend Container<T, HookPtr>;
+
+      // lock protecting the validity of the iterator
+      LockHolder l_;
+    };
+
+    // records the information that the node was accessed by setting its
+    // visited bit. This does not grab the container lock.
+    //
+    // @param node  node that we want to mark as relevant/accessed
+    // @param mode  the mode for the access operation.
+    //
+    // @return      True if the node was not visited before and got marked,
+    //              false otherwise
+    bool recordAccess(T& node, AccessMode mode) noexcept;
+
+    // adds the given node into the container and marks it as being present in
+    // the container. The node is added to the head of the queue.
+    //
+    // @param node  The node to be added to the container.
+    // @return  True if the node was successfully added to the container. False
+    //          if the node was already in the contianer. On error state of node
+    //          is unchanged.
+    bool add(T& node) noexcept;
+
+    // removes the node from the queue and sets it previous and next to
+    // nullptr.
+    //
+    // @param node  The node to be removed from the container.
+    // @return  True if the node was successfully removed from the container.
+    //          False if the node was not part of the container. On error, the
+    //          state of node is unchanged.
+    bool remove(T& node) noexcept;
+
+    // same as the above but uses an iterator context. The iterator is updated
+    // on removal of the corresponding node to point to the next candidate.
+    // The hand is left where the node was. The iterator context is
+    // responsible for locking.
+    //
+    // @param it    Iterator that will be removed
+    void remove(Iterator& it) noexcept;
+
+    // replaces one node with another, at the same position
+    //
+    // @param oldNode   node being replaced
+    // @param newNode   node to replace oldNode with
+    //
+    // @return true  If the replace was successful. Returns false if the
+    //               destination node did not exist in the container, or if the
+    //               source node already existed.
+    bool replace(T& oldNode, T& newNode) noexcept;
+
+    // Obtain an iterator that start from the hand and can be used
+    // to search for evictions. This iterator holds a lock to this
+    // container and only one such iterator can exist at a time
+    LockedIterator getEvictionIterator() const noexcept;
+
+    // Execute provided function under container lock. Function gets
+    // iterator passed as parameter.
+    template <typename F>
+    void withEvictionIterator(F&& f);
+
+    // Execute provided function under container lock.
+    template <typename F>
+    void withContainerLock(F&& f);
+
+    // Calls fun with the nodes from the most recently inserted one until it
+    // returns false, under the container lock. fun must not call back into
+    // the container.
+    template <typename F>
+    void forEachFromMRU(F&& fun);
+
+    // get copy of current config
+    Config getConfig() const;
+
+    // override the existing config with the new one.
+    void setConfig(const Config& newConfig);
+
+    bool isEmpty() const noexcept { return size() == 0; }
+
+    // returns the number of elements in the container
+    size_t size() const noexcept {
+      return mutex_->lock_combine([this]() { return lru_.size(); });
+    }
+
+    // Returns the eviction age stats. See CacheStats.h for details
+    EvictionAgeStat getEvictionAgeStat(uint64_t projectedLength) const noexcept;
+
+    // for saving the state of the container
+    //
+    // precondition:  serialization must happen without any reader or writer
+    // present. Any modification of this object afterwards will result in an
+    // invalid, inconsistent state for the serialized data.
+    //
+    serialization::MMSieveObject saveState() const noexcept;
+
+    // return the stats for this container.
+    MMContainerStat getStats() const noexcept;
+
+    static LruType getLruType(const T& /* node */) noexcept {
+      return LruType{};
+    }
+
+    // Accesses are not buffered by this container. Just for compile of
+    // cache allocator.
+    void invalidateBufferedAccesses() noexcept {}
+
+   private:
+    static Time getUpdateTime(const T& node) noexcept {
+      return (node.*HookPtr).getUpdateTime();
+    }
+
+    static void setUpdateTime(T& node, Time time) noexcept {
+      (node.*HookPtr).setUpdateTime(time);
+    }
+
+    // remove node from the queue and move the hand off it
+    // @param node          node to remove
+    void removeLocked(T& node) noexcept;
+
+    // Bit MM_BIT_0 is used to record if the item has been accessed since the
+    // hand last passed it.
+    static void markVisited(T& node) noexcept {
+      node.template setFlag<RefFlags::kMMFlag0>();
+    }
+
+    static void unmarkVisited(T& node) noexcept {
+      node.template unSetFlag<RefFlags::kMMFlag0>();
+    }
+
+    static bool isVisited(const T& node) noexcept {
+      return node.template isFlagSet<RefFlags::kMMFlag0>();
+    }
+
+    // protects all operations on the queue and the hand. Accesses do not
+    // need it.
+    mutable folly::cacheline_aligned<Mutex> mutex_;
+
+    const PtrCompressor compressor_{};
+
+    // the queue, in insertion order
+    LruList lru_{};
+
+    // next node to be considered for eviction. nullptr means the tail.
+    T* hand_{nullptr};
+
+    // Config for this container.
+    // Write access to the MMSieve Config is serialized.
+    // Reads may be racy.
+    Config config_{};
+  };
+};
+
+/* Container Interface Implementation */
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+MMSieve::Container<T, HookPtr>::Container(serialization::MMSieveObject object,
+                                          PtrCompressor compressor)
+    : compressor_(std::move(compressor)),
+      lru_(*object.lru(), compressor_),
+      hand_(compressor_.unCompress(
+          CompressedPtrType{*object.compressedHand()})),
+      config_(*object.config()) {}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+bool MMSieve::Container<T, HookPtr>::recordAccess(T& node,
+                                                  AccessMode mode) noexcept {
+  if ((mode == AccessMode::kWrite && !config_.updateOnWrite) ||
+      (mode == AccessMode::kRead && !config_.updateOnRead)) {
+    return false;
+  }
+
+  // check if the node is still being memory managed
+  if (!node.isInMMContainer() || isVisited(node)) {
+    return false;
+  }
+  markVisited(node);
+  return true;
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+bool MMSieve::Container<T, HookPtr>::add(T& node) noexcept {
+  const auto currTime = static_cast<Time>(util::getCurrentTimeSec());
+
+  return mutex_->lock_combine([this, &node, currTime]() {
+    if (node.isInMMContainer()) {
+      return false;
+    }
+    lru_.linkAtHead(node);
+    node.markInMMContainer();
+    setUpdateTime(node, currTime);
+    unmarkVisited(node);
+    return true;
+  });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+typename MMSieve::Container<T, HookPtr>::LockedIterator
+MMSieve::Container<T, HookPtr>::getEvictionIterator() const noexcept {
+  LockHolder l(*mutex_);
+  return LockedIterator{std::move(l), Iterator{*this}};
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+template <typename F>
+void MMSieve::Container<T, HookPtr>::withEvictionIterator(F&& fun) {
+  LockHolder lck{*mutex_};
+  fun(Iterator{*this});
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+template <typename F>
+void MMSieve::Container<T, HookPtr>::withContainerLock(F&& fun) {
+  mutex_->lock_combine([&fun]() { fun(); });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+template <typename F>
+void MMSieve::Container<T, HookPtr>::forEachFromMRU(F&& fun) {
+  mutex_->lock_combine([this, &fun]() {
+    for (auto it = lru_.begin(); it && fun(*it); ++it) {
+    }
+  });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+void MMSieve::Container<T, HookPtr>::setConfig(const Config& newConfig) {
+  mutex_->lock_combine([this, newConfig]() { config_ = newConfig; });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+typename MMSieve::Config MMSieve::Container<T, HookPtr>::getConfig() const {
+  return mutex_->lock_combine([this]() { return config_; });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+void MMSieve::Container<T, HookPtr>::removeLocked(T& node) noexcept {
+  if (hand_ == &node) {
+    hand_ = lru_.getPrev(node);
+  }
+  lru_.remove(node);
+  unmarkVisited(node);
+  node.unmarkInMMContainer();
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+bool MMSieve::Container<T, HookPtr>::remove(T& node) noexcept {
+  return mutex_->lock_combine([this, &node]() {
+    if (!node.isInMMContainer()) {
+      return false;
+    }
+    removeLocked(node);
+    return true;
+  });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+void MMSieve::Container<T, HookPtr>::remove(Iterator& it) noexcept {
+  T& node = *it;
+  XDCHECK(node.isInMMContainer());
+  ++it;
+  // park the hand on the evicted node so that removing it moves the hand to
+  // the node right after it.
+  hand_ = &node;
+  removeLocked(node);
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+bool MMSieve::Container<T, HookPtr>::replace(T& oldNode, T& newNode) noexcept {
+  return mutex_->lock_combine([this, &oldNode, &newNode]() {
+    if (!oldNode.isInMMContainer() || newNode.isInMMContainer()) {
+      return false;
+    }
+    const auto updateTime = getUpdateTime(oldNode);
+    lru_.replace(oldNode, newNode);
+    oldNode.unmarkInMMContainer();
+    newNode.markInMMContainer();
+    setUpdateTime(newNode, updateTime);
+    if (isVisited(oldNode)) {
+      markVisited(newNode);
+      unmarkVisited(oldNode);
+    } else {
+      unmarkVisited(newNode);
+    }
+    if (hand_ == &oldNode) {
+      hand_ = &newNode;
+    }
+    return true;
+  });
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+serialization::MMSieveObject MMSieve::Container<T, HookPtr>::saveState()
+    const noexcept {
+  serialization::MMSieveConfig configObject;
+  *configObject.updateOnWrite() = config_.updateOnWrite;
+  *configObject.updateOnRead() = config_.updateOnRead;
+
+  serialization::MMSieveObject object;
+  *object.config() = configObject;
+  *object.compressedHand() = compressor_.compress(hand_).saveState();
+  *object.lru() = lru_.saveState();
+  return object;
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+MMContainerStat MMSieve::Container<T, HookPtr>::getStats() const noexcept {
+  auto stat = mutex_->lock_combine([this]() {
+    auto* tail = lru_.getTail();
+    return folly::make_array(lru_.size(),
+                             tail == nullptr ? 0 : getUpdateTime(*tail));
+  });
+  return {stat[0] /* queue size */,
+          stat[1] /* tail time */,
+          0,
+          0,
+          0,
+          0,
+          0};
+}
+
+template <typename T, MMSieve::Hook<T> T::*HookPtr>
+cachelib::EvictionAgeStat MMSieve::Container<T, HookPtr>::getEvictionAgeStat(
+    uint64_t projectedLength) const noexcept {
+  return mutex_->lock_combine([this, projectedLength]() {
+    EvictionAgeStat stat{};
+    const auto currTime = static_cast<Time>(util::getCurrentTimeSec());
+
+    // the queue is in insertion order, so the tail is the oldest node
+    const T* node = lru_.getTail();
+    stat.warmQueueStat.oldestElementAge =
+        node ? currTime - getUpdateTime(*node) : 0;
+    stat.warmQueueStat.size = lru_.size();
+    for (size_t numSeen = 0; numSeen < projectedLength && node != nullptr;
+         numSeen++, node = lru_.getPrev(*node)) {
+    }
+    stat.warmQueueStat.projectedAge =
+        node ? currTime - getUpdateTime(*node)
+             : stat.warmQueueStat.oldestElementAge;
+    return stat;
+  });
+}
+} // namespace facebook::cachelib
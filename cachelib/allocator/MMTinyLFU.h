@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -29,6 +31,7 @@
 #include "cachelib/allocator/Util.h"
 #include "cachelib/allocator/datastruct/MultiDList.h"
 #include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/BlockedCountMinSketch.h"
 #include "cachelib/common/CompilerUtils.h"
 #include "cachelib/common/CountMinSketch.h"
 #include "cachelib/common/Mutex.h"
@@ -55,11 +58,14 @@ namespace facebook::cachelib {
 // cache size. After every 32 X cache_capacity number of items, the
 // counts are halved to weigh frequency by recency. The function
 // counterSize() returns the size of the counters
-// in bytes. See MMTinyLFU::maybeGrowAccessCountersLocked()
-// implementation for how the size is computed.
+// in bytes. See MMTinyLFU::maybeResizeAccessCountersLocked()
+// implementation for how the size is computed. With blockedFrequencySketch,
+// the counters are 4 bits and those of a key share a cache line, which makes
+// counting an access cheaper and the counters 8 times smaller.
 //
 // Tiny cache size:
-// This default to 1%. There's no need to tune this parameter.
+// This default to 1%. Workloads favoring recency over frequency do better
+// with a larger one; adaptiveTinySize lets the container find it.
 class MMTinyLFU {
  public:
   // unique identifier per MMType
@@ -306,9 +312,19 @@ class MMTinyLFU {
     // The multiplier for window size given the cache size.
     size_t windowToCacheSizeRatio{32};
 
-    // The size of tiny cache, as a percentage of the total size.
+    // The size of tiny cache, as a percentage of the total size. The initial
+    // size when adaptiveTinySize is set.
     size_t tinySizePercent{1};
 
+    // If true, the tiny cache is resized by hill climbing on the hit ratio
+    // observed by the container, within the 1% to 50% of tinySizePercent.
+    // Every sample of roughly ten times the container size in accesses, the
+    // size moves by a step in the same direction as the previous one if the
+    // hit ratio improved, and in the opposite one otherwise. The step decays
+    // so that the size settles, and is reset when the hit ratio changes
+    // abruptly as the workload likely shifted.
+    bool adaptiveTinySize{false};
+
     // Minimum interval between reconfigurations. If 0, reconfigure is never
     // called.
     std::chrono::seconds mmReconfigureIntervalSecs{};
@@ -319,6 +335,12 @@ class MMTinyLFU {
     // strictly scan patterns (access a key exactly once and move on), this
     // is not a desirable behavior (we'll always cache miss).
     bool newcomerWinsOnTie{true};
+
+    // If true, the frequencies are counted in a BlockedCountMinSketch, whose
+    // counters of a key are all in one cache line, instead of one cache line
+    // per hash. Its counters saturate at 15, which is plenty for comparing
+    // the tail of the tiny and the main queue within a window.
+    bool blockedFrequencySketch{false};
   };
 
   // The container object which can be used to keep track of objects of type
@@ -342,7 +364,8 @@ class MMTinyLFU {
     Container(Config c, PtrCompressor compressor)
         : lru_(LruType::NumTypes, std::move(compressor)),
           config_(std::move(c)) {
-      maybeGrowAccessCountersLocked();
+      maybeResizeAccessCountersLocked();
+      resetTinySizeLocked();
       lruRefreshTime_ = config_.lruRefreshTime;
       nextReconfigureTime_ =
           config_.mmReconfigureIntervalSecs.count() == 0
@@ -530,7 +553,14 @@ class MMTinyLFU {
 
     size_t counterSize() const noexcept {
       LockHolder l(lruMutex_);
-      return accessFreq_.getByteSize();
+      return accessFreq_.getByteSize() + blockedAccessFreq_.getByteSize();
+    }
+
+    // @return the current size of tiny cache as a percentage of the total
+    //         size. Only differs from the config with adaptiveTinySize.
+    double getTinySizePercent() const noexcept {
+      LockHolder l(lruMutex_);
+      return tinySizePercent_;
     }
 
     // Returns the eviction age stats. See CacheStats.h for details
@@ -550,6 +580,12 @@ class MMTinyLFU {
     template <typename F>
     void withContainerLock(F&& f);
 
+    // Calls fun with the nodes from the most recently used one until it
+    // returns false, under the container lock: the main cache first, then
+    // the tiny one. fun must not call back into the container.
+    template <typename F>
+    void forEachFromMRU(F&& fun);
+
     // for saving the state of the lru
     //
     // precondition:  serialization must happen without any reader or writer
@@ -565,6 +601,10 @@ class MMTinyLFU {
       return isTiny(node) ? LruType::Tiny : LruType::Main;
     }
 
+    // Promotions are not buffered by this container. Just for compile of
+    // cache allocator.
+    void invalidateBufferedAccesses() noexcept {}
+
    private:
     EvictionAgeStat getEvictionAgeStatLocked(
         uint64_t projectedLength) const noexcept;
@@ -577,8 +617,17 @@ class MMTinyLFU {
       (node.*HookPtr).setUpdateTime(time);
     }
 
-    // As the cache grows, the frequency counters may need to grow.
-    void maybeGrowAccessCountersLocked() noexcept;
+    // As the cache grows, the frequency counters may need to grow. They
+    // shrink back when the cache loses most of its items, e.g. after its
+    // pool was resized, so that the decay window follows the cache size.
+    void maybeResizeAccessCountersLocked() noexcept;
+
+    // Restarts the tiny cache sizing from the config.
+    void resetTinySizeLocked() noexcept;
+
+    // Moves the tiny cache size one step of the hill climbing with the hit
+    // ratio of the sample that just ended.
+    void adaptTinySizeLocked() noexcept;
 
     // Update frequency count for the node. Halve all counts if
     // we've reached the end of the window.
@@ -598,8 +647,8 @@ class MMTinyLFU {
     bool admitToMain(const T& tinyNode, const T& mainNode) const noexcept {
       XDCHECK(isTiny(tinyNode));
       XDCHECK(!isTiny(mainNode));
-      auto tinyFreq = accessFreq_.getCount(hashNode(tinyNode));
-      auto mainFreq = accessFreq_.getCount(hashNode(mainNode));
+      auto tinyFreq = getFrequency(tinyNode);
+      auto mainFreq = getFrequency(mainNode);
       if (config_.newcomerWinsOnTie) {
         return tinyFreq >= mainFreq;
       } else {
@@ -607,6 +656,13 @@ class MMTinyLFU {
       }
     }
 
+    // @return the approximate frequency of the node's key
+    uint32_t getFrequency(const T& node) const noexcept {
+      return config_.blockedFrequencySketch
+                 ? blockedAccessFreq_.getCount(hashNode(node))
+                 : accessFreq_.getCount(hashNode(node));
+    }
+
     // remove node from lru and adjust insertion points
     //
     // @param node          node to remove
@@ -650,6 +706,17 @@ class MMTinyLFU {
     // decay rate for frequency
     static constexpr double kDecayFactor = 0.5;
 
+    // Hill climbing of the tiny cache size. The step is in percentage points
+    // of the total size.
+    static constexpr double kMinTinySizePercent = 1;
+    static constexpr double kMaxTinySizePercent = 50;
+    static constexpr double kClimbInitialStep = 6.25;
+    static constexpr double kClimbStepDecay = 0.98;
+    // hit ratio change past which the step is reset
+    static constexpr double kClimbRestartThreshold = 0.05;
+    // accesses in a sample, per item of the container
+    static constexpr size_t kClimbSampleMultiplier = 10;
+
     // protects all operations on the lru. We never really just read the state
     // of the LRU. Hence we dont really require a RW mutex at this point of
     // time.
@@ -667,6 +734,19 @@ class MMTinyLFU {
     // The capacity for which the counters are sized
     size_t capacity_{0};
 
+    // size of tiny cache as a percentage of the total size
+    double tinySizePercent_{1};
+
+    // signed step of the next tiny cache resize, and the hit ratio of the
+    // previous sample
+    double climbStep_{kClimbInitialStep};
+    double prevHitRatio_{0};
+
+    // hits and insertions in the current sample. Hits are counted without
+    // the lock as most of them do not take it.
+    std::atomic<uint64_t> climbHits_{0};
+    uint64_t climbAdds_{0};
+
     // The next time to reconfigure the container.
     std::atomic<Time> nextReconfigureTime_{};
 
@@ -685,9 +765,15 @@ class MMTinyLFU {
     // time the maxWindowSize is hit.
     facebook::cachelib::util::CountMinSketch accessFreq_{};
 
+    // Used instead of accessFreq_ with blockedFrequencySketch. Only one of
+    // the two has counters.
+    facebook::cachelib::util::BlockedCountMinSketch blockedAccessFreq_{};
+
     FRIEND_TEST(MMTinyLFUTest, SegmentStress);
     FRIEND_TEST(MMTinyLFUTest, TinyLFUBasic);
     FRIEND_TEST(MMTinyLFUTest, Reconfigure);
+    FRIEND_TEST(MMTinyLFUTest, AdaptiveTinySize);
+    FRIEND_TEST(MMTinyLFUTest, BlockedFrequencySketch);
   };
 };
 
@@ -701,16 +787,18 @@ MMTinyLFU::Container<T, HookPtr>::Container(
                              ? std::numeric_limits<Time>::max()
                              : static_cast<Time>(util::getCurrentTimeSec()) +
                                    config_.mmReconfigureIntervalSecs.count();
-  maybeGrowAccessCountersLocked();
+  maybeResizeAccessCountersLocked();
+  resetTinySizeLocked();
 }
 
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
 void MMTinyLFU::Container<T,
-                          HookPtr>::maybeGrowAccessCountersLocked() noexcept {
+                          HookPtr>::maybeResizeAccessCountersLocked() noexcept {
   size_t capacity = lru_.size();
-  // If the new capacity ask is more than double the current size, recreate
-  // the approx frequency counters.
-  if (2 * capacity_ > capacity) {
+  // If the new capacity ask is more than double the current size, or less
+  // than a quarter of it, recreate the approx frequency counters.
+  if (2 * capacity_ > capacity &&
+      (4 * capacity >= capacity_ || capacity_ <= kDefaultCapacity)) {
     return;
   }
 
@@ -731,8 +819,15 @@ void MMTinyLFU::Container<T,
   numCounters = folly::nextPowTwo(numCounters);
 
   // The CountMinSketch frequency counter
-  accessFreq_ =
-      facebook::cachelib::util::CountMinSketch(numCounters, kHashCount);
+  if (config_.blockedFrequencySketch) {
+    accessFreq_ = facebook::cachelib::util::CountMinSketch{};
+    blockedAccessFreq_ = facebook::cachelib::util::BlockedCountMinSketch(
+        numCounters * kHashCount);
+  } else {
+    blockedAccessFreq_ = facebook::cachelib::util::BlockedCountMinSketch{};
+    accessFreq_ =
+        facebook::cachelib::util::CountMinSketch(numCounters, kHashCount);
+  }
 }
 
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
@@ -743,6 +838,10 @@ bool MMTinyLFU::Container<T, HookPtr>::recordAccess(T& node,
     return false;
   }
 
+  if (config_.adaptiveTinySize) {
+    climbHits_.fetch_add(1, std::memory_order_relaxed);
+  }
+
   const auto curr = static_cast<Time>(util::getCurrentTimeSec());
   // check if the node is still being memory managed
   if (node.isInMMContainer() &&
@@ -805,15 +904,57 @@ MMTinyLFU::Container<T, HookPtr>::getEvictionAgeStatLocked(
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
 void MMTinyLFU::Container<T, HookPtr>::updateFrequenciesLocked(
     const T& node) noexcept {
-  accessFreq_.increment(hashNode(node));
+  if (config_.blockedFrequencySketch) {
+    blockedAccessFreq_.increment(hashNode(node));
+  } else {
+    accessFreq_.increment(hashNode(node));
+  }
   ++windowSize_;
   // decay counts every maxWindowSize_ .  This avoids having items that were
   // accessed frequently (were hot) but aren't being accessed anymore (are
   // cold) from staying in cache forever.
   if (windowSize_ == maxWindowSize_) {
     windowSize_ >>= 1;
-    accessFreq_.decayCountsBy(kDecayFactor);
+    if (config_.blockedFrequencySketch) {
+      // halving is the decay by kDecayFactor
+      blockedAccessFreq_.halve();
+    } else {
+      accessFreq_.decayCountsBy(kDecayFactor);
+    }
+  }
+}
+
+template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
+void MMTinyLFU::Container<T, HookPtr>::resetTinySizeLocked() noexcept {
+  tinySizePercent_ = static_cast<double>(config_.tinySizePercent);
+  climbStep_ = kClimbInitialStep;
+  prevHitRatio_ = 0;
+  climbHits_.store(0, std::memory_order_relaxed);
+  climbAdds_ = 0;
+}
+
+template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
+void MMTinyLFU::Container<T, HookPtr>::adaptTinySizeLocked() noexcept {
+  const auto hits = climbHits_.exchange(0, std::memory_order_relaxed);
+  const auto accesses = hits + climbAdds_;
+  climbAdds_ = 0;
+  if (accesses == 0) {
+    return;
   }
+
+  // insertions stand for the misses
+  const double hitRatio =
+      static_cast<double>(hits) / static_cast<double>(accesses);
+  const double change = hitRatio - prevHitRatio_;
+  prevHitRatio_ = hitRatio;
+
+  // keep going if the last step helped, go back otherwise
+  const double step = change >= 0 ? climbStep_ : -climbStep_;
+  tinySizePercent_ = std::clamp(tinySizePercent_ + step, kMinTinySizePercent,
+                                kMaxTinySizePercent);
+  climbStep_ = std::abs(change) >= kClimbRestartThreshold
+                   ? (step >= 0 ? kClimbInitialStep : -kClimbInitialStep)
+                   : step * kClimbStepDecay;
 }
 
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
@@ -862,15 +1003,24 @@ bool MMTinyLFU::Container<T, HookPtr>::add(T& node) noexcept {
   markTiny(node);
   // Initialize the frequency count for this node.
   updateFrequenciesLocked(node);
+  if (config_.adaptiveTinySize &&
+      ++climbAdds_ + climbHits_.load(std::memory_order_relaxed) >=
+          kClimbSampleMultiplier * std::max(lru_.size(), kDefaultCapacity)) {
+    adaptTinySizeLocked();
+  }
   // If tiny cache is full, unconditionally promote tail to main cache.
-  const auto expectedSize = config_.tinySizePercent * lru_.size() / 100;
-  if (lru_.getList(LruType::Tiny).size() > expectedSize) {
-    auto tailNode = tinyLru.getTail();
-    tinyLru.remove(*tailNode);
-
+  const auto expectedSize =
+      static_cast<size_t>(tinySizePercent_ * lru_.size() / 100);
+  if (tinyLru.size() > expectedSize) {
+    // Promote two nodes at most, so that a tiny cache that was shrunk
+    // drains over the next insertions rather than all at once.
     auto& mainLru = lru_.getList(LruType::Main);
-    mainLru.linkAtHead(*tailNode);
-    unmarkTiny(*tailNode);
+    for (int i = 0; i < 2 && tinyLru.size() > expectedSize; ++i) {
+      auto tailNode = tinyLru.getTail();
+      tinyLru.remove(*tailNode);
+      mainLru.linkAtHead(*tailNode);
+      unmarkTiny(*tailNode);
+    }
   } else {
     // The tiny and main cache are full. Swap the tails of tiny and main cache
     // if the tiny tail has a higher frequency than the main tail.
@@ -879,7 +1029,7 @@ bool MMTinyLFU::Container<T, HookPtr>::add(T& node) noexcept {
   // If the number of counters are too small for the cache size, double them.
   // TODO: If this shows in latency, we may need to grow the counters
   // asynchronously.
-  maybeGrowAccessCountersLocked();
+  maybeResizeAccessCountersLocked();
 
   node.markInMMContainer();
   setUpdateTime(node, currTime);
@@ -908,6 +1058,19 @@ void MMTinyLFU::Container<T, HookPtr>::withContainerLock(F&& fun) {
   fun();
 }
 
+template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
+template <typename F>
+void MMTinyLFU::Container<T, HookPtr>::forEachFromMRU(F&& fun) {
+  LockHolder l(lruMutex_);
+  for (auto type : {LruType::Main, LruType::Tiny}) {
+    for (auto it = lru_.getList(type).begin(); it; ++it) {
+      if (!fun(*it)) {
+        return;
+      }
+    }
+  }
+}
+
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
 void MMTinyLFU::Container<T, HookPtr>::removeLocked(T& node) noexcept {
   if (isTiny(node)) {
@@ -977,7 +1140,15 @@ typename MMTinyLFU::Config MMTinyLFU::Container<T, HookPtr>::getConfig() const {
 template <typename T, MMTinyLFU::Hook<T> T::*HookPtr>
 void MMTinyLFU::Container<T, HookPtr>::setConfig(const Config& c) {
   LockHolder l(lruMutex_);
+  const bool sketchChanged =
+      c.blockedFrequencySketch != config_.blockedFrequencySketch;
   config_ = c;
+  if (sketchChanged) {
+    // recreate the frequency counters in the other sketch
+    capacity_ = 0;
+    maybeResizeAccessCountersLocked();
+  }
+  resetTinySizeLocked();
   lruRefreshTime_.store(config_.lruRefreshTime, std::memory_order_relaxed);
   nextReconfigureTime_ = config_.mmReconfigureIntervalSecs.count() == 0
                              ? std::numeric_limits<Time>::max()
@@ -74,6 +74,9 @@ PoolOptimizeContext
 MarginalHitsOptimizeStrategy::pickVictimAndReceiverRegularPoolsImpl(
     const CacheBase& cache) {
   const auto config = getConfigCopy();
+  if (config.rankAcrossPools) {
+    return pickVictimAndReceiverAcrossPools(cache, config);
+  }
   std::unordered_map<PoolId, double> scores;
   std::unordered_map<PoolId, bool> validVictim;
   std::unordered_map<PoolId, bool> validReceiver;
@@ -118,6 +121,10 @@ PoolOptimizeContext
 MarginalHitsOptimizeStrategy::pickVictimAndReceiverCompactCachesImpl(
     const CacheBase& cache) {
   const auto config = getConfigCopy();
+  if (config.rankAcrossPools) {
+    // compact caches are ranked with the regular pools
+    return kNoOpContext;
+  }
   std::unordered_map<PoolId, double> scores;
   std::unordered_map<PoolId, bool> validVictim;
   std::unordered_map<PoolId, bool> validReceiver;
@@ -148,4 +155,74 @@ MarginalHitsOptimizeStrategy::pickVictimAndReceiverCompactCachesImpl(
       compactCacheState_, validVictim, validReceiver);
 }
 
+PoolOptimizeContext
+MarginalHitsOptimizeStrategy::pickVictimAndReceiverAcrossPools(
+    const CacheBase& cache, const Config& config) {
+  std::unordered_map<PoolId, double> scores;
+  std::unordered_map<PoolId, bool> validVictim;
+  std::unordered_map<PoolId, bool> validReceiver;
+  const auto ccachePools = cache.getCCachePoolIds();
+
+  // If no data is stored yet, initialize stats and return nothing
+  if (acrossPoolsState_.entities.empty()) {
+    for (auto pid : cache.getRegularPoolIds()) {
+      if (cache.autoResizeEnabledForPool(pid)) {
+        acrossPoolsState_.entities.push_back(pid);
+        acrossPoolsState_.smoothedRanks[pid] = 0;
+        auto poolStats = cache.getPoolStats(pid);
+        for (auto cid : poolStats.getClassIds()) {
+          accuTailHitsRegularPool[pid][cid] =
+              poolStats.cacheStats.at(cid).containerStat.numTailAccesses;
+        }
+      }
+    }
+    for (auto pid : ccachePools) {
+      if (cache.autoResizeEnabledForPool(pid)) {
+        acrossPoolsState_.entities.push_back(pid);
+        acrossPoolsState_.smoothedRanks[pid] = 0;
+        accuTailHitsCompactCache[pid] =
+            cache.getCompactCache(pid).getStats().tailHits;
+      }
+    }
+    return kNoOpContext;
+  }
+
+  for (auto pid : acrossPoolsState_.entities) {
+    if (ccachePools.count(pid) == 0) {
+      // the tail of an allocation class is a slab worth of its items, so its
+      // tail hits are already hits per slab
+      const auto poolStats = cache.getPoolStats(pid);
+      uint64_t score = 0;
+      for (auto it : getTailHitsAndUpdate(poolStats, pid)) {
+        score = std::max(score, it.second);
+      }
+      scores[pid] = score;
+      validVictim[pid] =
+          poolStats.numEvictions() > 0 &&
+          poolStats.poolSize > config.poolMinSizeSlabs * Slab::kSize;
+      validReceiver[pid] = poolStats.mpStats.freeMemory() <
+                           config.poolMaxFreeSlabs * Slab::kSize;
+      continue;
+    }
+
+    // scale the tail hits of the compact cache to the hits per slab of its
+    // tail entries
+    const auto& ccache = cache.getCompactCache(pid);
+    const auto tailHits = getTailHitsAndUpdate(ccache.getStats(), pid);
+    const auto tailSize = ccache.getTailSize();
+    scores[pid] = tailSize == 0 ? 0
+                                : static_cast<double>(tailHits) * Slab::kSize /
+                                      static_cast<double>(tailSize);
+    validVictim[pid] = ccache.getSize() > Slab::kSize * config.poolMinSizeSlabs;
+    validReceiver[pid] =
+        ccache.getConfiguredSize() > 0 &&
+        ccache.getSize() + Slab::kSize * config.poolMaxFreeSlabs >
+            ccache.getConfiguredSize();
+  }
+
+  acrossPoolsState_.updateRankings(scores, config.movingAverageParam);
+  return pickVictimAndReceiverFromRankings(
+      acrossPoolsState_, validVictim, validReceiver);
+}
+
 } // namespace facebook::cachelib
@@ -47,6 +47,12 @@ class MarginalHitsOptimizeStrategy : public PoolOptimizeStrategy {
     // cannot be a receiver.
     uint32_t poolMaxFreeSlabs{2};
 
+    // Rank regular pools and compact caches together by tail hits per slab,
+    // so that memory flows to whichever gives the most hits per byte. When
+    // set, regular pool rounds pick victim and receiver across both kinds of
+    // pools and compact cache rounds pick nothing.
+    bool rankAcrossPools{false};
+
     Config() noexcept {}
     explicit Config(double param,
                     uint32_t minSizeSlabs,
@@ -84,6 +90,10 @@ class MarginalHitsOptimizeStrategy : public PoolOptimizeStrategy {
       const CacheBase& cache) override final;
 
  private:
+  // pick victim and receiver among regular pools and compact caches
+  PoolOptimizeContext pickVictimAndReceiverAcrossPools(const CacheBase& cache,
+                                                       const Config& config);
+
   // pick victim and receivers from rankings in states
   // @param valildVictim   whether a pool can be a victim in this round
   // @param valildReceiver whether a pool can be a receiver in this round
@@ -98,6 +108,9 @@ class MarginalHitsOptimizeStrategy : public PoolOptimizeStrategy {
   // compact cache optimize states
   MarginalHitsState<PoolId> compactCacheState_;
 
+  // optimize states of regular pools and compact caches ranked together
+  MarginalHitsState<PoolId> acrossPoolsState_;
+
   // stats: accumulative tail hits for each allocation classes in regular pools
   std::unordered_map<PoolId, std::unordered_map<ClassId, uint64_t>>
       accuTailHitsRegularPool;
@@ -16,8 +16,11 @@
 
 #include "cachelib/allocator/MemoryMonitor.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+
 #include "cachelib/allocator/PoolResizeStrategy.h"
 #include "cachelib/common/Exceptions.h"
 
@@ -40,7 +43,13 @@ MemoryMonitor::MemoryMonitor(CacheBase& cache,
       rateLimiter_(
           // Detect rate of decrease in free memory and
           // rate of increase in resident memory mode
-          config.mode == FreeMemory ? false : true) {
+          config.mode != FreeMemory && config.mode != CgroupMemory),
+      cgroupDir_(config.cgroupDir),
+      pressureThresholdPct_(config.pressureThresholdPct),
+      pressureAdviseMultiplier_(std::max<size_t>(
+          config.pressureAdviseMultiplier, 1)),
+      adviseBatchSize_(std::max<size_t>(config.adviseBatchSize, 1)),
+      adviseThrottlerConfig_(config.adviseThrottlerConfig) {
   if (!strategy_) {
     strategy_ = std::make_shared<PoolResizeStrategy>();
   }
@@ -68,6 +77,9 @@ void MemoryMonitor::work() {
   case ResidentMemory:
     checkResidentMemory();
     break;
+  case CgroupMemory:
+    checkCgroupMemory();
+    break;
   case TestMode:
     checkPoolsAndAdviseReclaim();
     break;
@@ -118,6 +130,72 @@ void MemoryMonitor::checkResidentMemory() {
   checkPoolsAndAdviseReclaim();
 }
 
+void MemoryMonitor::checkCgroupMemory() {
+  const auto cgroupStats = util::getCgroupMemoryStats(cgroupDir_);
+  if (cgroupStats.usageBytes == 0 || cgroupStats.limitBytes == 0) {
+    XLOG_EVERY_MS(ERR, 60'000)
+        << "Unable to read the memory usage and limit of cgroup "
+        << (cgroupDir_.empty() ? util::getCgroupDir() : cgroupDir_);
+    checkPoolsAndAdviseReclaim();
+    return;
+  }
+
+  // memory left below the limit plays the role of the free memory
+  const size_t memFree = cgroupStats.limitBytes > cgroupStats.usageBytes
+                             ? cgroupStats.limitBytes - cgroupStats.usageBytes
+                             : 0;
+  memAvailableSize_ = memFree;
+  rateLimiter_.addValue(memFree);
+
+  // stall time since the previous iteration, which reacts much faster than
+  // the averages over 10 seconds and more reported by the kernel
+  const auto now = std::chrono::steady_clock::now();
+  double pressurePct = 0;
+  if (lastStallTime_ != std::chrono::steady_clock::time_point{} &&
+      cgroupStats.someStallUs >= lastStallUs_) {
+    const auto elapsedUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                              lastStallTime_)
+            .count();
+    if (elapsedUs > 0) {
+      pressurePct = std::min(
+          100.0, static_cast<double>(cgroupStats.someStallUs - lastStallUs_) *
+                     100 / static_cast<double>(elapsedUs));
+    }
+  }
+  lastStallUs_ = cgroupStats.someStallUs;
+  lastStallTime_ = now;
+  memPressurePct_ = pressurePct;
+
+  const bool underPressure =
+      pressureThresholdPct_ > 0 && pressurePct >= pressureThresholdPct_;
+  const auto stats = cache_.getCacheMemoryStats();
+  if (underPressure) {
+    XLOGF(DBG,
+          "Memory pressure of {}% is above the limit of {}%, {} bytes below "
+          "the cgroup limit",
+          pressurePct,
+          pressureThresholdPct_,
+          memFree);
+    adviseAwaySlabs(pressureAdviseMultiplier_);
+  } else if (memFree < lowerLimit_) {
+    XLOGF(DBG,
+          "Cgroup memory of {} bytes below the limit is below the limit of {} "
+          "bytes",
+          memFree,
+          lowerLimit_);
+    adviseAwaySlabs();
+  } else if (memFree > upperLimit_ && stats.numAdvisedSlabs() > 0) {
+    XLOGF(DBG,
+          "Cgroup memory of {} bytes below the limit is above the limit of {} "
+          "bytes",
+          memFree,
+          upperLimit_);
+    reclaimSlabs();
+  }
+  checkPoolsAndAdviseReclaim();
+}
+
 namespace {
 size_t bytesToSlabs(size_t bytes) { return bytes / Slab::kSize; }
 } // namespace
@@ -156,10 +234,14 @@ void MemoryMonitor::checkPoolsAndAdviseReclaim() {
 
   // Advise slabs, if marked for advise
   if (results.advise) {
+    util::Throttler throttler(adviseThrottlerConfig_);
     for (auto& result : results.poolAdviseReclaimMap) {
       uint64_t slabsAdvised = 0;
       PoolId poolId = result.first;
       uint64_t slabsToAdvise = result.second;
+      // advise away the last batch even if it is not full, or if releasing
+      // a slab was aborted
+      SCOPE_EXIT { cache_.adviseReleasedSlabs(); };
       while (slabsAdvised < slabsToAdvise) {
         const auto classId = strategy_->pickVictimForResizing(cache_, poolId);
         if (classId == Slab::kInvalidClassId) {
@@ -170,6 +252,10 @@ void MemoryMonitor::checkPoolsAndAdviseReclaim() {
           auto stats = cache_.getPoolStats(poolId);
           cache_.releaseSlab(poolId, classId, SlabReleaseMode::kAdvise);
           ++slabsAdvised;
+          // the batch of the pool was advised away
+          if (slabsAdvised % adviseBatchSize_ == 0) {
+            throttler.throttleNow();
+          }
           const auto elapsed_time =
               static_cast<uint64_t>(util::getCurrentTimeMs() - now);
           // Log the event about the Pool which released the Slab along with
@@ -218,7 +304,7 @@ void MemoryMonitor::checkPoolsAndAdviseReclaim() {
   }
 }
 
-void MemoryMonitor::adviseAwaySlabs() {
+void MemoryMonitor::adviseAwaySlabs(size_t multiplier) {
   const auto totalSlabsInUse = getSlabsInUse();
   const auto totalSlabs = getTotalSlabs();
 
@@ -243,7 +329,7 @@ void MemoryMonitor::adviseAwaySlabs() {
   // Advise percentAdvisePerIteration_% of upperLimit_ - lowerLimit_
   // every iteration
   const auto slabsToAdvise = bytesToSlabs(upperLimit_ - lowerLimit_) *
-                             percentAdvisePerIteration_ / 100;
+                             percentAdvisePerIteration_ * multiplier / 100;
   XLOGF(DBG, "Advising away {} slabs to free {} bytes", slabsToAdvise,
         slabsToAdvise * Slab::kSize);
   cache_.updateNumSlabsToAdvise(slabsToAdvise);
@@ -17,11 +17,14 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <string>
 
 #include "cachelib/allocator/Cache.h"
 #include "cachelib/allocator/RebalanceStrategy.h"
 #include "cachelib/allocator/SlabReleaseStats.h"
 #include "cachelib/common/PeriodicWorker.h"
+#include "cachelib/common/Throttler.h"
 
 namespace facebook {
 namespace cachelib {
@@ -73,15 +76,17 @@ class RateLimiter {
 // either by ensuring there's enough free memory available on the system or
 // that the caching process does not exceed a given memory usage limit.
 // Note: For processes running inside cgroups with memory limits, the free
-// memory monitoring does not work. Instead use the resident memory monitoring
-// to keep the process memory usage below the cgroup memory limit.
+// memory monitoring does not work. Instead use the cgroup memory monitoring
+// on cgroup v2 hosts, or the resident memory monitoring to keep the process
+// memory usage below the cgroup memory limit.
 class MemoryMonitor : public PeriodicWorker {
  public:
-  enum Mode { FreeMemory, ResidentMemory, TestMode, Disabled };
+  enum Mode { FreeMemory, ResidentMemory, CgroupMemory, TestMode, Disabled };
 
   struct Config {
     // Memory monitoring mode. Enable memory monitoring by setting this to
-    // MemoryMonitor::ResidentMemory or MemoryMonitor::FreeMemory mode.
+    // MemoryMonitor::ResidentMemory, MemoryMonitor::FreeMemory or
+    // MemoryMonitor::CgroupMemory mode.
     Mode mode{Mode::Disabled};
     // percentage of memUpperLimit - memLowerLimit to be advised away
     // in an iteration.
@@ -91,7 +96,8 @@ class MemoryMonitor : public PeriodicWorker {
     size_t maxReclaimPercentPerIter{5};
     // lower limit for free/resident memory in GBs.
     // Note: the lower/upper limit is used in exactly opposite ways for the
-    // FreeMemory versus ResidentMemory mode.
+    // FreeMemory versus ResidentMemory mode. The CgroupMemory mode uses them
+    // like the FreeMemory mode, for the memory left below the cgroup limit.
     // 1. In the ResidentMemory mode, when the resident memory usage drops
     // below this limit, advised away slabs are reclaimed in proportion to
     // the size of pools, to increase cache size and raise resident memory
@@ -122,6 +128,28 @@ class MemoryMonitor : public PeriodicWorker {
     // advised memory by the amount by which free/resident memory is
     // decreasing/increasing
     std::chrono::seconds reclaimRateLimitWindowSecs{0};
+    // CgroupMemory mode: directory of the cgroup v2 to monitor, such as
+    // /sys/fs/cgroup/foo.slice. Empty monitors the cgroup of the process.
+    std::string cgroupDir;
+    // CgroupMemory mode: percentage of the time the tasks of the cgroup
+    // stalled on memory (PSI) since the previous iteration above which slabs
+    // are advised away whatever the memory left, and reclaiming stops.
+    // 0 ignores memory pressure.
+    double pressureThresholdPct{5};
+    // CgroupMemory mode: the amount advised away in an iteration is
+    // multiplied by this much while memory pressure is above the threshold,
+    // to react before the cgroup is OOM killed.
+    size_t pressureAdviseMultiplier{4};
+    // number of slabs released from a pool that are advised away together,
+    // with one madvise call for every run of contiguous slabs instead of one
+    // per slab. Every call shoots down the TLB entries of the range on all
+    // the cpus running the process.
+    size_t adviseBatchSize{1};
+    // throttles advising away slabs: the time is checked after every batch,
+    // and the memory monitor sleeps for sleepMs once it advised for longer
+    // than workMs. No throttling by default.
+    util::Throttler::Config adviseThrottlerConfig{
+        util::Throttler::Config::makeNoThrottleConfig()};
   };
 
   // Memory monitoring can be setup to run in one of the two following modes:
@@ -171,7 +199,17 @@ class MemoryMonitor : public PeriodicWorker {
   //                             decreasing free memory values. Setting this to
   //                             non-zero value enables rate limiting reclaim.
   //
-  // 2. Resident Memory Monitoring
+  // 2. Cgroup Memory Monitoring (cgroup v2 only)
+  //
+  // Setup a cgroup memory monitor that periodically reads the usage
+  // (memory.current) and limit (memory.high, or memory.max) of a cgroup, and
+  // the time its tasks stalled on memory (memory.pressure). It works like the
+  // free memory monitoring for the memory left below the limit, but also
+  // advises away pressureAdviseMultiplier times more memory per iteration
+  // while the stall time is above pressureThresholdPct, since the kernel
+  // reclaims and throttles well before the usage reaches the limit.
+  //
+  // 3. Resident Memory Monitoring
   //
   // Setup a resident memory monitor to advise away memory to avoid OOM, by
   // by limiting process's total resident memory usage. The resident memory
@@ -209,6 +247,10 @@ class MemoryMonitor : public PeriodicWorker {
   // rss size of the process
   size_t getMemRssSize() const noexcept { return memRssSize_; }
 
+  // percentage of the time the tasks of the cgroup stalled on memory in the
+  // last iteration of the cgroup memory monitoring
+  double getMemPressurePct() const noexcept { return memPressurePct_; }
+
   SlabReleaseEvents getSlabReleaseEvents(PoolId pid) const {
     return stats_.getSlabReleaseEvents(pid);
   }
@@ -220,6 +262,9 @@ class MemoryMonitor : public PeriodicWorker {
   // check resident memory and advise/reclaim if necessary
   void checkResidentMemory();
 
+  // check cgroup memory and pressure and advise/reclaim if necessary
+  void checkCgroupMemory();
+
   // check pools for memory to be advised or reclaimed and execute
   // Checks the target number of slabs to be advised and compares with
   // the currently advised away slabs. Slabs are advised away or reclaimed
@@ -241,7 +286,8 @@ class MemoryMonitor : public PeriodicWorker {
   size_t getSlabsInUse() const noexcept;
 
   // advise away slabs to increase free memory or reduce RSS
-  void adviseAwaySlabs();
+  // @param multiplier  multiple of the usual amount to advise away
+  void adviseAwaySlabs(size_t multiplier = 1);
 
   // reclaim slabs to increase cache size and reduce free memory/increase RSS
   void reclaimSlabs();
@@ -311,6 +357,22 @@ class MemoryMonitor : public PeriodicWorker {
   // decrease/increase.
   RateLimiter rateLimiter_;
 
+  // cgroup monitored in the CgroupMemory mode, empty for the cgroup of the
+  // process
+  const std::string cgroupDir_;
+
+  // stall time above which the CgroupMemory mode advises away faster
+  const double pressureThresholdPct_;
+  const size_t pressureAdviseMultiplier_;
+
+  // slabs advised away together and the throttling between the batches
+  const size_t adviseBatchSize_;
+  const util::Throttler::Config adviseThrottlerConfig_;
+
+  // stall time of the cgroup and when it was read at the previous iteration
+  uint64_t lastStallUs_{0};
+  std::chrono::steady_clock::time_point lastStallTime_{};
+
   // a count of total number of slabs advised away
   std::atomic<unsigned int> slabsAdvised_{0};
 
@@ -324,6 +386,8 @@ class MemoryMonitor : public PeriodicWorker {
   std::atomic<size_t> memAvailableSize_{0};
   // rss size of the process
   std::atomic<size_t> memRssSize_{0};
+  // memory pressure of the cgroup in percent
+  std::atomic<double> memPressurePct_{0};
 
   // implements the actual logic of running tryRebalancing and
   // updating the stats
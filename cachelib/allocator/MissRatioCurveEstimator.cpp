@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/MissRatioCurveEstimator.h"
+
+#include <folly/Format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace facebook::cachelib {
+
+namespace {
+constexpr uint64_t kMaxHash = std::numeric_limits<uint64_t>::max();
+
+double getRate(uint64_t threshold) noexcept {
+  return static_cast<double>(threshold) / static_cast<double>(kMaxHash);
+}
+} // namespace
+
+MissRatioCurve MissRatioCurve::operator-(const MissRatioCurve& older) const {
+  if (older.empty()) {
+    return *this;
+  }
+  MissRatioCurve curve{*this};
+  curve.numAccesses = std::max(0.0, numAccesses - older.numAccesses);
+  for (size_t i = 0; i < curve.hits.size() && i < older.hits.size(); i++) {
+    curve.hits[i] = std::max(0.0, hits[i] - older.hits[i]);
+  }
+  return curve;
+}
+
+MissRatioCurveEstimator::MissRatioCurveEstimator(double samplingRate,
+                                                 size_t maxSamples,
+                                                 uint64_t bucketBytes,
+                                                 size_t numBuckets)
+    : bucketBytes_(bucketBytes),
+      threshold_(samplingRate >= 1.0
+                     ? kMaxHash
+                     : static_cast<uint64_t>(std::ldexp(samplingRate, 64))),
+      maxSamples_(maxSamples),
+      hits_(numBuckets, 0) {
+  if (!(samplingRate > 0 && samplingRate <= 1) || maxSamples == 0 ||
+      bucketBytes == 0 || numBuckets == 0) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid miss ratio curve estimator. sampling rate: {}, max samples: "
+        "{}, bucket bytes: {}, buckets: {}",
+        samplingRate, maxSamples, bucketBytes, numBuckets));
+  }
+}
+
+void MissRatioCurveEstimator::recordSample(uint64_t hash, uint32_t size) {
+  std::lock_guard<std::mutex> l(mutex_);
+  const auto threshold = threshold_.load(std::memory_order_relaxed);
+  if (hash > threshold) {
+    // the threshold was lowered since the check
+    return;
+  }
+  if (tree_.empty()) {
+    // estimators of pools that are never accessed stay small
+    tree_.resize(2 * maxSamples_ + 1, 0);
+  } else if (nextSlot_ + 1 == tree_.size()) {
+    compactSlots();
+  }
+
+  // every sampled access stands for 1 / rate accesses
+  const double rate = getRate(threshold);
+  numAccesses_ += 1.0 / rate;
+
+  auto it = samples_.find(hash);
+  if (it != samples_.end()) {
+    auto& sample = it->second;
+    const uint64_t newerBytes =
+        getBytesUpTo(nextSlot_ - 1) - getBytesUpTo(sample.slot);
+    // a cache holding the keys accessed since and the key itself hits
+    const double distance =
+        std::max(1.0, static_cast<double>(newerBytes) / rate + size);
+    const auto idx = static_cast<size_t>(
+        std::ceil(distance / static_cast<double>(bucketBytes_)) - 1);
+    if (idx < hits_.size()) {
+      hits_[idx] += 1.0 / rate;
+    }
+    addBytes(sample.slot, -static_cast<int64_t>(sample.size));
+  } else {
+    it = samples_.emplace(hash, Sample{0, 0}).first;
+  }
+  it->second.slot = nextSlot_++;
+  it->second.size = size;
+  addBytes(it->second.slot, size);
+
+  if (samples_.size() > maxSamples_) {
+    auto last = std::prev(samples_.end());
+    addBytes(last->second.slot, -static_cast<int64_t>(last->second.size));
+    threshold_.store(std::max<uint64_t>(last->first, 2) - 1,
+                     std::memory_order_relaxed);
+    samples_.erase(last);
+  }
+}
+
+void MissRatioCurveEstimator::addBytes(size_t slot, int64_t delta) noexcept {
+  for (size_t i = slot + 1; i < tree_.size(); i += i & (~i + 1)) {
+    tree_[i] += static_cast<uint64_t>(delta);
+  }
+}
+
+uint64_t MissRatioCurveEstimator::getBytesUpTo(size_t slot) const noexcept {
+  uint64_t bytes = 0;
+  for (size_t i = slot + 1; i > 0; i -= i & (~i + 1)) {
+    bytes += tree_[i];
+  }
+  return bytes;
+}
+
+void MissRatioCurveEstimator::compactSlots() {
+  std::vector<Sample*> bySlot;
+  bySlot.reserve(samples_.size());
+  for (auto& kv : samples_) {
+    bySlot.push_back(&kv.second);
+  }
+  std::sort(bySlot.begin(), bySlot.end(),
+            [](const Sample* a, const Sample* b) { return a->slot < b->slot; });
+
+  std::fill(tree_.begin(), tree_.end(), 0);
+  nextSlot_ = 0;
+  for (auto* sample : bySlot) {
+    sample->slot = nextSlot_++;
+    addBytes(sample->slot, sample->size);
+  }
+}
+
+MissRatioCurve MissRatioCurveEstimator::getCurve() const {
+  MissRatioCurve curve;
+  curve.bucketBytes = bucketBytes_;
+  std::lock_guard<std::mutex> l(mutex_);
+  curve.numAccesses = numAccesses_;
+  curve.hits.reserve(hits_.size());
+  double hits = 0;
+  for (const auto h : hits_) {
+    hits += h;
+    curve.hits.push_back(hits);
+  }
+  return curve;
+}
+
+double MissRatioCurveEstimator::getSamplingRate() const noexcept {
+  return getRate(threshold_.load(std::memory_order_relaxed));
+}
+
+size_t MissRatioCurveEstimator::getNumSamples() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return samples_.size();
+}
+} // namespace facebook::cachelib
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/hash/Hash.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace facebook {
+namespace cachelib {
+
+// Hits a pool would get for every cache size, estimated from the accesses
+// recorded since the estimator was created.
+struct MissRatioCurve {
+  // the curve has a point every this many bytes
+  uint64_t bucketBytes{0};
+
+  // estimated number of accesses
+  double numAccesses{0};
+
+  // estimated hits of a cache of (i + 1) * bucketBytes at index i
+  std::vector<double> hits;
+
+  bool empty() const noexcept { return hits.empty(); }
+
+  // @return estimated hits of a cache of @bytes. The hits of the largest
+  //         size on the curve past it.
+  double getHits(uint64_t bytes) const noexcept {
+    if (hits.empty() || bytes < bucketBytes) {
+      return 0;
+    }
+    const auto idx = bytes / bucketBytes - 1;
+    return idx < hits.size() ? hits[idx] : hits.back();
+  }
+
+  // @return estimated fraction of the accesses missing a cache of @bytes
+  double getMissRatio(uint64_t bytes) const noexcept {
+    return numAccesses > 0 ? 1.0 - getHits(bytes) / numAccesses : 0;
+  }
+
+  // @return curve of the accesses recorded since @older was taken from the
+  //         same estimator
+  MissRatioCurve operator-(const MissRatioCurve& older) const;
+};
+
+// Estimates the miss ratio curve of an LRU cache from its accesses, with
+// spatial sampling of the key hashes (SHARDS, Waldspurger et al. FAST '15).
+//
+// Only the keys whose hash falls below a threshold are tracked. The reuse
+// distance of a tracked key, the bytes of the distinct tracked keys accessed
+// since its previous access, is scaled by the sampling rate to estimate the
+// size of the smallest cache that would hit. At most maxSamples keys are
+// tracked: past that the key with the largest hash is dropped and the
+// threshold lowered to exclude it, so the memory is bounded whatever the
+// working set.
+//
+// recordAccess() only takes a lock for the sampled keys. Thread safe.
+class MissRatioCurveEstimator {
+ public:
+  // @param samplingRate  fraction of the keys tracked initially, in (0, 1]
+  // @param maxSamples    upper bound on the tracked keys
+  // @param bucketBytes   granularity of the curve
+  // @param numBuckets    number of points of the curve
+  //
+  // @throw std::invalid_argument if a parameter is out of range
+  MissRatioCurveEstimator(double samplingRate,
+                          size_t maxSamples,
+                          uint64_t bucketBytes,
+                          size_t numBuckets);
+
+  // record an access to the key of @keyHash, whose item takes @size bytes
+  void recordAccess(uint64_t keyHash, uint32_t size) {
+    const auto hash = folly::hash::twang_mix64(keyHash);
+    if (hash > threshold_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    recordSample(hash, size);
+  }
+
+  // @return curve of every access recorded so far
+  MissRatioCurve getCurve() const;
+
+  // @return fraction of the keys tracked now
+  double getSamplingRate() const noexcept;
+
+  // @return number of keys tracked now
+  size_t getNumSamples() const;
+
+ private:
+  struct Sample {
+    // position of the last access in tree_
+    size_t slot;
+    uint32_t size;
+  };
+
+  void recordSample(uint64_t hash, uint32_t size);
+
+  // adds @delta to the bytes of @slot in tree_
+  void addBytes(size_t slot, int64_t delta) noexcept;
+
+  // @return bytes of the slots up to and including @slot in tree_
+  uint64_t getBytesUpTo(size_t slot) const noexcept;
+
+  // renumbers the slots of the samples from 0 in the order of their last
+  // access once tree_ runs out of slots
+  void compactSlots();
+
+  const uint64_t bucketBytes_;
+
+  // keys whose mixed hash is above it are not tracked
+  std::atomic<uint64_t> threshold_;
+
+  const size_t maxSamples_;
+
+  mutable std::mutex mutex_;
+
+  // tracked keys by their mixed hash
+  std::map<uint64_t, Sample> samples_;
+
+  // Fenwick tree of the bytes of the tracked keys by the slot of their last
+  // access. Slots are handed out in the order of the accesses. Sized on the
+  // first sample.
+  std::vector<uint64_t> tree_;
+  size_t nextSlot_{0};
+
+  // estimated hits by the index of the smallest cache size that hits
+  std::vector<double> hits_;
+  double numAccesses_{0};
+};
+} // namespace cachelib
+} // namespace facebook
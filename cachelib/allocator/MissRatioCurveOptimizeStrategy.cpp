@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/MissRatioCurveOptimizeStrategy.h"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+
+namespace facebook::cachelib {
+
+namespace {
+// blends the curve of the latest round into the moving average
+void smoothCurve(MissRatioCurve& smoothed,
+                 const MissRatioCurve& latest,
+                 double param) {
+  if (smoothed.empty() || smoothed.hits.size() != latest.hits.size()) {
+    smoothed = latest;
+    return;
+  }
+  smoothed.numAccesses =
+      param * smoothed.numAccesses + (1 - param) * latest.numAccesses;
+  for (size_t i = 0; i < smoothed.hits.size(); i++) {
+    smoothed.hits[i] = param * smoothed.hits[i] + (1 - param) * latest.hits[i];
+  }
+}
+} // namespace
+
+std::map<PoolId, size_t> MissRatioCurveOptimizeStrategy::computeTargetSlabs(
+    const std::map<PoolId, MissRatioCurve>& curves,
+    const std::map<PoolId, size_t>& currentSlabs,
+    size_t totalSlabs,
+    size_t minSlabs) {
+  std::map<PoolId, size_t> target;
+  size_t remaining = totalSlabs;
+  for (const auto& kv : curves) {
+    const auto slabs = std::min(minSlabs, remaining);
+    target[kv.first] = slabs;
+    remaining -= slabs;
+  }
+
+  // Greedily hand out the slabs to the pool gaining the most hits per slab.
+  // Every point of a curve past the current size is considered, not only the
+  // next slab, so that a pool whose hits only grow past a cliff is not
+  // starved by pools with a gentle slope.
+  while (remaining > 0) {
+    PoolId bestPool = Slab::kInvalidPoolId;
+    size_t bestSlabs = 0;
+    double bestRate = 0;
+    for (const auto& [pid, curve] : curves) {
+      if (curve.empty()) {
+        continue;
+      }
+      const size_t current = target[pid];
+      const double currentHits = curve.getHits(current * Slab::kSize);
+      for (size_t i = 0; i < curve.hits.size(); i++) {
+        const size_t slabs =
+            ((i + 1) * curve.bucketBytes + Slab::kSize - 1) / Slab::kSize;
+        if (slabs <= current) {
+          continue;
+        }
+        if (slabs - current > remaining) {
+          break;
+        }
+        const double rate =
+            (curve.getHits(slabs * Slab::kSize) - currentHits) /
+            static_cast<double>(slabs - current);
+        if (rate > bestRate) {
+          bestPool = pid;
+          bestSlabs = slabs;
+          bestRate = rate;
+        }
+      }
+    }
+    if (bestPool == Slab::kInvalidPoolId) {
+      break;
+    }
+    remaining -= bestSlabs - target[bestPool];
+    target[bestPool] = bestSlabs;
+  }
+
+  // slabs adding no hits stay where they are
+  for (auto& [pid, slabs] : target) {
+    if (remaining == 0) {
+      break;
+    }
+    const auto it = currentSlabs.find(pid);
+    if (it != currentSlabs.end() && it->second > slabs) {
+      const auto extra = std::min(remaining, it->second - slabs);
+      slabs += extra;
+      remaining -= extra;
+    }
+  }
+  return target;
+}
+
+PoolOptimizeContext
+MissRatioCurveOptimizeStrategy::pickVictimAndReceiverRegularPoolsImpl(
+    const CacheBase& cache) {
+  const auto config = getConfigCopy();
+  std::map<PoolId, MissRatioCurve> curves;
+  std::map<PoolId, size_t> currentSlabs;
+  size_t totalSlabs = 0;
+  for (const auto pid : cache.getRegularPoolIds()) {
+    if (!cache.autoResizeEnabledForPool(pid)) {
+      continue;
+    }
+    auto curve = cache.getPoolMissRatioCurve(pid);
+    if (curve.empty()) {
+      continue;
+    }
+    auto& lastCurve = lastCurves_[pid];
+    const auto latest = curve - lastCurve;
+    lastCurve = std::move(curve);
+    auto& smoothed = smoothedCurves_[pid];
+    smoothCurve(smoothed, latest, config.movingAverageParam);
+    curves[pid] = smoothed;
+
+    const auto slabs = cache.getPool(pid).getPoolSize() / Slab::kSize;
+    currentSlabs[pid] = slabs;
+    totalSlabs += slabs;
+  }
+  if (curves.size() < 2) {
+    return kNoOpContext;
+  }
+
+  const auto target = computeTargetSlabs(curves, currentSlabs, totalSlabs,
+                                         config.poolMinSizeSlabs);
+  PoolOptimizeContext ctx;
+  size_t maxSurplus = 0;
+  size_t maxDeficit = 0;
+  for (const auto& [pid, slabs] : currentSlabs) {
+    const auto targetSlabs = target.at(pid);
+    if (slabs >= targetSlabs + config.minDiffSlabs &&
+        slabs - targetSlabs > maxSurplus) {
+      maxSurplus = slabs - targetSlabs;
+      ctx.victimPoolId = pid;
+    }
+    if (targetSlabs >= slabs + config.minDiffSlabs &&
+        targetSlabs - slabs > maxDeficit) {
+      maxDeficit = targetSlabs - slabs;
+      ctx.receiverPoolId = pid;
+    }
+  }
+  if (ctx.victimPoolId == Slab::kInvalidPoolId ||
+      ctx.receiverPoolId == Slab::kInvalidPoolId) {
+    return kNoOpContext;
+  }
+
+  XLOGF(DBG,
+        "Optimizing: receiver = {}, {} slabs below target, victim = {}, {} "
+        "slabs above target",
+        static_cast<int>(ctx.receiverPoolId), maxDeficit,
+        static_cast<int>(ctx.victimPoolId), maxSurplus);
+  return ctx;
+}
+
+} // namespace facebook::cachelib
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "cachelib/allocator/MissRatioCurveEstimator.h"
+#include "cachelib/allocator/PoolOptimizeStrategy.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Sizes the regular pools from their miss ratio curves, see
+// CacheAllocatorConfig::enableMissRatioCurves.
+//
+// Every round the memory of the pools is split to maximize the total hits
+// predicted by the curves of the accesses since the previous round. Unlike
+// tail hits, the curves predict the effect of moving many slabs, so a pool
+// whose hits only grow past a cliff still gets the memory to reach it. The
+// pool furthest above its target size is the victim and the one furthest
+// below is the receiver; a slab moves per round.
+class MissRatioCurveOptimizeStrategy : public PoolOptimizeStrategy {
+ public:
+  struct Config : public BaseConfig {
+    // Parameter for moving average of the curves between rounds, between 0
+    // and 1. 0 only looks at the latest round.
+    double movingAverageParam{0.3};
+
+    // Pools are never sized below this many slabs
+    uint32_t poolMinSizeSlabs{1};
+
+    // Pools are moved only if their size is off their target by more than
+    // this many slabs
+    uint32_t minDiffSlabs{1};
+
+    Config() noexcept {}
+    Config(double param, uint32_t minSizeSlabs, uint32_t diffSlabs) noexcept
+        : movingAverageParam(param),
+          poolMinSizeSlabs(minSizeSlabs),
+          minDiffSlabs(diffSlabs) {}
+  };
+
+  explicit MissRatioCurveOptimizeStrategy(Config config = {})
+      : PoolOptimizeStrategy(PredictedHits), config_(std::move(config)) {}
+
+  // Update the config. This will not affect the current rebalancing, but
+  // will take effect in the next round
+  void updateConfig(const BaseConfig& baseConfig) override final {
+    std::lock_guard<std::mutex> l(configLock_);
+    config_ = static_cast<const Config&>(baseConfig);
+  }
+
+  // Split @totalSlabs between the pools of @curves to maximize the total
+  // predicted hits, giving every pool at least @minSlabs. Slabs that add no
+  // hits anywhere are left to the pools in @currentSlabs up to their
+  // current size, so that nothing moves for nothing.
+  //
+  // @return  target number of slabs of every pool
+  static std::map<PoolId, size_t> computeTargetSlabs(
+      const std::map<PoolId, MissRatioCurve>& curves,
+      const std::map<PoolId, size_t>& currentSlabs,
+      size_t totalSlabs,
+      size_t minSlabs);
+
+ protected:
+  // This returns a copy of the current config.
+  // This ensures that we're always looking at the same config even though
+  // someone else may have updated the config during rebalancing
+  Config getConfigCopy() const {
+    std::lock_guard<std::mutex> l(configLock_);
+    return config_;
+  }
+
+  // pick victim and receiver regular pools
+  PoolOptimizeContext pickVictimAndReceiverRegularPoolsImpl(
+      const CacheBase& cache) override final;
+
+ private:
+  // curve of every pool at the end of the previous round
+  std::unordered_map<PoolId, MissRatioCurve> lastCurves_;
+
+  // moving average of the curves of the rounds
+  std::unordered_map<PoolId, MissRatioCurve> smoothedCurves_;
+
+  // Config for this strategy, this can be updated anytime.
+  // Do not access this directly, always use `getConfig()` to
+  // obtain a copy first
+  Config config_;
+  mutable std::mutex configLock_;
+};
+} // namespace cachelib
+} // namespace facebook
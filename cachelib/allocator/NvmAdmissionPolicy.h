@@ -16,11 +16,16 @@
 
 #pragma once
 
+#include <folly/Random.h>
 #include <folly/Range.h>
+#include <folly/lang/Bits.h>
+
+#include <array>
 
 #include "cachelib/common/ApproxSplitSet.h"
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/PercentileStats.h"
+#include "cachelib/common/Ticker.h"
 #include "cachelib/common/Time.h"
 
 namespace facebook {
@@ -240,5 +245,204 @@ class RejectFirstAP final : public NvmAdmissionPolicy<Cache> {
   AtomicCounter admitsByDramHits_{0};
   const bool useDramHitSignal_{true};
 };
+
+// Configuration for WriteBudgetAP.
+struct WriteBudgetAPConfig {
+  // bytes per second the policy admits into nvmcache. Must be non zero.
+  uint64_t targetBytesPerSec{0};
+
+  // length of the window over which the budget is spent and at the end of
+  // which the admission threshold is recomputed.
+  uint32_t windowSecs{1};
+
+  // number of keys of recently offered items to remember. An item whose key
+  // was offered before is scored higher since it came back to DRAM after
+  // being evicted. 0 disables this signal.
+  uint64_t numTrackedKeys{0};
+  uint32_t numTrackedSplits{20};
+
+  // if true, items are scored by value per byte so that the budget goes to
+  // the items giving the most hits per byte written.
+  bool sizeAware{true};
+
+  // The ticker to be used to supply the current second. If this is not set,
+  // the default clock based ticker will be used.
+  std::shared_ptr<Ticker> ticker{std::make_shared<detail::ClockBasedTicker>()};
+
+  // @throw std::invalid_argument if the config is invalid
+  void validate() const {
+    if (targetBytesPerSec == 0) {
+      throw std::invalid_argument(
+          "Write budget AP needs a non zero target write rate");
+    }
+    if (windowSecs == 0) {
+      throw std::invalid_argument("Write budget AP needs a non zero window");
+    }
+    if (numTrackedKeys > 0 && numTrackedSplits == 0) {
+      throw std::invalid_argument(
+          "Write budget AP needs non zero splits to track keys");
+    }
+    if (!ticker) {
+      throw std::invalid_argument("Write budget AP needs a ticker");
+    }
+  }
+};
+
+// an admission policy that spends a device write budget on the items with the
+// highest value instead of sampling them at random. Items are scored from
+// their DRAM access history: a hit in DRAM, and a previous eviction of the
+// same key when key tracking is enabled. With sizeAware, the score is the
+// value per byte, bucketed by powers of two.
+//
+// The policy keeps a histogram of the bytes offered per score in the current
+// window. At the end of each window, it picks the lowest score whose bytes,
+// together with the bytes of all higher scores, fit in the budget and admits
+// a fraction of the items at that score so that the budget is spent fully.
+// Within a window, nothing is admitted once the budget is used up.
+template <typename Cache>
+class WriteBudgetAP final : public NvmAdmissionPolicy<Cache> {
+ public:
+  using Item = typename Cache::Item;
+  using ChainedItemIter = typename Cache::ChainedItemIter;
+
+  static constexpr uint32_t kNumScores = 32;
+
+  // @throw std::invalid_argument if the config is invalid
+  explicit WriteBudgetAP(WriteBudgetAPConfig config)
+      : config_{(config.validate(), std::move(config))},
+        tracker_{config_.numTrackedKeys > 0
+                     ? std::make_unique<ApproxSplitSet>(
+                           config_.numTrackedKeys, config_.numTrackedSplits)
+                     : nullptr},
+        windowStart_{config_.ticker->getCurrentTick()} {}
+
+  // @return the score of an item with the given signals, in [0, kNumScores)
+  static uint32_t getScore(bool sizeAware,
+                           bool wasDramHit,
+                           bool seenBefore,
+                           uint64_t size) {
+    const uint64_t value = 1 + (wasDramHit ? 2 : 0) + (seenBefore ? 1 : 0);
+    if (!sizeAware) {
+      return static_cast<uint32_t>(value);
+    }
+    const auto perByte = (value << 20) / std::max<uint64_t>(size, 1);
+    return std::min<uint32_t>(kNumScores - 1, folly::findLastSet(perByte));
+  }
+
+ protected:
+  bool acceptImpl(const Item& it,
+                  folly::Range<ChainedItemIter> chainedItems) final override {
+    maybeUpdateThreshold();
+
+    uint64_t size = it.getTotalSize();
+    for (const auto& c : chainedItems) {
+      size += c.getTotalSize();
+    }
+    const bool wasDramHit = it.getLastAccessTime() > it.getCreationTime();
+    const bool seenBefore = tracker_ && tracker_->insert(hashKey(it.getKey()));
+    const auto score =
+        getScore(config_.sizeAware, wasDramHit, seenBefore, size);
+    offeredBytes_[score].fetch_add(size, std::memory_order_relaxed);
+
+    const auto threshold = threshold_.load(std::memory_order_relaxed);
+    if (score < threshold ||
+        (score == threshold &&
+         folly::Random::rand32(kAdmitFractionScale) >=
+             admitFraction_.load(std::memory_order_relaxed))) {
+      scoreRejected_.inc();
+      return false;
+    }
+
+    const auto budget = config_.targetBytesPerSec * config_.windowSecs;
+    if (windowBytes_.fetch_add(size, std::memory_order_relaxed) + size >
+        budget) {
+      windowBytes_.fetch_sub(size, std::memory_order_relaxed);
+      budgetRejected_.inc();
+      return false;
+    }
+    admittedBytes_.add(size);
+    return true;
+  }
+
+  void getCountersImpl(const util::CounterVisitor& visitor) final override {
+    visitor("ap.write_budget_threshold", threshold_.load());
+    visitor("ap.write_budget_admit_pct",
+            admitFraction_.load() * 100.0 / kAdmitFractionScale);
+    visitor("ap.write_budget_admitted_bytes", admittedBytes_.get(),
+            util::CounterVisitor::CounterType::RATE);
+    visitor("ap.write_budget_score_rejected", scoreRejected_.get(),
+            util::CounterVisitor::CounterType::RATE);
+    visitor("ap.write_budget_budget_rejected", budgetRejected_.get(),
+            util::CounterVisitor::CounterType::RATE);
+  }
+
+ private:
+  static constexpr uint32_t kAdmitFractionScale = 1'000'000;
+
+  static uint64_t hashKey(typename Item::Key key) {
+    return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(), 0);
+  }
+
+  // Starts a new window once the current one is over and recomputes the
+  // threshold from the bytes offered during it. Only the thread that moves
+  // the window does the work.
+  void maybeUpdateThreshold() {
+    const uint32_t now = config_.ticker->getCurrentTick();
+    auto start = windowStart_.load(std::memory_order_relaxed);
+    if (now < start + config_.windowSecs ||
+        !windowStart_.compare_exchange_strong(start, now)) {
+      return;
+    }
+
+    // the window can be longer than configured if there was no traffic
+    const uint64_t budget =
+        config_.targetBytesPerSec * std::max(now - start, config_.windowSecs);
+    uint64_t used = 0;
+    bool fits = true;
+    uint32_t threshold = 0;
+    uint32_t fraction = kAdmitFractionScale;
+    for (uint32_t score = kNumScores; score-- > 0;) {
+      const auto bytes =
+          offeredBytes_[score].exchange(0, std::memory_order_relaxed);
+      if (!fits || bytes == 0) {
+        continue;
+      }
+      threshold = score;
+      if (used + bytes > budget) {
+        fraction = static_cast<uint32_t>((budget - used) * kAdmitFractionScale /
+                                         bytes);
+        fits = false;
+      }
+      used += bytes;
+    }
+    // when everything fits, everything is admitted
+    if (fits) {
+      threshold = 0;
+      fraction = kAdmitFractionScale;
+    }
+
+    threshold_.store(threshold, std::memory_order_relaxed);
+    admitFraction_.store(fraction, std::memory_order_relaxed);
+    windowBytes_.store(0, std::memory_order_relaxed);
+  }
+
+  const WriteBudgetAPConfig config_;
+  std::unique_ptr<ApproxSplitSet> tracker_;
+
+  // bytes offered per score in the current window
+  std::array<std::atomic<uint64_t>, kNumScores> offeredBytes_{};
+  // bytes admitted in the current window
+  std::atomic<uint64_t> windowBytes_{0};
+  std::atomic<uint32_t> windowStart_{0};
+
+  // items below the threshold are rejected and items at the threshold are
+  // admitted with a probability of admitFraction_ / kAdmitFractionScale
+  std::atomic<uint32_t> threshold_{0};
+  std::atomic<uint32_t> admitFraction_{kAdmitFractionScale};
+
+  AtomicCounter admittedBytes_{0};
+  AtomicCounter scoreRejected_{0};
+  AtomicCounter budgetRejected_{0};
+};
 } // namespace cachelib
 } // namespace facebook
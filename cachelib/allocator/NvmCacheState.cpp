@@ -24,6 +24,7 @@
 #pragma GCC diagnostic pop
 
 #include "cachelib/allocator/CacheVersion.h"
+#include "cachelib/allocator/FormatUpgrades.h"
 #include "cachelib/allocator/NvmCacheState.h"
 #include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
 #include "cachelib/common/Serialization.h"
@@ -114,6 +115,14 @@ void NvmCacheState::restoreState() {
     wasCleanshutDown_ = *metadata.safeShutDown();
 
     if (!shouldStartFresh()) {
+      const auto version = static_cast<uint64_t>(*metadata.nvmFormatVersion());
+      auto& upgrader = getNvmFormatUpgrader();
+      if (version != kCacheNvmFormatVersion && upgrader.canUpgrade(version)) {
+        upgrader.upgrade(version, metadata);
+        *metadata.nvmFormatVersion() = kCacheNvmFormatVersion;
+        XLOGF(INFO, "Upgraded nvm format version {} to {}", version,
+              kCacheNvmFormatVersion);
+      }
       if (*metadata.nvmFormatVersion() == kCacheNvmFormatVersion &&
           encryptionEnabled_ == *metadata.encryptionEnabled() &&
           truncateAllocSize_ == *metadata.truncateAllocSize()) {
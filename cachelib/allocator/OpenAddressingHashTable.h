@@ -0,0 +1,1537 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cachelib/allocator/Cache.h"
+#include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/CompilerUtils.h"
+#include "cachelib/common/Exceptions.h"
+#include "cachelib/common/Mutex.h"
+#include "cachelib/common/Throttler.h"
+#include "cachelib/shm/Shm.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <folly/Format.h>
+#include <folly/Range.h>
+#pragma GCC diagnostic pop
+
+namespace facebook::cachelib {
+
+/**
+ * Implementation of an open addressing hash table, meant as a drop in
+ * replacement for ChainedHashTable as the AccessType of a cache trait.
+ *
+ * Every slot holds a compressed pointer to its node and a 1 byte control
+ * that is either empty, deleted, or a 7 bit tag taken from the key's hash.
+ * The controls of 16 slots form a group that is compared against the tag
+ * of a key at once, so a lookup reads one cacheline of controls and only
+ * dereferences the nodes whose tag matches, instead of walking a chain of
+ * node headers. Nodes do not need any hook for the table.
+ *
+ * The slots are split into shards of at most 1024 slots. A key is probed
+ * only within its shard, which is protected by one of the locks. A shard
+ * takes keys up to 7/8 of its slots; inserts into a full shard fail. Size
+ * the table for the number of items accordingly.
+ *
+ * Expects T to provide a getKey() and appropriate key comparison operators.
+ * The container guarantees thread safety.
+ */
+class OpenAddressingHashTable {
+ public:
+  // unique identifier per AccessType
+  static const int kId;
+
+  // nodes keep nothing for the table. The hook only exists to plug into
+  // the AccessType interface.
+  template <typename T>
+  struct CACHELIB_PACKED_ATTR Hook {};
+
+ private:
+  // Implements the slots and the probing. Not thread safe, callers hold the
+  // lock of the shard they operate on.
+  template <typename T>
+  class Impl {
+   public:
+    using Key = typename T::Key;
+    using CompressedPtrType = typename T::CompressedPtrType;
+    using PtrCompressor = typename T::PtrCompressor;
+    using ShardId = size_t;
+    using GroupId = size_t;
+    using SlotId = size_t;
+
+    static constexpr SlotId kInvalidSlot = std::numeric_limits<SlotId>::max();
+
+    // number of slots whose controls are compared together
+    static constexpr size_t kGroupSize = 16;
+
+    // allocate memory for the slots; the memory is managed by Impl.
+    //
+    // @param numSlots      the number of slots, power of two
+    // @param compressor    object used to compress/decompress node pointers
+    // @param hasher        object used to hash the keys
+    Impl(size_t numSlots,
+         const PtrCompressor& compressor,
+         const Hasher& hasher);
+
+    // use memory managed by the user for the slots.
+    //
+    // @param numSlots      the number of slots, power of two
+    // @param memStart      user managed memory of getRequiredSize(numSlots)
+    // @param compressor    object used to compress/decompress node pointers
+    // @param hasher        object used to hash the keys
+    // @param resetMem      mark all the slots empty. Otherwise the memory
+    //                      holds a previously saved table.
+    Impl(size_t numSlots,
+         void* memStart,
+         const PtrCompressor& compressor,
+         const Hasher& hasher,
+         bool resetMem);
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    uint32_t getHash(Key key) const noexcept {
+      return (*hasher_)(key.data(), key.size());
+    }
+
+    ShardId getShard(uint32_t hash) const noexcept {
+      return hash & numShardsMask_;
+    }
+
+    ShardId getShardForGroup(GroupId group) const noexcept {
+      return group >> groupsPerShardPower_;
+    }
+
+    // @return  slot holding the key or kInvalidSlot
+    SlotId findSlot(Key key, uint32_t hash) const noexcept;
+
+    T* findNode(Key key, uint32_t hash) const noexcept {
+      const auto slot = findSlot(key, hash);
+      return slot == kInvalidSlot ? nullptr : getNode(slot);
+    }
+
+    T* getNode(SlotId slot) const noexcept {
+      XDCHECK_LT(slot, numSlots_);
+      return compressor_.unCompress(slots_[slot]);
+    }
+
+    // inserts the node. The key must not be in the table.
+    //
+    // @param canRehash   whether the shard may be rebuilt to drop its
+    //                    deleted slots when it runs out of empty ones
+    // @return  false if the shard of the key is full
+    bool insert(T& node, uint32_t hash, bool canRehash) noexcept;
+
+    // point the slot at a node with the same key
+    void replaceInSlot(SlotId slot, T& node) noexcept {
+      XDCHECK(getNode(slot)->getKey() == node.getKey());
+      slots_[slot] = compressor_.compress(&node);
+    }
+
+    // empty the slot
+    void removeSlot(SlotId slot) noexcept;
+
+    // prefetch the first group of controls probed for the hash.
+    void prefetchGroup(uint32_t hash) const noexcept {
+      __builtin_prefetch(
+          ctrl_ + getGroup(getShard(hash), hash, 0) * kGroupSize, 0, 3);
+    }
+
+    // call 'func' on each node in the group
+    template <typename F>
+    void forEachGroupElem(GroupId group, F&& func) const;
+
+    // number of nodes in the group
+    unsigned int getGroupNumElems(GroupId group) const noexcept;
+
+    bool isRestorable() const noexcept { return restorable_; }
+
+    size_t getNumSlots() const noexcept { return numSlots_; }
+
+    size_t getNumGroups() const noexcept { return numSlots_ / kGroupSize; }
+
+    // memory needed for numSlots slots: a control byte and a compressed
+    // pointer per slot.
+    static size_t getRequiredSize(size_t numSlots) noexcept {
+      return numSlots * (sizeof(uint8_t) + sizeof(CompressedPtrType));
+    }
+
+   private:
+    // shards never span more than this many slots so that rebuilding one is
+    // cheap and the locks spread across the table.
+    static constexpr size_t kMaxShardSize = 1024;
+
+    // control bytes. Zeroed memory is an empty table.
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kDeleted = 1;
+    static constexpr uint8_t kFull = 0x80;
+
+    // the low bits of the hash pick the shard and the group. The tag is
+    // taken from the top of a remix of the whole hash so that it is not
+    // correlated with them.
+    static uint8_t getTag(uint32_t hash) noexcept {
+      return static_cast<uint8_t>(
+          kFull | ((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> 57));
+    }
+
+    // bit i is set if the control of slot i in the group equals c.
+    static uint32_t matchControl(const uint8_t* group, uint8_t c) noexcept {
+#if defined(__SSE2__)
+      const auto ctrl =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+      return static_cast<uint32_t>(_mm_movemask_epi8(
+          _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(c)))));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupSize; ++i) {
+        mask |= static_cast<uint32_t>(group[i] == c) << i;
+      }
+      return mask;
+#endif
+    }
+
+    // bit i is set if slot i in the group holds a node.
+    static uint32_t matchFull(const uint8_t* group) noexcept {
+#if defined(__SSE2__)
+      return static_cast<uint32_t>(_mm_movemask_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupSize; ++i) {
+        mask |= static_cast<uint32_t>((group[i] & kFull) != 0) << i;
+      }
+      return mask;
+#endif
+    }
+
+    // group visited by the probe'th step for the hash. Triangular steps
+    // visit every group of the shard once.
+    GroupId getGroup(ShardId shard, uint32_t hash, size_t probe) const noexcept {
+      const size_t home = hash >> numShardsPower_;
+      return (shard << groupsPerShardPower_) +
+             ((home + probe * (probe + 1) / 2) & groupsPerShardMask_);
+    }
+
+    // first slot along the probe sequence that does not hold a node.
+    //
+    // @param allowEmpty  whether empty slots qualify or only deleted ones
+    // @return  the slot or kInvalidSlot
+    SlotId findFreeSlot(ShardId shard,
+                        uint32_t hash,
+                        bool allowEmpty) const noexcept;
+
+    // reinsert the nodes of the shard, turning its deleted slots empty.
+    void rehashShard(ShardId shard) noexcept;
+
+    // compute the shard sizes and reset or recover the per shard state.
+    void init(bool resetMem);
+
+    // slots of the shard that may hold a node or be deleted
+    size_t getShardCapacity() const noexcept {
+      return shardSize_ - shardSize_ / 8;
+    }
+
+    const size_t numSlots_{0};
+
+    size_t shardSize_{0};
+    unsigned int numShardsPower_{0};
+    size_t numShardsMask_{0};
+    unsigned int groupsPerShardPower_{0};
+    size_t groupsPerShardMask_{0};
+
+    // memory for the slots when it is managed by Impl.
+    std::unique_ptr<void, void (*)(void*)> ownedMemory_{nullptr, std::free};
+
+    // control byte of each slot, followed in memory by the slots.
+    uint8_t* const ctrl_;
+    CompressedPtrType* const slots_;
+
+    // number of empty slots each shard can still fill before it is full.
+    // Recomputed from the controls when the table is restored.
+    std::unique_ptr<uint32_t[]> growthLeft_;
+
+    // indicate whether or not the table uses user-managed memory and is
+    // thus restorable from serialized state
+    const bool restorable_{false};
+
+    // object used to compress/decompress node pointers
+    const PtrCompressor compressor_;
+
+    // Hash the key
+    const Hasher hasher_;
+  };
+
+ public:
+  // the saved state has the same fields as that of ChainedHashTable. The
+  // cache metadata records the AccessType, so one is never restored as the
+  // other.
+  using SerializationType = serialization::ChainedHashTableObject;
+
+  // Config class for the open addressing hash table.
+  class Config {
+   public:
+    // Do not add 'noexcept' here, see ChainedHashTable::Config.
+    Config() = default;
+
+    // @param bucketsPower number of slots in base 2 logarithm
+    // @param locksPower number of locks in base 2 logarithm
+    // @param pageSize page size
+    Config(unsigned int bucketsPower,
+           unsigned int locksPower,
+           PageSizeT pageSize = PageSizeT::NORMAL)
+        : Config(bucketsPower,
+                 locksPower,
+                 std::make_shared<MurmurHash2>(),
+                 pageSize) {}
+
+    // @param bucketsPower number of slots in base 2 logarithm
+    // @param locksPower number of locks in base 2 logarithm
+    // @param hasher the key hash function
+    // @param pageSize page size
+    Config(unsigned int bucketsPower,
+           unsigned int locksPower,
+           Hasher hasher,
+           PageSizeT pageSize = PageSizeT::NORMAL)
+        : bucketsPower_(bucketsPower),
+          locksPower_(locksPower),
+          pageSize_(pageSize),
+          hasher_(std::move(hasher)) {
+      if (bucketsPower_ < kMinBucketPower || bucketsPower_ > kMaxBucketPower ||
+          locksPower_ > kMaxLockPower || locksPower_ > bucketsPower_) {
+        throw std::invalid_argument(folly::sformat(
+            "Invalid arguments to the config constructor bucketPower =  {}, "
+            "lockPower = {}",
+            bucketsPower_, locksPower_));
+      }
+    }
+
+    Config(const Config&) = default;
+    Config& operator=(const Config&) = default;
+
+    size_t getNumBuckets() const noexcept {
+      return static_cast<size_t>(1) << bucketsPower_;
+    }
+
+    // slots to reserve memory for. The table does not grow.
+    size_t getMaxNumBuckets() const noexcept { return getNumBuckets(); }
+
+    size_t getNumLocks() const noexcept {
+      return static_cast<size_t>(1) << locksPower_;
+    }
+
+    // Estimate bucketsPower and LocksPower based on cache entries.
+    void sizeBucketsPowerAndLocksPower(size_t cacheEntries) {
+      // a shard is full at 7/8 of its slots. Keeping the average load at
+      // 60% leaves room for the shards that get more than their share.
+      bucketsPower_ = std::max(
+          kMinBucketPower,
+          static_cast<unsigned int>(ceil(log2(cacheEntries * 1.6))));
+
+      if (bucketsPower_ > kMaxBucketPower) {
+        throw std::invalid_argument(folly::sformat(
+            "Invalid arguments to the config constructor cacheEntries =  {}",
+            cacheEntries));
+      }
+
+      // 1 lock per 1000 slots.
+      locksPower_ =
+          (bucketsPower_ <= 20) ? (bucketsPower_ / 2) + 1 : bucketsPower_ - 10;
+    }
+
+    unsigned int getBucketsPower() const noexcept { return bucketsPower_; }
+
+    unsigned int getLocksPower() const noexcept { return locksPower_; }
+
+    const Hasher& getHasher() const noexcept { return hasher_; }
+
+    // Track the contention on the shard locks. See
+    // ChainedHashTable::Config::setLockContentionSampleRate().
+    Config& setLockContentionSampleRate(uint32_t sampleRate) noexcept {
+      lockContentionSampleRate_ = sampleRate;
+      return *this;
+    }
+
+    uint32_t getLockContentionSampleRate() const noexcept {
+      return lockContentionSampleRate_;
+    }
+
+    std::map<std::string, std::string> serialize() const {
+      std::map<std::string, std::string> configMap;
+      configMap["BucketsPower"] = std::to_string(bucketsPower_);
+      configMap["LocksPower"] = std::to_string(locksPower_);
+      configMap["LockContentionSampleRate"] =
+          std::to_string(lockContentionSampleRate_);
+      configMap["Hasher"] =
+          hasher_->getMagicId() == 1 ? "FNVHash" : "MurmurHash2";
+      return configMap;
+    }
+
+    PageSizeT getPageSize() const { return pageSize_; }
+
+   private:
+    // at least one group of slots.
+    static constexpr unsigned int kMinBucketPower = 4;
+    static constexpr unsigned int kMaxBucketPower = 32;
+    static constexpr unsigned int kMaxLockPower = 32;
+
+    // total number of slots in the hashtable expressed as power of two. The
+    // default holds a few thousand keys since slots are not shared.
+    unsigned int bucketsPower_{12};
+
+    // total number of locks for the hashtable expressed as a power of two.
+    unsigned int locksPower_{5};
+
+    PageSizeT pageSize_{PageSizeT::NORMAL};
+
+    // one out of this many contended shard lock acquisitions is timed. 0
+    // means contention is not tracked.
+    uint32_t lockContentionSampleRate_{0};
+
+    Hasher hasher_ = std::make_shared<MurmurHash2>();
+  };
+
+  // Interface for the Container that implements a hash table. Maintains
+  // the node's isInAccessContainer state. T must implement an interface to
+  // markAccessible(), unmarkAccessible() and isAccessible().
+  template <typename T,
+            Hook<T> T::*HookPtr,
+            typename LockT = facebook::cachelib::SharedMutexBuckets>
+  struct Container {
+   private:
+    using Hashtable = Impl<T>;
+    using GroupId = typename Hashtable::GroupId;
+    using ShardId = typename Hashtable::ShardId;
+
+   public:
+    using Key = typename T::Key;
+    using Handle = typename T::Handle;
+    using HandleMaker = typename T::HandleMaker;
+    using CompressedPtrType = typename T::CompressedPtrType;
+    using PtrCompressor = typename T::PtrCompressor;
+
+    // default handle maker that calls incRef
+    static const HandleMaker kDefaultHandleMaker;
+
+    // container with default config.
+    Container() noexcept
+        : Container(Config{}, PtrCompressor(), kDefaultHandleMaker) {}
+
+    // create hash table container with local-managed memory
+    // @param config      the config for the hashtable
+    // @param compressor  object used to compress/decompress node pointers
+    // @param hm          the functor that creates a Handle from T*
+    Container(Config c,
+              const PtrCompressor& compressor,
+              HandleMaker hm = kDefaultHandleMaker)
+        : config_(std::move(c)),
+          handleMaker_(std::move(hm)),
+          ht_{config_.getNumBuckets(), compressor, config_.getHasher()},
+          locks_{config_.getLocksPower(), config_.getHasher(),
+                 config_.getLockContentionSampleRate()} {}
+
+    // create hash table container with user-managed memory
+    //
+    // @param c           config for hash table
+    // @param memStart    hash table memory managed by the user, of
+    //                    getRequiredSize(c.getNumBuckets()) bytes
+    // @param compressor  object used to compress/decompress node pointers
+    // @param hm          the functor that creates a Handle from T*
+    Container(Config c,
+              void* memStart,
+              const PtrCompressor& compressor,
+              HandleMaker hm = kDefaultHandleMaker)
+        : config_(std::move(c)),
+          handleMaker_(std::move(hm)),
+          ht_{config_.getNumBuckets(), memStart, compressor,
+              config_.getHasher(), true /* resetMem */},
+          locks_{config_.getLocksPower(), config_.getHasher(),
+                 config_.getLockContentionSampleRate()} {}
+
+    // restore hash table from serialized data.
+    //
+    // @param object      serialized object
+    // @param newConfig   the new set of configurations
+    // @param memSegment  shared memory segment for the hash table
+    // @param compressor  object used to compress/decompress node pointers
+    // @param hm          the functor that creates a Handle from T*
+    //
+    // @throw std::invalid argument if the bucket power in new config does not
+    //        match the previous state or the size of the memSegment does not
+    //        match the old state.
+    Container(const serialization::ChainedHashTableObject& object,
+              const Config& newConfig,
+              ShmAddr memSegment,
+              const PtrCompressor& compressor,
+              HandleMaker hm = kDefaultHandleMaker);
+
+    // restore hash table from previous state. This only works when the
+    // hash table memory is managed by the user.
+    //
+    // @param object      serialized object
+    // @param newConfig   the new set of configurations
+    // @param memStart    hash table memory managed by the user
+    // @param nBytes      size of memory allocation pointed to by memStart
+    // @param compressor  object used to compress/decompress node pointers
+    // @param hm          the functor that creates a Handle from T*
+    //
+    // @throw std::invalid argument if the bucket power in new config does not
+    //        match the previous state or the size of the memSegment does not
+    //        match the old state.
+    Container(const serialization::ChainedHashTableObject& object,
+              const Config& newConfig,
+              void* memStart,
+              size_t nBytes,
+              const PtrCompressor& compressor,
+              HandleMaker hm = kDefaultHandleMaker);
+
+    Container(const Container&) = delete;
+    Container& operator=(const Container&) = delete;
+
+    // inserts the node into the hash table and marks it as being in the
+    // hashtable upon success. If another node exists with the same key or
+    // the shard of the key is full, the insert fails. On failure the state
+    // of the node is unchanged.
+    //
+    // @param node  the node to be inserted into the hashtable
+    // @return  True if the node was successfully inserted into the hashtable.
+    //          False if not.
+    bool insert(T& node) noexcept;
+
+    // inserts or replaces the node into the hash table and marks it being in
+    // the hashtable upon success. If another node exists with the same key, the
+    // that node is removed. On failure the state of the node is unchanged.
+    //
+    // @param node  the node to be inserted into the hashtable
+    // @return  if the node was successfully inserted into the hashtable,
+    //          returns a null handle. If the node replaced an existing node,
+    //          a handle to the old node is returned.
+    //
+    // @throw std::overflow_error is the maximum item refcount is execeeded by
+    //        creating this item handle.
+    // @throw exception::AccessContainerFull if there is no node to replace
+    //        and the shard of the key is full.
+    Handle insertOrReplace(T& node);
+
+    // replaces a node into the hash table, only if another node exists with
+    // the same key and is marked accessible.
+    //
+    // @param oldNode   expected current node in the hash table
+    // @param newNode   the new node for the key
+    //
+    // @return true  if oldNode exists, is accessible, and was replaced
+    //               successfully.
+    bool replaceIfAccessible(T& oldNode, T& newNode) noexcept;
+
+    // replaces a node if predicate returns true on the existing node
+    //
+    // @param oldNode   expected current node in the hash table
+    // @param newNode   the new node for the key
+    // @param predicate   asseses if condition is met for the oldNode to merit
+    //                    a replace
+    //
+    // @return true  if oldNode exists, is accessible, predicate is true, and
+    //               was replaced successfully.
+    template <typename F>
+    bool replaceIf(T& oldNode, T& newNode, F&& predicate);
+
+    // removes the node from the hashtable and unmarks it as accessible. If
+    // the node does not exists, returns False.
+    //
+    // @param   node  node to be removed from the hashtable.
+    // @return  True if the node was in the hashtable and if it was
+    //          successfully removed. False if the node was not in the
+    //          hashtable.
+    bool remove(T& node) noexcept;
+
+    // remove a node from the container if it exists for the key and the
+    // predicate returns true for the node. This is intended to simplify the
+    // eviction purposes to guarantee a good selection of candidate.
+    //
+    // @param  node       the node to be removed
+    // @param  predicate  the predicate check for the node
+    //
+    // @return handle to the node if we successfully removed it. returns a
+    // null handle if the node was either not in the container or the
+    // predicate failed.
+    Handle removeIf(T& node,
+                    const std::function<bool(const T& node)>& predicate);
+
+    // finds the node corresponding to the key in the hashtable and returns a
+    // handle to that node.
+    //
+    // @param key   the lookup key
+    //
+    // @return  Handle with valid T* if there is a node corresponding to the
+    //          key or a Handle with nullptr if not.
+    //
+    // @throw std::overflow_error is the maximum item refcount is execeeded by
+    //        creating this item handle.
+    Handle find(Key key) const;
+
+    // finds the nodes corresponding to the keys in the hashtable. All the
+    // keys are hashed and their first group of controls prefetched up front.
+    // The lookups are then grouped by lock so that each lock is acquired
+    // only once for the entire batch.
+    //
+    // @param keys  the lookup keys
+    //
+    // @return  vector of Handles in the same order as keys. A Handle is
+    //          nullptr if there is no node corresponding to the key.
+    //
+    // @throw std::overflow_error is the maximum item refcount is execeeded by
+    //        creating an item handle.
+    std::vector<Handle> findBatch(folly::Range<const Key*> keys) const;
+
+    // for saving the state of the hash table
+    //
+    // precondition:  serialization must happen without any reader or writer
+    // present. Any modification of this object afterwards will result in an
+    // invalid, inconsistent state for the serialized data.
+    //
+    // @throw std::logic_error if the container has any pending iterators that
+    // need to be destroyed or if the container can not be restored.
+    serialization::ChainedHashTableObject saveState() const;
+
+    // get the required size for the slots.
+    static size_t getRequiredSize(size_t numBuckets) noexcept {
+      return Hashtable::getRequiredSize(numBuckets);
+    }
+
+    const Config& getConfig() const noexcept { return config_; }
+
+    unsigned int getHashpower() const noexcept {
+      return config_.getBucketsPower();
+    }
+
+    // the slots are fixed, so there is never anything to resize.
+    //
+    // @return  0, the number of buckets split
+    size_t resizeStep(size_t /* maxBuckets */) noexcept { return 0; }
+
+    // Iterator interface for the hashtable. Iterates over the hashtable
+    // group by group and takes a snapshot of the group to iterate over. It
+    // guarantees that all keys that were present when the iteration started
+    // will be accessible unless they are removed. Keys that are
+    // removed/inserted during the lifetime of an iterator are not guaranteed
+    // to be either visited or not-visited. Adding/Removing from the hash
+    // table while the iterator is alive will not invalidate any iterator or
+    // the element that the iterator points at currently. The iterator
+    // internally holds a Handle to the item.
+    class Iterator {
+     public:
+      ~Iterator() {
+        XDCHECK_GT(container_->numIterators_.load(), 0u);
+        --container_->numIterators_;
+      }
+      Iterator(const Iterator&) = delete;
+      Iterator& operator=(const Iterator&) = delete;
+
+      Iterator(Iterator&&) noexcept;
+      Iterator& operator=(Iterator&&) noexcept;
+      enum EndIterT { EndIter };
+
+      // increment the iterator to the next element.
+      // with/without throttler
+      Iterator& operator++();
+
+      // dereference the current element that the iterator is pointing to.
+      T& operator*();
+      T* operator->() { return &(*(*this)); }
+      const T& operator*() const;
+      const T* operator->() const { return &(*(*this)); }
+
+      bool operator==(const Iterator& other) const noexcept {
+        return container_ == other.container_ &&
+               currGroup_ == other.currGroup_ && curSor_ == other.curSor_;
+      }
+
+      bool operator!=(const Iterator& other) const noexcept {
+        return !(*this == other);
+      }
+
+      const Handle& asHandle() { return curr(); }
+
+      // reset the Iterator to begin of container
+      void reset();
+
+     private:
+      // container for the iterator
+      using C = Container<T, HookPtr, LockT>;
+
+      // construct an iterator with the given
+      friend C;
+      explicit Iterator(C& ht,
+                        folly::Optional<util::Throttler::Config>
+                            throttlerConfig = folly::none);
+
+      Iterator(C& ht, EndIterT);
+
+      // the container over which we are iterating
+      mutable C* container_;
+
+      // current group that the iterator is pointing to.
+      mutable GroupId currGroup_{0};
+
+      // cursor into the current group.
+      mutable unsigned int curSor_{0};
+
+      // current group.
+      mutable std::vector<Handle> groupElems_;
+
+      // optional throttler
+      folly::Optional<util::Throttler> throttler_ = folly::none;
+
+      // returns the handle for current item in the iterator.
+      Handle& curr() {
+        if (curSor_ < groupElems_.size()) {
+          return groupElems_[curSor_];
+        }
+        throw std::logic_error(
+            "Iterator in invalid state with curSor_: " +
+            folly::to<std::string>(curSor_) + ", currGroup_: " +
+            folly::to<std::string>(currGroup_) + ", total groups: " +
+            folly::to<std::string>(container_->ht_.getNumGroups()));
+      }
+    };
+
+    // Iterator interface to the container.
+    // whether it constructs iterator of begin with a throttler config
+    Iterator begin(folly::Optional<util::Throttler::Config> throttlerConfig);
+
+    Iterator begin() { return Iterator(*this); }
+    Iterator end() { return Iterator(*this, Iterator::EndIter); }
+
+    // Stats describing the distribution of items (keys) in the hash table
+    struct DistributionStats {
+      uint64_t numKeys{0};
+      uint64_t numBuckets{0};
+      // map from number of items in a group of slots to the number of such
+      // groups.
+      std::map<unsigned int, uint64_t> itemDistribution{};
+    };
+
+    struct Stats {
+      uint64_t numKeys;
+      uint64_t numBuckets;
+      // slots are always initialized upfront.
+      uint64_t numInitializedBuckets;
+      // inserts that failed because the shard of the key was full
+      uint64_t numInsertFailures;
+    };
+
+    // Get the distribution stats. This function will use cached results
+    // if the difference since last updated is not significant. This is
+    // expensive. Call at your discretion.
+    //
+    // Critiera for refreshing the stats:
+    //  - 10 minutes since last update, OR
+    //  - 5% more or less number of keys in the hash table
+    DistributionStats getDistributionStats() const;
+
+    // lightweight stats that give the number of keys and buckets inside the
+    // container. This is guaranteed to be fast.
+    Stats getStats() const noexcept {
+      return {numKeys_, ht_.getNumSlots(), ht_.getNumSlots(),
+              numInsertFailures_.load(std::memory_order_relaxed)};
+    }
+
+    // Get the total number of keys inserted into the hash table
+    uint64_t getNumKeys() const noexcept {
+      return numKeys_.load(std::memory_order_relaxed);
+    }
+
+    // @return  contention stats of the shard locks, indexed by lock, or
+    //          nullptr if Config::setLockContentionSampleRate was not set.
+    const util::LockContentionStats* getLockContentionStats() const noexcept {
+      return locks_.getContentionStats();
+    }
+
+    // @return  index of the lock guarding @key. Operations on keys sharing
+    //          a lock can be grouped to keep the lock and its shard hot.
+    uint32_t getLockIdx(Key key) const noexcept {
+      return ht_.getShard(ht_.getHash(key)) &
+             ((1u << config_.getLocksPower()) - 1);
+    }
+
+   private:
+    // rebuilding a shard moves nodes between its groups, which could make
+    // a live iterator skip them. Full shards are only rebuilt without any.
+    bool canRehash() const noexcept { return numIterators_ == 0; }
+
+    // the slots of the saved table are read when restoring it, so the saved
+    // state is validated before that.
+    //
+    // @return  the number of slots
+    //
+    // @throw std::invalid_argument if the saved state does not match the
+    //        config or the memory size
+    static size_t checkSavedState(
+        const serialization::ChainedHashTableObject& object,
+        const Config& config,
+        size_t nBytes);
+
+    // Fetch a vector of handle to the items belonging to a given group. This
+    // is for use by the iterator. 'handles' will be cleared and then populated
+    // with handles for the items in the given group. Items will be skipped if
+    // the handle cannot be acquired for any reason.
+    void getGroupElems(GroupId group, std::vector<Handle>& handles) const;
+
+    // config for the hash table.
+    const Config config_{};
+
+    // handle maker to convert the T* to T::Handle
+    HandleMaker handleMaker_;
+
+    // the hashtable slots
+    Hashtable ht_;
+
+    // locks protecting the shards of the hashtable
+    mutable LockT locks_;
+
+    std::atomic<unsigned int> numIterators_{0};
+
+    // Cached stats for distribution
+    // This is updated if the number of keys changes by more than 5%, or
+    // it has been 10 minutes since the stats has last been updated.
+    mutable std::mutex cachedStatsLock_;
+    mutable DistributionStats cachedStats_{};
+
+    // if we can recompute the cachedStats if it is too old. Set to false when
+    // another thread is computing it.
+    mutable bool canRecomputeDistributionStats_{true};
+
+    // when the distribution was last computed.
+    mutable time_t cachedStatsUpdateTime_{0};
+
+    // number of the keys stored in this hash table
+    std::atomic<uint64_t> numKeys_{0};
+
+    // number of inserts that found the shard of their key full
+    std::atomic<uint64_t> numInsertFailures_{0};
+  };
+};
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+const typename T::HandleMaker
+    OpenAddressingHashTable::Container<T, HookPtr, LockT>::kDefaultHandleMaker =
+        [](T* t) -> typename T::Handle {
+  if (t) {
+    t->incRef();
+  }
+  return typename T::Handle{t};
+};
+
+template <typename T>
+OpenAddressingHashTable::Impl<T>::Impl(size_t numSlots,
+                                       const PtrCompressor& compressor,
+                                       const Hasher& hasher)
+    : numSlots_(numSlots),
+      ownedMemory_(std::calloc(getRequiredSize(numSlots), 1), std::free),
+      ctrl_(static_cast<uint8_t*>(ownedMemory_.get())),
+      slots_(reinterpret_cast<CompressedPtrType*>(ctrl_ + numSlots)),
+      compressor_(compressor),
+      hasher_(hasher) {
+  if (ownedMemory_ == nullptr) {
+    throw std::bad_alloc();
+  }
+  // calloc already marked every slot empty.
+  init(false /* resetMem */);
+}
+
+template <typename T>
+OpenAddressingHashTable::Impl<T>::Impl(size_t numSlots,
+                                       void* memStart,
+                                       const PtrCompressor& compressor,
+                                       const Hasher& hasher,
+                                       bool resetMem)
+    : numSlots_(numSlots),
+      ctrl_(static_cast<uint8_t*>(memStart)),
+      slots_(reinterpret_cast<CompressedPtrType*>(ctrl_ + numSlots)),
+      restorable_(true),
+      compressor_(compressor),
+      hasher_(hasher) {
+  init(resetMem);
+}
+
+template <typename T>
+void OpenAddressingHashTable::Impl<T>::init(bool resetMem) {
+  if (numSlots_ < kGroupSize) {
+    throw std::invalid_argument(
+        folly::sformat("Can not have less than {} slots", kGroupSize));
+  }
+  if (numSlots_ & (numSlots_ - 1)) {
+    throw std::invalid_argument("Number of slots must be a power of two");
+  }
+
+  shardSize_ = std::min(numSlots_, kMaxShardSize);
+  const size_t numShards = numSlots_ / shardSize_;
+  numShardsPower_ = static_cast<unsigned int>(__builtin_ctzll(numShards));
+  numShardsMask_ = numShards - 1;
+  const size_t groupsPerShard = shardSize_ / kGroupSize;
+  groupsPerShardPower_ =
+      static_cast<unsigned int>(__builtin_ctzll(groupsPerShard));
+  groupsPerShardMask_ = groupsPerShard - 1;
+
+  if (resetMem) {
+    std::memset(ctrl_, kEmpty, numSlots_);
+  }
+
+  growthLeft_ = std::make_unique<uint32_t[]>(numShards);
+  for (ShardId shard = 0; shard < numShards; ++shard) {
+    const uint8_t* begin = ctrl_ + shard * shardSize_;
+    const auto used = static_cast<size_t>(
+        std::count_if(begin, begin + shardSize_,
+                      [](uint8_t c) { return c != kEmpty; }));
+    growthLeft_[shard] = static_cast<uint32_t>(
+        used < getShardCapacity() ? getShardCapacity() - used : 0);
+  }
+}
+
+template <typename T>
+typename OpenAddressingHashTable::Impl<T>::SlotId
+OpenAddressingHashTable::Impl<T>::findSlot(Key key,
+                                           uint32_t hash) const noexcept {
+  const auto shard = getShard(hash);
+  const auto tag = getTag(hash);
+  for (size_t probe = 0; probe <= groupsPerShardMask_; ++probe) {
+    const auto group = getGroup(shard, hash, probe);
+    const uint8_t* ctrl = ctrl_ + group * kGroupSize;
+    for (uint32_t match = matchControl(ctrl, tag); match != 0;
+         match &= match - 1) {
+      const SlotId slot = group * kGroupSize + __builtin_ctz(match);
+      if (getNode(slot)->getKey() == key) {
+        return slot;
+      }
+    }
+    // an insert would have used the empty slot, so the key can not be in
+    // any later group.
+    if (matchControl(ctrl, kEmpty) != 0) {
+      break;
+    }
+  }
+  return kInvalidSlot;
+}
+
+template <typename T>
+typename OpenAddressingHashTable::Impl<T>::SlotId
+OpenAddressingHashTable::Impl<T>::findFreeSlot(ShardId shard,
+                                               uint32_t hash,
+                                               bool allowEmpty) const noexcept {
+  for (size_t probe = 0; probe <= groupsPerShardMask_; ++probe) {
+    const auto group = getGroup(shard, hash, probe);
+    const uint8_t* ctrl = ctrl_ + group * kGroupSize;
+    const uint32_t match = matchControl(ctrl, kDeleted) |
+                           (allowEmpty ? matchControl(ctrl, kEmpty) : 0);
+    if (match != 0) {
+      return group * kGroupSize + __builtin_ctz(match);
+    }
+    // lookups stop at the first group with an empty slot, so a node past it
+    // would not be found.
+    if (matchControl(ctrl, kEmpty) != 0) {
+      break;
+    }
+  }
+  return kInvalidSlot;
+}
+
+template <typename T>
+bool OpenAddressingHashTable::Impl<T>::insert(T& node,
+                                              uint32_t hash,
+                                              bool canRehash) noexcept {
+  XDCHECK_EQ(kInvalidSlot, findSlot(node.getKey(), hash));
+  const auto shard = getShard(hash);
+  if (growthLeft_[shard] == 0 && canRehash) {
+    rehashShard(shard);
+  }
+
+  // without growth left only deleted slots can be reused
+  const bool allowEmpty = growthLeft_[shard] > 0;
+  const auto slot = findFreeSlot(shard, hash, allowEmpty);
+  if (slot == kInvalidSlot) {
+    return false;
+  }
+  if (ctrl_[slot] == kEmpty) {
+    --growthLeft_[shard];
+  }
+  ctrl_[slot] = getTag(hash);
+  slots_[slot] = compressor_.compress(&node);
+  return true;
+}
+
+template <typename T>
+void OpenAddressingHashTable::Impl<T>::removeSlot(SlotId slot) noexcept {
+  XDCHECK_LT(slot, numSlots_);
+  XDCHECK(ctrl_[slot] & kFull);
+  const uint8_t* group = ctrl_ + (slot / kGroupSize) * kGroupSize;
+  // lookups stop at a group with an empty slot, so if the group already has
+  // one, no probe sequence goes past it and the slot can be emptied too.
+  if (matchControl(group, kEmpty) != 0) {
+    ctrl_[slot] = kEmpty;
+    ++growthLeft_[getShardForGroup(slot / kGroupSize)];
+  } else {
+    ctrl_[slot] = kDeleted;
+  }
+}
+
+template <typename T>
+void OpenAddressingHashTable::Impl<T>::rehashShard(ShardId shard) noexcept {
+  std::array<T*, kMaxShardSize> nodes;
+  size_t numNodes = 0;
+  const SlotId begin = shard * shardSize_;
+  for (SlotId slot = begin; slot < begin + shardSize_; ++slot) {
+    if (ctrl_[slot] & kFull) {
+      nodes[numNodes++] = getNode(slot);
+    }
+  }
+
+  std::memset(ctrl_ + begin, kEmpty, shardSize_);
+  growthLeft_[shard] = static_cast<uint32_t>(getShardCapacity());
+  for (size_t i = 0; i < numNodes; ++i) {
+    const auto hash = getHash(nodes[i]->getKey());
+    const auto slot = findFreeSlot(shard, hash, true /* allowEmpty */);
+    XDCHECK_NE(kInvalidSlot, slot);
+    ctrl_[slot] = getTag(hash);
+    slots_[slot] = compressor_.compress(nodes[i]);
+    --growthLeft_[shard];
+  }
+}
+
+template <typename T>
+template <typename F>
+void OpenAddressingHashTable::Impl<T>::forEachGroupElem(GroupId group,
+                                                        F&& func) const {
+  XDCHECK_LT(group, getNumGroups());
+  for (uint32_t match = matchFull(ctrl_ + group * kGroupSize); match != 0;
+       match &= match - 1) {
+    func(getNode(group * kGroupSize + __builtin_ctz(match)));
+  }
+}
+
+template <typename T>
+unsigned int OpenAddressingHashTable::Impl<T>::getGroupNumElems(
+    GroupId group) const noexcept {
+  XDCHECK_LT(group, getNumGroups());
+  return static_cast<unsigned int>(
+      __builtin_popcount(matchFull(ctrl_ + group * kGroupSize)));
+}
+
+// AccessContainer interface
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Container(
+    const serialization::ChainedHashTableObject& object,
+    const Config& config,
+    ShmAddr memSegment,
+    const PtrCompressor& compressor,
+    HandleMaker hm)
+    : Container(object,
+                config,
+                memSegment.addr,
+                memSegment.size,
+                compressor,
+                std::move(hm)) {}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Container(
+    const serialization::ChainedHashTableObject& object,
+    const Config& config,
+    void* memStart,
+    size_t nBytes,
+    const PtrCompressor& compressor,
+    HandleMaker hm)
+    : config_{config},
+      handleMaker_(std::move(hm)),
+      ht_{checkSavedState(object, config, nBytes), memStart, compressor,
+          config_.getHasher(), false /* resetMem */},
+      locks_{config_.getLocksPower(), config_.getHasher(),
+             config_.getLockContentionSampleRate()},
+      numKeys_(*object.numKeys()) {}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+size_t OpenAddressingHashTable::Container<T, HookPtr, LockT>::checkSavedState(
+    const serialization::ChainedHashTableObject& object,
+    const Config& config,
+    size_t nBytes) {
+  if (config.getBucketsPower() !=
+      static_cast<uint32_t>(*object.bucketsPower())) {
+    throw std::invalid_argument(folly::sformat(
+        "Hashtable bucket power not compatible. old = {}, new = {}",
+        *object.bucketsPower(),
+        config.getBucketsPower()));
+  }
+
+  if (nBytes != getRequiredSize(config.getNumBuckets())) {
+    throw std::invalid_argument(folly::sformat(
+        "Hashtable size not compatible. old = {}, new = {}",
+        nBytes,
+        getRequiredSize(config.getNumBuckets())));
+  }
+
+  // the slots a key can be in depend on the hash function.
+  if (*object.hasherMagicId() != config.getHasher()->getMagicId()) {
+    throw std::invalid_argument(folly::sformat(
+        "Hash object's ID mismatch. expected = {}, actual = {}",
+        *object.hasherMagicId(), config.getHasher()->getMagicId()));
+  }
+  return config.getNumBuckets();
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename OpenAddressingHashTable::Container<T, HookPtr, LockT>::
+    DistributionStats
+    OpenAddressingHashTable::Container<T, HookPtr, LockT>::
+        getDistributionStats() const {
+  const auto now = util::getCurrentTimeSec();
+  const uint64_t numKeys = numKeys_;
+
+  std::unique_lock<std::mutex> statsLockGuard(cachedStatsLock_);
+  const auto numKeysDifference = numKeys > cachedStats_.numKeys
+                                     ? numKeys - cachedStats_.numKeys
+                                     : cachedStats_.numKeys - numKeys;
+
+  const bool needToRecompute =
+      (now - cachedStatsUpdateTime_ > 10 * 60 /* seconds */) ||
+      (cachedStats_.numKeys > 0 &&
+       (static_cast<double>(numKeysDifference) /
+            static_cast<double>(cachedStats_.numKeys) >
+        0.05));
+
+  // return the cached value or if someone else is already computing.
+  if (!needToRecompute || !canRecomputeDistributionStats_) {
+    return cachedStats_;
+  }
+
+  // record that we are iterating so that we dont cause everyone who
+  // observes this to recompute
+  canRecomputeDistributionStats_ = false;
+
+  // release the lock.
+  statsLockGuard.unlock();
+
+  // compute the distribution
+  std::map<unsigned int, uint64_t> distribution;
+  const auto numGroups = ht_.getNumGroups();
+  for (GroupId currGroup = 0; currGroup < numGroups; ++currGroup) {
+    auto l = locks_.lockShared(ht_.getShardForGroup(currGroup));
+    ++distribution[ht_.getGroupNumElems(currGroup)];
+  }
+
+  // acquire lock
+  statsLockGuard.lock();
+  cachedStats_.numKeys = numKeys;
+  cachedStats_.itemDistribution = std::move(distribution);
+  cachedStats_.numBuckets = ht_.getNumSlots();
+  cachedStatsUpdateTime_ = now;
+  canRecomputeDistributionStats_ = true;
+  return cachedStats_;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+bool OpenAddressingHashTable::Container<T, HookPtr, LockT>::insert(
+    T& node) noexcept {
+  if (node.isAccessible()) {
+    // already in hash table.
+    return false;
+  }
+
+  const auto key = node.getKey();
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockExclusive(ht_.getShard(hash));
+  if (ht_.findSlot(key, hash) != Hashtable::kInvalidSlot) {
+    return false;
+  }
+  if (!ht_.insert(node, hash, canRehash())) {
+    numInsertFailures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  node.markAccessible();
+  numKeys_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename T::Handle
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::insertOrReplace(
+    T& node) {
+  if (node.isAccessible()) {
+    return handleMaker_(nullptr);
+  }
+
+  const auto key = node.getKey();
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockExclusive(ht_.getShard(hash));
+  const auto slot = ht_.findSlot(key, hash);
+  T* oldNode = slot == Hashtable::kInvalidSlot ? nullptr : ht_.getNode(slot);
+  XDCHECK_NE(reinterpret_cast<uintptr_t>(&node),
+             reinterpret_cast<uintptr_t>(oldNode));
+
+  // grab a handle to the old node before changing anything, so that a
+  // failure leaves the table as it was.
+  auto handle = handleMaker_(oldNode);
+
+  if (oldNode) {
+    ht_.replaceInSlot(slot, node);
+  } else if (!ht_.insert(node, hash, canRehash())) {
+    numInsertFailures_.fetch_add(1, std::memory_order_relaxed);
+    throw exception::AccessContainerFull(
+        folly::sformat("No free slot for key {} in the hash table shard",
+                       folly::StringPiece{key.data(), key.size()}));
+  }
+
+  node.markAccessible();
+
+  if (oldNode) {
+    oldNode->unmarkAccessible();
+  } else {
+    numKeys_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return handle;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+bool OpenAddressingHashTable::Container<T, HookPtr, LockT>::replaceIfAccessible(
+    T& oldNode, T& newNode) noexcept {
+  return replaceIf(oldNode, newNode, [](T&) { return true; });
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+template <typename F>
+bool OpenAddressingHashTable::Container<T, HookPtr, LockT>::replaceIf(
+    T& oldNode, T& newNode, F&& predicate) {
+  const auto key = newNode.getKey();
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockExclusive(ht_.getShard(hash));
+
+  if (oldNode.isAccessible() && predicate(oldNode)) {
+    const auto slot = ht_.findSlot(key, hash);
+    XDCHECK_NE(Hashtable::kInvalidSlot, slot);
+    XDCHECK_EQ(reinterpret_cast<uintptr_t>(&oldNode),
+               reinterpret_cast<uintptr_t>(ht_.getNode(slot)));
+    ht_.replaceInSlot(slot, newNode);
+    oldNode.unmarkAccessible();
+    newNode.markAccessible();
+    return true;
+  }
+  return false;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+bool OpenAddressingHashTable::Container<T, HookPtr, LockT>::remove(
+    T& node) noexcept {
+  const auto key = node.getKey();
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockExclusive(ht_.getShard(hash));
+
+  // check inside the lock to prevent from racing removes
+  if (!node.isAccessible()) {
+    return false;
+  }
+
+  const auto slot = ht_.findSlot(key, hash);
+  XDCHECK_NE(Hashtable::kInvalidSlot, slot) << node.toString();
+  XDCHECK_EQ(reinterpret_cast<uintptr_t>(&node),
+             reinterpret_cast<uintptr_t>(ht_.getNode(slot)));
+  ht_.removeSlot(slot);
+  node.unmarkAccessible();
+
+  numKeys_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename T::Handle
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::removeIf(
+    T& node, const std::function<bool(const T& node)>& predicate) {
+  const auto key = node.getKey();
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockExclusive(ht_.getShard(hash));
+
+  // check inside the lock to prevent from racing removes
+  if (node.isAccessible() && predicate(node)) {
+    // grab the handle before we do any other state change. this ensures that
+    // if handle maker throws an exception, we leave the item in a consistent
+    // state.
+    auto handle = handleMaker_(&node);
+    const auto slot = ht_.findSlot(key, hash);
+    XDCHECK_NE(Hashtable::kInvalidSlot, slot) << node.toString();
+    ht_.removeSlot(slot);
+    node.unmarkAccessible();
+    numKeys_.fetch_sub(1, std::memory_order_relaxed);
+    return handle;
+  } else {
+    return handleMaker_(nullptr);
+  }
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename T::Handle OpenAddressingHashTable::Container<T, HookPtr, LockT>::find(
+    Key key) const {
+  const auto hash = ht_.getHash(key);
+  auto l = locks_.lockShared(ht_.getShard(hash));
+  return handleMaker_(ht_.findNode(key, hash));
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+std::vector<typename T::Handle>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::findBatch(
+    folly::Range<const Key*> keys) const {
+  const size_t numKeys = keys.size();
+  std::vector<uint32_t> hashes(numKeys);
+  for (size_t i = 0; i < numKeys; ++i) {
+    hashes[i] = ht_.getHash(keys[i]);
+    ht_.prefetchGroup(hashes[i]);
+  }
+
+  // locks are picked by masking the shard id. Sort the lookups by their lock
+  // so that all the keys sharing a lock are looked up under one acquisition.
+  const size_t locksMask = config_.getNumLocks() - 1;
+  const auto getLockId = [&](uint32_t idx) {
+    return ht_.getShard(hashes[idx]) & locksMask;
+  };
+  std::vector<uint32_t> order(numKeys);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return getLockId(a) < getLockId(b);
+  });
+
+  std::vector<Handle> handles(numKeys);
+  size_t i = 0;
+  while (i < numKeys) {
+    const auto lockId = getLockId(order[i]);
+    auto l = locks_.lockShared(ht_.getShard(hashes[order[i]]));
+    do {
+      const auto idx = order[i];
+      handles[idx] = handleMaker_(ht_.findNode(keys[idx], hashes[idx]));
+      ++i;
+    } while (i < numKeys && getLockId(order[i]) == lockId);
+  }
+  return handles;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+serialization::ChainedHashTableObject
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::saveState() const {
+  if (!ht_.isRestorable()) {
+    throw std::logic_error(
+        "hashtable is not restorable since the memory is not managed by user");
+  }
+
+  if (numIterators_ != 0) {
+    throw std::logic_error(
+        folly::sformat("There are {} pending iterators", numIterators_.load()));
+  }
+
+  serialization::ChainedHashTableObject object;
+  *object.bucketsPower() = config_.getBucketsPower();
+  *object.locksPower() = config_.getLocksPower();
+  *object.numKeys() = numKeys_;
+  *object.hasherMagicId() = config_.getHasher()->getMagicId();
+  return object;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+void OpenAddressingHashTable::Container<T, HookPtr, LockT>::getGroupElems(
+    GroupId group, std::vector<Handle>& handles) const {
+  handles.clear();
+  auto l = locks_.lockShared(ht_.getShardForGroup(group));
+
+  ht_.forEachGroupElem(group, [this, &handles](T* e) {
+    try {
+      XDCHECK(e);
+      auto h = handleMaker_(e);
+      if (h) {
+        handles.emplace_back(std::move(h));
+      }
+    } catch (const std::exception&) {
+      // if we are not able to acquire a handle, skip over them.
+    }
+  });
+}
+
+// Container's Iterator
+// with/without throtter to iterate
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator&
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::operator++() {
+  if (throttler_) {
+    throttler_->throttle();
+  }
+
+  ++curSor_;
+  if (curSor_ < groupElems_.size()) {
+    return *this;
+  }
+
+  ++currGroup_;
+  for (; currGroup_ < container_->ht_.getNumGroups(); ++currGroup_) {
+    container_->getGroupElems(currGroup_, groupElems_);
+    if (!groupElems_.empty()) {
+      curSor_ = 0;
+      return *this;
+    } else if (throttler_) {
+      throttler_->throttle();
+    }
+  }
+
+  // reach the end
+  groupElems_.clear();
+  curSor_ = 0;
+  return *this;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+T& OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::
+operator*() {
+  return *curr();
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::Iterator(
+    Container<T, HookPtr, LockT>& container,
+    folly::Optional<util::Throttler::Config> throttlerConfig)
+    : container_(&container) {
+  if (throttlerConfig) {
+    throttler_.assign(util::Throttler(*throttlerConfig));
+  }
+
+  ++container_->numIterators_;
+
+  reset();
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::Iterator(
+    Iterator&& other) noexcept
+    : container_{other.container_},
+      currGroup_{other.currGroup_},
+      curSor_{other.curSor_},
+      groupElems_(std::move(other.groupElems_)) {
+  // increment the iterator count when we move.
+  ++container_->numIterators_;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator&
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::operator=(
+    Iterator&& other) noexcept {
+  if (this != &other) {
+    this->~Iterator();
+    new (this) Iterator(std::move(other));
+  }
+  return *this;
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::Iterator(
+    Container<T, HookPtr, LockT>& container, EndIterT)
+    : container_(&container), currGroup_{container_->ht_.getNumGroups()} {
+  // increment the iterator for both the end and begin() types so that the
+  // destructor can just blindly decrement.
+  ++container_->numIterators_;
+  XDCHECK_EQ(0u, curSor_);
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+typename OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator
+OpenAddressingHashTable::Container<T, HookPtr, LockT>::begin(
+    folly::Optional<util::Throttler::Config> throttlerConfig) {
+  return Iterator(*this, throttlerConfig);
+}
+
+template <typename T,
+          typename OpenAddressingHashTable::Hook<T> T::*HookPtr,
+          typename LockT>
+void OpenAddressingHashTable::Container<T, HookPtr, LockT>::Iterator::reset() {
+  curSor_ = 0;
+  currGroup_ = 0;
+  container_->getGroupElems(currGroup_, groupElems_);
+  while (groupElems_.empty() &&
+         ++currGroup_ < container_->ht_.getNumGroups()) {
+    if (throttler_) {
+      throttler_->throttle();
+    }
+    container_->getGroupElems(currGroup_, groupElems_);
+  }
+  XDCHECK_EQ(0u, curSor_);
+}
+} // namespace facebook::cachelib
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/Range.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/allocator/CacheStats.h"
+#include "cachelib/allocator/MemoryMonitor.h"
+#include "cachelib/common/Hash.h"
+#include "cachelib/common/PeriodicWorker.h"
+
+namespace facebook {
+namespace cachelib {
+
+struct PartitionedCacheConfig {
+  // number of cache instances, for example one per NUMA node or core group
+  uint32_t numPartitions{2};
+
+  // DRAM shared by all the partitions, in bytes. Every partition starts with
+  // an equal share and the rest of its configured cache size advised away,
+  // so each partition must be configured at least as large as its share.
+  // Memory then moves to the partitions that evict the most. 0 gives every
+  // partition its whole configured size and never moves memory.
+  size_t memoryBudget{0};
+
+  // interval of the background rebalancing of the budget. 0 leaves it to
+  // the caller to call rebalance().
+  std::chrono::milliseconds rebalanceInterval{0};
+
+  // max number of slabs moved between two partitions by a rebalance
+  uint32_t slabsPerRebalance{1};
+
+  // a partition never gives away memory below this percent of its equal
+  // share of the budget
+  uint32_t minSharePercent{50};
+
+  // @throw std::invalid_argument if the config is invalid
+  void validate() const {
+    if (numPartitions == 0 || slabsPerRebalance == 0) {
+      throw std::invalid_argument(
+          "Partitioned cache needs at least one partition and slab per "
+          "rebalance");
+    }
+    if (minSharePercent > 100) {
+      throw std::invalid_argument(folly::sformat(
+          "Min share must be at most 100 percent, but got {}",
+          minSharePercent));
+    }
+  }
+};
+
+// Owns several cache instances that share one memory budget and routes each
+// key to one of them by its hash, so that the caches can be placed on
+// different NUMA nodes or core groups without contending on the same locks.
+//
+// Pools are added to every partition with an equal share of their size and
+// have the same id in all of them. Pool and memory stats are aggregated over
+// the partitions. Each partition has its own nvm cache, if any: configure
+// a separate device or file per partition in the setup callback.
+//
+// The budget is shared through the slab advising of the partitions: each
+// partition advises away the slabs it holds above its share, and rebalance()
+// moves advised slabs from the partition that evicted the least since the
+// previous rebalance to the one that evicted the most. The memory monitor of
+// every partition carries the advising out in the background.
+template <typename CacheT>
+class PartitionedCache {
+ public:
+  using CacheConfig = typename CacheT::Config;
+  using Item = typename CacheT::Item;
+  using Key = typename Item::Key;
+  using ReadHandle = typename CacheT::ReadHandle;
+  using WriteHandle = typename CacheT::WriteHandle;
+  using RemoveRes = typename CacheT::RemoveRes;
+  using MMConfig = typename CacheT::MMConfig;
+
+  // called with the index and the config of every partition before it is
+  // created, to bind it to a NUMA node, give it its own nvm device, etc.
+  using SetupFn = std::function<void(uint32_t, CacheConfig&)>;
+
+  // @param config        config of the partitioning
+  // @param cacheConfig   config of every partition, whose cache size is the
+  //                      size of one partition
+  // @param setup         optional callback to adjust the config of each
+  //                      partition
+  //
+  // @throw std::invalid_argument if the config is invalid, the budget is
+  //        larger than the partitions or the partitions already monitor
+  //        their memory for another purpose
+  PartitionedCache(const PartitionedCacheConfig& config,
+                   const CacheConfig& cacheConfig,
+                   SetupFn setup = {})
+      : config_(config) {
+    config_.validate();
+    if (config_.memoryBudget > 0 && cacheConfig.memMonitoringEnabled() &&
+        cacheConfig.memMonitorConfig.mode != MemoryMonitor::TestMode) {
+      throw std::invalid_argument(
+          "Partitions sharing a memory budget can not monitor the memory of "
+          "the process");
+    }
+
+    for (uint32_t i = 0; i < config_.numPartitions; i++) {
+      auto partitionConfig = cacheConfig;
+      if (setup) {
+        setup(i, partitionConfig);
+      }
+      if (config_.memoryBudget > 0 &&
+          !partitionConfig.memMonitoringEnabled()) {
+        MemoryMonitor::Config monitorConfig;
+        monitorConfig.mode = MemoryMonitor::TestMode;
+        partitionConfig.enableMemoryMonitor(kAdviseInterval, monitorConfig);
+      }
+      partitions_.push_back(std::make_unique<CacheT>(partitionConfig));
+    }
+
+    advisedSlabs_.resize(config_.numPartitions, 0);
+    maxAdvisedSlabs_.resize(config_.numPartitions, 0);
+    lastEvictions_.resize(config_.numPartitions, 0);
+    if (config_.memoryBudget > 0) {
+      initBudget();
+      if (config_.rebalanceInterval.count() > 0) {
+        rebalancer_ = std::make_unique<Rebalancer>(*this);
+        rebalancer_->start(config_.rebalanceInterval, "PartitionRebalancer");
+      }
+    }
+  }
+
+  ~PartitionedCache() {
+    if (rebalancer_) {
+      rebalancer_->stop();
+    }
+  }
+
+  PartitionedCache(const PartitionedCache&) = delete;
+  PartitionedCache& operator=(const PartitionedCache&) = delete;
+
+  uint32_t numPartitions() const noexcept {
+    return static_cast<uint32_t>(partitions_.size());
+  }
+
+  // @return the partition a key belongs to
+  uint32_t getPartitionIdx(Key key) const noexcept {
+    // the high bits of the hash, since the low bits pick the buckets of the
+    // access container of the partition
+    return static_cast<uint32_t>((HashedKey{key}.keyHash() >> 32) %
+                                 partitions_.size());
+  }
+
+  CacheT& getPartition(uint32_t idx) { return *partitions_.at(idx); }
+
+  CacheT& getPartitionForKey(Key key) {
+    return *partitions_[getPartitionIdx(key)];
+  }
+
+  // Item APIs of the partition of the key. See CacheAllocator.
+  WriteHandle allocate(PoolId pid,
+                       Key key,
+                       uint32_t size,
+                       uint32_t ttlSecs = 0,
+                       uint32_t creationTime = 0) {
+    return getPartitionForKey(key).allocate(pid, key, size, ttlSecs,
+                                            creationTime);
+  }
+
+  bool insert(const WriteHandle& handle) {
+    return getPartitionForKey(handle->getKey()).insert(handle);
+  }
+
+  WriteHandle insertOrReplace(const WriteHandle& handle) {
+    return getPartitionForKey(handle->getKey()).insertOrReplace(handle);
+  }
+
+  ReadHandle find(Key key) { return getPartitionForKey(key).find(key); }
+
+  WriteHandle findToWrite(Key key) {
+    return getPartitionForKey(key).findToWrite(key);
+  }
+
+  RemoveRes remove(Key key) { return getPartitionForKey(key).remove(key); }
+
+  // add a pool to every partition, with an equal share of the size
+  //
+  // @return the id of the pool in all the partitions
+  // @throw   std::invalid_argument if the size is invalid or there is not
+  //          enough space for creating the pool in a partition.
+  //          std::logic_error if we have run out of pools or the partitions
+  //          gave the pool different ids.
+  PoolId addPool(folly::StringPiece name,
+                 size_t size,
+                 const std::set<uint32_t>& allocSizes = {},
+                 MMConfig mmConfig = {}) {
+    const auto share = size / partitions_.size();
+    const auto pid =
+        partitions_[0]->addPool(name, share, allocSizes, mmConfig);
+    for (size_t i = 1; i < partitions_.size(); i++) {
+      if (partitions_[i]->addPool(name, share, allocSizes, mmConfig) != pid) {
+        throw std::logic_error(folly::sformat(
+            "Pool {} has a different id in partition {}", name, i));
+      }
+    }
+    return pid;
+  }
+
+  // shrink or grow a pool by an equal share of the bytes in every partition
+  //
+  // @return true if the pool was resized in all the partitions
+  bool shrinkPool(PoolId pid, size_t bytes) {
+    bool res = true;
+    for (auto& partition : partitions_) {
+      res &= partition->shrinkPool(pid, bytes / partitions_.size());
+    }
+    return res;
+  }
+
+  bool growPool(PoolId pid, size_t bytes) {
+    bool res = true;
+    for (auto& partition : partitions_) {
+      res &= partition->growPool(pid, bytes / partitions_.size());
+    }
+    return res;
+  }
+
+  // @return the stats of the pool summed over the partitions
+  PoolStats getPoolStats(PoolId pid) const {
+    auto stats = partitions_[0]->getPoolStats(pid);
+    for (size_t i = 1; i < partitions_.size(); i++) {
+      stats += partitions_[i]->getPoolStats(pid);
+    }
+    return stats;
+  }
+
+  // @return the memory stats of the cache summed over the partitions
+  CacheMemoryStats getCacheMemoryStats() const {
+    CacheMemoryStats stats;
+    for (const auto& partition : partitions_) {
+      const auto p = partition->getCacheMemoryStats();
+      stats.ramCacheSize += p.ramCacheSize;
+      stats.configuredRamCacheSize += p.configuredRamCacheSize;
+      stats.configuredRamCacheRegularSize += p.configuredRamCacheRegularSize;
+      stats.configuredRamCacheCompactSize += p.configuredRamCacheCompactSize;
+      stats.advisedSize += p.advisedSize;
+      stats.maxAdvisedPct = std::max(stats.maxAdvisedPct, p.maxAdvisedPct);
+      stats.unReservedSize += p.unReservedSize;
+      stats.nvmCacheSize += p.nvmCacheSize;
+      stats.memAvailableSize = p.memAvailableSize;
+      stats.memRssSize = p.memRssSize;
+    }
+    return stats;
+  }
+
+  // @return the number of slabs the partition advises away to stay within
+  //         the budget
+  size_t getNumSlabsToAdvise(uint32_t idx) const {
+    std::lock_guard<std::mutex> l(rebalanceMutex_);
+    return advisedSlabs_.at(idx);
+  }
+
+  // @return the number of slabs moved between partitions so far
+  uint64_t getNumSlabsMoved() const noexcept {
+    return numSlabsMoved_.load(std::memory_order_relaxed);
+  }
+
+  // Move up to slabsPerRebalance slabs of the budget from the partition that
+  // evicted the least since the previous call to the one that evicted the
+  // most, if that one has slabs advised away.
+  //
+  // @return the number of slabs moved
+  uint32_t rebalance() {
+    if (config_.memoryBudget == 0 || partitions_.size() < 2) {
+      return 0;
+    }
+
+    std::lock_guard<std::mutex> l(rebalanceMutex_);
+    size_t donor = 0;
+    size_t receiver = 0;
+    std::vector<uint64_t> evictions(partitions_.size());
+    for (size_t i = 0; i < partitions_.size(); i++) {
+      const auto total = getNumEvictions(*partitions_[i]);
+      evictions[i] = total - std::min(total, lastEvictions_[i]);
+      lastEvictions_[i] = total;
+      if (evictions[i] < evictions[donor]) {
+        donor = i;
+      }
+      if (evictions[i] > evictions[receiver]) {
+        receiver = i;
+      }
+    }
+    if (evictions[receiver] == evictions[donor]) {
+      return 0;
+    }
+
+    const auto donorRoom = maxAdvisedSlabs_[donor] -
+                           std::min(maxAdvisedSlabs_[donor],
+                                    advisedSlabs_[donor]);
+    const auto numSlabs = static_cast<uint32_t>(
+        std::min<size_t>({config_.slabsPerRebalance, donorRoom,
+                          advisedSlabs_[receiver]}));
+    if (numSlabs == 0) {
+      return 0;
+    }
+
+    // advise away the slabs of the donor before the receiver gets them
+    partitions_[donor]->updateNumSlabsToAdvise(numSlabs);
+    partitions_[receiver]->updateNumSlabsToAdvise(-static_cast<int32_t>(
+        numSlabs));
+    advisedSlabs_[donor] += numSlabs;
+    advisedSlabs_[receiver] -= numSlabs;
+    numSlabsMoved_.fetch_add(numSlabs, std::memory_order_relaxed);
+    XLOGF(DBG, "Moved {} slabs of the memory budget from partition {} to {}",
+          numSlabs, donor, receiver);
+    return numSlabs;
+  }
+
+ private:
+  // interval of the memory monitors that advise away and reclaim the slabs
+  // of the partitions
+  static constexpr std::chrono::milliseconds kAdviseInterval{1000};
+
+  class Rebalancer : public PeriodicWorker {
+   public:
+    explicit Rebalancer(PartitionedCache& cache) : cache_(cache) {}
+
+    ~Rebalancer() override { stop(); }
+
+   private:
+    void work() final { cache_.rebalance(); }
+
+    PartitionedCache& cache_;
+  };
+
+  static uint64_t getNumEvictions(CacheT& cache) {
+    uint64_t evictions = 0;
+    for (const auto pid : cache.getRegularPoolIds()) {
+      evictions += cache.getPoolStats(pid).numEvictions();
+    }
+    return evictions;
+  }
+
+  // advise away the slabs of every partition above its share of the budget
+  void initBudget() {
+    const auto shareSlabs =
+        config_.memoryBudget / Slab::kSize / partitions_.size();
+    for (size_t i = 0; i < partitions_.size(); i++) {
+      const auto slabs =
+          partitions_[i]->getCacheMemoryStats().configuredRamCacheSize /
+          Slab::kSize;
+      if (slabs < shareSlabs) {
+        throw std::invalid_argument(folly::sformat(
+            "Partition {} has {} slabs, less than its share of {} slabs of "
+            "the memory budget",
+            i, slabs, shareSlabs));
+      }
+      advisedSlabs_[i] = slabs - shareSlabs;
+      maxAdvisedSlabs_[i] =
+          slabs - shareSlabs * config_.minSharePercent / 100;
+      if (advisedSlabs_[i] > 0) {
+        partitions_[i]->updateNumSlabsToAdvise(
+            static_cast<int32_t>(advisedSlabs_[i]));
+      }
+    }
+  }
+
+  const PartitionedCacheConfig config_;
+
+  std::vector<std::unique_ptr<CacheT>> partitions_;
+
+  // slabs each partition advises away, the most it may advise away and its
+  // evictions as of the previous rebalance
+  mutable std::mutex rebalanceMutex_;
+  std::vector<size_t> advisedSlabs_;
+  std::vector<size_t> maxAdvisedSlabs_;
+  std::vector<uint64_t> lastEvictions_;
+
+  std::atomic<uint64_t> numSlabsMoved_{0};
+
+  // stopped before the partitions are destroyed
+  std::unique_ptr<Rebalancer> rebalancer_;
+};
+
+} // namespace cachelib
+} // namespace facebook
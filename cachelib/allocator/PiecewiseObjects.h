@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/allocator/memory/Slab.h"
+#include "cachelib/common/CompilerUtils.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Objects, such as the bodies served for CDN range requests, stored as fixed
+// size pieces that are cached and read independently.
+//
+// The object is a header item under its own key that holds its size, the
+// size of its pieces, a random id and a bitmap of the pieces inserted so far.
+// Each piece is an item whose key is a short binary prefix, the id and the
+// index of the piece, instead of a string built from the key of the object.
+// A range read finds the header, then looks up only the pieces of the range
+// that the bitmap has, in a single batch that also goes to the nvm cache.
+//
+// Pieces are evicted independently of the header, so the bitmap is a hint:
+// a piece it has may be missing, but a piece it does not have was never
+// inserted for this version of the object. Replacing an object gives it a new
+// id, which orphans the pieces of the previous version until they are
+// evicted.
+template <typename CacheT>
+class PiecewiseObjects {
+ public:
+  using Item = typename CacheT::Item;
+  using Key = typename Item::Key;
+  using ReadHandle = typename CacheT::ReadHandle;
+  using WriteHandle = typename CacheT::WriteHandle;
+
+  // value of the header item, followed by the bitmap of the inserted pieces.
+  // The payload of an item is not necessarily aligned.
+  struct CACHELIB_PACKED_ATTR Header {
+    uint64_t magic;
+    uint64_t id;
+    uint64_t objectSize;
+    uint32_t pieceSize;
+    uint32_t numPieces;
+  };
+
+  static constexpr uint64_t kMagic = 0x5069656365576973; // "PieceWis"
+
+  // piece keys are the prefix, the id of the object and the index of the
+  // piece. The prefix starts with a nul byte to stay clear of text keys.
+  static constexpr size_t kPieceKeyPrefixSize = 3;
+  static constexpr size_t kPieceKeySize =
+      kPieceKeyPrefixSize + sizeof(uint64_t) + sizeof(uint32_t);
+  using PieceKey = std::array<char, kPieceKeySize>;
+
+  // the pieces of a range read, in the order of the object
+  struct Range {
+    // header of the object, nullptr if the object is not cached
+    ReadHandle header;
+
+    // the range that was read, within the object
+    uint64_t offset{0};
+    uint64_t length{0};
+
+    // index of the first piece of the range
+    uint32_t firstPiece{0};
+
+    // a handle per piece of the range, nullptr for the pieces not cached
+    std::vector<ReadHandle> pieces;
+
+    // @return true if every byte of the range is cached
+    bool isComplete() const {
+      return header != nullptr &&
+             std::all_of(pieces.begin(), pieces.end(),
+                         [](const ReadHandle& h) { return h != nullptr; });
+    }
+
+    // @return the indexes of the pieces of the range that are not cached,
+    //         to be fetched and inserted by the caller
+    std::vector<uint32_t> getMissingPieces() const {
+      std::vector<uint32_t> missing;
+      for (size_t i = 0; i < pieces.size(); i++) {
+        if (!pieces[i]) {
+          missing.push_back(firstPiece + static_cast<uint32_t>(i));
+        }
+      }
+      return missing;
+    }
+
+    // copy the range into dst, which must hold length bytes
+    //
+    // @throw std::logic_error if the range is not complete
+    void copyTo(void* dst) const {
+      auto* out = reinterpret_cast<uint8_t*>(dst);
+      forEachPiece([&](const uint8_t* data, size_t size) {
+        std::memcpy(out, data, size);
+        out += size;
+      });
+    }
+
+    // @return the range as a chain of IOBufs over the memory of the pieces.
+    //         Each IOBuf holds a handle to its piece.
+    //
+    // @throw std::logic_error if the range is not complete
+    std::unique_ptr<folly::IOBuf> toIOBuf() const {
+      std::unique_ptr<folly::IOBuf> head;
+      size_t i = 0;
+      forEachPiece([&](const uint8_t* data, size_t size) {
+        auto buf = folly::IOBuf::takeOwnership(
+            const_cast<uint8_t*>(data), size,
+            [](void*, void* userData) {
+              delete reinterpret_cast<ReadHandle*>(userData);
+            } /* freeFunc */,
+            new ReadHandle{pieces[i++].clone()} /* userData for freeFunc */);
+        buf->markExternallySharedOne();
+        if (head) {
+          head->prependChain(std::move(buf));
+        } else {
+          head = std::move(buf);
+        }
+      });
+      return head;
+    }
+
+   private:
+    // call fn with the bytes of the range in each piece
+    template <typename Fn>
+    void forEachPiece(Fn&& fn) const {
+      if (!isComplete()) {
+        throw std::logic_error("Range has pieces that are not cached");
+      }
+      const uint64_t pieceSize = getHeader(*header)->pieceSize;
+      uint64_t pos = offset;
+      const uint64_t end = offset + length;
+      for (const auto& piece : pieces) {
+        const uint64_t skip = pos % pieceSize;
+        const uint64_t size = std::min<uint64_t>(piece->getSize() - skip,
+                                                 end - pos);
+        fn(reinterpret_cast<const uint8_t*>(piece->getMemory()) + skip,
+           static_cast<size_t>(size));
+        pos += size;
+      }
+    }
+  };
+
+  explicit PiecewiseObjects(CacheT& cache) : cache_(cache) {}
+
+  // create the header of an object, in place of any previous version of the
+  // object. Its pieces are inserted afterwards through insertPiece().
+  //
+  // @param pid         pool of the header and the pieces
+  // @param key         key of the object
+  // @param objectSize  size of the object
+  // @param pieceSize   size of every piece but the last one
+  // @param ttlSecs     time to live of the header and the pieces
+  //
+  // @return the header, nullptr if it could not be allocated
+  // @throw std::invalid_argument if the sizes are invalid
+  WriteHandle create(PoolId pid,
+                     Key key,
+                     uint64_t objectSize,
+                     uint32_t pieceSize,
+                     uint32_t ttlSecs = 0) {
+    if (objectSize == 0 || pieceSize == 0 ||
+        (objectSize - 1) / pieceSize >= std::numeric_limits<uint32_t>::max()) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid piecewise object of {} bytes with pieces of {} bytes",
+          objectSize, pieceSize));
+    }
+    const auto numPieces =
+        static_cast<uint32_t>((objectSize - 1) / pieceSize + 1);
+    auto header = cache_.allocate(
+        pid, key,
+        static_cast<uint32_t>(sizeof(Header) + getBitmapSize(numPieces)),
+        ttlSecs);
+    if (!header) {
+      return header;
+    }
+    Header h{kMagic, folly::Random::rand64(), objectSize, pieceSize,
+             numPieces};
+    auto* mem = reinterpret_cast<uint8_t*>(header->getMemory());
+    std::memcpy(mem, &h, sizeof(h));
+    std::memset(mem + sizeof(h), 0, getBitmapSize(numPieces));
+    cache_.insertOrReplace(header);
+    return header;
+  }
+
+  // @return the header of the object to insert its pieces, nullptr if the
+  //         object is not cached
+  WriteHandle findToWrite(Key key) {
+    auto header = cache_.findToWrite(key);
+    if (header && !getHeader(*header)) {
+      return WriteHandle{};
+    }
+    return header;
+  }
+
+  // insert a piece of an object
+  //
+  // @param header  header of the object
+  // @param index   index of the piece
+  // @param data    the piece, as large as the pieces of the object or the
+  //                rest of the object for the last piece
+  //
+  // @return false if the piece could not be allocated
+  // @throw std::invalid_argument if the header, index or size is invalid
+  bool insertPiece(const WriteHandle& header,
+                   uint32_t index,
+                   folly::ByteRange data) {
+    const auto* h = header ? getHeader(*header) : nullptr;
+    if (!h || index >= h->numPieces ||
+        data.size() != getPieceSize(*h, index)) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid piece {} of {} bytes", index, data.size()));
+    }
+
+    const auto key = makePieceKey(h->id, index);
+    auto piece = cache_.allocate(
+        cache_.getAllocInfo(header->getMemory()).poolId,
+        Key{key.data(), key.size()}, static_cast<uint32_t>(data.size()),
+        static_cast<uint32_t>(header->getConfiguredTTL().count()));
+    if (!piece) {
+      return false;
+    }
+    std::memcpy(piece->getMemory(), data.data(), data.size());
+    cache_.insertOrReplace(piece);
+
+    auto* bitmap =
+        reinterpret_cast<uint8_t*>(header->getMemory()) + sizeof(Header);
+    __atomic_fetch_or(&bitmap[index / 8], getPieceBit(index),
+                      __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // read a range of an object. Only the pieces of the range that were
+  // inserted are looked up, together, in dram and then in the nvm cache.
+  //
+  // @param key     key of the object
+  // @param offset  first byte of the range
+  // @param length  size of the range, trimmed to the end of the object
+  //
+  // @return the pieces of the range. The header is nullptr if the object is
+  //         not cached, and so is every piece that is not cached.
+  // @throw std::invalid_argument if the range starts past the end of the
+  //        object
+  Range read(Key key, uint64_t offset, uint64_t length) {
+    Range range;
+    range.header = cache_.find(key);
+    const auto* h = range.header ? getHeader(*range.header) : nullptr;
+    if (!h) {
+      range.header.reset();
+      return range;
+    }
+    if (offset >= h->objectSize || length == 0) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid range of {} bytes at {} of an object of {} bytes", length,
+          offset, h->objectSize));
+    }
+
+    range.offset = offset;
+    range.length = std::min(length, h->objectSize - offset);
+    range.firstPiece = static_cast<uint32_t>(offset / h->pieceSize);
+    const auto lastPiece = static_cast<uint32_t>(
+        (offset + range.length - 1) / h->pieceSize);
+    range.pieces.resize(lastPiece - range.firstPiece + 1);
+
+    const auto* bitmap =
+        reinterpret_cast<const uint8_t*>(range.header->getMemory()) +
+        sizeof(Header);
+    std::vector<PieceKey> pieceKeys;
+    std::vector<Key> keys;
+    std::vector<uint32_t> slots;
+    for (uint32_t i = range.firstPiece; i <= lastPiece; i++) {
+      if (hasPiece(bitmap, i)) {
+        pieceKeys.push_back(makePieceKey(h->id, i));
+        slots.push_back(i - range.firstPiece);
+      }
+    }
+    for (const auto& pieceKey : pieceKeys) {
+      keys.emplace_back(pieceKey.data(), pieceKey.size());
+    }
+
+    auto found = cache_.findBatch(folly::range(keys));
+    for (size_t i = 0; i < found.size(); i++) {
+      auto& piece = found[i];
+      piece.wait();
+      // a piece of the wrong size belongs to an object whose id collided
+      if (piece &&
+          piece->getSize() == getPieceSize(*h, range.firstPiece + slots[i])) {
+        range.pieces[slots[i]] = std::move(piece);
+      }
+    }
+    return range;
+  }
+
+  // remove an object and the pieces it has
+  //
+  // @return false if the object was not cached
+  bool remove(Key key) {
+    auto header = cache_.find(key);
+    const auto* h = header ? getHeader(*header) : nullptr;
+    if (!h) {
+      return false;
+    }
+    const auto* bitmap =
+        reinterpret_cast<const uint8_t*>(header->getMemory()) + sizeof(Header);
+    for (uint32_t i = 0; i < h->numPieces; i++) {
+      if (hasPiece(bitmap, i)) {
+        const auto pieceKey = makePieceKey(h->id, i);
+        cache_.remove(Key{pieceKey.data(), pieceKey.size()});
+      }
+    }
+    cache_.remove(header);
+    return true;
+  }
+
+  // @return the header of a piecewise object stored in the item, nullptr if
+  //         the item is not one
+  static const Header* getHeader(const Item& item) {
+    if (item.getSize() < sizeof(Header)) {
+      return nullptr;
+    }
+    const auto* h = reinterpret_cast<const Header*>(item.getMemory());
+    if (h->magic != kMagic || h->numPieces == 0 ||
+        item.getSize() != sizeof(Header) + getBitmapSize(h->numPieces)) {
+      return nullptr;
+    }
+    return h;
+  }
+
+  // @return the key of a piece of the object with that id
+  static PieceKey makePieceKey(uint64_t id, uint32_t index) {
+    PieceKey key{'\0', 'p', 'w'};
+    std::memcpy(key.data() + kPieceKeyPrefixSize, &id, sizeof(id));
+    std::memcpy(key.data() + kPieceKeyPrefixSize + sizeof(id), &index,
+                sizeof(index));
+    return key;
+  }
+
+ private:
+  static size_t getBitmapSize(uint32_t numPieces) noexcept {
+    return (static_cast<size_t>(numPieces) + 7) / 8;
+  }
+
+  static uint8_t getPieceBit(uint32_t index) noexcept {
+    return static_cast<uint8_t>(1 << (index % 8));
+  }
+
+  static bool hasPiece(const uint8_t* bitmap, uint32_t index) noexcept {
+    return __atomic_load_n(&bitmap[index / 8], __ATOMIC_ACQUIRE) &
+           getPieceBit(index);
+  }
+
+  static uint64_t getPieceSize(const Header& h, uint32_t index) noexcept {
+    return index + 1 < h.numPieces
+               ? h.pieceSize
+               : h.objectSize - static_cast<uint64_t>(index) * h.pieceSize;
+  }
+
+  CacheT& cache_;
+};
+
+} // namespace cachelib
+} // namespace facebook
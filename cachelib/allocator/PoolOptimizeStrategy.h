@@ -42,7 +42,7 @@ class PoolOptimizeStrategy {
   struct BaseConfig {};
   virtual void updateConfig(const BaseConfig&) {}
 
-  enum Type { PickNothingOrTest, MarginalHits, NumTypes };
+  enum Type { PickNothingOrTest, MarginalHits, PredictedHits, NumTypes };
   explicit PoolOptimizeStrategy(Type strategyType = PickNothingOrTest)
       : type_(strategyType) {}
   virtual ~PoolOptimizeStrategy() = default;
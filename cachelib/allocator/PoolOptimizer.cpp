@@ -34,10 +34,23 @@ void PoolOptimizer::optimizeRegularPoolSizes() {
     if (context.victimPoolId == Slab::kInvalidPoolId ||
         context.receiverPoolId == Slab::kInvalidPoolId) {
       XLOG(DBG, "Cannot find victim and receiver for pool optimization");
+    } else if (cache_.getPoolSloHint(context.victimPoolId).weight >
+               cache_.getPoolSloHint(context.receiverPoolId).weight) {
+      // memory is not taken from a latency sensitive pool for a pool that
+      // is less so
+      XLOG(DBG, "Not moving a slab from Pool {} to Pool {} of a lower weight",
+           static_cast<int>(context.victimPoolId),
+           static_cast<int>(context.receiverPoolId));
     } else {
       const auto memoryToMove = Slab::kSize;
       cache_.resizePools(context.victimPoolId, context.receiverPoolId,
                          memoryToMove);
+      // the strategy may rank compact caches with the regular pools
+      const auto ccachePools = cache_.getCCachePoolIds();
+      if (ccachePools.count(context.victimPoolId) ||
+          ccachePools.count(context.receiverPoolId)) {
+        cache_.resizeCompactCaches();
+      }
       XLOG(DBG, "Moving a slab from Pool {} to Pool {}",
            static_cast<int>(context.victimPoolId),
            static_cast<int>(context.receiverPoolId));
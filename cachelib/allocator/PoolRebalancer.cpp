@@ -16,40 +16,146 @@
 
 #include "cachelib/allocator/PoolRebalancer.h"
 
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+#include <atomic>
 #include <stdexcept>
-#include <thread>
+
+#include "cachelib/common/CountDownLatch.h"
 
 namespace facebook::cachelib {
 
 PoolRebalancer::PoolRebalancer(CacheBase& cache,
                                std::shared_ptr<RebalanceStrategy> strategy,
-                               unsigned int freeAllocThreshold)
+                               unsigned int freeAllocThreshold,
+                               unsigned int numThreads)
     : cache_(cache),
       defaultStrategy_(std::move(strategy)),
-      freeAllocThreshold_(freeAllocThreshold) {
+      freeAllocThreshold_(freeAllocThreshold),
+      numThreads_(std::max(numThreads, 1u)) {
   if (!defaultStrategy_) {
     throw std::invalid_argument("The default rebalance strategy is not set.");
   }
+  if (numThreads_ > 1) {
+    releaseExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        numThreads_ - 1,
+        std::make_shared<folly::NamedThreadFactory>("PoolRebalancer"));
+  }
 }
 
 PoolRebalancer::~PoolRebalancer() { stop(std::chrono::seconds(0)); }
 
 void PoolRebalancer::work() {
   try {
+    if (numThreads_ == 1) {
+      for (const auto pid : cache_.getRegularPoolIds()) {
+        auto strategy = cache_.getRebalanceStrategy(pid);
+        if (!strategy) {
+          strategy = defaultStrategy_;
+        }
+        tryRebalancing(pid, *strategy);
+      }
+      return;
+    }
+
+    // The strategies keep state that is not thread safe, so the picks are
+    // serial and only the releases run concurrently
+    std::vector<PendingRelease> releases;
     for (const auto pid : cache_.getRegularPoolIds()) {
       auto strategy = cache_.getRebalanceStrategy(pid);
       if (!strategy) {
         strategy = defaultStrategy_;
       }
-      tryRebalancing(pid, *strategy);
+      PendingRelease release;
+      if (pickRelease(pid, *strategy, release)) {
+        releases.push_back(release);
+      }
     }
+    releaseConcurrently(releases);
   } catch (const std::exception& ex) {
     XLOGF(ERR, "Rebalancing interrupted due to exception: {}", ex.what());
   }
 }
 
+bool PoolRebalancer::pickRelease(PoolId pid,
+                                 RebalanceStrategy& strategy,
+                                 PendingRelease& release) {
+  release.pid = pid;
+  release.beginMs = util::getCurrentTimeMs();
+
+  if (freeAllocThreshold_ > 0) {
+    auto ctx = pickVictimByFreeAlloc(pid);
+    if (ctx.victimClassId != Slab::kInvalidClassId) {
+      // the slab goes back to the pool, which then has free slabs and is
+      // not rebalanced by the strategy
+      release.ctx = ctx;
+      release.fromStrategy = false;
+      return true;
+    }
+  }
+
+  if (!cache_.getPool(pid).allSlabsAllocated()) {
+    return false;
+  }
+
+  const auto begin = util::getCurrentTimeMs();
+  const auto context = strategy.pickVictimAndReceiver(cache_, pid);
+  const auto end = util::getCurrentTimeMs();
+  pickVictimStats_.recordLoopTime(end > begin ? end - begin : 0);
+
+  if (context.victimClassId == Slab::kInvalidClassId) {
+    XLOGF(DBG,
+          "Pool Id: {} rebalancing strategy didn't find an victim",
+          static_cast<int>(pid));
+    return false;
+  }
+  release.ctx = context;
+  release.fromStrategy = true;
+  return true;
+}
+
+void PoolRebalancer::releaseConcurrently(
+    const std::vector<PendingRelease>& releases) {
+  std::atomic<size_t> next{0};
+  auto releaseAll = [&] {
+    for (auto i = next++; i < releases.size(); i = next++) {
+      const auto& release = releases[i];
+      try {
+        const auto begin = util::getCurrentTimeMs();
+        releaseSlab(release.pid, release.ctx.victimClassId,
+                    release.ctx.receiverClassId);
+        if (release.fromStrategy) {
+          const auto end = util::getCurrentTimeMs();
+          releaseStats_.recordLoopTime(end > begin ? end - begin : 0);
+          rebalanceStats_.recordLoopTime(
+              end > release.beginMs ? end - release.beginMs : 0);
+        }
+      } catch (const std::exception& ex) {
+        XLOGF(ERR, "Releasing a slab of pool {} failed: {}",
+              static_cast<int>(release.pid), ex.what());
+      }
+    }
+  };
+
+  if (releases.empty()) {
+    return;
+  }
+  const auto numHelpers = std::min<size_t>(numThreads_, releases.size()) - 1;
+  util::CountDownLatch done(static_cast<uint32_t>(numHelpers));
+  for (size_t i = 0; i < numHelpers; i++) {
+    // releaseAll() does not throw, so every helper counts down
+    releaseExecutor_->add([&] {
+      releaseAll();
+      done.count_down();
+    });
+  }
+  // the worker thread releases too
+  releaseAll();
+  done.wait();
+}
+
 void PoolRebalancer::releaseSlab(PoolId pid,
                                  ClassId victimClassId,
                                  ClassId receiverClassId) {
@@ -16,8 +16,12 @@
 
 #pragma once
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <gtest/gtest_prod.h>
 
+#include <memory>
+#include <vector>
+
 #include "cachelib/allocator/Cache.h"
 #include "cachelib/allocator/CacheStats.h"
 #include "cachelib/allocator/RebalanceStrategy.h"
@@ -34,6 +38,9 @@ namespace cachelib {
 // Else
 // 2. Find a victim and receiver pair according to the strategy and move a slab
 // from the victim class to the receiver class.
+//
+// With more than one thread, the slabs of all the pools are picked first and
+// then released concurrently, since releasing a slab is the slow part.
 class PoolRebalancer : public PeriodicWorker {
  public:
   // @param cache               the cache interface
@@ -42,9 +49,12 @@ class PoolRebalancer : public PeriodicWorker {
   // is calculated by the number of total free allocations divided by the number
   // of allocations in a slab. Only allocation classes with a higher
   // free-alloc-slab could get picked as a victim.
+  // @param numThreads          number of slabs of different pools released
+  // concurrently.
   PoolRebalancer(CacheBase& cache,
                  std::shared_ptr<RebalanceStrategy> strategy,
-                 unsigned int freeAllocThreshold);
+                 unsigned int freeAllocThreshold,
+                 unsigned int numThreads = 1);
 
   ~PoolRebalancer() override;
 
@@ -96,6 +106,29 @@ class PoolRebalancer : public PeriodicWorker {
   RebalanceContext pickVictimByFreeAlloc(PoolId pid) const;
 
   void releaseSlab(PoolId pid, ClassId victim, ClassId receiver);
+
+  // a slab picked for release by a run
+  struct PendingRelease {
+    PoolId pid;
+    RebalanceContext ctx;
+    // whether the rebalancing strategy picked it
+    bool fromStrategy;
+    // time the pick started
+    uint64_t beginMs;
+  };
+
+  // Picks the slab to release in @pid the same way tryRebalancing() does,
+  // without releasing it.
+  //
+  // @return true if a slab was picked into @release
+  bool pickRelease(PoolId pid,
+                   RebalanceStrategy& strategy,
+                   PendingRelease& release);
+
+  // Releases the slabs of @releases with up to numThreads_ threads: the
+  // worker thread and those of releaseExecutor_.
+  void releaseConcurrently(const std::vector<PendingRelease>& releases);
+
   // cache allocator's interface for rebalancing
   CacheBase& cache_;
 
@@ -106,6 +139,13 @@ class PoolRebalancer : public PeriodicWorker {
   // of free allocs to number of allocs per slab.
   unsigned int freeAllocThreshold_;
 
+  // number of slabs released concurrently
+  const unsigned int numThreads_;
+
+  // threads that release slabs along with the worker thread, numThreads_ - 1
+  // of them. Kept across runs so that a run does not start and join threads.
+  std::unique_ptr<folly::CPUThreadPoolExecutor> releaseExecutor_;
+
   // slab release stats for this rebalancer.
   ReleaseStats stats_;
 
@@ -18,6 +18,10 @@
 
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "cachelib/allocator/PoolResizeStrategy.h"
 #include "cachelib/common/Exceptions.h"
 
@@ -38,7 +42,14 @@ PoolResizer::~PoolResizer() { stop(std::chrono::seconds(0)); }
 
 void PoolResizer::work() {
   const auto pools = cache_.getRegularPoolIdsForResize();
+  // shrink the pools of lower weights first, since a release may abort the
+  // iteration
+  std::vector<std::pair<uint32_t, PoolId>> poolsByWeight;
   for (auto poolId : pools) {
+    poolsByWeight.emplace_back(cache_.getPoolSloHint(poolId).weight, poolId);
+  }
+  std::sort(poolsByWeight.begin(), poolsByWeight.end());
+  for (const auto& [weight, poolId] : poolsByWeight) {
     const PoolStats poolStats = cache_.getPoolStats(poolId);
     for (unsigned int i = 0; i < numSlabsPerIteration_; i++) {
       // check if the pool still needs resizing after each iteration.
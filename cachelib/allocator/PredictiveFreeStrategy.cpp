@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/PredictiveFreeStrategy.h"
+
+#include <folly/Format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace facebook::cachelib {
+
+PredictiveFreeStrategy::PredictiveFreeStrategy(Config config)
+    : config_(std::move(config)) {
+  if (!(config_.ewmaWeight > 0 && config_.ewmaWeight <= 1) ||
+      config_.headroom < 1 || config_.headroomStep < 0 ||
+      config_.maxHeadroom < config_.headroom || config_.minBatch == 0 ||
+      config_.maxBatch < config_.minBatch) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid predictive free strategy config. ewma weight: {}, headroom: "
+        "{}, headroom step: {}, max headroom: {}, min batch: {}, max batch: {}",
+        config_.ewmaWeight, config_.headroom, config_.headroomStep,
+        config_.maxHeadroom, config_.minBatch, config_.maxBatch));
+  }
+}
+
+std::vector<size_t> PredictiveFreeStrategy::calculateBatchSizes(
+    const CacheBase& cache, std::vector<MemoryDescriptorType> acVec) {
+  const auto now = Clock::now();
+  // the stats of a pool are computed once for all its classes
+  std::unordered_map<PoolId, PoolStats> poolStats;
+  std::unordered_map<PoolId, double> minFreeAllocPcts;
+  std::vector<size_t> batches;
+  batches.reserve(acVec.size());
+
+  std::lock_guard<std::mutex> l(mutex_);
+  for (const auto& desc : acVec) {
+    const auto pid = desc.pid_;
+    const auto cid = desc.cid_;
+    auto it = poolStats.find(pid);
+    if (it == poolStats.end()) {
+      it = poolStats.emplace(pid, cache.getPoolStats(pid)).first;
+      minFreeAllocPcts[pid] = cache.getPoolSloHint(pid).minFreeAllocPct;
+    }
+    const auto& stats = it->second;
+    const auto& classStats = stats.cacheStats.at(cid);
+    const auto& acStats = stats.mpStats.acStats.at(cid);
+
+    // the class can also carve its allocations out of the free slabs of the
+    // pool without evicting
+    const auto poolFreeSlabs =
+        stats.mpStats.freeSlabs + stats.mpStats.slabsUnAllocated;
+    const uint64_t freeAllocs =
+        acStats.freeAllocs +
+        (acStats.freeSlabs + poolFreeSlabs) * acStats.allocsPerSlab;
+    const auto minFreeAllocs = static_cast<uint64_t>(
+        std::ceil(minFreeAllocPcts[pid] / 100 *
+                  static_cast<double>(acStats.totalSlabs() *
+                                      acStats.allocsPerSlab)));
+
+    batches.push_back(updateAndGetBatch(
+        states_[{pid, cid}], classStats.allocAttempts,
+        classStats.numEvictions(), freeAllocs, minFreeAllocs, now));
+  }
+  return batches;
+}
+
+size_t PredictiveFreeStrategy::updateAndGetBatch(ClassState& state,
+                                                 uint64_t allocAttempts,
+                                                 uint64_t evictions,
+                                                 uint64_t freeAllocs,
+                                                 uint64_t minFreeAllocs,
+                                                 Clock::time_point now) {
+  auto getBatch = [this, freeAllocs](uint64_t target) -> size_t {
+    if (target <= freeAllocs) {
+      return 0;
+    }
+    return std::clamp(target - freeAllocs, config_.minBatch,
+                      config_.maxBatch);
+  };
+
+  if (state.time == Clock::time_point{}) {
+    // nothing to forecast from before the first run
+    state = {allocAttempts, evictions, now, 0, 0, config_.headroom, 0};
+    state.lastBatch = getBatch(minFreeAllocs);
+    return state.lastBatch;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(now - state.time).count();
+  const auto allocs = allocAttempts - std::min(allocAttempts,
+                                               state.allocAttempts);
+  const auto evicted = evictions - std::min(evictions, state.evictions);
+  if (seconds > 0) {
+    const double weight = state.interval > 0 ? config_.ewmaWeight : 1.0;
+    state.allocRate =
+        weight * static_cast<double>(allocs) / seconds +
+        (1 - weight) * state.allocRate;
+    state.interval = weight * seconds + (1 - weight) * state.interval;
+  }
+
+  // evictions beyond the batch of the previous run were foreground ones: the
+  // forecast fell short
+  if (evicted > state.lastBatch) {
+    state.headroom =
+        std::min(config_.maxHeadroom, state.headroom + config_.headroomStep);
+  } else {
+    state.headroom = std::max(config_.headroom,
+                              state.headroom - config_.headroomStep / 2);
+  }
+
+  state.allocAttempts = allocAttempts;
+  state.evictions = evictions;
+  state.time = now;
+
+  const auto target = std::max(
+      minFreeAllocs, static_cast<uint64_t>(std::ceil(
+                         state.allocRate * state.interval * state.headroom)));
+  state.lastBatch = getBatch(target);
+  return state.lastBatch;
+}
+
+} // namespace facebook::cachelib
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "cachelib/allocator/BackgroundMoverStrategy.h"
+#include "cachelib/allocator/Cache.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Background eviction strategy sizing every batch from the allocations an
+// allocation class is expected to serve before the evictor runs again.
+//
+// The allocation rate and the time between two runs of every class are
+// tracked with an exponentially weighted moving average. A batch evicts just
+// enough items for the free allocations of the class, counting the free
+// slabs it could grab, to cover the forecast with some headroom. Classes
+// with enough free memory evict nothing, so items are not evicted long before
+// their memory is needed, and a class whose allocations still evicted in the
+// foreground since the previous run raises its headroom until they stop.
+// Classes of a pool with a PoolSloHint also keep at least the free
+// allocations of the hint.
+class PredictiveFreeStrategy : public BackgroundMoverStrategy {
+ public:
+  struct Config {
+    // Weight of the latest interval in the moving averages, in (0, 1]
+    double ewmaWeight{0.3};
+
+    // Free allocations kept as a multiple of the forecast allocations
+    double headroom{1.2};
+
+    // Headroom is raised by this much after an interval with foreground
+    // evictions, up to maxHeadroom, and decays back to headroom otherwise
+    double headroomStep{0.2};
+    double maxHeadroom{4.0};
+
+    // Bounds on a non empty batch
+    uint64_t minBatch{1};
+    uint64_t maxBatch{1000};
+
+    Config() noexcept {}
+  };
+
+  // @throw std::invalid_argument if the config is invalid
+  explicit PredictiveFreeStrategy(Config config = {});
+  ~PredictiveFreeStrategy() override {}
+
+  std::vector<size_t> calculateBatchSizes(
+      const CacheBase& cache, std::vector<MemoryDescriptorType> acVec) override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct ClassState {
+    // cumulative stats of the class at the previous run
+    uint64_t allocAttempts{0};
+    uint64_t evictions{0};
+    Clock::time_point time{};
+
+    // moving averages of the allocations per second and of the seconds
+    // between two runs
+    double allocRate{0};
+    double interval{0};
+
+    // current multiple of the forecast kept free
+    double headroom{0};
+
+    // items asked to evict at the previous run. Evictions beyond it were
+    // done by the foreground allocations.
+    size_t lastBatch{0};
+  };
+
+  // @return  number of items to evict for a class whose state was @state
+  //          with @allocAttempts and @evictions so far, and room for
+  //          @freeAllocs allocations without evicting, out of at least
+  //          @minFreeAllocs
+  size_t updateAndGetBatch(ClassState& state,
+                           uint64_t allocAttempts,
+                           uint64_t evictions,
+                           uint64_t freeAllocs,
+                           uint64_t minFreeAllocs,
+                           Clock::time_point now);
+
+  const Config config_;
+
+  // protects states_; the strategy is shared by the evictor threads
+  std::mutex mutex_;
+  std::map<std::pair<PoolId, ClassId>, ClassState> states_;
+};
+
+} // namespace cachelib
+} // namespace facebook
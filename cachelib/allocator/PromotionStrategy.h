@@ -33,9 +33,12 @@ class PromotionStrategy : public BackgroundMoverStrategy {
         minPromotionBatch(minPromotionBatch) {}
   ~PromotionStrategy() {}
 
+  // Promotions are driven by the items queued on hits in the lower memory
+  // tier, so every class gets the full batch and only moves what is queued.
   std::vector<size_t> calculateBatchSizes(
-      const CacheBase& cache, std::vector<MemoryDescriptorType> acVec) {
-    return {};
+      const CacheBase& /* cache */,
+      std::vector<MemoryDescriptorType> acVec) override {
+    return std::vector<size_t>(acVec.size(), maxPromotionBatch);
   }
 
  private:
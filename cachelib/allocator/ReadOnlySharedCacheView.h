@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -25,15 +27,35 @@
 #pragma GCC diagnostic pop
 
 #include "cachelib/allocator/CacheDetails.h"
+#include "cachelib/allocator/ChainedHashTable.h"
+#include "cachelib/allocator/memory/Slab.h"
+#include "cachelib/allocator/memory/SlabAllocator.h"
 #include "cachelib/shm/ShmManager.h"
 
 namespace facebook {
 namespace cachelib {
 
 // used as a read only into a shared cache. The cache is owned by another
-// process and we peek into the items in the cache based on their offsets.
+// process and we peek into the items in the cache based on their offsets, or
+// look them up by key through the access container without taking any lock.
 class ReadOnlySharedCacheView {
  public:
+  // outcome of find()
+  enum class LookupResult {
+    kFound,
+    kNotFound,
+    // the owner kept changing the item or its hash chain under the lookup.
+    // The caller can retry or fall back to asking the owner.
+    kConflict,
+  };
+
+  // number of times find() retries a lookup that raced with the owner
+  static constexpr unsigned int kDefaultLookupAttempts = 3;
+
+  // longest hash chain find() walks before assuming it is reading a chain
+  // that is being modified
+  static constexpr size_t kMaxLookupHops = 1024;
+
   // tries to attach to an existing cache with the cacheDir if present under
   // the correct shm mode.
   //
@@ -50,7 +72,18 @@ class ReadOnlySharedCacheView {
                                    bool usePosixShm,
                                    void* addr = nullptr)
       : shm_(ShmManager::attachShmReadOnly(
-            cacheDir, detail::kShmCacheName, usePosixShm, addr)) {}
+            cacheDir, detail::kShmCacheName, usePosixShm, addr)),
+        hashTableShm_(ShmManager::attachShmReadOnly(
+            cacheDir, detail::kShmHashTableName, usePosixShm)) {
+    // same layout as the SlabAllocator of the owner: the slab headers are
+    // followed by the slabs, both aligned to the slab size.
+    const auto mapping = shm_->getCurrentMapping();
+    const auto numSlabs = mapping.size / Slab::kSize;
+    numSlabs_ = SlabAllocator::getNumUsableSlabs(mapping.size);
+    slabHeaders_ = reinterpret_cast<const SlabHeader*>(mapping.addr);
+    slabMemoryStart_ = reinterpret_cast<const uint8_t*>(mapping.addr) +
+                       (numSlabs - numSlabs_) * Slab::kSize;
+  }
 
   // returns the absolute address at which the shared memory mapping is mounted.
   // The caller can add a relative offset obtained from
@@ -83,9 +116,167 @@ class ReadOnlySharedCacheView {
                                    offset);
   }
 
+  // looks up the key in the access container of the cache and copies the
+  // value of its item into @value. No lock is taken and nothing is written
+  // to the cache, so the owner is not slowed down by the readers.
+  //
+  // Since the owner keeps changing the items, a lookup is validated the way
+  // a seqlock reader would be: the item must be accessible and hold the key
+  // both before and after its value is copied, with the same creation time,
+  // size and slab allocation size. Every pointer read from the cache is
+  // bounds checked against the mappings. A lookup that fails the validation
+  // is retried up to @maxAttempts times.
+  //
+  // Only the parent item is read, the chained items of a large value are
+  // not. Expired items are not found.
+  //
+  // @param key           the key to look up
+  // @param value         set to the value of the item when found
+  // @param accessConfig  the config of the access container of the cache.
+  //                      Its hasher and buckets power have to match those
+  //                      of the owner.
+  // @param maxAttempts   attempts for a lookup racing with the owner
+  //
+  // @throw std::invalid_argument if @accessConfig needs more buckets than
+  //        the hash table of the cache has.
+  template <typename CacheT>
+  LookupResult find(folly::StringPiece key,
+                    std::string& value,
+                    const ChainedHashTable::Config& accessConfig,
+                    unsigned int maxAttempts = kDefaultLookupAttempts) const {
+    static_assert(
+        std::is_same_v<typename CacheT::AccessType, ChainedHashTable>,
+        "lookups are only supported with the chained hash table");
+    using CompressedPtrType = typename CacheT::Item::CompressedPtrType;
+
+    const auto mapping = hashTableShm_->getCurrentMapping();
+    const auto numBuckets = mapping.size / sizeof(CompressedPtrType);
+    if (accessConfig.getMaxNumBuckets() > numBuckets) {
+      throw std::invalid_argument(
+          folly::sformat("Access config has {} buckets, the cache has {}",
+                         accessConfig.getMaxNumBuckets(), numBuckets));
+    }
+    const auto* buckets =
+        reinterpret_cast<const CompressedPtrType*>(mapping.addr);
+    const uint32_t hash = (*accessConfig.getHasher())(key.data(), key.size());
+
+    auto result = LookupResult::kConflict;
+    for (unsigned int i = 0;
+         i < maxAttempts && result == LookupResult::kConflict;
+         i++) {
+      result = LookupResult::kNotFound;
+      // a hash table that grows keeps the keys of the buckets that are not
+      // split yet in the lower half. Which buckets are split is only known
+      // to the owner, so every candidate is tried from the largest table.
+      size_t prevBucket = numBuckets;
+      for (auto power = accessConfig.getMaxBucketsPower();
+           power >= accessConfig.getBucketsPower() &&
+           result == LookupResult::kNotFound;
+           power--) {
+        const size_t bucket = hash & ((static_cast<size_t>(1) << power) - 1);
+        if (bucket != prevBucket) {
+          result = findInChain<CacheT>(buckets[bucket], key, value);
+          prevBucket = bucket;
+        }
+        if (power == 0) {
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
  private:
+  // returns the allocation of the compressed pointer and sets @allocSize to
+  // the size of the allocations in its slab. Returns nullptr if it does not
+  // point to an allocation in a slab that is in use.
+  template <typename CompressedPtrType>
+  const uint8_t* decode(CompressedPtrType ptr,
+                        uint32_t& allocSize) const noexcept {
+    const uint32_t slabIdx = ptr.getSlabIdx(false /* isMultiTiered */);
+    const uint32_t allocIdx = ptr.getAllocIdx();
+    if (slabIdx >= numSlabs_) {
+      return nullptr;
+    }
+    allocSize = slabHeaders_[slabIdx].allocSize;
+    if (allocSize == 0 ||
+        (static_cast<uint64_t>(allocIdx) + 1) * allocSize > Slab::kSize) {
+      return nullptr;
+    }
+    return slabMemoryStart_ + static_cast<size_t>(slabIdx) * Slab::kSize +
+           static_cast<size_t>(allocIdx) * allocSize;
+  }
+
+  // walks the hash chain starting at @head for the key, copying the value
+  // of its item into @value. See find().
+  template <typename CacheT>
+  LookupResult findInChain(typename CacheT::Item::CompressedPtrType head,
+                           folly::StringPiece key,
+                           std::string& value) const {
+    using Item = typename CacheT::Item;
+
+    // the key fits in the allocation of the item and matches
+    auto holdsKey = [key](const Item& item, const uint8_t* end) {
+      const auto itemKey = item.getKey();
+      return itemKey.size() == key.size() &&
+             reinterpret_cast<const uint8_t*>(itemKey.data()) + key.size() <=
+                 end &&
+             std::memcmp(itemKey.data(), key.data(), key.size()) == 0;
+    };
+
+    auto ptr = head;
+    for (size_t hops = 0; !ptr.isNull(); hops++) {
+      if (hops == kMaxLookupHops) {
+        return LookupResult::kConflict;
+      }
+      uint32_t allocSize = 0;
+      const uint8_t* alloc = decode(ptr, allocSize);
+      if (alloc == nullptr) {
+        // buckets that the owner never initialized do not hold a valid
+        // pointer. Past the head, the chain changed under the lookup.
+        return hops == 0 ? LookupResult::kNotFound : LookupResult::kConflict;
+      }
+      const auto& item = *reinterpret_cast<const Item*>(alloc);
+      const uint8_t* end = alloc + allocSize;
+      if (!holdsKey(item, end)) {
+        ptr = item.accessHook_.getHashNext();
+        continue;
+      }
+
+      const auto creationTime = item.getCreationTime();
+      const auto size = item.getSize();
+      const auto* memory = reinterpret_cast<const uint8_t*>(item.getMemory());
+      if (!item.isAccessible() || memory + size > end) {
+        return LookupResult::kConflict;
+      }
+      if (item.isExpired()) {
+        return LookupResult::kNotFound;
+      }
+      value.assign(reinterpret_cast<const char*>(memory), size);
+
+      // the copy has to complete before the item is checked again
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t newAllocSize = 0;
+      if (decode(ptr, newAllocSize) != alloc || newAllocSize != allocSize ||
+          !item.isAccessible() || item.getCreationTime() != creationTime ||
+          item.getSize() != size || !holdsKey(item, end)) {
+        return LookupResult::kConflict;
+      }
+      return LookupResult::kFound;
+    }
+    return LookupResult::kNotFound;
+  }
+
   // the segment backing the cache
   std::unique_ptr<ShmSegment> shm_;
+
+  // the segment backing the buckets of the access container
+  std::unique_ptr<ShmSegment> hashTableShm_;
+
+  // layout of the slabs in the cache segment
+  const SlabHeader* slabHeaders_{nullptr};
+  const uint8_t* slabMemoryStart_{nullptr};
+  size_t numSlabs_{0};
 };
 
 } // namespace cachelib
@@ -19,6 +19,8 @@
 #include <limits>
 
 #include "cachelib/allocator/CacheStats.h"
+#include "cachelib/allocator/SlabExpiryIndex.h"
+#include "cachelib/allocator/memory/AllocationClass.h"
 #include "cachelib/allocator/memory/Slab.h"
 #include "cachelib/common/PeriodicWorker.h"
 
@@ -45,6 +47,24 @@ struct ReaperAPIWrapper {
     cache.traverseAndExpireItems(std::forward<Fn>(f));
   }
 
+  template <typename FilterFn, typename Fn, typename DoneFn>
+  static void traverseAndExpireItems(C& cache,
+                                     FilterFn&& shouldVisit,
+                                     Fn&& f,
+                                     DoneFn&& onSlabDone) {
+    cache.traverseAndExpireItems(std::forward<FilterFn>(shouldVisit),
+                                 std::forward<Fn>(f),
+                                 std::forward<DoneFn>(onSlabDone));
+  }
+
+  static SlabExpiryIndex* getSlabExpiryIndex(C& cache) {
+    return cache.getSlabExpiryIndex();
+  }
+
+  static uint32_t getFullScanInterval(C& cache) {
+    return cache.config_.reaperFullScanInterval;
+  }
+
   static WriteHandle findInternal(C& cache, Key key) {
     return cache.findInternal(key);
   }
@@ -106,6 +126,9 @@ class Reaper : public PeriodicWorker {
   std::atomic<uint64_t> numReapedItems_{0};
   std::atomic<uint64_t> numErrs_{0};
 
+  // slabs not walked because the expiry index has nothing due in them
+  std::atomic<uint64_t> numIndexSkippedSlabs_{0};
+
   // number of items to visit before we check for stopping the worker in super
   // charged mode.
   static constexpr const uint64_t kCheckThreshold = 1ULL << 22;
@@ -143,62 +166,115 @@ void Reaper<CacheT>::reapSlabWalkMode() {
   uint64_t visits = 0;
   uint64_t reaps = 0;
 
-  // unlike the iterator mode, in this mode, we traverse all the way
-  ReaperAPIWrapper<CacheT>::traverseAndExpireItems(
-      cache_, [&](void* ptr, facebook::cachelib::AllocInfo allocInfo) -> bool {
-        XDCHECK(ptr);
-        // see if we need to stop the traversal and accumulate counts to
-        // global
-        if (visits++ == kCheckThreshold) {
-          numVisitedItems_.fetch_add(visits, std::memory_order_relaxed);
-          numReapedItems_.fetch_add(reaps, std::memory_order_relaxed);
-          visits = 0;
-          reaps = 0;
-
-          // abort the current iteration since we have to stop
-          if (shouldStopWork()) {
-            return false;
-          }
-
-          currentTimeSec = util::getCurrentTimeSec();
-        }
-
-        // if we throttle, then we should check for stop condition after
-        // the throttler has actually throttled us.
-        if (t.throttle() && shouldStopWork()) {
-          return false;
-        }
+  // earliest expiry time left in the slab being walked, for the expiry index
+  uint32_t slabMinExpiry = SlabExpiryIndex::kNoExpiry;
+  auto noteExpiry = [&slabMinExpiry](uint32_t expiryTime) {
+    if (expiryTime != 0 && expiryTime < slabMinExpiry) {
+      slabMinExpiry = expiryTime;
+    }
+  };
 
-        // get an item and check if it is expired and is in the access
-        // container before we actually grab the
-        // handle to the item and proceed to expire it.
-        const auto& item = *reinterpret_cast<const Item*>(ptr);
-        if (!item.isExpired(currentTimeSec) || !item.isAccessible()) {
-          return true;
-        }
+  auto visitItem = [&](void* ptr,
+                       facebook::cachelib::AllocInfo allocInfo) -> bool {
+    XDCHECK(ptr);
+    // see if we need to stop the traversal and accumulate counts to
+    // global
+    if (visits++ == kCheckThreshold) {
+      numVisitedItems_.fetch_add(visits, std::memory_order_relaxed);
+      numReapedItems_.fetch_add(reaps, std::memory_order_relaxed);
+      visits = 0;
+      reaps = 0;
+
+      // abort the current iteration since we have to stop
+      if (shouldStopWork()) {
+        return false;
+      }
+
+      currentTimeSec = util::getCurrentTimeSec();
+    }
+
+    // if we throttle, then we should check for stop condition after
+    // the throttler has actually throttled us.
+    if (t.throttle() && shouldStopWork()) {
+      return false;
+    }
+
+    // get an item and check if it is expired and is in the access
+    // container before we actually grab the
+    // handle to the item and proceed to expire it.
+    const auto& item = *reinterpret_cast<const Item*>(ptr);
+    const auto expiryTime = item.getExpiryTime();
+    if (!item.isAccessible()) {
+      // could be an item about to be inserted
+      if (expiryTime > currentTimeSec) {
+        noteExpiry(expiryTime);
+      }
+      return true;
+    }
+    if (!item.isExpired(currentTimeSec)) {
+      noteExpiry(expiryTime);
+      return true;
+    }
+
+    // Item has to be smaller than the alloc size to be a valid item.
+    auto key = item.getKey();
+    if (Item::getRequiredSize(key, 0 /* value size*/) > allocInfo.allocSize) {
+      return true;
+    }
+
+    try {
+      // obtain a valid handle without disturbing the state of the item in
+      // cache.
+      auto handle = ReaperAPIWrapper<CacheT>::findInternal(cache_, key);
+      auto reaped = ReaperAPIWrapper<CacheT>::removeIfExpired(cache_, handle);
+      if (reaped) {
+        reaps++;
+      } else {
+        // still due, the slab is walked again on the next run
+        noteExpiry(expiryTime);
+      }
+    } catch (const std::exception& e) {
+      noteExpiry(expiryTime);
+      numErrs_.fetch_add(1, std::memory_order_relaxed);
+      XLOGF(DBG, "Error while reaping. Msg = {}", e.what());
+    }
+    return true;
+  };
 
-        // Item has to be smaller than the alloc size to be a valid item.
-        auto key = item.getKey();
-        if (Item::getRequiredSize(key, 0 /* value size*/) >
-            allocInfo.allocSize) {
+  auto* expiryIndex = ReaperAPIWrapper<CacheT>::getSlabExpiryIndex(cache_);
+  if (!expiryIndex) {
+    // unlike the iterator mode, in this mode, we traverse all the way
+    ReaperAPIWrapper<CacheT>::traverseAndExpireItems(cache_, visitItem);
+  } else {
+    // only walk the slabs with items due to expire, but every now and then
+    // the whole cache for the expiry times the index missed
+    const auto fullScanInterval =
+        ReaperAPIWrapper<CacheT>::getFullScanInterval(cache_);
+    const bool fullScan =
+        fullScanInterval > 0 && getRunCount() % fullScanInterval == 0;
+    uint64_t indexSkips = 0;
+    uint32_t prevMinExpiry = 0;
+    ReaperAPIWrapper<CacheT>::traverseAndExpireItems(
+        cache_,
+        [&](uint32_t slabIdx) {
+          if (!fullScan && !expiryIndex->isDue(slabIdx, currentTimeSec)) {
+            indexSkips++;
+            return false;
+          }
+          prevMinExpiry = expiryIndex->beginScan(slabIdx);
+          slabMinExpiry = SlabExpiryIndex::kNoExpiry;
           return true;
-        }
-
-        try {
-          // obtain a valid handle without disturbing the state of the item in
-          // cache.
-          auto handle = ReaperAPIWrapper<CacheT>::findInternal(cache_, key);
-          auto reaped =
-              ReaperAPIWrapper<CacheT>::removeIfExpired(cache_, handle);
-          if (reaped) {
-            reaps++;
+        },
+        visitItem,
+        [&](uint32_t slabIdx, SlabIterationStatus status) {
+          if (status == SlabIterationStatus::kFinishedCurrentSlabAndContinue) {
+            expiryIndex->endScan(slabIdx, slabMinExpiry);
+          } else {
+            expiryIndex->abortScan(slabIdx, prevMinExpiry);
           }
-        } catch (const std::exception& e) {
-          numErrs_.fetch_add(1, std::memory_order_relaxed);
-          XLOGF(DBG, "Error while reaping. Msg = {}", e.what());
-        }
-        return true;
-      });
+        });
+    numIndexSkippedSlabs_.fetch_add(indexSkips, std::memory_order_relaxed);
+  }
 
   // accumulate any left over visits, reaps.
   numVisitedItems_.fetch_add(visits, std::memory_order_relaxed);
@@ -222,6 +298,8 @@ ReaperStats Reaper<CacheT>::getStats() const noexcept {
   stats.numVisitedItems = numVisitedItems_.load(std::memory_order_relaxed);
   stats.numReapedItems = numReapedItems_.load(std::memory_order_relaxed);
   stats.numVisitErrs = numErrs_.load(std::memory_order_relaxed);
+  stats.numIndexSkippedSlabs =
+      numIndexSkippedSlabs_.load(std::memory_order_relaxed);
   auto runCount = getRunCount();
   stats.numTraversals = runCount;
   stats.lastTraversalTimeMs = traversalStats_.getLastTraversalTimeMs();
@@ -21,6 +21,7 @@
 #include <folly/logging/xlog.h>
 #include <folly/portability/Asm.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <limits>
@@ -112,9 +113,15 @@ class FOLLY_PACK_ATTR RefcountWithFlags {
     // Item was evicted from NVM while it was in RAM.
     kNvmEvicted,
 
-    // A deprecated and noop flag that was used to mark whether the item is
-    // unevictable in the past.
-    kUnevictable_NOOP,
+    // If the item is the parent of a large item, whose payload indexes its
+    // chunks. This bit was the deprecated unevictable flag, which nothing
+    // sets anymore.
+    kLargeItem,
+
+    // 3 bits for the cost level of the item, see setCostLevel()
+    kCostLevel0,
+    kCostLevel1,
+    kCostLevel2,
 
     // Unused. This is just to indciate the maximum number of flags
     kFlagMax,
@@ -166,6 +173,31 @@ class FOLLY_PACK_ATTR RefcountWithFlags {
     return res;
   }
 
+  // Bumps up the reference count only if the item is in the access container
+  // and is not exclusive. Unlike incRef(), this never bumps the refcount of an
+  // item that has already been removed from the access container, which makes
+  // it suitable for pinning an item that was found without holding the
+  // access container lock.
+  //
+  // @return true if the refcount is bumped, false otherwise.
+  // @throw  exception::RefcountOverflow if new count would be greater than
+  // maxCount
+  FOLLY_ALWAYS_INLINE bool incRefIfAccessible() {
+    auto predicate = [](const Value curValue) {
+      if (UNLIKELY((curValue & kAccessRefMask) == (kAccessRefMask))) {
+        throw exception::RefcountOverflow("Refcount maxed out.");
+      }
+      return (curValue & getAdminRef<kAccessible>()) &&
+             !(curValue & getAdminRef<kExclusive>());
+    };
+
+    auto newValue = [](const Value curValue) {
+      return (curValue + static_cast<Value>(1));
+    };
+
+    return atomicUpdateValue(predicate, newValue);
+  }
+
   // Bumps down the reference count
   //
   // @return Refcount with control bits. When it is zero, we know for
@@ -354,6 +386,35 @@ class FOLLY_PACK_ATTR RefcountWithFlags {
     return atomicUpdateValue(predicate, newValue);
   }
 
+  /**
+   * Same as markMoving(), but for a caller that holds the only access ref to
+   * the item. That ref becomes the extra ref of the moving state, so the
+   * caller must give up its handle without dropping the ref afterwards.
+   */
+  bool markMovingWhenOnlyRef() {
+    Value linkedBitMask = getAdminRef<kLinked>();
+    Value exclusiveBitMask = getAdminRef<kExclusive>();
+    Value isChainedItemFlag = getFlag<kIsChainedItem>();
+
+    auto predicate = [linkedBitMask, exclusiveBitMask,
+                      isChainedItemFlag](const Value curValue) {
+      XDCHECK(!(curValue & isChainedItemFlag));
+
+      const bool unlinked = !(curValue & linkedBitMask);
+      const bool alreadyExclusive = curValue & exclusiveBitMask;
+      if ((curValue & kAccessRefMask) != 1 || unlinked || alreadyExclusive) {
+        return false;
+      }
+      return true;
+    };
+
+    auto newValue = [exclusiveBitMask](const Value curValue) {
+      return curValue | exclusiveBitMask;
+    };
+
+    return atomicUpdateValue(predicate, newValue);
+  }
+
   Value unmarkMoving() noexcept {
     XDCHECK(isMoving());
     auto predicate = [](const Value curValue) {
@@ -406,6 +467,8 @@ class FOLLY_PACK_ATTR RefcountWithFlags {
   void markHasChainedItem() noexcept { setFlag<kHasChainedItem>(); }
   void unmarkHasChainedItem() noexcept { unSetFlag<kHasChainedItem>(); }
   bool hasChainedItem() const noexcept { return isFlagSet<kHasChainedItem>(); }
+  void markLargeItem() noexcept { setFlag<kLargeItem>(); }
+  bool isLargeItem() const noexcept { return isFlagSet<kLargeItem>(); }
 
   /**
    * Keep track of whether the item was modified while in ram cache
@@ -422,6 +485,27 @@ class FOLLY_PACK_ATTR RefcountWithFlags {
   void unmarkNvmEvicted() noexcept { return unSetFlag<kNvmEvicted>(); }
   bool isNvmEvicted() const noexcept { return isFlagSet<kNvmEvicted>(); }
 
+  /**
+   * Hint of how expensive the item is to recompute, between 0 and
+   * kMaxCostLevel, used by the cost aware eviction
+   */
+  static constexpr uint8_t kMaxCostLevel = 7;
+  void setCostLevel(uint8_t level) noexcept {
+    constexpr Value kCostMask = static_cast<Value>(kMaxCostLevel)
+                                << kCostLevel0;
+    const Value levelBits =
+        static_cast<Value>(std::min(level, kMaxCostLevel)) << kCostLevel0;
+    Value curValue = __atomic_load_n(&refCount_, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&refCount_, &curValue,
+                                        (curValue & ~kCostMask) | levelBits,
+                                        true /* isWeak */, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_RELAXED)) {
+    }
+  }
+  uint8_t getCostLevel() const noexcept {
+    return static_cast<uint8_t>((getRaw() >> kCostLevel0) & kMaxCostLevel);
+  }
+
   // Whether or not an item is completely drained of access
   // Refcount is 0 and the item is not linked, accessible, nor exclusive
   bool isDrained() const noexcept { return getRefWithAccessAndAdmin() == 0; }
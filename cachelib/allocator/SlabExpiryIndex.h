@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace facebook::cachelib {
+// Lower bound of the expiry times of the items in every slab, so that the
+// reaper only walks the slabs that hold items due to expire instead of the
+// whole cache.
+//
+// Allocations record the expiry time of their item, lowering the bound of
+// its slab. A reaper pass claims a due slab with beginScan(), which resets the
+// bound, walks the slab and hands back the earliest expiry time it left in
+// it with endScan(). Allocations racing with the walk lower the reset bound
+// themselves, so the bound is never above an expiry time that was recorded.
+//
+// Expiry times changed through Item::updateExpiryTime() bypass the index;
+// the reaper makes up for them with periodic full scans. The index is not
+// persisted, every slab is due after a restart.
+//
+// Thread safe.
+class SlabExpiryIndex {
+ public:
+  // bound of a slab with no item to expire
+  static constexpr uint32_t kNoExpiry = std::numeric_limits<uint32_t>::max();
+
+  // @param numSlabs  number of slabs of the cache
+  explicit SlabExpiryIndex(uint32_t numSlabs)
+      : numSlabs_{numSlabs},
+        minExpiry_{std::make_unique<std::atomic<uint32_t>[]>(numSlabs)} {
+    for (uint32_t i = 0; i < numSlabs_; i++) {
+      minExpiry_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  uint32_t getNumSlabs() const noexcept { return numSlabs_; }
+
+  // lowers the bound of @slabIdx to @expiryTime. Items that never expire
+  // (expiry time 0) are not recorded.
+  void recordExpiry(uint32_t slabIdx, uint32_t expiryTime) noexcept {
+    if (expiryTime == 0 || slabIdx >= numSlabs_) {
+      return;
+    }
+    lower(minExpiry_[slabIdx], expiryTime);
+  }
+
+  // @return true if @slabIdx may hold an item expired at @currentTimeSec
+  bool isDue(uint32_t slabIdx, uint32_t currentTimeSec) const noexcept {
+    return slabIdx >= numSlabs_ ||
+           minExpiry_[slabIdx].load(std::memory_order_relaxed) <
+               currentTimeSec;
+  }
+
+  // claims @slabIdx for a walk by resetting its bound.
+  //
+  // @return the bound before the walk, to hand back to abortScan()
+  uint32_t beginScan(uint32_t slabIdx) noexcept {
+    if (slabIdx >= numSlabs_) {
+      return 0;
+    }
+    return minExpiry_[slabIdx].exchange(kNoExpiry, std::memory_order_acq_rel);
+  }
+
+  // ends the walk of @slabIdx that left items expiring at @minExpiry the
+  // earliest, kNoExpiry if none
+  void endScan(uint32_t slabIdx, uint32_t minExpiry) noexcept {
+    if (slabIdx >= numSlabs_) {
+      return;
+    }
+    lower(minExpiry_[slabIdx], minExpiry);
+  }
+
+  // ends the walk of @slabIdx that did not visit every item, restoring the
+  // bound returned by beginScan()
+  void abortScan(uint32_t slabIdx, uint32_t prevMinExpiry) noexcept {
+    endScan(slabIdx, prevMinExpiry);
+  }
+
+ private:
+  static void lower(std::atomic<uint32_t>& bound, uint32_t expiryTime) {
+    auto cur = bound.load(std::memory_order_relaxed);
+    while (expiryTime < cur &&
+           !bound.compare_exchange_weak(cur, expiryTime,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  const uint32_t numSlabs_;
+  std::unique_ptr<std::atomic<uint32_t>[]> minExpiry_;
+};
+} // namespace facebook::cachelib
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/StatsSnapshotter.h"
+
+#include <folly/logging/xlog.h>
+
+namespace facebook::cachelib {
+
+StatsSnapshotter::~StatsSnapshotter() { stop(std::chrono::seconds(0)); }
+
+void StatsSnapshotter::work() {
+  try {
+    auto snapshot = std::make_shared<CacheStatsSnapshot>();
+    snapshot->time = std::chrono::steady_clock::now();
+    snapshot->globalStats = cache_.getGlobalCacheStats();
+    snapshot->memoryStats = cache_.getCacheMemoryStats();
+    for (const auto pid : cache_.getPoolIds()) {
+      snapshot->poolStats.emplace(pid, cache_.getPoolStats(pid));
+    }
+    cache_.exportStats(statPrefix_, aggregationInterval_,
+                       [&snapshot](folly::StringPiece name, uint64_t value) {
+                         snapshot->counters.emplace_back(name.str(), value);
+                       });
+
+    snapshot_.store(std::shared_ptr<const CacheStatsSnapshot>(
+                        std::move(snapshot)),
+                    std::memory_order_release);
+    numRuns_.fetch_add(1, std::memory_order_relaxed);
+  } catch (const std::exception& ex) {
+    XLOGF(CRITICAL, "Stats snapshot interrupted due to exception: {}",
+          ex.what());
+    XDCHECK(false);
+  }
+}
+
+} // namespace facebook::cachelib
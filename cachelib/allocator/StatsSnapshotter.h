@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/concurrency/AtomicSharedPtr.h>
+#include <folly/container/F14Map.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cachelib/allocator/Cache.h"
+#include "cachelib/allocator/CacheStats.h"
+#include "cachelib/common/PeriodicWorker.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Stats of the cache as of one run of the StatsSnapshotter. Snapshots are
+// immutable once published.
+struct CacheStatsSnapshot {
+  // when the snapshot was taken
+  std::chrono::steady_clock::time_point time;
+
+  GlobalCacheStats globalStats;
+  CacheMemoryStats memoryStats;
+  folly::F14FastMap<PoolId, PoolStats> poolStats;
+
+  // the counters of CacheBase::exportStats, with the deltas computed over
+  // the interval since the previous snapshot
+  std::vector<std::pair<std::string, uint64_t>> counters;
+};
+
+// Periodic worker that computes the stats of the cache and publishes them as
+// a snapshot. Computing the stats iterates over every pool and class and
+// merges the thread local stats, which monitoring that scrapes every second
+// would otherwise do on its own thread each time. Reading the latest
+// snapshot only copies a shared pointer.
+//
+// The worker exports the counters of the cache, so exportStats() must not
+// also be called by the application while it runs.
+class StatsSnapshotter : public PeriodicWorker {
+ public:
+  // @param cache                 the cache interface
+  // @param statPrefix            prefix of the names of the counters
+  // @param aggregationInterval   the interval the worker runs at, which the
+  //                              deltas of the counters are computed over
+  StatsSnapshotter(CacheBase& cache,
+                   std::string statPrefix,
+                   std::chrono::seconds aggregationInterval)
+      : cache_(cache),
+        statPrefix_(std::move(statPrefix)),
+        aggregationInterval_(aggregationInterval) {}
+
+  ~StatsSnapshotter() override;
+
+  // @return the latest snapshot, or nullptr before the first run
+  std::shared_ptr<const CacheStatsSnapshot> getSnapshot() const {
+    return snapshot_.load(std::memory_order_acquire);
+  }
+
+  // number of snapshots published
+  uint64_t getNumRuns() const noexcept {
+    return numRuns_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // cache's interface for computing the stats
+  CacheBase& cache_;
+
+  const std::string statPrefix_;
+  const std::chrono::seconds aggregationInterval_;
+
+  folly::atomic_shared_ptr<const CacheStatsSnapshot> snapshot_;
+
+  std::atomic<uint64_t> numRuns_{0};
+
+  void work() final;
+};
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/ThreadLocal.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/lang/Align.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "cachelib/allocator/Handle.h"
+#include "cachelib/allocator/Refcount.h"
+#include "cachelib/common/Time.h"
+#include "cachelib/common/hothash/HotHashDetector.h"
+
+namespace facebook {
+namespace cachelib {
+
+struct StripedRefcountConfig {
+  // number of buckets of the hot hash detector of every thread, a power of
+  // two
+  size_t detectorBuckets{1024};
+
+  // size of the warm set of the detectors. A key is hot when it is looked up
+  // at least hotnessMultiplier times more than the keys of the warm set.
+  size_t detectorWarmItems{100};
+  size_t detectorHotnessMultiplier{10};
+
+  // number of items that can have a striped refcount at a time. Keys are
+  // mapped to them by hash. At most kMaxItems.
+  uint32_t maxItems{64};
+
+  // number of refcount stripes of every item. 0 picks the number of cpus.
+  // At most kMaxStripes.
+  uint32_t numStripes{0};
+
+  // the striped refcount of an item is folded back into the item after this
+  // long. The item is then looked up through the access container again,
+  // which refreshes its position in the eviction queue, and can be evicted
+  // if it is not hot anymore.
+  std::chrono::milliseconds lifetime{1000};
+
+  static constexpr uint32_t kMaxItems{255};
+  static constexpr uint32_t kMaxStripes{detail::StripedRef::kNoStripe};
+
+  // @throw std::invalid_argument if the config is invalid
+  void validate() const {
+    if (detectorBuckets == 0 || (detectorBuckets & (detectorBuckets - 1))) {
+      throw std::invalid_argument(folly::sformat(
+          "Hot key detector buckets must be a power of two, but got {}",
+          detectorBuckets));
+    }
+    if (detectorWarmItems == 0 || detectorHotnessMultiplier == 0) {
+      throw std::invalid_argument(
+          "Hot key detector warm items and hotness multiplier must be "
+          "positive");
+    }
+    if (maxItems == 0 || maxItems > kMaxItems || numStripes > kMaxStripes) {
+      throw std::invalid_argument(folly::sformat(
+          "Striped refcounts need between 1 and {} items and at most {} "
+          "stripes, but got {} items and {} stripes",
+          kMaxItems, kMaxStripes, maxItems, numStripes));
+    }
+  }
+};
+
+// Refcounts split into per cpu stripes for a few very hot items.
+//
+// An item with a striped refcount is pinned by one reference held by this
+// table. Handles to it that are handed out by find() increment the stripe of
+// the current cpu instead of the refcount of the item, and decrement that
+// same stripe when they are released, so readers on different cpus do not
+// share a cacheline. The handle remembers its slot, stripe and the
+// generation of the slot.
+//
+// Folding the refcount back closes the stripes one at a time. A stripe is
+// closed by a compare and swap that only succeeds if the count moved into
+// the item is still the count of the stripe, so every handle counted by the
+// stripe is accounted on the item before it can be released from the item.
+// Handles released after their stripe was closed, or whose generation is
+// not the current one of the slot anymore, release their reference from the
+// item itself. The pin is dropped last.
+template <typename Item>
+class StripedRefcounts {
+ public:
+  // a reference counted on a stripe, kept by the handle
+  using Ref = detail::StripedRef;
+
+  explicit StripedRefcounts(const StripedRefcountConfig& config)
+      : config_(config),
+        numStripes_(getNumStripes(config)),
+        detectors_([config]() {
+          return new HotHashDetector(config.detectorBuckets,
+                                     config.detectorWarmItems,
+                                     config.detectorHotnessMultiplier);
+        }),
+        slots_(config.maxItems) {
+    config_.validate();
+    for (auto& slot : slots_) {
+      slot.stripes = std::make_unique<Stripe[]>(numStripes_);
+    }
+  }
+
+  // bump the hash on the detector of the calling thread
+  //
+  // @return true if the key of the hash is very hot
+  bool bumpHash(uint64_t hash) { return detectors_->bumpHash(hash) != 0; }
+
+  // take a reference on the stripe of the current cpu if the key has a
+  // striped refcount
+  //
+  // @return the item with the reference, nullptr otherwise
+  Item* acquire(typename Item::Key key, uint64_t hash, Ref& ref) {
+    const auto slotIdx = getSlotIdx(hash);
+    auto& slot = slots_[slotIdx];
+    const auto state = slot.state.load(std::memory_order_acquire);
+    if (state == 0 || slot.hash.load(std::memory_order_relaxed) != hash) {
+      return nullptr;
+    }
+
+    const auto generation = getGeneration(state);
+    const auto stripeIdx =
+        folly::AccessSpreader<>::cachedCurrent(numStripes_);
+    auto& word = slot.stripes[stripeIdx].word;
+    auto value = word.load(std::memory_order_relaxed);
+    do {
+      // the stripe being open for the generation of the item means the
+      // table still pins the item
+      if ((value & kClosed) || getGeneration(value) != generation) {
+        return nullptr;
+      }
+    } while (!word.compare_exchange_weak(value, value + 1,
+                                         std::memory_order_acq_rel));
+
+    ref.slot = static_cast<uint8_t>(slotIdx);
+    ref.stripe = static_cast<uint8_t>(stripeIdx);
+    ref.generation = generation;
+    Item* item = getItem(state);
+    if (item->getKey() != key ||
+        util::getCurrentTimeMs() - slot.creationTimeMs >
+            static_cast<uint64_t>(config_.lifetime.count())) {
+      release(ref);
+      return nullptr;
+    }
+    return item;
+  }
+
+  // drop a reference taken by acquire()
+  //
+  // @return false if the refcount of the item was folded back, in which case
+  //         the reference must be released from the item itself
+  bool release(const Ref& ref) noexcept {
+    auto& word = slots_[ref.slot].stripes[ref.stripe].word;
+    auto value = word.load(std::memory_order_relaxed);
+    do {
+      if ((value & kClosed) || getGeneration(value) != ref.generation) {
+        return false;
+      }
+    } while (!word.compare_exchange_weak(value, value - 1,
+                                         std::memory_order_acq_rel));
+    return true;
+  }
+
+  // give the item a striped refcount, in place of the item of the same slot
+  // if that one is stale
+  //
+  // @param item  the item, with a reference that becomes the pin
+  //
+  // @return the item whose pin must be released by the caller: the item
+  //         displaced from the slot, the item itself if it could not be
+  //         added, or nullptr
+  Item* add(uint64_t hash, Item& item) {
+    const auto ptr = reinterpret_cast<uintptr_t>(&item);
+    if (ptr >> kGenerationShift) {
+      return &item;
+    }
+
+    auto& slot = slots_[getSlotIdx(hash)];
+    std::lock_guard<std::mutex> l(mutex_);
+    Item* displaced = nullptr;
+    const auto state = slot.state.load(std::memory_order_relaxed);
+    if (state != 0) {
+      const bool fresh =
+          util::getCurrentTimeMs() - slot.creationTimeMs <=
+              static_cast<uint64_t>(config_.lifetime.count()) &&
+          getItem(state)->isAccessible();
+      if (fresh) {
+        return &item;
+      }
+      displaced = foldLocked(slot);
+    }
+
+    const uint16_t generation = ++slot.generation;
+    for (uint32_t i = 0; i < numStripes_; i++) {
+      slot.stripes[i].word.store(
+          static_cast<uint64_t>(generation) << kGenerationShift,
+          std::memory_order_relaxed);
+    }
+    slot.hash.store(hash, std::memory_order_relaxed);
+    slot.creationTimeMs = util::getCurrentTimeMs();
+    slot.state.store(
+        (static_cast<uint64_t>(generation) << kGenerationShift) | ptr,
+        std::memory_order_release);
+    return displaced;
+  }
+
+  // fold the striped refcount of the key back into its item
+  //
+  // @return the item whose pin must be released by the caller, or nullptr
+  Item* fold(uint64_t hash) {
+    auto& slot = slots_[getSlotIdx(hash)];
+    if (slot.state.load(std::memory_order_acquire) == 0 ||
+        slot.hash.load(std::memory_order_relaxed) != hash) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> l(mutex_);
+    if (slot.hash.load(std::memory_order_relaxed) != hash) {
+      return nullptr;
+    }
+    return foldLocked(slot);
+  }
+
+  // fold all the striped refcounts back into their items
+  //
+  // @return the items whose pin must be released by the caller
+  std::vector<Item*> foldAll() {
+    return foldAll([](const Item&) { return true; });
+  }
+
+  // fold the striped refcounts of the items that shouldFold returns true
+  // for back into them
+  //
+  // @return the items whose pin must be released by the caller
+  template <typename Fn>
+  std::vector<Item*> foldAll(Fn&& shouldFold) {
+    std::vector<Item*> items;
+    std::lock_guard<std::mutex> l(mutex_);
+    for (auto& slot : slots_) {
+      const auto state = slot.state.load(std::memory_order_relaxed);
+      if (state == 0 || !shouldFold(*getItem(state))) {
+        continue;
+      }
+      items.push_back(foldLocked(slot));
+    }
+    return items;
+  }
+
+ private:
+  // word of a stripe: the generation of the slot in the upper bits, a bit
+  // set once the stripe is closed and the count of references.
+  static constexpr unsigned int kGenerationShift = 48;
+  static constexpr uint64_t kClosed = 1ULL << 47;
+  static constexpr uint64_t kCountMask = kClosed - 1;
+
+  struct alignas(folly::hardware_destructive_interference_size) Stripe {
+    std::atomic<uint64_t> word{0};
+  };
+
+  struct Slot {
+    // generation of the slot in the upper bits and the address of the item,
+    // 0 when the slot has no item
+    std::atomic<uint64_t> state{0};
+    std::atomic<uint64_t> hash{0};
+    uint64_t creationTimeMs{0};
+    uint16_t generation{0};
+    std::unique_ptr<Stripe[]> stripes;
+  };
+
+  static uint16_t getGeneration(uint64_t value) noexcept {
+    return static_cast<uint16_t>(value >> kGenerationShift);
+  }
+
+  static Item* getItem(uint64_t state) noexcept {
+    return reinterpret_cast<Item*>(state &
+                                   ((1ULL << kGenerationShift) - 1));
+  }
+
+  static uint32_t getNumStripes(const StripedRefcountConfig& config) {
+    if (config.numStripes != 0) {
+      return config.numStripes;
+    }
+    return std::min(StripedRefcountConfig::kMaxStripes,
+                    std::max(1u, std::thread::hardware_concurrency()));
+  }
+
+  size_t getSlotIdx(uint64_t hash) const noexcept {
+    return hash % slots_.size();
+  }
+
+  Item* foldLocked(Slot& slot) {
+    const auto state = slot.state.load(std::memory_order_relaxed);
+    if (state == 0) {
+      return nullptr;
+    }
+
+    Item* item = getItem(state);
+    for (uint32_t i = 0; i < numStripes_; i++) {
+      auto& word = slot.stripes[i].word;
+      // references moved from the stripe to the item so far. The pin keeps
+      // the item alive while these are adjusted.
+      uint64_t moved = 0;
+      auto value = word.load(std::memory_order_acquire);
+      do {
+        const auto count = value & kCountMask;
+        for (; moved < count; moved++) {
+          const auto res = item->incRef();
+          XDCHECK(res == RefcountWithFlags::IncResult::kIncOk);
+        }
+        for (; moved > count; moved--) {
+          item->decRef();
+        }
+      } while (!word.compare_exchange_weak(value, value | kClosed,
+                                           std::memory_order_acq_rel));
+    }
+    slot.state.store(0, std::memory_order_release);
+    return item;
+  }
+
+  const StripedRefcountConfig config_;
+  const uint32_t numStripes_;
+
+  // not thread safe, hence one per thread
+  folly::ThreadLocal<HotHashDetector> detectors_;
+
+  // serializes adding and folding striped refcounts
+  std::mutex mutex_;
+  std::vector<Slot> slots_;
+};
+
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/Range.h>
+#include <folly/String.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "cachelib/allocator/memory/Slab.h"
+
+namespace facebook {
+namespace cachelib {
+
+struct ValueDedupStats {
+  // values stored in the item of their key, because they are small or their
+  // blob could not be allocated
+  uint64_t numInlineInserts{0};
+
+  // values that created a new blob
+  uint64_t numBlobInserts{0};
+
+  // values that found their blob already cached, and their bytes
+  uint64_t numSharedInserts{0};
+  uint64_t bytesShared{0};
+
+  // lookups of keys whose blob was evicted or removed
+  uint64_t numMissingBlobs{0};
+};
+
+// Stores the values of keys, from any pool of the cache, so that identical
+// values are kept once. A value of at least minDedupSize bytes lives in a
+// blob item of a dedicated pool, keyed by the hash and size of the content,
+// and the item of the key only holds a reference to it. Smaller values are
+// stored in the item of their key.
+//
+// Blobs are regular items: they are evicted from their pool in LRU order,
+// every lookup through a reference bumps the blob, and with an nvm cache a
+// blob is written to flash once however many keys reference it. A key whose
+// blob was evicted reads as a miss and its reference is removed.
+//
+// Blobs are not reference counted. Counting would rewrite the blob on every
+// insert, which drops its flash copy, and could not account for references
+// that get evicted. A blob no key refers to anymore ages out of its pool
+// instead.
+//
+// Keys of blobs start with a 0 byte followed by "vdb". Such keys are reserved
+// for the blobs.
+template <typename CacheT>
+class ValueDedupCache {
+ public:
+  using Item = typename CacheT::Item;
+  using Key = typename Item::Key;
+  using ReadHandle = typename CacheT::ReadHandle;
+  using RemoveRes = typename CacheT::RemoveRes;
+
+  // values below this size are not worth a reference and a second lookup
+  static constexpr uint32_t kDefaultMinDedupSize = 1024;
+
+  // The value of a key and the items holding it. The value is valid as long
+  // as the handle is alive.
+  class ValueHandle {
+   public:
+    ValueHandle() = default;
+
+    explicit operator bool() const noexcept { return item_ != nullptr; }
+
+    folly::StringPiece getValue() const noexcept { return value_; }
+
+    // @return true if the value is held by a blob shared with other keys
+    bool isShared() const noexcept { return blob_ != nullptr; }
+
+   private:
+    ValueHandle(ReadHandle item, ReadHandle blob, folly::StringPiece value)
+        : item_{std::move(item)}, blob_{std::move(blob)}, value_{value} {}
+
+    ReadHandle item_;
+    ReadHandle blob_;
+    folly::StringPiece value_;
+
+    friend ValueDedupCache;
+  };
+
+  // @param cache         cache holding the items of the keys and the blobs
+  // @param blobPoolId    pool of the blobs
+  // @param minDedupSize  values of at least this many bytes are shared
+  ValueDedupCache(CacheT& cache,
+                  PoolId blobPoolId,
+                  uint32_t minDedupSize = kDefaultMinDedupSize)
+      : cache_(cache), blobPoolId_{blobPoolId}, minDedupSize_{minDedupSize} {}
+
+  ValueDedupCache(const ValueDedupCache&) = delete;
+  ValueDedupCache& operator=(const ValueDedupCache&) = delete;
+
+  // Store the value of the key in the pool, replacing any previous value of
+  // the key. The value is shared with the keys that have the same value if
+  // it is large enough.
+  //
+  // @return false if the item of the key could not be allocated
+  // @throw std::invalid_argument if the key is reserved for the blobs, or if
+  //        the value is too large for an item
+  bool insertOrReplace(PoolId pid,
+                       Key key,
+                       folly::StringPiece value,
+                       uint32_t ttlSecs = 0) {
+    if (key.startsWith(folly::StringPiece{kBlobKeyPrefix, kPrefixSize})) {
+      throw std::invalid_argument(folly::sformat(
+          "Key {} is reserved for the blobs of shared values",
+          folly::humanify(key.str())));
+    }
+
+    Header header{};
+    header.size = static_cast<uint32_t>(value.size());
+    if (value.size() >= minDedupSize_) {
+      folly::hash::SpookyHashV2::Hash128(value.data(), value.size(),
+                                         &header.hash[0], &header.hash[1]);
+      if (insertBlob(header, value)) {
+        header.shared = 1;
+      }
+    }
+
+    const auto inlineSize = header.shared ? 0 : value.size();
+    auto handle = cache_.allocate(
+        pid, key, static_cast<uint32_t>(sizeof(Header) + inlineSize),
+        ttlSecs);
+    if (!handle) {
+      return false;
+    }
+    auto* mem = reinterpret_cast<char*>(handle->getMemory());
+    std::memcpy(mem, &header, sizeof(Header));
+    if (!header.shared) {
+      std::memcpy(mem + sizeof(Header), value.data(), value.size());
+      numInlineInserts_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cache_.insertOrReplace(handle);
+    return true;
+  }
+
+  // @return the value of the key, empty if the key is not cached or its
+  //         blob was evicted
+  ValueHandle find(Key key) {
+    auto handle = cache_.find(key);
+    if (!handle) {
+      return {};
+    }
+    Header header;
+    const auto* mem = reinterpret_cast<const char*>(handle->getMemory());
+    std::memcpy(&header, mem, sizeof(Header));
+    if (!header.shared) {
+      return ValueHandle{std::move(handle), ReadHandle{},
+                         folly::StringPiece{mem + sizeof(Header),
+                                            header.size}};
+    }
+
+    const auto blobKey = makeBlobKey(header);
+    auto blob = cache_.find(Key{blobKey.data(), blobKey.size()});
+    if (!blob || blob->getSize() != header.size) {
+      // nothing to read the value from anymore. Drop the reference unless
+      // the key was replaced meanwhile.
+      numMissingBlobs_.fetch_add(1, std::memory_order_relaxed);
+      cache_.remove(handle);
+      return {};
+    }
+    const folly::StringPiece value{
+        reinterpret_cast<const char*>(blob->getMemory()), header.size};
+    return ValueHandle{std::move(handle), std::move(blob), value};
+  }
+
+  // Remove the key. Its blob stays until it is evicted.
+  RemoveRes remove(Key key) { return cache_.remove(key); }
+
+  ValueDedupStats getStats() const noexcept {
+    ValueDedupStats stats;
+    stats.numInlineInserts = numInlineInserts_.load(std::memory_order_relaxed);
+    stats.numBlobInserts = numBlobInserts_.load(std::memory_order_relaxed);
+    stats.numSharedInserts = numSharedInserts_.load(std::memory_order_relaxed);
+    stats.bytesShared = bytesShared_.load(std::memory_order_relaxed);
+    stats.numMissingBlobs = numMissingBlobs_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  // stored at the start of the item of every key. An inline value follows.
+  struct Header {
+    uint64_t hash[2];
+    uint32_t size;
+    uint8_t shared;
+  };
+
+  static constexpr char kBlobKeyPrefix[] = "\0vdb";
+  static constexpr size_t kPrefixSize = sizeof(kBlobKeyPrefix) - 1;
+  static constexpr size_t kBlobKeySize =
+      kPrefixSize + sizeof(Header::hash) + sizeof(Header::size);
+  using BlobKey = std::array<char, kBlobKeySize>;
+
+  static BlobKey makeBlobKey(const Header& header) noexcept {
+    BlobKey key;
+    auto* pos = key.data();
+    std::memcpy(pos, kBlobKeyPrefix, kPrefixSize);
+    pos += kPrefixSize;
+    std::memcpy(pos, header.hash, sizeof(header.hash));
+    pos += sizeof(header.hash);
+    std::memcpy(pos, &header.size, sizeof(header.size));
+    return key;
+  }
+
+  // Find the blob of the value or insert it.
+  //
+  // @return false if the value can not be shared, because its blob could not
+  //         be allocated or another value has the same hash and size
+  bool insertBlob(const Header& header, folly::StringPiece value) {
+    const auto blobKey = makeBlobKey(header);
+    const Key key{blobKey.data(), blobKey.size()};
+    // a second attempt if another thread inserts the same blob first
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (auto blob = cache_.find(key)) {
+        if (blob->getSize() != value.size() ||
+            std::memcmp(blob->getMemory(), value.data(), value.size()) != 0) {
+          return false;
+        }
+        numSharedInserts_.fetch_add(1, std::memory_order_relaxed);
+        bytesShared_.fetch_add(value.size(), std::memory_order_relaxed);
+        return true;
+      }
+
+      auto blob = cache_.allocate(blobPoolId_, key,
+                                  static_cast<uint32_t>(value.size()));
+      if (!blob) {
+        return false;
+      }
+      std::memcpy(blob->getMemory(), value.data(), value.size());
+      if (cache_.insert(blob)) {
+        numBlobInserts_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  CacheT& cache_;
+  const PoolId blobPoolId_;
+  const uint32_t minDedupSize_;
+
+  std::atomic<uint64_t> numInlineInserts_{0};
+  std::atomic<uint64_t> numBlobInserts_{0};
+  std::atomic<uint64_t> numSharedInserts_{0};
+  std::atomic<uint64_t> bytesShared_{0};
+  std::atomic<uint64_t> numMissingBlobs_{0};
+};
+} // namespace cachelib
+} // namespace facebook
@@ -16,6 +16,7 @@
 
 #include "cachelib/allocator/memory/AllocationClass.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/Try.h>
 #include <folly/logging/xlog.h>
 
@@ -41,18 +42,25 @@ using namespace facebook::cachelib;
 constexpr unsigned int AllocationClass::kFreeAllocsPruneLimit;
 constexpr unsigned int AllocationClass::kFreeAllocsPruneSleepMicroSecs;
 constexpr unsigned int AllocationClass::kForEachAllocPrefetchOffset;
+constexpr uint32_t AllocationClass::kMaxMagazineSize;
 
 AllocationClass::AllocationClass(ClassId classId,
                                  PoolId poolId,
                                  uint32_t allocSize,
-                                 const SlabAllocator& s)
+                                 const SlabAllocator& s,
+                                 uint32_t magazineSize)
     : classId_(classId),
       poolId_(poolId),
       allocationSize_(allocSize),
       slabAlloc_(s),
       freedAllocations_{
-          slabAlloc_.createPtrCompressor<FreeAlloc, CompressedPtr4B>()} {
+          slabAlloc_.createPtrCompressor<FreeAlloc, CompressedPtr4B>()},
+      magazineSize_(magazineSize) {
   checkState();
+  if (magazineSize_ > 0) {
+    magazines_ =
+        std::make_unique<Magazines>([this]() { return new Magazine(*this); });
+  }
 }
 
 void AllocationClass::checkState() const {
@@ -69,6 +77,12 @@ void AllocationClass::checkState() const {
         folly::sformat("Invalid alloc size {}", allocationSize_));
   }
 
+  if (magazineSize_ > kMaxMagazineSize) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid magazine size {}. Must be at most {}", magazineSize_,
+        kMaxMagazineSize));
+  }
+
   const auto header = slabAlloc_.getSlabHeader(currSlab_);
   if (currSlab_ != nullptr && header == nullptr) {
     throw std::invalid_argument(folly::sformat(
@@ -95,7 +109,8 @@ void AllocationClass::checkState() const {
 AllocationClass::AllocationClass(
     const serialization::AllocationClassObject& object,
     PoolId poolId,
-    const SlabAllocator& s)
+    const SlabAllocator& s,
+    uint32_t magazineSize)
     : classId_(*object.classId()),
       poolId_(poolId),
       allocationSize_(static_cast<uint32_t>(*object.allocationSize())),
@@ -105,7 +120,8 @@ AllocationClass::AllocationClass(
       freedAllocations_(
           *object.freedAllocationsObject(),
           slabAlloc_.createPtrCompressor<FreeAlloc, CompressedPtr4B>()),
-      canAllocate_(*object.canAllocate()) {
+      canAllocate_(*object.canAllocate()),
+      magazineSize_(magazineSize) {
   if (!slabAlloc_.isRestorable()) {
     throw std::logic_error("The allocation class cannot be restored.");
   }
@@ -119,6 +135,10 @@ AllocationClass::AllocationClass(
   }
 
   checkState();
+  if (magazineSize_ > 0) {
+    magazines_ =
+        std::make_unique<Magazines>([this]() { return new Magazine(*this); });
+  }
 }
 
 void AllocationClass::addSlabLocked(Slab* slab) {
@@ -155,12 +175,110 @@ bool AllocationClass::canAllocateFromCurrentSlabLocked() const noexcept {
 }
 
 void* AllocationClass::allocate() {
+  if (magazines_) {
+    if (void* ret = allocateFromMagazine()) {
+      return ret;
+    }
+  }
   if (!canAllocate_) {
     return nullptr;
   }
   return lock_->lock_combine([this]() -> void* { return allocateLocked(); });
 }
 
+void* AllocationClass::allocateFromMagazine() {
+  auto& magazine = **magazines_;
+  std::lock_guard<folly::SpinLock> l(magazine.lock);
+  // checked under the magazine lock to synchronize with flushMagazines
+  if (magazinesBypassed()) {
+    return nullptr;
+  }
+
+  auto size = magazine.size.load(std::memory_order_relaxed);
+  if (size == 0) {
+    if (!canAllocate_) {
+      return nullptr;
+    }
+    const uint32_t numToRefill = std::max(1u, magazineSize_ / 2);
+    size = lock_->lock_combine([&]() {
+      uint32_t n = 0;
+      while (n < numToRefill) {
+        void* alloc = allocateLocked();
+        if (alloc == nullptr) {
+          break;
+        }
+        magazine.allocs[n++] = alloc;
+      }
+      return n;
+    });
+    if (size == 0) {
+      return nullptr;
+    }
+  }
+
+  --size;
+  magazine.size.store(size, std::memory_order_relaxed);
+  return magazine.allocs[size];
+}
+
+bool AllocationClass::freeToMagazine(void* memory) {
+  auto& magazine = **magazines_;
+  std::lock_guard<folly::SpinLock> l(magazine.lock);
+  // checked under the magazine lock to synchronize with flushMagazines
+  if (magazinesBypassed()) {
+    return false;
+  }
+
+  auto size = magazine.size.load(std::memory_order_relaxed);
+  if (size == magazineSize_) {
+    // give the older half back to the class and keep the recently freed
+    // allocations, which are more likely to be in the cpu cache.
+    const uint32_t numToFlush = std::max(1u, magazineSize_ / 2);
+    freeBatch(magazine.allocs.data(), numToFlush);
+    std::copy(magazine.allocs.begin() + numToFlush,
+              magazine.allocs.begin() + size, magazine.allocs.begin());
+    size -= numToFlush;
+  }
+
+  magazine.allocs[size++] = memory;
+  magazine.size.store(size, std::memory_order_relaxed);
+  return true;
+}
+
+void AllocationClass::freeBatch(void* const* allocs, size_t numAllocs) {
+  if (numAllocs == 0) {
+    return;
+  }
+  lock_->lock_combine([&]() {
+    for (size_t i = 0; i < numAllocs; i++) {
+      freeLocked(slabAlloc_.getSlabHeader(allocs[i]),
+                 slabAlloc_.getSlabForMemory(allocs[i]), allocs[i]);
+    }
+  });
+}
+
+void AllocationClass::flushMagazines() {
+  if (!magazines_) {
+    return;
+  }
+
+  std::vector<void*> allocs;
+  for (auto& magazine : magazines_->accessAllThreads()) {
+    std::lock_guard<folly::SpinLock> l(magazine.lock);
+    const auto size = magazine.size.load(std::memory_order_relaxed);
+    allocs.insert(allocs.end(), magazine.allocs.begin(),
+                  magazine.allocs.begin() + size);
+    magazine.size.store(0, std::memory_order_relaxed);
+  }
+  freeBatch(allocs.data(), allocs.size());
+}
+
+AllocationClass::Magazine::~Magazine() {
+  std::lock_guard<folly::SpinLock> l(lock);
+  parent.freeBatch(allocs.data(), size.load(std::memory_order_relaxed));
+  size.store(0, std::memory_order_relaxed);
+}
+
 void* AllocationClass::allocateLocked() {
   // fast path for case when the cache is mostly full.
   if (freedAllocations_.empty() && freeSlabs_.empty() &&
@@ -222,6 +340,14 @@ SlabReleaseContext AllocationClass::startSlabRelease(
         folly::sformat("Invalid hint {} for slab release {}", hint, hintSlab));
   }
 
+  // stop caching free allocations in magazines and return what is cached, so
+  // that pruning the free allocations finds all the free allocations of the
+  // slab. If the slab ends up with active allocations, activeReleases_ keeps
+  // the magazines bypassed until the release completes or is aborted.
+  ++slabReleasesStarting_;
+  SCOPE_EXIT { --slabReleasesStarting_; };
+  flushMagazines();
+
   const Slab* slab;
   SlabHeader* header;
   {
@@ -636,34 +762,42 @@ void AllocationClass::free(void* memory) {
         memory, header ? header->classId : Slab::kInvalidClassId, classId_));
   }
 
-  const auto slabPtrVal = getSlabPtrValue(slab);
-  lock_->lock_combine([this, header, slab, memory, slabPtrVal]() {
-    // check under the lock we actually add the allocation back to the free list
-    if (header->isMarkedForRelease()) {
-      auto it = slabReleaseAllocMap_.find(slabPtrVal);
-
-      // this should not happen.
-      if (it == slabReleaseAllocMap_.end()) {
-        throw std::runtime_error(folly::sformat(
-            "Invalid slabReleaseAllocMap "
-            "state when attempting to free an allocation. Memory: {}",
-            memory));
-      }
+  if (magazines_ && freeToMagazine(memory)) {
+    return;
+  }
 
-      auto& allocState = it->second;
-      const auto idx = getAllocIdx(slab, memory);
-      if (allocState[idx]) {
-        throw std::invalid_argument(
-            folly::sformat("Allocation {} is already marked as free", memory));
-      }
-      allocState[idx] = true;
-      return;
+  lock_->lock_combine(
+      [this, header, slab, memory]() { freeLocked(header, slab, memory); });
+}
+
+void AllocationClass::freeLocked(const SlabHeader* header,
+                                 const Slab* slab,
+                                 void* memory) {
+  // check under the lock we actually add the allocation back to the free list
+  if (header->isMarkedForRelease()) {
+    auto it = slabReleaseAllocMap_.find(getSlabPtrValue(slab));
+
+    // this should not happen.
+    if (it == slabReleaseAllocMap_.end()) {
+      throw std::runtime_error(folly::sformat(
+          "Invalid slabReleaseAllocMap "
+          "state when attempting to free an allocation. Memory: {}",
+          memory));
     }
 
-    // TODO add checks here to ensure that we dont double free in debug mode.
-    freedAllocations_.insert(*reinterpret_cast<FreeAlloc*>(memory));
-    canAllocate_ = true;
-  });
+    auto& allocState = it->second;
+    const auto idx = getAllocIdx(slab, memory);
+    if (allocState[idx]) {
+      throw std::invalid_argument(
+          folly::sformat("Allocation {} is already marked as free", memory));
+    }
+    allocState[idx] = true;
+    return;
+  }
+
+  // TODO add checks here to ensure that we dont double free in debug mode.
+  freedAllocations_.insert(*reinterpret_cast<FreeAlloc*>(memory));
+  canAllocate_ = true;
 }
 
 serialization::AllocationClassObject AllocationClass::saveState() const {
@@ -674,6 +808,10 @@ serialization::AllocationClassObject AllocationClass::saveState() const {
     throw std::logic_error(
         "Can not save state when there are active slab releases happening");
   }
+  if (getNumMagazineAllocs() > 0) {
+    throw std::logic_error(
+        "Can not save state when magazines hold free allocations");
+  }
 
   serialization::AllocationClassObject object;
   *object.classId() = classId_;
@@ -691,17 +829,35 @@ serialization::AllocationClassObject AllocationClass::saveState() const {
   return object;
 }
 
+size_t AllocationClass::getNumMagazineAllocs() const {
+  if (!magazines_) {
+    return 0;
+  }
+  size_t numAllocs = 0;
+  for (const auto& magazine : magazines_->accessAllThreads()) {
+    numAllocs += magazine.size.load(std::memory_order_relaxed);
+  }
+  return numAllocs;
+}
+
 ACStats AllocationClass::getStats() const {
-  return lock_->lock_combine([this]() -> ACStats {
+  // allocations cached in magazines are free. This is racy with respect to the
+  // counts below, so clamp the active allocations.
+  const unsigned long long nMagazineAllocs = getNumMagazineAllocs();
+  return lock_->lock_combine([this, nMagazineAllocs]() -> ACStats {
     const auto freeAllocsInCurrSlab =
         canAllocateFromCurrentSlabLocked()
             ? (Slab::kSize - currOffset_) / allocationSize_
             : 0;
     const unsigned long long perSlab = getAllocsPerSlab();
     const unsigned long long nSlabsAllocated = allocatedSlabs_.size();
-    const unsigned long long nFreedAllocs = freedAllocations_.size();
+    const unsigned long long nFreedAllocs =
+        freedAllocations_.size() + nMagazineAllocs;
+    const unsigned long long nUsedAllocs = nSlabsAllocated * perSlab;
     const unsigned long long nActiveAllocs =
-        nSlabsAllocated * perSlab - nFreedAllocs - freeAllocsInCurrSlab;
+        nUsedAllocs > nFreedAllocs + freeAllocsInCurrSlab
+            ? nUsedAllocs - nFreedAllocs - freeAllocsInCurrSlab
+            : 0;
     return {allocationSize_, perSlab,       nSlabsAllocated, freeSlabs_.size(),
             nFreedAllocs,    nActiveAllocs, isFull()};
   });
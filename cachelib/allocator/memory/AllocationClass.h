@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <folly/SpinLock.h>
+#include <folly/ThreadLocal.h>
 #include <folly/lang/Aligned.h>
 #include <folly/synchronization/DistributedMutex.h>
 
+#include <array>
 #include <atomic>
 #include <mutex>
 #include <unordered_map>
@@ -49,33 +52,45 @@ enum class SlabIterationStatus {
 // from Slabs
 class AllocationClass {
  public:
-  // @param classId   the id corresponding to this allocation class
-  // @param poolId    the poolId corresponding to this allocation class
-  // @param allocSize the size of allocations that this allocation class
-  //                  handles.
-  // @param s         the slab allocator for fetching the header info.
+  // maximum number of free allocations a thread can cache per allocation
+  // class.
+  static constexpr uint32_t kMaxMagazineSize = 64;
+
+  // @param classId      the id corresponding to this allocation class
+  // @param poolId       the poolId corresponding to this allocation class
+  // @param allocSize    the size of allocations that this allocation class
+  //                     handles.
+  // @param s            the slab allocator for fetching the header info.
+  // @param magazineSize number of free allocations each thread caches for
+  //                     this class. 0 disables the per-thread caches.
   //
   // @throw std::invalid_argument if the classId is invalid or the allocSize
-  //        is invalid.
+  //        or magazineSize is invalid.
   AllocationClass(ClassId classId,
                   PoolId poolId,
                   uint32_t allocSize,
-                  const SlabAllocator& s);
+                  const SlabAllocator& s,
+                  uint32_t magazineSize = 0);
 
   // restore this AllocationClass from the serialized data.
-  // @param object  Object that contains the data to restore AllocationClass
-  // @param poolId  the poolId corresponding to this allocation class
-  // @param s       the slab allocator for fetching the header info. s must be
-  //                a restorable slab allocator which was previously used with
-  //                the same allocation class object.
+  // @param object       Object that contains the data to restore
+  //                     AllocationClass
+  // @param poolId       the poolId corresponding to this allocation class
+  // @param s            the slab allocator for fetching the header info. s
+  //                     must be a restorable slab allocator which was
+  //                     previously used with the same allocation class
+  //                     object.
+  // @param magazineSize number of free allocations each thread caches for
+  //                     this class. 0 disables the per-thread caches.
   //
   // @throw std::invalid_argument if the classId is invalid or the allocSize
-  //        is invalid.
+  //        or magazineSize is invalid.
   // @throw std::logic_error if the allocation class cannot be restored with
   //        this allocator
   AllocationClass(const serialization::AllocationClassObject& object,
                   PoolId poolId,
-                  const SlabAllocator& s);
+                  const SlabAllocator& s,
+                  uint32_t magazineSize = 0);
 
   AllocationClass(const AllocationClass&) = delete;
   AllocationClass& operator=(const AllocationClass&) = delete;
@@ -94,6 +109,10 @@ class AllocationClass {
     return static_cast<unsigned int>(Slab::kSize / allocationSize_);
   }
 
+  // returns the number of free allocations each thread caches for this
+  // class.
+  uint32_t getMagazineSize() const noexcept { return magazineSize_; }
+
   // fetch stats about this allocation class.
   ACStats getStats() const;
 
@@ -103,13 +122,19 @@ class AllocationClass {
   bool isFull() const noexcept { return !canAllocate_; }
 
   // allocate memory corresponding to the allocation size of this
-  // AllocationClass.
+  // AllocationClass. With magazines enabled, this is served from the calling
+  // thread's magazine, which is refilled in batches from the class.
   //
   // @return  ptr to the memory of allocationSize_ chunk or nullptr if we
   //          don't have any free memory. The caller will have to add a slab
   //          to this slab class to make further allocations out of it.
   void* allocate();
 
+  // return the free allocations cached in the magazines of all threads back
+  // to this class. Afterwards every free allocation is accounted by the
+  // class until threads allocate or free again.
+  void flushMagazines();
+
   // @param ctx     release context for the slab owning this alloc
   // @param memory  memory to check
   //
@@ -205,7 +230,9 @@ class AllocationClass {
     return SlabIterationStatus::kFinishedCurrentSlabAndContinue;
   }
 
-  // release the memory back to the slab class.
+  // release the memory back to the slab class. With magazines enabled, this
+  // goes into the calling thread's magazine, which is flushed in batches
+  // back to the class once full.
   //
   // @param memory  memory to be released.
   // @throws std::invalid_argument if the memory does not belong to a slab of
@@ -222,7 +249,9 @@ class AllocationClass {
   void* addSlabAndAllocate(Slab* slab);
 
   // Releasing a slab is a two step process.
-  // 1. Mark a slab for release, by calling `startSlabRelease`.
+  // 1. Mark a slab for release, by calling `startSlabRelease`. This flushes
+  //    the magazines and keeps them bypassed until the release completes or
+  //    is aborted, so that no free allocation of the slab is cached.
   // 2. Free all the activeAllocations
   // 3. Actually release the slab, by calling `completeSlabRelease`.
   //    In some scenario (i.e. when the slab is already released in step 1),
@@ -302,8 +331,9 @@ class AllocationClass {
   // precondition:  The object must have been instantiated with a restorable
   // slab allocator does not own the memory. serialization must happen without
   // any reader or writer present. All active slab releases must have
-  // completed.  Any modification of this object afterwards
-  // will result in an invalid, inconsistent state for the serialized data.
+  // completed and the magazines must have been flushed. Any modification of
+  // this object afterwards will result in an invalid, inconsistent state for
+  // the serialized data.
   //
   // @throw std::logic_error if the object state can not be serialized
   serialization::AllocationClassObject saveState() const;
@@ -399,6 +429,13 @@ class AllocationClass {
   // acquires a new slab for this allocation class.
   void addSlabLocked(Slab* slab);
 
+  // release the memory back to the slab class, marking it as freed instead
+  // if its slab is being released. Must be called under the lock_.
+  //
+  // @throws std::runtime_error if the slab release state is inconsistent.
+  // @throws std::invalid_argument if the memory is already freed.
+  void freeLocked(const SlabHeader* header, const Slab* slab, void* memory);
+
   // allocate memory corresponding to the allocation size of this
   // AllocationClass.
   //
@@ -489,9 +526,67 @@ class AllocationClass {
   // in a slab.
   static constexpr unsigned int kForEachAllocPrefetchOffset = 16;
 
+  // per-thread cache of free allocations for this class. Allocations are
+  // taken from and freed into the calling thread's magazine without grabbing
+  // the lock_. The magazine lock is only contended when another thread
+  // flushes all the magazines.
+  struct Magazine {
+    explicit Magazine(AllocationClass& ac) : parent(ac) {}
+    Magazine(const Magazine&) = delete;
+    Magazine& operator=(const Magazine&) = delete;
+
+    // return the cached allocations when the thread exits
+    ~Magazine();
+
+    AllocationClass& parent;
+    folly::SpinLock lock;
+    // read without the lock for stats
+    std::atomic<uint32_t> size{0};
+    std::array<void*, kMaxMagazineSize> allocs;
+  };
+  struct MagazineTag {};
+  using Magazines = folly::ThreadLocal<Magazine, MagazineTag>;
+
+  // true while a slab release is in progress. Magazines must not cache free
+  // allocations in the meanwhile since they would never be freed back to the
+  // slab being released.
+  bool magazinesBypassed() const noexcept {
+    return slabReleasesStarting_.load() > 0 || activeReleases_.load() > 0;
+  }
+
+  // allocate from the calling thread's magazine, refilling half of it from
+  // the class if empty.
+  //
+  // @return  the allocation or nullptr if the magazine is bypassed or the
+  //          class has no free memory.
+  void* allocateFromMagazine();
+
+  // free into the calling thread's magazine, flushing half of it back to the
+  // class if full.
+  //
+  // @return  true if the memory was cached in the magazine.
+  bool freeToMagazine(void* memory);
+
+  // return the given allocations back to the class under one lock.
+  void freeBatch(void* const* allocs, size_t numAllocs);
+
+  // number of free allocations currently cached in the magazines of all
+  // threads.
+  size_t getNumMagazineAllocs() const;
+
+  // number of free allocations that each thread caches
+  const uint32_t magazineSize_{0};
+
+  // number of threads inside startSlabRelease
+  std::atomic<int64_t> slabReleasesStarting_{0};
+
   // Allow access to private members by unit tests
   friend class facebook::cachelib::tests::AllocTestBase;
   FRIEND_TEST(AllocationClassTest, ReleaseSlabMultithread);
+
+  // the magazines are destroyed first since destroying them frees their
+  // allocations back to this class. Only created if magazineSize_ > 0.
+  std::unique_ptr<Magazines> magazines_;
 };
 } // namespace cachelib
 } // namespace facebook
@@ -45,6 +45,9 @@ class AllocTestBase;
 // kMinAllocPower(6) = 16 bits for storing the alloc index. This leaves the
 // remaining 32 - (kNumSlabBits - kMinAllocPower) = 16 bits  for the  slab
 // index. Hence we can index 256 GiB of memory.
+// With a different slab size (CACHELIB_SLAB_SIZE_BITS) the split moves: every
+// extra slab bit goes to the alloc index and is taken from the slab index, so
+// the addressable memory stays the same.
 
 // In multi-tier design:
 // kNumSlabIds and kMinAllocPower remains unchanged. The tier id occupies the
@@ -354,6 +357,20 @@ class CACHELIB_PACKED_ATTR CompressedPtr5B {
   friend class facebook::cachelib::tests::AllocTestBase;
 };
 
+// Returns the size in bytes of the narrowest compressed pointer that can
+// address a cache of cacheSize bytes, or 0 if no compressed pointer can. Items
+// embed compressed pointers, so the width is fixed by the cache trait and this
+// is meant for picking the trait at startup.
+constexpr size_t getMinCompressedPtrBytes(size_t cacheSize) noexcept {
+  if (cacheSize <= CompressedPtr4B::getMaxAddressableSize()) {
+    return sizeof(CompressedPtr4B);
+  }
+  if (cacheSize <= CompressedPtr5B::getMaxAddressableSize()) {
+    return sizeof(CompressedPtr5B);
+  }
+  return 0;
+}
+
 template <typename PtrType, typename AllocatorT, typename CompressedPtrType>
 class PtrCompressor {
  public:
@@ -26,6 +26,21 @@ void checkConfig(const MemoryAllocator::Config& config) {
   if (config.allocSizes.size() > MemoryAllocator::kMaxClasses) {
     throw std::invalid_argument("Too many allocation classes");
   }
+  if (config.allocMagazineSize > AllocationClass::kMaxMagazineSize) {
+    throw std::invalid_argument(
+        folly::sformat("Alloc magazine size {} is larger than {}",
+                       config.allocMagazineSize,
+                       AllocationClass::kMaxMagazineSize));
+  }
+}
+
+SlabAllocator::Config createSlabAllocatorConfig(
+    const MemoryAllocator::Config& config) {
+  SlabAllocator::Config slabConfig{config.disableFullCoredump,
+                                   config.lockMemory};
+  slabConfig.hugePageSize = config.hugePageSize;
+  slabConfig.hugePageFallback = config.hugePageFallback;
+  return slabConfig;
 }
 } // namespace
 
@@ -36,15 +51,14 @@ MemoryAllocator::MemoryAllocator(Config config,
       slabAllocator_(memoryStart,
                      memSize,
                      {config_.disableFullCoredump, config_.lockMemory}),
-      memoryPoolManager_(slabAllocator_) {
+      memoryPoolManager_(slabAllocator_, config_.allocMagazineSize) {
   checkConfig(config_);
 }
 
 MemoryAllocator::MemoryAllocator(Config config, size_t memSize)
     : config_(std::move(config)),
-      slabAllocator_(memSize,
-                     {config_.disableFullCoredump, config_.lockMemory}),
-      memoryPoolManager_(slabAllocator_) {
+      slabAllocator_(memSize, createSlabAllocatorConfig(config_)),
+      memoryPoolManager_(slabAllocator_, config_.allocMagazineSize) {
   checkConfig(config_);
 }
 
@@ -52,17 +66,21 @@ MemoryAllocator::MemoryAllocator(
     const serialization::MemoryAllocatorObject& object,
     void* memoryStart,
     size_t memSize,
-    bool disableCoredump)
+    bool disableCoredump,
+    uint32_t allocMagazineSize)
     : config_(std::set<uint32_t>{object.allocSizes()->begin(),
                                  object.allocSizes()->end()},
               *object.enableZeroedSlabAllocs(),
               disableCoredump,
-              *object.lockMemory()),
+              *object.lockMemory(),
+              allocMagazineSize),
       slabAllocator_(*object.slabAllocator(),
                      memoryStart,
                      memSize,
                      {config_.disableFullCoredump, config_.lockMemory}),
-      memoryPoolManager_(*object.memoryPoolManager(), slabAllocator_) {
+      memoryPoolManager_(*object.memoryPoolManager(),
+                         slabAllocator_,
+                         config_.allocMagazineSize) {
   checkConfig(config_);
 }
 
@@ -133,6 +151,10 @@ ClassId MemoryAllocator::getAllocationClassId(PoolId poolId,
 }
 
 serialization::MemoryAllocatorObject MemoryAllocator::saveState() {
+  for (const auto pid : memoryPoolManager_.getPoolIds()) {
+    memoryPoolManager_.getPoolById(pid).flushAllocMagazines();
+  }
+
   serialization::MemoryAllocatorObject object;
   object.allocSizes()->insert(config_.allocSizes.begin(),
                               config_.allocSizes.end());
@@ -149,10 +171,12 @@ SlabReleaseContext MemoryAllocator::startSlabRelease(
     ClassId receiver,
     SlabReleaseMode mode,
     const void* hint,
-    SlabReleaseAbortFn shouldAbortFn) {
+    SlabReleaseAbortFn shouldAbortFn,
+    SlabReleaseGraceFn graceFn) {
   auto& pool = memoryPoolManager_.getPoolById(pid);
   return pool.startSlabRelease(victim, receiver, mode, hint,
-                               config_.enableZeroedSlabAllocs, shouldAbortFn);
+                               config_.enableZeroedSlabAllocs,
+                               std::move(shouldAbortFn), std::move(graceFn));
 }
 
 bool MemoryAllocator::isAllocFreed(const SlabReleaseContext& ctx,
@@ -87,11 +87,13 @@ class MemoryAllocator {
     Config(std::set<uint32_t> sizes,
            bool zeroOnRelease,
            bool disableCoredump,
-           bool _lockMemory)
+           bool _lockMemory,
+           uint32_t magazineSize = 0)
         : allocSizes(std::move(sizes)),
           enableZeroedSlabAllocs(zeroOnRelease),
           disableFullCoredump(disableCoredump),
-          lockMemory(_lockMemory) {}
+          lockMemory(_lockMemory),
+          allocMagazineSize(magazineSize) {}
 
     // Hint to determine the allocation class sizes
     std::set<uint32_t> allocSizes;
@@ -109,6 +111,20 @@ class MemoryAllocator {
     // allocator is not shared, user needs to ensure there are appropriate
     // rlimits setup to lock the memory.
     bool lockMemory{false};
+
+    // Number of free allocations each thread caches per allocation class, so
+    // that allocating and freeing does not grab the allocation class lock
+    // every time. 0 disables the per-thread caches. This is not persisted.
+    uint32_t allocMagazineSize{0};
+
+    // Size of the hugetlb pages backing the memory when the allocator maps
+    // its own memory. 0 uses regular pages. Ignored for caller provided
+    // memory.
+    size_t hugePageSize{0};
+
+    // Fall back to regular pages when the huge pages can not be reserved
+    // instead of throwing.
+    bool hugePageFallback{true};
   };
 
   // Creates a memory allocator out of the caller allocated memory region. The
@@ -146,10 +162,13 @@ class MemoryAllocator {
   // @param memSize         the size of the memory region that was originally
   //                        used to create this memory allocator
   // @param disableCoredump exclude mapped region from core dumps
+  // @param allocMagazineSize number of free allocations each thread caches
+  //                        per allocation class. 0 disables it.
   MemoryAllocator(const serialization::MemoryAllocatorObject& object,
                   void* memoryStart,
                   size_t memSize,
-                  bool disableCoredump);
+                  bool disableCoredump,
+                  uint32_t allocMagazineSize = 0);
 
   MemoryAllocator(const MemoryAllocator&) = delete;
   MemoryAllocator& operator=(const MemoryAllocator&) = delete;
@@ -157,6 +176,11 @@ class MemoryAllocator {
   // returns true if the memory allocator is restorable. false otherwise.
   bool isRestorable() const noexcept { return slabAllocator_.isRestorable(); }
 
+  // returns the start of the memory managed by this allocator.
+  const void* getMemoryStart() const noexcept {
+    return slabAllocator_.getMemoryStart();
+  }
+
   // allocate memory of corresponding size.
   //
   // @param id    the pool id to be used for this allocation.
@@ -272,6 +296,9 @@ class MemoryAllocator {
   //              random slab is selected from the pool and allocation class.
   // @param  shouldAbortFn invoked in the code to see if this release slab
   //         process should be aborted
+  // @param  graceFn invoked before a slab that is already released is handed
+  //         out again. Callers that complete the release themselves wait
+  //         for their readers before completeSlabRelease.
   //
   // @return  a valid context. If the slab is already released, then the
   //          caller needs to do nothing. If it is not released, then the caller
@@ -290,7 +317,8 @@ class MemoryAllocator {
       ClassId receiver,
       SlabReleaseMode mode,
       const void* hint = nullptr,
-      SlabReleaseAbortFn shouldAbortFn = []() { return false; });
+      SlabReleaseAbortFn shouldAbortFn = []() { return false; },
+      SlabReleaseGraceFn graceFn = {});
 
   // Check if an alloc is free (during slab release)
   //
@@ -383,6 +411,32 @@ class MemoryAllocator {
     return slabAllocator_.numSlabsReclaimable();
   }
 
+  // Slabs released in kAdvise mode are advised away in batches of this many
+  // slabs per pool, with one madvise call per run of contiguous slabs. A
+  // released slab waiting for its batch counts neither as used nor as
+  // advised, so callers flush the batches with adviseReleasedSlabs() once
+  // they are done releasing. 1 advises every slab right away. Not persisted.
+  void setSlabAdviseBatchSize(size_t batchSize) noexcept {
+    slabAllocator_.setAdviseBatchSize(batchSize);
+  }
+
+  // advise away the released slabs of all the pools that wait for their
+  // batch to fill up.
+  //
+  // @return the number of slabs advised away
+  size_t adviseReleasedSlabs() {
+    size_t numAdvised = 0;
+    for (auto pid : memoryPoolManager_.getPoolIds()) {
+      numAdvised += memoryPoolManager_.getPoolById(pid).adviseReleasedSlabs();
+    }
+    return numAdvised;
+  }
+
+  // number of madvise calls made to advise slabs away
+  uint64_t getNumSlabAdviseCalls() const noexcept {
+    return slabAllocator_.getNumAdviseCalls();
+  }
+
   // get the PoolId corresponding to the pool name.
   //
   // @param name  the name of the pool
@@ -439,6 +493,23 @@ class MemoryAllocator {
     return memoryPoolManager_.getPoolById(id);
   }
 
+  // place the slabs that the pool acquires from now on according to the
+  // NUMA policy. This is not persisted.
+  //
+  // @throw std::invalid_argument if the pool id or the policy is invalid.
+  void setPoolNumaPolicy(PoolId id, NumaPolicy policy) {
+    memoryPoolManager_.getPoolById(id).setNumaPolicy(std::move(policy));
+  }
+
+  // returns the number of slabs of every pool backed by each NUMA node. Slabs
+  // whose memory is not resident are counted under node -1.
+  //
+  // @throw std::system_error if the NUMA nodes can not be queried
+  std::unordered_map<PoolId, std::map<int, uint64_t>> getNumSlabsPerNumaNode()
+      const {
+    return memoryPoolManager_.getNumSlabsPerNumaNode();
+  }
+
   // obtain list of pools that are currently occupying more memory than their
   // current limit.
   std::set<PoolId> getPoolsOverLimit() const {
@@ -479,6 +550,13 @@ class MemoryAllocator {
     return AllocInfo{header->poolId, header->classId, header->allocSize};
   }
 
+  // @param memory  the memory belonging to the slab allocator
+  // @return        true if the slab of the memory is being released
+  bool isMarkedForRelease(const void* memory) const noexcept {
+    const auto* header = slabAllocator_.getSlabHeader(memory);
+    return header != nullptr && header->isMarkedForRelease();
+  }
+
   // fetch the allocation size for the pool id and class id.
   //
   // @param pid  the pool id
@@ -516,7 +594,8 @@ class MemoryAllocator {
   //          outside of the allocation sizes for the memory pool.
   ClassId getAllocationClassId(PoolId poolId, uint32_t nBytes) const;
 
-  // for saving the state of the memory allocator
+  // for saving the state of the memory allocator. This returns the free
+  // allocations cached by threads to their allocation classes first.
   //
   // precondition:  The object must have been instantiated with a restorable
   // slab allocator that does not own the memory. serialization must happen
@@ -588,6 +667,24 @@ class MemoryAllocator {
   //                   allocation class.
   template <typename AllocTraversalFn>
   uint64_t forEachAllocation(AllocTraversalFn&& callback) {
+    return forEachAllocation([](uint32_t) { return true; },
+                             std::forward<AllocTraversalFn>(callback),
+                             [](uint32_t, SlabIterationStatus) {});
+  }
+
+  // Same as above, but only traverses the slabs for which @shouldVisit
+  // returns true when called with the slab index, and calls @onSlabDone with
+  // the slab index and the status of the traversal of every slab it was
+  // called for, including the skipped and the aborted ones.
+  //
+  // @return           The number of slabs skipped, not counting the ones
+  //                   @shouldVisit returned false for
+  template <typename SlabFilterFn,
+            typename AllocTraversalFn,
+            typename SlabDoneFn>
+  uint64_t forEachAllocation(SlabFilterFn&& shouldVisit,
+                             AllocTraversalFn&& callback,
+                             SlabDoneFn&& onSlabDone) {
     uint64_t slabSkipped = 0;
     for (unsigned int idx = 0; idx < slabAllocator_.getNumUsableSlabs();
          ++idx) {
@@ -603,9 +700,13 @@ class MemoryAllocator {
         ++slabSkipped;
         continue;
       }
+      if (!shouldVisit(idx)) {
+        continue;
+      }
       auto& pool = memoryPoolManager_.getPoolById(poolId);
-      auto slabIterationStatus = pool.forEachAllocation(
-          classId, slab, std::forward<AllocTraversalFn>(callback));
+      auto slabIterationStatus =
+          pool.forEachAllocation(classId, slab, callback);
+      onSlabDone(idx, slabIterationStatus);
       if (slabIterationStatus ==
           SlabIterationStatus::kSkippedCurrentSlabAndContinue) {
         ++slabSkipped;
@@ -616,6 +717,18 @@ class MemoryAllocator {
     return slabSkipped;
   }
 
+  // @return the number of slabs of this allocator, including the advised
+  //         away ones
+  uint32_t getNumSlabs() const noexcept {
+    return slabAllocator_.getNumUsableAndAdvisedSlabs();
+  }
+
+  // @return the index of the slab holding @memory, which must be a valid
+  //         allocation from this allocator
+  uint32_t getSlabIdx(const void* memory) const noexcept {
+    return slabAllocator_.slabIdx(slabAllocator_.getSlabForMemory(memory));
+  }
+
   // returns a default set of allocation sizes with given size range and factor.
   //
   // @param factor      the factor by which the alloc sizes grow.
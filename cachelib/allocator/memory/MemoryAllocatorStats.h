@@ -82,6 +82,10 @@ struct MPStats {
   // number of slabs advised away currently for the pool.
   uint64_t numSlabAdvise;
 
+  // number of slabs that could not be placed according to the pool's NUMA
+  // policy.
+  uint64_t numSlabNumaPlacementFailures{0};
+
   // number of slabs under this memory pool allocated from the slab allocator.
   // this includes freeSlabs.
   unsigned long long allocatedSlabs() const noexcept {
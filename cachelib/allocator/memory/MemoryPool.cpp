@@ -26,6 +26,7 @@
 #pragma GCC diagnostic ignored "-Wconversion"
 #include <folly/Format.h>
 #pragma GCC diagnostic pop
+#include <folly/logging/xlog.h>
 
 using namespace facebook::cachelib;
 using LockHolder = std::unique_lock<std::mutex>;
@@ -44,10 +45,12 @@ std::vector<uint32_t> MemoryPool::createMcSizesFromSerialized(
 MemoryPool::ACVector MemoryPool::createMcFromSerialized(
     const serialization::MemoryPoolObject& object,
     PoolId poolId,
-    SlabAllocator& alloc) {
+    SlabAllocator& alloc,
+    uint32_t allocMagazineSize) {
   MemoryPool::ACVector ac;
   for (const auto& allocClassObject : *object.ac()) {
-    ac.emplace_back(new AllocationClass(allocClassObject, poolId, alloc));
+    ac.emplace_back(new AllocationClass(allocClassObject, poolId, alloc,
+                                        allocMagazineSize));
   }
   return ac;
 }
@@ -55,24 +58,26 @@ MemoryPool::ACVector MemoryPool::createMcFromSerialized(
 MemoryPool::MemoryPool(PoolId id,
                        size_t poolSize,
                        SlabAllocator& alloc,
-                       const std::set<uint32_t>& allocSizes)
+                       const std::set<uint32_t>& allocSizes,
+                       uint32_t allocMagazineSize)
     : id_(id),
       maxSize_{poolSize},
       slabAllocator_(alloc),
       acSizes_(allocSizes.begin(), allocSizes.end()),
-      ac_(createAllocationClasses()) {
+      ac_(createAllocationClasses(allocMagazineSize)) {
   checkState();
 }
 
 MemoryPool::MemoryPool(const serialization::MemoryPoolObject& object,
-                       SlabAllocator& alloc)
+                       SlabAllocator& alloc,
+                       uint32_t allocMagazineSize)
     : id_(*object.id()),
       maxSize_(*object.maxSize()),
       currSlabAllocSize_(*object.currSlabAllocSize()),
       currAllocSize_(*object.currAllocSize()),
       slabAllocator_(alloc),
       acSizes_(createMcSizesFromSerialized(object)),
-      ac_(createMcFromSerialized(object, getId(), alloc)),
+      ac_(createMcFromSerialized(object, getId(), alloc, allocMagazineSize)),
       curSlabsAdvised_{static_cast<uint64_t>(*object.numSlabsAdvised())},
       nSlabResize_{static_cast<unsigned int>(*object.numSlabResize())},
       nSlabRebalance_{static_cast<unsigned int>(*object.numSlabRebalance())} {
@@ -141,7 +146,8 @@ void MemoryPool::checkState() const {
   }
 }
 
-MemoryPool::ACVector MemoryPool::createAllocationClasses() const {
+MemoryPool::ACVector MemoryPool::createAllocationClasses(
+    uint32_t allocMagazineSize) const {
   ACVector ac;
   ClassId id = 0;
   for (const auto size : acSizes_) {
@@ -149,7 +155,8 @@ MemoryPool::ACVector MemoryPool::createAllocationClasses() const {
       throw std::invalid_argument(
           folly::sformat("Invalid allocation class size {}", size));
     }
-    ac.emplace_back(new AllocationClass(id++, getId(), size, slabAllocator_));
+    ac.emplace_back(new AllocationClass(id++, getId(), size, slabAllocator_,
+                                        allocMagazineSize));
   }
   XDCHECK(std::is_sorted(ac.begin(),
                          ac.end(),
@@ -234,7 +241,8 @@ ClassId MemoryPool::getAllocationClassId(const void* memory) const {
   return classId;
 }
 
-Slab* MemoryPool::getSlabLocked() noexcept {
+Slab* MemoryPool::getSlabLocked(
+    std::shared_ptr<const NumaPolicy>& placement) noexcept {
   {
     // check again after getting the lock.
     if (allSlabsAllocated()) {
@@ -258,10 +266,33 @@ Slab* MemoryPool::getSlabLocked() noexcept {
   // if slab allocator failed to allocate, decrement the size.
   if (slab == nullptr) {
     currSlabAllocSize_ -= Slab::kSize;
+  } else if (!numaPolicy_->isDefault()) {
+    placement = numaPolicy_;
   }
   return slab;
 }
 
+void MemoryPool::placeSlab(Slab* slab, const NumaPolicy& policy) noexcept {
+  if (policy.isDefault()) {
+    return;
+  }
+  try {
+    policy.apply(slab, Slab::kSize);
+  } catch (const std::exception& e) {
+    ++nSlabNumaPlacementFailures_;
+    XLOG_EVERY_MS(WARN, 10000) << folly::sformat(
+        "Unable to place slab of pool {} with NUMA policy {}: {}", id_,
+        policy.toString(), e.what());
+  }
+}
+
+void MemoryPool::setNumaPolicy(NumaPolicy policy) {
+  policy.validate();
+  auto ptr = std::make_shared<const NumaPolicy>(std::move(policy));
+  LockHolder l(lock_);
+  numaPolicy_ = std::move(ptr);
+}
+
 bool MemoryPool::provision(const std::vector<uint32_t>& slabsDistribution) {
   if (slabsDistribution.size() != ac_.size()) {
     throw std::invalid_argument(
@@ -280,13 +311,18 @@ bool MemoryPool::provision(const std::vector<uint32_t>& slabsDistribution) {
   uint32_t totalSlabsToAllocate =
       std::accumulate(slabsDistribution.begin(), slabsDistribution.end(), 0);
   std::list<Slab*> slabs;
+  std::vector<std::pair<Slab*, std::shared_ptr<const NumaPolicy>>> toPlace;
   for (uint32_t i = 0; i < totalSlabsToAllocate; i++) {
-    auto slab = getSlabLocked();
+    std::shared_ptr<const NumaPolicy> placement;
+    auto slab = getSlabLocked(placement);
     if (slab == nullptr) {
       freeAllSlabs(slabs);
       return false;
     }
     slabs.push_back(slab);
+    if (placement) {
+      toPlace.emplace_back(slab, std::move(placement));
+    }
   }
   for (size_t i = 0; i < slabsDistribution.size(); i++) {
     for (size_t j = 0; j < slabsDistribution[i]; ++j) {
@@ -294,6 +330,11 @@ bool MemoryPool::provision(const std::vector<uint32_t>& slabsDistribution) {
       slabs.pop_front();
     }
   }
+  l.unlock();
+
+  for (const auto& [slab, placement] : toPlace) {
+    placeSlab(slab, *placement);
+  }
   return true;
 }
 
@@ -330,7 +371,8 @@ void* MemoryPool::allocate(uint32_t size) {
   }
 
   // see if we have a slab to add to the allocation class.
-  auto slab = getSlabLocked();
+  std::shared_ptr<const NumaPolicy> placement;
+  auto slab = getSlabLocked(placement);
   if (slab == nullptr) {
     // out of memory
     return nullptr;
@@ -341,6 +383,14 @@ void* MemoryPool::allocate(uint32_t size) {
   XDCHECK_NE(nullptr, alloc);
 
   currAllocSize_ += allocSize;
+
+  // placing migrates the resident pages of the slab, which must not hold up
+  // the slow path of the other allocation classes. The pages can be used
+  // while they are migrated.
+  l.unlock();
+  if (placement) {
+    placeSlab(slab, *placement);
+  }
   return alloc;
 }
 
@@ -352,6 +402,12 @@ void MemoryPool::free(void* alloc) {
   currAllocSize_ -= ac.getAllocSize();
 }
 
+void MemoryPool::flushAllocMagazines() {
+  for (auto& ac : ac_) {
+    ac->flushMagazines();
+  }
+}
+
 serialization::MemoryPoolObject MemoryPool::saveState() const {
   if (!slabAllocator_.isRestorable()) {
     throw std::logic_error("Memory Pool can not be restored");
@@ -367,6 +423,9 @@ serialization::MemoryPoolObject MemoryPool::saveState() const {
   for (auto slab : freeSlabs_) {
     object.freeSlabIdxs()->push_back(slabAllocator_.slabIdx(slab));
   }
+  for (auto slab : pendingAdviseSlabs_) {
+    object.freeSlabIdxs()->push_back(slabAllocator_.slabIdx(slab));
+  }
 
   for (auto size : acSizes_) {
     object.acSizes()->push_back(size);
@@ -403,15 +462,20 @@ void MemoryPool::releaseSlab(SlabReleaseMode mode,
     ++nSlabResize_;
     break;
 
-  case SlabReleaseMode::kAdvise:
-    if (slabAllocator_.adviseSlab(const_cast<Slab*>(slab))) {
-      ++curSlabsAdvised_;
-    } else {
+  case SlabReleaseMode::kAdvise: {
+    bool batchFull = false;
+    {
       LockHolder l(lock_);
-      freeSlabs_.push_back(const_cast<Slab*>(slab));
+      pendingAdviseSlabs_.push_back(const_cast<Slab*>(slab));
+      batchFull =
+          pendingAdviseSlabs_.size() >= slabAllocator_.getAdviseBatchSize();
     }
     currSlabAllocSize_ -= Slab::kSize;
+    if (batchFull) {
+      adviseReleasedSlabs();
+    }
     break;
+  }
 
   case SlabReleaseMode::kRebalance:
     if (receiverClassId != Slab::kInvalidClassId) {
@@ -436,19 +500,43 @@ void MemoryPool::releaseSlab(SlabReleaseMode mode,
 }
 
 size_t MemoryPool::reclaimSlabsAndGrow(size_t numSlabs) {
-  unsigned int numReclaimed = 0;
-  for (size_t i = 0; i < numSlabs; i++) {
-    auto slab = slabAllocator_.reclaimSlab(id_);
-    if (!slab) {
-      break;
-    }
-    XDCHECK(slabAllocator_.getSlabHeader(slab)->poolId == getId());
+  const auto slabs = slabAllocator_.reclaimSlabs(id_, numSlabs);
+  std::shared_ptr<const NumaPolicy> placement;
+  {
     LockHolder l(lock_);
+    placement = numaPolicy_;
+  }
+  for (auto* slab : slabs) {
+    placeSlab(slab, *placement);
+  }
+
+  LockHolder l(lock_);
+  for (auto* slab : slabs) {
+    XDCHECK(slabAllocator_.getSlabHeader(slab)->poolId == getId());
     freeSlabs_.push_back(slab);
-    --curSlabsAdvised_;
-    ++numReclaimed;
   }
-  return numReclaimed;
+  curSlabsAdvised_ -= slabs.size();
+  return slabs.size();
+}
+
+size_t MemoryPool::adviseReleasedSlabs() {
+  std::vector<Slab*> slabs;
+  {
+    LockHolder l(lock_);
+    slabs.swap(pendingAdviseSlabs_);
+  }
+  if (slabs.empty()) {
+    return 0;
+  }
+
+  const auto numSlabs = slabs.size();
+  const auto failed = slabAllocator_.adviseSlabs(std::move(slabs));
+  curSlabsAdvised_ += numSlabs - failed.size();
+  if (!failed.empty()) {
+    LockHolder l(lock_);
+    freeSlabs_.insert(freeSlabs_.end(), failed.begin(), failed.end());
+  }
+  return numSlabs - failed.size();
 }
 
 SlabReleaseContext MemoryPool::releaseFromFreeSlabs() {
@@ -470,7 +558,8 @@ SlabReleaseContext MemoryPool::startSlabRelease(
     SlabReleaseMode mode,
     const void* hint,
     bool zeroOnRelease,
-    SlabReleaseAbortFn shouldAbortFn) {
+    SlabReleaseAbortFn shouldAbortFn,
+    SlabReleaseGraceFn graceFn) {
   if (receiver != Slab::kInvalidClassId &&
       mode != SlabReleaseMode::kRebalance) {
     throw std::invalid_argument(folly::sformat(
@@ -495,7 +584,12 @@ SlabReleaseContext MemoryPool::startSlabRelease(
   // slabs. the caller should not have to call completeSlabRelease()
   if (context.isReleased()) {
     XDCHECK(context.getActiveAllocations().empty());
-    // The caller does not need to call completeSlabRelease.
+    // The caller does not need to call completeSlabRelease. The allocations
+    // of a slab taken from a class were freed just now, so readers may still
+    // refer to them.
+    if (graceFn && victim != Slab::kInvalidClassId) {
+      graceFn();
+    }
     releaseSlab(context.getMode(), context.getSlab(), zeroOnRelease, receiver);
   }
   return context;
@@ -554,7 +648,12 @@ MPStats MemoryPool::getStats() const {
   const auto slabsUnAllocated =
       availableMemory > 0 ? availableMemory / Slab::kSize - freeSlabs_.size()
                           : 0;
-  return MPStats{std::move(classIds), std::move(acStats), freeSlabs_.size(),
-                 slabsUnAllocated,    nSlabResize_,       nSlabRebalance_,
-                 curSlabsAdvised_};
+  return MPStats{std::move(classIds),
+                 std::move(acStats),
+                 freeSlabs_.size(),
+                 slabsUnAllocated,
+                 nSlabResize_,
+                 nSlabRebalance_,
+                 curSlabsAdvised_,
+                 nSlabNumaPlacementFailures_};
 }
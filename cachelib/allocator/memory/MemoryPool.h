@@ -24,6 +24,7 @@
 
 #include "cachelib/allocator/memory/AllocationClass.h"
 #include "cachelib/allocator/memory/MemoryAllocatorStats.h"
+#include "cachelib/allocator/memory/NumaPolicy.h"
 #include "cachelib/allocator/memory/Slab.h"
 
 #pragma GCC diagnostic push
@@ -57,20 +58,26 @@ class MemoryPool {
   // @param  allocSizes the set of allocation class sizes for this pool,
   //                    sorted in increasing order. The largest size should be
   //                    less than Slab::kSize.
+  // @param  allocMagazineSize  number of free allocations each thread caches
+  //                            per allocation class. 0 disables it.
   // @throw std::invalid_argument if allocSizes is invalid
   MemoryPool(PoolId id,
              size_t poolSize,
              SlabAllocator& alloc,
-             const std::set<uint32_t>& allocSizes);
+             const std::set<uint32_t>& allocSizes,
+             uint32_t allocMagazineSize = 0);
 
   // creates a pool by restoring it from a serialized buffer.
   // @param object  Object that contains the data to restore MemoryPool
   // @param alloc   the slab allocator for fetching the header info.
+  // @param allocMagazineSize  number of free allocations each thread caches
+  //                           per allocation class. 0 disables it.
   // @throw   std::invalid_argument if the object state is invalid.
   //          std::logic_error if the Memory pool is not compatible for
   //          restoration with the slab allocator.
   MemoryPool(const serialization::MemoryPoolObject& object,
-             SlabAllocator& alloc);
+             SlabAllocator& alloc,
+             uint32_t allocMagazineSize = 0);
 
   MemoryPool(const MemoryPool&) = delete;
   MemoryPool& operator=(const MemoryPool&) = delete;
@@ -190,6 +197,8 @@ class MemoryPool {
   // @param zeroOnRelease  whether or not to zero out the slab
   // @param shouldAbortFn  invoked in the code to see if this release slab
   //                       process should be aborted
+  // @param graceFn        invoked before a slab that is already released is
+  //                       handed out again
   //
   // @return  a valid context. If the slab is already released, then the
   //          caller needs to do nothing. If it is not released, then the caller
@@ -208,7 +217,8 @@ class MemoryPool {
       SlabReleaseMode mode,
       const void* hint,
       bool zeroOnRelease,
-      SlabReleaseAbortFn shouldAbortFn = []() { return false; });
+      SlabReleaseAbortFn shouldAbortFn = []() { return false; },
+      SlabReleaseGraceFn graceFn = {});
 
   // Aborts the slab release process when there were active allocations in
   // the slab. This should be called with the same non-null context that was
@@ -246,6 +256,12 @@ class MemoryPool {
   // @return           the actual number of slabs reclaimed by the pool
   size_t reclaimSlabsAndGrow(size_t numSlabs);
 
+  // Advise away the slabs released in SlabReleaseMode::kAdvise mode that are
+  // waiting for the batch of the slab allocator to fill up.
+  //
+  // @return           the number of slabs advised away
+  size_t adviseReleasedSlabs();
+
   // for saving the state of the memory pool
   //
   // precondition:  The object must have been instantiated with a restorable
@@ -257,6 +273,10 @@ class MemoryPool {
   // @throw std::logic_error if the object state can not be serialized
   serialization::MemoryPoolObject saveState() const;
 
+  // return the free allocations cached by threads in all the allocation
+  // classes of this pool. Must be done before saving the state.
+  void flushAllocMagazines();
+
   // fetch the ClassId corresponding to the allocation class from this memory
   // pool
   //
@@ -315,6 +335,18 @@ class MemoryPool {
   // @param value  new value for the curSlabsAdvised_
   void setNumSlabsAdvised(uint64_t value) { curSlabsAdvised_ = value; }
 
+  // place the slabs this pool acquires from the slab allocator from now on
+  // according to the policy. Slabs already owned by the pool are not moved.
+  // This is not persisted and needs to be set again after a restore.
+  //
+  // @throw std::invalid_argument if the policy is invalid.
+  void setNumaPolicy(NumaPolicy policy);
+
+  NumaPolicy getNumaPolicy() const {
+    std::lock_guard<std::mutex> l(lock_);
+    return *numaPolicy_;
+  }
+
  private:
   // container for storing a vector of AllocationClass.
   using ACVector = std::vector<std::unique_ptr<AllocationClass>>;
@@ -326,10 +358,20 @@ class MemoryPool {
 
   // get a slab for use based on the activeSize and maxSize. returns nullptr
   // if out of slab memory.
-  Slab* getSlabLocked() noexcept;
+  //
+  // @param placement  set to the NUMA policy to place the slab with, if it
+  //                   is new from the slab allocator. Placing migrates the
+  //                   resident pages of the slab, so the caller does it with
+  //                   placeSlab() once lock_ is released.
+  Slab* getSlabLocked(std::shared_ptr<const NumaPolicy>& placement) noexcept;
+
+  // apply a NUMA policy to a slab acquired from the slab allocator. Failures
+  // are counted and otherwise ignored since the slab is still usable. Called
+  // without holding lock_.
+  void placeSlab(Slab* slab, const NumaPolicy& policy) noexcept;
 
   // create allocation classes corresponding to the pool's configuration.
-  ACVector createAllocationClasses() const;
+  ACVector createAllocationClasses(uint32_t allocMagazineSize) const;
 
   // @return  AllocationClass corresponding to the memory, if it
   //          belongs to an AllocationClass
@@ -393,6 +435,10 @@ class MemoryPool {
   // not currently in use.
   std::vector<Slab*> freeSlabs_;
 
+  // slabs released to be advised away that wait for the batch to fill up.
+  // They are saved as free slabs.
+  std::vector<Slab*> pendingAdviseSlabs_;
+
   // sorted vector of allocation class sizes
   const std::vector<uint32_t> acSizes_;
 
@@ -410,13 +456,23 @@ class MemoryPool {
   std::atomic<unsigned int> nSlabRebalance_{0};
   std::atomic<unsigned int> nSlabReleaseAborted_{0};
 
+  // placement of the slabs acquired from the slab allocator. The pointer is
+  // guarded by lock_, and a slab is placed with the policy it had when the
+  // slab was acquired.
+  std::shared_ptr<const NumaPolicy> numaPolicy_{
+      std::make_shared<const NumaPolicy>()};
+
+  // number of slabs that could not be placed according to numaPolicy_
+  std::atomic<uint64_t> nSlabNumaPlacementFailures_{0};
+
   static std::vector<uint32_t> createMcSizesFromSerialized(
       const serialization::MemoryPoolObject& object);
 
   static ACVector createMcFromSerialized(
       const serialization::MemoryPoolObject& object,
       PoolId poolId,
-      SlabAllocator& alloc);
+      SlabAllocator& alloc,
+      uint32_t allocMagazineSize);
 
   // Allow access to private members by unit tests
   friend class facebook::cachelib::tests::AllocTestBase;
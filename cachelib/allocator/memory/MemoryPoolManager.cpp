@@ -27,13 +27,17 @@ using namespace facebook::cachelib;
 
 constexpr unsigned int MemoryPoolManager::kMaxPools;
 
-MemoryPoolManager::MemoryPoolManager(SlabAllocator& slabAlloc)
-    : slabAlloc_(slabAlloc) {}
+MemoryPoolManager::MemoryPoolManager(SlabAllocator& slabAlloc,
+                                     uint32_t allocMagazineSize)
+    : slabAlloc_(slabAlloc), allocMagazineSize_(allocMagazineSize) {}
 
 MemoryPoolManager::MemoryPoolManager(
     const serialization::MemoryPoolManagerObject& object,
-    SlabAllocator& slabAlloc)
-    : nextPoolId_(*object.nextPoolId()), slabAlloc_(slabAlloc) {
+    SlabAllocator& slabAlloc,
+    uint32_t allocMagazineSize)
+    : nextPoolId_(*object.nextPoolId()),
+      slabAlloc_(slabAlloc),
+      allocMagazineSize_(allocMagazineSize) {
   if (!slabAlloc_.isRestorable()) {
     throw std::logic_error(
         "Memory Pool Manager can not be restored,"
@@ -55,12 +59,22 @@ MemoryPoolManager::MemoryPoolManager(
   }
   size_t slabsAdvised = 0;
   for (size_t i = 0; i < object.pools()->size(); ++i) {
-    pools_[i] = std::make_unique<MemoryPool>(object.pools()[i], slabAlloc_);
+    pools_[i] = std::make_unique<MemoryPool>(object.pools()[i], slabAlloc_,
+                                             allocMagazineSize_);
     slabsAdvised += pools_[i]->getNumSlabsAdvised();
   }
+  PoolIdMap poolsByName;
   for (const auto& kv : *object.poolsByName()) {
-    poolsByName_.insert(kv);
+    if (kv.second < 0 || kv.second >= nextPoolId_) {
+      throw std::logic_error(folly::sformat(
+          "Memory Pool Manager can not be restored, invalid id {} of pool {}",
+          kv.second, kv.first));
+    }
+    poolsByName.insert(kv);
+    poolNames_[kv.second] = kv.first;
   }
+  poolsByName_.update(
+      [&poolsByName](PoolIdMap& m) { m = std::move(poolsByName); });
 
   // Number items in the poolsByName map must be same as nextPoolId, if not
   // throw error
@@ -94,7 +108,7 @@ PoolId MemoryPoolManager::createNewPool(folly::StringPiece name,
                                         size_t poolSize,
                                         const std::set<uint32_t>& allocSizes) {
   std::unique_lock l(lock_);
-  if (poolsByName_.find(name) != poolsByName_.end()) {
+  if (poolsByName_.read()->count(name)) {
     throw std::invalid_argument("Duplicate pool");
   }
 
@@ -112,9 +126,10 @@ PoolId MemoryPoolManager::createNewPool(folly::StringPiece name,
   }
 
   const PoolId id = nextPoolId_;
-  pools_[id] =
-      std::make_unique<MemoryPool>(id, poolSize, slabAlloc_, allocSizes);
-  poolsByName_.insert({name.str(), id});
+  pools_[id] = std::make_unique<MemoryPool>(id, poolSize, slabAlloc_,
+                                            allocSizes, allocMagazineSize_);
+  poolNames_[id] = name.str();
+  poolsByName_.update([&](PoolIdMap& m) { m.insert({name.str(), id}); });
   nextPoolId_++;
   return id;
 }
@@ -128,13 +143,15 @@ bool MemoryPoolManager::provisionPool(
 }
 
 MemoryPool& MemoryPoolManager::getPoolByName(const std::string& name) const {
-  std::shared_lock l(lock_);
-  auto it = poolsByName_.find(name);
-  if (it == poolsByName_.end()) {
-    throw std::invalid_argument(folly::sformat("Invalid pool name {}", name));
+  PoolId poolId;
+  {
+    auto poolsByName = poolsByName_.read();
+    auto it = poolsByName->find(name);
+    if (it == poolsByName->end()) {
+      throw std::invalid_argument(folly::sformat("Invalid pool name {}", name));
+    }
+    poolId = it->second;
   }
-
-  auto poolId = it->second;
   XDCHECK_LT(poolId, nextPoolId_.load());
   XDCHECK_GE(poolId, 0);
   XDCHECK(pools_[poolId] != nullptr);
@@ -152,11 +169,9 @@ MemoryPool& MemoryPoolManager::getPoolById(PoolId id) const {
 }
 
 const std::string& MemoryPoolManager::getPoolNameById(PoolId id) const {
-  std::shared_lock l(lock_);
-  for (const auto& pair : poolsByName_) {
-    if (pair.second == id) {
-      return pair.first;
-    }
+  // same as getPoolById, the name is set before the id is handed out
+  if (id < nextPoolId_ && id >= 0) {
+    return poolNames_[id];
   }
   throw std::invalid_argument(folly::sformat("Invali pool id {}", id));
 }
@@ -173,7 +188,8 @@ serialization::MemoryPoolManagerObject MemoryPoolManager::saveState() const {
     object.pools()->push_back(pools_[i]->saveState());
   }
   object.poolsByName().emplace();
-  for (const auto& kv : poolsByName_) {
+  auto poolsByName = poolsByName_.read();
+  for (const auto& kv : *poolsByName) {
     object.poolsByName()->insert(kv);
   }
   object.nextPoolId() = nextPoolId_;
@@ -189,6 +205,15 @@ std::set<PoolId> MemoryPoolManager::getPoolIds() const {
   return ret;
 }
 
+std::unordered_map<PoolId, std::map<int, uint64_t>>
+MemoryPoolManager::getNumSlabsPerNumaNode() const {
+  std::unordered_map<PoolId, std::map<int, uint64_t>> slabsPerNode;
+  for (const auto& [pid, node] : slabAlloc_.getSlabNumaNodes()) {
+    ++slabsPerNode[pid][node];
+  }
+  return slabsPerNode;
+}
+
 bool MemoryPoolManager::resizePools(PoolId src, PoolId dest, size_t bytes) {
   auto& srcPool = getPoolById(src);
   auto& destPool = getPoolById(dest);
@@ -230,11 +255,8 @@ bool MemoryPoolManager::growPool(PoolId pid, size_t bytes) {
 
 std::set<PoolId> MemoryPoolManager::getPoolsOverLimit() const {
   std::set<PoolId> res;
-  std::shared_lock l(lock_);
-  for (const auto& kv : poolsByName_) {
-    const auto poolId = kv.second;
-    const auto& pool = getPoolById(poolId);
-    if (pool.overLimit()) {
+  for (PoolId poolId = 0; poolId < nextPoolId_; ++poolId) {
+    if (getPoolById(poolId).overLimit()) {
       res.insert(poolId);
     }
   }
@@ -19,6 +19,7 @@
 #include <folly/SharedMutex.h>
 
 #include <array>
+#include <map>
 #include <memory>
 #include <unordered_map>
 
@@ -31,6 +32,7 @@
 #include "cachelib/allocator/memory/Slab.h"
 #include "cachelib/allocator/memory/SlabAllocator.h"
 #include "cachelib/allocator/memory/serialize/gen-cpp2/objects_types.h"
+#include "cachelib/common/Cohort.h"
 
 namespace facebook {
 namespace cachelib {
@@ -49,16 +51,22 @@ class MemoryPoolManager {
 
   // creates a memory pool manager for this slabAllocator.
   // @param slabAlloc  the slab allocator to be used for the memory pools.
-  explicit MemoryPoolManager(SlabAllocator& slabAlloc);
+  // @param allocMagazineSize  number of free allocations each thread caches
+  //                           per allocation class. 0 disables it.
+  explicit MemoryPoolManager(SlabAllocator& slabAlloc,
+                             uint32_t allocMagazineSize = 0);
 
   // creates a memory pool manager by restoring it from a serialized buffer.
   //
   // @param object    Object that contains the data to restore MemoryPoolManger
   // @param slabAlloc the slab allocator for fetching the header info.
+  // @param allocMagazineSize  number of free allocations each thread caches
+  //                           per allocation class. 0 disables it.
   //
   // @throw  std::logic_error if the slab allocator is not restorable.
   MemoryPoolManager(const serialization::MemoryPoolManagerObject& object,
-                    SlabAllocator& slabAlloc);
+                    SlabAllocator& slabAlloc,
+                    uint32_t allocMagazineSize = 0);
 
   MemoryPoolManager(const MemoryPoolManager&) = delete;
   MemoryPoolManager& operator=(const MemoryPoolManager&) = delete;
@@ -129,12 +137,21 @@ class MemoryPoolManager {
   MemoryPool& getPoolById(PoolId id) const;
 
   // returns the pool's name by its pool ID
-  // @throw std::logic_error if the pool ID not existed.
+  // @throw std::invalid_argument if the pool ID not existed.
   const std::string& getPoolNameById(PoolId id) const;
 
   // returns the current pool ids that are being used.
   std::set<PoolId> getPoolIds() const;
 
+  // returns the number of slabs of every pool backed by each NUMA node, as
+  // reported by the kernel for the first page of the slab. Slabs whose memory
+  // is not resident yet are counted under node -1. This walks all the slabs
+  // and is meant for periodic stats collection, not for the fast path.
+  //
+  // @throw std::system_error if the NUMA nodes can not be queried
+  std::unordered_map<PoolId, std::map<int, uint64_t>> getNumSlabsPerNumaNode()
+      const;
+
   // for saving the state of the memory pool manager
   //
   // precondition:  The object must have been instantiated with a restorable
@@ -218,7 +235,7 @@ class MemoryPoolManager {
       uint64_t totalSlabsInUse,
       std::unordered_map<PoolId, size_t>& numSlabsInUse) const;
 
-  // rw lock serializing the access to poolsByName_ and pool creation.
+  // rw lock serializing pool creation and resizing.
   mutable folly::SharedMutex lock_;
 
   // array of pools by Id. The valid pools are up to (nextPoolId_ - 1). This
@@ -226,8 +243,13 @@ class MemoryPoolManager {
   // long as the pool Id is valid.
   std::array<std::unique_ptr<MemoryPool>, kMaxPools> pools_;
 
-  // pool name -> pool Id mapping.
-  folly::F14FastMap<std::string, PoolId> poolsByName_;
+  using PoolIdMap = folly::F14FastMap<std::string, PoolId>;
+
+  // pool name -> pool Id mapping, looked up without taking lock_.
+  CohortRcu<PoolIdMap> poolsByName_;
+
+  // names of the pools by Id, valid up to (nextPoolId_ - 1) like pools_.
+  std::array<std::string, kMaxPools> poolNames_;
 
   // the next available pool id.
   std::atomic<PoolId> nextPoolId_{0};
@@ -235,6 +257,9 @@ class MemoryPoolManager {
   // slab allocator for the pools
   SlabAllocator& slabAlloc_;
 
+  // number of free allocations each thread caches per allocation class
+  const uint32_t allocMagazineSize_{0};
+
   // Number of slabs to advise away
   // This is target number of slabs to be advised across all pools.
   // This would be same as sum of current number of advised away slabs in
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/memory/NumaPolicy.h"
+
+#include <folly/Format.h>
+#include <numa.h>
+#include <numaif.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "cachelib/common/Utils.h"
+
+namespace facebook {
+namespace cachelib {
+
+void NumaPolicy::validate() const {
+  if ((mode_ == Mode::kBind || mode_ == Mode::kInterleave) && nodes_.empty()) {
+    throw std::invalid_argument(
+        folly::sformat("NUMA policy {} needs at least one node", toString()));
+  }
+}
+
+void NumaPolicy::apply(void* memory, size_t size) const {
+  int mode = MPOL_DEFAULT;
+  switch (mode_) {
+  case Mode::kDefault:
+    return;
+  case Mode::kBind:
+    mode = MPOL_BIND;
+    break;
+  case Mode::kInterleave:
+    mode = MPOL_INTERLEAVE;
+    break;
+  case Mode::kLocal:
+    // preferred with no nodes means the node of the calling thread
+    mode = MPOL_PREFERRED;
+    break;
+  }
+
+  auto nodesMask = nodes_.getNativeBitmask();
+  const bool hasNodes = mode_ != Mode::kLocal;
+  long ret = mbind(memory, size, mode, hasNodes ? nodesMask->maskp : nullptr,
+                   hasNodes ? nodesMask->size : 0, MPOL_MF_MOVE);
+  if (ret != 0) {
+    util::throwSystemError(
+        errno, folly::sformat("mbind() failed: {}", std::strerror(errno)));
+  }
+}
+
+std::string NumaPolicy::toString() const {
+  switch (mode_) {
+  case Mode::kDefault:
+    return "default";
+  case Mode::kBind:
+    return "bind";
+  case Mode::kInterleave:
+    return "interleave";
+  case Mode::kLocal:
+    return "local";
+  }
+  return "unknown";
+}
+
+namespace detail {
+std::vector<int> getNumaNodes(const std::vector<void*>& addrs) {
+  std::vector<int> nodes(addrs.size(), -1);
+  if (addrs.empty()) {
+    return nodes;
+  }
+
+  // with no target nodes, move_pages only reports where the pages are
+  std::vector<void*> pages = addrs;
+  long ret = move_pages(0 /* self */, pages.size(), pages.data(), nullptr,
+                        nodes.data(), 0);
+  if (ret != 0) {
+    util::throwSystemError(
+        errno, folly::sformat("move_pages() failed: {}", std::strerror(errno)));
+  }
+  for (auto& node : nodes) {
+    // pages that are not resident report a negative errno
+    if (node < 0) {
+      node = -1;
+    }
+  }
+  return nodes;
+}
+} // namespace detail
+
+} // namespace cachelib
+} // namespace facebook
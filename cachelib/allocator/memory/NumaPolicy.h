@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cachelib/shm/ShmCommon.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Placement of a memory pool's slabs across NUMA nodes. The policy is applied
+// to every slab the pool acquires from the slab allocator, on top of any
+// memory binding of the whole memory tier. Pages of the slab that are already
+// resident are migrated to comply with the policy.
+class NumaPolicy {
+ public:
+  enum class Mode {
+    // no placement, the slab keeps the policy of the memory tier
+    kDefault,
+    // allocate only from the given nodes
+    kBind,
+    // interleave the pages across the given nodes
+    kInterleave,
+    // prefer the node of the thread that acquires the slab, which is the
+    // thread allocating from the pool. Falls back to other nodes when the
+    // local node is out of memory.
+    kLocal,
+  };
+
+  NumaPolicy() = default;
+
+  static NumaPolicy bind(NumaBitMask nodes) {
+    return NumaPolicy{Mode::kBind, std::move(nodes)};
+  }
+
+  static NumaPolicy interleave(NumaBitMask nodes) {
+    return NumaPolicy{Mode::kInterleave, std::move(nodes)};
+  }
+
+  static NumaPolicy local() { return NumaPolicy{Mode::kLocal, NumaBitMask{}}; }
+
+  Mode getMode() const noexcept { return mode_; }
+
+  const NumaBitMask& getNodes() const noexcept { return nodes_; }
+
+  bool isDefault() const noexcept { return mode_ == Mode::kDefault; }
+
+  // @throw std::invalid_argument if bind or interleave are given no nodes.
+  void validate() const;
+
+  // apply the policy to the memory range, moving the resident pages that do
+  // not comply with it.
+  //
+  // @param memory  start of the range, page aligned
+  // @param size    length of the range
+  //
+  // @throw std::system_error on failure
+  void apply(void* memory, size_t size) const;
+
+  std::string toString() const;
+
+ private:
+  NumaPolicy(Mode mode, NumaBitMask nodes)
+      : mode_(mode), nodes_(std::move(nodes)) {}
+
+  Mode mode_{Mode::kDefault};
+  NumaBitMask nodes_;
+};
+
+namespace detail {
+// returns the NUMA node of the page backing each of the addresses, or -1 if
+// the page is not resident.
+//
+// @throw std::system_error on failure
+std::vector<int> getNumaNodes(const std::vector<void*>& addrs);
+} // namespace detail
+
+} // namespace cachelib
+} // namespace facebook
@@ -27,6 +27,13 @@
 
 #include "cachelib/common/CompilerUtils.h"
 
+// log2 of the slab size. This is part of the layout of the cache memory and of
+// compressed pointers, so caches can only be attached by binaries built with
+// the same value.
+#ifndef CACHELIB_SLAB_SIZE_BITS
+#define CACHELIB_SLAB_SIZE_BITS 22
+#endif
+
 namespace facebook {
 namespace cachelib {
 
@@ -58,6 +65,9 @@ using PoolId = int8_t;
 using ClassId = int8_t;
 // slab release abort function to determine if slab release should be aborted
 using SlabReleaseAbortFn = std::function<bool(void)>;
+// invoked before the memory of a released slab is handed out again, to wait
+// for readers that may still refer to the allocations that were in it
+using SlabReleaseGraceFn = std::function<void(void)>;
 
 struct AllocInfo {
   const PoolId poolId;
@@ -76,8 +86,11 @@ class CACHELIB_PACKED_ATTR Slab {
   // used to represent the fact that the slab does not belong to any MemoryPool
   static constexpr PoolId kInvalidPoolId = -1;
 
-  // size of the slab in bytes.
-  static constexpr unsigned int kNumSlabBits = 22;
+  // size of the slab in bytes. Defaults to 4 MB and can be set at build time
+  // with CACHELIB_SLAB_SIZE_BITS. Smaller slabs make slab releases between
+  // pools and allocation classes cheaper. Larger slabs cut the number of slab
+  // headers and allocator metadata for very large caches.
+  static constexpr unsigned int kNumSlabBits = CACHELIB_SLAB_SIZE_BITS;
 
   // minimum of 64 byte allocations.
   static constexpr unsigned int kMinAllocPower = 6;
@@ -102,6 +115,12 @@ class CACHELIB_PACKED_ATTR Slab {
 static_assert(std::is_standard_layout<Slab>::value,
               "Slab is not standard layout");
 
+// 1 MB to 64 MB. Slabs bound the largest allocation, and slab offsets share
+// 32 bits with slab indexes in compressed pointers and with chain indexes in
+// datatype buffers, so larger slabs leave fewer bits for those.
+static_assert(Slab::kNumSlabBits >= 20 && Slab::kNumSlabBits <= 26,
+              "CACHELIB_SLAB_SIZE_BITS must be between 20 and 26");
+
 enum class SlabHeaderFlag : uint8_t {
   IS_MARKED_FOR_RELEASE = 0,
   IS_ADVISED = 1,
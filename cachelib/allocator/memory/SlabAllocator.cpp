@@ -23,10 +23,14 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <chrono>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <system_error>
 
+#include "cachelib/allocator/memory/NumaPolicy.h"
 #include "cachelib/common/Utils.h"
 
 /* Missing madvise(2) flags on MacOS */
@@ -82,7 +86,11 @@ SlabAllocator::~SlabAllocator() {
   stopMemoryLocker();
 
   if (ownsMemory_) {
-    munmap(memoryStart_, memorySize_);
+    munmap(memoryStart_,
+           ownedHugePageSize_ == 0
+               ? memorySize_
+               : util::getAlignedSize(
+                     memorySize_, static_cast<uint32_t>(ownedHugePageSize_)));
   }
 }
 
@@ -93,14 +101,47 @@ void SlabAllocator::stopMemoryLocker() {
   }
 }
 
+SlabAllocator::OwnedMemory SlabAllocator::mapOwnedMemory(
+    size_t size, const Config& config) {
+  if (config.hugePageSize == 0) {
+    return {util::mmapAlignedZeroedMemory(sizeof(Slab), size), 0};
+  }
+
+  try {
+    return {util::mmapAlignedZeroedMemory(sizeof(Slab), size, false,
+                                          config.hugePageSize),
+            config.hugePageSize};
+  } catch (const std::system_error& e) {
+    if (!config.hugePageFallback) {
+      throw;
+    }
+    XLOGF(WARN,
+          "Unable to map {} bytes with {} byte huge pages, falling back to "
+          "regular pages: {}",
+          size, config.hugePageSize, e.what());
+  }
+
+  void* memory = util::mmapAlignedZeroedMemory(sizeof(Slab), size);
+#ifdef MADV_HUGEPAGE
+  // best effort. The kernel may still back the memory with huge pages
+  // transparently.
+  madvise(memory, size, MADV_HUGEPAGE);
+#endif
+  return {memory, 0};
+}
+
 SlabAllocator::SlabAllocator(size_t size, const Config& config)
-    : SlabAllocator(util::mmapAlignedZeroedMemory(sizeof(Slab), size),
-                    size,
-                    true,
-                    config) {
+    : SlabAllocator(mapOwnedMemory(size, config), size, config) {
   XDCHECK(!isRestorable());
 }
 
+SlabAllocator::SlabAllocator(OwnedMemory memory,
+                             size_t size,
+                             const Config& config)
+    : SlabAllocator(memory.memoryStart, size, true, config) {
+  ownedHugePageSize_ = memory.hugePageSize;
+}
+
 SlabAllocator::SlabAllocator(void* memoryStart,
                              size_t memorySize,
                              const Config& config)
@@ -300,6 +341,33 @@ unsigned int SlabAllocator::getNumUsableAndAdvisedSlabs() const noexcept {
   return static_cast<unsigned int>(getSlabMemoryEnd() - slabMemoryStart_);
 }
 
+std::vector<std::pair<PoolId, int>> SlabAllocator::getSlabNumaNodes() const {
+  const Slab* end = nullptr;
+  {
+    LockHolder l(lock_);
+    end = nextSlabAllocation_;
+  }
+
+  std::vector<PoolId> pools;
+  std::vector<void*> slabs;
+  for (Slab* slab = slabMemoryStart_; slab < end; ++slab) {
+    const auto* header = getSlabHeader(slab);
+    if (header->poolId == Slab::kInvalidPoolId || header->isAdvised()) {
+      continue;
+    }
+    pools.push_back(header->poolId);
+    slabs.push_back(slab);
+  }
+
+  const auto nodes = detail::getNumaNodes(slabs);
+  std::vector<std::pair<PoolId, int>> slabNodes;
+  slabNodes.reserve(pools.size());
+  for (size_t i = 0; i < pools.size(); i++) {
+    slabNodes.emplace_back(pools[i], nodes[i]);
+  }
+  return slabNodes;
+}
+
 Slab* SlabAllocator::computeSlabMemoryStart(void* memoryStart,
                                             size_t memorySize) {
   // compute the number of slabs we can have.
@@ -384,59 +452,89 @@ void SlabAllocator::freeSlab(Slab* slab) {
 }
 
 bool SlabAllocator::adviseSlab(Slab* slab) {
-  // find the header for the slab.
-  auto* header = getSlabHeader(slab);
-  if (header == nullptr) {
-    throw std::runtime_error(folly::sformat("Invalid Slab {}", slab));
+  return adviseSlabs({slab}).empty();
+}
+
+std::vector<Slab*> SlabAllocator::adviseSlabs(std::vector<Slab*> slabs) {
+  for (auto* slab : slabs) {
+    if (getSlabHeader(slab) == nullptr) {
+      throw std::runtime_error(folly::sformat("Invalid Slab {}", slab));
+    }
   }
-  // Mark slab as advised in header prior to advising to avoid it from being
-  // touched during memory locking.
-  header->setAdvised(true);
-  // madvise kernel to release this slab. Do this while not holding the
-  // lock since the MADV_REMOVE happens inline.
-  auto ret = madvise((void*)slab->memoryAtOffset(0), Slab::kSize, MADV_REMOVE);
-  if (!ret || pretendMadvise_) {
+  // Mark slabs as advised in header prior to advising to avoid them from
+  // being touched during memory locking.
+  for (auto* slab : slabs) {
+    getSlabHeader(slab)->setAdvised(true);
+  }
+
+  std::sort(slabs.begin(), slabs.end());
+  std::vector<Slab*> advised;
+  std::vector<Slab*> failed;
+  auto runBegin = slabs.begin();
+  while (runBegin != slabs.end()) {
+    auto runEnd = std::next(runBegin);
+    while (runEnd != slabs.end() && *runEnd == *std::prev(runEnd) + 1) {
+      ++runEnd;
+    }
+    // madvise kernel to release these slabs. Do this while not holding the
+    // lock since the MADV_REMOVE happens inline.
+    const auto ret =
+        madvise((void*)(*runBegin)->memoryAtOffset(0),
+                std::distance(runBegin, runEnd) * Slab::kSize, MADV_REMOVE);
+    ++numAdviseCalls_;
+    auto& result = (!ret || pretendMadvise_) ? advised : failed;
+    result.insert(result.end(), runBegin, runEnd);
+    runBegin = runEnd;
+  }
+
+  // Unset the flag since we failed to advise these slabs away
+  for (auto* slab : failed) {
+    getSlabHeader(slab)->setAdvised(false);
+  }
+  if (!advised.empty()) {
     LockHolder l(lock_);
-    advisedSlabs_.push_back(slab);
-    // This doesn't reset flags
-    header->resetAllocInfo();
-    return true;
+    for (auto* slab : advised) {
+      advisedSlabs_.push_back(slab);
+      // This doesn't reset flags
+      getSlabHeader(slab)->resetAllocInfo();
+    }
   }
-  // Unset the flag since we failed to advise this slab away
-  header->setAdvised(false);
-  return false;
+  return failed;
 }
 
 Slab* FOLLY_NULLABLE SlabAllocator::reclaimSlab(PoolId id) {
-  Slab* slab = nullptr;
+  auto slabs = reclaimSlabs(id, 1);
+  return slabs.empty() ? nullptr : slabs.front();
+}
+
+std::vector<Slab*> SlabAllocator::reclaimSlabs(PoolId id, size_t numSlabs) {
+  std::vector<Slab*> slabs;
   {
     LockHolder l(lock_);
-    if (!advisedSlabs_.empty()) {
-      auto it = advisedSlabs_.begin();
-      slab = *it;
-      advisedSlabs_.erase(it);
-    }
-  }
-
-  if (!slab) {
-    return nullptr;
+    const auto end =
+        advisedSlabs_.begin() + std::min(numSlabs, advisedSlabs_.size());
+    slabs.assign(advisedSlabs_.begin(), end);
+    advisedSlabs_.erase(advisedSlabs_.begin(), end);
   }
 
   const size_t numPages = util::getNumPages(sizeof(Slab));
   const size_t pageSize = util::getPageSize();
-  auto* mem = reinterpret_cast<const uint8_t* const>(slab->memoryAtOffset(0));
-  XDCHECK(util::isPageAlignedAddr(mem));
+  for (auto* slab : slabs) {
+    auto* mem =
+        reinterpret_cast<const uint8_t* const>(slab->memoryAtOffset(0));
+    XDCHECK(util::isPageAlignedAddr(mem));
 
-  for (size_t pageOffset = 0; pageOffset < numPages; pageOffset++) {
-    // Use volatile to fool the compiler to not optimize this away in opt
-    // mode.
-    volatile const uint8_t val = *(mem + pageOffset * pageSize);
-    (void)val;
+    for (size_t pageOffset = 0; pageOffset < numPages; pageOffset++) {
+      // Use volatile to fool the compiler to not optimize this away in opt
+      // mode.
+      volatile const uint8_t val = *(mem + pageOffset * pageSize);
+      (void)val;
+    }
+    memoryPoolSize_[id] += sizeof(Slab);
+    // initialize the header for the slab.
+    initializeHeader(slab, id);
   }
-  memoryPoolSize_[id] += sizeof(Slab);
-  // initialize the header for the slab.
-  initializeHeader(slab, id);
-  return slab;
+  return slabs;
 }
 
 SlabHeader* SlabAllocator::getSlabHeader(
@@ -18,10 +18,12 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <atomic>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #pragma GCC diagnostic push
@@ -60,6 +62,14 @@ class SlabAllocator {
     // lock the pages in memory, forcing to allocate them and retaining them in
     // memory even when untouched.
     bool lockMemory{false};
+
+    // When the slab allocator maps its own memory, back it with hugetlb pages
+    // of this size. 0 uses regular pages.
+    size_t hugePageSize{0};
+
+    // If the huge pages can not be reserved, fall back to regular pages
+    // advised for transparent huge pages instead of throwing.
+    bool hugePageFallback{true};
   };
 
   // initialize the slab allocator for the range of memory starting from
@@ -109,6 +119,9 @@ class SlabAllocator {
   // state. This is a precondition to calling saveState.
   bool isRestorable() const noexcept { return !ownsMemory_; }
 
+  // returns the start of the memory managed by this slab allocator.
+  const void* getMemoryStart() const noexcept { return memoryStart_; }
+
   using LockHolder = std::unique_lock<std::mutex>;
 
   // return true if any more slabs can be allocated from the slab allocator at
@@ -145,10 +158,32 @@ class SlabAllocator {
   // @return true if madvise succeeded
   bool adviseSlab(Slab* slab);
 
+  // Same as adviseSlab() for a batch of slabs, with one madvise call for
+  // every run of contiguous slabs. Every call shoots down the TLB entries of
+  // the range on all the cpus running the process, so fewer and larger calls
+  // disturb the other threads less.
+  //
+  // @throw throws std::runtime_error if a slab is invalid
+  // @return the slabs that could not be advised away
+  std::vector<Slab*> adviseSlabs(std::vector<Slab*> slabs);
+
   // Page in the pages for the slab into memory that were previously
   // madvised away for the given pool.
   Slab* reclaimSlab(PoolId id);
 
+  // Same as reclaimSlab() for up to numSlabs slabs at once.
+  std::vector<Slab*> reclaimSlabs(PoolId id, size_t numSlabs);
+
+  // number of slabs released for advising that the memory pools gather
+  // before advising them away together. Not persisted.
+  size_t getAdviseBatchSize() const noexcept { return adviseBatchSize_; }
+  void setAdviseBatchSize(size_t batchSize) noexcept {
+    adviseBatchSize_ = std::max<size_t>(batchSize, 1);
+  }
+
+  // number of madvise calls made to advise slabs away
+  uint64_t getNumAdviseCalls() const noexcept { return numAdviseCalls_; }
+
   // Number of advised away slabs that can be reclaimed by calling reclaimSlab()
   size_t numSlabsReclaimable() const noexcept {
     LockHolder l(lock_);
@@ -167,6 +202,13 @@ class SlabAllocator {
   // return the number of slabs that the cache can hold
   unsigned int getNumUsableAndAdvisedSlabs() const noexcept;
 
+  // returns the pool of every slab currently handed out to a pool along with
+  // the NUMA node backing the first page of the slab, or -1 if that page is
+  // not resident. Slabs that are advised away are skipped.
+  //
+  // @throw std::system_error if the NUMA nodes can not be queried
+  std::vector<std::pair<PoolId, int>> getSlabNumaNodes() const;
+
   // returns the SlabHeader for the memory address or nullptr if the memory
   // is invalid. Hotly accessed for getting alloc info
   FOLLY_ALWAYS_INLINE SlabHeader* getSlabHeader(
@@ -334,6 +376,20 @@ class SlabAllocator {
   // reach 2^16 - 1;
   static constexpr SlabIdx kNullSlabIdx = std::numeric_limits<SlabIdx>::max();
 
+  // memory mapped by the slab allocator itself along with the size of the
+  // hugetlb pages backing it. 0 means regular pages.
+  struct OwnedMemory {
+    void* memoryStart;
+    size_t hugePageSize;
+  };
+
+  // maps memory of the given size, trying hugetlb pages first if the config
+  // asks for them.
+  static OwnedMemory mapOwnedMemory(size_t memorySize, const Config& config);
+
+  // used for delegation from the constructor that maps its own memory.
+  SlabAllocator(OwnedMemory memory, size_t memorySize, const Config& config);
+
   // used for delegation from the first two types of constructors.
   SlabAllocator(void* memoryStart,
                 size_t memorySize,
@@ -426,6 +482,10 @@ class SlabAllocator {
   // whether the memory this slab allocator manages is mmaped by the caller.
   const bool ownsMemory_{true};
 
+  // size of the hugetlb pages backing the memory we own. 0 for regular pages.
+  // hugetlb mappings can only be unmapped in multiples of their page size.
+  size_t ownedHugePageSize_{0};
+
   // thread that does back-ground job of paging in and locking the memory if
   // enabled.
   std::thread memoryLocker_;
@@ -437,6 +497,11 @@ class SlabAllocator {
   // to be successful.
   bool pretendMadvise_{false};
 
+  // see getAdviseBatchSize()
+  std::atomic<size_t> adviseBatchSize_{1};
+
+  std::atomic<uint64_t> numAdviseCalls_{0};
+
   // amount of time to sleep in between each step to spread out the page
   // faults over a period of time.
   static constexpr unsigned int kLockSleepMS = 100;
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <memory>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "cachelib/allocator/memory/AllocationClass.h"
@@ -1124,6 +1125,117 @@ TEST_F(AllocationClassTest, Stats) {
   }
 }
 
+TEST_F(AllocationClassTest, Magazine) {
+  auto slabAlloc = createSlabAllocator(10);
+  const PoolId pid = 0;
+  const ClassId cid = 0;
+  const auto allocSize = 1 << 10;
+  ASSERT_THROW(AllocationClass(cid, pid, allocSize, *slabAlloc,
+                               AllocationClass::kMaxMagazineSize + 1),
+               std::invalid_argument);
+
+  const uint32_t magazineSize = 8;
+  AllocationClass ac(cid, pid, allocSize, *slabAlloc, magazineSize);
+  ASSERT_EQ(magazineSize, ac.getMagazineSize());
+  auto slab = slabAlloc->makeNewSlab(pid);
+  ac.addSlab(slab);
+
+  std::vector<void*> allocs;
+  for (unsigned int i = 0; i < ac.getAllocsPerSlab(); i++) {
+    auto alloc = ac.allocate();
+    ASSERT_NE(nullptr, alloc);
+    allocs.push_back(alloc);
+  }
+  ASSERT_EQ(nullptr, ac.allocate());
+  ASSERT_EQ(allocs.size(), ac.getStats().activeAllocs);
+
+  // freed allocations are cached and handed out again most recent first.
+  ac.free(allocs.back());
+  ASSERT_EQ(1, ac.getStats().freeAllocs);
+  ASSERT_EQ(allocs.back(), ac.allocate());
+
+  // freeing more than the magazine holds flushes it back in batches.
+  for (auto alloc : allocs) {
+    ac.free(alloc);
+  }
+  {
+    auto stat = ac.getStats();
+    ASSERT_EQ(allocs.size(), stat.freeAllocs);
+    ASSERT_EQ(0, stat.activeAllocs);
+  }
+
+  // the slab is released even though some of its free allocations are
+  // cached.
+  auto context = ac.startSlabRelease(SlabReleaseMode::kResize, allocs[0]);
+  ASSERT_TRUE(context.isReleased());
+  ASSERT_EQ(slab, context.getSlab());
+  ASSERT_EQ(0, ac.getStats().freeAllocs);
+  ASSERT_EQ(nullptr, ac.allocate());
+}
+
+TEST_F(AllocationClassTest, MagazineSlabRelease) {
+  auto slabAlloc = createSlabAllocator(10);
+  const PoolId pid = 0;
+  const ClassId cid = 0;
+  const auto allocSize = 1 << 10;
+  AllocationClass ac(cid, pid, allocSize, *slabAlloc, 8);
+  auto slab = slabAlloc->makeNewSlab(pid);
+  ac.addSlab(slab);
+
+  std::vector<void*> allocs;
+  for (unsigned int i = 0; i < ac.getAllocsPerSlab(); i++) {
+    allocs.push_back(ac.allocate());
+  }
+
+  // while the slab is being released, frees must not be cached since they
+  // would never be marked as freed for the release.
+  auto context = ac.startSlabRelease(SlabReleaseMode::kResize, allocs[0]);
+  ASSERT_FALSE(context.isReleased());
+  auto activeAllocs = context.getActiveAllocations();
+  std::sort(allocs.begin(), allocs.end());
+  std::sort(activeAllocs.begin(), activeAllocs.end());
+  ASSERT_EQ(allocs, activeAllocs);
+  for (auto alloc : allocs) {
+    ASSERT_FALSE(ac.isAllocFreed(context, alloc));
+    ac.free(alloc);
+    ASSERT_TRUE(ac.isAllocFreed(context, alloc));
+  }
+  ASSERT_TRUE(ac.allFreed(slab));
+  ac.completeSlabRelease(context);
+}
+
+TEST_F(AllocationClassTest, MagazineThreadExit) {
+  auto slabAlloc = createSlabAllocator(10);
+  const PoolId pid = 0;
+  const ClassId cid = 0;
+  const auto allocSize = 1 << 10;
+  AllocationClass ac(cid, pid, allocSize, *slabAlloc, 8);
+  ac.addSlab(slabAlloc->makeNewSlab(pid));
+
+  // allocations cached by a thread go back to the class when it exits.
+  const unsigned int numAllocs = 5;
+  std::thread t([&]() {
+    std::vector<void*> allocs;
+    for (unsigned int i = 0; i < numAllocs; i++) {
+      allocs.push_back(ac.allocate());
+    }
+    for (auto alloc : allocs) {
+      ac.free(alloc);
+    }
+  });
+  t.join();
+
+  std::vector<void*> allocs;
+  for (unsigned int i = 0; i < ac.getAllocsPerSlab(); i++) {
+    auto alloc = ac.allocate();
+    ASSERT_NE(nullptr, alloc);
+    allocs.push_back(alloc);
+  }
+  ASSERT_EQ(nullptr, ac.allocate());
+  std::sort(allocs.begin(), allocs.end());
+  ASSERT_EQ(allocs.end(), std::unique(allocs.begin(), allocs.end()));
+}
+
 // Test alloc processing during slab release
 TEST_F(AllocationClassTest, ProcessAllocForRelease) {
   auto slabAlloc = createSlabAllocator(1);
@@ -236,3 +236,17 @@ TEST_F(CompressedPtrTest, Compare) {
                 m.compress<CompressedPtr5B>(nullptr, true /* isMultiTiered */),
                 true /* isMultiTiered */));
 }
+
+TEST_F(CompressedPtrTest, MinCompressedPtrBytes) {
+  constexpr size_t kGB = 1024 * 1024 * 1024;
+  ASSERT_EQ(5, sizeof(CompressedPtr5B));
+  ASSERT_EQ(4, getMinCompressedPtrBytes(Slab::kSize));
+  ASSERT_EQ(4, getMinCompressedPtrBytes(256 * kGB));
+  ASSERT_EQ(5, getMinCompressedPtrBytes(256 * kGB + Slab::kSize));
+  ASSERT_EQ(5, getMinCompressedPtrBytes(512 * kGB));
+  ASSERT_EQ(5,
+            getMinCompressedPtrBytes(CompressedPtr5B::getMaxAddressableSize()));
+  ASSERT_EQ(
+      0,
+      getMinCompressedPtrBytes(CompressedPtr5B::getMaxAddressableSize() + 1));
+}
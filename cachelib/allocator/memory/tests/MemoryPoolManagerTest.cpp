@@ -16,6 +16,7 @@
 
 #include <folly/Random.h>
 
+#include <cstring>
 #include <memory>
 #include <random>
 
@@ -347,3 +348,48 @@ TEST_F(MemoryPoolManagerTest, PoolOverLimit) {
   m.resizePools(3, 4, 5 * Slab::kSize);
   ASSERT_EQ(std::set<PoolId>({0, 3}), m.getPoolsOverLimit());
 }
+
+TEST_F(MemoryPoolManagerTest, NumaPlacement) {
+  auto slabAlloc = createSlabAllocator(20);
+  MemoryPoolManager m(*slabAlloc);
+  const std::set<uint32_t> allocSizes{Slab::kSize};
+  auto pid1 = m.createNewPool("bound", 5 * Slab::kSize, allocSizes);
+  auto pid2 = m.createNewPool("default", 5 * Slab::kSize, allocSizes);
+  auto& pool1 = m.getPoolById(pid1);
+  auto& pool2 = m.getPoolById(pid2);
+
+  // bind and interleave need nodes
+  ASSERT_THROW(pool1.setNumaPolicy(NumaPolicy::bind(NumaBitMask{})),
+               std::invalid_argument);
+  ASSERT_THROW(pool1.setNumaPolicy(NumaPolicy::interleave(NumaBitMask{})),
+               std::invalid_argument);
+  ASSERT_TRUE(pool1.getNumaPolicy().isDefault());
+
+  NumaBitMask nodes;
+  nodes.setBit(0);
+  pool1.setNumaPolicy(NumaPolicy::bind(nodes));
+  ASSERT_EQ(NumaPolicy::Mode::kBind, pool1.getNumaPolicy().getMode());
+
+  // touch the slabs so that their memory is resident
+  for (int i = 0; i < 3; i++) {
+    std::memset(pool1.allocate(Slab::kSize), 'a', Slab::kSize);
+  }
+  std::memset(pool2.allocate(Slab::kSize), 'b', Slab::kSize);
+
+  auto slabsPerNode = m.getNumSlabsPerNumaNode();
+  ASSERT_EQ(2, slabsPerNode.size());
+  auto countSlabs = [](const std::map<int, uint64_t>& perNode) {
+    uint64_t total = 0;
+    for (const auto& [node, count] : perNode) {
+      EXPECT_NE(-1, node);
+      total += count;
+    }
+    return total;
+  };
+  ASSERT_EQ(3, countSlabs(slabsPerNode[pid1]));
+  ASSERT_EQ(1, countSlabs(slabsPerNode[pid2]));
+  if (pool1.getStats().numSlabNumaPlacementFailures == 0) {
+    ASSERT_EQ(3, slabsPerNode[pid1][0]);
+  }
+  ASSERT_EQ(0, pool2.getStats().numSlabNumaPlacementFailures);
+}
@@ -640,6 +640,63 @@ TEST_F(SlabAllocatorTest, AdviseRelease) {
   ASSERT_TRUE(memRssAfter2 > memRssAfter);
 }
 
+TEST_F(SlabAllocatorTest, AdviseReleaseBatch) {
+  const size_t numSlabs = 50;
+  const size_t size = numSlabs * Slab::kSize;
+  size_t allocSize = size + sizeof(Slab);
+
+  void* memory = nullptr;
+  ShmManager shmManager("/tmp/test_advise" + std::to_string(::getpid()),
+                        false /* use posix */);
+  std::string shmName = "testShm_2_";
+  shmName += std::to_string(::getpid());
+  shmManager.createShm(shmName, allocSize, memory);
+
+  SCOPE_EXIT { shmManager.removeShm(shmName); };
+
+  memory = util::align(Slab::kSize, size, memory, allocSize);
+  SlabAllocator s(memory, size, getDefaultConfig());
+
+  std::vector<Slab*> slabs;
+  for (size_t i = 0; i < numSlabs; i++) {
+    auto* slab = s.makeNewSlab(0);
+    ASSERT_NE(nullptr, slab);
+    memset(slab->memoryAtOffset(0), 'a', Slab::kSize);
+    slabs.push_back(slab);
+  }
+
+  // two runs of contiguous slabs, out of order, are advised away with one
+  // madvise call each
+  std::vector<Slab*> toAdvise;
+  for (size_t i = 30; i > 20; i--) {
+    toAdvise.push_back(slabs[i]);
+  }
+  for (size_t i = 0; i < 10; i++) {
+    toAdvise.push_back(slabs[i]);
+  }
+  const auto callsBefore = s.getNumAdviseCalls();
+  ASSERT_TRUE(s.adviseSlabs(toAdvise).empty());
+  ASSERT_EQ(callsBefore + 2, s.getNumAdviseCalls());
+  ASSERT_EQ(20, s.numSlabsReclaimable());
+  ASSERT_EQ(0, util::getNumResidentPages(slabs[0], 10 * Slab::kSize));
+  ASSERT_EQ(0, util::getNumResidentPages(slabs[21], 10 * Slab::kSize));
+  for (auto* slab : toAdvise) {
+    ASSERT_TRUE(s.getSlabHeader(slab)->isAdvised());
+  }
+
+  // reclaim them in two batches
+  auto reclaimed = s.reclaimSlabs(0, 15);
+  ASSERT_EQ(15, reclaimed.size());
+  ASSERT_EQ(5, s.numSlabsReclaimable());
+  reclaimed = s.reclaimSlabs(0, 15);
+  ASSERT_EQ(5, reclaimed.size());
+  ASSERT_EQ(0, s.numSlabsReclaimable());
+  ASSERT_TRUE(s.reclaimSlabs(0, 1).empty());
+  ASSERT_EQ(util::getNumPages(20 * Slab::kSize),
+            util::getNumResidentPages(slabs[0], 10 * Slab::kSize) +
+                util::getNumResidentPages(slabs[21], 10 * Slab::kSize));
+}
+
 void testAdvise(SlabAllocator& s,
                 const size_t numSlabs,
                 const size_t numAdviseSlabs,
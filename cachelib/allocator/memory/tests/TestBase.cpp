@@ -103,7 +103,10 @@ bool AllocTestBase::isSameMemoryPoolManager(const MemoryPoolManager& m1,
     return false;
   }
 
-  return m1.poolsByName_ == m2.poolsByName_;
+  return *m1.poolsByName_.read() == *m2.poolsByName_.read() &&
+         std::equal(m1.poolNames_.begin(),
+                    m1.poolNames_.begin() + m1.nextPoolId_,
+                    m2.poolNames_.begin());
 }
 
 /* static */
@@ -99,6 +99,17 @@ class CacheAPIWrapperForNvm {
     return cache.insertImpl(handle, AllocatorApiEvent::INSERT_FROM_NVM);
   }
 
+  // Index the chunks of an item filled from nvmcache that was written as a
+  // large item, and mark it as one.
+  //
+  // @param cache   the cache instance using nvmcache
+  // @param parent  the parent item, with its chain added
+  // @return false if the item is not laid out as a large item or the chain
+  //         does not match its chunks
+  static bool rebuildLargeItemIndex(C& cache, Item& parent) {
+    return cache.rebuildLargeItemIndex(parent);
+  }
+
   // Acquire the wait context for the handle. This is used by nvmcache to
   // maintain a list of waiters.
   //
@@ -16,82 +16,146 @@
 
 #pragma once
 
-#include <folly/Hash.h>
-#include <folly/Range.h>
-#include <folly/container/F14Map.h>
-#include <folly/fibers/TimedMutex.h>
+#include <folly/Bits.h>
+#include <folly/Expected.h>
 #include <folly/lang/Align.h>
 #include <folly/logging/xlog.h>
 
+#include <array>
+#include <atomic>
+#include <thread>
 #include <utility>
 
+#include "cachelib/common/Hash.h"
+
 namespace facebook {
 namespace cachelib {
 
-using folly::fibers::TimedMutex;
-
 // Utility to track inflight puts in nvmcache through a token. Tokens can be
-// invalidated and can be used to execute some function if not invalidated. The
-// user guarantees that the lifetime of the token is within the lifetime of the
-// string piece with which they obtain the token.
+// invalidated and can be used to execute some function if not invalidated.
+//
+// The tokens are kept in a small fixed-size open-addressed table of key
+// hashes, probed over a bounded window. All operations are lock free except
+// that invalidating a token waits for a concurrent executeIfValid or
+// tryAcquireToken callback on the same key to finish. Two keys with the same
+// hash are treated as the same key, which only fails acquiring the token of
+// the second one. When the probe window of a key is full, acquiring a token
+// fails with TABLE_FULL.
 class alignas(folly::hardware_destructive_interference_size) InFlightPuts {
-  using LockGuard = std::lock_guard<TimedMutex>;
-  using UniqueLock = std::unique_lock<TimedMutex>;
-
  public:
   class PutToken;
 
-  enum class PutTokenError { TRY_LOCK_FAIL, TOKEN_EXISTS, CALLBACK_FAILED };
+  enum class PutTokenError { TABLE_FULL, TOKEN_EXISTS, CALLBACK_FAILED };
+
+  // number of slots of the table and how many of them a key probes
+  static constexpr uint32_t kNumSlots = 32;
+  static constexpr uint32_t kMaxProbe = 8;
 
-  // inserts an in-flight put into the map if none exists and acquires a
-  // token.  If a token is acquired successfully, will call fn() while
-  // holding the mutex_. If fn() returns false, deletes the token otherwise
-  // return the valid token.
+  InFlightPuts() = default;
+  InFlightPuts(const InFlightPuts&) = delete;
+  InFlightPuts& operator=(const InFlightPuts&) = delete;
+
+  // inserts an in-flight put into the table if none exists and acquires a
+  // token.  If a token is acquired successfully, will call fn() before it
+  // becomes visible to invalidateToken. If fn() returns false, deletes the
+  // token otherwise return the valid token.
   template <typename F>
-  folly::Expected<PutToken, PutTokenError> tryAcquireToken(
-      folly::StringPiece key, F&& fn) {
-    UniqueLock l(mutex_, std::try_to_lock);
-    if (!l.owns_lock()) {
-      return folly::makeUnexpected(PutTokenError::TRY_LOCK_FAIL);
+  folly::Expected<PutToken, PutTokenError> tryAcquireToken(HashedKey hk,
+                                                           F&& fn) {
+    const auto tag = getTag(hk.keyHash());
+    uint32_t slot = kNumSlots;
+    while (true) {
+      // record for same key being inflight written to nvmcache should be
+      // rare. In that case, fail the latter one.
+      slot = kNumSlots;
+      for (uint32_t i = 0; i < kMaxProbe; i++) {
+        const auto idx = getSlot(hk.keyHash(), i);
+        const auto val = slots_[idx].load();
+        if (val != kEmpty && (val & ~kStateMask) == tag) {
+          return folly::makeUnexpected(PutTokenError::TOKEN_EXISTS);
+        }
+        if (val == kEmpty && slot == kNumSlots) {
+          slot = idx;
+        }
+      }
+      if (slot == kNumSlots) {
+        return folly::makeUnexpected(PutTokenError::TABLE_FULL);
+      }
+      uint64_t expected = kEmpty;
+      if (slots_[slot].compare_exchange_strong(expected, tag | kBusy)) {
+        break;
+      }
     }
 
-    auto ret = keys_.emplace(key, true);
-    // record for same key being inflight written to nvmcache should be rare.
-    // In that case, fail the latter one.
-    if (!ret.second) {
-      return folly::makeUnexpected(PutTokenError::TOKEN_EXISTS);
+    // a racing acquisition for the same key could have claimed another free
+    // slot. Both claimed their slot before looking for the other one, so at
+    // most one of them proceeds.
+    for (uint32_t i = 0; i < kMaxProbe; i++) {
+      const auto idx = getSlot(hk.keyHash(), i);
+      const auto val = slots_[idx].load();
+      if (idx != slot && val != kEmpty && (val & ~kStateMask) == tag) {
+        slots_[slot].store(kEmpty);
+        return folly::makeUnexpected(PutTokenError::TOKEN_EXISTS);
+      }
     }
 
     bool fnRet = std::forward<F>(fn)();
     if (fnRet) {
-      return PutToken{key, *this};
+      slots_[slot].store(tag | kValid);
+      return PutToken{tag, slot, *this};
     }
 
     // if fn() failed, erase the token
-    auto eraseRet = keys_.erase(key);
-    XDCHECK_EQ(eraseRet, 1u);
+    slots_[slot].store(kEmpty);
     return folly::makeUnexpected(PutTokenError::CALLBACK_FAILED);
   }
 
   // marks the token as invalidated. This will ensure that we dont execute any
   // function on this token and simply remove the token when the token gets
   // destroyed.
-  void invalidateToken(folly::StringPiece key) {
-    LockGuard l(mutex_);
-    auto it = keys_.find(key);
-    if (it != keys_.end()) {
-      it->second = false;
+  void invalidateToken(HashedKey hk) {
+    const auto tag = getTag(hk.keyHash());
+    for (uint32_t i = 0; i < kMaxProbe; i++) {
+      auto& slot = slots_[getSlot(hk.keyHash(), i)];
+      auto val = slot.load();
+      while ((val & ~kStateMask) == tag && val != kEmpty) {
+        if ((val & kStateMask) == kValid) {
+          if (slot.compare_exchange_weak(val, tag | kInvalid)) {
+            break;
+          }
+        } else if ((val & kStateMask) == kBusy) {
+          // the callback of the token is running. Wait for it to finish, as
+          // if it held a lock.
+          std::this_thread::yield();
+          val = slot.load();
+        } else {
+          break;
+        }
+      }
     }
   }
 
-  // Represents an insertion into the inflight map. this token can be used to
-  // execute some action if the token was not invalidated in the mean time.
+  // @return true if there is a token for the key, valid or not. The put is
+  // either about to be enqueued to navy or just dropped.
+  bool isPresent(HashedKey hk) const {
+    const auto tag = getTag(hk.keyHash());
+    for (uint32_t i = 0; i < kMaxProbe; i++) {
+      const auto val = slots_[getSlot(hk.keyHash(), i)].load();
+      if (val != kEmpty && (val & ~kStateMask) == tag) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Represents an insertion into the inflight table. this token can be used
+  // to execute some action if the token was not invalidated in the mean time.
   class PutToken {
    public:
     PutToken() noexcept {}
     ~PutToken() {
       if (puts_) {
-        puts_->removeToken(key_);
+        puts_->removeToken(tag_, slot_);
       }
     }
 
@@ -100,7 +164,8 @@ class alignas(folly::hardware_destructive_interference_size) InFlightPuts {
     PutToken& operator=(const PutToken&) = delete;
 
     // moving is okay
-    PutToken(PutToken&& other) noexcept : key_(other.key_), puts_(other.puts_) {
+    PutToken(PutToken&& other) noexcept
+        : tag_(other.tag_), slot_(other.slot_), puts_(other.puts_) {
       other.reset();
     }
 
@@ -121,7 +186,7 @@ class alignas(folly::hardware_destructive_interference_size) InFlightPuts {
     template <typename F>
     bool executeIfValid(F&& fn) {
       if (isValid() &&
-          puts_->executeIfValid(key_, std::forward<decltype(fn)>(fn))) {
+          puts_->executeIfValid(tag_, slot_, std::forward<decltype(fn)>(fn))) {
         // successfully executed, reset the token.
         reset();
         return true;
@@ -132,54 +197,80 @@ class alignas(folly::hardware_destructive_interference_size) InFlightPuts {
    private:
     void reset() noexcept {
       puts_ = nullptr;
-      key_.clear();
+      tag_ = 0;
+      slot_ = 0;
       XDCHECK(!isValid());
     }
 
     friend InFlightPuts;
-    PutToken(folly::StringPiece key, InFlightPuts& puts)
-        : key_(key), puts_(&puts) {}
+    PutToken(uint64_t tag, uint32_t slot, InFlightPuts& puts)
+        : tag_(tag), slot_(slot), puts_(&puts) {}
 
-    // key corresponding to the token
-    folly::StringPiece key_{};
+    // key hash of the token, without the state bits
+    uint64_t tag_{0};
 
-    // map holding the state
+    // slot of the table holding the token
+    uint32_t slot_{0};
+
+    // table holding the state
     InFlightPuts* puts_{nullptr};
   };
 
  private:
+  // the low bits of a slot hold the state of the token. An empty slot is 0.
+  static constexpr uint64_t kStateMask = 3;
+  static constexpr uint64_t kEmpty = 0;
+  static constexpr uint64_t kValid = 1;
+  static constexpr uint64_t kInvalid = 2;
+  // a callback is running for the token
+  static constexpr uint64_t kBusy = 3;
+
+  static_assert(folly::isPowTwo(kNumSlots), "slots must be a power of two");
+  static_assert(kMaxProbe <= kNumSlots, "probe window larger than the table");
+
+  static uint64_t getTag(uint64_t keyHash) noexcept {
+    return keyHash & ~kStateMask;
+  }
+
+  // the low bits of the hash pick the shard, so probe with the high bits.
+  static uint32_t getSlot(uint64_t keyHash, uint32_t probe) noexcept {
+    return static_cast<uint32_t>((keyHash >> 32) + probe) & (kNumSlots - 1);
+  }
+
   // execute only if the token is present and was not invalidated.
-  //  @param key the item key
-  //  @param fn  function to execute
+  //  @param tag   the key hash of the token
+  //  @param slot  the slot of the token
+  //  @param fn    function to execute
   //
   //  @return  true if the function was executed and token was destroyed
   //          appropriately
   //  @throw    if fn throws, token is preserved.
   template <typename F>
-  bool executeIfValid(folly::StringPiece key, F&& fn) {
-    LockGuard l(mutex_);
-    auto it = keys_.find(key);
-    const bool valid = it != keys_.end() && it->second;
-    if (valid) {
+  bool executeIfValid(uint64_t tag, uint32_t slot, F&& fn) {
+    uint64_t expected = tag | kValid;
+    if (!slots_[slot].compare_exchange_strong(expected, tag | kBusy)) {
+      return false;
+    }
+    try {
       fn();
-      keys_.erase(it);
-      return true;
+    } catch (...) {
+      slots_[slot].store(tag | kValid);
+      throw;
     }
-    return false;
+    slots_[slot].store(kEmpty);
+    return true;
   }
 
-  // erases the record from inflight map.
-  void removeToken(folly::StringPiece key) {
-    LockGuard l(mutex_);
-    auto res = keys_.erase(key);
-    XDCHECK_EQ(res, 1u);
+  // erases the record from inflight table.
+  void removeToken(uint64_t tag, uint32_t slot) {
+    XDCHECK_EQ(slots_[slot].load() & ~kStateMask, tag);
+    slots_[slot].store(kEmpty);
   }
 
-  // map storing the presence of a token  and its validity
-  folly::F14FastMap<folly::StringPiece, bool, folly::Hash> keys_;
-
-  // mutex protecting the map.
-  TimedMutex mutex_;
+  // tokens by their key hash and state. All accesses are sequentially
+  // consistent so that an invalidation either sees a token or happens
+  // before the token is acquired.
+  std::array<std::atomic<uint64_t>, kNumSlots> slots_{};
 };
 
 } // namespace cachelib
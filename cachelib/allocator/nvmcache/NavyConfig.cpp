@@ -76,6 +76,36 @@ void NavyConfig::enableAsyncIo(unsigned int qDepth, bool enableIoUring) {
   }
 }
 
+void MemoryDeviceEmulationConfig::validate() const {
+  for (const auto* latencies : {&readLatencyUs, &writeLatencyUs}) {
+    double lastPct = 0;
+    uint32_t lastLatency = 0;
+    for (const auto& [pct, latency] : *latencies) {
+      if (pct <= lastPct || pct > 100 || latency < lastLatency) {
+        throw std::invalid_argument(folly::sformat(
+            "Emulated latency percentiles must increase within (0, 100] "
+            "with non decreasing latencies, but got p{} of {}us after p{} of "
+            "{}us",
+            pct, latency, lastPct, lastLatency));
+      }
+      lastPct = pct;
+      lastLatency = latency;
+    }
+  }
+}
+
+void IoBudgetConfig::validate() const {
+  if (userReadShare == 0 || flushShare == 0 || reclaimReadShare == 0 ||
+      reinsertionShare == 0 || burstMs == 0) {
+    throw std::invalid_argument(folly::sformat(
+        "IO budget shares and burst must be positive, but got user read "
+        "share {}, flush share {}, reclaim read share {}, reinsertion share "
+        "{} and burst {}ms",
+        userReadShare, flushShare, reclaimReadShare, reinsertionShare,
+        burstMs));
+  }
+}
+
 void NavyConfig::setSimpleFile(const std::string& fileName,
                                uint64_t fileSize,
                                bool truncateFile) {
@@ -114,6 +144,12 @@ BlockCacheConfig& BlockCacheConfig::enablePctBasedReinsertion(
   return *this;
 }
 
+BlockCacheConfig& BlockCacheConfig::enableReuseBasedReinsertion(
+    uint8_t reuseThreshold, uint64_t maxBytesPerSec) {
+  reinsertionConfig_.enableReuseBased(reuseThreshold, maxBytesPerSec);
+  return *this;
+}
+
 BlockCacheConfig& BlockCacheConfig::enableCustomReinsertion(
     std::shared_ptr<BlockCacheReinsertionPolicy> policy) {
   reinsertionConfig_.enableCustom(
@@ -163,6 +199,25 @@ BigHashConfig& BigHashConfig::setSizePctAndMaxItemSize(
   return *this;
 }
 
+BigHashConfig& BigHashConfig::setLog(unsigned int logSizePct,
+                                     uint32_t segmentSize,
+                                     uint32_t moveThreshold) {
+  if (logSizePct >= 100) {
+    throw std::invalid_argument(folly::sformat(
+        "BigHash log size pct should be in the range of [0, 100), but {} is "
+        "set",
+        logSizePct));
+  }
+  if (segmentSize == 0 || moveThreshold == 0) {
+    throw std::invalid_argument(
+        "BigHash log segment size and move threshold must be positive");
+  }
+  logSizePct_ = logSizePct;
+  logSegmentSize_ = segmentSize;
+  logMoveThreshold_ = moveThreshold;
+  return *this;
+}
+
 // job scheduler settings
 
 void NavyConfig::setReaderAndWriterThreads(unsigned int readerThreads,
@@ -219,30 +274,106 @@ void NavyConfig::setNavyReqOrderingShards(uint64_t navyReqOrderingShards) {
   navyReqOrderingShards_ = navyReqOrderingShards;
 }
 
+void NavyConfig::setPoolEnginePairs(std::vector<size_t> poolEnginePairs,
+                                    PoolResolver resolver) {
+  if (!resolver) {
+    throw std::invalid_argument(
+        "Pool engine pairs need a resolver from keys to pools");
+  }
+  poolEnginePairs_ = std::move(poolEnginePairs);
+  poolResolver_ = std::move(resolver);
+}
+
+void NavyConfig::setInflightTrackingShards(uint32_t inflightTrackingShards) {
+  if (inflightTrackingShards == 0) {
+    throw std::invalid_argument(
+        "Inflight tracking shards should always be non-zero");
+  }
+  inflightTrackingShards_ = inflightTrackingShards;
+}
+
+EnginesConfig& EnginesConfig::addBlockCacheBand(uint32_t maxItemSize,
+                                                BlockCacheConfig config) {
+  if (!blockCacheBands_.empty() &&
+      maxItemSize <= blockCacheBands_.back().first) {
+    throw std::invalid_argument(folly::sformat(
+        "block cache band max item size: {} must be larger than the previous "
+        "one: {}",
+        maxItemSize, blockCacheBands_.back().first));
+  }
+  if (config.getSize() == 0) {
+    throw std::invalid_argument("block cache band needs a size");
+  }
+  blockCacheBands_.emplace_back(maxItemSize, std::move(config));
+  return *this;
+}
+
 std::map<std::string, std::string> EnginesConfig::serialize() const {
   auto configMap = std::map<std::string, std::string>();
 
   // BlockCache settings
   configMap["navyConfig::blockCacheLru"] =
       blockCache().isLruEnabled() ? "true" : "false";
+  configMap["navyConfig::blockCacheHitDensity"] =
+      blockCache().isHitDensityEnabled() ? "true" : "false";
   configMap["navyConfig::blockCacheRegionSize"] =
       folly::to<std::string>(blockCache().getRegionSize());
   configMap["navyConfig::blockCacheCleanRegions"] =
       folly::to<std::string>(blockCache().getCleanRegions());
   configMap["navyConfig::blockCacheCleanRegionThreads"] =
       folly::to<std::string>(blockCache().getCleanRegionThreads());
+  configMap["navyConfig::blockCacheMaxCleanRegions"] =
+      folly::to<std::string>(blockCache().getMaxCleanRegions());
+  configMap["navyConfig::blockCacheReadPageCacheSize"] =
+      folly::to<std::string>(blockCache().getReadPageCacheSize());
+  configMap["navyConfig::blockCacheFlushedRegionCacheSize"] =
+      folly::to<std::string>(blockCache().getFlushedRegionCacheSize());
   configMap["navyConfig::blockCacheReinsertionHitsThreshold"] =
       folly::to<std::string>(
           blockCache().getReinsertionConfig().getHitsThreshold());
   configMap["navyConfig::blockCacheReinsertionPctThreshold"] =
       folly::to<std::string>(
           blockCache().getReinsertionConfig().getPctThreshold());
+  configMap["navyConfig::blockCacheReinsertionReuseThreshold"] =
+      folly::to<std::string>(
+          blockCache().getReinsertionConfig().getReuseThreshold());
+  configMap["navyConfig::blockCacheReinsertionReuseMaxBytesPerSec"] =
+      folly::to<std::string>(
+          blockCache().getReinsertionConfig().getReuseMaxBytesPerSec());
   configMap["navyConfig::blockCacheNumInMemBuffers"] =
       folly::to<std::string>(blockCache().getNumInMemBuffers());
+  configMap["navyConfig::blockCacheStreamSizeLimits"] =
+      folly::join(",", blockCache().getStreamSizeLimits());
   configMap["navyConfig::blockCacheDataChecksum"] =
       blockCache().getDataChecksum() ? "true" : "false";
+  configMap["navyConfig::blockCacheLookupChecksumPct"] =
+      folly::to<std::string>(blockCache().getLookupChecksumPct());
   configMap["navyConfig::blockCacheSegmentedFifoSegmentRatio"] =
       folly::join(",", blockCache().getSFifoSegmentRatio());
+  configMap["navyConfig::blockCacheFixedSizeIndexItems"] =
+      folly::to<std::string>(blockCache().getFixedSizeIndexItems());
+  configMap["navyConfig::blockCachePackedEntryAlignSize"] =
+      folly::to<std::string>(blockCache().getPackedEntryAlignSize());
+  configMap["navyConfig::blockCachePlacementByPriority"] =
+      folly::to<std::string>(blockCache().isPlacementByPriority());
+  configMap["navyConfig::blockCacheIndexCheckpointFile"] =
+      blockCache().getIndexCheckpointFile();
+  configMap["navyConfig::blockCacheIndexCheckpointInterval"] =
+      folly::to<std::string>(blockCache().getIndexCheckpointInterval().count());
+  configMap["navyConfig::blockCacheLazyIndexRecovery"] =
+      folly::to<std::string>(blockCache().isLazyIndexRecovery());
+  configMap["navyConfig::blockCacheIndexRecoveryThreads"] =
+      folly::to<std::string>(blockCache().getIndexRecoveryThreads());
+  configMap["navyConfig::blockCacheFlatIndexPersistence"] =
+      folly::to<std::string>(blockCache().isFlatIndexPersistence());
+  // <max item size>:<region size>:<size> of every band
+  std::vector<std::string> bands;
+  for (const auto& [maxItemSize, bandConfig] : blockCacheBands_) {
+    bands.push_back(folly::sformat("{}:{}:{}", maxItemSize,
+                                   bandConfig.getRegionSize(),
+                                   bandConfig.getSize()));
+  }
+  configMap["navyConfig::blockCacheBands"] = folly::join(",", bands);
 
   // BigHash settings
   configMap["navyConfig::bigHashSizePct"] =
@@ -253,6 +384,24 @@ std::map<std::string, std::string> EnginesConfig::serialize() const {
       folly::to<std::string>(bigHash().getBucketBfSize());
   configMap["navyConfig::bigHashSmallItemMaxSize"] =
       folly::to<std::string>(bigHash().getSmallItemMaxSize());
+  configMap["navyConfig::bigHashBlockedBloomFilter"] =
+      bigHash().isBlockedBloomFilterEnabled() ? "true" : "false";
+  configMap["navyConfig::bigHashTwoChoiceHashing"] =
+      bigHash().isTwoChoiceHashingEnabled() ? "true" : "false";
+  configMap["navyConfig::bigHashWriteBatchSize"] =
+      folly::to<std::string>(bigHash().getWriteBatchSize());
+  configMap["navyConfig::bigHashStagingMemoryMB"] =
+      folly::to<std::string>(bigHash().getStagingMemoryMB());
+  configMap["navyConfig::bigHashBucketCacheSize"] =
+      folly::to<std::string>(bigHash().getBucketCacheSize());
+  configMap["navyConfig::bigHashRecoveryThreads"] =
+      folly::to<std::string>(bigHash().getRecoveryThreads());
+  configMap["navyConfig::bigHashLogSizePct"] =
+      folly::to<std::string>(bigHash().getLogSizePct());
+  configMap["navyConfig::bigHashLogSegmentSize"] =
+      folly::to<std::string>(bigHash().getLogSegmentSize());
+  configMap["navyConfig::bigHashLogMoveThreshold"] =
+      folly::to<std::string>(bigHash().getLogMoveThreshold());
   return configMap;
 }
 
@@ -284,11 +433,54 @@ std::map<std::string, std::string> NavyConfig::serialize() const {
       std::to_string(deviceMetadataSize_);
   configMap["navyConfig::fileSize"] = folly::to<std::string>(fileSize_);
   configMap["navyConfig::truncateFile"] = truncateFile_ ? "true" : "false";
+  if (memoryDeviceEmulation_.isEnabled()) {
+    auto formatLatencies = [](const auto& latencies) {
+      std::vector<std::string> points;
+      for (const auto& [pct, latency] : latencies) {
+        points.push_back(folly::sformat("p{}:{}us", pct, latency));
+      }
+      return folly::join(",", points);
+    };
+    configMap["navyConfig::emulatedReadLatency"] =
+        formatLatencies(memoryDeviceEmulation_.readLatencyUs);
+    configMap["navyConfig::emulatedWriteLatency"] =
+        formatLatencies(memoryDeviceEmulation_.writeLatencyUs);
+    configMap["navyConfig::emulatedReadBandwidthMBps"] =
+        folly::to<std::string>(memoryDeviceEmulation_.readBandwidthMBps);
+    configMap["navyConfig::emulatedWriteBandwidthMBps"] =
+        folly::to<std::string>(memoryDeviceEmulation_.writeBandwidthMBps);
+    configMap["navyConfig::emulatedQueueDepth"] =
+        folly::to<std::string>(memoryDeviceEmulation_.queueDepth);
+  }
   configMap["navyConfig::deviceMaxWriteSize"] =
       folly::to<std::string>(deviceMaxWriteSize_);
+  if (ioBudget_.isEnabled()) {
+    configMap["navyConfig::ioBudgetBytesPerSec"] =
+        folly::to<std::string>(ioBudget_.bytesPerSec);
+    configMap["navyConfig::ioBudgetShares"] = folly::sformat(
+        "user_read:{},flush:{},reclaim_read:{},reinsertion:{}",
+        ioBudget_.userReadShare, ioBudget_.flushShare,
+        ioBudget_.reclaimReadShare, ioBudget_.reinsertionShare);
+    configMap["navyConfig::ioBudgetBurstMs"] =
+        folly::to<std::string>(ioBudget_.burstMs);
+  }
   configMap["navyConfig::ioEngine"] = getIoEngineName(ioEngine_).str();
   configMap["navyConfig::QDepth"] = folly::to<std::string>(qDepth_);
+  configMap["navyConfig::ioUringRegisteredBufferSize"] =
+      folly::to<std::string>(ioUringRegisteredBufferSize_);
+  configMap["navyConfig::ioCompletionPollUs"] =
+      folly::to<std::string>(ioCompletionPollUs_);
+  configMap["navyConfig::ioThreadCpus"] = folly::join(",", ioThreadCpus_);
+  configMap["navyConfig::nvmePassthrough"] =
+      folly::to<std::string>(nvmePassthrough_);
+  configMap["navyConfig::qDepthPerFile"] =
+      folly::to<std::string>(qDepthPerFile_);
+  configMap["navyConfig::qDepthTargetLatencyUs"] =
+      folly::to<std::string>(qDepthTargetLatencyUs_);
+  configMap["navyConfig::batchWriteChunks"] =
+      folly::to<std::string>(batchWriteChunks_);
   configMap["navyConfig::enableFDP"] = folly::to<std::string>(enableFDP_);
+  configMap["navyConfig::subPageReads"] = subPageReads_ ? "true" : "false";
 
   // Job scheduler settings
   configMap["navyConfig::readerThreads"] =
@@ -297,15 +489,25 @@ std::map<std::string, std::string> NavyConfig::serialize() const {
       folly::to<std::string>(writerThreads_);
   configMap["navyConfig::navyReqOrderingShards"] =
       folly::to<std::string>(navyReqOrderingShards_);
+  configMap["navyConfig::workStealing"] = folly::to<std::string>(workStealing_);
   configMap["navyConfig::maxNumReads"] = folly::to<std::string>(maxNumReads_);
   configMap["navyConfig::maxNumWrites"] = folly::to<std::string>(maxNumWrites_);
   configMap["navyConfig::stackSize"] = folly::to<std::string>(stackSize_);
+  configMap["navyConfig::maxPooledFibers"] =
+      folly::to<std::string>(maxPooledFibers_);
+  configMap["navyConfig::keyAffinityCpus"] = folly::join(",", keyAffinityCpus_);
 
   // Other settings
   configMap["navyConfig::maxConcurrentInserts"] =
       folly::to<std::string>(maxConcurrentInserts_);
   configMap["navyConfig::maxParcelMemoryMB"] =
       folly::to<std::string>(maxParcelMemoryMB_);
+  configMap["navyConfig::inflightTrackingShards"] =
+      folly::to<std::string>(inflightTrackingShards_);
+  configMap["navyConfig::sizeAdvisorSampleRate"] =
+      folly::to<std::string>(sizeAdvisorSampleRate_);
+
+  configMap["navyConfig::poolEnginePairs"] = folly::join(",", poolEnginePairs_);
 
   if (enginesConfigs_.size() > 1) {
     for (size_t idx = 0; idx < enginesConfigs_.size(); idx++) {
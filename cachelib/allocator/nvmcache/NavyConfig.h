@@ -17,9 +17,14 @@
 #pragma once
 
 #include <folly/json/dynamic.h>
+#include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
 
+#include <chrono>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "cachelib/allocator/nvmcache/BlockCacheReinsertionPolicy.h"
 #include "cachelib/common/Hash.h"
@@ -160,7 +165,7 @@ class DynamicRandomAPConfig {
 class BlockCacheReinsertionConfig {
  public:
   BlockCacheReinsertionConfig& enableHitsBased(uint8_t hitsThreshold) {
-    if (pctThreshold_ > 0 || makeCustomPolicy_) {
+    if (pctThreshold_ > 0 || reuseThreshold_ > 0 || makeCustomPolicy_) {
       throw std::invalid_argument(
           "already set reinsertion percentage threshold, should not set "
           "reinsertion hits threshold");
@@ -171,7 +176,7 @@ class BlockCacheReinsertionConfig {
   }
 
   BlockCacheReinsertionConfig& enablePctBased(unsigned int pctThreshold) {
-    if (hitsThreshold_ > 0 || makeCustomPolicy_) {
+    if (hitsThreshold_ > 0 || reuseThreshold_ > 0 || makeCustomPolicy_) {
       throw std::invalid_argument(
           "already set reinsertion hits threshold, should not set reinsertion "
           "probability threshold");
@@ -186,10 +191,30 @@ class BlockCacheReinsertionConfig {
     return *this;
   }
 
+  // @param reuseThreshold  minimum reuse score, hits since the last write
+  //                        plus half the hits before, to reinsert an item
+  // @param maxBytesPerSec  cap on the bytes reinserted per second, 0 for no
+  //                        cap
+  BlockCacheReinsertionConfig& enableReuseBased(uint8_t reuseThreshold,
+                                                uint64_t maxBytesPerSec) {
+    if (hitsThreshold_ > 0 || pctThreshold_ > 0 || makeCustomPolicy_) {
+      throw std::invalid_argument(
+          "already set another reinsertion policy, should not set reinsertion "
+          "reuse threshold");
+    }
+    if (reuseThreshold == 0) {
+      throw std::invalid_argument(
+          "reinsertion reuse threshold should be greater than 0");
+    }
+    reuseThreshold_ = reuseThreshold;
+    reuseMaxBytesPerSec_ = maxBytesPerSec;
+    return *this;
+  }
+
   BlockCacheReinsertionConfig& enableCustom(
       std::function<std::shared_ptr<BlockCacheReinsertionPolicy>(const Index&)>
           makeCustomPolicy) {
-    if (hitsThreshold_ > 0 || pctThreshold_ > 0) {
+    if (hitsThreshold_ > 0 || pctThreshold_ > 0 || reuseThreshold_ > 0) {
       throw std::invalid_argument(
           "Already set reinsertion hits threshold {}, or reinsertion "
           "probability threshold {} while trying to set a custom reinsertion "
@@ -200,13 +225,14 @@ class BlockCacheReinsertionConfig {
   }
 
   BlockCacheReinsertionConfig& validate() {
-    if ((pctThreshold_ > 0) + (hitsThreshold_ > 0) +
+    if ((pctThreshold_ > 0) + (hitsThreshold_ > 0) + (reuseThreshold_ > 0) +
             (makeCustomPolicy_ != nullptr) >
         1) {
       throw std::invalid_argument(folly::sformat(
           "More than one configuration for reinsertion policy is specified: "
-          "pctThreshold_ {}, hitsThreshold_ {}, custom_ {}",
-          pctThreshold_, hitsThreshold_, makeCustomPolicy_ != nullptr));
+          "pctThreshold_ {}, hitsThreshold_ {}, reuseThreshold_ {}, custom_ {}",
+          pctThreshold_, hitsThreshold_, reuseThreshold_,
+          makeCustomPolicy_ != nullptr));
     }
     return *this;
   }
@@ -215,6 +241,10 @@ class BlockCacheReinsertionConfig {
 
   unsigned int getPctThreshold() const { return pctThreshold_; }
 
+  uint8_t getReuseThreshold() const { return reuseThreshold_; }
+
+  uint64_t getReuseMaxBytesPerSec() const { return reuseMaxBytesPerSec_; }
+
   std::shared_ptr<BlockCacheReinsertionPolicy> getCustomPolicy(
       const Index& index) const {
     ensureCustomPolicy(index);
@@ -231,6 +261,11 @@ class BlockCacheReinsertionConfig {
   // Threshold of a percentage based reinsertion policy with Navy BlockCache.
   // The percentage value is between 0 and 100 for reinsertion.
   unsigned int pctThreshold_{0};
+  // Threshold and write budget of a reuse based reinsertion policy. Items
+  // whose reuse score reaches the threshold are reinserted while fewer than
+  // reuseMaxBytesPerSec_ bytes were reinserted in the last second.
+  uint8_t reuseThreshold_{0};
+  uint64_t reuseMaxBytesPerSec_{0};
 
   // A constructor for a custom reinsertion policy.
   std::function<std::shared_ptr<BlockCacheReinsertionPolicy>(const Index&)>
@@ -263,6 +298,15 @@ class BlockCacheConfig {
   // Enable FIFO eviction policy (LRU will be disabled).
   BlockCacheConfig& enableFifo() noexcept {
     lru_ = false;
+    hitDensity_ = false;
+    return *this;
+  }
+
+  // Enable hit density eviction policy (LRU will be disabled). Evicts the
+  // region with the fewest recent hits per byte among the oldest regions.
+  BlockCacheConfig& enableHitDensity() noexcept {
+    lru_ = false;
+    hitDensity_ = true;
     return *this;
   }
 
@@ -294,6 +338,16 @@ class BlockCacheConfig {
   //        been enabled or the input value is not in the range of 0~100.
   BlockCacheConfig& enablePctBasedReinsertion(unsigned int pctThreshold);
 
+  // Enable reuse based reinsertion policy.
+  // Evicted items are reinserted when their hits predict they will be read
+  // again: hits since the last write count fully, earlier hits count half.
+  // At most @maxBytesPerSec bytes are reinserted per second, 0 for no cap,
+  // to bound the device writes reinsertions cost.
+  // @throw std::invalid_argument if any other reinsertion policy has been
+  //        enabled or @reuseThreshold is 0.
+  BlockCacheConfig& enableReuseBasedReinsertion(uint8_t reuseThreshold,
+                                                uint64_t maxBytesPerSec = 0);
+
   // Enable a customized reinsertion policy created by the user.
   // @throw std::invalid_argument if any other reinsertion policy has been
   // enabled.
@@ -317,6 +371,43 @@ class BlockCacheConfig {
   BlockCacheConfig& setCleanRegions(uint32_t cleanRegions,
                                     uint32_t cleanRegionThreads = 1);
 
+  // Let the number of clean regions follow the write rate, between the one
+  // set with setCleanRegions() and @maxCleanRegions. The pool grows when
+  // regions are allocated faster than a reclaim completes, so inserts do not
+  // wait for a clean region under bursts of writes.
+  BlockCacheConfig& setMaxCleanRegions(uint32_t maxCleanRegions) noexcept {
+    maxCleanRegions_ = maxCleanRegions;
+    return *this;
+  }
+
+  // Keep up to @size bytes of recently read device pages in DRAM. Lookups of
+  // small items that share a page with an item read just before are then
+  // served without another device read.
+  BlockCacheConfig& setReadPageCacheSize(uint64_t size) noexcept {
+    readPageCacheSize_ = size;
+    return *this;
+  }
+
+  // Keep the in-mem buffers of the most recently flushed regions, up to
+  // @size bytes rounded down to whole regions, so that newly written items,
+  // the most likely to be read again, are still read from DRAM after their
+  // region is flushed. The buffers are allocated on top of the in-mem
+  // buffers.
+  BlockCacheConfig& setFlushedRegionCacheSize(uint64_t size) noexcept {
+    flushedRegionCacheSize_ = size;
+    return *this;
+  }
+
+  // Split writes by item size into streams that fill their own regions:
+  // items up to @limits[i] bytes go to stream i, larger ones to a last
+  // stream. Regions then hold items of similar sizes, so reclaiming a region
+  // of large items does not evict many small hot items with it.
+  // @param limits  ascending item size limits, each below the region size
+  BlockCacheConfig& setStreamSizeLimits(std::vector<uint32_t> limits) noexcept {
+    streamSizeLimits_ = std::move(limits);
+    return *this;
+  }
+
   BlockCacheConfig& setRegionSize(uint32_t regionSize) noexcept {
     regionSize_ = regionSize;
     return *this;
@@ -327,6 +418,21 @@ class BlockCacheConfig {
     return *this;
   }
 
+  // With data checksum enabled, verify the value checksum on this percent
+  // of the lookups reading from the device, picked at random. Checksums are
+  // still computed on every insert and verified on reclaim.
+  // @throw std::invalid_argument if @pct is above 100.
+  BlockCacheConfig& setLookupChecksumPct(uint32_t pct) {
+    if (pct > 100) {
+      throw std::invalid_argument(folly::sformat(
+          "lookup checksum percentage should be between 0 and 100, but {} "
+          "is set",
+          pct));
+    }
+    lookupChecksumPct_ = pct;
+    return *this;
+  }
+
   BlockCacheConfig& setPreciseRemove(bool preciseRemove) noexcept {
     preciseRemove_ = preciseRemove;
     return *this;
@@ -337,8 +443,78 @@ class BlockCacheConfig {
     return *this;
   }
 
+  // Index the items with a packed index sized up front for @maxNumItems
+  // items instead of a hash map that grows with them. It takes less DRAM per
+  // item, but starts dropping items once full and counts only up to 7 hits,
+  // so it does not support a higher hits based reinsertion threshold.
+  BlockCacheConfig& useFixedSizeIndex(uint64_t maxNumItems) noexcept {
+    fixedSizeIndexItems_ = maxNumItems;
+    return *this;
+  }
+
+  // Pack the entries of a region at @alignSize bytes, a power of two from 32
+  // to 256, instead of 512 bytes so that small items waste less space. The
+  // alignment still grows with the device size on devices larger than
+  // @alignSize * 4GB.
+  BlockCacheConfig& setPackedEntryAlignSize(uint32_t alignSize) {
+    if (alignSize != 0 &&
+        (!folly::isPowTwo(alignSize) || alignSize < 32 || alignSize > 256)) {
+      throw std::invalid_argument(folly::sformat(
+          "packed entry alignment should be a power of two from 32 to 256, but "
+          "{} is set",
+          alignSize));
+    }
+    packedEntryAlignSize_ = alignSize;
+    return *this;
+  }
+
+  // Write the regions of every priority with their own placement handle of
+  // an FDP device, separating newly admitted items from reinserted ones by
+  // reclaim unit. Needs FDP and reinsertion with more than one priority to
+  // have an effect.
+  BlockCacheConfig& setPlacementByPriority(bool enable) noexcept {
+    placementByPriority_ = enable;
+    return *this;
+  }
+
+  // Checkpoint the index to @file instead of persisting it at shutdown with
+  // the rest of the metadata. The file gets the whole index at first, then
+  // every @interval (0 for never) only the buckets changed since the previous
+  // checkpoint, and so does the shutdown. With @lazyRecovery, the cache
+  // serves right after a warm restart and loads the index in the background.
+  // Every block cache needs its own file.
+  BlockCacheConfig& setIndexCheckpoint(std::string file,
+                                       std::chrono::seconds interval,
+                                       bool lazyRecovery) {
+    if (file.empty()) {
+      throw std::invalid_argument("index checkpoint file must be set");
+    }
+    indexCheckpointFile_ = std::move(file);
+    indexCheckpointInterval_ = interval;
+    lazyIndexRecovery_ = lazyRecovery;
+    return *this;
+  }
+
+  // Number of threads decoding the index on a warm restart. Default value
+  // is 4.
+  BlockCacheConfig& setIndexRecoveryThreads(uint32_t numThreads) noexcept {
+    indexRecoveryThreads_ = numThreads;
+    return *this;
+  }
+
+  // Persist the index as flat arrays of entries, which recover faster than
+  // the default thrift objects. Either format is recovered regardless, but
+  // older versions can't recover the flat one. Not supported with the fixed
+  // size index.
+  BlockCacheConfig& setFlatIndexPersistence(bool enable) noexcept {
+    flatIndexPersistence_ = enable;
+    return *this;
+  }
+
   bool isLruEnabled() const { return lru_; }
 
+  bool isHitDensityEnabled() const { return hitDensity_; }
+
   const std::vector<unsigned int>& getSFifoSegmentRatio() const {
     return sFifoSegmentRatio_;
   }
@@ -347,12 +523,24 @@ class BlockCacheConfig {
 
   uint32_t getCleanRegionThreads() const { return cleanRegionThreads_; }
 
+  uint32_t getMaxCleanRegions() const { return maxCleanRegions_; }
+
+  uint64_t getReadPageCacheSize() const { return readPageCacheSize_; }
+
+  uint64_t getFlushedRegionCacheSize() const { return flushedRegionCacheSize_; }
+
   uint32_t getNumInMemBuffers() const { return numInMemBuffers_; }
 
+  const std::vector<uint32_t>& getStreamSizeLimits() const {
+    return streamSizeLimits_;
+  }
+
   uint32_t getRegionSize() const { return regionSize_; }
 
   bool getDataChecksum() const { return dataChecksum_; }
 
+  uint32_t getLookupChecksumPct() const { return lookupChecksumPct_; }
+
   uint64_t getSize() const { return size_; }
 
   const BlockCacheReinsertionConfig& getReinsertionConfig() const {
@@ -361,9 +549,32 @@ class BlockCacheConfig {
 
   bool isPreciseRemove() const { return preciseRemove_; }
 
+  uint64_t getFixedSizeIndexItems() const { return fixedSizeIndexItems_; }
+
+  uint32_t getPackedEntryAlignSize() const { return packedEntryAlignSize_; }
+
+  bool isPlacementByPriority() const { return placementByPriority_; }
+
+  const std::string& getIndexCheckpointFile() const {
+    return indexCheckpointFile_;
+  }
+
+  std::chrono::seconds getIndexCheckpointInterval() const {
+    return indexCheckpointInterval_;
+  }
+
+  bool isLazyIndexRecovery() const { return lazyIndexRecovery_; }
+
+  uint32_t getIndexRecoveryThreads() const { return indexRecoveryThreads_; }
+
+  bool isFlatIndexPersistence() const { return flatIndexPersistence_; }
+
  private:
   // Whether Navy BlockCache will use region-based LRU eviction policy.
   bool lru_{true};
+  // Whether Navy BlockCache will use hit density eviction policy.
+  // Once enabled, lru_ will be false.
+  bool hitDensity_{false};
   // The ratio of segments for segmented FIFO eviction policy.
   // Once segmented FIFO is enabled, lru_ will be false.
   std::vector<unsigned int> sFifoSegmentRatio_;
@@ -375,13 +586,24 @@ class BlockCacheConfig {
   // We expect one thread is enough for most of use cases, but can be
   // configured to more threads if needed
   unsigned int cleanRegionThreads_{1};
+  // Upper bound of the adaptive clean regions buffer. 0 keeps the buffer at
+  // cleanRegions_.
+  uint32_t maxCleanRegions_{0};
+  // Bytes of device pages cached in DRAM for lookups. 0 to disable.
+  uint64_t readPageCacheSize_{0};
+  // Bytes of DRAM to keep recently flushed region buffers in. 0 to disable.
+  uint64_t flushedRegionCacheSize_{0};
   // Number of Navy BlockCache in-memory buffers.
   uint32_t numInMemBuffers_{2};
+  // Item size limits of the write streams. Empty for a single stream.
+  std::vector<uint32_t> streamSizeLimits_;
   // Size for a region for Navy BlockCache (must be multiple of
   // blockSize_).
   uint32_t regionSize_{16 * 1024 * 1024};
   // Whether enabling data checksum for Navy BlockCache.
   bool dataChecksum_{true};
+  // Percent of the device reads of lookups that verify the value checksum.
+  uint32_t lookupChecksumPct_{100};
   // Whether to remove an item by checking the key (true) or only the hash value
   // (false).
   bool preciseRemove_{false};
@@ -390,6 +612,27 @@ class BlockCacheConfig {
   // If 0, this block cache takes all the space left on the device.
   uint64_t size_{0};
 
+  // Number of items the fixed size index is sized for. 0 uses the sparse
+  // map index instead.
+  uint64_t fixedSizeIndexItems_{0};
+
+  // Alignment of the entries in a region. 0 uses the default alignment.
+  uint32_t packedEntryAlignSize_{0};
+
+  // Whether every priority gets its own placement handle.
+  bool placementByPriority_{false};
+
+  // File the index is checkpointed to. Empty to persist it at shutdown.
+  std::string indexCheckpointFile_;
+  // Interval of the periodic index checkpoints, 0 to disable them.
+  std::chrono::seconds indexCheckpointInterval_{0};
+  // Whether the index is loaded in the background on recovery.
+  bool lazyIndexRecovery_{false};
+  // Number of threads decoding the index on recovery.
+  uint32_t indexRecoveryThreads_{4};
+  // Whether the index is persisted in the flat format.
+  bool flatIndexPersistence_{false};
+
   friend class NavyConfig;
 };
 
@@ -428,8 +671,87 @@ class BigHashConfig {
     return *this;
   }
 
+  // Use a blocked bloom filter, with all bits of a key in one 64 bit word and
+  // derived from a single hash. Cheaper to probe and, for filters of up to 8
+  // bytes, fewer false positives for the same size.
+  BigHashConfig& setBlockedBloomFilter(bool blocked) noexcept {
+    blockedBloomFilter_ = blocked;
+    return *this;
+  }
+
+  // Place every item in the less full of two buckets picked by its key
+  // instead of a single one. Skewed keys spread better over the buckets, at
+  // the cost of reading both buckets on inserts and for missing keys.
+  BigHashConfig& setTwoChoiceHashing(bool twoChoiceHashing) noexcept {
+    twoChoiceHashing_ = twoChoiceHashing;
+    return *this;
+  }
+
+  // Stage up to @batchSize inserts per bucket in memory and write them to
+  // the bucket together, in one read-modify-write instead of one per insert.
+  // Staged inserts are served from memory and are lost on a crash, but not on
+  // a clean shutdown. @stagingMemoryMB bounds the memory they take.
+  // A @batchSize of 0 or 1 writes every insert through, the default.
+  BigHashConfig& setWriteBatching(uint32_t batchSize,
+                                  uint64_t stagingMemoryMB) noexcept {
+    writeBatchSize_ = batchSize;
+    stagingMemoryMB_ = stagingMemoryMB;
+    return *this;
+  }
+
+  // Keep up to @size bytes of recently read buckets in DRAM, so that the
+  // buckets of hot keys are not read from the device on every lookup that
+  // misses DRAM. Buckets are evicted with CLOCK.
+  BigHashConfig& setBucketCacheSize(uint64_t size) noexcept {
+    bucketCacheSize_ = size;
+    return *this;
+  }
+
+  // Number of threads that rebuild the bloom filters from the buckets on a
+  // warm restart when the persisted filters don't match the config, e.g.
+  // after changing the bloom filter size. Default value is 4.
+  BigHashConfig& setRecoveryThreads(uint32_t numThreads) noexcept {
+    recoveryThreads_ = numThreads;
+    return *this;
+  }
+
+  // Put a log of @logSizePct percent of the BigHash space in front of the
+  // buckets. Inserts are appended to the log in segments of @segmentSize
+  // bytes and moved to the buckets in groups once the log wraps around, so a
+  // bucket write is shared by several items. Items of buckets that got fewer
+  // than @moveThreshold items from a segment are dropped instead. A threshold
+  // above 1 needs the bloom filter. The log is emptied into the buckets on a
+  // clean shutdown and lost on a crash.
+  // @throw std::invalid_argument if logSizePct is not in the range of
+  //        [0, 100).
+  BigHashConfig& setLog(unsigned int logSizePct,
+                        uint32_t segmentSize,
+                        uint32_t moveThreshold);
+
   bool isBloomFilterEnabled() const { return bucketBfSize_ > 0; }
 
+  bool isBlockedBloomFilterEnabled() const { return blockedBloomFilter_; }
+
+  bool isTwoChoiceHashingEnabled() const { return twoChoiceHashing_; }
+
+  bool isWriteBatchingEnabled() const { return writeBatchSize_ > 1; }
+
+  uint32_t getWriteBatchSize() const { return writeBatchSize_; }
+
+  uint64_t getStagingMemoryMB() const { return stagingMemoryMB_; }
+
+  uint64_t getBucketCacheSize() const { return bucketCacheSize_; }
+
+  uint32_t getRecoveryThreads() const { return recoveryThreads_; }
+
+  bool isLogEnabled() const { return logSizePct_ > 0; }
+
+  unsigned int getLogSizePct() const { return logSizePct_; }
+
+  uint32_t getLogSegmentSize() const { return logSegmentSize_; }
+
+  uint32_t getLogMoveThreshold() const { return logMoveThreshold_; }
+
   unsigned int getSizePct() const { return sizePct_; }
 
   uint32_t getBucketSize() const { return bucketSize_; }
@@ -449,8 +771,25 @@ class BigHashConfig {
   uint32_t bucketSize_{4096};
   // The bloom filter size per bucket in bytes for Navy BigHash engine
   uint64_t bucketBfSize_{8};
+  // Whether the bloom filter is blocked
+  bool blockedBloomFilter_{false};
   // The maximum item size to put into Navy BigHash engine.
   uint64_t smallItemMaxSize_{};
+  // Whether an item can be placed in either of two buckets
+  bool twoChoiceHashing_{false};
+  // Number of inserts staged per bucket before it is written
+  uint32_t writeBatchSize_{0};
+  // Memory for staged inserts in MB
+  uint64_t stagingMemoryMB_{0};
+  // Bytes of DRAM to cache buckets in
+  uint64_t bucketCacheSize_{0};
+  // Threads that rebuild the bloom filters on recovery
+  uint32_t recoveryThreads_{4};
+  // Percentage of the BigHash space used for the log in front of it
+  unsigned int logSizePct_{0};
+  uint32_t logSegmentSize_{256 * 1024};
+  // Items of a segment needed to move them to a bucket
+  uint32_t logMoveThreshold_{1};
 };
 
 // Config for a pair of small,large engines.
@@ -468,9 +807,27 @@ class EnginesConfig {
 
   bool isBigHashEnabled() const { return bigHashConfig_.getSizePct() > 0; }
 
+  // Add a block cache with its own device range and settings for the items
+  // that are too large for BigHash and for the bands added before, up to
+  // @maxItemSize bytes of key and value. This allows e.g. a smaller region
+  // size for smaller items. Items above every band go to blockCache(). Bands
+  // must be added in increasing @maxItemSize and need a size, because
+  // blockCache() takes the space left.
+  // @throw std::invalid_argument if @maxItemSize is not larger than that of
+  //        the previous band or the band has no size
+  EnginesConfig& addBlockCacheBand(uint32_t maxItemSize,
+                                   BlockCacheConfig config);
+
+  // block cache bands with their max item size, in increasing max item size
+  const std::vector<std::pair<uint32_t, BlockCacheConfig>>& blockCacheBands()
+      const {
+    return blockCacheBands_;
+  }
+
  private:
   BlockCacheConfig blockCacheConfig_;
   BigHashConfig bigHashConfig_;
+  std::vector<std::pair<uint32_t, BlockCacheConfig>> blockCacheBands_;
 };
 
 enum class IoEngine : uint8_t { IoUring, LibAio, Sync };
@@ -488,6 +845,73 @@ inline const folly::StringPiece getIoEngineName(IoEngine e) {
   return "invalid";
 }
 
+/**
+ * MemoryDeviceEmulationConfig describes the performance of a device that a
+ * memory device emulates, so that cachebench can predict the behavior of Navy
+ * on a device that is not at hand. By default a memory device is as fast as
+ * memory.
+ *
+ * An IO waits for one of the queueDepth IOs the device serves at a time,
+ * then for its transfer at the bandwidth of the device, which is shared by
+ * all the IOs, and then for a latency sampled from the latency percentiles.
+ */
+struct MemoryDeviceEmulationConfig {
+  // Latency of the IOs in microseconds by percentile, such as
+  // {{50, 80}, {99, 400}, {100, 2000}} for a median of 80us, a p99 of 400us
+  // and a max of 2ms. The latency of an IO is interpolated between the
+  // percentiles for a uniformly sampled percentile. Empty for no latency.
+  std::vector<std::pair<double, uint32_t>> readLatencyUs;
+  std::vector<std::pair<double, uint32_t>> writeLatencyUs;
+
+  // Bandwidth of the device in MB/s. 0 for unlimited.
+  uint32_t readBandwidthMBps{0};
+  uint32_t writeBandwidthMBps{0};
+
+  // Number of IOs the device serves at a time. 0 for unlimited.
+  uint32_t queueDepth{0};
+
+  bool isEnabled() const {
+    return !readLatencyUs.empty() || !writeLatencyUs.empty() ||
+           readBandwidthMBps != 0 || writeBandwidthMBps != 0 ||
+           queueDepth != 0;
+  }
+
+  // @throw std::invalid_argument if the percentiles are not increasing
+  //        within (0, 100] or their latencies are decreasing
+  void validate() const;
+};
+
+/**
+ * IoBudgetConfig splits the bandwidth of the device between the classes of
+ * Navy IO: user reads, region flushes, reclaim reads and reinsertions. Every
+ * class is guaranteed its share of the bandwidth, and a class can use the
+ * shares the others leave idle, so that reclaim and reinsertions can not
+ * crowd out user reads when they are busy. By default there is no budget.
+ *
+ * Reinsertions are rejected rather than delayed once over their budget. The
+ * reinserted items are written by region flushes, so they are charged to the
+ * flushes as well.
+ */
+struct IoBudgetConfig {
+  // Bandwidth of the device in bytes per second. 0 for no budget.
+  uint64_t bytesPerSec{0};
+
+  // Relative shares of the bandwidth of every class, each at least 1
+  uint32_t userReadShare{4};
+  uint32_t flushShare{2};
+  uint32_t reclaimReadShare{1};
+  uint32_t reinsertionShare{1};
+
+  // Milliseconds worth of its share a class can save up while it is idle,
+  // and of the whole bandwidth that the idle classes leave to the others
+  uint32_t burstMs{10};
+
+  bool isEnabled() const { return bytesPerSec != 0; }
+
+  // @throw std::invalid_argument if a share or the burst is 0
+  void validate() const;
+};
+
 /**
  * NavyConfig provides APIs for users to set up Navy related settings for
  * NvmCache.
@@ -502,6 +926,8 @@ inline const folly::StringPiece getIoEngineName(IoEngine e) {
 class NavyConfig {
  public:
   using EnginesSelector = std::function<size_t(HashedKey)>;
+  // Tells the pool id of the item of a key, see setPoolEnginePairs
+  using PoolResolver = std::function<int8_t(folly::StringPiece key)>;
 
   static constexpr folly::StringPiece kAdmPolicyRandom{"random"};
   static constexpr folly::StringPiece kAdmPolicyDynamicRandom{"dynamic_random"};
@@ -530,14 +956,30 @@ class NavyConfig {
   // ============ Device settings =============
   uint64_t getBlockSize() const { return blockSize_; }
   bool getExclusiveOwner() const { return isExclusiveOwner_; }
+  bool getSubPageReads() const { return subPageReads_; }
   const std::string& getFileName() const;
   const std::vector<std::string>& getRaidPaths() const;
   uint64_t getDeviceMetadataSize() const { return deviceMetadataSize_; }
   uint64_t getFileSize() const { return fileSize_; }
+  const MemoryDeviceEmulationConfig& getMemoryDeviceEmulation() const {
+    return memoryDeviceEmulation_;
+  }
+  const IoBudgetConfig& getIoBudget() const { return ioBudget_; }
   bool getTruncateFile() const { return truncateFile_; }
   uint32_t getDeviceMaxWriteSize() const { return deviceMaxWriteSize_; }
   IoEngine getIoEngine() const { return ioEngine_; }
   unsigned int getQDepth() const { return qDepth_; }
+  uint32_t getIoUringRegisteredBufferSize() const {
+    return ioUringRegisteredBufferSize_;
+  }
+  uint32_t getIoCompletionPollUs() const { return ioCompletionPollUs_; }
+  const std::vector<uint32_t>& getIoThreadCpus() const {
+    return ioThreadCpus_;
+  }
+  bool getNvmePassthrough() const { return nvmePassthrough_; }
+  uint32_t getQDepthPerFile() const { return qDepthPerFile_; }
+  uint32_t getQDepthTargetLatencyUs() const { return qDepthTargetLatencyUs_; }
+  bool getBatchWriteChunks() const { return batchWriteChunks_; }
   bool hasDeviceDataCorruptionForTesting() const {
     return testingBadDeviceHasDataCorruption_;
   }
@@ -558,14 +1000,23 @@ class NavyConfig {
   unsigned int getReaderThreads() const { return readerThreads_; }
   unsigned int getWriterThreads() const { return writerThreads_; }
   uint64_t getNavyReqOrderingShards() const { return navyReqOrderingShards_; }
+  bool getWorkStealing() const { return workStealing_; }
 
   unsigned int getMaxNumReads() const { return maxNumReads_; }
   unsigned int getMaxNumWrites() const { return maxNumWrites_; }
   unsigned int getStackSize() const { return stackSize_; }
+  uint32_t getMaxPooledFibers() const { return maxPooledFibers_; }
+  const std::vector<uint32_t>& getKeyAffinityCpus() const {
+    return keyAffinityCpus_;
+  }
   // ============ other settings =============
   uint32_t getMaxConcurrentInserts() const { return maxConcurrentInserts_; }
   uint64_t getMaxParcelMemoryMB() const { return maxParcelMemoryMB_; }
+  uint32_t getInflightTrackingShards() const {
+    return inflightTrackingShards_;
+  }
   bool getUseEstimatedWriteSize() const { return useEstimatedWriteSize_; }
+  uint32_t getSizeAdvisorSampleRate() const { return sizeAdvisorSampleRate_; }
 
   // Setters:
   // Enable "dynamic_random" admission policy.
@@ -583,6 +1034,10 @@ class NavyConfig {
   void setBlockSize(uint64_t blockSize) noexcept { blockSize_ = blockSize; }
   // Set the NVMe FDP Device data placement mode in the Cachelib
   void setEnableFDP(bool enable) noexcept { enableFDP_ = enable; }
+  // Read at the logical block size of the device, e.g. 512 bytes, where it is
+  // smaller than the block size. Writes keep the block size. Not used with
+  // encryption, which works on whole blocks.
+  void setSubPageReads(bool enable) noexcept { subPageReads_ = enable; }
   // If true, Navy will only start if it's the sole owner of the file.
   // This only applies to non-memory-backed files.
   void setExclusiveOwner(bool isExclusiveOwner) noexcept {
@@ -603,6 +1058,13 @@ class NavyConfig {
   // This function is only for cachebench and unit tests to create
   // a MemoryDevice when no file path is set.
   void setMemoryFile(uint64_t fileSize) noexcept { fileSize_ = fileSize; }
+  // Have the in-memory file emulate the latency, bandwidth and queue depth
+  // of a device. Only used when no file path is set.
+  // @throw std::invalid_argument if the emulation config is invalid.
+  void setMemoryDeviceEmulation(MemoryDeviceEmulationConfig emulation) {
+    emulation.validate();
+    memoryDeviceEmulation_ = std::move(emulation);
+  }
   // Set up a bad device backed by the existing device that user has configured.
   // This requires the user to have also set up a real device (one of the
   // above).
@@ -628,6 +1090,64 @@ class NavyConfig {
   // If qDepth is 0, existing qDepth_ will be used
   void enableAsyncIo(unsigned int qDepth, bool enableIoUring);
 
+  // Have every io_uring context register one buffer of @bufferSize bytes per
+  // queue depth with the kernel. IOs up to @bufferSize are copied through
+  // them, which saves the kernel pinning their pages on every IO. 0 to
+  // disable. Only used with io_uring.
+  void setIoUringRegisteredBufferSize(uint32_t bufferSize) noexcept {
+    ioUringRegisteredBufferSize_ = bufferSize;
+  }
+
+  // Have a fiber waiting for its async IO poll for completions for up to
+  // @pollUs microseconds before it yields, instead of being woken up through
+  // the event loop. It trades the CPU time of the IO threads for the latency
+  // of the IOs completing within @pollUs. 0 to disable.
+  void setIoCompletionPollUs(uint32_t pollUs) noexcept {
+    ioCompletionPollUs_ = pollUs;
+  }
+
+  // Pin the threads issuing async IO, e.g. the reader and writer threads, to
+  // @cpus, one cpu each in turn. Meant for cores set aside for IO, together
+  // with completion polling.
+  void setIoThreadCpus(std::vector<uint32_t> cpus) noexcept {
+    ioThreadCpus_ = std::move(cpus);
+  }
+
+  // Send all async io_uring IO as NVMe commands through the NVMe character
+  // device (e.g. /dev/ng0n1) of the NVMe block device file, skipping the
+  // block layer. Only for a single NVMe block device; FDP does this anyway.
+  void setNvmePassthrough(bool enable) noexcept { nvmePassthrough_ = enable; }
+
+  // Limit the async IOs every IO thread keeps outstanding on each file of a
+  // RAID0 setup to @qDepthPerFile, below the queue depth, so that IOs queued
+  // on a slow drive leave the queue depth to the other drives. 0 for none.
+  void setQDepthPerFile(uint32_t qDepthPerFile) noexcept {
+    qDepthPerFile_ = qDepthPerFile;
+  }
+
+  // Let every IO thread adapt its queue depth, up to the one set with
+  // enableAsyncIo, to keep the average device latency at @targetLatencyUs. The
+  // queue depth is halved when the latency is above the target and grown by
+  // one while it is within and IOs wait for it. 0 for the fixed queue depth.
+  void setQDepthTargetLatencyUs(uint32_t targetLatencyUs) noexcept {
+    qDepthTargetLatencyUs_ = targetLatencyUs;
+  }
+
+  // Share the bandwidth of the device between user reads, flushes, reclaim
+  // reads and reinsertions, see IoBudgetConfig.
+  // @throw std::invalid_argument if the budget config is invalid.
+  void setIoBudget(IoBudgetConfig ioBudget) {
+    if (ioBudget.isEnabled()) {
+      ioBudget.validate();
+    }
+    ioBudget_ = ioBudget;
+  }
+
+  // Submit the chunks of max device write size a large write, e.g. a region
+  // flush, is split into in one batch and wait for all of them, instead of
+  // waiting for every chunk before submitting the next. Only with async IO.
+  void setBatchWriteChunks(bool enable) noexcept { batchWriteChunks_ = enable; }
+
   // ============ BlockCache settings =============
   // Return BlockCacheConfig for configuration.
   BlockCacheConfig& blockCache() noexcept {
@@ -645,6 +1165,18 @@ class NavyConfig {
     selector_ = std::move(selector);
   }
 
+  // Put the items of every pool into its own engine pair, so that pools of
+  // very different item sizes do not share regions, reclaims and write
+  // amplification. @poolEnginePairs is the engine pair index of every pool
+  // id; pools past its end use the first pair. @resolver tells the pool of a
+  // key, e.g. from a tenant prefix, since lookups and removes only have the
+  // key, and must agree with the pool the item is allocated from. Replaces
+  // the engines selector, which can not be set as well.
+  //
+  // @throw std::invalid_argument if @resolver is empty
+  void setPoolEnginePairs(std::vector<size_t> poolEnginePairs,
+                          PoolResolver resolver);
+
   // ============ Job scheduler settings =============
   // Set the number of reader threads and writer threads.
   // If maxNumReads and maxNumWrites are all 0, sync IO will be used
@@ -658,6 +1190,33 @@ class NavyConfig {
   // @throw std::invalid_argument if the input value is 0.
   void setNavyReqOrderingShards(uint64_t navyReqOrderingShards);
 
+  // Let idle reader (writer) threads run jobs queued on busy reader (writer)
+  // threads, so that skewed keys don't leave jobs waiting behind a busy
+  // thread. Ordering by key is still kept through the ordering shards. Only
+  // for the thread pool scheduler, i.e. when maxNumReads and maxNumWrites
+  // are 0.
+  void setWorkStealing(bool enable) noexcept { workStealing_ = enable; }
+
+  // Keep at most @maxPooledFibers finished fibers per reader (writer) thread
+  // for reuse when async IO is used. The stacks of the others are freed once
+  // their request is done, so that a high maxNumReads only costs fiber stack
+  // memory while the requests are in flight. 0 for the default of 1000.
+  void setMaxPooledFibers(uint32_t maxPooledFibers) noexcept {
+    maxPooledFibers_ = maxPooledFibers;
+  }
+
+  // Run the requests of a key on one of @cpus, with one reader and one
+  // writer thread pinned to each, so that the reads and writes of a key and
+  // the index buckets and IOs they touch stay on the same cpu. Requests
+  // enqueued on the owning thread itself, e.g. the next request of a key
+  // queued behind one completing, are dispatched without a wake up. Only
+  // when async IO is used; readerThreads and writerThreads must be the
+  // number of cpus, and the IO threads can not be pinned separately with
+  // setIoThreadCpus.
+  void setKeyAffinityCpus(std::vector<uint32_t> cpus) noexcept {
+    keyAffinityCpus_ = std::move(cpus);
+  }
+
   // ============ Other settings =============
   void setMaxConcurrentInserts(uint32_t maxConcurrentInserts) noexcept {
     maxConcurrentInserts_ = maxConcurrentInserts;
@@ -668,12 +1227,27 @@ class NavyConfig {
   void setUseEstimatedWriteSize(bool useEstimatedWriteSize) noexcept {
     useEstimatedWriteSize_ = useEstimatedWriteSize;
   }
+  // Sample 1 in this many inserts by key hash to recommend the region size,
+  // entry alignment and small item threshold for the inserted sizes, which
+  // are reported in navy stats. 0 disables it.
+  void setSizeAdvisorSampleRate(uint32_t sampleRate) noexcept {
+    sizeAdvisorSampleRate_ = sampleRate;
+  }
+
+  // Set the number of shards nvmcache tracks its in-flight puts and deletes
+  // with.
+  // @throw std::invalid_argument if the input value is 0.
+  void setInflightTrackingShards(uint32_t inflightTrackingShards);
 
   const std::vector<EnginesConfig>& enginesConfigs() const {
     return enginesConfigs_;
   }
 
   EnginesSelector getEnginesSelector() const { return selector_; }
+  const std::vector<size_t>& getPoolEnginePairs() const {
+    return poolEnginePairs_;
+  }
+  PoolResolver getPoolResolver() const { return poolResolver_; }
 
  private:
   // ============ AP settings =============
@@ -688,6 +1262,8 @@ class NavyConfig {
   uint64_t blockSize_{4096};
   // If true, Navy will only start if it's the sole owner of the file.
   bool isExclusiveOwner_{false};
+  // Whether to read at the logical block size detected for the device.
+  bool subPageReads_{false};
   // The file name/path for caching.
   std::string fileName_;
   // An array of Navy RAID device file paths.
@@ -699,6 +1275,8 @@ class NavyConfig {
   uint64_t fileSize_{};
   // Whether ask Navy to truncate the file it uses.
   bool truncateFile_{false};
+  // Performance the in-memory file emulates.
+  MemoryDeviceEmulationConfig memoryDeviceEmulation_{};
   // This controls granularity of the writes when we flush the region.
   // This is only used when in-mem buffer is enabled.
   uint32_t deviceMaxWriteSize_{};
@@ -712,11 +1290,39 @@ class NavyConfig {
   // 0 for Sync io engine and >1 for libaio and io_uring
   unsigned int qDepth_{0};
 
+  // Size of the buffers registered with io_uring. 0 for none.
+  uint32_t ioUringRegisteredBufferSize_{0};
+
+  // Microseconds to poll for async IO completions before yielding.
+  uint32_t ioCompletionPollUs_{0};
+
+  // CPUs to pin the async IO threads to. Empty to leave them unpinned.
+  std::vector<uint32_t> ioThreadCpus_;
+
+  // Whether to send async IO through the NVMe character device.
+  bool nvmePassthrough_{false};
+
+  // Max async IOs per thread outstanding on each RAID0 file, 0 for no limit.
+  uint32_t qDepthPerFile_{0};
+
+  // Average IO latency target to adapt the queue depth to, 0 for none.
+  uint32_t qDepthTargetLatencyUs_{0};
+
+  // Whether the chunks of a large write are submitted in one batch.
+  bool batchWriteChunks_{false};
+
+  // Shares of the device bandwidth of the classes of IO.
+  IoBudgetConfig ioBudget_{};
+
   // ============ Engines settings =============
   // Currently we support one pair of engines.
   std::vector<EnginesConfig> enginesConfigs_{1};
   // Function to map each item to a pair of engine.
   EnginesSelector selector_{};
+  // Engine pair of every pool id, empty to use the selector.
+  std::vector<size_t> poolEnginePairs_;
+  // Function to map each key to the pool of its item.
+  PoolResolver poolResolver_{};
 
   // ============ Job scheduler settings =============
   // Number of asynchronous worker thread for read operation.
@@ -727,6 +1333,8 @@ class NavyConfig {
   // Navy.
   // This value needs to be non-zero.
   uint64_t navyReqOrderingShards_{20};
+  // Whether idle worker threads steal jobs from busy ones.
+  bool workStealing_{false};
 
   // Max number of concurrent reads/writes in whole Navy.
   // This needs to be a multiple of the number of readers and writers.
@@ -738,6 +1346,13 @@ class NavyConfig {
   // Stack size of fibers when async-io is enabled. 0 for default
   unsigned int stackSize_{0};
 
+  // Max number of idle fibers kept per thread when async-io is enabled.
+  // 0 for default
+  uint32_t maxPooledFibers_{0};
+
+  // CPUs owning the keys with async IO. Empty to leave the threads unpinned.
+  std::vector<uint32_t> keyAffinityCpus_;
+
   // ============ Other settings =============
   // Maximum number of concurrent inserts we allow globally for Navy.
   // 0 means unlimited.
@@ -749,6 +1364,11 @@ class NavyConfig {
   // Whether to use write size (instead of parcel size) for Navy admission
   // policy.
   bool useEstimatedWriteSize_{false};
+  // 1 in this many inserts is sampled by the size advisor. 0 disables it.
+  uint32_t sizeAdvisorSampleRate_{0};
+  // Number of shards for the in-flight puts and deletes of nvmcache. Each
+  // shard is a fixed-size table of a few hundred bytes.
+  uint32_t inflightTrackingShards_{1024};
   // Whether Navy support the NVMe FDP data placement(TP4146) directives or not.
   // Reference: https://nvmexpress.org/nvmeflexible-data-placement-fdp-blog/
   bool enableFDP_{false};
@@ -20,6 +20,8 @@
 #include <folly/logging/xlog.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
 #include "cachelib/navy/Factory.h"
 #include "cachelib/navy/scheduler/JobScheduler.h"
@@ -100,9 +102,30 @@ uint64_t setupBigHash(const navy::BigHashConfig& bigHashConfig,
     // for our use case. If BF size to bucket size ratio gets lower, try
     // to reduce number of hashes.
     constexpr uint32_t kNumHashes = 4;
-    const uint32_t bitsPerHash =
-        bigHashConfig.getBucketBfSize() * 8 / kNumHashes;
-    bigHash->setBloomFilter(kNumHashes, bitsPerHash);
+    if (bigHashConfig.isBlockedBloomFilterEnabled()) {
+      bigHash->setBlockedBloomFilter(kNumHashes,
+                                     bigHashConfig.getBucketBfSize() * 8);
+    } else {
+      const uint32_t bitsPerHash =
+          bigHashConfig.getBucketBfSize() * 8 / kNumHashes;
+      bigHash->setBloomFilter(kNumHashes, bitsPerHash);
+    }
+  }
+
+  bigHash->setTwoChoiceHashing(bigHashConfig.isTwoChoiceHashingEnabled());
+
+  bigHash->setBucketCacheSize(bigHashConfig.getBucketCacheSize());
+  bigHash->setRecoveryThreads(bigHashConfig.getRecoveryThreads());
+
+  if (bigHashConfig.isLogEnabled()) {
+    bigHash->setLog(bigHashCacheSize * bigHashConfig.getLogSizePct() / 100,
+                    bigHashConfig.getLogSegmentSize(),
+                    bigHashConfig.getLogMoveThreshold());
+  }
+
+  if (bigHashConfig.isWriteBatchingEnabled()) {
+    bigHash->setWriteBatching(bigHashConfig.getWriteBatchSize(),
+                              bigHashConfig.getStagingMemoryMB() * 1024 * 1024);
   }
 
   proto.setBigHash(std::move(bigHash), bigHashConfig.getSmallItemMaxSize());
@@ -126,6 +149,8 @@ uint64_t setupBigHash(const navy::BigHashConfig& bigHashConfig,
 // @param itemDestructorEnabled
 // @param stackSize size of the stack used by the region_manager thread
 // @param proto
+// @param bandMaxItemSize if not 0, the block cache is set up as a size band
+//                        for items up to this size
 //
 // @return The end offset (exclusive) of the setup blockcache.
 uint64_t setupBlockCache(const navy::BlockCacheConfig& blockCacheConfig,
@@ -135,7 +160,8 @@ uint64_t setupBlockCache(const navy::BlockCacheConfig& blockCacheConfig,
                          bool usesRaidFiles,
                          bool itemDestructorEnabled,
                          uint32_t stackSize,
-                         cachelib::navy::EnginePairProto& proto) {
+                         cachelib::navy::EnginePairProto& proto,
+                         uint32_t bandMaxItemSize = 0) {
   auto regionSize = blockCacheConfig.getRegionSize();
   if (regionSize != alignUp(regionSize, ioAlignSize)) {
     throw std::invalid_argument(
@@ -161,11 +187,14 @@ uint64_t setupBlockCache(const navy::BlockCacheConfig& blockCacheConfig,
   auto blockCache = cachelib::navy::createBlockCacheProto();
   blockCache->setLayout(blockCacheOffset, blockCacheSize, regionSize);
   blockCache->setChecksum(blockCacheConfig.getDataChecksum());
+  blockCache->setLookupChecksumPct(blockCacheConfig.getLookupChecksumPct());
 
   // set eviction policy
   auto segmentRatio = blockCacheConfig.getSFifoSegmentRatio();
   if (!segmentRatio.empty()) {
     blockCache->setSegmentedFifoEvictionPolicy(std::move(segmentRatio));
+  } else if (blockCacheConfig.isHitDensityEnabled()) {
+    blockCache->setHitDensityEvictionPolicy();
   } else if (blockCacheConfig.isLruEnabled()) {
     blockCache->setLruEvictionPolicy();
   } else {
@@ -173,18 +202,77 @@ uint64_t setupBlockCache(const navy::BlockCacheConfig& blockCacheConfig,
   }
   blockCache->setCleanRegionsPool(blockCacheConfig.getCleanRegions(),
                                   blockCacheConfig.getCleanRegionThreads());
+  blockCache->setMaxCleanRegionsPool(blockCacheConfig.getMaxCleanRegions());
+  blockCache->setReadPageCacheSize(blockCacheConfig.getReadPageCacheSize());
+  blockCache->setFlushedRegionCacheSize(
+      blockCacheConfig.getFlushedRegionCacheSize());
 
   blockCache->setReinsertionConfig(blockCacheConfig.getReinsertionConfig());
 
-  blockCache->setNumInMemBuffers(blockCacheConfig.getNumInMemBuffers());
+  const auto& streamSizeLimits = blockCacheConfig.getStreamSizeLimits();
+  blockCache->setStreamSizeLimits(streamSizeLimits);
+  // every extra stream keeps one more region open for writes per priority
+  const uint32_t numPriorities =
+      std::max<uint32_t>(1, blockCacheConfig.getSFifoSegmentRatio().size());
+  blockCache->setNumInMemBuffers(
+      blockCacheConfig.getNumInMemBuffers() +
+      numPriorities * static_cast<uint32_t>(streamSizeLimits.size()));
   blockCache->setItemDestructorEnabled(itemDestructorEnabled);
   blockCache->setStackSize(stackSize);
   blockCache->setPreciseRemove(blockCacheConfig.isPreciseRemove());
+  blockCache->setFixedSizeIndex(blockCacheConfig.getFixedSizeIndexItems());
+  blockCache->setPackedEntryAlignSize(
+      blockCacheConfig.getPackedEntryAlignSize());
+  blockCache->setPlacementByPriority(blockCacheConfig.isPlacementByPriority());
+  blockCache->setIndexRecoveryThreads(
+      blockCacheConfig.getIndexRecoveryThreads());
+  blockCache->setFlatIndexPersistence(
+      blockCacheConfig.isFlatIndexPersistence());
+  if (!blockCacheConfig.getIndexCheckpointFile().empty()) {
+    blockCache->setIndexCheckpoint(
+        blockCacheConfig.getIndexCheckpointFile(),
+        blockCacheConfig.getIndexCheckpointInterval(),
+        blockCacheConfig.isLazyIndexRecovery());
+  }
 
-  proto.setBlockCache(std::move(blockCache));
+  if (bandMaxItemSize > 0) {
+    proto.addBlockCacheBand(std::move(blockCache), bandMaxItemSize);
+  } else {
+    proto.setBlockCache(std::move(blockCache));
+  }
   return blockCacheOffset + blockCacheSize;
 }
 
+// @return the engines selector of @config, or one sending the keys of every
+//         pool to the engine pair of the pool when pools have engine pairs
+//
+// @throw std::invalid_argument if both are set or a pool has no such pair
+navy::NavyConfig::EnginesSelector makeEnginesSelector(
+    const navy::NavyConfig& config) {
+  const auto& poolEnginePairs = config.getPoolEnginePairs();
+  if (poolEnginePairs.empty()) {
+    return config.getEnginesSelector();
+  }
+  if (config.getEnginesSelector()) {
+    throw std::invalid_argument(
+        "Pool engine pairs and an engines selector can not both be set");
+  }
+  const auto numPairs = config.enginesConfigs().size();
+  for (size_t pid = 0; pid < poolEnginePairs.size(); pid++) {
+    if (poolEnginePairs[pid] >= numPairs) {
+      throw std::invalid_argument(folly::sformat(
+          "Pool {} is assigned engine pair {} of {}", pid,
+          poolEnginePairs[pid], numPairs));
+    }
+  }
+  return [pairs = poolEnginePairs,
+          resolver = config.getPoolResolver()](HashedKey hk) -> size_t {
+    const auto pid = resolver(hk.key());
+    return pid >= 0 && static_cast<size_t>(pid) < pairs.size() ? pairs[pid]
+                                                               : 0;
+  };
+}
+
 // Setup the CacheProto, includes BigHashProto and BlockCacheProto,
 // which is the configuration interface from Navy engine, and can be used to
 // create BigHash and BlockCache engines.
@@ -198,6 +286,8 @@ uint64_t setupBlockCache(const navy::BlockCacheConfig& blockCacheConfig,
 // on the device address space.
 // |--------------------------------- Device -------------------------------|
 // |--- Metadata ---|--- BC-0 ---|--- BC-1 ---|...|--- BH-1 ---|--- BH-0 ---|
+// where the size bands of a pair come before its block cache:
+// |--- BC-0 band-0 ---|--- BC-0 band-1 ---|...|--- BC-0 ---|
 
 void setupCacheProtos(const navy::NavyConfig& config,
                       const navy::Device& device,
@@ -249,6 +339,17 @@ void setupCacheProtos(const navy::NavyConfig& config,
     uint64_t blockCacheSize = enginesConfig.blockCache().getSize();
     auto enginePairProto = cachelib::navy::createEnginePairProto();
 
+    // The size bands come first, the main block cache takes what is left
+    // before bighash.
+    for (const auto& [maxItemSize, bandConfig] :
+         enginesConfig.blockCacheBands()) {
+      blockCacheStartOffset = setupBlockCache(
+          bandConfig, bandConfig.getSize(), ioAlignSize, blockCacheStartOffset,
+          config.usesRaidFiles(), itemDestructorEnabled, config.getStackSize(),
+          *enginePairProto, maxItemSize);
+      blockCacheEndOffset = blockCacheStartOffset;
+    }
+
     if (enginesConfig.isBigHashEnabled()) {
       uint64_t bigHashSize =
           totalCacheSize * enginesConfig.bigHash().getSizePct() / 100ul;
@@ -284,7 +385,7 @@ void setupCacheProtos(const navy::NavyConfig& config,
     bigHashEndOffset = bigHashStartOffset;
     blockCacheStartOffset = blockCacheEndOffset;
   }
-  proto.setEnginesSelector(config.getEnginesSelector());
+  proto.setEnginesSelector(makeEnginesSelector(config));
 }
 
 void setAdmissionPolicy(const cachelib::navy::NavyConfig& config,
@@ -311,9 +412,20 @@ std::unique_ptr<cachelib::navy::JobScheduler> createJobScheduler(
   auto maxNumWrites = config.getMaxNumWrites();
   auto stackSize = config.getStackSize();
   auto reqOrderShardsPower = config.getNavyReqOrderingShards();
+  auto maxPooledFibers = config.getMaxPooledFibers();
+  const auto& keyAffinityCpus = config.getKeyAffinityCpus();
+  if (!keyAffinityCpus.empty() &&
+      ((maxNumReads == 0 && maxNumWrites == 0) ||
+       !config.getIoThreadCpus().empty())) {
+    throw std::invalid_argument(
+        "key affinity cpus need async IO and unpinned IO threads");
+  }
   if (maxNumReads == 0 && maxNumWrites == 0) {
     return cachelib::navy::createOrderedThreadPoolJobScheduler(
-        readerThreads, writerThreads, reqOrderShardsPower);
+        readerThreads,
+        writerThreads,
+        reqOrderShardsPower,
+        config.getWorkStealing());
   }
 
   return cachelib::navy::createNavyRequestScheduler(readerThreads,
@@ -321,7 +433,9 @@ std::unique_ptr<cachelib::navy::JobScheduler> createJobScheduler(
                                                     maxNumReads,
                                                     maxNumWrites,
                                                     stackSize,
-                                                    reqOrderShardsPower);
+                                                    reqOrderShardsPower,
+                                                    maxPooledFibers,
+                                                    keyAffinityCpus);
 }
 } // namespace
 
@@ -353,10 +467,19 @@ std::unique_ptr<cachelib::navy::Device> createDevice(
         config.getQDepth(),
         config.isFDPEnabled(),
         std::move(encryptor),
-        config.getExclusiveOwner());
+        config.getExclusiveOwner(),
+        config.getSubPageReads(),
+        cachelib::navy::AsyncIoOptions{config.getIoUringRegisteredBufferSize(),
+                                       config.getIoCompletionPollUs(),
+                                       config.getIoThreadCpus(),
+                                       config.getNvmePassthrough(),
+                                       config.getQDepthPerFile(),
+                                       config.getQDepthTargetLatencyUs(),
+                                       config.getBatchWriteChunks()});
   } else {
-    return cachelib::navy::createMemoryDevice(config.getFileSize(),
-                                              std::move(encryptor), blockSize);
+    return cachelib::navy::createMemoryDevice(
+        config.getFileSize(), std::move(encryptor), blockSize,
+        0 /* readAlignSize */, config.getMemoryDeviceEmulation());
   }
 }
 
@@ -366,7 +489,9 @@ std::unique_ptr<navy::AbstractCache> createNavyCache(
     navy::DestructorCallback destructorCb,
     bool truncate,
     std::shared_ptr<navy::DeviceEncryptor> encryptor,
-    bool itemDestructorEnabled) {
+    bool itemDestructorEnabled,
+    navy::ExpiryTimeGetter getExpiryTime,
+    bool deferRecovery) {
   auto device = createDevice(config, std::move(encryptor));
 
   if (config.hasDeviceDataCorruptionForTesting()) {
@@ -393,6 +518,11 @@ std::unique_ptr<navy::AbstractCache> createNavyCache(
     device = std::move(mockDevice);
   }
 
+  if (config.getIoBudget().isEnabled()) {
+    device->setIoBudget(
+        std::make_shared<navy::IoBudget>(config.getIoBudget()));
+  }
+
   auto proto = cachelib::navy::createCacheProto();
   auto* devicePtr = device.get();
   proto->setDevice(std::move(device));
@@ -400,8 +530,12 @@ std::unique_ptr<navy::AbstractCache> createNavyCache(
   proto->setMaxConcurrentInserts(config.getMaxConcurrentInserts());
   proto->setMaxParcelMemory(megabytesToBytes(config.getMaxParcelMemoryMB()));
   proto->setUseEstimatedWriteSize(config.getUseEstimatedWriteSize());
+  proto->setSizeAdvisor(
+      config.getSizeAdvisorSampleRate(),
+      config.isBigHashEnabled() ? config.bigHash().getBucketSize() : 4096);
   setAdmissionPolicy(config, *proto);
   proto->setExpiredCheck(checkExpired);
+  proto->setExpiryTimeGetter(std::move(getExpiryTime));
   proto->setDestructorCallback(destructorCb);
 
   setupCacheProtos(config, *devicePtr, *proto, itemDestructorEnabled);
@@ -414,6 +548,10 @@ std::unique_ptr<navy::AbstractCache> createNavyCache(
     return cache;
   }
 
+  if (deferRecovery) {
+    return cache;
+  }
+
   if (!cache->recover()) {
     XLOG(WARN) << "No recovery data found. Continuing with clean cache.";
   }
@@ -22,14 +22,18 @@
 namespace facebook {
 namespace cachelib {
 // return a navy cache which is created by CacheProto whose data is from
-// NavyConfig.
+// NavyConfig. Unless truncating, the cache is recovered from the device before
+// it is returned; with deferRecovery the caller must call recover() on it
+// before using it instead.
 std::unique_ptr<facebook::cachelib::navy::AbstractCache> createNavyCache(
     const navy::NavyConfig& config,
     facebook::cachelib::navy::ExpiredCheck checkExpired,
     facebook::cachelib::navy::DestructorCallback destructorCb,
     bool truncate,
     std::shared_ptr<navy::DeviceEncryptor> encryptor,
-    bool itemDestructorEnabled);
+    bool itemDestructorEnabled,
+    facebook::cachelib::navy::ExpiryTimeGetter getExpiryTime = {},
+    bool deferRecovery = false);
 
 // create a flash device for Navy engines to use
 // made public for testing purposes
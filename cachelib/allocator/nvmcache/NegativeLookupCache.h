@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Bits.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace facebook {
+namespace cachelib {
+
+// Remembers the key hashes of recent lookups that were confirmed to miss in
+// nvmcache so that repeated lookups for the same absent keys can be answered
+// without going to navy.
+//
+// The cache is a fixed array of 64-bit buckets, each holding three 16-bit
+// fingerprints of key hashes and a 16-bit version. All operations are lock
+// free. When a bucket is full, a new miss replaces one of the fingerprints.
+// Two keys sharing a bucket and a fingerprint are mistaken for each other,
+// which turns a hit into a miss for roughly one lookup out of 20,000 when the
+// cache is full. It never turns a miss into a hit.
+//
+// The version of a bucket changes whenever a key of the bucket is
+// invalidated. A lookup captures a token with the version before reading from
+// navy and the miss is only recorded if the version did not change since, so
+// that a miss can not be recorded after an insert for the same key raced with
+// the lookup.
+class NegativeLookupCache {
+ public:
+  using Token = uint16_t;
+
+  // @param numEntries  number of misses to remember, rounded up to fill a
+  //                    power of two number of buckets.
+  //
+  // @throw std::invalid_argument if numEntries is 0
+  explicit NegativeLookupCache(size_t numEntries)
+      : numBuckets_{numEntries == 0
+                        ? 0
+                        : folly::nextPowTwo(
+                              (numEntries + kSlotsPerBucket - 1) /
+                              kSlotsPerBucket)},
+        buckets_{std::make_unique<std::atomic<uint64_t>[]>(numBuckets_)} {
+    if (numEntries == 0) {
+      throw std::invalid_argument(
+          "Negative lookup cache needs at least one entry");
+    }
+  }
+
+  NegativeLookupCache(const NegativeLookupCache&) = delete;
+  NegativeLookupCache& operator=(const NegativeLookupCache&) = delete;
+
+  // @return true if a lookup for the key hash recently missed and no insert
+  //         for it happened since.
+  bool isKnownMiss(uint64_t keyHash) const noexcept {
+    return findSlot(getBucket(keyHash).load(std::memory_order_acquire),
+                    fingerprint(keyHash)) != kSlotsPerBucket;
+  }
+
+  // @return the token to pass to recordMiss once the lookup for the key
+  //         hash completes.
+  Token getToken(uint64_t keyHash) const noexcept {
+    return version(getBucket(keyHash).load(std::memory_order_acquire));
+  }
+
+  // Records a miss for the key hash, unless the key hash was invalidated
+  // since @token was taken.
+  //
+  // @return true if the miss is recorded
+  bool recordMiss(uint64_t keyHash, Token token) noexcept {
+    auto& bucket = getBucket(keyHash);
+    const auto fp = fingerprint(keyHash);
+    auto old = bucket.load(std::memory_order_acquire);
+    while (true) {
+      if (version(old) != token) {
+        return false;
+      }
+      if (findSlot(old, fp) != kSlotsPerBucket) {
+        return true;
+      }
+      auto slot = findSlot(old, 0);
+      if (slot == kSlotsPerBucket) {
+        slot = (keyHash >> 32) % kSlotsPerBucket;
+      }
+      const auto shift = slot * kBitsPerSlot;
+      const auto updated =
+          (old & ~(kSlotMask << shift)) | (static_cast<uint64_t>(fp) << shift);
+      if (bucket.compare_exchange_weak(old, updated,
+                                       std::memory_order_acq_rel)) {
+        return true;
+      }
+    }
+  }
+
+  // Forgets about the misses for the key hash and fails recording any miss
+  // for a lookup that started before this call. Call this before a value for
+  // the key becomes visible in nvmcache.
+  void invalidate(uint64_t keyHash) noexcept {
+    auto& bucket = getBucket(keyHash);
+    const auto fp = fingerprint(keyHash);
+    auto old = bucket.load(std::memory_order_acquire);
+    while (true) {
+      auto updated = old;
+      for (uint32_t slot = 0; slot < kSlotsPerBucket; slot++) {
+        const auto shift = slot * kBitsPerSlot;
+        if (((old >> shift) & kSlotMask) == fp) {
+          updated &= ~(kSlotMask << shift);
+        }
+      }
+      const auto nextVersion = static_cast<Token>(version(old) + 1);
+      updated = (updated & ~(kSlotMask << kVersionShift)) |
+                (static_cast<uint64_t>(nextVersion) << kVersionShift);
+      if (bucket.compare_exchange_weak(old, updated,
+                                       std::memory_order_acq_rel)) {
+        return;
+      }
+    }
+  }
+
+  // @return the max number of misses remembered
+  size_t getCapacity() const noexcept { return numBuckets_ * kSlotsPerBucket; }
+
+ private:
+  static constexpr uint32_t kSlotsPerBucket = 3;
+  static constexpr uint32_t kBitsPerSlot = 16;
+  static constexpr uint64_t kSlotMask = (1ULL << kBitsPerSlot) - 1;
+  static constexpr uint32_t kVersionShift = kSlotsPerBucket * kBitsPerSlot;
+
+  // fingerprint from the high bits since the low bits pick the bucket. 0
+  // marks an empty slot.
+  static uint16_t fingerprint(uint64_t keyHash) noexcept {
+    const auto fp = static_cast<uint16_t>(keyHash >> (64 - kBitsPerSlot));
+    return fp == 0 ? 1 : fp;
+  }
+
+  static Token version(uint64_t bucket) noexcept {
+    return static_cast<Token>(bucket >> kVersionShift);
+  }
+
+  // @return the slot holding @fp, or kSlotsPerBucket if none does
+  static uint32_t findSlot(uint64_t bucket, uint16_t fp) noexcept {
+    for (uint32_t slot = 0; slot < kSlotsPerBucket; slot++) {
+      if (((bucket >> (slot * kBitsPerSlot)) & kSlotMask) == fp) {
+        return slot;
+      }
+    }
+    return kSlotsPerBucket;
+  }
+
+  std::atomic<uint64_t>& getBucket(uint64_t keyHash) const noexcept {
+    return buckets_[keyHash & (numBuckets_ - 1)];
+  }
+
+  const size_t numBuckets_;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+};
+} // namespace cachelib
+} // namespace facebook
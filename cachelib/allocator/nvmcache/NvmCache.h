@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <folly/Function.h>
+#include <folly/Random.h>
 #include <folly/container/F14Map.h>
 #include <folly/container/F14Set.h>
 #include <folly/fibers/TimedMutex.h>
@@ -24,23 +26,37 @@
 #include <folly/json/json.h>
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "cachelib/allocator/nvmcache/CacheApiWrapper.h"
 #include "cachelib/allocator/nvmcache/InFlightPuts.h"
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
 #include "cachelib/allocator/nvmcache/NavySetup.h"
+#include "cachelib/allocator/nvmcache/NegativeLookupCache.h"
+#include "cachelib/allocator/nvmcache/NvmCompressor.h"
 #include "cachelib/allocator/nvmcache/NvmItem.h"
 #include "cachelib/allocator/nvmcache/ReqContexts.h"
 #include "cachelib/allocator/nvmcache/TombStones.h"
 #include "cachelib/allocator/nvmcache/WaitContext.h"
+#include "cachelib/allocator/nvmcache/WarmUpPromotionFilter.h"
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/EventInterface.h"
 #include "cachelib/common/Exceptions.h"
 #include "cachelib/common/Hash.h"
+#include "cachelib/common/HistogramStats.h"
+#include "cachelib/common/Time.h"
+#include "cachelib/common/Tracepoints.h"
 #include "cachelib/common/Utils.h"
 #include "cachelib/navy/common/Device.h"
+#include "cachelib/navy/common/LookupTrace.h"
 #include "folly/Range.h"
 
 namespace facebook::cachelib {
@@ -91,6 +107,16 @@ class NvmCache {
   using DeleteTombStoneGuard = typename TombStones::Guard;
   using PutToken = typename InFlightPuts::PutToken;
 
+  // Outcome of a batch remove, counting each key once.
+  struct RemoveBatchResult {
+    size_t numRemoved{0};  // removed from navy
+    size_t numNotFound{0}; // not in navy, including the skipped removes
+    size_t numFailed{0};   // failed with an error
+  };
+  using RemoveBatchCallback = folly::Function<void(RemoveBatchResult)>;
+  using RemoveBatchKeys =
+      std::vector<std::pair<HashedKey, DeleteTombStoneGuard>>;
+
   struct Config {
     navy::NavyConfig navyConfig{};
 
@@ -118,6 +144,55 @@ class NvmCache {
     // gradually. See S421120 for more details.
     bool disableNvmCacheOnBadState_S421120{true};
 
+    // (Optional) number of recent nvm misses to remember so that repeated
+    // lookups for absent keys are answered without going to navy. Sized in
+    // entries of 16 bits. 0 disables it.
+    size_t negativeLookupCacheSize{0};
+
+    // (Optional) compression of the values written to navy, by pool. The
+    // values of the other pools are written uncompressed.
+    std::map<PoolId, NvmCompressor::Config> poolCompression{};
+
+    // maximum number of prefetched keys (see NvmCache::prefetch) being looked
+    // up in navy at a time. The keys prefetched beyond it are skipped. 0
+    // disables prefetching.
+    uint32_t maxPrefetchesInflight{1024};
+
+    // (Optional) the prefetches that did not start within this long are
+    // cancelled. 0 for no timeout.
+    std::chrono::milliseconds prefetchTimeout{0};
+
+    // (Optional) recover navy on a background thread instead of in the
+    // constructor. Until the recovery completes nvmcache is not enabled:
+    // lookups miss and puts are dropped, while removes are queued and applied
+    // once recovered.
+    bool asyncRecovery{false};
+
+    // maximum number of removes queued during an async recovery. Beyond it,
+    // navy is reset instead of recovered since the removes can not be
+    // applied anymore.
+    size_t maxRemovesDuringRecovery{1'000'000};
+
+    // (Optional) trace one in this many navy lookups through the stages of
+    // the lookup, from the fill map to the insert into DRAM, and export the
+    // latency of every stage as nvm_lookup_stage_<stage>_ns. 0 disables it.
+    uint32_t lookupTraceSampleRate{0};
+
+    // (Optional) warm up after a restart with a cold DRAM and a warm navy.
+    // For this long after nvmcache is created, an item found in navy is only
+    // inserted into DRAM if its key was found in navy before within
+    // warmUpPromotionWindow, or by several lookups at once. Otherwise the
+    // item is handed out without being inserted and freed once released, so
+    // that DRAM fills with the keys that are looked up again rather than with
+    // every key read once. Finds for writing and prefetches always insert.
+    // 0 disables it.
+    std::chrono::seconds warmUpDuration{0};
+    std::chrono::seconds warmUpPromotionWindow{60};
+
+    // number of keys found in navy remembered during the warm up, rounded up
+    // to a power of two. Sized in entries of 8 bytes.
+    size_t warmUpTrackedKeys{1 << 20};
+
     // serialize the config for debugging purposes
     std::map<std::string, std::string> serialize() const;
 
@@ -137,10 +212,32 @@ class NvmCache {
            bool truncate,
            const ItemDestructor& itemDestructor);
 
+  // waits for the async recovery, if any
+  ~NvmCache();
+
   // Look up item by key
   // @param key         key to lookup
+  // @param toWrite     the caller mutates the item, so it must be inserted
+  //                    into DRAM even during the warm up
   // @return            WriteHandle
-  WriteHandle find(HashedKey key);
+  WriteHandle find(HashedKey key, bool toWrite = false);
+
+  // Look up a batch of keys. Same as calling find for each key, except that
+  // the keys that have to be read from navy are looked up together when it is
+  // safe to do so.
+  // @param keys        keys to lookup
+  // @return            a WriteHandle for each key, at the same index
+  std::vector<WriteHandle> findBatch(folly::Range<const HashedKey*> keys);
+
+  // Bring a batch of keys from navy into the cache in the background, so that
+  // upcoming finds for them hit in DRAM. Does not wait for the lookups. They
+  // are issued to navy at low priority so they do not delay the lookups of
+  // finds, and a find for a key being prefetched joins its lookup. The keys
+  // already in DRAM, being looked up, removed or written to navy are skipped,
+  // and so are the keys beyond Config::maxPrefetchesInflight.
+  // @param keys        keys to prefetch
+  // @return            the number of keys looked up in navy
+  size_t prefetch(folly::Range<const HashedKey*> keys);
 
   // Returns true if a key is potentially in cache. There is a non-zero chance
   // the key does not exist in cache (e.g. hash collision in NvmCache). This
@@ -175,7 +272,18 @@ class NvmCache {
 
   // returns the current state of whether nvmcache is enabled or not. nvmcache
   // can be disabled if the backend implementation ends up in a corrupt state
-  bool isEnabled() const noexcept { return navyEnabled_; }
+  bool isEnabled() const noexcept {
+    return navyEnabled_ && !recovering_.load(std::memory_order_acquire);
+  }
+
+  // returns true while navy is being recovered in the background. See
+  // Config::asyncRecovery
+  bool isRecovering() const noexcept {
+    return recovering_.load(std::memory_order_acquire);
+  }
+
+  // blocks until the async recovery, if any, completes
+  void waitForRecovery();
 
   // creates a delete tombstone for the key. This will ensure that all
   // concurrent gets and puts to nvmcache can synchronize with an upcoming
@@ -197,6 +305,18 @@ class NvmCache {
   //                    tombstone should be created before removing item in ram.
   void remove(HashedKey hk, DeleteTombStoneGuard tombstone);
 
+  // remove a batch of keys. This is equivalent to calling remove for every
+  // key, except that the navy removes are submitted together: grouped by
+  // engine pair into a single job each, which removes the keys sharing an
+  // index bucket together.
+  // @param keys  keys to remove with their tombstones, created the same as
+  //              for remove. The keys only need to be valid for the duration
+  //              of the call.
+  // @param cb    invoked once with the outcome, after the removes of all the
+  //              keys complete. It can be invoked on a navy worker thread or
+  //              before this returns. Optional.
+  void removeBatch(RemoveBatchKeys keys, RemoveBatchCallback cb);
+
   // peek the nvmcache without bringing the item into the cache. creates a
   // temporary item handle with the content of the nvmcache. this is intended
   // for debugging purposes
@@ -297,13 +417,24 @@ class NvmCache {
 
   std::unique_ptr<NvmItem> makeNvmItem(const Item& item);
 
+  // @return a compressed copy of @nvmItem if its pool compresses its values
+  //         and it compresses well enough, @nvmItem otherwise.
+  std::unique_ptr<NvmItem> compressNvmItem(std::unique_ptr<NvmItem> nvmItem);
+
+  // @param buf  holds the decompressed copy of @nvmItem, if any
+  //
+  // @return @nvmItem if it is not compressed, its decompressed copy
+  //         otherwise. nullptr if it could not be decompressed.
+  const NvmItem* decompressNvmItem(const NvmItem& nvmItem,
+                                   std::unique_ptr<NvmItem>& buf);
+
   // wrap an item into a blob for writing into navy.
   Blob makeBlob(const Item& it);
   uint32_t getStorageSizeInNvm(const Item& it);
 
   // Holds all the necessary data to do an async navy get
-  // All of the supported operations aren't thread safe. The caller
-  // needs to ensure thread safety
+  // All of the supported operations aren't thread safe, except isValid().
+  // The caller needs to ensure thread safety
   struct GetCtx {
     NvmCache& cache;       //< the NvmCache instance
     const std::string key; //< key being fetched
@@ -311,7 +442,19 @@ class NvmCache {
                                                                    // waiters
     WriteHandle it; // will be set when Context is being filled
     util::LatencyTracker tracker_;
-    bool valid_;
+    // written under the fill lock, but read without it to skip filling
+    // early.
+    std::atomic<bool> valid_;
+    // taken before the lookup so that a miss racing with a put is not
+    // recorded in the negative lookup cache.
+    NegativeLookupCache::Token negativeLookupToken{0};
+    // started by a prefetch rather than a find
+    const bool prefetch{false};
+    // a find for writing is waiting, so the item must be inserted into DRAM
+    // even during the warm up. Written under the fill lock.
+    bool toWrite{false};
+    // stage timestamps of a sampled lookup, nullptr if not sampled
+    std::unique_ptr<navy::LookupTrace> trace;
 
     GetCtx(NvmCache& c,
            folly::StringPiece k,
@@ -325,6 +468,12 @@ class NvmCache {
       addWaiter(std::move(ctx));
     }
 
+    // for a prefetch, which has no waiter of its own
+    GetCtx(NvmCache& c, folly::StringPiece k)
+        : cache(c), key(k.toString()), valid_(true), prefetch(true) {
+      it.markWentToNvm();
+    }
+
     ~GetCtx() {
       // prevent any further enqueue to waiters
       // Note: we don't need to hold locks since no one can enqueue
@@ -369,9 +518,9 @@ class NvmCache {
       }
     }
 
-    void invalidate() { valid_ = false; }
+    void invalidate() { valid_.store(false, std::memory_order_relaxed); }
 
-    bool isValid() const { return valid_; }
+    bool isValid() const { return valid_.load(std::memory_order_relaxed); }
   };
 
   // Erase entry for the ctx from the fill map
@@ -431,13 +580,75 @@ class NvmCache {
     return getFillLockForShard(getShardForKey(hk));
   }
 
+  InFlightPuts& getInflightPuts(HashedKey hk) {
+    return inflightPuts_[hk.keyHash() % numInflightShards_];
+  }
+
+  TombStones& getTombStones(HashedKey hk) {
+    return tombstones_[hk.keyHash() % numInflightShards_];
+  }
+
   void onGetComplete(GetCtx& ctx,
                      navy::Status s,
                      HashedKey key,
                      navy::BufferView value);
 
+  // Resolves @hk against DRAM and the fills in flight. If it has to be read
+  // from navy, a fill context is created for it and returned in @ctx, which
+  // is left null otherwise.
+  // @param canBatch  set to true if the navy lookup for @ctx can be done
+  //                  through a batch lookup, which is not ordered with the
+  //                  puts already enqueued for the same shard.
+  // @param toWrite   the item must be inserted into DRAM, see find
+  // @return          the handle to return to the caller of find
+  WriteHandle startFind(HashedKey hk,
+                        GetCtx*& ctx,
+                        bool& canBatch,
+                        bool toWrite = false);
+
+  // creates the fill context of a prefetch, unless it is to be skipped.
+  // @return the context, nullptr if the key is skipped
+  GetCtx* startPrefetch(HashedKey hk);
+
   void evictCB(HashedKey hk, navy::BufferView val, navy::DestructorEvent e);
 
+  // Called when the navy remove for @ctx completes.
+  void onRemoveComplete(DelContexts& delContexts,
+                        const DelCtx& ctx,
+                        navy::Status status);
+
+  // Tracks the keys of a batch remove that have not completed yet.
+  class RemoveBatchState {
+   public:
+    RemoveBatchState(RemoveBatchCallback cb, size_t numPending)
+        : cb_{std::move(cb)}, numPending_{numPending} {}
+
+    // records the outcome of a key of the batch
+    void complete(navy::Status status) {
+      auto& counter = status == navy::Status::Ok         ? numRemoved_
+                      : status == navy::Status::NotFound ? numNotFound_
+                                                         : numFailed_;
+      counter.fetch_add(1, std::memory_order_relaxed);
+      finish();
+    }
+
+    // drops one pending count. The callback is invoked by the last one.
+    void finish() {
+      if (numPending_.fetch_sub(1, std::memory_order_acq_rel) == 1 && cb_) {
+        cb_(RemoveBatchResult{numRemoved_.load(std::memory_order_relaxed),
+                              numNotFound_.load(std::memory_order_relaxed),
+                              numFailed_.load(std::memory_order_relaxed)});
+      }
+    }
+
+   private:
+    RemoveBatchCallback cb_;
+    std::atomic<size_t> numPending_;
+    std::atomic<size_t> numRemoved_{0};
+    std::atomic<size_t> numNotFound_{0};
+    std::atomic<size_t> numFailed_{0};
+  };
+
   static navy::BufferView makeBufferView(folly::ByteRange b) {
     return navy::BufferView{b.size(), b.data()};
   }
@@ -468,9 +679,11 @@ class NvmCache {
   std::array<DelContexts, kShards> delContexts_;
 
   // co-ordination between in-flight evictions from cache that are not queued
-  // to navy and in-flight gets into nvmcache that are not yet queued.
-  std::array<InFlightPuts, kShards> inflightPuts_;
-  std::array<TombStones, kShards> tombstones_;
+  // to navy and in-flight gets into nvmcache that are not yet queued. Both
+  // have NavyConfig::getInflightTrackingShards() shards.
+  const size_t numInflightShards_;
+  std::unique_ptr<InFlightPuts[]> inflightPuts_;
+  std::unique_ptr<TombStones[]> tombstones_;
 
   const ItemDestructor itemDestructor_;
 
@@ -485,6 +698,50 @@ class NvmCache {
 
   std::unique_ptr<cachelib::navy::AbstractCache> navyCache_;
 
+  // misses recently confirmed by navy. nullptr if disabled.
+  std::unique_ptr<NegativeLookupCache> negativeLookupCache_;
+
+  // keys found in navy during the warm up and the time it ends in seconds.
+  // nullptr if there is no warm up.
+  std::unique_ptr<WarmUpPromotionFilter> warmUpFilter_;
+  uint32_t warmUpEndSecs_{0};
+
+  // @return true if the item found in navy for @ctx is to be handed out
+  //         without inserting it into DRAM
+  bool shouldSkipFill(const GetCtx& ctx, HashedKey hk);
+
+  // compressors of the pools that compress their values. Not modified after
+  // construction.
+  folly::F14FastMap<PoolId, std::unique_ptr<NvmCompressor>> compressors_;
+
+  // number of prefetches being looked up in navy
+  std::atomic<uint32_t> numPrefetchesInflight_{0};
+
+  // latency of every stage of the sampled lookups, by LookupTrace::Stage
+  mutable std::array<util::HistogramStats, navy::LookupTrace::kNumStages>
+      lookupStageLatency_;
+
+  // record the stages of a sampled lookup once it completed
+  void recordLookupTrace(const navy::LookupTrace& trace);
+
+  // recovers navy in the background, then applies the removes queued
+  // meanwhile
+  void recoverNavy();
+
+  // queues the remove of a key while navy is recovering
+  // @return false if the recovery completed and the key has to be removed
+  //         from navy instead
+  bool deferRemove(HashedKey hk);
+
+  // async recovery state. The removes are queued under recoveryMutex_ while
+  // recovering_ is set, and it is cleared under the mutex once they are
+  // applied.
+  std::atomic<bool> recovering_{false};
+  std::mutex recoveryMutex_;
+  std::vector<std::string> removesDuringRecovery_;
+  bool removesOverflowed_{false};
+  std::thread recoveryThread_;
+
   friend class tests::NvmCacheTest;
   FRIEND_TEST(CachelibAdminTest, WorkingSetAnalysisLoggingTest);
 };
@@ -500,6 +757,23 @@ std::map<std::string, std::string> NvmCache<C>::Config::serialize() const {
       truncateItemToOriginalAllocSizeInNvm ? "true" : "false";
   configMap["disableNvmCacheOnBadState_S421120"] =
       disableNvmCacheOnBadState_S421120 ? "true" : "false";
+  configMap["negativeLookupCacheSize"] =
+      std::to_string(negativeLookupCacheSize);
+  configMap["maxPrefetchesInflight"] = std::to_string(maxPrefetchesInflight);
+  configMap["prefetchTimeoutMs"] = std::to_string(prefetchTimeout.count());
+  configMap["asyncRecovery"] = asyncRecovery ? "true" : "false";
+  configMap["maxRemovesDuringRecovery"] =
+      std::to_string(maxRemovesDuringRecovery);
+  configMap["lookupTraceSampleRate"] = std::to_string(lookupTraceSampleRate);
+  configMap["warmUpDurationSecs"] = std::to_string(warmUpDuration.count());
+  configMap["warmUpPromotionWindowSecs"] =
+      std::to_string(warmUpPromotionWindow.count());
+  configMap["warmUpTrackedKeys"] = std::to_string(warmUpTrackedKeys);
+  for (const auto& [pid, compression] : poolCompression) {
+    for (const auto& [name, value] : compression.serialize()) {
+      configMap[folly::sformat("compression::pool{}::{}", pid, name)] = value;
+    }
+  }
   return configMap;
 }
 
@@ -512,6 +786,18 @@ typename NvmCache<C>::Config NvmCache<C>::Config::validateAndSetDefaults() {
         "Encode and Decode CBs must be both specified or both empty.");
   }
 
+  for (const auto& [pid, compression] : poolCompression) {
+    compression.validate();
+  }
+
+  if (warmUpDuration.count() > 0 &&
+      (warmUpPromotionWindow.count() <= 0 || warmUpTrackedKeys == 0)) {
+    throw std::invalid_argument(folly::sformat(
+        "Warm up needs a promotion window and tracked keys, but got a window "
+        "of {}s and {} tracked keys",
+        warmUpPromotionWindow.count(), warmUpTrackedKeys));
+  }
+
   if (deviceEncryptor) {
     auto encryptionBlockSize = deviceEncryptor->encryptionBlockSize();
     auto blockSize = navyConfig.getBlockSize();
@@ -544,9 +830,7 @@ typename NvmCache<C>::Config NvmCache<C>::Config::validateAndSetDefaults() {
 template <typename C>
 typename NvmCache<C>::DeleteTombStoneGuard NvmCache<C>::createDeleteTombStone(
     HashedKey hk) {
-  // lower bits for shard and higher bits for key.
-  const auto shard = hk.keyHash() % kShards;
-  auto guard = tombstones_[shard].add(hk.key());
+  auto guard = getTombStones(hk).add(hk);
 
   // need to synchronize tombstone creations with fill lock to serialize
   // async fills with deletes
@@ -558,34 +842,109 @@ typename NvmCache<C>::DeleteTombStoneGuard NvmCache<C>::createDeleteTombStone(
   // If onGetComplete is holding the FillLock, wait the insertion to be done.
   // If onGetComplete has not yet acquired FillLock, we are fine to exit since
   // hasTombStone in onGetComplete is checked after acquiring FillLock.
-  auto lock = getFillLockForShard(shard);
+  auto lock = getFillLock(hk);
 
   return guard;
 }
 
 template <typename C>
 bool NvmCache<C>::hasTombStone(HashedKey hk) {
-  // lower bits for shard and higher bits for key.
-  const auto shard = hk.keyHash() % kShards;
-  return tombstones_[shard].isPresent(hk.key());
+  return getTombStones(hk).isPresent(hk);
 }
 
 template <typename C>
-typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk) {
+typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk,
+                                                    bool toWrite) {
   if (!isEnabled()) {
     return WriteHandle{};
   }
 
+  GetCtx* ctx{nullptr};
+  bool canBatch{false};
+  auto hdl = startFind(hk, ctx, canBatch, toWrite);
+  if (!ctx) {
+    return hdl;
+  }
+
+  auto guard = folly::makeGuard([hk, this]() { removeFromFillMap(hk); });
+
+  {
+    // navy picks up the trace while enqueueing the lookup
+    navy::ScopedLookupTrace scopedTrace{ctx->trace.get()};
+    navyCache_->lookupAsync(
+        HashedKey::precomputed(ctx->getKey(), hk.keyHash()),
+        [this, ctx](navy::Status s, HashedKey k, navy::Buffer v) {
+          this->onGetComplete(*ctx, s, k, v.view());
+        });
+  }
+  guard.dismiss();
+  return hdl;
+}
+
+template <typename C>
+std::vector<typename NvmCache<C>::WriteHandle> NvmCache<C>::findBatch(
+    folly::Range<const HashedKey*> keys) {
+  std::vector<WriteHandle> handles;
+  handles.reserve(keys.size());
+  if (!isEnabled()) {
+    handles.resize(keys.size());
+    return handles;
+  }
+
+  std::vector<HashedKey> batchKeys;
+  std::vector<navy::LookupCallback> batchCbs;
+  for (const auto hk : keys) {
+    GetCtx* ctx{nullptr};
+    bool canBatch{false};
+    handles.push_back(startFind(hk, ctx, canBatch));
+    if (!ctx) {
+      continue;
+    }
+
+    auto navyKey = HashedKey::precomputed(ctx->getKey(), hk.keyHash());
+    auto cb = [this, ctx](navy::Status s, HashedKey k, navy::Buffer v) {
+      this->onGetComplete(*ctx, s, k, v.view());
+    };
+    if (!canBatch) {
+      auto guard = folly::makeGuard([hk, this]() { removeFromFillMap(hk); });
+      {
+        navy::ScopedLookupTrace scopedTrace{ctx->trace.get()};
+        navyCache_->lookupAsync(navyKey, std::move(cb));
+      }
+      guard.dismiss();
+      continue;
+    }
+    batchKeys.push_back(navyKey);
+    batchCbs.emplace_back(std::move(cb));
+  }
+
+  if (batchKeys.empty()) {
+    return handles;
+  }
+  auto guard = folly::makeGuard([&batchKeys, this]() {
+    for (auto hk : batchKeys) {
+      removeFromFillMap(hk);
+    }
+  });
+  navyCache_->lookupBatchAsync(batchKeys, std::move(batchCbs));
+  guard.dismiss();
+  return handles;
+}
+
+template <typename C>
+typename NvmCache<C>::WriteHandle NvmCache<C>::startFind(HashedKey hk,
+                                                         GetCtx*& ctx,
+                                                         bool& canBatch,
+                                                         bool toWrite) {
   util::LatencyTracker tracker(stats().nvmLookupLatency_);
 
   auto shard = getShardForKey(hk);
   // invalidateToken any inflight puts for the same key since we are filling
   // from nvmcache.
-  inflightPuts_[shard].invalidateToken(hk.key());
+  getInflightPuts(hk).invalidateToken(hk);
 
   stats().numNvmGets.inc();
 
-  GetCtx* ctx{nullptr};
   WriteHandle hdl{nullptr};
   {
     auto lock = getFillLockForShard(shard);
@@ -602,6 +961,13 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk) {
       return hdl;
     }
 
+    // the token must be taken before checking for put contexts. A put
+    // invalidates the key after creating its context, so a put we do not
+    // see below fails recording the miss of this lookup.
+    const auto negativeLookupToken =
+        negativeLookupCache_ ? negativeLookupCache_->getToken(hk.keyHash())
+                             : NegativeLookupCache::Token{0};
+
     auto& fillMap = getFillMapForShard(shard);
     auto it = fillMap.find(hk.key());
     // we use async apis for nvmcache operations into navy. async apis for
@@ -624,11 +990,26 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk) {
     // For concurrent put, if it is already enqueued, its put context already
     // exists. If it is not enqueued yet (in-flight) the above invalidateToken
     // will prevent the put from being enqueued.
-    if (it == fillMap.end() && !putContexts_[shard].hasContexts() &&
-        !navyCache_->couldExist(hk)) {
-      stats().numNvmGetMiss.inc();
-      stats().numNvmGetMissFast.inc();
-      return WriteHandle{};
+    //
+    // The negative lookup cache is checked under the same conditions. Any
+    // put that completed already invalidated the key before its context was
+    // destroyed.
+    if (it == fillMap.end() && !putContexts_[shard].hasContexts()) {
+      if (negativeLookupCache_ &&
+          negativeLookupCache_->isKnownMiss(hk.keyHash())) {
+        stats().numNvmGetMiss.inc();
+        stats().numNvmGetMissFast.inc();
+        stats().numNvmGetMissNegativeCache.inc();
+        return WriteHandle{};
+      }
+      if (!navyCache_->couldExist(hk)) {
+        if (negativeLookupCache_) {
+          negativeLookupCache_->recordMiss(hk.keyHash(), negativeLookupToken);
+        }
+        stats().numNvmGetMiss.inc();
+        stats().numNvmGetMissFast.inc();
+        return WriteHandle{};
+      }
     }
 
     hdl = CacheAPIWrapperForNvm<C>::createNvmCacheFillHandle(cache_);
@@ -640,6 +1021,7 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk) {
     if (it != fillMap.end()) {
       ctx = it->second.get();
       ctx->addWaiter(std::move(waitContext));
+      ctx->toWrite |= toWrite;
       stats().numNvmGetCoalesced.inc();
       return hdl;
     }
@@ -651,20 +1033,112 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::find(HashedKey hk) {
         fillMap.emplace(std::make_pair(newCtx->getKey(), std::move(newCtx)));
     XDCHECK(res.second);
     ctx = res.first->second.get();
+    ctx->negativeLookupToken = negativeLookupToken;
+    ctx->toWrite = toWrite;
+    if (config_.lookupTraceSampleRate > 0 &&
+        folly::Random::oneIn(config_.lookupTraceSampleRate)) {
+      ctx->trace = std::make_unique<navy::LookupTrace>();
+    }
+
+    // A batch lookup is not ordered with the requests already enqueued for
+    // its keys. Same as for the couldExist check above, the puts enqueued
+    // for this shard could have their partial state read. The removes are
+    // fine since onGetComplete discards the values that have a tombstone.
+    canBatch = !putContexts_[shard].hasContexts();
   } // scope for fill lock
 
   XDCHECK(ctx);
-  auto guard = folly::makeGuard([hk, this]() { removeFromFillMap(hk); });
-
-  navyCache_->lookupAsync(
-      HashedKey::precomputed(ctx->getKey(), hk.keyHash()),
-      [this, ctx](navy::Status s, HashedKey k, navy::Buffer v) {
-        this->onGetComplete(*ctx, s, k, v.view());
-      });
-  guard.dismiss();
   return hdl;
 }
 
+template <typename C>
+size_t NvmCache<C>::prefetch(folly::Range<const HashedKey*> keys) {
+  if (!isEnabled()) {
+    return 0;
+  }
+
+  const uint64_t deadlineNs =
+      config_.prefetchTimeout.count() > 0
+          ? util::getCurrentTimeNs() +
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    config_.prefetchTimeout)
+                    .count()
+          : 0;
+  size_t numIssued = 0;
+  for (const auto hk : keys) {
+    if (numPrefetchesInflight_.fetch_add(1) >= config_.maxPrefetchesInflight) {
+      numPrefetchesInflight_.fetch_sub(1);
+      stats().numNvmPrefetchSkipped.inc();
+      continue;
+    }
+
+    GetCtx* ctx = startPrefetch(hk);
+    if (!ctx) {
+      numPrefetchesInflight_.fetch_sub(1);
+      stats().numNvmPrefetchSkipped.inc();
+      continue;
+    }
+
+    auto guard = folly::makeGuard([hk, this]() {
+      removeFromFillMap(hk);
+      numPrefetchesInflight_.fetch_sub(1);
+    });
+    navyCache_->lookupAsync(
+        HashedKey::precomputed(ctx->getKey(), hk.keyHash()),
+        [this, ctx](navy::Status s, HashedKey k, navy::Buffer v) {
+          this->onGetComplete(*ctx, s, k, v.view());
+          numPrefetchesInflight_.fetch_sub(1);
+        },
+        navy::RequestPriority::Low,
+        deadlineNs);
+    guard.dismiss();
+    numIssued++;
+  }
+  return numIssued;
+}
+
+template <typename C>
+typename NvmCache<C>::GetCtx* NvmCache<C>::startPrefetch(HashedKey hk) {
+  // a put in flight is about to write a newer value than navy has, and a
+  // remove in flight would drop the fill anyway.
+  if (getInflightPuts(hk).isPresent(hk) || hasTombStone(hk)) {
+    return nullptr;
+  }
+
+  auto shard = getShardForKey(hk);
+  auto lock = getFillLockForShard(shard);
+  if (CacheAPIWrapperForNvm<C>::findInternal(cache_, hk.key()) != nullptr) {
+    return nullptr;
+  }
+
+  // see startFind about when the fast negative lookups can be trusted
+  const auto negativeLookupToken =
+      negativeLookupCache_ ? negativeLookupCache_->getToken(hk.keyHash())
+                           : NegativeLookupCache::Token{0};
+  auto& fillMap = getFillMapForShard(shard);
+  if (fillMap.find(hk.key()) != fillMap.end()) {
+    return nullptr;
+  }
+  if (!putContexts_[shard].hasContexts() &&
+      ((negativeLookupCache_ &&
+        negativeLookupCache_->isKnownMiss(hk.keyHash())) ||
+       !navyCache_->couldExist(hk))) {
+    return nullptr;
+  }
+
+  // the prefetch lookups are counted as nvm gets, so that their misses are
+  // accounted for.
+  stats().numNvmGets.inc();
+  stats().numNvmPrefetches.inc();
+  auto newCtx = std::make_unique<GetCtx>(*this, hk.key());
+  auto res =
+      fillMap.emplace(std::make_pair(newCtx->getKey(), std::move(newCtx)));
+  XDCHECK(res.second);
+  auto* ctx = res.first->second.get();
+  ctx->negativeLookupToken = negativeLookupToken;
+  return ctx;
+}
+
 template <typename C>
 bool NvmCache<C>::couldExistFast(HashedKey hk) {
   if (!isEnabled()) {
@@ -674,7 +1148,7 @@ bool NvmCache<C>::couldExistFast(HashedKey hk) {
   auto shard = getShardForKey(hk);
   // invalidateToken any inflight puts for the same key since we are filling
   // from nvmcache.
-  inflightPuts_[shard].invalidateToken(hk.key());
+  getInflightPuts(hk).invalidateToken(hk);
 
   auto lock = getFillLockForShard(shard);
   // do not use the Cache::find() since that will call back into us.
@@ -731,8 +1205,12 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::peek(folly::StringPiece key) {
   navyCache_->lookupAsync(
       HashedKey{key}, [&, this](navy::Status st, HashedKey, navy::Buffer v) {
         if (st != navy::Status::NotFound) {
-          auto nvmItem = reinterpret_cast<const NvmItem*>(v.data());
-          hdl = createItem(key, *nvmItem);
+          std::unique_ptr<NvmItem> buf;
+          auto nvmItem = decompressNvmItem(
+              *reinterpret_cast<const NvmItem*>(v.data()), buf);
+          if (nvmItem) {
+            hdl = createItem(key, *nvmItem);
+          }
         }
         b.post();
       });
@@ -864,7 +1342,10 @@ void NvmCache<C>::evictCB(HashedKey hk,
   if (itemDestructor_) {
     // create the item on heap instead of memory pool to avoid allocation
     // failure and evictions from cache for a temporary item.
-    auto iobuf = createItemAsIOBuf(hk.key(), nvmItem);
+    std::unique_ptr<NvmItem> decompressed;
+    const auto* destructedItem = decompressNvmItem(nvmItem, decompressed);
+    auto iobuf = destructedItem ? createItemAsIOBuf(hk.key(), *destructedItem)
+                                : nullptr;
     if (iobuf) {
       auto& item = *reinterpret_cast<Item*>(iobuf->writableData());
       // make chained items
@@ -908,6 +1389,9 @@ NvmCache<C>::NvmCache(C& c,
         const auto& nvmItem = *reinterpret_cast<const NvmItem*>(v.data());
         return nvmItem.isExpired();
       }),
+      numInflightShards_(config_.navyConfig.getInflightTrackingShards()),
+      inflightPuts_(std::make_unique<InFlightPuts[]>(numInflightShards_)),
+      tombstones_(std::make_unique<TombStones[]>(numInflightShards_)),
       itemDestructor_(itemDestructor) {
   navyCache_ = createNavyCache(
       config_.navyConfig,
@@ -917,7 +1401,94 @@ NvmCache<C>::NvmCache(C& c,
       },
       truncate,
       std::move(config.deviceEncryptor),
-      itemDestructor_ ? true : false);
+      itemDestructor_ ? true : false,
+      [](navy::BufferView v) -> uint32_t {
+        return reinterpret_cast<const NvmItem*>(v.data())->getExpiryTime();
+      },
+      !truncate && config_.asyncRecovery);
+  if (config_.negativeLookupCacheSize > 0) {
+    negativeLookupCache_ =
+        std::make_unique<NegativeLookupCache>(config_.negativeLookupCacheSize);
+  }
+  // a truncated navy has nothing to warm up from
+  if (!truncate && config_.warmUpDuration.count() > 0) {
+    warmUpFilter_ = std::make_unique<WarmUpPromotionFilter>(
+        config_.warmUpTrackedKeys,
+        static_cast<uint32_t>(config_.warmUpPromotionWindow.count()));
+    warmUpEndSecs_ = util::getCurrentTimeSec() +
+                     static_cast<uint32_t>(config_.warmUpDuration.count());
+  }
+  for (const auto& [pid, compression] : config_.poolCompression) {
+    compressors_.emplace(pid, std::make_unique<NvmCompressor>(compression));
+  }
+  if (!truncate && config_.asyncRecovery) {
+    recovering_ = true;
+    recoveryThread_ = std::thread{[this] { recoverNavy(); }};
+  }
+}
+
+template <typename C>
+NvmCache<C>::~NvmCache() {
+  waitForRecovery();
+}
+
+template <typename C>
+void NvmCache<C>::recoverNavy() {
+  const auto startMs = util::getCurrentTimeMs();
+  bool recovered = false;
+  try {
+    recovered = navyCache_->recover();
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "Navy recovery failed: {}", e.what());
+  }
+  if (!recovered) {
+    XLOG(WARN) << "No recovery data found. Continuing with clean cache.";
+  }
+
+  std::lock_guard<std::mutex> l{recoveryMutex_};
+  if (removesOverflowed_) {
+    XLOGF(WARN,
+          "More than {} removes during navy recovery. Resetting navy.",
+          config_.maxRemovesDuringRecovery);
+    navyCache_->reset();
+  } else {
+    for (const auto& key : removesDuringRecovery_) {
+      navyCache_->removeAsync(HashedKey{key}, [](navy::Status, HashedKey) {});
+    }
+    // navy does not copy the keys. Waiting also orders the removes before
+    // any operation issued once recovering_ is cleared.
+    navyCache_->flush();
+  }
+  XLOGF(INFO,
+        "Navy recovered in the background in {} ms, {} removes applied",
+        util::getCurrentTimeMs() - startMs,
+        removesOverflowed_ ? 0 : removesDuringRecovery_.size());
+  removesDuringRecovery_.clear();
+  removesDuringRecovery_.shrink_to_fit();
+  recovering_.store(false, std::memory_order_release);
+}
+
+template <typename C>
+bool NvmCache<C>::deferRemove(HashedKey hk) {
+  std::lock_guard<std::mutex> l{recoveryMutex_};
+  if (!recovering_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (removesDuringRecovery_.size() >= config_.maxRemovesDuringRecovery) {
+    removesOverflowed_ = true;
+    removesDuringRecovery_.clear();
+  }
+  if (!removesOverflowed_) {
+    removesDuringRecovery_.emplace_back(hk.key().str());
+  }
+  return true;
+}
+
+template <typename C>
+void NvmCache<C>::waitForRecovery() {
+  if (recoveryThread_.joinable()) {
+    recoveryThread_.join();
+  }
 }
 
 template <typename C>
@@ -962,16 +1533,59 @@ std::unique_ptr<NvmItem> NvmCache<C>::makeNvmItem(const Item& item) {
     }
 
     const size_t bufSize = NvmItem::estimateVariableSize(blobs);
-    return std::unique_ptr<NvmItem>(new (bufSize) NvmItem(
-        poolId, item.getCreationTime(), item.getExpiryTime(), blobs));
+    return compressNvmItem(std::unique_ptr<NvmItem>(new (bufSize) NvmItem(
+        poolId, item.getCreationTime(), item.getExpiryTime(), blobs,
+        item.isLargeItem())));
   } else {
     Blob blob = makeBlob(item);
     const size_t bufSize = NvmItem::estimateVariableSize(blob);
-    return std::unique_ptr<NvmItem>(new (bufSize) NvmItem(
-        poolId, item.getCreationTime(), item.getExpiryTime(), blob));
+    return compressNvmItem(std::unique_ptr<NvmItem>(new (bufSize) NvmItem(
+        poolId, item.getCreationTime(), item.getExpiryTime(), blob)));
   }
 }
 
+template <typename C>
+std::unique_ptr<NvmItem> NvmCache<C>::compressNvmItem(
+    std::unique_ptr<NvmItem> nvmItem) {
+  auto it = compressors_.find(nvmItem->poolId());
+  if (it == compressors_.end()) {
+    return nvmItem;
+  }
+
+  const auto begin = util::getCurrentTimeNs();
+  auto compressed = it->second->compress(*nvmItem);
+  stats().nvmCompressNs.add(util::getCurrentTimeNs() - begin);
+  if (!compressed) {
+    stats().numNvmCompressSkipped.inc();
+    return nvmItem;
+  }
+  stats().numNvmCompressed.inc();
+  stats().nvmCompressBytesIn.add(nvmItem->getDataSize());
+  stats().nvmCompressBytesOut.add(compressed->getData().size());
+  return compressed;
+}
+
+template <typename C>
+const NvmItem* NvmCache<C>::decompressNvmItem(const NvmItem& nvmItem,
+                                              std::unique_ptr<NvmItem>& buf) {
+  if (!nvmItem.isCompressed()) {
+    return &nvmItem;
+  }
+
+  auto it = compressors_.find(nvmItem.poolId());
+  if (it != compressors_.end()) {
+    const auto begin = util::getCurrentTimeNs();
+    buf = it->second->decompress(nvmItem);
+    stats().nvmDecompressNs.add(util::getCurrentTimeNs() - begin);
+  }
+  if (!buf) {
+    // corrupted, or written with a compression the pool does not use anymore
+    stats().numNvmDecompressErrors.inc();
+    return nullptr;
+  }
+  return buf.get();
+}
+
 template <typename C>
 void NvmCache<C>::put(Item& item, PutToken token) {
   util::LatencyTracker tracker(stats().nvmInsertLatency_);
@@ -996,6 +1610,8 @@ void NvmCache<C>::put(Item& item, PutToken token) {
   }
 
   stats().numNvmPuts.inc();
+  CACHELIB_TRACEPOINT(nvm_put, hk.key().data(), hk.key().size(),
+                      item.getSize());
   if (hasTombStone(hk)) {
     stats().numNvmAbortedPutOnTombstone.inc();
     return;
@@ -1019,6 +1635,11 @@ void NvmCache<C>::put(Item& item, PutToken token) {
   auto& putContexts = putContexts_[shard];
   auto& ctx = putContexts.createContext(item.getKey(), std::move(iobuf),
                                         std::move(tracker));
+  // after creating the context so that a concurrent lookup either sees the
+  // context or fails recording its miss.
+  if (negativeLookupCache_) {
+    negativeLookupCache_->invalidate(hk.keyHash());
+  }
   // capture array reference for putContext. it is stable
   auto putCleanup = [&putContexts, &ctx]() { putContexts.destroyContext(ctx); };
   auto guard = folly::makeGuard([putCleanup]() { putCleanup(); });
@@ -1069,8 +1690,8 @@ template <typename F>
 typename folly::Expected<typename NvmCache<C>::PutToken,
                          InFlightPuts::PutTokenError>
 NvmCache<C>::createPutToken(folly::StringPiece key, F&& fn) {
-  return inflightPuts_[getShardForKey(key)].tryAcquireToken(
-      key, std::forward<F>(fn));
+  const HashedKey hk{key};
+  return getInflightPuts(hk).tryAcquireToken(hk, std::forward<F>(fn));
 }
 
 template <typename C>
@@ -1080,6 +1701,17 @@ void NvmCache<C>::onGetComplete(GetCtx& ctx,
                                 navy::BufferView val) {
   auto guard =
       folly::makeGuard([&ctx, hk]() { ctx.cache.removeFromFillMap(hk); });
+  // taken out of the context, which can be destroyed before returning
+  auto trace = std::move(ctx.trace);
+  auto traceGuard = folly::makeGuard([this, &trace]() {
+    if (trace) {
+      recordLookupTrace(*trace);
+    }
+  });
+  if (trace) {
+    trace->stamp(navy::LookupTrace::kCallback);
+  }
+
   // navy got disabled while we were fetching. If so, safely return a miss.
   // If navy gets disabled beyond this point, it is okay since we fetched it
   // before we got disabled.
@@ -1087,10 +1719,38 @@ void NvmCache<C>::onGetComplete(GetCtx& ctx,
     return;
   }
 
+  if (status == navy::Status::Rejected && ctx.prefetch) {
+    // the prefetch was cancelled before it started. The finds that joined it
+    // in the meantime still need their lookup, otherwise it is dropped from
+    // the fill map before any other find can join.
+    std::unique_ptr<GetCtx> toDelete;
+    auto lock = getFillLock(hk);
+    guard.dismiss();
+    if (!ctx.waiters.empty()) {
+      lock.unlock();
+      navyCache_->lookupAsync(
+          hk, [this, c = &ctx](navy::Status s, HashedKey k, navy::Buffer v) {
+            this->onGetComplete(*c, s, k, v.view());
+          });
+      return;
+    }
+    auto& fillMap = getFillMap(hk);
+    auto it = fillMap.find(hk.key());
+    XDCHECK(it != fillMap.end());
+    toDelete = std::move(it->second);
+    fillMap.erase(it);
+    lock.unlock();
+    stats().numNvmPrefetchCancelled.inc();
+    stats().numNvmGetMiss.inc();
+    return;
+  }
+
   if (status != navy::Status::Ok) {
     // instead of disabling navy, we enqueue a delete and return a miss.
     if (status != navy::Status::NotFound) {
       remove(hk, createDeleteTombStone(hk));
+    } else if (negativeLookupCache_) {
+      negativeLookupCache_->recordMiss(hk.keyHash(), ctx.negativeLookupToken);
     }
     stats().numNvmGetMiss.inc();
     return;
@@ -1109,6 +1769,26 @@ void NvmCache<C>::onGetComplete(GetCtx& ctx,
     return;
   }
 
+  // a racing remove or evict already invalidated this fill. Check before
+  // allocating and copying the item into DRAM only to throw it away. The
+  // check under the fill lock below stays authoritative.
+  if (hasTombStone(hk) || !ctx.isValid()) {
+    stats().numNvmGetMiss.inc();
+    stats().numNvmGetMissDueToInflightRemove.inc();
+    return;
+  }
+
+  std::unique_ptr<NvmItem> decompressed;
+  nvmItem = decompressNvmItem(*nvmItem, decompressed);
+  if (!nvmItem) {
+    stats().numNvmGetMiss.inc();
+    stats().numNvmGetMissErrs.inc();
+    // the value can not be read back. Return a miss and invalidate what we
+    // have in nvmcache
+    remove(hk, createDeleteTombStone(hk));
+    return;
+  }
+
   auto it = createItem(hk.key(), *nvmItem);
   if (!it) {
     stats().numNvmGetMiss.inc();
@@ -1129,14 +1809,67 @@ void NvmCache<C>::onGetComplete(GetCtx& ctx,
     return;
   }
 
+  if (shouldSkipFill(ctx, hk)) {
+    // the item is not inserted, so releasing it must not run the remove
+    // callback or the item destructor. Drop the context while holding the
+    // fill lock so that no find for writing joins it anymore.
+    it.markNascent();
+    it.markWentToNvm();
+    ctx.setWriteHandle(std::move(it));
+    auto& fillMap = getFillMap(hk);
+    auto fillIt = fillMap.find(hk.key());
+    XDCHECK(fillIt != fillMap.end());
+    auto toDelete = std::move(fillIt->second);
+    fillMap.erase(fillIt);
+    guard.dismiss();
+    lock.unlock();
+    stats().numNvmGetServedWithoutFill.inc();
+    return;
+  }
+
   // by the time we filled from navy, another thread inserted in RAM. We
   // disregard.
-  if (CacheAPIWrapperForNvm<C>::insertFromNvm(cache_, it)) {
+  const bool filled = CacheAPIWrapperForNvm<C>::insertFromNvm(cache_, it);
+  CACHELIB_TRACEPOINT(nvm_fill, hk.key().data(), hk.key().size(),
+                      filled ? 1 : 0);
+  if (trace) {
+    trace->stamp(navy::LookupTrace::kFilled);
+  }
+  if (filled) {
     it.markWentToNvm();
     ctx.setWriteHandle(std::move(it));
+    if (ctx.prefetch) {
+      stats().numNvmPrefetchFilled.inc();
+    }
   }
 } // namespace cachelib
 
+template <typename C>
+bool NvmCache<C>::shouldSkipFill(const GetCtx& ctx, HashedKey hk) {
+  if (!warmUpFilter_ || ctx.prefetch || ctx.toWrite) {
+    return false;
+  }
+  const auto now = util::getCurrentTimeSec();
+  if (now >= warmUpEndSecs_) {
+    return false;
+  }
+  // the hit is recorded even for a key looked up by several finds at once,
+  // which is inserted right away.
+  const bool seen = warmUpFilter_->recordHit(hk.keyHash(), now);
+  return !seen && ctx.waiters.size() <= 1;
+}
+
+template <typename C>
+void NvmCache<C>::recordLookupTrace(const navy::LookupTrace& trace) {
+  for (uint8_t i = navy::LookupTrace::kEnqueued;
+       i < navy::LookupTrace::kNumStages; i++) {
+    const auto stage = static_cast<navy::LookupTrace::Stage>(i);
+    if (const auto latencyNs = trace.getStageLatencyNs(stage)) {
+      lookupStageLatency_[i].trackValue(latencyNs);
+    }
+  }
+}
+
 template <typename C>
 typename NvmCache<C>::WriteHandle NvmCache<C>::createItem(
     folly::StringPiece key, const NvmItem& nvmItem) {
@@ -1181,6 +1914,12 @@ typename NvmCache<C>::WriteHandle NvmCache<C>::createItem(
       cache_.addChainedItem(it, std::move(chainedIt));
       XDCHECK(it->hasChainedItem());
     }
+    // the chunk index of a large item still points to the chunks that were
+    // written to navy
+    if (nvmItem.isLargeItem() &&
+        !CacheAPIWrapperForNvm<C>::rebuildLargeItemIndex(cache_, *it)) {
+      return nullptr;
+    }
   }
 
   // issue the call back to decode and fix up the item if needed.
@@ -1270,6 +2009,10 @@ void NvmCache<C>::disableNavy(const std::string& msg) {
 
 template <typename C>
 void NvmCache<C>::remove(HashedKey hk, DeleteTombStoneGuard tombstone) {
+  if (isRecovering() && navyEnabled_ && deferRemove(hk)) {
+    stats().numNvmDeletes.inc();
+    return;
+  }
   if (!isEnabled()) {
     return;
   }
@@ -1282,7 +2025,7 @@ void NvmCache<C>::remove(HashedKey hk, DeleteTombStoneGuard tombstone) {
   //
   // invalidate any inflight put that is on flight since we are queueing up a
   // deletion.
-  inflightPuts_[shard].invalidateToken(hk.key());
+  getInflightPuts(hk).invalidateToken(hk);
 
   // Skip scheduling async job to remove the key if the key couldn't exist,
   // if there are no put requests for the key shard.
@@ -1304,27 +2047,108 @@ void NvmCache<C>::remove(HashedKey hk, DeleteTombStoneGuard tombstone) {
   // capture array reference for delContext. it is stable
   auto delCleanup = [&delContexts, &ctx, this](navy::Status status,
                                                HashedKey) mutable {
-    if (auto eventTracker = CacheAPIWrapperForNvm<C>::getEventTracker(cache_)) {
-      const auto result = status == navy::Status::Ok
-                              ? AllocatorApiResult::REMOVED
-                              : (status == navy::Status::NotFound
-                                     ? AllocatorApiResult::NOT_FOUND
-                                     : AllocatorApiResult::FAILED);
-      eventTracker->record(AllocatorApiEvent::NVM_REMOVE, ctx.key(), result);
-    }
-    delContexts.destroyContext(ctx);
-    if (status == navy::Status::Ok || status == navy::Status::NotFound) {
-      return;
-    }
-    // we set disable navy since we failed to delete something
-    disableNavy(folly::sformat("Delete Failure. status = {}",
-                               static_cast<int>(status)));
+    onRemoveComplete(delContexts, ctx, status);
   };
 
   navyCache_->removeAsync(HashedKey::precomputed(ctx.key(), hk.keyHash()),
                           delCleanup);
 }
 
+template <typename C>
+void NvmCache<C>::removeBatch(RemoveBatchKeys keys, RemoveBatchCallback cb) {
+  if (isRecovering() && navyEnabled_) {
+    size_t numDeferred = 0;
+    for (const auto& [hk, tombstone] : keys) {
+      if (!deferRemove(hk)) {
+        break;
+      }
+      stats().numNvmDeletes.inc();
+      numDeferred++;
+    }
+    if (numDeferred == keys.size()) {
+      if (cb) {
+        cb(RemoveBatchResult{});
+      }
+      return;
+    }
+    // the recovery completed in the middle, the rest goes to navy
+    keys.erase(keys.begin(), keys.begin() + numDeferred);
+  }
+  if (!isEnabled()) {
+    if (cb) {
+      cb(RemoveBatchResult{});
+    }
+    return;
+  }
+
+  // one extra pending count, dropped once all the removes are submitted so
+  // that the callback can not be invoked before.
+  auto state =
+      std::make_shared<RemoveBatchState>(std::move(cb), keys.size() + 1);
+  std::vector<HashedKey> batchKeys;
+  std::vector<navy::RemoveCallback> batchCbs;
+  for (auto& [hk, tombstone] : keys) {
+    XDCHECK(tombstone);
+    stats().numNvmDeletes.inc();
+
+    util::LatencyTracker tracker(stats().nvmRemoveLatency_);
+    const auto shard = getShardForKey(hk);
+    getInflightPuts(hk).invalidateToken(hk);
+
+    // A batch job is ordered by its first key only, so a key is batched only
+    // if there is no put enqueued for its shard that the remove must follow.
+    // This is also the condition to skip the remove, see remove().
+    const bool canBatch = !putContexts_[shard].hasContexts();
+    if (canBatch && !navyCache_->couldExist(hk)) {
+      stats().numNvmSkippedDeletes.inc();
+      state->complete(navy::Status::NotFound);
+      continue;
+    }
+
+    auto& delContexts = delContexts_[shard];
+    auto& ctx = delContexts.createContext(hk.key(), std::move(tracker),
+                                          std::move(tombstone));
+    auto delCleanup = [&delContexts, &ctx, state, this](navy::Status status,
+                                                        HashedKey) {
+      onRemoveComplete(delContexts, ctx, status);
+      state->complete(status);
+    };
+    const auto navyKey = HashedKey::precomputed(ctx.key(), hk.keyHash());
+    if (canBatch) {
+      batchKeys.push_back(navyKey);
+      batchCbs.push_back(std::move(delCleanup));
+    } else {
+      navyCache_->removeAsync(navyKey, std::move(delCleanup));
+    }
+  }
+
+  if (!batchKeys.empty()) {
+    navyCache_->removeBatchAsync(std::move(batchKeys), std::move(batchCbs));
+  }
+  state->finish();
+}
+
+template <typename C>
+void NvmCache<C>::onRemoveComplete(DelContexts& delContexts,
+                                   const DelCtx& ctx,
+                                   navy::Status status) {
+  if (auto eventTracker = CacheAPIWrapperForNvm<C>::getEventTracker(cache_)) {
+    const auto result = status == navy::Status::Ok
+                            ? AllocatorApiResult::REMOVED
+                            : (status == navy::Status::NotFound
+                                   ? AllocatorApiResult::NOT_FOUND
+                                   : AllocatorApiResult::FAILED);
+    eventTracker->record(AllocatorApiEvent::NVM_REMOVE, ctx.key(), result);
+  }
+  delContexts.destroyContext(ctx);
+  if (status == navy::Status::Ok || status == navy::Status::NotFound) {
+    return;
+  }
+  // we set disable navy since we failed to delete something
+  disableNavy(folly::sformat("Delete Failure. status = {}",
+                             static_cast<int>(status)));
+}
+
 template <typename C>
 typename NvmCache<C>::SampleItem NvmCache<C>::getSampleItem() {
   navy::Buffer value;
@@ -1335,7 +2159,13 @@ typename NvmCache<C>::SampleItem NvmCache<C>::getSampleItem() {
 
   folly::StringPiece key(keyStr);
 
-  const auto& nvmItem = *reinterpret_cast<const NvmItem*>(value.data());
+  std::unique_ptr<NvmItem> decompressed;
+  const auto* nvmItemPtr = decompressNvmItem(
+      *reinterpret_cast<const NvmItem*>(value.data()), decompressed);
+  if (!nvmItemPtr) {
+    return SampleItem{true /* fromNvm */};
+  }
+  const auto& nvmItem = *nvmItemPtr;
   const auto requiredSize =
       Item::getRequiredSize(key, nvmItem.getBlob(0).origAllocSize);
 
@@ -1357,6 +2187,7 @@ typename NvmCache<C>::SampleItem NvmCache<C>::getSampleItem() {
 template <typename C>
 bool NvmCache<C>::shutDown() {
   navyEnabled_ = false;
+  waitForRecovery();
   try {
     this->flushPendingOps();
     navyCache_->persist();
@@ -1376,8 +2207,22 @@ void NvmCache<C>::flushPendingOps() {
 template <typename C>
 util::StatsMap NvmCache<C>::getStatsMap() const {
   util::StatsMap statsMap;
-  navyCache_->getCounters(statsMap.createCountVisitor());
+  // navy is not safe to inspect while being recovered
+  if (!isRecovering()) {
+    navyCache_->getCounters(statsMap.createCountVisitor());
+  }
+  statsMap.insertCount("nvm_recovering", isRecovering() ? 1 : 0);
   statsMap.insertCount("items_tracked_for_destructor", getNvmItemRemovedSize());
+  if (config_.lookupTraceSampleRate > 0) {
+    for (uint8_t i = navy::LookupTrace::kEnqueued;
+         i < navy::LookupTrace::kNumStages; i++) {
+      lookupStageLatency_[i].visitQuantileEstimator(
+          statsMap.createCountVisitor(),
+          folly::sformat("nvm_lookup_stage_{}_ns",
+                         navy::LookupTrace::getStageName(
+                             static_cast<navy::LookupTrace::Stage>(i))));
+    }
+  }
   return statsMap;
 }
 
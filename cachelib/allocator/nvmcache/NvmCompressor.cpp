@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/nvmcache/NvmCompressor.h"
+
+#include <folly/compression/Compression.h>
+#include <folly/logging/xlog.h>
+#include <zstd.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <folly/Format.h>
+#pragma GCC diagnostic pop
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace facebook {
+namespace cachelib {
+
+namespace {
+struct ZstdCCtxDeleter {
+  void operator()(ZSTD_CCtx* ctx) const { ZSTD_freeCCtx(ctx); }
+};
+
+struct ZstdDCtxDeleter {
+  void operator()(ZSTD_DCtx* ctx) const { ZSTD_freeDCtx(ctx); }
+};
+
+// zstd contexts are expensive to create and can only be used by one thread
+// at a time.
+ZSTD_CCtx* getZstdCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> ctx{
+      ZSTD_createCCtx()};
+  return ctx.get();
+}
+
+ZSTD_DCtx* getZstdDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> ctx{
+      ZSTD_createDCtx()};
+  return ctx.get();
+}
+
+folly::io::Codec& getLz4Codec() {
+  thread_local auto codec = folly::io::getCodec(folly::io::CodecType::LZ4);
+  return *codec;
+}
+
+const char* getTypeName(NvmCompressor::Type type) {
+  switch (type) {
+  case NvmCompressor::Type::Zstd:
+    return "zstd";
+  case NvmCompressor::Type::Lz4:
+    return "lz4";
+  }
+  return "unknown";
+}
+} // namespace
+
+struct NvmCompressor::ZstdDicts {
+  struct CDictDeleter {
+    void operator()(ZSTD_CDict* dict) const { ZSTD_freeCDict(dict); }
+  };
+  struct DDictDeleter {
+    void operator()(ZSTD_DDict* dict) const { ZSTD_freeDDict(dict); }
+  };
+
+  std::unique_ptr<ZSTD_CDict, CDictDeleter> cdict;
+  std::unique_ptr<ZSTD_DDict, DDictDeleter> ddict;
+};
+
+void NvmCompressor::Config::validate() const {
+  if (type != Type::Zstd && type != Type::Lz4) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid nvm compression type {}", static_cast<int>(type)));
+  }
+  if (type == Type::Zstd &&
+      (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel())) {
+    throw std::invalid_argument(
+        folly::sformat("Invalid zstd compression level {}", level));
+  }
+  if (type != Type::Zstd && !dictionary.empty()) {
+    throw std::invalid_argument(folly::sformat(
+        "Compression dictionaries are only supported for zstd, not {}",
+        getTypeName(type)));
+  }
+  if (minSavingsPct >= 100) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid compression minimum savings {}%", minSavingsPct));
+  }
+}
+
+std::map<std::string, std::string> NvmCompressor::Config::serialize() const {
+  std::map<std::string, std::string> configMap;
+  configMap["type"] = getTypeName(type);
+  configMap["level"] = std::to_string(level);
+  configMap["dictionarySize"] = std::to_string(dictionary.size());
+  configMap["minSize"] = std::to_string(minSize);
+  configMap["minSavingsPct"] = std::to_string(minSavingsPct);
+  return configMap;
+}
+
+NvmCompressor::NvmCompressor(Config config) : config_(std::move(config)) {
+  config_.validate();
+  if (config_.type == Type::Lz4 &&
+      !folly::io::hasCodec(folly::io::CodecType::LZ4)) {
+    throw std::invalid_argument("lz4 is not available for nvm compression");
+  }
+  if (!config_.dictionary.empty()) {
+    zstdDicts_ = std::make_unique<ZstdDicts>();
+    zstdDicts_->cdict.reset(ZSTD_createCDict(config_.dictionary.data(),
+                                             config_.dictionary.size(),
+                                             config_.level));
+    zstdDicts_->ddict.reset(ZSTD_createDDict(config_.dictionary.data(),
+                                             config_.dictionary.size()));
+    if (!zstdDicts_->cdict || !zstdDicts_->ddict) {
+      throw std::invalid_argument(folly::sformat(
+          "Could not load zstd dictionary of {} bytes",
+          config_.dictionary.size()));
+    }
+  }
+}
+
+NvmCompressor::~NvmCompressor() = default;
+
+std::unique_ptr<NvmItem> NvmCompressor::compress(const NvmItem& item) const {
+  XDCHECK(!item.isCompressed());
+  const auto data = item.getData();
+  if (data.size() < config_.minSize) {
+    return nullptr;
+  }
+
+  // compress aside first since the compressed size is only known after.
+  thread_local std::vector<uint8_t> scratch;
+  scratch.resize(compressBound(data.size()));
+  const auto size = compressData(
+      data, folly::MutableByteRange{scratch.data(), scratch.size()});
+  if (size == 0 || size * 100 > data.size() * (100 - config_.minSavingsPct)) {
+    return nullptr;
+  }
+
+  const auto compression = static_cast<uint8_t>(config_.type);
+  const size_t bufSize = NvmItem::estimateVariableSize(item, compression, size);
+  auto compressed =
+      std::unique_ptr<NvmItem>(new (bufSize) NvmItem(item, compression, size));
+  std::memcpy(compressed->getMutableData().data(), scratch.data(), size);
+  return compressed;
+}
+
+std::unique_ptr<NvmItem> NvmCompressor::decompress(const NvmItem& item) const {
+  // written with an algorithm the pool does not use anymore
+  if (item.getCompression() != static_cast<uint8_t>(config_.type)) {
+    return nullptr;
+  }
+
+  const size_t size = item.getDataSize();
+  const size_t bufSize = NvmItem::estimateVariableSize(item, 0, size);
+  auto decompressed =
+      std::unique_ptr<NvmItem>(new (bufSize) NvmItem(item, 0, size));
+  if (!decompressData(item.getData(), decompressed->getMutableData())) {
+    return nullptr;
+  }
+  return decompressed;
+}
+
+size_t NvmCompressor::compressBound(size_t size) const {
+  if (config_.type == Type::Lz4) {
+    return getLz4Codec().maxCompressedLength(size);
+  }
+  return ZSTD_compressBound(size);
+}
+
+size_t NvmCompressor::compressData(folly::ByteRange src,
+                                   folly::MutableByteRange dst) const {
+  if (config_.type == Type::Lz4) {
+    try {
+      const auto out = getLz4Codec().compress(folly::StringPiece{src});
+      if (out.size() > dst.size()) {
+        return 0;
+      }
+      std::memcpy(dst.data(), out.data(), out.size());
+      return out.size();
+    } catch (const std::exception&) {
+      return 0;
+    }
+  }
+
+  const size_t ret =
+      zstdDicts_
+          ? ZSTD_compress_usingCDict(getZstdCCtx(), dst.data(), dst.size(),
+                                     src.data(), src.size(),
+                                     zstdDicts_->cdict.get())
+          : ZSTD_compressCCtx(getZstdCCtx(), dst.data(), dst.size(),
+                              src.data(), src.size(), config_.level);
+  return ZSTD_isError(ret) ? 0 : ret;
+}
+
+bool NvmCompressor::decompressData(folly::ByteRange src,
+                                   folly::MutableByteRange dst) const {
+  if (config_.type == Type::Lz4) {
+    try {
+      const auto out = getLz4Codec().uncompress(
+          folly::StringPiece{src}, static_cast<uint64_t>(dst.size()));
+      if (out.size() != dst.size()) {
+        return false;
+      }
+      std::memcpy(dst.data(), out.data(), out.size());
+      return true;
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  const size_t ret =
+      zstdDicts_
+          ? ZSTD_decompress_usingDDict(getZstdDCtx(), dst.data(), dst.size(),
+                                       src.data(), src.size(),
+                                       zstdDicts_->ddict.get())
+          : ZSTD_decompressDCtx(getZstdDCtx(), dst.data(), dst.size(),
+                                src.data(), src.size());
+  return !ZSTD_isError(ret) && ret == dst.size();
+}
+
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cachelib/allocator/nvmcache/NvmItem.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Compresses the data of the items nvmcache writes to navy, and decompresses
+// it when they are read back. The header of the NvmItem stays uncompressed so
+// that navy can check its expiry. Thread safe.
+class NvmCompressor {
+ public:
+  // the algorithm, recorded in each compressed NvmItem. The values must not
+  // change since they are persisted.
+  enum class Type : uint8_t { Zstd = 1, Lz4 = 2 };
+
+  struct Config {
+    Type type{Type::Zstd};
+
+    // zstd compression level. 0 picks the zstd default.
+    int level{0};
+
+    // (Optional) content of a dictionary trained with `zstd --train` on
+    // sample values. Only for zstd. Items written with a dictionary can only
+    // be read back with the same dictionary, the others read as misses.
+    std::string dictionary{};
+
+    // values whose data is smaller than this are stored uncompressed
+    uint32_t minSize{128};
+
+    // a compressed value is stored only if it is at least this many percent
+    // smaller than the uncompressed one
+    uint32_t minSavingsPct{10};
+
+    // @throw std::invalid_argument if the config is invalid
+    void validate() const;
+
+    // serialize the config for debugging purposes
+    std::map<std::string, std::string> serialize() const;
+  };
+
+  // @throw std::invalid_argument if the config is invalid, the dictionary can
+  //        not be loaded or the algorithm is not available
+  explicit NvmCompressor(Config config);
+  ~NvmCompressor();
+
+  NvmCompressor(const NvmCompressor&) = delete;
+  NvmCompressor& operator=(const NvmCompressor&) = delete;
+
+  // @return a compressed copy of @item, or nullptr if @item is too small or
+  //         does not compress well enough to be worth it
+  std::unique_ptr<NvmItem> compress(const NvmItem& item) const;
+
+  // @return an uncompressed copy of @item, or nullptr if its data could not
+  //         be decompressed
+  std::unique_ptr<NvmItem> decompress(const NvmItem& item) const;
+
+  const Config& getConfig() const noexcept { return config_; }
+
+ private:
+  // compresses @src into @dst, sized to at least compressBound()
+  // @return the compressed size, 0 on failure
+  size_t compressData(folly::ByteRange src, folly::MutableByteRange dst) const;
+
+  // @return true if @src decompressed into exactly @dst
+  bool decompressData(folly::ByteRange src, folly::MutableByteRange dst) const;
+
+  size_t compressBound(size_t size) const;
+
+  const Config config_;
+
+  // zstd dictionaries digested from config_.dictionary, if any
+  struct ZstdDicts;
+  std::unique_ptr<ZstdDicts> zstdDicts_;
+};
+
+} // namespace cachelib
+} // namespace facebook
@@ -20,6 +20,7 @@
 #pragma GCC diagnostic ignored "-Wconversion"
 #include <folly/Format.h>
 #pragma GCC diagnostic pop
+#include <folly/logging/xlog.h>
 
 #include "cachelib/common/Time.h"
 
@@ -31,6 +32,10 @@ Blob NvmItem::getBlob(size_t index) const {
     throw std::invalid_argument(
         folly::sformat("Index {} out of range {}", index, numBlobs_));
   }
+  if (isCompressed()) {
+    throw std::invalid_argument(
+        folly::sformat("Blob {} of compressed item", index));
+  }
 
   const auto& blobInfo = getBlobInfo(index);
   const size_t begin = index == 0 ? 0 : getBlobInfo(index - 1).endOffset;
@@ -43,8 +48,10 @@ Blob NvmItem::getBlob(size_t index) const {
 NvmItem::NvmItem(PoolId id,
                  uint32_t creationTime,
                  uint32_t expTime,
-                 const std::vector<Blob>& blobs)
+                 const std::vector<Blob>& blobs,
+                 bool largeItem)
     : id_(id),
+      flags_(largeItem ? kLargeItemFlag : 0),
       creationTime_(creationTime),
       expTime_(expTime),
       numBlobs_(blobs.size()) {
@@ -83,6 +90,25 @@ NvmItem::NvmItem(PoolId id, uint32_t creationTime, uint32_t expTime, Blob blob)
   blobInfo.endOffset = static_cast<uint32_t>(blob.data.size());
 }
 
+NvmItem::NvmItem(const NvmItem& other, uint8_t compression, size_t dataSize)
+    : id_(other.id_),
+      flags_(static_cast<uint8_t>((compression & kCompressionMask) |
+                                  (other.flags_ & kLargeItemFlag))),
+      creationTime_(other.creationTime_),
+      expTime_(other.expTime_),
+      numBlobs_(other.numBlobs_) {
+  if (dataSize > std::numeric_limits<uint32_t>::max()) {
+    throw std::out_of_range(
+        folly::sformat("data is too big. size {}", dataSize));
+  }
+  XDCHECK(compression != 0 || dataSize == other.getDataSize());
+  std::memcpy(data_, other.data_, numBlobs_ * sizeof(BlobInfo));
+  if (compression != 0) {
+    const auto size = static_cast<uint32_t>(dataSize);
+    std::memcpy(data_ + numBlobs_ * sizeof(BlobInfo), &size, sizeof(size));
+  }
+}
+
 void* NvmItem::operator new(size_t count, size_t extra) {
   void* alloc = malloc(count + extra);
   if (alloc == nullptr) {
@@ -100,7 +126,7 @@ void NvmItem::operator delete(void* p, size_t) { operator delete(p); }
 size_t NvmItem::totalSize() const noexcept {
   // size of sizes + size of all blobs
   return sizeof(NvmItem) + numBlobs_ * sizeof(BlobInfo) +
-         getBlobInfo(numBlobs_ - 1).endOffset;
+         getCompressedHeaderSize(getCompression()) + getStoredDataSize();
 }
 
 size_t NvmItem::estimateVariableSize(const std::vector<Blob>& blobs) {
@@ -115,6 +141,13 @@ size_t NvmItem::estimateVariableSize(Blob blob) {
   return sizeof(BlobInfo) + blob.data.size();
 }
 
+size_t NvmItem::estimateVariableSize(const NvmItem& other,
+                                     uint8_t compression,
+                                     size_t dataSize) {
+  return other.numBlobs_ * sizeof(BlobInfo) +
+         getCompressedHeaderSize(compression) + dataSize;
+}
+
 bool NvmItem::isExpired() const noexcept {
   return expTime_ > 0 &&
          expTime_ < static_cast<uint32_t>(util::getCurrentTimeSec());
@@ -20,6 +20,8 @@
 #include <folly/Range.h>
 #include <folly/io/IOBuf.h>
 
+#include <cstring>
+
 #include "cachelib/allocator/memory/Slab.h"
 namespace facebook {
 namespace cachelib {
@@ -44,12 +46,15 @@ class FOLLY_PACK_ATTR NvmItem {
   // @param id            pool id for the original item
   // @param creationTime  creation time for the item in cache
   // @param blobs         vector of blobs
+  // @param largeItem     whether the item is the parent of a large item,
+  //                      whose chained items are its chunks
   //
   // @throw std::out_of_range if the total size of the blobs exceeds 4GB.
   NvmItem(PoolId id,
           uint32_t creationTime,
           uint32_t expTime,
-          const std::vector<Blob>& blobs);
+          const std::vector<Blob>& blobs,
+          bool largeItem = false);
 
   //  same as the above, but handles for a single blob without having to
   //  instantiate a vector
@@ -57,6 +62,14 @@ class FOLLY_PACK_ATTR NvmItem {
   // @throw std::out_of_range if the total size of blob exceeds 4GB.
   NvmItem(PoolId id, uint32_t creationTime, uint32_t expTime, Blob blob);
 
+  // constructs a nvm item with the same pool, times and blobs as @other,
+  // whose data is stored in @dataSize bytes encoded with @compression. The
+  // caller fills the data through getMutableData(). @compression 0 means the
+  // data is stored as is and must then be as large as the data of @other.
+  //
+  // @throw std::out_of_range if @dataSize exceeds 4GB.
+  NvmItem(const NvmItem& other, uint8_t compression, size_t dataSize);
+
   // A custom new that allocates NvmItem with extra
   // bytes space at the end for data
   static void* operator new(size_t count, size_t extra);
@@ -88,9 +101,33 @@ class FOLLY_PACK_ATTR NvmItem {
 
   // get the blob at index. index starts from 0 up to numBlobs - 1
   //
-  // @throw std::invalid_argument if the index is out of range.
+  // @throw std::invalid_argument if the index is out of range or the item is
+  //        compressed.
   Blob getBlob(size_t index) const;
 
+  // @return the compression of the data of the blobs. 0 if not compressed.
+  uint8_t getCompression() const noexcept { return flags_ & kCompressionMask; }
+
+  bool isCompressed() const noexcept { return getCompression() != 0; }
+
+  // @return true if the item was the parent of a large item
+  bool isLargeItem() const noexcept { return flags_ & kLargeItemFlag; }
+
+  // @return the size of the data of all the blobs once uncompressed
+  size_t getDataSize() const noexcept {
+    return getBlobInfo(numBlobs_ - 1).endOffset;
+  }
+
+  // @return the data of all the blobs as stored, compressed or not.
+  folly::ByteRange getData() const noexcept {
+    return {reinterpret_cast<const uint8_t*>(getDataCBegin()),
+            getStoredDataSize()};
+  }
+
+  folly::MutableByteRange getMutableData() noexcept {
+    return {reinterpret_cast<uint8_t*>(getDataBegin()), getStoredDataSize()};
+  }
+
   // return true if the item is expired
   bool isExpired() const noexcept;
 
@@ -105,10 +142,40 @@ class FOLLY_PACK_ATTR NvmItem {
   // estimate the additional  malloc size for a vector of blobs
   static size_t estimateVariableSize(const std::vector<Blob>& blobs);
 
+  // estimate the additional malloc size for a copy of @other with @dataSize
+  // bytes of data encoded with @compression.
+  static size_t estimateVariableSize(const NvmItem& other,
+                                     uint8_t compression,
+                                     size_t dataSize);
+
+  // the bits of the flags holding the compression of the data
+  static constexpr uint8_t kCompressionMask = 0x3;
+
+  // the bit of the flags marking the parent of a large item
+  static constexpr uint8_t kLargeItemFlag = 0x4;
+
  private:
+  // size of the header preceding the data of compressed items
+  static size_t getCompressedHeaderSize(uint8_t compression) noexcept {
+    return compression != 0 ? sizeof(uint32_t) : 0;
+  }
+
   // returns the pointer to the beginning of the blob array.
   const char* getDataCBegin() const {
-    return reinterpret_cast<const char*>(data_ + numBlobs_ * sizeof(BlobInfo));
+    return reinterpret_cast<const char*>(
+        data_ + numBlobs_ * sizeof(BlobInfo) +
+        getCompressedHeaderSize(getCompression()));
+  }
+
+  // size of the data as stored. For compressed items, it is recorded right
+  // after the blob infos.
+  size_t getStoredDataSize() const noexcept {
+    if (!isCompressed()) {
+      return getDataSize();
+    }
+    uint32_t size;
+    std::memcpy(&size, data_ + numBlobs_ * sizeof(BlobInfo), sizeof(size));
+    return size;
   }
 
   char* getDataBegin() { return const_cast<char*>(getDataCBegin()); }
@@ -137,6 +204,7 @@ class FOLLY_PACK_ATTR NvmItem {
    * .
    * .
    * BlobInfo[numBlobs_ - 1]
+   * compressed data size (uint32_t, only if compressed)
    * Blobs[0]
    * .
    * .
@@ -149,7 +217,8 @@ class FOLLY_PACK_ATTR NvmItem {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-private-field"
 #endif
-  const uint8_t flags_ = 0; // flags for the item. Currently unused.
+  // flags for the item. Holds the compression and the large item bit.
+  const uint8_t flags_ = 0;
 #if defined(__clang__)
 #pragma clang diagnostic pop
 #endif
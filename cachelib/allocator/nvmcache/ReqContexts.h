@@ -59,16 +59,20 @@ class PutCtx {
 // Holds all necessary data to do an async nvm remove
 class DelCtx {
  public:
-  DelCtx(folly::StringPiece,
+  DelCtx(folly::StringPiece _key,
          util::LatencyTracker tracker,
          TombStones::Guard tombstone)
-      : tracker_(std::move(tracker)), tombstone_(std::move(tombstone)) {}
+      : key_(_key.toString()),
+        tracker_(std::move(tracker)),
+        tombstone_(std::move(tombstone)) {}
 
-  folly::StringPiece key() const { return tombstone_.key(); }
+  // @return   key as StringPiece
+  folly::StringPiece key() const { return {key_.data(), key_.length()}; }
 
   static folly::StringPiece type() { return "del ctx"; }
 
  private:
+  std::string key_; //< key to remove
   //< tracking latency of the put operation
   util::LatencyTracker tracker_;
 
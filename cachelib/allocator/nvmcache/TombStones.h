@@ -20,8 +20,11 @@
 #include <folly/lang/Align.h>
 #include <glog/logging.h>
 
+#include <array>
+#include <atomic>
 #include <utility>
 
+#include "cachelib/common/Hash.h"
 #include "folly/Range.h"
 
 namespace facebook {
@@ -32,31 +35,83 @@ using folly::fibers::TimedMutex;
 // Utility that helps us track in flight deletes. We maintain a count per key
 // and check for presence against the count to resolve multiple concurrent
 // deletes for the same key in flight.
+//
+// The counts are kept in a small fixed-size open-addressed table of key
+// hashes, probed over a bounded window and updated without locks. Keys that
+// do not find a slot in their window fall back to a map under a mutex. Two
+// keys sharing a hash tag are treated as the same key, which at worst reports
+// a tombstone for a key that has none.
 class alignas(folly::hardware_destructive_interference_size) TombStones {
  public:
   class Guard;
 
+  // number of slots of the table and how many of them a key probes
+  static constexpr uint32_t kNumSlots = 32;
+  static constexpr uint32_t kMaxProbe = 8;
+
+  TombStones() = default;
+  TombStones(const TombStones&) = delete;
+  TombStones& operator=(const TombStones&) = delete;
+
   // adds an instance of  key
-  // @param key  key for the record
+  // @param hk  key for the record
   // @return a valid Guard representing the tombstone
-  Guard add(folly::StringPiece key) {
-    std::lock_guard<TimedMutex> l(mutex_);
-    auto it = keys_.find(key);
+  Guard add(HashedKey hk) {
+    const auto tag = getTag(hk.keyHash());
+    uint32_t freeSlot = kNumSlots;
+    for (uint32_t i = 0; i < kMaxProbe; i++) {
+      const auto idx = getSlot(hk.keyHash(), i);
+      auto val = slots_[idx].load(std::memory_order_acquire);
+      while (getCount(val) != 0 && getCount(val) != kMaxCount &&
+             (val & ~kCountMask) == tag) {
+        if (slots_[idx].compare_exchange_weak(val, val + 1,
+                                              std::memory_order_acq_rel)) {
+          return Guard(tag, idx, *this);
+        }
+      }
+      if (getCount(val) == 0 && freeSlot == kNumSlots) {
+        freeSlot = idx;
+      }
+    }
 
-    if (it == keys_.end()) {
-      it = keys_.insert(std::make_pair(key.toString(), 0)).first;
+    // another add for the same key can take a different free slot. Both are
+    // counted by isPresent.
+    if (freeSlot != kNumSlots) {
+      uint64_t expected = slots_[freeSlot].load(std::memory_order_acquire);
+      if (getCount(expected) == 0 &&
+          slots_[freeSlot].compare_exchange_strong(
+              expected, tag | 1, std::memory_order_acq_rel)) {
+        return Guard(tag, freeSlot, *this);
+      }
     }
 
-    ++it->second;
-    return Guard(it->first, *this);
+    std::lock_guard<TimedMutex> l(mutex_);
+    ++overflowKeys_[tag];
+    numOverflow_.fetch_add(1, std::memory_order_acq_rel);
+    return Guard(tag, kNumSlots, *this);
   }
 
+  Guard add(folly::StringPiece key) { return add(HashedKey{key}); }
+
   // checks if there is a key present and returns true if so.
-  bool isPresent(folly::StringPiece key) {
+  bool isPresent(HashedKey hk) {
+    const auto tag = getTag(hk.keyHash());
+    for (uint32_t i = 0; i < kMaxProbe; i++) {
+      const auto val =
+          slots_[getSlot(hk.keyHash(), i)].load(std::memory_order_acquire);
+      if (getCount(val) != 0 && (val & ~kCountMask) == tag) {
+        return true;
+      }
+    }
+    if (numOverflow_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
     std::lock_guard<TimedMutex> l(mutex_);
-    return keys_.count(key) != 0;
+    return overflowKeys_.count(tag) != 0;
   }
 
+  bool isPresent(folly::StringPiece key) { return isPresent(HashedKey{key}); }
+
   // Guard that wraps around the tombstone record. Removes the key from the
   // tombstone records upon destruction. A valid guard can be only created by
   // adding to the tombstone record.
@@ -65,7 +120,7 @@ class alignas(folly::hardware_destructive_interference_size) TombStones {
     Guard() {}
     ~Guard() {
       if (tombstones_) {
-        tombstones_->remove(key_);
+        tombstones_->remove(tag_, slot_);
         tombstones_ = nullptr;
       }
     }
@@ -76,7 +131,7 @@ class alignas(folly::hardware_destructive_interference_size) TombStones {
 
     // allow moving
     Guard(Guard&& other) noexcept
-        : key_{std::move(other.key_)}, tombstones_(other.tombstones_) {
+        : tag_{other.tag_}, slot_{other.slot_}, tombstones_(other.tombstones_) {
       other.tombstones_ = nullptr;
     }
     Guard& operator=(Guard&& other) noexcept {
@@ -87,43 +142,80 @@ class alignas(folly::hardware_destructive_interference_size) TombStones {
       return *this;
     }
 
-    folly::StringPiece key() const noexcept { return key_; }
-
     explicit operator bool() const noexcept { return tombstones_ != nullptr; }
 
    private:
     // only tombstone can create a guard.
     friend TombStones;
-    Guard(folly::StringPiece key, TombStones& t) noexcept
-        : key_(key), tombstones_(&t) {}
+    Guard(uint64_t tag, uint32_t slot, TombStones& t) noexcept
+        : tag_(tag), slot_(slot), tombstones_(&t) {}
 
-    // key for the tombstone
-    folly::StringPiece key_;
+    // key hash tag for the tombstone
+    uint64_t tag_{0};
+
+    // slot of the table counting the tombstone. kNumSlots for the overflow
+    // map.
+    uint32_t slot_{0};
 
     // tombstone record
     TombStones* tombstones_{nullptr};
   };
 
  private:
-  // removes an instance of key. if the count drops to 0, we remove the key
-  void remove(folly::StringPiece key) {
+  // the low bits of a slot count the tombstones of the key. The high bits
+  // are the tag of the key hash. A slot with a count of 0 is free.
+  static constexpr uint64_t kCountMask = (1ULL << 16) - 1;
+  static constexpr uint64_t kMaxCount = kCountMask;
+
+  static uint64_t getTag(uint64_t keyHash) noexcept {
+    return keyHash & ~kCountMask;
+  }
+
+  static uint64_t getCount(uint64_t val) noexcept { return val & kCountMask; }
+
+  // the low bits of the hash pick the shard, so probe with the high bits.
+  static uint32_t getSlot(uint64_t keyHash, uint32_t probe) noexcept {
+    return static_cast<uint32_t>((keyHash >> 32) + probe) & (kNumSlots - 1);
+  }
+
+  // removes an instance of key. if the count drops to 0, we free the slot
+  void remove(uint64_t tag, uint32_t slot) {
+    if (slot != kNumSlots) {
+      const auto val = slots_[slot].fetch_sub(1, std::memory_order_acq_rel);
+      // this is not supposed to happen if guards are destroyed appropriately
+      if ((val & ~kCountMask) != tag || getCount(val) == 0) {
+        throw std::runtime_error(
+            fmt::format("Invalid state. Tag: {}. Slot: {}. Count: {}", tag,
+                        slot, getCount(val)));
+      }
+      return;
+    }
+
     std::lock_guard<TimedMutex> l(mutex_);
-    auto it = keys_.find(key);
-    if (it == keys_.end() || it->second == 0) {
+    auto it = overflowKeys_.find(tag);
+    if (it == overflowKeys_.end() || it->second == 0) {
       // this is not supposed to happen if guards are destroyed appropriately
-      throw std::runtime_error(fmt::format(
-          "Invalid state. Key: {}. State: {}", key,
-          it == keys_.end() ? "does not exist" : "exists, but count is 0"));
+      throw std::runtime_error(
+          fmt::format("Invalid state. Tag: {}. State: {}", tag,
+                      it == overflowKeys_.end() ? "does not exist"
+                                                : "exists, but count is 0"));
     }
 
     if (--(it->second) == 0) {
-      keys_.erase(it);
+      overflowKeys_.erase(it);
     }
+    numOverflow_.fetch_sub(1, std::memory_order_acq_rel);
   }
 
-  // mutex protecting the map below
+  // tombstone counts by key hash tag
+  std::array<std::atomic<uint64_t>, kNumSlots> slots_{};
+
+  // number of tombstones in the overflow map
+  std::atomic<uint64_t> numOverflow_{0};
+
+  // mutex protecting the overflow map below
   TimedMutex mutex_;
-  folly::F14NodeMap<std::string, uint64_t> keys_;
+  folly::F14FastMap<uint64_t, uint64_t> overflowKeys_;
 };
 
 } // namespace cachelib
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Bits.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace facebook {
+namespace cachelib {
+
+// Decides which items found in navy are inserted into DRAM while the cache
+// warms up: only those whose key was already found in navy within a window.
+//
+// The filter is a fixed array of 64-bit slots, each holding a 32-bit
+// fingerprint of the last key hash seen in the slot and the time it was seen
+// in seconds. All operations are lock free. Keys sharing a slot push each
+// other out, which only delays their promotion, and keys sharing a slot and a
+// fingerprint are promoted on the first hit of the second key.
+class WarmUpPromotionFilter {
+ public:
+  // @param numEntries  number of keys to remember, rounded up to a power of
+  //                    two
+  // @param windowSecs  a key is promoted if it was seen at most this long
+  //                    ago
+  //
+  // @throw std::invalid_argument if numEntries or windowSecs is 0
+  WarmUpPromotionFilter(size_t numEntries, uint32_t windowSecs)
+      : numSlots_{numEntries == 0 ? 0 : folly::nextPowTwo(numEntries)},
+        windowSecs_{windowSecs},
+        slots_{std::make_unique<std::atomic<uint64_t>[]>(numSlots_)} {
+    if (numEntries == 0 || windowSecs == 0) {
+      throw std::invalid_argument(
+          "Warm up promotion filter needs at least one entry and a window");
+    }
+  }
+
+  WarmUpPromotionFilter(const WarmUpPromotionFilter&) = delete;
+  WarmUpPromotionFilter& operator=(const WarmUpPromotionFilter&) = delete;
+
+  // Records that the key hash was found in navy at @nowSecs.
+  //
+  // @return true if the key hash was already found within the window, in
+  //         which case its item should be inserted into DRAM.
+  bool recordHit(uint64_t keyHash, uint32_t nowSecs) noexcept {
+    const auto fp = fingerprint(keyHash);
+    const auto old = slots_[keyHash & (numSlots_ - 1)].exchange(
+        (static_cast<uint64_t>(fp) << 32) | nowSecs,
+        std::memory_order_relaxed);
+    if (static_cast<uint32_t>(old >> 32) != fp) {
+      return false;
+    }
+    const auto seenSecs = static_cast<uint32_t>(old);
+    return nowSecs >= seenSecs && nowSecs - seenSecs <= windowSecs_;
+  }
+
+  // @return the max number of keys remembered
+  size_t getCapacity() const noexcept { return numSlots_; }
+
+ private:
+  // fingerprint from the high bits since the low bits pick the slot. 0 marks
+  // an empty slot.
+  static uint32_t fingerprint(uint64_t keyHash) noexcept {
+    const auto fp = static_cast<uint32_t>(keyHash >> 32);
+    return fp == 0 ? 1 : fp;
+  }
+
+  const size_t numSlots_;
+  const uint32_t windowSecs_;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+} // namespace cachelib
+} // namespace facebook
@@ -28,7 +28,7 @@ namespace tests {
 
 TEST(InFlightPutsTest, FunctionExecution) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
   auto token = *p.tryAcquireToken(key, []() { return true; });
   ASSERT_TRUE(token.isValid());
 
@@ -44,9 +44,25 @@ TEST(InFlightPutsTest, FunctionExecution) {
   ASSERT_FALSE(executed);
 }
 
+TEST(InFlightPutsTest, IsPresent) {
+  InFlightPuts p;
+  HashedKey key{"foobar"};
+  ASSERT_FALSE(p.isPresent(key));
+  {
+    auto token = *p.tryAcquireToken(key, []() { return true; });
+    ASSERT_TRUE(p.isPresent(key));
+    ASSERT_FALSE(p.isPresent(HashedKey{"other"}));
+
+    // still present until the token goes away
+    p.invalidateToken(key);
+    ASSERT_TRUE(p.isPresent(key));
+  }
+  ASSERT_FALSE(p.isPresent(key));
+}
+
 TEST(InFlightPutsTest, TokenMove) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
   {
     auto token = *p.tryAcquireToken(key, []() { return true; });
     ASSERT_TRUE(token.isValid());
@@ -67,7 +83,7 @@ TEST(InFlightPutsTest, TokenMove) {
 
 TEST(InFlightPutsTest, FunctionException) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
   auto token = *p.tryAcquireToken(key, []() { return true; });
   ASSERT_TRUE(token.isValid());
 
@@ -87,7 +103,7 @@ TEST(InFlightPutsTest, FunctionException) {
 
 TEST(InFlightPutsTest, Collision) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
   {
     auto token = *p.tryAcquireToken(key, []() { return true; });
     ASSERT_TRUE(token.isValid());
@@ -104,7 +120,7 @@ TEST(InFlightPutsTest, Collision) {
 
 TEST(InFlightPutsTest, InvalidationSimple) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
 
   auto token = *p.tryAcquireToken(key, []() { return true; });
   ASSERT_TRUE(token.isValid());
@@ -129,7 +145,7 @@ TEST(InFlightPutsTest, InvalidationSimple) {
 // token is desrtroyed
 TEST(InFlightPutsTest, InvalidationAndCreate) {
   InFlightPuts p;
-  folly::StringPiece key = "foobar";
+  HashedKey key{"foobar"};
 
   bool executed = false;
   auto fn = [&]() { executed = true; };
@@ -158,6 +174,37 @@ TEST(InFlightPutsTest, InvalidationAndCreate) {
   ASSERT_TRUE(token.executeIfValid(fn));
   ASSERT_TRUE(executed);
 }
+
+// keys whose probe windows are full fail to acquire a token until one of the
+// tokens of the window is released.
+TEST(InFlightPutsTest, TableFull) {
+  InFlightPuts p;
+  // same high bits to share the probe window, different tags.
+  auto makeKey = [](uint64_t i) {
+    return HashedKey::precomputed("foobar", i << 2);
+  };
+
+  std::vector<InFlightPuts::PutToken> tokens;
+  for (uint64_t i = 0; i < InFlightPuts::kMaxProbe; i++) {
+    auto tokenRv = p.tryAcquireToken(makeKey(i), []() { return true; });
+    ASSERT_TRUE(tokenRv.hasValue());
+    tokens.push_back(std::move(*tokenRv));
+  }
+
+  const auto key = makeKey(InFlightPuts::kMaxProbe);
+  auto tokenRv = p.tryAcquireToken(key, []() { return true; });
+  ASSERT_TRUE(tokenRv.hasError());
+  ASSERT_EQ(tokenRv.error(), InFlightPuts::PutTokenError::TABLE_FULL);
+
+  // invalidating a key that has no token leaves the others alone.
+  p.invalidateToken(key);
+  bool executed = false;
+  ASSERT_TRUE(tokens.back().executeIfValid([&]() { executed = true; }));
+  ASSERT_TRUE(executed);
+
+  auto token = *p.tryAcquireToken(key, []() { return true; });
+  ASSERT_TRUE(token.isValid());
+}
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
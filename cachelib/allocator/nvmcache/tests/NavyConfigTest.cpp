@@ -21,7 +21,7 @@
 
 #include "cachelib/allocator/nvmcache/BlockCacheReinsertionPolicy.h"
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
-#include "cachelib/navy/block_cache/Index.h"
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
 
 namespace facebook {
 namespace cachelib {
@@ -140,6 +140,7 @@ TEST(NavyConfigTest, DefaultVal) {
 
   const auto& blockCacheConfig = config.blockCache();
   EXPECT_EQ(blockCacheConfig.isLruEnabled(), true);
+  EXPECT_EQ(blockCacheConfig.isHitDensityEnabled(), false);
   EXPECT_EQ(blockCacheConfig.getRegionSize(), 16 * 1024 * 1024);
   EXPECT_EQ(blockCacheConfig.getCleanRegions(), 1);
   EXPECT_EQ(blockCacheConfig.getCleanRegionThreads(), 1);
@@ -154,6 +155,7 @@ TEST(NavyConfigTest, DefaultVal) {
 
   EXPECT_EQ(config.getMaxConcurrentInserts(), 1'000'000);
   EXPECT_EQ(config.getMaxParcelMemoryMB(), 256);
+  EXPECT_EQ(config.getInflightTrackingShards(), 1024);
 
   EXPECT_EQ(config.getReaderThreads(), 32);
   EXPECT_EQ(config.getWriterThreads(), 32);
@@ -194,32 +196,73 @@ TEST(NavyConfigTest, Serialization) {
   expectedConfigMap["navyConfig::ioEngine"] = "io_uring";
   expectedConfigMap["navyConfig::QDepth"] = "64";
   expectedConfigMap["navyConfig::enableFDP"] = "0";
+  expectedConfigMap["navyConfig::ioUringRegisteredBufferSize"] = "0";
+  expectedConfigMap["navyConfig::ioCompletionPollUs"] = "0";
+  expectedConfigMap["navyConfig::ioThreadCpus"] = "";
+  expectedConfigMap["navyConfig::nvmePassthrough"] = "0";
+  expectedConfigMap["navyConfig::qDepthPerFile"] = "0";
+  expectedConfigMap["navyConfig::qDepthTargetLatencyUs"] = "0";
+  expectedConfigMap["navyConfig::batchWriteChunks"] = "0";
+  expectedConfigMap["navyConfig::subPageReads"] = "false";
 
   expectedConfigMap["navyConfig::blockCacheLru"] = "false";
+  expectedConfigMap["navyConfig::blockCacheHitDensity"] = "false";
   expectedConfigMap["navyConfig::blockCacheRegionSize"] = "16777216";
   expectedConfigMap["navyConfig::blockCacheCleanRegions"] = "4";
   expectedConfigMap["navyConfig::blockCacheCleanRegionThreads"] = "1";
+  expectedConfigMap["navyConfig::blockCacheMaxCleanRegions"] = "0";
+  expectedConfigMap["navyConfig::blockCacheReadPageCacheSize"] = "0";
+  expectedConfigMap["navyConfig::blockCacheFlushedRegionCacheSize"] = "0";
   expectedConfigMap["navyConfig::blockCacheReinsertionHitsThreshold"] = "111";
   expectedConfigMap["navyConfig::blockCacheReinsertionPctThreshold"] = "0";
+  expectedConfigMap["navyConfig::blockCacheReinsertionReuseThreshold"] = "0";
+  expectedConfigMap["navyConfig::blockCacheReinsertionReuseMaxBytesPerSec"] =
+      "0";
   expectedConfigMap["navyConfig::blockCacheNumInMemBuffers"] = "8";
+  expectedConfigMap["navyConfig::blockCacheStreamSizeLimits"] = "";
+  expectedConfigMap["navyConfig::blockCacheBands"] = "";
   expectedConfigMap["navyConfig::blockCacheDataChecksum"] = "true";
+  expectedConfigMap["navyConfig::blockCacheLookupChecksumPct"] = "100";
   expectedConfigMap["navyConfig::blockCacheSegmentedFifoSegmentRatio"] =
       "111,222,333";
+  expectedConfigMap["navyConfig::blockCacheFixedSizeIndexItems"] = "0";
+  expectedConfigMap["navyConfig::blockCachePackedEntryAlignSize"] = "0";
+  expectedConfigMap["navyConfig::blockCachePlacementByPriority"] = "0";
+  expectedConfigMap["navyConfig::blockCacheIndexCheckpointFile"] = "";
+  expectedConfigMap["navyConfig::blockCacheIndexCheckpointInterval"] = "0";
+  expectedConfigMap["navyConfig::blockCacheLazyIndexRecovery"] = "0";
+  expectedConfigMap["navyConfig::blockCacheIndexRecoveryThreads"] = "4";
+  expectedConfigMap["navyConfig::blockCacheFlatIndexPersistence"] = "0";
 
   expectedConfigMap["navyConfig::bigHashSizePct"] = "50";
   expectedConfigMap["navyConfig::bigHashBucketSize"] = "1024";
   expectedConfigMap["navyConfig::bigHashBucketBfSize"] = "4";
   expectedConfigMap["navyConfig::bigHashSmallItemMaxSize"] = "512";
+  expectedConfigMap["navyConfig::bigHashBlockedBloomFilter"] = "false";
+  expectedConfigMap["navyConfig::bigHashTwoChoiceHashing"] = "false";
+  expectedConfigMap["navyConfig::bigHashWriteBatchSize"] = "0";
+  expectedConfigMap["navyConfig::bigHashStagingMemoryMB"] = "0";
+  expectedConfigMap["navyConfig::bigHashBucketCacheSize"] = "0";
+  expectedConfigMap["navyConfig::bigHashRecoveryThreads"] = "4";
+  expectedConfigMap["navyConfig::bigHashLogSizePct"] = "0";
+  expectedConfigMap["navyConfig::bigHashLogSegmentSize"] = "262144";
+  expectedConfigMap["navyConfig::bigHashLogMoveThreshold"] = "1";
 
   expectedConfigMap["navyConfig::maxConcurrentInserts"] = "50000";
   expectedConfigMap["navyConfig::maxParcelMemoryMB"] = "512";
+  expectedConfigMap["navyConfig::inflightTrackingShards"] = "1024";
+  expectedConfigMap["navyConfig::sizeAdvisorSampleRate"] = "0";
+  expectedConfigMap["navyConfig::poolEnginePairs"] = "";
 
   expectedConfigMap["navyConfig::readerThreads"] = "40";
   expectedConfigMap["navyConfig::writerThreads"] = "40";
   expectedConfigMap["navyConfig::navyReqOrderingShards"] = "30";
+  expectedConfigMap["navyConfig::workStealing"] = "0";
   expectedConfigMap["navyConfig::maxNumReads"] = "0";
   expectedConfigMap["navyConfig::maxNumWrites"] = "0";
   expectedConfigMap["navyConfig::stackSize"] = "0";
+  expectedConfigMap["navyConfig::maxPooledFibers"] = "0";
+  expectedConfigMap["navyConfig::keyAffinityCpus"] = "";
 
   EXPECT_EQ(configMap, expectedConfigMap);
 }
@@ -309,6 +352,21 @@ TEST(NavyConfigTest, Device) {
     EXPECT_EQ(config.getIoEngine(), navy::IoEngine::IoUring);
     EXPECT_EQ(config.getQDepth(), 64);
   }
+  {
+    // set io budget
+    NavyConfig config{};
+    EXPECT_FALSE(config.getIoBudget().isEnabled());
+    navy::IoBudgetConfig ioBudget;
+    ioBudget.bytesPerSec = 1024 * 1024 * 1024;
+    ioBudget.reclaimReadShare = 0;
+    EXPECT_THROW(config.setIoBudget(ioBudget), std::invalid_argument);
+    ioBudget.reclaimReadShare = 2;
+    config.setIoBudget(ioBudget);
+    EXPECT_TRUE(config.getIoBudget().isEnabled());
+    EXPECT_EQ(config.getIoBudget().reclaimReadShare, 2);
+    EXPECT_EQ(config.serialize()["navyConfig::ioBudgetShares"],
+              "user_read:4,flush:2,reclaim_read:2,reinsertion:1");
+  }
 }
 
 TEST(NavyConfigTest, BlockCache) {
@@ -324,9 +382,14 @@ TEST(NavyConfigTest, BlockCache) {
             blockCacheCleanRegions * 2);
   EXPECT_EQ(config.blockCache().getDataChecksum(), blockCacheDataChecksum);
 
+  // test hit density eviction policy
+  config.blockCache().enableHitDensity();
+  EXPECT_EQ(config.blockCache().isLruEnabled(), false);
+  EXPECT_EQ(config.blockCache().isHitDensityEnabled(), true);
   // test FIFO eviction policy
   config.blockCache().enableFifo();
   EXPECT_EQ(config.blockCache().isLruEnabled(), false);
+  EXPECT_EQ(config.blockCache().isHitDensityEnabled(), false);
   EXPECT_TRUE(config.blockCache().getSFifoSegmentRatio().empty());
   // test segmented FIFO eviction policy
   config.blockCache().enableSegmentedFifo(blockCacheSegmentedFifoSegmentRatio);
@@ -336,7 +399,7 @@ TEST(NavyConfigTest, BlockCache) {
 
   auto customPolicy = std::make_shared<DummyReinsertionPolicy>();
 
-  navy::Index index;
+  navy::SparseMapIndex index;
 
   // test cannot enable both hits-based and probability-based reinsertion policy
   config = NavyConfig{};
@@ -371,6 +434,23 @@ TEST(NavyConfigTest, BlockCache) {
   EXPECT_THROW(config.blockCache().enablePctBasedReinsertion(200),
                std::invalid_argument);
 
+  // test reuse based reinsertion policy
+  config = NavyConfig{};
+  EXPECT_THROW(config.blockCache().enableReuseBasedReinsertion(0),
+               std::invalid_argument);
+  config.blockCache().enableReuseBasedReinsertion(2, 1024 * 1024);
+  EXPECT_EQ(config.blockCache().getReinsertionConfig().getReuseThreshold(), 2);
+  EXPECT_EQ(
+      config.blockCache().getReinsertionConfig().getReuseMaxBytesPerSec(),
+      1024 * 1024);
+  EXPECT_THROW(config.blockCache().enablePctBasedReinsertion(50),
+               std::invalid_argument);
+  EXPECT_THROW(config.blockCache().enableHitsBasedReinsertion(
+                   blockCacheReinsertionHitsThreshold),
+               std::invalid_argument);
+  EXPECT_THROW(config.blockCache().enableCustomReinsertion(customPolicy),
+               std::invalid_argument);
+
   config = NavyConfig{};
   EXPECT_THROW(config.blockCache()
                    .enableCustomReinsertion(customPolicy)
@@ -417,6 +497,9 @@ TEST(NavyConfigTest, OtherSettings) {
   config.setMaxParcelMemoryMB(maxParcelMemoryMB);
   EXPECT_EQ(config.getMaxConcurrentInserts(), maxConcurrentInserts);
   EXPECT_EQ(config.getMaxParcelMemoryMB(), maxParcelMemoryMB);
+  ASSERT_THROW(config.setInflightTrackingShards(0), std::invalid_argument);
+  config.setInflightTrackingShards(64);
+  EXPECT_EQ(config.getInflightTrackingShards(), 64);
 }
 } // namespace tests
 } // namespace cachelib
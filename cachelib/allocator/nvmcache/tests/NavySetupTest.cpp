@@ -304,6 +304,72 @@ TEST(NavySetupTest, EnginesSetup) {
         std::invalid_argument);
   }
 }
+
+TEST(NavySetupTest, PoolEnginePairs) {
+  auto makeConfig = []() {
+    navy::NavyConfig cfg = utils::getNvmTestConfig("/tmp");
+    // 20MB block cache 0.
+    cfg.blockCache().setSize(20 * 1024 * 1024);
+    navy::EnginesConfig pair1;
+    pair1.blockCache().setRegionSize(4 * 1024 * 1024);
+    cfg.addEnginePair(std::move(pair1));
+    return cfg;
+  };
+  // the pool is the first character of the key
+  auto resolver = [](folly::StringPiece key) -> int8_t { return key[0] - '0'; };
+
+  {
+    navy::NavyConfig cfg = makeConfig();
+    EXPECT_THROW(cfg.setPoolEnginePairs({0, 1}, {}), std::invalid_argument);
+    cfg.setPoolEnginePairs({0, 1}, resolver);
+    auto cache = createNavyCache(cfg, {}, {}, true, nullptr, false);
+    ASSERT_NE(nullptr, cache);
+
+    // items of every pool are found in their own engine pair. The values are
+    // too large for the bighash of the first pair.
+    const std::string value(200, 'v');
+    for (auto key : {"0key", "1key", "2key"}) {
+      EXPECT_EQ(navy::Status::Ok,
+                cache->insert(HashedKey{key}, navy::makeView(value)));
+    }
+    for (auto key : {"0key", "1key", "2key"}) {
+      navy::Buffer found;
+      EXPECT_EQ(navy::Status::Ok, cache->lookup(HashedKey{key}, found));
+    }
+
+    uint64_t pair0Inserts = 0;
+    uint64_t pair1Inserts = 0;
+    cache->getCounters({[&](folly::StringPiece name, double count) {
+      if (name == "navy_bc_inserts_0") {
+        pair0Inserts = static_cast<uint64_t>(count);
+      } else if (name == "navy_bc_inserts_1") {
+        pair1Inserts = static_cast<uint64_t>(count);
+      }
+    }});
+    // pool 2 has no engine pair and goes to the first one
+    EXPECT_EQ(2, pair0Inserts);
+    EXPECT_EQ(1, pair1Inserts);
+  }
+
+  {
+    // Exception. Pool 1 has no such engine pair.
+    navy::NavyConfig cfg = makeConfig();
+    cfg.setPoolEnginePairs({0, 2}, resolver);
+    EXPECT_THROW(
+        { createNavyCache(cfg, {}, {}, true, nullptr, false); },
+        std::invalid_argument);
+  }
+
+  {
+    // Exception. Both pool engine pairs and a selector.
+    navy::NavyConfig cfg = makeConfig();
+    cfg.setPoolEnginePairs({0, 1}, resolver);
+    cfg.setEnginesSelector([](HashedKey hk) { return hk.key().size() % 2; });
+    EXPECT_THROW(
+        { createNavyCache(cfg, {}, {}, true, nullptr, false); },
+        std::invalid_argument);
+  }
+}
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/allocator/nvmcache/NegativeLookupCache.h"
+#include "cachelib/common/Hash.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+namespace {
+uint64_t hashOf(const std::string& key) {
+  return HashedKey{key}.keyHash();
+}
+} // namespace
+
+TEST(NegativeLookupCacheTest, Basic) {
+  NegativeLookupCache cache{100};
+  const auto hash = hashOf("key");
+  EXPECT_FALSE(cache.isKnownMiss(hash));
+
+  EXPECT_TRUE(cache.recordMiss(hash, cache.getToken(hash)));
+  EXPECT_TRUE(cache.isKnownMiss(hash));
+
+  // recording again keeps a single entry
+  EXPECT_TRUE(cache.recordMiss(hash, cache.getToken(hash)));
+  EXPECT_TRUE(cache.isKnownMiss(hash));
+
+  cache.invalidate(hash);
+  EXPECT_FALSE(cache.isKnownMiss(hash));
+}
+
+TEST(NegativeLookupCacheTest, InvalidateRacesWithLookup) {
+  NegativeLookupCache cache{100};
+  const auto hash = hashOf("key");
+
+  // a put invalidates the key while the lookup is in flight
+  const auto token = cache.getToken(hash);
+  cache.invalidate(hash);
+  EXPECT_FALSE(cache.recordMiss(hash, token));
+  EXPECT_FALSE(cache.isKnownMiss(hash));
+
+  // a later lookup records its miss
+  EXPECT_TRUE(cache.recordMiss(hash, cache.getToken(hash)));
+  EXPECT_TRUE(cache.isKnownMiss(hash));
+}
+
+TEST(NegativeLookupCacheTest, Capacity) {
+  EXPECT_THROW(NegativeLookupCache{0}, std::invalid_argument);
+
+  NegativeLookupCache cache{100};
+  EXPECT_GE(cache.getCapacity(), 100u);
+
+  // record many more misses than the capacity. The most recent ones are
+  // remembered and the older ones get replaced.
+  const int numKeys = static_cast<int>(10 * cache.getCapacity());
+  for (int i = 0; i < numKeys; i++) {
+    const auto hash = hashOf(std::to_string(i));
+    EXPECT_TRUE(cache.recordMiss(hash, cache.getToken(hash)));
+    EXPECT_TRUE(cache.isKnownMiss(hash));
+  }
+
+  int numKnown = 0;
+  for (int i = 0; i < numKeys; i++) {
+    numKnown += cache.isKnownMiss(hashOf(std::to_string(i))) ? 1 : 0;
+  }
+  EXPECT_LE(numKnown, static_cast<int>(cache.getCapacity()) + numKeys / 100);
+}
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
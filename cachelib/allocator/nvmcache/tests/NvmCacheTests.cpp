@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include <climits>
+#include <future>
 #include <set>
 #include <thread>
 
@@ -135,6 +136,47 @@ TEST_F(NvmCacheTest, BasicGet) {
   ASSERT_TRUE(this->checkKeyExists(key, false /* ramOnly */));
 }
 
+TEST_F(NvmCacheTest, FindAsync) {
+  auto& nvm = this->cache();
+  auto pid = this->poolId();
+
+  const std::string key = "blah";
+  {
+    auto sf = nvm.findAsync(key);
+    ASSERT_TRUE(sf.isReady());
+    ASSERT_EQ(nullptr, std::move(sf).get());
+  }
+
+  {
+    auto it = nvm.allocate(pid, key, 100);
+    ASSERT_NE(nullptr, it);
+    *reinterpret_cast<uint64_t*>(it->getMemory()) = 42;
+    nvm.insertOrReplace(it);
+  }
+
+  // DRAM hits complete right away
+  {
+    auto sf = nvm.findAsync(key);
+    ASSERT_TRUE(sf.isReady());
+    auto hdl = std::move(sf).get();
+    ASSERT_NE(nullptr, hdl);
+    ASSERT_FALSE(hdl.wentToNvm());
+  }
+
+  // DRAM misses complete once the item is loaded from the nvm cache
+  this->pushToNvmCacheFromRamForTesting(key);
+  this->removeFromRamForTesting(key);
+  nvm.flushNvmCache();
+  {
+    auto hdl = nvm.findAsync(key).get();
+    ASSERT_NE(nullptr, hdl);
+    ASSERT_TRUE(hdl.wentToNvm());
+    ASSERT_EQ(42, *reinterpret_cast<const uint64_t*>(hdl->getMemory()));
+  }
+  ASSERT_EQ(0, nvm.getNumActiveHandles());
+  ASSERT_EQ(0, nvm.getHandleCountForThread());
+}
+
 TEST_F(NvmCacheTest, CouldExistFast) {
   // Enable fast negative lookup
   this->makeCache();
@@ -368,6 +410,102 @@ TEST_F(NvmCacheTest, Delete) {
   }
 }
 
+TEST_F(NvmCacheTest, RemoveBatch) {
+  auto& nvm = this->cache();
+  auto pid = this->poolId();
+
+  const int nKeys = 1024;
+
+  std::vector<std::string> keys;
+  for (unsigned int i = 0; i < nKeys; i++) {
+    keys.push_back(std::string("blah") + folly::to<std::string>(i));
+    auto it = nvm.allocate(pid, keys.back(), 15 * 1024);
+    ASSERT_NE(nullptr, it);
+    nvm.insertOrReplace(it);
+    // Avoid any nvm eviction being dropped due to the race with still
+    // outstanding remove operation for insertion
+    if (i % 100 == 0) {
+      nvm.flushNvmCache();
+    }
+  }
+  nvm.flushNvmCache();
+
+  // remove every other key in a single batch
+  std::vector<AllocatorT::Key> toRemove;
+  for (unsigned int i = 0; i < nKeys; i += 2) {
+    toRemove.emplace_back(keys[i]);
+  }
+  std::promise<AllocatorT::RemoveBatchResult> promise;
+  auto future = promise.get_future();
+  nvm.removeBatch(folly::range(toRemove),
+                  [&promise](AllocatorT::RemoveBatchResult result) {
+                    promise.set_value(result);
+                  });
+  const auto result = future.get();
+  EXPECT_EQ(0, result.numFailed);
+  EXPECT_GT(result.numRemoved, 0);
+  EXPECT_LE(result.numRemoved + result.numNotFound, toRemove.size());
+
+  for (unsigned int i = 0; i < nKeys; i++) {
+    if (i % 2 == 0) {
+      ASSERT_FALSE(this->checkKeyExists(keys[i], false /* ramOnly */));
+    }
+  }
+
+  // nothing to do has the callback invoked right away
+  bool invoked = false;
+  nvm.removeBatch({}, [&invoked](AllocatorT::RemoveBatchResult result) {
+    EXPECT_EQ(0, result.numRemoved + result.numNotFound + result.numFailed);
+    invoked = true;
+  });
+  EXPECT_TRUE(invoked);
+}
+
+TEST_F(NvmCacheTest, Prefetch) {
+  auto& nvm = this->cache();
+  auto pid = this->poolId();
+
+  std::vector<std::string> keys;
+  for (uint64_t i = 0; i < 10; i++) {
+    keys.push_back(folly::sformat("prefetch{}", i));
+    auto it = nvm.allocate(pid, keys.back(), 100);
+    ASSERT_NE(nullptr, it);
+    *reinterpret_cast<uint64_t*>(it->getMemory()) = i;
+    nvm.insertOrReplace(it);
+    ASSERT_TRUE(this->pushToNvmCacheFromRamForTesting(keys.back()));
+    this->removeFromRamForTesting(keys.back());
+  }
+  nvm.flushNvmCache();
+  for (const auto& key : keys) {
+    ASSERT_FALSE(this->checkKeyExists(key, true /* ramOnly */));
+  }
+
+  std::vector<AllocatorT::Key> toPrefetch(keys.begin(), keys.end());
+  toPrefetch.emplace_back("missing");
+  const auto numIssued = nvm.prefetch(folly::range(toPrefetch));
+  EXPECT_GE(numIssued, keys.size());
+  EXPECT_LE(numIssued, keys.size() + 1);
+  nvm.flushNvmCache();
+
+  // the items are in dram now
+  for (uint64_t i = 0; i < keys.size(); i++) {
+    auto hdl = this->fetch(keys[i], true /* ramOnly */);
+    ASSERT_NE(nullptr, hdl);
+    ASSERT_EQ(i, *reinterpret_cast<const uint64_t*>(hdl->getMemory()));
+  }
+  ASSERT_FALSE(this->checkKeyExists("missing", true /* ramOnly */));
+
+  // and are not prefetched again
+  ASSERT_EQ(0, nvm.prefetch(folly::range(toPrefetch.data(),
+                                         toPrefetch.data() + keys.size())));
+
+  const auto stats = nvm.getGlobalCacheStats();
+  EXPECT_EQ(numIssued, stats.numNvmPrefetches);
+  EXPECT_EQ(keys.size(), stats.numNvmPrefetchFilled);
+  EXPECT_EQ(2 * keys.size() + 1 - numIssued, stats.numNvmPrefetchSkipped);
+  EXPECT_EQ(0, stats.numNvmPrefetchCancelled);
+}
+
 TEST_F(NvmCacheTest, InsertOrReplace) {
   auto& nvm = this->cache();
   auto pid = this->poolId();
@@ -769,6 +907,42 @@ TEST_F(NvmCacheTest, WarmRoll) {
   }
 }
 
+TEST_F(NvmCacheTest, WarmRollDeferredRestore) {
+  this->convertToShmCache();
+  this->getConfig().setDeferredAttachRestore();
+  std::string key = "blah";
+  std::string removedKey = "removed";
+  std::string ramKey = "ram";
+  {
+    auto& nvm = this->cache();
+    auto pid = this->poolId();
+
+    for (const auto& k : {key, removedKey, ramKey}) {
+      auto it = nvm.allocate(pid, k, 100);
+      nvm.insertOrReplace(it);
+    }
+    for (const auto& k : {key, removedKey}) {
+      ASSERT_TRUE(this->pushToNvmCacheFromRamForTesting(k));
+      this->removeFromRamForTesting(k);
+    }
+  }
+
+  this->warmRoll();
+  {
+    // the dram cache serves right away
+    ASSERT_TRUE(this->checkKeyExists(ramKey, true /* ramOnly */));
+
+    // removed while navy may still be recovering, it must not come back
+    this->cache().remove(removedKey);
+
+    this->getNvmCache()->waitForRecovery();
+    ASSERT_FALSE(this->getNvmCache()->isRecovering());
+    ASSERT_TRUE(this->getNvmCache()->isEnabled());
+    ASSERT_TRUE(this->checkKeyExists(key, false /* ramOnly */));
+    ASSERT_FALSE(this->checkKeyExists(removedKey, false /* ramOnly */));
+  }
+}
+
 TEST_F(NvmCacheTest, ColdRoll) {
   this->convertToShmCache();
   std::string key = "blah";
@@ -798,6 +972,58 @@ TEST_F(NvmCacheTest, ColdRoll) {
   }
 }
 
+TEST_F(NvmCacheTest, WarmUpAfterColdRoll) {
+  this->convertToShmCache();
+  std::vector<std::string> keys = {"once", "twice", "write", "coalesced"};
+  {
+    auto& nvm = this->cache();
+    auto pid = this->poolId();
+    for (const auto& key : keys) {
+      auto it = nvm.allocate(pid, key, 100);
+      ASSERT_NE(nullptr, it);
+      nvm.insertOrReplace(it);
+      ASSERT_TRUE(this->pushToNvmCacheFromRamForTesting(key));
+    }
+  }
+
+  this->getConfig().nvmConfig->warmUpDuration = std::chrono::seconds{3600};
+  this->coldRoll();
+  auto& nvm = this->cache();
+  const auto numRemoveCbs = this->evictionCount();
+
+  // a key found once is served from navy without being inserted
+  ASSERT_NE(nullptr, this->fetch("once", false /* ramOnly */));
+  EXPECT_FALSE(this->checkKeyExists("once", true /* ramOnly */));
+  EXPECT_EQ(1, this->getStats().numNvmGetServedWithoutFill);
+
+  // and inserted when found again within the window
+  ASSERT_NE(nullptr, this->fetch("twice", false /* ramOnly */));
+  EXPECT_FALSE(this->checkKeyExists("twice", true /* ramOnly */));
+  ASSERT_NE(nullptr, this->fetch("twice", false /* ramOnly */));
+  EXPECT_TRUE(this->checkKeyExists("twice", true /* ramOnly */));
+  EXPECT_EQ(2, this->getStats().numNvmGetServedWithoutFill);
+
+  // finds for writing always insert
+  ASSERT_NE(nullptr, this->fetchToWrite("write", false /* ramOnly */));
+  EXPECT_TRUE(this->checkKeyExists("write", true /* ramOnly */));
+
+  // so do several finds waiting on the same lookup
+  {
+    auto hdl1 = nvm.find("coalesced");
+    auto hdl2 = nvm.find("coalesced");
+    hdl1.wait();
+    hdl2.wait();
+    ASSERT_NE(nullptr, hdl1);
+    ASSERT_NE(nullptr, hdl2);
+  }
+  EXPECT_TRUE(this->checkKeyExists("coalesced", true /* ramOnly */));
+  EXPECT_EQ(2, this->getStats().numNvmGetServedWithoutFill);
+
+  // releasing the items that were not inserted does not run the remove
+  // callback
+  EXPECT_EQ(numRemoveCbs, this->evictionCount());
+}
+
 TEST_F(NvmCacheTest, ColdRollDropNvmCache) {
   this->getConfig().setDropNvmCacheOnShmNew(true);
   this->convertToShmCache();
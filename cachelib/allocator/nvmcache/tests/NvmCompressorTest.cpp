@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Format.h>
+#include <folly/Random.h>
+#include <folly/compression/Compression.h>
+#include <gtest/gtest.h>
+
+#include "cachelib/allocator/nvmcache/NvmCompressor.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+namespace {
+// text that compresses well
+std::string genCompressibleStr(size_t len) {
+  std::string s;
+  s.reserve(len);
+  while (s.size() < len) {
+    s.append(folly::sformat("key{} value{} ", s.size() % 97, s.size() % 13));
+  }
+  s.resize(len);
+  return s;
+}
+
+std::string genRandomStr(size_t len) {
+  std::string s;
+  s.reserve(len);
+  for (size_t i = 0; i < len; i++) {
+    s.push_back(static_cast<char>(folly::Random::rand32(0, 256)));
+  }
+  return s;
+}
+
+std::unique_ptr<NvmItem> makeItem(const std::vector<std::string>& strings) {
+  std::vector<Blob> blobs;
+  for (const auto& s : strings) {
+    blobs.push_back(Blob{static_cast<uint32_t>(s.size()), s});
+  }
+  return std::unique_ptr<NvmItem>(
+      new (NvmItem::estimateVariableSize(blobs)) NvmItem(1, 2, 3, blobs));
+}
+
+void testRoundTrip(const NvmCompressor& compressor) {
+  std::vector<std::string> strings{genCompressibleStr(4096),
+                                   genCompressibleStr(1000)};
+  auto nvmItem = makeItem(strings);
+  auto compressed = compressor.compress(*nvmItem);
+  ASSERT_NE(nullptr, compressed);
+  ASSERT_TRUE(compressed->isCompressed());
+  ASSERT_LT(compressed->getData().size(), nvmItem->getData().size());
+  ASSERT_LT(compressed->totalSize(), nvmItem->totalSize());
+  ASSERT_EQ(nvmItem->getExpiryTime(), compressed->getExpiryTime());
+
+  auto decompressed = compressor.decompress(*compressed);
+  ASSERT_NE(nullptr, decompressed);
+  ASSERT_FALSE(decompressed->isCompressed());
+  ASSERT_EQ(nvmItem->totalSize(), decompressed->totalSize());
+  for (size_t i = 0; i < strings.size(); i++) {
+    ASSERT_EQ(strings[i], decompressed->getBlob(i).data);
+  }
+}
+} // namespace
+
+TEST(NvmCompressorTest, Zstd) {
+  NvmCompressor compressor{NvmCompressor::Config{}};
+  testRoundTrip(compressor);
+}
+
+TEST(NvmCompressorTest, ZstdDictionary) {
+  NvmCompressor::Config config;
+  config.dictionary = genCompressibleStr(1024);
+  NvmCompressor compressor{config};
+  testRoundTrip(compressor);
+
+  // a compressor without the dictionary can not read the values back
+  auto compressed = compressor.compress(*makeItem({genCompressibleStr(1024)}));
+  ASSERT_NE(nullptr, compressed);
+  NvmCompressor noDict{NvmCompressor::Config{}};
+  ASSERT_EQ(nullptr, noDict.decompress(*compressed));
+}
+
+TEST(NvmCompressorTest, Lz4) {
+  if (!folly::io::hasCodec(folly::io::CodecType::LZ4)) {
+    return;
+  }
+  NvmCompressor::Config config;
+  config.type = NvmCompressor::Type::Lz4;
+  NvmCompressor compressor{config};
+  testRoundTrip(compressor);
+
+  // values of another algorithm are not decompressed
+  auto compressed = compressor.compress(*makeItem({genCompressibleStr(1024)}));
+  ASSERT_NE(nullptr, compressed);
+  NvmCompressor zstd{NvmCompressor::Config{}};
+  ASSERT_EQ(nullptr, zstd.decompress(*compressed));
+}
+
+TEST(NvmCompressorTest, Skip) {
+  NvmCompressor::Config config;
+  config.minSize = 512;
+  NvmCompressor compressor{config};
+
+  // too small
+  ASSERT_EQ(nullptr, compressor.compress(*makeItem({genCompressibleStr(500)})));
+  // does not compress
+  ASSERT_EQ(nullptr, compressor.compress(*makeItem({genRandomStr(4096)})));
+  ASSERT_NE(nullptr, compressor.compress(*makeItem({genCompressibleStr(512)})));
+}
+
+TEST(NvmCompressorTest, InvalidConfig) {
+  NvmCompressor::Config config;
+  config.level = 1000;
+  ASSERT_THROW(config.validate(), std::invalid_argument);
+  ASSERT_THROW(NvmCompressor{config}, std::invalid_argument);
+
+  config = NvmCompressor::Config{};
+  config.type = NvmCompressor::Type::Lz4;
+  config.dictionary = "dictionary";
+  ASSERT_THROW(config.validate(), std::invalid_argument);
+
+  config = NvmCompressor::Config{};
+  config.minSavingsPct = 100;
+  ASSERT_THROW(config.validate(), std::invalid_argument);
+
+  config = NvmCompressor::Config{};
+  config.type = static_cast<NvmCompressor::Type>(3);
+  ASSERT_THROW(config.validate(), std::invalid_argument);
+}
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
@@ -93,6 +93,47 @@ TEST(NvmItemTest, TotalSize) {
   ASSERT_EQ(bufSize + sizeof(NvmItem), nvmItem->totalSize());
 }
 
+TEST(NvmItemTest, CompressedCopy) {
+  std::vector<std::string> strings{genRandomStr(100), genRandomStr(200)};
+  std::vector<Blob> blobs{Blob{90, strings[0]}, Blob{200, strings[1]}};
+  auto nvmItem = std::unique_ptr<NvmItem>(
+      new (NvmItem::estimateVariableSize(blobs)) NvmItem(1, 2, 3, blobs));
+  ASSERT_FALSE(nvmItem->isCompressed());
+  ASSERT_EQ(300, nvmItem->getDataSize());
+  ASSERT_EQ(300, nvmItem->getData().size());
+
+  // a compressed copy keeps the header and the blobs layout
+  const uint8_t compression = 1;
+  const size_t compressedSize = 42;
+  size_t bufSize =
+      NvmItem::estimateVariableSize(*nvmItem, compression, compressedSize);
+  auto compressed = std::unique_ptr<NvmItem>(
+      new (bufSize) NvmItem(*nvmItem, compression, compressedSize));
+  ASSERT_TRUE(compressed->isCompressed());
+  ASSERT_EQ(compression, compressed->getCompression());
+  ASSERT_EQ(1, compressed->poolId());
+  ASSERT_EQ(2, compressed->getCreationTime());
+  ASSERT_EQ(3, compressed->getExpiryTime());
+  ASSERT_EQ(2, compressed->getNumBlobs());
+  ASSERT_EQ(300, compressed->getDataSize());
+  ASSERT_EQ(compressedSize, compressed->getData().size());
+  ASSERT_EQ(bufSize + sizeof(NvmItem), compressed->totalSize());
+  ASSERT_THROW(compressed->getBlob(0), std::invalid_argument);
+
+  // an uncompressed copy of it has the same blobs
+  auto data = nvmItem->getData();
+  bufSize = NvmItem::estimateVariableSize(*compressed, 0, data.size());
+  auto copy = std::unique_ptr<NvmItem>(
+      new (bufSize) NvmItem(*compressed, 0, data.size()));
+  std::memcpy(copy->getMutableData().data(), data.data(), data.size());
+  ASSERT_FALSE(copy->isCompressed());
+  ASSERT_EQ(nvmItem->totalSize(), copy->totalSize());
+  for (size_t i = 0; i < blobs.size(); i++) {
+    ASSERT_EQ(blobs[i].data, copy->getBlob(i).data);
+    ASSERT_EQ(blobs[i].origAllocSize, copy->getBlob(i).origAllocSize);
+  }
+}
+
 TEST(NvmItemTest, MultipleBlobsOverFlow) {
   int nBlobs = folly::Random::rand32(1, 100);
   std::vector<Blob> blobs;
@@ -120,6 +120,38 @@ TEST(TombStoneTest, Move) {
   ASSERT_FALSE(t.isPresent(key));
 }
 
+// keys whose probe windows are full are tracked in the overflow map.
+TEST(TombStoneTest, Overflow) {
+  TombStones t;
+  // same high bits to share the probe window, different tags.
+  auto makeKey = [](uint64_t i) {
+    return HashedKey::precomputed("12325", i << 16);
+  };
+
+  const uint64_t nKeys = 2 * TombStones::kMaxProbe;
+  std::vector<TombStones::Guard> guards;
+  for (uint64_t i = 0; i < nKeys; i++) {
+    guards.push_back(t.add(makeKey(i)));
+    guards.push_back(t.add(makeKey(i)));
+  }
+  for (uint64_t i = 0; i < nKeys; i++) {
+    ASSERT_TRUE(t.isPresent(makeKey(i)));
+  }
+  ASSERT_FALSE(t.isPresent(makeKey(nKeys)));
+
+  // release the first guard of every key, then the second one.
+  for (uint64_t i = 0; i < guards.size(); i += 2) {
+    guards[i] = TombStones::Guard{};
+  }
+  for (uint64_t i = 0; i < nKeys; i++) {
+    ASSERT_TRUE(t.isPresent(makeKey(i)));
+  }
+  guards.clear();
+  for (uint64_t i = 0; i < nKeys; i++) {
+    ASSERT_FALSE(t.isPresent(makeKey(i)));
+  }
+}
+
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
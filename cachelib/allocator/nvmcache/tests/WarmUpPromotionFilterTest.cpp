@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/allocator/nvmcache/WarmUpPromotionFilter.h"
+#include "cachelib/common/Hash.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+namespace {
+uint64_t hashOf(const std::string& key) {
+  return HashedKey{key}.keyHash();
+}
+} // namespace
+
+TEST(WarmUpPromotionFilterTest, Window) {
+  WarmUpPromotionFilter filter{100, 10};
+  const auto hash = hashOf("key");
+  EXPECT_FALSE(filter.recordHit(hash, 1000));
+  EXPECT_TRUE(filter.recordHit(hash, 1010));
+
+  // every hit restarts the window
+  EXPECT_TRUE(filter.recordHit(hash, 1020));
+  EXPECT_FALSE(filter.recordHit(hash, 1031));
+  EXPECT_FALSE(filter.recordHit(hashOf("other"), 1031));
+}
+
+TEST(WarmUpPromotionFilterTest, Collision) {
+  WarmUpPromotionFilter filter{1, 10};
+  EXPECT_EQ(1, filter.getCapacity());
+
+  // keys sharing the only slot push each other out
+  EXPECT_FALSE(filter.recordHit(hashOf("key1"), 1000));
+  EXPECT_FALSE(filter.recordHit(hashOf("key2"), 1000));
+  EXPECT_FALSE(filter.recordHit(hashOf("key1"), 1000));
+  EXPECT_TRUE(filter.recordHit(hashOf("key1"), 1000));
+}
+
+TEST(WarmUpPromotionFilterTest, Capacity) {
+  EXPECT_THROW(WarmUpPromotionFilter(0, 10), std::invalid_argument);
+  EXPECT_THROW(WarmUpPromotionFilter(100, 0), std::invalid_argument);
+  EXPECT_EQ(128, (WarmUpPromotionFilter{100, 10}.getCapacity()));
+}
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
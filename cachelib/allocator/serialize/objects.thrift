@@ -34,6 +34,7 @@ struct CacheAllocatorMetadata {
   9: i64 numChainedChildItems;
   10: i64 ramFormatVersion = 0; // format version of ram cache
   11: i64 numAbortedSlabReleases = 0; // number of times slab release is aborted
+  12: i64 memoryPageSize = 0; // PageSizeT the slab memory was created with
 }
 
 struct NvmCacheMetadata {
@@ -47,6 +48,9 @@ struct NvmCacheMetadata {
 struct CompactCacheMetadataObject {
   1: required i64 keySize;
   2: required i64 valueSize;
+  // 0 in the states saved before the bucket layout was recorded
+  3: i64 bucketSize = 0;
+  4: i32 layoutVersion = 0;
 }
 
 struct CompactCacheAllocatorObject {
@@ -135,6 +139,23 @@ struct MMTinyLFUCollection {
   1: required map<i32, map<i32, MMTinyLFUObject>> pools;
 }
 
+struct MMSieveConfig {
+  1: bool updateOnWrite = false;
+  2: bool updateOnRead = true;
+}
+
+struct MMSieveObject {
+  1: required MMSieveConfig config;
+
+  // position of the eviction hand
+  2: required i64 compressedHand;
+  3: required DListObject lru;
+}
+
+struct MMSieveCollection {
+  1: required map<i32, map<i32, MMSieveObject>> pools;
+}
+
 struct ChainedHashTableObject {
   // fields in ChainedHashTable::Config
   1: required i32 bucketsPower;
@@ -144,6 +165,11 @@ struct ChainedHashTableObject {
   // this magic id ensures on a warm roll, user cannot
   // start the cache with a different hash function
   4: i32 hasherMagicId = 0;
+
+  // state of a hash table that grows. bucketsPower is the power it grew
+  // to, and numBucketsSplit the buckets split by a resize in progress.
+  5: i32 maxBucketsPower = 0;
+  6: i64 numBucketsSplit = 0;
 }
 
 struct MMTTLBucketObject {
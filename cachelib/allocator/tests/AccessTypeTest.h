@@ -58,10 +58,17 @@ struct AccessTypeTest : public SlabAllocatorTestBase {
 
     void incRef() noexcept { refcount_++; }
     void decRef() noexcept { refcount_--; }
+    bool incRefIfAccessible() noexcept {
+      if (!accessible_) {
+        return false;
+      }
+      refcount_++;
+      return true;
+    }
 
     std::string toString() const {
       return folly::sformat(" key = {}, ref = {}, accessible = ", key_,
-                            refcount_.load(), accessible_);
+                            refcount_.load(), accessible_.load());
     }
 
     void triggerHandleException(bool state) {
@@ -76,12 +83,12 @@ struct AccessTypeTest : public SlabAllocatorTestBase {
     friend AccessTypeTest<AccessType>;
 
     void markAccessible() noexcept {
-      ASSERT_FALSE(accessible_);
+      ASSERT_FALSE(accessible_.load());
       accessible_ = true;
     }
 
     void unmarkAccessible() noexcept {
-      ASSERT_TRUE(accessible_);
+      ASSERT_TRUE(accessible_.load());
       accessible_ = false;
     }
 
@@ -103,7 +110,7 @@ struct AccessTypeTest : public SlabAllocatorTestBase {
 
    private:
     std::string key_;
-    bool accessible_{false};
+    std::atomic<bool> accessible_{false};
     std::atomic<unsigned int> refcount_{0};
     friend typename AccessType::template Container<Node, &Node::accessHook_>;
     std::atomic<bool> shouldTriggerHandleException_{false};
@@ -313,9 +320,9 @@ void AccessTypeTest<AccessType>::testFind() {
 template <typename AccessType>
 void AccessTypeTest<AccessType>::testSerialization() {
   Config config;
-  std::unique_ptr<CompressedPtrType[]> memStart(
-      new CompressedPtrType[config.getNumBuckets()]);
-  size_t hashTableSize = sizeof(CompressedPtrType) * config.getNumBuckets();
+  const size_t hashTableSize =
+      Container::getRequiredSize(config.getNumBuckets());
+  std::unique_ptr<uint8_t[]> memStart(new uint8_t[hashTableSize]);
   memset(memStart.get(), 0, hashTableSize);
 
   Container c1(config,
@@ -386,10 +393,10 @@ void AccessTypeTest<AccessType>::testSerialization() {
 template <typename AccessType>
 void AccessTypeTest<AccessType>::testIteratorWithSerialization() {
   Config config;
-  std::unique_ptr<CompressedPtrType[]> memStart(
-      new CompressedPtrType[config.getNumBuckets()]);
-  memset(memStart.get(), 0,
-         sizeof(CompressedPtrType*) * config.getNumBuckets());
+  const size_t hashTableSize =
+      Container::getRequiredSize(config.getNumBuckets());
+  std::unique_ptr<uint8_t[]> memStart(new uint8_t[hashTableSize]);
+  memset(memStart.get(), 0, hashTableSize);
   Container c{std::move(config), reinterpret_cast<Node**>(memStart.get()),
               typename Node::PtrCompressor()};
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "cachelib/allocator/AllocSizeTuner.h"
+#include "cachelib/allocator/CacheAllocator.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+TEST(AllocSizeTunerTest, InvalidSampleRate) {
+  EXPECT_THROW(AllocSizeTuner{0}, std::invalid_argument);
+}
+
+TEST(AllocSizeTunerTest, SizeDistribution) {
+  AllocSizeTuner tuner{1};
+  for (int i = 0; i < 10; i++) {
+    tuner.recordAllocation(100);
+  }
+  for (int i = 0; i < 5; i++) {
+    tuner.recordAllocation(2000);
+  }
+
+  // small sizes are only rounded to the alignment, larger ones to a bucket
+  // at most 1/64th larger
+  std::map<uint32_t, uint64_t> expected{{104, 10}, {2008, 5}};
+  ASSERT_EQ(expected, tuner.getSizeDistribution());
+
+  tuner.decay();
+  expected = {{104, 5}, {2008, 2}};
+  ASSERT_EQ(expected, tuner.getSizeDistribution());
+}
+
+TEST(AllocSizeTunerTest, ComputeAllocSizes) {
+  const std::map<uint32_t, uint64_t> dist{{100, 10}, {200, 10}, {1000, 10}};
+  ASSERT_EQ((std::set<uint32_t>{104, 200, 1000}),
+            AllocSizeTuner::computeAllocSizes(dist, 3, 64, 1000));
+  ASSERT_EQ((std::set<uint32_t>{200, 1000}),
+            AllocSizeTuner::computeAllocSizes(dist, 2, 64, 1000));
+
+  // the largest size is kept even if nothing that large was sampled
+  const std::map<uint32_t, uint64_t> small{{100, 10}};
+  ASSERT_EQ((std::set<uint32_t>{104, 4096}),
+            AllocSizeTuner::computeAllocSizes(small, 10, 64, 4096));
+  ASSERT_EQ((std::set<uint32_t>{4096}),
+            AllocSizeTuner::computeAllocSizes(small, 1, 64, 4096));
+
+  // sizes are never below the minimum
+  ASSERT_EQ((std::set<uint32_t>{64, 4096}),
+            AllocSizeTuner::computeAllocSizes({{16, 10}}, 10, 64, 4096));
+
+  EXPECT_THROW(AllocSizeTuner::computeAllocSizes(dist, 0, 64, 1000),
+               std::invalid_argument);
+  EXPECT_THROW(AllocSizeTuner::computeAllocSizes(dist, 3, 128, 64),
+               std::invalid_argument);
+}
+
+TEST(AllocSizeTunerTest, ComputeWastedBytes) {
+  const std::map<uint32_t, uint64_t> dist{{100, 1}, {200, 1}, {1000, 1}};
+  // sizes that do not fit any allocation size are ignored
+  ASSERT_DOUBLE_EQ(42, AllocSizeTuner::computeWastedBytes(dist, {128, 256}));
+  ASSERT_DOUBLE_EQ(0,
+                   AllocSizeTuner::computeWastedBytes(dist, {100, 200, 1000}));
+}
+
+TEST(AllocSizeTunerTest, Recommend) {
+  AllocSizeTuner tuner{1};
+  ASSERT_EQ(0, tuner.recommend({128, 256}, 2, 64).numSamples);
+
+  tuner.recordAllocation(100);
+  tuner.recordAllocation(200);
+  auto recommendation = tuner.recommend({128, 256}, 2, 64);
+  ASSERT_EQ(2, recommendation.numSamples);
+  ASSERT_EQ((std::set<uint32_t>{104, 256}), recommendation.allocSizes);
+  ASSERT_DOUBLE_EQ(40, recommendation.currentWastedBytes);
+  ASSERT_DOUBLE_EQ(28, recommendation.recommendedWastedBytes);
+}
+
+TEST(AllocSizeTunerTest, CacheRecommendation) {
+  LruAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  config.enableAllocSizeTuning(std::chrono::milliseconds{10}, 1);
+  LruAllocator cache(config);
+  const auto pid = cache.addPool(
+      "default", cache.getCacheMemoryStats().ramCacheSize);
+
+  for (int i = 0; i < 1000; i++) {
+    auto handle = cache.allocate(pid, folly::sformat("key{}", i), 3000);
+    ASSERT_NE(nullptr, handle);
+  }
+
+  AllocSizeRecommendation recommendation;
+  for (int i = 0; i < 1000 && recommendation.numSamples == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    recommendation = cache.getAllocSizeRecommendation(pid);
+  }
+  ASSERT_GT(recommendation.numSamples, 0);
+
+  const auto& allocSizes = cache.getPool(pid).getAllocSizes();
+  ASSERT_LE(recommendation.allocSizes.size(), allocSizes.size());
+  ASSERT_EQ(allocSizes.back(), *recommendation.allocSizes.rbegin());
+  ASSERT_LE(recommendation.recommendedWastedBytes,
+            recommendation.currentWastedBytes);
+  // every item has the same size, so one class fits all of them exactly
+  ASSERT_LT(recommendation.recommendedWastedBytes, 8);
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
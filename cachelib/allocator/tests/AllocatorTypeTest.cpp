@@ -55,6 +55,29 @@ TYPED_TEST(BaseAllocatorTest, ReadWriteHandle) { this->testReadWriteHandle(); }
 // fetch them.
 TYPED_TEST(BaseAllocatorTest, Find) { this->testFind(); }
 
+// look up a mix of present, missing and expired keys in one batch.
+TYPED_TEST(BaseAllocatorTest, FindBatch) { this->testFindBatch(); }
+
+TYPED_TEST(BaseAllocatorTest, MMContainerShards) {
+  this->testMMContainerShards();
+}
+
+TYPED_TEST(BaseAllocatorTest, EvictionBatch) { this->testEvictionBatch(); }
+
+TYPED_TEST(BaseAllocatorTest, HotKeyReplication) {
+  this->testHotKeyReplication();
+}
+
+TYPED_TEST(BaseAllocatorTest, StripedRefcounts) {
+  this->testStripedRefcounts();
+}
+
+TYPED_TEST(BaseAllocatorTest, StatsSnapshots) { this->testStatsSnapshots(); }
+
+TYPED_TEST(BaseAllocatorTest, TraverseAndEvictItems) {
+  this->testTraverseAndEvictItems();
+}
+
 // make some allocations without evictions, remove them and ensure that they
 // cannot be accessed through find.
 TYPED_TEST(BaseAllocatorTest, Remove) { this->testRemove(); }
@@ -69,6 +92,10 @@ TYPED_TEST(BaseAllocatorTest, RemoveCbSlabReleaseMoving) {
   this->testRemoveCbSlabReleaseMoving();
 }
 
+TYPED_TEST(BaseAllocatorTest, SlabReleaseMoveBatches) {
+  this->testSlabReleaseMoveBatches();
+}
+
 TYPED_TEST(BaseAllocatorTest, RemoveCbSlabRelease) {
   this->testRemoveCbSlabRelease();
 }
@@ -81,6 +108,10 @@ TYPED_TEST(BaseAllocatorTest, AttachDetachOnExit) {
   this->testAttachDetachOnExit();
 }
 
+TYPED_TEST(BaseAllocatorTest, ParallelShutDown) {
+  this->testParallelShutDown();
+}
+
 TYPED_TEST(BaseAllocatorTest, AttachWithDifferentCacheName) {
   this->testAttachWithDifferentName();
 }
@@ -114,6 +145,12 @@ TYPED_TEST(BaseAllocatorTest, CleanupAttached) {
 
 TYPED_TEST(BaseAllocatorTest, DropFile) { this->testDropFile(); }
 
+TYPED_TEST(BaseAllocatorTest, MemoryPageSize) {
+  this->testMemoryPageSize();
+}
+
+TYPED_TEST(BaseAllocatorTest, MemoryTiers) { this->testMemoryTiers(); }
+
 TYPED_TEST(BaseAllocatorTest, ShmTemporary) { this->testShmTemporary(); }
 
 TYPED_TEST(BaseAllocatorTest, Serialization) { this->testSerialization(); }
@@ -151,6 +188,18 @@ TYPED_TEST(BaseAllocatorTest, IOBufSharedItemHandle) {
   this->testIOBufSharedItemHandleWithChainedItems();
 }
 
+TYPED_TEST(BaseAllocatorTest, ReadHandleToIOBuf) {
+  this->testReadHandleToIOBuf();
+}
+
+TYPED_TEST(BaseAllocatorTest, DeferredItemRelease) {
+  this->testDeferredItemRelease();
+}
+
+TYPED_TEST(BaseAllocatorTest, DeferredEvictionCallbacks) {
+  this->testDeferredEvictionCallbacks();
+}
+
 TYPED_TEST(BaseAllocatorTest, IOBufItemHandleForChainedItems) {
   this->testIOBufItemHandleForChainedItems();
 }
@@ -214,6 +263,10 @@ TYPED_TEST(BaseAllocatorTest, ReaperNoWaitUntilEvictions) {
   this->testReaperNoWaitUntilEvictions();
 }
 
+TYPED_TEST(BaseAllocatorTest, ReaperExpiryIndex) {
+  this->testReaperExpiryIndex();
+}
+
 TYPED_TEST(BaseAllocatorTest, ReaperOutOfBound) {
   this->testReaperOutOfBound();
 }
@@ -263,6 +316,8 @@ TYPED_TEST(BaseAllocatorTest, ChainedAllocTransfer) {
   this->testChainedAllocsTransfer();
 }
 
+TYPED_TEST(BaseAllocatorTest, LargeItem) { this->testLargeItem(); }
+
 TYPED_TEST(BaseAllocatorTest, ChainedAllocReplaceInChain) {
   this->testChainedAllocsReplaceInChain();
 }
@@ -344,6 +399,10 @@ TYPED_TEST(BaseAllocatorTest, EvictionAgeStats) {
   this->testEvictionAgeStats();
 }
 
+TYPED_TEST(BaseAllocatorTest, SampledEvictionAges) {
+  this->testSampledEvictionAges();
+}
+
 TYPED_TEST(BaseAllocatorTest, ReplaceInMMContainer) {
   this->testReplaceInMMContainer();
 }
@@ -413,6 +472,10 @@ TYPED_TEST(BaseAllocatorTest, StatSnapshotTest) {
 
 TYPED_TEST(BaseAllocatorTest, ProvisionPool) { this->testProvisionPool(); }
 
+TYPED_TEST(BaseAllocatorTest, WarmUpStreaming) {
+  this->testWarmUpStreaming();
+}
+
 namespace { // the tests that cannot be done by TYPED_TEST.
 
 using LruAllocatorTest = BaseAllocatorTest<LruAllocator>;
@@ -438,6 +501,10 @@ TEST_F(TinyLFUAllocatorTest, AllocateInAccessible) {
   testAllocateInAccessible(config);
 }
 
+TEST_F(LruAllocatorTest, CostAwareEviction) { testCostAwareEviction(); }
+
+TEST_F(Lru2QAllocatorTest, CostAwareEviction) { testCostAwareEviction(); }
+
 TEST_F(LruAllocatorTest, EvictionSearchLimit) {
   LruAllocator::MMConfig config;
   testEvictionSearchLimit(config);
@@ -25,6 +25,10 @@ TYPED_TEST_CASE(BaseAllocatorTestDeathStyle, AllocatorTypes);
 TYPED_TEST(BaseAllocatorTestDeathStyle, ReadOnlyCacheView) {
   this->testReadOnlyCacheView();
 }
+
+TYPED_TEST(BaseAllocatorTestDeathStyle, ReadOnlyCacheViewFind) {
+  this->testReadOnlyCacheViewFind();
+}
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
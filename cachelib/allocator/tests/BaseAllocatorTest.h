@@ -24,6 +24,7 @@
 #include <chrono>
 #include <ctime>
 #include <future>
+#include <map>
 #include <mutex>
 #include <set>
 #include <stdexcept>
@@ -31,6 +32,7 @@
 #include <vector>
 
 #include "cachelib/allocator/CCacheAllocator.h"
+#include "cachelib/allocator/CacheWarmUp.h"
 #include "cachelib/allocator/FreeMemStrategy.h"
 #include "cachelib/allocator/LruTailAgeStrategy.h"
 #include "cachelib/allocator/MarginalHitsOptimizeStrategy.h"
@@ -799,6 +801,489 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     }
   }
 
+  // look up present, missing and expired keys in one batch and ensure that
+  // the result matches doing find() on each of them.
+  void testFindBatch() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(100 * Slab::kSize);
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    const unsigned int keyLen = 100;
+    std::vector<std::string> keyStrs;
+    for (unsigned int i = 0; i < 100; i++) {
+      const auto key = this->getRandomNewKey(alloc, keyLen);
+      auto handle = util::allocateAccessible(alloc, poolId, key, 100);
+      ASSERT_NE(handle, nullptr);
+      keyStrs.push_back(key);
+      keyStrs.push_back(this->getRandomNewKey(alloc, keyLen));
+    }
+
+    const std::string expiredKey = this->getRandomNewKey(alloc, keyLen);
+    {
+      auto handle =
+          util::allocateAccessible(alloc, poolId, expiredKey, 100, 1 /* ttl */);
+      ASSERT_NE(handle, nullptr);
+    }
+    keyStrs.push_back(expiredKey);
+    /* sleep override */ std::this_thread::sleep_for(std::chrono::seconds(3));
+
+    std::vector<typename AllocatorT::Key> keys;
+    for (const auto& key : keyStrs) {
+      keys.emplace_back(key);
+    }
+
+    const auto getsBefore = alloc.getGlobalCacheStats().numCacheGets;
+    auto handles = alloc.findBatch(folly::range(keys));
+    ASSERT_EQ(keys.size(), handles.size());
+    EXPECT_EQ(getsBefore + keys.size(),
+              alloc.getGlobalCacheStats().numCacheGets);
+
+    for (size_t i = 0; i < handles.size(); i++) {
+      const auto& key = keyStrs[i];
+      if (key == expiredKey) {
+        ASSERT_EQ(nullptr, handles[i]);
+      } else if (i % 2 == 0) {
+        ASSERT_NE(nullptr, handles[i]);
+        ASSERT_EQ(key, handles[i]->getKey());
+      } else {
+        ASSERT_EQ(nullptr, handles[i]);
+      }
+    }
+  }
+
+  // allocate items of a single class with sharded MMContainers beyond the
+  // cache capacity and ensure that items are spread across the shards,
+  // evictions happen and stats cover all the shards.
+  void testMMContainerShards() {
+    {
+      typename AllocatorT::Config config;
+      config.setCacheSize(100 * Slab::kSize);
+      config.setNumMMContainerShards(3);
+      ASSERT_THROW(AllocatorT{config}, std::invalid_argument);
+    }
+
+    const size_t numShards = 4;
+    typename AllocatorT::Config config;
+    config.setCacheSize(100 * Slab::kSize);
+    config.setNumMMContainerShards(numShards);
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+    ASSERT_EQ(numShards, alloc.getNumMMContainerShards());
+
+    const unsigned int keyLen = 100;
+    const auto sizes = this->getValidAllocSizes(alloc, poolId, 1, keyLen);
+    ClassId cid = Slab::kInvalidClassId;
+    // keep allocating until a good number of evictions happened
+    for (unsigned int i = 0;
+         i % 1000 != 0 || alloc.getPoolStats(poolId).numEvictions() < 1000;
+         i++) {
+      auto handle = util::allocateAccessible(
+          alloc, poolId, this->getRandomNewKey(alloc, keyLen), sizes[0]);
+      ASSERT_NE(nullptr, handle);
+      auto& container = alloc.getMMContainer(*handle);
+      cid = alloc.getAllocInfo(handle->getMemory()).classId;
+      ASSERT_EQ(&container,
+                &alloc.getMMContainer(poolId, cid,
+                                      alloc.getMMContainerShard(*handle)));
+    }
+
+    const auto poolStats = alloc.getPoolStats(poolId);
+
+    size_t totalSize = 0;
+    for (size_t i = 0; i < numShards; i++) {
+      const auto shardSize = alloc.getMMContainer(poolId, cid, i).size();
+      ASSERT_GT(shardSize, 0);
+      totalSize += shardSize;
+    }
+    ASSERT_EQ(totalSize, poolStats.cacheStats.at(cid).containerStat.size);
+    ASSERT_EQ(totalSize, poolStats.numItems());
+  }
+
+  // fill up a single class with eviction batching enabled and ensure that
+  // evictions happen a batch at a time, the following allocations are served
+  // from the evicted allocations and slabs can be released while allocations
+  // are stashed.
+  void testEvictionBatch() {
+    {
+      typename AllocatorT::Config config;
+      config.setCacheSize(100 * Slab::kSize);
+      config.setEvictionBatchSize(0);
+      ASSERT_THROW(AllocatorT{config}, std::invalid_argument);
+      config.setEvictionBatchSize(
+          AllocatorT::Config::kMaxEvictionBatchSize + 1);
+      ASSERT_THROW(AllocatorT{config}, std::invalid_argument);
+    }
+
+    const uint32_t batchSize = 8;
+    typename AllocatorT::Config config;
+    config.setCacheSize(100 * Slab::kSize);
+    config.setEvictionBatchSize(batchSize);
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    const unsigned int keyLen = 100;
+    const auto sizes = this->getValidAllocSizes(alloc, poolId, 1, keyLen);
+    auto allocate = [&]() {
+      auto handle = util::allocateAccessible(
+          alloc, poolId, this->getRandomNewKey(alloc, keyLen), sizes[0]);
+      EXPECT_NE(nullptr, handle);
+      return alloc.getAllocInfo(handle->getMemory()).classId;
+    };
+
+    ClassId cid = Slab::kInvalidClassId;
+    while (alloc.getPoolStats(poolId).numEvictions() == 0) {
+      cid = allocate();
+    }
+    ASSERT_EQ(batchSize, alloc.getPoolStats(poolId).numEvictions());
+
+    // the rest of the batch is handed out without evicting anything
+    for (uint32_t i = 1; i < batchSize; i++) {
+      allocate();
+      ASSERT_EQ(batchSize, alloc.getPoolStats(poolId).numEvictions());
+    }
+    allocate();
+    ASSERT_EQ(2 * batchSize, alloc.getPoolStats(poolId).numEvictions());
+
+    // stashed allocations do not hold items and must not stall slab release
+    auto usedSlabs = [&]() {
+      return alloc.getPool(poolId).getAllocationClass(cid).getStats().usedSlabs;
+    };
+    const auto numSlabs = usedSlabs();
+    alloc.releaseSlab(poolId, cid, SlabReleaseMode::kRebalance);
+    ASSERT_EQ(numSlabs - 1, usedSlabs());
+    allocate();
+  }
+
+  // lookups of a hot key are served from a replica on the current cpu until
+  // the key changes
+  void testHotKeyReplication() {
+    using Item = typename AllocatorT::Item;
+    {
+      typename AllocatorT::Config config;
+      config.setCacheSize(100 * Slab::kSize);
+      HotKeyReplicationConfig hotKeyConfig;
+      hotKeyConfig.numGenerations = 3;
+      ASSERT_THROW(config.enableHotKeyReplication(hotKeyConfig),
+                   std::invalid_argument);
+      config.enableHotKeyReplication();
+      config.setItemDestructor(
+          [](const typename AllocatorT::DestructorData&) {});
+      ASSERT_THROW(AllocatorT{config}, std::invalid_argument);
+    }
+
+    typename AllocatorT::Config config;
+    config.setCacheSize(100 * Slab::kSize);
+    HotKeyReplicationConfig hotKeyConfig;
+    // one shard, so that the test thread finds its replicas on any cpu
+    hotKeyConfig.numShards = 1;
+    config.enableHotKeyReplication(hotKeyConfig);
+    int numRemoveCbs = 0;
+    config.setRemoveCallback(
+        [&numRemoveCbs](const typename AllocatorT::RemoveCbData&) {
+          numRemoveCbs++;
+        });
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    const std::string key = "hot";
+    const uint32_t size = 100;
+    auto insert = [&](char value) {
+      auto handle = util::allocateAccessible(alloc, poolId, key, size);
+      EXPECT_NE(nullptr, handle);
+      std::memset(handle->getMemory(), value, size);
+      return handle.get();
+    };
+    auto findReplica = [&](const Item* primary) {
+      for (int i = 0; i < 1000000; i++) {
+        auto handle = alloc.find(key);
+        EXPECT_NE(nullptr, handle);
+        if (handle.get() != primary) {
+          return handle;
+        }
+      }
+      return typename AllocatorT::ReadHandle{};
+    };
+    auto isFilledWith = [size](const Item& item, char value) {
+      const auto* data = reinterpret_cast<const char*>(item.getMemory());
+      return std::all_of(data, data + size, [value](char c) {
+        return c == value;
+      });
+    };
+
+    const Item* primary = insert('a');
+    {
+      auto replica = findReplica(primary);
+      ASSERT_NE(nullptr, replica);
+      ASSERT_EQ(key, replica->getKey());
+      ASSERT_FALSE(replica->isAccessible());
+      ASSERT_TRUE(isFilledWith(*replica, 'a'));
+    }
+    auto stats = alloc.getGlobalCacheStats();
+    ASSERT_LT(0, stats.numHotKeyReplicaHits);
+    ASSERT_LT(0, stats.numHotKeyReplicasCreated);
+
+    // the replicas of a replaced key are not served anymore
+    primary = insert('b');
+    ASSERT_EQ(primary, alloc.find(key).get());
+    auto replica = findReplica(primary);
+    ASSERT_NE(nullptr, replica);
+    ASSERT_TRUE(isFilledWith(*replica, 'b'));
+
+    // a replica outlives the removal of its key for its current readers only
+    ASSERT_EQ(AllocatorT::RemoveRes::kSuccess, alloc.remove(key));
+    ASSERT_EQ(nullptr, alloc.find(key));
+    ASSERT_TRUE(isFilledWith(*replica, 'b'));
+    replica.reset();
+
+    // replicas are not passed to the remove callback, unlike the replaced
+    // and the removed items
+    ASSERT_EQ(2, numRemoveCbs);
+    ASSERT_EQ(0, alloc.getHandleCountForThread());
+
+    // replicas do not stall slab release
+    primary = insert('c');
+    ASSERT_NE(nullptr, findReplica(primary));
+    const auto cid = alloc.getAllocInfo(primary).classId;
+    auto usedSlabs = [&]() {
+      return alloc.getPool(poolId).getAllocationClass(cid).getStats().usedSlabs;
+    };
+    const auto numSlabs = usedSlabs();
+    alloc.releaseSlab(poolId, cid, SlabReleaseMode::kRebalance);
+    ASSERT_EQ(numSlabs - 1, usedSlabs());
+  }
+
+  // handles to a hot item are counted on stripes until the item leaves the
+  // cache
+  void testStripedRefcounts() {
+    {
+      typename AllocatorT::Config config;
+      config.setCacheSize(100 * Slab::kSize);
+      StripedRefcountConfig stripedConfig;
+      stripedConfig.maxItems = 0;
+      ASSERT_THROW(config.enableStripedRefcounts(stripedConfig),
+                   std::invalid_argument);
+      config.enableStripedRefcounts();
+      config.enableHotKeyReplication();
+      ASSERT_THROW(AllocatorT{config}, std::invalid_argument);
+    }
+
+    typename AllocatorT::Config config;
+    config.setCacheSize(100 * Slab::kSize);
+    StripedRefcountConfig stripedConfig;
+    stripedConfig.numStripes = 4;
+    // long enough not to be folded back while the test runs
+    stripedConfig.lifetime = std::chrono::seconds{60};
+    config.enableStripedRefcounts(stripedConfig);
+    int numRemoveCbs = 0;
+    config.setRemoveCallback(
+        [&numRemoveCbs](const typename AllocatorT::RemoveCbData&) {
+          numRemoveCbs++;
+        });
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    const std::string key = "hot";
+    auto insert = [&]() {
+      auto handle = util::allocateAccessible(alloc, poolId, key, 100);
+      EXPECT_NE(nullptr, handle);
+      return handle.get();
+    };
+    auto findStriped = [&]() {
+      const auto hits = alloc.getGlobalCacheStats().numStripedRefcountHits;
+      for (int i = 0; i < 1000000; i++) {
+        auto handle = alloc.find(key);
+        EXPECT_NE(nullptr, handle);
+        if (alloc.getGlobalCacheStats().numStripedRefcountHits > hits) {
+          return handle;
+        }
+      }
+      return typename AllocatorT::ReadHandle{};
+    };
+
+    const auto* item = insert();
+    auto handle = findStriped();
+    ASSERT_EQ(item, handle.get());
+    ASSERT_LT(0, alloc.getGlobalCacheStats().numStripedRefcountsCreated);
+    // only the pin is on the item
+    ASSERT_EQ(1, item->getRefCount());
+    ASSERT_EQ(1, alloc.getHandleCountForThread());
+    auto clone = alloc.acquire(const_cast<typename AllocatorT::Item*>(item));
+    ASSERT_EQ(2, item->getRefCount());
+    clone.reset();
+
+    // moving the handle moves its striped reference along
+    auto moved = std::move(handle);
+    ASSERT_EQ(item, moved.get());
+    ASSERT_EQ(1, item->getRefCount());
+
+    // removing the item folds the handle back into its refcount, which
+    // frees the item once the handle is released
+    ASSERT_EQ(AllocatorT::RemoveRes::kSuccess, alloc.remove(key));
+    ASSERT_EQ(1, item->getRefCount());
+    ASSERT_EQ(0, numRemoveCbs);
+    moved.reset();
+    ASSERT_EQ(1, numRemoveCbs);
+    ASSERT_EQ(0, alloc.getHandleCountForThread());
+
+    // pinned items do not stall slab release
+    item = insert();
+    handle = findStriped();
+    ASSERT_EQ(item, handle.get());
+    handle.reset();
+    const auto cid = alloc.getAllocInfo(item).classId;
+    auto usedSlabs = [&]() {
+      return alloc.getPool(poolId).getAllocationClass(cid).getStats().usedSlabs;
+    };
+    const auto numSlabs = usedSlabs();
+    alloc.releaseSlab(poolId, cid, SlabReleaseMode::kRebalance);
+    ASSERT_EQ(numSlabs - 1, usedSlabs());
+    ASSERT_EQ(0, alloc.getHandleCountForThread());
+  }
+
+  // stats snapshots are taken in the background and published for readers
+  void testStatsSnapshots() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(10 * Slab::kSize);
+    config.enableStatsSnapshots(std::chrono::seconds{1}, "test.");
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    ASSERT_NE(nullptr, util::allocateAccessible(alloc, poolId, "key", 100));
+    for (int i = 0; i < 10; i++) {
+      ASSERT_NE(nullptr, alloc.find("key"));
+    }
+
+    // wait for a snapshot taken after the lookups
+    const auto begin = std::chrono::steady_clock::now();
+    std::shared_ptr<const CacheStatsSnapshot> snapshot;
+    for (int i = 0; i < 1000; i++) {
+      snapshot = alloc.getStatsSnapshot();
+      if (snapshot && snapshot->time > begin) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_GT(snapshot->time, begin);
+    ASSERT_LE(10, snapshot->globalStats.numCacheGets);
+    ASSERT_EQ(1, snapshot->poolStats.count(poolId));
+    ASSERT_EQ(1, snapshot->poolStats.at(poolId).numItems());
+    auto isTestCounter = [](const auto& counter) {
+      return counter.first.rfind("test.", 0) == 0;
+    };
+    ASSERT_FALSE(snapshot->counters.empty());
+    ASSERT_TRUE(std::all_of(snapshot->counters.begin(),
+                            snapshot->counters.end(), isTestCounter));
+
+    ASSERT_TRUE(alloc.stopStatsSnapshotter());
+    ASSERT_EQ(nullptr, alloc.getStatsSnapshot());
+  }
+
+  // the background evictor evicts a batch at a time, skipping the items
+  // someone holds
+  void testTraverseAndEvictItems() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(10 * Slab::kSize);
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    const unsigned int keyLen = 100;
+    const auto sizes = this->getValidAllocSizes(alloc, poolId, 1, keyLen);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; i++) {
+      keys.push_back(this->getRandomNewKey(alloc, keyLen));
+      ASSERT_NE(nullptr, util::allocateAccessible(alloc, poolId, keys.back(),
+                                                  sizes[0]));
+    }
+    auto held = alloc.find(keys.front());
+    ASSERT_NE(nullptr, held);
+    const auto cid = alloc.getAllocInfo(held->getMemory()).classId;
+
+    const size_t batch = 10;
+    ASSERT_EQ(batch, alloc.traverseAndEvictItems(poolId, cid, batch));
+    ASSERT_EQ(batch, alloc.getPoolStats(poolId).numEvictions());
+    ASSERT_EQ(keys.size() - batch, alloc.getPoolStats(poolId).numItems());
+    ASSERT_NE(nullptr, alloc.find(keys.front()));
+
+    // no more than there is to evict
+    held.reset();
+    ASSERT_EQ(keys.size() - batch,
+              alloc.traverseAndEvictItems(poolId, cid, 1000));
+    ASSERT_EQ(0, alloc.getPoolStats(poolId).numItems());
+  }
+
+  // the cost aware eviction evicts the cheap items at the tail and decays the
+  // cost level of the expensive ones it passes over
+  void testCostAwareEviction() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(10 * Slab::kSize);
+    config.enableCostAwareEviction(5);
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    using Item = typename AllocatorT::Item;
+    ASSERT_EQ(0, Item::getCostLevelFor(std::chrono::microseconds{10}));
+    ASSERT_EQ(1, Item::getCostLevelFor(std::chrono::microseconds{11}));
+    ASSERT_EQ(5, Item::getCostLevelFor(std::chrono::milliseconds{10}));
+    ASSERT_EQ(Item::kMaxCostLevel,
+              Item::getCostLevelFor(std::chrono::seconds{1}));
+
+    // every other item is expensive
+    const unsigned int keyLen = 100;
+    const auto sizes = this->getValidAllocSizes(alloc, poolId, 1, keyLen);
+    auto getKey = [](int i) { return folly::sformat("key_{}", i); };
+    const int numKeys = 100;
+    ClassId cid = Slab::kInvalidClassId;
+    for (int i = 0; i < numKeys; i++) {
+      auto handle =
+          util::allocateAccessible(alloc, poolId, getKey(i), sizes[0]);
+      ASSERT_NE(nullptr, handle);
+      if (i % 2 == 0) {
+        handle->setCostLevel(Item::kMaxCostLevel);
+      }
+      cid = alloc.getAllocInfo(handle->getMemory()).classId;
+    }
+
+    const size_t batch = 10;
+    ASSERT_EQ(batch, alloc.traverseAndEvictItems(poolId, cid, batch));
+    for (int i = 0; i < numKeys; i++) {
+      // peek so that the items are not promoted
+      auto handle = alloc.peek(getKey(i));
+      if (i % 2 == 1) {
+        ASSERT_EQ(i >= 2 * static_cast<int>(batch), handle != nullptr);
+        continue;
+      }
+      ASSERT_NE(nullptr, handle);
+      // passed over once
+      ASSERT_EQ(i < 2 * static_cast<int>(batch) ? Item::kMaxCostLevel - 1
+                                                : Item::kMaxCostLevel,
+                handle->getCostLevel());
+    }
+
+    // the other flags are left alone
+    auto handle = alloc.peek(getKey(0));
+    ASSERT_NE(nullptr, handle);
+    auto& item = const_cast<Item&>(*handle);
+    item.markNvmClean();
+    item.setCostLevel(0);
+    ASSERT_EQ(0, item.getCostLevel());
+    ASSERT_TRUE(item.isNvmClean());
+  }
+
   // make some allocations without evictions, remove them and ensure that they
   // cannot be accessed through find.
   void testRemove() {
@@ -983,6 +1468,141 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     }
   }
 
+  // items removed with deferred release enabled are destroyed exactly once,
+  // on the background thread, and the ones still pending when the cache is
+  // destroyed are destroyed then.
+  void testDeferredItemRelease() {
+    std::mutex mutex;
+    std::map<std::string, int> destroyed;
+    std::set<std::thread::id> threads;
+    auto itemDestructor = [&](const typename AllocatorT::DestructorData& data) {
+      std::lock_guard<std::mutex> l(mutex);
+      destroyed[data.item.getKey().str()]++;
+      threads.insert(std::this_thread::get_id());
+    };
+    typename AllocatorT::Config config;
+    config.setItemDestructor(itemDestructor);
+    config.setCacheSize(100 * Slab::kSize);
+    config.enableDeferredItemRelease(std::chrono::milliseconds{10},
+                                     /* maxPending */ 1000,
+                                     /* batchSize */ 16);
+
+    const size_t numItems = 500;
+    {
+      AllocatorT alloc(config);
+      const auto poolId = alloc.addPool(
+          "default", alloc.getCacheMemoryStats().ramCacheSize);
+
+      for (size_t i = 0; i < numItems; i++) {
+        auto hdl = util::allocateAccessible(alloc, poolId,
+                                            folly::to<std::string>(i), 100);
+        ASSERT_NE(nullptr, hdl);
+      }
+      // nascent items are not destroyed
+      { auto hdl = alloc.allocate(poolId, "nascent", 100); }
+
+      for (size_t i = 0; i < numItems; i++) {
+        ASSERT_EQ(AllocatorT::RemoveRes::kSuccess,
+                  alloc.remove(folly::to<std::string>(i)));
+      }
+
+      // the removed items are destroyed in the background
+      for (int i = 0; i < 100; i++) {
+        {
+          std::lock_guard<std::mutex> l(mutex);
+          if (destroyed.size() == numItems) {
+            break;
+          }
+        }
+        /* sleep override */
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      }
+      {
+        std::lock_guard<std::mutex> l(mutex);
+        ASSERT_EQ(numItems, destroyed.size());
+        ASSERT_EQ(0, threads.count(std::this_thread::get_id()));
+      }
+      const auto stats = alloc.getDeferredReleaserStats();
+      ASSERT_EQ(numItems, stats.numDeferred);
+      ASSERT_EQ(0, stats.numPending);
+
+      // an item removed while a handle is held is released once the handle
+      // is dropped, and the pending ones are released when the cache is
+      // destroyed
+      for (int i = 0; i < 10; i++) {
+        auto key = folly::to<std::string>("held", i);
+        auto hdl = util::allocateAccessible(alloc, poolId, key, 100);
+        ASSERT_EQ(AllocatorT::RemoveRes::kSuccess, alloc.remove(key));
+      }
+    }
+
+    ASSERT_EQ(numItems + 10, destroyed.size());
+    for (const auto& [key, count] : destroyed) {
+      ASSERT_EQ(1, count) << key;
+    }
+    ASSERT_EQ(0, destroyed.count("nascent"));
+  }
+
+  // evicted items with deferred release enabled are destroyed exactly once,
+  // on the background thread, with a copy that holds their key and value.
+  void testDeferredEvictionCallbacks() {
+    std::mutex mutex;
+    std::map<std::string, int> destroyed;
+    std::set<std::thread::id> threads;
+    bool intact = true;
+    auto itemDestructor = [&](const typename AllocatorT::DestructorData& data) {
+      ASSERT_EQ(DestructorContext::kEvictedFromRAM, data.context);
+      const auto key = data.item.getKey().str();
+      const auto* value =
+          reinterpret_cast<const char*>(data.item.getMemory());
+      std::lock_guard<std::mutex> l(mutex);
+      destroyed[key]++;
+      threads.insert(std::this_thread::get_id());
+      intact = intact && data.item.getSize() == 10 * 1024 &&
+               std::all_of(value, value + data.item.getSize(),
+                           [&](char c) { return c == key.back(); });
+    };
+    typename AllocatorT::Config config;
+    config.setItemDestructor(itemDestructor);
+    config.setCacheSize(100 * Slab::kSize);
+    config.enableDeferredItemRelease(std::chrono::milliseconds{10},
+                                     /* maxPending */ 100000,
+                                     /* batchSize */ 16);
+
+    AllocatorT alloc(config);
+    const auto poolId = alloc.addPool("default", 4 * Slab::kSize);
+
+    const size_t numItems = 5000;
+    for (size_t i = 0; i < numItems; i++) {
+      const auto key = folly::to<std::string>(i);
+      auto hdl = util::allocateAccessible(alloc, poolId, key, 10 * 1024);
+      ASSERT_NE(nullptr, hdl);
+      std::memset(hdl->getMemory(), key.back(), hdl->getSize());
+    }
+
+    const auto numEvictions = alloc.getGlobalCacheStats().numEvictions;
+    ASSERT_LT(0, numEvictions);
+    for (int i = 0; i < 100; i++) {
+      {
+        std::lock_guard<std::mutex> l(mutex);
+        if (destroyed.size() == numEvictions) {
+          break;
+        }
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    std::lock_guard<std::mutex> l(mutex);
+    ASSERT_EQ(numEvictions, destroyed.size());
+    for (const auto& [key, count] : destroyed) {
+      ASSERT_EQ(1, count) << key;
+      ASSERT_EQ(nullptr, alloc.peek(key));
+    }
+    ASSERT_EQ(0, threads.count(std::this_thread::get_id()));
+    ASSERT_TRUE(intact);
+  }
+
   // do slab release and make sure that moved items dont get call backs issued
   // and evicted items get remove cb executed.
   void testRemoveCbSlabReleaseMoving() {
@@ -1042,6 +1662,49 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     ASSERT_NE(0, movedKeys.size());
   }
 
+  // the items of a released slab are moved in batches when there is room
+  // for them elsewhere in the pool
+  void testSlabReleaseMoveBatches() {
+    typename AllocatorT::Config config;
+    using Item = typename AllocatorT::Item;
+    config.setCacheSize(4 * Slab::kSize);
+
+    std::set<std::string> movedKeys;
+    auto moveCb = [&](const Item& oldItem, Item&, Item* /* parentPtr */) {
+      movedKeys.insert(oldItem.getKey().str());
+    };
+    config.enableMovingOnSlabRelease(moveCb, {}, 10);
+    config.setSlabReleaseMoveBatchSize(16);
+
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    const uint32_t size = 16 * 1024;
+    auto poolId = alloc.addPool("foobar", numBytes, {size});
+    auto& pool = alloc.getPool(poolId);
+
+    // fill a slab and part of a second one
+    const int numItems = Slab::kSize / size + 10;
+    for (int i = 0; i < numItems; i++) {
+      ASSERT_TRUE(util::allocateAccessible(alloc, poolId, std::to_string(i),
+                                           size - 100));
+    }
+
+    auto hint = alloc.find(std::to_string(0)).get();
+    alloc.releaseSlab(poolId, pool.getAllocationClassId(size),
+                      SlabReleaseMode::kRebalance, hint);
+
+    const auto stats = alloc.getSlabReleaseStats();
+    ASSERT_NE(0, movedKeys.size());
+    ASSERT_EQ(movedKeys.size(), stats.numMoveSuccesses);
+    ASSERT_LT(0, stats.numMoveBatches);
+    ASSERT_LT(stats.numMoveBatches, stats.numMoveSuccesses);
+    ASSERT_DOUBLE_EQ(1.0, stats.getMovedRatio());
+    ASSERT_DOUBLE_EQ(0.0, stats.getEvictedRatio());
+    for (int i = 0; i < numItems; i++) {
+      ASSERT_NE(nullptr, alloc.find(std::to_string(i)));
+    }
+  }
+
   void testRemoveCbSlabRelease() {
     std::set<std::string> evictedKeys;
     std::set<std::string> removedKeys;
@@ -1415,6 +2078,39 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     ASSERT_EQ(AllocatorT::ShutDownStatus::kSuccess, alloc.shutDown());
   }
 
+  // stop the workers concurrently on shut down and restore the cache
+  void testParallelShutDown() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(10 * Slab::kSize);
+    config.enableCachePersistence(this->cacheDir_);
+    config.enableParallelShutdown();
+    config.enablePoolRebalancing(
+        std::make_shared<RebalanceStrategy>(), std::chrono::seconds{1});
+    config.enablePoolResizing(
+        std::make_shared<RebalanceStrategy>(), std::chrono::seconds{1}, 1);
+    config.reaperInterval = std::chrono::seconds(1);
+
+    {
+      AllocatorT alloc(AllocatorT::SharedMemNew, config);
+      auto poolId =
+          alloc.addPool("foo", alloc.getCacheMemoryStats().ramCacheSize);
+      util::allocateAccessible(alloc, poolId, "hello", 1000);
+      ASSERT_EQ(AllocatorT::ShutDownStatus::kSuccess, alloc.shutDown());
+
+      const auto& timings = alloc.getShutDownTimings();
+      EXPECT_GE(timings.total, timings.stopWorkers + timings.saveRamCache +
+                                   timings.shmShutDown);
+      EXPECT_EQ(std::chrono::milliseconds{0}, timings.saveNvmCache);
+    }
+
+    testShmIsNotRemoved(config);
+
+    {
+      AllocatorT alloc(AllocatorT::SharedMemAttach, config);
+      ASSERT_NE(nullptr, alloc.find("hello"));
+    }
+  }
+
   void testAttachDetachOnExit() {
     typename AllocatorT::Config config;
     config.setCacheSize(10 * Slab::kSize);
@@ -1710,6 +2406,112 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     testShmIsRemoved(config);
   }
 
+  // Asking for huge pages falls back to regular pages when they are not
+  // reserved on the host and the page size the cache was created with is
+  // kept across restarts.
+  void testMemoryPageSize() {
+    const size_t normalPageSize = detail::getPageSize(PageSizeT::NORMAL);
+    const size_t hugePageSize = detail::getPageSize(PageSizeT::TWO_MB);
+    const uint8_t poolId = 0;
+
+    typename AllocatorT::Config config;
+    config.setCacheSize(20 * Slab::kSize);
+    config.setMemoryPageSize(PageSizeT::TWO_MB);
+
+    auto checkPageSizes = [&](AllocatorT& alloc) {
+      const auto pageSizes = alloc.getMemoryPageSizes();
+      const auto it = pageSizes.find(detail::kShmCacheName);
+      EXPECT_NE(pageSizes.end(), it);
+      EXPECT_TRUE(it->second == normalPageSize || it->second == hugePageSize);
+      auto handle = util::allocateAccessible(alloc, poolId, "key", 1000);
+      EXPECT_NE(nullptr, handle);
+      return it->second;
+    };
+
+    {
+      AllocatorT alloc(config);
+      alloc.addPool("default", alloc.getCacheMemoryStats().ramCacheSize);
+      const auto pageSize = checkPageSizes(alloc);
+      ASSERT_EQ(1, alloc.getMemoryPageSizes().size());
+
+      if (pageSize == normalPageSize) {
+        auto strictConfig = config;
+        strictConfig.setMemoryPageSize(PageSizeT::TWO_MB, false);
+        ASSERT_THROW(AllocatorT{strictConfig}, std::system_error);
+      }
+    }
+
+    config.enableCachePersistence(this->cacheDir_);
+    size_t pageSize = 0;
+    {
+      AllocatorT alloc(AllocatorT::SharedMemNew, config);
+      alloc.addPool("default", alloc.getCacheMemoryStats().ramCacheSize);
+      pageSize = checkPageSizes(alloc);
+      ASSERT_EQ(AllocatorT::ShutDownStatus::kSuccess, alloc.shutDown());
+    }
+
+    // the page size is not taken from the config when attaching
+    config.setMemoryPageSize(PageSizeT::NORMAL);
+    {
+      AllocatorT alloc(AllocatorT::SharedMemAttach, config);
+      ASSERT_EQ(pageSize, checkPageSizes(alloc));
+      ASSERT_NE(nullptr, alloc.find("key"));
+    }
+    testShmIsRemoved(config);
+  }
+
+  // With two memory tiers every pool gets a lower tier pool. Items evicted
+  // from the upper tier are demoted into it and come back once they are hit
+  // often enough.
+  void testMemoryTiers() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(20 * Slab::kSize);
+    config.configureMemoryTiers(
+        {MemoryTierCacheConfig::fromShm().setRatio(1),
+         MemoryTierCacheConfig::fromShm().setRatio(1)});
+    // keep the background promoter out of the way after its first run
+    config.setMemoryTierPromotion(2, std::chrono::hours{1});
+
+    AllocatorT alloc(config);
+    const auto pid =
+        alloc.addPool("default", alloc.getCacheMemoryStats().ramCacheSize);
+    const auto lowerPid = alloc.getPoolId("default#tier1");
+    ASSERT_NE(Slab::kInvalidPoolId, lowerPid);
+    ASSERT_NE(pid, lowerPid);
+
+    int i = 0;
+    while (alloc.getGlobalCacheStats().numMemoryTierDemotions == 0) {
+      auto handle = util::allocateAccessible(
+          alloc, pid, folly::sformat("key{}", i), sizeof(int));
+      ASSERT_NE(nullptr, handle);
+      *handle->template getMemoryAs<int>() = i++;
+    }
+
+    // the oldest item now lives in the lower tier with its value intact
+    ClassId cid;
+    {
+      auto handle = alloc.find("key0");
+      ASSERT_NE(nullptr, handle);
+      const auto allocInfo = alloc.getAllocInfo(handle->getMemory());
+      ASSERT_EQ(lowerPid, allocInfo.poolId);
+      ASSERT_EQ(0, *handle->template getMemoryAs<int>());
+      cid = allocInfo.classId;
+    }
+    ASSERT_NE(nullptr, alloc.find("key0"));
+
+    alloc.traverseAndPromoteItems(lowerPid, cid, 10);
+    auto handle = alloc.find("key0");
+    ASSERT_NE(nullptr, handle);
+    ASSERT_EQ(pid, alloc.getAllocInfo(handle->getMemory()).poolId);
+    ASSERT_EQ(0, *handle->template getMemoryAs<int>());
+
+    const auto stats = alloc.getGlobalCacheStats();
+    ASSERT_EQ(1, stats.numMemoryTierPromotions);
+    ASSERT_LE(1, stats.numMemoryTierPromotionsQueued);
+    ASSERT_EQ(0, stats.numMemoryTierPromotionFailures);
+    ASSERT_EQ(2, stats.memoryTierStats.size());
+  }
+
   // Test temporary shared memory mode which is enabled when memory
   // monitoring is enabled.
   void testShmTemporary() {
@@ -2187,6 +2989,49 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     ASSERT_EQ(0, alloc.getNumActiveHandles());
   }
 
+  // a read handle converts into IOBufs over the item memory, which hold the
+  // reference of the handle
+  void testReadHandleToIOBuf() {
+    typename AllocatorT::Config config;
+    config.configureChainedItems();
+    config.setCacheSize(10 * Slab::kSize);
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    {
+      auto parent = util::allocateAccessible(alloc, poolId, "parent", 100);
+      *reinterpret_cast<char*>(parent->getMemory()) = 'p';
+      for (int i = 0; i < 3; ++i) {
+        auto chained = alloc.allocateChainedItem(parent, 100);
+        *reinterpret_cast<int*>(chained->getMemory()) = i;
+        alloc.addChainedItem(parent, std::move(chained));
+      }
+    }
+
+    typename AllocatorT::ReadHandle empty{};
+    ASSERT_THROW(std::move(empty).toIOBuf(), std::invalid_argument);
+
+    auto handle = alloc.find("parent");
+    const auto* memory = handle->getMemory();
+    auto ioBuf = std::move(handle).toIOBuf();
+    ASSERT_EQ(nullptr, handle);
+    ASSERT_EQ(1, alloc.getNumActiveHandles());
+
+    // the IOBufs point to the item memory, in insertion order
+    ASSERT_EQ(memory, ioBuf.data());
+    ASSERT_EQ(100, ioBuf.length());
+    ASSERT_EQ(4, ioBuf.countChainElements());
+    const auto* curr = ioBuf.next();
+    for (int i = 0; i < 3; ++i, curr = curr->next()) {
+      ASSERT_EQ(i, *reinterpret_cast<const int*>(curr->data()));
+    }
+    ASSERT_EQ(4, ioBuf.getIov().size());
+
+    ioBuf = folly::IOBuf{};
+    ASSERT_EQ(0, alloc.getNumActiveHandles());
+  }
+
   // Make sure we can convert a chain of cached items into a chain of IOBufs
   void testIOBufItemHandleForChainedItems() {
     std::atomic<int> itemsRemoved{0};
@@ -2630,6 +3475,107 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     }
   }
 
+  void testLargeItem() {
+    typename AllocatorT::Config config;
+    config.configureChainedItems();
+    config.setCacheSize(10 * Slab::kSize);
+    AllocatorT alloc(config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    ASSERT_THROW(alloc.allocateLargeItem(poolId, "large", 100, 0),
+                 std::invalid_argument);
+
+    // 12 chunks of 4000 bytes and a last one of 2000
+    const uint64_t size = 50000;
+    const uint32_t chunkSize = 4000;
+    {
+      auto parent = alloc.allocateLargeItem(poolId, "large", size, chunkSize);
+      ASSERT_NE(nullptr, parent);
+      ASSERT_TRUE(alloc.isLargeItem(*parent));
+      auto view = alloc.viewAsWritableLargeItem(parent);
+      ASSERT_EQ(size, view.getSize());
+      ASSERT_EQ(13, view.getNumChunks());
+      ASSERT_EQ(2000, view.getChunk(12).getSize());
+      uint64_t offset = 0;
+      for (size_t i = 0; i < view.getNumChunks(); i++) {
+        auto& chunk = view.getChunk(i);
+        auto* data = reinterpret_cast<uint8_t*>(chunk.getMemory());
+        for (uint32_t j = 0; j < chunk.getSize(); j++) {
+          data[j] = static_cast<uint8_t>((offset + j) % 251);
+        }
+        offset += chunk.getSize();
+      }
+      alloc.insertOrReplace(parent);
+    }
+    auto other = util::allocateAccessible(alloc, poolId, "other", 100);
+    ASSERT_FALSE(alloc.isLargeItem(*other));
+
+    // a regular parent whose payload looks like the index of a large item
+    // is not one
+    {
+      using Layout =
+          LargeItemLayout<typename AllocatorT::Item::CompressedPtrType>;
+      auto forged = util::allocateAccessible(alloc, poolId, "forged",
+                                             Layout::getParentSize(1));
+      ASSERT_NE(nullptr, forged);
+      auto chained = alloc.allocateChainedItem(forged, 100);
+      ASSERT_NE(nullptr, chained);
+      alloc.addChainedItem(forged, std::move(chained));
+      Layout::initHeader(forged->getMemory(), 100, 1);
+      ASSERT_FALSE(alloc.isLargeItem(*forged));
+      ASSERT_THROW(alloc.viewAsLargeItem(forged), std::invalid_argument);
+      ASSERT_NE(nullptr, alloc.popChainedItem(forged));
+    }
+
+    auto checkValue = [&](const typename AllocatorT::ReadHandle& hdl) {
+      ASSERT_NE(nullptr, hdl);
+      std::vector<uint8_t> expected(size);
+      for (uint64_t i = 0; i < size; i++) {
+        expected[i] = static_cast<uint8_t>(i % 251);
+      }
+      std::vector<uint8_t> value(size);
+      alloc.viewAsLargeItem(hdl).copyTo(value.data());
+      ASSERT_EQ(expected, value);
+
+      auto iobuf = alloc.viewAsLargeItem(hdl).toIOBuf();
+      ASSERT_EQ(size, iobuf->computeChainDataLength());
+      auto range = iobuf->coalesce();
+      ASSERT_EQ(0, std::memcmp(expected.data(), range.data(), size));
+
+      // the handle converts into the chunks only
+      auto converted = hdl.clone().toIOBuf();
+      ASSERT_EQ(size, converted.computeChainDataLength());
+      ASSERT_EQ(0, std::memcmp(expected.data(), converted.coalesce().data(),
+                               size));
+    };
+    checkValue(alloc.find("large"));
+
+    // a replaced chunk is indexed in place of the old one
+    {
+      auto parent = alloc.findToWrite("large");
+      ASSERT_THROW(alloc.popChainedItem(parent), std::invalid_argument);
+      auto* oldChunk = &alloc.viewAsWritableLargeItem(parent).getChunk(3);
+      auto newChunk = alloc.allocateChainedItem(parent, oldChunk->getSize());
+      std::memcpy(newChunk->getMemory(), oldChunk->getMemory(),
+                  oldChunk->getSize());
+      auto* newMemory = newChunk->getMemory();
+      alloc.replaceChainedItem(*oldChunk, std::move(newChunk), *parent);
+      ASSERT_EQ(newMemory,
+                alloc.viewAsLargeItem(parent).getChunk(3).getMemory());
+    }
+    checkValue(alloc.find("large"));
+
+    // the index is rebuilt from the chain, e.g. after a fill from nvmcache
+    {
+      auto parent = alloc.findToWrite("large");
+      const auto* first = alloc.viewAsLargeItem(parent).getChunk(0).getMemory();
+      ASSERT_TRUE(alloc.rebuildLargeItemIndex(*parent));
+      ASSERT_EQ(first, alloc.viewAsLargeItem(parent).getChunk(0).getMemory());
+    }
+    checkValue(alloc.find("large"));
+  }
+
   void testChainedAllocsTransfer() {
     typename AllocatorT::Config config;
     config.configureChainedItems();
@@ -4012,6 +4958,62 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     EXPECT_LE(stats.lastTraversalTimeMs, util::getCurrentTimeMs() - startTime);
   }
 
+  void testReaperExpiryIndex() {
+    const int numSlabs = 4;
+
+    typename AllocatorT::Config config;
+    config.setCacheSize((numSlabs + 1) * Slab::kSize);
+    config.enableItemReaperInBackground(std::chrono::milliseconds{50}, {});
+    // never walk the whole cache to only reap through the index
+    config.enableReaperExpiryIndex(0);
+
+    AllocatorT allocator(config);
+
+    const size_t numBytes = allocator.getCacheMemoryStats().ramCacheSize;
+    auto poolId = allocator.addPool("default", numBytes);
+
+    // items with a ttl and items without one land in slabs of their own
+    const unsigned int ttlSecs = 2;
+    const int numItems = 10;
+    for (int i = 0; i < numItems; i++) {
+      util::allocateAccessible(allocator, poolId,
+                               folly::sformat("ttl_{}", i), 100, ttlSecs);
+      util::allocateAccessible(allocator, poolId,
+                               folly::sformat("no_ttl_{}", i), 10000);
+    }
+
+    // slabs with nothing to expire are skipped once walked
+    auto stats = allocator.getReaperStats();
+    while (stats.numIndexSkippedSlabs == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      stats = allocator.getReaperStats();
+    }
+    EXPECT_EQ(0, stats.numReapedItems);
+
+    std::this_thread::sleep_for(std::chrono::seconds(ttlSecs + 1));
+    const auto prev = stats.numTraversals;
+    while (stats.numTraversals - prev < 5) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      stats = allocator.getReaperStats();
+    }
+    EXPECT_EQ(numItems, stats.numReapedItems);
+    for (int i = 0; i < numItems; i++) {
+      EXPECT_EQ(nullptr, allocator.peek(folly::sformat("ttl_{}", i)));
+      EXPECT_NE(nullptr, allocator.peek(folly::sformat("no_ttl_{}", i)));
+    }
+
+    // the ttl slab is skipped too once it has nothing left to expire
+    const auto visited = stats.numVisitedItems;
+    const auto skipped = stats.numIndexSkippedSlabs;
+    const auto traversals = stats.numTraversals;
+    while (stats.numTraversals - traversals < 5) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      stats = allocator.getReaperStats();
+    }
+    EXPECT_EQ(visited, stats.numVisitedItems);
+    EXPECT_GE(stats.numIndexSkippedSlabs - skipped, 10);
+  }
+
   void testReaperOutOfBound() {
     // This test is to test a reaper will not crash when it is checking the last
     // item in a slab and it happens to have a large key beyond the end of cache
@@ -5463,6 +6465,39 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     }
   }
 
+  void testSampledEvictionAges() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(10 * Slab::kSize);
+    config.enableSampledEvictionAges(1 /* sampleRate */, 1024 /* window */);
+    AllocatorT alloc(config);
+    const std::set<uint32_t> allocSizes{100};
+    const auto poolId = alloc.addPool(
+        "default", alloc.getCacheMemoryStats().ramCacheSize, allocSizes);
+
+    {
+      const auto stats = alloc.getPoolEvictionAgeStats(poolId, 0);
+      ASSERT_EQ(0, stats.getSampledEvictionStat(0).numSamples);
+    }
+
+    // fill the cache a few times over so that every sample is an eviction
+    // of an item that was just inserted
+    const size_t numItems = 3 * 10 * Slab::kSize / 100;
+    for (size_t i = 0; i < numItems; i++) {
+      util::allocateAccessible(alloc, poolId, folly::sformat("key_{}", i), 10);
+    }
+    ASSERT_LT(0, alloc.getPoolStats(poolId).numEvictions());
+
+    const auto stats = alloc.getPoolEvictionAgeStats(poolId, 0);
+    const auto& sampled = stats.getSampledEvictionStat(0);
+    // older samples are halved once the window is full
+    ASSERT_LT(0, sampled.numSamples);
+    ASSERT_GE(1024, sampled.numSamples);
+    ASSERT_LE(sampled.p10, sampled.p50);
+    ASSERT_LE(sampled.p50, sampled.p90);
+    ASSERT_LE(sampled.p90, sampled.p99);
+    ASSERT_GE(10, sampled.p50);
+  }
+
   void testReplaceInMMContainer() {
     typename AllocatorT::Config config;
     config.setCacheSize(10 * Slab::kSize);
@@ -6297,6 +7332,105 @@ class BaseAllocatorTest : public AllocatorTest<AllocatorT> {
     EXPECT_EQ(intervalNameExists, 4);
   }
 
+  // stream the hot items of a cache into another one
+  void testWarmUpStreaming() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(20 * Slab::kSize);
+    AllocatorT src(config);
+    AllocatorT dst(config);
+    const size_t numBytes = src.getCacheMemoryStats().ramCacheSize;
+    const auto srcPid = src.addPool("default", numBytes / 2);
+    const auto dstPid = dst.addPool("default", numBytes / 2);
+
+    const int numKeys = 1000;
+    for (int i = 0; i < numKeys; i++) {
+      const auto key = folly::sformat("key_{}", i);
+      const auto value = folly::sformat("value_{}", i);
+      auto hdl = src.allocate(srcPid, key, value.size(), i % 2 ? 3600 : 0);
+      ASSERT_NE(nullptr, hdl);
+      std::memcpy(hdl->getMemory(), value.data(), value.size());
+      src.insertOrReplace(hdl);
+    }
+    // items with chained items are not streamed
+    {
+      auto parent = src.allocate(srcPid, "parent", 10);
+      ASSERT_NE(nullptr, parent);
+      auto chained = src.allocateChainedItem(parent, 10);
+      ASSERT_NE(nullptr, chained);
+      src.addChainedItem(parent, std::move(chained));
+      src.insertOrReplace(parent);
+    }
+
+    // the hot items of a class are the most recently used ones
+    const auto cid = src.getAllocInfo(src.find("key_0")->getMemory()).classId;
+    auto hot = src.getHotItems(srcPid, cid, 10);
+    ASSERT_EQ(10, hot.size());
+    std::set<std::string> hotKeys;
+    for (const auto& hdl : hot) {
+      hotKeys.insert(hdl->getKey().str());
+    }
+    EXPECT_EQ(10, hotKeys.size());
+    ASSERT_EQ(0, src.getHotItems(srcPid, cid, 0).size());
+
+    WarmUpConfig warmUpConfig;
+    warmUpConfig.batchSize = 64;
+    std::vector<std::unique_ptr<folly::IOBuf>> batches;
+    auto sent = streamHotItems(
+        src, warmUpConfig,
+        [&](folly::StringPiece pool, std::unique_ptr<folly::IOBuf> batch) {
+          EXPECT_EQ("default", pool);
+          batches.push_back(std::move(batch));
+          return true;
+        });
+    EXPECT_EQ(numKeys, sent.numItems);
+    EXPECT_EQ(1, sent.numChainedSkipped);
+    EXPECT_EQ(batches.size(), sent.numBatches);
+    EXPECT_EQ((numKeys + 63) / 64, batches.size());
+
+    WarmUpStats inserted;
+    for (const auto& batch : batches) {
+      auto stats = insertWarmUpBatch(dst, dstPid, *batch);
+      inserted.numItems += stats.numItems;
+      inserted.numExisting += stats.numExisting;
+    }
+    EXPECT_EQ(numKeys, inserted.numItems);
+    EXPECT_EQ(0, inserted.numExisting);
+    for (int i = 0; i < numKeys; i++) {
+      auto hdl = dst.find(folly::sformat("key_{}", i));
+      ASSERT_NE(nullptr, hdl);
+      EXPECT_EQ(folly::sformat("value_{}", i),
+                folly::StringPiece(
+                    reinterpret_cast<const char*>(hdl->getMemory()),
+                    hdl->getSize()));
+      // the remaining ttl is sent
+      const auto ttl = hdl->getConfiguredTTL().count();
+      if (i % 2) {
+        EXPECT_LE(3590, ttl);
+        EXPECT_GE(3600, ttl);
+      } else {
+        EXPECT_EQ(0, ttl);
+      }
+    }
+    EXPECT_EQ(nullptr, dst.find("parent"));
+
+    // the values already in the cache are kept
+    EXPECT_EQ(64, insertWarmUpBatch(dst, dstPid, *batches[0]).numExisting);
+
+    // the sink stops the stream
+    size_t numBatches = 0;
+    sent = streamHotItems(
+        src, warmUpConfig,
+        [&](folly::StringPiece, std::unique_ptr<folly::IOBuf>) {
+          return ++numBatches < 2;
+        });
+    EXPECT_EQ(2, numBatches);
+    EXPECT_EQ(2 * 64, sent.numItems);
+
+    auto notABatch = folly::IOBuf::copyBuffer("not a warm up batch");
+    EXPECT_THROW(insertWarmUpBatch(dst, dstPid, *notABatch),
+                 std::invalid_argument);
+  }
+
   void testProvisionPool() {
     typename AllocatorT::Config config;
     config.setCacheSize(20 * Slab::kSize);
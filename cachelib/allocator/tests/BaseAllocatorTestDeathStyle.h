@@ -19,6 +19,7 @@
 #include <folly/Random.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <future>
@@ -77,6 +78,82 @@ class BaseAllocatorTestDeathStyle : public AllocatorTest<AllocatorT> {
                              allocSize),
                  ".*");
   }
+
+  // look up keys through the read only cache view while the cache keeps
+  // changing them.
+  void testReadOnlyCacheViewFind() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(20 * Slab::kSize);
+    config.setAccessConfig({10 /* bucketsPower */, 5 /* locksPower */});
+    config.enableCachePersistence(this->cacheDir_);
+
+    AllocatorT alloc(AllocatorT::SharedMemNew, config);
+    const size_t numBytes = alloc.getCacheMemoryStats().ramCacheSize;
+    auto poolId = alloc.addPool("foobar", numBytes);
+
+    // more keys than buckets, so that the hash chains are walked
+    const int numKeys = 4000;
+    auto valueOf = [](int i, int version) {
+      return folly::sformat("value_{}_{}", i, version);
+    };
+    for (int i = 0; i < numKeys; i++) {
+      const auto value = valueOf(i, 0);
+      auto hdl = util::allocateAccessible(
+          alloc, poolId, folly::to<std::string>(i), value.size());
+      ASSERT_NE(hdl, nullptr);
+      std::memcpy(hdl->getMemory(), value.data(), value.size());
+    }
+
+    using LookupResult = ReadOnlySharedCacheView::LookupResult;
+    auto roCache = ReadOnlySharedCacheView(config.cacheDir, config.usePosixShm);
+    std::string value;
+    for (int i = 0; i < numKeys; i++) {
+      ASSERT_EQ(LookupResult::kFound,
+                roCache.find<AllocatorT>(folly::to<std::string>(i), value,
+                                         config.accessConfig));
+      ASSERT_EQ(valueOf(i, 0), value);
+    }
+    ASSERT_EQ(LookupResult::kNotFound,
+              roCache.find<AllocatorT>("missing", value, config.accessConfig));
+
+    alloc.remove("0");
+    ASSERT_EQ(LookupResult::kNotFound,
+              roCache.find<AllocatorT>("0", value, config.accessConfig));
+
+    // the owner replaces the values while the view reads them. A lookup
+    // either sees a complete value or reports the conflict.
+    std::atomic<bool> stop{false};
+    std::thread writer{[&] {
+      for (int version = 1; !stop; version++) {
+        for (int i = 1; i < numKeys; i++) {
+          const auto newValue = valueOf(i, version);
+          auto hdl = alloc.allocate(poolId, folly::to<std::string>(i),
+                                    newValue.size());
+          if (hdl) {
+            std::memcpy(hdl->getMemory(), newValue.data(), newValue.size());
+            alloc.insertOrReplace(hdl);
+          }
+        }
+      }
+    }};
+    for (int round = 0; round < 5; round++) {
+      for (int i = 1; i < numKeys; i++) {
+        const auto key = folly::to<std::string>(i);
+        if (roCache.find<AllocatorT>(key, value, config.accessConfig) ==
+            LookupResult::kFound) {
+          ASSERT_TRUE(folly::StringPiece{value}.startsWith(
+              folly::sformat("value_{}_", i)))
+              << value;
+        }
+      }
+    }
+    stop = true;
+    writer.join();
+
+    EXPECT_THROW(roCache.find<AllocatorT>(
+                     "1", value, {12 /* bucketsPower */, 5 /* locksPower */}),
+                 std::invalid_argument);
+  }
 };
 } // namespace tests
 } // namespace cachelib
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <thread>
+
 #include "cachelib/allocator/ChainedHashTable.h"
 #include "cachelib/allocator/tests/AccessTypeTest.h"
 
@@ -83,6 +85,250 @@ TEST_F(ChainedHashTest, Chaining) {
   }
 }
 
+TEST_F(ChainedHashTest, FindBatch) {
+  using HashConfig = ChainedHashTable::Config;
+  const unsigned int bucketsPower = 10;
+  const unsigned int locksPower = 2;
+  HashConfig config{bucketsPower, locksPower};
+
+  Container c{std::move(config), typename Node::PtrCompressor()};
+  auto nodes = createSimpleContainer(c);
+
+  // interleave present and missing keys
+  std::vector<std::string> keyStrs;
+  for (const auto& node : nodes) {
+    keyStrs.push_back(node->getKey().str());
+    keyStrs.push_back(getRandomNewKey(c));
+  }
+  std::vector<Node::Key> keys;
+  for (const auto& k : keyStrs) {
+    keys.emplace_back(k);
+  }
+
+  auto handles = c.findBatch(folly::range(keys));
+  ASSERT_EQ(keys.size(), handles.size());
+  for (size_t i = 0; i < handles.size(); i++) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(nodes[i / 2].get(), handles[i].get());
+    } else {
+      ASSERT_EQ(nullptr, handles[i]);
+    }
+  }
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(1u, node->getRefCount());
+  }
+  handles.clear();
+  for (const auto& node : nodes) {
+    ASSERT_EQ(0u, node->getRefCount());
+  }
+
+  ASSERT_TRUE(c.findBatch({}).empty());
+}
+
+TEST_F(ChainedHashTest, FindBatchInterleaved) {
+  using HashConfig = ChainedHashTable::Config;
+  // few buckets so that lookups have to walk long chains
+  const unsigned int bucketsPower = 4;
+  const unsigned int locksPower = 2;
+  HashConfig config{bucketsPower, locksPower};
+  ASSERT_THROW(config.setNumInterleavedLookups(
+                   HashConfig::kMaxInterleavedLookups + 1),
+               std::invalid_argument);
+  config.setNumInterleavedLookups(8);
+
+  Container c{std::move(config), typename Node::PtrCompressor()};
+  auto nodes = createSimpleContainer(c);
+
+  std::vector<std::string> keyStrs;
+  for (const auto& node : nodes) {
+    keyStrs.push_back(getRandomNewKey(c));
+    keyStrs.push_back(node->getKey().str());
+  }
+  std::vector<Node::Key> keys;
+  for (const auto& k : keyStrs) {
+    keys.emplace_back(k);
+  }
+
+  // batches smaller and larger than the number of interleaved lookups
+  for (size_t batchSize : {1, 3, 8, 13, 64}) {
+    for (size_t start = 0; start < keys.size(); start += batchSize) {
+      const size_t end = std::min(keys.size(), start + batchSize);
+      auto handles =
+          c.findBatch(folly::range(keys.data() + start, keys.data() + end));
+      ASSERT_EQ(end - start, handles.size());
+      for (size_t i = start; i < end; i++) {
+        if (i % 2 == 1) {
+          ASSERT_EQ(nodes[i / 2].get(), handles[i - start].get());
+        } else {
+          ASSERT_EQ(nullptr, handles[i - start]);
+        }
+      }
+    }
+  }
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(0u, node->getRefCount());
+  }
+}
+
+TEST_F(ChainedHashTest, OptimisticReads) {
+  using HashConfig = ChainedHashTable::Config;
+  const unsigned int bucketsPower = 6;
+  const unsigned int locksPower = 2;
+  HashConfig config{bucketsPower, locksPower};
+  config.setOptimisticReads(true);
+  ASSERT_TRUE(config.isOptimisticReadsEnabled());
+
+  Container c{std::move(config), typename Node::PtrCompressor()};
+  auto nodes = createSimpleContainer(c);
+  for (const auto& node : nodes) {
+    auto handle = c.find(node->getKey());
+    ASSERT_EQ(node.get(), handle.get());
+    ASSERT_EQ(1u, node->getRefCount());
+  }
+
+  // readers racing with writers removing and re-inserting half the nodes
+  // must only ever see the node for their key.
+  std::atomic<bool> stop{false};
+  std::thread writer([&]() {
+    while (!stop) {
+      for (size_t i = 0; i < nodes.size(); i += 2) {
+        c.remove(*nodes[i]);
+        c.insert(*nodes[i]);
+      }
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      for (int iter = 0; iter < 20; iter++) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+          auto handle = c.find(nodes[i]->getKey());
+          if (i % 2 == 1) {
+            ASSERT_EQ(nodes[i].get(), handle.get());
+          } else if (handle) {
+            ASSERT_EQ(nodes[i].get(), handle.get());
+          }
+        }
+      }
+    });
+  }
+  for (auto& r : readers) {
+    r.join();
+  }
+  stop = true;
+  writer.join();
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(0u, node->getRefCount());
+  }
+}
+
+TEST_F(ChainedHashTest, SynchronizeOptimisticReads) {
+  // a no-op without lock-free reads
+  Container locked{Config{6, 2}, PtrCompressor{}};
+  locked.synchronizeOptimisticReads();
+
+  Container c{Config{6, 2}.setOptimisticReads(true), PtrCompressor{}};
+  auto nodes = createSimpleContainer(c);
+  c.synchronizeOptimisticReads();
+
+  std::vector<std::string> keys;
+  for (const auto& node : nodes) {
+    keys.push_back(node->getKey().str());
+  }
+
+  // once a removed node is synchronized and no handle refers to it, its
+  // memory can be freed while readers keep looking up its key.
+  std::atomic<bool> stop{false};
+  std::thread writer([&]() {
+    while (!stop) {
+      for (size_t i = 0; i < nodes.size(); i += 2) {
+        ASSERT_TRUE(c.remove(*nodes[i]));
+        c.synchronizeOptimisticReads();
+        while (nodes[i]->getRefCount() != 0) {
+          std::this_thread::yield();
+        }
+        nodes[i] = std::make_unique<Node>(keys[i]);
+        ASSERT_TRUE(c.insert(*nodes[i]));
+      }
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      for (int iter = 0; iter < 20; iter++) {
+        for (const auto& key : keys) {
+          auto handle = c.find(key);
+          if (handle) {
+            ASSERT_EQ(key, handle->getKey().str());
+          }
+        }
+      }
+    });
+  }
+  for (auto& r : readers) {
+    r.join();
+  }
+  stop = true;
+  writer.join();
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(0u, node->getRefCount());
+  }
+}
+
+TEST_F(ChainedHashTest, LazyBucketInit) {
+  using HashConfig = ChainedHashTable::Config;
+  const unsigned int bucketsPower = 14;
+  const unsigned int locksPower = 4;
+  HashConfig config{bucketsPower, locksPower};
+  config.setLazyBucketInit(true);
+  ASSERT_TRUE(config.isLazyBucketInitEnabled());
+
+  // fill the memory with garbage. Nothing must be read from it before the
+  // buckets are initialized.
+  const size_t hashTableSize =
+      sizeof(CompressedPtrType) * config.getNumBuckets();
+  std::unique_ptr<CompressedPtrType[]> memStart(
+      new CompressedPtrType[config.getNumBuckets()]);
+  memset(memStart.get(), 0xab, hashTableSize);
+
+  Container c1(config, reinterpret_cast<Node**>(memStart.get()),
+               typename Node::PtrCompressor());
+  ASSERT_EQ(0, c1.getStats().numInitializedBuckets);
+  ASSERT_EQ(nullptr, c1.find(getRandomNewKey(c1)));
+
+  // the first insert initializes only the block of its bucket
+  Node first{getRandomNewKey(c1)};
+  ASSERT_TRUE(c1.insert(first));
+  const auto numInitialized = c1.getStats().numInitializedBuckets;
+  ASSERT_LT(0, numInitialized);
+  ASSERT_GT(config.getNumBuckets(), numInitialized);
+  ASSERT_EQ(&first, c1.find(first.getKey()).get());
+
+  auto nodes = createSimpleContainer(c1);
+  testSimpleInsertAndRemove(c1, nodes);
+
+  // saving the state initializes the remaining buckets so that the memory
+  // can be restored as is.
+  auto serializedData = c1.saveState();
+  ASSERT_EQ(config.getNumBuckets(), c1.getStats().numInitializedBuckets);
+
+  Container c2(serializedData, HashConfig{bucketsPower, locksPower},
+               reinterpret_cast<Node**>(memStart.get()), hashTableSize,
+               typename Node::PtrCompressor());
+  ASSERT_EQ(config.getNumBuckets(), c2.getStats().numInitializedBuckets);
+  ASSERT_EQ(&first, c2.find(first.getKey()).get());
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c2.find(node->getKey()).get());
+  }
+  ASSERT_EQ(nodes.size() + 1, iterateAndGetKeys(c2).size());
+}
+
 /* this is a fun test and quite important and notoriously significant which
  * cause mc-cachelib to be rolledback 100%. ChainedHashTable api expect nodes
  * to be right state when calling the APIs. When a corrupt node which is not
@@ -272,6 +518,190 @@ TEST_F(ChainedHashTest, IteratorWithThrottler) {
   ASSERT_EQ(existingKeys, visitedKeys);
   ASSERT_TRUE((time1 > time2 * 5));
 }
+TEST_F(ChainedHashTest, ResizeConfig) {
+  using HashConfig = ChainedHashTable::Config;
+  HashConfig config{4, 2};
+  ASSERT_FALSE(config.isResizable());
+  ASSERT_EQ(config.getNumBuckets(), config.getMaxNumBuckets());
+
+  config.setMaxBucketsPower(8, 2.0);
+  ASSERT_TRUE(config.isResizable());
+  ASSERT_EQ(8, config.getMaxBucketsPower());
+  ASSERT_EQ(256, config.getMaxNumBuckets());
+  ASSERT_EQ(2.0, config.getMaxLoadFactor());
+  ASSERT_EQ("8", config.serialize()["MaxBucketsPower"]);
+
+  ASSERT_THROW(config.setMaxBucketsPower(3), std::invalid_argument);
+  ASSERT_THROW(config.setMaxBucketsPower(33), std::invalid_argument);
+  ASSERT_THROW(config.setMaxBucketsPower(8, 0), std::invalid_argument);
+}
+
+TEST_F(ChainedHashTest, Resize) {
+  Container c{Config{4, 2}.setMaxBucketsPower(8), PtrCompressor{}};
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 1000; i++) {
+    nodes.emplace_back(new Node(getRandomNewKey(c)));
+    ASSERT_TRUE(c.insert(*nodes.back()));
+  }
+  ASSERT_EQ(16, c.getStats().numBuckets);
+
+  // every call splits a few buckets and starts the next doubling once the
+  // previous one is done, until the max buckets power is reached.
+  ASSERT_EQ(7, c.resizeStep(7));
+  auto stats = c.getStats();
+  ASSERT_TRUE(stats.resizing);
+  ASSERT_EQ(7, stats.numBucketsSplit);
+  ASSERT_EQ(16, stats.numBucketsToSplit);
+  ASSERT_EQ(23, stats.numBuckets);
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c.find(node->getKey()).get());
+  }
+
+  while (c.resizeStep(7) > 0) {
+  }
+  stats = c.getStats();
+  ASSERT_FALSE(stats.resizing);
+  ASSERT_EQ(256, stats.numBuckets);
+  ASSERT_EQ(4, stats.numResizes);
+  ASSERT_EQ(8, c.getHashpower());
+  ASSERT_FALSE(c.startResize());
+  ASSERT_EQ(256, c.getDistributionStats().numBuckets);
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c.find(node->getKey()).get());
+  }
+  ASSERT_EQ(nodes.size(), iterateAndGetKeys(c).size());
+  for (const auto& node : nodes) {
+    ASSERT_TRUE(c.remove(*node));
+  }
+  ASSERT_EQ(0, c.getNumKeys());
+}
+
+TEST_F(ChainedHashTest, ResizeWithConcurrentAccess) {
+  Container c{Config{6, 4}.setMaxBucketsPower(12).setOptimisticReads(true),
+              PtrCompressor{}};
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 5000; i++) {
+    nodes.emplace_back(new Node(getRandomNewKey(c)));
+    ASSERT_TRUE(c.insert(*nodes.back()));
+  }
+  // keys that come and go during the resize.
+  std::vector<std::unique_ptr<Node>> churnNodes;
+  for (int i = 0; i < 100; i++) {
+    churnNodes.emplace_back(new Node(getRandomNewKey(c)));
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> numMisses{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&]() {
+      while (!done) {
+        for (const auto& node : nodes) {
+          if (c.find(node->getKey()).get() != node.get()) {
+            ++numMisses;
+          }
+        }
+      }
+    });
+  }
+  threads.emplace_back([&]() {
+    while (!done) {
+      for (auto& node : churnNodes) {
+        c.insert(*node);
+      }
+      for (auto& node : churnNodes) {
+        c.remove(*node);
+      }
+    }
+  });
+
+  while (c.resizeStep(1) > 0) {
+  }
+  done = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  ASSERT_EQ(0, numMisses);
+  ASSERT_EQ(12, c.getHashpower());
+  ASSERT_EQ(nodes.size(), c.getNumKeys());
+  ASSERT_EQ(nodes.size(), iterateAndGetKeys(c).size());
+}
+
+TEST_F(ChainedHashTest, ResizePausedByIterator) {
+  Container c{Config{4, 2}.setMaxBucketsPower(8), PtrCompressor{}};
+  auto nodes = createSimpleContainer(c);
+  {
+    auto it = c.begin();
+    // the resize starts but no bucket is split under the iterator.
+    ASSERT_EQ(0, c.resizeStep(100));
+    ASSERT_TRUE(c.getStats().resizing);
+    ASSERT_EQ(16, c.getStats().numBuckets);
+  }
+  ASSERT_EQ(5, c.resizeStep(5));
+
+  // iteration in the middle of a resize still sees every key once.
+  ASSERT_EQ(nodes.size(), iterateAndGetKeys(c).size());
+}
+
+TEST_F(ChainedHashTest, ResizeSerialization) {
+  using HashConfig = ChainedHashTable::Config;
+  HashConfig config{4, 2};
+  config.setMaxBucketsPower(10);
+  const size_t hashTableSize =
+      Container::getRequiredSize(config.getMaxNumBuckets());
+  std::unique_ptr<uint8_t[]> memStart(new uint8_t[hashTableSize]);
+
+  Container c1(config, memStart.get(), PtrCompressor{});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 500; i++) {
+    nodes.emplace_back(new Node(getRandomNewKey(c1)));
+    ASSERT_TRUE(c1.insert(*nodes.back()));
+  }
+  ASSERT_EQ(5, c1.resizeStep(5));
+  const auto serializedData = c1.saveState();
+  ASSERT_EQ(4, *serializedData.bucketsPower());
+  ASSERT_EQ(10, *serializedData.maxBucketsPower());
+  ASSERT_EQ(5, *serializedData.numBucketsSplit());
+
+  // the reserved memory and the buckets to start from must fit the saved
+  // hash table.
+  ASSERT_THROW(
+      Container(serializedData, HashConfig{4, 2}.setMaxBucketsPower(9),
+                memStart.get(), hashTableSize, PtrCompressor{}),
+      std::invalid_argument);
+  ASSERT_THROW(
+      Container(serializedData, HashConfig{5, 2}.setMaxBucketsPower(10),
+                memStart.get(), hashTableSize, PtrCompressor{}),
+      std::invalid_argument);
+
+  Container c2(serializedData, config, memStart.get(), hashTableSize,
+               PtrCompressor{});
+  auto stats = c2.getStats();
+  ASSERT_TRUE(stats.resizing);
+  ASSERT_EQ(21, stats.numBuckets);
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c2.find(node->getKey()).get());
+  }
+
+  // the resize picks up where it was left and stops once the load factor
+  // is met.
+  while (c2.resizeStep(5) > 0) {
+  }
+  ASSERT_EQ(512, c2.getStats().numBuckets);
+
+  // a hash table that grew can be restored from a config with the buckets
+  // it has grown to.
+  const auto grownData = c2.saveState();
+  Container c3(grownData, HashConfig{9, 2}.setMaxBucketsPower(10),
+               memStart.get(), hashTableSize, PtrCompressor{});
+  ASSERT_EQ(512, c3.getStats().numBuckets);
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c3.find(node->getKey()).get());
+  }
+  ASSERT_EQ(nodes.size(), iterateAndGetKeys(c3).size());
+}
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "cachelib/allocator/EvictionAgeSampler.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+TEST(EvictionAgeSamplerTest, InvalidConfig) {
+  EXPECT_THROW((EvictionAgeSampler{0, 1024}), std::invalid_argument);
+  EXPECT_THROW((EvictionAgeSampler{1, 1}), std::invalid_argument);
+}
+
+TEST(EvictionAgeSamplerTest, Buckets) {
+  for (uint32_t age = 0; age < 8; age++) {
+    ASSERT_EQ(age, EvictionAgeSampler::getBucketAge(
+                       EvictionAgeSampler::getBucketIdx(age)));
+  }
+  for (uint32_t age : {8u, 100u, 1000u, 86400u, 1u << 31,
+                       std::numeric_limits<uint32_t>::max()}) {
+    const auto bucketAge =
+        EvictionAgeSampler::getBucketAge(EvictionAgeSampler::getBucketIdx(age));
+    ASSERT_LE(age, bucketAge);
+    ASSERT_GE(uint64_t{age} + age / 8, bucketAge);
+  }
+}
+
+TEST(EvictionAgeSamplerTest, Percentiles) {
+  EvictionAgeSampler sampler{1, 1000};
+  for (int i = 0; i < 90; i++) {
+    sampler.recordEviction(3, 10);
+  }
+  for (int i = 0; i < 10; i++) {
+    sampler.recordEviction(3, 1000);
+  }
+
+  const auto stat = sampler.getStat(3);
+  ASSERT_EQ(100, stat.numSamples);
+  ASSERT_EQ(10, stat.p10);
+  ASSERT_EQ(10, stat.p50);
+  ASSERT_EQ(10, stat.p90);
+  // ages past 8 seconds are rounded up to a bucket at most 1/8th larger
+  ASSERT_EQ(1023, stat.p99);
+
+  // other classes are sampled separately
+  ASSERT_EQ(0, sampler.getStat(4).numSamples);
+  ASSERT_EQ(0, sampler.getStat(4).p50);
+}
+
+TEST(EvictionAgeSamplerTest, Window) {
+  EvictionAgeSampler sampler{1, 100};
+  for (int i = 0; i < 100; i++) {
+    sampler.recordEviction(0, 5);
+  }
+  // the samples are halved once the window is full
+  ASSERT_EQ(50, sampler.getStat(0).numSamples);
+  ASSERT_EQ(5, sampler.getStat(0).p50);
+
+  // the newer ages make up half of the window after it is halved again
+  for (int i = 0; i < 50; i++) {
+    sampler.recordEviction(0, 100);
+  }
+  const auto stat = sampler.getStat(0);
+  ASSERT_EQ(50, stat.numSamples);
+  ASSERT_EQ(5, stat.p50);
+  ASSERT_EQ(103, stat.p90);
+}
+
+TEST(EvictionAgeSamplerTest, SampleRate) {
+  EvictionAgeSampler sampler{10, 1000};
+  for (int i = 0; i < 1000; i++) {
+    sampler.recordEviction(0, 1);
+  }
+  ASSERT_EQ(100, sampler.getStat(0).numSamples);
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Task.h>
 #include <folly/fibers/Baton.h>
+#include <folly/fibers/FiberManagerMap.h>
 #include <folly/io/async/EventBase.h>
 #include <gmock/gmock.h>
 
@@ -59,6 +62,8 @@ struct TestAllocator {
 
   MOCK_METHOD2(release, void(TestItem*, bool));
 
+  void releaseStripedRef(TestItem*, detail::StripedRef, bool) {}
+
   TestWriteHandle acquire(TestItem* it) {
     tlRef_.tlStats() += 1;
     return TestWriteHandle{it, *this};
@@ -76,6 +81,10 @@ struct TestAllocator {
     hdl.getItemWaitContext()->set(std::move(h));
   }
 
+  auto getWaitContext(const TestReadHandle& hdl) {
+    return hdl.getItemWaitContext();
+  }
+
   void markExpired(TestWriteHandle& hdl) { hdl.markExpired(); }
 
   void adjustHandleCountForThread_private(int i) { tlRef_.tlStats() += i; }
@@ -198,6 +207,59 @@ TEST(ItemHandleTest, WaitContext_set_waitSemiFuture_ready) {
   EXPECT_TRUE(called);
 }
 
+TEST(ItemHandleTest, WaitContext_set_waitOnFiber) {
+  testing::NiceMock<TestAllocator> t;
+  TestItem k;
+  auto hdl = t.getHandle();
+
+  // the handle is set by another fiber of the same thread, which can only
+  // run if waiting suspends the waiting fiber rather than the thread
+  folly::EventBase evb;
+  auto& fm = folly::fibers::getFiberManager(evb);
+  bool waited = false;
+  fm.addTask([&]() {
+    hdl.wait();
+    waited = true;
+  });
+  fm.addTask([&]() { t.setHandle(hdl, &k); });
+  evb.loop();
+  EXPECT_TRUE(waited);
+  EXPECT_EQ(&k, hdl.get());
+}
+
+#if FOLLY_HAS_COROUTINES
+TEST(ItemHandleTest, WaitContext_set_coAwait) {
+  testing::NiceMock<TestAllocator> t;
+  TestItem k;
+  TestWriteHandle hdl = t.getHandle();
+
+  // the handle is moved into the task, so set it through its wait context
+  folly::fibers::Baton run;
+  auto thr = std::thread([&t, &k, &run, ctx = t.getWaitContext(hdl)]() {
+    run.wait();
+    ctx->set(t.acquire(&k));
+  });
+
+  auto task = [&]() -> folly::coro::Task<TestWriteHandle> {
+    run.post();
+    co_return co_await std::move(hdl);
+  };
+  auto h = folly::coro::blockingWait(task());
+  EXPECT_TRUE(h.isReady());
+  EXPECT_EQ(&k, h.get());
+  thr.join();
+  h.reset();
+
+  // a ready handle does not suspend
+  auto ready = t.getHandle();
+  t.setHandle(ready, t.acquire(&k));
+  auto readTask = [&]() -> folly::coro::Task<TestReadHandle> {
+    co_return co_await TestReadHandle{std::move(ready)};
+  };
+  EXPECT_EQ(&k, folly::coro::blockingWait(readTask()).get());
+}
+#endif
+
 namespace detail {
 TEST(ItemHandleTest, WaitContext_readycb) {
   testing::NiceMock<TestAllocator> t;
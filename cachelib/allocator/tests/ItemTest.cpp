@@ -129,6 +129,83 @@ TEST(ItemTest, ExpiryTime) {
 // Then make a chained item and verify it is a chained item
 // Finally pass invalid size when constructing another chained item,
 // it should throw
+TEST(ItemTest, NoExpiryTime) {
+  using CompactItem = LruCompactItemAllocator::Item;
+  static_assert(sizeof(CompactItem) + sizeof(uint32_t) == sizeof(Item),
+                "items without an expiry time are 4 bytes smaller");
+
+  constexpr uint32_t bufferSize = 100;
+  char buffer[bufferSize];
+  const folly::StringPiece key = "helloworld";
+  const uint32_t now = util::getCurrentTimeSec();
+
+  auto item = new (buffer) CompactItem(key, bufferSize / 2, now);
+  item->markInMMContainer();
+  EXPECT_EQ(key, item->getKey());
+  EXPECT_EQ(now, item->getCreationTime());
+  EXPECT_EQ(0, item->getExpiryTime());
+  EXPECT_EQ(0, item->getConfiguredTTL().count());
+  EXPECT_FALSE(item->isExpired());
+
+  // the expiry time can not be set
+  EXPECT_FALSE(item->updateExpiryTime(now + 600));
+  EXPECT_FALSE(item->extendTTL(std::chrono::seconds(600)));
+  EXPECT_EQ(0, item->getExpiryTime());
+  EXPECT_FALSE(item->isExpired(now + 1200));
+}
+
+TEST(ItemTest, NoExpiryTimeAllocate) {
+  LruCompactItemAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  LruCompactItemAllocator cache(config);
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+
+  ASSERT_THROW(cache.allocate(pid, "key", 100, 600 /* ttlSecs */),
+               std::invalid_argument);
+
+  auto handle = cache.allocate(pid, "key", 100);
+  ASSERT_NE(nullptr, handle);
+  cache.insertOrReplace(handle);
+  handle.reset();
+  ASSERT_NE(nullptr, cache.find("key"));
+}
+
+TEST(ItemTest, DramOnlyAllocate) {
+  static_assert(!LruDramOnlyAllocator::kHasNvmCache &&
+                    !LruDramOnlyAllocator::kHasChainedItems &&
+                    !LruDramOnlyAllocator::kHasItemCallbacks,
+                "the features are compiled out");
+
+  LruDramOnlyAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  {
+    auto invalidConfig = config;
+    invalidConfig.setRemoveCallback(
+        [](const LruDramOnlyAllocator::RemoveCbData&) {});
+    ASSERT_THROW(LruDramOnlyAllocator{invalidConfig}, std::invalid_argument);
+  }
+
+  LruDramOnlyAllocator cache(config);
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+
+  ASSERT_THROW(cache.allocate(pid, "key", 100, 600 /* ttlSecs */),
+               std::invalid_argument);
+
+  auto handle = cache.allocate(pid, "key", 100);
+  ASSERT_NE(nullptr, handle);
+  ASSERT_THROW(cache.allocateChainedItem(handle, 100), std::invalid_argument);
+  EXPECT_FALSE(handle->hasChainedItem());
+  cache.insertOrReplace(handle);
+  handle.reset();
+  ASSERT_NE(nullptr, cache.find("key"));
+  EXPECT_FALSE(cache.isNvmCacheEnabled());
+
+  EXPECT_EQ(LruDramOnlyAllocator::RemoveRes::kSuccess, cache.remove("key"));
+  ASSERT_EQ(nullptr, cache.find("key"));
+}
+
 TEST(ItemTest, ChainedItemConstruction) {
   constexpr uint32_t bufferSize = 100;
   char buffer1[bufferSize];
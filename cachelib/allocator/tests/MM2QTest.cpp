@@ -733,5 +733,93 @@ TEST_F(MM2QTest, CombinedLockingIteration) {
     ASSERT_FALSE(node->isInMMContainer());
   }
 }
+
+TEST_F(MM2QTest, HotClockHits) {
+  MM2Q::Config config{};
+  config.lruRefreshTime = 0;
+  config.hotSizePercent = 50;
+  config.coldSizePercent = 25;
+  config.hotClockHits = true;
+  Container c(config, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+  // the older half was moved to Cold
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[4]));
+  ASSERT_EQ(MM2Q::Hot, c.getLruType(*nodes[5]));
+
+  // a hot hit only marks the node, it is not counted until Hot is shrunk
+  ASSERT_TRUE(c.recordAccess(*nodes[5], AccessMode::kRead));
+  ASSERT_EQ(0, c.getStats().numHotAccesses);
+
+  // the accessed node at the tail of Hot gets a second chance, the next one
+  // moves to Cold
+  nodes.emplace_back(new Node{10});
+  ASSERT_TRUE(c.add(*nodes.back()));
+  ASSERT_EQ(MM2Q::Hot, c.getLruType(*nodes[5]));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[6]));
+  ASSERT_EQ(1, c.getStats().numHotAccesses);
+
+  // without another hit, it moves to Cold once it reaches the tail again
+  for (int i = 11; i < 21; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[5]));
+
+  // hits on cold nodes are still promoted to Warm
+  ASSERT_TRUE(c.recordAccess(*nodes[0], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Warm, c.getLruType(*nodes[0]));
+
+  // the tail bit can not double as the accessed bit with tail hits tracking
+  config.addExtraConfig(1);
+  Container tracked(config, {});
+  Node node0{0};
+  Node node1{1};
+  ASSERT_TRUE(tracked.add(node0));
+  ASSERT_TRUE(tracked.add(node1));
+  ASSERT_EQ(MM2Q::Hot, tracked.getLruType(node1));
+  ASSERT_TRUE(tracked.recordAccess(node1, AccessMode::kRead));
+  ASSERT_EQ(1, tracked.getStats().numHotAccesses);
+}
+
+TEST_F(MM2QTest, PromotionBuffer) {
+  MM2Q::Config config{};
+  config.lruRefreshTime = 0;
+  config.hotSizePercent = 10;
+  config.coldSizePercent = 30;
+  config.promotionBufferSize = 2;
+  Container c(config, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[0]));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[1]));
+
+  // promotions are held back until the buffer is full
+  ASSERT_TRUE(c.recordAccess(*nodes[0], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[0]));
+  ASSERT_TRUE(c.recordAccess(*nodes[1], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Warm, c.getLruType(*nodes[0]));
+  ASSERT_EQ(MM2Q::Warm, c.getLruType(*nodes[1]));
+
+  // invalidating drops whatever has been buffered so far
+  ASSERT_TRUE(c.recordAccess(*nodes[2], AccessMode::kRead));
+  c.invalidateBufferedAccesses();
+  ASSERT_TRUE(c.recordAccess(*nodes[3], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[2]));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[3]));
+
+  // buffering resumes after the invalidation
+  ASSERT_TRUE(c.recordAccess(*nodes[4], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Cold, c.getLruType(*nodes[4]));
+  ASSERT_TRUE(c.recordAccess(*nodes[5], AccessMode::kRead));
+  ASSERT_EQ(MM2Q::Warm, c.getLruType(*nodes[4]));
+  ASSERT_EQ(MM2Q::Warm, c.getLruType(*nodes[5]));
+}
 } // namespace cachelib
 } // namespace facebook
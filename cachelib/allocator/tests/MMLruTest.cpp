@@ -17,6 +17,8 @@
 #include <folly/Random.h>
 #include <folly/logging/xlog.h>
 
+#include <thread>
+
 #include "cachelib/allocator/MMLru.h"
 #include "cachelib/allocator/tests/MMTypeTest.h"
 
@@ -580,5 +582,131 @@ TEST_F(MMLruTest, CombinedLockingIteration) {
     ASSERT_FALSE(node->isInMMContainer());
   }
 }
+TEST_F(MMLruTest, PromotionBuffer) {
+  MMLru::Config config{};
+  config.lruRefreshTime = 0;
+  config.promotionBufferSize = 4;
+  Container c(config, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+
+  auto getHeadId = [&c]() {
+    int id = -1;
+    for (auto iter = c.getEvictionIterator(); iter; ++iter) {
+      id = iter->getId();
+    }
+    return id;
+  };
+
+  // promotions are held back until the buffer is full
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(c.recordAccess(*nodes[i], AccessMode::kRead));
+    ASSERT_EQ(9, getHeadId());
+  }
+  ASSERT_TRUE(c.recordAccess(*nodes[3], AccessMode::kRead));
+  ASSERT_EQ(3, getHeadId());
+
+  // a node removed after being buffered is not promoted
+  ASSERT_TRUE(c.recordAccess(*nodes[4], AccessMode::kRead));
+  ASSERT_TRUE(c.remove(*nodes[4]));
+  ASSERT_TRUE(c.recordAccess(*nodes[5], AccessMode::kRead));
+  ASSERT_TRUE(c.recordAccess(*nodes[6], AccessMode::kRead));
+  ASSERT_TRUE(c.recordAccess(*nodes[7], AccessMode::kRead));
+  ASSERT_EQ(7, getHeadId());
+  ASSERT_FALSE(nodes[4]->isInMMContainer());
+
+  // invalidating drops whatever has been buffered so far
+  ASSERT_TRUE(c.recordAccess(*nodes[0], AccessMode::kRead));
+  ASSERT_TRUE(c.recordAccess(*nodes[1], AccessMode::kRead));
+  c.invalidateBufferedAccesses();
+  ASSERT_TRUE(c.recordAccess(*nodes[2], AccessMode::kRead));
+  ASSERT_TRUE(c.recordAccess(*nodes[8], AccessMode::kRead));
+  ASSERT_EQ(7, getHeadId());
+
+  // buffering resumes after the invalidation
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(c.recordAccess(*nodes[i], AccessMode::kRead));
+  }
+  ASSERT_EQ(3, getHeadId());
+  ASSERT_EQ(9, c.getStats().size);
+}
+
+TEST_F(MMLruTest, LockContention) {
+  MMLru::Config config{};
+  config.lruRefreshTime = 0;
+  config.tryLockUpdate = true;
+  config.lockContentionSampleRate = 1;
+  Container c(config, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 2; i++) {
+    nodes.emplace_back(new Node{i});
+  }
+  ASSERT_TRUE(c.add(*nodes[0]));
+  ASSERT_EQ(0, c.getStats().numLockContended);
+
+  {
+    auto iter = c.getEvictionIterator();
+    // a promotion is dropped rather than waiting for the lock
+    std::thread{[&] {
+      ASSERT_FALSE(c.recordAccess(*nodes[0], AccessMode::kRead));
+    }}.join();
+
+    std::thread adder{[&] { ASSERT_TRUE(c.add(*nodes[1])); }};
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    iter.destroy();
+    adder.join();
+  }
+
+  const auto stats = c.getStats();
+  ASSERT_EQ(2, stats.size);
+  ASSERT_EQ(2, stats.numLockContended);
+  ASSERT_EQ(1, stats.numLockWaitSampled);
+  ASSERT_LT(0, stats.lockWaitNs);
+}
+
+TEST_F(MMLruTest, SampledEviction) {
+  MMLru::Config config{};
+  config.lruRefreshTime = 0;
+  config.evictionSampleSize = 4;
+  Container c(config, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+
+  auto getIds = [&c]() {
+    std::vector<int> ids;
+    for (auto iter = c.getEvictionIterator(); iter; ++iter) {
+      ids.push_back(iter->getId());
+    }
+    return ids;
+  };
+  auto getEvictionTailId = [&c]() {
+    int id = -1;
+    c.withEvictionIterator([&id](auto&& iter) { id = iter->getId(); });
+    return id;
+  };
+
+  // accesses only stamp the nodes
+  ASSERT_TRUE(c.recordAccess(*nodes[0], AccessMode::kRead));
+  ASSERT_TRUE(c.recordAccess(*nodes[1], AccessMode::kRead));
+  ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), getIds());
+
+  // the accessed nodes of the sample move to the head and the least recently
+  // updated of the others to the tail
+  nodes[3]->setUpdateTime(nodes[2]->getUpdateTime() - 1);
+  ASSERT_EQ(3, getEvictionTailId());
+  ASSERT_EQ((std::vector<int>{3, 2, 4, 5, 6, 7, 8, 9, 0, 1}), getIds());
+
+  // a node is promoted once per access
+  ASSERT_EQ(3, getEvictionTailId());
+  ASSERT_EQ((std::vector<int>{3, 2, 4, 5, 6, 7, 8, 9, 0, 1}), getIds());
+  ASSERT_EQ(10, c.getStats().size);
+}
 } // namespace cachelib
 } // namespace facebook
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/MMSieve.h"
+#include "cachelib/allocator/tests/MMTypeTest.h"
+
+namespace facebook {
+namespace cachelib {
+
+using MMSieveTest = MMTypeTest<MMSieve>;
+
+TEST_F(MMSieveTest, AddBasic) { testAddBasic(MMSieve::Config{}); }
+
+TEST_F(MMSieveTest, RemoveBasic) { testRemoveBasic(MMSieve::Config{}); }
+
+TEST_F(MMSieveTest, Serialization) {
+  testSerializationBasic(MMSieve::Config{});
+}
+
+TEST_F(MMSieveTest, RecordAccess) {
+  Container c(MMSieve::Config{}, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  createSimpleContainer(c, nodes);
+
+  // only the first access after insertion marks the node
+  for (auto& node : nodes) {
+    ASSERT_TRUE(c.recordAccess(*node, AccessMode::kRead));
+    ASSERT_FALSE(c.recordAccess(*node, AccessMode::kRead));
+    // writes are ignored by default
+    ASSERT_FALSE(c.recordAccess(*node, AccessMode::kWrite));
+  }
+
+  // accesses never change the order of the queue
+  std::vector<int> order;
+  for (auto& node : nodes) {
+    order.push_back(node->getId());
+  }
+  auto config = c.getConfig();
+  config.updateOnRead = false;
+  c.setConfig(config);
+  for (auto& node : nodes) {
+    ASSERT_TRUE(c.remove(*node));
+    ASSERT_TRUE(c.add(*node));
+    ASSERT_FALSE(c.recordAccess(*node, AccessMode::kRead));
+  }
+  std::vector<int> evictionOrder;
+  for (auto itr = c.getEvictionIterator(); itr; ++itr) {
+    evictionOrder.push_back(itr->getId());
+  }
+  ASSERT_EQ(order, evictionOrder);
+}
+
+TEST_F(MMSieveTest, Eviction) {
+  Container c(MMSieve::Config{}, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    ASSERT_TRUE(c.add(*nodes.back()));
+  }
+
+  auto evictOne = [&c]() {
+    int id = -1;
+    c.withEvictionIterator([&c, &id](auto&& itr) {
+      if (itr) {
+        id = itr->getId();
+        c.remove(itr);
+      }
+    });
+    return id;
+  };
+
+  // visited nodes are skipped by the hand and lose their visited bit
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(c.recordAccess(*nodes[i], AccessMode::kRead));
+  }
+  ASSERT_EQ(3, evictOne());
+  ASSERT_FALSE(nodes[3]->isInMMContainer());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(nodes[i]->isInMMContainer());
+    ASSERT_FALSE(nodes[i]->isFlagSet<Node::kMMFlag0>());
+  }
+
+  // the hand continues from where it stopped instead of the tail
+  ASSERT_EQ(4, evictOne());
+
+  // visiting everything makes the hand clear a full lap without finding a
+  // candidate. The next attempt evicts the node under the hand.
+  for (auto& node : nodes) {
+    if (node->isInMMContainer()) {
+      c.recordAccess(*node, AccessMode::kRead);
+    }
+  }
+  ASSERT_EQ(-1, evictOne());
+  ASSERT_EQ(5, evictOne());
+
+  // the hand wraps around from the head to the tail
+  ASSERT_EQ(6, evictOne());
+  ASSERT_EQ(7, evictOne());
+  ASSERT_EQ(8, evictOne());
+  ASSERT_EQ(9, evictOne());
+  ASSERT_EQ(0, evictOne());
+  ASSERT_EQ(1, evictOne());
+  ASSERT_EQ(2, evictOne());
+  ASSERT_EQ(-1, evictOne());
+  ASSERT_EQ(0, c.size());
+}
+
+TEST_F(MMSieveTest, ReplaceHand) {
+  Container c(MMSieve::Config{}, {});
+  std::vector<std::unique_ptr<Node>> nodes;
+  createSimpleContainer(c, nodes);
+
+  // park the hand on the second node from the tail
+  Node* hand = nullptr;
+  c.withEvictionIterator([&c, &hand](auto&& itr) {
+    c.remove(itr);
+    hand = itr.get();
+  });
+  ASSERT_NE(nullptr, hand);
+
+  // replacing the node under the hand keeps the hand on the new node
+  auto newNode = std::make_unique<Node>(100);
+  ASSERT_TRUE(c.replace(*hand, *newNode));
+  auto itr = c.getEvictionIterator();
+  ASSERT_EQ(newNode.get(), itr.get());
+}
+} // namespace cachelib
+} // namespace facebook
@@ -432,5 +432,91 @@ TEST_F(MMTinyLFUTest, Reconfigure) {
   // refresh time 3, node 0 (age 2) does not get promoted
   EXPECT_FALSE(container.recordAccess(*nodes[0], AccessMode::kRead));
 }
+
+TEST_F(MMTinyLFUTest, AdaptiveTinySize) {
+  MMTinyLFU::Config config;
+  config.tinySizePercent = 10;
+  config.adaptiveTinySize = true;
+  Container c{config, {}};
+  EXPECT_EQ(10, c.getTinySizePercent());
+
+  auto climb = [&](uint64_t hits, uint64_t adds) {
+    c.climbHits_ = hits;
+    c.climbAdds_ = adds;
+    c.adaptTinySizeLocked();
+    return c.getTinySizePercent();
+  };
+  // the first sample improves on nothing
+  EXPECT_EQ(10 + 6.25, climb(50, 50));
+  // a worse hit ratio goes back
+  EXPECT_EQ(10, climb(40, 60));
+  // a better one keeps going, with a smaller step
+  EXPECT_EQ(10 - 6.25, climb(41, 59));
+  EXPECT_EQ(1, climb(42, 58));
+
+  // the tiny cache drains towards a smaller size as nodes are added
+  config.adaptiveTinySize = false;
+  config.tinySizePercent = 50;
+  c.setConfig(config);
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 200; i++) {
+    nodes.emplace_back(new Node{i});
+    c.add(*nodes.back());
+  }
+  auto& tinyLru = c.lru_.getList(MMTinyLFU::LruType::Tiny);
+  EXPECT_EQ(100, tinyLru.size());
+  c.tinySizePercent_ = 1;
+  for (int i = 200; i < 250; i++) {
+    nodes.emplace_back(new Node{i});
+    c.add(*nodes.back());
+  }
+  EXPECT_EQ(50, tinyLru.size());
+
+  // the frequency counters follow the size of the container
+  const auto counterSize = c.counterSize();
+  for (int i = 250; i < 1000; i++) {
+    nodes.emplace_back(new Node{i});
+    c.add(*nodes.back());
+  }
+  EXPECT_LT(counterSize, c.counterSize());
+  for (int i = 0; i < 802; i++) {
+    c.remove(*nodes[i]);
+  }
+  nodes.emplace_back(new Node{1000});
+  c.add(*nodes.back());
+  EXPECT_EQ(counterSize, c.counterSize());
+}
+
+TEST_F(MMTinyLFUTest, BlockedFrequencySketch) {
+  MMTinyLFU::Config config;
+  config.lruRefreshTime = 0;
+  Container c{config, {}};
+  const auto counterSize = c.counterSize();
+
+  // 4 bit counters instead of 32 bit ones
+  config.blockedFrequencySketch = true;
+  c.setConfig(config);
+  EXPECT_EQ(counterSize / 8, c.counterSize());
+
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10; i++) {
+    nodes.emplace_back(new Node{i});
+    c.add(*nodes.back());
+  }
+  for (int i = 0; i < 3; i++) {
+    c.recordAccess(*nodes[0], AccessMode::kRead);
+  }
+  EXPECT_GE(c.getFrequency(*nodes[0]), 3);
+  // the counters saturate
+  for (int i = 0; i < 100; i++) {
+    c.recordAccess(*nodes[1], AccessMode::kRead);
+  }
+  EXPECT_EQ(15, c.getFrequency(*nodes[1]));
+
+  config.blockedFrequencySketch = false;
+  c.setConfig(config);
+  EXPECT_EQ(counterSize, c.counterSize());
+  EXPECT_EQ(0, c.getFrequency(*nodes[1]));
+}
 } // namespace cachelib
 } // namespace facebook
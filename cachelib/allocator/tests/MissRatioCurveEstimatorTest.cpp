@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "cachelib/allocator/MissRatioCurveEstimator.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+TEST(MissRatioCurveEstimatorTest, InvalidParams) {
+  EXPECT_THROW(MissRatioCurveEstimator(0, 10, 100, 10), std::invalid_argument);
+  EXPECT_THROW(MissRatioCurveEstimator(1.5, 10, 100, 10),
+               std::invalid_argument);
+  EXPECT_THROW(MissRatioCurveEstimator(1, 0, 100, 10), std::invalid_argument);
+  EXPECT_THROW(MissRatioCurveEstimator(1, 10, 0, 10), std::invalid_argument);
+  EXPECT_THROW(MissRatioCurveEstimator(1, 10, 100, 0), std::invalid_argument);
+}
+
+TEST(MissRatioCurveEstimatorTest, CyclicAccesses) {
+  const uint64_t numKeys = 100;
+  const uint32_t size = 10;
+  const int numLoops = 5;
+  // every key is tracked and the slots are compacted a few times
+  MissRatioCurveEstimator estimator{1, numKeys, 100, 20};
+  for (int loop = 0; loop < numLoops; loop++) {
+    for (uint64_t key = 0; key < numKeys; key++) {
+      estimator.recordAccess(key, size);
+    }
+  }
+  ASSERT_EQ(numKeys, estimator.getNumSamples());
+  ASSERT_DOUBLE_EQ(1.0, estimator.getSamplingRate());
+
+  // a key hits once the cache holds all of them
+  const auto curve = estimator.getCurve();
+  ASSERT_EQ(20, curve.hits.size());
+  ASSERT_DOUBLE_EQ(numKeys * numLoops, curve.numAccesses);
+  ASSERT_DOUBLE_EQ(0, curve.getHits(numKeys * size - 1));
+  ASSERT_DOUBLE_EQ(1.0, curve.getMissRatio(numKeys * size / 2));
+  ASSERT_DOUBLE_EQ(numKeys * (numLoops - 1), curve.getHits(numKeys * size));
+  ASSERT_DOUBLE_EQ(1.0 / numLoops, curve.getMissRatio(numKeys * size));
+  ASSERT_DOUBLE_EQ(1.0 / numLoops, curve.getMissRatio(100 * numKeys * size));
+
+  // only the latest loop
+  const auto older = estimator.getCurve();
+  for (uint64_t key = 0; key < numKeys; key++) {
+    estimator.recordAccess(key, size);
+  }
+  const auto latest = estimator.getCurve() - older;
+  ASSERT_DOUBLE_EQ(numKeys, latest.numAccesses);
+  ASSERT_DOUBLE_EQ(0, latest.getMissRatio(numKeys * size));
+}
+
+TEST(MissRatioCurveEstimatorTest, BoundedSamples) {
+  const size_t maxSamples = 512;
+  MissRatioCurveEstimator estimator{1, maxSamples, 1000, 400};
+  const uint64_t numKeys = 10000;
+  for (int loop = 0; loop < 3; loop++) {
+    for (uint64_t key = 0; key < numKeys; key++) {
+      estimator.recordAccess(key, 10);
+    }
+  }
+  ASSERT_EQ(maxSamples, estimator.getNumSamples());
+  ASSERT_LT(estimator.getSamplingRate(), 0.1);
+
+  // the sampled keys still estimate the whole working set, and only the
+  // first loop misses once it fits
+  const auto curve = estimator.getCurve();
+  ASSERT_NEAR(3 * numKeys, curve.numAccesses, 0.5 * numKeys);
+  ASSERT_GT(curve.getMissRatio(numKeys * 10 / 2), 0.9);
+  ASSERT_LT(curve.getMissRatio(numKeys * 10 * 2), 0.5);
+}
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <folly/Format.h>
 #include <gtest/gtest.h>
 
 #include "cachelib/allocator/CacheAllocator.h"
@@ -208,6 +209,126 @@ TEST_F(NvmAdmissionPolicyTest, CacheAllocatorConfigInitTest) {
   EXPECT_THROW({ config5.setNvmAdmissionMinTTL(5); }, std::invalid_argument);
 }
 
+namespace {
+class MockTicker : public Ticker {
+ public:
+  uint32_t getCurrentTick() override { return tick; }
+  uint32_t tick{100};
+};
+} // namespace
+
+TEST_F(NvmAdmissionPolicyTest, WriteBudgetAPScore) {
+  using AP = WriteBudgetAP<Cache>;
+  // hits in DRAM and keys seen before are worth more
+  EXPECT_LT(AP::getScore(false, false, false, 100),
+            AP::getScore(false, false, true, 100));
+  EXPECT_LT(AP::getScore(false, false, true, 100),
+            AP::getScore(false, true, false, 100));
+  EXPECT_LT(AP::getScore(false, true, false, 100),
+            AP::getScore(false, true, true, 100));
+  // size is ignored unless size aware
+  EXPECT_EQ(AP::getScore(false, true, false, 100),
+            AP::getScore(false, true, false, 100'000));
+
+  // smaller items are worth more per byte
+  EXPECT_GT(AP::getScore(true, false, false, 100),
+            AP::getScore(true, false, false, 100'000));
+  EXPECT_GT(AP::getScore(true, true, false, 1000),
+            AP::getScore(true, false, false, 1000));
+  EXPECT_EQ(0, AP::getScore(true, true, true, 1ULL << 30));
+  EXPECT_GT(AP::kNumScores, AP::getScore(true, true, true, 1));
+}
+
+TEST_F(NvmAdmissionPolicyTest, WriteBudgetAP) {
+  auto ticker = std::make_shared<MockTicker>();
+  WriteBudgetAPConfig config;
+  config.targetBytesPerSec = 1000;
+  config.ticker = ticker;
+  WriteBudgetAP<Cache> ap{config};
+  folly::Range<Cache::ChainedItemIter> dummyChainedItem;
+
+  // 100 items of 38 bytes each, half of them with a hit in DRAM
+  std::vector<Cache::Item> items;
+  for (int i = 0; i < 100; i++) {
+    items.emplace_back(folly::sformat("key{:03}", i));
+    items.back().creationTime_ = 10;
+    items.back().lastAccessTime_ = i % 2 ? 20 : 10;
+  }
+
+  // the first window admits everything until the budget is used up
+  uint64_t admittedBytes = 0;
+  for (const auto& item : items) {
+    if (ap.accept(item, dummyChainedItem)) {
+      admittedBytes += item.getTotalSize();
+    }
+  }
+  EXPECT_LE(admittedBytes, 1000);
+  EXPECT_GT(admittedBytes, 1000 - items[0].getTotalSize());
+  auto ctrs = ap.getCounters();
+  EXPECT_EQ(0, ctrs["ap.write_budget_threshold"]);
+  EXPECT_GT(ctrs["ap.write_budget_budget_rejected"], 0);
+
+  // the next window only admits items with a hit in DRAM, roughly half of
+  // them to fit in the budget
+  ticker->tick++;
+  uint64_t admittedHitBytes = 0;
+  admittedBytes = 0;
+  for (int round = 0; round < 10; round++) {
+    for (const auto& item : items) {
+      const bool wasHit = item.getLastAccessTime() > item.getCreationTime();
+      const bool accepted = ap.accept(item, dummyChainedItem);
+      EXPECT_TRUE(wasHit || !accepted);
+      if (accepted) {
+        admittedHitBytes += item.getTotalSize();
+      }
+    }
+    ticker->tick++;
+    admittedBytes += admittedHitBytes;
+    EXPECT_LE(admittedHitBytes, 1000);
+    admittedHitBytes = 0;
+  }
+  ctrs = ap.getCounters();
+  EXPECT_EQ(WriteBudgetAP<Cache>::getScore(true, true, false, 38),
+            ctrs["ap.write_budget_threshold"]);
+  EXPECT_NEAR(100.0 * 1000 / (50 * 38), ctrs["ap.write_budget_admit_pct"],
+              0.1);
+  EXPECT_GT(ctrs["ap.write_budget_score_rejected"], 0);
+  // the budget is mostly spent
+  EXPECT_GT(admittedBytes, 10 * 1000 / 2);
+
+  // a window with little traffic admits everything
+  ticker->tick++;
+  ap.accept(items[0], dummyChainedItem);
+  ticker->tick++;
+  EXPECT_TRUE(ap.accept(items[0], dummyChainedItem));
+  EXPECT_EQ(0, ap.getCounters()["ap.write_budget_threshold"]);
+}
+
+TEST_F(NvmAdmissionPolicyTest, WriteBudgetAPConfig) {
+  WriteBudgetAPConfig config;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+  config.targetBytesPerSec = 1000;
+  config.validate();
+  config.windowSecs = 0;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+  config.windowSecs = 1;
+  config.numTrackedKeys = 100;
+  config.numTrackedSplits = 0;
+  EXPECT_THROW(WriteBudgetAP<Cache>{config}, std::invalid_argument);
+
+  using CacheT = CacheAllocator<Cache>;
+  CacheAllocatorConfig<CacheT> cacheConfig;
+  EXPECT_THROW(cacheConfig.enableWriteBudgetAPForNvm(WriteBudgetAPConfig{}),
+               std::invalid_argument);
+  config.numTrackedSplits = 10;
+  this->enableNvmConfig(cacheConfig);
+  cacheConfig.enableWriteBudgetAPForNvm(config);
+  CacheT cache{cacheConfig};
+  EXPECT_NE(nullptr,
+            std::dynamic_pointer_cast<WriteBudgetAP<CacheT>>(
+                this->getNvmAdmissionPolicy(cache)));
+}
+
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
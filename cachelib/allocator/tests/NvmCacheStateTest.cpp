@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <folly/ScopeGuard.h>
 #include <folly/io/RecordIO.h>
 #include <gtest/gtest.h>
 
@@ -21,6 +22,7 @@
 #include <thread>
 
 #include "cachelib/allocator/CacheVersion.h"
+#include "cachelib/allocator/FormatUpgrades.h"
 #include "cachelib/allocator/NvmCacheState.h"
 #include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
 #include "cachelib/common/Serialization.h"
@@ -124,6 +126,58 @@ TEST_F(NvmCacheStateTest, CreationTime) {
   }
 }
 
+TEST_F(NvmCacheStateTest, PreviousVersion) {
+  auto dir = getCacheDir();
+  const auto writePrevVersion = [&dir]() {
+    serialization::NvmCacheMetadata metadata;
+    *metadata.nvmFormatVersion() = kCacheNvmFormatVersion - 1;
+    *metadata.creationTime() = 12345;
+    *metadata.safeShutDown() = true;
+    auto metadataIoBuf = Serializer::serializeToIOBuf(metadata);
+    folly::File shutDownFile{folly::sformat("{}/{}", dir, "NvmCacheState"),
+                             O_CREAT | O_TRUNC | O_RDWR};
+    folly::RecordIOWriter rw{std::move(shutDownFile)};
+    rw.write(std::move(metadataIoBuf));
+  };
+
+  auto& upgrader = getNvmFormatUpgrader();
+  upgrader.addStep(kCacheNvmFormatVersion - 1,
+                   [](serialization::NvmCacheMetadata& metadata) {
+                     *metadata.creationTime() += 1;
+                   });
+  {
+    SCOPE_EXIT { upgrader.removeStep(kCacheNvmFormatVersion - 1); };
+    writePrevVersion();
+    NvmCacheState s(util::getCurrentTimeSec(), dir, false /* encryption */,
+                    false /* truncateAllocSize */);
+    ASSERT_TRUE(s.wasCleanShutDown());
+    ASSERT_FALSE(s.shouldDropNvmCache());
+
+    // Restored through the upgrade step
+    ASSERT_EQ(12346, s.getCreationTime());
+
+    // The state is persisted in the current version
+    s.markSafeShutDown();
+  }
+
+  {
+    NvmCacheState s(util::getCurrentTimeSec(), dir, false /* encryption */,
+                    false /* truncateAllocSize */);
+    ASSERT_TRUE(s.wasCleanShutDown());
+    ASSERT_FALSE(s.shouldDropNvmCache());
+    ASSERT_EQ(12346, s.getCreationTime());
+  }
+
+  {
+    // Dropped once the upgrade step is gone
+    writePrevVersion();
+    NvmCacheState s(util::getCurrentTimeSec(), dir, false /* encryption */,
+                    false /* truncateAllocSize */);
+    ASSERT_TRUE(s.shouldDropNvmCache());
+    ASSERT_NE(12345, s.getCreationTime());
+  }
+}
+
 TEST_F(NvmCacheStateTest, Encryption) {
   auto dir = getCacheDir();
 
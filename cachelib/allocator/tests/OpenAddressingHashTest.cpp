@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/allocator/OpenAddressingHashTable.h"
+#include "cachelib/allocator/CacheAllocator.h"
+#include "cachelib/allocator/tests/AccessTypeTest.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+using facebook::cachelib::OpenAddressingHashTable;
+using OpenAddressingHashTest = AccessTypeTest<OpenAddressingHashTable>;
+
+TEST(OpenAddressingHashTableConfigTest, Size) {
+  using HashConfig = OpenAddressingHashTable::Config;
+  HashConfig config{};
+  config.sizeBucketsPowerAndLocksPower(1000000);
+  EXPECT_EQ(config.getBucketsPower(), 21);
+  EXPECT_EQ(config.getLocksPower(), 11);
+
+  ASSERT_THROW(config.sizeBucketsPowerAndLocksPower(2700000000),
+               std::invalid_argument);
+
+  // never less than a group of slots
+  config.sizeBucketsPowerAndLocksPower(1);
+  EXPECT_EQ(config.getBucketsPower(), 4);
+  EXPECT_EQ(config.getLocksPower(), 3);
+
+  ASSERT_THROW(HashConfig(3, 1), std::invalid_argument);
+  ASSERT_THROW(HashConfig(4, 5), std::invalid_argument);
+  ASSERT_THROW(HashConfig(33, 10), std::invalid_argument);
+}
+
+TEST_F(OpenAddressingHashTest, Insert) { testInsert(); }
+
+TEST_F(OpenAddressingHashTest, Replace) { testReplace(); }
+
+TEST_F(OpenAddressingHashTest, Remove) { testRemove(); }
+
+TEST_F(OpenAddressingHashTest, Find) { testFind(); }
+
+TEST_F(OpenAddressingHashTest, HandleIteration) {
+  testHandleIterationWithExceptions();
+}
+
+TEST_F(OpenAddressingHashTest, RemoveIf) { testRemoveIf(); }
+
+TEST_F(OpenAddressingHashTest, testIteratorMayContainNull) {
+  testIteratorMayContainNull();
+}
+
+TEST_F(OpenAddressingHashTest, Serialization) { testSerialization(); }
+
+TEST_F(OpenAddressingHashTest, IteratorBasic) { testIteratorBasic(); }
+
+TEST_F(OpenAddressingHashTest, IteratorWithInserts) {
+  testIteratorWithInserts();
+}
+
+TEST_F(OpenAddressingHashTest, IteratorWithSerialization) {
+  testIteratorWithSerialization();
+}
+
+TEST_F(OpenAddressingHashTest, Full) {
+  // a single group of 16 slots takes 14 keys.
+  Container c{Config{4, 0}, PtrCompressor{}};
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 14; i++) {
+    nodes.emplace_back(new Node(getRandomNewKey(c)));
+    ASSERT_TRUE(c.insert(*nodes.back()));
+  }
+
+  std::unique_ptr<Node> extra{new Node(getRandomNewKey(c))};
+  ASSERT_FALSE(c.insert(*extra));
+  ASSERT_THROW(c.insertOrReplace(*extra), exception::AccessContainerFull);
+  ASSERT_FALSE(extra->isAccessible());
+  ASSERT_EQ(nullptr, c.find(extra->getKey()));
+  ASSERT_EQ(14, c.getNumKeys());
+  ASSERT_EQ(2, c.getStats().numInsertFailures);
+
+  // replacing an existing key does not need another slot.
+  std::unique_ptr<Node> replacement{new Node(nodes[0]->getKey())};
+  ASSERT_EQ(nodes[0].get(), c.insertOrReplace(*replacement).get());
+  ASSERT_FALSE(nodes[0]->isAccessible());
+  ASSERT_EQ(replacement.get(), c.find(replacement->getKey()).get());
+  nodes[0] = std::move(replacement);
+
+  // removing a key makes room for another one.
+  ASSERT_TRUE(c.remove(*nodes.back()));
+  ASSERT_TRUE(c.insert(*extra));
+  for (size_t i = 0; i + 1 < nodes.size(); i++) {
+    ASSERT_EQ(nodes[i].get(), c.find(nodes[i]->getKey()).get());
+  }
+  ASSERT_EQ(extra.get(), c.find(extra->getKey()).get());
+}
+
+TEST_F(OpenAddressingHashTest, Churn) {
+  // keep a small table at capacity while keys come and go so that slots are
+  // freed with deleted markers and the shards get rebuilt.
+  Container c{Config{6, 1}, PtrCompressor{}};
+  std::vector<std::unique_ptr<Node>> nodes;
+  while (true) {
+    nodes.emplace_back(new Node(getRandomNewKey(c)));
+    if (!c.insert(*nodes.back())) {
+      nodes.pop_back();
+      break;
+    }
+  }
+  // a shard takes 7/8 of its slots.
+  ASSERT_EQ(56, nodes.size());
+
+  std::vector<std::unique_ptr<Node>> removedNodes;
+  for (int i = 0; i < 10000; i++) {
+    auto& victim = nodes[folly::Random::rand32() % nodes.size()];
+    ASSERT_TRUE(c.remove(*victim));
+    removedNodes.push_back(std::move(victim));
+    victim.reset(new Node(getRandomNewKey(c)));
+    ASSERT_TRUE(c.insert(*victim));
+  }
+
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node.get(), c.find(node->getKey()).get());
+  }
+  for (const auto& node : removedNodes) {
+    ASSERT_FALSE(node->isAccessible());
+  }
+  ASSERT_EQ(nodes.size(), c.getNumKeys());
+}
+
+TEST_F(OpenAddressingHashTest, Stats) {
+  Config config{10, 2};
+  Container c{config, PtrCompressor{}};
+  auto nodes = createSimpleContainer(c);
+  const auto stats = c.getStats();
+  ASSERT_EQ(nodes.size(), stats.numKeys);
+  ASSERT_EQ(config.getNumBuckets(), stats.numBuckets);
+  ASSERT_EQ(0, stats.numInsertFailures);
+
+  const auto distribution = c.getDistributionStats();
+  ASSERT_EQ(nodes.size(), distribution.numKeys);
+  ASSERT_EQ(config.getNumBuckets(), distribution.numBuckets);
+  uint64_t numGroups = 0;
+  uint64_t numKeys = 0;
+  for (const auto& [groupSize, count] : distribution.itemDistribution) {
+    ASSERT_LE(groupSize, 16);
+    numGroups += count;
+    numKeys += groupSize * count;
+  }
+  ASSERT_EQ(config.getNumBuckets() / 16, numGroups);
+  ASSERT_EQ(nodes.size(), numKeys);
+}
+
+TEST_F(OpenAddressingHashTest, Config) {
+  Config config{10, 2};
+  auto configMap = config.serialize();
+  ASSERT_EQ("10", configMap["BucketsPower"]);
+  ASSERT_EQ("2", configMap["LocksPower"]);
+  ASSERT_EQ("MurmurHash2", configMap["Hasher"]);
+}
+
+TEST_F(OpenAddressingHashTest, FindBatch) {
+  Container c{Config{12, 2}, PtrCompressor{}};
+  auto nodes = createSimpleContainer(c);
+
+  std::vector<std::string> keyStrs;
+  for (const auto& node : nodes) {
+    keyStrs.push_back(node->getKey().str());
+    keyStrs.push_back(getRandomNewKey(c));
+  }
+  std::vector<Node::Key> keys;
+  for (const auto& k : keyStrs) {
+    keys.emplace_back(k);
+  }
+
+  auto handles = c.findBatch(folly::range(keys));
+  ASSERT_EQ(keys.size(), handles.size());
+  for (size_t i = 0; i < handles.size(); i++) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(nodes[i / 2].get(), handles[i].get());
+    } else {
+      ASSERT_EQ(nullptr, handles[i]);
+    }
+  }
+  handles.clear();
+  for (const auto& node : nodes) {
+    ASSERT_EQ(0u, node->getRefCount());
+  }
+}
+
+TEST(OpenAddressingAllocatorTest, InsertFindRemove) {
+  LruOpenAddressingAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  config.setAccessConfig({12, 4});
+  LruOpenAddressingAllocator cache(config);
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+
+  for (int i = 0; i < 1000; i++) {
+    auto handle = cache.allocate(pid, folly::sformat("key{}", i), 100);
+    ASSERT_NE(nullptr, handle);
+    cache.insertOrReplace(handle);
+  }
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_NE(nullptr, cache.find(folly::sformat("key{}", i)));
+  }
+  ASSERT_EQ(LruOpenAddressingAllocator::RemoveRes::kSuccess,
+            cache.remove("key0"));
+  ASSERT_EQ(nullptr, cache.find("key0"));
+  ASSERT_EQ(999, cache.getAccessContainerNumKeys());
+}
+
+TEST(OpenAddressingAllocatorTest, Full) {
+  LruOpenAddressingAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  config.setAccessConfig({4, 0});
+  LruOpenAddressingAllocator cache(config);
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+
+  for (int i = 0; i < 14; i++) {
+    auto handle = cache.allocate(pid, folly::sformat("key{}", i), 100);
+    ASSERT_NE(nullptr, handle);
+    ASSERT_TRUE(cache.insert(handle));
+  }
+
+  auto handle = cache.allocate(pid, "extra", 100);
+  ASSERT_NE(nullptr, handle);
+  ASSERT_FALSE(cache.insert(handle));
+  ASSERT_THROW(cache.insertOrReplace(handle), exception::AccessContainerFull);
+  ASSERT_EQ(nullptr, cache.find("extra"));
+  ASSERT_LT(0, cache.getAccessContainerStats().numInsertFailures);
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
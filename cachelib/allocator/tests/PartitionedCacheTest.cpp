@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "cachelib/allocator/CacheAllocator.h"
+#include "cachelib/allocator/PartitionedCache.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+using PartitionedLruCache = PartitionedCache<LruAllocator>;
+
+namespace {
+LruAllocator::Config makeCacheConfig(size_t numSlabs) {
+  LruAllocator::Config config;
+  config.setCacheSize(numSlabs * Slab::kSize);
+  return config;
+}
+} // namespace
+
+TEST(PartitionedCacheTest, InvalidConfig) {
+  PartitionedCacheConfig config;
+  config.numPartitions = 0;
+  EXPECT_THROW(PartitionedLruCache(config, makeCacheConfig(10)),
+               std::invalid_argument);
+
+  // the budget does not fit in the partitions
+  config.numPartitions = 2;
+  config.memoryBudget = 40 * Slab::kSize;
+  EXPECT_THROW(PartitionedLruCache(config, makeCacheConfig(10)),
+               std::invalid_argument);
+}
+
+TEST(PartitionedCacheTest, RoutesKeysToPartitions) {
+  PartitionedCacheConfig config;
+  config.numPartitions = 4;
+  std::vector<uint32_t> setupCalls;
+  PartitionedLruCache cache(
+      config, makeCacheConfig(10),
+      [&setupCalls](uint32_t idx, LruAllocator::Config& partitionConfig) {
+        setupCalls.push_back(idx);
+        partitionConfig.setCacheName(folly::sformat("partition{}", idx));
+      });
+  ASSERT_EQ((std::vector<uint32_t>{0, 1, 2, 3}), setupCalls);
+
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+  for (uint32_t i = 0; i < cache.numPartitions(); i++) {
+    ASSERT_EQ(1, cache.getPartition(i).getPoolIds().size());
+  }
+
+  std::vector<uint32_t> keysPerPartition(cache.numPartitions(), 0);
+  for (int i = 0; i < 100; i++) {
+    const auto key = folly::sformat("key{}", i);
+    auto handle = cache.allocate(pid, key, 100);
+    ASSERT_NE(nullptr, handle);
+    cache.insertOrReplace(handle);
+
+    const auto idx = cache.getPartitionIdx(key);
+    ASSERT_NE(nullptr, cache.getPartition(idx).find(key));
+    ASSERT_NE(nullptr, cache.find(key));
+    keysPerPartition[idx]++;
+  }
+  for (auto numKeys : keysPerPartition) {
+    ASSERT_LT(0, numKeys);
+  }
+  ASSERT_EQ(100, cache.getPoolStats(pid).numItems());
+
+  ASSERT_EQ(LruAllocator::RemoveRes::kSuccess, cache.remove("key0"));
+  ASSERT_EQ(nullptr, cache.find("key0"));
+  ASSERT_EQ(99, cache.getPoolStats(pid).numItems());
+}
+
+TEST(PartitionedCacheTest, SharedBudget) {
+  PartitionedCacheConfig config;
+  config.numPartitions = 2;
+  config.memoryBudget = 20 * Slab::kSize;
+  config.slabsPerRebalance = 2;
+  config.minSharePercent = 50;
+  PartitionedLruCache cache(config, makeCacheConfig(20));
+
+  // every partition advises away what it has above its half of the budget
+  const auto slabs =
+      cache.getPartition(0).getCacheMemoryStats().configuredRamCacheSize /
+      Slab::kSize;
+  ASSERT_EQ(slabs - 10, cache.getNumSlabsToAdvise(0));
+  ASSERT_EQ(slabs - 10, cache.getNumSlabsToAdvise(1));
+
+  // no evictions, nothing to move
+  const auto pid =
+      cache.addPool("default", cache.getCacheMemoryStats().ramCacheSize);
+  ASSERT_EQ(0, cache.rebalance());
+
+  // evict from the partition of one key only
+  const uint32_t hot = cache.getPartitionIdx("key0");
+  auto& partition = cache.getPartition(hot);
+  for (int i = 0; i < 100000 && cache.getPoolStats(pid).numEvictions() == 0;
+       i++) {
+    auto handle = partition.allocate(pid, folly::sformat("key{}", i), 1000);
+    if (handle) {
+      partition.insertOrReplace(handle);
+    }
+  }
+  ASSERT_LT(0, cache.getPoolStats(pid).numEvictions());
+
+  ASSERT_EQ(2, cache.rebalance());
+  ASSERT_EQ(slabs - 12, cache.getNumSlabsToAdvise(hot));
+  ASSERT_EQ(slabs - 8, cache.getNumSlabsToAdvise(1 - hot));
+  ASSERT_EQ(2, cache.getNumSlabsMoved());
+
+  // without new evictions, nothing moves
+  ASSERT_EQ(0, cache.rebalance());
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "cachelib/allocator/CacheAllocator.h"
+#include "cachelib/allocator/PiecewiseObjects.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+namespace {
+using Objects = PiecewiseObjects<LruAllocator>;
+
+std::string makeBody(size_t size) {
+  std::string body(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    body[i] = static_cast<char>('a' + i % 26);
+  }
+  return body;
+}
+
+std::unique_ptr<LruAllocator> makeCache(PoolId& pid) {
+  LruAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  auto cache = std::make_unique<LruAllocator>(config);
+  pid = cache->addPool("default", cache->getCacheMemoryStats().ramCacheSize);
+  return cache;
+}
+
+// insert the given pieces of the body
+void insertPieces(Objects& objects,
+                  const LruAllocator::WriteHandle& header,
+                  const std::string& body,
+                  uint32_t pieceSize,
+                  const std::vector<uint32_t>& indexes) {
+  for (auto i : indexes) {
+    auto piece = folly::StringPiece{body}.subpiece(i * pieceSize, pieceSize);
+    ASSERT_TRUE(objects.insertPiece(header, i, folly::ByteRange{piece}));
+  }
+}
+} // namespace
+
+TEST(PiecewiseObjectsTest, ReadRange) {
+  PoolId pid;
+  auto cache = makeCache(pid);
+  Objects objects{*cache};
+
+  const auto body = makeBody(10000);
+  const uint32_t pieceSize = 1024;
+  auto header = objects.create(pid, "object", body.size(), pieceSize);
+  ASSERT_NE(nullptr, header);
+  insertPieces(objects, header, body, pieceSize,
+               {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  header.reset();
+
+  for (auto [offset, length] : std::vector<std::pair<uint64_t, uint64_t>>{
+           {0, 10000}, {0, 1}, {1000, 100}, {1023, 2}, {5000, 3000},
+           {9999, 1}, {9000, 50000}}) {
+    auto range = objects.read("object", offset, length);
+    ASSERT_TRUE(range.isComplete());
+    const auto expected = body.substr(offset, length);
+    ASSERT_EQ(expected.size(), range.length);
+    ASSERT_EQ(offset / pieceSize, range.firstPiece);
+
+    std::string copy(range.length, '\0');
+    range.copyTo(copy.data());
+    ASSERT_EQ(expected, copy);
+
+    auto buf = range.toIOBuf();
+    ASSERT_EQ(range.pieces.size(), buf->countChainElements());
+    ASSERT_EQ(expected, buf->moveToFbString().toStdString());
+  }
+
+  EXPECT_THROW(objects.read("object", 10000, 1), std::invalid_argument);
+  ASSERT_EQ(nullptr, objects.read("missing", 0, 1).header);
+}
+
+TEST(PiecewiseObjectsTest, MissingPieces) {
+  PoolId pid;
+  auto cache = makeCache(pid);
+  Objects objects{*cache};
+
+  const auto body = makeBody(4000);
+  const uint32_t pieceSize = 1000;
+  auto header = objects.create(pid, "object", body.size(), pieceSize);
+  insertPieces(objects, header, body, pieceSize, {0, 2});
+
+  auto range = objects.read("object", 500, 3000);
+  ASSERT_FALSE(range.isComplete());
+  ASSERT_EQ((std::vector<uint32_t>{1, 3}), range.getMissingPieces());
+  EXPECT_THROW(range.toIOBuf(), std::logic_error);
+  range = {};
+
+  // a piece that was evicted is reported as missing although the header
+  // still has it
+  const auto key = Objects::makePieceKey(Objects::getHeader(*header)->id, 2);
+  cache->remove(LruAllocator::Key{key.data(), key.size()});
+  ASSERT_EQ((std::vector<uint32_t>{1, 2, 3}),
+            objects.read("object", 0, 4000).getMissingPieces());
+
+  insertPieces(objects, header, body, pieceSize, {1, 2, 3});
+  ASSERT_TRUE(objects.read("object", 0, 4000).isComplete());
+
+  // the last piece is only as large as the rest of the object
+  EXPECT_THROW(objects.insertPiece(header, 3, folly::ByteRange{}),
+               std::invalid_argument);
+  EXPECT_THROW(objects.insertPiece(header, 4, folly::ByteRange{}),
+               std::invalid_argument);
+}
+
+TEST(PiecewiseObjectsTest, ReplaceAndRemove) {
+  PoolId pid;
+  auto cache = makeCache(pid);
+  Objects objects{*cache};
+
+  const auto body = makeBody(3000);
+  auto header = objects.create(pid, "object", body.size(), 1000);
+  insertPieces(objects, header, body, 1000, {0, 1, 2});
+  const auto oldId = Objects::getHeader(*header)->id;
+
+  // a new version does not serve the pieces of the previous one
+  header = objects.create(pid, "object", body.size(), 1000);
+  ASSERT_NE(oldId, Objects::getHeader(*header)->id);
+  ASSERT_EQ((std::vector<uint32_t>{0, 1, 2}),
+            objects.read("object", 0, 3000).getMissingPieces());
+
+  insertPieces(objects, header, body, 1000, {0, 1, 2});
+  const auto key = Objects::makePieceKey(Objects::getHeader(*header)->id, 1);
+  header.reset();
+  ASSERT_TRUE(objects.findToWrite("object"));
+
+  ASSERT_TRUE(objects.remove("object"));
+  ASSERT_FALSE(objects.remove("object"));
+  ASSERT_EQ(nullptr, cache->find(LruAllocator::Key{key.data(), key.size()}));
+
+  // regular items are not piecewise objects
+  auto item = cache->allocate(pid, "regular", 100);
+  cache->insertOrReplace(item);
+  ASSERT_EQ(nullptr, objects.read("regular", 0, 1).header);
+  ASSERT_FALSE(objects.findToWrite("regular"));
+
+  EXPECT_THROW(objects.create(pid, "object", 0, 1000), std::invalid_argument);
+  EXPECT_THROW(objects.create(pid, "object", 1000, 0), std::invalid_argument);
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
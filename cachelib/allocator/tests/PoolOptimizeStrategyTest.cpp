@@ -19,6 +19,7 @@
 #include "cachelib/allocator/CCacheAllocator.h"
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/allocator/MarginalHitsOptimizeStrategy.h"
+#include "cachelib/allocator/MissRatioCurveOptimizeStrategy.h"
 #include "cachelib/allocator/PoolOptimizeStrategy.h"
 #include "cachelib/allocator/tests/TestBase.h"
 #include "cachelib/compact_cache/CCacheCreator.h"
@@ -204,6 +205,159 @@ TEST_F(PoolOptimizeStrategy2QTest, MarginalHitsCompactCacheOptimize) {
   }
 }
 
+TEST_F(PoolOptimizeStrategy2QTest, MarginalHitsAcrossPoolsOptimize) {
+  using MMConfig = Lru2QAllocator::MMConfig;
+  const auto itemSize = 10240;
+  const auto numItemsInBucket = 8;
+  const auto numOps = 10;
+  Lru2QAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  config.enableTailHitsTracking();
+  config.enableCompactCache();
+  auto cache = std::make_unique<Lru2QAllocator>(config);
+
+  MMConfig mmConfig;
+  // get rid of hot and warm queue
+  mmConfig.hotSizePercent = 0;
+  mmConfig.coldSizePercent = 100;
+  // always promote
+  mmConfig.lruRefreshTime = 0;
+  const std::set<uint32_t> allocSizes{static_cast<uint32_t>(Slab::kSize)};
+  auto p0 =
+      cache->addPool("Pool0", cache->getCacheMemoryStats().ramCacheSize / 2,
+                     allocSizes, mmConfig);
+  ASSERT_NE(Slab::kInvalidPoolId, p0);
+
+  using CCacheT =
+      typename CCacheCreator<CCacheAllocator, LargeInt, LargeInt>::type;
+  typename CCacheT::Value dummyValue(0xAA);
+  auto& ccache = *cache->template addCompactCache<CCacheT>("C0", Slab::kSize);
+  cache->setPoolOptimizerFor(cache->getPoolId("C0"), true);
+  auto p1 = this->getCompactCacheId(*cache, "C0");
+  ASSERT_GE(ccache.getSize(), Slab::kSize);
+  // one entry of every bucket is the tail
+  EXPECT_EQ(ccache.getSize() / numItemsInBucket, ccache.getTailSize());
+
+  uint32_t numItems;
+  for (numItems = 0; !cache->getPoolStats(p0).numEvictions(); numItems++) {
+    auto handle = util::allocateAccessible(
+        *cache, p0, "key0-" + std::to_string(numItems), itemSize);
+    ASSERT_NE(nullptr, handle);
+  }
+  for (uint32_t i = 1; i <= numItemsInBucket; i++) {
+    ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(i, &dummyValue));
+  }
+
+  MarginalHitsOptimizeStrategy::Config strategyConfig(
+      /* moving average param */ 0.3,
+      /* pool min size slab */ 0,
+      /* pool max free memory slab */ 1);
+  strategyConfig.rankAcrossPools = true;
+  auto strategy =
+      std::make_shared<MarginalHitsOptimizeStrategy>(strategyConfig);
+
+  // initialize pool states
+  {
+    auto init = strategy->pickVictimAndReceiverRegularPools(*cache);
+    EXPECT_EQ(init.victimPoolId, Slab::kInvalidPoolId);
+    EXPECT_EQ(init.receiverPoolId, Slab::kInvalidPoolId);
+  }
+
+  // access the compact cache at tail
+  for (uint32_t i = 1; i <= numOps; i++) {
+    ASSERT_EQ(CCacheReturn::FOUND,
+              ccache.get(1, /* value */ nullptr, /* size */ nullptr,
+                         /* promotion */ false));
+  }
+
+  // move from the regular pool to the compact cache, the compact cache
+  // rounds pick nothing
+  {
+    auto ctx = strategy->pickVictimAndReceiverCompactCaches(*cache);
+    EXPECT_EQ(Slab::kInvalidPoolId, ctx.victimPoolId);
+    EXPECT_EQ(Slab::kInvalidPoolId, ctx.receiverPoolId);
+    ctx = strategy->pickVictimAndReceiverRegularPools(*cache);
+    EXPECT_EQ(p1, ctx.receiverPoolId);
+    EXPECT_EQ(p0, ctx.victimPoolId);
+  }
+
+  // access the regular pool at tail
+  for (uint32_t i = 1; i < numOps && i < numItems; i++) {
+    ASSERT_NE(nullptr, cache->find("key0-" + std::to_string(i)));
+  }
+
+  // move from the compact cache to the regular pool
+  {
+    auto ctx = strategy->pickVictimAndReceiverRegularPools(*cache);
+    EXPECT_EQ(p0, ctx.receiverPoolId);
+    EXPECT_EQ(p1, ctx.victimPoolId);
+  }
+}
+
+TEST(MissRatioCurveOptimizeStrategyTest, ComputeTargetSlabs) {
+  // pool 1 only hits once it holds 8 slabs, pool 2 gains a little with every
+  // slab
+  MissRatioCurve cliff;
+  cliff.bucketBytes = Slab::kSize;
+  MissRatioCurve slope;
+  slope.bucketBytes = Slab::kSize;
+  for (size_t i = 0; i < 10; i++) {
+    cliff.hits.push_back(i < 7 ? 0 : 1000);
+    slope.hits.push_back(50 * (i + 1));
+  }
+  cliff.numAccesses = slope.numAccesses = 2000;
+
+  const std::map<PoolId, size_t> current{{1, 5}, {2, 5}};
+  auto target = MissRatioCurveOptimizeStrategy::computeTargetSlabs(
+      {{1, cliff}, {2, slope}}, current, 10, 1);
+  EXPECT_EQ((std::map<PoolId, size_t>{{1, 8}, {2, 2}}), target);
+
+  // not enough slabs to reach the cliff
+  target = MissRatioCurveOptimizeStrategy::computeTargetSlabs(
+      {{1, cliff}, {2, slope}}, current, 6, 1);
+  EXPECT_EQ((std::map<PoolId, size_t>{{1, 1}, {2, 5}}), target);
+
+  // slabs that add no hits stay where they are
+  MissRatioCurve flat;
+  flat.bucketBytes = Slab::kSize;
+  flat.hits.assign(10, 0);
+  target = MissRatioCurveOptimizeStrategy::computeTargetSlabs(
+      {{1, flat}, {2, flat}}, current, 10, 1);
+  EXPECT_EQ(current, target);
+}
+
+TEST_F(PoolOptimizeStrategy2QTest, MissRatioCurveRegularPoolOptimize) {
+  const auto itemSize = 10240;
+  Lru2QAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  config.enableMissRatioCurves(1, 16384);
+  auto cache = std::make_unique<Lru2QAllocator>(config);
+  const auto poolSize = cache->getCacheMemoryStats().ramCacheSize / 2;
+  auto p0 = cache->addPool("Pool0", poolSize);
+  auto p1 = cache->addPool("Pool1", poolSize);
+  ASSERT_NE(Slab::kInvalidPoolId, p0);
+  ASSERT_NE(Slab::kInvalidPoolId, p1);
+
+  // pool 0 loops over more than its size, pool 1 over a few items
+  auto access = [&](PoolId pid, const std::string& key) {
+    if (!cache->find(key)) {
+      util::allocateAccessible(*cache, pid, key, itemSize);
+    }
+  };
+  const size_t numKeys0 = poolSize * 3 / 2 / itemSize;
+  for (int loop = 0; loop < 3; loop++) {
+    for (size_t i = 0; i < numKeys0; i++) {
+      access(p0, "key0-" + std::to_string(i));
+      access(p1, "key1-" + std::to_string(i % 100));
+    }
+  }
+
+  auto strategy = std::make_shared<MissRatioCurveOptimizeStrategy>();
+  auto ctx = strategy->pickVictimAndReceiverRegularPools(*cache);
+  EXPECT_EQ(p0, ctx.receiverPoolId);
+  EXPECT_EQ(p1, ctx.victimPoolId);
+}
+
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
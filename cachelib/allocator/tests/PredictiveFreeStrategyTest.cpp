@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "cachelib/allocator/CacheAllocator.h"
+#include "cachelib/allocator/PredictiveFreeStrategy.h"
+#include "cachelib/allocator/tests/AllocatorTestUtils.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+TEST(PredictiveFreeStrategyTest, InvalidConfig) {
+  PredictiveFreeStrategy::Config config;
+  config.ewmaWeight = 0;
+  EXPECT_THROW(PredictiveFreeStrategy{config}, std::invalid_argument);
+
+  config = {};
+  config.headroom = 0.5;
+  EXPECT_THROW(PredictiveFreeStrategy{config}, std::invalid_argument);
+
+  config = {};
+  config.maxHeadroom = 1;
+  EXPECT_THROW(PredictiveFreeStrategy{config}, std::invalid_argument);
+
+  config = {};
+  config.minBatch = 0;
+  EXPECT_THROW(PredictiveFreeStrategy{config}, std::invalid_argument);
+
+  config = {};
+  config.maxBatch = 0;
+  EXPECT_THROW(PredictiveFreeStrategy{config}, std::invalid_argument);
+}
+
+TEST(PredictiveFreeStrategyTest, BatchCoversForecast) {
+  LruAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  LruAllocator cache{config};
+  const size_t poolSize = cache.getCacheMemoryStats().ramCacheSize / 2;
+  const std::set<uint32_t> allocSizes{1024, 64 * 1024};
+  const auto fullPid = cache.addPool("full", poolSize, allocSizes);
+  const auto freePid = cache.addPool("free", poolSize, allocSizes);
+
+  const uint32_t valSize = 500;
+  int key = 0;
+  auto allocate = [&](PoolId pid) {
+    auto handle = util::allocateAccessible(
+        cache, pid, folly::sformat("key_{}", key++), valSize);
+    EXPECT_NE(nullptr, handle);
+    return cache.getAllocInfo(handle->getMemory()).classId;
+  };
+
+  // fill up the first pool
+  ClassId cid{};
+  while (cache.getPoolStats(fullPid).numEvictions() == 0) {
+    cid = allocate(fullPid);
+  }
+  ASSERT_EQ(cid, allocate(freePid));
+
+  PredictiveFreeStrategy strategy;
+  const std::vector<MemoryDescriptorType> acVec{{fullPid, cid},
+                                                {freePid, cid}};
+  // nothing to forecast from yet
+  EXPECT_EQ((std::vector<size_t>{0, 0}),
+            strategy.calculateBatchSizes(cache, acVec));
+
+  const size_t numAllocs = 200;
+  for (size_t i = 0; i < numAllocs; i++) {
+    allocate(fullPid);
+    allocate(freePid);
+  }
+
+  // the full pool evicts ahead of the forecast allocations while the other
+  // still has room for them
+  const auto batches = strategy.calculateBatchSizes(cache, acVec);
+  EXPECT_GE(batches[0], numAllocs);
+  EXPECT_LE(batches[0], PredictiveFreeStrategy::Config{}.maxBatch);
+  EXPECT_EQ(0, batches[1]);
+}
+
+TEST(PredictiveFreeStrategyTest, SloHintKeepsFreeAllocs) {
+  LruAllocator::Config config;
+  config.setCacheSize(20 * Slab::kSize);
+  LruAllocator cache{config};
+  const size_t poolSize = cache.getCacheMemoryStats().ramCacheSize / 2;
+  const std::set<uint32_t> allocSizes{1024, 64 * 1024};
+  const auto fullPid = cache.addPool("full", poolSize, allocSizes);
+  const auto otherPid = cache.addPool("other", poolSize, allocSizes);
+
+  EXPECT_THROW(cache.setPoolSloHint(fullPid, {0, 0}), std::invalid_argument);
+  EXPECT_THROW(cache.setPoolSloHint(fullPid, {1, 100}),
+               std::invalid_argument);
+  EXPECT_EQ(1, cache.getPoolSloHint(fullPid).weight);
+  cache.setPoolSloHint(fullPid, {2, 10});
+  EXPECT_EQ(2, cache.getPoolSloHint(fullPid).weight);
+  EXPECT_EQ(10, cache.getPoolSloHint(fullPid).minFreeAllocPct);
+
+  int key = 0;
+  ClassId cid{};
+  while (cache.getPoolStats(fullPid).numEvictions() == 0) {
+    auto handle = util::allocateAccessible(
+        cache, fullPid, folly::sformat("key_{}", key++), 500);
+    ASSERT_NE(nullptr, handle);
+    cid = cache.getAllocInfo(handle->getMemory()).classId;
+  }
+  ASSERT_NE(nullptr, util::allocateAccessible(cache, otherPid, "other", 500));
+
+  // the pool with the hint keeps a tenth of its allocations free even with
+  // nothing to forecast from, while the full pool without it does not
+  PredictiveFreeStrategy strategy;
+  EXPECT_LT(0, strategy.calculateBatchSizes(cache, {{fullPid, cid}})[0]);
+  EXPECT_EQ((std::vector<size_t>{0}),
+            strategy.calculateBatchSizes(cache, {{otherPid, cid}}));
+
+  cache.setPoolSloHint(fullPid, {});
+  PredictiveFreeStrategy noHintStrategy;
+  EXPECT_EQ((std::vector<size_t>{0}),
+            noHintStrategy.calculateBatchSizes(cache, {{fullPid, cid}}));
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
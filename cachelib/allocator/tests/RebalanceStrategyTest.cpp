@@ -190,6 +190,46 @@ class RebalanceStrategyTest : public testing::Test {
     }
   }
 
+  void runConcurrentPoolRebalancerTest() {
+    typename AllocatorT::Config config;
+    config.setCacheSize(20 * Slab::kSize);
+
+    const ClassId victim = static_cast<ClassId>(1);
+    const ClassId receiver = static_cast<ClassId>(0);
+    config.enablePoolRebalancing(
+        std::make_shared<AlwaysPickOneRebalanceStrategy>(victim, receiver),
+        std::chrono::milliseconds{100});
+    config.poolRebalancerThreads = 2;
+    auto cache = std::make_unique<AllocatorT>(config);
+
+    const std::set<uint32_t> allocSizes{10000, 100000};
+    const auto poolSize = cache->getCacheMemoryStats().ramCacheSize / 2;
+    const std::vector<PoolId> pids{
+        cache->addPool("pool0", poolSize, allocSizes),
+        cache->addPool("pool1", poolSize, allocSizes)};
+
+    /* Allocate in both pools until both released a slab */
+    uint i = 0;
+    auto hasEvents = [&](PoolId pid) {
+      return !cache->getAllSlabReleaseEvents(pid).rebalancerEvents.empty();
+    };
+    while (!hasEvents(pids[0]) || !hasEvents(pids[1])) {
+      for (auto pid : pids) {
+        util::allocateAccessible(*cache, pid, folly::sformat("key_{}", i++),
+                                 50000);
+      }
+    }
+    for (auto pid : pids) {
+      for (const auto& event :
+           cache->getAllSlabReleaseEvents(pid).rebalancerEvents) {
+        ASSERT_EQ(event.from, victim);
+        ASSERT_EQ(event.to, receiver);
+        ASSERT_EQ(event.pid, pid);
+      }
+    }
+    ASSERT_GT(cache->getRebalancerStats().numRebalancedSlabs, 1);
+  }
+
   void testDeltaAllocFailures() {
     // 1. Create a pool with two allocation classes
     // 2. Allocate until one is full
@@ -521,6 +561,10 @@ TYPED_TEST(RebalanceStrategyTest, testPoolRebalancerStats) {
   this->runPoolRebalancerStatsTest();
 }
 
+TYPED_TEST(RebalanceStrategyTest, ConcurrentPoolRebalancer) {
+  this->runConcurrentPoolRebalancerTest();
+}
+
 TYPED_TEST(RebalanceStrategyTest, WeightedHitsPerSlabRebalancer) {
   this->testHitsPerSlabWithWeights();
 }
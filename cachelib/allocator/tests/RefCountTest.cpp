@@ -227,6 +227,26 @@ void RefCountTest::testMarkForEvictionAndMoving() {
     ref.incRef();
     ASSERT_FALSE(ref.markForEviction());
   }
+
+  {
+    // the holder of the only ref can turn it into the moving ref
+    RefcountWithFlags ref;
+    ref.markInMMContainer();
+    ASSERT_FALSE(ref.markMovingWhenOnlyRef());
+
+    ref.incRef();
+    ref.incRef();
+    ASSERT_FALSE(ref.markMovingWhenOnlyRef());
+
+    ref.decRef();
+    ASSERT_TRUE(ref.markMovingWhenOnlyRef());
+    ASSERT_TRUE(ref.isMoving());
+    ASSERT_EQ(RefcountWithFlags::IncResult::kIncFailedMoving, ref.incRef());
+
+    ref.unmarkInMMContainer();
+    auto ret = ref.unmarkMoving();
+    ASSERT_EQ(ret, 0);
+  }
 }
 } // namespace
 
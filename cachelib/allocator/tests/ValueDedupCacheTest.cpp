@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "cachelib/allocator/CacheAllocator.h"
+#include "cachelib/allocator/ValueDedupCache.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+using DedupLruCache = ValueDedupCache<LruAllocator>;
+
+namespace {
+std::unique_ptr<LruAllocator> makeCache(size_t numSlabs) {
+  LruAllocator::Config config;
+  config.setCacheSize(numSlabs * Slab::kSize);
+  return std::make_unique<LruAllocator>(config);
+}
+} // namespace
+
+TEST(ValueDedupCacheTest, SharesValuesAcrossPools) {
+  auto cache = makeCache(20);
+  const auto poolA = cache->addPool("a", 4 * Slab::kSize);
+  const auto poolB = cache->addPool("b", 4 * Slab::kSize);
+  const auto blobPool = cache->addPool("blobs", 4 * Slab::kSize);
+  DedupLruCache dedup{*cache, blobPool};
+
+  const std::string value(10000, 'v');
+  ASSERT_TRUE(dedup.insertOrReplace(poolA, "key1", value));
+  ASSERT_TRUE(dedup.insertOrReplace(poolB, "key2", value));
+  ASSERT_EQ(1, cache->getPoolStats(blobPool).numItems());
+
+  for (const auto key : {"key1", "key2"}) {
+    auto handle = dedup.find(key);
+    ASSERT_TRUE(handle);
+    EXPECT_TRUE(handle.isShared());
+    EXPECT_EQ(value, handle.getValue());
+  }
+
+  // the items of the keys only hold the references
+  auto item = cache->find("key1");
+  ASSERT_NE(nullptr, item);
+  EXPECT_LT(item->getSize(), 100u);
+
+  // removing one key leaves the value to the other
+  ASSERT_EQ(LruAllocator::RemoveRes::kSuccess, dedup.remove("key1"));
+  EXPECT_FALSE(dedup.find("key1"));
+  EXPECT_EQ(value, dedup.find("key2").getValue());
+
+  const auto stats = dedup.getStats();
+  EXPECT_EQ(1, stats.numBlobInserts);
+  EXPECT_EQ(1, stats.numSharedInserts);
+  EXPECT_EQ(value.size(), stats.bytesShared);
+  EXPECT_EQ(0, stats.numInlineInserts);
+}
+
+TEST(ValueDedupCacheTest, SmallAndDistinctValues) {
+  auto cache = makeCache(20);
+  const auto pid = cache->addPool("default", 4 * Slab::kSize);
+  const auto blobPool = cache->addPool("blobs", 4 * Slab::kSize);
+  DedupLruCache dedup{*cache, blobPool, 100};
+
+  // small values stay in the item of their key
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "small1", "value"));
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "small2", "value"));
+  EXPECT_EQ(0, cache->getPoolStats(blobPool).numItems());
+  auto handle = dedup.find("small1");
+  ASSERT_TRUE(handle);
+  EXPECT_FALSE(handle.isShared());
+  EXPECT_EQ("value", handle.getValue());
+
+  // replacing a value with another one gives it a blob of its own
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "large", std::string(200, 'a')));
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "large", std::string(200, 'b')));
+  EXPECT_EQ(2, cache->getPoolStats(blobPool).numItems());
+  EXPECT_EQ(std::string(200, 'b'), dedup.find("large").getValue());
+
+  const auto stats = dedup.getStats();
+  EXPECT_EQ(2, stats.numInlineInserts);
+  EXPECT_EQ(2, stats.numBlobInserts);
+  EXPECT_EQ(0, stats.numSharedInserts);
+
+  // keys of blobs are reserved
+  EXPECT_THROW(dedup.insertOrReplace(pid, folly::StringPiece{"\0vdbkey", 7},
+                                     "value"),
+               std::invalid_argument);
+}
+
+TEST(ValueDedupCacheTest, MissingBlob) {
+  auto cache = makeCache(20);
+  const auto pid = cache->addPool("default", 4 * Slab::kSize);
+  const auto blobPool = cache->addPool("blobs", 4 * Slab::kSize);
+  DedupLruCache dedup{*cache, blobPool};
+
+  const std::string value(5000, 'v');
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "key", value));
+
+  // drop the blob as an eviction would
+  for (auto it = cache->begin(); it != cache->end(); ++it) {
+    if (folly::StringPiece{it->getKey()} != "key") {
+      ASSERT_EQ(LruAllocator::RemoveRes::kSuccess, cache->remove(it));
+    }
+  }
+
+  // the key reads as a miss and its reference is gone
+  EXPECT_FALSE(dedup.find("key"));
+  EXPECT_EQ(nullptr, cache->find("key"));
+  EXPECT_EQ(1, dedup.getStats().numMissingBlobs);
+
+  // inserting the value again brings the blob back
+  ASSERT_TRUE(dedup.insertOrReplace(pid, "key", value));
+  EXPECT_EQ(value, dedup.find("key").getValue());
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
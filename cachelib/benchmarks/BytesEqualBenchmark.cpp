@@ -156,6 +156,9 @@ BENCHMARK_DRAW_LINE();
 BENCH_BASE(runBytesEqual, 16bytes, 16)
 BENCH_REL(runMemcmp, 16bytes, 16)
 BENCHMARK_DRAW_LINE();
+BENCH_BASE(runBytesEqual, 24bytes, 24)
+BENCH_REL(runMemcmp, 24bytes, 24)
+BENCHMARK_DRAW_LINE();
 BENCH_BASE(runBytesEqual, 32bytes, 32)
 BENCH_REL(runMemcmp, 32bytes, 32)
 BENCHMARK_DRAW_LINE();
@@ -180,6 +183,9 @@ BENCHMARK_DRAW_LINE();
 BENCH_BASE(runBytesEqualRand, 16bytes, 16)
 BENCH_REL(runMemcmpRand, 16bytes, 16)
 BENCHMARK_DRAW_LINE();
+BENCH_BASE(runBytesEqualRand, 24bytes, 24)
+BENCH_REL(runMemcmpRand, 24bytes, 24)
+BENCHMARK_DRAW_LINE();
 BENCH_BASE(runBytesEqualRand, 32bytes, 32)
 BENCH_REL(runMemcmpRand, 32bytes, 32)
 BENCHMARK_DRAW_LINE();
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+
+#include <cstring>
+#include <vector>
+
+#include "cachelib/compact_cache/CCache.h"
+
+// Compares the entry by entry key search of a compact cache bucket with the
+// wide compares used for keys that compare by their bytes.
+namespace facebook {
+namespace cachelib {
+template <size_t KeySize, bool kBitwise>
+struct FOLLY_PACK_ATTR BenchKey {
+  uint32_t value{};
+  uint8_t _[KeySize - sizeof(uint32_t)]{};
+
+  bool isEmpty() const { return value == 0; }
+  bool operator==(const BenchKey& rhs) const {
+    return std::memcmp(this, &rhs, sizeof(BenchKey)) == 0;
+  }
+
+  BenchKey() = default;
+  explicit BenchKey(uint32_t i) : value(i) {}
+};
+
+template <size_t KeySize>
+struct BitwiseComparableKey<BenchKey<KeySize, true>> : std::true_type {};
+} // namespace cachelib
+} // namespace facebook
+
+using namespace facebook::cachelib;
+
+DEFINE_uint64(num_buckets, 1024, "number of buckets searched");
+DEFINE_uint64(num_lookups, 10UL * 1000UL * 1000UL, "number of lookups");
+
+template <typename Key, typename Value>
+void runFind() {
+  using Descriptor = CompactCacheDescriptor<Key, ValueDescriptor<Value>>;
+  using BucketDesc = FixedLruBucket<Descriptor, NB_ENTRIES_PER_BUCKET>;
+  static_assert(BucketDesc::kWideKeyMatch ==
+                BitwiseComparableKey<Key>::value);
+
+  std::vector<typename BucketDesc::Bucket> buckets;
+  std::vector<Key> keys;
+  BENCHMARK_SUSPEND {
+    // value initialized, i.e. empty
+    buckets.resize(FLAGS_num_buckets);
+    uint32_t next = 1;
+    for (auto& bucket : buckets) {
+      for (int i = 0; i < NB_ENTRIES_PER_BUCKET; i++) {
+        Value value{};
+        BucketDesc::insert(&bucket, Key{next++}, &value, 0, [](auto&) {});
+      }
+    }
+    // 1 in 8 lookups misses
+    keys.reserve(FLAGS_num_lookups);
+    for (size_t i = 0; i < FLAGS_num_lookups; i++) {
+      keys.emplace_back(folly::Random::rand32(1, next + next / 8));
+    }
+  }
+
+  size_t found = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    // keys were inserted in order, NB_ENTRIES_PER_BUCKET per bucket
+    auto& bucket = buckets[(keys[i].value - 1) / NB_ENTRIES_PER_BUCKET %
+                           buckets.size()];
+    found += static_cast<bool>(BucketDesc::find(&bucket, keys[i]));
+  }
+  folly::doNotOptimizeAway(found);
+}
+
+BENCHMARK(Scalar8) { runFind<BenchKey<8, false>, NoValue>(); }
+BENCHMARK_RELATIVE(Wide8) { runFind<BenchKey<8, true>, NoValue>(); }
+BENCHMARK(Scalar8WithValue) { runFind<BenchKey<8, false>, uint64_t>(); }
+BENCHMARK_RELATIVE(Wide8WithValue) { runFind<BenchKey<8, true>, uint64_t>(); }
+BENCHMARK(Scalar16) { runFind<BenchKey<16, false>, NoValue>(); }
+BENCHMARK_RELATIVE(Wide16) { runFind<BenchKey<16, true>, NoValue>(); }
+BENCHMARK(Scalar16WithValue) { runFind<BenchKey<16, false>, uint64_t>(); }
+BENCHMARK_RELATIVE(Wide16WithValue) {
+  runFind<BenchKey<16, true>, uint64_t>();
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+
+#include <vector>
+
+#include "cachelib/compact_cache/CCache.h"
+
+// Compares the bucket that shifts the data on every delete and update with
+// the one that leaves holes and compacts lazily, on a mix of updates, deletes
+// and lookups of values of about 64 bytes. The buckets hold about 14 such
+// values: the resident runs map fewer keys to a bucket, so that most updates
+// find their key, the churn runs map more, so that most updates evict.
+using namespace facebook::cachelib;
+
+DEFINE_uint64(num_buckets, 1024, "number of buckets");
+DEFINE_uint64(resident_keys_per_bucket,
+              12,
+              "number of keys mapped to each bucket in the resident runs");
+DEFINE_uint64(churn_keys_per_bucket,
+              32,
+              "number of keys mapped to each bucket in the churn runs");
+DEFINE_uint64(num_ops, 10UL * 1000UL * 1000UL, "number of operations");
+DEFINE_double(update_percentage, 0.5, "Percentage of updates");
+DEFINE_double(delete_percentage, 0.2, "Percentage of deletes");
+
+namespace {
+// buckets hold a value of up to this size, i.e. about 16 values of 64 bytes
+constexpr size_t kMaxValueSize = 1024;
+constexpr size_t kMaxOpValueSize = 96;
+
+struct Op {
+  uint32_t key;
+  uint8_t type; // 0: lookup, 1: update, 2: delete
+  uint8_t size;
+};
+
+std::vector<Op> makeOps(uint64_t keysPerBucket) {
+  std::vector<Op> ops;
+  ops.reserve(FLAGS_num_ops);
+  const auto numKeys = FLAGS_num_buckets * keysPerBucket;
+  const auto updateThreshold = FLAGS_update_percentage;
+  const auto deleteThreshold = updateThreshold + FLAGS_delete_percentage;
+  for (size_t i = 0; i < FLAGS_num_ops; i++) {
+    const auto p = folly::Random::randDouble01();
+    Op op;
+    op.key = folly::Random::rand32(1, numKeys + 1);
+    op.type = p < updateThreshold ? 1 : (p < deleteThreshold ? 2 : 0);
+    // values between 32 and 96 bytes, 64 on average
+    op.size = folly::Random::rand32(32, kMaxOpValueSize + 1);
+    ops.push_back(op);
+  }
+  return ops;
+}
+
+template <template <typename> class BucketT>
+void runOps(uint64_t keysPerBucket) {
+  using Descriptor =
+      CompactCacheDescriptor<uint32_t,
+                             VariableSizedValueDescriptor<kMaxValueSize>>;
+  using BucketDesc = BucketT<Descriptor>;
+  using Value = typename BucketDesc::Value;
+
+  std::vector<typename BucketDesc::Bucket> buckets;
+  std::vector<Op> ops;
+  char value[kMaxOpValueSize]{};
+  BENCHMARK_SUSPEND {
+    // value initialized, i.e. empty
+    buckets.resize(FLAGS_num_buckets);
+    ops = makeOps(keysPerBucket);
+  }
+
+  auto evictionCb = [](const typename BucketDesc::EntryHandle&) {};
+  size_t found = 0;
+  for (const auto& op : ops) {
+    auto* bucket = &buckets[op.key % buckets.size()];
+    auto handle = BucketDesc::first(bucket);
+    while (handle && handle.key() != op.key) {
+      handle.next();
+    }
+    switch (op.type) {
+    case 1:
+      if (handle) {
+        BucketDesc::updateVal(handle, reinterpret_cast<const Value*>(value),
+                              op.size, evictionCb);
+      } else {
+        BucketDesc::insert(bucket, op.key,
+                           reinterpret_cast<const Value*>(value), op.size,
+                           evictionCb);
+      }
+      break;
+    case 2:
+      if (handle) {
+        BucketDesc::del(handle);
+      }
+      break;
+    default:
+      if (handle) {
+        found++;
+        if (BucketDesc::needs_promote(handle)) {
+          BucketDesc::promote(handle);
+        }
+      }
+    }
+  }
+  folly::doNotOptimizeAway(found);
+}
+} // namespace
+
+BENCHMARK(VariableLruBucketResident) {
+  runOps<VariableLruBucket>(FLAGS_resident_keys_per_bucket);
+}
+BENCHMARK_RELATIVE(VariableSlotLruBucketResident) {
+  runOps<VariableSlotLruBucket>(FLAGS_resident_keys_per_bucket);
+}
+BENCHMARK(VariableLruBucketChurn) {
+  runOps<VariableLruBucket>(FLAGS_churn_keys_per_bucket);
+}
+BENCHMARK_RELATIVE(VariableSlotLruBucketChurn) {
+  runOps<VariableSlotLruBucket>(FLAGS_churn_keys_per_bucket);
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+}
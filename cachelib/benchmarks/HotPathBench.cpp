@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Suite of the primitives on the hot paths of the cache, to evaluate changes
+// to them and to catch regressions. Every benchmark runs at each of the
+// --threads counts, splitting the iterations between the threads, so the
+// time per iteration of a benchmark across thread counts is its scaling
+// curve. Run with --bm_json_verbose=<file> to keep the results.
+//
+// The threads of a benchmark share one instance of the primitive:
+//  - ChainedHashTable find, locked and optimistic, and insert + remove
+//  - recordAccess of MMLru, MM2Q and MMTinyLFU, promoting on every access
+//  - allocate + free of a single allocation class
+//  - compress + unCompress of CompressedPtr
+//  - lookup of the navy sparse map and fixed size indexes
+//  - Bucket::find of a BigHash bucket
+//  - couldExist of the classic, blocked and split block bloom filters
+//  - getCurrentTimeSec, reading the system clock or the coarse clock
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cachelib/allocator/ChainedHashTable.h"
+#include "cachelib/allocator/KAllocation.h"
+#include "cachelib/allocator/MM2Q.h"
+#include "cachelib/allocator/MMLru.h"
+#include "cachelib/allocator/MMTinyLFU.h"
+#include "cachelib/allocator/Util.h"
+#include "cachelib/allocator/memory/MemoryAllocator.h"
+#include "cachelib/benchmarks/MMTypeBench.h"
+#include "cachelib/common/BloomFilter.h"
+#include "cachelib/common/Hash.h"
+#include "cachelib/common/Time.h"
+#include "cachelib/navy/bighash/Bucket.h"
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
+#include "cachelib/navy/common/Buffer.h"
+
+DEFINE_string(threads,
+              "1,2,4,8,16",
+              "comma separated thread counts to run every benchmark at");
+DEFINE_uint32(num_keys,
+              100000,
+              "number of keys in the hash table, indexes and bloom filters");
+DEFINE_uint32(num_nodes,
+              10000,
+              "number of nodes of every thread in the MM containers");
+
+namespace facebook {
+namespace cachelib {
+namespace benchmarks {
+namespace {
+
+// Runs @fn(threadId, begin, end) on @numThreads threads, each taking its
+// share of [0, @numOps).
+template <typename F>
+void runOnThreads(uint32_t numThreads, uint64_t numOps, const F& fn) {
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&fn, t, numThreads, numOps] {
+      fn(t, numOps * t / numThreads, numOps * (t + 1) / numThreads);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// index of the key of the @i-th op, spread over the keys
+inline size_t keyIdx(uint64_t i, size_t numKeys) {
+  return folly::hash::twang_mix64(i) % numKeys;
+}
+
+// node of the ChainedHashTable, like the items of the cache
+struct HashNode {
+  using Key = KAllocation::Key;
+  struct Releaser {
+    void operator()(HashNode* node) const noexcept { node->decRef(); }
+  };
+  using Handle = std::unique_ptr<HashNode, Releaser>;
+  using HandleMaker = std::function<Handle(HashNode*)>;
+  using CompressedPtrType = HashNode*;
+  struct PtrCompressor {
+    constexpr CompressedPtrType compress(HashNode* uncompressed) const {
+      return uncompressed;
+    }
+    constexpr HashNode* unCompress(CompressedPtrType compressed) const {
+      return compressed;
+    }
+  };
+
+  explicit HashNode(std::string key) : key_(std::move(key)) {}
+
+  Key getKey() const { return {key_.data(), key_.length()}; }
+  bool isAccessible() const noexcept { return accessible_; }
+  void markAccessible() noexcept { accessible_ = true; }
+  void unmarkAccessible() noexcept { accessible_ = false; }
+  void incRef() noexcept { refcount_.fetch_add(1, std::memory_order_relaxed); }
+  void decRef() noexcept { refcount_.fetch_sub(1, std::memory_order_relaxed); }
+  bool incRefIfAccessible() noexcept {
+    incRef();
+    if (accessible_) {
+      return true;
+    }
+    decRef();
+    return false;
+  }
+  std::string toString() const { return key_; }
+
+  ChainedHashTable::Hook<HashNode> accessHook_;
+
+ private:
+  std::string key_;
+  std::atomic<bool> accessible_{false};
+  std::atomic<uint32_t> refcount_{0};
+};
+using HashContainer = ChainedHashTable::Container<HashNode,
+                                                  &HashNode::accessHook_>;
+
+struct Fixtures {
+  std::vector<std::string> keys;
+  std::vector<uint64_t> hashes;
+
+  std::vector<std::unique_ptr<HashNode>> hashNodes;
+  std::unique_ptr<HashContainer> hashTable;
+  std::unique_ptr<HashContainer> optimisticHashTable;
+
+  std::unique_ptr<MemoryAllocator> allocator;
+  PoolId poolId{};
+  std::vector<void*> allocs;
+
+  std::unique_ptr<navy::Index> sparseMapIndex;
+  std::unique_ptr<navy::Index> fixedSizeIndex;
+
+  navy::Buffer bucketBuffer;
+  std::vector<std::string> bucketKeys;
+
+  BloomFilter bloomFilter;
+  BloomFilter blockedBloomFilter;
+  BloomFilter splitBlockBloomFilter;
+};
+std::unique_ptr<Fixtures> fixtures;
+
+void buildFixtures() {
+  fixtures = std::make_unique<Fixtures>();
+  auto& f = *fixtures;
+  for (uint32_t i = 0; i < FLAGS_num_keys; i++) {
+    f.keys.push_back(folly::sformat("hot_path_key_{}", i));
+    f.hashes.push_back(HashedKey{f.keys.back()}.keyHash());
+  }
+
+  ChainedHashTable::Config hashConfig;
+  hashConfig.sizeBucketsPowerAndLocksPower(FLAGS_num_keys);
+  f.hashTable = std::make_unique<HashContainer>(hashConfig,
+                                                HashNode::PtrCompressor{});
+  hashConfig.setOptimisticReads(true);
+  f.optimisticHashTable = std::make_unique<HashContainer>(
+      hashConfig, HashNode::PtrCompressor{});
+  for (const auto& key : f.keys) {
+    f.hashNodes.push_back(std::make_unique<HashNode>(key));
+    f.hashTable->insert(*f.hashNodes.back());
+    f.hashNodes.push_back(std::make_unique<HashNode>(key));
+    f.optimisticHashTable->insert(*f.hashNodes.back());
+  }
+
+  const auto allocSizes = util::generateAllocSizes(1.25);
+  MemoryAllocator::Config allocatorConfig(
+      allocSizes, false /* enableZeroedSlabAllocs */,
+      true /* disableCoredump */, false /* lockMemory */);
+  const size_t poolSize = 64 * Slab::kSize;
+  f.allocator = std::make_unique<MemoryAllocator>(allocatorConfig,
+                                                  poolSize + 2 * Slab::kSize);
+  f.poolId = f.allocator->addPool("hot_path", poolSize, allocSizes);
+  for (int i = 0; i < 1000; i++) {
+    auto* alloc = f.allocator->allocate(f.poolId, 100);
+    if (alloc) {
+      f.allocs.push_back(alloc);
+    }
+  }
+
+  f.sparseMapIndex = std::make_unique<navy::SparseMapIndex>();
+  f.fixedSizeIndex = std::make_unique<navy::FixedSizeIndex>(
+      navy::FixedSizeIndex::numBucketsFor(FLAGS_num_keys));
+  for (uint32_t i = 0; i < FLAGS_num_keys; i++) {
+    f.sparseMapIndex->insert(f.hashes[i], i, 100);
+    f.fixedSizeIndex->insert(f.hashes[i], i, 100);
+  }
+
+  // a 4KB BigHash bucket full of small items
+  f.bucketBuffer = navy::Buffer(4096);
+  auto& bucket = navy::Bucket::initNew(f.bucketBuffer.mutableView(), 0);
+  const std::string value(64, 'v');
+  for (int i = 0; i < 40; i++) {
+    f.bucketKeys.push_back(folly::sformat("bucket_key_{}", i));
+    bucket.insert(HashedKey{f.bucketKeys.back()}, navy::makeView(value),
+                  nullptr, nullptr);
+  }
+
+  f.bloomFilter = BloomFilter::makeBloomFilter(1024, FLAGS_num_keys / 1024 + 1,
+                                               0.01);
+  f.blockedBloomFilter = BloomFilter::makeBlockedBloomFilter(1024, 4, 1024);
+  f.splitBlockBloomFilter = BloomFilter::makeSplitBlockBloomFilter(
+      1024, f.bloomFilter.numBitsPerFilter());
+  for (uint32_t i = 0; i < FLAGS_num_keys; i++) {
+    f.bloomFilter.set(i % 1024, f.hashes[i]);
+    f.blockedBloomFilter.set(i % 1024, f.hashes[i]);
+    f.splitBlockBloomFilter.set(i % 1024, f.hashes[i]);
+  }
+}
+
+void benchHashTableFind(const HashContainer& table,
+                        uint32_t numThreads,
+                        uint64_t iters) {
+  const auto& keys = fixtures->keys;
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      auto handle = table.find(keys[keyIdx(i, keys.size())]);
+      folly::doNotOptimizeAway(handle);
+    }
+  });
+}
+
+void benchHashTableInsertRemove(uint32_t numThreads, uint64_t iters) {
+  // every thread inserts and removes keys of its own, next to the others
+  folly::BenchmarkSuspender suspender;
+  constexpr size_t kNodesPerThread = 1024;
+  std::vector<std::vector<std::unique_ptr<HashNode>>> nodes(numThreads);
+  for (uint32_t t = 0; t < numThreads; t++) {
+    for (size_t i = 0; i < kNodesPerThread; i++) {
+      nodes[t].push_back(std::make_unique<HashNode>(
+          folly::sformat("hot_path_new_key_{}_{}", t, i)));
+    }
+  }
+  auto& table = *fixtures->hashTable;
+  suspender.dismissing([&] {
+    runOnThreads(numThreads, iters,
+                 [&](uint32_t t, uint64_t begin, uint64_t end) {
+                   for (uint64_t i = begin; i < end; i++) {
+                     auto& node = *nodes[t][i % kNodesPerThread];
+                     table.insert(node);
+                     table.remove(node);
+                   }
+                 });
+  });
+}
+
+// MM containers with the nodes of every thread, by thread count
+template <typename MMType>
+std::vector<std::unique_ptr<MMTypeBench<MMType>>>& mmBenches() {
+  static std::vector<std::unique_ptr<MMTypeBench<MMType>>> benches(
+      kMMTypeBenchMaxThreads + 1);
+  return benches;
+}
+
+template <typename MMType>
+void benchRecordAccess(uint32_t numThreads, uint64_t iters) {
+  auto& bench = mmBenches<MMType>()[numThreads];
+  if (!bench) {
+    folly::BenchmarkSuspender suspender;
+    bench = std::make_unique<MMTypeBench<MMType>>();
+    // a refresh time of 0 promotes on every access, the contended path
+    bench->createContainer(typename MMType::Config{0, true, true});
+    bench->createNodes(FLAGS_num_nodes, numThreads, true);
+  }
+  runOnThreads(numThreads, iters,
+               [&](uint32_t t, uint64_t begin, uint64_t end) {
+                 const auto numAccess = static_cast<unsigned int>(end - begin);
+                 bench->benchRecordAccessRead(FLAGS_num_nodes, t, numAccess);
+               });
+}
+
+void benchAllocateFree(uint32_t numThreads, uint64_t iters) {
+  auto& allocator = *fixtures->allocator;
+  const auto poolId = fixtures->poolId;
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      void* alloc = allocator.allocate(poolId, 100);
+      folly::doNotOptimizeAway(alloc);
+      if (alloc) {
+        allocator.free(alloc);
+      }
+    }
+  });
+}
+
+template <typename PtrType>
+void benchCompressedPtr(uint32_t numThreads, uint64_t iters) {
+  const auto& allocator = *fixtures->allocator;
+  const auto& allocs = fixtures->allocs;
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      auto compressed = allocator.compress<PtrType>(
+          allocs[i % allocs.size()], false /* isMultiTiered */);
+      void* ptr =
+          allocator.unCompress<PtrType>(compressed, false /* isMultiTiered */);
+      folly::doNotOptimizeAway(ptr);
+    }
+  });
+}
+
+void benchIndexLookup(navy::Index& index,
+                      uint32_t numThreads,
+                      uint64_t iters) {
+  const auto& hashes = fixtures->hashes;
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      auto result = index.lookup(hashes[keyIdx(i, hashes.size())]);
+      folly::doNotOptimizeAway(result);
+    }
+  });
+}
+
+void benchBucketFind(uint32_t numThreads, uint64_t iters) {
+  const auto& bucket = *reinterpret_cast<const navy::Bucket*>(
+      fixtures->bucketBuffer.data());
+  std::vector<HashedKey> hks;
+  for (const auto& key : fixtures->bucketKeys) {
+    hks.emplace_back(key);
+  }
+  // every other lookup misses
+  hks.emplace_back("bucket_key_missing");
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      const auto& hk = i % 2 ? hks.back() : hks[keyIdx(i, hks.size() - 1)];
+      auto value = bucket.find(hk);
+      folly::doNotOptimizeAway(value);
+    }
+  });
+}
+
+void benchBloomFilter(const BloomFilter& filter,
+                      uint32_t numThreads,
+                      uint64_t iters) {
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      // mostly keys that were not set, as for most lookups on flash
+      const auto hash = folly::hash::twang_mix64(i);
+      folly::doNotOptimizeAway(filter.couldExist(hash % 1024, hash));
+    }
+  });
+}
+
+void benchCurrentTimeSec(bool coarse, uint32_t numThreads, uint64_t iters) {
+  std::unique_ptr<util::CoarseClock> clock;
+  if (coarse) {
+    folly::BenchmarkSuspender suspender;
+    clock = std::make_unique<util::CoarseClock>();
+  }
+  runOnThreads(numThreads, iters, [&](uint32_t, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      folly::doNotOptimizeAway(util::getCurrentTimeSec());
+    }
+  });
+  folly::BenchmarkSuspender suspender;
+  clock.reset();
+}
+
+void addBenchmarks(uint32_t numThreads) {
+  auto add = [numThreads](folly::StringPiece name, auto fn) {
+    folly::addBenchmark(
+        __FILE__, folly::sformat("{}/{}threads", name, numThreads),
+        [numThreads, fn](unsigned iters) {
+          fn(numThreads, iters);
+          return iters;
+        });
+  };
+
+  add("ChainedHashTable_find", [](uint32_t threads, uint64_t iters) {
+    benchHashTableFind(*fixtures->hashTable, threads, iters);
+  });
+  add("ChainedHashTable_findOptimistic", [](uint32_t threads, uint64_t iters) {
+    benchHashTableFind(*fixtures->optimisticHashTable, threads, iters);
+  });
+  add("ChainedHashTable_insertRemove", benchHashTableInsertRemove);
+  add("MMLru_recordAccess", benchRecordAccess<MMLru>);
+  add("MM2Q_recordAccess", benchRecordAccess<MM2Q>);
+  add("MMTinyLFU_recordAccess", benchRecordAccess<MMTinyLFU>);
+  add("AllocationClass_allocateFree", benchAllocateFree);
+  add("CompressedPtr4B", benchCompressedPtr<CompressedPtr4B>);
+  add("CompressedPtr5B", benchCompressedPtr<CompressedPtr5B>);
+  add("SparseMapIndex_lookup", [](uint32_t threads, uint64_t iters) {
+    benchIndexLookup(*fixtures->sparseMapIndex, threads, iters);
+  });
+  add("FixedSizeIndex_lookup", [](uint32_t threads, uint64_t iters) {
+    benchIndexLookup(*fixtures->fixedSizeIndex, threads, iters);
+  });
+  add("Bucket_find", benchBucketFind);
+  add("BloomFilter_couldExist", [](uint32_t threads, uint64_t iters) {
+    benchBloomFilter(fixtures->bloomFilter, threads, iters);
+  });
+  add("BlockedBloomFilter_couldExist", [](uint32_t threads, uint64_t iters) {
+    benchBloomFilter(fixtures->blockedBloomFilter, threads, iters);
+  });
+  add("SplitBlockBloomFilter_couldExist",
+      [](uint32_t threads, uint64_t iters) {
+        benchBloomFilter(fixtures->splitBlockBloomFilter, threads, iters);
+      });
+  add("getCurrentTimeSec", [](uint32_t threads, uint64_t iters) {
+    benchCurrentTimeSec(false, threads, iters);
+  });
+  add("getCurrentTimeSec_coarse", [](uint32_t threads, uint64_t iters) {
+    benchCurrentTimeSec(true, threads, iters);
+  });
+  folly::addBenchmark(__FILE__, "-", [] { return 0; });
+}
+} // namespace
+} // namespace benchmarks
+} // namespace cachelib
+} // namespace facebook
+
+int main(int argc, char** argv) {
+  using namespace facebook::cachelib::benchmarks;
+  folly::init(&argc, &argv);
+
+  std::vector<uint32_t> threads;
+  folly::split(',', FLAGS_threads, threads, true /* ignoreEmpty */);
+  for (auto numThreads : threads) {
+    if (numThreads == 0 || numThreads > kMMTypeBenchMaxThreads) {
+      std::cout << "thread counts must be in [1, " << kMMTypeBenchMaxThreads
+                << "]" << std::endl;
+      return 1;
+    }
+  }
+
+  buildFixtures();
+  for (auto numThreads : threads) {
+    addBenchmarks(numThreads);
+  }
+  folly::runBenchmarks();
+  return 0;
+}
@@ -43,6 +43,11 @@ struct MMTypeBench {
 
     int getId() const noexcept { return id_; }
 
+    // the id as key, for the MMTypes keeping access frequencies
+    folly::StringPiece getKey() const noexcept {
+      return {reinterpret_cast<const char*>(&id_), sizeof(id_)};
+    }
+
     template <Flags flagBit>
     void setFlag() {
       flags_ |= static_cast<uint8_t>(1) << static_cast<uint8_t>(flagBit);
@@ -34,6 +34,11 @@ const unsigned int numPools = 4;
 std::unique_ptr<MemoryAllocator> m;
 std::vector<AllocPair> validAllocs;
 std::vector<AllocPair> validAllocsAlt;
+// the same allocations compressed with 5 byte pointers and with the tier bit
+// reserved, to compare the widths on identical slab and alloc indexes.
+std::vector<CompressedPtr5B> validAllocs5B;
+std::vector<CompressedPtr4B> validAllocsMultiTier;
+std::vector<CompressedPtr5B> validAllocs5BMultiTier;
 
 std::set<uint32_t> getAllocSizes() {
   // defaults from tao for allocation sizes.
@@ -65,6 +70,12 @@ void buildAllocs(size_t poolSize) {
                                    ma->compress<CompressedPtrType>(
                                        alloc, false /* isMultiTiered */));
           validAllocsAlt.emplace_back(alloc, ma->compressAlt(alloc));
+          validAllocs5B.push_back(ma->compress<CompressedPtr5B>(
+              alloc, false /* isMultiTiered */));
+          validAllocsMultiTier.push_back(ma->compress<CompressedPtr4B>(
+              alloc, true /* isMultiTiered */));
+          validAllocs5BMultiTier.push_back(ma->compress<CompressedPtr5B>(
+              alloc, true /* isMultiTiered */));
           numAllocations++;
         }
       }
@@ -74,6 +85,22 @@ void buildAllocs(size_t poolSize) {
     makeAllocs(pool.first, m.get(), pool.second);
   }
 }
+
+template <typename PtrType>
+void compressAll(bool isMultiTiered) {
+  for (const auto& alloc : validAllocs) {
+    PtrType c = m->compress<PtrType>(alloc.first, isMultiTiered);
+    folly::doNotOptimizeAway(c);
+  }
+}
+
+template <typename PtrType>
+void unCompressAll(const std::vector<PtrType>& ptrs, bool isMultiTiered) {
+  for (const auto& c : ptrs) {
+    void* ptr = m->unCompress<PtrType>(c, isMultiTiered);
+    folly::doNotOptimizeAway(ptr);
+  }
+}
 } // namespace
 
 BENCHMARK(CompressionAlt) {
@@ -84,11 +111,19 @@ BENCHMARK(CompressionAlt) {
 }
 
 BENCHMARK_RELATIVE(Compression) {
-  for (const auto& alloc : validAllocs) {
-    CompressedPtrType c =
-        m->compress<CompressedPtrType>(alloc.first, false /* isMultiTiered */);
-    folly::doNotOptimizeAway(c);
-  }
+  compressAll<CompressedPtr4B>(false /* isMultiTiered */);
+}
+
+BENCHMARK_RELATIVE(Compression5B) {
+  compressAll<CompressedPtr5B>(false /* isMultiTiered */);
+}
+
+BENCHMARK_RELATIVE(CompressionMultiTier) {
+  compressAll<CompressedPtr4B>(true /* isMultiTiered */);
+}
+
+BENCHMARK_RELATIVE(Compression5BMultiTier) {
+  compressAll<CompressedPtr5B>(true /* isMultiTiered */);
 }
 
 BENCHMARK(DeCompressAlt) {
@@ -106,6 +141,18 @@ BENCHMARK_RELATIVE(DeCompress) {
   }
 }
 
+BENCHMARK_RELATIVE(DeCompress5B) {
+  unCompressAll(validAllocs5B, false /* isMultiTiered */);
+}
+
+BENCHMARK_RELATIVE(DeCompressMultiTier) {
+  unCompressAll(validAllocsMultiTier, true /* isMultiTiered */);
+}
+
+BENCHMARK_RELATIVE(DeCompress5BMultiTier) {
+  unCompressAll(validAllocs5BMultiTier, true /* isMultiTiered */);
+}
+
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
 
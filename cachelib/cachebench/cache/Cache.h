@@ -100,7 +100,7 @@ class Cache {
   using ChainedAllocs = typename Allocator::ChainedAllocs;
 
   template <typename U>
-  using TypedHandle = LruAllocator::TypedHandle<U>;
+  using TypedHandle = typename Allocator::template TypedHandle<U>;
 
   // instantiate a cachelib cache instance.
   //
@@ -301,8 +301,19 @@ class Cache {
   // enables consistency checking for the cache. This should be done before
   // any find/insert/remove is called.
   //
-  // @param keys  list of keys that the stressor uses for the workload.
-  void enableConsistencyCheck(const std::vector<std::string>& keys);
+  // @param keys        list of keys that the stressor uses for the workload.
+  // @param sampleRate  0 to check every key as the operations end. Otherwise
+  //                    only the keys whose hash is a multiple of it are
+  //                    tracked, and checked by checkSampledConsistency().
+  void enableConsistencyCheck(const std::vector<std::string>& keys,
+                              uint32_t sampleRate = 0);
+
+  // checks the operations logged by the sampled consistency checking and
+  // adds the inconsistencies found to the inconsistency count. Call it once
+  // the stress workers are done.
+  //
+  // @return the number of inconsistencies found
+  uint64_t checkSampledConsistency();
 
   // returns true if the consistency checking is enabled.
   bool consistencyCheckEnabled() const { return valueTracker_ != nullptr; }
@@ -364,6 +375,11 @@ class Cache {
   // until the cache is re-attached using reAttach() below.
   void shutDown();
 
+  // @return the time spent in each phase of the last shutDown()
+  const typename Allocator::ShutDownTimings& getShutDownTimings() const {
+    return cache_->getShutDownTimings();
+  }
+
   // reinitialize the cache. This assumes the cache was shutdown using
   // shutDown() api.
   //
@@ -395,6 +411,9 @@ class Cache {
   // get the nand writes for the SSD device if enabled.
   uint64_t fetchNandWrites() const;
 
+  // get the writes of all hosts to the SSD device if enabled.
+  uint64_t fetchHostWrites() const;
+
   // original input config for the cache used to derive the
   // CacheAllocatorConfig.
   const CacheConfig config_;
@@ -441,6 +460,9 @@ class Cache {
   // reading of the nand bytes written for the benchmark if enabled.
   const uint64_t nandBytesBegin_{0};
 
+  // reading of the host bytes written for the benchmark if enabled.
+  const uint64_t hostBytesBegin_{0};
+
   // latency stats of cachelib APIs inside cachebench
   mutable util::PercentileStats cacheFindLatency_;
 
@@ -463,30 +485,47 @@ MMConfigType makeMMConfig(CacheConfig const&);
 // LRU
 template <>
 inline typename LruAllocator::MMConfig makeMMConfig(CacheConfig const& config) {
-  return LruAllocator::MMConfig(config.lruRefreshSec,
-                                config.lruRefreshRatio,
-                                config.lruUpdateOnWrite,
-                                config.lruUpdateOnRead,
-                                config.tryLockUpdate,
-                                static_cast<uint8_t>(config.lruIpSpec),
-                                0,
-                                config.useCombinedLockForIterators);
-}
-
-// LRU
-template <>
-inline typename Lru2QAllocator::MMConfig makeMMConfig(
-    CacheConfig const& config) {
-  return Lru2QAllocator::MMConfig(config.lruRefreshSec,
+  LruAllocator::MMConfig mmConfig(config.lruRefreshSec,
                                   config.lruRefreshRatio,
                                   config.lruUpdateOnWrite,
                                   config.lruUpdateOnRead,
                                   config.tryLockUpdate,
-                                  false,
-                                  config.lru2qHotPct,
-                                  config.lru2qColdPct,
+                                  static_cast<uint8_t>(config.lruIpSpec),
                                   0,
                                   config.useCombinedLockForIterators);
+  mmConfig.promotionBufferSize =
+      static_cast<uint32_t>(config.lruPromotionBufferSize);
+  mmConfig.evictionSampleSize =
+      static_cast<uint32_t>(config.lruEvictionSampleSize);
+  return mmConfig;
+}
+
+// LRU
+template <>
+inline typename Lru2QAllocator::MMConfig makeMMConfig(
+    CacheConfig const& config) {
+  Lru2QAllocator::MMConfig mmConfig(config.lruRefreshSec,
+                                     config.lruRefreshRatio,
+                                     config.lruUpdateOnWrite,
+                                     config.lruUpdateOnRead,
+                                     config.tryLockUpdate,
+                                     false,
+                                     config.lru2qHotPct,
+                                     config.lru2qColdPct,
+                                     0,
+                                     config.useCombinedLockForIterators);
+  mmConfig.promotionBufferSize =
+      static_cast<uint32_t>(config.lruPromotionBufferSize);
+  mmConfig.hotClockHits = config.lru2qHotClockHits;
+  return mmConfig;
+}
+
+// SIEVE
+template <>
+inline typename SieveAllocator::MMConfig makeMMConfig(
+    CacheConfig const& config) {
+  return SieveAllocator::MMConfig(config.lruUpdateOnWrite,
+                                  config.lruUpdateOnRead);
 }
 
 template <typename Allocator>
@@ -503,6 +542,20 @@ uint64_t Cache<Allocator>::fetchNandWrites() const {
   return total;
 }
 
+template <typename Allocator>
+uint64_t Cache<Allocator>::fetchHostWrites() const {
+  size_t total = 0;
+  for (const auto& d : config_.writeAmpDeviceList) {
+    try {
+      total += facebook::hw::hostWriteBytes(d);
+    } catch (const std::exception& e) {
+      XLOGF(ERR, "Exception fetching host writes for {}. Msg: {}", d, e.what());
+      return 0;
+    }
+  }
+  return total;
+}
+
 template <typename Allocator>
 Cache<Allocator>::Cache(const CacheConfig& config,
                         ChainedItemMovingSync movingSync,
@@ -511,6 +564,7 @@ Cache<Allocator>::Cache(const CacheConfig& config,
     : config_(config),
       touchValue_(touchValue),
       nandBytesBegin_{fetchNandWrites()},
+      hostBytesBegin_{fetchHostWrites()},
       itemRecords_(config_.enableItemDestructorCheck) {
   constexpr size_t MB = 1024ULL * 1024ULL;
 
@@ -542,15 +596,37 @@ Cache<Allocator>::Cache(const CacheConfig& config,
   }
 
   // Set hash table config
-  allocatorConfig_.setAccessConfig(typename Allocator::AccessConfig{
+  typename Allocator::AccessConfig accessConfig{
       static_cast<uint32_t>(config_.htBucketPower),
-      static_cast<uint32_t>(config_.htLockPower)});
-
-  allocatorConfig_.configureChainedItems(typename Allocator::AccessConfig{
+      static_cast<uint32_t>(config_.htLockPower)};
+  accessConfig.setNumInterleavedLookups(
+      static_cast<uint32_t>(config_.htNumInterleavedLookups));
+  accessConfig.setOptimisticReads(config_.htOptimisticReads);
+  accessConfig.setLazyBucketInit(config_.htLazyBucketInit);
+  allocatorConfig_.setAccessConfig(std::move(accessConfig));
+
+  typename Allocator::AccessConfig chainedItemAccessConfig{
       static_cast<uint32_t>(config_.chainedItemHtBucketPower),
-      static_cast<uint32_t>(config_.chainedItemHtLockPower)});
+      static_cast<uint32_t>(config_.chainedItemHtLockPower)};
+  chainedItemAccessConfig.setLazyBucketInit(config_.htLazyBucketInit);
+  allocatorConfig_.configureChainedItems(std::move(chainedItemAccessConfig));
 
   allocatorConfig_.setCacheSize(config_.cacheSizeMB * (MB));
+  allocatorConfig_.setNumMMContainerShards(
+      static_cast<uint32_t>(config_.mmContainerShards));
+  allocatorConfig_.setEvictionBatchSize(
+      static_cast<uint32_t>(config_.evictionBatchSize));
+  allocatorConfig_.setAllocMagazineSize(
+      static_cast<uint32_t>(config_.allocMagazineSize));
+  if (config_.hotKeyReplication) {
+    allocatorConfig_.enableHotKeyReplication();
+  }
+  if (config_.stripedRefcounts) {
+    allocatorConfig_.enableStripedRefcounts();
+  }
+  if (config_.coarseClock) {
+    allocatorConfig_.enableCoarseClock();
+  }
 
   if (!cacheDir.empty()) {
     allocatorConfig_.cacheDir = cacheDir;
@@ -562,8 +638,27 @@ Cache<Allocator>::Cache(const CacheConfig& config,
 
   allocatorConfig_.setMemoryLocking(config_.lockMemory);
 
+  if (config_.parallelShutdown) {
+    allocatorConfig_.enableParallelShutdown();
+  }
+
+  if (config_.memoryPageSizeMB == 2) {
+    allocatorConfig_.setMemoryPageSize(PageSizeT::TWO_MB,
+                                       config_.memoryPageSizeFallback);
+  } else if (config_.memoryPageSizeMB == 1024) {
+    allocatorConfig_.setMemoryPageSize(PageSizeT::ONE_GB,
+                                       config_.memoryPageSizeFallback);
+  } else if (config_.memoryPageSizeMB != 0) {
+    throw std::invalid_argument(folly::sformat(
+        "memoryPageSizeMB must be 0, 2 or 1024, but got {}",
+        config_.memoryPageSizeMB));
+  }
+
   if (!config_.memoryTierConfigs.empty()) {
     allocatorConfig_.configureMemoryTiers(config_.memoryTierConfigs);
+    allocatorConfig_.setMemoryTierPromotion(
+        config_.memoryTierPromotionMinHits,
+        std::chrono::milliseconds(config_.memoryTierPromotionIntervalMs));
   }
 
   auto cleanupGuard = folly::makeGuard([&] {
@@ -636,9 +731,31 @@ Cache<Allocator>::Cache(const CacheConfig& config,
       XLOGF(INFO, "Configuring NVM cache: memory file size {} MB",
             config_.nvmCacheSizeMB);
       nvmConfig.navyConfig.setMemoryFile(config_.nvmCacheSizeMB * MB);
+
+      navy::MemoryDeviceEmulationConfig emulation;
+      auto toPercentiles =
+          [](const std::unordered_map<std::string, uint32_t>& latencies) {
+            std::vector<std::pair<double, uint32_t>> percentiles;
+            for (const auto& [pct, latency] : latencies) {
+              percentiles.emplace_back(folly::to<double>(pct), latency);
+            }
+            std::sort(percentiles.begin(), percentiles.end());
+            return percentiles;
+          };
+      emulation.readLatencyUs =
+          toPercentiles(config_.navyMemoryDeviceReadLatencyUs);
+      emulation.writeLatencyUs =
+          toPercentiles(config_.navyMemoryDeviceWriteLatencyUs);
+      emulation.readBandwidthMBps = config_.navyMemoryDeviceReadMBps;
+      emulation.writeBandwidthMBps = config_.navyMemoryDeviceWriteMBps;
+      emulation.queueDepth =
+          static_cast<uint32_t>(config_.navyMemoryDeviceQueueDepth);
+      nvmConfig.navyConfig.setMemoryDeviceEmulation(std::move(emulation));
     }
     nvmConfig.navyConfig.setDeviceMetadataSize(config_.nvmCacheMetadataSizeMB *
                                                MB);
+    nvmConfig.navyConfig.setSizeAdvisorSampleRate(
+        static_cast<uint32_t>(config_.navySizeAdvisorSampleRate));
 
     if (config_.navyReqOrderShardsPower != 0) {
       nvmConfig.navyConfig.setNavyReqOrderingShards(
@@ -831,15 +948,34 @@ void Cache<Allocator>::cleanupSharedMem() {
 
 template <typename Allocator>
 void Cache<Allocator>::enableConsistencyCheck(
-    const std::vector<std::string>& keys) {
+    const std::vector<std::string>& keys, uint32_t sampleRate) {
   XDCHECK(valueTracker_ == nullptr);
-  valueTracker_ =
-      std::make_unique<ValueTracker>(ValueTracker::wrapStrings(keys));
+  valueTracker_ = std::make_unique<ValueTracker>(
+      ValueTracker::wrapStrings(keys), sampleRate);
   for (const std::string& key : keys) {
     invalidKeys_.emplace(key, false);
   }
 }
 
+template <typename Allocator>
+uint64_t Cache<Allocator>::checkSampledConsistency() {
+  if (!consistencyCheckEnabled()) {
+    return 0;
+  }
+  auto count = valueTracker_->checkSampledEvents(
+      [this](folly::StringPiece key, const LogEventStream& es) {
+        std::cout << folly::sformat("Inconsistent get of key {}\n{}", key,
+                                    es.format());
+        auto it = invalidKeys_.find(key);
+        if (it != invalidKeys_.end()) {
+          it->second.store(true, std::memory_order_relaxed);
+        }
+      });
+  inconsistencyCount_.fetch_add(static_cast<unsigned int>(count),
+                                std::memory_order_relaxed);
+  return count;
+}
+
 template <typename Allocator>
 typename Cache<Allocator>::RemoveRes Cache<Allocator>::remove(Key key) {
   if (!consistencyCheckEnabled()) {
@@ -1156,6 +1292,11 @@ Stats Cache<Allocator>::getStats() const {
       cacheStats.promotionStats.numMovedItems;
   ret.backgndPromoStats.nTraversals = cacheStats.promotionStats.runCount;
 
+  ret.memoryTierStats = cacheStats.memoryTierStats;
+  ret.numMemoryTierDemotionFailures = cacheStats.numMemoryTierDemotionFailures;
+  ret.numMemoryTierPromotionFailures =
+      cacheStats.numMemoryTierPromotionFailures;
+
   ret.numCacheGets = cacheStats.numCacheGets;
   ret.numCacheGetMiss = cacheStats.numCacheGetMiss;
   ret.numCacheEvictions = cacheStats.numCacheEvictions;
@@ -1221,10 +1362,19 @@ Stats Cache<Allocator>::getStats() const {
     if (now > nandBytesBegin_) {
       ret.numNvmNandBytesWritten = now - nandBytesBegin_;
     }
+    now = fetchHostWrites();
+    if (now > hostBytesBegin_) {
+      ret.numNvmHostBytesWritten = now - hostBytesBegin_;
+    }
     double bhLogicalBytes = lookup("navy_bh_logical_written");
     double bcLogicalBytes = lookup("navy_bc_logical_written");
     ret.numNvmLogicalBytesWritten =
         static_cast<size_t>(bhLogicalBytes + bcLogicalBytes);
+    ret.numNvmBcLogicalBytesWritten = lookup("navy_bc_logical_written");
+    ret.numNvmBcReinsertionBytesWritten = lookup("navy_bc_reinsertion_bytes");
+    ret.numNvmBcPhysicalBytesWritten = lookup("navy_bc_physical_written");
+    ret.numNvmBhLogicalBytesWritten = lookup("navy_bh_logical_written");
+    ret.numNvmBhPhysicalBytesWritten = lookup("navy_bh_physical_written");
     ret.nvmReadLatencyMicrosP50 = lookup("navy_device_read_latency_us_p50");
     ret.nvmReadLatencyMicrosP90 = lookup("navy_device_read_latency_us_p90");
     ret.nvmReadLatencyMicrosP99 = lookup("navy_device_read_latency_us_p99");
@@ -84,6 +84,17 @@ struct Stats {
   uint64_t numNvmBytesWritten{0};
   uint64_t numNvmNandBytesWritten{0};
   uint64_t numNvmLogicalBytesWritten{0};
+  // bytes written to the devices of writeAmpDeviceList by all hosts
+  uint64_t numNvmHostBytesWritten{0};
+
+  // what navy writes: the entries block cache writes, reinsertions included,
+  // the reinserted entries and the regions it flushes; the entries BigHash
+  // writes and the buckets it (re)writes for them.
+  uint64_t numNvmBcLogicalBytesWritten{0};
+  uint64_t numNvmBcReinsertionBytesWritten{0};
+  uint64_t numNvmBcPhysicalBytesWritten{0};
+  uint64_t numNvmBhLogicalBytesWritten{0};
+  uint64_t numNvmBhPhysicalBytesWritten{0};
 
   uint64_t numNvmItemRemovedSetSize{0};
 
@@ -137,6 +148,11 @@ struct Stats {
   std::map<PoolId, std::map<ClassId, uint64_t>> backgroundEvictionClasses;
   std::map<PoolId, std::map<ClassId, uint64_t>> backgroundPromotionClasses;
 
+  // stats of every memory tier, empty with a single tier
+  std::vector<MemoryTierStats> memoryTierStats;
+  uint64_t numMemoryTierDemotionFailures{0};
+  uint64_t numMemoryTierPromotionFailures{0};
+
   // errors from the nvm engine.
   std::unordered_map<std::string, double> nvmErrors;
 
@@ -289,6 +305,25 @@ struct Stats {
           << std::endl;
     }
 
+    if (!memoryTierStats.empty()) {
+      out << "== Memory Tier Stats ==" << std::endl;
+      for (size_t tier = 0; tier < memoryTierStats.size(); ++tier) {
+        const auto& tierStats = memoryTierStats[tier];
+        out << folly::sformat(
+                   "Tier {} : size {:,} MB, hits {:,}, demoted {:,}, "
+                   "promoted {:,}",
+                   tier, tierStats.poolSize / (1024 * 1024), tierStats.numHits,
+                   tierStats.numDemotions, tierStats.numPromotions)
+            << std::endl;
+      }
+      out << folly::sformat("Tier Demotion Failures : {:,}",
+                            numMemoryTierDemotionFailures)
+          << std::endl;
+      out << folly::sformat("Tier Promotion Failures : {:,}",
+                            numMemoryTierPromotionFailures)
+          << std::endl;
+    }
+
     if (numNvmGets > 0 || numNvmDeletes > 0 || numNvmPuts > 0) {
       const double ramHitRatio = invertPctFn(numCacheGetMiss, numCacheGets);
       const double nvmHitRatio = invertPctFn(numNvmGetMiss, numNvmGets);
@@ -344,6 +379,7 @@ struct Stats {
                             appWriteAmp);
       out << folly::sformat("NVM dev write amplification   : {:6.2f}\n",
                             devWriteAmp);
+      renderNvmWrites(Stats{}, out);
     }
     const double putSuccessPct =
         invertPctFn(numNvmPutErrs + numNvmAbortedPutOnInflightGet +
@@ -475,9 +511,103 @@ struct Stats {
           "NVM Hit Ratio : {:6.2f}%\n",
           ramHitRatio, nvmHitRatio);
     }
+    if (numNvmBytesWritten > prevStats.numNvmBytesWritten) {
+      constexpr double GB = 1024.0 * 1024 * 1024;
+      const auto w = getNvmWrites(prevStats);
+      out << folly::sformat("NVM bytes written (physical)  : {:6.2f} GB\n",
+                            w.device / GB);
+      out << folly::sformat("NVM bytes written (nand)      : {:6.2f} GB\n",
+                            w.nand / GB);
+      out << folly::sformat("NVM app write amplification   : {:6.2f}\n",
+                            w.appWriteAmp());
+      renderNvmWrites(prevStats, out);
+    }
   }
 
-  void render(folly::UserCounters& counters) {
+  // NVM writes between a previous snapshot of the stats and this one.
+  struct NvmWrites {
+    // bytes written to the devices by all hosts, and to their NAND
+    uint64_t host{0};
+    uint64_t nand{0};
+    // bytes navy wrote to the devices, and the entries it wrote
+    uint64_t device{0};
+    uint64_t logical{0};
+    // entries block cache wrote for new inserts and for reinsertions
+    uint64_t bcInserts{0};
+    uint64_t bcReinsertions{0};
+    // entries BigHash wrote, and the rest of the buckets it rewrote for them
+    uint64_t bhInserts{0};
+    uint64_t bhRmw{0};
+
+    double appWriteAmp() const { return pctFn(device, logical) / 100.0; }
+    // NAND writes per host write, 0 without host writes
+    double deviceWriteAmp() const { return pctFn(nand, host) / 100.0; }
+  };
+
+  NvmWrites getNvmWrites(const Stats& prevStats) const {
+    auto delta = [](uint64_t curr, uint64_t prev) {
+      return curr > prev ? curr - prev : 0;
+    };
+    NvmWrites w;
+    w.host = delta(numNvmHostBytesWritten, prevStats.numNvmHostBytesWritten);
+    w.nand = delta(numNvmNandBytesWritten, prevStats.numNvmNandBytesWritten);
+    w.device = delta(numNvmBytesWritten, prevStats.numNvmBytesWritten);
+    w.logical =
+        delta(numNvmLogicalBytesWritten, prevStats.numNvmLogicalBytesWritten);
+    w.bcReinsertions = delta(numNvmBcReinsertionBytesWritten,
+                             prevStats.numNvmBcReinsertionBytesWritten);
+    w.bcInserts = delta(numNvmBcLogicalBytesWritten,
+                        prevStats.numNvmBcLogicalBytesWritten);
+    w.bcInserts = delta(w.bcInserts, w.bcReinsertions);
+    w.bhInserts = delta(numNvmBhLogicalBytesWritten,
+                        prevStats.numNvmBhLogicalBytesWritten);
+    w.bhRmw = delta(delta(numNvmBhPhysicalBytesWritten,
+                          prevStats.numNvmBhPhysicalBytesWritten),
+                    w.bhInserts);
+    return w;
+  }
+
+  // Render the host writes to the devices and the write amplification of
+  // the devices since @prevStats, and what navy writes for.
+  void renderNvmWrites(const Stats& prevStats, std::ostream& out) const {
+    constexpr double GB = 1024.0 * 1024 * 1024;
+    const auto w = getNvmWrites(prevStats);
+    if (w.host > 0) {
+      out << folly::sformat("NVM bytes written (host)      : {:6.2f} GB\n",
+                            w.host / GB);
+      out << folly::sformat("NVM device write amplification: {:6.2f}\n",
+                            w.deviceWriteAmp());
+    }
+    out << folly::sformat(
+        "NVM writes    : BlockCache inserts {:.2f} GB, reinsertions {:.2f} "
+        "GB, BigHash inserts {:.2f} GB, bucket rewrites {:.2f} GB\n",
+        w.bcInserts / GB, w.bcReinsertions / GB, w.bhInserts / GB,
+        w.bhRmw / GB);
+  }
+
+  static void renderNvmWritesTableHeader(std::ostream& out) {
+    out << "time host_mb nand_mb navy_mb logical_mb dev_wa app_wa "
+           "bc_insert_mb bc_reinsert_mb bh_insert_mb bh_rmw_mb"
+        << std::endl;
+  }
+
+  // Render the NVM writes since @prevStats as a row of the table of
+  // renderNvmWritesTableHeader(), for the interval ending at @time
+  void renderNvmWritesTable(folly::StringPiece time,
+                            const Stats& prevStats,
+                            std::ostream& out) const {
+    constexpr double MB = 1024.0 * 1024;
+    const auto w = getNvmWrites(prevStats);
+    out << folly::sformat(
+               "{} {:.2f} {:.2f} {:.2f} {:.2f} {:.3f} {:.3f} {:.2f} {:.2f} "
+               "{:.2f} {:.2f}",
+               time, w.host / MB, w.nand / MB, w.device / MB, w.logical / MB,
+               w.deviceWriteAmp(), w.appWriteAmp(), w.bcInserts / MB,
+               w.bcReinsertions / MB, w.bhInserts / MB, w.bhRmw / MB)
+        << std::endl;
+  }
+
+  void render(folly::UserCounters& counters) const {
     auto calcInvertPctFn = [](uint64_t ops, uint64_t total) {
       return static_cast<int64_t>(invertPctFn(ops, total) * 100);
     };
@@ -513,6 +643,19 @@ struct Stats {
         static_cast<int64_t>(numNvmNandBytesWritten / MB);
     counters["nvm_app_write_amp"] = static_cast<int64_t>(appWriteAmp);
     counters["nvm_dev_write_amp"] = static_cast<int64_t>(devWriteAmp);
+
+    const auto w = getNvmWrites(Stats{});
+    counters["nvm_bytes_written_host_mb"] = static_cast<int64_t>(w.host / MB);
+    counters["nvm_device_write_amp_x100"] =
+        static_cast<int64_t>(w.deviceWriteAmp() * 100);
+    counters["nvm_bytes_written_bc_insert_mb"] =
+        static_cast<int64_t>(w.bcInserts / MB);
+    counters["nvm_bytes_written_bc_reinsertion_mb"] =
+        static_cast<int64_t>(w.bcReinsertions / MB);
+    counters["nvm_bytes_written_bh_insert_mb"] =
+        static_cast<int64_t>(w.bhInserts / MB);
+    counters["nvm_bytes_written_bh_rmw_mb"] =
+        static_cast<int64_t>(w.bhRmw / MB);
   }
 
   bool renderIsTestPassed(std::ostream& out) {
@@ -18,6 +18,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace facebook {
@@ -33,11 +34,22 @@ std::vector<folly::StringPiece> ValueTracker::wrapStrings(
   return rv;
 }
 
-ValueTracker::ValueTracker(std::vector<folly::StringPiece> keys)
-    : trackers_(keys.size()) {
-  if (keys.size() > std::numeric_limits<uint32_t>::max()) {
+ValueTracker::ValueTracker(std::vector<folly::StringPiece> keys,
+                           uint32_t sampleRate)
+    : sampleRate_{sampleRate} {
+  if (keys.size() >= kUntracked) {
     throw std::invalid_argument("too many keys");
   }
+  if (isSampled()) {
+    folly::hasher<folly::StringPiece> hasher;
+    for (auto key : keys) {
+      if (hasher(key) % sampleRate_ == 0) {
+        sampledKeys_.push_back(key);
+      }
+    }
+    keys = sampledKeys_;
+  }
+  trackers_ = std::vector<ValueHistory>(keys.size());
   for (uint32_t i = 0; i < keys.size(); i++) {
     keyTrackerMap_.emplace(keys[i], i);
   }
@@ -45,17 +57,26 @@ ValueTracker::ValueTracker(std::vector<folly::StringPiece> keys)
 
 ValueTracker::Index ValueTracker::beginGet(folly::StringPiece key) {
   auto ti = getTrackerIndexOrThrow(key);
+  if (isSampled()) {
+    return beginSampled(SampledOp::kBeginGet, ti);
+  }
   return Index{ti, trackers_[ti].beginGet(eventInfo())};
 }
 
 ValueTracker::Index ValueTracker::beginSet(folly::StringPiece key,
                                            uint64_t value) {
   auto ti = getTrackerIndexOrThrow(key);
+  if (isSampled()) {
+    return beginSampled(SampledOp::kBeginSet, ti, value);
+  }
   return Index{ti, trackers_[ti].beginSet(eventInfo(), value)};
 }
 
 ValueTracker::Index ValueTracker::beginDelete(folly::StringPiece key) {
   auto ti = getTrackerIndexOrThrow(key);
+  if (isSampled()) {
+    return beginSampled(SampledOp::kBeginDelete, ti);
+  }
   return Index{ti, trackers_[ti].beginDelete(eventInfo())};
 }
 
@@ -63,19 +84,141 @@ bool ValueTracker::endGet(Index beginIdx,
                           uint64_t data,
                           bool found,
                           EventStream* es) {
+  if (isSampled()) {
+    if (beginIdx.trackerIndex != kUntracked) {
+      logSampled(SampledOp::kEndGet, beginIdx.trackerIndex, beginIdx.seq, data,
+                 found);
+    }
+    return true;
+  }
   return trackers_[beginIdx.trackerIndex].endGet(
       eventInfo(), beginIdx.historyIndex, data, found, es);
 }
 
 void ValueTracker::endSet(Index beginIdx) {
+  if (isSampled()) {
+    if (beginIdx.trackerIndex != kUntracked) {
+      logSampled(SampledOp::kEndSet, beginIdx.trackerIndex, beginIdx.seq);
+    }
+    return;
+  }
   trackers_[beginIdx.trackerIndex].endSet(eventInfo(), beginIdx.historyIndex);
 }
 
 void ValueTracker::endDelete(Index beginIdx) {
+  if (isSampled()) {
+    if (beginIdx.trackerIndex != kUntracked) {
+      logSampled(SampledOp::kEndDelete, beginIdx.trackerIndex, beginIdx.seq);
+    }
+    return;
+  }
   trackers_[beginIdx.trackerIndex].endDelete(eventInfo(),
                                              beginIdx.historyIndex);
 }
 
+ValueTracker::Index ValueTracker::beginSampled(SampledOp op,
+                                               TrackerIndexT ti,
+                                               uint64_t value) {
+  Index index{ti, 0};
+  if (ti != kUntracked) {
+    index.seq = logSampled(op, ti, 0, value);
+  }
+  return index;
+}
+
+uint64_t ValueTracker::logSampled(SampledOp op,
+                                  TrackerIndexT ti,
+                                  uint64_t beginSeq,
+                                  uint64_t value,
+                                  bool found) {
+  auto& log = *threadLogs_;
+  if (log.events.size() == kThreadLogCapacity) {
+    spill(log);
+  }
+  SampledEvent event;
+  // the sequence number is taken before the operation of a begin event and
+  // after the one of an end event, which orders the events like they
+  // happened
+  event.seq = nextSeq_.fetch_add(1, std::memory_order_acq_rel);
+  event.beginSeq = beginSeq == 0 ? event.seq : beginSeq;
+  event.value = value;
+  event.tp = std::chrono::system_clock::now();
+  event.trackerIndex = ti;
+  event.tid = log.tid;
+  event.op = op;
+  event.found = found;
+  log.events.write(event);
+  return event.seq;
+}
+
+void ValueTracker::spill(ThreadLog& log) {
+  std::lock_guard<std::mutex> l{spillMutex_};
+  while (log.events.size() > 0) {
+    spilled_.push_back(log.events.read());
+  }
+}
+
+uint64_t ValueTracker::checkSampledEvents(
+    const InconsistencyCallback& onInconsistency) {
+  if (!isSampled()) {
+    return 0;
+  }
+  for (auto& log : threadLogs_.accessAllThreads()) {
+    spill(log);
+  }
+  std::vector<SampledEvent> events;
+  {
+    std::lock_guard<std::mutex> l{spillMutex_};
+    events.swap(spilled_);
+  }
+  std::sort(events.begin(), events.end(),
+            [](const SampledEvent& a, const SampledEvent& b) {
+              return a.seq < b.seq;
+            });
+
+  // history index of the begin events by their sequence number. The value
+  // histories are only used by this replay, so none of the locks are
+  // contended.
+  std::unordered_map<uint64_t, HistoryIndexT> begins;
+  uint64_t numInconsistent = 0;
+  for (const auto& event : events) {
+    auto& history = trackers_[event.trackerIndex];
+    EventInfo info{event.tid, event.tp};
+    switch (event.op) {
+    case SampledOp::kBeginGet:
+      begins[event.seq] = history.beginGet(info);
+      break;
+    case SampledOp::kBeginSet:
+      begins[event.seq] = history.beginSet(info, event.value);
+      break;
+    case SampledOp::kBeginDelete:
+      begins[event.seq] = history.beginDelete(info);
+      break;
+    default: {
+      auto it = begins.find(event.beginSeq);
+      if (it == begins.end()) {
+        // the begin was replayed by an earlier check
+        break;
+      }
+      if (event.op == SampledOp::kEndSet) {
+        history.endSet(info, it->second);
+      } else if (event.op == SampledOp::kEndDelete) {
+        history.endDelete(info, it->second);
+      } else {
+        LogEventStream es;
+        if (!history.endGet(info, it->second, event.value, event.found,
+                            &es)) {
+          numInconsistent++;
+          onInconsistency(sampledKeys_[event.trackerIndex], es);
+        }
+      }
+      begins.erase(it);
+    }
+    }
+  }
+  return numInconsistent;
+}
+
 void ValueTracker::evicted(folly::StringPiece /* key */) {
   // TODO: Implement
 }
@@ -84,6 +227,9 @@ ValueTracker::TrackerIndexT ValueTracker::getTrackerIndexOrThrow(
     folly::StringPiece key) const {
   auto it = keyTrackerMap_.find(key);
   if (it == keyTrackerMap_.end()) {
+    if (isSampled()) {
+      return kUntracked;
+    }
     throw std::logic_error("unknown key");
   }
   return it->second;
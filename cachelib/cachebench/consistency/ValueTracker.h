@@ -17,13 +17,20 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/ThreadLocal.h>
 #include <folly/hash/Hash.h>
 
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "cachelib/cachebench/consistency/LogEventStream.h"
+#include "cachelib/cachebench/consistency/RingBuffer.h"
 #include "cachelib/cachebench/consistency/ShortThreadId.h"
 #include "cachelib/cachebench/consistency/ValueHistory.h"
 
@@ -31,11 +38,29 @@ namespace facebook {
 namespace cachelib {
 namespace cachebench {
 
+// Tracks the values of the keys and checks that every get returns a value
+// consistent with the sets and deletes that preceded or overlapped it.
+//
+// By default every key is tracked and every get is checked as it ends, under
+// the lock of the value history of its key. In the sampled mode only the keys
+// whose hash is a multiple of the sample rate are tracked. Their events are
+// appended to a log of the calling thread without taking a lock and ordered
+// by a global sequence number, and the gets are checked by
+// checkSampledEvents() once the workload is done. This keeps the concurrency
+// of the workload close to the one of a run without consistency checking.
 class ValueTracker {
  public:
   using TrackerIndexT = uint32_t;
   using HistoryIndexT = uint32_t;
 
+  // called by checkSampledEvents() for every inconsistent get with its key
+  // and the history that reveals the inconsistency
+  using InconsistencyCallback =
+      std::function<void(folly::StringPiece, const LogEventStream&)>;
+
+  // number of events a thread logs before they are moved to the shared log
+  static constexpr size_t kThreadLogCapacity{4096};
+
   // Opaque for the user index into the value history
   struct Index {
     friend ValueTracker;
@@ -48,6 +73,9 @@ class ValueTracker {
     // trackers_[@trackerIndex].getAt/setAt(@historyIndex)
     TrackerIndexT trackerIndex{};
     HistoryIndexT historyIndex{};
+
+    // sequence number of the begin event in the sampled mode
+    uint64_t seq{};
   };
 
   // Helper for the constructor
@@ -58,7 +86,15 @@ class ValueTracker {
   //
   // Params:
   // @keys    list of keys to track
-  explicit ValueTracker(std::vector<folly::StringPiece> keys);
+  explicit ValueTracker(std::vector<folly::StringPiece> keys)
+      : ValueTracker(std::move(keys), 0) {}
+
+  // Params:
+  // @keys        list of keys to track
+  // @sampleRate  0 to check every key as its gets end. Otherwise only the
+  //              keys whose hash is a multiple of @sampleRate are tracked
+  //              and checked by checkSampledEvents().
+  ValueTracker(std::vector<folly::StringPiece> keys, uint32_t sampleRate);
   ValueTracker(const ValueTracker&) = delete;
   ValueTracker& operator=(const ValueTracker&) = delete;
 
@@ -68,7 +104,7 @@ class ValueTracker {
   Index beginSet(folly::StringPiece key, uint64_t value);
   Index beginDelete(folly::StringPiece key);
   // Returns false if inconsistent and feeds @es with the history that reveals
-  // inconsistency (optional).
+  // inconsistency (optional). Always true in the sampled mode.
   bool endGet(Index beginIdx,
               uint64_t data,
               bool found,
@@ -78,18 +114,95 @@ class ValueTracker {
 
   void evicted(folly::StringPiece key);
 
+  bool isSampled() const { return sampleRate_ != 0; }
+
+  // Checks the gets logged in the sampled mode by replaying the events of
+  // all the threads in the order of their sequence numbers. Events that were
+  // checked already are not replayed again. Call it once no thread uses the
+  // tracker anymore.
+  //
+  // @return number of inconsistent gets found
+  uint64_t checkSampledEvents(const InconsistencyCallback& onInconsistency);
+
  private:
   // Map from key to index into trackers vector
   using ValueHistoryMap = std::unordered_map<folly::StringPiece,
                                              TrackerIndexT,
                                              folly::hasher<folly::StringPiece>>;
 
+  // tracker index of the keys that are not sampled
+  static constexpr TrackerIndexT kUntracked{
+      std::numeric_limits<TrackerIndexT>::max()};
+
+  enum class SampledOp : uint8_t {
+    kBeginGet,
+    kBeginSet,
+    kBeginDelete,
+    kEndGet,
+    kEndSet,
+    kEndDelete,
+  };
+
+  struct SampledEvent {
+    uint64_t seq{};
+    // sequence number of the begin event, for the end events
+    uint64_t beginSeq{};
+    uint64_t value{};
+    EventInfo::TimePoint tp{};
+    TrackerIndexT trackerIndex{};
+    ShortThreadId tid{};
+    SampledOp op{SampledOp::kBeginGet};
+    bool found{false};
+  };
+
+  struct ThreadLog {
+    ThreadLog(ValueTracker& t, ShortThreadId id) : tracker{t}, tid{id} {}
+    // moves the events of an exiting thread to the shared log
+    ~ThreadLog() { tracker.spill(*this); }
+
+    ValueTracker& tracker;
+    const ShortThreadId tid;
+    RingBuffer<SampledEvent, kThreadLogCapacity> events;
+  };
+
   TrackerIndexT getTrackerIndexOrThrow(folly::StringPiece key) const;
   EventInfo eventInfo() const;
 
+  // log the begin event of an operation in the sampled mode, unless the key
+  // is not sampled
+  Index beginSampled(SampledOp op, TrackerIndexT ti, uint64_t value = 0);
+
+  // log an event of a sampled key on the calling thread
+  //
+  // @return the sequence number of the event
+  uint64_t logSampled(SampledOp op,
+                      TrackerIndexT ti,
+                      uint64_t beginSeq = 0,
+                      uint64_t value = 0,
+                      bool found = false);
+
+  // move the events of a thread log to the shared log
+  void spill(ThreadLog& log);
+
+  const uint32_t sampleRate_{0};
+
   ValueHistoryMap keyTrackerMap_;
   std::vector<ValueHistory> trackers_;
   mutable ShortThreadIdMap shortTids_;
+
+  // keys of the trackers, in the sampled mode
+  std::vector<folly::StringPiece> sampledKeys_;
+
+  std::atomic<uint64_t> nextSeq_{1};
+  std::atomic<ShortThreadId> nextTid_{0};
+
+  // events moved out of the thread logs. Declared before the thread logs
+  // since these spill into it when they are destroyed.
+  std::mutex spillMutex_;
+  std::vector<SampledEvent> spilled_;
+
+  folly::ThreadLocal<ThreadLog> threadLogs_{
+      [this]() { return new ThreadLog(*this, nextTid_.fetch_add(1)); }};
 };
 } // namespace cachebench
 } // namespace cachelib
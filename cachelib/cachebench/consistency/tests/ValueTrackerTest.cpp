@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <folly/Format.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "cachelib/cachebench/consistency/ValueTracker.h"
 
 namespace facebook {
@@ -35,6 +38,60 @@ TEST(ValueTracker, Basic) {
   EXPECT_TRUE(vt.endGet(catGet, 0, true));
   EXPECT_FALSE(vt.endGet(dogGet, 1, true)); // Inconsistent
 }
+
+// Same interleaving in the sampled mode, with every key sampled: the gets
+// are only checked after the fact.
+TEST(ValueTracker, Sampled) {
+  std::vector<std::string> ss{"cat", "dog"};
+  ValueTracker vt{ValueTracker::wrapStrings(ss), 1};
+  auto catSet = vt.beginSet("cat", 0);
+  vt.endSet(catSet);
+  auto catGet = vt.beginGet("cat");
+  vt.beginSet("dog", 0); // Set without end
+  auto dogGet = vt.beginGet("dog");
+  EXPECT_TRUE(vt.endGet(catGet, 0, true));
+  EXPECT_TRUE(vt.endGet(dogGet, 1, true)); // Not checked yet
+
+  std::vector<std::string> inconsistentKeys;
+  EXPECT_EQ(1, vt.checkSampledEvents([&](folly::StringPiece key,
+                                         const LogEventStream&) {
+    inconsistentKeys.push_back(key.str());
+  }));
+  EXPECT_EQ(std::vector<std::string>{"dog"}, inconsistentKeys);
+
+  // events are checked only once
+  EXPECT_EQ(0, vt.checkSampledEvents([](folly::StringPiece,
+                                        const LogEventStream&) {}));
+}
+
+// Events logged by threads that exited, across several spills of their logs,
+// are replayed in order.
+TEST(ValueTracker, SampledThreads) {
+  std::vector<std::string> ss;
+  for (int i = 0; i < 100; i++) {
+    ss.push_back(folly::sformat("key_{}", i));
+  }
+  ValueTracker vt{ValueTracker::wrapStrings(ss), 3};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&vt, &ss, t] {
+      for (size_t i = 0; i < 2 * ValueTracker::kThreadLogCapacity; i++) {
+        // every thread has keys of its own
+        const auto& key = ss[(i * 4 + t) % ss.size()];
+        auto set = vt.beginSet(key, t);
+        vt.endSet(set);
+        auto get = vt.beginGet(key);
+        vt.endGet(get, t, true);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, vt.checkSampledEvents([](folly::StringPiece,
+                                        const LogEventStream&) {}));
+}
 } // namespace tests
 } // namespace cachebench
 } // namespace cachelib
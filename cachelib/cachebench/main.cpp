@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/json.h>
 #include <folly/logging/LoggerDB.h>
 #include <gflags/gflags.h>
 
@@ -23,6 +26,7 @@
 
 #include "cachelib/cachebench/runner/Runner.h"
 #include "cachelib/cachebench/runner/Stressor.h"
+#include "cachelib/cachebench/util/RegressionCheck.h"
 #include "cachelib/common/Utils.h"
 
 #ifdef CACHEBENCH_FB_ENV
@@ -55,6 +59,25 @@ DEFINE_string(progress_stats_file,
 DEFINE_int32(timeout_seconds,
              0,
              "Maximum allowed seconds for running test. 0 means no timeout");
+DEFINE_uint32(num_runs,
+              1,
+              "Number of times to run the test, each with a new cache, to "
+              "compare their results with --baseline_file");
+DEFINE_string(results_file,
+              "",
+              "Write the metrics of every run to this file as json, to be "
+              "used as the --baseline_file of later tests");
+DEFINE_string(baseline_file,
+              "",
+              "Compare the metrics of the runs to the ones in this file and "
+              "fail on a regression");
+DEFINE_double(regression_confidence,
+              0.95,
+              "Confidence level of the comparison with --baseline_file");
+DEFINE_double(regression_min_change_pct,
+              1.0,
+              "Smallest change of a metric in percent reported as a "
+              "regression, however significant");
 
 struct sigaction act;
 std::unique_ptr<facebook::cachelib::cachebench::Runner> runnerInstance;
@@ -115,10 +138,71 @@ bool checkArgsValidity() {
               << std::endl;
     return false;
   }
+  if (FLAGS_num_runs == 0) {
+    std::cout << "--num_runs must be positive" << std::endl;
+    return false;
+  }
+  if (!FLAGS_baseline_file.empty() &&
+      !facebook::cachelib::util::pathExists(FLAGS_baseline_file)) {
+    std::cout << "Invalid baseline file: " << FLAGS_baseline_file << std::endl;
+    return false;
+  }
 
   return true;
 }
 
+// Runs the test --num_runs times. With --results_file or --baseline_file,
+// keeps the metrics of the runs to store them and compare them to the
+// baseline.
+//
+// @return false if a run failed or regressed from the baseline
+bool runTests(const facebook::cachelib::cachebench::CacheBenchConfig& config) {
+  using namespace facebook::cachelib::cachebench;
+  const bool keepResults =
+      !FLAGS_results_file.empty() || !FLAGS_baseline_file.empty();
+  // read the baseline before spending the time of the runs
+  RunResults baseline;
+  if (!FLAGS_baseline_file.empty()) {
+    std::string json;
+    if (!folly::readFile(FLAGS_baseline_file.c_str(), json)) {
+      throw std::invalid_argument(
+          folly::sformat("could not read file: {}", FLAGS_baseline_file));
+    }
+    baseline = RegressionCheck::fromJson(folly::parseJson(json));
+  }
+  RegressionCheck check{FLAGS_regression_confidence,
+                        FLAGS_regression_min_change_pct};
+
+  RunResults results;
+  for (uint32_t i = 0; i < FLAGS_num_runs; i++) {
+    if (FLAGS_num_runs > 1) {
+      std::cout << "== Run " << i + 1 << " of " << FLAGS_num_runs << " =="
+                << std::endl;
+    }
+    runnerInstance = std::make_unique<Runner>(config);
+    folly::UserCounters counters;
+    if (!runnerInstance->run(std::chrono::seconds(FLAGS_progress),
+                             FLAGS_progress_stats_file,
+                             keepResults ? &counters : nullptr)) {
+      return false;
+    }
+    RegressionCheck::addRun(counters, results);
+  }
+
+  if (!FLAGS_results_file.empty()) {
+    if (!folly::writeFile(folly::toPrettyJson(RegressionCheck::toJson(results)),
+                          FLAGS_results_file.c_str())) {
+      std::cout << "Could not write " << FLAGS_results_file << std::endl;
+      return false;
+    }
+  }
+  if (FLAGS_baseline_file.empty()) {
+    return true;
+  }
+  std::cout << "\n== Comparison with " << FLAGS_baseline_file << " ==\n";
+  return RegressionCheck::render(check.compare(baseline, results), std::cout);
+}
+
 int main(int argc, char** argv) {
   using namespace facebook::cachelib;
   using namespace facebook::cachelib::cachebench;
@@ -151,15 +235,10 @@ int main(int argc, char** argv) {
 #endif
 
   try {
-    runnerInstance =
-        std::make_unique<facebook::cachelib::cachebench::Runner>(config);
     setupSignalHandler();
     setupTimeoutHandler();
 
-    return runnerInstance->run(std::chrono::seconds(FLAGS_progress),
-                               FLAGS_progress_stats_file)
-               ? 0
-               : 1;
+    return runTests(config) ? 0 : 1;
   } catch (const std::exception& e) {
     std::cout << "Invalid configuration. Exception: " << e.what() << std::endl;
     return 1;
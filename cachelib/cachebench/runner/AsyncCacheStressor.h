@@ -114,7 +114,8 @@ class AsyncCacheStressor : public Stressor {
     }
 
     if (config_.checkConsistency) {
-      cache_->enableConsistencyCheck(wg_->getAllKeys());
+      cache_->enableConsistencyCheck(wg_->getAllKeys(),
+                                     config_.consistencySampleRate);
     }
     if (config_.opRatePerSec > 0) {
       rateLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
@@ -159,6 +160,7 @@ class AsyncCacheStressor : public Stressor {
       stressWorker_.join();
     }
     wg_->markShutdown();
+    cache_->checkSampledConsistency();
     cache_->clearCache(config_.maxInvalidDestructorCount);
   }
 
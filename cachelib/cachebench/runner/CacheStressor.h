@@ -18,6 +18,7 @@
 
 #include <folly/Random.h>
 #include <folly/TokenBucket.h>
+#include <folly/portability/Asm.h>
 #include <folly/system/ThreadName.h>
 
 #include <atomic>
@@ -25,6 +26,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <unordered_set>
 
@@ -36,6 +38,7 @@
 #include "cachelib/cachebench/util/Parallel.h"
 #include "cachelib/cachebench/util/Request.h"
 #include "cachelib/cachebench/workload/GeneratorBase.h"
+#include "cachelib/common/PercentileStats.h"
 
 namespace facebook {
 namespace cachelib {
@@ -62,6 +65,8 @@ class CacheStressor : public Stressor {
                 std::unique_ptr<GeneratorBase>&& generator)
       : config_(std::move(config)),
         throughputStats_(config_.numThreads),
+        latencyStats_(config_.numThreads),
+        threadTenants_(config_.numThreads),
         wg_(std::move(generator)),
         hardcodedString_(genHardcodedString()),
         endTime_{std::chrono::system_clock::time_point::max()} {
@@ -112,7 +117,15 @@ class CacheStressor : public Stressor {
           "test: {}, cache: {}",
           config_.opPoolDistribution.size(), cache_->numPools()));
     }
-    if (config_.keyPoolDistribution.size() != cache_->numPools()) {
+    for (const auto& tenant : config_.tenants) {
+      if (tenant.tenantPoolId >= cache_->numPools()) {
+        throw std::invalid_argument(folly::sformat(
+            "tenant {} uses pool {}, the cache has {} pools", tenant.name,
+            tenant.tenantPoolId, cache_->numPools()));
+      }
+    }
+    if (config_.tenants.empty() &&
+        config_.keyPoolDistribution.size() != cache_->numPools()) {
       throw std::invalid_argument(folly::sformat(
           "different number of pools in the test from in the cache. "
           "test: {}, cache: {}",
@@ -120,7 +133,8 @@ class CacheStressor : public Stressor {
     }
 
     if (config_.checkConsistency) {
-      cache_->enableConsistencyCheck(wg_->getAllKeys());
+      cache_->enableConsistencyCheck(wg_->getAllKeys(),
+                                     config_.consistencySampleRate);
     }
     if (config_.opRatePerSec > 0) {
       // opRateBurstSize is default to opRatePerSec if not specified
@@ -129,6 +143,9 @@ class CacheStressor : public Stressor {
                                     ? config_.opRateBurstSize
                                     : config_.opRatePerSec);
     }
+    for (auto& tenant : threadTenants_) {
+      tenant.store(config_.tenants.size(), std::memory_order_relaxed);
+    }
   }
 
   ~CacheStressor() override { finish(); }
@@ -150,9 +167,14 @@ class CacheStressor : public Stressor {
       for (uint64_t i = 0; i < config_.numThreads; ++i) {
         workers.push_back(
             std::thread([this, throughputStats = &throughputStats_.at(i),
+                         latencyStats = &latencyStats_.at(i),
+                         threadTenant = &threadTenants_.at(i),
                          threadName = folly::sformat("cb_stressor_{}", i)]() {
               folly::setThreadName(threadName);
-              stressByDiscreteDistribution(*throughputStats);
+              const auto tenant = wg_->getTenant();
+              threadTenant->store(tenant, std::memory_order_relaxed);
+              stressByDiscreteDistribution(*throughputStats, *latencyStats,
+                                           tenant);
             }));
       }
       for (auto& worker : workers) {
@@ -182,6 +204,7 @@ class CacheStressor : public Stressor {
       stressWorker_.join();
     }
     wg_->markShutdown();
+    cache_->checkSampledConsistency();
     cache_->clearCache(config_.maxInvalidDestructorCount);
   }
 
@@ -205,14 +228,33 @@ class CacheStressor : public Stressor {
     return res;
   }
 
+  // obtain aggregated op latencies for the stress run so far.
+  OpLatencyStats aggregateLatencyStats() const override {
+    OpLatencyStats res{};
+    for (const auto& stats : latencyStats_) {
+      res += stats;
+    }
+    return res;
+  }
+
   void renderWorkloadGeneratorStats(uint64_t elapsedTimeNs,
                                     std::ostream& out) const override {
     wg_->renderStats(elapsedTimeNs, out);
+    if (config_.replaySpeed > 0) {
+      renderReplayStats(out);
+    }
+    if (!config_.tenants.empty()) {
+      renderTenantStats(elapsedTimeNs, out);
+    }
   }
 
   void renderWorkloadGeneratorStats(
       uint64_t elapsedTimeNs, folly::UserCounters& counters) const override {
     wg_->renderStats(elapsedTimeNs, counters);
+    if (config_.replaySpeed > 0) {
+      counters["replay_latency_p99"] = replayLatencyNs_.estimate().p99;
+      counters["replay_issue_lag_p99"] = replayIssueLagNs_.estimate().p99;
+    }
   }
 
   uint64_t getTestDurationNs() const override {
@@ -272,8 +314,14 @@ class CacheStressor : public Stressor {
   //
   // Throughput and Hit/Miss rates are tracked here as well
   //
-  // @param stats       Throughput stats
-  void stressByDiscreteDistribution(ThroughputStats& stats) {
+  // @param stats         Throughput stats
+  // @param latencyStats  Op latencies, if StressorConfig::latencyStatsFile
+  //                      is set
+  // @param tenant        tenant served by the thread, if
+  //                      StressorConfig::tenants is set
+  void stressByDiscreteDistribution(ThroughputStats& stats,
+                                    OpLatencyStats& latencyStats,
+                                    size_t tenant) {
     std::mt19937_64 gen(folly::Random::rand64());
     std::discrete_distribution<> opPoolDist(config_.opPoolDistribution.begin(),
                                             config_.opPoolDistribution.end());
@@ -292,6 +340,14 @@ class CacheStressor : public Stressor {
       limitRate();
     };
 
+    const bool openLoop = config_.replaySpeed > 0;
+    const bool recordLatency = !config_.latencyStatsFile.empty();
+    // the ops of a tenant go to its pool, with its own keys
+    const bool multiTenant = !config_.tenants.empty();
+    const std::string tenantKeyPrefix =
+        multiTenant ? folly::sformat("{}:", tenant) : "";
+    std::string tenantKey;
+
     std::optional<uint64_t> lastRequestId = std::nullopt;
     for (uint64_t i = 0;
          i < config_.numOps &&
@@ -300,9 +356,19 @@ class CacheStressor : public Stressor {
              config_.maxInvalidDestructorCount &&
          !cache_->isNvmCacheDisabled() && !shouldTestStop();
          ++i) {
+      // when the op should have been issued in open-loop replay
+      std::chrono::steady_clock::time_point intendedTime{};
       try {
         // at the end of every operation, throttle per the config.
         SCOPE_EXIT { throttleFn(); };
+        SCOPE_EXIT {
+          if (openLoop && intendedTime != decltype(intendedTime){}) {
+            replayLatencyNs_.trackValue(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - intendedTime)
+                    .count());
+          }
+        };
         // detect refcount leaks when run in  debug mode.
 #ifndef NDEBUG
         auto checkCnt = [useCombinedLockForIterators =
@@ -318,10 +384,30 @@ class CacheStressor : public Stressor {
 #endif
         ++stats.ops;
 
-        const auto pid = static_cast<PoolId>(opPoolDist(gen));
+        const auto pid = static_cast<PoolId>(
+            multiTenant ? config_.tenants[tenant].tenantPoolId
+                        : opPoolDist(gen));
         const Request& req(getReq(pid, gen, lastRequestId));
+        if (openLoop) {
+          intendedTime = waitForReplayTime(req);
+        }
         OpType op = req.getOp();
+        // in open-loop replay, the latency includes the delay to issue the op
+        std::chrono::steady_clock::time_point opStart{};
+        if (recordLatency) {
+          opStart = openLoop ? intendedTime : std::chrono::steady_clock::now();
+        }
+        SCOPE_EXIT {
+          if (recordLatency) {
+            latencyStats.record(op,
+                                std::chrono::steady_clock::now() - opStart);
+          }
+        };
         std::string_view key = req.key;
+        if (multiTenant) {
+          tenantKey.assign(tenantKeyPrefix).append(key);
+          key = tenantKey;
+        }
         std::string oneHitKey;
         if (op == OpType::kLoneGet || op == OpType::kLoneSet) {
           oneHitKey = Request::getUniqueKey();
@@ -499,6 +585,97 @@ class CacheStressor : public Stressor {
     }
   }
 
+  // Sleeps until @req is due: its trace time past the first request, divided
+  // by replaySpeed, after the first request was issued.
+  //
+  // @return the time at which @req should have been issued
+  std::chrono::steady_clock::time_point waitForReplayTime(const Request& req) {
+    using Clock = std::chrono::steady_clock;
+    // sleeping overshoots by tens of microseconds; spin for the end of a wait
+    constexpr std::chrono::microseconds kSpinTime{50};
+    // sleep in slices to notice the end of the test during trace gaps
+    constexpr std::chrono::milliseconds kMaxSleep{100};
+
+    const uint64_t traceUs =
+        req.timestampUs != 0 ? req.timestampUs : req.timestamp * 1000000;
+    std::call_once(replayStartOnce_, [&] {
+      replayTraceStartUs_ = traceUs;
+      replayStart_ = Clock::now();
+    });
+    // another thread may have started the replay with a later request
+    const double offsetUs =
+        traceUs > replayTraceStartUs_
+            ? (traceUs - replayTraceStartUs_) / config_.replaySpeed
+            : 0;
+    const auto intendedTime =
+        replayStart_ + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double, std::micro>(offsetUs));
+
+    auto now = Clock::now();
+    while (intendedTime - now > kSpinTime && !shouldTestStop()) {
+      std::this_thread::sleep_until(
+          std::min(intendedTime - kSpinTime, now + kMaxSleep));
+      now = Clock::now();
+    }
+    while (now < intendedTime && !shouldTestStop()) {
+      folly::asm_volatile_pause();
+      now = Clock::now();
+    }
+    replayIssueLagNs_.trackValue(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                             intendedTime)
+            .count());
+    return intendedTime;
+  }
+
+  void renderReplayStats(std::ostream& out) const {
+    out << "== Open Loop Replay ==" << std::endl;
+    auto fmtLatency = [&](folly::StringPiece cat,
+                          const util::PercentileStats::Estimates& latency) {
+      auto fmt = [&](folly::StringPiece pct, uint64_t diffNanos) {
+        out << folly::sformat("{:20} {:8} : {:>10.2f} us\n", cat, pct,
+                              diffNanos / 1000.0);
+      };
+      fmt("avg", latency.avg);
+      fmt("p50", latency.p50);
+      fmt("p90", latency.p90);
+      fmt("p99", latency.p99);
+      fmt("p999", latency.p999);
+      fmt("p9999", latency.p9999);
+      fmt("p100", latency.p100);
+    };
+    // latency from the intended issue time, including any queueing
+    fmtLatency("Op latency", replayLatencyNs_.estimate());
+    // how late the ops were issued; ops pile up behind slow ones when there
+    // are not enough threads to keep up with the trace
+    fmtLatency("Issue lag", replayIssueLagNs_.estimate());
+  }
+
+  // throughput, hit ratio and latency of the ops of every tenant
+  void renderTenantStats(uint64_t elapsedTimeNs, std::ostream& out) const {
+    std::vector<ThroughputStats> throughput(config_.tenants.size());
+    std::vector<OpLatencyStats> latency(config_.tenants.size());
+    for (size_t i = 0; i < threadTenants_.size(); i++) {
+      const auto tenant = threadTenants_[i].load(std::memory_order_relaxed);
+      if (tenant >= config_.tenants.size()) {
+        // not started yet
+        continue;
+      }
+      throughput[tenant] += throughputStats_[i];
+      latency[tenant] += latencyStats_[i];
+    }
+    for (size_t tenant = 0; tenant < config_.tenants.size(); tenant++) {
+      out << folly::sformat("== Tenant {} {} (pool {}) ==", tenant,
+                            config_.tenants[tenant].name,
+                            config_.tenants[tenant].tenantPoolId)
+          << std::endl;
+      throughput[tenant].render(elapsedTimeNs, out);
+      if (!config_.latencyStatsFile.empty()) {
+        latency[tenant].render(out);
+      }
+    }
+  }
+
   // fetch a request from the workload generator for a particular pool
   // @param pid             the pool id chosen for the request.
   // @param gen             the thread local random number generator to be
@@ -555,8 +732,21 @@ class CacheStressor : public Stressor {
 
   std::vector<ThroughputStats> throughputStats_; // thread local stats
 
+  std::vector<OpLatencyStats> latencyStats_; // thread local latencies
+
+  // tenant served by every thread, once it started
+  std::vector<std::atomic<size_t>> threadTenants_;
+
   std::unique_ptr<GeneratorBase> wg_; // workload generator
 
+  // open-loop replay: the trace time of the first request and when it was
+  // issued, the timeline the other requests are issued on.
+  std::once_flag replayStartOnce_;
+  std::chrono::steady_clock::time_point replayStart_;
+  uint64_t replayTraceStartUs_{0};
+  mutable util::PercentileStats replayLatencyNs_;
+  mutable util::PercentileStats replayIssueLagNs_;
+
   // locks when using chained item and moving.
   std::array<folly::SharedMutex, 1024> locks_;
 
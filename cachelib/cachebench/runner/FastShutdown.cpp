@@ -33,10 +33,8 @@ FastShutdownStressor::FastShutdownStressor(const CacheConfig& cacheConfig,
 
 void FastShutdownStressor::start() {
   startTime_ = std::chrono::system_clock::now();
-  constexpr uint32_t kSlabSize = 4 * 1024 * 1024;
-
-  uint32_t nslabs = cache_->getCacheSize() / kSlabSize;
-  uint32_t numSmallAllocs = kSlabSize / 64;
+  uint32_t nslabs = cache_->getCacheSize() / Slab::kSize;
+  uint32_t numSmallAllocs = Slab::kSize / 64;
   using CacheType = Cache<LruAllocator>;
   uint64_t expectedAbortCount = 0;
 
@@ -120,6 +118,12 @@ void FastShutdownStressor::start() {
         endTime_ - shutDownStartTime);
 
     std::cout << "Shut down durtaion " << duration.count() << "\n";
+    const auto& timings = cache_->getShutDownTimings();
+    std::cout << folly::sformat(
+        "Shut down phases: stopping workers {}ms, saving nvmcache {}ms, "
+        "saving dram cache {}ms, shutting down shm {}ms\n",
+        timings.stopWorkers.count(), timings.saveNvmCache.count(),
+        timings.saveRamCache.count(), timings.shmShutDown.count());
     if (duration.count() > 10) {
       throw std::runtime_error(
           folly::sformat("Failed. Took {} seconds for shutdown to complete",
@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Random.h>
+#include <folly/TokenBucket.h>
+#include <folly/fibers/Baton.h>
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/system/ThreadName.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "cachelib/cachebench/cache/Cache.h"
+#include "cachelib/cachebench/runner/Stressor.h"
+#include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/util/Exceptions.h"
+#include "cachelib/cachebench/util/Request.h"
+#include "cachelib/cachebench/workload/GeneratorBase.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// Stressor that keeps many requests in flight on every thread, to drive NVM
+// at the queue depths of a real service with few threads. Every thread runs
+// StressorConfig::fibersPerThread fibers that each issue requests one after
+// the other. A lookup that goes to NVM suspends its fiber on the wait context
+// of the handle, so the thread goes on with the requests of its other fibers
+// until the item is read. Like AsyncCacheStressor, values follow the
+// CacheValue schema and item.getMemory and item.getSize are not valid.
+template <typename Allocator>
+class FiberCacheStressor : public Stressor {
+ public:
+  using CacheT = Cache<Allocator>;
+  using Key = typename CacheT::Key;
+  using WriteHandle = typename CacheT::WriteHandle;
+
+  // @param cacheConfig   the config to instantiate the cache instance
+  // @param config        stress test config
+  // @param generator     workload  generator
+  //
+  // @throw std::invalid_argument if the config needs locks around chained
+  //        items, which would block the thread under a suspended fiber.
+  FiberCacheStressor(CacheConfig cacheConfig,
+                     StressorConfig config,
+                     std::unique_ptr<GeneratorBase>&& generator)
+      : config_(std::move(config)),
+        throughputStats_(config_.numThreads),
+        latencyStats_(config_.numThreads),
+        wg_(std::move(generator)),
+        hardcodedString_(genHardcodedString()),
+        endTime_{std::chrono::system_clock::time_point::max()} {
+    if (config_.fibersPerThread == 0) {
+      throw std::invalid_argument("fibersPerThread must be positive");
+    }
+    if (config_.usesChainedItems() &&
+        (cacheConfig.moveOnSlabRelease || config_.checkConsistency)) {
+      throw std::invalid_argument(
+          "fiber stressor does not support chained items with "
+          "moveOnSlabRelease or consistency checking");
+    }
+
+    cache_ = std::make_unique<CacheT>(cacheConfig,
+                                      typename CacheT::ChainedItemMovingSync{},
+                                      "", config_.touchValue);
+    if (config_.opPoolDistribution.size() > cache_->numPools()) {
+      throw std::invalid_argument(folly::sformat(
+          "more pools specified in the test than in the cache. "
+          "test: {}, cache: {}",
+          config_.opPoolDistribution.size(), cache_->numPools()));
+    }
+    if (config_.keyPoolDistribution.size() != cache_->numPools()) {
+      throw std::invalid_argument(folly::sformat(
+          "different number of pools in the test from in the cache. "
+          "test: {}, cache: {}",
+          config_.keyPoolDistribution.size(), cache_->numPools()));
+    }
+
+    if (config_.checkConsistency) {
+      cache_->enableConsistencyCheck(wg_->getAllKeys(),
+                                     config_.consistencySampleRate);
+    }
+    if (config_.opRatePerSec > 0) {
+      rateLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
+          config_.opRatePerSec, config_.opRatePerSec);
+    }
+  }
+
+  ~FiberCacheStressor() override { finish(); }
+
+  // Start the stress test by spawning the worker threads and waiting for them
+  // to finish the stress operations.
+  void start() override {
+    {
+      std::lock_guard<std::mutex> l(timeMutex_);
+      startTime_ = std::chrono::system_clock::now();
+    }
+    std::cout << folly::sformat(
+                     "Total {:.2f}M ops to be run, {} in flight per thread",
+                     config_.numThreads * config_.numOps / 1e6,
+                     config_.fibersPerThread)
+              << std::endl;
+
+    stressWorker_ = std::thread([this] {
+      std::vector<std::thread> workers;
+      for (uint64_t i = 0; i < config_.numThreads; ++i) {
+        workers.push_back(
+            std::thread([this, throughputStats = &throughputStats_.at(i),
+                         latencyStats = &latencyStats_.at(i),
+                         threadName = folly::sformat("cb_fiber_{}", i)]() {
+              folly::setThreadName(threadName);
+              stressWithFibers(*throughputStats, *latencyStats);
+            }));
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+      {
+        std::lock_guard<std::mutex> l(timeMutex_);
+        endTime_ = std::chrono::system_clock::now();
+      }
+    });
+  }
+
+  // Block until all stress workers are finished.
+  void finish() override {
+    if (stressWorker_.joinable()) {
+      stressWorker_.join();
+    }
+    wg_->markShutdown();
+    cache_->checkSampledConsistency();
+    cache_->clearCache(config_.maxInvalidDestructorCount);
+  }
+
+  // abort the stress run by indicating to the workload generator and
+  // delegating to the base class abort() to stop the test.
+  void abort() override {
+    wg_->markShutdown();
+    Stressor::abort();
+  }
+
+  // obtain stats from the cache instance.
+  Stats getCacheStats() const override { return cache_->getStats(); }
+
+  // obtain aggregated throughput stats for the stress run so far.
+  ThroughputStats aggregateThroughputStats() const override {
+    ThroughputStats res{};
+    for (const auto& stats : throughputStats_) {
+      res += stats;
+    }
+    return res;
+  }
+
+  OpLatencyStats aggregateLatencyStats() const override {
+    OpLatencyStats res{};
+    for (const auto& stats : latencyStats_) {
+      res += stats;
+    }
+    return res;
+  }
+
+  void renderWorkloadGeneratorStats(uint64_t elapsedTimeNs,
+                                    std::ostream& out) const override {
+    wg_->renderStats(elapsedTimeNs, out);
+  }
+
+  void renderWorkloadGeneratorStats(
+      uint64_t elapsedTimeNs, folly::UserCounters& counters) const override {
+    wg_->renderStats(elapsedTimeNs, counters);
+  }
+
+  uint64_t getTestDurationNs() const override {
+    std::lock_guard<std::mutex> l(timeMutex_);
+    return std::chrono::nanoseconds{
+        std::min(std::chrono::system_clock::now(), endTime_) - startTime_}
+        .count();
+  }
+
+ private:
+  // cache operations run on the fiber stacks
+  static constexpr size_t kFiberStackSize = 64 * 1024;
+
+  // state shared by the fibers of a thread, which run one at a time
+  struct ThreadState {
+    ThroughputStats& stats;
+    OpLatencyStats& latencyStats;
+    std::mt19937_64 gen{folly::Random::rand64()};
+    std::discrete_distribution<> opPoolDist;
+    // ops of the thread not issued yet
+    uint64_t remainingOps{0};
+    // ops since the last delay
+    uint64_t opCounter{0};
+  };
+
+  static std::string genHardcodedString() {
+    const std::string s = "The quick brown fox jumps over the lazy dog. ";
+    std::string val;
+    for (int i = 0; i < 4 * 1024 * 1024; i += s.size()) {
+      val += s;
+    }
+    return val;
+  }
+
+  // suspends the calling fiber, letting the others run
+  static void sleepFiber(std::chrono::nanoseconds duration) {
+    folly::fibers::Baton baton;
+    baton.try_wait_for(duration);
+  }
+
+  // populate the input item handle according to the stress setup.
+  void populateItem(WriteHandle& handle) {
+    if (!config_.populateItem) {
+      return;
+    }
+    XDCHECK(handle);
+    XDCHECK_LE(cache_->getSize(handle), 4ULL * 1024 * 1024);
+    if (cache_->consistencyCheckEnabled()) {
+      cache_->setUint64ToItem(handle, folly::Random::rand64(rng));
+    } else {
+      cache_->setStringItem(handle, hardcodedString_);
+    }
+  }
+
+  // Runs the ops of a thread on fibers of an event base, until all of them
+  // are done.
+  void stressWithFibers(ThroughputStats& stats, OpLatencyStats& latencyStats) {
+    ThreadState state{stats, latencyStats};
+    state.opPoolDist = std::discrete_distribution<>(
+        config_.opPoolDistribution.begin(), config_.opPoolDistribution.end());
+    state.remainingOps = config_.numOps;
+
+    folly::EventBase evb;
+    folly::fibers::FiberManager::Options options;
+    options.stackSize = kFiberStackSize;
+    auto& fm = folly::fibers::getFiberManager(evb, options);
+
+    uint64_t runningFibers = config_.fibersPerThread;
+    for (uint64_t i = 0; i < config_.fibersPerThread; ++i) {
+      fm.addTask([&] {
+        runRequests(state);
+        if (--runningFibers == 0) {
+          evb.terminateLoopSoon();
+        }
+      });
+    }
+    evb.loopForever();
+    wg_->markFinish();
+  }
+
+  bool shouldStop() {
+    return cache_->getInconsistencyCount() >= config_.maxInconsistencyCount ||
+           cache_->getInvalidDestructorCount() >=
+               config_.maxInvalidDestructorCount ||
+           cache_->isNvmCacheDisabled() || shouldTestStop();
+  }
+
+  // Issues requests of the thread one after the other until its ops run
+  // out. Handle counts are not checked for leaks per op since the handles of
+  // all the fibers of the thread count together.
+  void runRequests(ThreadState& state) {
+    const bool recordLatency = !config_.latencyStatsFile.empty();
+    auto& stats = state.stats;
+    std::optional<uint64_t> lastRequestId = std::nullopt;
+    while (state.remainingOps > 0 && !shouldStop()) {
+      --state.remainingOps;
+      try {
+        SCOPE_EXIT { throttle(state); };
+        ++stats.ops;
+
+        const auto pid = static_cast<PoolId>(state.opPoolDist(state.gen));
+        const Request& req(getReq(pid, state.gen, lastRequestId));
+        // the op of a request can be changed by other threads once the fiber
+        // is suspended
+        const OpType op = req.getOp();
+        const auto requestId = req.requestId;
+        std::string_view key = req.key;
+        std::string oneHitKey;
+        if (op == OpType::kLoneGet || op == OpType::kLoneSet) {
+          oneHitKey = Request::getUniqueKey();
+          key = oneHitKey;
+        }
+        std::chrono::steady_clock::time_point opStart{};
+        if (recordLatency) {
+          opStart = std::chrono::steady_clock::now();
+        }
+        SCOPE_EXIT {
+          if (recordLatency) {
+            state.latencyStats.record(
+                op, std::chrono::steady_clock::now() - opStart);
+          }
+        };
+
+        OpResultType result(OpResultType::kNop);
+        switch (op) {
+        case OpType::kLoneSet:
+        case OpType::kSet: {
+          result = setKey(pid, stats, key, *(req.sizeBegin), req.ttlSecs,
+                          req.admFeatureMap);
+          break;
+        }
+        case OpType::kLoneGet:
+        case OpType::kGet: {
+          ++stats.get;
+          cache_->recordAccess(key);
+          // suspends the fiber until the item is read from NVM
+          auto it = cache_->find(key);
+          if (it == nullptr) {
+            ++stats.getMiss;
+            result = OpResultType::kGetMiss;
+            if (config_.enableLookaside) {
+              setKey(pid, stats, key, *(req.sizeBegin), req.ttlSecs,
+                     req.admFeatureMap);
+            }
+          } else {
+            result = OpResultType::kGetHit;
+          }
+          break;
+        }
+        case OpType::kDel: {
+          ++stats.del;
+          auto res = cache_->remove(key);
+          if (res == CacheT::RemoveRes::kNotFoundInRam) {
+            ++stats.delNotFound;
+          }
+          break;
+        }
+        case OpType::kAddChained: {
+          ++stats.get;
+          auto it = cache_->findToWrite(key);
+          if (!it) {
+            ++stats.getMiss;
+
+            ++stats.set;
+            it = cache_->allocate(pid, key, *(req.sizeBegin), req.ttlSecs);
+            if (!it) {
+              ++stats.setFailure;
+              break;
+            }
+            populateItem(it);
+            cache_->insertOrReplace(it);
+          }
+          XDCHECK(req.sizeBegin + 1 != req.sizeEnd);
+          for (auto j = req.sizeBegin + 1; j != req.sizeEnd; j++) {
+            ++stats.addChained;
+            auto child = cache_->allocateChainedItem(it, *j);
+            if (!child) {
+              ++stats.addChainedFailure;
+              continue;
+            }
+            populateItem(child);
+            cache_->addChainedItem(it, std::move(child));
+          }
+          break;
+        }
+        case OpType::kUpdate: {
+          ++stats.get;
+          ++stats.update;
+          auto it = cache_->findToWrite(key);
+          if (it == nullptr) {
+            ++stats.getMiss;
+            ++stats.updateMiss;
+            break;
+          }
+          cache_->updateItemRecordVersion(it);
+          break;
+        }
+        case OpType::kCouldExist: {
+          ++stats.couldExistOp;
+          if (!cache_->couldExist(key)) {
+            ++stats.couldExistOpFalse;
+          }
+          break;
+        }
+        default:
+          throw std::runtime_error(
+              folly::sformat("invalid operation generated: {}", (int)op));
+        }
+
+        lastRequestId = requestId;
+        if (requestId) {
+          wg_->notifyResult(*requestId, result);
+        }
+      } catch (const cachebench::EndOfTrace&) {
+        break;
+      }
+    }
+  }
+
+  // Delays and rate limits per the config by suspending the fiber rather
+  // than the thread.
+  void throttle(ThreadState& state) {
+    if (config_.opDelayBatch != 0 && config_.opDelayNs != 0 &&
+        ++state.opCounter == config_.opDelayBatch) {
+      state.opCounter = 0;
+      sleepFiber(std::chrono::nanoseconds(config_.opDelayNs));
+    }
+    if (rateLimiter_) {
+      const auto waitSecs = rateLimiter_->consumeWithBorrowNonBlocking(1);
+      if (waitSecs && *waitSecs > 0) {
+        sleepFiber(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(*waitSecs)));
+      }
+    }
+  }
+
+  // inserts key into the cache if the admission policy also indicates the
+  // key is worthy to be cached.
+  //
+  // @param pid         pool id to insert the key
+  // @param stats       reference to the stats structure.
+  // @param key         the key to be inserted
+  // @param size        size of the cache value
+  // @param ttlSecs     ttl for the value
+  // @param featureMap  feature map for admission policy decisions.
+  OpResultType setKey(
+      PoolId pid,
+      ThroughputStats& stats,
+      const std::string_view key,
+      size_t size,
+      uint32_t ttlSecs,
+      const std::unordered_map<std::string, std::string>& featureMap) {
+    if (config_.admPolicy && !config_.admPolicy->accept(featureMap)) {
+      return OpResultType::kSetSkip;
+    }
+
+    ++stats.set;
+    auto it = cache_->allocate(pid, key, size, ttlSecs);
+    if (it == nullptr) {
+      ++stats.setFailure;
+      return OpResultType::kSetFailure;
+    }
+    populateItem(it);
+    cache_->insertOrReplace(it);
+    return OpResultType::kSetSuccess;
+  }
+
+  // fetch a request from the workload generator for a particular pool
+  const Request& getReq(const PoolId& pid,
+                        std::mt19937_64& gen,
+                        std::optional<uint64_t>& lastRequestId) {
+    while (true) {
+      const Request& req(wg_->getReq(pid, gen, lastRequestId));
+      if (config_.checkConsistency && cache_->isInvalidKey(req.key)) {
+        continue;
+      }
+      if (config_.checkNvmCacheWarmUp &&
+          folly::Random::oneIn(kNvmCacheWarmUpCheckRate)) {
+        checkNvmCacheWarmedUp(req.timestamp);
+      }
+      return req;
+    }
+  }
+
+  void checkNvmCacheWarmedUp(uint64_t requestTimestamp) {
+    if (hasNvmCacheWarmedUp_.load(std::memory_order_relaxed) ||
+        cache_->isNvmCacheDisabled()) {
+      return;
+    }
+    if (cache_->hasNvmCacheWarmedUp() &&
+        !hasNvmCacheWarmedUp_.exchange(true)) {
+      wg_->setNvmCacheWarmedUp(requestTimestamp);
+      XLOG(INFO) << "NVM cache has been warmed up";
+    }
+  }
+
+  static constexpr uint32_t kNvmCacheWarmUpCheckRate = 1000;
+
+  const StressorConfig config_; // config for the stress run
+
+  std::vector<ThroughputStats> throughputStats_; // thread local stats
+
+  std::vector<OpLatencyStats> latencyStats_; // thread local latencies
+
+  std::unique_ptr<GeneratorBase> wg_; // workload generator
+
+  // memorize rng to improve random performance
+  folly::ThreadLocalPRNG rng;
+
+  // string used for generating random payloads
+  const std::string hardcodedString_;
+
+  std::unique_ptr<CacheT> cache_;
+
+  // main stressor thread
+  std::thread stressWorker_;
+
+  // mutex to protect reading the timestamps.
+  mutable std::mutex timeMutex_;
+
+  // start time for the stress test
+  std::chrono::time_point<std::chrono::system_clock> startTime_;
+
+  // time when benchmark finished. This is set once the benchmark finishes
+  std::chrono::time_point<std::chrono::system_clock> endTime_;
+
+  // Token bucket used to limit the operations per second.
+  std::unique_ptr<folly::BasicTokenBucket<>> rateLimiter_;
+
+  // Whether flash cache has been warmed up
+  std::atomic<bool> hasNvmCacheWarmedUp_{false};
+};
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -16,15 +16,34 @@
 
 #include "cachelib/cachebench/runner/ProgressTracker.h"
 
+#include <folly/json/dynamic.h>
+#include <folly/json/json.h>
+
+#include <cmath>
+
 namespace facebook {
 namespace cachelib {
 namespace cachebench {
 ProgressTracker::ProgressTracker(const Stressor& s,
-                                 const std::string& detailedStatsFile)
+                                 const std::string& detailedStatsFile,
+                                 const std::string& latencyStatsFile,
+                                 const std::string& nvmWriteStatsFile,
+                                 const std::string& timeSeriesStatsFile)
     : stressor_(s) {
   if (!detailedStatsFile.empty()) {
     statsFile_.open(detailedStatsFile, std::ios::app);
   }
+  if (!latencyStatsFile.empty()) {
+    latencyFile_.open(latencyStatsFile, std::ios::trunc);
+    OpLatencyStats::renderTableHeader(latencyFile_);
+  }
+  if (!nvmWriteStatsFile.empty()) {
+    nvmWriteFile_.open(nvmWriteStatsFile, std::ios::trunc);
+    Stats::renderNvmWritesTableHeader(nvmWriteFile_);
+  }
+  if (!timeSeriesStatsFile.empty()) {
+    timeSeriesFile_.open(timeSeriesStatsFile, std::ios::trunc);
+  }
 }
 
 ProgressTracker::~ProgressTracker() {
@@ -32,6 +51,15 @@ ProgressTracker::~ProgressTracker() {
     if (statsFile_.is_open()) {
       statsFile_.close();
     }
+    if (latencyFile_.is_open()) {
+      latencyFile_.close();
+    }
+    if (nvmWriteFile_.is_open()) {
+      nvmWriteFile_.close();
+    }
+    if (timeSeriesFile_.is_open()) {
+      timeSeriesFile_.close();
+    }
     stop();
   } catch (const std::exception&) {
   }
@@ -79,8 +107,63 @@ void ProgressTracker::work() {
     statsFile_ << std::endl;
   }
 
+  if (nvmWriteFile_.is_open()) {
+    // writes since the last interval, at the seconds since the start of the
+    // test
+    currCacheStats.renderNvmWritesTable(
+        std::to_string(stressor_.getTestDurationNs() / 1000000000),
+        prevStats_, nvmWriteFile_);
+  }
+
+  // latency of the ops since the last interval
+  OpLatencyStats intervalLatency;
+  if (latencyFile_.is_open() || timeSeriesFile_.is_open()) {
+    const auto latency = stressor_.aggregateLatencyStats();
+    intervalLatency = latency;
+    intervalLatency -= prevLatency_;
+    prevLatency_ = latency;
+  }
+
+  if (latencyFile_.is_open()) {
+    // at the seconds since the start of the test
+    intervalLatency.renderTable(
+        std::to_string(stressor_.getTestDurationNs() / 1000000000),
+        latencyFile_);
+  }
+
+  if (timeSeriesFile_.is_open()) {
+    const auto elapsedTimeNs = stressor_.getTestDurationNs();
+    folly::UserCounters counters;
+    currCacheStats.render(counters);
+    throughputStats.render(elapsedTimeNs, counters);
+    intervalLatency.render(counters);
+    stressor_.renderWorkloadGeneratorStats(elapsedTimeNs, counters);
+    renderTimeSeriesRecord(elapsedTimeNs / 1000000000, counters,
+                           currCacheStats.nvmCounters, timeSeriesFile_);
+  }
+
   prevStats_ = currCacheStats;
 }
+
+void ProgressTracker::renderTimeSeriesRecord(
+    uint64_t timeSecs,
+    const folly::UserCounters& counters,
+    const std::unordered_map<std::string, double>& nvmCounters,
+    std::ostream& out) {
+  folly::dynamic record =
+      folly::dynamic::object("time_secs", static_cast<int64_t>(timeSecs));
+  for (const auto& [name, metric] : counters) {
+    record[name] = metric.value;
+  }
+  for (const auto& [name, value] : nvmCounters) {
+    if (std::isfinite(value)) {
+      record[name] = value;
+    }
+  }
+  folly::json::serialization_opts opts;
+  opts.sort_keys = true;
+  out << folly::json::serialize(record, opts) << std::endl;
+}
 } // namespace cachebench
 } // namespace cachelib
 } // namespace facebook
@@ -15,7 +15,9 @@
  */
 
 #pragma once
+#include <ostream>
 #include <string>
+#include <unordered_map>
 
 #include "cachelib/cachebench/runner/Stressor.h"
 #include "cachelib/common/PeriodicWorker.h"
@@ -32,15 +34,49 @@ class ProgressTracker final : public cachelib::PeriodicWorker {
   //                           and cache stats are dumped periodically in
   //                           addition to the stdout. If empty, this is
   //                           disabled.
-  ProgressTracker(const Stressor& s, const std::string& detailedStatsFile);
+  // @param latencyStatsFile   path to a file where the op latency
+  //                           percentiles of every interval are written in
+  //                           a machine readable format. If empty, this is
+  //                           disabled.
+  // @param nvmWriteStatsFile  path to a file where the NVM writes of every
+  //                           interval are written in a machine readable
+  //                           format. If empty, this is disabled.
+  // @param timeSeriesStatsFile  path to a file where the counters of every
+  //                           interval are written as a json object per
+  //                           line. If empty, this is disabled.
+  ProgressTracker(const Stressor& s,
+                  const std::string& detailedStatsFile,
+                  const std::string& latencyStatsFile = "",
+                  const std::string& nvmWriteStatsFile = "",
+                  const std::string& timeSeriesStatsFile = "");
   ~ProgressTracker() override;
 
+  // Write the counters of an interval as a single line json object, with
+  // @timeSecs under "time_secs" and the keys sorted. Counters that are not
+  // finite are left out since json has no representation for them.
+  static void renderTimeSeriesRecord(
+      uint64_t timeSecs,
+      const folly::UserCounters& counters,
+      const std::unordered_map<std::string, double>& nvmCounters,
+      std::ostream& out);
+
  private:
   void work() override;
 
   const Stressor& stressor_; // stressor instance
   std::ofstream statsFile_;  // optional output file stream
   Stats prevStats_; // previous snapshot of cache stats to perform deltas.
+
+  // optional output file stream for the op latencies
+  std::ofstream latencyFile_;
+  // previous snapshot of the op latencies to perform deltas.
+  OpLatencyStats prevLatency_;
+
+  // optional output file stream for the NVM writes
+  std::ofstream nvmWriteFile_;
+
+  // optional output file stream for the counters of every interval
+  std::ofstream timeSeriesFile_;
 };
 } // namespace cachebench
 } // namespace cachelib
@@ -16,6 +16,8 @@
 
 #include "cachelib/cachebench/runner/Runner.h"
 
+#include <fstream>
+
 #include "cachelib/cachebench/runner/Stressor.h"
 
 namespace facebook {
@@ -23,11 +25,16 @@ namespace cachelib {
 namespace cachebench {
 Runner::Runner(const CacheBenchConfig& config)
     : stressor_{Stressor::makeStressor(config.getCacheConfig(),
-                                       config.getStressorConfig())} {}
+                                       config.getStressorConfig())},
+      latencyStatsFile_{config.getStressorConfig().latencyStatsFile},
+      nvmWriteStatsFile_{config.getStressorConfig().nvmWriteStatsFile},
+      timeSeriesStatsFile_{config.getStressorConfig().timeSeriesStatsFile} {}
 
 bool Runner::run(std::chrono::seconds progressInterval,
-                 const std::string& progressStatsFile) {
-  ProgressTracker tracker{*stressor_, progressStatsFile};
+                 const std::string& progressStatsFile,
+                 folly::UserCounters* counters) {
+  ProgressTracker tracker{*stressor_, progressStatsFile, latencyStatsFile_,
+                          nvmWriteStatsFile_, timeSeriesStatsFile_};
 
   stressor_->start();
 
@@ -40,6 +47,7 @@ bool Runner::run(std::chrono::seconds progressInterval,
   uint64_t durationNs = stressor_->getTestDurationNs();
   auto cacheStats = stressor_->getCacheStats();
   auto opsStats = stressor_->aggregateThroughputStats();
+  auto latencyStats = stressor_->aggregateLatencyStats();
   tracker.stop();
 
   std::cout << "== Test Results ==\n== Allocator Stats ==" << std::endl;
@@ -48,9 +56,26 @@ bool Runner::run(std::chrono::seconds progressInterval,
   std::cout << "\n== Throughput for  ==\n";
   opsStats.render(durationNs, std::cout);
 
+  if (!latencyStatsFile_.empty()) {
+    std::cout << "\n== Op Latency ==\n";
+    latencyStats.render(std::cout);
+
+    std::ofstream latencyFile(latencyStatsFile_, std::ios::app);
+    latencyStats.renderTable("total", latencyFile);
+  }
+
+  if (!nvmWriteStatsFile_.empty()) {
+    std::ofstream nvmWriteFile(nvmWriteStatsFile_, std::ios::app);
+    cacheStats.renderNvmWritesTable("total", Stats{}, nvmWriteFile);
+  }
+
   stressor_->renderWorkloadGeneratorStats(durationNs, std::cout);
   std::cout << std::endl;
 
+  if (counters) {
+    renderCounters(durationNs, cacheStats, opsStats, latencyStats, *counters);
+  }
+
   stressor_.reset();
 
   bool passed = cacheStats.renderIsTestPassed(std::cout);
@@ -69,17 +94,9 @@ bool Runner::run(folly::UserCounters& counters) {
     uint64_t durationNs = stressor_->getTestDurationNs();
     auto cacheStats = stressor_->getCacheStats();
     auto opsStats = stressor_->aggregateThroughputStats();
+    auto latencyStats = stressor_->aggregateLatencyStats();
 
-    // Allocator Stats
-    cacheStats.render(counters);
-
-    // Throughput
-    opsStats.render(durationNs, counters);
-
-    stressor_->renderWorkloadGeneratorStats(durationNs, counters);
-
-    counters["nvm_disable"] = cacheStats.isNvmCacheDisabled ? 100 : 0;
-    counters["inconsistency_count"] = cacheStats.inconsistencyCount * 100;
+    renderCounters(durationNs, cacheStats, opsStats, latencyStats, counters);
 
     stressor_.reset();
   }
@@ -91,6 +108,26 @@ bool Runner::run(folly::UserCounters& counters) {
   return true;
 }
 
+void Runner::renderCounters(uint64_t durationNs,
+                            Stats& cacheStats,
+                            const ThroughputStats& opsStats,
+                            const OpLatencyStats& latencyStats,
+                            folly::UserCounters& counters) const {
+  // Allocator Stats
+  cacheStats.render(counters);
+
+  // Throughput
+  opsStats.render(durationNs, counters);
+
+  // Latency, if recorded
+  latencyStats.render(counters);
+
+  stressor_->renderWorkloadGeneratorStats(durationNs, counters);
+
+  counters["nvm_disable"] = cacheStats.isNvmCacheDisabled ? 100 : 0;
+  counters["inconsistency_count"] = cacheStats.inconsistencyCount * 100;
+}
+
 } // namespace cachebench
 } // namespace cachelib
 } // namespace facebook
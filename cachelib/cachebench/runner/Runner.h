@@ -41,9 +41,12 @@ class Runner {
   //                            benchmark run is reported/tracked.
   // @param progressStatsFile   the file to log periodic stats and progress
   //                            to in addition to stdtout. Ignored if empty
+  // @param counters            if set, receives the metrics of the run as
+  //                            the folly::Benchmark run below does
   // @return true if the run was successful, false if there is a failure.
   bool run(std::chrono::seconds progressInterval,
-           const std::string& progressStatsFile);
+           const std::string& progressStatsFile,
+           folly::UserCounters* counters = nullptr);
 
   // for testings using folly::Benchmark
   // in addition to running time, cachebench has several metrics
@@ -59,9 +62,24 @@ class Runner {
   }
 
  private:
+  void renderCounters(uint64_t durationNs,
+                      Stats& cacheStats,
+                      const ThroughputStats& opsStats,
+                      const OpLatencyStats& latencyStats,
+                      folly::UserCounters& counters) const;
+
   // instance of the stressor.
   std::unique_ptr<Stressor> stressor_;
 
+  // file for the op latencies, empty if they are not recorded.
+  const std::string latencyStatsFile_;
+
+  // file for the NVM writes, empty if they are not written.
+  const std::string nvmWriteStatsFile_;
+
+  // file for the counters of every interval, empty if they are not written.
+  const std::string timeSeriesStatsFile_;
+
   bool aborted_{false};
 };
 } // namespace cachebench
@@ -16,14 +16,19 @@
 
 #include "cachelib/cachebench/runner/Stressor.h"
 
+#include <algorithm>
+#include <array>
+
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/cachebench/runner/AsyncCacheStressor.h"
 #include "cachelib/cachebench/runner/CacheStressor.h"
 #include "cachelib/cachebench/runner/FastShutdown.h"
+#include "cachelib/cachebench/runner/FiberCacheStressor.h"
 #include "cachelib/cachebench/runner/IntegrationStressor.h"
 #include "cachelib/cachebench/workload/BinaryKVReplayGenerator.h"
 #include "cachelib/cachebench/workload/BlockChunkReplayGenerator.h"
 #include "cachelib/cachebench/workload/KVReplayGenerator.h"
+#include "cachelib/cachebench/workload/MultiTenantGenerator.h"
 #include "cachelib/cachebench/workload/OnlineGenerator.h"
 #include "cachelib/cachebench/workload/PieceWiseReplayGenerator.h"
 #include "cachelib/cachebench/workload/WorkloadGenerator.h"
@@ -138,9 +143,118 @@ void ThroughputStats::render(uint64_t elapsedTimeNs,
       util::narrow_cast<uint64_t>(addChainedSuccessRate);
 }
 
+void OpLatencyStats::record(OpType op,
+                            std::chrono::nanoseconds latency) noexcept {
+  const auto ns = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+  switch (op) {
+  case OpType::kGet:
+  case OpType::kLoneGet:
+  case OpType::kCouldExist:
+    get.record(ns);
+    break;
+  case OpType::kDel:
+    del.record(ns);
+    break;
+  default:
+    set.record(ns);
+    break;
+  }
+}
+
+OpLatencyStats& OpLatencyStats::operator+=(const OpLatencyStats& other) {
+  get += other.get;
+  set += other.set;
+  del += other.del;
+  return *this;
+}
+
+OpLatencyStats& OpLatencyStats::operator-=(const OpLatencyStats& other) {
+  get -= other.get;
+  set -= other.set;
+  del -= other.del;
+  return *this;
+}
+
+namespace {
+constexpr std::array<std::pair<folly::StringPiece, double>, 8>
+    kLatencyPercentiles{{{"p50", 50},
+                         {"p90", 90},
+                         {"p99", 99},
+                         {"p999", 99.9},
+                         {"p9999", 99.99},
+                         {"p99999", 99.999},
+                         {"p999999", 99.9999},
+                         {"p100", 100}}};
+} // namespace
+
+void OpLatencyStats::render(std::ostream& out) const {
+  auto printLatencies = [&out](folly::StringPiece cat,
+                               const LatencyHistogram& latency) {
+    if (latency.getCount() == 0) {
+      return;
+    }
+    for (const auto& [pct, percentile] : kLatencyPercentiles) {
+      out << folly::sformat("{:20} {:8} : {:>10.2f} us\n", cat, pct,
+                            latency.getValueAtPercentile(percentile) / 1000.0);
+    }
+  };
+  printLatencies("Get Latency", get);
+  printLatencies("Set Latency", set);
+  printLatencies("Del Latency", del);
+}
+
+void OpLatencyStats::render(folly::UserCounters& counters) const {
+  auto renderLatencies = [&counters](folly::StringPiece op,
+                                     const LatencyHistogram& latency) {
+    if (latency.getCount() == 0) {
+      return;
+    }
+    for (const auto& [pct, percentile] : kLatencyPercentiles) {
+      if (percentile <= 99.9) {
+        counters[folly::sformat("{}_latency_{}_ns", op, pct)] =
+            static_cast<int64_t>(latency.getValueAtPercentile(percentile));
+      }
+    }
+  };
+  renderLatencies("get", get);
+  renderLatencies("set", set);
+  renderLatencies("del", del);
+}
+
+void OpLatencyStats::renderTableHeader(std::ostream& out) {
+  out << "time op count";
+  for (const auto& [pct, percentile] : kLatencyPercentiles) {
+    out << " " << pct << "us";
+  }
+  out << std::endl;
+}
+
+void OpLatencyStats::renderTable(folly::StringPiece time,
+                                 std::ostream& out) const {
+  auto printRow = [&](folly::StringPiece op, const LatencyHistogram& latency) {
+    out << time << " " << op << " " << latency.getCount();
+    for (const auto& [pct, percentile] : kLatencyPercentiles) {
+      out << folly::sformat(" {:.2f}",
+                            latency.getValueAtPercentile(percentile) / 1000.0);
+    }
+    out << "\n";
+  };
+  printRow("get", get);
+  printRow("set", set);
+  printRow("del", del);
+  out << std::flush;
+}
+
 namespace {
 std::unique_ptr<GeneratorBase> makeGenerator(const StressorConfig& config) {
-  if (config.generator == "piecewise-replay") {
+  if (!config.tenants.empty()) {
+    std::vector<std::unique_ptr<GeneratorBase>> generators;
+    for (const auto& tenantConfig : config.tenants) {
+      generators.push_back(makeGenerator(tenantConfig));
+    }
+    return std::make_unique<MultiTenantGenerator>(config,
+                                                  std::move(generators));
+  } else if (config.generator == "piecewise-replay") {
     return std::make_unique<PieceWiseReplayGenerator>(config);
   } else if (config.generator == "replay") {
     return std::make_unique<KVReplayGenerator>(config);
@@ -160,6 +274,40 @@ std::unique_ptr<GeneratorBase> makeGenerator(const StressorConfig& config) {
         "Invalid config: unsupported generator {}", config.generator));
   }
 }
+
+// Creates a stressor running the allocator named in the config. Caches that
+// need 5 byte compressed pointers get the 5 byte variant of the allocator.
+template <template <typename> class StressorT>
+std::unique_ptr<Stressor> makeCacheStressor(
+    const CacheConfig& cacheConfig,
+    const StressorConfig& stressorConfig,
+    std::unique_ptr<GeneratorBase> generator) {
+  const bool use5BPtr = cacheConfig.getCompressedPtrBytes() == 5;
+  if (cacheConfig.allocator == "LRU") {
+    // default allocator is LRU, other allocator types should be added here
+    if (use5BPtr) {
+      return std::make_unique<StressorT<Lru5BAllocator>>(
+          cacheConfig, stressorConfig, std::move(generator));
+    }
+    return std::make_unique<StressorT<LruAllocator>>(
+        cacheConfig, stressorConfig, std::move(generator));
+  } else if (cacheConfig.allocator == "LRU2Q") {
+    if (use5BPtr) {
+      return std::make_unique<StressorT<Lru5B2QAllocator>>(
+          cacheConfig, stressorConfig, std::move(generator));
+    }
+    return std::make_unique<StressorT<Lru2QAllocator>>(
+        cacheConfig, stressorConfig, std::move(generator));
+  } else if (cacheConfig.allocator == "SIEVE") {
+    if (use5BPtr) {
+      return std::make_unique<StressorT<Sieve5BAllocator>>(
+          cacheConfig, stressorConfig, std::move(generator));
+    }
+    return std::make_unique<StressorT<SieveAllocator>>(
+        cacheConfig, stressorConfig, std::move(generator));
+  }
+  throw std::invalid_argument("Invalid config");
+}
 } // namespace
 
 std::unique_ptr<Stressor> Stressor::makeStressor(
@@ -187,26 +335,25 @@ std::unique_ptr<Stressor> Stressor::makeStressor(
     }
 
     auto generator = makeGenerator(stressorConfig);
-    if (cacheConfig.allocator == "LRU") {
-      // default allocator is LRU, other allocator types should be added here
-      return std::make_unique<AsyncCacheStressor<LruAllocator>>(
-          cacheConfig, stressorConfig, std::move(generator));
-    } else if (cacheConfig.allocator == "LRU2Q") {
-      return std::make_unique<AsyncCacheStressor<Lru2QAllocator>>(
-          cacheConfig, stressorConfig, std::move(generator));
+    return makeCacheStressor<AsyncCacheStressor>(cacheConfig, stressorConfig,
+                                                 std::move(generator));
+  } else if (stressorConfig.name == "fiber") {
+    if (stressorConfig.generator != "workload" &&
+        !stressorConfig.generator.empty()) {
+      throw std::invalid_argument(folly::sformat(
+          "Fiber cache stressor only works with workload generator currently. "
+          "generator: {}",
+          stressorConfig.generator));
     }
+
+    auto generator = makeGenerator(stressorConfig);
+    return makeCacheStressor<FiberCacheStressor>(cacheConfig, stressorConfig,
+                                                 std::move(generator));
   } else {
     auto generator = makeGenerator(stressorConfig);
-    if (cacheConfig.allocator == "LRU") {
-      // default allocator is LRU, other allocator types should be added here
-      return std::make_unique<CacheStressor<LruAllocator>>(
-          cacheConfig, stressorConfig, std::move(generator));
-    } else if (cacheConfig.allocator == "LRU2Q") {
-      return std::make_unique<CacheStressor<Lru2QAllocator>>(
-          cacheConfig, stressorConfig, std::move(generator));
-    }
+    return makeCacheStressor<CacheStressor>(cacheConfig, stressorConfig,
+                                            std::move(generator));
   }
-  throw std::invalid_argument("Invalid config");
 }
 } // namespace cachebench
 } // namespace cachelib
@@ -19,10 +19,13 @@
 #include <folly/Benchmark.h>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 
 #include "cachelib/cachebench/cache/Cache.h"
 #include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/util/LatencyHistogram.h"
+#include "cachelib/cachebench/util/Request.h"
 
 namespace facebook {
 namespace cachelib {
@@ -57,6 +60,34 @@ struct ThroughputStats {
   void render(uint64_t, folly::UserCounters&) const;
 };
 
+// Latency histograms of the ops of the stress run in nanoseconds, recorded
+// when StressorConfig::latencyStatsFile is set. Every stressor thread records
+// into its own instance, which is aggregated by copy while the run goes on.
+struct OpLatencyStats {
+  LatencyHistogram get; // gets and couldExist
+  LatencyHistogram set; // sets, updates and chained item adds
+  LatencyHistogram del;
+
+  void record(OpType op, std::chrono::nanoseconds latency) noexcept;
+
+  OpLatencyStats& operator+=(const OpLatencyStats& other);
+
+  // @param other   an earlier snapshot, to get the latency since then
+  OpLatencyStats& operator-=(const OpLatencyStats& other);
+
+  // convenience method to print the latency percentiles to stdout.
+  void render(std::ostream& out) const;
+
+  // the latencies up to p999 in nanoseconds of the ops that ran
+  void render(folly::UserCounters& counters) const;
+
+  // Machine readable format: a header line, then a line per op with the
+  // number of ops and the latency percentiles in microseconds, as columns
+  // separated by spaces. @time tells the lines of different intervals apart.
+  static void renderTableHeader(std::ostream& out);
+  void renderTable(folly::StringPiece time, std::ostream& out) const;
+};
+
 // forward declaration for the workload generator.
 class GeneratorBase;
 
@@ -77,6 +108,10 @@ class Stressor {
   // aggregate the throughput related stats at any given point in time.
   virtual ThroughputStats aggregateThroughputStats() const = 0;
 
+  // aggregate the op latency histograms at any given point in time. Empty
+  // for stressors that do not record them.
+  virtual OpLatencyStats aggregateLatencyStats() const { return {}; }
+
   // ouputs workload generator specific stats to either an output stream or to
   // an output counter map
   virtual void renderWorkloadGeneratorStats(uint64_t /*elapsedTimeNs*/,
@@ -27,6 +27,7 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, allocator);
   JSONSetVal(configJson, cacheDir);
   JSONSetVal(configJson, cacheSizeMB);
+  JSONSetVal(configJson, compressedPtrBytes);
   JSONSetVal(configJson, poolRebalanceIntervalSec);
   JSONSetVal(configJson, moveOnSlabRelease);
   JSONSetVal(configJson, rebalanceStrategy);
@@ -35,18 +36,30 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
 
   JSONSetVal(configJson, htBucketPower);
   JSONSetVal(configJson, htLockPower);
+  JSONSetVal(configJson, htNumInterleavedLookups);
+  JSONSetVal(configJson, htOptimisticReads);
+  JSONSetVal(configJson, htLazyBucketInit);
 
   JSONSetVal(configJson, lruRefreshSec);
   JSONSetVal(configJson, lruRefreshRatio);
   JSONSetVal(configJson, mmReconfigureIntervalSecs);
+  JSONSetVal(configJson, mmContainerShards);
+  JSONSetVal(configJson, evictionBatchSize);
+  JSONSetVal(configJson, allocMagazineSize);
+  JSONSetVal(configJson, hotKeyReplication);
+  JSONSetVal(configJson, stripedRefcounts);
+  JSONSetVal(configJson, coarseClock);
   JSONSetVal(configJson, lruUpdateOnWrite);
   JSONSetVal(configJson, lruUpdateOnRead);
   JSONSetVal(configJson, tryLockUpdate);
   JSONSetVal(configJson, lruIpSpec);
+  JSONSetVal(configJson, lruPromotionBufferSize);
+  JSONSetVal(configJson, lruEvictionSampleSize);
   JSONSetVal(configJson, useCombinedLockForIterators);
 
   JSONSetVal(configJson, lru2qHotPct);
   JSONSetVal(configJson, lru2qColdPct);
+  JSONSetVal(configJson, lru2qHotClockHits);
 
   JSONSetVal(configJson, allocFactor);
   JSONSetVal(configJson, maxAllocSize);
@@ -72,6 +85,12 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, navyParcelMemoryMB);
   JSONSetVal(configJson, navyHitsReinsertionThreshold);
   JSONSetVal(configJson, navyProbabilityReinsertionThreshold);
+  JSONSetVal(configJson, navyMemoryDeviceReadLatencyUs);
+  JSONSetVal(configJson, navyMemoryDeviceWriteLatencyUs);
+  JSONSetVal(configJson, navyMemoryDeviceReadMBps);
+  JSONSetVal(configJson, navyMemoryDeviceWriteMBps);
+  JSONSetVal(configJson, navyMemoryDeviceQueueDepth);
+  JSONSetVal(configJson, navySizeAdvisorSampleRate);
   JSONSetVal(configJson, navyReaderThreads);
   JSONSetVal(configJson, navyWriterThreads);
   JSONSetVal(configJson, navyMaxNumReads);
@@ -94,12 +113,17 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
 
   JSONSetVal(configJson, usePosixShm);
   JSONSetVal(configJson, lockMemory);
+  JSONSetVal(configJson, memoryPageSizeFallback);
+  JSONSetVal(configJson, parallelShutdown);
+  JSONSetVal(configJson, memoryPageSizeMB);
   if (configJson.count("memoryTiers")) {
     for (auto& it : configJson["memoryTiers"]) {
       memoryTierConfigs.push_back(
           MemoryTierConfig(it).getMemoryTierCacheConfig());
     }
   }
+  JSONSetVal(configJson, memoryTierPromotionIntervalMs);
+  JSONSetVal(configJson, memoryTierPromotionMinHits);
 
   JSONSetVal(configJson, useTraceTimeStamp);
   JSONSetVal(configJson, printNvmCounters);
@@ -112,7 +136,7 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
   // if you added new fields to the configuration, update the JSONSetVal
   // to make them available for the json configs and increment the size
   // below
-  checkCorrectSize<CacheConfig, 760>();
+  checkCorrectSize<CacheConfig, 1000>();
 
   if (numPools != poolSizes.size()) {
     throw std::invalid_argument(folly::sformat(
@@ -120,6 +144,13 @@ CacheConfig::CacheConfig(const folly::dynamic& configJson) {
         "numPools: {}, poolSizes.size(): {}",
         numPools, poolSizes.size()));
   }
+
+  if (compressedPtrBytes != 0 && compressedPtrBytes != 4 &&
+      compressedPtrBytes != 5) {
+    throw std::invalid_argument(folly::sformat(
+        "compressedPtrBytes must be 0, 4 or 5. compressedPtrBytes: {}",
+        compressedPtrBytes));
+  }
 }
 
 std::shared_ptr<RebalanceStrategy> CacheConfig::getRebalanceStrategy() const {
@@ -142,6 +173,20 @@ std::shared_ptr<RebalanceStrategy> CacheConfig::getRebalanceStrategy() const {
   }
 }
 
+size_t CacheConfig::getCompressedPtrBytes() const {
+  if (compressedPtrBytes != 0) {
+    return compressedPtrBytes;
+  }
+  const size_t bytes =
+      getMinCompressedPtrBytes(cacheSizeMB * 1024ULL * 1024ULL);
+  if (bytes == 0) {
+    throw std::invalid_argument(folly::sformat(
+        "no compressed pointer can address the cache. cacheSizeMB: {}",
+        cacheSizeMB));
+  }
+  return bytes;
+}
+
 MemoryTierConfig::MemoryTierConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, ratio);
   JSONSetVal(configJson, memBindNodes);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <any>
+#include <unordered_map>
 
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/allocator/RebalanceStrategy.h"
@@ -39,6 +40,20 @@ class CacheMonitorFactory {
   virtual ~CacheMonitorFactory() = default;
   virtual std::unique_ptr<CacheMonitor> create(LruAllocator& cache) = 0;
   virtual std::unique_ptr<CacheMonitor> create(Lru2QAllocator& cache) = 0;
+  virtual std::unique_ptr<CacheMonitor> create(SieveAllocator& /* cache */) {
+    return nullptr;
+  }
+  virtual std::unique_ptr<CacheMonitor> create(Lru5BAllocator& /* cache */) {
+    return nullptr;
+  }
+  virtual std::unique_ptr<CacheMonitor> create(
+      Lru5B2QAllocator& /* cache */) {
+    return nullptr;
+  }
+  virtual std::unique_ptr<CacheMonitor> create(
+      Sieve5BAllocator& /* cache */) {
+    return nullptr;
+  }
 };
 
 // Parse memory tiers configuration from JSON config
@@ -62,7 +77,7 @@ struct MemoryTierConfig : public JSONConfig {
 };
 
 struct CacheConfig : public JSONConfig {
-  // by defaullt, lru allocator. can be set to LRU-2Q.
+  // by defaullt, lru allocator. can be set to LRU2Q or SIEVE.
   std::string allocator{"LRU"};
 
   // if set, we will persist the cache across cachebench runs. The directory
@@ -70,6 +85,10 @@ struct CacheConfig : public JSONConfig {
   std::string cacheDir{""};
 
   uint64_t cacheSizeMB{0};
+  // size in bytes of the compressed pointers in items, 4 or 5. 0 picks the
+  // smallest one that can address cacheSizeMB. 5 byte pointers are needed
+  // for caches larger than 256 GB.
+  uint64_t compressedPtrBytes{0};
   uint64_t poolRebalanceIntervalSec{0};
   std::string rebalanceStrategy;
   uint64_t rebalanceMinSlabs{1};
@@ -78,6 +97,12 @@ struct CacheConfig : public JSONConfig {
 
   uint64_t htBucketPower{22}; // buckets in hash table
   uint64_t htLockPower{20};   // locks in hash table
+  // lookups interleaved by batched finds in the hash table. 0 disables it.
+  uint64_t htNumInterleavedLookups{0};
+  // lock-free, version validated reads in the hash table
+  bool htOptimisticReads{false};
+  // initialize hash table buckets on demand instead of at start up
+  bool htLazyBucketInit{false};
 
   // Hash table config for chained items
   uint64_t chainedItemHtBucketPower{22};
@@ -86,6 +111,29 @@ struct CacheConfig : public JSONConfig {
   // time to sleep between MMContainer reconfigures
   uint64_t mmReconfigureIntervalSecs{0};
 
+  // number of MMContainer shards per allocation class. Must be a power of two.
+  uint64_t mmContainerShards{1};
+
+  // number of items evicted per eviction pass when an allocation class is
+  // full. Allocations evicted beyond the first are kept for later allocations.
+  uint64_t evictionBatchSize{1};
+
+  // number of free allocations cached per thread and allocation class. 0
+  // disables the per-thread caches.
+  uint64_t allocMagazineSize{0};
+
+  // serve the lookups of very hot keys from per cpu copies of their items.
+  // Can not be combined with moveOnSlabRelease or item destructors.
+  bool hotKeyReplication{false};
+
+  // count the handles to very hot items on per cpu stripes instead of their
+  // refcount. Can not be combined with hotKeyReplication.
+  bool stripedRefcounts{false};
+
+  // keep the clock of the items in a background thread instead of reading
+  // it on every access. Run with and without to compare.
+  bool coarseClock{false};
+
   // LRU and 2Q params
   uint64_t lruRefreshSec{60};
   double lruRefreshRatio{0.1};
@@ -97,10 +145,24 @@ struct CacheConfig : public JSONConfig {
   // LRU param
   uint64_t lruIpSpec{0};
 
+  // number of promotions buffered per thread before being applied to the
+  // lru in a batch. 0 disables buffering.
+  uint64_t lruPromotionBufferSize{0};
+
+  // number of items at the tail of the lru compared by every eviction in the
+  // sampled eviction mode, where accesses never reorder the lru. 0 disables
+  // it.
+  uint64_t lruEvictionSampleSize{0};
+
   // 2Q params
   size_t lru2qHotPct{20};
   size_t lru2qColdPct{20};
 
+  // hits on items in the hot queue only mark them accessed instead of
+  // taking the lru lock. Warm and cold promotions are buffered per thread
+  // according to lruPromotionBufferSize.
+  bool lru2qHotClockHits{false};
+
   double allocFactor{1.5};
   // maximum alloc size generated using the alloc factor above.
   size_t maxAllocSize{1024 * 1024};
@@ -178,6 +240,21 @@ struct CacheConfig : public JSONConfig {
   // use a probability based reinsertion policy with navy
   uint64_t navyProbabilityReinsertionThreshold{0};
 
+  // Performance the memory file emulates when no nvmCachePaths are set, to
+  // predict the behavior of navy on a device that is not at hand. Latencies
+  // are in microseconds by percentile, such as {"50": 80, "99": 400}, and
+  // bandwidths in MB/s. 0 or empty for no limit.
+  std::unordered_map<std::string, uint32_t> navyMemoryDeviceReadLatencyUs{};
+  std::unordered_map<std::string, uint32_t> navyMemoryDeviceWriteLatencyUs{};
+  uint32_t navyMemoryDeviceReadMBps{0};
+  uint32_t navyMemoryDeviceWriteMBps{0};
+  // number of IOs the emulated device serves at a time
+  uint64_t navyMemoryDeviceQueueDepth{0};
+
+  // 1 in this many navy inserts is sampled to recommend the layout of the
+  // engines. 0 disables it.
+  uint64_t navySizeAdvisorSampleRate{0};
+
   // number of asynchronous worker thread for navy read operation.
   uint32_t navyReaderThreads{32};
 
@@ -240,9 +317,26 @@ struct CacheConfig : public JSONConfig {
   // Lock memory in the RAM
   bool lockMemory{false};
 
+  // Use regular pages if the huge pages for the cache memory can not be
+  // obtained
+  bool memoryPageSizeFallback{true};
+
+  // Stop the background workers and save the nvmcache concurrently on shut
+  // down
+  bool parallelShutdown{false};
+
+  // Size in MB of the huge pages backing the cache memory, 2 or 1024. 0 uses
+  // regular pages.
+  uint64_t memoryPageSizeMB{0};
+
   // Memory tiers configs
   std::vector<MemoryTierCacheConfig> memoryTierConfigs{};
 
+  // With two memory tiers, interval of the background promoter and the
+  // number of hits in the lower tier after which an item is promoted.
+  uint64_t memoryTierPromotionIntervalMs{10};
+  uint32_t memoryTierPromotionMinHits{2};
+
   // If enabled, we will use the timestamps from the trace file in the ticker
   // so that the cachebench will observe time based on timestamps from the trace
   // instead of the system time.
@@ -306,6 +400,10 @@ struct CacheConfig : public JSONConfig {
   CacheConfig() {}
 
   std::shared_ptr<RebalanceStrategy> getRebalanceStrategy() const;
+
+  // compressed pointer size to run the cache with, compressedPtrBytes or the
+  // smallest one that can address the cache when it is 0.
+  size_t getCompressedPtrBytes() const;
 };
 } // namespace cachebench
 } // namespace cachelib
@@ -36,10 +36,12 @@ StressorConfig::StressorConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, samplingIntervalMs);
 
   JSONSetVal(configJson, checkConsistency);
+  JSONSetVal(configJson, consistencySampleRate);
   JSONSetVal(configJson, touchValue);
 
   JSONSetVal(configJson, numOps);
   JSONSetVal(configJson, numThreads);
+  JSONSetVal(configJson, fibersPerThread);
   JSONSetVal(configJson, numKeys);
 
   JSONSetVal(configJson, opDelayBatch);
@@ -47,6 +49,10 @@ StressorConfig::StressorConfig(const folly::dynamic& configJson) {
 
   JSONSetVal(configJson, opRatePerSec);
   JSONSetVal(configJson, opRateBurstSize);
+  JSONSetVal(configJson, replaySpeed);
+  JSONSetVal(configJson, latencyStatsFile);
+  JSONSetVal(configJson, nvmWriteStatsFile);
+  JSONSetVal(configJson, timeSeriesStatsFile);
 
   JSONSetVal(configJson, opPoolDistribution);
   JSONSetVal(configJson, keyPoolDistribution);
@@ -69,6 +75,20 @@ StressorConfig::StressorConfig(const folly::dynamic& configJson) {
 
   JSONSetVal(configJson, useCombinedLockForIterators);
 
+  JSONSetVal(configJson, tenantPoolId);
+  if (configJson.count("tenants")) {
+    for (const auto& it : configJson["tenants"]) {
+      auto tenantJson = it;
+      if (!tenantJson.count("configPath")) {
+        tenantJson["configPath"] = configPath;
+      }
+      if (!tenantJson.count("numOps")) {
+        tenantJson["numOps"] = static_cast<int64_t>(numOps);
+      }
+      tenants.emplace_back(tenantJson);
+    }
+  }
+
   if (configJson.count("poolDistributions")) {
     for (auto& it : configJson["poolDistributions"]) {
       poolDistributions.emplace_back(it, configPath);
@@ -87,10 +107,41 @@ StressorConfig::StressorConfig(const folly::dynamic& configJson) {
         folly::sformat("set only one of traceFileName or traceFileNames"));
   }
 
+  if (!tenants.empty()) {
+    uint64_t tenantThreads = 0;
+    for (const auto& tenant : tenants) {
+      if (tenant.numThreads == 0 || !tenant.tenants.empty()) {
+        throw std::invalid_argument(folly::sformat(
+            "tenant {} needs numThreads and can not have tenants",
+            tenant.name));
+      }
+      tenantThreads += tenant.numThreads;
+    }
+    if (numThreads == 0) {
+      numThreads = tenantThreads;
+    }
+    if (numThreads != tenantThreads) {
+      throw std::invalid_argument(
+          folly::sformat("tenants run on {} threads, numThreads is {}",
+                         tenantThreads, numThreads));
+    }
+    if (checkConsistency) {
+      throw std::invalid_argument(
+          "consistency checking is not supported with tenants");
+    }
+  }
+
+  if (replaySpeed < 0 || (replaySpeed > 0 && opRatePerSec > 0)) {
+    throw std::invalid_argument(folly::sformat(
+        "invalid replaySpeed {}; it can not be negative or combined with "
+        "opRatePerSec",
+        replaySpeed));
+  }
+
   // If you added new fields to the configuration, update the JSONSetVal
   // to make them available for the json configs and increment the size
   // below
-  checkCorrectSize<StressorConfig, 560>();
+  checkCorrectSize<StressorConfig, 744>();
 }
 
 bool StressorConfig::usesChainedItems() const {
@@ -201,6 +252,7 @@ ReplayGeneratorConfig::ReplayGeneratorConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, ampFactor);
   JSONSetVal(configJson, ampSizeFactor);
   JSONSetVal(configJson, binaryFileName);
+  JSONSetVal(configJson, columnarFileName);
   JSONSetVal(configJson, fastForwardCount);
   JSONSetVal(configJson, preLoadReqs);
   JSONSetVal(configJson, replaySerializationMode);
@@ -209,6 +261,8 @@ ReplayGeneratorConfig::ReplayGeneratorConfig(const folly::dynamic& configJson) {
   JSONSetVal(configJson, numExtraFields);
   JSONSetVal(configJson, blockSizeKB);
   JSONSetVal(configJson, chunkSizeKB);
+  JSONSetVal(configJson, lbaShardSizeKB);
+  JSONSetVal(configJson, numParserThreads);
   JSONSetVal(configJson, statsPerAggField);
 
   if (configJson.count("mlAdmissionConfig")) {
@@ -223,7 +277,7 @@ ReplayGeneratorConfig::ReplayGeneratorConfig(const folly::dynamic& configJson) {
         "Unsupported request serialization mode: {}", replaySerializationMode));
   }
 
-  checkCorrectSize<ReplayGeneratorConfig, 184>();
+  checkCorrectSize<ReplayGeneratorConfig, 224>();
 }
 
 ReplayGeneratorConfig::SerializeMode
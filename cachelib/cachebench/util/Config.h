@@ -134,6 +134,11 @@ struct ReplayGeneratorConfig : public JSONConfig {
   // the path of the binary file to make
   std::string binaryFileName{};
 
+  // the path of the columnar trace to convert the trace to. See
+  // ColumnarTrace.h. The replay generators recognize columnar traces as
+  // such and decode their blocks in parallel.
+  std::string columnarFileName{};
+
   // The number of requests (not including ampFactor) to skip
   // in the trace. This is so that after warming up the cache
   // with a certain number of requests, we can easily reattach
@@ -161,6 +166,19 @@ struct ReplayGeneratorConfig : public JSONConfig {
   // Used only for BlockChunkReplayGenerator; default 128KB
   uint32_t chunkSizeKB{128};
 
+  // Used only for BlockChunkReplayGenerator. If non-zero, requests are
+  // sharded across the stressor threads by ranges of this many KB of a block
+  // instead of by block, so the IOs to different parts of a hot block are
+  // replayed in parallel. Requests are split at the range boundaries. Must be
+  // a multiple of chunkSizeKB, so the IOs to a chunk are still replayed in
+  // order by a single thread.
+  uint32_t lbaShardSizeKB{0};
+
+  // Used only for KVReplayGenerator. If non-zero, the trace files are memory
+  // mapped and parsed by this many threads instead of being read line by line
+  // by a single one. Requests for the same key are still replayed in order.
+  uint32_t numParserThreads{0};
+
   // For each aggregation field, we track the statistics broken down by
   // specific aggregation values. this map specifies the values for which
   // stats are aggregated by per field.
@@ -225,6 +243,12 @@ struct StressorConfig : public JSONConfig {
   // If enabled, stressor will verify operations' results are consistent.
   bool checkConsistency{false};
 
+  // If non zero, consistency checking only tracks the keys whose hash is a
+  // multiple of this. Their operations are logged per thread without locks
+  // and checked once the stress run is done, so the run keeps most of the
+  // throughput and concurrency of a run without consistency checking.
+  uint32_t consistencySampleRate{0};
+
   // If enabled, stressor will check whether nvm cache has been warmed up and
   // output stats after warmup.
   bool checkNvmCacheWarmUp{false};
@@ -235,6 +259,10 @@ struct StressorConfig : public JSONConfig {
 
   uint64_t numOps{0};     // operation per thread
   uint64_t numThreads{0}; // number of threads that will run
+
+  // Requests each thread of the "fiber" stressor keeps in flight, each on a
+  // fiber of its own.
+  uint64_t fibersPerThread{16};
   uint64_t numKeys{0};    // number of keys that will be used
 
   // Req generation throttling delay for each thread; those generated reqs are
@@ -247,6 +275,30 @@ struct StressorConfig : public JSONConfig {
   uint64_t opRatePerSec{0};
   uint64_t opRateBurstSize{0};
 
+  // Open-loop replay: when positive, every request is issued at its trace
+  // timestamp relative to the first request, with the trace time divided by
+  // this factor (2 replays twice as fast). The latency of an op is measured
+  // from when it should have been issued, so that an op delayed behind a slow
+  // one counts its queueing delay. 0 issues the ops back to back. Needs a
+  // generator with timestamps and excludes opRatePerSec.
+  double replaySpeed{0};
+
+  // If set, the latency of every op is recorded into histograms. The
+  // latency percentiles of each progress interval and of the whole run are
+  // written to this file, see vizualize/extract_latency.sh.
+  std::string latencyStatsFile{};
+
+  // If set, the NVM writes of each progress interval and of the whole run
+  // are written to this file: host and NAND writes of the devices in
+  // writeAmpDeviceList, the write amplification of the devices and of navy,
+  // and what navy writes for.
+  std::string nvmWriteStatsFile{};
+
+  // If set, every progress interval appends one json object per line with
+  // the seconds since the start and the cache, navy, throughput and workload
+  // generator counters, see vizualize/plot_time_series.sh.
+  std::string timeSeriesStatsFile{};
+
   // Distribution of operations across the pools in cache
   // This cannot exceed the number of pools in cache
   std::vector<double> opPoolDistribution{1.0};
@@ -292,6 +344,17 @@ struct StressorConfig : public JSONConfig {
 
   bool useCombinedLockForIterators{false};
 
+  // For a tenant, the cache pool its ops go to.
+  uint32_t tenantPoolId{0};
+
+  // Workloads to run side by side, each a stressor config of its own with a
+  // generator, numThreads (the threads of the run that serve it) and
+  // optionally opRatePerSec, replay traces, pool distribution and so on.
+  // The numThreads of the tenants add up to numThreads. Tenants get numOps
+  // and configPath from here unless they set them, and their keys are
+  // prefixed with their index so that they do not share items.
+  std::vector<StressorConfig> tenants;
+
   // admission policy for cache.
   std::shared_ptr<StressorAdmPolicy> admPolicy{};
 
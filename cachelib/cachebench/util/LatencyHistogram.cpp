@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/cachebench/util/LatencyHistogram.h"
+
+#include <cmath>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+LatencyHistogram::LatencyHistogram() : counts_(kNumBuckets) {}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other)
+    : counts_(kNumBuckets) {
+  *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    counts_[i].store(other.counts_[i].load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    counts_[i].store(counts_[i].load(std::memory_order_relaxed) +
+                         other.counts_[i].load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+LatencyHistogram& LatencyHistogram::operator-=(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    const auto count = counts_[i].load(std::memory_order_relaxed);
+    const auto prev = other.counts_[i].load(std::memory_order_relaxed);
+    counts_[i].store(count - std::min(count, prev), std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+uint64_t LatencyHistogram::getCount() const {
+  uint64_t total = 0;
+  for (const auto& count : counts_) {
+    total += count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+  const auto total = getCount();
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(percentile / 100 * total)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return getBucketMax(i);
+    }
+  }
+  return getBucketMax(kNumBuckets - 1);
+}
+
+uint64_t LatencyHistogram::getBucketMax(size_t bucket) noexcept {
+  constexpr size_t kHalfSubBuckets = 1ULL << (kPrecisionBits - 1);
+  if (bucket < 2 * kHalfSubBuckets) {
+    return bucket;
+  }
+  const size_t shift = bucket / kHalfSubBuckets - 1;
+  const uint64_t bits = bucket - shift * kHalfSubBuckets;
+  return ((bits + 1) << shift) - 1;
+}
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// Histogram of every recorded value, in the style of HdrHistogram: a value
+// goes into a bucket made of its kPrecisionBits most significant bits, so the
+// buckets are linear within each power of two. Percentiles are exact in rank
+// and within 1% in value, whatever the number of values, and histograms of
+// different threads or runs can be added up and compared.
+//
+// A histogram has a single writer. Other threads can copy it at any time to
+// read a consistent enough snapshot; the difference of two snapshots is the
+// histogram of the values recorded in between.
+class LatencyHistogram {
+ public:
+  static constexpr unsigned kPrecisionBits = 8;
+  // larger values are recorded as the largest one, ~68s in nanoseconds
+  static constexpr unsigned kMaxValueBits = 36;
+  static constexpr size_t kNumBuckets = (kMaxValueBits - kPrecisionBits + 2)
+                                        << (kPrecisionBits - 1);
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram& other);
+  LatencyHistogram& operator=(const LatencyHistogram& other);
+
+  // only called by the writer of the histogram
+  void record(uint64_t value) noexcept {
+    auto& count = counts_[getBucket(value)];
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  LatencyHistogram& operator+=(const LatencyHistogram& other);
+
+  // @param other   an earlier snapshot of this histogram
+  LatencyHistogram& operator-=(const LatencyHistogram& other);
+
+  uint64_t getCount() const;
+
+  // @param percentile    in [0, 100]
+  // @return the largest value of the bucket holding the value at @percentile,
+  //         0 if the histogram is empty
+  uint64_t getValueAtPercentile(double percentile) const;
+
+  static size_t getBucket(uint64_t value) noexcept {
+    constexpr uint64_t kSubBuckets = 1ULL << kPrecisionBits;
+    constexpr uint64_t kMaxValue = (1ULL << kMaxValueBits) - 1;
+    if (value < kSubBuckets) {
+      return value;
+    }
+    value = std::min(value, kMaxValue);
+    // keep the kPrecisionBits most significant bits
+    const unsigned shift = folly::findLastSet(value) - kPrecisionBits;
+    return (shift << (kPrecisionBits - 1)) + (value >> shift);
+  }
+
+  // @return the largest value going into @bucket
+  static uint64_t getBucketMax(size_t bucket) noexcept;
+
+ private:
+  std::vector<std::atomic<uint64_t>> counts_;
+};
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -369,6 +369,55 @@ std::optional<uint64_t> skhmsWriteBytes(
                          1 /* factor */);
 }
 
+// Drives following the OCP datacenter NVMe SSD specification report the
+// physical media units written, in bytes, in the first 16 bytes of the SMART /
+// health information extended log page 0xC0. The page ends with a GUID that
+// tells it apart from the vendor specific pages using the same id.
+std::optional<uint64_t> ocpWriteBytes(
+    const std::shared_ptr<ProcessFactory>& processFactory,
+    const folly::StringPiece nvmePath,
+    const folly::StringPiece devicePath) {
+  constexpr size_t kLogPageSize = 512;
+  constexpr size_t kGuidOffset = 496;
+  constexpr uint64_t kGuidLow = 0xA4F2BFEA2810AFC5;
+  constexpr uint64_t kGuidHigh = 0xAFD514C97C6F4F9C;
+
+  std::string out;
+  if (!runNvmeCmd(processFactory,
+                  nvmePath,
+                  {"get-log", devicePath.str(), "--log-id=0xc0",
+                   folly::sformat("--log-len={}", kLogPageSize),
+                   "--raw-binary"},
+                  out)) {
+    XLOG(ERR) << "Failed to run nvme command!";
+    return std::nullopt;
+  }
+  if (out.size() < kLogPageSize) {
+    XLOG(ERR) << "Got " << out.size() << " bytes of log page 0xC0, expected "
+              << kLogPageSize << ".";
+    return std::nullopt;
+  }
+
+  // fields of the log page are little endian
+  auto readUint64 = [&out](size_t offset) {
+    uint64_t value = 0;
+    for (size_t i = 8; i > 0; i--) {
+      value = (value << 8) | static_cast<uint8_t>(out[offset + i - 1]);
+    }
+    return value;
+  };
+  if (readUint64(kGuidOffset) != kGuidLow ||
+      readUint64(kGuidOffset + 8) != kGuidHigh) {
+    XLOG(ERR) << "Log page 0xC0 is not the OCP SMART extended log page!";
+    return std::nullopt;
+  }
+  if (readUint64(8) != 0) {
+    XLOG(ERR) << "Physical media units written overflow 64 bits!";
+    return std::nullopt;
+  }
+  return readUint64(0);
+}
+
 // Gets the output of `nvme list` for the given device.
 std::optional<std::string> getDeviceModelNumber(
     std::shared_ptr<ProcessFactory> processFactory,
@@ -459,10 +508,58 @@ uint64_t nandWriteBytes(const folly::StringPiece& deviceName,
     }
   }
 
-  // We got a model string but didn't match the vendor.
+  // We got a model string but didn't match the vendor. Datacenter drives
+  // report their NAND writes in a standard log page.
+  XLOG(DBG) << "No vendor matched, trying the OCP SMART extended log page.";
+  const auto& ocpBytesWritten =
+      ocpWriteBytes(processFactory, nvmePath, devicePath);
+  if (ocpBytesWritten) {
+    return ocpBytesWritten.value();
+  }
   throw std::invalid_argument(folly::sformat(
       "Vendor not recogized in device model number {}", modelNumber.value()));
 }
 
+// The output of `nvme smart-log -o json` looks like:
+//
+// clang-format off
+// {
+//   "critical_warning" : 0,
+//   ...
+//   "data_units_read" : 5093394330,
+//   "data_units_written" : 3270939924,
+//   ...
+// }
+// clang-format on
+//
+// Depending on the version of `nvme`, 128 bit counters are numbers or strings.
+uint64_t hostWriteBytes(const folly::StringPiece& deviceName,
+                        const folly::StringPiece& nvmePath,
+                        std::shared_ptr<ProcessFactory> processFactory) {
+  // A data unit is a thousand 512 byte units, whatever the sector size.
+  constexpr uint64_t kDataUnitBytes = 512 * 1000;
+
+  const auto& devicePath = folly::sformat("/dev/{}", deviceName);
+  std::string out;
+  if (!runNvmeCmd(
+          processFactory, nvmePath, {"smart-log", devicePath, "-o", "json"},
+          out)) {
+    throw std::invalid_argument(
+        folly::sformat("Failed to get smart log for device {}", deviceName));
+  }
+
+  try {
+    const auto& units = folly::parseJson(out)["data_units_written"];
+    const uint64_t dataUnits = units.isString()
+                                   ? folly::to<uint64_t>(units.asString())
+                                   : folly::to<uint64_t>(units.asInt());
+    return dataUnits * kDataUnitBytes;
+  } catch (const std::exception& e) {
+    throw std::invalid_argument(
+        folly::sformat("Failed to get host bytes written for device {}: {}",
+                       deviceName, e.what()));
+  }
+}
+
 } // namespace hw
 } // namespace facebook
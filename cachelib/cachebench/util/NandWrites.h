@@ -59,6 +59,10 @@ class ProcessFactory {
 //
 // @returns Lifetime total physical (NAND) bytes written to the device.
 //
+// Devices of vendors that are not recognized are queried through the SMART /
+// health information extended log page (0xC0) of the OCP datacenter NVMe SSD
+// specification.
+//
 // @throws std::runtime_error if the device is not recognized or an error occurs
 //         when running the `nvme` command.
 uint64_t nandWriteBytes(const folly::StringPiece& deviceName,
@@ -66,5 +70,23 @@ uint64_t nandWriteBytes(const folly::StringPiece& deviceName,
                         std::shared_ptr<ProcessFactory> processFactory =
                             std::make_shared<ProcessFactory>());
 
+// Gets the lifetime total of bytes written by hosts to a device, from the
+// data units written of the standard NVMe SMART / health log page. Together
+// with nandWriteBytes() this gives the write amplification of the device.
+//
+// @param[in] deviceName       Identifier for a device, such as nvme1n1.
+// @param[in] nvmePath         Path to the `nvme` tool.
+// @param[in] processFactory   Interface used to spawn subprocesses, used to
+//                             inject a mock for unit tests.
+//
+// @returns Lifetime total bytes written by hosts to the device.
+//
+// @throws std::invalid_argument if an error occurs when running the `nvme`
+//         command or its output can not be parsed.
+uint64_t hostWriteBytes(const folly::StringPiece& deviceName,
+                        const folly::StringPiece& nvmePath = "/usr/sbin/nvme",
+                        std::shared_ptr<ProcessFactory> processFactory =
+                            std::make_shared<ProcessFactory>());
+
 } // namespace hw
 } // namespace facebook
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/cachebench/util/RegressionCheck.h"
+
+#include <folly/Format.h>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+namespace {
+struct Summary {
+  size_t count{0};
+  double mean{0};
+  double variance{0};
+};
+
+Summary summarize(const std::vector<double>& values) {
+  Summary summary;
+  summary.count = values.size();
+  if (values.empty()) {
+    return summary;
+  }
+  for (auto v : values) {
+    summary.mean += v;
+  }
+  summary.mean /= values.size();
+  if (values.size() > 1) {
+    for (auto v : values) {
+      summary.variance += (v - summary.mean) * (v - summary.mean);
+    }
+    summary.variance /= values.size() - 1;
+  }
+  return summary;
+}
+
+// continued fraction of the regularized incomplete beta function, see
+// Numerical Recipes 6.4
+double betaContinuedFraction(double a, double b, double x) {
+  constexpr int kMaxIterations = 300;
+  constexpr double kEpsilon = 1e-12;
+  constexpr double kTiny = 1e-300;
+  const double qab = a + b;
+  const double qap = a + 1;
+  const double qam = a - 1;
+  double c = 1;
+  double d = 1 - qab * x / qap;
+  if (std::abs(d) < kTiny) {
+    d = kTiny;
+  }
+  d = 1 / d;
+  double h = d;
+  for (int m = 1; m <= kMaxIterations; m++) {
+    const int m2 = 2 * m;
+    double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+    d = 1 + aa * d;
+    d = std::abs(d) < kTiny ? 1 / kTiny : 1 / d;
+    c = 1 + aa / c;
+    if (std::abs(c) < kTiny) {
+      c = kTiny;
+    }
+    h *= d * c;
+    aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+    d = 1 + aa * d;
+    d = std::abs(d) < kTiny ? 1 / kTiny : 1 / d;
+    c = 1 + aa / c;
+    if (std::abs(c) < kTiny) {
+      c = kTiny;
+    }
+    const double delta = d * c;
+    h *= delta;
+    if (std::abs(delta - 1) < kEpsilon) {
+      break;
+    }
+  }
+  return h;
+}
+
+double regularizedIncompleteBeta(double a, double b, double x) {
+  if (x <= 0) {
+    return 0;
+  }
+  if (x >= 1) {
+    return 1;
+  }
+  const double front =
+      std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+               a * std::log(x) + b * std::log(1 - x));
+  if (x < (a + 1) / (a + b + 2)) {
+    return front * betaContinuedFraction(a, b, x) / a;
+  }
+  return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+}
+
+double studentTCdf(double t, double degreesOfFreedom) {
+  const double x = degreesOfFreedom / (degreesOfFreedom + t * t);
+  const double tail =
+      0.5 * regularizedIncompleteBeta(degreesOfFreedom / 2, 0.5, x);
+  return t >= 0 ? 1 - tail : tail;
+}
+} // namespace
+
+RegressionCheck::Direction RegressionCheck::getDirection(
+    const std::string& metric) {
+  for (const char* worse :
+       {"latency", "lag", "write_amp", "bytes_written", "inconsistency"}) {
+    if (metric.find(worse) != std::string::npos) {
+      return Direction::kLowerIsBetter;
+    }
+  }
+  for (const char* better : {"hit_rate", "per_sec", "suc_rate"}) {
+    if (metric.find(better) != std::string::npos) {
+      return Direction::kHigherIsBetter;
+    }
+  }
+  return Direction::kNeutral;
+}
+
+RegressionCheck::RegressionCheck(double confidence, double minChangePct)
+    : confidence_(confidence), minChangePct_(minChangePct) {
+  if (!(confidence_ > 0 && confidence_ < 1)) {
+    throw std::invalid_argument(
+        folly::sformat("invalid confidence level: {}", confidence_));
+  }
+}
+
+double RegressionCheck::getStudentTQuantile(double p,
+                                            double degreesOfFreedom) {
+  if (p == 0.5) {
+    return 0;
+  }
+  if (p < 0.5) {
+    return -getStudentTQuantile(1 - p, degreesOfFreedom);
+  }
+  // bisection, the cdf being monotonic
+  double low = 0;
+  double high = 1;
+  while (studentTCdf(high, degreesOfFreedom) < p && high < 1e12) {
+    high *= 2;
+  }
+  for (int i = 0; i < 200 && high - low > 1e-9 * high; i++) {
+    const double mid = (low + high) / 2;
+    if (studentTCdf(mid, degreesOfFreedom) < p) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return (low + high) / 2;
+}
+
+std::vector<RegressionCheck::Comparison> RegressionCheck::compare(
+    const RunResults& baseline, const RunResults& results) const {
+  const double p = (1 + confidence_) / 2;
+  auto getInterval = [p](const Summary& s) {
+    if (s.count < 2) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    return getStudentTQuantile(p, s.count - 1) *
+           std::sqrt(s.variance / s.count);
+  };
+
+  std::vector<Comparison> comparisons;
+  for (const auto& [metric, values] : results) {
+    auto it = baseline.find(metric);
+    if (it == baseline.end() || it->second.empty() || values.empty()) {
+      continue;
+    }
+    const auto b = summarize(it->second);
+    const auto r = summarize(values);
+
+    Comparison c;
+    c.metric = metric;
+    c.direction = getDirection(metric);
+    c.baselineMean = b.mean;
+    c.baselineInterval = getInterval(b);
+    c.mean = r.mean;
+    c.interval = getInterval(r);
+    const double diff = r.mean - b.mean;
+    if (b.mean != 0) {
+      c.changePct = diff / std::abs(b.mean) * 100;
+    } else if (diff != 0) {
+      c.changePct = diff > 0 ? std::numeric_limits<double>::infinity()
+                             : -std::numeric_limits<double>::infinity();
+    }
+
+    // Welch's t-test, which does not assume equal variances
+    if (b.count > 1 && r.count > 1) {
+      const double vb = b.variance / b.count;
+      const double vr = r.variance / r.count;
+      const double se = std::sqrt(vb + vr);
+      if (se == 0) {
+        c.significant = diff != 0;
+      } else {
+        const double degreesOfFreedom =
+            (vb + vr) * (vb + vr) /
+            (vb * vb / (b.count - 1) + vr * vr / (r.count - 1));
+        c.significant =
+            std::abs(diff) > getStudentTQuantile(p, degreesOfFreedom) * se;
+      }
+    }
+
+    if (c.significant && std::abs(c.changePct) >= minChangePct_ &&
+        c.direction != Direction::kNeutral) {
+      const bool better = (diff > 0) == (c.direction ==
+                                         Direction::kHigherIsBetter);
+      c.improved = better;
+      c.regressed = !better;
+    }
+    comparisons.push_back(std::move(c));
+  }
+  return comparisons;
+}
+
+bool RegressionCheck::render(const std::vector<Comparison>& comparisons,
+                             std::ostream& out) {
+  auto formatMean = [](double mean, double interval) {
+    return std::isnan(interval)
+               ? folly::sformat("{:.2f}", mean)
+               : folly::sformat("{:.2f} +- {:.2f}", mean, interval);
+  };
+
+  bool passed = true;
+  out << folly::sformat("{:36} {:>26} {:>26} {:>9}  {}\n", "metric",
+                        "baseline", "current", "change", "verdict");
+  for (const auto& c : comparisons) {
+    const char* verdict = "";
+    if (c.regressed) {
+      verdict = "REGRESSION";
+      passed = false;
+    } else if (c.improved) {
+      verdict = "improvement";
+    } else if (c.significant) {
+      verdict = "changed";
+    }
+    out << folly::sformat("{:36} {:>26} {:>26} {:>8.2f}%  {}\n", c.metric,
+                          formatMean(c.baselineMean, c.baselineInterval),
+                          formatMean(c.mean, c.interval), c.changePct,
+                          verdict);
+  }
+  return passed;
+}
+
+void RegressionCheck::addRun(const folly::UserCounters& counters,
+                             RunResults& results) {
+  for (const auto& [metric, value] : counters) {
+    results[metric].push_back(static_cast<double>(value.value));
+  }
+}
+
+folly::dynamic RegressionCheck::toJson(const RunResults& results) {
+  folly::dynamic json = folly::dynamic::object;
+  for (const auto& [metric, values] : results) {
+    json[metric] = folly::dynamic(values.begin(), values.end());
+  }
+  return json;
+}
+
+RunResults RegressionCheck::fromJson(const folly::dynamic& json) {
+  if (!json.isObject()) {
+    throw std::invalid_argument("run results must be a json object");
+  }
+  RunResults results;
+  for (const auto& [metric, values] : json.items()) {
+    if (!values.isArray()) {
+      throw std::invalid_argument(folly::sformat(
+          "results of {} must be an array", metric.asString()));
+    }
+    auto& samples = results[metric.asString()];
+    for (const auto& value : values) {
+      if (!value.isNumber()) {
+        throw std::invalid_argument(folly::sformat(
+            "results of {} must be numbers", metric.asString()));
+      }
+      samples.push_back(value.asDouble());
+    }
+  }
+  return results;
+}
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Benchmark.h>
+#include <folly/dynamic.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// Results of repeated runs of a cachebench config: the value of every metric
+// in each run, by metric name.
+using RunResults = std::map<std::string, std::vector<double>>;
+
+// Compares the results of runs against the stored results of baseline runs.
+// A metric regresses when the confidence interval of the difference of its
+// means (Welch's t-test) is entirely on its worse side and the difference is
+// at least a minimum change, so that noise between runs is not reported.
+class RegressionCheck {
+ public:
+  // whether a metric improves when it increases, from its name
+  enum class Direction { kHigherIsBetter, kLowerIsBetter, kNeutral };
+  static Direction getDirection(const std::string& metric);
+
+  struct Comparison {
+    std::string metric;
+    Direction direction{Direction::kNeutral};
+    double baselineMean{0};
+    // half width of the confidence interval of the mean, NaN with one run
+    double baselineInterval{0};
+    double mean{0};
+    double interval{0};
+    // change of the mean relative to the baseline, in percent
+    double changePct{0};
+    // the confidence interval of the difference excludes 0
+    bool significant{false};
+    bool regressed{false};
+    bool improved{false};
+  };
+
+  // @param confidence    confidence level of the intervals, in (0, 1)
+  // @param minChangePct  smallest change in percent to report, however
+  //                      significant
+  //
+  // @throw std::invalid_argument if confidence is not in (0, 1)
+  explicit RegressionCheck(double confidence = 0.95,
+                           double minChangePct = 1.0);
+
+  // @return the comparison of the metrics in both @baseline and @results
+  std::vector<Comparison> compare(const RunResults& baseline,
+                                  const RunResults& results) const;
+
+  // prints the comparisons as a table
+  // @return false if any metric regressed
+  static bool render(const std::vector<Comparison>& comparisons,
+                     std::ostream& out);
+
+  // appends the metrics of a run to @results
+  static void addRun(const folly::UserCounters& counters, RunResults& results);
+
+  static folly::dynamic toJson(const RunResults& results);
+
+  // @throw std::invalid_argument if @json is not an object of arrays of
+  //        numbers
+  static RunResults fromJson(const folly::dynamic& json);
+
+  // quantile of the Student's t distribution with @degreesOfFreedom
+  static double getStudentTQuantile(double p, double degreesOfFreedom);
+
+ private:
+  const double confidence_;
+  const double minChangePct_;
+};
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
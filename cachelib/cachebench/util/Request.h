@@ -140,6 +140,7 @@ struct Request {
         requestId(reqId),
         admFeatureMap(other.admFeatureMap),
         timestamp(other.timestamp),
+        timestampUs(other.timestampUs),
         itemValue(other.itemValue),
         op(other.getOp()) {}
 
@@ -191,6 +192,10 @@ struct Request {
   // May not have to be the same as wall clock
   uint64_t timestamp{0};
 
+  // Same timestamp in microseconds, for replaying the requests at the time
+  // they were recorded. 0 if the generator does not have it.
+  uint64_t timestampUs{0};
+
   // Use case specific data that will be included in the request. This can be
   // used to track metadata that is specific to a particular application.
   std::string itemValue;
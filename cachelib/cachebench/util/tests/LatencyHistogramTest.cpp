@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "cachelib/cachebench/util/LatencyHistogram.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+namespace tests {
+
+TEST(LatencyHistogramTest, Buckets) {
+  // small values have their own bucket
+  for (uint64_t v = 0; v < 256; v++) {
+    EXPECT_EQ(v, LatencyHistogram::getBucket(v));
+    EXPECT_EQ(v, LatencyHistogram::getBucketMax(v));
+  }
+
+  // buckets are contiguous and every value is within 1% of its bucket max
+  size_t prevBucket = 255;
+  for (uint64_t v = 256; v < (1ULL << 20); v += 7) {
+    const auto bucket = LatencyHistogram::getBucket(v);
+    EXPECT_LE(prevBucket, bucket);
+    EXPECT_GE(prevBucket + 1, bucket);
+    prevBucket = bucket;
+    const auto max = LatencyHistogram::getBucketMax(bucket);
+    EXPECT_LE(v, max);
+    EXPECT_LT(max - v, v / 100 + 1);
+    EXPECT_EQ(bucket, LatencyHistogram::getBucket(max));
+    EXPECT_EQ(bucket + 1, LatencyHistogram::getBucket(max + 1));
+  }
+
+  EXPECT_EQ(LatencyHistogram::kNumBuckets - 1,
+            LatencyHistogram::getBucket(UINT64_MAX));
+  EXPECT_EQ((1ULL << LatencyHistogram::kMaxValueBits) - 1,
+            LatencyHistogram::getBucketMax(LatencyHistogram::kNumBuckets - 1));
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.getCount());
+  EXPECT_EQ(0, histogram.getValueAtPercentile(99));
+
+  for (uint64_t v = 1; v <= 100; v++) {
+    histogram.record(v);
+  }
+  histogram.record(1000000);
+  EXPECT_EQ(101, histogram.getCount());
+  EXPECT_EQ(1, histogram.getValueAtPercentile(0));
+  EXPECT_EQ(51, histogram.getValueAtPercentile(50));
+  EXPECT_EQ(100, histogram.getValueAtPercentile(99));
+  const auto max = histogram.getValueAtPercentile(100);
+  EXPECT_LE(1000000, max);
+  EXPECT_GT(1010000, max);
+}
+
+TEST(LatencyHistogramTest, Snapshots) {
+  LatencyHistogram histogram;
+  for (uint64_t v = 0; v < 1000; v++) {
+    histogram.record(v);
+  }
+  const auto snapshot = histogram;
+  for (uint64_t v = 0; v < 10; v++) {
+    histogram.record(5000);
+  }
+
+  auto interval = histogram;
+  interval -= snapshot;
+  EXPECT_EQ(10, interval.getCount());
+  EXPECT_EQ(LatencyHistogram::getBucketMax(LatencyHistogram::getBucket(5000)),
+            interval.getValueAtPercentile(50));
+
+  auto total = snapshot;
+  total += interval;
+  EXPECT_EQ(histogram.getCount(), total.getCount());
+  EXPECT_EQ(histogram.getValueAtPercentile(99.9),
+            total.getValueAtPercentile(99.9));
+}
+
+} // namespace tests
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
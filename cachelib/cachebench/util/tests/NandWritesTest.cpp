@@ -711,5 +711,89 @@ host_bytes_written              : 100%       sectors: 172365270
             7547837550166016);
 }
 
+// Devices of unknown vendors are read through the OCP SMART extended log page.
+TEST_F(NandWritesTest, nandWriteBytes_handlesOcpDevice) {
+  constexpr auto& kListOutput = R"EOF({
+  "Devices" : [
+    {
+      "DevicePath" : "/dev/nvme0n1",
+      "Firmware" : "1.0",
+      "Index" : 0,
+      "ModelNumber" : "ACME DC1000",
+      "SerialNumber" : "0001",
+      "UsedBytes" : 1600321314816,
+      "MaximumLBA" : 390703446,
+      "PhysicalSize" : 1600321314816,
+      "SectorSize" : 4096
+    }
+  ]
+})EOF";
+
+  auto makeLogPage = [](uint64_t bytesWritten, uint64_t guidLow) {
+    std::string page(512, '\0');
+    auto writeUint64 = [&page](size_t offset, uint64_t value) {
+      for (size_t i = 0; i < 8; i++) {
+        page[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+      }
+    };
+    writeUint64(0, bytesWritten);
+    writeUint64(496, guidLow);
+    writeUint64(504, 0xAFD514C97C6F4F9C);
+    return page;
+  };
+  const std::vector<std::string> getLogCmd{
+      kNvmePath,       "get-log",        "/dev/nvme0n1", "--log-id=0xc0",
+      "--log-len=512", "--raw-binary"};
+
+  mockFactory_->expectedCommands(
+      {{{kNvmePath, "list", "-o", "json"}, kListOutput},
+       {getLogCmd, makeLogPage(2068700589752320, 0xA4F2BFEA2810AFC5)}});
+  EXPECT_EQ(nandWriteBytes("nvme0n1", kNvmePath, mockFactory_),
+            2068700589752320);
+  Mock::VerifyAndClearExpectations(mockFactory_.get());
+
+  // a vendor specific page with the same id is not mistaken for the OCP one
+  mockFactory_->expectedCommands(
+      {{{kNvmePath, "list", "-o", "json"}, kListOutput},
+       {getLogCmd, makeLogPage(2068700589752320, 0)}});
+  EXPECT_THROW(nandWriteBytes("nvme0n1", kNvmePath, mockFactory_),
+               std::invalid_argument);
+}
+
+TEST_F(NandWritesTest, hostWriteBytes) {
+  constexpr auto& kSmartLogOutput = R"EOF({
+  "critical_warning" : 0,
+  "temperature" : 310,
+  "avail_spare" : 100,
+  "spare_thresh" : 10,
+  "percent_used" : 3,
+  "data_units_read" : 5093394330,
+  "data_units_written" : 3270939924,
+  "host_read_commands" : 79462385236,
+  "host_write_commands" : 27186934537
+})EOF";
+
+  mockFactory_->expectedCommands(
+      {{{kNvmePath, "smart-log", "/dev/nvme0n1", "-o", "json"},
+        kSmartLogOutput}});
+  EXPECT_EQ(hostWriteBytes("nvme0n1", kNvmePath, mockFactory_),
+            3270939924ULL * 512 * 1000);
+  Mock::VerifyAndClearExpectations(mockFactory_.get());
+
+  // newer versions of nvme print 128 bit counters as strings
+  mockFactory_->expectedCommands(
+      {{{kNvmePath, "smart-log", "/dev/nvme0n1", "-o", "json"},
+        R"EOF({"data_units_written" : "3270939924"})EOF"}});
+  EXPECT_EQ(hostWriteBytes("nvme0n1", kNvmePath, mockFactory_),
+            3270939924ULL * 512 * 1000);
+  Mock::VerifyAndClearExpectations(mockFactory_.get());
+
+  mockFactory_->expectedCommands(
+      {{{kNvmePath, "smart-log", "/dev/nvme0n1", "-o", "json"},
+        "not valid json"}});
+  EXPECT_THROW(hostWriteBytes("nvme0n1", kNvmePath, mockFactory_),
+               std::invalid_argument);
+}
+
 } // namespace hw
 } // namespace facebook
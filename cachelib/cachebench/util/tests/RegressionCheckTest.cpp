@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+
+#include "cachelib/cachebench/util/RegressionCheck.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+namespace tests {
+
+TEST(RegressionCheckTest, StudentTQuantile) {
+  EXPECT_NEAR(12.706, RegressionCheck::getStudentTQuantile(0.975, 1), 1e-3);
+  EXPECT_NEAR(2.776, RegressionCheck::getStudentTQuantile(0.975, 4), 1e-3);
+  EXPECT_NEAR(3.250, RegressionCheck::getStudentTQuantile(0.995, 9), 1e-3);
+  EXPECT_NEAR(-2.776, RegressionCheck::getStudentTQuantile(0.025, 4), 1e-3);
+  EXPECT_EQ(0, RegressionCheck::getStudentTQuantile(0.5, 4));
+}
+
+TEST(RegressionCheckTest, Direction) {
+  using D = RegressionCheck::Direction;
+  EXPECT_EQ(D::kHigherIsBetter, RegressionCheck::getDirection("hit_rate"));
+  EXPECT_EQ(D::kHigherIsBetter, RegressionCheck::getDirection("get_per_sec"));
+  EXPECT_EQ(D::kLowerIsBetter,
+            RegressionCheck::getDirection("get_latency_p99_ns"));
+  EXPECT_EQ(D::kLowerIsBetter,
+            RegressionCheck::getDirection("nvm_dev_write_amp"));
+  EXPECT_EQ(D::kNeutral, RegressionCheck::getDirection("num_items"));
+}
+
+TEST(RegressionCheckTest, Compare) {
+  RunResults baseline{{"get_per_sec", {100, 102, 98, 101, 99}},
+                      {"get_latency_p99_ns", {1000, 1010, 990, 1005, 995}},
+                      {"hit_rate", {9000, 9010, 8990, 9005, 8995}},
+                      {"num_items", {10, 10, 10, 10, 10}},
+                      {"only_in_baseline", {1}}};
+  RunResults results{{"get_per_sec", {90, 92, 88, 91, 89}},
+                     {"get_latency_p99_ns", {900, 910, 890, 905, 895}},
+                     {"hit_rate", {9001, 9012, 8991, 9004, 8994}},
+                     {"num_items", {20, 20, 20, 20, 20}}};
+
+  RegressionCheck check;
+  const auto comparisons = check.compare(baseline, results);
+  ASSERT_EQ(4, comparisons.size());
+  std::map<std::string, RegressionCheck::Comparison> byMetric;
+  for (const auto& c : comparisons) {
+    byMetric[c.metric] = c;
+  }
+
+  // fewer gets per second: a regression
+  const auto& throughput = byMetric["get_per_sec"];
+  EXPECT_DOUBLE_EQ(100, throughput.baselineMean);
+  EXPECT_DOUBLE_EQ(90, throughput.mean);
+  EXPECT_DOUBLE_EQ(-10, throughput.changePct);
+  EXPECT_GT(throughput.interval, 0);
+  EXPECT_TRUE(throughput.significant);
+  EXPECT_TRUE(throughput.regressed);
+
+  // lower latency: an improvement
+  EXPECT_TRUE(byMetric["get_latency_p99_ns"].improved);
+  EXPECT_FALSE(byMetric["get_latency_p99_ns"].regressed);
+
+  // noise
+  EXPECT_FALSE(byMetric["hit_rate"].significant);
+  EXPECT_FALSE(byMetric["hit_rate"].regressed);
+
+  // changed, but neither better nor worse
+  EXPECT_TRUE(byMetric["num_items"].significant);
+  EXPECT_FALSE(byMetric["num_items"].regressed);
+  EXPECT_FALSE(byMetric["num_items"].improved);
+
+  std::ostringstream out;
+  EXPECT_FALSE(RegressionCheck::render(comparisons, out));
+  EXPECT_NE(std::string::npos, out.str().find("REGRESSION"));
+
+  // a small change is not reported, however significant
+  RegressionCheck lenient{0.95, 20.0};
+  const auto lenientComparisons = lenient.compare(baseline, results);
+  std::ostringstream lenientOut;
+  EXPECT_TRUE(RegressionCheck::render(lenientComparisons, lenientOut));
+}
+
+TEST(RegressionCheckTest, SingleRun) {
+  RunResults baseline{{"get_per_sec", {100}}};
+  RunResults results{{"get_per_sec", {50}}};
+  const auto comparisons = RegressionCheck{}.compare(baseline, results);
+  ASSERT_EQ(1, comparisons.size());
+  EXPECT_TRUE(std::isnan(comparisons[0].interval));
+  // no variance to tell a change from noise
+  EXPECT_FALSE(comparisons[0].significant);
+  EXPECT_FALSE(comparisons[0].regressed);
+}
+
+TEST(RegressionCheckTest, Json) {
+  folly::UserCounters counters;
+  counters["hit_rate"] = 9000;
+  counters["get_per_sec"] = 100;
+  RunResults results;
+  RegressionCheck::addRun(counters, results);
+  counters["hit_rate"] = 9100;
+  RegressionCheck::addRun(counters, results);
+  EXPECT_EQ(std::vector<double>({9000, 9100}), results["hit_rate"]);
+
+  EXPECT_EQ(results,
+            RegressionCheck::fromJson(RegressionCheck::toJson(results)));
+  EXPECT_THROW(RegressionCheck::fromJson(folly::dynamic::array(1)),
+               std::invalid_argument);
+  EXPECT_THROW(RegressionCheck::fromJson(folly::dynamic::object("a", 1)),
+               std::invalid_argument);
+  EXPECT_THROW(RegressionCheck{1.5}, std::invalid_argument);
+}
+
+} // namespace tests
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
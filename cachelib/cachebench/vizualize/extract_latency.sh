@@ -20,6 +20,7 @@ if [[ $# -ne 1 ]] || [[ ! -s "$input_logfile" ]] || [[ ! -f "$input_logfile" ]];
     echo "produces a tsv containing nvm read/write latencies from LOGFILE"
     echo "if gnuplot is installed, will produce a plot of these latencies"
     echo "LOGFILE should be logging output of cachebench with --progress-stats_file"
+    echo "or the latencyStatsFile of the cachebench config"
     exit 1
 fi
 
@@ -83,6 +84,31 @@ extract_bandwidth() {
         echo "Bandwidth written to $out"
 }
 
+# split the per interval rows of a latencyStatsFile into a tsv for an op
+#   time op count p50us ... p100us
+#   10 get 1034 1.02 ... 250.30
+#
+#   becomes
+#   10 1.02 ... 250.30
+extract_op_latency() {
+    local in=$3
+    local out=$2
+    local op=$1
+
+    {
+        echo "time $percentiles"
+        awk -v op="$op" '$2 == op && $1 != "total" && $3 > 0 {
+            printf "%s", $1
+            for (i = 4; i <= NF; i++) printf " %s", $i
+            printf "\n"
+        }' "$in"
+    }  | column -t > "$out"
+
+    [[ "$(wc -l < "$out")" -eq "1" ]] &&                        \
+        echo "No $op latency records found" ||                  \
+        echo "$op latency written to $out"
+}
+
 extract_median() {
     local in="$1"
     local column="$2"
@@ -107,9 +133,36 @@ print_median_percentile() {
     echo
 }
 
+plot_png() {
+    gnuplot                     \
+        -e "tsv='$1'"           \
+        -e "out_file='$2'"      \
+        -e "chart_title='$3'"   \
+        "$4"                &&  \
+            echo "Plotted $3 in $2" || \
+            echo "Failed to plot $3"
+}
 
 out_dir=$(dirname "$input_logfile")
 filename=$(basename "$input_logfile")
+plot_file="$(dirname "$0")/gnuplot_latency.plt"
+
+if head -n 1 "$input_logfile" | grep -q "^time op count "; then
+    ops="get set del"
+    for op in $ops; do
+        op_tsv="$out_dir/${filename%%.*}_${op}_latency.tsv"
+        extract_op_latency "$op" "$op_tsv" "$input_logfile"
+        plot_png "$op_tsv" "$out_dir/${filename%%.*}_${op}_latency.png" \
+            "${op} Latency" "$plot_file"
+    done
+
+    echo -e "\n\n======= Overall Latency ======= "
+    {
+        echo "OpType count $percentiles"
+        awk '$1 == "total" {$1 = ""; print}' "$input_logfile"
+    } | column -t
+    exit 0
+fi
 
 # location of the intermediate tsv
 read_tsv="$out_dir/${filename%%.*}_read_latency.tsv"
@@ -123,17 +176,6 @@ extract_bandwidth "egressBytesPerSec" "$bandwidth_tsv"  "$input_logfile"
 # location of the final latency charts
 read_png="$out_dir/${filename%%.*}_read_latency.png"
 write_png="$out_dir/${filename%%.*}_write_latency.png"
-plot_file="$(dirname "$0")/gnuplot_latency.plt"
-
-plot_png() {
-    gnuplot                     \
-        -e "tsv='$1'"           \
-        -e "out_file='$2'"      \
-        -e "chart_title='$3'"   \
-        "$4"                &&  \
-            echo "Plotted $3 in $2" || \
-            echo "Failed to plot $3"
-}
 
 plot_png "$read_tsv" "$read_png" "Read Latency" "$plot_file"
 plot_png "$write_tsv" "$write_png" "Write Latency" "$plot_file"
@@ -0,0 +1,35 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+set terminal png size 2000, 500 * num_counters
+
+# out_file is provided as input
+set output out_file
+
+# chart_title is provided as input
+set multiplot layout num_counters,1 title chart_title font ",20"
+
+set grid
+set autoscale
+set xlabel "seconds"
+set key font ",16"
+
+# pick up column names from first line
+set key center top autotitle columnhead
+
+# tsv is the input file containing the time in the first column and a
+# column per counter
+do for [i=2:num_counters + 1] {
+    plot tsv using 1:i with lines
+}
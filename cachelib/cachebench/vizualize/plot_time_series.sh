@@ -0,0 +1,83 @@
+#! /bin/bash
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+input_file=$1
+if [[ $# -lt 1 ]] || [[ ! -s "$input_file" ]] || [[ ! -f "$input_file" ]]; then
+    echo "USAGE: $0 TIMESERIESFILE [COUNTER[:rate] ...]"
+    echo "produces a tsv of the COUNTERs over time from TIMESERIESFILE"
+    echo "if gnuplot is installed, will produce a plot of these counters"
+    echo "TIMESERIESFILE should be the timeSeriesStatsFile of the cachebench"
+    echo "config. COUNTER:rate plots the change per second of a counter that"
+    echo "only grows, such as navy_bc_inserts. Without COUNTERs, lists them"
+    exit 1
+fi
+shift
+
+if ! command -v jq > /dev/null; then
+    echo "jq is needed to read $input_file"
+    exit 1
+fi
+
+if [[ $# -eq 0 ]]; then
+    jq -r -s 'map(keys[]) | unique[] | select(. != "time_secs")' "$input_file"
+    exit 0
+fi
+
+out_dir=$(dirname "$input_file")
+filename=$(basename "$input_file")
+tsv="$out_dir/${filename%%.*}_time_series.tsv"
+png="$out_dir/${filename%%.*}_time_series.png"
+plot_file="$(dirname "$0")/gnuplot_time_series.plt"
+
+# one row per interval, with the seconds since the start of the run and a
+# column per counter. A counter missing from an interval is 0.
+#   {"navy_bc_inserts": 120, "num_items": 30, "time_secs": 10}
+#   {"navy_bc_inserts": 320, "num_items": 50, "time_secs": 20}
+#
+#   with num_items and navy_bc_inserts:rate becomes
+#   time  num_items  navy_bc_inserts:rate
+#   10    30         0
+#   20    50         20
+jq -r -s --arg counters "$*" '
+    ($counters | split(" ")) as $cols
+    | (["time"] + $cols),
+      (range(0; length) as $i
+       | .[$i] as $cur
+       | (if $i > 0 then .[$i - 1] else null end) as $prev
+       | [$cur.time_secs] + [$cols[]
+           | if endswith(":rate") then
+               .[:-5] as $name
+               | if $prev == null or $cur.time_secs == $prev.time_secs then 0
+                 else (($cur[$name] // 0) - ($prev[$name] // 0)) /
+                      ($cur.time_secs - $prev.time_secs)
+                 end
+             else $cur[.] // 0
+             end])
+    | @tsv' "$input_file" | column -t > "$tsv"
+
+if [[ "$(wc -l < "$tsv")" -le "1" ]]; then
+    echo "Incorrect time series file. No records found"
+    exit 1
+fi
+echo "Time series written to $tsv"
+
+gnuplot                             \
+    -e "tsv='$tsv'"                 \
+    -e "out_file='$png'"            \
+    -e "chart_title='$filename'"    \
+    -e "num_counters=$#"            \
+    "$plot_file"                &&  \
+        echo "Plotted $filename in $png" || \
+        echo "Failed to plot $filename"
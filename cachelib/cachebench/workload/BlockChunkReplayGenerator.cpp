@@ -16,6 +16,10 @@
 
 #include "cachelib/cachebench/workload/BlockChunkReplayGenerator.h"
 
+#include <folly/hash/SpookyHashV2.h>
+
+#include <algorithm>
+
 #include "cachelib/cachebench/util/Exceptions.h"
 
 namespace {
@@ -37,6 +41,7 @@ const Request& BlockChunkReplayGenerator::getReq(
     } else {
       // Wait a while to allow traceGenThread_ to process new samples.
       queueConsumerWaitCounts_.inc();
+      shardStats_[*tlStickyIdx_].consumerWaits.inc();
       std::this_thread::sleep_for(
           std::chrono::microseconds(kProducerConsumerWaitTimeUs));
     }
@@ -152,38 +157,28 @@ void BlockChunkReplayGenerator::getReqFromTrace() {
         key.append(folly::sformat("_{:04d}", keySuffix));
       }
 
-      // Push the request to the queue of the worker identified by the shard
-      auto shard = getShard(key);
-      while (true) {
-        if (shouldShutdown()) {
-          XLOG(INFO) << "Forced to stop, terminate reading trace file!";
+      if (lbaShardSize_ == 0) {
+        if (!pushReq(getShard(key), timestampRaw, op, key, ioOffset,
+                     ioOffset + ioSize - 1)) {
           return;
         }
+        continue;
+      }
 
-        // Skip the shard if the stressor thread wants to leave
-        if (threadFinished_[shard].load(std::memory_order_relaxed)) {
-          XLOG_EVERY_MS(INFO, 100'000,
-                        folly::sformat("Thread {} finish, skip", shard));
-          break;
+      // Split the request at the boundaries of the ranges it covers. Every
+      // part is a request of its own, queued to the shard of its range.
+      const uint64_t ioEnd = ioOffset + ioSize;
+      for (uint64_t start = ioOffset; start < ioEnd;) {
+        const uint64_t end =
+            std::min(ioEnd, (start / lbaShardSize_ + 1) * lbaShardSize_);
+        if (!pushReq(getLbaShard(key, start), timestampRaw, op, key, start,
+                     end - 1)) {
+          return;
         }
-
-        std::vector<std::string> statsAggFields;
-        if (!activeReqQ_[shard]->isFull()) {
-          auto status = activeReqQ_[shard]->write(blockCacheAdapter_,
-                                                  timestampRaw,
-                                                  nextReqId_,
-                                                  op,
-                                                  key,
-                                                  ioOffset,
-                                                  ioOffset + ioSize - 1);
-          XCHECK(status);
-          break;
+        start = end;
+        if (start < ioEnd) {
+          ++nextReqId_;
         }
-
-        // Spin until the queue has room
-        queueProducerWaitCounts_.inc();
-        std::this_thread::sleep_for(
-            std::chrono::microseconds(kProducerConsumerWaitTimeUs));
       }
     }
 
@@ -191,6 +186,84 @@ void BlockChunkReplayGenerator::getReqFromTrace() {
   }
 }
 
+bool BlockChunkReplayGenerator::pushReq(uint32_t shard,
+                                        uint64_t timestamp,
+                                        OpType op,
+                                        const std::string& key,
+                                        uint64_t rangeStart,
+                                        uint64_t rangeEnd) {
+  while (true) {
+    if (shouldShutdown()) {
+      XLOG(INFO) << "Forced to stop, terminate reading trace file!";
+      return false;
+    }
+
+    // Skip the shard if the stressor thread wants to leave
+    if (threadFinished_[shard].load(std::memory_order_relaxed)) {
+      XLOG_EVERY_MS(INFO, 100'000,
+                    folly::sformat("Thread {} finish, skip", shard));
+      return true;
+    }
+
+    if (!activeReqQ_[shard]->isFull()) {
+      auto status = activeReqQ_[shard]->write(blockCacheAdapter_,
+                                              timestamp,
+                                              nextReqId_,
+                                              op,
+                                              key,
+                                              rangeStart,
+                                              rangeEnd);
+      XCHECK(status);
+      shardStats_[shard].reqs.inc();
+      shardStats_[shard].bytes.add(rangeEnd - rangeStart + 1);
+      return true;
+    }
+
+    // Spin until the queue has room
+    queueProducerWaitCounts_.inc();
+    shardStats_[shard].producerWaits.inc();
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(kProducerConsumerWaitTimeUs));
+  }
+}
+
+uint32_t BlockChunkReplayGenerator::getLbaShard(const std::string& key,
+                                                uint64_t offset) {
+  if (mode_ != ReplayGeneratorConfig::SerializeMode::strict) {
+    return getShard(key);
+  }
+  const auto range = static_cast<uint32_t>(offset / lbaShardSize_);
+  return folly::hash::SpookyHashV2::Hash32(key.data(), key.size(), range) %
+         numShards_;
+}
+
+double BlockChunkReplayGenerator::getShardReqsImbalance() const {
+  uint64_t total = 0;
+  uint64_t max = 0;
+  for (const auto& stats : shardStats_) {
+    total += stats.reqs.get();
+    max = std::max(max, stats.reqs.get());
+  }
+  return total == 0 ? 0.0
+                    : static_cast<double>(max) * shardStats_.size() / total;
+}
+
+void BlockChunkReplayGenerator::renderShardStats(std::ostream& out) const {
+  out << "= Shard stats =" << std::endl;
+  out << folly::sformat("Shard Reqs Imbalance (max/avg) : {:.2f}",
+                        getShardReqsImbalance())
+      << std::endl;
+  for (size_t i = 0; i < shardStats_.size(); i++) {
+    const auto& stats = shardStats_[i];
+    out << folly::sformat(
+               "Shard {:3} : reqs {:>12}, bytes {:>16}, producer waits {:>10}, "
+               "consumer waits {:>10}",
+               i, stats.reqs.get(), stats.bytes.get(),
+               stats.producerWaits.get(), stats.consumerWaits.get())
+        << std::endl;
+  }
+}
+
 } // namespace cachebench
 } // namespace cachelib
 } // namespace facebook
@@ -38,8 +38,19 @@ class BlockChunkReplayGenerator : public ReplayGeneratorBase {
         traceStream_(config, 0, columnTable_),
         blockCacheAdapter_(config.replayGeneratorConfig.blockSizeKB * 1024,
                            config.replayGeneratorConfig.chunkSizeKB * 1024),
+        lbaShardSize_(
+            static_cast<uint64_t>(config.replayGeneratorConfig.lbaShardSizeKB) *
+            1024),
         activeReqQ_(config.numThreads),
-        threadFinished_(config.numThreads) {
+        threadFinished_(config.numThreads),
+        shardStats_(config.numThreads) {
+    const auto& replayConfig = config.replayGeneratorConfig;
+    if (replayConfig.chunkSizeKB == 0 ||
+        replayConfig.lbaShardSizeKB % replayConfig.chunkSizeKB != 0) {
+      throw std::invalid_argument(folly::sformat(
+          "lbaShardSizeKB ({}) must be a multiple of chunkSizeKB ({})",
+          replayConfig.lbaShardSizeKB, replayConfig.chunkSizeKB));
+    }
     for (uint32_t i = 0; i < numShards_; ++i) {
       activeReqQ_[i] =
           std::make_unique<folly::ProducerConsumerQueue<BlockReqWrapper>>(
@@ -83,11 +94,13 @@ class BlockChunkReplayGenerator : public ReplayGeneratorBase {
 
   void renderStats(uint64_t elapsedTimeNs, std::ostream& out) const override {
     blockCacheAdapter_.getStats().renderStats(elapsedTimeNs, out);
+    renderShardStats(out);
   }
 
   void renderStats(uint64_t elapsedTimeNs,
                    folly::UserCounters& counters) const override {
     blockCacheAdapter_.getStats().renderStats(elapsedTimeNs, counters);
+    counters["shard_reqs_imbalance"] = getShardReqsImbalance();
   }
 
   void renderWindowStats(double elapsedSecs, std::ostream& out) const override {
@@ -99,8 +112,36 @@ class BlockChunkReplayGenerator : public ReplayGeneratorBase {
   }
 
  private:
+  // requests and waits of the queue of a stressor thread
+  struct ShardStats {
+    AtomicCounter reqs{0};
+    AtomicCounter bytes{0};
+    AtomicCounter producerWaits{0};
+    AtomicCounter consumerWaits{0};
+  };
+
   void getReqFromTrace();
 
+  // push a request to the queue of its shard, waiting for room
+  //
+  // @return false if the replay is shutting down
+  bool pushReq(uint32_t shard,
+               uint64_t timestamp,
+               OpType op,
+               const std::string& key,
+               uint64_t rangeStart,
+               uint64_t rangeEnd);
+
+  // @return the shard of the IOs to the range of the block that starts at
+  //         offset. Ranges of a block are spread across the shards like
+  //         blocks are.
+  uint32_t getLbaShard(const std::string& key, uint64_t offset);
+
+  // @return the ratio of the most requests queued to a shard to the average
+  double getShardReqsImbalance() const;
+
+  void renderShardStats(std::ostream& out) const;
+
   OpType getOpType(const std::string& opName) {
     if (!opName.compare(0, 12, "getChunkData")) {
       return OpType::kGet;
@@ -148,6 +189,10 @@ class BlockChunkReplayGenerator : public ReplayGeneratorBase {
 
   BlockChunkCacheAdapter blockCacheAdapter_;
 
+  // size of the ranges of a block that requests are sharded by, 0 to shard
+  // them by block
+  const uint64_t lbaShardSize_;
+
   uint64_t nextReqId_{1};
 
   // Used to assign tlStickyIdx_
@@ -168,6 +213,9 @@ class BlockChunkReplayGenerator : public ReplayGeneratorBase {
   // further request on its shard
   std::vector<std::atomic<bool>> threadFinished_;
 
+  // indexed like activeReqQ_
+  std::vector<ShardStats> shardStats_;
+
   // The thread used to process trace file and generate workloads for each
   // activeReqQ_ queue.
   std::thread traceGenThread_;
@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/cachebench/workload/ColumnarTrace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <folly/Format.h>
+#include <folly/Varint.h>
+#include <folly/compression/Compression.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+namespace {
+void appendU64(std::string& out, uint64_t val) {
+  val = folly::Endian::little(val);
+  out.append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+uint64_t readU64(folly::StringPiece data, size_t offset) {
+  uint64_t val;
+  std::memcpy(&val, data.data() + offset, sizeof(val));
+  return folly::Endian::little(val);
+}
+
+void appendVarint(std::string& out, uint64_t val) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  out.append(reinterpret_cast<const char*>(buf),
+             folly::encodeVarint(val, buf));
+}
+
+// Reads the columns of a decompressed block
+class BlockDecoder {
+ public:
+  explicit BlockDecoder(folly::StringPiece data)
+      : data_(reinterpret_cast<const uint8_t*>(data.begin()),
+              reinterpret_cast<const uint8_t*>(data.end())) {}
+
+  uint64_t varint() {
+    auto val = folly::tryDecodeVarint(data_);
+    if (!val.hasValue()) {
+      throw std::runtime_error("Corrupt columnar trace block: bad varint");
+    }
+    return val.value();
+  }
+
+  uint8_t byte() {
+    if (data_.empty()) {
+      throw std::runtime_error("Corrupt columnar trace block: truncated");
+    }
+    auto val = data_.front();
+    data_.advance(1);
+    return val;
+  }
+
+  folly::StringPiece bytes(size_t size) {
+    if (data_.size() < size) {
+      throw std::runtime_error("Corrupt columnar trace block: truncated");
+    }
+    folly::StringPiece val{reinterpret_cast<const char*>(data_.data()), size};
+    data_.advance(size);
+    return val;
+  }
+
+ private:
+  folly::ByteRange data_;
+};
+} // namespace
+
+bool ColumnarTrace::isColumnarTrace(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char header[sizeof(uint64_t)];
+  if (!in.read(header, sizeof(header))) {
+    return false;
+  }
+  return readU64(folly::StringPiece{header, sizeof(header)}, 0) == kMagic;
+}
+
+ColumnarTraceWriter::ColumnarTraceWriter(const std::string& path,
+                                         size_t recordsPerBlock,
+                                         int compressionLevel)
+    : path_(path),
+      recordsPerBlock_(recordsPerBlock),
+      compressionLevel_(compressionLevel),
+      out_(path, std::ios::binary | std::ios::trunc) {
+  if (!out_ || recordsPerBlock_ == 0) {
+    throw std::invalid_argument(folly::sformat(
+        "Can not write columnar trace {} with {} requests per block", path_,
+        recordsPerBlock_));
+  }
+  pending_.reserve(recordsPerBlock_);
+
+  std::string header;
+  appendU64(header, ColumnarTrace::kMagic);
+  appendU64(header, ColumnarTrace::kVersion);
+  write(header);
+}
+
+ColumnarTraceWriter::~ColumnarTraceWriter() {
+  try {
+    finish();
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "Failed to finish columnar trace {}: {}", path_, e.what());
+  }
+}
+
+void ColumnarTraceWriter::add(ColumnarTraceRecord record) {
+  XCHECK(!finished_);
+  pending_.push_back(std::move(record));
+  if (pending_.size() == recordsPerBlock_) {
+    writeBlock();
+  }
+}
+
+void ColumnarTraceWriter::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  writeBlock();
+
+  std::string footer;
+  const auto indexOffset = offset_;
+  for (const auto& info : index_) {
+    appendU64(footer, info.offset);
+    appendU64(footer, info.compressedSize);
+    appendU64(footer, info.size);
+    appendU64(footer, info.firstRecord);
+    appendU64(footer, info.numRecords);
+    appendU64(footer, info.firstTimestamp);
+  }
+  appendU64(footer, indexOffset);
+  appendU64(footer, index_.size());
+  appendU64(footer, numRecords_);
+  appendU64(footer, ColumnarTrace::kMagic);
+  write(footer);
+  out_.close();
+  if (out_.fail()) {
+    throw std::runtime_error(
+        folly::sformat("Failed to close columnar trace {}", path_));
+  }
+}
+
+void ColumnarTraceWriter::writeBlock() {
+  if (pending_.empty()) {
+    return;
+  }
+
+  std::string block;
+  appendVarint(block, pending_.size());
+
+  // dictionary of the distinct keys of the block, by first appearance
+  std::unordered_map<folly::StringPiece, uint64_t> keyIds;
+  std::vector<folly::StringPiece> keys;
+  std::vector<uint64_t> ids;
+  ids.reserve(pending_.size());
+  for (const auto& record : pending_) {
+    auto res = keyIds.emplace(record.key, keys.size());
+    if (res.second) {
+      keys.push_back(record.key);
+    }
+    ids.push_back(res.first->second);
+  }
+  appendVarint(block, keys.size());
+  for (auto key : keys) {
+    appendVarint(block, key.size());
+    block.append(key.data(), key.size());
+  }
+
+  uint64_t prevTimestamp = 0;
+  for (const auto& record : pending_) {
+    appendVarint(block, folly::encodeZigZag(static_cast<int64_t>(
+                            record.timestamp - prevTimestamp)));
+    prevTimestamp = record.timestamp;
+  }
+  for (auto id : ids) {
+    appendVarint(block, id);
+  }
+  for (const auto& record : pending_) {
+    block.push_back(static_cast<char>(record.op));
+  }
+  for (const auto& record : pending_) {
+    appendVarint(block, record.valueSize);
+  }
+  for (const auto& record : pending_) {
+    appendVarint(block, record.opCount);
+  }
+  for (const auto& record : pending_) {
+    appendVarint(block, record.ttlSecs);
+  }
+
+  auto codec =
+      folly::io::getCodec(folly::io::CodecType::ZSTD, compressionLevel_);
+  auto compressed = codec->compress(block);
+
+  ColumnarTrace::BlockInfo info;
+  info.offset = offset_;
+  info.compressedSize = compressed.size();
+  info.size = block.size();
+  info.firstRecord = numRecords_;
+  info.numRecords = pending_.size();
+  info.firstTimestamp = pending_.front().timestamp;
+  index_.push_back(info);
+
+  write(compressed);
+  numRecords_ += pending_.size();
+  pending_.clear();
+}
+
+void ColumnarTraceWriter::write(folly::StringPiece data) {
+  out_.write(data.data(), data.size());
+  if (!out_) {
+    throw std::runtime_error(
+        folly::sformat("Failed to write columnar trace {}", path_));
+  }
+  offset_ += data.size();
+}
+
+ColumnarTraceReader::ColumnarTraceReader(const std::string& path)
+    : path_(path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::invalid_argument(
+        folly::sformat("Failed to open columnar trace {}", path));
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    throw std::invalid_argument(
+        folly::sformat("Failed to read the size of columnar trace {}", path));
+  }
+  const size_t fileSize = fileStat.st_size;
+  if (fileSize < ColumnarTrace::kHeaderSize + ColumnarTrace::kTrailerSize) {
+    close(fd);
+    throw std::invalid_argument(
+        folly::sformat("{} is too short for a columnar trace", path));
+  }
+  void* data = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::invalid_argument(folly::sformat(
+        "Failed to map columnar trace {}: {}", path, strerror(errno)));
+  }
+  mapping_ = std::shared_ptr<const void>(data, [fileSize](const void* p) {
+    munmap(const_cast<void*>(p), fileSize);
+  });
+  data_ = folly::StringPiece{static_cast<const char*>(data), fileSize};
+
+  const auto trailer = fileSize - ColumnarTrace::kTrailerSize;
+  if (readU64(data_, 0) != ColumnarTrace::kMagic ||
+      readU64(data_, trailer + 24) != ColumnarTrace::kMagic) {
+    throw std::invalid_argument(
+        folly::sformat("{} is not a columnar trace", path));
+  }
+  if (readU64(data_, 8) != ColumnarTrace::kVersion) {
+    throw std::invalid_argument(
+        folly::sformat("Unsupported version {} of columnar trace {}",
+                       readU64(data_, 8), path));
+  }
+
+  const auto indexOffset = readU64(data_, trailer);
+  const auto numBlocks = readU64(data_, trailer + 8);
+  numRecords_ = readU64(data_, trailer + 16);
+  if (indexOffset < ColumnarTrace::kHeaderSize || indexOffset > trailer ||
+      (trailer - indexOffset) / ColumnarTrace::kIndexEntrySize != numBlocks) {
+    throw std::invalid_argument(
+        folly::sformat("Corrupt index in columnar trace {}", path));
+  }
+
+  index_.reserve(numBlocks);
+  for (size_t i = 0; i < numBlocks; i++) {
+    const auto entry = indexOffset + i * ColumnarTrace::kIndexEntrySize;
+    ColumnarTrace::BlockInfo info;
+    info.offset = readU64(data_, entry);
+    info.compressedSize = readU64(data_, entry + 8);
+    info.size = readU64(data_, entry + 16);
+    info.firstRecord = readU64(data_, entry + 24);
+    info.numRecords = readU64(data_, entry + 32);
+    info.firstTimestamp = readU64(data_, entry + 40);
+    if (info.offset < ColumnarTrace::kHeaderSize ||
+        info.offset + info.compressedSize > indexOffset) {
+      throw std::invalid_argument(
+          folly::sformat("Corrupt index in columnar trace {}", path));
+    }
+    index_.push_back(info);
+  }
+}
+
+size_t ColumnarTraceReader::findBlockByRecord(uint64_t record) const {
+  if (record >= numRecords_) {
+    return index_.size();
+  }
+  auto it = std::upper_bound(
+      index_.begin(), index_.end(), record,
+      [](uint64_t r, const ColumnarTrace::BlockInfo& info) {
+        return r < info.firstRecord;
+      });
+  return std::distance(index_.begin(), it) - 1;
+}
+
+size_t ColumnarTraceReader::findBlockByTimestamp(uint64_t timestamp) const {
+  // the requests at timestamp may start in the block before the first one
+  // starting after it
+  auto it = std::upper_bound(
+      index_.begin(), index_.end(), timestamp,
+      [](uint64_t t, const ColumnarTrace::BlockInfo& info) {
+        return t <= info.firstTimestamp;
+      });
+  return it == index_.begin() ? 0 : std::distance(index_.begin(), it) - 1;
+}
+
+std::vector<ColumnarTraceRecord> ColumnarTraceReader::decodeBlock(
+    size_t block) const {
+  const auto& info = index_.at(block);
+  thread_local auto codec = folly::io::getCodec(folly::io::CodecType::ZSTD);
+  const auto data = codec->uncompress(
+      data_.subpiece(info.offset, info.compressedSize), info.size);
+
+  BlockDecoder decoder{data};
+  const auto numRecords = decoder.varint();
+  if (numRecords != info.numRecords) {
+    throw std::runtime_error(folly::sformat(
+        "Corrupt block {} of columnar trace {}: {} requests instead of {}",
+        block, path_, numRecords, info.numRecords));
+  }
+  std::vector<folly::StringPiece> keys(decoder.varint());
+  for (auto& key : keys) {
+    key = decoder.bytes(decoder.varint());
+  }
+
+  std::vector<ColumnarTraceRecord> records(numRecords);
+  uint64_t timestamp = 0;
+  for (auto& record : records) {
+    timestamp += folly::decodeZigZag(decoder.varint());
+    record.timestamp = timestamp;
+  }
+  for (auto& record : records) {
+    const auto id = decoder.varint();
+    if (id >= keys.size()) {
+      throw std::runtime_error(folly::sformat(
+          "Corrupt block {} of columnar trace {}: key id {} of {}", block,
+          path_, id, keys.size()));
+    }
+    record.key = keys[id].str();
+  }
+  for (auto& record : records) {
+    record.op = static_cast<OpType>(decoder.byte());
+  }
+  for (auto& record : records) {
+    record.valueSize = decoder.varint();
+  }
+  for (auto& record : records) {
+    record.opCount = static_cast<uint32_t>(decoder.varint());
+  }
+  for (auto& record : records) {
+    record.ttlSecs = static_cast<uint32_t>(decoder.varint());
+  }
+  return records;
+}
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
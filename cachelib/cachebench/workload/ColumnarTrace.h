@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cachelib/cachebench/util/Request.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// A request of a key-value trace, as replayed by KVReplayGenerator
+struct ColumnarTraceRecord {
+  // timestamp in microseconds
+  uint64_t timestamp{0};
+  std::string key;
+  OpType op{OpType::kGet};
+  uint64_t valueSize{0};
+  uint32_t opCount{1};
+  uint32_t ttlSecs{0};
+};
+
+// Compact trace format for key-value traces.
+//
+// The requests are stored in blocks of consecutive requests. A block is laid
+// out column by column so that similar values compress together:
+// timestamps as deltas from the previous request, keys as ids into a
+// dictionary of the distinct keys of the block, then ops, value sizes, op
+// counts and ttls. Integers are varints and every block is compressed with
+// zstd on its own. An index at the end of the file has the offset, the first
+// request and the first timestamp of every block, so that a reader can seek
+// and decode blocks concurrently without decoding what precedes them.
+//
+// File layout, integers in little endian:
+//   magic (8B) | version (8B) | block... | index entry... | trailer
+//   index entry: offset, compressed size, decompressed size, first request,
+//                number of requests, first timestamp (8B each)
+//   trailer: index offset, number of blocks, number of requests, magic
+//            (8B each)
+struct ColumnarTrace {
+  static constexpr uint64_t kMagic = 0x3145435254434c43; // "CLCTRCE1"
+  static constexpr uint64_t kVersion = 2;
+  static constexpr size_t kHeaderSize = 16;
+  static constexpr size_t kIndexEntrySize = 48;
+  static constexpr size_t kTrailerSize = 32;
+
+  struct BlockInfo {
+    uint64_t offset{0};
+    uint64_t compressedSize{0};
+    uint64_t size{0};
+    uint64_t firstRecord{0};
+    uint64_t numRecords{0};
+    uint64_t firstTimestamp{0};
+  };
+
+  // @return true if the file at @path starts like a columnar trace
+  static bool isColumnarTrace(const std::string& path);
+};
+
+// Writes a columnar trace, buffering one block of requests at a time.
+class ColumnarTraceWriter {
+ public:
+  // @param path              file to create, truncated if it exists
+  // @param recordsPerBlock   requests in a block. Larger blocks compress
+  //                          better while a seek decodes more requests.
+  // @param compressionLevel  zstd level of the blocks
+  //
+  // @throw std::invalid_argument if the file can not be created or
+  //        recordsPerBlock is 0
+  explicit ColumnarTraceWriter(const std::string& path,
+                               size_t recordsPerBlock = 64 * 1024,
+                               int compressionLevel = 3);
+
+  // finishes the file if finish() was not called
+  ~ColumnarTraceWriter();
+
+  ColumnarTraceWriter(const ColumnarTraceWriter&) = delete;
+  ColumnarTraceWriter& operator=(const ColumnarTraceWriter&) = delete;
+
+  void add(ColumnarTraceRecord record);
+
+  // Writes the pending block and the index. Nothing can be added afterwards.
+  //
+  // @throw std::runtime_error on a write error
+  void finish();
+
+  uint64_t getNumRecords() const { return numRecords_; }
+
+ private:
+  void writeBlock();
+
+  void write(folly::StringPiece data);
+
+  const std::string path_;
+  const size_t recordsPerBlock_;
+  const int compressionLevel_;
+
+  std::ofstream out_;
+  uint64_t offset_{0};
+  uint64_t numRecords_{0};
+  bool finished_{false};
+
+  std::vector<ColumnarTraceRecord> pending_;
+  std::vector<ColumnarTrace::BlockInfo> index_;
+};
+
+// Reads a columnar trace from a memory mapping of the file. Blocks are
+// decoded independently; every method is const and thread safe.
+class ColumnarTraceReader {
+ public:
+  // @throw std::invalid_argument if the file can not be read or is not a
+  //        columnar trace
+  explicit ColumnarTraceReader(const std::string& path);
+
+  ColumnarTraceReader(const ColumnarTraceReader&) = delete;
+  ColumnarTraceReader& operator=(const ColumnarTraceReader&) = delete;
+
+  size_t getNumBlocks() const { return index_.size(); }
+  uint64_t getNumRecords() const { return numRecords_; }
+  const ColumnarTrace::BlockInfo& getBlockInfo(size_t block) const {
+    return index_.at(block);
+  }
+
+  // @return the block holding the request at @record, getNumBlocks() past
+  //         the end of the trace
+  size_t findBlockByRecord(uint64_t record) const;
+
+  // @return the first block that may hold requests at or after @timestamp,
+  //         for a trace whose timestamps do not decrease
+  size_t findBlockByTimestamp(uint64_t timestamp) const;
+
+  // @return the requests of @block, in order
+  // @throw std::runtime_error if the block is corrupt
+  std::vector<ColumnarTraceRecord> decodeBlock(size_t block) const;
+
+ private:
+  const std::string path_;
+  std::shared_ptr<const void> mapping_;
+  folly::StringPiece data_;
+  uint64_t numRecords_{0};
+  std::vector<ColumnarTrace::BlockInfo> index_;
+};
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -68,11 +68,17 @@ class GeneratorBase {
   }
 
   // Should be called when all working threads are finished, or aborted
-  void markShutdown() { isShutdown_.store(true, std::memory_order_relaxed); }
+  virtual void markShutdown() {
+    isShutdown_.store(true, std::memory_order_relaxed);
+  }
 
   // Should be called when working thread finish its operations
   virtual void markFinish() {}
 
+  // Index of the tenant served to the calling stressor thread by generators
+  // running several workloads, see StressorConfig::tenants.
+  virtual size_t getTenant() { return 0; }
+
  protected:
   bool shouldShutdown() const {
     return isShutdown_.load(std::memory_order_relaxed);
@@ -24,10 +24,14 @@
 #include <folly/synchronization/Latch.h>
 #include <folly/system/ThreadName.h>
 
+#include <limits>
+#include <mutex>
+
 #include "cachelib/cachebench/cache/Cache.h"
 #include "cachelib/cachebench/util/Exceptions.h"
 #include "cachelib/cachebench/util/Parallel.h"
 #include "cachelib/cachebench/util/Request.h"
+#include "cachelib/cachebench/workload/ColumnarTrace.h"
 #include "cachelib/cachebench/workload/ReplayGeneratorBase.h"
 
 namespace facebook {
@@ -76,6 +80,13 @@ struct ReqWrapper {
 // In order to minimize the contentions for the request submission queues
 // which might need to be dispatched by multiple stressor threads,
 // the requests are sharded to each stressor by doing hashing over the key.
+//
+// With numParserThreads set, the trace files are memory mapped and split in
+// chunks of whole lines which are parsed concurrently. Every stressor takes
+// its requests from the parsed chunks in the order of the chunks in the
+// trace, so the requests for a key are still replayed in order. Columnar
+// traces (see ColumnarTrace.h) are always replayed this way, a block per
+// chunk.
 class KVReplayGenerator : public ReplayGeneratorBase {
  public:
   // Default order is key,op,size,op_count,key_size,ttl
@@ -162,6 +173,47 @@ class KVReplayGenerator : public ReplayGeneratorBase {
       }
       close(fd);
       exit(0);
+    } else if (!config.replayGeneratorConfig.columnarFileName.empty()) {
+      if (repeatTraceReplay_) {
+        throw std::invalid_argument(
+            "Cannot generate a columnar trace with repeatTraceReplay");
+      }
+      folly::setThreadName("cb_columnar_gen");
+      writeColumnarTrace(
+          getTraceFilePath(config.replayGeneratorConfig.columnarFileName));
+      exit(0);
+    } else if (numParserThreads_ > 0 || isColumnarTrace()) {
+      if (isColumnarTrace()) {
+        auto fileNames = config.traceFileNames;
+        if (!config.traceFileName.empty()) {
+          fileNames = {config.traceFileName};
+        }
+        for (const auto& fileName : fileNames) {
+          columnarTraces_.push_back(std::make_shared<ColumnarTraceReader>(
+              getTraceFilePath(fileName)));
+        }
+        fastForwardColumnarTraces(fastForwardCount_);
+      } else {
+        mmapStream_ =
+            std::make_unique<MmapTraceStream>(config, kParseChunkBytes);
+        try {
+          mmapStream_->fastForwardTrace(fastForwardCount_);
+        } catch (const EndOfTrace&) {
+          // the first parser to ask for a chunk ends the trace
+        }
+      }
+      // columnar traces are always decoded in parallel
+      const auto numParsers = std::max<uint32_t>(numParserThreads_, 1);
+      // a parser can run ahead of the slowest stressor by a couple of chunks
+      for (size_t i = 0; i < 2 * numParsers; i++) {
+        parsedChunks_.emplace_back(std::make_unique<ParsedChunk>());
+      }
+      for (uint32_t i = 0; i < numParsers; i++) {
+        parserWorkers_.emplace_back([this, i, &latch] {
+          folly::setThreadName(folly::sformat("cb_replay_gen_{}", i));
+          parseChunks(i, latch);
+        });
+      }
     } else {
       genWorker_ = std::thread([this, &latch] {
         folly::setThreadName("cb_replay_gen");
@@ -183,6 +235,9 @@ class KVReplayGenerator : public ReplayGeneratorBase {
     if (genWorker_.joinable()) {
       genWorker_.join();
     }
+    for (auto& worker : parserWorkers_) {
+      worker.join();
+    }
   }
 
   // getReq generates the next request from the trace file.
@@ -205,7 +260,9 @@ class KVReplayGenerator : public ReplayGeneratorBase {
   void markFinish() override { getStressorCtx().markFinish(); }
 
   // Parse the request from the trace line and set the ReqWrapper
-  bool parseRequest(const std::string& line, std::unique_ptr<ReqWrapper>& req);
+  bool parseRequest(const std::string& line, std::unique_ptr<ReqWrapper>& req) {
+    return parseRequest(traceStream_, line, req);
+  }
 
   // for unit test
   bool setHeaderRow(const std::string& header) {
@@ -220,6 +277,10 @@ class KVReplayGenerator : public ReplayGeneratorBase {
   static constexpr uint64_t checkIntervalUs_ = 100;
   static constexpr size_t kMaxRequests = 10000;
   static constexpr size_t kMinKeySize = 16;
+  // Bytes of trace lines parsed at once with numParserThreads
+  static constexpr size_t kParseChunkBytes = 256 * 1024;
+  // Sequence number of a ParsedChunk not holding any chunk yet
+  static constexpr uint64_t kNoChunk = std::numeric_limits<uint64_t>::max();
 
   using ReqQueue = folly::ProducerConsumerQueue<std::unique_ptr<ReqWrapper>>;
 
@@ -244,11 +305,90 @@ class KVReplayGenerator : public ReplayGeneratorBase {
     // Thread that finish its operations mark it here, so we will skip
     // further request on its shard
     std::atomic<bool> finished_{false};
+
+    // With numParserThreads, the next request to replay is at this index in
+    // the parsed chunk of this sequence number. Only the stressor thread
+    // accesses them.
+    uint64_t nextChunkSeq_{0};
+    size_t nextChunkIdx_{0};
+    // Number of parsed chunks the stressor thread is done with. The parsers
+    // reuse their memory for later chunks.
+    std::atomic<uint64_t> consumedChunks_{0};
+  };
+
+  // Requests parsed from a chunk of the trace by the parser threads
+  struct ParsedChunk {
+    // sequence number of the chunk in the trace. Set once the requests are
+    // in place.
+    std::atomic<uint64_t> seq{kNoChunk};
+    // true past the end of the trace
+    bool last{false};
+    // requests of the chunk by shard
+    std::vector<std::vector<std::unique_ptr<ReqWrapper>>> reqs;
   };
 
   // Read next trace line from TraceFileStream and fill ReqWrapper
   std::unique_ptr<ReqWrapper> getReqInternal();
 
+  // Parse the request from the trace line with the header row set in
+  // @stream and set the ReqWrapper
+  bool parseRequest(TraceFileStream& stream,
+                    folly::StringPiece line,
+                    std::unique_ptr<ReqWrapper>& req);
+
+  // Make the key of @req unique to its @keySuffix copy when the key
+  // population is amplified
+  void amplifyKey(ReqWrapper& req, size_t keySuffix) const;
+
+  // Body of the parser thread @id: parses chunks of the trace until its end
+  void parseChunks(uint32_t id, folly::Latch& latch);
+
+  // A block of a columnar trace to decode, skipping its first requests
+  struct ColumnarBlock {
+    std::shared_ptr<const ColumnarTraceReader> trace;
+    size_t index{0};
+    size_t skip{0};
+  };
+
+  // Skip the first @fastForwardCount requests of the columnar traces
+  void fastForwardColumnarTraces(uint64_t fastForwardCount);
+
+  // @return next block of the columnar traces
+  // @throw EndOfTrace at the end of the traces
+  ColumnarBlock getNextColumnarBlockLocked();
+
+  // Convert the trace to a columnar trace at @path
+  void writeColumnarTrace(const std::string& path);
+
+  // Wait for the stressors to be done with the parsed chunk preceding the
+  // one of sequence number @seq in parsedChunks_
+  //
+  // @return false if the test is shutting down
+  bool waitForChunk(uint64_t seq, folly::Latch& latch);
+
+  // Next request of the stressor from the parsed chunks
+  //
+  // @throw EndOfTrace at the end of the trace or on shutdown
+  std::unique_ptr<ReqWrapper> getParsedReq(StressorCtx& stressorCtx);
+
+  // @return true if the first trace file is a columnar trace
+  bool isColumnarTrace() const {
+    if (!config_.traceFileName.empty()) {
+      return ColumnarTrace::isColumnarTrace(
+          getTraceFilePath(config_.traceFileName));
+    }
+    return !config_.traceFileNames.empty() &&
+           ColumnarTrace::isColumnarTrace(
+               getTraceFilePath(config_.traceFileNames.front()));
+  }
+
+  // Release the constructor once the requests are preloaded
+  void markPreloaded(folly::Latch& latch) {
+    if (!preloaded_.exchange(true)) {
+      latch.count_down();
+    }
+  }
+
   // Used to assign stressorIdx_
   std::atomic<uint32_t> incrementalIdx_{0};
 
@@ -268,6 +408,28 @@ class KVReplayGenerator : public ReplayGeneratorBase {
 
   std::thread genWorker_;
 
+  // Parallel ingestion with numParserThreads
+  const uint32_t numParserThreads_{
+      config_.replayGeneratorConfig.numParserThreads};
+  std::vector<std::thread> parserWorkers_;
+
+  // protects mmapStream_ and the fields after it
+  std::mutex mmapStreamMutex_;
+  // the trace is split in chunks of lines of csv files, or in the blocks
+  // of columnar traces
+  std::unique_ptr<MmapTraceStream> mmapStream_;
+  std::vector<std::shared_ptr<const ColumnarTraceReader>> columnarTraces_;
+  size_t nextColumnarTrace_{0};
+  size_t nextColumnarBlock_{0};
+  size_t columnarSkip_{0};
+  uint64_t nextChunkSeq_{0};
+  bool mmapStreamEnded_{false};
+
+  // ring of the chunks parsed ahead of the stressors, by sequence number
+  std::vector<std::unique_ptr<ParsedChunk>> parsedChunks_;
+  std::atomic<uint64_t> numParsedReqs_{0};
+  std::atomic<bool> preloaded_{false};
+
   // Used to signal end of file as EndOfTrace exception
   std::atomic<bool> eof{false};
 
@@ -294,23 +456,24 @@ class KVReplayGenerator : public ReplayGeneratorBase {
   }
 };
 
-inline bool KVReplayGenerator::parseRequest(const std::string& line,
+inline bool KVReplayGenerator::parseRequest(TraceFileStream& stream,
+                                            folly::StringPiece line,
                                             std::unique_ptr<ReqWrapper>& req) {
-  if (!traceStream_.setNextLine(line)) {
+  if (!stream.setNextLine(line)) {
     return false;
   }
 
-  auto sizeField = traceStream_.template getField<size_t>(SampleFields::SIZE);
+  auto sizeField = stream.template getField<size_t>(SampleFields::SIZE);
   if (!sizeField.hasValue()) {
     return false;
   }
 
   // Set key
-  auto parsedKey = traceStream_.template getField<>(SampleFields::KEY).value();
+  auto parsedKey = stream.template getField<>(SampleFields::KEY).value();
   req->updateKey(std::string{parsedKey});
 
   auto keySizeField =
-      traceStream_.template getField<size_t>(SampleFields::KEY_SIZE);
+      stream.template getField<size_t>(SampleFields::KEY_SIZE);
   if (keySizeField.hasValue()) {
     // The key is encoded as <encoded key, key size>.
     // Generate key whose size matches with that of the original one
@@ -324,15 +487,19 @@ inline bool KVReplayGenerator::parseRequest(const std::string& line,
 
   // Convert timestamp to seconds.
   auto timestampField =
-      traceStream_.template getField<uint64_t>(SampleFields::OP_TIME);
+      stream.template getField<uint64_t>(SampleFields::OP_TIME);
   if (timestampField.hasValue()) {
     uint64_t timestampRaw = timestampField.value();
     uint64_t timestampSeconds = timestampRaw / timestampFactor_;
     req->req_.timestamp = timestampSeconds;
+    // split to not overflow with a fine grained raw timestamp
+    req->req_.timestampUs =
+        timestampSeconds * 1000000 +
+        timestampRaw % timestampFactor_ * 1000000 / timestampFactor_;
   }
 
   // Set op
-  auto op = traceStream_.template getField<>(SampleFields::OP).value();
+  auto op = stream.template getField<>(SampleFields::OP).value();
   // TODO implement GET_LEASE and SET_LEASE emulations
   if (!op.compare("GET") || !op.compare("GET_LEASE")) {
     req->req_.setOp(OpType::kGet);
@@ -349,7 +516,7 @@ inline bool KVReplayGenerator::parseRequest(const std::string& line,
 
   // Set op_count
   auto opCountField =
-      traceStream_.template getField<uint32_t>(SampleFields::OP_COUNT);
+      stream.template getField<uint32_t>(SampleFields::OP_COUNT);
   req->repeats_ = static_cast<uint16_t>(opCountField.value_or(1));
   if (!req->repeats_) {
     return false;
@@ -359,7 +526,7 @@ inline bool KVReplayGenerator::parseRequest(const std::string& line,
   }
 
   // Set TTL (optional)
-  auto ttlField = traceStream_.template getField<size_t>(SampleFields::TTL);
+  auto ttlField = stream.template getField<size_t>(SampleFields::TTL);
   req->req_.ttlSecs = ttlField.value_or(0);
 
   return true;
@@ -383,6 +550,24 @@ inline std::unique_ptr<ReqWrapper> KVReplayGenerator::getReqInternal() {
   return reqWrapper;
 }
 
+inline void KVReplayGenerator::amplifyKey(ReqWrapper& req,
+                                          size_t keySuffix) const {
+  if (ampFactor_ <= 1) {
+    return;
+  }
+  // Replace the last 4 bytes with thread Id of 4 decimal chars. In doing
+  // so, keep at least 10B from the key for uniqueness; 10B is the max
+  // number of decimal digits for uint32_t which is used to encode the key
+  auto key = req.key_;
+  if (key.size() > kMinKeySize) {
+    // trunkcate the key
+    size_t newSize = std::max<size_t>(key.size() - 4, kMinKeySize);
+    key.resize(newSize, '0');
+  }
+  key.append(folly::sformat("{:04d}", keySuffix));
+  req.updateKey(key);
+}
+
 inline void KVReplayGenerator::genRequests(folly::Latch& latch) {
   bool init = true;
   uint64_t nreqs = 0;
@@ -411,17 +596,7 @@ inline void KVReplayGenerator::genRequests(folly::Latch& latch) {
       }
 
       size_t keySize = req->key_.size();
-      if (ampFactor_ > 1) {
-        // Replace the last 4 bytes with thread Id of 4 decimal chars. In doing
-        // so, keep at least 10B from the key for uniqueness; 10B is the max
-        // number of decimal digits for uint32_t which is used to encode the key
-        if (req->key_.size() > kMinKeySize) {
-          // trunkcate the key
-          size_t newSize = std::max<size_t>(req->key_.size() - 4, kMinKeySize);
-          req->key_.resize(newSize, '0');
-        }
-        req->key_.append(folly::sformat("{:04d}", keySuffix));
-      }
+      amplifyKey(*req, keySuffix);
 
       if (makeBinaryFile_) {
         uint8_t op = static_cast<uint8_t>(req->req_.getOp());
@@ -501,6 +676,258 @@ inline void KVReplayGenerator::genRequests(folly::Latch& latch) {
   setEOF();
 }
 
+inline void KVReplayGenerator::parseChunks(uint32_t id, folly::Latch& latch) {
+  // every parser keeps its own field map
+  TraceFileStream stream(config_, id, columnTable_);
+  std::string header;
+  std::vector<std::vector<std::unique_ptr<ReqWrapper>>> reqs(numShards_);
+
+  while (!shouldShutdown()) {
+    MmapTraceStream::Chunk chunk;
+    ColumnarBlock block;
+    uint64_t seq;
+    bool last = false;
+    {
+      std::lock_guard<std::mutex> l(mmapStreamMutex_);
+      if (mmapStreamEnded_) {
+        break;
+      }
+      seq = nextChunkSeq_++;
+      try {
+        if (mmapStream_) {
+          chunk = mmapStream_->getNextChunk();
+        } else {
+          block = getNextColumnarBlockLocked();
+        }
+      } catch (const EndOfTrace&) {
+        // the stressors stop at the chunk holding the end of the trace
+        mmapStreamEnded_ = true;
+        last = true;
+      }
+    }
+
+    uint64_t numLines = 0;
+    uint64_t numErrors = 0;
+    uint64_t numReqs = 0;
+    auto addReq = [&](std::unique_ptr<ReqWrapper> reqWrapper) {
+      numLines++;
+      for (size_t keySuffix = 0; keySuffix < ampFactor_; keySuffix++) {
+        std::unique_ptr<ReqWrapper> req;
+        // Use a copy of ReqWrapper except for the last one
+        if (keySuffix == ampFactor_ - 1) {
+          req.swap(reqWrapper);
+        } else {
+          req = std::make_unique<ReqWrapper>(*reqWrapper);
+        }
+        amplifyKey(*req, keySuffix);
+        reqs[getShard(req->req_.key)].push_back(std::move(req));
+        numReqs++;
+      }
+    };
+
+    if (block.trace) {
+      std::vector<ColumnarTraceRecord> records;
+      try {
+        records = block.trace->decodeBlock(block.index);
+      } catch (const std::runtime_error& e) {
+        numErrors += block.trace->getBlockInfo(block.index).numRecords;
+        XLOG(ERR) << e.what();
+      }
+      for (size_t i = block.skip; i < records.size(); i++) {
+        auto& record = records[i];
+        auto reqWrapper = std::make_unique<ReqWrapper>();
+        reqWrapper->updateKey(record.key);
+        reqWrapper->req_.setOp(record.op);
+        reqWrapper->req_.timestamp = record.timestamp / 1000000;
+        reqWrapper->req_.timestampUs = record.timestamp;
+        reqWrapper->req_.ttlSecs = record.ttlSecs;
+        reqWrapper->sizes_[0] = record.valueSize;
+        reqWrapper->repeats_ = config_.ignoreOpCount
+                                   ? 1
+                                   : static_cast<uint16_t>(record.opCount);
+        addReq(std::move(reqWrapper));
+      }
+    } else if (!last) {
+      if (chunk.header != header) {
+        header = chunk.header.str();
+        stream.resetHeaderRow(header);
+      }
+      auto lines = chunk.lines;
+      while (!lines.empty()) {
+        auto eol = lines.find('\n');
+        auto line =
+            eol == folly::StringPiece::npos ? lines : lines.subpiece(0, eol);
+        lines.advance(eol == folly::StringPiece::npos ? lines.size()
+                                                      : eol + 1);
+
+        auto reqWrapper = std::make_unique<ReqWrapper>();
+        if (!parseRequest(stream, line, reqWrapper)) {
+          numErrors++;
+          XLOG_N_PER_MS(ERR, 10, 1000)
+              << folly::sformat("Parsing error: {}", line);
+          continue;
+        }
+        addReq(std::move(reqWrapper));
+      }
+    }
+    parseSuccess += numLines;
+    parseError += numErrors;
+
+    if (!waitForChunk(seq, latch)) {
+      break;
+    }
+    auto& parsed = *parsedChunks_[seq % parsedChunks_.size()];
+    parsed.reqs.swap(reqs);
+    parsed.last = last;
+    parsed.seq.store(seq, std::memory_order_release);
+    for (auto& shardReqs : reqs) {
+      // the requests were taken by the stressors
+      shardReqs.clear();
+    }
+    reqs.resize(numShards_);
+
+    numParsedReqs_ += numReqs;
+    if (last || numParsedReqs_.load() >= preLoadReqs_) {
+      markPreloaded(latch);
+    }
+    if (last) {
+      break;
+    }
+  }
+
+  setEOF();
+  markPreloaded(latch);
+}
+
+inline void KVReplayGenerator::fastForwardColumnarTraces(
+    uint64_t fastForwardCount) {
+  for (; nextColumnarTrace_ < columnarTraces_.size(); nextColumnarTrace_++) {
+    const auto& trace = *columnarTraces_[nextColumnarTrace_];
+    if (fastForwardCount < trace.getNumRecords()) {
+      // seek with the index
+      nextColumnarBlock_ = trace.findBlockByRecord(fastForwardCount);
+      columnarSkip_ = fastForwardCount -
+                      trace.getBlockInfo(nextColumnarBlock_).firstRecord;
+      return;
+    }
+    fastForwardCount -= trace.getNumRecords();
+  }
+}
+
+inline KVReplayGenerator::ColumnarBlock
+KVReplayGenerator::getNextColumnarBlockLocked() {
+  bool restarted = false;
+  while (true) {
+    if (nextColumnarTrace_ >= columnarTraces_.size()) {
+      if (!repeatTraceReplay_ || restarted) {
+        throw cachelib::cachebench::EndOfTrace("");
+      }
+      XLOGF_EVERY_MS(
+          INFO, 60'000,
+          "Reached the end of trace files. Restarting from beginning.");
+      nextColumnarTrace_ = 0;
+      nextColumnarBlock_ = 0;
+      // an empty trace ends even when repeated
+      restarted = true;
+    }
+
+    const auto& trace = columnarTraces_[nextColumnarTrace_];
+    if (nextColumnarBlock_ < trace->getNumBlocks()) {
+      ColumnarBlock block{trace, nextColumnarBlock_++, columnarSkip_};
+      columnarSkip_ = 0;
+      return block;
+    }
+    nextColumnarTrace_++;
+    nextColumnarBlock_ = 0;
+  }
+}
+
+inline void KVReplayGenerator::writeColumnarTrace(const std::string& path) {
+  traceStream_.fastForwardTrace(fastForwardCount_);
+  ColumnarTraceWriter writer(path);
+  XLOGF(INFO, "Started generating columnar trace {} from KVReplayGenerator",
+        path);
+  while (true) {
+    std::unique_ptr<ReqWrapper> reqWrapper;
+    try {
+      reqWrapper = getReqInternal();
+    } catch (const EndOfTrace&) {
+      break;
+    }
+    ColumnarTraceRecord record;
+    record.timestamp = reqWrapper->req_.timestampUs;
+    record.key = std::move(reqWrapper->key_);
+    record.op = reqWrapper->req_.getOp();
+    record.valueSize = reqWrapper->sizes_[0];
+    record.opCount = reqWrapper->repeats_;
+    record.ttlSecs = reqWrapper->req_.ttlSecs;
+    writer.add(std::move(record));
+    if (writer.getNumRecords() % BIN_REQ_INT == 0 &&
+        writer.getNumRecords() > 0) {
+      XLOGF(INFO, "Converted: {} reqs", writer.getNumRecords());
+    }
+  }
+  writer.finish();
+  XLOGF(INFO, "Finished columnar trace {} with {} reqs (parse error: {})",
+        path, writer.getNumRecords(), parseError.load());
+}
+
+inline bool KVReplayGenerator::waitForChunk(uint64_t seq,
+                                            folly::Latch& latch) {
+  const auto numChunks = parsedChunks_.size();
+  if (seq < numChunks) {
+    return true;
+  }
+  while (!shouldShutdown()) {
+    // the chunk that was parsed numChunks before must be replayed by every
+    // stressor still running
+    bool replayed = true;
+    for (const auto& stressorCtx : stressorCtxs_) {
+      if (!stressorCtx->isFinished() &&
+          stressorCtx->consumedChunks_.load(std::memory_order_acquire) <=
+              seq - numChunks) {
+        replayed = false;
+        break;
+      }
+    }
+    if (replayed) {
+      return true;
+    }
+    // the stressors are behind; enough requests are ready to start
+    markPreloaded(latch);
+    std::this_thread::sleep_for(std::chrono::microseconds{checkIntervalUs_});
+  }
+  return false;
+}
+
+inline std::unique_ptr<ReqWrapper> KVReplayGenerator::getParsedReq(
+    StressorCtx& stressorCtx) {
+  while (true) {
+    auto& chunk =
+        *parsedChunks_[stressorCtx.nextChunkSeq_ % parsedChunks_.size()];
+    if (chunk.seq.load(std::memory_order_acquire) !=
+        stressorCtx.nextChunkSeq_) {
+      if (shouldShutdown()) {
+        throw cachelib::cachebench::EndOfTrace("Test stopped");
+      }
+      // ProducerConsumerQueue does not support blocking, so use sleep
+      std::this_thread::sleep_for(std::chrono::microseconds{checkIntervalUs_});
+      continue;
+    }
+    if (chunk.last) {
+      throw cachelib::cachebench::EndOfTrace("EOF reached");
+    }
+
+    auto& reqs = chunk.reqs[stressorCtx.id_];
+    if (stressorCtx.nextChunkIdx_ < reqs.size()) {
+      return std::move(reqs[stressorCtx.nextChunkIdx_++]);
+    }
+    stressorCtx.nextChunkIdx_ = 0;
+    stressorCtx.consumedChunks_.store(++stressorCtx.nextChunkSeq_,
+                                      std::memory_order_release);
+  }
+}
+
 const Request& KVReplayGenerator::getReq(uint8_t,
                                          std::mt19937_64&,
                                          std::optional<uint64_t>) {
@@ -510,12 +937,19 @@ const Request& KVReplayGenerator::getReq(uint8_t,
   auto& reqQ = *stressorCtx.reqQueue_;
   auto& resubmitQueue = stressorCtx.resubmitQueue_;
 
-  while (resubmitQueue.empty() && !reqQ.read(reqWrapper)) {
-    if (resubmitQueue.empty() && isEOF()) {
-      throw cachelib::cachebench::EndOfTrace("Test stopped or EOF reached");
+  if (!parsedChunks_.empty()) {
+    if (resubmitQueue.empty()) {
+      reqWrapper = getParsedReq(stressorCtx);
+    }
+  } else {
+    while (resubmitQueue.empty() && !reqQ.read(reqWrapper)) {
+      if (resubmitQueue.empty() && isEOF()) {
+        throw cachelib::cachebench::EndOfTrace("Test stopped or EOF reached");
+      }
+      // ProducerConsumerQueue does not support blocking, so use sleep
+      std::this_thread::sleep_for(
+          std::chrono::microseconds{checkIntervalUs_});
     }
-    // ProducerConsumerQueue does not support blocking, so use sleep
-    std::this_thread::sleep_for(std::chrono::microseconds{checkIntervalUs_});
   }
 
   if (!reqWrapper) {
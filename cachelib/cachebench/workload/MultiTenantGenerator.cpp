@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/cachebench/workload/MultiTenantGenerator.h"
+
+#include <folly/Format.h>
+#include <folly/logging/xlog.h>
+
+#include <stdexcept>
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+MultiTenantGenerator::MultiTenantGenerator(
+    const StressorConfig& config,
+    std::vector<std::unique_ptr<GeneratorBase>> generators) {
+  if (generators.size() != config.tenants.size()) {
+    throw std::invalid_argument(
+        folly::sformat("{} tenant generators for {} tenants",
+                       generators.size(), config.tenants.size()));
+  }
+  for (size_t i = 0; i < generators.size(); i++) {
+    const auto& tenantConfig = config.tenants[i];
+    Tenant tenant;
+    tenant.name = tenantConfig.name.empty() ? folly::sformat("tenant_{}", i)
+                                            : tenantConfig.name;
+    tenant.generator = std::move(generators[i]);
+    if (tenantConfig.opRatePerSec > 0) {
+      tenant.rateLimiter = std::make_unique<folly::BasicTokenBucket<>>(
+          tenantConfig.opRatePerSec, tenantConfig.opRateBurstSize > 0
+                                         ? tenantConfig.opRateBurstSize
+                                         : tenantConfig.opRatePerSec);
+    }
+    tenants_.push_back(std::move(tenant));
+    threadTenants_.insert(threadTenants_.end(), tenantConfig.numThreads,
+                          static_cast<uint32_t>(i));
+  }
+}
+
+const Request& MultiTenantGenerator::getReq(
+    uint8_t, std::mt19937_64& gen, std::optional<uint64_t> lastRequestId) {
+  auto& tenant = tenants_[getTenant()];
+  if (tenant.rateLimiter) {
+    tenant.rateLimiter->consumeWithBorrowAndWait(1);
+  }
+  return tenant.generator->getReq(0, gen, lastRequestId);
+}
+
+size_t MultiTenantGenerator::getTenant() {
+  if (!tenantIdx_.get()) {
+    const auto idx = incrementalIdx_++;
+    XCHECK_LT(idx, threadTenants_.size());
+    tenantIdx_.reset(new uint32_t(threadTenants_[idx]));
+  }
+  return *tenantIdx_;
+}
+
+void MultiTenantGenerator::setNvmCacheWarmedUp(uint64_t timestamp) {
+  for (auto& tenant : tenants_) {
+    tenant.generator->setNvmCacheWarmedUp(timestamp);
+  }
+}
+
+void MultiTenantGenerator::renderStats(uint64_t elapsedTimeNs,
+                                       std::ostream& out) const {
+  for (const auto& tenant : tenants_) {
+    out << "== Workload of " << tenant.name << " ==" << std::endl;
+    tenant.generator->renderStats(elapsedTimeNs, out);
+  }
+}
+
+void MultiTenantGenerator::renderStats(uint64_t elapsedTimeNs,
+                                       folly::UserCounters& counters) const {
+  for (const auto& tenant : tenants_) {
+    tenant.generator->renderStats(elapsedTimeNs, counters);
+  }
+}
+
+void MultiTenantGenerator::renderWindowStats(double elapsedSecs,
+                                             std::ostream& out) const {
+  for (const auto& tenant : tenants_) {
+    tenant.generator->renderWindowStats(elapsedSecs, out);
+  }
+}
+
+void MultiTenantGenerator::markShutdown() {
+  GeneratorBase::markShutdown();
+  for (auto& tenant : tenants_) {
+    tenant.generator->markShutdown();
+  }
+}
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <folly/TokenBucket.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/util/Request.h"
+#include "cachelib/cachebench/workload/GeneratorBase.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// Runs the workloads of several tenants side by side, as configured by
+// StressorConfig::tenants. Each tenant has its own generator, replay or
+// synthetic, and its own subset of the stressor threads: the first threads
+// to call in serve the first tenant and so on. The requests of a tenant can
+// be rate limited on their own.
+class MultiTenantGenerator : public GeneratorBase {
+ public:
+  // @param config      stressor config with the tenants
+  // @param generators  generator of every tenant, in the order of
+  //                    config.tenants
+  MultiTenantGenerator(const StressorConfig& config,
+                       std::vector<std::unique_ptr<GeneratorBase>> generators);
+
+  // the request of the tenant of the calling thread, after waiting for its
+  // rate limit. Tenant generators always get pool 0, their only one.
+  const Request& getReq(uint8_t poolId,
+                        std::mt19937_64& gen,
+                        std::optional<uint64_t> lastRequestId) override;
+
+  void notifyResult(uint64_t requestId, OpResultType result) override {
+    getTenantGenerator().notifyResult(requestId, result);
+  }
+
+  // keys are not shared between the tenants
+  const std::vector<std::string>& getAllKeys() const override {
+    throw std::logic_error("MultiTenantGenerator has no keys precomputed!");
+  }
+
+  void setNvmCacheWarmedUp(uint64_t timestamp) override;
+
+  void renderStats(uint64_t elapsedTimeNs, std::ostream& out) const override;
+
+  void renderStats(uint64_t elapsedTimeNs,
+                   folly::UserCounters& counters) const override;
+
+  void renderWindowStats(double elapsedSecs, std::ostream& out) const override;
+
+  void markShutdown() override;
+
+  void markFinish() override { getTenantGenerator().markFinish(); }
+
+  size_t getTenant() override;
+
+ private:
+  struct Tenant {
+    std::string name;
+    std::unique_ptr<GeneratorBase> generator;
+    std::unique_ptr<folly::BasicTokenBucket<>> rateLimiter;
+  };
+
+  GeneratorBase& getTenantGenerator() {
+    return *tenants_[getTenant()].generator;
+  }
+
+  std::vector<Tenant> tenants_;
+
+  // tenant of every stressor thread, in the order they first call in
+  std::vector<uint32_t> threadTenants_;
+
+  // Used to assign tenantIdx_
+  std::atomic<uint32_t> incrementalIdx_{0};
+
+  // tenant of the calling stressor thread
+  folly::ThreadLocalPtr<uint32_t> tenantIdx_;
+};
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
 
 #include "cachelib/common/Utils.h"
@@ -28,6 +29,9 @@ namespace cachebench {
 
 OnlineGenerator::OnlineGenerator(const StressorConfig& config)
     : config_{config},
+      // keys are the idx followed by a padding that only depends on the
+      // length, so only the idx is written for each request
+      key_([this]() { return new std::string(maxKeyLength_, 'a'); }),
       req_([&]() { return Request(*key_, dummy_.begin(), dummy_.end()); }) {
   for (const auto& c : config_.poolDistributions) {
     if (c.keySizeRange.size() != c.keySizeRangeProbability.size() + 1) {
@@ -55,12 +59,10 @@ const Request& OnlineGenerator::getReq(uint8_t poolId,
                                        std::optional<uint64_t>) {
   size_t keyIdx = getKeyIdx(poolId, gen);
 
-  std::string key(req_->key);
-  generateKey(poolId, keyIdx, key);
   auto sizes = generateSize(poolId, keyIdx);
   req_->sizeBegin = sizes->begin();
   req_->sizeEnd = sizes->end();
-  req_->key = key;
+  req_->key = generateKey(poolId, keyIdx, *key_);
   auto op =
       static_cast<OpType>(workloadDist_[workloadIdx(poolId)].sampleOpDist(gen));
   req_->setOp(op);
@@ -78,24 +80,23 @@ void OnlineGenerator::generateKeyLengths() {
                        workloadDist_[workloadIdx(i)].sampleKeySizeDist(gen)),
                    sizeof(size_t));
       keyLengths_.back().emplace_back(keySize);
+      maxKeyLength_ = std::max(maxKeyLength_, keySize);
     }
   }
 }
 
-void OnlineGenerator::generateKey(uint8_t pid, size_t idx, std::string& key) {
-  // All keys are printable lower case english alphabet. we need to ensure the
-  // key lengths are consistent for an idx.
+std::string_view OnlineGenerator::generateKey(uint8_t pid,
+                                              size_t idx,
+                                              std::string& buffer) {
+  // we need to ensure the key lengths are consistent for an idx.
   const auto keySize = keyLengths_[pid][idx % keyLengths_[pid].size()];
   XDCHECK_GE(keySize, sizeof(idx));
-  key.resize(keySize);
-
-  // write the idx into the key and pad any additional bytes with same bytes.
-  auto* idxChars = reinterpret_cast<char*>(&idx);
-  std::memcpy(key.data(), idxChars, sizeof(idx));
-  // pad (deterministically)
-  for (size_t i = sizeof(idx); i < keySize; i++) {
-    key[i] = 'a';
-  }
+  XDCHECK_LE(keySize, buffer.size());
+
+  // write the idx into the key. The rest of the buffer is already padded
+  // with the same bytes.
+  std::memcpy(buffer.data(), &idx, sizeof(idx));
+  return std::string_view{buffer.data(), keySize};
 }
 
 typename std::vector<std::vector<size_t>>::iterator
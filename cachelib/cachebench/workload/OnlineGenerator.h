@@ -23,6 +23,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "cachelib/cachebench/cache/Cache.h"
@@ -53,7 +54,11 @@ class OnlineGenerator : public GeneratorBase {
  private:
   uint64_t getKeyIdx(uint8_t poolId, std::mt19937_64& gen);
   void generateFirstKeyIndexForPool();
-  void generateKey(uint8_t poolId, size_t idx, std::string& key);
+  // Write the key of the idx into the buffer of the calling thread, which
+  // is padded in advance, so that this neither allocates nor fills the key.
+  //
+  // @return the key, valid until the next call on the same thread
+  std::string_view generateKey(uint8_t poolId, size_t idx, std::string& buffer);
   void generateKeyLengths();
 
   void generateSizes();
@@ -75,6 +80,9 @@ class OnlineGenerator : public GeneratorBase {
   // the size corresponding to a key id is always the same.
   std::vector<std::vector<size_t>> keyLengths_;
 
+  // length of the longest key, to which the key buffers are padded
+  size_t maxKeyLength_{0};
+
   // used for thread local intialization
   std::vector<size_t> dummy_;
 
@@ -88,7 +96,7 @@ class OnlineGenerator : public GeneratorBase {
   // popularity distribution for keys per pool
   std::vector<std::unique_ptr<Distribution>> workloadPopDist_;
 
-  // thread local copy of key and  request to return as a part of getReq
+  // thread local key buffer and request to return as a part of getReq
   class Tag;
   folly::ThreadLocal<std::string, Tag> key_;
   folly::ThreadLocal<Request, Tag> req_;
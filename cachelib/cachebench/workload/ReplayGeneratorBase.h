@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -169,7 +170,7 @@ class TraceFileStream {
     }
   }
 
-  bool setNextLine(const std::string& line) {
+  bool setNextLine(folly::StringPiece line) {
     nextLineFields_.clear();
     folly::split(",", line, nextLineFields_);
     if (nextLineFields_.size() < minNumFields_) {
@@ -265,6 +266,14 @@ class TraceFileStream {
     return true;
   }
 
+  // Sets the header row of the lines parsed next, falling back to the default
+  // column order if it is not a valid header
+  void resetHeaderRow(const std::string& header) {
+    if (!setHeaderRow(header)) {
+      fieldMap_.clear();
+    }
+  }
+
  private:
   bool openNextInfile() {
     if (nextInfileIdx_ >= infileNames_.size()) {
@@ -305,9 +314,7 @@ class TraceFileStream {
     std::string headerLine;
     std::getline(infile_, headerLine);
 
-    if (!setHeaderRow(headerLine)) {
-      fieldMap_.clear();
-    }
+    resetHeaderRow(headerLine);
     return true;
   }
 
@@ -341,6 +348,134 @@ class TraceFileStream {
   std::vector<std::string> keys_;
 };
 
+// Hands out the lines of the trace files in chunks, so that the chunks can
+// be parsed concurrently. The files are memory mapped instead of read
+// through a stream, and every chunk ends on a line boundary. Not thread
+// safe.
+class MmapTraceStream {
+ public:
+  // whole lines of a trace file along with the header row of the file
+  struct Chunk {
+    folly::StringPiece header;
+    folly::StringPiece lines;
+    // keeps the file mapped while the chunk is in use
+    std::shared_ptr<const void> mapping;
+  };
+
+  // @param chunkBytes  a chunk is the lines overlapping its first chunkBytes
+  MmapTraceStream(const StressorConfig& config, size_t chunkBytes)
+      : configPath_(config.configPath),
+        repeatTraceReplay_(config.repeatTraceReplay),
+        chunkBytes_(std::max<size_t>(chunkBytes, 1)) {
+    if (!config.traceFileName.empty()) {
+      infileNames_.push_back(config.traceFileName);
+    } else {
+      infileNames_ = config.traceFileNames;
+    }
+  }
+
+  // Skips the first @fastForwardCount lines of the trace, not counting the
+  // header rows.
+  void fastForwardTrace(uint64_t fastForwardCount) {
+    for (uint64_t count = 0; count < fastForwardCount; count++) {
+      while (remaining_.empty()) {
+        openNextInfile(); // can throw
+      }
+      auto eol = remaining_.find('\n');
+      remaining_.advance(eol == folly::StringPiece::npos ? remaining_.size()
+                                                         : eol + 1);
+    }
+  }
+
+  // @return the next chunk of at least one line
+  // @throw EndOfTrace when all the trace files were handed out and the trace
+  //        is not replayed repeatedly
+  Chunk getNextChunk() {
+    while (remaining_.empty()) {
+      openNextInfile(); // can throw
+    }
+
+    size_t size = std::min(chunkBytes_, remaining_.size());
+    auto eol = remaining_.find('\n', size - 1);
+    size = eol == folly::StringPiece::npos ? remaining_.size() : eol + 1;
+    Chunk chunk{header_, remaining_.subpiece(0, size), mapping_};
+    remaining_.advance(size);
+    return chunk;
+  }
+
+ private:
+  bool openNextInfile() {
+    if (nextInfileIdx_ >= infileNames_.size()) {
+      if (!repeatTraceReplay_) {
+        throw cachelib::cachebench::EndOfTrace("");
+      }
+
+      XLOGF_EVERY_MS(
+          INFO, 60'000,
+          "Reached the end of trace files. Restarting from beginning.");
+      nextInfileIdx_ = 0;
+    }
+
+    mapping_.reset();
+    header_.clear();
+    remaining_.clear();
+
+    const std::string& traceFileName = infileNames_[nextInfileIdx_++];
+    std::string filePath;
+    if (traceFileName[0] == '/') {
+      filePath = traceFileName;
+    } else {
+      filePath = folly::sformat("{}/{}", configPath_, traceFileName);
+    }
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+      XLOGF(ERR, "Failed to open trace file {}", filePath);
+      return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+      XLOGF(ERR, "Failed to read the size of trace file {}", filePath);
+      close(fd);
+      return false;
+    }
+    const size_t fileSize = fileStat.st_size;
+    void* data = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      XLOGF(ERR, "Failed to map trace file {}: {}", filePath, strerror(errno));
+      return false;
+    }
+    madvise(data, fileSize, MADV_SEQUENTIAL);
+    mapping_ = std::shared_ptr<const void>(data, [fileSize](const void* p) {
+      munmap(const_cast<void*>(p), fileSize);
+    });
+
+    XLOGF(INFO, "Mapped trace file {}", filePath);
+    folly::StringPiece contents{static_cast<const char*>(data), fileSize};
+    auto eol = contents.find('\n');
+    if (eol == folly::StringPiece::npos) {
+      header_ = contents;
+    } else {
+      header_ = contents.subpiece(0, eol);
+      remaining_ = contents.subpiece(eol + 1);
+    }
+    return true;
+  }
+
+  std::string configPath_;
+  const bool repeatTraceReplay_;
+  const size_t chunkBytes_;
+
+  std::vector<std::string> infileNames_;
+  size_t nextInfileIdx_ = 0;
+
+  // current file, its header row and its lines not handed out yet
+  std::shared_ptr<const void> mapping_;
+  folly::StringPiece header_;
+  folly::StringPiece remaining_;
+};
+
 class BinaryFileStream {
  public:
   BinaryFileStream(const StressorConfig& config)
@@ -502,6 +637,15 @@ class ReplayGeneratorBase : public GeneratorBase {
 
   std::vector<std::string> keys_;
 
+  // Return the path of the trace file @fileName, which is relative to the
+  // directory of the config unless it is absolute.
+  std::string getTraceFilePath(const std::string& fileName) const {
+    if (!fileName.empty() && fileName[0] == '/') {
+      return fileName;
+    }
+    return folly::sformat("{}/{}", config_.configPath, fileName);
+  }
+
   // Return the shard for the key.
   uint32_t getShard(folly::StringPiece key) {
     if (mode_ == ReplayGeneratorConfig::SerializeMode::strict) {
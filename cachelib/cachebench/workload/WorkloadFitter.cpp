@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/cachebench/workload/WorkloadFitter.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+
+#include "cachelib/cachebench/workload/WorkloadDistribution.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+namespace {
+// keys with access counts within this factor of the most accessed key of a
+// popularity bucket share the bucket
+constexpr double kBucketCountFactor = 1.1;
+
+// the online generator keeps the key index in the first bytes of the key
+constexpr uint32_t kMinKeySize = sizeof(uint64_t);
+
+OpType normalizeOp(OpType op) {
+  switch (op) {
+  case OpType::kLoneGet:
+  case OpType::kCouldExist:
+    return OpType::kGet;
+  case OpType::kLoneSet:
+  case OpType::kUpdate:
+  case OpType::kAddChained:
+    return OpType::kSet;
+  default:
+    return op;
+  }
+}
+
+// Fenwick tree over the access times, counting the keys whose last access
+// was at a given time
+class AccessTimes {
+ public:
+  explicit AccessTimes(size_t size) : tree_(size + 1, 0) {}
+
+  void add(size_t time, int64_t delta) {
+    for (size_t i = time + 1; i < tree_.size(); i += i & (~i + 1)) {
+      tree_[i] += delta;
+    }
+  }
+
+  // number of keys last accessed before @time
+  int64_t countBefore(size_t time) const {
+    int64_t count = 0;
+    for (size_t i = time; i > 0; i -= i & (~i + 1)) {
+      count += tree_[i];
+    }
+    return count;
+  }
+
+ private:
+  std::vector<int64_t> tree_;
+};
+} // namespace
+
+WorkloadFitter::WorkloadFitter(unsigned sizePrecisionBits)
+    : sizePrecisionBits_(sizePrecisionBits) {
+  if (sizePrecisionBits_ == 0 || sizePrecisionBits_ >= 64) {
+    throw std::invalid_argument(folly::sformat(
+        "invalid value size precision of {} bits", sizePrecisionBits_));
+  }
+}
+
+void WorkloadFitter::add(folly::StringPiece key,
+                         OpType op,
+                         uint64_t valueSize) {
+  auto [it, inserted] =
+      keyIds_.try_emplace(key.str(), static_cast<uint32_t>(keys_.size()));
+  if (inserted) {
+    XCHECK_LT(keys_.size(), std::numeric_limits<uint32_t>::max());
+    keys_.emplace_back();
+    keys_.back().keySize = static_cast<uint32_t>(key.size());
+  }
+
+  op = normalizeOp(op);
+  auto& info = keys_[it->second];
+  info.count++;
+  if (op != OpType::kDel && valueSize > 0) {
+    info.valueSize = valueSize;
+  }
+  accesses_.push_back({it->second, op});
+}
+
+WorkloadFitter::Fit WorkloadFitter::fit() const {
+  Fit fit;
+  auto& dist = fit.distribution;
+  fit.numOps = accesses_.size();
+
+  // op mix, with requests for keys accessed once as lone ones
+  uint64_t gets = 0, sets = 0, dels = 0, loneGets = 0, loneSets = 0;
+  for (const auto& access : accesses_) {
+    const bool lone = keys_[access.key].count == 1;
+    switch (access.op) {
+    case OpType::kGet:
+      (lone ? loneGets : gets)++;
+      break;
+    case OpType::kSet:
+      (lone ? loneSets : sets)++;
+      break;
+    default:
+      dels++;
+      break;
+    }
+  }
+  if (fit.numOps > 0) {
+    const double numOps = static_cast<double>(fit.numOps);
+    dist.getRatio = gets / numOps;
+    dist.setRatio = sets / numOps;
+    dist.delRatio = dels / numOps;
+    dist.loneGetRatio = loneGets / numOps;
+    dist.loneSetRatio = loneSets / numOps;
+  }
+  fit.enableLookaside = sets + loneSets == 0;
+
+  // popularity, from the access counts of the keys by rank
+  std::vector<uint64_t> counts;
+  std::map<uint32_t, uint64_t> keySizes;
+  for (const auto& info : keys_) {
+    if (info.count > 1) {
+      counts.push_back(info.count);
+      keySizes[std::max(info.keySize, kMinKeySize)]++;
+      fit.footprintBytes += info.keySize + info.valueSize;
+    }
+  }
+  if (counts.empty()) {
+    throw std::invalid_argument("no key of the trace is accessed twice");
+  }
+  fit.numKeys = counts.size();
+  std::sort(counts.begin(), counts.end(), std::greater<uint64_t>());
+
+  for (size_t i = 0; i < counts.size();) {
+    const auto first = counts[i];
+    uint64_t weight = 0;
+    size_t j = i;
+    for (; j < counts.size() && counts[j] * kBucketCountFactor >= first; j++) {
+      weight += counts[j];
+    }
+    dist.popularityBuckets.push_back(j - i);
+    dist.popularityWeights.push_back(static_cast<double>(weight));
+    i = j;
+  }
+
+  // least squares fit of log(count) on log(rank), at ranks spread evenly on
+  // the log scale so that the tail does not dominate
+  double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+  size_t numPoints = 0;
+  for (size_t rank = 1; rank <= counts.size(); rank *= 2) {
+    const double x = std::log(static_cast<double>(rank));
+    const double y = std::log(static_cast<double>(counts[rank - 1]));
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+    numPoints++;
+  }
+  const double denominator = numPoints * sumXX - sumX * sumX;
+  if (numPoints > 1 && denominator > 0) {
+    fit.zipfAlpha = -(numPoints * sumXY - sumX * sumY) / denominator;
+  }
+
+  // key sizes as unit intervals, with nothing in between
+  for (auto it = keySizes.begin(); it != keySizes.end(); ++it) {
+    if (it != keySizes.begin()) {
+      dist.keySizeRangeProbability.push_back(0);
+    }
+    dist.keySizeRange.push_back(it->first);
+    dist.keySizeRange.push_back(it->first + 1);
+    dist.keySizeRangeProbability.push_back(static_cast<double>(it->second));
+  }
+
+  // value sizes of all the keys, as a discrete distribution of the sizes
+  // rounded up to their most significant bits
+  std::map<uint64_t, uint64_t> valueSizes;
+  for (const auto& info : keys_) {
+    auto size = info.valueSize;
+    if (size == 0) {
+      continue;
+    }
+    const auto bits = folly::findLastSet(size);
+    if (bits > sizePrecisionBits_) {
+      const auto shift = bits - sizePrecisionBits_;
+      size = ((size + (1ULL << shift) - 1) >> shift) << shift;
+    }
+    valueSizes[size]++;
+  }
+  if (valueSizes.empty()) {
+    throw std::invalid_argument("no value sizes in the trace");
+  }
+  for (const auto& [size, count] : valueSizes) {
+    dist.valSizeRange.push_back(static_cast<double>(size));
+    dist.valSizeRangeProbability.push_back(static_cast<double>(count));
+  }
+  return fit;
+}
+
+std::vector<double> WorkloadFitter::getTraceMissRatios(
+    const std::vector<uint64_t>& cacheSizes) const {
+  return getLruMissRatios(accesses_, cacheSizes);
+}
+
+std::vector<double> WorkloadFitter::getSyntheticMissRatios(
+    const Fit& fit,
+    uint64_t numOps,
+    const std::vector<uint64_t>& cacheSizes,
+    uint64_t seed) {
+  if (fit.numKeys + numOps > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(folly::sformat(
+        "{} keys and {} ops are too many to simulate", fit.numKeys, numOps));
+  }
+  WorkloadDistribution workload{fit.distribution};
+  auto popDist = workload.getPopDist(0, fit.numKeys - 1);
+  std::mt19937_64 gen{seed};
+
+  std::vector<Access> accesses;
+  accesses.reserve(numOps);
+  // lone requests are for keys never accessed again
+  auto loneKey = static_cast<uint32_t>(fit.numKeys);
+  for (uint64_t i = 0; i < numOps; i++) {
+    const auto op = static_cast<OpType>(workload.sampleOpDist(gen));
+    switch (op) {
+    case OpType::kLoneGet:
+      accesses.push_back({loneKey++, OpType::kGet});
+      break;
+    case OpType::kLoneSet:
+      accesses.push_back({loneKey++, OpType::kSet});
+      break;
+    default:
+      accesses.push_back(
+          {static_cast<uint32_t>((*popDist)(gen)), normalizeOp(op)});
+      break;
+    }
+  }
+  return getLruMissRatios(accesses, cacheSizes);
+}
+
+std::vector<double> WorkloadFitter::getLruMissRatios(
+    const std::vector<Access>& accesses,
+    const std::vector<uint64_t>& cacheSizes) {
+  uint32_t maxKey = 0;
+  for (const auto& access : accesses) {
+    maxKey = std::max(maxKey, access.key);
+  }
+
+  // time of the last access of every key in the cache, -1 if not in it
+  std::vector<int64_t> lastAccess(static_cast<size_t>(maxKey) + 1, -1);
+  AccessTimes times{accesses.size()};
+  int64_t numCached = 0;
+
+  // stack distances of the gets that find their key in an unbounded cache
+  std::vector<uint64_t> distances;
+  uint64_t numGets = 0;
+  for (size_t t = 0; t < accesses.size(); t++) {
+    const auto& access = accesses[t];
+    auto& last = lastAccess[access.key];
+    if (access.op == OpType::kGet) {
+      numGets++;
+      if (last >= 0) {
+        const auto newer = numCached - times.countBefore(last + 1);
+        distances.push_back(static_cast<uint64_t>(newer) + 1);
+      }
+    }
+    if (last >= 0) {
+      times.add(last, -1);
+      numCached--;
+      last = -1;
+    }
+    // gets fill the cache on a miss, as lookaside caches do
+    if (access.op != OpType::kDel) {
+      times.add(t, 1);
+      numCached++;
+      last = static_cast<int64_t>(t);
+    }
+  }
+
+  std::sort(distances.begin(), distances.end());
+  std::vector<double> missRatios;
+  for (auto cacheSize : cacheSizes) {
+    if (numGets == 0) {
+      missRatios.push_back(0);
+      continue;
+    }
+    const auto hits = static_cast<uint64_t>(
+        std::upper_bound(distances.begin(), distances.end(), cacheSize) -
+        distances.begin());
+    missRatios.push_back(static_cast<double>(numGets - hits) / numGets);
+  }
+  return missRatios;
+}
+
+folly::dynamic WorkloadFitter::toConfig(const Fit& fit,
+                                        uint64_t numThreads,
+                                        const std::string& popFile,
+                                        const std::string& sizesFile) {
+  const auto& dist = fit.distribution;
+  // a cache for a tenth of the footprint, where the miss ratio curve tends
+  // to be steep
+  const uint64_t cacheSizeMB =
+      std::max<uint64_t>(64, fit.footprintBytes / 10 / 1024 / 1024);
+
+  folly::dynamic testConfig = folly::dynamic::object;
+  testConfig["generator"] = "online";
+  testConfig["enableLookaside"] = fit.enableLookaside;
+  testConfig["numThreads"] = numThreads;
+  testConfig["numOps"] = std::max<uint64_t>(1, fit.numOps / numThreads);
+  testConfig["numKeys"] = fit.numKeys;
+  testConfig["keySizeRange"] =
+      folly::dynamic(dist.keySizeRange.begin(), dist.keySizeRange.end());
+  testConfig["keySizeRangeProbability"] =
+      folly::dynamic(dist.keySizeRangeProbability.begin(),
+                            dist.keySizeRangeProbability.end());
+  testConfig["popDistFile"] = popFile;
+  testConfig["valSizeDistFile"] = sizesFile;
+  testConfig["getRatio"] = dist.getRatio;
+  testConfig["setRatio"] = dist.setRatio;
+  testConfig["delRatio"] = dist.delRatio;
+  testConfig["loneGetRatio"] = dist.loneGetRatio;
+  testConfig["loneSetRatio"] = dist.loneSetRatio;
+
+  return folly::dynamic::object(
+      "cache_config", folly::dynamic::object("cacheSizeMB", cacheSizeMB))(
+      "test_config", std::move(testConfig));
+}
+
+folly::dynamic WorkloadFitter::toPopularityConfig(const Fit& fit) {
+  const auto& dist = fit.distribution;
+  return folly::dynamic::object("zipfAlpha", fit.zipfAlpha)(
+      "popularityBuckets",
+      folly::dynamic(dist.popularityBuckets.begin(),
+                            dist.popularityBuckets.end()))(
+      "popularityWeights",
+      folly::dynamic(dist.popularityWeights.begin(),
+                            dist.popularityWeights.end()));
+}
+
+folly::dynamic WorkloadFitter::toSizesConfig(const Fit& fit) {
+  const auto& dist = fit.distribution;
+  return folly::dynamic::object(
+      "valSizeRange",
+      folly::dynamic(dist.valSizeRange.begin(),
+                            dist.valSizeRange.end()))(
+      "valSizeRangeProbability",
+      folly::dynamic(dist.valSizeRangeProbability.begin(),
+                            dist.valSizeRangeProbability.end()));
+}
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/dynamic.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/util/Request.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+
+// Fits the synthetic workload of cachebench to a key-value trace, so that a
+// workload like the traced one can be run and shared without the trace.
+//
+// The fit is an independent reference model, as run by the online and
+// workload generators:
+//  - popularity as buckets of keys with similar access counts, the rank
+//    frequency curve of the trace, plus a Zipf exponent for reference
+//  - keys accessed once as lone gets and sets
+//  - key sizes and rounded value sizes of the distinct keys
+//  - the mix of gets, sets and deletes
+// Temporal locality beyond popularity is not modeled. Comparing the miss
+// ratio curve of LRU on the trace with the one on the fitted workload shows
+// how much of the hit ratio depends on it.
+class WorkloadFitter {
+ public:
+  struct Fit {
+    // distribution to run, with the popularity and value sizes inline
+    DistributionConfig distribution;
+    // number of keys of the popularity distribution, without lone ones
+    uint64_t numKeys{0};
+    uint64_t numOps{0};
+    // requests of the trace are lookaside gets only, so sets follow misses
+    bool enableLookaside{false};
+    // exponent of the Zipf distribution closest to the popularity
+    double zipfAlpha{0};
+    // bytes of the keys and values of the popularity distribution
+    uint64_t footprintBytes{0};
+  };
+
+  // @param sizePrecisionBits   value sizes are rounded up to their most
+  //                            significant bits, 5 bits keeping them within
+  //                            3%, to bound the number of distinct sizes
+  explicit WorkloadFitter(unsigned sizePrecisionBits = 5);
+
+  // adds a request of the trace
+  void add(folly::StringPiece key, OpType op, uint64_t valueSize);
+
+  uint64_t getNumOps() const { return accesses_.size(); }
+  uint64_t getNumKeys() const { return keys_.size(); }
+
+  Fit fit() const;
+
+  // @return the miss ratios of gets of LRU caches of @cacheSizes objects on
+  //         the trace
+  std::vector<double> getTraceMissRatios(
+      const std::vector<uint64_t>& cacheSizes) const;
+
+  // @return the miss ratios of gets of LRU caches of @cacheSizes objects on
+  //         @numOps requests generated from @fit
+  static std::vector<double> getSyntheticMissRatios(
+      const Fit& fit,
+      uint64_t numOps,
+      const std::vector<uint64_t>& cacheSizes,
+      uint64_t seed = 1);
+
+  // cachebench config running @fit on @numThreads threads, with the
+  // popularity and value sizes in the files named @popFile and @sizesFile
+  static folly::dynamic toConfig(const Fit& fit,
+                                 uint64_t numThreads,
+                                 const std::string& popFile,
+                                 const std::string& sizesFile);
+  static folly::dynamic toPopularityConfig(const Fit& fit);
+  static folly::dynamic toSizesConfig(const Fit& fit);
+
+  struct Access {
+    uint32_t key;
+    OpType op;
+  };
+
+  // Miss ratios of gets of LRU caches of @cacheSizes objects, from stack
+  // distances. Gets and sets make their key the most recent one, as gets of
+  // a lookaside cache fill it on a miss, and deletes remove it. With deletes
+  // the curve is a close approximation, as the space they free goes to keys
+  // that an actual LRU cache would have evicted already.
+  static std::vector<double> getLruMissRatios(
+      const std::vector<Access>& accesses,
+      const std::vector<uint64_t>& cacheSizes);
+
+ private:
+  struct KeyInfo {
+    uint64_t count{0};
+    uint64_t valueSize{0};
+    uint32_t keySize{0};
+  };
+
+  const unsigned sizePrecisionBits_;
+
+  folly::F14FastMap<std::string, uint32_t> keyIds_;
+  std::vector<KeyInfo> keys_;
+  std::vector<Access> accesses_;
+};
+
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
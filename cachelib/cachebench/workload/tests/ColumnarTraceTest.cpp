@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Format.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "cachelib/cachebench/workload/ColumnarTrace.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+namespace tests {
+
+namespace {
+ColumnarTraceRecord makeRecord(uint64_t i) {
+  ColumnarTraceRecord record;
+  // a few timestamps going back, as in merged traces
+  record.timestamp = 1000 + i / 10 - (i % 7 == 0 ? 1 : 0);
+  record.key = folly::sformat("key_{}", i % 37);
+  record.op = i % 3 == 0 ? OpType::kSet : OpType::kGet;
+  record.valueSize = 100 + i;
+  record.opCount = 1 + i % 2;
+  record.ttlSecs = i % 5 == 0 ? 3600 : 0;
+  return record;
+}
+} // namespace
+
+TEST(ColumnarTraceTest, WriteAndRead) {
+  const auto path =
+      folly::sformat("/tmp/COLUMNAR_TRACE_WRITE_AND_READ-{}", ::getpid());
+  constexpr size_t kNumRecords = 1050;
+  {
+    ColumnarTraceWriter writer(path, 100 /* recordsPerBlock */);
+    for (size_t i = 0; i < kNumRecords; i++) {
+      writer.add(makeRecord(i));
+    }
+    writer.finish();
+  }
+  ASSERT_TRUE(ColumnarTrace::isColumnarTrace(path));
+
+  ColumnarTraceReader reader(path);
+  ASSERT_EQ(kNumRecords, reader.getNumRecords());
+  ASSERT_EQ(11, reader.getNumBlocks());
+  uint64_t i = 0;
+  for (size_t block = 0; block < reader.getNumBlocks(); block++) {
+    EXPECT_EQ(i, reader.getBlockInfo(block).firstRecord);
+    for (const auto& record : reader.decodeBlock(block)) {
+      const auto expected = makeRecord(i++);
+      EXPECT_EQ(expected.timestamp, record.timestamp);
+      EXPECT_EQ(expected.key, record.key);
+      EXPECT_EQ(expected.op, record.op);
+      EXPECT_EQ(expected.valueSize, record.valueSize);
+      EXPECT_EQ(expected.opCount, record.opCount);
+      EXPECT_EQ(expected.ttlSecs, record.ttlSecs);
+    }
+  }
+  EXPECT_EQ(kNumRecords, i);
+
+  EXPECT_EQ(0, reader.findBlockByRecord(0));
+  EXPECT_EQ(3, reader.findBlockByRecord(399));
+  EXPECT_EQ(4, reader.findBlockByRecord(400));
+  EXPECT_EQ(10, reader.findBlockByRecord(kNumRecords - 1));
+  EXPECT_EQ(11, reader.findBlockByRecord(kNumRecords));
+
+  EXPECT_EQ(0, reader.findBlockByTimestamp(0));
+  // requests 500 to 509 are at 1050; 500 starts block 5
+  EXPECT_EQ(4, reader.findBlockByTimestamp(1050));
+  EXPECT_EQ(5, reader.findBlockByTimestamp(1051));
+  EXPECT_EQ(10, reader.findBlockByTimestamp(5000));
+
+  std::remove(path.c_str());
+}
+
+TEST(ColumnarTraceTest, InvalidFile) {
+  const auto path =
+      folly::sformat("/tmp/COLUMNAR_TRACE_INVALID_FILE-{}", ::getpid());
+  {
+    std::ofstream out(path);
+    out << "key,op,size,op_count,key_size\n";
+    out << "key_1,GET,100,1,10\n";
+  }
+  EXPECT_FALSE(ColumnarTrace::isColumnarTrace(path));
+  EXPECT_THROW(ColumnarTraceReader{path}, std::invalid_argument);
+
+  {
+    ColumnarTraceWriter writer(path);
+    writer.add(makeRecord(0));
+  }
+  // truncate the index
+  ASSERT_EQ(0, ::truncate(path.c_str(), 40));
+  EXPECT_TRUE(ColumnarTrace::isColumnarTrace(path));
+  EXPECT_THROW(ColumnarTraceReader{path}, std::invalid_argument);
+
+  EXPECT_THROW(ColumnarTraceWriter(path, 0), std::invalid_argument);
+  std::remove(path.c_str());
+}
+
+} // namespace tests
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
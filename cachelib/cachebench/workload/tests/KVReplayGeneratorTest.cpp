@@ -17,6 +17,12 @@
 #include <folly/Random.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
 #include "cachelib/cachebench/workload/KVReplayGenerator.h"
 
 namespace facebook {
@@ -188,6 +194,59 @@ TEST(KVReplayGeneratorTest, DynamicHeader) {
   replayer.markShutdown();
 }
 
+TEST(KVReplayGeneratorTest, ParallelParsing) {
+  const auto filePath =
+      folly::sformat("/tmp/KV_REPLAY_PARALLEL_PARSING_TEST-{}", ::getpid());
+  constexpr size_t kNumKeys = 1000;
+  constexpr size_t kNumLines = 200'000;
+  {
+    std::ofstream trace(filePath);
+    trace << "key,op,size,op_count\n";
+    for (size_t i = 0; i < kNumLines; i++) {
+      // the size of a request is its line number
+      trace << folly::sformat("key{},GET,{},1\n", i % kNumKeys, i);
+    }
+  }
+
+  StressorConfig config;
+  config.numThreads = 4;
+  config.traceFileName = filePath;
+  config.replayGeneratorConfig.numParserThreads = 3;
+  KVReplayGenerator replayer{config};
+
+  std::atomic<size_t> numReqs{0};
+  std::vector<std::thread> stressors;
+  for (size_t i = 0; i < config.numThreads; i++) {
+    stressors.emplace_back([&] {
+      std::mt19937_64 gen;
+      std::unordered_map<std::string, size_t> lastLines;
+      try {
+        while (true) {
+          const auto& req = replayer.getReq(0, gen);
+          const size_t line = *req.sizeBegin;
+          // the requests for a key are replayed in order
+          auto it = lastLines.find(std::string{req.key});
+          if (it != lastLines.end()) {
+            EXPECT_LT(it->second, line);
+          }
+          lastLines[std::string{req.key}] = line;
+          numReqs++;
+          replayer.notifyResult(*req.requestId, OpResultType::kGetMiss);
+        }
+      } catch (const EndOfTrace&) {
+      }
+      replayer.markFinish();
+    });
+  }
+  for (auto& stressor : stressors) {
+    stressor.join();
+  }
+  EXPECT_EQ(kNumLines, numReqs);
+
+  replayer.markShutdown();
+  std::remove(filePath.c_str());
+}
+
 } // namespace tests
 } // namespace cachebench
 } // namespace cachelib
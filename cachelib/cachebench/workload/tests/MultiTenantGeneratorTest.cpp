@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/json.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+
+#include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/workload/MultiTenantGenerator.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+namespace tests {
+
+namespace {
+// returns the same request, named after the generator
+class NamedGenerator : public GeneratorBase {
+ public:
+  explicit NamedGenerator(std::string name)
+      : key_(std::move(name)), req_(key_, sizes_.begin(), sizes_.end()) {}
+
+  const Request& getReq(uint8_t poolId,
+                        std::mt19937_64&,
+                        std::optional<uint64_t>) override {
+    EXPECT_EQ(0, poolId);
+    numReqs_++;
+    return req_;
+  }
+
+  const std::vector<std::string>& getAllKeys() const override {
+    return keys_;
+  }
+
+  void markShutdown() override {
+    GeneratorBase::markShutdown();
+    shutdown_ = true;
+  }
+
+  std::atomic<uint64_t> numReqs_{0};
+  bool shutdown_{false};
+
+ private:
+  std::string key_;
+  std::vector<size_t> sizes_{100};
+  Request req_;
+  std::vector<std::string> keys_;
+};
+} // namespace
+
+TEST(MultiTenantGeneratorTest, Config) {
+  auto json = folly::parseJson(R"({
+    "numOps": 100,
+    "configPath": "/tmp",
+    "tenants": [
+      {"name": "a", "numThreads": 2, "tenantPoolId": 1},
+      {"name": "b", "numThreads": 1, "numOps": 10, "opRatePerSec": 5}
+    ]
+  })");
+  StressorConfig config{json};
+  EXPECT_EQ(3, config.numThreads);
+  ASSERT_EQ(2, config.tenants.size());
+  EXPECT_EQ(1, config.tenants[0].tenantPoolId);
+  EXPECT_EQ(100, config.tenants[0].numOps);
+  EXPECT_EQ("/tmp", config.tenants[0].configPath);
+  EXPECT_EQ(10, config.tenants[1].numOps);
+  EXPECT_EQ(5, config.tenants[1].opRatePerSec);
+
+  json["numThreads"] = 4;
+  EXPECT_THROW(StressorConfig{json}, std::invalid_argument);
+
+  json["numThreads"] = 3;
+  json["tenants"][0].erase("numThreads");
+  EXPECT_THROW(StressorConfig{json}, std::invalid_argument);
+}
+
+TEST(MultiTenantGeneratorTest, ThreadsServeTheirTenant) {
+  StressorConfig config;
+  config.numThreads = 3;
+  config.tenants.resize(2);
+  config.tenants[0].numThreads = 2;
+  config.tenants[1].numThreads = 1;
+
+  std::vector<std::unique_ptr<GeneratorBase>> generators;
+  generators.push_back(std::make_unique<NamedGenerator>("a"));
+  generators.push_back(std::make_unique<NamedGenerator>("b"));
+  auto* a = static_cast<NamedGenerator*>(generators[0].get());
+  auto* b = static_cast<NamedGenerator*>(generators[1].get());
+  MultiTenantGenerator generator{config, std::move(generators)};
+
+  std::vector<std::thread> threads;
+  std::atomic<size_t> numA{0};
+  for (size_t i = 0; i < config.numThreads; i++) {
+    threads.emplace_back([&] {
+      std::mt19937_64 gen;
+      const auto tenant = generator.getTenant();
+      for (int j = 0; j < 10; j++) {
+        const auto& req = generator.getReq(3, gen, std::nullopt);
+        EXPECT_EQ(tenant == 0 ? "a" : "b", req.key);
+      }
+      if (tenant == 0) {
+        numA++;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(2, numA);
+  EXPECT_EQ(20, a->numReqs_);
+  EXPECT_EQ(10, b->numReqs_);
+
+  generator.markShutdown();
+  EXPECT_TRUE(a->shutdown_);
+  EXPECT_TRUE(b->shutdown_);
+}
+
+} // namespace tests
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
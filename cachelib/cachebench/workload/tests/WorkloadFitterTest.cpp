@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Format.h>
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+
+#include "cachelib/cachebench/workload/WorkloadFitter.h"
+
+namespace facebook {
+namespace cachelib {
+namespace cachebench {
+namespace tests {
+
+TEST(WorkloadFitterTest, LruMissRatios) {
+  using A = WorkloadFitter::Access;
+  // a b c a : the second a is at stack distance 3
+  std::vector<A> accesses{{0, OpType::kGet},
+                          {1, OpType::kGet},
+                          {2, OpType::kSet},
+                          {0, OpType::kGet}};
+  auto missRatios = WorkloadFitter::getLruMissRatios(accesses, {1, 2, 3});
+  EXPECT_DOUBLE_EQ(1.0, missRatios[0]);
+  EXPECT_DOUBLE_EQ(1.0, missRatios[1]);
+  EXPECT_DOUBLE_EQ(2.0 / 3, missRatios[2]);
+
+  // deleting b brings a to distance 2, and the get of b after misses
+  accesses.insert(accesses.begin() + 3, A{1, OpType::kDel});
+  accesses.push_back({1, OpType::kGet});
+  missRatios = WorkloadFitter::getLruMissRatios(accesses, {2, 10});
+  EXPECT_DOUBLE_EQ(3.0 / 4, missRatios[0]);
+  EXPECT_DOUBLE_EQ(3.0 / 4, missRatios[1]);
+}
+
+TEST(WorkloadFitterTest, Fit) {
+  WorkloadFitter fitter;
+  // key i is accessed 100 / (i + 1) times
+  for (int i = 0; i < 10; i++) {
+    const auto key = folly::sformat("key_{}", i);
+    for (int j = 0; j < 100 / (i + 1); j++) {
+      fitter.add(key, j == 0 ? OpType::kSet : OpType::kGet, 100 * (i + 1));
+    }
+  }
+  fitter.add("lone", OpType::kGet, 5000);
+  fitter.add("deleted", OpType::kSet, 1000);
+  fitter.add("deleted", OpType::kDel, 0);
+  EXPECT_EQ(12, fitter.getNumKeys());
+
+  const auto fit = fitter.fit();
+  const auto& dist = fit.distribution;
+  EXPECT_EQ(fitter.getNumOps(), fit.numOps);
+  EXPECT_EQ(11, fit.numKeys);
+  EXPECT_FALSE(fit.enableLookaside);
+  EXPECT_DOUBLE_EQ(1.0 / fit.numOps, dist.loneGetRatio);
+  EXPECT_DOUBLE_EQ(0, dist.loneSetRatio);
+  EXPECT_DOUBLE_EQ(11.0 / fit.numOps, dist.setRatio);
+  EXPECT_DOUBLE_EQ(1.0 / fit.numOps, dist.delRatio);
+  EXPECT_NEAR(1.0, fit.zipfAlpha, 0.1);
+
+  EXPECT_EQ(fit.numKeys, std::accumulate(dist.popularityBuckets.begin(),
+                                         dist.popularityBuckets.end(), 0UL));
+  EXPECT_DOUBLE_EQ(
+      fit.numOps - 1,
+      std::accumulate(dist.popularityWeights.begin(),
+                      dist.popularityWeights.end(), 0.0));
+  // the most popular key has its own bucket
+  EXPECT_EQ(1, dist.popularityBuckets[0]);
+  EXPECT_DOUBLE_EQ(100, dist.popularityWeights[0]);
+
+  // value sizes are rounded up to 5 significant bits
+  EXPECT_EQ(dist.valSizeRange.size(), dist.valSizeRangeProbability.size());
+  EXPECT_EQ(100, dist.valSizeRange[0]);
+  EXPECT_EQ(5120, dist.valSizeRange.back());
+  // keys of 5 and 7 bytes are longer in the online generator
+  EXPECT_EQ(std::vector<double>({8, 9}), dist.keySizeRange);
+
+  const auto config =
+      WorkloadFitter::toConfig(fit, 4, "pop.json", "sizes.json");
+  EXPECT_EQ("online", config["test_config"]["generator"].asString());
+  EXPECT_EQ(fit.numKeys, config["test_config"]["numKeys"].asInt());
+}
+
+TEST(WorkloadFitterTest, SyntheticMissRatios) {
+  // requests for keys of a zipf-like popularity, independent of each other
+  WorkloadFitter fitter;
+  std::mt19937_64 gen{42};
+  std::vector<double> weights;
+  for (int i = 0; i < 1000; i++) {
+    weights.push_back(1.0 / (i + 1));
+  }
+  std::discrete_distribution<int> keyDist{weights.begin(), weights.end()};
+  for (int i = 0; i < 200000; i++) {
+    fitter.add(folly::sformat("key_{}", keyDist(gen)), OpType::kGet, 100);
+  }
+
+  const auto fit = fitter.fit();
+  EXPECT_TRUE(fit.enableLookaside);
+  const std::vector<uint64_t> cacheSizes{10, 50, 100, 250, 500};
+  const auto traceMissRatios = fitter.getTraceMissRatios(cacheSizes);
+  const auto fitMissRatios = WorkloadFitter::getSyntheticMissRatios(
+      fit, fit.numOps, cacheSizes);
+  for (size_t i = 0; i < cacheSizes.size(); i++) {
+    EXPECT_NEAR(traceMissRatios[i], fitMissRatios[i], 0.03) << cacheSizes[i];
+  }
+}
+
+} // namespace tests
+} // namespace cachebench
+} // namespace cachelib
+} // namespace facebook
@@ -16,9 +16,11 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <random>
 
 #include "cachelib/cachebench/util/Config.h"
+#include "cachelib/cachebench/workload/OnlineGenerator.h"
 #include "cachelib/cachebench/workload/WorkloadDistribution.h"
 #include "cachelib/cachebench/workload/WorkloadGenerator.h"
 
@@ -75,6 +77,35 @@ TEST(WorkloadGeneratorTest, SimpleDiscreteValueSizes) {
   }
 }
 
+TEST(WorkloadGeneratorTest, OnlineGeneratorKeys) {
+  StressorConfig config;
+  config.numKeys = 1000;
+  config.numOps = 10000;
+  config.numThreads = 1;
+  config.poolDistributions.push_back(DistributionConfig{});
+  auto& workloadConfig = config.poolDistributions.back();
+  workloadConfig.getRatio = 1.0;
+  workloadConfig.keySizeRange = std::vector<double>{16, 17};
+  workloadConfig.keySizeRangeProbability = std::vector<double>{1.0};
+  workloadConfig.valSizeRange = std::vector<double>{10, 11};
+  workloadConfig.valSizeRangeProbability = std::vector<double>{1.0};
+  config.opPoolDistribution = std::vector<double>{1.0};
+  config.keyPoolDistribution = std::vector<double>{1.0};
+
+  OnlineGenerator keygen{config};
+  std::mt19937_64 gen;
+  for (int i = 0; i < 1500; ++i) {
+    const Request& r(keygen.getReq(0, gen));
+    // the key is the idx padded to the key size
+    ASSERT_EQ(16, r.key.size());
+    size_t idx;
+    std::memcpy(&idx, r.key.data(), sizeof(idx));
+    ASSERT_LT(idx, config.numKeys);
+    ASSERT_EQ(std::string(8, 'a'), r.key.substr(sizeof(idx)));
+    EXPECT_EQ(10, *(r.sizeBegin));
+  }
+}
+
 TEST(WorkloadGeneratorTest, InvalidValueSizes) {
   StressorConfig config;
   config.numKeys = 1000;
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <gflags/gflags.h>
+
+#include <iostream>
+#include <memory>
+
+#include "cachelib/cachebench/workload/KVReplayGenerator.h"
+#include "cachelib/cachebench/workload/WorkloadFitter.h"
+#include "cachelib/common/Utils.h"
+
+DEFINE_string(json_test_config,
+              "",
+              "path to the config of the kv replay of the trace to fit");
+DEFINE_string(output_dir,
+              "",
+              "directory to write config.json, pop.json and sizes.json to. "
+              "If empty, only the fit and its miss ratio curve are printed");
+DEFINE_uint64(max_ops, 0, "if set, fits the first X requests of the trace");
+DEFINE_uint64(num_threads, 16, "threads of the fitted cachebench config");
+DEFINE_uint32(size_precision_bits,
+              5,
+              "significant bits of the value sizes of the fitted config");
+
+bool checkArgsValidity() {
+  if (FLAGS_json_test_config.empty() ||
+      !facebook::cachelib::util::pathExists(FLAGS_json_test_config)) {
+    std::cout << "Invalid config file: " << FLAGS_json_test_config
+              << ". pass a valid --json_test_config for the trace to fit."
+              << std::endl;
+    return false;
+  }
+  if (FLAGS_num_threads == 0) {
+    std::cout << "--num_threads must be positive" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char** argv) {
+  using namespace facebook::cachelib;
+  using namespace facebook::cachelib::cachebench;
+
+  folly::init(&argc, &argv, true);
+  if (!checkArgsValidity()) {
+    return 1;
+  }
+
+  CacheBenchConfig config(FLAGS_json_test_config);
+  std::cout << "Workload Fitter" << std::endl;
+
+  WorkloadFitter fitter{FLAGS_size_precision_bits};
+  try {
+    // one reader sees all the requests of the trace, in order
+    auto stressorConfig = config.getStressorConfig();
+    stressorConfig.numThreads = 1;
+    KVReplayGenerator generator{stressorConfig};
+    std::mt19937_64 gen;
+    while (FLAGS_max_ops == 0 || fitter.getNumOps() < FLAGS_max_ops) {
+      const Request* req;
+      try {
+        req = &generator.getReq(0, gen, std::nullopt);
+      } catch (const EndOfTrace&) {
+        break;
+      }
+      fitter.add(req->key, req->getOp(), *(req->sizeBegin));
+      // hands the request back, and gets its repeats next
+      generator.notifyResult(*req->requestId, OpResultType::kNop);
+    }
+    generator.markShutdown();
+  } catch (const std::exception& e) {
+    std::cout << "Invalid configuration. Exception: " << e.what() << std::endl;
+    return 1;
+  }
+
+  WorkloadFitter::Fit fit;
+  try {
+    fit = fitter.fit();
+  } catch (const std::invalid_argument& e) {
+    std::cout << "Can not fit the trace: " << e.what() << std::endl;
+    return 1;
+  }
+  const auto& dist = fit.distribution;
+  std::cout << folly::sformat(
+                   "{} requests, {} keys, {} popular keys of {:.2f} GB",
+                   fit.numOps, fitter.getNumKeys(), fit.numKeys,
+                   fit.footprintBytes / 1024.0 / 1024.0 / 1024.0)
+            << std::endl;
+  std::cout << folly::sformat(
+                   "get {:.4f} set {:.4f} del {:.4f} loneGet {:.4f} "
+                   "loneSet {:.4f}{}",
+                   dist.getRatio, dist.setRatio, dist.delRatio,
+                   dist.loneGetRatio, dist.loneSetRatio,
+                   fit.enableLookaside ? " (lookaside)" : "")
+            << std::endl;
+  std::cout << folly::sformat(
+                   "{} popularity buckets, zipf alpha {:.3f}, {} value sizes",
+                   dist.popularityBuckets.size(), fit.zipfAlpha,
+                   dist.valSizeRange.size())
+            << std::endl;
+
+  // miss ratio curves of LRU for caches of fractions of the popular keys
+  std::vector<uint64_t> cacheSizes;
+  for (double fraction : {0.001, 0.01, 0.05, 0.1, 0.25, 0.5, 1.0}) {
+    cacheSizes.push_back(
+        std::max<uint64_t>(1, static_cast<uint64_t>(fit.numKeys * fraction)));
+  }
+  const auto traceMissRatios = fitter.getTraceMissRatios(cacheSizes);
+  const auto fitMissRatios =
+      WorkloadFitter::getSyntheticMissRatios(fit, fit.numOps, cacheSizes);
+  std::cout << folly::sformat("{:>12} {:>10} {:>10}", "cache objs", "trace",
+                              "fit")
+            << std::endl;
+  for (size_t i = 0; i < cacheSizes.size(); i++) {
+    std::cout << folly::sformat("{:>12} {:>10.4f} {:>10.4f}", cacheSizes[i],
+                                traceMissRatios[i], fitMissRatios[i])
+              << std::endl;
+  }
+
+  if (FLAGS_output_dir.empty()) {
+    return 0;
+  }
+  auto write = [](const std::string& file, const folly::dynamic& json) {
+    const auto path = folly::sformat("{}/{}", FLAGS_output_dir, file);
+    if (!folly::writeFile(folly::toPrettyJson(json), path.c_str())) {
+      std::cout << "Could not write " << path << std::endl;
+      return false;
+    }
+    std::cout << "Wrote " << path << std::endl;
+    return true;
+  };
+  const bool written =
+      write("config.json",
+            WorkloadFitter::toConfig(fit, FLAGS_num_threads, "pop.json",
+                                     "sizes.json")) &&
+      write("pop.json", WorkloadFitter::toPopularityConfig(fit)) &&
+      write("sizes.json", WorkloadFitter::toSizesConfig(fit));
+  return written ? 0 : 1;
+}
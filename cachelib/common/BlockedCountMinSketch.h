@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "cachelib/common/Hash.h"
+
+namespace facebook::cachelib::util {
+// A count-min sketch of 4 bit counters that keeps all the counters of a key
+// in one 64 byte block, so that an increment or a count of a key touches a
+// single cache line instead of one per row.
+//
+// A block holds 8 words of 16 counters. Each of the kDepth rows owns two
+// words of the block, and a key uses one counter of each row, in the word
+// and at the position picked by the bits of its hash. Counters saturate at
+// kMaxCount. halve() halves every counter with two word-wide operations per
+// 16 counters.
+//
+// Users are supposed to synchronize concurrent accesses to the data
+// structure.
+class BlockedCountMinSketch {
+ public:
+  static constexpr uint32_t kDepth{4};
+  static constexpr uint32_t kMaxCount{15};
+  static constexpr uint64_t kCountersPerBlock{128};
+
+  // @param numCounters   total number of counters, rounded up to a power of
+  //                      two number of blocks
+  //
+  // @throw std::invalid_argument if numCounters is 0
+  explicit BlockedCountMinSketch(uint64_t numCounters) {
+    if (numCounters == 0) {
+      throw std::invalid_argument{"Number of counters must be greater than 0."};
+    }
+    const uint64_t numBlocks = folly::nextPowTwo(
+        (numCounters + kCountersPerBlock - 1) / kCountersPerBlock);
+    blocks_ = std::make_unique<Block[]>(numBlocks);
+    blockMask_ = numBlocks - 1;
+  }
+
+  BlockedCountMinSketch() = default;
+  BlockedCountMinSketch(BlockedCountMinSketch&&) noexcept = default;
+  BlockedCountMinSketch& operator=(BlockedCountMinSketch&&) noexcept =
+      default;
+
+  uint32_t getCount(uint64_t key) const {
+    if (!blocks_) {
+      return 0;
+    }
+    const uint64_t hash = hashInt(key);
+    const auto& block = blocks_[hash & blockMask_];
+    uint32_t count = kMaxCount;
+    for (uint32_t row = 0; row < kDepth; row++) {
+      const auto [word, shift] = getCounter(hash, row);
+      count = std::min(
+          count, static_cast<uint32_t>((block.words[word] >> shift) & 0xF));
+    }
+    return count;
+  }
+
+  void increment(uint64_t key) {
+    if (!blocks_) {
+      return;
+    }
+    const uint64_t hash = hashInt(key);
+    auto& block = blocks_[hash & blockMask_];
+    for (uint32_t row = 0; row < kDepth; row++) {
+      const auto [word, shift] = getCounter(hash, row);
+      if (((block.words[word] >> shift) & 0xF) != kMaxCount) {
+        block.words[word] += 1ULL << shift;
+      }
+    }
+  }
+
+  // halve all the counts, rounding down
+  void halve() noexcept {
+    for (uint64_t i = 0; i <= blockMask_ && blocks_; i++) {
+      for (auto& word : blocks_[i].words) {
+        word = (word >> 1) & kHalveMask;
+      }
+    }
+  }
+
+  // Sets count for all keys to zero
+  void reset() noexcept {
+    for (uint64_t i = 0; i <= blockMask_ && blocks_; i++) {
+      blocks_[i] = Block{};
+    }
+  }
+
+  uint64_t getNumCounters() const noexcept {
+    return blocks_ ? (blockMask_ + 1) * kCountersPerBlock : 0;
+  }
+
+  uint64_t getByteSize() const noexcept {
+    return blocks_ ? (blockMask_ + 1) * sizeof(Block) : 0;
+  }
+
+ private:
+  struct alignas(64) Block {
+    uint64_t words[8]{};
+  };
+  static_assert(sizeof(Block) * 2 == kCountersPerBlock,
+                "a block is 128 counters of 4 bits");
+
+  // clears the bit that a counter shifted into the one below
+  static constexpr uint64_t kHalveMask{0x7777777777777777ULL};
+
+  // @return the word and the shift of the counter of the row for the hash.
+  //         The lower bits of the hash pick the block, so the counters are
+  //         picked from the upper 32 bits, 5 bits per row.
+  static std::pair<uint32_t, uint32_t> getCounter(uint64_t hash,
+                                                  uint32_t row) noexcept {
+    const auto bits = static_cast<uint32_t>(hash >> (32 + row * 8));
+    return {row * 2 + (bits & 1), ((bits >> 1) & 0xF) * 4};
+  }
+
+  std::unique_ptr<Block[]> blocks_{};
+  uint64_t blockMask_{0};
+};
+} // namespace facebook::cachelib::util
@@ -16,11 +16,18 @@
 
 #include "cachelib/common/BloomFilter.h"
 
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
 #include <folly/lang/Bits.h>
 
+#include <array>
 #include <cassert>
 #include <cstring>
 
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
 #include "cachelib/common/Hash.h"
 #include "cachelib/common/Utils.h"
 
@@ -48,6 +55,74 @@ std::pair<uint32_t, size_t> findOptimalParams(size_t elementCount,
 
   return std::make_pair(minK, static_cast<size_t>(minM));
 }
+
+// Bits of a key in a split block filter: one per 32 bit word of the block,
+// picked by the top 5 bits of the hash multiplied by the salt of the word.
+constexpr std::array<uint32_t, BloomFilter::kSplitBlockHashes>
+    kSplitBlockSalts{0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                     0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+constexpr size_t kSplitBlockBytes = 32;
+
+void splitBlockSet(uint8_t* block, uint32_t hash) {
+  for (size_t i = 0; i < kSplitBlockSalts.size(); i++) {
+    uint32_t word;
+    std::memcpy(&word, block + i * sizeof(word), sizeof(word));
+    word |= uint32_t{1} << ((hash * kSplitBlockSalts[i]) >> 27);
+    std::memcpy(block + i * sizeof(word), &word, sizeof(word));
+  }
+}
+
+bool splitBlockCouldExist(const uint8_t* block, uint32_t hash) {
+  for (size_t i = 0; i < kSplitBlockSalts.size(); i++) {
+    uint32_t word;
+    std::memcpy(&word, block + i * sizeof(word), sizeof(word));
+    if (!(word & (uint32_t{1} << ((hash * kSplitBlockSalts[i]) >> 27)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if FOLLY_X64
+// The same with the 8 words of the block in one AVX2 register. These are
+// only called when the cpu supports AVX2.
+__attribute__((target("avx2"))) inline __m256i splitBlockMaskAvx2(
+    uint32_t hash) {
+  const __m256i salts = _mm256_setr_epi32(
+      static_cast<int>(kSplitBlockSalts[0]),
+      static_cast<int>(kSplitBlockSalts[1]),
+      static_cast<int>(kSplitBlockSalts[2]),
+      static_cast<int>(kSplitBlockSalts[3]),
+      static_cast<int>(kSplitBlockSalts[4]),
+      static_cast<int>(kSplitBlockSalts[5]),
+      static_cast<int>(kSplitBlockSalts[6]),
+      static_cast<int>(kSplitBlockSalts[7]));
+  const __m256i shifts = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts),
+      27);
+  return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+}
+
+__attribute__((target("avx2"))) void splitBlockSetAvx2(uint8_t* block,
+                                                       uint32_t hash) {
+  auto* ptr = reinterpret_cast<__m256i*>(block);
+  _mm256_storeu_si256(
+      ptr, _mm256_or_si256(_mm256_loadu_si256(ptr), splitBlockMaskAvx2(hash)));
+}
+
+__attribute__((target("avx2"))) bool splitBlockCouldExistAvx2(
+    const uint8_t* block, uint32_t hash) {
+  const auto blockBits =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  // set if every bit of the mask is set in the block
+  return _mm256_testc_si256(blockBits, splitBlockMaskAvx2(hash));
+}
+
+bool hasAvx2() {
+  static const bool avx2 = folly::CpuId().avx2();
+  return avx2;
+}
+#endif
 } // namespace
 
 BloomFilter BloomFilter::makeBloomFilter(uint32_t numFilters,
@@ -61,7 +136,20 @@ BloomFilter BloomFilter::makeBloomFilter(uint32_t numFilters,
   return BloomFilter{numFilters, numHashes, bitsPerFilter};
 }
 
+BloomFilter BloomFilter::makeBlockedBloomFilter(uint32_t numFilters,
+                                                uint32_t numHashes,
+                                                size_t filterBitSize) {
+  return BloomFilter{BlockedTag{}, numFilters, numHashes, filterBitSize};
+}
+
+BloomFilter BloomFilter::makeSplitBlockBloomFilter(uint32_t numFilters,
+                                                   size_t filterBitSize) {
+  return BloomFilter{SplitBlockTag{}, numFilters, filterBitSize};
+}
+
 constexpr uint32_t BloomFilter::kPersistFragmentSize;
+constexpr uint32_t BloomFilter::kMaxBlockedHashes;
+constexpr uint32_t BloomFilter::kSplitBlockHashes;
 
 BloomFilter::BloomFilter(uint32_t numFilters,
                          uint32_t numHashes,
@@ -82,7 +170,94 @@ BloomFilter::BloomFilter(uint32_t numFilters,
   }
 }
 
+BloomFilter::BloomFilter(BlockedTag,
+                         uint32_t numFilters,
+                         uint32_t numHashes,
+                         size_t filterBitSize)
+    : numFilters_{numFilters},
+      hashTableBitSize_{(filterBitSize + 63) & ~size_t{63}},
+      filterByteSize_{hashTableBitSize_ / 8},
+      blocked_{true},
+      seeds_(numHashes),
+      bits_{std::make_unique<uint8_t[]>(getByteSize())} {
+  if (numFilters == 0 || numHashes == 0 || numHashes > kMaxBlockedHashes ||
+      filterBitSize == 0) {
+    throw std::invalid_argument("invalid blocked bloom filter params");
+  }
+  // bits are derived from a single hash, the seeds are only kept to report
+  // the number of hashes and for the persisted format.
+  for (size_t i = 0; i < seeds_.size(); i++) {
+    seeds_[i] = facebook::cachelib::hashInt(i);
+  }
+}
+
+BloomFilter::BloomFilter(SplitBlockTag,
+                         uint32_t numFilters,
+                         size_t filterBitSize)
+    : numFilters_{numFilters},
+      hashTableBitSize_{(filterBitSize + 255) & ~size_t{255}},
+      filterByteSize_{hashTableBitSize_ / 8},
+      splitBlock_{true},
+      seeds_(kSplitBlockHashes),
+      bits_{std::make_unique<uint8_t[]>(getByteSize())} {
+  if (numFilters == 0 || filterBitSize == 0) {
+    throw std::invalid_argument("invalid split block bloom filter params");
+  }
+  // like for the blocked filters, the seeds are only kept to report the
+  // number of hashes and for the persisted format.
+  for (size_t i = 0; i < seeds_.size(); i++) {
+    seeds_[i] = facebook::cachelib::hashInt(i);
+  }
+}
+
+uint8_t* BloomFilter::getSplitBlock(uint32_t idx, uint64_t hash) const {
+  XDCHECK_LT(idx, numFilters_);
+  const uint64_t numBlocks = filterByteSize_ / kSplitBlockBytes;
+  // the upper half of the hash picks the block, the lower half the bits
+  const auto block = ((hash >> 32) * numBlocks) >> 32;
+  return getFilterBytes(idx) + block * kSplitBlockBytes;
+}
+
+uint8_t* BloomFilter::getBlockedWord(uint32_t idx, uint64_t hash) const {
+  XDCHECK_LT(idx, numFilters_);
+  const size_t numWords = filterByteSize_ / sizeof(uint64_t);
+  // the low bits pick the bits in the word
+  const size_t word = numWords == 1 ? 0 : (hash >> 48) % numWords;
+  return getFilterBytes(idx) + word * sizeof(uint64_t);
+}
+
+uint64_t BloomFilter::getBlockedMask(uint64_t hash) const {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < seeds_.size(); i++) {
+    mask |= uint64_t{1} << ((hash >> (6 * i)) & 63);
+  }
+  return mask;
+}
+
 void BloomFilter::set(uint32_t idx, uint64_t key) {
+  if (splitBlock_ && !seeds_.empty()) {
+    const auto hash = facebook::cachelib::hashInt(key);
+    auto* block = getSplitBlock(idx, hash);
+#if FOLLY_X64
+    if (hasAvx2()) {
+      splitBlockSetAvx2(block, static_cast<uint32_t>(hash));
+      return;
+    }
+#endif
+    splitBlockSet(block, static_cast<uint32_t>(hash));
+    return;
+  }
+
+  if (blocked_ && !seeds_.empty()) {
+    const auto hash = facebook::cachelib::hashInt(key);
+    auto* wordPtr = getBlockedWord(idx, hash);
+    uint64_t word;
+    std::memcpy(&word, wordPtr, sizeof(word));
+    word |= getBlockedMask(hash);
+    std::memcpy(wordPtr, &word, sizeof(word));
+    return;
+  }
+
   size_t firstBit = 0;
   for (auto seed : seeds_) {
     auto* filterPtr = getFilterBytes(idx);
@@ -95,6 +270,25 @@ void BloomFilter::set(uint32_t idx, uint64_t key) {
 }
 
 bool BloomFilter::couldExist(uint32_t idx, uint64_t key) const {
+  if (splitBlock_ && !seeds_.empty()) {
+    const auto hash = facebook::cachelib::hashInt(key);
+    const auto* block = getSplitBlock(idx, hash);
+#if FOLLY_X64
+    if (hasAvx2()) {
+      return splitBlockCouldExistAvx2(block, static_cast<uint32_t>(hash));
+    }
+#endif
+    return splitBlockCouldExist(block, static_cast<uint32_t>(hash));
+  }
+
+  if (blocked_ && !seeds_.empty()) {
+    const auto hash = facebook::cachelib::hashInt(key);
+    uint64_t word;
+    std::memcpy(&word, getBlockedWord(idx, hash), sizeof(word));
+    const auto mask = getBlockedMask(hash);
+    return (word & mask) == mask;
+  }
+
   size_t firstBit = 0;
   for (auto seed : seeds_) {
     XDCHECK_LT(idx, numFilters_);
@@ -177,5 +371,23 @@ void BloomFilter::deserializeBits(RecordReader& rr) {
   }
 }
 
+void BloomFilter::skipBits(RecordReader& rr,
+                           uint32_t numFilters,
+                           uint64_t filterByteSize) {
+  // the bits followed by the init bits, see serializeBits()
+  for (uint64_t size : {numFilters * filterByteSize,
+                        static_cast<uint64_t>(bitsToBytes(numFilters))}) {
+    uint64_t off = 0;
+    while (off < size) {
+      auto buf = rr.readRecord();
+      if (!buf) {
+        throw std::invalid_argument(
+            folly::sformat("Failed to skip bits off: {}", off));
+      }
+      off += buf->length();
+    }
+  }
+}
+
 } // namespace cachelib
 } // namespace facebook
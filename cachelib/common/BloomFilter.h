@@ -55,6 +55,35 @@ class BloomFilter {
                                      size_t elementCount,
                                      double fpProb);
 
+  // Creates @numFilters blocked BFs of @filterBitSize bits each, rounded up
+  // to a multiple of 64. All @numHashes bits of a key are in a single 64 bit
+  // word of its filter and are derived from one hash of the key, so a probe
+  // is one load and a mask compare. For filters of a single word this also
+  // gives a lower false positive rate than the per hash tables above.
+  //
+  // Throws std::invalid_argument if @numHashes is not in
+  // [1, kMaxBlockedHashes] or @filterBitSize is 0.
+  static BloomFilter makeBlockedBloomFilter(uint32_t numFilters,
+                                            uint32_t numHashes,
+                                            size_t filterBitSize);
+
+  static constexpr uint32_t kMaxBlockedHashes{8};
+
+  // Creates @numFilters split block BFs of @filterBitSize bits each, rounded
+  // up to a multiple of 256. A key sets one bit in each 32 bit word of one
+  // 256 bit block of its filter, picked by one hash of the key. A probe
+  // touches a single cacheline whatever the size of the filter, and is one
+  // compare of the block where AVX2 is available. This suits filters of many
+  // keys, such as negative caches, for which a single word per key gives too
+  // many false positives.
+  //
+  // Throws std::invalid_argument if @numFilters or @filterBitSize is 0.
+  static BloomFilter makeSplitBlockBloomFilter(uint32_t numFilters,
+                                               size_t filterBitSize);
+
+  // number of bits a key sets in a split block filter, one per word
+  static constexpr uint32_t kSplitBlockHashes{8};
+
   // Not copyable, bacause assumed to have huge memory footprint
   BloomFilter(const BloomFilter&) = delete;
   BloomFilter& operator=(const BloomFilter&) = delete;
@@ -65,6 +94,8 @@ class BloomFilter {
       : numFilters_(other.numFilters_),
         hashTableBitSize_(other.hashTableBitSize_),
         filterByteSize_(other.filterByteSize_),
+        blocked_(other.blocked_),
+        splitBlock_(other.splitBlock_),
         seeds_(std::exchange(other.seeds_, {})),
         bits_(std::exchange(other.bits_, nullptr)) {}
 
@@ -94,6 +125,12 @@ class BloomFilter {
   // number of unique filters
   uint32_t numFilters() const { return numFilters_; }
 
+  // whether this is a blocked filter, see makeBlockedBloomFilter()
+  bool isBlocked() const { return blocked_; }
+
+  // whether this is a split block filter, see makeSplitBlockBloomFilter()
+  bool isSplitBlock() const { return splitBlock_; }
+
   // number of hash functions per filter
   uint32_t numHashes() const { return static_cast<uint32_t>(seeds_.size()); }
 
@@ -113,7 +150,31 @@ class BloomFilter {
   template <typename SerializationProto>
   void recover(RecordReader& rw);
 
+  // Like recover(), but if the persisted filter has a different size or
+  // layout, skips its records and returns false, leaving this filter as is.
+  // Callers can then rebuild the filter instead of dropping their state.
+  //
+  // Throws std::invalid_argument if the records can't be read.
+  template <typename SerializationProto>
+  bool tryRecover(RecordReader& rr);
+
  private:
+  struct BlockedTag {};
+  BloomFilter(BlockedTag,
+              uint32_t numFilters,
+              uint32_t numHashes,
+              size_t filterBitSize);
+
+  struct SplitBlockTag {};
+  BloomFilter(SplitBlockTag, uint32_t numFilters, size_t filterBitSize);
+
+  // The word of the filter and the bits in it for a blocked filter
+  uint8_t* getBlockedWord(uint32_t idx, uint64_t hash) const;
+  uint64_t getBlockedMask(uint64_t hash) const;
+
+  // The 256 bit block of the filter for a split block filter
+  uint8_t* getSplitBlock(uint32_t idx, uint64_t hash) const;
+
   uint8_t* getFilterBytes(uint32_t idx) const {
     XDCHECK(bits_);
     return bits_.get() + idx * filterByteSize_;
@@ -121,12 +182,19 @@ class BloomFilter {
 
   void serializeBits(RecordWriter& rw, uint64_t fragmentSize);
   void deserializeBits(RecordReader& rr);
+  // skips the bits of a persisted filter with @numFilters filters of
+  // @filterByteSize bytes
+  static void skipBits(RecordReader& rr,
+                       uint32_t numFilters,
+                       uint64_t filterByteSize);
 
   static constexpr uint32_t kPersistFragmentSize = 1024 * 1024;
 
   const uint32_t numFilters_{};
   const size_t hashTableBitSize_{};
   const size_t filterByteSize_{};
+  const bool blocked_{false};
+  const bool splitBlock_{false};
   std::vector<uint64_t> seeds_;
   std::unique_ptr<uint8_t[]> bits_;
 };
@@ -138,6 +206,8 @@ void BloomFilter::persist(RecordWriter& rw) {
   *bd.hashTableBitSize() = hashTableBitSize_;
   *bd.filterByteSize() = filterByteSize_;
   *bd.fragmentSize() = kPersistFragmentSize;
+  *bd.blocked() = blocked_;
+  *bd.splitBlock() = splitBlock_;
   bd.seeds()->resize(seeds_.size());
   for (uint32_t i = 0; i < seeds_.size(); i++) {
     bd.seeds()[i] = seeds_[i];
@@ -149,21 +219,34 @@ void BloomFilter::persist(RecordWriter& rw) {
 
 template <typename SerializationProto>
 void BloomFilter::recover(RecordReader& rr) {
+  if (!tryRecover<SerializationProto>(rr)) {
+    throw std::invalid_argument(
+        "Could not recover BloomFilter. Invalid BloomFilter.");
+  }
+}
+
+template <typename SerializationProto>
+bool BloomFilter::tryRecover(RecordReader& rr) {
   const auto bd = facebook::cachelib::deserializeProto<
       serialization::BloomFilterPersistentData,
       SerializationProto>(rr);
   if (numFilters_ != static_cast<uint32_t>(*bd.numFilters()) ||
       hashTableBitSize_ != static_cast<uint64_t>(*bd.hashTableBitSize()) ||
       filterByteSize_ != static_cast<uint64_t>(*bd.filterByteSize()) ||
-      static_cast<uint32_t>(*bd.fragmentSize()) != kPersistFragmentSize) {
-    throw std::invalid_argument(
-        "Could not recover BloomFilter. Invalid BloomFilter.");
+      static_cast<uint32_t>(*bd.fragmentSize()) != kPersistFragmentSize ||
+      *bd.blocked() != blocked_ || *bd.splitBlock() != splitBlock_ ||
+      seeds_.size() != bd.seeds()->size()) {
+    skipBits(rr,
+             static_cast<uint32_t>(*bd.numFilters()),
+             static_cast<uint64_t>(*bd.filterByteSize()));
+    return false;
   }
 
   for (uint32_t i = 0; i < bd.seeds()->size(); i++) {
     seeds_[i] = bd.seeds()[i];
   }
   deserializeBits(rr);
+  return true;
 }
 
 } // namespace cachelib
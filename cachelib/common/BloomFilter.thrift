@@ -24,4 +24,6 @@ struct BloomFilterPersistentData {
   3: required i64 filterByteSize = 0;
   4: required i32 fragmentSize = 0;
   5: required list<i64> seeds;
+  6: bool blocked = false;
+  7: bool splitBlock = false;
 }
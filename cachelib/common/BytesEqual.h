@@ -41,6 +41,48 @@ inline bool eq(const char* a, const char* b) {
   return lhs == rhs;
 }
 
+// @return the xor of the T sized words at a and b, 0 if they are equal
+template <typename T>
+FOLLY_ALWAYS_INLINE T xorWord(const char* a, const char* b) {
+  static_assert(std::is_integral<T>::value, "Non integral type");
+  T lhs;
+  T rhs;
+  memcpy(&lhs, a, sizeof(T));
+  memcpy(&rhs, b, sizeof(T));
+  return lhs ^ rhs;
+}
+
+// byte arrays up to this length are compared by shortBytesEqual()
+constexpr size_t kShortBytesEqualMaxLen = 32;
+
+// Compare two byte arrays of at most kShortBytesEqualMaxLen bytes, such as
+// most cache keys, without looping. The arrays are covered by at most four
+// word loads each, overlapping in the middle, and the words are combined
+// without a branch per word.
+FOLLY_ALWAYS_INLINE bool shortBytesEqual(const char* a,
+                                         const char* b,
+                                         size_t len) {
+  assert(len <= kShortBytesEqualMaxLen);
+  if (len >= 8) {
+    uint64_t diff = xorWord<uint64_t>(a, b) |
+                    xorWord<uint64_t>(a + len - 8, b + len - 8);
+    if (len > 16) {
+      diff |= xorWord<uint64_t>(a + 8, b + 8) |
+              xorWord<uint64_t>(a + len - 16, b + len - 16);
+    }
+    return diff == 0;
+  }
+  if (len >= 4) {
+    return (xorWord<uint32_t>(a, b) |
+            xorWord<uint32_t>(a + len - 4, b + len - 4)) == 0;
+  }
+  if (len >= 2) {
+    return (xorWord<uint16_t>(a, b) |
+            xorWord<uint16_t>(a + len - 2, b + len - 2)) == 0;
+  }
+  return len == 0 || *a == *b;
+}
+
 // Compare the two byte arrays up to the len and return if they are equal or
 // not. Defaults to using memcmp for more than 1024 byte comparisons. Use this
 // only when you are comparing less than 64 byte buffers for getting a win.
@@ -57,6 +99,10 @@ FOLLY_ALWAYS_INLINE bool bytesEqual(const void* a_,
   const char* a = (const char*)a_;
   const char* b = (const char*)b_;
 
+  if (LIKELY(len <= kShortBytesEqualMaxLen)) {
+    return shortBytesEqual(a, b, len);
+  }
+
   if (UNLIKELY(len >= 1024)) {
     return memcmp(a_, b_, len) == 0;
   }
@@ -19,6 +19,12 @@
 #include <folly/logging/xlog.h>
 
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace facebook {
 namespace cachelib {
@@ -175,5 +181,77 @@ class Cohort {
   std::atomic<uint64_t> cohortVal_{kBottomCohortBit};
 };
 
+// Read-copy-update of a read-mostly object of type T using a Cohort. Readers
+// get the current version without taking any lock and keep it alive while
+// they hold the returned pointer. Writers are serialized, modify a copy,
+// publish it and wait for the readers of the previous version to drain
+// before freeing it. Since writers sleep while the readers drain, updates
+// are meant to be rare and readers short lived.
+template <typename T>
+class CohortRcu {
+ public:
+  // A reader's view of a version of the object. Make sure the owner
+  // CohortRcu is longer-lived than the pointer.
+  class ReadPtr {
+   public:
+    const T& operator*() const noexcept { return *ptr_; }
+    const T* operator->() const noexcept { return ptr_; }
+
+   private:
+    friend class CohortRcu;
+    ReadPtr(Cohort::Token token, const T* ptr)
+        : token_(std::move(token)), ptr_(ptr) {}
+
+    Cohort::Token token_;
+    const T* ptr_;
+  };
+
+  explicit CohortRcu(T initial = T{})
+      : current_(new T(std::move(initial))) {}
+
+  CohortRcu(const CohortRcu&) = delete;
+  CohortRcu& operator=(const CohortRcu&) = delete;
+
+  ~CohortRcu() { delete current_.load(); }
+
+  // @return the current version. Later updates do not change it.
+  ReadPtr read() const noexcept {
+    // the version is loaded after joining the cohort, so that the writer
+    // replacing it waits for us
+    auto token = cohort_.incrActiveReqs();
+    return ReadPtr(std::move(token), current_.load());
+  }
+
+  // Apply @fn to a copy of the current version and publish the copy. Returns
+  // once no reader holds the previous version anymore. If @fn throws, the
+  // current version is kept.
+  //
+  // @return what @fn returns
+  template <typename F>
+  auto update(F&& fn) {
+    std::lock_guard<std::mutex> l(writeLock_);
+    auto next = std::make_unique<T>(*current_.load());
+    if constexpr (std::is_void_v<decltype(fn(*next))>) {
+      fn(*next);
+      retire(current_.exchange(next.release()));
+    } else {
+      auto ret = fn(*next);
+      retire(current_.exchange(next.release()));
+      return ret;
+    }
+  }
+
+ private:
+  // Wait for the readers of @prev to drain and free it
+  void retire(T* prev) noexcept {
+    cohort_.switchCohorts();
+    delete prev;
+  }
+
+  mutable Cohort cohort_;
+  std::mutex writeLock_;
+  std::atomic<T*> current_;
+};
+
 } // namespace cachelib
 } // namespace facebook
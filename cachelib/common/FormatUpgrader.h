@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Format.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace facebook {
+namespace cachelib {
+
+// Upgrades state persisted by an older version of a format to the current
+// version, so that a binary bumping the format can restore what the previous
+// binary persisted instead of starting cold.
+//
+// A step is registered for every version bump that the older state can be
+// translated across. It takes the deserialized state of its version and
+// turns it into the state of the next version. State can be upgraded if
+// there is a step for every version from its own to the current one.
+//
+// Thread safe.
+template <typename State>
+class FormatUpgrader {
+ public:
+  // translates the state of version V into the state of version V + 1
+  using Step = std::function<void(State&)>;
+
+  explicit FormatUpgrader(uint64_t currentVersion)
+      : currentVersion_{currentVersion} {}
+
+  FormatUpgrader(const FormatUpgrader&) = delete;
+  FormatUpgrader& operator=(const FormatUpgrader&) = delete;
+
+  uint64_t getCurrentVersion() const noexcept { return currentVersion_; }
+
+  // registers the step upgrading from @fromVersion to @fromVersion + 1,
+  // replacing the previous one if any.
+  //
+  // @throw std::invalid_argument if @fromVersion is not older than the
+  //        current version
+  void addStep(uint64_t fromVersion, Step step) {
+    if (fromVersion >= currentVersion_) {
+      throw std::invalid_argument(folly::sformat(
+          "Upgrade step from version {} but the current version is {}",
+          fromVersion, currentVersion_));
+    }
+    std::lock_guard<std::mutex> l{mutex_};
+    steps_[fromVersion] = std::move(step);
+  }
+
+  // unregisters the step upgrading from @fromVersion
+  void removeStep(uint64_t fromVersion) {
+    std::lock_guard<std::mutex> l{mutex_};
+    steps_.erase(fromVersion);
+  }
+
+  // @return true if state of @version is current or can be upgraded
+  bool canUpgrade(uint64_t version) const {
+    std::lock_guard<std::mutex> l{mutex_};
+    return canUpgradeLocked(version);
+  }
+
+  // upgrades @state of @version to the current version by applying the
+  // steps in order. Nothing is done if @version is current.
+  //
+  // @throw std::invalid_argument if @version can not be upgraded. @state is
+  //        unchanged then.
+  // @throw any exception of a step, which may leave @state partially
+  //        upgraded
+  void upgrade(uint64_t version, State& state) const {
+    std::lock_guard<std::mutex> l{mutex_};
+    if (!canUpgradeLocked(version)) {
+      throw std::invalid_argument(
+          folly::sformat("Can not upgrade format version {} to {}", version,
+                         currentVersion_));
+    }
+    for (; version < currentVersion_; version++) {
+      steps_.at(version)(state);
+    }
+  }
+
+ private:
+  bool canUpgradeLocked(uint64_t version) const {
+    if (version > currentVersion_) {
+      return false;
+    }
+    for (; version < currentVersion_; version++) {
+      if (steps_.count(version) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const uint64_t currentVersion_;
+
+  mutable std::mutex mutex_;
+  // step by the version it upgrades from
+  std::map<uint64_t, Step> steps_;
+};
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/common/HistogramStats.h"
+
+namespace facebook {
+namespace cachelib {
+namespace util {
+constexpr std::array<double, 14> HistogramStats::kQuantiles{
+    0,    0.05, 0.1,   0.25,   0.5,     0.75,     0.9,
+    0.95, 0.99, 0.999, 0.9999, 0.99999, 0.999999, 1.0};
+
+HistogramStats::Estimates HistogramStats::estimate() {
+  const auto snapshot = buckets_.getSnapshot();
+
+  // the histogram of the values tracked since the previous call
+  Buckets delta;
+  uint64_t count = 0;
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    for (size_t i = 0; i < kNumBuckets; i++) {
+      delta.counts[i] = snapshot.counts[i] - lastSnapshot_.counts[i];
+      count += delta.counts[i];
+    }
+    delta.sum = snapshot.sum - lastSnapshot_.sum;
+    lastSnapshot_ = snapshot;
+  }
+  if (count == 0) {
+    return {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  }
+
+  // the value of a quantile is the middle of the bucket holding it, except
+  // for the min and the max which are the bounds of their buckets
+  std::array<uint64_t, 14> values{};
+  size_t bucket = 0;
+  uint64_t seen = delta.counts[0];
+  for (size_t q = 0; q < kQuantiles.size(); q++) {
+    // the rank of the quantile, counting from 1
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(kQuantiles[q] * static_cast<double>(count)));
+    while (seen < rank) {
+      seen += delta.counts[++bucket];
+    }
+    const auto range = getBucketRange(bucket);
+    if (q == 0) {
+      values[q] = range.first;
+    } else if (q == kQuantiles.size() - 1) {
+      values[q] = range.second;
+    } else {
+      values[q] = range.first + (range.second - range.first) / 2;
+    }
+  }
+
+  return {delta.sum / count, values[0],  values[1],  values[2],
+          values[3],         values[4],  values[5],  values[6],
+          values[7],         values[8],  values[9],  values[10],
+          values[11],        values[12], values[13]};
+}
+} // namespace util
+} // namespace cachelib
+} // namespace facebook
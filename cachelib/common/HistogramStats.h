@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include "cachelib/common/FastStats.h"
+#include "cachelib/common/PercentileStats.h"
+#include "cachelib/common/Utils.h"
+
+namespace facebook {
+namespace cachelib {
+namespace util {
+
+// Percentiles of values from a log-linear histogram with fixed buckets that
+// is kept per thread. Tracking a value bumps two counters of the calling
+// thread: it does not allocate, lock, share a cacheline with other threads
+// or read the clock. The histograms of all the threads are merged when the
+// percentiles are estimated.
+//
+// Values below 2^kSubBucketBits have a bucket each. Every power of two above
+// is split into 2^kSubBucketBits buckets, so the error of an estimate is
+// within 1/2^kSubBucketBits of the value (6% by default). Values of
+// 2^kMaxValueBits and above are tracked as the largest value.
+//
+// Unlike PercentileStats, which estimates the values of a sliding window,
+// estimate() covers the values tracked since the previous estimate().
+class HistogramStats {
+ public:
+  using Estimates = PercentileStats::Estimates;
+
+  static constexpr unsigned int kSubBucketBits = 4;
+  static constexpr unsigned int kMaxValueBits = 48;
+  static constexpr size_t kNumBuckets =
+      (kMaxValueBits - kSubBucketBits + 1) << kSubBucketBits;
+
+  // track a value, such as a latency in nanoseconds
+  void trackValue(uint64_t value) noexcept {
+    auto& buckets = buckets_.tlStats();
+    buckets.counts[getBucketIdx(value)]++;
+    buckets.sum += value;
+  }
+
+  // Return the estimates of the values tracked since the previous call.
+  // This merges the histograms of all the threads, so do not call it
+  // frequently.
+  Estimates estimate();
+
+  // visit each estimate using the visitor, with the same names as
+  // PercentileStats
+  // @param visitor   the stat visitor
+  // @param prefix    prefix for the stat name.
+  void visitQuantileEstimator(const CounterVisitor& visitor,
+                              folly::StringPiece statPrefix) {
+    PercentileStats::visitQuantileEstimates(visitor, estimate(), statPrefix);
+  }
+
+  void visitQuantileEstimator(
+      const std::function<void(folly::StringPiece, double)>& visitor,
+      folly::StringPiece statPrefix) {
+    visitQuantileEstimator(CounterVisitor{visitor}, statPrefix);
+  }
+
+  // @return the bucket a value is tracked in
+  static size_t getBucketIdx(uint64_t value) noexcept {
+    constexpr uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    if (value >> kMaxValueBits) {
+      return kNumBuckets - 1;
+    }
+    const auto shift = folly::findLastSet(value) - 1 - kSubBucketBits;
+    return static_cast<size_t>(((shift + 1) << kSubBucketBits) +
+                               ((value >> shift) & (kSubBuckets - 1)));
+  }
+
+  // @return the smallest and the largest value of a bucket
+  static std::pair<uint64_t, uint64_t> getBucketRange(size_t idx) noexcept {
+    constexpr uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+    if (idx < kSubBuckets) {
+      return {idx, idx};
+    }
+    const auto shift = (idx >> kSubBucketBits) - 1;
+    const auto lower = (kSubBuckets + (idx & (kSubBuckets - 1))) << shift;
+    return {lower, lower + (1ULL << shift) - 1};
+  }
+
+ private:
+  struct Buckets {
+    std::array<uint64_t, kNumBuckets> counts{};
+    uint64_t sum{0};
+
+    Buckets& operator+=(const Buckets& other) {
+      for (size_t i = 0; i < kNumBuckets; i++) {
+        counts[i] += other.counts[i];
+      }
+      sum += other.sum;
+      return *this;
+    }
+  };
+
+  static const std::array<double, 14> kQuantiles;
+
+  FastStats<Buckets> buckets_;
+
+  // the merged histogram as of the previous estimate()
+  std::mutex mutex_;
+  Buckets lastSnapshot_;
+};
+
+// Tracks the latency of a scope into a HistogramStats, like LatencyTracker
+// does into a PercentileStats. Callers that already know when the operation
+// started pass that time instead of reading the clock again.
+class HistogramLatencyTracker {
+ public:
+  using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  explicit HistogramLatencyTracker(HistogramStats& stats)
+      : HistogramLatencyTracker(stats, std::chrono::steady_clock::now()) {}
+  HistogramLatencyTracker(HistogramStats& stats, TimePoint begin)
+      : stats_(&stats), begin_(begin) {}
+  HistogramLatencyTracker() {}
+  ~HistogramLatencyTracker() {
+    if (stats_) {
+      finish(std::chrono::steady_clock::now());
+    }
+  }
+
+  // track the latency up to the given time, which the caller already read.
+  // Nothing is tracked on destruction afterwards.
+  void finish(TimePoint end) {
+    if (stats_) {
+      const auto diffNanos =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin_)
+              .count();
+      stats_->trackValue(static_cast<uint64_t>(std::max<int64_t>(
+          0, static_cast<int64_t>(diffNanos))));
+      stats_ = nullptr;
+    }
+  }
+
+  HistogramLatencyTracker(const HistogramLatencyTracker&) = delete;
+  HistogramLatencyTracker& operator=(const HistogramLatencyTracker&) = delete;
+
+  HistogramLatencyTracker(HistogramLatencyTracker&& rhs) noexcept
+      : stats_(rhs.stats_), begin_(rhs.begin_) {
+    rhs.stats_ = nullptr;
+  }
+
+  HistogramLatencyTracker& operator=(HistogramLatencyTracker&& rhs) noexcept {
+    if (this != &rhs) {
+      this->~HistogramLatencyTracker();
+      new (this) HistogramLatencyTracker(std::move(rhs));
+    }
+    return *this;
+  }
+
+ private:
+  HistogramStats* stats_{nullptr};
+  TimePoint begin_;
+};
+} // namespace util
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/common/LockContentionStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace facebook::cachelib::util {
+
+LockContentionStats::LockContentionStats(size_t numStripes,
+                                         uint32_t sampleRate)
+    : numStripes_(numStripes), sampleRate_(sampleRate) {
+  if (numStripes_ == 0) {
+    throw std::invalid_argument("No lock stripes to track contention for");
+  }
+  if (sampleRate_ == 0) {
+    throw std::invalid_argument("Sample rate for lock contention is 0");
+  }
+  stripes_ = std::make_unique<Stripe[]>(numStripes_);
+}
+
+void LockContentionStats::recordWait(size_t stripe,
+                                     std::chrono::nanoseconds wait) {
+  XDCHECK_LT(stripe, numStripes_);
+  const auto waitNs = static_cast<uint64_t>(std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count(), 0));
+  auto& s = stripes_[stripe];
+  s.numSampled.fetch_add(1, std::memory_order_relaxed);
+  s.waitNs.fetch_add(waitNs, std::memory_order_relaxed);
+  waitNs_.trackValue(static_cast<double>(waitNs));
+}
+
+LockContentionStats::Snapshot LockContentionStats::getSnapshot(
+    size_t numHotStripes) const {
+  Snapshot snapshot;
+  std::vector<StripeStats> contended;
+  for (size_t i = 0; i < numStripes_; i++) {
+    const auto stripe = getStripeStats(i);
+    if (stripe.numContended == 0) {
+      continue;
+    }
+    snapshot.numContended += stripe.numContended;
+    snapshot.numSampled += stripe.numSampled;
+    snapshot.waitNs += stripe.waitNs;
+    contended.push_back(stripe);
+  }
+
+  const auto numHot = std::min(numHotStripes, contended.size());
+  std::partial_sort(contended.begin(), contended.begin() + numHot,
+                    contended.end(), [](const auto& a, const auto& b) {
+                      return a.numContended > b.numContended;
+                    });
+  contended.resize(numHot);
+  snapshot.hotStripes = std::move(contended);
+
+  if (snapshot.numSampled > 0) {
+    snapshot.waitNsEstimates = waitNs_.estimate();
+  }
+  return snapshot;
+}
+
+} // namespace facebook::cachelib::util
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cachelib/common/PercentileStats.h"
+
+namespace facebook {
+namespace cachelib {
+namespace util {
+
+// Contention statistics for a set of lock stripes. Callers report the
+// acquisitions that found their lock held. Every contended acquisition is
+// counted, and the wait of one out of sampleRate of them is timed.
+//
+// Nothing is recorded for uncontended acquisitions, so the cost outside of
+// the contended path is the try lock the caller does to detect contention.
+class LockContentionStats {
+ public:
+  struct StripeStats {
+    // index of the stripe
+    size_t stripe{0};
+
+    // number of acquisitions that found the stripe locked
+    uint64_t numContended{0};
+
+    // number of contended acquisitions whose wait was timed
+    uint64_t numSampled{0};
+
+    // total time spent waiting by the sampled acquisitions
+    uint64_t waitNs{0};
+  };
+
+  struct Snapshot {
+    // number of acquisitions that found their lock held
+    uint64_t numContended{0};
+
+    // number of contended acquisitions whose wait was timed
+    uint64_t numSampled{0};
+
+    // total time spent waiting by the sampled acquisitions
+    uint64_t waitNs{0};
+
+    // distribution of the wait of the sampled acquisitions in the recent past
+    PercentileStats::Estimates waitNsEstimates{};
+
+    // most contended stripes, by number of contended acquisitions
+    std::vector<StripeStats> hotStripes;
+  };
+
+  // @param numStripes  number of lock stripes tracked
+  // @param sampleRate  one out of this many contended acquisitions is timed
+  //
+  // @throw std::invalid_argument if numStripes or sampleRate is 0
+  LockContentionStats(size_t numStripes, uint32_t sampleRate);
+
+  // count a contended acquisition of the stripe.
+  //
+  // @return true if the caller should time its wait and report it through
+  //         recordWait
+  bool recordContention(size_t stripe) noexcept {
+    XDCHECK_LT(stripe, numStripes_);
+    stripes_[stripe].numContended.fetch_add(1, std::memory_order_relaxed);
+    static thread_local uint32_t numContended = 0;
+    return ++numContended % sampleRate_ == 0;
+  }
+
+  // record the wait of a sampled contended acquisition of the stripe.
+  void recordWait(size_t stripe, std::chrono::nanoseconds wait);
+
+  // count a contended acquisition of the stripe and acquire the lock with
+  // acquireFn, timing it if sampled.
+  template <typename F>
+  void trackWait(size_t stripe, F&& acquireFn) {
+    if (!recordContention(stripe)) {
+      acquireFn();
+      return;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    acquireFn();
+    recordWait(stripe, std::chrono::steady_clock::now() - begin);
+  }
+
+  size_t getNumStripes() const noexcept { return numStripes_; }
+
+  // @return the stats of a single stripe. Cheaper than getSnapshot.
+  StripeStats getStripeStats(size_t stripe) const noexcept {
+    XDCHECK_LT(stripe, numStripes_);
+    const auto& s = stripes_[stripe];
+    return {stripe, s.numContended.load(std::memory_order_relaxed),
+            s.numSampled.load(std::memory_order_relaxed),
+            s.waitNs.load(std::memory_order_relaxed)};
+  }
+
+  // @param numHotStripes   number of most contended stripes to return
+  //
+  // @return the stats accumulated so far. Only stripes that saw contention
+  //         are returned as hot stripes.
+  Snapshot getSnapshot(size_t numHotStripes) const;
+
+ private:
+  struct Stripe {
+    std::atomic<uint64_t> numContended{0};
+    std::atomic<uint64_t> numSampled{0};
+    std::atomic<uint64_t> waitNs{0};
+  };
+
+  const size_t numStripes_;
+  const uint32_t sampleRate_;
+
+  std::unique_ptr<Stripe[]> stripes_;
+
+  // estimate() is not const
+  mutable PercentileStats waitNs_;
+};
+} // namespace util
+} // namespace cachelib
+} // namespace facebook
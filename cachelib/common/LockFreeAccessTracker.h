@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <folly/Format.h>
+#include <folly/Range.h>
+#include <folly/ThreadLocal.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/common/Hash.h"
+#include "cachelib/common/Ticker.h"
+
+namespace facebook::cachelib {
+// Tracks the access counts of keys over rotating time windows like
+// AccessTracker with counts, without taking a lock, so that it can be
+// consulted on every request, such as for admission decisions.
+//
+// The windows share one count-min sketch whose cells hold a counter per
+// window, next to each other. Reading the history of a key takes the
+// minimum over the rows of whole runs of counters, one cache line or so per
+// row, instead of locking and reading a sketch per window.
+//
+// Accesses are buffered per thread and added to the counters with relaxed
+// atomic increments once the buffer of a thread fills up or its window
+// passes. An access is therefore not visible to getAccesses() right away,
+// not even from the recording thread, until flush() is called from that
+// thread. Rotating to a new window clears its counters while others may
+// still increment them, which can leave an access or so of the old window
+// behind. Both are within the error of the sketch for admission purposes.
+class LockFreeAccessTracker {
+ public:
+  struct Config {
+    // number of past windows to track
+    size_t numBuckets{0};
+
+    // The ticker to be uesd to supply current tick.
+    // If this is not set, the default clock based ticker will be used.
+    std::shared_ptr<Ticker> ticker{std::make_shared<ClockBasedTicker>()};
+
+    // number of ticks per window
+    size_t numTicksPerBucket{3600};
+
+    // maximum number of ops we expect per window
+    size_t maxNumOpsPerBucket{1'000'000};
+
+    // error in count can not be more more than this. Must be non zero
+    size_t cmsMaxErrorValue{1};
+
+    // certainity that the error is within the above margin.
+    double cmsErrorCertainity{0.99};
+
+    // maximum width and depth of the sketch, which bound the memory usage
+    // to width * depth * numBuckets * 4 bytes
+    size_t cmsMaxWidth{8'000'000};
+    size_t cmsMaxDepth{8};
+
+    // number of accesses a thread buffers before adding them to the
+    // counters. 0 adds every access right away.
+    size_t threadBufferSize{64};
+  };
+
+  // @throw std::invalid_argument if the config is invalid
+  explicit LockFreeAccessTracker(Config config)
+      : config_(std::move(config)),
+        width_(calculateWidth(config_)),
+        depth_(calculateDepth(config_)),
+        counters_(std::make_unique<std::atomic<uint32_t>[]>(
+            width_ * depth_ * config_.numBuckets)),
+        itemCounts_(
+            std::make_unique<std::atomic<uint64_t>[]>(config_.numBuckets)),
+        buffers_([this]() { return new Buffer(*this); }) {
+    if (!config_.ticker) {
+      config_.ticker = std::make_shared<ClockBasedTicker>();
+    }
+    mostRecentAccessedBucket_ = getCurrentBucket();
+  }
+
+  // The thread buffers point back to the tracker.
+  LockFreeAccessTracker(const LockFreeAccessTracker&) = delete;
+  LockFreeAccessTracker& operator=(const LockFreeAccessTracker&) = delete;
+
+  // Record an access to the current window.
+  void recordAccess(folly::StringPiece key) {
+    const auto bucket = updateMostRecentAccessedBucket();
+    const auto hashVal = hashKey(key);
+    if (config_.threadBufferSize == 0) {
+      addAccesses(bucket, &hashVal, 1);
+      return;
+    }
+    auto& buffer = *buffers_;
+    if (!buffer.hashes.empty() && buffer.bucket != bucket) {
+      flushBuffer(buffer);
+    }
+    buffer.bucket = bucket;
+    buffer.hashes.push_back(hashVal);
+    if (buffer.hashes.size() >= config_.threadBufferSize) {
+      flushBuffer(buffer);
+    }
+  }
+
+  // Return the access counts of the key.
+  // @return vector of length config_.numBuckets. element i contains
+  //         the access count of current - i window.
+  std::vector<double> getAccesses(folly::StringPiece key) {
+    const auto mostRecent = updateMostRecentAccessedBucket();
+    const auto hashVal = hashKey(key);
+    const size_t numBuckets = config_.numBuckets;
+
+    std::vector<uint32_t> counts(numBuckets,
+                                 std::numeric_limits<uint32_t>::max());
+    for (size_t row = 0; row < depth_; row++) {
+      const auto* cell = &counters_[getCellIndex(row, hashVal)];
+      for (size_t idx = 0; idx < numBuckets; idx++) {
+        counts[idx] =
+            std::min(counts[idx], cell[idx].load(std::memory_order_relaxed));
+      }
+    }
+
+    std::vector<double> features(numBuckets);
+    for (size_t i = 0; i < numBuckets; i++) {
+      features[i] = counts[rotatedIdx(mostRecent + numBuckets - i)];
+    }
+    return features;
+  }
+
+  // Return the access counts of the key and then record an access to it.
+  std::vector<double> recordAndPopulateAccessFeatures(folly::StringPiece key) {
+    auto features = getAccesses(key);
+    recordAccess(key);
+    return features;
+  }
+
+  // Add the accesses buffered by the calling thread to the counters.
+  void flush() { flushBuffer(*buffers_); }
+
+  size_t getNumBuckets() const noexcept { return config_.numBuckets; }
+
+  size_t getByteSize() const noexcept {
+    return width_ * depth_ * config_.numBuckets * sizeof(uint32_t);
+  }
+
+  // Get number of accesses in each window, as flushed.
+  // count[i]: number of accesses in the (current - i) window.
+  std::vector<uint64_t> getRotatedAccessCounts() {
+    const auto mostRecent = updateMostRecentAccessedBucket();
+    std::vector<uint64_t> counts(config_.numBuckets);
+    for (size_t i = 0; i < config_.numBuckets; i++) {
+      counts[i] =
+          itemCounts_[rotatedIdx(mostRecent + config_.numBuckets - i)].load(
+              std::memory_order_relaxed);
+    }
+    return counts;
+  }
+
+ private:
+  static constexpr uint64_t kRandomSeed{314159};
+
+  // accesses of a thread not added to the counters yet
+  struct Buffer {
+    explicit Buffer(LockFreeAccessTracker& t) : tracker(t) {
+      hashes.reserve(t.config_.threadBufferSize);
+    }
+    // hand the accesses of an exiting thread over
+    ~Buffer() { tracker.flushBuffer(*this); }
+
+    LockFreeAccessTracker& tracker;
+    // the window of the accesses, not rotated
+    size_t bucket{0};
+    std::vector<uint64_t> hashes;
+  };
+
+  static size_t calculateWidth(const Config& config) {
+    if (config.numBuckets == 0 || config.maxNumOpsPerBucket == 0 ||
+        config.cmsMaxErrorValue == 0) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid access tracker config: numBuckets {}, maxNumOpsPerBucket "
+          "{}, cmsMaxErrorValue {}",
+          config.numBuckets, config.maxNumOpsPerBucket,
+          config.cmsMaxErrorValue));
+    }
+    // From "Approximating Data with the Count-Min Data Structure" (Cormode &
+    // Muthukrishnan), as CountMinSketch
+    const double error = config.cmsMaxErrorValue /
+                         static_cast<double>(config.maxNumOpsPerBucket);
+    auto width = static_cast<size_t>(std::ceil(2 / std::min(error, 1.0)));
+    return std::max<size_t>(
+        1, config.cmsMaxWidth > 0 ? std::min(config.cmsMaxWidth, width)
+                                  : width);
+  }
+
+  static size_t calculateDepth(const Config& config) {
+    const double probability = config.cmsErrorCertainity;
+    if (probability <= 0 || probability >= 1) {
+      throw std::invalid_argument(folly::sformat(
+          "Probability should be greater than 0 and less than 1. "
+          "Probability: {}",
+          probability));
+    }
+    auto depth = std::max<size_t>(
+        1, static_cast<size_t>(
+               std::ceil(std::abs(std::log(1 - probability) / std::log(2)))));
+    return config.cmsMaxDepth > 0 ? std::min(config.cmsMaxDepth, depth)
+                                  : depth;
+  }
+
+  static uint64_t hashKey(folly::StringPiece key) {
+    return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(),
+                                             kRandomSeed);
+  }
+
+  // the window of the current tick, not rotated
+  size_t getCurrentBucket() const {
+    return config_.ticker->getCurrentTick() / config_.numTicksPerBucket;
+  }
+
+  size_t rotatedIdx(size_t bucket) const { return bucket % config_.numBuckets; }
+
+  // index of the first of the counters of the cell of the row for the hash
+  size_t getCellIndex(size_t row, uint64_t hashVal) const {
+    const auto col = combineHashes(hashInt(row), hashVal) % width_;
+    return (row * width_ + col) * config_.numBuckets;
+  }
+
+  // Move to the window of the current tick, clearing its counters if this
+  // is the first time entering it.
+  //
+  // @return the current window, not rotated
+  size_t updateMostRecentAccessedBucket() {
+    const auto bucket = getCurrentBucket();
+    auto mostRecent = mostRecentAccessedBucket_.load(std::memory_order_relaxed);
+    // we assume that all threads accessing this don't run for more than 2
+    // windows, as AccessTracker
+    while (bucket > mostRecent) {
+      if (mostRecentAccessedBucket_.compare_exchange_weak(mostRecent,
+                                                          bucket)) {
+        // clear the windows skipped over as well
+        auto first = mostRecent + 1;
+        if (bucket >= config_.numBuckets) {
+          first = std::max(first, bucket + 1 - config_.numBuckets);
+        }
+        for (auto b = first; b <= bucket; b++) {
+          resetBucket(rotatedIdx(b));
+        }
+        return bucket;
+      }
+    }
+    return std::max(bucket, mostRecent);
+  }
+
+  void resetBucket(size_t idx) {
+    const size_t numCells = width_ * depth_;
+    for (size_t cell = 0; cell < numCells; cell++) {
+      counters_[cell * config_.numBuckets + idx].store(
+          0, std::memory_order_relaxed);
+    }
+    itemCounts_[idx].store(0, std::memory_order_relaxed);
+  }
+
+  void addAccesses(size_t bucket, const uint64_t* hashes, size_t n) {
+    const auto idx = rotatedIdx(bucket);
+    for (size_t i = 0; i < n; i++) {
+      for (size_t row = 0; row < depth_; row++) {
+        counters_[getCellIndex(row, hashes[i]) + idx].fetch_add(
+            1, std::memory_order_relaxed);
+      }
+    }
+    itemCounts_[idx].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void flushBuffer(Buffer& buffer) {
+    // accesses of a window whose counters were reused are dropped
+    if (!buffer.hashes.empty() &&
+        buffer.bucket + config_.numBuckets >
+            mostRecentAccessedBucket_.load(std::memory_order_relaxed)) {
+      addAccesses(buffer.bucket, buffer.hashes.data(), buffer.hashes.size());
+    }
+    buffer.hashes.clear();
+  }
+
+  Config config_;
+  const size_t width_;
+  const size_t depth_;
+
+  // the most recent window, not rotated
+  std::atomic<size_t> mostRecentAccessedBucket_{0};
+
+  // counters of cell c of window i at c * numBuckets + i
+  std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+
+  // number of accesses of every window
+  std::unique_ptr<std::atomic<uint64_t>[]> itemCounts_;
+
+  // destroyed first, which flushes the buffers into the counters
+  folly::ThreadLocal<Buffer, LockFreeAccessTracker> buffers_;
+};
+} // namespace facebook::cachelib
@@ -29,6 +29,7 @@
 #include <system_error>
 
 #include "cachelib/common/Hash.h"
+#include "cachelib/common/LockContentionStats.h"
 
 namespace facebook {
 namespace cachelib {
@@ -301,7 +302,26 @@ class BaseBucketLocks {
   }
 
   // Get a reference to the lock that will used for this particular hash
-  Lock& getLock(uint64_t hash) noexcept { return *locks_[hash & locksMask_]; }
+  Lock& getLock(uint64_t hash) noexcept { return getLockAt(getLockIdx(hash)); }
+
+  // Get the index of the lock for this key. Mirrors getLock.
+  size_t getLockIdx(const void* data, size_t size) noexcept {
+    return getLockIdx((*hasher_)(data, size));
+  }
+
+  size_t getLockIdx(void* ptr) noexcept {
+    return getLockIdx(&ptr, sizeof(ptr));
+  }
+
+  size_t getLockIdx(folly::StringPiece key) noexcept {
+    return getLockIdx(key.data(), key.size());
+  }
+
+  size_t getLockIdx(uint64_t hash) noexcept { return hash & locksMask_; }
+
+  Lock& getLockAt(size_t idx) noexcept { return *locks_[idx]; }
+
+  size_t getNumLocks() const noexcept { return locks_.size(); }
 
  private:
   // materialized value of (number of locks) - 1
@@ -343,19 +363,46 @@ class RWBucketLocks : public BaseBucketLocks<LockType, LockAlignmentType> {
   using ReadLockHolder = std::shared_lock<LockType>;
   using WriteLockHolder = std::unique_lock<LockType>;
 
-  RWBucketLocks(uint32_t locksPower, std::shared_ptr<Hash> hasher)
-      : Base::BaseBucketLocks(locksPower, std::move(hasher)) {}
+  // @param contentionSampleRate   if not 0, contended acquisitions of
+  //                               lockShared and lockExclusive are counted
+  //                               per lock and one out of this many has its
+  //                               wait timed. See getContentionStats.
+  RWBucketLocks(uint32_t locksPower,
+                std::shared_ptr<Hash> hasher,
+                uint32_t contentionSampleRate = 0)
+      : Base::BaseBucketLocks(locksPower, std::move(hasher)) {
+    if (contentionSampleRate > 0) {
+      contentionStats_ = std::make_unique<util::LockContentionStats>(
+          Base::getNumLocks(), contentionSampleRate);
+    }
+  }
 
   // Lock for this particular key and return a reader lock
   template <typename... Args>
   ReadLockHolder lockShared(Args... args) {
-    return ReadLockHolder{Base::getLock(args...)};
+    if (!contentionStats_) {
+      return ReadLockHolder{Base::getLock(args...)};
+    }
+    const auto idx = Base::getLockIdx(args...);
+    ReadLockHolder l{Base::getLockAt(idx), std::try_to_lock};
+    if (!l.owns_lock()) {
+      contentionStats_->trackWait(idx, [&l] { l.lock(); });
+    }
+    return l;
   }
 
   // Lock for this particular key and return a writer lock
   template <typename... Args>
   WriteLockHolder lockExclusive(Args... args) {
-    return WriteLockHolder{Base::getLock(args...)};
+    if (!contentionStats_) {
+      return WriteLockHolder{Base::getLock(args...)};
+    }
+    const auto idx = Base::getLockIdx(args...);
+    WriteLockHolder l{Base::getLockAt(idx), std::try_to_lock};
+    if (!l.owns_lock()) {
+      contentionStats_->trackWait(idx, [&l] { l.lock(); });
+    }
+    return l;
   }
 
   template <typename... Args>
@@ -363,6 +410,15 @@ class RWBucketLocks : public BaseBucketLocks<LockType, LockAlignmentType> {
     return WriteLockHolder(Base::getLock(args...), std::try_to_lock);
   }
 
+  // Index of the lock for this key, in [0, numLocks()). Keys with the same
+  // index share a lock, so per lock state can be kept alongside.
+  template <typename... Args>
+  size_t lockIdx(Args... args) noexcept {
+    return Base::getLockIdx(args...);
+  }
+
+  size_t numLocks() const noexcept { return Base::getNumLocks(); }
+
   // try to grab the reader lock for a limit _timeout_ duration
   template <typename... Args>
   ReadLockHolder lockShared(const std::chrono::microseconds& timeout,
@@ -382,6 +438,16 @@ class RWBucketLocks : public BaseBucketLocks<LockType, LockAlignmentType> {
             ? WriteLockHolder(Base::getLock(args...))
             : WriteLockHolder(Base::getLock(args...), timeout);
   }
+
+  // @return  contention stats of the locks, indexed by lock, or nullptr if
+  //          contention is not tracked. Acquisitions with a timeout or
+  //          through tryLockExclusive are not tracked.
+  const util::LockContentionStats* getContentionStats() const noexcept {
+    return contentionStats_.get();
+  }
+
+ private:
+  std::unique_ptr<util::LockContentionStats> contentionStats_;
 };
 using TimedMutexRWBuckets =
     RWBucketLocks<folly::fibers::TimedRWMutex<folly::fibers::Baton>>;
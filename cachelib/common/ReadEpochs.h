@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/fibers/TimedMutex.h>
+#include <folly/lang/Align.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cachelib/common/ConditionVariable.h"
+
+namespace facebook {
+namespace cachelib {
+
+// Read side epochs for reclaiming memory that lock-free readers may still be
+// looking at. A reader enters the current epoch on the stripe of its cpu and
+// exits it once done, so readers on different cpus do not share a cacheline.
+//
+// A reclaimer first makes the memory unreachable for new readers, then
+// advances the epoch with synchronize() and waits until every reader of the
+// previous epoch has exited. Once it returns, no reader still refers to the
+// memory. Readers of unrelated memory that entered the previous epoch are
+// waited for as well, which only lasts as long as a read.
+//
+// Readers on fibers may be suspended while they read, hence readers are
+// counted per stripe rather than tracked per thread.
+class ReadEpochs {
+ public:
+  // what a reader needs to exit the epoch it entered
+  struct Ticket {
+    uint16_t stripe{0};
+    uint8_t parity{0};
+  };
+
+  ReadEpochs()
+      : numStripes_{std::max(1u, std::thread::hardware_concurrency())},
+        stripes_{std::make_unique<Stripe[]>(numStripes_)} {}
+
+  ReadEpochs(const ReadEpochs&) = delete;
+  ReadEpochs& operator=(const ReadEpochs&) = delete;
+
+  // Enter the current epoch. Check whether the memory is still reachable
+  // after this.
+  Ticket enter() noexcept {
+    Ticket ticket;
+    ticket.stripe = static_cast<uint16_t>(
+        folly::AccessSpreader<>::cachedCurrent(numStripes_));
+    auto epoch = epoch_.load();
+    while (true) {
+      ticket.parity = static_cast<uint8_t>(epoch & 1);
+      auto& readers = stripes_[ticket.stripe].readers[ticket.parity];
+      readers.fetch_add(1);
+      // With two parities, a reader counted under an epoch that has already
+      // been synchronized would be counted under the next epoch with the
+      // same parity, which the following synchronize() does not wait for.
+      // Enter again if the epoch moved before the reader was counted.
+      const auto current = epoch_.load();
+      if (current == epoch) {
+        return ticket;
+      }
+      readers.fetch_sub(1);
+      notifyWaiters();
+      epoch = current;
+    }
+  }
+
+  // Exit the epoch entered with the ticket, on any cpu
+  void exit(Ticket ticket) noexcept {
+    stripes_[ticket.stripe].readers[ticket.parity].fetch_sub(1);
+    notifyWaiters();
+  }
+
+  // Advance the epoch and wait until the readers of the previous one have
+  // exited. Only one caller advances the epoch at a time.
+  void synchronize() {
+    std::lock_guard<folly::fibers::TimedMutex> sync{syncLock_};
+    const auto parity = static_cast<uint8_t>(epoch_.fetch_add(1) & 1);
+    waiters_.fetch_add(1);
+    {
+      std::unique_lock<folly::fibers::TimedMutex> l{lock_};
+      while (getNumReaders(parity) != 0) {
+        cond_.wait(l);
+      }
+    }
+    waiters_.fetch_sub(1);
+  }
+
+  // @return the number of readers in any epoch
+  uint64_t getNumReaders() const noexcept {
+    return getNumReaders(0) + getNumReaders(1);
+  }
+
+ private:
+  void notifyWaiters() {
+    if (waiters_.load() > 0) {
+      std::lock_guard<folly::fibers::TimedMutex> l{lock_};
+      cond_.notifyAll();
+    }
+  }
+
+  struct alignas(folly::hardware_destructive_interference_size) Stripe {
+    std::atomic<uint64_t> readers[2]{};
+  };
+
+  uint64_t getNumReaders(uint8_t parity) const noexcept {
+    uint64_t num = 0;
+    for (uint32_t i = 0; i < numStripes_; i++) {
+      num += stripes_[i].readers[parity].load();
+    }
+    return num;
+  }
+
+  const uint32_t numStripes_;
+  std::unique_ptr<Stripe[]> stripes_;
+
+  std::atomic<uint64_t> epoch_{0};
+
+  // number of callers waiting for readers to exit. Readers only notify when
+  // there are any.
+  std::atomic<uint32_t> waiters_{0};
+
+  // serializes advancing the epoch
+  folly::fibers::TimedMutex syncLock_;
+
+  mutable folly::fibers::TimedMutex lock_;
+  util::ConditionVariable cond_;
+};
+
+} // namespace cachelib
+} // namespace facebook
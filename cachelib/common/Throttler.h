@@ -70,7 +70,29 @@ class Throttler {
     if (!config_.needsThrottling() || ++counter_ % kSpinLimit) {
       return false;
     }
+    return checkTime();
+  }
+
+  // same as throttle(), but checks the time on every call. For callers that
+  // do a lot of work between the calls, such as a batch of syscalls.
+  bool throttleNow() {
+    if (!config_.needsThrottling()) {
+      return false;
+    }
+    return checkTime();
+  }
+
+  uint64_t numThrottles() const noexcept { return throttleCounter_; }
 
+  explicit Throttler(Config config, ThrottleCb&& throttleCb = nullptr)
+      : config_(std::move(config)),
+        currWorkStartMs_(util::getCurrentTimeMs()),
+        throttleCb_(std::move(throttleCb)) {}
+  explicit Throttler() : Throttler(Config{}) {}
+
+ private:
+  // sleep if we worked for longer than workMs since the last sleep
+  bool checkTime() {
     uint64_t curr = util::getCurrentTimeMs();
     if (throttleCb_) {
       throttleCb_(std::chrono::milliseconds(curr));
@@ -86,15 +108,6 @@ class Throttler {
     return false;
   }
 
-  uint64_t numThrottles() const noexcept { return throttleCounter_; }
-
-  explicit Throttler(Config config, ThrottleCb&& throttleCb = nullptr)
-      : config_(std::move(config)),
-        currWorkStartMs_(util::getCurrentTimeMs()),
-        throttleCb_(std::move(throttleCb)) {}
-  explicit Throttler() : Throttler(Config{}) {}
-
- private:
   // number of spins before we attempt to call time
   static constexpr const uint64_t kSpinLimit = 1024;
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/common/Time.h"
+
+#include <folly/logging/xlog.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace facebook {
+namespace cachelib {
+namespace util {
+namespace {
+struct CoarseClockState {
+  // serializes starting and stopping the thread, including the join
+  std::mutex lifecycleMutex;
+  size_t numInstances{0};
+  std::thread thread;
+
+  // protects stop, which the thread waits on
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stop{false};
+};
+
+// never destroyed, so that instances destroyed at exit can still stop it
+CoarseClockState& getCoarseClockState() {
+  static auto* state = new CoarseClockState();
+  return *state;
+}
+
+uint32_t getSystemTimeSec() {
+  return static_cast<uint32_t>(std::time(nullptr));
+}
+} // namespace
+
+CoarseClock::CoarseClock() {
+  auto& state = getCoarseClockState();
+  std::lock_guard<std::mutex> l(state.lifecycleMutex);
+  if (state.numInstances++ > 0) {
+    return;
+  }
+
+  state.stop = false;
+  detail::coarseTimeSec.store(getSystemTimeSec(), std::memory_order_relaxed);
+  state.thread = std::thread([&state]() {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (!state.cv.wait_for(lock, kUpdateInterval,
+                              [&state]() { return state.stop; })) {
+      detail::coarseTimeSec.store(getSystemTimeSec(),
+                                  std::memory_order_relaxed);
+    }
+  });
+}
+
+CoarseClock::~CoarseClock() {
+  auto& state = getCoarseClockState();
+  std::lock_guard<std::mutex> l(state.lifecycleMutex);
+  XDCHECK_GT(state.numInstances, 0u);
+  if (--state.numInstances > 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stop = true;
+  }
+  state.cv.notify_all();
+  state.thread.join();
+  detail::coarseTimeSec.store(0, std::memory_order_relaxed);
+}
+} // namespace util
+} // namespace cachelib
+} // namespace facebook
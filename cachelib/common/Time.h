@@ -15,7 +15,9 @@
  */
 
 #pragma once
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <stdexcept>
 
@@ -23,15 +25,47 @@ namespace facebook {
 namespace cachelib {
 namespace util {
 
+namespace detail {
+// seconds since epoch kept by the coarse clock, 0 while it is not running
+inline std::atomic<uint32_t> coarseTimeSec{0};
+} // namespace detail
+
 // ::time is the fastest for getting the second granularity system clock
 // through the vdso. This is faster than std::chrono::system_clock::now and
-// counting it as seconds since epoch.
+// counting it as seconds since epoch. While the coarse clock runs, the time
+// it keeps is returned instead, which saves the vdso call on every access
+// and allocation.
 inline uint32_t getCurrentTimeSec() {
+  const auto coarseTime =
+      detail::coarseTimeSec.load(std::memory_order_relaxed);
+  if (coarseTime != 0) {
+    return coarseTime;
+  }
   // time in seconds since epoch will fit in 32 bit. We use this primarily for
   // storing in cache.
   return static_cast<uint32_t>(std::time(nullptr));
 }
 
+// Second granularity clock kept by a background thread, for
+// getCurrentTimeSec(). It runs while at least one CoarseClock instance is
+// alive, and is shared by all of them. It lags the system clock by at most
+// kUpdateInterval.
+class CoarseClock {
+ public:
+  static constexpr std::chrono::milliseconds kUpdateInterval{10};
+
+  CoarseClock();
+  ~CoarseClock();
+
+  CoarseClock(const CoarseClock&) = delete;
+  CoarseClock& operator=(const CoarseClock&) = delete;
+
+  // @return whether the coarse clock is running
+  static bool isRunning() noexcept {
+    return detail::coarseTimeSec.load(std::memory_order_relaxed) != 0;
+  }
+};
+
 // For nano second granularity, std::chrono::steady_clock seems to do a fine
 // job.
 inline uint64_t getCurrentTimeMs() {
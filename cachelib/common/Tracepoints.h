@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// USDT static probes at the hot paths of the allocator and navy, for tracing
+// events such as evictions or region reclaims with bpftrace or perf in
+// production. For example:
+//
+//   bpftrace -e 'usdt:<binary>:cachelib:dram_evict { @[arg0, arg1] = count(); }'
+//
+// A probe is a nop in the code and its arguments are only read by the tracer,
+// but they are compiled out unless the build defines CACHELIB_TRACEPOINTS
+// (the cmake option of the same name). Arguments must be integers or
+// pointers.
+//
+// Probes of the provider "cachelib" and their arguments:
+//   allocate             pool id, class id, size, allocated (0 or 1)
+//   dram_evict           pool id, class id, key data, key size
+//   find_miss            key data, key size, expired (0 or 1)
+//   slab_release         pool id, victim class id, receiver class id, mode
+//   nvm_put              key data, key size, value size
+//   nvm_admission_reject key hash, key size, value size
+//   nvm_fill             key data, key size, filled (0 or 1)
+//   bc_region_reclaim    region id, evicted items
+//   bc_reinsertion       key hash, entry size
+//   bh_bucket_rmw        bucket id, removed items, evicted items
+
+#ifdef CACHELIB_TRACEPOINTS
+#include <folly/tracing/StaticTracepoint.h>
+
+#define CACHELIB_TRACEPOINT(name, ...) FOLLY_SDT(cachelib, name, __VA_ARGS__)
+#else
+#define CACHELIB_TRACEPOINT(name, ...) \
+  do {                                 \
+  } while (false)
+#endif
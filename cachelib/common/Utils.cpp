@@ -30,7 +30,9 @@
 #pragma GCC diagnostic ignored "-Wconversion"
 #include <folly/Format.h>
 #pragma GCC diagnostic pop
+#include <folly/Bits.h>
 #include <folly/Random.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 
 #include "cachelib/common/Utils.h"
@@ -166,12 +168,54 @@ void* align(size_t alignment, size_t size, void*& ptr, size_t& space) {
 
 void* mmapAlignedZeroedMemory(size_t alignment,
                               size_t numBytes,
-                              bool noAccess) {
+                              bool noAccess,
+                              size_t hugePageSize) {
   // to enforce alignment, we try to make sure that the address we return is
   // aligned to slab size.
   size_t newBytes = numBytes + alignment;
   const auto protFlag = noAccess ? PROT_NONE : PROT_READ | PROT_WRITE;
-  const auto mapFlag = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  auto mapFlag = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  if (hugePageSize != 0) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    if (!folly::isPowTwo(hugePageSize) || !folly::isPowTwo(alignment)) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid huge page size {} for alignment {}", hugePageSize,
+          alignment));
+    }
+    // hugetlb pages are reserved at mmap time only without MAP_NORESERVE.
+    // Otherwise running out of huge pages surfaces as SIGBUS on first touch
+    // instead of an error here.
+    const int pageShift = folly::findLastSet(hugePageSize) - 1;
+    mapFlag = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+              (pageShift << MAP_HUGE_SHIFT);
+    // the mapping is aligned to the huge page size already, so it is
+    // over-mapped only for an alignment larger than that. The slack is
+    // unmapped right away, so that no huge page stays reserved for it.
+    const size_t mappedBytes =
+        getAlignedSize(numBytes, static_cast<uint32_t>(hugePageSize));
+    const size_t slack =
+        alignment > hugePageSize ? alignment - hugePageSize : 0;
+    void* memory =
+        mmap(nullptr, mappedBytes + slack, protFlag, mapFlag, -1, 0);
+    if (memory == MAP_FAILED) {
+      throw std::system_error(errno, std::system_category(), "Cannot mmap");
+    }
+    auto* start = static_cast<uint8_t*>(memory);
+    auto* alignedStart = reinterpret_cast<uint8_t*>(getAlignedSize(
+        reinterpret_cast<uintptr_t>(start), static_cast<uint32_t>(alignment)));
+    const size_t head = alignedStart - start;
+    if (head != 0) {
+      munmap(start, head);
+    }
+    if (slack != head) {
+      munmap(alignedStart + mappedBytes, slack - head);
+    }
+    return alignedStart;
+#else
+    throw std::system_error(ENOTSUP, std::system_category(),
+                            "Huge pages are not supported");
+#endif
+  }
   void* memory = mmap(nullptr, newBytes, protFlag, mapFlag, -1, 0);
   if (memory != MAP_FAILED) {
     auto alignedMemory = align(alignment, numBytes, memory, newBytes);
@@ -428,6 +472,81 @@ size_t getMemAvailable() {
   return 0;
 }
 
+namespace {
+// reads a single value cgroup file. "max" reads as 0, like a missing file.
+size_t readCgroupValue(const std::string& cgroupDir, folly::StringPiece name) {
+  std::string content;
+  if (!folly::readFile(folly::sformat("{}/{}", cgroupDir, name).c_str(),
+                       content)) {
+    return 0;
+  }
+  return folly::tryTo<size_t>(folly::trimWhitespace(content)).value_or(0);
+}
+} // namespace
+
+std::string getCgroupDir() {
+  // a cgroup v2 process has a line formatted as 0::/path/of/the/cgroup
+  std::string cgroupStr;
+  if (!folly::readFile("/proc/self/cgroup", cgroupStr)) {
+    return {};
+  }
+
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', cgroupStr, lines);
+
+  constexpr folly::StringPiece unifiedStr{"0::"};
+  for (auto l : lines) {
+    if (l.startsWith(unifiedStr)) {
+      l.advance(unifiedStr.size());
+      return folly::sformat("/sys/fs/cgroup{}", l == "/" ? "" : l);
+    }
+  }
+  return {};
+}
+
+CgroupMemoryStats getCgroupMemoryStats(const std::string& cgroupDir) {
+  CgroupMemoryStats stats;
+  const auto dir = cgroupDir.empty() ? getCgroupDir() : cgroupDir;
+  if (dir.empty()) {
+    return stats;
+  }
+
+  stats.usageBytes = readCgroupValue(dir, "memory.current");
+  stats.limitBytes = readCgroupValue(dir, "memory.high");
+  if (stats.limitBytes == 0) {
+    stats.limitBytes = readCgroupValue(dir, "memory.max");
+  }
+
+  // format is
+  // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  std::string pressureStr;
+  if (!folly::readFile(folly::sformat("{}/memory.pressure", dir).c_str(),
+                       pressureStr)) {
+    return stats;
+  }
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', pressureStr, lines);
+
+  constexpr folly::StringPiece totalStr{"total="};
+  for (auto l : lines) {
+    const auto pos = l.find(totalStr);
+    if (pos == folly::StringPiece::npos) {
+      continue;
+    }
+    const auto total =
+        folly::tryTo<uint64_t>(
+            folly::trimWhitespace(l.subpiece(pos + totalStr.size())))
+            .value_or(0);
+    if (l.startsWith("some")) {
+      stats.someStallUs = total;
+    } else if (l.startsWith("full")) {
+      stats.fullStallUs = total;
+    }
+  }
+  return stats;
+}
+
 void printExceptionStackTraces() {
   auto exceptions = folly::exception_tracer::getCurrentExceptions();
   for (auto& exc : exceptions) {
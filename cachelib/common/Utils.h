@@ -288,12 +288,17 @@ std::enable_if_t<std::is_arithmetic<T>::value, T> getDivCeiling(
 // @param alignment   the desired alignment
 // @param numBytes    the length of the mapping
 // @param noAccess    whether or not this mapping is going to be accessed
+// @param hugePageSize  if non-zero, back the mapping with hugetlb pages of
+//                      this size. The length is rounded up to a multiple
+//                      of it, and both must be powers of two.
 // @return    pointer to aligned memory or nullptr on error
 //
-// @throw std::system_error if unable to create mapping
+// @throw std::system_error if unable to create mapping, which includes not
+//        having enough huge pages reserved.
 void* mmapAlignedZeroedMemory(size_t alignment,
                               size_t numBytes,
-                              bool noAccess = false);
+                              bool noAccess = false,
+                              size_t hugePageSize = 0);
 
 // get the number of pages in the range which are resident in the process.
 //
@@ -361,6 +366,29 @@ size_t getRSSBytes();
 // returns the current mem-available reported by the kernel. 0 means an error.
 size_t getMemAvailable();
 
+// Memory usage and pressure of a cgroup v2
+struct CgroupMemoryStats {
+  // memory.current. 0 means an error.
+  size_t usageBytes{0};
+
+  // memory.high, or memory.max if memory.high is not set. 0 means no limit
+  // or an error.
+  size_t limitBytes{0};
+
+  // cumulative microseconds some or all of the tasks of the cgroup stalled
+  // waiting for memory, from memory.pressure (PSI)
+  uint64_t someStallUs{0};
+  uint64_t fullStallUs{0};
+};
+
+// returns the directory of the cgroup v2 of the current process under the
+// cgroup mount point. Empty means an error or a cgroup v1 only host.
+std::string getCgroupDir();
+
+// returns the memory usage and pressure of the cgroup v2 at @cgroupDir, or of
+// the cgroup of the current process if @cgroupDir is empty
+CgroupMemoryStats getCgroupMemoryStats(const std::string& cgroupDir);
+
 // Print stack trace for the current exception thrown
 void printExceptionStackTraces();
 
@@ -17,7 +17,11 @@
 #include <folly/Random.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include "cachelib/common/AccessTracker.h"
+#include "cachelib/common/LockFreeAccessTracker.h"
 
 namespace facebook {
 namespace cachelib {
@@ -185,5 +189,73 @@ TEST_P(AccessTrackerTest, separateAccessTrackingAndPopulate) {
   assertVecEq(tracker.getAccesses(key), {1, 5, 0});
 }
 
+TEST(LockFreeAccessTrackerTest, Windows) {
+  auto ticker = std::make_shared<detail::NumberTicker>();
+  LockFreeAccessTracker::Config config;
+  config.numBuckets = 3;
+  config.numTicksPerBucket = 10;
+  config.maxNumOpsPerBucket = 1000;
+  config.ticker = ticker;
+  LockFreeAccessTracker tracker{std::move(config)};
+
+  tracker.recordAccess("key0");
+  tracker.recordAccess("key0");
+  // Accesses are buffered until flushed.
+  EXPECT_EQ((std::vector<double>{0, 0, 0}), tracker.getAccesses("key0"));
+  tracker.flush();
+  EXPECT_EQ((std::vector<double>{2, 0, 0}), tracker.getAccesses("key0"));
+
+  ticker->setTicks(10);
+  tracker.recordAccess("key0");
+  tracker.recordAccess("key1");
+  tracker.flush();
+  EXPECT_EQ((std::vector<double>{1, 2, 0}), tracker.getAccesses("key0"));
+  EXPECT_EQ((std::vector<double>{1, 0, 0}), tracker.getAccesses("key1"));
+  EXPECT_EQ((std::vector<uint64_t>{2, 2, 0}),
+            tracker.getRotatedAccessCounts());
+
+  // Accesses buffered in a window that is reused are dropped.
+  tracker.recordAccess("key0");
+  ticker->setTicks(40);
+  EXPECT_EQ((std::vector<double>{0, 0, 0}), tracker.getAccesses("key0"));
+  tracker.flush();
+  EXPECT_EQ((std::vector<double>{0, 0, 0}), tracker.getAccesses("key0"));
+  EXPECT_EQ((std::vector<uint64_t>{0, 0, 0}),
+            tracker.getRotatedAccessCounts());
+}
+
+TEST(LockFreeAccessTrackerTest, Unbuffered) {
+  LockFreeAccessTracker::Config config;
+  config.numBuckets = 2;
+  config.maxNumOpsPerBucket = 1000;
+  config.threadBufferSize = 0;
+  LockFreeAccessTracker tracker{std::move(config)};
+  EXPECT_EQ((std::vector<double>{0, 0}),
+            tracker.recordAndPopulateAccessFeatures("key0"));
+  EXPECT_EQ((std::vector<double>{1, 0}),
+            tracker.recordAndPopulateAccessFeatures("key0"));
+}
+
+TEST(LockFreeAccessTrackerTest, Threads) {
+  LockFreeAccessTracker::Config config;
+  config.numBuckets = 2;
+  config.maxNumOpsPerBucket = 1000;
+  LockFreeAccessTracker tracker{std::move(config)};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&tracker]() {
+      for (int i = 0; i < 1000; i++) {
+        tracker.recordAccess("key0");
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // the buffers of the threads are flushed when they exit
+  EXPECT_EQ(4000, tracker.getAccesses("key0")[0]);
+  EXPECT_EQ(4000, tracker.getRotatedAccessCounts()[0]);
+}
+
 } // namespace cachelib
 } // namespace facebook
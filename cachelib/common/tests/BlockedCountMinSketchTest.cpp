@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/common/BlockedCountMinSketch.h"
+
+namespace facebook::cachelib::tests {
+using util::BlockedCountMinSketch;
+
+TEST(BlockedCountMinSketch, Simple) {
+  BlockedCountMinSketch cms{1000};
+  // rounded up to 8 blocks
+  EXPECT_EQ(1024, cms.getNumCounters());
+  EXPECT_EQ(512, cms.getByteSize());
+
+  std::mt19937_64 rg{1};
+  std::vector<uint64_t> keys;
+  for (uint32_t i = 0; i < 10; i++) {
+    keys.push_back(rg());
+    for (uint32_t j = 0; j < i; j++) {
+      cms.increment(keys[i]);
+    }
+  }
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    EXPECT_GE(cms.getCount(keys[i]), i);
+  }
+
+  cms.reset();
+  for (auto key : keys) {
+    EXPECT_EQ(0, cms.getCount(key));
+  }
+}
+
+TEST(BlockedCountMinSketch, Saturate) {
+  BlockedCountMinSketch cms{128};
+  for (uint32_t i = 0; i < 100; i++) {
+    cms.increment(1);
+  }
+  EXPECT_EQ(BlockedCountMinSketch::kMaxCount, cms.getCount(1));
+}
+
+TEST(BlockedCountMinSketch, Halve) {
+  BlockedCountMinSketch cms{1 << 16};
+  std::mt19937_64 rg{1};
+  std::vector<uint64_t> keys;
+  for (uint32_t i = 0; i < 16; i++) {
+    keys.push_back(rg());
+    for (uint32_t j = 0; j < i; j++) {
+      cms.increment(keys[i]);
+    }
+  }
+  // with a counter per key in every row of a block, the keys rarely collide
+  // in all rows
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(std::min(i, BlockedCountMinSketch::kMaxCount),
+              cms.getCount(keys[i]));
+  }
+  cms.halve();
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(std::min(i, BlockedCountMinSketch::kMaxCount) / 2,
+              cms.getCount(keys[i]));
+  }
+}
+
+TEST(BlockedCountMinSketch, Empty) {
+  BlockedCountMinSketch cms;
+  cms.increment(1);
+  cms.halve();
+  EXPECT_EQ(0, cms.getCount(1));
+  EXPECT_EQ(0, cms.getByteSize());
+  EXPECT_THROW(BlockedCountMinSketch{0}, std::invalid_argument);
+}
+} // namespace facebook::cachelib::tests
@@ -344,6 +344,205 @@ TEST(BloomFilter, PersistRecoveryValid) {
   testPersistRecoveryWithParams(numFilters, bitsPerFilterHash, numHash);
 }
 
+TEST(BloomFilter, Blocked) {
+  auto bf = BloomFilter::makeBlockedBloomFilter(4, 4, 100);
+  EXPECT_TRUE(bf.isBlocked());
+  EXPECT_EQ(4, bf.numHashes());
+  // rounded up to whole words
+  EXPECT_EQ(128, bf.numBitsPerFilter());
+  EXPECT_EQ(64, bf.getByteSize());
+
+  for (uint32_t i = 0; i < 4; i++) {
+    for (uint64_t key = 0; key < 10; key++) {
+      bf.set(i, key + i * 10);
+    }
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    for (uint64_t key = 0; key < 10; key++) {
+      EXPECT_TRUE(bf.couldExist(i, key + i * 10));
+    }
+  }
+
+  bf.clear(1);
+  for (uint64_t key = 0; key < 10; key++) {
+    EXPECT_FALSE(bf.couldExist(1, key + 10));
+    EXPECT_TRUE(bf.couldExist(2, key + 20));
+  }
+
+  bf.reset();
+  for (uint64_t key = 0; key < 10; key++) {
+    EXPECT_FALSE(bf.couldExist(2, key + 20));
+  }
+
+  EXPECT_THROW(BloomFilter::makeBlockedBloomFilter(0, 4, 64),
+               std::invalid_argument);
+  EXPECT_THROW(BloomFilter::makeBlockedBloomFilter(4, 0, 64),
+               std::invalid_argument);
+  EXPECT_THROW(BloomFilter::makeBlockedBloomFilter(
+                   4, BloomFilter::kMaxBlockedHashes + 1, 64),
+               std::invalid_argument);
+  EXPECT_THROW(BloomFilter::makeBlockedBloomFilter(4, 4, 0),
+               std::invalid_argument);
+}
+
+TEST(BloomFilter, BlockedFalsePositives) {
+  // a single word blocked filter does not do worse than the per hash tables
+  // of the same size, the setup BigHash uses with 8 bytes per bucket
+  const uint32_t numFilters = 1000;
+  const uint64_t keysPerFilter = 20;
+  auto blocked = BloomFilter::makeBlockedBloomFilter(numFilters, 4, 64);
+  BloomFilter partitioned{numFilters, 4, 16};
+  EXPECT_EQ(blocked.getByteSize(), partitioned.getByteSize());
+
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < numFilters; i++) {
+    for (uint64_t k = 0; k < keysPerFilter; k++, key++) {
+      blocked.set(i, key);
+      partitioned.set(i, key);
+    }
+  }
+
+  uint64_t blockedFp = 0;
+  uint64_t partitionedFp = 0;
+  for (uint32_t i = 0; i < numFilters; i++) {
+    for (uint64_t k = 0; k < 100; k++, key++) {
+      blockedFp += blocked.couldExist(i, key);
+      partitionedFp += partitioned.couldExist(i, key);
+    }
+  }
+  EXPECT_LE(blockedFp, partitionedFp);
+}
+
+TEST(BloomFilter, BlockedPersistRecovery) {
+  const uint32_t numFilters = 100;
+  auto makeBf = [=]() {
+    auto bf = BloomFilter::makeBlockedBloomFilter(numFilters, 4, 64);
+    for (uint64_t key = 0; key < 1000; key++) {
+      bf.set(key % numFilters, key);
+    }
+    folly::IOBufQueue queue;
+    auto rw = createMemoryRecordWriter(queue);
+    bf.persist<apache::thrift::BinarySerializer>(*rw);
+    return queue;
+  };
+
+  // the layouts differ, a blocked filter can't be recovered as a regular one
+  {
+    auto queue = makeBf();
+    auto rr = createMemoryRecordReader(queue);
+    BloomFilter bf{numFilters, 4, 16};
+    ASSERT_THROW(bf.recover<apache::thrift::BinarySerializer>(*rr),
+                 std::invalid_argument);
+  }
+
+  auto queue = makeBf();
+  auto rr = createMemoryRecordReader(queue);
+  auto bf = BloomFilter::makeBlockedBloomFilter(numFilters, 4, 64);
+  bf.recover<apache::thrift::BinarySerializer>(*rr);
+  EXPECT_TRUE(bf.isBlocked());
+  for (uint64_t key = 0; key < 1000; key++) {
+    EXPECT_TRUE(bf.couldExist(key % numFilters, key));
+  }
+}
+
+TEST(BloomFilter, SplitBlock) {
+  auto bf = BloomFilter::makeSplitBlockBloomFilter(4, 300);
+  EXPECT_TRUE(bf.isSplitBlock());
+  EXPECT_FALSE(bf.isBlocked());
+  EXPECT_EQ(BloomFilter::kSplitBlockHashes, bf.numHashes());
+  // rounded up to whole blocks
+  EXPECT_EQ(512, bf.numBitsPerFilter());
+  EXPECT_EQ(256, bf.getByteSize());
+
+  for (uint32_t i = 0; i < 4; i++) {
+    for (uint64_t key = 0; key < 10; key++) {
+      bf.set(i, key + i * 10);
+    }
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    for (uint64_t key = 0; key < 10; key++) {
+      EXPECT_TRUE(bf.couldExist(i, key + i * 10));
+    }
+  }
+
+  bf.clear(1);
+  for (uint64_t key = 0; key < 10; key++) {
+    EXPECT_FALSE(bf.couldExist(1, key + 10));
+    EXPECT_TRUE(bf.couldExist(2, key + 20));
+  }
+
+  bf.reset();
+  for (uint64_t key = 0; key < 10; key++) {
+    EXPECT_FALSE(bf.couldExist(2, key + 20));
+  }
+
+  EXPECT_THROW(BloomFilter::makeSplitBlockBloomFilter(0, 256),
+               std::invalid_argument);
+  EXPECT_THROW(BloomFilter::makeSplitBlockBloomFilter(4, 0),
+               std::invalid_argument);
+}
+
+TEST(BloomFilter, SplitBlockFalsePositives) {
+  // filters of many keys at 16 bits per key, as for a negative cache
+  const uint32_t numFilters = 100;
+  const uint64_t keysPerFilter = 256;
+  auto splitBlock = BloomFilter::makeSplitBlockBloomFilter(numFilters, 4096);
+  auto blocked = BloomFilter::makeBlockedBloomFilter(numFilters, 4, 4096);
+  EXPECT_EQ(splitBlock.getByteSize(), blocked.getByteSize());
+
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < numFilters; i++) {
+    for (uint64_t k = 0; k < keysPerFilter; k++, key++) {
+      splitBlock.set(i, key);
+      blocked.set(i, key);
+    }
+  }
+
+  uint64_t splitBlockFp = 0;
+  uint64_t blockedFp = 0;
+  const uint64_t numProbes = 1000;
+  for (uint32_t i = 0; i < numFilters; i++) {
+    for (uint64_t k = 0; k < numProbes; k++, key++) {
+      splitBlockFp += splitBlock.couldExist(i, key);
+      blockedFp += blocked.couldExist(i, key);
+    }
+  }
+  EXPECT_LE(splitBlockFp, blockedFp);
+  EXPECT_LT(splitBlockFp, numFilters * numProbes / 200);
+}
+
+TEST(BloomFilter, SplitBlockPersistRecovery) {
+  const uint32_t numFilters = 100;
+  auto makeBf = [=]() {
+    auto bf = BloomFilter::makeSplitBlockBloomFilter(numFilters, 256);
+    for (uint64_t key = 0; key < 1000; key++) {
+      bf.set(key % numFilters, key);
+    }
+    folly::IOBufQueue queue;
+    auto rw = createMemoryRecordWriter(queue);
+    bf.persist<apache::thrift::BinarySerializer>(*rw);
+    return queue;
+  };
+
+  // the layouts differ, a split block filter can't be recovered as a blocked
+  // one of the same size
+  {
+    auto queue = makeBf();
+    auto rr = createMemoryRecordReader(queue);
+    auto bf = BloomFilter::makeBlockedBloomFilter(numFilters, 8, 256);
+    ASSERT_FALSE(bf.tryRecover<apache::thrift::BinarySerializer>(*rr));
+  }
+
+  auto queue = makeBf();
+  auto rr = createMemoryRecordReader(queue);
+  auto bf = BloomFilter::makeSplitBlockBloomFilter(numFilters, 256);
+  bf.recover<apache::thrift::BinarySerializer>(*rr);
+  EXPECT_TRUE(bf.isSplitBlock());
+  for (uint64_t key = 0; key < 1000; key++) {
+    EXPECT_TRUE(bf.couldExist(key % numFilters, key));
+  }
+}
+
 } // namespace navy
 } // namespace cachelib
 } // namespace facebook
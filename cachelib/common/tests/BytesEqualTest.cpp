@@ -84,6 +84,24 @@ TEST(bytesEqual, alignment_equal) { testAllAlignment(true); }
 
 TEST(bytesEqual, alignment_notequal) { testAllAlignment(false); }
 
+// keys that differ in a single byte must compare unequal whichever word of
+// the short compare covers that byte
+TEST(bytesEqual, singleByteDiff) {
+  auto a = generateRandomString();
+  auto b = a;
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t len = 0; len <= 4 * kShortBytesEqualMaxLen; len++) {
+      ASSERT_TRUE(bytesEqual(&a[offset], &b[offset], len));
+      for (size_t pos = 0; pos < len; pos++) {
+        b[offset + pos] ^= 1;
+        ASSERT_FALSE(bytesEqual(&a[offset], &b[offset], len))
+            << "len " << len << " pos " << pos;
+        b[offset + pos] ^= 1;
+      }
+    }
+  }
+}
+
 TEST(bytesEqual, randomCmp) {
 #ifdef FOLLY_SANITIZE_ADDRESS
   const auto kRandomCmps = 100;
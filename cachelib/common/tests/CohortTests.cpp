@@ -18,6 +18,12 @@
 #include <folly/fibers/Baton.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include "cachelib/common/Cohort.h"
 
 namespace facebook {
@@ -176,6 +182,61 @@ TEST(Cohort, MultiThreaded) {
   }
 }
 
+// readers keep the version they got while it is updated
+TEST(CohortRcu, ReadUpdate) {
+  CohortRcu<std::vector<int>> rcu{{1}};
+  std::thread writer;
+  {
+    auto v1 = rcu.read();
+    EXPECT_EQ(std::vector<int>{1}, *v1);
+    // the update waits for v1 to go away, so run it elsewhere
+    writer = std::thread{[&rcu] {
+      EXPECT_EQ(2, rcu.update([](std::vector<int>& v) {
+        v.push_back(2);
+        return static_cast<int>(v.size());
+      }));
+    }};
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(std::vector<int>{1}, *v1);
+  }
+  writer.join();
+  EXPECT_EQ((std::vector<int>{1, 2}), *rcu.read());
+
+  // a throwing update keeps the current version
+  auto clearAndThrow = [](std::vector<int>& v) {
+    v.clear();
+    throw std::runtime_error("failed");
+  };
+  EXPECT_THROW(rcu.update(clearAndThrow), std::runtime_error);
+  EXPECT_EQ((std::vector<int>{1, 2}), *rcu.read());
+}
+
+// concurrent readers always see a complete version
+TEST(CohortRcu, ConcurrentReaders) {
+  CohortRcu<std::vector<int>> rcu;
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&rcu, &stop] {
+      while (!stop) {
+        auto v = rcu.read();
+        for (size_t j = 0; j < v->size(); j++) {
+          ASSERT_EQ(static_cast<int>(j), (*v)[j]);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++) {
+    rcu.update([i](std::vector<int>& v) { v.push_back(i); });
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(100, rcu.read()->size());
+}
+
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
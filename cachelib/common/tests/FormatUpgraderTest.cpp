@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "cachelib/common/FormatUpgrader.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+TEST(FormatUpgrader, Current) {
+  FormatUpgrader<std::string> upgrader{3};
+  EXPECT_EQ(3, upgrader.getCurrentVersion());
+  EXPECT_TRUE(upgrader.canUpgrade(3));
+  EXPECT_FALSE(upgrader.canUpgrade(2));
+  EXPECT_FALSE(upgrader.canUpgrade(4));
+
+  std::string state = "v3";
+  upgrader.upgrade(3, state);
+  EXPECT_EQ("v3", state);
+  EXPECT_THROW(upgrader.upgrade(2, state), std::invalid_argument);
+  EXPECT_THROW(upgrader.upgrade(4, state), std::invalid_argument);
+  EXPECT_EQ("v3", state);
+}
+
+TEST(FormatUpgrader, Steps) {
+  FormatUpgrader<std::string> upgrader{3};
+  EXPECT_THROW(upgrader.addStep(3, [](std::string&) {}),
+               std::invalid_argument);
+
+  upgrader.addStep(2, [](std::string& s) { s += "->v3"; });
+  EXPECT_TRUE(upgrader.canUpgrade(2));
+  EXPECT_FALSE(upgrader.canUpgrade(1));
+
+  // a gap in the chain stops the upgrade before any step runs
+  std::string state = "v0";
+  upgrader.addStep(0, [](std::string& s) { s += "->v1"; });
+  EXPECT_FALSE(upgrader.canUpgrade(0));
+  EXPECT_THROW(upgrader.upgrade(0, state), std::invalid_argument);
+  EXPECT_EQ("v0", state);
+
+  upgrader.addStep(1, [](std::string& s) { s += "->v2"; });
+  EXPECT_TRUE(upgrader.canUpgrade(0));
+  upgrader.upgrade(0, state);
+  EXPECT_EQ("v0->v1->v2->v3", state);
+
+  state = "v2";
+  upgrader.upgrade(2, state);
+  EXPECT_EQ("v2->v3", state);
+
+  upgrader.removeStep(1);
+  EXPECT_FALSE(upgrader.canUpgrade(0));
+  EXPECT_TRUE(upgrader.canUpgrade(2));
+}
+
+TEST(FormatUpgrader, StepThrows) {
+  FormatUpgrader<std::string> upgrader{2};
+  upgrader.addStep(1, [](std::string&) { throw std::runtime_error("bad"); });
+  std::string state;
+  EXPECT_THROW(upgrader.upgrade(1, state), std::runtime_error);
+}
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
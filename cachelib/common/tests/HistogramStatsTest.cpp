@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "cachelib/common/HistogramStats.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+
+using util::HistogramStats;
+
+TEST(HistogramStats, Buckets) {
+  for (uint64_t v = 0; v < 16; v++) {
+    EXPECT_EQ(v, HistogramStats::getBucketIdx(v));
+  }
+
+  // buckets are contiguous, and every value is within its bucket
+  size_t prevIdx = 0;
+  for (uint64_t v = 1; v < (1ULL << 20); v += v / 64 + 1) {
+    const auto idx = HistogramStats::getBucketIdx(v);
+    EXPECT_GE(idx, prevIdx);
+    EXPECT_LE(idx, prevIdx + 1);
+    prevIdx = idx;
+    const auto range = HistogramStats::getBucketRange(idx);
+    EXPECT_LE(range.first, v);
+    EXPECT_GE(range.second, v);
+    // within 1/16 of the value
+    EXPECT_LE(range.second - range.first, v / 16);
+  }
+
+  EXPECT_EQ(HistogramStats::kNumBuckets - 1,
+            HistogramStats::getBucketIdx(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ((1ULL << HistogramStats::kMaxValueBits) - 1,
+            HistogramStats::getBucketRange(HistogramStats::kNumBuckets - 1)
+                .second);
+}
+
+TEST(HistogramStats, Estimate) {
+  HistogramStats stats;
+  auto empty = stats.estimate();
+  EXPECT_EQ(0, empty.p50);
+  EXPECT_EQ(0, empty.p100);
+
+  // values from 1 to 10000 tracked from several threads
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; t++) {
+    threads.emplace_back([&stats, t]() {
+      for (uint64_t v = t + 1; v <= 10000; v += 4) {
+        stats.trackValue(v);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const auto rst = stats.estimate();
+  EXPECT_EQ(5000, rst.avg);
+  EXPECT_EQ(1, rst.p0);
+  EXPECT_NEAR(5000, rst.p50, 5000 / 16);
+  EXPECT_NEAR(9900, rst.p99, 9900 / 16);
+  EXPECT_LE(10000, rst.p100);
+  EXPECT_GE(10000 + 10000 / 16, rst.p100);
+
+  // the next estimate only covers the values tracked since
+  stats.trackValue(100);
+  const auto next = stats.estimate();
+  EXPECT_EQ(100, next.avg);
+  EXPECT_NEAR(100, next.p0, 100 / 16);
+  EXPECT_NEAR(100, next.p100, 100 / 16);
+
+  std::map<std::string, double> counters;
+  stats.trackValue(7);
+  stats.visitQuantileEstimator(
+      [&counters](folly::StringPiece name, double value) {
+        counters[name.str()] = value;
+      },
+      "lat");
+  EXPECT_EQ(7, counters["lat_avg"]);
+  EXPECT_EQ(7, counters["lat_p99"]);
+  EXPECT_EQ(7, counters["lat_max"]);
+}
+
+TEST(HistogramStats, LatencyTracker) {
+  HistogramStats stats;
+  const auto begin = std::chrono::steady_clock::now();
+  {
+    util::HistogramLatencyTracker tracker{stats, begin};
+    tracker.finish(begin + std::chrono::microseconds{100});
+  }
+  const auto rst = stats.estimate();
+  EXPECT_NEAR(100000, rst.avg, 1);
+  EXPECT_NEAR(100000, rst.p0, 100000 / 16);
+  EXPECT_NEAR(100000, rst.p100, 100000 / 16);
+
+  // a moved tracker tracks once, on destruction
+  {
+    util::HistogramLatencyTracker tracker{stats};
+    auto moved = std::move(tracker);
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_LE(1000000, stats.estimate().p0);
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
@@ -147,5 +147,66 @@ void testRWBucketLocks() {
 TEST(SharedMutex, TestRWBucketLocks) {
   testRWBucketLocks<folly::SharedMutex>();
 }
+
+TEST(LockContentionStats, Snapshot) {
+  ASSERT_THROW(util::LockContentionStats(0, 1), std::invalid_argument);
+  ASSERT_THROW(util::LockContentionStats(4, 0), std::invalid_argument);
+
+  util::LockContentionStats stats{4, 1};
+  auto snapshot = stats.getSnapshot(2);
+  ASSERT_EQ(0, snapshot.numContended);
+  ASSERT_TRUE(snapshot.hotStripes.empty());
+
+  for (int i = 0; i < 3; i++) {
+    stats.trackWait(2, [] {});
+  }
+  stats.trackWait(0, [] {});
+  ASSERT_TRUE(stats.recordContention(3));
+  stats.recordWait(3, std::chrono::nanoseconds(1000));
+
+  snapshot = stats.getSnapshot(2);
+  ASSERT_EQ(5, snapshot.numContended);
+  ASSERT_EQ(5, snapshot.numSampled);
+  ASSERT_LE(1000, snapshot.waitNs);
+  ASSERT_EQ(2, snapshot.hotStripes.size());
+  ASSERT_EQ(2, snapshot.hotStripes[0].stripe);
+  ASSERT_EQ(3, snapshot.hotStripes[0].numContended);
+  ASSERT_EQ(0, stats.getStripeStats(1).numContended);
+  ASSERT_EQ(1000, stats.getStripeStats(3).waitNs);
+}
+
+TEST(LockContentionStats, RWBucketLocks) {
+  using Locks = RWBucketLocks<folly::SharedMutex>;
+  Locks untracked(4, std::make_shared<FNVHash>());
+  ASSERT_EQ(nullptr, untracked.getContentionStats());
+
+  Locks locks(4, std::make_shared<FNVHash>(), 1 /* contentionSampleRate */);
+  const auto* stats = locks.getContentionStats();
+  ASSERT_NE(nullptr, stats);
+  ASSERT_EQ(16, stats->getNumStripes());
+
+  // uncontended acquisitions are not recorded
+  {
+    auto s1 = locks.lockShared(1234);
+    auto s2 = locks.lockShared(1234);
+  }
+  ASSERT_EQ(0, stats->getSnapshot(1).numContended);
+
+  {
+    auto l = locks.lockExclusive(1234);
+    std::thread reader{[&] { auto s = locks.lockShared(1234); }};
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    l.unlock();
+    reader.join();
+  }
+
+  const auto snapshot = stats->getSnapshot(1);
+  ASSERT_EQ(1, snapshot.numContended);
+  ASSERT_EQ(1, snapshot.numSampled);
+  ASSERT_LT(0, snapshot.waitNs);
+  ASSERT_EQ(1, snapshot.hotStripes.size());
+  ASSERT_EQ(1234 % 16, snapshot.hotStripes[0].stripe);
+}
 } // namespace cachelib
 } // namespace facebook
@@ -14,14 +14,19 @@
  * limitations under the License.
  */
 
+#include <folly/FileUtil.h>
 #include <folly/Random.h>
+#include <folly/ScopeGuard.h>
 #include <gtest/gtest.h>
 #include <sys/mman.h>
 
 #include <atomic>
+#include <chrono>
+#include <thread>
 #include <unordered_map>
 
 #include "cachelib/common/FastStats.h"
+#include "cachelib/common/Time.h"
 #include "cachelib/common/Utils.h"
 
 using facebook::cachelib::util::FastStats;
@@ -173,6 +178,37 @@ TEST(Util, SysctlTests) {
 
 TEST(Util, MemAvailable) { EXPECT_GT(util::getMemAvailable(), 0); }
 
+TEST(Util, CgroupMemoryStats) {
+  const auto dir = util::getUniqueTempDir("cgroup_test");
+  util::makeDir(dir);
+  SCOPE_EXIT { util::removePath(dir); };
+  auto write = [&](folly::StringPiece name, folly::StringPiece content) {
+    ASSERT_TRUE(
+        folly::writeFile(content, folly::sformat("{}/{}", dir, name).c_str()));
+  };
+
+  // nothing to read
+  auto stats = util::getCgroupMemoryStats(dir);
+  EXPECT_EQ(0, stats.usageBytes);
+  EXPECT_EQ(0, stats.limitBytes);
+
+  write("memory.current", "1048576\n");
+  write("memory.high", "max\n");
+  write("memory.max", "4194304\n");
+  write("memory.pressure",
+        "some avg10=1.50 avg60=0.10 avg300=0.00 total=123456\n"
+        "full avg10=0.50 avg60=0.00 avg300=0.00 total=7890\n");
+  stats = util::getCgroupMemoryStats(dir);
+  EXPECT_EQ(1048576, stats.usageBytes);
+  // memory.high is not set
+  EXPECT_EQ(4194304, stats.limitBytes);
+  EXPECT_EQ(123456, stats.someStallUs);
+  EXPECT_EQ(7890, stats.fullStallUs);
+
+  write("memory.high", "2097152\n");
+  EXPECT_EQ(2097152, util::getCgroupMemoryStats(dir).limitBytes);
+}
+
 TEST(Util, CounterVisitor) {
   // Uninitialized can be called.
   util::CounterVisitor v;
@@ -182,6 +218,30 @@ TEST(Util, CounterVisitor) {
   util::CounterVisitor(
       [&ctrs](folly::StringPiece k, double v) { ctrs[k.str()] = v; });
 }
+
+TEST(Util, CoarseClock) {
+  EXPECT_FALSE(util::CoarseClock::isRunning());
+  {
+    util::CoarseClock clock;
+    EXPECT_TRUE(util::CoarseClock::isRunning());
+    {
+      // shared with the first instance
+      util::CoarseClock other;
+    }
+    EXPECT_TRUE(util::CoarseClock::isRunning());
+
+    const auto begin = util::getCurrentTimeSec();
+    EXPECT_NEAR(static_cast<double>(std::time(nullptr)), begin, 1);
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds{1100});
+    EXPECT_LT(begin, util::getCurrentTimeSec());
+  }
+  EXPECT_FALSE(util::CoarseClock::isRunning());
+
+  // and it can be started again
+  util::CoarseClock clock;
+  EXPECT_TRUE(util::CoarseClock::isRunning());
+}
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
@@ -40,11 +40,21 @@
 
 #pragma once
 
+#include <folly/Range.h>
 #include <folly/SharedMutex.h>
+#include <folly/lang/Align.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 #include "cachelib/allocator/Cache.h"
 #include "cachelib/allocator/CacheStats.h"
@@ -53,8 +63,11 @@
 #include "cachelib/common/FastStats.h"
 #include "cachelib/common/Hash.h"
 #include "cachelib/common/Mutex.h"
+#include "cachelib/common/Time.h"
 #include "cachelib/compact_cache/CCacheFixedLruBucket.h"
+#include "cachelib/compact_cache/CCacheFixedTtlLruBucket.h"
 #include "cachelib/compact_cache/CCacheVariableLruBucket.h"
+#include "cachelib/compact_cache/CCacheVariableSlotLruBucket.h"
 
 /**
  * Default amount of entries per bucket.
@@ -79,6 +92,38 @@ struct DefaultBucketDescriptor {
                                 VariableLruBucket<C>>::type;
 };
 
+namespace detail {
+/** Whether a bucket descriptor provides find(Bucket*, const Key&). */
+template <typename B, typename = void>
+struct HasBucketFind : std::false_type {};
+
+template <typename B>
+struct HasBucketFind<
+    B,
+    std::void_t<decltype(B::find(
+        std::declval<typename B::Bucket*>(),
+        std::declval<const typename B::Descriptor::Key&>()))>>
+    : std::true_type {};
+
+/** Whether a bucket descriptor has a fixed number of entries per bucket. */
+template <typename B, typename = void>
+struct HasFixedEntriesPerBucket : std::false_type {};
+
+template <typename B>
+struct HasFixedEntriesPerBucket<B, std::void_t<decltype(B::kEntriesPerBucket)>>
+    : std::true_type {};
+
+/** Whether a bucket descriptor stores an expiry time with every entry. */
+template <typename B, typename = void>
+struct HasEntryExpiry : std::false_type {};
+
+template <typename B>
+struct HasEntryExpiry<
+    B,
+    std::void_t<decltype(std::declval<typename B::EntryHandle>()
+                             .expiryTime())>> : std::true_type {};
+} // namespace detail
+
 enum class CCacheReturn : int {
   TIMEOUT = -2,
   ERROR = -1,
@@ -120,6 +165,19 @@ class CompactCache : public ICompactCache {
   constexpr static bool kHasValues = C::kHasValues;
   constexpr static bool kValuesFixedSize = C::kValuesFixedSize;
 
+  /** Optimistic reads need a bucket that can be read while it is being
+   * written without going out of bounds, i.e. the fixed size LRU bucket. */
+  constexpr static bool kSupportsOptimisticReads =
+      kValuesFixedSize &&
+      std::is_same_v<B, typename DefaultBucketDescriptor<C>::type>;
+
+  /** Whether entries can be set with an expiry time, i.e. the bucket
+   * descriptor is FixedTtlLruBucket. */
+  constexpr static bool kSupportsExpiry = detail::HasEntryExpiry<B>::value;
+
+  /** Default power of two of the number of bucket locks. */
+  constexpr static uint32_t kDefaultLockHashPower = 10;
+
   enum Operation { READ, WRITE };
 
   /** Type of the callbacks called when an entry is removed.
@@ -163,8 +221,20 @@ class CompactCache : public ICompactCache {
    *                        the allocator for the lifetime of the compact cache.
    * @param allowPromotions Whether we should allow promotions on read
    *                        operations. True by default
+   * @param lockHashPower   The bucket locks are striped over 2^lockHashPower
+   *                        locks. Larger caches with many threads want more
+   *                        stripes, small ones fewer.
+   * @param optimisticReads Whether get and exists first read the bucket
+   *                        without locking, retrying under the shared lock
+   *                        if a writer interfered. Only supported with
+   *                        fixed size values.
+   *
+   * @throw std::invalid_argument if optimistic reads are not supported
    */
-  explicit CompactCache(Allocator& allocator, bool allowPromotions = true);
+  explicit CompactCache(Allocator& allocator,
+                        bool allowPromotions = true,
+                        uint32_t lockHashPower = kDefaultLockHashPower,
+                        bool optimisticReads = false);
 
   /**
    * Construct a new compact cache instance with callbacks to track when
@@ -179,12 +249,21 @@ class CompactCache : public ICompactCache {
    *                        valid
    * @param allowPromotions Whether we should allow promotions on read
    *                        operations. True by default
+   * @param lockHashPower   The bucket locks are striped over 2^lockHashPower
+   *                        locks.
+   * @param optimisticReads Whether get and exists first read the bucket
+   *                        without locking. Only supported with fixed size
+   *                        values.
+   *
+   * @throw std::invalid_argument if optimistic reads are not supported
    */
   CompactCache(Allocator& allocator,
                RemoveCb removeCb,
                ReplaceCb replaceCb,
                ValidCb validCb,
-               bool allowPromotions = true);
+               bool allowPromotions = true,
+               uint32_t lockHashPower = kDefaultLockHashPower,
+               bool optimisticReads = false);
 
   /**
    * Destructor will detach the allocator. Only after a CompactCache instance
@@ -207,9 +286,37 @@ class CompactCache : public ICompactCache {
    *  (2) Update num_chunks, wait for refcount on old value to hit 0
    *  (3) Walk all the entries in the old table size and see which ones would
    *      now hash to new chunks and move them.
+   *
+   * If a resize step is set, every call rehashes at most that many chunks
+   * and following calls continue the resize where it stopped, so the pool
+   * resizer that calls this periodically migrates the table incrementally.
+   * Until the copy pass is done, requests keep using the old layout and
+   * writes also go to the new one. The size only changes again once the
+   * resize in progress completed.
    */
   void resize() override;
 
+  /**
+   * Set the number of chunks resize rehashes per call. 0, the default,
+   * completes a resize in one call.
+   */
+  void setResizeStep(size_t chunksPerStep) {
+    auto lock = std::unique_lock(resizeLock_);
+    resizeStepChunks_ = chunksPerStep;
+  }
+
+  /** Progress of the resize in progress, if any. */
+  CCacheResizeStats getResizeStats() const override;
+
+  /**
+   * Complete the resize in progress, if any. Called before the chunks are
+   * saved for a warm roll.
+   */
+  void finishResize() {
+    auto lock = std::unique_lock(resizeLock_);
+    continueResize(std::numeric_limits<size_t>::max());
+  }
+
   /**
    * return whether the cache is enabled
    * this is non-virtual for better performance since it is hotly accessed
@@ -227,6 +334,19 @@ class CompactCache : public ICompactCache {
     return numChunks_ * allocator_.getChunkSize();
   }
 
+  /**
+   * return the memory held by the last entry of every bucket, the entries
+   * whose hits count as tail hits (virtual function). Buckets without a fixed
+   * number of entries report the whole size.
+   */
+  size_t getTailSize() const override {
+    if constexpr (detail::HasFixedEntriesPerBucket<B>::value) {
+      return getSize() / BucketDescriptor::kEntriesPerBucket;
+    } else {
+      return getSize();
+    }
+  }
+
   /**
    * return config size of this compact cache
    */
@@ -254,6 +374,9 @@ class CompactCache : public ICompactCache {
    *                the value type is NoValue which is a special indicator for
    *                a compact cache of no values.
    * @param size    Size of the value. 0 means the value is fixed size.
+   * @param expiryTime  Time in seconds since epoch after which the entry
+   *                    expires, 0 if it never expires. Only supported if
+   *                    kSupportsExpiry, i.e. with FixedTtlLruBucket.
    * @return        CCacheReturn with appropriate result type:
    *                FOUND (on hit - the value was updated), NOTFOUND (on miss -
    *                the value was set), TIMEOUT, ERROR (other error)
@@ -261,11 +384,13 @@ class CompactCache : public ICompactCache {
   CCacheReturn set(const Key& key,
                    const std::chrono::microseconds& timeout,
                    const Value* val = nullptr,
-                   size_t size = 0);
+                   size_t size = 0,
+                   uint32_t expiryTime = 0);
   CCacheReturn set(const Key& key,
                    const Value* val = nullptr,
-                   size_t size = 0) {
-    return set(key, std::chrono::microseconds::zero(), val, size);
+                   size_t size = 0,
+                   uint32_t expiryTime = 0) {
+    return set(key, std::chrono::microseconds::zero(), val, size, expiryTime);
   }
 
   /**
@@ -343,6 +468,73 @@ class CompactCache : public ICompactCache {
     return exists(key, std::chrono::microseconds::zero());
   }
 
+  /**
+   * Add a delta to the counter of a key. Only for values described by a
+   * CounterValueDescriptor. A missing key is set to the delta and an entry
+   * whose counter becomes zero is removed. The counter is read and written
+   * under one exclusive bucket lock, instead of the two locks of a get
+   * followed by a set, which also makes concurrent adds to a key atomic.
+   * While a resize is in progress the new value is also written to the
+   * key's bucket in the new layout, so like concurrent sets, concurrent
+   * adds to a key can race there.
+   *
+   * @param key     Key of the counter.
+   * @param timeout if greater than 0, take a timed lock
+   * @param delta   Value to add to the counter.
+   * @param newVal  If not nullptr, the counter after the addition is written
+   *                there, zero if the entry was removed.
+   * @return        CCacheReturn with appropriate result type:
+   *                FOUND (on hit - the counter was updated), NOTFOUND (on
+   *                miss - the counter was set to the delta), TIMEOUT, ERROR
+   *                (other error)
+   */
+  CCacheReturn add(const Key& key,
+                   const std::chrono::microseconds& timeout,
+                   const Value& delta,
+                   Value* newVal = nullptr);
+  CCacheReturn add(const Key& key,
+                   const Value& delta,
+                   Value* newVal = nullptr) {
+    return add(key, std::chrono::microseconds::zero(), delta, newVal);
+  }
+
+  /**
+   * Retrieve the values of a batch of keys. Equivalent to calling get for
+   * every key, but the buckets are looked up and prefetched up front, the
+   * keys share one cohort reference and every bucket lock is taken once for
+   * all the keys under it. Only for compact caches with fixed size values.
+   *
+   * @param keys           Keys of the entries to be read.
+   * @param results        results[i] is the result of get(keys[i]).
+   * @param vals           If not empty, vals[i] is where the value of
+   *                       keys[i] is written to. Left untouched on a miss.
+   * @param timeout        if greater than 0, take timed locks
+   * @param shouldPromote  Whether the keys should be promoted.
+   */
+  void multiGet(folly::Range<const Key*> keys,
+                folly::Range<CCacheReturn*> results,
+                folly::Range<Value*> vals = {},
+                const std::chrono::microseconds& timeout =
+                    std::chrono::microseconds::zero(),
+                bool shouldPromote = true);
+
+  /**
+   * Set or update the values of a batch of keys, in order. Equivalent to
+   * calling set for every key, taking every bucket lock once like multiGet.
+   * Only for compact caches with fixed size values.
+   *
+   * @param keys     Keys for which to set / update the values.
+   * @param results  results[i] is the result of set(keys[i], &vals[i]).
+   * @param vals     Values of the keys. Must be empty if and only if the
+   *                 value type is NoValue.
+   * @param timeout  if greater than 0, take timed locks
+   */
+  void multiSet(folly::Range<const Key*> keys,
+                folly::Range<CCacheReturn*> results,
+                folly::Range<const Value*> vals = {},
+                const std::chrono::microseconds& timeout =
+                    std::chrono::microseconds::zero());
+
   /**
    * Accepts a prefix and value, returning whether or not to purge the entry.
    * @param key     key of the entry
@@ -372,10 +564,13 @@ class CompactCache : public ICompactCache {
   bool forEachBucket(const BucketCallBack& cb);
 
   /** Move or purge entries that would change which chunk they hash to
-   * based on the specified old and new numbers of chunks. */
+   * based on the specified old and new numbers of chunks. Only the old
+   * chunks in [beginChunk, endChunk) are rehashed. */
   void tableRehash(size_t oldNumChunks,
                    size_t newNumChunks,
-                   RehashOperation op);
+                   RehashOperation op,
+                   size_t beginChunk = 0,
+                   size_t endChunk = std::numeric_limits<size_t>::max());
 
   /** return the current snapshot of all stats */
   CCacheStats getStats() const override { return stats_.getSnapshot(); }
@@ -410,6 +605,22 @@ class CompactCache : public ICompactCache {
                    Fn f,
                    Args... args);
 
+  /**
+   * Execute a request handler on a batch of keys, like callBucketFn does for
+   * one key. The buckets are sorted by lock so that each lock is taken once;
+   * keys under the same lock are handled in their order in the batch.
+   *
+   * @param keys    Keys on which to perform the request.
+   * @param rvs     rvs[i] is what callBucketFn would return for keys[i].
+   * @param call    Handler called as call(bucket, i) for keys[i].
+   */
+  template <typename Fn>
+  void callBucketFnBatch(folly::Range<const Key*> keys,
+                         Operation op,
+                         const std::chrono::microseconds& timeout,
+                         folly::Range<int*> rvs,
+                         Fn call);
+
   /** Free chunks whose index is between chunk_index_low, inclusive, and
    * chunk_index_high, exclusive. Used which shrinking the cache. */
   int tableChunksFree(size_t chunkIndexLow, size_t chunkIndexHigh);
@@ -471,6 +682,7 @@ class CompactCache : public ICompactCache {
    * @param val    Value to insert into the bucket. Nullptr means no value.
    * @param size   Size of the value. Unused if this compact cache stores
    *               values of a fixed size.
+   * @param expiryTime  Expiry time of the entry, 0 if it never expires.
    *
    * @return       FOUND if entry is found (an existing entry was updated),
    *               or FOUND if not found (a new entry was inserted).
@@ -478,7 +690,8 @@ class CompactCache : public ICompactCache {
   BucketReturn bucketSet(Bucket* bucket,
                          const Key& key,
                          const Value* val = nullptr,
-                         size_t size = 0);
+                         size_t size = 0,
+                         uint32_t expiryTime = 0);
 
   /**
    * Delete an entry from a bucket.
@@ -530,6 +743,27 @@ class CompactCache : public ICompactCache {
    */
   BucketReturn bucketPromote(Bucket* bucket, const Key& key);
 
+  /**
+   * Add a delta to the counter of an entry, inserting or removing the entry
+   * as needed.
+   *
+   * @param bucket  Bucket from which to look for an entry.
+   * @param key     Key to search for in the bucket.
+   * @param delta   Value to add.
+   * @param result  The counter after the addition is written there.
+   * @param applied Set by the first call. A second call for the same add,
+   *                on the bucket of the key in the layout an incremental
+   *                resize moves to, writes @result instead of adding again.
+   *
+   * @return        FOUND if the entry was there, NOTFOUND otherwise, or
+   *                ERROR.
+   */
+  BucketReturn bucketAdd(Bucket* bucket,
+                         const Key& key,
+                         const Value* delta,
+                         Value* result,
+                         bool* applied);
+
   /**
    * Find the position of an entry in a bucket.
    *
@@ -540,6 +774,60 @@ class CompactCache : public ICompactCache {
    */
   EntryHandle bucketFind(Bucket* bucket, const Key& key);
 
+  /** Sequence number of a bucket lock. It is odd while a writer holding the
+   * lock modifies its buckets, so optimistic readers can detect that the
+   * bucket they read changed underneath them. */
+  struct alignas(folly::hardware_destructive_interference_size) LockSeq {
+    std::atomic<uint64_t> seq{0};
+  };
+
+  /** Exclusive bucket lock that also bumps the sequence number of the lock
+   * when optimistic reads are enabled. */
+  class BucketWriteLock {
+   public:
+    BucketWriteLock() = default;
+    BucketWriteLock(std::unique_lock<folly::SharedMutex> lock,
+                    std::atomic<uint64_t>* seq)
+        : lock_(std::move(lock)), seq_(lock_.owns_lock() ? seq : nullptr) {
+      if (seq_ != nullptr) {
+        seq_->store(seq_->load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+    }
+    BucketWriteLock(BucketWriteLock&& other) noexcept
+        : lock_(std::move(other.lock_)),
+          seq_(std::exchange(other.seq_, nullptr)) {}
+    BucketWriteLock& operator=(BucketWriteLock&&) = delete;
+    ~BucketWriteLock() {
+      if (seq_ != nullptr) {
+        seq_->store(seq_->load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+      }
+    }
+
+    bool owns_lock() const noexcept { return lock_.owns_lock(); }
+
+   private:
+    std::unique_lock<folly::SharedMutex> lock_;
+    std::atomic<uint64_t>* seq_{nullptr};
+  };
+
+  /** Take the exclusive lock of a bucket, optionally with a timeout. */
+  BucketWriteLock lockBucketExclusive(Bucket* bucket);
+  BucketWriteLock lockBucketExclusive(const std::chrono::microseconds& timeout,
+                                      Bucket* bucket);
+
+  /**
+   * Call a read only bucket function without locking the bucket.
+   *
+   * @return true if the bucket did not change while it was read, in which
+   *         case @rv holds the result of the function.
+   */
+  template <typename Fn, typename... Args>
+  bool optimisticRead(
+      Bucket* bucket, const Key& key, BucketReturn& rv, Fn f, Args... args);
+
   /**
    * Data for a compact cache instance.
    * The arena must remain alive (i.e. not free'd) during the lifetime of the
@@ -547,11 +835,34 @@ class CompactCache : public ICompactCache {
    */
   Allocator& allocator_;
   RWBucketLocks<folly::SharedMutex> locks_;
+  /** one per bucket lock if optimistic reads are enabled, null otherwise */
+  std::unique_ptr<LockSeq[]> lockSeqs_;
   RemoveCb removeCb_;
   ReplaceCb replaceCb_;
   ValidCb validCb_;
   facebook::cachelib::Cohort cohort_;     /**< resize cohort synchronization */
   mutable folly::SharedMutex resizeLock_; /**< Lock to synchronize resize. */
+
+  /** State of an incremental resize, guarded by resizeLock_ */
+  struct ResizeState {
+    bool inProgress{false};
+    RehashOperation op{RehashOperation::COPY};
+    size_t oldNumChunks{0};
+    size_t newNumChunks{0};
+    /* next old chunk to rehash in the current pass */
+    size_t nextChunk{0};
+  };
+  ResizeState resizeState_;
+  size_t resizeStepChunks_{0};
+  uint64_t resizesCompleted_{0};
+
+  /** Start a resize to the configured size if it changed.
+   * @return true if entries need to be rehashed */
+  bool startResize();
+
+  /** Rehash up to @maxChunks chunks of the resize in progress, finishing
+   * its passes as they complete. */
+  void continueResize(size_t maxChunks);
   const size_t bucketsPerChunk_;
   util::FastStats<CCacheStats> stats_;
   const bool allowPromotions_; /**< Whether promotions are allowed on read
@@ -652,17 +963,28 @@ void callReplaceCb(const typename CC::ReplaceCb& cb,
 } // namespace detail
 
 template <typename C, typename A, typename B>
-CompactCache<C, A, B>::CompactCache(Allocator& allocator, bool allowPromotions)
-    : CompactCache(allocator, nullptr, nullptr, nullptr, allowPromotions) {}
+CompactCache<C, A, B>::CompactCache(Allocator& allocator,
+                                    bool allowPromotions,
+                                    uint32_t lockHashPower,
+                                    bool optimisticReads)
+    : CompactCache(allocator,
+                   nullptr,
+                   nullptr,
+                   nullptr,
+                   allowPromotions,
+                   lockHashPower,
+                   optimisticReads) {}
 
 template <typename C, typename A, typename B>
 CompactCache<C, A, B>::CompactCache(Allocator& allocator,
                                     RemoveCb removeCb,
                                     ReplaceCb replaceCb,
                                     ValidCb validCb,
-                                    bool allowPromotions)
+                                    bool allowPromotions,
+                                    uint32_t lockHashPower,
+                                    bool optimisticReads)
     : allocator_(allocator),
-      locks_(10 /* hashpower */, std::make_shared<MurmurHash2>()),
+      locks_(lockHashPower, std::make_shared<MurmurHash2>()),
       removeCb_(removeCb),
       replaceCb_(replaceCb),
       validCb_(validCb),
@@ -671,6 +993,13 @@ CompactCache<C, A, B>::CompactCache(Allocator& allocator,
       allowPromotions_(allowPromotions),
       numChunks_(allocator_.getNumChunks()),
       pendingNumChunks_(0) {
+  if (optimisticReads) {
+    if (!kSupportsOptimisticReads) {
+      throw std::invalid_argument(
+          "optimistic reads need a compact cache with fixed size values");
+    }
+    lockSeqs_ = std::make_unique<LockSeq[]>(locks_.numLocks());
+  }
   allocator_.attach(this);
 }
 
@@ -691,17 +1020,20 @@ CompactCache<C, A, B>::~CompactCache() {
 template <typename C, typename A, typename B>
 void CompactCache<C, A, B>::tableRehash(size_t oldNumChunks,
                                         size_t newNumChunks,
-                                        RehashOperation op) {
+                                        RehashOperation op,
+                                        size_t beginChunk,
+                                        size_t endChunk) {
   XDCHECK_LE(newNumChunks, allocator_.getNumChunks());
   XDCHECK_GT(newNumChunks, 0u);
   XDCHECK_GT(oldNumChunks, 0u);
 
   /* Loop through all entries in all buckets of the hash table. */
-  for (size_t n = 0; n < oldNumChunks; n++) {
+  endChunk = std::min(endChunk, oldNumChunks);
+  for (size_t n = beginChunk; n < endChunk; n++) {
     Bucket* table_chunk = reinterpret_cast<Bucket*>(allocator_.getChunk(n));
     for (size_t i = 0; i < bucketsPerChunk_; i++) {
       Bucket* bucket = &table_chunk[i];
-      auto lock = locks_.lockExclusive(bucket);
+      auto lock = lockBucketExclusive(bucket);
 
       const size_t capacity = BucketDescriptor::nEntriesCapacity(*bucket);
       /* When expanding the cache (newNumChunks > oldNumChunks) move
@@ -714,7 +1046,17 @@ void CompactCache<C, A, B>::tableRehash(size_t oldNumChunks,
           capacity);
       size_t moved = 0;
       EntryHandle entry = BucketDescriptor::first(&table_chunk[i]);
+      [[maybe_unused]] const uint32_t now =
+          kSupportsExpiry ? util::getCurrentTimeSec() : 0;
       while (entry) {
+        if constexpr (kSupportsExpiry) {
+          /* expired entries are neither moved nor reported, the DELETE
+           * pass drops them */
+          if (op == RehashOperation::COPY && entry.isExpired(now)) {
+            entry.next();
+            continue;
+          }
+        }
         const bool valid_entry = !validCb_ || validCb_(entry.key());
         auto remove_context =
             valid_entry ? RemoveContext::kEviction : RemoveContext::kNormal;
@@ -752,9 +1094,12 @@ void CompactCache<C, A, B>::tableRehash(size_t oldNumChunks,
             bool sameLock = locks_.isSameLock(newBucket, bucket);
             auto higher_lock //
                 = sameLock   //
-                      ? std::unique_lock<folly::SharedMutex>()
-                      : locks_.lockExclusive(newBucket);
-            if (kHasValues) {
+                      ? BucketWriteLock()
+                      : lockBucketExclusive(newBucket);
+            if constexpr (kSupportsExpiry) {
+              bucketSet(newBucket, entry.key(), entry.val(), 0,
+                        entry.expiryTime());
+            } else if (kHasValues) {
               if (kValuesFixedSize) {
                 bucketSet(newBucket, entry.key(), entry.val());
               } else {
@@ -788,19 +1133,27 @@ void CompactCache<C, A, B>::tableRehash(size_t oldNumChunks,
 
 template <typename C, typename A, typename B>
 void CompactCache<C, A, B>::resize() {
+  /* Lock resize operations to prevent more than one from occurring
+   * at a time */
+  auto lock = std::unique_lock(resizeLock_);
+  if (!resizeState_.inProgress && !startResize()) {
+    return;
+  }
+  continueResize(resizeStepChunks_ == 0 ? std::numeric_limits<size_t>::max()
+                                        : resizeStepChunks_);
+}
+
+template <typename C, typename A, typename B>
+bool CompactCache<C, A, B>::startResize() {
   const size_t oldNumChunks = numChunks_;
   const size_t configuredSize = allocator_.getConfiguredSize();
   const size_t numChunksWanted = configuredSize / allocator_.getChunkSize();
 
   /* No change in size */
   if (oldNumChunks == numChunksWanted) {
-    return;
+    return false;
   }
 
-  /* Lock resize operations to prevent more than one from occurring
-   * at a time */
-  auto lock = std::unique_lock(resizeLock_);
-
   size_t newNumChunks = numChunksWanted;
 
   if (numChunksWanted > oldNumChunks) {
@@ -810,7 +1163,7 @@ void CompactCache<C, A, B>::resize() {
     if (newNumChunks != numChunksWanted) {
       if (newNumChunks == oldNumChunks) {
         XLOG(CRITICAL) << "Failed to grow arena. Continuing with old size.";
-        return;
+        return false;
       } else {
         XLOG(CRITICAL) << "Failed to grow arena by as much as we wanted.";
       }
@@ -831,35 +1184,89 @@ void CompactCache<C, A, B>::resize() {
      * In offline mode, move entries; online we just delete
      * to avoid invalidate races
      */
-    tableRehash(oldNumChunks, newNumChunks, RehashOperation::COPY);
-
-    // now that rehash happened, we can start reading from the new location
-    // don't yet stop double writes as that ordering (no double write, read
-    // from old location) may not be guaranteed
-    // It likely is fine as those are ordered by a lock which should order
-    // the loads of the num_chunks value properly
-    numChunks_ = newNumChunks;
-    cohort_.switchCohorts();
+    resizeState_ = ResizeState{
+        true, RehashOperation::COPY, oldNumChunks, newNumChunks, 0};
+    return true;
+  }
 
-    // now stop double writes and wait for all requests to complete
-    // so that the old chunk locations are totally unused
-    pendingNumChunks_ = 0;
-    cohort_.switchCohorts();
+  numChunks_ = newNumChunks;
 
-    // now go through again and delete stale entries in the old location
-    tableRehash(oldNumChunks, newNumChunks, RehashOperation::DELETE);
-  } else {
-    numChunks_ = newNumChunks;
-
-    // If we are disabling the compact cache (making the size to 0), we need to
-    // make sure all requests are completed before we can release the chunks
-    cohort_.switchCohorts();
-  }
+  // If we are disabling the compact cache (making the size to 0), we need to
+  // make sure all requests are completed before we can release the chunks
+  cohort_.switchCohorts();
 
   // free slabs if we have extra
   if (newNumChunks < oldNumChunks) {
     allocator_.resize();
   }
+  ++resizesCompleted_;
+  return false;
+}
+
+template <typename C, typename A, typename B>
+void CompactCache<C, A, B>::continueResize(size_t maxChunks) {
+  auto& state = resizeState_;
+  while (state.inProgress) {
+    if (state.nextChunk < state.oldNumChunks) {
+      if (maxChunks == 0) {
+        return;
+      }
+      const size_t n =
+          std::min(state.oldNumChunks - state.nextChunk, maxChunks);
+      tableRehash(state.oldNumChunks,
+                  state.newNumChunks,
+                  state.op,
+                  state.nextChunk,
+                  state.nextChunk + n);
+      state.nextChunk += n;
+      maxChunks -= n;
+      continue;
+    }
+
+    if (state.op == RehashOperation::COPY) {
+      // now that rehash happened, we can start reading from the new location
+      // don't yet stop double writes as that ordering (no double write, read
+      // from old location) may not be guaranteed
+      // It likely is fine as those are ordered by a lock which should order
+      // the loads of the num_chunks value properly
+      numChunks_ = state.newNumChunks;
+      cohort_.switchCohorts();
+
+      // now stop double writes and wait for all requests to complete
+      // so that the old chunk locations are totally unused
+      pendingNumChunks_ = 0;
+      cohort_.switchCohorts();
+
+      // now go through again and delete stale entries in the old location
+      state.op = RehashOperation::DELETE;
+      state.nextChunk = 0;
+      continue;
+    }
+
+    // free slabs if we have extra
+    state.inProgress = false;
+    if (state.newNumChunks < state.oldNumChunks) {
+      allocator_.resize();
+    }
+    ++resizesCompleted_;
+  }
+}
+
+template <typename C, typename A, typename B>
+CCacheResizeStats CompactCache<C, A, B>::getResizeStats() const {
+  auto lock = std::shared_lock(resizeLock_);
+  CCacheResizeStats stats;
+  stats.inProgress = resizeState_.inProgress;
+  if (stats.inProgress) {
+    stats.chunksToRehash = 2 * resizeState_.oldNumChunks;
+    stats.chunksRehashed =
+        (resizeState_.op == RehashOperation::DELETE
+             ? resizeState_.oldNumChunks
+             : 0) +
+        resizeState_.nextChunk;
+  }
+  stats.resizesCompleted = resizesCompleted_;
+  return stats;
 }
 
 template <typename C, typename A, typename B>
@@ -867,9 +1274,15 @@ CCacheReturn CompactCache<C, A, B>::set(
     const Key& key,
     const std::chrono::microseconds& timeout,
     const Value* val,
-    size_t size) {
-  int rv = callBucketFn(
-      key, Operation::WRITE, timeout, &SelfType::bucketSet, val, size);
+    size_t size,
+    uint32_t expiryTime) {
+  int rv = callBucketFn(key,
+                        Operation::WRITE,
+                        timeout,
+                        &SelfType::bucketSet,
+                        val,
+                        size,
+                        expiryTime);
   UPDATE_STATS_AND_RETURN(set, rv);
 }
 
@@ -914,6 +1327,79 @@ CCacheReturn CompactCache<C, A, B>::exists(
   UPDATE_STATS_AND_RETURN(get, rv);
 }
 
+template <typename C, typename A, typename B>
+CCacheReturn CompactCache<C, A, B>::add(
+    const Key& key,
+    const std::chrono::microseconds& timeout,
+    const Value& delta,
+    Value* newVal) {
+  static_assert(kHasValues && kValuesFixedSize,
+                "add needs counter values, see CounterValueDescriptor");
+  Value result{};
+  bool applied = false;
+  int rv = callBucketFn(key,
+                        Operation::WRITE,
+                        timeout,
+                        &SelfType::bucketAdd,
+                        &delta,
+                        &result,
+                        &applied);
+  if (newVal != nullptr && rv >= 0) {
+    std::memcpy(newVal, &result, sizeof(Value));
+  }
+  UPDATE_STATS_AND_RETURN(set, rv);
+}
+
+template <typename C, typename A, typename B>
+void CompactCache<C, A, B>::multiGet(folly::Range<const Key*> keys,
+                                     folly::Range<CCacheReturn*> results,
+                                     folly::Range<Value*> vals,
+                                     const std::chrono::microseconds& timeout,
+                                     bool shouldPromote) {
+  static_assert(kValuesFixedSize, "multiGet needs fixed size values");
+  XDCHECK_EQ(keys.size(), results.size());
+  XDCHECK(vals.empty() || vals.size() == keys.size());
+
+  std::vector<int> rvs(keys.size());
+  callBucketFnBatch(
+      keys, Operation::READ, timeout, folly::range(rvs),
+      [&](Bucket* bucket, size_t i) {
+        return bucketGet(bucket,
+                         keys[i],
+                         vals.empty() ? nullptr : &vals[i],
+                         nullptr /* size */,
+                         shouldPromote);
+      });
+  auto toResult = [this](int rv) { UPDATE_STATS_AND_RETURN(get, rv); };
+  for (size_t i = 0; i < keys.size(); i++) {
+    results[i] = toResult(rvs[i]);
+  }
+}
+
+template <typename C, typename A, typename B>
+void CompactCache<C, A, B>::multiSet(folly::Range<const Key*> keys,
+                                     folly::Range<CCacheReturn*> results,
+                                     folly::Range<const Value*> vals,
+                                     const std::chrono::microseconds& timeout) {
+  static_assert(kValuesFixedSize, "multiSet needs fixed size values");
+  XDCHECK_EQ(keys.size(), results.size());
+  XDCHECK(vals.empty() || vals.size() == keys.size());
+
+  std::vector<int> rvs(keys.size());
+  callBucketFnBatch(keys, Operation::WRITE, timeout, folly::range(rvs),
+                    [&](Bucket* bucket, size_t i) {
+                      /* bucketSet fails if a value is missing */
+                      return bucketSet(bucket,
+                                       keys[i],
+                                       vals.empty() ? nullptr : &vals[i],
+                                       0 /* size */);
+                    });
+  auto toResult = [this](int rv) { UPDATE_STATS_AND_RETURN(set, rv); };
+  for (size_t i = 0; i < keys.size(); i++) {
+    results[i] = toResult(rvs[i]);
+  }
+}
+
 template <typename C, typename A, typename B>
 bool CompactCache<C, A, B>::purge(const PurgeFilter& shouldPurge) {
   auto bucketCallback = [&](Bucket* bucket) {
@@ -974,8 +1460,12 @@ int CompactCache<C, A, B>::callBucketFn(
   BucketReturn rv;
   bool immutable_bucket = (op == Operation::READ);
 
-  /* 4) Call the request handler. */
-  if (immutable_bucket) {
+  /* 4) Call the request handler. Reads try without the lock first if
+   * optimistic reads are enabled. */
+  if (immutable_bucket && lockSeqs_ &&
+      optimisticRead(bucket, key, rv, f, args...)) {
+    /* nothing to do, rv is set */
+  } else if (immutable_bucket) {
     auto lock = locks_.lockShared(timeout, bucket);
     if (!lock.owns_lock()) {
       XDCHECK(timeout > std::chrono::microseconds::zero());
@@ -985,7 +1475,7 @@ int CompactCache<C, A, B>::callBucketFn(
 
     rv = (this->*f)(bucket, key, args...);
   } else {
-    auto lock = locks_.lockExclusive(timeout, bucket);
+    auto lock = lockBucketExclusive(timeout, bucket);
     if (!lock.owns_lock()) {
       XDCHECK(timeout > std::chrono::microseconds::zero());
       ++stats_.tlStats().lockTimeout;
@@ -1003,7 +1493,7 @@ int CompactCache<C, A, B>::callBucketFn(
     rv = BucketReturn::FOUND;
 
     if (allowPromotions_) {
-      auto lock = locks_.lockExclusive(timeout, bucket);
+      auto lock = lockBucketExclusive(timeout, bucket);
       if (!lock.owns_lock()) {
         XDCHECK(timeout > std::chrono::microseconds::zero());
         ++stats_.tlStats().promoteTimeout;
@@ -1026,7 +1516,7 @@ int CompactCache<C, A, B>::callBucketFn(
       (op == Operation::WRITE) ? tableFindDblWriteBucket(key) : nullptr;
 
   if (bucketDbl != nullptr) {
-    auto lockDbl = locks_.lockExclusive(bucketDbl);
+    auto lockDbl = lockBucketExclusive(bucketDbl);
     if ((this->*f)(bucketDbl, key, args...) == BucketReturn::ERROR) {
       rv = BucketReturn::ERROR;
     }
@@ -1035,6 +1525,160 @@ int CompactCache<C, A, B>::callBucketFn(
   return toInt(rv);
 }
 
+template <typename C, typename A, typename B>
+template <typename Fn>
+void CompactCache<C, A, B>::callBucketFnBatch(
+    folly::Range<const Key*> keys,
+    Operation op,
+    const std::chrono::microseconds& timeout,
+    folly::Range<int*> rvs,
+    Fn call) {
+  XDCHECK_EQ(keys.size(), rvs.size());
+  if (numChunks_ == 0) {
+    std::fill(rvs.begin(), rvs.end(), -1);
+    return;
+  }
+
+  /* One cohort reference for the whole batch */
+  Cohort::Token tok = cohort_.incrActiveReqs();
+
+  /* Find and prefetch all the buckets before taking any lock, then group
+   * them by lock. The sort is stable to keep the order of the keys sharing
+   * a bucket. */
+  struct Target {
+    Bucket* bucket;
+    size_t lockIdx;
+    size_t keyIdx;
+  };
+  std::vector<Target> targets(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    Bucket* bucket = tableFindBucket(keys[i]);
+    __builtin_prefetch(bucket);
+    targets[i] = Target{bucket, locks_.lockIdx(bucket), i};
+  }
+  std::stable_sort(
+      targets.begin(), targets.end(), [](const Target& a, const Target& b) {
+        return a.lockIdx < b.lockIdx;
+      });
+
+  std::vector<const Target*> promotes;
+  for (size_t begin = 0, end = 0; begin < targets.size(); begin = end) {
+    end = begin + 1;
+    while (end < targets.size() &&
+           targets[end].lockIdx == targets[begin].lockIdx) {
+      end++;
+    }
+    /* any bucket of the group gets the lock of the group */
+    Bucket* lockBucket = targets[begin].bucket;
+
+    auto onTimeout = [&] {
+      XDCHECK(timeout > std::chrono::microseconds::zero());
+      for (size_t j = begin; j < end; j++) {
+        ++stats_.tlStats().lockTimeout;
+        rvs[targets[j].keyIdx] = -2;
+      }
+    };
+
+    if (op == Operation::READ) {
+      promotes.clear();
+      {
+        auto lock = locks_.lockShared(timeout, lockBucket);
+        if (!lock.owns_lock()) {
+          onTimeout();
+          continue;
+        }
+        for (size_t j = begin; j < end; j++) {
+          BucketReturn rv = call(targets[j].bucket, targets[j].keyIdx);
+          if (UNLIKELY(rv == BucketReturn::PROMOTE)) {
+            rv = BucketReturn::FOUND;
+            promotes.push_back(&targets[j]);
+          }
+          rvs[targets[j].keyIdx] = toInt(rv);
+        }
+      }
+
+      /* Promote under one exclusive lock if necessary */
+      if (!promotes.empty() && allowPromotions_) {
+        auto lock = lockBucketExclusive(timeout, lockBucket);
+        if (!lock.owns_lock()) {
+          XDCHECK(timeout > std::chrono::microseconds::zero());
+          stats_.tlStats().promoteTimeout += promotes.size();
+        } else {
+          for (const Target* t : promotes) {
+            bucketPromote(t->bucket, keys[t->keyIdx]);
+          }
+        }
+      }
+    } else {
+      auto lock = lockBucketExclusive(timeout, lockBucket);
+      if (!lock.owns_lock()) {
+        onTimeout();
+        continue;
+      }
+      for (size_t j = begin; j < end; j++) {
+        rvs[targets[j].keyIdx] =
+            toInt(call(targets[j].bucket, targets[j].keyIdx));
+      }
+    }
+  }
+
+  /* Do the writes on the new location if necessary, after the old one as in
+   * callBucketFn. */
+  if (op == Operation::WRITE) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      Bucket* bucketDbl =
+          rvs[i] == -2 ? nullptr : tableFindDblWriteBucket(keys[i]);
+      if (bucketDbl != nullptr) {
+        auto lockDbl = lockBucketExclusive(bucketDbl);
+        if (call(bucketDbl, i) == BucketReturn::ERROR) {
+          rvs[i] = toInt(BucketReturn::ERROR);
+        }
+      }
+    }
+  }
+}
+
+template <typename C, typename A, typename B>
+typename CompactCache<C, A, B>::BucketWriteLock
+CompactCache<C, A, B>::lockBucketExclusive(Bucket* bucket) {
+  return lockBucketExclusive(std::chrono::microseconds::zero(), bucket);
+}
+
+template <typename C, typename A, typename B>
+typename CompactCache<C, A, B>::BucketWriteLock
+CompactCache<C, A, B>::lockBucketExclusive(
+    const std::chrono::microseconds& timeout, Bucket* bucket) {
+  auto* seq = lockSeqs_ ? &lockSeqs_[locks_.lockIdx(bucket)].seq : nullptr;
+  return BucketWriteLock{locks_.lockExclusive(timeout, bucket), seq};
+}
+
+/** Seqlock style read: the bucket is copied racing with writers and the copy
+ * is only used if the sequence number of its lock did not change meanwhile.
+ * Fixed size buckets are short plain arrays, so the copy is cheap. Falls
+ * back to the shared lock after a few failed attempts. */
+template <typename C, typename A, typename B>
+template <typename Fn, typename... Args>
+bool CompactCache<C, A, B>::optimisticRead(
+    Bucket* bucket, const Key& key, BucketReturn& rv, Fn f, Args... args) {
+  constexpr int kMaxAttempts = 4;
+  auto& seq = lockSeqs_[locks_.lockIdx(bucket)].seq;
+  for (int i = 0; i < kMaxAttempts; i++) {
+    const auto before = seq.load(std::memory_order_acquire);
+    if (before & 1) {
+      /* a writer holds the lock */
+      continue;
+    }
+    Bucket snapshot;
+    std::memcpy(&snapshot, bucket, sizeof(Bucket));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) == before) {
+      rv = (this->*f)(&snapshot, key, args...);
+      return true;
+    }
+  }
+  return false;
+}
+
 template <typename C, typename A, typename B>
 typename CompactCache<C, A, B>::Bucket* CompactCache<C, A, B>::tableFindChunk(
     size_t numChunks, const Key& key) {
@@ -1088,11 +1732,17 @@ void CompactCache<C, A, B>::onEntryEvicted(const EntryHandle& handle) {
 
 template <typename C, typename A, typename B>
 typename CompactCache<C, A, B>::BucketReturn CompactCache<C, A, B>::bucketSet(
-    Bucket* bucket, const Key& key, const Value* val, size_t size) {
+    Bucket* bucket,
+    const Key& key,
+    const Value* val,
+    size_t size,
+    uint32_t expiryTime) {
   if ((kHasValues && (val == nullptr)) ||
-      (kValuesFixedSize && size != 0 && size != sizeof(Value))) {
+      (kValuesFixedSize && size != 0 && size != sizeof(Value)) ||
+      (!kSupportsExpiry && expiryTime != 0)) {
     // val should not be null if kHasValues is true
     // size should be 0 if kValuesFixedSize is true
+    // expiryTime needs a bucket descriptor that stores it
     return BucketReturn::ERROR;
   }
 
@@ -1102,7 +1752,13 @@ typename CompactCache<C, A, B>::BucketReturn CompactCache<C, A, B>::bucketSet(
   /* Look for an existing entry to be updated. */
   EntryHandle entry = bucketFind(bucket, key);
   if (!entry) {
-    int rv = BucketDescriptor::insert(bucket, key, val, size, evictionCallback);
+    int rv;
+    if constexpr (kSupportsExpiry) {
+      rv = BucketDescriptor::insert(
+          bucket, key, val, size, evictionCallback, expiryTime);
+    } else {
+      rv = BucketDescriptor::insert(bucket, key, val, size, evictionCallback);
+    }
 
     if (rv == -1) {
       /* An error occured when inserting. */
@@ -1117,7 +1773,12 @@ typename CompactCache<C, A, B>::BucketReturn CompactCache<C, A, B>::bucketSet(
       detail::callReplaceCb<SelfType>(replaceCb_, key, entry.val(), val);
     }
     /* Update the value of the already existing entry. */
-    BucketDescriptor::updateVal(entry, val, size, evictionCallback);
+    if constexpr (kSupportsExpiry) {
+      BucketDescriptor::updateVal(
+          entry, val, size, evictionCallback, expiryTime);
+    } else {
+      BucketDescriptor::updateVal(entry, val, size, evictionCallback);
+    }
 
     /* This is a hit. */
     return BucketReturn::FOUND;
@@ -1182,26 +1843,94 @@ CompactCache<C, A, B>::bucketPromote(Bucket* bucket, const Key& key) {
   return BucketReturn::FOUND;
 }
 
+template <typename C, typename A, typename B>
+typename CompactCache<C, A, B>::BucketReturn CompactCache<C, A, B>::bucketAdd(
+    Bucket* bucket,
+    const Key& key,
+    const Value* delta,
+    Value* result,
+    bool* applied) {
+  if (*applied) {
+    /* Blindly write the result, the entry in this bucket may be stale. */
+    if (!ValueDescriptor::isEmpty(*result)) {
+      return bucketSet(bucket, key, result);
+    }
+    bucketDel(bucket, key, nullptr, nullptr);
+    return BucketReturn::FOUND;
+  }
+  *applied = true;
+
+  EntryHandle entry = bucketFind(bucket, key);
+  if (!entry) {
+    std::memcpy(result, delta, sizeof(Value));
+    if (ValueDescriptor::isEmpty(*delta)) {
+      return BucketReturn::NOTFOUND;
+    }
+    return bucketSet(bucket, key, delta) == BucketReturn::ERROR
+               ? BucketReturn::ERROR
+               : BucketReturn::NOTFOUND;
+  }
+
+  Value current{};
+  std::memcpy(&current, entry.val(), sizeof(Value));
+  const Value sum = ValueDescriptor::add(current, *delta);
+  std::memcpy(result, &sum, sizeof(Value));
+  if (ValueDescriptor::isEmpty(sum)) {
+    if (removeCb_) {
+      detail::callRemoveCb<SelfType>(
+          removeCb_, key, entry.val(), RemoveContext::kNormal);
+    }
+    BucketDescriptor::del(entry);
+    return BucketReturn::FOUND;
+  }
+
+  if (replaceCb_) {
+    detail::callReplaceCb<SelfType>(replaceCb_, key, entry.val(), &sum);
+  }
+  /* Values are of a fixed size, so updates do not evict. */
+  if constexpr (kSupportsExpiry) {
+    BucketDescriptor::updateVal(entry, &sum, 0, {}, entry.expiryTime());
+  } else {
+    BucketDescriptor::updateVal(entry, &sum, 0, {});
+  }
+  return BucketReturn::FOUND;
+}
+
 /** This iterates on all the entries in the bucket and compare their keys
- *  with the key until a match is found. */
+ *  with the key until a match is found, unless the bucket descriptor has its
+ *  own find. */
 template <typename C, typename A, typename B>
 typename CompactCache<C, A, B>::EntryHandle CompactCache<C, A, B>::bucketFind(
     Bucket* bucket, const Key& key) {
-  for (EntryHandle handle = BucketDescriptor::first(bucket); handle;
-       handle.next()) {
-    if (handle.key() == key) {
-      /* Entry found. */
-      return handle;
+  if constexpr (detail::HasBucketFind<B>::value) {
+    return BucketDescriptor::find(bucket, key);
+  } else {
+    for (EntryHandle handle = BucketDescriptor::first(bucket); handle;
+         handle.next()) {
+      if (handle.key() == key) {
+        /* Entry found. */
+        return handle;
+      }
     }
-  }
 
-  /* Entry not found. */
-  return EntryHandle();
+    /* Entry not found. */
+    return EntryHandle();
+  }
 }
 
 template <typename C, typename A, typename B>
 bool CompactCache<C, A, B>::forEachBucket(const BucketCallBack& cb) {
   auto lock = std::shared_lock(resizeLock_);
+  // buckets are only visited in one layout, so first finish any incremental
+  // resize in progress
+  while (resizeState_.inProgress) {
+    lock.unlock();
+    {
+      auto resizeLock = std::unique_lock(resizeLock_);
+      continueResize(std::numeric_limits<size_t>::max());
+    }
+    lock.lock();
+  }
 
   // this obtains a resize lock so it cannot be occuring during an actual
   // resize; assert that
@@ -1213,7 +1942,7 @@ bool CompactCache<C, A, B>::forEachBucket(const BucketCallBack& cb) {
     for (size_t i = 0; i < bucketsPerChunk_; i++) {
       /* Lock the bucket. */
       Bucket* bucket = &tableChunk[i];
-      auto bucketLock = locks_.lockExclusive(bucket);
+      auto bucketLock = lockBucketExclusive(bucket);
 
       if (!cb(bucket)) {
         return false;
@@ -27,6 +27,8 @@
  * values of a fixed size, or compact caches that do not store values.
  * CCacheVariableCreator can be used for creating a compact cache that
  * stores values of a variable size.
+ * CCacheTtlCreator is like CCacheCreator, for a compact cache whose entries
+ * can be set with an expiry time.
  */
 
 #include "cachelib/compact_cache/CCache.h"
@@ -74,6 +76,35 @@ struct CCacheCreator {
   using type = CompactCache<Descriptor, AllocatorT>;
 };
 
+/**
+ * Same as CCacheCreator, but every entry also stores an expiry time that is
+ * passed to set. Expired entries are missed and their slots are reused by
+ * the next inserts in the bucket.
+ *
+ * For example:
+ *  using MyCCache = CCacheTtlCreator<A, K, V>::type;
+ *  ccache.set(key, &value, 0, util::getCurrentTimeSec() + ttlSecs);
+ *
+ * @param AllocatorT    This must implement CCacheAllocatorBase interface.
+ * @param KeyT          Key must be a POD-like type.
+ * @param ValueT        Value must be a POD-like type.
+ */
+template <typename AllocatorT, typename KeyT, typename ValueT = NoValue>
+struct CCacheTtlCreator {
+ private:
+  using ValueDesc = typename std::conditional<std::is_integral<ValueT>::value,
+                                              CounterValueDescriptor<ValueT>,
+                                              ValueDescriptor<ValueT>>::type;
+
+  using Descriptor = CompactCacheDescriptor<KeyT, ValueDesc>;
+
+ public:
+  using type =
+      CompactCache<Descriptor,
+                   AllocatorT,
+                   FixedTtlLruBucket<Descriptor, NB_ENTRIES_PER_BUCKET>>;
+};
+
 /**
  * The following trait can be used for creating a compact cache that stores
  * values of a variable size.
@@ -82,11 +113,21 @@ struct CCacheCreator {
  *  using MyCCache = CCacheVariableCreator<A, K, 400>::type;
  *     maps a key made of type K to values of a variable size up to 400B.
  *
+ *  using MyCCache =
+ *      CCacheVariableCreator<A, K, 64, VariableSlotLruBucket>::type;
+ *     same for values up to 64B, with buckets that compact lazily, for
+ *     caches with a high rate of updates and deletes.
+ *
  * @param AllocatorT    This must implement CCacheAllocatorBase interface.
  * @param KeyT          Key must be a POD-like type.
- * @param ValueT        Value must be a POD-like type.
+ * @param MaxValueSize  Maximum size of a value.
+ * @param BucketT       Bucket descriptor for variable sized values, either
+ *                      VariableLruBucket or VariableSlotLruBucket.
  */
-template <typename AllocatorT, typename KeyT, unsigned MaxValueSize>
+template <typename AllocatorT,
+          typename KeyT,
+          unsigned MaxValueSize,
+          template <typename> class BucketT = VariableLruBucket>
 struct CCacheVariableCreator {
  private:
   /* Create the value descriptor for a variable size value. */
@@ -97,7 +138,7 @@ struct CCacheVariableCreator {
 
  public:
   /* Create the compact cache. */
-  using type = CompactCache<Descriptor, AllocatorT>;
+  using type = CompactCache<Descriptor, AllocatorT, BucketT<Descriptor>>;
 };
 } // namespace cachelib
 } // namespace facebook
@@ -172,6 +172,19 @@ struct VariableSizedValueDescriptor {
 /****************************************************************************/
 /* Compact Cache descriptor */
 
+/**
+ * Trait telling whether two keys compare equal if and only if their bytes are
+ * equal. Buckets can then match a key against all their entries with wide
+ * compares instead of calling operator== on every entry.
+ * True for integral keys. Specialize it for POD keys whose operator== is a
+ * plain memcmp, e.g.:
+ *
+ *   template <>
+ *   struct BitwiseComparableKey<MyKey> : std::true_type {};
+ */
+template <typename KeyT>
+struct BitwiseComparableKey : std::bool_constant<std::is_integral_v<KeyT>> {};
+
 /** Special type for a compact cache that stores no value. */
 struct CACHELIB_PACKED_ATTR NoValue {
   char value[0];
@@ -201,6 +214,9 @@ struct CompactCacheDescriptor {
   /** Used to determine if this compact cache stores values of a variable
    * size, i.e VariableSizedValueDescriptor is used. */
   constexpr static bool kValuesFixedSize = ValueDescriptor::kFixedSize;
+
+  /** Used to determine if keys can be matched by comparing their bytes. */
+  constexpr static bool kBitwiseKeys = BitwiseComparableKey<Key>::value;
 };
 } // namespace cachelib
 } // namespace facebook
@@ -28,6 +28,16 @@
  * the top and shifting all the entries that were above it down one position.
  */
 
+#include <folly/lang/Bits.h>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace facebook {
 namespace cachelib {
 
@@ -65,6 +75,12 @@ struct FixedLruBucket {
   static_assert(sizeof(Bucket) == kEntriesPerBucket * sizeof(Entry),
                 "Bucket packing went awry");
 
+  /** Whether find matches the key against all the entries at once. This
+   * needs keys that compare by their bytes and are 4, 8 or 16 bytes wide. */
+  constexpr static bool kWideKeyMatch =
+      Descriptor::kBitwiseKeys && kEntriesPerBucket <= 32 &&
+      (sizeof(Key) == 4 || sizeof(Key) == 8 || sizeof(Key) == 16);
+
   /**
    * Handle to an entry. This class provides the compact cache implementation
    * with a way to keep a reference to an entry in a bucket as well as a way
@@ -127,6 +143,35 @@ struct FixedLruBucket {
     return EntryHandle(bucket, 0);
   }
 
+  /**
+   * Find the entry of a key.
+   *
+   * @param bucket Bucket in which to look for the key.
+   * @param key    Key to look for.
+   * @return       Handle to the entry, or invalid handle if not found.
+   */
+  static EntryHandle find(Bucket* bucket, const Key& key) {
+    if constexpr (kWideKeyMatch) {
+      const uint32_t matches = matchKeys(*bucket, key);
+      if (matches != 0) {
+        /* Empty slots are zeroed, so only an empty key could match one. The
+         * handle is invalid then, as with the entry by entry search. */
+        EntryHandle handle(bucket, folly::findFirstSet(matches) - 1);
+        if (handle) {
+          return handle;
+        }
+      }
+      return EntryHandle();
+    } else {
+      for (EntryHandle handle = first(bucket); handle; handle.next()) {
+        if (handle.key() == key) {
+          return handle;
+        }
+      }
+      return EntryHandle();
+    }
+  }
+
   /**
    * Return capacity of this bucket in number of entries
    * @param bucket
@@ -261,6 +306,79 @@ struct FixedLruBucket {
   }
 
  private:
+  /**
+   * Compare the bytes of a key with the keys of all the entries.
+   *
+   * @return  bitmask with bit i set if entry i has the key
+   */
+  static uint32_t matchKeys(const Bucket& bucket, const Key& key) {
+    static_assert(kWideKeyMatch);
+    uint32_t matches = 0;
+#if defined(__SSE2__)
+    if constexpr (!kHasValues && sizeof(Key) <= 8 &&
+                  sizeof(Bucket) % sizeof(__m128i) == 0) {
+      /* Keys are contiguous, compare a vector of them at a time. */
+      constexpr int kKeysPerVector = sizeof(__m128i) / sizeof(Key);
+      __m128i needle;
+      if constexpr (sizeof(Key) == 4) {
+        needle = _mm_set1_epi32(loadKey<int32_t>(&key));
+      } else {
+        needle = _mm_set1_epi64x(loadKey<int64_t>(&key));
+      }
+      for (int i = 0; i < kEntriesPerBucket; i += kKeysPerVector) {
+        __m128i eq = _mm_cmpeq_epi32(
+            _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(&bucket.entries[i])),
+            needle);
+        uint32_t mask;
+        if constexpr (sizeof(Key) == 4) {
+          mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        } else {
+          /* both halves of a 64 bit key must match */
+          eq = _mm_and_si128(eq,
+                             _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+          mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        }
+        matches |= mask << i;
+      }
+      return matches;
+    }
+    if constexpr (sizeof(Key) == 16) {
+      const __m128i needle =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&key));
+      for (int i = 0; i < kEntriesPerBucket; i++) {
+        const __m128i entryKey = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(&bucket.entries[i].key));
+        const int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(entryKey, needle));
+        matches |= static_cast<uint32_t>(eq == 0xFFFF) << i;
+      }
+      return matches;
+    }
+#endif
+    /* Branchless compare of every entry, which compilers unroll */
+    using Word = std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+    constexpr size_t kWords = sizeof(Key) / sizeof(Word);
+    Word needle[kWords];
+    std::memcpy(needle, &key, sizeof(Key));
+    for (int i = 0; i < kEntriesPerBucket; i++) {
+      Word entryKey[kWords];
+      std::memcpy(entryKey, &bucket.entries[i].key, sizeof(Key));
+      bool eq = true;
+      for (size_t w = 0; w < kWords; w++) {
+        eq &= entryKey[w] == needle[w];
+      }
+      matches |= static_cast<uint32_t>(eq) << i;
+    }
+    return matches;
+  }
+
+  template <typename T>
+  static T loadKey(const Key* key) {
+    T word;
+    std::memcpy(&word, key, sizeof(T));
+    return word;
+  }
+
   /**
    * Copy a value from one buffer to another.
    * The caller should ensure that this is called with non NULL values.
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * This file implements a bucket management for values of a fixed size where
+ * every entry carries an expiry time, in seconds since epoch like the expiry
+ * time of an item. An expiry time of 0 means the entry never expires.
+ *
+ * Entries are kept by a FixedLruBucket whose values are prefixed with the
+ * expiry time, so the LRU mechanism is the same. Expiry is lazy:
+ *  - find does not return an expired entry, so get, exists and del miss it.
+ *  - insert first drops the expired entries of the bucket, so they are
+ *    reclaimed as free slots before any valid entry is evicted.
+ * Expired entries are dropped without calling the eviction callback.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "cachelib/common/Time.h"
+#include "cachelib/compact_cache/CCacheDescriptor.h"
+#include "cachelib/compact_cache/CCacheFixedLruBucket.h"
+
+namespace facebook {
+namespace cachelib {
+
+template <typename CompactCacheDescriptor, unsigned EntriesPerBucket>
+struct FixedTtlLruBucket {
+ public:
+  using Descriptor = CompactCacheDescriptor;
+  using ValueDescriptor = typename Descriptor::ValueDescriptor;
+  using Key = typename Descriptor::Key;
+  using Value = typename ValueDescriptor::Value;
+
+  constexpr static int kEntriesPerBucket = EntriesPerBucket;
+  constexpr static bool kHasValues = Descriptor::kHasValues;
+
+  static_assert(Descriptor::kValuesFixedSize,
+                "This bucket descriptor must be used with values of a fixed"
+                "size");
+
+  /** Value stored in the entries of the underlying bucket. */
+  struct ExpiringValue {
+    uint32_t expiryTime;
+    /* Expands to NoValue (size 0) if this cache does not store values */
+    Value val;
+  } __attribute__((__packed__));
+
+ private:
+  using StoreValueDescriptor = cachelib::ValueDescriptor<ExpiringValue>;
+  using StoreDescriptor =
+      cachelib::CompactCacheDescriptor<Key, StoreValueDescriptor>;
+  using Store = FixedLruBucket<StoreDescriptor, EntriesPerBucket>;
+
+ public:
+  /** Type of a bucket.
+   * Empty entry slots must be zeroed out to avoid spurious matches! */
+  using Bucket = typename Store::Bucket;
+
+  /**
+   * Handle to an entry, see FixedLruBucket::EntryHandle. Expired entries are
+   * still visited when iterating over a bucket.
+   */
+  class EntryHandle {
+   public:
+    explicit operator bool() const { return static_cast<bool>(handle_); }
+    void next() { handle_.next(); }
+
+    Key key() const { return handle_.key(); }
+    Value* val() const { return &handle_.val()->val; }
+    constexpr size_t size() const { return sizeof(Value); }
+    uint32_t expiryTime() const { return handle_.val()->expiryTime; }
+
+    /** Whether the entry expired relative to @now, in seconds. */
+    bool isExpired(uint32_t now) const {
+      const uint32_t expiry = expiryTime();
+      return expiry > 0 && expiry < now;
+    }
+
+    EntryHandle() = default;
+    explicit EntryHandle(typename Store::EntryHandle handle)
+        : handle_(handle) {}
+
+    bool isBucketTail() const { return handle_.isBucketTail(); }
+
+   private:
+    typename Store::EntryHandle handle_;
+    friend struct FixedTtlLruBucket<CompactCacheDescriptor, EntriesPerBucket>;
+  };
+
+  /** Type of the callback to be called when an entry is evicted. */
+  using EvictionCb = std::function<void(const EntryHandle& handle)>;
+
+  static EntryHandle first(Bucket* bucket) {
+    return EntryHandle(Store::first(bucket));
+  }
+
+  /**
+   * Find the entry of a key.
+   *
+   * @return  Handle to the entry, or invalid handle if not found or expired.
+   */
+  static EntryHandle find(Bucket* bucket, const Key& key) {
+    EntryHandle handle(Store::find(bucket, key));
+    if (handle && handle.isExpired(util::getCurrentTimeSec())) {
+      return EntryHandle();
+    }
+    return handle;
+  }
+
+  static uint32_t nEntriesCapacity(const Bucket& /*bucket*/) {
+    return kEntriesPerBucket;
+  }
+
+  /**
+   * Insert a new entry in a bucket, after dropping the expired ones. The
+   * least recently used entry is evicted if the bucket is still full.
+   *
+   * @param bucket         Bucket in which to insert the new entry.
+   * @param key            key of the new entry.
+   * @param val            Pointer to a value to be copied in the new
+   *                       entry. Unused if Value Type is NoValue.
+   * @param size           Unused, values are of a fixed size.
+   * @param evictionCb     Callback to be called for when an entry is evicted.
+   * @param expiryTime     Expiry time of the entry, 0 if it never expires.
+   * @return               1 if an entry was evicted, 0 otherwise.
+   */
+  static bool insert(Bucket* bucket,
+                     const Key& key,
+                     const Value* val,
+                     size_t,
+                     EvictionCb evictionCb,
+                     uint32_t expiryTime = 0) {
+    reclaimExpired(bucket, util::getCurrentTimeSec());
+
+    ExpiringValue entryVal{};
+    entryVal.expiryTime = expiryTime;
+    if (kHasValues) {
+      XDCHECK(val);
+      std::memcpy(&entryVal.val, val, sizeof(Value));
+    }
+    return Store::insert(
+        bucket, key, &entryVal, 0,
+        [&evictionCb](const typename Store::EntryHandle& handle) {
+          evictionCb(EntryHandle(handle));
+        });
+  }
+
+  static void promote(EntryHandle& handle) { Store::promote(handle.handle_); }
+
+  static inline bool needs_promote(EntryHandle& handle) {
+    return Store::needs_promote(handle.handle_);
+  }
+
+  static void del(EntryHandle& handle) { Store::del(handle.handle_); }
+
+  /**
+   * Update the value and the expiry time of an entry.
+   *
+   * @param handle     Handle of the entry to be updated. Remains valid after
+   *                   this function returns.
+   * @param val        New value of the entry.
+   * @param size       Unused, values are of a fixed size.
+   * @param evictionCb Unused, updates do not evict.
+   * @param expiryTime New expiry time of the entry, 0 if it never expires.
+   */
+  static void updateVal(EntryHandle& handle,
+                        const Value* val,
+                        size_t,
+                        EvictionCb /*evictionCb*/,
+                        uint32_t expiryTime = 0) {
+    XDCHECK(handle);
+    handle.handle_.val()->expiryTime = expiryTime;
+    if (kHasValues) {
+      XDCHECK(val);
+      std::memcpy(handle.val(), val, sizeof(Value));
+    }
+  }
+
+  static void copyVal(Value* val, size_t*, EntryHandle& handle) {
+    XDCHECK(handle);
+    XDCHECK(val);
+    std::memcpy(val, handle.val(), sizeof(Value));
+  }
+
+ private:
+  /** Delete the entries of a bucket that expired relative to @now. */
+  static void reclaimExpired(Bucket* bucket, uint32_t now) {
+    EntryHandle handle = first(bucket);
+    while (handle) {
+      if (handle.isExpired(now)) {
+        /* del moves the handle to the next entry */
+        del(handle);
+      } else {
+        handle.next();
+      }
+    }
+  }
+};
+} // namespace cachelib
+} // namespace facebook
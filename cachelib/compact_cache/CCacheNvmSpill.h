@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/logging/xlog.h>
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/common/Hash.h"
+#include "cachelib/common/Mutex.h"
+#include "cachelib/compact_cache/CCache.h"
+#include "cachelib/navy/common/Hash.h"
+#include "cachelib/navy/engine/Engine.h"
+
+/**
+ * This file implements an NVM tier for a compact cache: the entries the
+ * compact cache evicts, including the ones dropped by a resize, spill to a
+ * navy engine, typically a BigHash, and are faulted back in on a miss.
+ *
+ * An entry lives either in the compact cache or in the engine:
+ *  - get looks the key up in the compact cache, then in the engine. A hit in
+ *    the engine moves the entry back to the compact cache.
+ *  - set writes to the compact cache and drops the copy in the engine, if
+ *    any.
+ *  - del removes the key from both.
+ *
+ * Operations on a key are serialized by striped locks so that an entry being
+ * faulted in does not overwrite a newer value. Evicted entries are written to
+ * the engine synchronously, from the remove callback of the compact cache,
+ * i.e. while the bucket of the compact cache is locked.
+ *
+ * set and del look the key up in the engine when it could exist there, so
+ * give the engine a bloom filter to keep them in DRAM for keys that were
+ * never spilled.
+ *
+ * Usage:
+ *
+ *   CCacheNvmSpill<MyCCache> spill(engine);
+ *   auto* ccache = cache->template addCompactCache<MyCCache>(
+ *       "name", size, spill.wrapRemoveCb(removeCb), replaceCb, validCb);
+ *   spill.attach(*ccache);
+ *   spill.set(key, &value);
+ *   spill.get(key, &value);
+ */
+
+namespace facebook {
+namespace cachelib {
+
+template <typename CC>
+class CCacheNvmSpill {
+ public:
+  using Key = typename CC::Key;
+  using Value = typename CC::Value;
+  using RemoveCb = typename CC::RemoveCb;
+
+  static_assert(CC::kValuesFixedSize,
+                "Spilling to NVM needs values of a fixed size.");
+
+  /** Default power of two of the number of key locks. */
+  constexpr static uint32_t kDefaultLockPower = 10;
+
+  struct Stats {
+    // entries written to the engine on eviction
+    uint64_t spills{0};
+    // evicted entries the engine failed to take
+    uint64_t spillErrors{0};
+    // misses in the compact cache found in the engine
+    uint64_t faultIns{0};
+  };
+
+  /**
+   * @param engine     navy engine that takes the evicted entries. The
+   *                   caller must guarantee its validity for the lifetime of
+   *                   this instance.
+   * @param lockPower  operations are serialized over 2^lockPower locks
+   */
+  explicit CCacheNvmSpill(navy::Engine& engine,
+                          uint32_t lockPower = kDefaultLockPower)
+      : engine_(engine), locks_(lockPower, std::make_shared<MurmurHash2>()) {}
+
+  CCacheNvmSpill(const CCacheNvmSpill&) = delete;
+  CCacheNvmSpill& operator=(const CCacheNvmSpill&) = delete;
+
+  /**
+   * Return the remove callback to create the compact cache with. It spills
+   * the evicted entries, then calls @cb, if any, for every removed entry.
+   * The returned callback refers to this instance.
+   */
+  RemoveCb wrapRemoveCb(RemoveCb cb = {}) {
+    if constexpr (CC::kHasValues) {
+      return [this, cb = std::move(cb)](const Key& key, const Value* val,
+                                        const RemoveContext context) {
+        if (context == RemoveContext::kEviction) {
+          spill(key, val);
+        }
+        if (cb) {
+          cb(key, val, context);
+        }
+      };
+    } else {
+      return [this, cb = std::move(cb)](const Key& key,
+                                        const RemoveContext context) {
+        if (context == RemoveContext::kEviction) {
+          spill(key, nullptr);
+        }
+        if (cb) {
+          cb(key, context);
+        }
+      };
+    }
+  }
+
+  /**
+   * Set the compact cache in front of the engine. It must have been created
+   * with a callback returned by wrapRemoveCb.
+   */
+  void attach(CC& ccache) { ccache_ = &ccache; }
+
+  /**
+   * Get an entry, from the compact cache or else from the engine. An entry
+   * found in the engine is moved to the compact cache.
+   *
+   * @return FOUND, NOTFOUND, or the error returned by the compact cache
+   */
+  CCacheReturn get(const Key& key,
+                   Value* val = nullptr,
+                   bool shouldPromote = true) {
+    XDCHECK(ccache_);
+    auto l = locks_.lock(&key, sizeof(Key));
+    auto res = ccache_->get(key, val, nullptr, shouldPromote);
+    if (res != CCacheReturn::NOTFOUND) {
+      return res;
+    }
+
+    const auto hk = makeHK(key);
+    navy::Buffer buffer;
+    if (!engine_.couldExist(hk) ||
+        engine_.lookup(hk, buffer) != navy::Status::Ok) {
+      return CCacheReturn::NOTFOUND;
+    }
+    if (buffer.size() != kValueSize) {
+      XLOGF(ERR, "Dropping NVM entry of {} bytes, expected {}", buffer.size(),
+            kValueSize);
+      removeFromEngine(hk);
+      return CCacheReturn::NOTFOUND;
+    }
+    faultIns_.inc();
+
+    // removed before the entry is back in the compact cache, so that an
+    // eviction right after does not lose it
+    removeFromEngine(hk);
+    const Value* nvmVal = CC::kHasValues
+                              ? reinterpret_cast<const Value*>(buffer.data())
+                              : nullptr;
+    if (val != nullptr && CC::kHasValues) {
+      std::memcpy(val, buffer.data(), kValueSize);
+    }
+    ccache_->set(key, nvmVal);
+    return CCacheReturn::FOUND;
+  }
+
+  /**
+   * Set an entry in the compact cache and drop the copy in the engine.
+   *
+   * @return the return of CompactCache::set
+   */
+  CCacheReturn set(const Key& key, const Value* val = nullptr) {
+    XDCHECK(ccache_);
+    auto l = locks_.lock(&key, sizeof(Key));
+    const auto res = ccache_->set(key, val);
+    if (res != CCacheReturn::ERROR && res != CCacheReturn::TIMEOUT) {
+      const auto hk = makeHK(key);
+      if (engine_.couldExist(hk)) {
+        removeFromEngine(hk);
+      }
+    }
+    return res;
+  }
+
+  /**
+   * Remove an entry from the compact cache and the engine.
+   *
+   * @return FOUND if the key was in either, NOTFOUND otherwise, or the error
+   *         returned by the compact cache
+   */
+  CCacheReturn del(const Key& key) {
+    XDCHECK(ccache_);
+    auto l = locks_.lock(&key, sizeof(Key));
+    auto res = ccache_->del(key);
+    if (res == CCacheReturn::ERROR || res == CCacheReturn::TIMEOUT) {
+      return res;
+    }
+    const auto hk = makeHK(key);
+    if (engine_.couldExist(hk) && removeFromEngine(hk)) {
+      res = CCacheReturn::FOUND;
+    }
+    return res;
+  }
+
+  Stats getStats() const {
+    Stats stats;
+    stats.spills = spills_.get();
+    stats.spillErrors = spillErrors_.get();
+    stats.faultIns = faultIns_.get();
+    return stats;
+  }
+
+ private:
+  constexpr static size_t kValueSize = CC::kHasValues ? sizeof(Value) : 0;
+
+  static HashedKey makeHK(const Key& key) {
+    return navy::makeHK(&key, sizeof(Key));
+  }
+
+  // Writes an evicted entry to the engine. Called under the lock of the
+  // compact cache's bucket.
+  void spill(const Key& key, const Value* val) {
+    const navy::BufferView view{kValueSize,
+                                reinterpret_cast<const uint8_t*>(val)};
+    navy::Status status;
+    // We do busy wait because we don't expect many retries.
+    while ((status = engine_.insert(makeHK(key), view)) ==
+           navy::Status::Retry) {
+      std::this_thread::yield();
+    }
+    if (status == navy::Status::Ok) {
+      spills_.inc();
+    } else {
+      spillErrors_.inc();
+    }
+  }
+
+  // Returns whether the key was in the engine.
+  bool removeFromEngine(HashedKey hk) {
+    navy::Status status;
+    while ((status = engine_.remove(hk)) == navy::Status::Retry) {
+      std::this_thread::yield();
+    }
+    return status == navy::Status::Ok;
+  }
+
+  navy::Engine& engine_;
+  CC* ccache_{nullptr};
+  BucketLocks<std::mutex> locks_;
+
+  AtomicCounter spills_;
+  AtomicCounter spillErrors_;
+  AtomicCounter faultIns_;
+};
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,638 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * This file implements a bucket management for variable sized objects that
+ * is optimized for buckets with a high rate of updates and deletes. It has a
+ * 3 byte overhead per entry + 5 bytes per bucket.
+ *
+ * +-----------------+---------------+---------------------------------------+
+ * |                 |               |                                       |
+ * |                 |               |                                       |
+ * | Slot directory  |    Empty      |          Data (with holes)            |
+ * |                 |               |                                       |
+ * |                 |               |                                       |
+ * +-----------------+---------------+---------------------------------------+
+ *
+ * The layout is the one of VariableLruBucket, but the data section may have
+ * holes:
+ *
+ * 1) Slot directory.
+ *    One entry header (EntryHdr) per entry, ordered from the MRU (left-most)
+ *    to the LRU (right-most). Each header holds the key, the size of the
+ *    value and its offset in the bucket. The data does not point back to its
+ *    header, so reordering the directory never touches the data.
+ *
+ * 2) Data.
+ *    The values, growing from the end of the bucket towards the directory.
+ *    Deleting or shrinking a value leaves a hole instead of shifting the
+ *    values that precede it. The "totalDataSize" field of Bucket is the size
+ *    of the data section including the holes, "holeSize" is the amount of
+ *    bytes in the holes.
+ *
+ * 3) Empty.
+ *    The contiguous free space between the directory and the data.
+ *
+ * Promoting an entry only shifts the headers that precede it. Deleting an
+ * entry shifts the headers that follow it and adds its value to the holes,
+ * unless the value is the first in the data section, in which case the data
+ * section shrinks. Updating an entry with a value of the same or a smaller
+ * size is done in place; a bigger value is deleted and inserted again.
+ *
+ * Compaction is lazy: holes count as free space when deciding how many
+ * entries an insert has to evict. The new value goes in the contiguous free
+ * space or, if it does not fit there, where the largest evicted value was.
+ * The data section is compacted only when neither fits, i.e when the
+ * fragmentation exceeds what the insert can do without. Compacting moves
+ * every value once, from the end of the bucket in decreasing offset order,
+ * and clears the holes.
+ */
+
+namespace facebook {
+namespace cachelib {
+
+template <typename CompactCacheDescriptor>
+struct VariableSlotLruBucket {
+ public:
+  using Descriptor = CompactCacheDescriptor;
+  using ValueDescriptor = typename Descriptor::ValueDescriptor;
+  using Key = typename Descriptor::Key;
+  using Value = typename ValueDescriptor::Value;
+
+  static_assert(Descriptor::kHasValues,
+                "This bucket descriptor must be used for compact caches with"
+                "values.");
+  static_assert(!Descriptor::kValuesFixedSize,
+                "This bucket descriptor must be used with values of a"
+                "variable size.");
+
+  /** Type of the integral that contains the the size of an entry's data.
+   * (see dataSize in EntryHdr). */
+  using EntryDataSize = uint8_t;
+  /** Type of the integral that gives an offset (in bytes), starting from the
+   * 'data' field of Bucket. This is used for the offset of an entry's value
+   * (see dataOffset in EntryHdr), and the sizes of the data section and its
+   * holes. */
+  using EntryDataOffset = uint16_t;
+  /** Type of the integral that gives the number of entries in a bucket. */
+  using EntryNum = uint8_t;
+
+  constexpr static size_t kMaxValueSize = ValueDescriptor::kMaxSize;
+
+  /** Maximum number of entries per bucket. The number of entries must be
+   * small enough to fit in a value of type EntryNum, so take the max
+   * possible value here. */
+  constexpr static size_t kMaxEntries = std::numeric_limits<EntryNum>::max();
+
+  /** An entry header, i.e a slot of the directory. */
+  struct EntryHdr {
+    Key key;
+    /* Size in bytes of the entry's value. */
+    EntryDataSize dataSize;
+    /* Offset (in bytes) where to find the entry's value, measured from the
+     * beginning of the bucket's data field. */
+    EntryDataOffset dataOffset;
+  } __attribute__((__packed__));
+
+  /** Compute the size of the bucket so that we can guarantee that it will be
+   * big enough to host an entry of the maximum size provided by the user. */
+  constexpr static size_t kBucketDataSize = kMaxValueSize + sizeof(EntryHdr);
+
+  struct Bucket {
+    /* Number of entries in the bucket. */
+    EntryNum numEntries;
+    /* Size of the "Data" section, holes included. */
+    EntryDataOffset totalDataSize;
+    /* Amount of bytes of the "Data" section not used by any entry.
+     * The free space in the bucket is given by computing:
+     * kBucketDataSize - totalDataSize + holeSize -
+     *   sizeof(EntryHdr) * numEntries.
+     */
+    EntryDataOffset holeSize;
+    /* Content of the bucket. This contains the three sections described in
+     * this file's documentation. */
+    char data[kBucketDataSize];
+  } __attribute__((__packed__));
+
+  /** This is to make sure that the 'totalDataSize' field of Bucket will
+   * never overflow. */
+  static_assert(kBucketDataSize <= std::numeric_limits<EntryDataOffset>::max(),
+                "Bucket is too big");
+
+  /** Offset of the empty values. These take no space in the data section,
+   * so that they never share an offset with another value. */
+  constexpr static EntryDataOffset kEmptyDataOffset = kBucketDataSize;
+
+  /**
+   * Handle to an entry. This contains a pointer to the bucket and the index
+   * of the entry in the slot directory. See VariableLruBucket::EntryHandle.
+   */
+  class EntryHandle {
+   public:
+    explicit operator bool() const {
+      return bucket_ && 0 <= pos_ && pos_ < bucket_->numEntries;
+    }
+    void next() {
+      XDCHECK(*this);
+      ++pos_;
+    }
+    Key key() const { return getEntry()->key; }
+    constexpr size_t size() const { return getEntry()->dataSize; }
+
+    Value* val() const {
+      return reinterpret_cast<Value*>(bucket_->data + getEntry()->dataOffset);
+    }
+
+    EntryHandle() : bucket_(nullptr), pos_(-1) {}
+    EntryHandle(Bucket* bucket, int pos) : bucket_(bucket), pos_(pos) {}
+
+    bool isBucketTail() const {
+      return *this && pos_ == bucket_->numEntries - 1;
+    }
+
+   private:
+    EntryHdr* getEntry() const { return getEntryHeader(bucket_, pos_); }
+
+    Bucket* bucket_;
+    int pos_;
+
+    friend struct VariableSlotLruBucket<CompactCacheDescriptor>;
+  };
+
+  /** Type of the callback to be called when an entry is evicted. */
+  using EvictionCb = std::function<void(const EntryHandle& handle)>;
+
+  /**
+   * Get a handle to the first entry in the bucket.
+   *
+   * @param bucket Bucket from which to retrieve the handle.
+   * @return Handle to the first entry.
+   */
+  static EntryHandle first(Bucket* bucket) {
+    /* If bucket->numEntries is 0, the created handle is invalid. */
+    return EntryHandle(bucket, 0);
+  }
+
+  /**
+   * Return the total number of items this bucket could hold.
+   * Due to variable size this is imprecise; extrapolate capacity
+   * by dividing current # of items by current fractional memory
+   * in use, holes excluded.
+   * @param bucket Bucket to find out the number of entries it could hold
+   * @return number of entries this bucket can hold (approx)
+   */
+  static uint32_t nEntriesCapacity(const Bucket& bucket) {
+    const size_t n = bucket.numEntries;
+    const size_t sz = bucket.totalDataSize - bucket.holeSize;
+    XDCHECK_LE(sz + sizeof(EntryHdr) * n, kBucketDataSize);
+    if (n == 0) {
+      return 0;
+    }
+    return (n * kBucketDataSize) / (sz + sizeof(EntryHdr) * n);
+  }
+
+  /**
+   * Insert a new entry in a bucket.
+   *
+   * 1) Evict as many entries as required for the free space, holes
+   *    included, to fit the entry.
+   * 2) If the entry does not fit in the contiguous free space, put its
+   *    value where the largest evicted value was if it fits there, or
+   *    compact the data section otherwise. The value goes at the beginning
+   *    of the data section if it is not put in place of an evicted one.
+   * 3) Write the entry's value.
+   * 4) Shift the slot directory to the right and write the entry's header
+   *    in the first position.
+   *
+   * @param bucket        Bucket in which to insert
+   * @param key           key of the new entry.
+   * @param val           Value to be inserted.
+   * @param size          Size of the value to be inserted. The size must be
+   *                      smaller than or equal to the maximum value size
+   *                      described by the value descriptor.
+   * @param evictionCb    Callback to be called for when an entry is evicted.
+   *                      Cannot be empty.
+   * @return              0 if no item was evicted, 1 if at least one item
+   *                      was evicted, -1 on error (the given size was too
+   *                      big).
+   */
+  static int insert(Bucket* bucket,
+                    const Key& key,
+                    const Value* val,
+                    size_t size,
+                    EvictionCb evictionCb) {
+    XDCHECK_LE(size, kMaxValueSize);
+    if (size > kMaxValueSize) {
+      XLOG(ERR) << "Cannot insert an value of size " << size
+                << ", the size must be smaller than " << kMaxValueSize;
+      return -1;
+    }
+    if (size > std::numeric_limits<EntryDataSize>::max()) {
+      XLOG(ERR)
+          << "Cannot insert an value of size " << size
+          << ", the size must be smaller than the max value of EntryDataSize";
+      return -1;
+    }
+
+#ifndef NDEBUG
+    checkBucketConsistency(bucket);
+#endif
+
+    /* 1) Evict as many entries as required. */
+    const size_t requiredSpace = size + sizeof(EntryHdr);
+    Extent evictedValue;
+    const bool evicted =
+        evictEntries(bucket, requiredSpace, evictionCb, evictedValue);
+
+    /* 2) Find a spot for the value. */
+    EntryDataOffset dataOffset = kEmptyDataOffset;
+    if (size > 0 && contiguousFreeSpace(bucket) < requiredSpace &&
+        contiguousFreeSpace(bucket) >= sizeof(EntryHdr) &&
+        evictedValue.size >= size) {
+      /* The value fits where an evicted one was, the rest of it remains a
+       * hole. */
+      dataOffset = evictedValue.offset;
+      bucket->holeSize -= size;
+    } else {
+      /* Compact if the holes are needed for the entry, and write the value
+       * at the beginning of the data section. */
+      if (contiguousFreeSpace(bucket) < requiredSpace) {
+        compact(bucket);
+      }
+      XDCHECK_GE(contiguousFreeSpace(bucket), requiredSpace);
+      if (size > 0) {
+        checkOverflow<EntryDataOffset>(bucket->totalDataSize + size);
+        bucket->totalDataSize += size;
+        dataOffset = getFirstEntryDataOffset(bucket);
+      }
+    }
+
+    /* 3) Write the entry's value. */
+    memcpy(bucket->data + dataOffset, val, size);
+
+    /* 4) Shift the slot directory and write the entry's header. */
+    memmove(getEntryHeader(bucket, 1),
+            getEntryHeader(bucket, 0),
+            bucket->numEntries * sizeof(EntryHdr));
+    EntryHdr* newEntry = getEntryHeader(bucket, 0);
+    memcpy(&newEntry->key, &key, sizeof(Key));
+    newEntry->dataSize = size;
+    newEntry->dataOffset = dataOffset;
+
+    checkOverflow<EntryNum>(bucket->numEntries + 1);
+    bucket->numEntries++;
+
+#ifndef NDEBUG
+    checkBucketConsistency(bucket);
+#endif
+
+    return evicted ? 1 : 0;
+  }
+
+  /**
+   * Promote an entry by moving its header to the first position of the slot
+   * directory. The headers that precede it are shifted one position to the
+   * right, the data is not touched.
+   *
+   * @param handle Handle of the entry to be promoted. Remains valid after
+   *               this call completes.
+   */
+  static void promote(EntryHandle& handle) {
+    XDCHECK(handle);
+
+    const EntryHdr toPromote = *handle.getEntry();
+    EntryHdr* firstEntry = getEntryHeader(handle.bucket_, 0);
+    memmove(getEntryHeader(handle.bucket_, 1),
+            firstEntry,
+            handle.pos_ * sizeof(EntryHdr));
+    memcpy(firstEntry, &toPromote, sizeof(EntryHdr));
+
+    /* Modify handle so that it still points to the same entry. */
+    handle.pos_ = 0;
+  }
+
+  /**
+   * Whether an entry needs promotion. Do this if it's beyond the first
+   * two, same as VariableLruBucket.
+   */
+  static inline bool needs_promote(EntryHandle& handle) {
+    XDCHECK(handle);
+    return handle.pos_ > 1;
+  }
+
+  /**
+   * Delete an entry. Its value is released to the holes and the headers
+   * that follow it are shifted one position to the left.
+   *
+   * @param handle Handle of the entry to be deleted. After this function
+   *               completes, the handle points to the next valid entry or
+   *               becomes invalid if no such entry.
+   */
+  static void del(EntryHandle& handle) {
+    XDCHECK(handle);
+    Bucket* bucket = handle.bucket_;
+
+    releaseData(bucket, *handle.getEntry());
+    if (handle.pos_ < bucket->numEntries - 1) {
+      const size_t delta = bucket->numEntries - handle.pos_ - 1;
+      memmove(
+          handle.getEntry(), handle.getEntry() + 1, delta * sizeof(EntryHdr));
+    }
+    bucket->numEntries--;
+
+#ifndef NDEBUG
+    checkBucketConsistency(bucket);
+#endif
+  }
+
+  /**
+   * Update the value of an entry.
+   *
+   * If the new size is not bigger than the old one, the value is copied in
+   * place and the bytes it does not use anymore are added to the holes.
+   * Otherwise, the entry is deleted and inserted again. The entry is
+   * promoted in both cases.
+   *
+   * @param handle     Handle to the entry to be updated. Remains valid after
+   *                   this function returns.
+   * @param val        New value of the entry.
+   * @param size       Size of the new value.
+   * @param evictionCb Eviction callback to be called when an entry is
+   *                   evicted due to relocating the updated entry.
+   */
+  static void updateVal(EntryHandle& handle,
+                        const Value* val,
+                        size_t size,
+                        EvictionCb evictionCb) {
+    XDCHECK(handle);
+    EntryHdr* existingEntry = handle.getEntry();
+
+    if (size == 0) {
+      releaseData(handle.bucket_, *existingEntry);
+      existingEntry->dataSize = 0;
+      existingEntry->dataOffset = kEmptyDataOffset;
+      promote(handle);
+#ifndef NDEBUG
+      checkBucketConsistency(handle.bucket_);
+#endif
+    } else if (size <= existingEntry->dataSize) {
+      memcpy(handle.bucket_->data + existingEntry->dataOffset, val, size);
+      handle.bucket_->holeSize += existingEntry->dataSize - size;
+      existingEntry->dataSize = size;
+      promote(handle);
+#ifndef NDEBUG
+      checkBucketConsistency(handle.bucket_);
+#endif
+    } else {
+      const EntryHdr copy = *existingEntry;
+      del(handle);
+      insert(handle.bucket_, copy.key, val, size, evictionCb);
+      handle = first(handle.bucket_);
+    }
+  }
+
+  /**
+   * Copy a an entry's value to a buffer.
+   * The buffer must be large enough to store the value, i.e the caller should
+   * allocate a buffer of a size greater or equal to the maximum possible size
+   * of a value in this compact cache.
+   *
+   * @param val    Buffer in which to copy the entry's value.
+   * @param handle Handle of the entry from which to copy the value. Remains
+   *               valid after this function returns.
+   */
+  static void copyVal(Value* val, size_t* size, const EntryHandle& handle) {
+    XDCHECK(handle);
+    XDCHECK(val);
+    XDCHECK(size);
+    *size = handle.size();
+    memcpy(val, handle.val(), *size);
+  }
+
+  constexpr static size_t maxValueSize() { return kMaxValueSize; }
+
+ private:
+  /** A range of the data section. */
+  struct Extent {
+    EntryDataOffset offset{0};
+    size_t size{0};
+  };
+
+  /**
+   * Check that a bucket is consistent: the values do not overlap each other
+   * or the slot directory, and the sizes of the values and the holes add up
+   * to the size of the data section.
+   *
+   * This should be called after each operation when in debug mode in order to
+   * verify that the operation leaves the bucket in a consistent state.
+   *
+   * @param bucket Bucket to be checked.
+   */
+  static void checkBucketConsistency(Bucket* bucket) {
+    using EntryInfo = std::pair<EntryDataOffset, EntryDataSize>;
+    std::vector<EntryInfo> entryDataSeen;
+    size_t liveSize = 0;
+    for (unsigned int i = 0; i < bucket->numEntries; i++) {
+      const EntryHdr* header = getEntryHeader(bucket, i);
+      entryDataSeen.emplace_back(header->dataOffset, header->dataSize);
+      liveSize += header->dataSize;
+    }
+    std::sort(entryDataSeen.begin(), entryDataSeen.end());
+
+    bool dataOffsetError = false;
+    size_t nextFreeOffset = getFirstEntryDataOffset(bucket);
+    for (const auto& info : entryDataSeen) {
+      if (info.first < nextFreeOffset) {
+        dataOffsetError = true;
+        break;
+      }
+      nextFreeOffset = info.first + info.second;
+    }
+    if (nextFreeOffset > kBucketDataSize ||
+        getFirstEntryDataOffset(bucket) <
+            sizeof(EntryHdr) * bucket->numEntries) {
+      dataOffsetError = true;
+    }
+
+    if (dataOffsetError ||
+        liveSize + bucket->holeSize != bucket->totalDataSize) {
+      /* Copy the bucket locally for easier debugging in case the slab is
+       * not in the core dump file. */
+      Bucket bucketCopy;
+      memcpy(&bucketCopy, bucket, sizeof(Bucket));
+      XDCHECK(false);
+    }
+  }
+
+  /**
+   * Evict as many entries as needed, starting from the oldest, until the
+   * amount of free space in the bucket, holes included, is equal or greater
+   * than requiredSpace. Evicting the LRU only drops the last header of the
+   * slot directory and releases its value.
+   *
+   * @param bucket Bucket from which to evict entries.
+   * @param requiredSpace Amount of space required (in bytes).
+   * @param evictionCb callback to be called for each evicted entry.
+   * @param largestHole set to the largest evicted value that became a hole.
+   * @return true if at least one entry was evicted.
+   */
+  static bool evictEntries(Bucket* bucket,
+                           size_t requiredSpace,
+                           EvictionCb evictionCb,
+                           Extent& largestHole) {
+    bool evicted = false;
+    auto evictOneMoreEntryFn = [&]() {
+      /* There should always be at least one entry for eviction until
+       * we have enough space. */
+      XDCHECK_GT(bucket->numEntries, 0);
+      const unsigned int pos = bucket->numEntries - 1;
+      const EntryHdr* header = getEntryHeader(bucket, pos);
+      evictionCb(EntryHandle(bucket, pos));
+      if (header->dataSize > largestHole.size &&
+          header->dataOffset != getFirstEntryDataOffset(bucket)) {
+        largestHole = {header->dataOffset, header->dataSize};
+      }
+      releaseData(bucket, *header);
+      bucket->numEntries--;
+      evicted = true;
+    };
+
+    /* Evict at least one entry if the current number of entries is about to
+     * overflow. */
+    if (bucket->numEntries == kMaxEntries) {
+      XLOG(ERR) << "Overflow in number of entries in a bucket";
+      evictOneMoreEntryFn();
+    }
+    while (freeSpace(bucket) < requiredSpace) {
+      evictOneMoreEntryFn();
+    }
+    return evicted;
+  }
+
+  /**
+   * Move the values to the end of the bucket, in decreasing offset order so
+   * that no value overwrites one that is yet to be moved, and clear the
+   * holes.
+   *
+   * @param bucket Bucket to be compacted.
+   */
+  static void compact(Bucket* bucket) {
+    /* Sort the headers by offset, packed with their position in integers
+     * for cheap compares. */
+    static_assert(sizeof(EntryNum) == 1);
+    std::array<uint32_t, kMaxEntries> order;
+    for (unsigned int i = 0; i < bucket->numEntries; i++) {
+      order[i] = (uint32_t{getEntryHeader(bucket, i)->dataOffset} << 8) | i;
+    }
+    std::sort(order.begin(),
+              order.begin() + bucket->numEntries,
+              std::greater<uint32_t>());
+
+    size_t dst = kBucketDataSize;
+    for (unsigned int i = 0; i < bucket->numEntries; i++) {
+      EntryHdr* header = getEntryHeader(bucket, order[i] & 0xff);
+      if (header->dataSize == 0) {
+        XDCHECK_EQ(header->dataOffset, kEmptyDataOffset);
+        continue;
+      }
+      dst -= header->dataSize;
+      XDCHECK_GE(dst, header->dataOffset);
+      if (dst != header->dataOffset) {
+        memmove(bucket->data + dst,
+                bucket->data + header->dataOffset,
+                header->dataSize);
+        header->dataOffset = dst;
+      }
+    }
+    bucket->totalDataSize = kBucketDataSize - dst;
+    bucket->holeSize = 0;
+  }
+
+  /* Utility functions */
+
+  /**
+   * Release the value of an entry: the data section shrinks if the value is
+   * the first one, the value becomes a hole otherwise.
+   */
+  static void releaseData(Bucket* bucket, const EntryHdr& header) {
+    if (header.dataSize == 0) {
+      return;
+    }
+    if (header.dataOffset == getFirstEntryDataOffset(bucket)) {
+      bucket->totalDataSize -= header.dataSize;
+    } else {
+      bucket->holeSize += header.dataSize;
+    }
+  }
+
+  /** Free space between the slot directory and the data section. */
+  static size_t contiguousFreeSpace(const Bucket* bucket) {
+    return kBucketDataSize - bucket->totalDataSize -
+           sizeof(EntryHdr) * bucket->numEntries;
+  }
+
+  /** Free space in the bucket, holes included. */
+  static size_t freeSpace(const Bucket* bucket) {
+    return contiguousFreeSpace(bucket) + bucket->holeSize;
+  }
+
+  /**
+   * Get the offset where the "Data" section of the given bucket starts.
+   */
+  constexpr static size_t getFirstEntryDataOffset(const Bucket* bucket) {
+    return kBucketDataSize - bucket->totalDataSize;
+  }
+
+  /**
+   * Return a pointer to the EntryHdr header at position headerPos.
+   *
+   * @param bucket    Bucket from which to retrieve the EntryHdr header.
+   * @param headerPos Position of the entry header.
+   * @return Pointer to the EntryHdr header at position headerPos.
+   */
+  constexpr static EntryHdr* getEntryHeader(Bucket* bucket, uint8_t headerPos) {
+    return reinterpret_cast<EntryHdr*>(bucket->data) + headerPos;
+  }
+
+  /**
+   * Check that the given value will not overflow if written to an integral of
+   * type T.
+   */
+  template <typename T>
+  static void checkOverflow(size_t val) {
+    XDCHECK_LE(val, std::numeric_limits<T>::max());
+  }
+};
+
+template <typename CompactCacheDescriptor>
+constexpr size_t VariableSlotLruBucket<CompactCacheDescriptor>::kBucketDataSize;
+
+template <typename CompactCacheDescriptor>
+constexpr size_t VariableSlotLruBucket<CompactCacheDescriptor>::kMaxValueSize;
+} // namespace cachelib
+} // namespace facebook
@@ -16,10 +16,12 @@
 
 #pragma once
 
+#include <folly/Format.h>
 #include <folly/logging/xlog.h>
 
 #include <atomic>
 
+#include "cachelib/allocator/CacheStats.h"
 #include "cachelib/allocator/serialize/gen-cpp2/objects_types.h"
 
 namespace facebook {
@@ -35,21 +37,30 @@ namespace cachelib {
 // When compact cache allocator is restored from warmroll, we restore the info
 // about size of key and value.
 //
-// When compact cache is attaching to the allocator, we make sure size of key
-// and value are the same
+// When compact cache is attaching to the allocator, we make sure size of key,
+// value and bucket, and the version of the bucket layout are the same, so that
+// the restored chunks are read with the layout they were written with
 class CCacheMetadata {
  public:
   using SerializationType = serialization::CompactCacheMetadataObject;
 
+  // Version of the layout of the buckets in the chunks. Bump it when the
+  // layout changes in a way the sizes of key, value and bucket don't show.
+  static constexpr int32_t kLayoutVersion = 1;
+
   CCacheMetadata() : keySize_(0), valueSize_(0) {}
 
   CCacheMetadata(const SerializationType& object)
-      : keySize_(*object.keySize()), valueSize_(*object.valueSize()) {}
+      : keySize_(*object.keySize()),
+        valueSize_(*object.valueSize()),
+        bucketSize_(*object.bucketSize()),
+        layoutVersion_(*object.layoutVersion()) {}
 
   template <typename CCacheT>
   void initializeOrVerify() {
     const size_t keySize = sizeof(typename CCacheT::Key);
     const size_t valueSize = CCacheT::ValueDescriptor::getSize();
+    const size_t bucketSize = sizeof(typename CCacheT::Bucket);
     if (keySize_ != 0) {
       if (keySize_ != keySize) {
         throw std::invalid_argument("size of key mismatch");
@@ -57,22 +68,36 @@ class CCacheMetadata {
       if (valueSize_ != valueSize) {
         throw std::invalid_argument("size of value mismatch");
       }
-    } else {
-      keySize_ = keySize;
-      valueSize_ = valueSize;
+      // states saved before the layout was recorded can't be checked
+      if (layoutVersion_ != 0 && layoutVersion_ != kLayoutVersion) {
+        throw std::invalid_argument(
+            folly::sformat("compact cache layout version mismatch: {} vs {}",
+                           layoutVersion_, kLayoutVersion));
+      }
+      if (bucketSize_ != 0 && bucketSize_ != bucketSize) {
+        throw std::invalid_argument("size of bucket mismatch");
+      }
     }
+    keySize_ = keySize;
+    valueSize_ = valueSize;
+    bucketSize_ = bucketSize;
+    layoutVersion_ = kLayoutVersion;
   }
 
   SerializationType saveState() {
     SerializationType object;
     *object.keySize() = keySize_;
     *object.valueSize() = valueSize_;
+    *object.bucketSize() = bucketSize_;
+    *object.layoutVersion() = layoutVersion_;
     return object;
   }
 
  private:
   size_t keySize_;
   size_t valueSize_;
+  size_t bucketSize_{0};
+  int32_t layoutVersion_{0};
 };
 
 // This is the base call for all of the compact cache allocators in order to
@@ -103,6 +128,10 @@ class CCacheAllocatorBase {
       throw std::logic_error("Current allocator is already attached");
     }
     compactCacheResizeFn_ = [ccache]() { ccache->resize(); };
+    compactCacheResizeStatsFn_ = [ccache]() {
+      return ccache->getResizeStats();
+    };
+    compactCacheFinishResizeFn_ = [ccache]() { ccache->finishResize(); };
   }
 
   // Detaching the allocator. Only after detach, can another compact cache
@@ -113,6 +142,8 @@ class CCacheAllocatorBase {
       throw std::logic_error("Current allocator is already detached");
     }
     compactCacheResizeFn_ = nullptr;
+    compactCacheResizeStatsFn_ = nullptr;
+    compactCacheFinishResizeFn_ = nullptr;
   }
 
   bool isAttached() const { return compactCacheResizeFn_ ? true : false; }
@@ -132,6 +163,12 @@ class CCacheAllocatorBase {
     }
   }
 
+  // Resize progress of the attached compact cache, empty if not attached
+  CCacheResizeStats getCompactCacheResizeStats() {
+    std::lock_guard<std::mutex> lock(resizeLock_);
+    return isAttached() ? compactCacheResizeStatsFn_() : CCacheResizeStats{};
+  }
+
   // resize the allocator to configured size
   virtual size_t resize() = 0;
 
@@ -143,8 +180,18 @@ class CCacheAllocatorBase {
   // This also serves as an indicator that the allocator is attached to a
   // compact cache
   std::function<void()> compactCacheResizeFn_;
+  std::function<CCacheResizeStats()> compactCacheResizeStatsFn_;
+  std::function<void()> compactCacheFinishResizeFn_;
 
  protected:
+  // Complete the incremental resize of the attached compact cache, if any, so
+  // that its chunks hold a single layout. Must hold resizeLock_.
+  void finishCompactCacheResizeLocked() {
+    if (compactCacheFinishResizeFn_) {
+      compactCacheFinishResizeFn_();
+    }
+  }
+
   std::mutex resizeLock_;
 
   // meta data of attached compact cache
@@ -73,6 +73,11 @@ class TestAllocator : public CCacheAllocatorBase {
 
   size_t getConfiguredSize() const { return configuredSize_; }
 
+  // takes effect on the next resize
+  void setConfiguredSize(size_t configuredSize) {
+    configuredSize_ = configuredSize;
+  }
+
   void* getChunk(size_t chunkNum) { return slabs_[chunkNum]; }
 
   size_t getNumChunks() const noexcept { return slabs_.size(); }
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "cachelib/compact_cache/CCacheCreator.h"
+#include "cachelib/compact_cache/CCacheNvmSpill.h"
+#include "cachelib/compact_cache/allocators/TestAllocator.h"
+
+namespace facebook {
+namespace cachelib {
+namespace tests {
+namespace {
+struct CACHELIB_PACKED_ATTR Int {
+  int value;
+  /* implicit */ Int(int v = 0) : value(v) {}
+  bool operator==(const Int& other) const { return value == other.value; }
+  bool operator!=(const Int& other) const { return value != other.value; }
+  bool isEmpty() const { return value == 0; }
+};
+
+// Engine keeping the items in a map
+class MapEngine final : public navy::Engine {
+ public:
+  uint64_t getSize() const override { return 1024 * 1024; }
+  bool couldExist(HashedKey hk) override {
+    return items_.count(hk.key().str()) > 0;
+  }
+  uint64_t estimateWriteSize(HashedKey hk,
+                             navy::BufferView value) const override {
+    return hk.key().size() + value.size();
+  }
+  navy::Status insert(HashedKey hk, navy::BufferView value) override {
+    items_[hk.key().str()] = navy::Buffer{value};
+    return navy::Status::Ok;
+  }
+  navy::Status lookup(HashedKey hk, navy::Buffer& value) override {
+    auto it = items_.find(hk.key().str());
+    if (it == items_.end()) {
+      return navy::Status::NotFound;
+    }
+    value = it->second.copy();
+    return navy::Status::Ok;
+  }
+  navy::Status remove(HashedKey hk) override {
+    return items_.erase(hk.key().str()) > 0 ? navy::Status::Ok
+                                            : navy::Status::NotFound;
+  }
+  void flush() override {}
+  void reset() override { items_.clear(); }
+  void persist(navy::RecordWriter&) override {}
+  bool recover(navy::RecordReader&) override { return true; }
+  void getCounters(const navy::CounterVisitor&) const override {}
+  uint64_t getMaxItemSize() const override { return UINT32_MAX; }
+  std::pair<navy::Status, std::string> getRandomAlloc(
+      navy::Buffer&) override {
+    return std::make_pair(navy::Status::NotFound, "");
+  }
+
+  size_t numItems() const { return items_.size(); }
+
+ private:
+  std::map<std::string, navy::Buffer> items_;
+};
+} // namespace
+
+TEST(CCacheNvmSpill, SpillAndFaultIn) {
+  using CC = CCacheCreator<TestAllocator, Int, Int>::type;
+  constexpr size_t kChunkSize = 64 * 1024;
+  TestAllocator allocator(kChunkSize, kChunkSize);
+  MapEngine engine;
+  CCacheNvmSpill<CC> spill(engine);
+
+  int evictions = 0;
+  CC ccache(allocator,
+            spill.wrapRemoveCb([&evictions](const Int&, const Int*,
+                                            const RemoveContext context) {
+              if (context == RemoveContext::kEviction) {
+                evictions++;
+              }
+            }));
+  spill.attach(ccache);
+
+  // more keys than the compact cache holds
+  constexpr int kNumKeys = 20000;
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int value(i * 2);
+    ASSERT_NE(CCacheReturn::ERROR, spill.set(i, &value));
+  }
+  ASSERT_GT(evictions, 0);
+  auto stats = spill.getStats();
+  EXPECT_EQ(evictions, stats.spills);
+  EXPECT_EQ(0, stats.spillErrors);
+  EXPECT_EQ(evictions, engine.numItems());
+
+  // every key is found, from either tier
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int out;
+    ASSERT_EQ(CCacheReturn::FOUND, spill.get(i, &out));
+    ASSERT_EQ(Int(i * 2), out);
+  }
+  stats = spill.getStats();
+  EXPECT_GT(stats.faultIns, 0);
+  EXPECT_EQ(0, stats.spillErrors);
+
+  // a set drops the stale copy in the engine
+  int spilled = 0;
+  for (int i = 1; i <= kNumKeys && spilled == 0; i++) {
+    Int out;
+    if (ccache.get(i, &out, nullptr, false) == CCacheReturn::NOTFOUND) {
+      spilled = i;
+    }
+  }
+  ASSERT_NE(0, spilled);
+  Int value(-1);
+  spill.set(spilled, &value);
+  Int out;
+  ASSERT_EQ(CCacheReturn::FOUND, spill.get(spilled, &out));
+  EXPECT_EQ(Int(-1), out);
+
+  // a delete removes the key from both tiers
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_EQ(CCacheReturn::FOUND, spill.del(i));
+  }
+  EXPECT_EQ(0, engine.numItems());
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_EQ(CCacheReturn::NOTFOUND, spill.get(i));
+  }
+}
+
+TEST(CCacheNvmSpill, ResizeSpills) {
+  using CC = CCacheCreator<TestAllocator, Int, Int>::type;
+  constexpr size_t kChunkSize = 64 * 1024;
+  TestAllocator allocator(4 * kChunkSize, kChunkSize);
+  MapEngine engine;
+  CCacheNvmSpill<CC> spill(engine);
+  CC ccache(allocator, spill.wrapRemoveCb());
+  spill.attach(ccache);
+
+  constexpr int kNumKeys = 20000;
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int value(i);
+    ASSERT_NE(CCacheReturn::ERROR, spill.set(i, &value));
+  }
+  const auto spillsBefore = spill.getStats().spills;
+
+  // the entries that do not fit after the shrink are kept by the engine
+  allocator.setConfiguredSize(kChunkSize);
+  ccache.resize();
+  EXPECT_GT(spill.getStats().spills, spillsBefore);
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int out;
+    ASSERT_EQ(CCacheReturn::FOUND, spill.get(i, &out));
+    ASSERT_EQ(Int(i), out);
+  }
+}
+
+} // namespace tests
+} // namespace cachelib
+} // namespace facebook
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  return RUN_ALL_TESTS();
+}
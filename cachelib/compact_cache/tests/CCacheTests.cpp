@@ -19,6 +19,12 @@
 #include <folly/init/Init.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/common/TestUtils.h"
 #include "cachelib/compact_cache/allocators/TestAllocator.h"
@@ -50,6 +56,20 @@ struct CACHELIB_PACKED_ATTR Buffer {
   bool isEmpty() const { return *this == Buffer(); }
 };
 
+/* Key matched by the buckets with wide compares */
+struct CACHELIB_PACKED_ATTR Int64 {
+  int64_t value;
+  /* implicit */ Int64(int v = 0) : value(v) {}
+  bool operator==(const Int64& other) const { return value == other.value; }
+  bool operator!=(const Int64& other) const { return value != other.value; }
+  bool isEmpty() const { return value == 0; }
+};
+} // namespace tests
+
+template <>
+struct BitwiseComparableKey<tests::Int64> : std::true_type {};
+
+namespace tests {
 template <typename T>
 class CompactCacheTests : public ::testing::Test {
  public:
@@ -63,6 +83,16 @@ class CompactCacheTests : public ::testing::Test {
     CompactCacheRunBasicTests<CC>();
   }
 
+  void testWideKeyMatch() {
+    using CC = typename CCacheCreator<T, Int64, Int>::type;
+    static_assert(CC::BucketDescriptor::kWideKeyMatch);
+    CompactCacheRunBasicTests<CC>();
+
+    using EmptyCC = typename CCacheCreator<T, Int64>::type;
+    static_assert(EmptyCC::BucketDescriptor::kWideKeyMatch);
+    CompactCacheRunBasicTests<EmptyCC>();
+  }
+
   void testInt2Str() {
     using CC = typename CCacheCreator<T, Int, Buffer<51>>::type;
     CompactCacheRunBasicTests<CC>();
@@ -91,6 +121,8 @@ TYPED_TEST(CompactCacheTests, Int2Empty) { this->testInt2Empty(); }
 
 TYPED_TEST(CompactCacheTests, Int2Int) { this->testInt2Int(); }
 
+TYPED_TEST(CompactCacheTests, WideKeyMatch) { this->testWideKeyMatch(); }
+
 TYPED_TEST(CompactCacheTests, Int2Str) { this->testInt2Str(); }
 
 TYPED_TEST(CompactCacheTests, Str2Empty) { this->testStr2Empty(); }
@@ -99,6 +131,429 @@ TYPED_TEST(CompactCacheTests, Str2Int) { this->testStr2Int(); }
 
 TYPED_TEST(CompactCacheTests, Str2Str) { this->testStr2Str(); }
 
+TEST(CompactCacheTests, OptimisticReads) {
+  using CC = CCacheCreator<TestAllocator, Int, Int>::type;
+  TestAllocator allocator(1024 * 1024, 64 * 1024);
+  // few lock stripes so that readers and the writer collide
+  CC ccache(allocator, true /* allowPromotions */, 2 /* lockHashPower */,
+            true /* optimisticReads */);
+
+  constexpr int kNumKeys = 1000;
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int value(i);
+    ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(i, &value));
+  }
+
+  // the writer flips every value between the key and its negation, so a
+  // reader seeing anything else read a torn bucket
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int round = 0; round < 50; round++) {
+      for (int i = 1; i <= kNumKeys; i++) {
+        Int value(round % 2 ? i : -i);
+        ccache.set(i, &value);
+      }
+    }
+    done = true;
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        for (int i = 1; i <= kNumKeys; i++) {
+          Int out;
+          if (ccache.get(i, &out) == CCacheReturn::FOUND) {
+            EXPECT_TRUE(out.value == i || out.value == -i);
+          }
+          ccache.exists(i);
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int out;
+    if (ccache.get(i, &out) == CCacheReturn::FOUND) {
+      EXPECT_EQ(i, out.value);
+    }
+  }
+}
+
+TEST(CompactCacheTests, MultiGetSet) {
+  using CC = CCacheCreator<TestAllocator, Int, Int>::type;
+  TestAllocator allocator(1024 * 1024, 64 * 1024);
+  CC ccache(allocator, true /* allowPromotions */, 2 /* lockHashPower */);
+
+  // key 3 is set twice, the last value wins
+  std::vector<Int> keys{1, 2, 3, 4, 3};
+  std::vector<Int> values{10, 20, 30, 40, 31};
+  std::vector<CCacheReturn> results(keys.size());
+  ccache.multiSet(folly::range(keys), folly::range(results),
+                  folly::range(values));
+  EXPECT_EQ((std::vector<CCacheReturn>{
+                CCacheReturn::NOTFOUND, CCacheReturn::NOTFOUND,
+                CCacheReturn::NOTFOUND, CCacheReturn::NOTFOUND,
+                CCacheReturn::FOUND}),
+            results);
+
+  std::vector<Int> getKeys{4, 5, 3, 1};
+  std::vector<Int> out(getKeys.size());
+  results.resize(getKeys.size());
+  ccache.multiGet(folly::range(getKeys), folly::range(results),
+                  folly::range(out));
+  EXPECT_EQ((std::vector<CCacheReturn>{
+                CCacheReturn::FOUND, CCacheReturn::NOTFOUND,
+                CCacheReturn::FOUND, CCacheReturn::FOUND}),
+            results);
+  EXPECT_EQ(Int(40), out[0]);
+  EXPECT_EQ(Int(31), out[2]);
+  EXPECT_EQ(Int(10), out[3]);
+
+  // without values, only the results are filled
+  ccache.multiGet(folly::range(getKeys), folly::range(results));
+  EXPECT_EQ(CCacheReturn::FOUND, results[0]);
+  EXPECT_EQ(CCacheReturn::NOTFOUND, results[1]);
+
+  // a missing value is an error
+  results.resize(1);
+  ccache.multiSet(folly::range(keys).subpiece(0, 1), folly::range(results));
+  EXPECT_EQ(CCacheReturn::ERROR, results[0]);
+
+  const auto stats = ccache.getStats();
+  EXPECT_EQ(8, stats.get);
+  EXPECT_EQ(6, stats.getHit);
+  EXPECT_EQ(6, stats.set);
+  EXPECT_EQ(1, stats.setErr);
+}
+
+TEST(CompactCacheTests, IncrementalResize) {
+  using CC = CCacheCreator<TestAllocator, Int, Int>::type;
+  constexpr size_t kChunkSize = 64 * 1024;
+  TestAllocator allocator(4 * kChunkSize, kChunkSize);
+  CC ccache(allocator);
+  ccache.setResizeStep(1);
+
+  constexpr int kNumKeys = 1000;
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int value(i);
+    ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(i, &value));
+  }
+
+  // one old chunk rehashed per call, copying and then deleting
+  allocator.setConfiguredSize(8 * kChunkSize);
+  ccache.resize();
+  auto stats = ccache.getResizeStats();
+  EXPECT_TRUE(stats.inProgress);
+  EXPECT_EQ(1, stats.chunksRehashed);
+  EXPECT_EQ(8, stats.chunksToRehash);
+
+  // requests keep working during the migration
+  Int value(kNumKeys + 1);
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.set(kNumKeys + 1, &value));
+  for (int i = 1; i <= kNumKeys + 1; i++) {
+    Int out;
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.get(i, &out));
+    ASSERT_EQ(Int(i), out);
+  }
+
+  int calls = 1;
+  while (ccache.getResizeStats().inProgress) {
+    ccache.resize();
+    calls++;
+  }
+  EXPECT_EQ(8, calls);
+  EXPECT_EQ(8 * kChunkSize, ccache.getSize());
+  EXPECT_EQ(1, ccache.getResizeStats().resizesCompleted);
+  for (int i = 1; i <= kNumKeys + 1; i++) {
+    Int out;
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.get(i, &out));
+    ASSERT_EQ(Int(i), out);
+  }
+
+  // without a step a resize completes in one call
+  ccache.setResizeStep(0);
+  allocator.setConfiguredSize(2 * kChunkSize);
+  ccache.resize();
+  stats = ccache.getResizeStats();
+  EXPECT_FALSE(stats.inProgress);
+  EXPECT_EQ(2, stats.resizesCompleted);
+  EXPECT_EQ(2 * kChunkSize, ccache.getSize());
+}
+
+TEST(CompactCacheTests, Expiry) {
+  using CC = CCacheTtlCreator<TestAllocator, Int, Int>::type;
+  constexpr size_t kChunkSize = 64 * 1024;
+  const uint32_t now = util::getCurrentTimeSec();
+
+  TestAllocator allocator(kChunkSize, kChunkSize);
+  int evictions = 0;
+  auto removeCb = [&evictions](const Int&, const Int*, RemoveContext c) {
+    if (c == RemoveContext::kEviction) {
+      evictions++;
+    }
+  };
+  CC ccache(allocator, removeCb, nullptr, nullptr);
+
+  Int value(7);
+  Int out;
+  ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(1, &value, 0, now - 10));
+  ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(2, &value, 0, now + 3600));
+  ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(3, &value));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.get(1, &out));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.exists(1));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.del(1));
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.get(2, &out));
+  EXPECT_EQ(value, out);
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.get(3, &out));
+
+  // updating an entry also updates its expiry time
+  ASSERT_EQ(CCacheReturn::FOUND, ccache.set(2, &value, 0, now - 10));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.get(2, &out));
+  ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(2, &value));
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.get(2, &out));
+
+  // expired entries are reused as free slots: filling the cache with fresh
+  // entries evicts as many entries as it does in an empty cache
+  TestAllocator emptyAllocator(kChunkSize, kChunkSize);
+  int emptyEvictions = 0;
+  CC emptyCCache(
+      emptyAllocator,
+      [&emptyEvictions](const Int&, const Int*, RemoveContext c) {
+        if (c == RemoveContext::kEviction) {
+          emptyEvictions++;
+        }
+      },
+      nullptr, nullptr);
+  ccache.del(2);
+  ccache.del(3);
+  constexpr int kNumKeys = 4000;
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_NE(CCacheReturn::ERROR, ccache.set(kNumKeys + i, &value, 0, now));
+  }
+  // wait for those entries to expire
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  evictions = 0;
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_NE(CCacheReturn::ERROR, ccache.set(i, &value, 0, now + 3600));
+    ASSERT_NE(CCacheReturn::ERROR, emptyCCache.set(i, &value));
+  }
+  EXPECT_EQ(emptyEvictions, evictions);
+
+  // caches without expiry support reject an expiry time
+  using PlainCC = CCacheCreator<TestAllocator, Int, Int>::type;
+  TestAllocator plainAllocator(kChunkSize, kChunkSize);
+  PlainCC plainCCache(plainAllocator);
+  EXPECT_EQ(CCacheReturn::ERROR, plainCCache.set(1, &value, 0, now + 3600));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, plainCCache.set(1, &value));
+}
+
+TEST(CompactCacheTests, Add) {
+  using CC = CCacheCreator<TestAllocator, Int, int64_t>::type;
+  constexpr size_t kChunkSize = 64 * 1024;
+  TestAllocator allocator(4 * kChunkSize, kChunkSize);
+  int removed = 0;
+  CC ccache(
+      allocator,
+      [&removed](const Int&, const int64_t*, RemoveContext c) {
+        if (c == RemoveContext::kNormal) {
+          removed++;
+        }
+      },
+      nullptr, nullptr);
+
+  int64_t newVal = 0;
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.add(1, 5, &newVal));
+  EXPECT_EQ(5, newVal);
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.add(1, 3, &newVal));
+  EXPECT_EQ(8, newVal);
+  int64_t out = 0;
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.get(1, &out));
+  EXPECT_EQ(8, out);
+
+  // a counter that becomes zero is removed
+  EXPECT_EQ(CCacheReturn::FOUND, ccache.add(1, -8, &newVal));
+  EXPECT_EQ(0, newVal);
+  EXPECT_EQ(1, removed);
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.get(1, &out));
+  // adding zero to a missing key does not insert it
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.add(1, 0));
+  EXPECT_EQ(CCacheReturn::NOTFOUND, ccache.get(1, &out));
+
+  // concurrent adds to the same keys are not lost
+  constexpr int kNumKeys = 64;
+  constexpr int kNumThreads = 4;
+  constexpr int kAddsPerThread = 6400;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&ccache] {
+      for (int i = 0; i < kAddsPerThread; i++) {
+        ASSERT_NE(CCacheReturn::ERROR, ccache.add(i % kNumKeys + 1, 1));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  constexpr int64_t kExpected = kNumThreads * kAddsPerThread / kNumKeys;
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.get(i, &out));
+    ASSERT_EQ(kExpected, out);
+  }
+
+  // adds during an incremental resize reach the new layout
+  ccache.setResizeStep(1);
+  allocator.setConfiguredSize(8 * kChunkSize);
+  int rounds = 0;
+  while (ccache.getResizeStats().resizesCompleted == 0) {
+    ccache.resize();
+    rounds++;
+    for (int i = 1; i <= kNumKeys; i++) {
+      ASSERT_EQ(CCacheReturn::FOUND, ccache.add(i, 1));
+    }
+  }
+  for (int i = 1; i <= kNumKeys; i++) {
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.get(i, &out));
+    ASSERT_EQ(kExpected + rounds, out);
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.add(i, -out, &newVal));
+    EXPECT_EQ(0, newVal);
+  }
+  EXPECT_EQ(1 + kNumKeys, removed);
+}
+
+TEST(CompactCacheTests, VariableSlotBucket) {
+  using Descriptor =
+      CompactCacheDescriptor<Int, VariableSizedValueDescriptor<64>>;
+  using BucketDesc = VariableSlotLruBucket<Descriptor>;
+  using Value = BucketDesc::Value;
+  constexpr size_t kEntrySize = 8;
+  // room for exactly this many entries of kEntrySize bytes
+  constexpr size_t kNumEntries =
+      BucketDesc::kBucketDataSize /
+      (kEntrySize + sizeof(BucketDesc::EntryHdr));
+
+  BucketDesc::Bucket bucket{};
+  std::vector<int> evicted;
+  auto evictionCb = [&evicted](const BucketDesc::EntryHandle& handle) {
+    evicted.push_back(handle.key().value);
+  };
+  auto valueOf = [](int key, size_t size) {
+    return std::string(size, static_cast<char>('a' + key));
+  };
+  auto find = [&bucket](int key) {
+    auto handle = BucketDesc::first(&bucket);
+    while (handle && handle.key() != Int(key)) {
+      handle.next();
+    }
+    return handle;
+  };
+  auto readValue = [&find](int key) {
+    auto handle = find(key);
+    return handle ? std::string(reinterpret_cast<const char*>(handle.val()),
+                                handle.size())
+                  : std::string();
+  };
+
+  for (size_t i = 1; i <= kNumEntries; i++) {
+    const auto value = valueOf(i, kEntrySize);
+    ASSERT_EQ(0,
+              BucketDesc::insert(&bucket, i,
+                                 reinterpret_cast<const Value*>(value.data()),
+                                 value.size(), evictionCb));
+  }
+
+  // deleting and shrinking entries leaves holes, the values stay in place
+  auto handle = find(2);
+  const auto* keptAt = reinterpret_cast<const char*>(find(3).val());
+  BucketDesc::del(handle);
+  handle = find(4);
+  const auto shorter = valueOf(4, kEntrySize / 2);
+  BucketDesc::updateVal(handle, reinterpret_cast<const Value*>(shorter.data()),
+                        shorter.size(), evictionCb);
+  EXPECT_EQ(keptAt, reinterpret_cast<const char*>(find(3).val()));
+  EXPECT_EQ(kEntrySize + kEntrySize / 2, bucket.holeSize);
+  EXPECT_EQ(shorter, readValue(4));
+  EXPECT_EQ(Int(4), BucketDesc::first(&bucket).key());
+
+  // the holes make room for the entry without evicting, but the bucket has
+  // to be compacted for it
+  const auto value = valueOf(42, 2 * kEntrySize);
+  EXPECT_EQ(0,
+            BucketDesc::insert(&bucket, 42,
+                               reinterpret_cast<const Value*>(value.data()),
+                               value.size(), evictionCb));
+  EXPECT_TRUE(evicted.empty());
+  EXPECT_EQ(0, bucket.holeSize);
+  for (size_t i = 1; i <= kNumEntries; i++) {
+    if (i == 2 || i == 4) {
+      continue;
+    }
+    EXPECT_EQ(valueOf(i, kEntrySize), readValue(i));
+  }
+  EXPECT_EQ(shorter, readValue(4));
+  EXPECT_EQ(value, readValue(42));
+
+  // growing an entry evicts from the LRU, here the entry of key 1
+  handle = find(3);
+  const auto longer = valueOf(3, 2 * kEntrySize);
+  BucketDesc::updateVal(handle, reinterpret_cast<const Value*>(longer.data()),
+                        longer.size(), evictionCb);
+  EXPECT_EQ(std::vector<int>{1}, evicted);
+  EXPECT_EQ(longer, readValue(3));
+  EXPECT_EQ(Int(3), BucketDesc::first(&bucket).key());
+  EXPECT_FALSE(find(1));
+}
+
+TEST(CompactCacheTests, VariableSlotBucketCache) {
+  using CC = CCacheVariableCreator<TestAllocator, Int, 64,
+                                   VariableSlotLruBucket>::type;
+  static_assert(!CC::kValuesFixedSize);
+  TestAllocator allocator(64 * 1024, 16 * 1024);
+  CC ccache(allocator, true /* allowPromotions */);
+  ccache.resize();
+
+  // random updates of values of random sizes, checked against a map
+  std::unordered_map<int, std::string> expected;
+  char out[64];
+  for (int i = 0; i < 100000; i++) {
+    const int key = folly::Random::rand32(1, 4096);
+    const auto op = folly::Random::rand32(10);
+    if (op < 5) {
+      const std::string value(folly::Random::rand32(65),
+                              static_cast<char>(folly::Random::rand32(256)));
+      ASSERT_NE(CCacheReturn::ERROR,
+                ccache.set(key,
+                           reinterpret_cast<const CC::Value*>(value.data()),
+                           value.size()));
+      expected[key] = value;
+    } else if (op < 7) {
+      ASSERT_NE(CCacheReturn::ERROR, ccache.del(key));
+      expected.erase(key);
+    } else {
+      size_t size = 0;
+      const auto res =
+          ccache.get(key, reinterpret_cast<CC::Value*>(out), &size);
+      ASSERT_NE(CCacheReturn::ERROR, res);
+      if (res == CCacheReturn::FOUND) {
+        // entries can be evicted, never changed
+        ASSERT_EQ(1, expected.count(key));
+        ASSERT_EQ(expected[key], std::string(out, size));
+      }
+    }
+  }
+}
+
+TEST(CompactCacheTests, OptimisticReadsNeedFixedSize) {
+  using CC = CCacheVariableCreator<TestAllocator, Int, 16>::type;
+  TestAllocator allocator(1024 * 1024, 64 * 1024);
+  EXPECT_THROW(CC(allocator, true, CC::kDefaultLockHashPower, true),
+               std::invalid_argument);
+}
+
 template <typename T>
 class CompactCacheAllocatorTests : public ::testing::Test {};
 
@@ -318,6 +773,74 @@ TYPED_TEST(CompactCacheAllocatorTests, resize) {
   }
 }
 
+TEST(CompactCacheWarmRollTests, LayoutMismatch) {
+  using CC = CCacheCreator<CCacheAllocator, Int, Int>::type;
+  // same key and value as CC but buckets that also store expiry times
+  using TtlCC = CCacheTtlCreator<CCacheAllocator, Int, Int>::type;
+  LruAllocator::Config config;
+  config.size = 2 * Slab::kSize;
+  config.enableCompactCache();
+  config.cacheDir = "/tmp/ccache_layout_mismatch_" +
+                    folly::to<std::string>(folly::Random::rand32());
+
+  Int value(42);
+  {
+    LruAllocator cacheAllocator(LruAllocator::SharedMemNew, config);
+    auto& ccache = *cacheAllocator.addCompactCache<CC>("cc", Slab::kSize);
+    ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(1, &value));
+    cacheAllocator.shutDown();
+  }
+
+  LruAllocator cacheAllocator(LruAllocator::SharedMemAttach, config);
+  EXPECT_THROW(cacheAllocator.attachCompactCache<TtlCC>("cc"),
+               std::invalid_argument);
+  // the failed attach leaves the contents for the right type
+  auto& ccache = *cacheAllocator.attachCompactCache<CC>("cc");
+  Int out;
+  ASSERT_EQ(CCacheReturn::FOUND, ccache.get(1, &out));
+  EXPECT_EQ(value, out);
+  cacheAllocator.shutDown();
+}
+
+TEST(CompactCacheWarmRollTests, ResizeInProgress) {
+  using CC = CCacheCreator<CCacheAllocator, Int, Int>::type;
+  LruAllocator::Config config;
+  config.size = 8 * Slab::kSize;
+  config.enableCompactCache();
+  config.cacheDir = "/tmp/ccache_resize_in_progress_" +
+                    folly::to<std::string>(folly::Random::rand32());
+
+  constexpr int kNumKeys = 10000;
+  {
+    LruAllocator cacheAllocator(LruAllocator::SharedMemNew, config);
+    auto& ccache = *cacheAllocator.addCompactCache<CC>("cc", 2 * Slab::kSize);
+    for (int i = 1; i <= kNumKeys; i++) {
+      Int value(i);
+      ASSERT_EQ(CCacheReturn::NOTFOUND, ccache.set(i, &value));
+    }
+
+    // stop the growth half way through the copy of the entries
+    ccache.setResizeStep(1);
+    ASSERT_TRUE(cacheAllocator.growPool(cacheAllocator.getPoolId("cc"),
+                                        2 * Slab::kSize));
+    ccache.resize();
+    ASSERT_TRUE(ccache.getResizeStats().inProgress);
+    cacheAllocator.shutDown();
+  }
+
+  // the resize was completed before the chunks were saved
+  LruAllocator cacheAllocator(LruAllocator::SharedMemAttach, config);
+  auto& ccache = *cacheAllocator.attachCompactCache<CC>("cc");
+  EXPECT_EQ(4 * Slab::kSize, ccache.getSize());
+  EXPECT_FALSE(ccache.getResizeStats().inProgress);
+  for (int i = 1; i <= kNumKeys; i++) {
+    Int out;
+    ASSERT_EQ(CCacheReturn::FOUND, ccache.get(i, &out));
+    ASSERT_EQ(Int(i), out);
+  }
+  cacheAllocator.shutDown();
+}
+
 } // namespace tests
 } // namespace cachelib
 } // namespace facebook
@@ -23,6 +23,7 @@
 #include <functional>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "cachelib/navy/common/Buffer.h"
 #include "cachelib/navy/common/Hash.h"
@@ -87,6 +88,25 @@ class AbstractCache {
   // is user responsibility to make a copy if needed (capture in callback).
   virtual void lookupAsync(HashedKey key, LookupCallback cb) = 0;
 
+  // Same as above, but the lookup is dispatched and its device reads are
+  // queued after those of higher @priority. If @deadlineNs (steady clock, see
+  // util::getCurrentTimeNs) is not 0 and passes before the lookup starts, it
+  // is cancelled and @cb is invoked with Status::Rejected.
+  virtual void lookupAsync(HashedKey key,
+                           LookupCallback cb,
+                           RequestPriority priority,
+                           uint64_t deadlineNs) = 0;
+
+  // Asynchronously looks up a batch of values. @cbs[i] is invoked with the
+  // result of @keys[i] on a worker thread. The keys are looked up together,
+  // so their device reads can be submitted at once. Unlike @lookupAsync, the
+  // lookup is not ordered with other async requests for the same keys, so
+  // the caller must not have inserts or removes in flight for them.
+  //
+  // See @lookupAsync about @keys lifetime.
+  virtual void lookupBatchAsync(std::vector<HashedKey> keys,
+                                std::vector<LookupCallback> cbs) = 0;
+
   // Removes from the index, space reused after reclamation.
   // Returns: Ok, NotFound
   virtual Status remove(HashedKey key) = 0;
@@ -97,6 +117,17 @@ class AbstractCache {
   // See @lookupAsync about @key lifetime.
   virtual void removeAsync(HashedKey key, RemoveCallback cb) = 0;
 
+  // Asynchronously removes a batch of keys. @cbs[i] is invoked with the
+  // result of @keys[i] on a worker thread, and can be empty. The keys are
+  // removed together so that keys sharing an index bucket are removed with a
+  // single write. Unlike @removeAsync, the remove is not ordered with other
+  // async requests for the same keys, so the caller must not have inserts or
+  // lookups in flight for them.
+  //
+  // See @lookupAsync about @keys lifetime.
+  virtual void removeBatchAsync(std::vector<HashedKey> keys,
+                                std::vector<RemoveCallback> cbs) = 0;
+
   // Ensure all pending job have been completed
   virtual void drain() = 0;
 
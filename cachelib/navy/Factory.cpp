@@ -20,15 +20,22 @@
 #include <folly/Random.h>
 
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include "cachelib/navy/admission_policy/DynamicRandomAP.h"
 #include "cachelib/navy/admission_policy/RejectRandomAP.h"
 #include "cachelib/navy/bighash/BigHash.h"
 #include "cachelib/navy/block_cache/BlockCache.h"
 #include "cachelib/navy/block_cache/FifoPolicy.h"
+#include "cachelib/navy/block_cache/HitDensityPolicy.h"
 #include "cachelib/navy/block_cache/LruPolicy.h"
 #include "cachelib/navy/common/Device.h"
+#include "cachelib/navy/common/Utils.h"
 #include "cachelib/navy/driver/Driver.h"
+#include "cachelib/navy/engine/NoopEngine.h"
+#include "cachelib/navy/engine/SizeBandEngine.h"
+#include "cachelib/navy/kangaroo/Kangaroo.h"
 #include "cachelib/navy/serialization/RecordIO.h"
 
 /* O_DIRECT not available on Mac OS */
@@ -57,6 +64,10 @@ class BlockCacheProtoImpl final : public BlockCacheProto {
 
   void setChecksum(bool enable) override { config_.checksum = enable; }
 
+  void setLookupChecksumPct(uint32_t pct) override {
+    config_.lookupChecksumPct = pct;
+  }
+
   void setLruEvictionPolicy() override {
     if (!(config_.cacheSize > 0 && config_.regionSize > 0)) {
       throw std::logic_error("layout is not set");
@@ -75,6 +86,17 @@ class BlockCacheProtoImpl final : public BlockCacheProto {
     config_.evictionPolicy = std::make_unique<FifoPolicy>();
   }
 
+  void setHitDensityEvictionPolicy() override {
+    if (!(config_.cacheSize > 0 && config_.regionSize > 0)) {
+      throw std::logic_error("layout is not set");
+    }
+    auto numRegions = config_.getNumRegions();
+    if (config_.evictionPolicy) {
+      throw std::invalid_argument("There's already an eviction policy set");
+    }
+    config_.evictionPolicy = std::make_unique<HitDensityPolicy>(numRegions);
+  }
+
   void setSegmentedFifoEvictionPolicy(
       std::vector<unsigned int> segmentRatio) override {
     if (config_.evictionPolicy) {
@@ -95,6 +117,22 @@ class BlockCacheProtoImpl final : public BlockCacheProto {
     config_.cleanRegionThreads = cleanRegionThreads;
   }
 
+  void setMaxCleanRegionsPool(uint32_t maxCleanRegions) override {
+    config_.maxCleanRegionsPool = maxCleanRegions;
+  }
+
+  void setReadPageCacheSize(uint64_t size) override {
+    config_.readPageCacheSize = size;
+  }
+
+  void setFlushedRegionCacheSize(uint64_t size) override {
+    config_.flushedRegionCacheSize = size;
+  }
+
+  void setStreamSizeLimits(std::vector<uint32_t> limits) override {
+    config_.streamSizeLimits = std::move(limits);
+  }
+
   void setReinsertionConfig(
       const BlockCacheReinsertionConfig& reinsertionConfig) override {
     config_.reinsertionConfig = reinsertionConfig;
@@ -118,11 +156,41 @@ class BlockCacheProtoImpl final : public BlockCacheProto {
     config_.preciseRemove = preciseRemove;
   }
 
+  void setFixedSizeIndex(uint64_t maxNumItems) override {
+    config_.fixedSizeIndexItems = maxNumItems;
+  }
+
+  void setPackedEntryAlignSize(uint32_t alignSize) override {
+    config_.packedEntryAlignSize = alignSize;
+  }
+
+  void setPlacementByPriority(bool enable) override {
+    config_.placementByPriority = enable;
+  }
+
+  void setIndexCheckpoint(std::string file,
+                          std::chrono::seconds interval,
+                          bool lazyRecovery) override {
+    config_.indexCheckpointFile = std::move(file);
+    config_.indexCheckpointInterval = interval;
+    config_.lazyIndexRecovery = lazyRecovery;
+  }
+
+  void setIndexRecoveryThreads(uint32_t numThreads) override {
+    config_.indexRecoveryThreads = numThreads;
+  }
+
+  void setFlatIndexPersistence(bool enable) override {
+    config_.flatIndexPersistence = enable;
+  }
+
   std::unique_ptr<Engine> create(JobScheduler& scheduler,
                                  ExpiredCheck checkExpired,
+                                 ExpiryTimeGetter getExpiryTime,
                                  DestructorCallback cb) && {
     config_.scheduler = &scheduler;
     config_.checkExpired = std::move(checkExpired);
+    config_.getExpiryTime = std::move(getExpiryTime);
     config_.destructorCb = std::move(cb);
     config_.validate();
     return std::make_unique<BlockCache>(std::move(config_));
@@ -155,6 +223,40 @@ class BigHashProtoImpl final : public BigHashProto {
     hashTableBitSize_ = hashTableBitSize;
   }
 
+  void setBlockedBloomFilter(uint32_t numHashes,
+                             uint32_t filterBitSize) override {
+    bloomFilterEnabled_ = true;
+    blockedBloomFilter_ = true;
+    numHashes_ = numHashes;
+    hashTableBitSize_ = filterBitSize;
+  }
+
+  void setTwoChoiceHashing(bool twoChoiceHashing) override {
+    config_.twoChoiceHashing = twoChoiceHashing;
+  }
+
+  void setWriteBatching(uint32_t batchSize,
+                        uint64_t stagingMemorySize) override {
+    config_.writeBatchSize = batchSize;
+    config_.stagingMemorySize = stagingMemorySize;
+  }
+
+  void setBucketCacheSize(uint64_t size) override {
+    config_.bucketCacheSize = size;
+  }
+
+  void setRecoveryThreads(uint32_t numThreads) override {
+    config_.recoveryThreads = numThreads;
+  }
+
+  void setLog(uint64_t logSize,
+              uint32_t segmentSize,
+              uint32_t moveThreshold) override {
+    logSize_ = logSize;
+    segmentSize_ = segmentSize;
+    moveThreshold_ = moveThreshold;
+  }
+
   void setDevice(Device* device) { config_.device = device; }
 
   void setDestructorCb(DestructorCallback cb) {
@@ -163,19 +265,56 @@ class BigHashProtoImpl final : public BigHashProto {
 
   std::unique_ptr<Engine> create(ExpiredCheck checkExpired) && {
     config_.checkExpired = std::move(checkExpired);
+    Kangaroo::Config logConfig;
+    if (logSize_ > 0) {
+      if (config_.bucketSize == 0 || segmentSize_ == 0) {
+        throw std::invalid_argument{"invalid bucket or segment size"};
+      }
+      // BigHash keeps the buckets after the log
+      logConfig.logBaseOffset = config_.cacheBaseOffset;
+      logConfig.logSize = logSize_ / segmentSize_ * segmentSize_;
+      logConfig.segmentSize = segmentSize_;
+      logConfig.moveThreshold = moveThreshold_;
+      const uint64_t bigHashBase = powTwoAlign(
+          logConfig.logBaseOffset + logConfig.logSize, config_.bucketSize);
+      if (bigHashBase - config_.cacheBaseOffset >= config_.cacheSize) {
+        throw std::invalid_argument{folly::sformat(
+            "log size: {} leaves no space for bighash of size: {}",
+            logSize_,
+            config_.cacheSize)};
+      }
+      config_.cacheSize -= bigHashBase - config_.cacheBaseOffset;
+      config_.cacheBaseOffset = bigHashBase;
+    }
     if (bloomFilterEnabled_) {
       if (config_.bucketSize == 0) {
         throw std::invalid_argument{"invalid bucket size"};
       }
-      config_.bloomFilter = std::make_unique<BloomFilter>(
-          config_.numBuckets(), numHashes_, hashTableBitSize_);
+      if (blockedBloomFilter_) {
+        config_.bloomFilter =
+            std::make_unique<BloomFilter>(BloomFilter::makeBlockedBloomFilter(
+                config_.numBuckets(), numHashes_, hashTableBitSize_));
+      } else {
+        config_.bloomFilter = std::make_unique<BloomFilter>(
+            config_.numBuckets(), numHashes_, hashTableBitSize_);
+      }
+    }
+    if (logSize_ > 0) {
+      logConfig.device = config_.device;
+      logConfig.destructorCb = config_.destructorCb;
+      logConfig.bigHash = std::move(config_);
+      return std::make_unique<Kangaroo>(std::move(logConfig));
     }
     return std::make_unique<BigHash>(std::move(config_));
   }
 
  private:
   BigHash::Config config_;
+  uint64_t logSize_{0};
+  uint32_t segmentSize_{0};
+  uint32_t moveThreshold_{1};
   bool bloomFilterEnabled_{false};
+  bool blockedBloomFilter_{false};
   uint32_t numHashes_{};
   uint32_t hashTableBitSize_{};
 };
@@ -187,6 +326,7 @@ class EnginePairProtoImpl final : public EnginePairProto {
   EnginePairProtoImpl(EnginePairProtoImpl&& proto) noexcept {
     bigHashProto_ = std::move(proto.bigHashProto_);
     blockCacheProto_ = std::move(proto.blockCacheProto_);
+    blockCacheBands_ = std::move(proto.blockCacheBands_);
     smallItemMaxSize_ = proto.smallItemMaxSize_;
   }
 
@@ -200,8 +340,14 @@ class EnginePairProtoImpl final : public EnginePairProto {
     blockCacheProto_ = std::move(proto);
   }
 
+  void addBlockCacheBand(std::unique_ptr<BlockCacheProto> proto,
+                         uint32_t maxItemSize) override {
+    blockCacheBands_.emplace_back(std::move(proto), maxItemSize);
+  }
+
   EnginePair create(Device* device,
                     ExpiredCheck checkExpired,
+                    ExpiryTimeGetter getExpiryTime,
                     DestructorCallback destructorCb,
                     JobScheduler& scheduler) {
     std::unique_ptr<Engine> bh;
@@ -220,10 +366,29 @@ class EnginePairProtoImpl final : public EnginePairProto {
       auto bcProto = dynamic_cast<BlockCacheProtoImpl*>(blockCacheProto_.get());
       if (bcProto != nullptr) {
         bcProto->setDevice(device);
-        bc = std::move(*bcProto).create(scheduler, checkExpired, destructorCb);
+        bc = std::move(*bcProto).create(scheduler, checkExpired,
+                                        getExpiryTime, destructorCb);
       }
     }
 
+    if (!blockCacheBands_.empty()) {
+      std::vector<SizeBandEngine::Band> bands;
+      for (auto& [proto, maxItemSize] : blockCacheBands_) {
+        auto bcProto = dynamic_cast<BlockCacheProtoImpl*>(proto.get());
+        if (bcProto != nullptr) {
+          bcProto->setDevice(device);
+          bands.push_back(
+              {maxItemSize,
+               std::move(*bcProto).create(scheduler, checkExpired,
+                                          getExpiryTime, destructorCb)});
+        }
+      }
+      // the main block cache takes the items above every band
+      bands.push_back({UINT32_MAX, bc ? std::move(bc)
+                                      : std::make_unique<NoopEngine>()});
+      bc = std::make_unique<SizeBandEngine>(std::move(bands));
+    }
+
     return EnginePair{std::move(bh), std::move(bc), smallItemMaxSize_,
                       &scheduler};
   }
@@ -231,6 +396,9 @@ class EnginePairProtoImpl final : public EnginePairProto {
  private:
   std::unique_ptr<BigHashProto> bigHashProto_;
   std::unique_ptr<BlockCacheProto> blockCacheProto_;
+  // in increasing max item size
+  std::vector<std::pair<std::unique_ptr<BlockCacheProto>, uint32_t>>
+      blockCacheBands_;
   uint32_t smallItemMaxSize_;
 };
 
@@ -251,6 +419,12 @@ class CacheProtoImpl final : public CacheProto {
     config_.useEstimatedWriteSize = useEstimatedWriteSize;
   }
 
+  void setSizeAdvisor(uint32_t sampleRate,
+                      uint32_t bigHashBucketSize) override {
+    config_.sizeAdvisorSampleRate = sampleRate;
+    config_.sizeAdvisorBigHashBucketSize = bigHashBucketSize;
+  }
+
   void setDevice(std::unique_ptr<Device> device) override {
     config_.device = std::move(device);
   }
@@ -261,6 +435,10 @@ class CacheProtoImpl final : public CacheProto {
     checkExpired_ = std::move(checkExpired);
   }
 
+  void setExpiryTimeGetter(ExpiryTimeGetter getExpiryTime) override {
+    getExpiryTime_ = std::move(getExpiryTime);
+  }
+
   void setDestructorCallback(DestructorCallback cb) override {
     destructorCb_ = std::move(cb);
   }
@@ -325,8 +503,8 @@ class CacheProtoImpl final : public CacheProto {
     for (auto& p : enginePairsProto_) {
       config_.enginePairs.push_back(
           dynamic_cast<EnginePairProtoImpl*>(p.get())->create(
-              config_.device.get(), checkExpired_, destructorCb_,
-              *config_.scheduler));
+              config_.device.get(), checkExpired_, getExpiryTime_,
+              destructorCb_, *config_.scheduler));
     }
 
     return std::make_unique<Driver>(std::move(config_));
@@ -334,6 +512,7 @@ class CacheProtoImpl final : public CacheProto {
 
  private:
   ExpiredCheck checkExpired_;
+  ExpiryTimeGetter getExpiryTime_;
   DestructorCallback destructorCb_;
   std::vector<std::unique_ptr<EnginePairProto>> enginePairsProto_;
   Driver::Config config_;
@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
@@ -48,8 +49,12 @@ class BlockCacheProto {
   // Enable data checksumming (default: disabled)
   virtual void setChecksum(bool enable) = 0;
 
+  // (Optional) Percent of the lookups reading from the device that verify
+  // the value checksum. Default: 100
+  virtual void setLookupChecksumPct(uint32_t pct) = 0;
+
   // set*EvictionPolicy function family: sets eviction policy. Supports LRU,
-  // LRU with deferred insert and FIFO. Must set up one of them.
+  // FIFO, segmented FIFO and hit density. Must set up one of them.
 
   // Sets LRU eviction policy.
   virtual void setLruEvictionPolicy() = 0;
@@ -57,6 +62,10 @@ class BlockCacheProto {
   // Sets FIFO eviction policy.
   virtual void setFifoEvictionPolicy() = 0;
 
+  // Sets hit density eviction policy: evicts the region with the fewest
+  // recent hits per byte among the oldest regions.
+  virtual void setHitDensityEvictionPolicy() = 0;
+
   // Sets SegmentedFIFO eviction policy.
   // @segmentRatio  ratio of the size of each segment.
   virtual void setSegmentedFifoEvictionPolicy(
@@ -71,6 +80,22 @@ class BlockCacheProto {
   virtual void setCleanRegionsPool(uint32_t cleanRegions,
                                    uint32_t cleanRegionThreads) = 0;
 
+  // (Optional) Lets the clean regions pool grow up to @maxCleanRegions with
+  // the write rate. Default: 0, the pool keeps its size
+  virtual void setMaxCleanRegionsPool(uint32_t maxCleanRegions) = 0;
+
+  // (Optional) Bytes of DRAM to cache recently read device pages in.
+  // Default: 0, disabled
+  virtual void setReadPageCacheSize(uint64_t size) = 0;
+
+  // (Optional) Bytes of DRAM to keep the buffers of recently flushed regions
+  // in. Default: 0, disabled
+  virtual void setFlushedRegionCacheSize(uint64_t size) = 0;
+
+  // (Optional) Ascending item size limits splitting writes into streams
+  // with their own regions. Default: empty, one stream
+  virtual void setStreamSizeLimits(std::vector<uint32_t> limits) = 0;
+
   // (Optional) Number of In memory buffers to maintain. Default: 0
   virtual void setNumInMemBuffers(uint32_t numInMemBuffers) = 0;
 
@@ -86,6 +111,32 @@ class BlockCacheProto {
 
   // (Optional) Set if the preciseRemove flag.
   virtual void setPreciseRemove(bool preciseRemove) = 0;
+
+  // (Optional) Index items with a FixedSizeIndex sized for @maxNumItems
+  // items instead of the default SparseMapIndex.
+  virtual void setFixedSizeIndex(uint64_t maxNumItems) = 0;
+
+  // (Optional) Pack the entries of a region at @alignSize bytes instead of
+  // the default alloc alignment. 0 to disable.
+  virtual void setPackedEntryAlignSize(uint32_t alignSize) = 0;
+
+  // (Optional) Write the regions of every priority with their own device
+  // placement handle.
+  virtual void setPlacementByPriority(bool enable) = 0;
+
+  // (Optional) Checkpoint the index to @file, every @interval and on
+  // persist, instead of persisting it with the rest of the metadata. With
+  // @lazyRecovery, the index is loaded in the background on recovery.
+  virtual void setIndexCheckpoint(std::string file,
+                                  std::chrono::seconds interval,
+                                  bool lazyRecovery) = 0;
+
+  // (Optional) Number of threads decoding the index on recovery.
+  virtual void setIndexRecoveryThreads(uint32_t numThreads) = 0;
+
+  // (Optional) Persist the index in the flat format instead of as thrift
+  // objects.
+  virtual void setFlatIndexPersistence(bool enable) = 0;
 };
 
 // BigHash engine proto. BigHash is used to cache small objects (under 2KB)
@@ -106,6 +157,37 @@ class BigHashProto {
   // bit array of @hashTableBitSize bits.
   virtual void setBloomFilter(uint32_t numHashes,
                               uint32_t hashTableBitSize) = 0;
+
+  // (Optional) Set up a blocked bloom filter per bucket of @filterBitSize
+  // bits with @numHashes bits per key, see
+  // BloomFilter::makeBlockedBloomFilter().
+  virtual void setBlockedBloomFilter(uint32_t numHashes,
+                                     uint32_t filterBitSize) = 0;
+
+  // (Optional) Place every item in the less full of two buckets.
+  virtual void setTwoChoiceHashing(bool twoChoiceHashing) = 0;
+
+  // (Optional) Stage up to @batchSize inserts per bucket in at most
+  // @stagingMemorySize bytes and write them to the bucket at once.
+  virtual void setWriteBatching(uint32_t batchSize,
+                                uint64_t stagingMemorySize) = 0;
+
+  // (Optional) Bytes of DRAM to cache recently read buckets in.
+  // Default: 0, disabled
+  virtual void setBucketCacheSize(uint64_t size) = 0;
+
+  // (Optional) Threads to rebuild the bloom filters with on recovery.
+  // Default: 4
+  virtual void setRecoveryThreads(uint32_t numThreads) = 0;
+
+  // (Optional) Put a log of @logSize bytes in front of BigHash, carved from
+  // the start of its layout, see Kangaroo. The log is written in segments of
+  // @segmentSize bytes. Items are moved to a bucket when at least
+  // @moveThreshold items of a segment map to it, other items are dropped.
+  // Default: no log
+  virtual void setLog(uint64_t logSize,
+                      uint32_t segmentSize,
+                      uint32_t moveThreshold) = 0;
 };
 
 class EnginePairProto {
@@ -119,6 +201,13 @@ class EnginePairProto {
   // Set up block cache engine.
   virtual void setBlockCache(std::unique_ptr<BlockCacheProto> proto) = 0;
 
+  // (Optional) Set up a block cache for the large items up to @maxItemSize
+  // bytes, see SizeBandEngine. Items too large for every band go to the block
+  // cache set with setBlockCache. Bands must be added in increasing
+  // @maxItemSize.
+  virtual void addBlockCacheBand(std::unique_ptr<BlockCacheProto> proto,
+                                 uint32_t maxItemSize) = 0;
+
   // Set up big hash engine.
   virtual void setBigHash(std::unique_ptr<BigHashProto> proto,
                           uint32_t smallItemMaxSize) = 0;
@@ -140,6 +229,11 @@ class CacheProto {
   // Set whether to use write size (instead of ) for admission policy.
   virtual void setUseEstimatedWriteSize(bool useEstimatedWriteSize) = 0;
 
+  // Sets the sample rate of the size advisor, 0 to disable it, and the
+  // bucket size of BigHash it models.
+  virtual void setSizeAdvisor(uint32_t sampleRate,
+                              uint32_t bigHashBucketSize) = 0;
+
   // Sets device that engine will use.
   virtual void setDevice(std::unique_ptr<Device> device) = 0;
 
@@ -156,6 +250,12 @@ class CacheProto {
   // Set callback used to if the passed NvmItem is expired
   virtual void setExpiredCheck(ExpiredCheck checkExpired) = 0;
 
+  // (Optional) Set callback used to get the expiry time of the passed NvmItem.
+  // BlockCache tracks the expiry range of every region with it and skips the
+  // per entry expiry checks when reclaiming a region all or none of whose
+  // entries expired.
+  virtual void setExpiryTimeGetter(ExpiryTimeGetter getExpiryTime) = 0;
+
   // (Optional) Set destructor callback.
   //   - Callback invoked exactly once for every insert, even if it was removed
   //     manually from the cache with @AbstractCache::remove.
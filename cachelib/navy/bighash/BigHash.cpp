@@ -19,9 +19,14 @@
 #include <folly/Format.h>
 #include <folly/Random.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <numeric>
+#include <thread>
 
 #include "cachelib/common/Hash.h"
+#include "cachelib/common/Tracepoints.h"
 #include "cachelib/navy/bighash/Bucket.h"
 #include "cachelib/navy/common/Hash.h"
 #include "cachelib/navy/common/Utils.h"
@@ -70,6 +75,20 @@ BigHash::Config& BigHash::Config::validate() {
                        bloomFilter->numFilters(),
                        numBuckets()));
   }
+
+  if (recoveryThreads == 0) {
+    throw std::invalid_argument("recovery threads cannot be 0");
+  }
+
+  if (writeBatchSize > 1) {
+    if (stagingMemorySize == 0) {
+      throw std::invalid_argument("write batching needs staging memory");
+    }
+    if (twoChoiceHashing) {
+      throw std::invalid_argument(
+          "write batching can't be combined with two choice hashing");
+    }
+  }
   return *this;
 }
 
@@ -87,14 +106,32 @@ BigHash::BigHash(Config&& config, ValidConfigTag)
       bucketSize_{config.bucketSize},
       cacheBaseOffset_{config.cacheBaseOffset},
       numBuckets_{config.numBuckets()},
+      twoChoiceHashing_{config.twoChoiceHashing},
+      writeBatchSize_{config.writeBatchSize},
+      stagingShardSize_{
+          std::max<uint64_t>(1, config.stagingMemorySize / kNumMutexes)},
+      recoveryThreads_{config.recoveryThreads},
       bloomFilter_{std::move(config.bloomFilter)},
       device_{*config.device},
       placementHandle_{device_.allocatePlacementHandle()} {
   XLOGF(INFO,
-        "BigHash created: buckets: {}, bucket size: {}, base offset: {}",
+        "BigHash created: buckets: {}, bucket size: {}, base offset: {}, "
+        "two choice hashing: {}",
         numBuckets_,
         bucketSize_,
-        cacheBaseOffset_);
+        cacheBaseOffset_,
+        twoChoiceHashing_);
+  if (writeBatchSize_ > 1) {
+    XLOGF(INFO,
+          "BigHash write batching: batch size: {}, staging memory: {}",
+          writeBatchSize_,
+          config.stagingMemorySize);
+    staging_ = std::make_unique<StagingShard[]>(kNumMutexes);
+  }
+  if (config.bucketCacheSize >= bucketSize_) {
+    bucketCache_ = std::make_unique<BucketCache>(
+        bucketSize_, config.bucketCacheSize / bucketSize_);
+  }
   reset();
 }
 
@@ -109,6 +146,17 @@ void BigHash::reset() {
   validBucketChecker_ = std::make_unique<ValidBucketChecker>(
       numBuckets_, kBigHashValidBucketCheckerBucketsPerBit);
 
+  if (staging_) {
+    for (size_t i = 0; i < kNumMutexes; i++) {
+      staging_[i].buckets.clear();
+      staging_[i].bytes = 0;
+    }
+  }
+  // cached buckets are of the previous generation
+  if (bucketCache_) {
+    bucketCache_->reset();
+  }
+
   itemCount_.set(0);
   insertCount_.set(0);
   succInsertCount_.set(0);
@@ -125,6 +173,8 @@ void BigHash::reset() {
   bfProbeCount_.set(0);
   checksumErrorCount_.set(0);
   usedSizeBytes_.set(0);
+  stagedItemCount_.set(0);
+  stagedWriteCount_.set(0);
 }
 
 double BigHash::bfFalsePositivePct() const {
@@ -137,7 +187,8 @@ double BigHash::bfFalsePositivePct() const {
 }
 
 uint64_t BigHash::getMaxItemSize() const {
-  auto itemOverhead = BucketStorage::slotSize(sizeof(details::BucketEntry));
+  auto itemOverhead = BucketStorage::slotSize(sizeof(details::BucketEntry)) +
+                      BucketStorage::tagSize(bucketSize_ - sizeof(Bucket));
   return bucketSize_ - sizeof(Bucket) - itemOverhead;
 }
 
@@ -218,12 +269,22 @@ void BigHash::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   visitor("navy_bh_disabled_buckets",
           validBucketChecker_->numDisabledBuckets());
+  if (bucketCache_) {
+    bucketCache_->getCounters(visitor);
+  }
+  if (staging_) {
+    visitor("navy_bh_staged_items", stagedItemCount_.get());
+    visitor("navy_bh_staged_bucket_writes",
+            stagedWriteCount_.get(),
+            CounterVisitor::CounterType::RATE);
+  }
   bucketExpirationsDist_x100_.visitQuantileEstimator(
       visitor, "navy_bh_expired_loop_x100");
 }
 
 void BigHash::persist(RecordWriter& rw) {
   XLOG(INFO, "Starting bighash persist");
+  writeAllStaged();
   serialization::BigHashPersistentData pd;
   *pd.version() = kFormatVersion;
   *pd.generationTime() = generationTime_.count();
@@ -233,6 +294,7 @@ void BigHash::persist(RecordWriter& rw) {
   *pd.numBuckets() = numBuckets_;
   *pd.usedSizeBytes() = usedSizeBytes_.get();
   *pd.validBucketCheckerState() = validBucketChecker_->persist();
+  *pd.twoChoiceHashing() = twoChoiceHashing_;
   serializeProto(pd, rw);
 
   if (bloomFilter_) {
@@ -243,10 +305,24 @@ void BigHash::persist(RecordWriter& rw) {
   XLOG(INFO, "Finished bighash persist");
 }
 
+FormatUpgrader<serialization::BigHashPersistentData>&
+BigHash::formatUpgrader() {
+  static auto* upgrader =
+      new FormatUpgrader<serialization::BigHashPersistentData>(kFormatVersion);
+  return *upgrader;
+}
+
 bool BigHash::recover(RecordReader& rr) {
   XLOG(INFO, "Starting bighash recovery");
   try {
     auto pd = deserializeProto<serialization::BigHashPersistentData>(rr);
+    const auto version = static_cast<uint64_t>(*pd.version());
+    if (version != kFormatVersion && formatUpgrader().canUpgrade(version)) {
+      formatUpgrader().upgrade(version, pd);
+      *pd.version() = kFormatVersion;
+      XLOGF(INFO, "Upgraded bighash format version {} to {}", version,
+            kFormatVersion);
+    }
     if (*pd.version() != kFormatVersion) {
       throw std::logic_error{
           folly::sformat("invalid format version {}, expected {}",
@@ -257,7 +333,8 @@ bool BigHash::recover(RecordReader& rr) {
     auto configEquals =
         static_cast<uint64_t>(*pd.bucketSize()) == bucketSize_ &&
         static_cast<uint64_t>(*pd.cacheBaseOffset()) == cacheBaseOffset_ &&
-        static_cast<uint64_t>(*pd.numBuckets()) == numBuckets_;
+        static_cast<uint64_t>(*pd.numBuckets()) == numBuckets_ &&
+        *pd.twoChoiceHashing() == twoChoiceHashing_;
     if (!configEquals) {
       auto configStr = serializeToJson(pd);
       XLOGF(ERR, "Recovery config: {}", configStr.c_str());
@@ -267,9 +344,17 @@ bool BigHash::recover(RecordReader& rr) {
     generationTime_ = std::chrono::nanoseconds{*pd.generationTime()};
     itemCount_.set(*pd.itemCount());
     usedSizeBytes_.set(*pd.usedSizeBytes());
+    // The buckets are still good when the bloom filters were resized or
+    // their layout changed, rebuild the filters from them instead of
+    // dropping the cache.
+    bool rebuildBf = false;
     if (bloomFilter_) {
-      bloomFilter_->recover<ProtoSerializer>(rr);
-      XLOG(INFO, "Recovered bloom filter");
+      if (bloomFilter_->tryRecover<ProtoSerializer>(rr)) {
+        XLOG(INFO, "Recovered bloom filter");
+      } else {
+        XLOG(INFO, "Persisted bloom filter does not match the config");
+        rebuildBf = true;
+      }
     }
 
     if (!validBucketChecker_->recover(*pd.validBucketCheckerState())) {
@@ -277,6 +362,10 @@ bool BigHash::recover(RecordReader& rr) {
     }
     XLOGF(INFO, "Recovered valid bucket checker. {} buckets diabled.",
           validBucketChecker_->numDisabledBuckets());
+
+    if (rebuildBf) {
+      rebuildBloomFilters();
+    }
   } catch (const std::exception& e) {
     XLOGF(ERR, "Exception: {}", e.what());
     XLOG(ERR, "Failed to recover bighash. Resetting cache.");
@@ -289,24 +378,32 @@ bool BigHash::recover(RecordReader& rr) {
 }
 
 Status BigHash::insert(HashedKey hk, BufferView value) {
-  const auto bid = getBucketId(hk);
+  auto bid = getBucketId(hk);
   insertCount_.inc();
 
   if (!validBucketChecker_->isBucketValid(bid.index())) {
     disabledBucketInsert_.inc();
     return Status::Rejected;
   }
+  if (staging_) {
+    return stageInsert(bid, hk, value);
+  }
+  auto altBid = getAltBucketId(hk);
+  if (!validBucketChecker_->isBucketValid(altBid.index())) {
+    altBid = bid;
+  }
 
   uint32_t removed{0};
   uint32_t evicted{0};
   uint32_t evictExpired{0};
 
-  uint32_t oldRemainingBytes = 0;
-  uint32_t newRemainingBytes = 0;
+  // summed over both buckets with two choice hashing
+  uint64_t oldRemainingBytes = 0;
+  uint64_t newRemainingBytes = 0;
 
   // we copy the items and trigger the destructorCb after bucket lock is
   // released to avoid possible heavy operations or locks in the destrcutor.
-  std::vector<std::tuple<Buffer, Buffer, DestructorEvent>> removedItems;
+  RemovedItems removedItems;
   DestructorCallback cb = [&removedItems](HashedKey key, BufferView val,
                                           DestructorEvent event) {
     // must make a copy for the key, o/w data might be deleted
@@ -314,19 +411,45 @@ Status BigHash::insert(HashedKey hk, BufferView value) {
   };
 
   {
-    std::unique_lock<SharedMutex> lock{getMutex(bid)};
+    auto locks = lockBuckets<std::unique_lock<SharedMutex>>(bid, altBid);
     auto buffer = readBucket(bid);
     if (buffer.isNull()) {
       ioErrorCount_.inc();
       return Status::DeviceError;
     }
-
     auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
-    oldRemainingBytes = bucket->remainingBytes();
+
+    // With two choice hashing the key may be in either bucket. Remove it
+    // from both and place it in the one with more space left.
+    Buffer altBuffer;
+    Bucket* altBucket{nullptr};
+    uint32_t altRemoved{0};
+    if (altBid != bid) {
+      altBuffer = readBucket(altBid);
+      if (altBuffer.isNull()) {
+        ioErrorCount_.inc();
+        return Status::DeviceError;
+      }
+      altBucket = reinterpret_cast<Bucket*>(altBuffer.data());
+      oldRemainingBytes += altBucket->remainingBytes();
+      altRemoved = altBucket->remove(hk, cb);
+    }
+
+    oldRemainingBytes += bucket->remainingBytes();
     removed = bucket->remove(hk, cb);
+    if (altBucket != nullptr &&
+        altBucket->remainingBytes() > bucket->remainingBytes()) {
+      std::swap(bid, altBid);
+      std::swap(buffer, altBuffer);
+      std::swap(bucket, altBucket);
+      std::swap(removed, altRemoved);
+    }
     std::tie(evicted, evictExpired) =
         bucket->insert(hk, value, checkExpired_, cb);
     newRemainingBytes = bucket->remainingBytes();
+    if (altBucket != nullptr) {
+      newRemainingBytes += altBucket->remainingBytes();
+    }
 
     // rebuild / fix the bloom filter before we move the buffer to do the
     // actual write
@@ -343,14 +466,23 @@ Status BigHash::insert(HashedKey hk, BufferView value) {
       ioErrorCount_.inc();
       return Status::DeviceError;
     }
-  }
 
-  for (const auto& item : removedItems) {
-    destructorCb_(makeHK(std::get<0>(item)) /* key */,
-                  std::get<1>(item).view() /* value */,
-                  std::get<2>(item) /* event */);
+    // Drop the old copy from the other bucket only once the new one is
+    // written. If that fails the other bucket is disabled along with it.
+    if (altRemoved > 0) {
+      bfRebuild(altBid, altBucket);
+      if (writeBucket(altBid, std::move(altBuffer))) {
+        physicalWrittenCount_.add(bucketSize_);
+      } else {
+        bfClear(altBid);
+        ioErrorCount_.inc();
+      }
+      removed += altRemoved;
+    }
   }
 
+  callDestructor(removedItems);
+
   if (oldRemainingBytes < newRemainingBytes) {
     usedSizeBytes_.sub(newRemainingBytes - oldRemainingBytes);
   } else {
@@ -366,12 +498,15 @@ Status BigHash::insert(HashedKey hk, BufferView value) {
   logicalWrittenCount_.add(hk.key().size() + value.size());
   physicalWrittenCount_.add(bucketSize_);
   succInsertCount_.inc();
+  CACHELIB_TRACEPOINT(bh_bucket_rmw, bid.index(), removed, evicted);
   return Status::Ok;
 }
 
 bool BigHash::couldExist(HashedKey hk) {
   const auto bid = getBucketId(hk);
-  bool canExist = !bfReject(bid, hk.keyHash());
+  const auto altBid = getAltBucketId(hk);
+  bool canExist = !bfReject(bid, hk.keyHash()) ||
+                  (altBid != bid && !bfReject(altBid, hk.keyHash()));
 
   // the caller is not likely to issue a subsequent lookup when we return
   // false. hence tag this as a lookup. If we return the key can exist, the
@@ -388,111 +523,546 @@ uint64_t BigHash::estimateWriteSize(HashedKey, BufferView) const {
 
 Status BigHash::lookup(HashedKey hk, Buffer& value) {
   const auto bid = getBucketId(hk);
+  const auto altBid = getAltBucketId(hk);
   lookupCount_.inc();
 
+  Status status;
+  {
+    // inserts move a key between its two buckets while holding both locks
+    auto locks = lockBuckets<std::shared_lock<SharedMutex>>(bid, altBid);
+    status = lookupInBucket(bid, hk, value);
+    if (status == Status::NotFound && altBid != bid) {
+      status = lookupInBucket(altBid, hk, value);
+    }
+  }
+  if (status == Status::Ok) {
+    succLookupCount_.inc();
+  }
+  return status;
+}
+
+Status BigHash::lookupInBucket(BucketId bid, HashedKey hk, Buffer& value) {
   if (!validBucketChecker_->isBucketValid(bid.index())) {
     disabledBucketLookup_.inc();
     return Status::NotFound;
   }
-
-  Bucket* bucket{nullptr};
-  Buffer buffer;
-
-  // scope of the lock is only needed until we read and mutate state for the
-  // bucket. Once the bucket is read, the buffer is local and we can find
-  // without holding the lock.
-  {
-    std::shared_lock<SharedMutex> lock{getMutex(bid)};
-    if (bfReject(bid, hk.keyHash())) {
-      return Status::NotFound;
-    }
-
-    buffer = readBucket(bid);
-    if (buffer.isNull()) {
-      ioErrorCount_.inc();
-      return Status::DeviceError;
+  if (staging_) {
+    if (const auto* item = findStaged(bid, hk)) {
+      value = Buffer{item->value.view()};
+      return Status::Ok;
     }
+  }
+  if (bfReject(bid, hk.keyHash())) {
+    return Status::NotFound;
+  }
 
-    bucket = reinterpret_cast<Bucket*>(buffer.data());
+  auto buffer = readBucket(bid);
+  if (buffer.isNull()) {
+    ioErrorCount_.inc();
+    return Status::DeviceError;
   }
 
+  auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
   auto valueView = bucket->find(hk);
   if (valueView.isNull()) {
     bfFalsePositiveCount_.inc();
     return Status::NotFound;
   }
   value = Buffer{valueView};
-  succLookupCount_.inc();
   return Status::Ok;
 }
 
 Status BigHash::remove(HashedKey hk) {
   const auto bid = getBucketId(hk);
+  const auto altBid = getAltBucketId(hk);
   removeCount_.inc();
 
+  // we copy the items and trigger the destructorCb after bucket lock is
+  // released to avoid possible heavy operations or locks in the destrcutor.
+  std::vector<Buffer> valueCopies;
+  Status status;
+  {
+    auto locks = lockBuckets<std::unique_lock<SharedMutex>>(bid, altBid);
+    status = removeInBucket(bid, hk, valueCopies);
+    if (status == Status::NotFound && altBid != bid) {
+      status = removeInBucket(altBid, hk, valueCopies);
+    }
+  }
+  if (status != Status::Ok) {
+    return status;
+  }
+
+  for (const auto& valueCopy : valueCopies) {
+    if (!valueCopy.isNull()) {
+      destructorCb_(hk, valueCopy.view(), DestructorEvent::Removed);
+    }
+  }
+  succRemoveCount_.inc();
+  return Status::Ok;
+}
+
+Status BigHash::removeInBucket(BucketId bid,
+                               HashedKey hk,
+                               std::vector<Buffer>& valueCopies) {
   if (!validBucketChecker_->isBucketValid(bid.index())) {
     disabledBucketRemove_.inc();
     return Status::NotFound;
   }
 
-  uint32_t oldRemainingBytes = 0;
-  uint32_t newRemainingBytes = 0;
+  // A staged item is dropped from memory, but an older copy of it can still
+  // be in the bucket on device.
+  bool removedStaged = false;
+  if (staging_) {
+    auto& shard = getStagingShard(bid);
+    auto it = shard.buckets.find(bid.index());
+    if (it != shard.buckets.end()) {
+      auto& items = it->second;
+      auto itemIt = std::find_if(
+          items.begin(), items.end(), [&hk](const StagedItem& item) {
+            return item.key.view() == makeView(hk.key());
+          });
+      if (itemIt != items.end()) {
+        shard.bytes -= itemIt->size();
+        valueCopies.push_back(std::move(itemIt->value));
+        items.erase(itemIt);
+        if (items.empty()) {
+          shard.buckets.erase(it);
+        }
+        stagedItemCount_.dec();
+        removedStaged = true;
+      }
+    }
+  }
+  const auto notFound = removedStaged ? Status::Ok : Status::NotFound;
+
+  if (bfReject(bid, hk.keyHash())) {
+    return notFound;
+  }
 
-  // we copy the items and trigger the destructorCb after bucket lock is
-  // released to avoid possible heavy operations or locks in the destrcutor.
   Buffer valueCopy;
   DestructorCallback cb = [&valueCopy](HashedKey, BufferView value,
                                        DestructorEvent) {
     valueCopy = Buffer{value};
   };
 
-  if (bfReject(bid, hk.keyHash())) {
-    return Status::NotFound;
+  auto buffer = readBucket(bid);
+  if (buffer.isNull()) {
+    ioErrorCount_.inc();
+    return Status::DeviceError;
+  }
+
+  auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
+  const uint32_t oldRemainingBytes = bucket->remainingBytes();
+  if (!bucket->remove(hk, cb)) {
+    if (!removedStaged) {
+      bfFalsePositiveCount_.inc();
+    }
+    return notFound;
+  }
+  const uint32_t newRemainingBytes = bucket->remainingBytes();
+  valueCopies.push_back(std::move(valueCopy));
+
+  // We compute bloom filter before writing the bucket because when encryption
+  // is enabled, we will "move" the bucket content into writeBucket().
+  bfRebuild(bid, bucket);
+  bfSetStaged(bid);
+
+  const auto res = writeBucket(bid, std::move(buffer));
+  if (!res) {
+    bfClear(bid);
+    bfSetStaged(bid);
+    ioErrorCount_.inc();
+    return Status::DeviceError;
   }
 
+  XDCHECK_LE(oldRemainingBytes, newRemainingBytes);
+  usedSizeBytes_.sub(newRemainingBytes - oldRemainingBytes);
+  itemCount_.dec();
+
+  // We do not bump logicalWrittenCount_ because logically a
+  // remove operation does not write, but for BigHash, it does
+  // incur physical writes.
+  physicalWrittenCount_.add(bucketSize_);
+  return Status::Ok;
+}
+
+Status BigHash::stageInsert(BucketId bid, HashedKey hk, BufferView value) {
+  RemovedItems removedItems;
+  Status status = Status::Ok;
+  {
+    std::unique_lock<SharedMutex> lock{getMutex(bid)};
+    auto& shard = getStagingShard(bid);
+    auto& items = shard.buckets[bid.index()];
+    auto it = std::find_if(
+        items.begin(), items.end(), [&hk](const StagedItem& item) {
+          return item.key.view() == makeView(hk.key());
+        });
+    if (it != items.end()) {
+      shard.bytes -= it->size();
+      removedItems.emplace_back(
+          std::move(it->key), std::move(it->value), DestructorEvent::Removed);
+      items.erase(it);
+      stagedItemCount_.dec();
+    }
+    items.push_back(StagedItem{Buffer{makeView(hk.key())}, Buffer{value}});
+    shard.bytes += items.back().size();
+    stagedItemCount_.inc();
+    bfSet(bid, hk.keyHash());
+
+    if (items.size() >= writeBatchSize_) {
+      status = writeStaged(bid, removedItems);
+    }
+    // All the buckets of the shard share the lock we hold. Write the ones
+    // with the most staged items until the shard is within its memory.
+    while (shard.bytes > stagingShardSize_) {
+      auto largest = std::max_element(
+          shard.buckets.begin(), shard.buckets.end(),
+          [](const auto& a, const auto& b) {
+            return a.second.size() < b.second.size();
+          });
+      const BucketId other{largest->first};
+      const auto res = writeStaged(other, removedItems);
+      if (other == bid) {
+        status = res;
+      }
+    }
+  }
+
+  callDestructor(removedItems);
+  if (status != Status::Ok) {
+    return status;
+  }
+  logicalWrittenCount_.add(hk.key().size() + value.size());
+  succInsertCount_.inc();
+  return Status::Ok;
+}
+
+const BigHash::StagedItem* BigHash::findStaged(BucketId bid,
+                                               HashedKey hk) const {
+  const auto& buckets = getStagingShard(bid).buckets;
+  auto it = buckets.find(bid.index());
+  if (it == buckets.end()) {
+    return nullptr;
+  }
+  for (const auto& item : it->second) {
+    if (item.key.view() == makeView(hk.key())) {
+      return &item;
+    }
+  }
+  return nullptr;
+}
+
+Status BigHash::writeStaged(BucketId bid, RemovedItems& removedItems) {
+  auto& shard = getStagingShard(bid);
+  auto it = shard.buckets.find(bid.index());
+  if (it == shard.buckets.end()) {
+    return Status::Ok;
+  }
+  auto items = std::move(it->second);
+  shard.buckets.erase(it);
+  for (const auto& item : items) {
+    shard.bytes -= item.size();
+  }
+  stagedItemCount_.sub(items.size());
+  stagedWriteCount_.inc();
+
+  if (!validBucketChecker_->isBucketValid(bid.index())) {
+    disabledBucketInsert_.add(items.size());
+    return Status::Rejected;
+  }
+
+  std::vector<std::pair<HashedKey, BufferView>> batch;
+  batch.reserve(items.size());
+  for (const auto& item : items) {
+    batch.emplace_back(makeHK(item.key), item.value.view());
+  }
+  return insertIntoBucket(bid, batch, removedItems);
+}
+
+Status BigHash::insertIntoBucket(
+    BucketId bid,
+    const std::vector<std::pair<HashedKey, BufferView>>& items,
+    RemovedItems& removedItems) {
+  DestructorCallback cb = [&removedItems](HashedKey key, BufferView val,
+                                          DestructorEvent event) {
+    // must make a copy for the key, o/w data might be deleted
+    removedItems.emplace_back(Buffer{makeView(key.key())}, val, event);
+  };
+
+  auto buffer = readBucket(bid);
+  if (buffer.isNull()) {
+    ioErrorCount_.inc();
+    return Status::DeviceError;
+  }
+
+  auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
+  const uint32_t oldRemainingBytes = bucket->remainingBytes();
+  uint32_t removed{0};
+  uint32_t evicted{0};
+  uint32_t evictExpired{0};
+  for (const auto& [hk, value] : items) {
+    removed += bucket->remove(hk, cb);
+    uint32_t itemEvicted{0};
+    uint32_t itemEvictExpired{0};
+    std::tie(itemEvicted, itemEvictExpired) =
+        bucket->insert(hk, value, checkExpired_, cb);
+    evicted += itemEvicted;
+    evictExpired += itemEvictExpired;
+  }
+  const uint32_t newRemainingBytes = bucket->remainingBytes();
+
+  bfRebuild(bid, bucket);
+  const auto res = writeBucket(bid, std::move(buffer));
+  if (!res) {
+    bfClear(bid);
+    ioErrorCount_.inc();
+    return Status::DeviceError;
+  }
+
+  if (oldRemainingBytes < newRemainingBytes) {
+    usedSizeBytes_.sub(newRemainingBytes - oldRemainingBytes);
+  } else {
+    usedSizeBytes_.add(oldRemainingBytes - newRemainingBytes);
+  }
+  itemCount_.add(items.size());
+  itemCount_.sub(evicted + removed);
+  evictionCount_.add(evicted);
+  evictionExpiredCount_.add(evictExpired);
+  if (evictExpired > 0) {
+    bucketExpirationsDist_x100_.trackValue(evictExpired * 100);
+  }
+  // one bucket write for all the items
+  physicalWrittenCount_.add(bucketSize_);
+  return Status::Ok;
+}
+
+void BigHash::writeAllStaged() {
+  if (!staging_) {
+    return;
+  }
+  for (size_t i = 0; i < kNumMutexes; i++) {
+    RemovedItems removedItems;
+    {
+      std::unique_lock<SharedMutex> lock{mutex_[i]};
+      auto& shard = staging_[i];
+      while (!shard.buckets.empty()) {
+        writeStaged(BucketId{shard.buckets.begin()->first}, removedItems);
+      }
+    }
+    callDestructor(removedItems);
+  }
+}
+
+void BigHash::callDestructor(const RemovedItems& removedItems) {
+  for (const auto& item : removedItems) {
+    destructorCb_(makeHK(std::get<0>(item)) /* key */,
+                  std::get<1>(item).view() /* value */,
+                  std::get<2>(item) /* event */);
+  }
+}
+
+void BigHash::removeBatch(folly::Range<const HashedKey*> hks,
+                          folly::Range<Status*> statuses) {
+  XDCHECK_EQ(hks.size(), statuses.size());
+  if (twoChoiceHashing_ || staging_) {
+    // keys may also be staged or in a second bucket, remove them one by one
+    for (size_t i = 0; i < hks.size(); i++) {
+      statuses[i] = remove(hks[i]);
+    }
+    return;
+  }
+
+  // group the keys by bucket so that each bucket is read and written once
+  std::vector<uint32_t> order(hks.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this, &hks](uint32_t a, uint32_t b) {
+    return getBucketId(hks[a]).index() < getBucketId(hks[b]).index();
+  });
+
+  for (size_t begin = 0; begin < order.size();) {
+    const auto bid = getBucketId(hks[order[begin]]);
+    size_t end = begin + 1;
+    while (end < order.size() && getBucketId(hks[order[end]]) == bid) {
+      end++;
+    }
+    if (end - begin == 1) {
+      statuses[order[begin]] = remove(hks[order[begin]]);
+    } else {
+      removeFromBucket(
+          bid, hks, folly::range(order.data() + begin, order.data() + end),
+          statuses);
+    }
+    begin = end;
+  }
+}
+
+void BigHash::removeFromBucket(BucketId bid,
+                               folly::Range<const HashedKey*> hks,
+                               folly::Range<const uint32_t*> idxs,
+                               folly::Range<Status*> statuses) {
+  removeCount_.add(idxs.size());
+  for (auto i : idxs) {
+    statuses[i] = Status::NotFound;
+  }
+
+  if (!validBucketChecker_->isBucketValid(bid.index())) {
+    disabledBucketRemove_.add(idxs.size());
+    return;
+  }
+
+  std::vector<uint32_t> candidates;
+  for (auto i : idxs) {
+    if (!bfReject(bid, hks[i].keyHash())) {
+      candidates.push_back(i);
+    }
+  }
+  if (candidates.empty()) {
+    return;
+  }
+
+  uint32_t oldRemainingBytes = 0;
+  uint32_t newRemainingBytes = 0;
+
+  // the removed keys along with a copy of their values to trigger the
+  // destructorCb after bucket lock is released.
+  std::vector<std::pair<uint32_t, Buffer>> removed;
   {
     std::unique_lock<SharedMutex> lock{getMutex(bid)};
 
     auto buffer = readBucket(bid);
     if (buffer.isNull()) {
       ioErrorCount_.inc();
-      return Status::DeviceError;
+      for (auto i : candidates) {
+        statuses[i] = Status::DeviceError;
+      }
+      return;
     }
 
     auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
     oldRemainingBytes = bucket->remainingBytes();
-    if (!bucket->remove(hk, cb)) {
-      bfFalsePositiveCount_.inc();
-      return Status::NotFound;
+    for (auto i : candidates) {
+      Buffer valueCopy;
+      DestructorCallback cb = [&valueCopy](HashedKey, BufferView value,
+                                           DestructorEvent) {
+        valueCopy = Buffer{value};
+      };
+      if (bucket->remove(hks[i], cb)) {
+        removed.emplace_back(i, std::move(valueCopy));
+      } else {
+        bfFalsePositiveCount_.inc();
+      }
+    }
+    if (removed.empty()) {
+      return;
     }
     newRemainingBytes = bucket->remainingBytes();
 
-    // We compute bloom filter before writing the bucket because when encryption
-    // is enabled, we will "move" the bucket content into writeBucket().
     bfRebuild(bid, bucket);
 
     const auto res = writeBucket(bid, std::move(buffer));
     if (!res) {
       bfClear(bid);
       ioErrorCount_.inc();
-      return Status::DeviceError;
+      for (const auto& entry : removed) {
+        statuses[entry.first] = Status::DeviceError;
+      }
+      return;
     }
   }
 
-  if (!valueCopy.isNull()) {
-    destructorCb_(hk, valueCopy.view(), DestructorEvent::Removed);
+  for (const auto& [i, valueCopy] : removed) {
+    statuses[i] = Status::Ok;
+    if (!valueCopy.isNull()) {
+      destructorCb_(hks[i], valueCopy.view(), DestructorEvent::Removed);
+    }
   }
 
   XDCHECK_LE(oldRemainingBytes, newRemainingBytes);
   usedSizeBytes_.sub(newRemainingBytes - oldRemainingBytes);
-  itemCount_.dec();
+  itemCount_.sub(removed.size());
 
-  // We do not bump logicalWrittenCount_ because logically a
-  // remove operation does not write, but for BigHash, it does
-  // incur physical writes.
+  // one bucket write for all the keys removed from it
   physicalWrittenCount_.add(bucketSize_);
-  succRemoveCount_.inc();
-  return Status::Ok;
+  succRemoveCount_.add(removed.size());
+}
+
+void BigHash::insertBatch(folly::Range<const HashedKey*> hks,
+                          folly::Range<const BufferView*> values,
+                          uint32_t minBucketBatch,
+                          folly::Range<Status*> statuses) {
+  XDCHECK_EQ(hks.size(), values.size());
+  XDCHECK_EQ(hks.size(), statuses.size());
+  // group the keys by bucket so that each bucket is read and written once
+  std::vector<uint32_t> order(hks.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(
+      order.begin(), order.end(), [this, &hks](uint32_t a, uint32_t b) {
+        return getBucketId(hks[a]).index() < getBucketId(hks[b]).index();
+      });
+
+  for (size_t begin = 0; begin < order.size();) {
+    const auto bid = getBucketId(hks[order[begin]]);
+    size_t end = begin + 1;
+    while (end < order.size() && getBucketId(hks[order[end]]) == bid) {
+      end++;
+    }
+    const auto idxs = folly::range(order.data() + begin, order.data() + end);
+    begin = end;
+
+    if (idxs.size() < minBucketBatch) {
+      for (auto i : idxs) {
+        statuses[i] = Status::Rejected;
+      }
+      continue;
+    }
+    if (twoChoiceHashing_ || staging_) {
+      // keys may go to a second bucket or be staged
+      for (auto i : idxs) {
+        statuses[i] = insert(hks[i], values[i]);
+      }
+      continue;
+    }
+    insertIntoBucket(bid, hks, values, idxs, statuses);
+  }
+}
+
+void BigHash::insertIntoBucket(BucketId bid,
+                               folly::Range<const HashedKey*> hks,
+                               folly::Range<const BufferView*> values,
+                               folly::Range<const uint32_t*> idxs,
+                               folly::Range<Status*> statuses) {
+  insertCount_.add(idxs.size());
+  if (!validBucketChecker_->isBucketValid(bid.index())) {
+    disabledBucketInsert_.add(idxs.size());
+    for (auto i : idxs) {
+      statuses[i] = Status::Rejected;
+    }
+    return;
+  }
+
+  std::vector<std::pair<HashedKey, BufferView>> items;
+  items.reserve(idxs.size());
+  for (auto i : idxs) {
+    items.emplace_back(hks[i], values[i]);
+  }
+
+  RemovedItems removedItems;
+  Status status;
+  {
+    std::unique_lock<SharedMutex> lock{getMutex(bid)};
+    status = insertIntoBucket(bid, items, removedItems);
+  }
+  callDestructor(removedItems);
+
+  for (auto i : idxs) {
+    statuses[i] = status;
+    if (status == Status::Ok) {
+      logicalWrittenCount_.add(hks[i].key().size() + values[i].size());
+    }
+  }
+  if (status == Status::Ok) {
+    succInsertCount_.add(idxs.size());
+  }
 }
 
 inline void BigHash::bfSet(BucketId bid, uint64_t keyHash) {
@@ -527,6 +1097,67 @@ bool BigHash::bfReject(BucketId bid, uint64_t keyHash) const {
   return false;
 }
 
+void BigHash::rebuildBloomFilters() {
+  XDCHECK(bloomFilter_);
+  const auto startTime = getSteadyClock();
+  const auto numThreads = static_cast<uint32_t>(
+      std::min<uint64_t>(recoveryThreads_, numBuckets_));
+  XLOGF(INFO, "Rebuilding bloom filters of {} buckets with {} threads",
+        numBuckets_, numThreads);
+  bloomFilter_->reset();
+
+  // log the progress every 10% of the buckets
+  const uint64_t logInterval = std::max<uint64_t>(1, numBuckets_ / 10);
+  std::atomic<uint64_t> numDone{0};
+  auto rebuildRange = [this, &numDone, logInterval](uint64_t begin,
+                                                    uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      const BucketId bid{static_cast<uint32_t>(i)};
+      if (validBucketChecker_->isBucketValid(bid.index())) {
+        std::unique_lock<SharedMutex> lock{getMutex(bid)};
+        auto buffer = readBucket(bid);
+        if (buffer.isNull()) {
+          ioErrorCount_.inc();
+        } else {
+          bfRebuild(bid, reinterpret_cast<const Bucket*>(buffer.data()));
+        }
+      }
+      const auto done = numDone.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (done % logInterval == 0) {
+        XLOGF(INFO, "Rebuilt bloom filters of {} of {} buckets ({}%)", done,
+              numBuckets_, done * 100 / numBuckets_);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 1; t < numThreads; t++) {
+    threads.emplace_back(rebuildRange, numBuckets_ * t / numThreads,
+                         numBuckets_ * (t + 1) / numThreads);
+  }
+  rebuildRange(0, numBuckets_ / numThreads);
+  for (auto& t : threads) {
+    t.join();
+  }
+  XLOGF(INFO, "Rebuilt bloom filters in {}ms",
+        toMillis(getSteadyClock() - startTime).count());
+}
+
+void BigHash::bfSetStaged(BucketId bid) {
+  if (!staging_ || !bloomFilter_) {
+    return;
+  }
+
+  const auto& buckets = getStagingShard(bid).buckets;
+  auto it = buckets.find(bid.index());
+  if (it == buckets.end()) {
+    return;
+  }
+  for (const auto& item : it->second) {
+    bfSet(bid, makeHK(item.key).keyHash());
+  }
+}
+
 void BigHash::bfRebuild(BucketId bid, const Bucket* bucket) {
   if (!bloomFilter_) {
     return;
@@ -545,6 +1176,7 @@ void BigHash::bfRebuild(BucketId bid, const Bucket* bucket) {
 
 void BigHash::flush() {
   XLOG(INFO, "Flush big hash");
+  writeAllStaged();
   device_.flush();
 }
 
@@ -552,6 +1184,11 @@ Buffer BigHash::readBucket(BucketId bid) {
   auto buffer = device_.makeIOBuffer(bucketSize_);
   XDCHECK(!buffer.isNull());
 
+  if (bucketCache_ &&
+      bucketCache_->lookup(bid.index(), buffer.mutableView())) {
+    return buffer;
+  }
+
   const bool res =
       device_.read(getBucketOffset(bid), buffer.size(), buffer.data());
   if (!res) {
@@ -584,16 +1221,26 @@ Buffer BigHash::readBucket(BucketId bid) {
       !checksumCheck(bucket, buffer.view())) {
     Bucket::initNew(buffer.mutableView(), generationTime_.count());
   }
+  if (bucketCache_) {
+    bucketCache_->insert(bid.index(), buffer.view());
+  }
   return buffer;
 }
 
 bool BigHash::writeBucket(BucketId bid, Buffer buffer) {
   auto* bucket = reinterpret_cast<Bucket*>(buffer.data());
   bucket->setChecksum(Bucket::computeChecksum(buffer.view()));
+  // the write may consume the buffer, refresh the cached copy first
+  if (bucketCache_) {
+    bucketCache_->update(bid.index(), buffer.view());
+  }
   const bool res =
       device_.write(getBucketOffset(bid), std::move(buffer), placementHandle_);
   if (!res) {
     validBucketChecker_->disableBucket(bid.index());
+    if (bucketCache_) {
+      bucketCache_->invalidate(bid.index());
+    }
   }
   return res;
 }
@@ -16,15 +16,23 @@
 
 #pragma once
 
+#include <folly/container/F14Map.h>
 #include <folly/fibers/TimedMutex.h>
+#include <folly/hash/Hash.h>
 
 #include <chrono>
+#include <functional>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/BloomFilter.h"
+#include "cachelib/common/FormatUpgrader.h"
 #include "cachelib/common/PercentileStats.h"
 #include "cachelib/navy/bighash/Bucket.h"
+#include "cachelib/navy/bighash/BucketCache.h"
 #include "cachelib/navy/common/Buffer.h"
 #include "cachelib/navy/common/Device.h"
 #include "cachelib/navy/common/Hash.h"
@@ -76,6 +84,25 @@ class BigHash final : public Engine {
     // Optional bloom filter to reduce IO
     std::unique_ptr<BloomFilter> bloomFilter;
 
+    // Place every item in the less full of two buckets picked by its key,
+    // see BigHash::getAltBucketId()
+    bool twoChoiceHashing{false};
+
+    // Stage up to this many inserts per bucket in memory and write them to
+    // the bucket together. 0 or 1 writes every insert through. Can't be
+    // combined with two choice hashing.
+    uint32_t writeBatchSize{0};
+    // Memory for staged inserts, required with write batching
+    uint64_t stagingMemorySize{0};
+
+    // Bytes of DRAM to cache recently read buckets in, rounded down to whole
+    // buckets. 0 to disable.
+    uint64_t bucketCacheSize{0};
+
+    // Threads to rebuild the bloom filters from the buckets with on recovery,
+    // when the persisted filters don't match the configured ones
+    uint32_t recoveryThreads{4};
+
     uint64_t numBuckets() const { return cacheSize / bucketSize; }
 
     Config& validate();
@@ -120,7 +147,22 @@ class BigHash final : public Engine {
   // and DeviceError on error.
   Status remove(HashedKey hk) override;
 
-  // flush the device file
+  // Removes a batch of keys. Keys falling in the same bucket are removed with
+  // a single read and write of the bucket.
+  void removeBatch(folly::Range<const HashedKey*> hks,
+                   folly::Range<Status*> statuses) override;
+
+  // Inserts a batch of keys, setting the status of each key at the same
+  // index as the key. Keys falling in the same bucket are inserted with a
+  // single read and write of the bucket, in batch order. Keys of buckets with
+  // fewer than @minBucketBatch keys in the batch are not inserted and get
+  // Status::Rejected.
+  void insertBatch(folly::Range<const HashedKey*> hks,
+                   folly::Range<const BufferView*> values,
+                   uint32_t minBucketBatch,
+                   folly::Range<Status*> statuses);
+
+  // write the staged inserts and flush the device file
   void flush() override;
 
   // reset BigHash, this clears the bloom filter and all stats
@@ -134,6 +176,12 @@ class BigHash final : public Engine {
   // @return true if recovery succeed, false o/w.
   bool recover(RecordReader& rr) override;
 
+  // upgrades the state persisted by older format versions on recovery. A
+  // step may only translate the persisted data, the buckets must still be
+  // readable by the current version.
+  static FormatUpgrader<serialization::BigHashPersistentData>&
+  formatUpgrader();
+
   // returns BigHash stats to the visitor
   void getCounters(const CounterVisitor& visitor) const override;
 
@@ -191,6 +239,106 @@ class BigHash final : public Engine {
     return BucketId{static_cast<uint32_t>(hk.keyHash() % numBuckets_)};
   }
 
+  // With two choice hashing, the other bucket @hk can be placed in. It can
+  // be the same as getBucketId(), which is always returned otherwise.
+  BucketId getAltBucketId(HashedKey hk) const {
+    if (!twoChoiceHashing_) {
+      return getBucketId(hk);
+    }
+    return BucketId{static_cast<uint32_t>(
+        folly::hash::twang_mix64(hk.keyHash()) % numBuckets_)};
+  }
+
+  // Locks the mutexes of both buckets in a fixed order. The second lock is
+  // empty if the buckets share a mutex.
+  template <typename Lock>
+  std::pair<Lock, Lock> lockBuckets(BucketId bid, BucketId altBid) const {
+    auto* first = &getMutex(bid);
+    auto* second = &getMutex(altBid);
+    if (first == second) {
+      return {Lock{*first}, Lock{}};
+    }
+    if (std::less<SharedMutex*>{}(second, first)) {
+      std::swap(first, second);
+    }
+    Lock firstLock{*first};
+    Lock secondLock{*second};
+    return {std::move(firstLock), std::move(secondLock)};
+  }
+
+  // Looks @hk up in bucket @bid, whose lock is held
+  Status lookupInBucket(BucketId bid, HashedKey hk, Buffer& value);
+
+  // Removes @hk from bucket @bid, whose lock is held. Copies of the removed
+  // values are added to @valueCopies for the destructor callback.
+  Status removeInBucket(BucketId bid,
+                        HashedKey hk,
+                        std::vector<Buffer>& valueCopies);
+
+  // Items removed from buckets, with the key copied, to call the destructor
+  // callback on once the bucket lock is released
+  using RemovedItems = std::vector<std::tuple<Buffer, Buffer, DestructorEvent>>;
+
+  // An insert waiting in memory to be written to its bucket
+  struct StagedItem {
+    Buffer key;
+    Buffer value;
+
+    size_t size() const { return key.size() + value.size(); }
+  };
+
+  // Staged inserts of the buckets sharing a mutex, guarded by that mutex.
+  // Items of a bucket are in insertion order.
+  struct StagingShard {
+    folly::F14FastMap<uint32_t, std::vector<StagedItem>> buckets;
+    uint64_t bytes{0};
+  };
+
+  StagingShard& getStagingShard(BucketId bid) const {
+    return staging_[bid.index() & (kNumMutexes - 1)];
+  }
+
+  // Stages the insert of @hk into bucket @bid and writes the bucket once
+  // enough inserts are staged for it.
+  Status stageInsert(BucketId bid, HashedKey hk, BufferView value);
+
+  // Returns the staged item of @hk in bucket @bid or nullptr. The bucket lock
+  // must be held.
+  const StagedItem* findStaged(BucketId bid, HashedKey hk) const;
+
+  // Inserts all staged items of @bid into the bucket with one read and one
+  // write. The bucket lock must be held.
+  Status writeStaged(BucketId bid, RemovedItems& removedItems);
+
+  // Inserts @items into bucket @bid in order with one read and one write.
+  // The bucket lock must be held.
+  Status insertIntoBucket(
+      BucketId bid,
+      const std::vector<std::pair<HashedKey, BufferView>>& items,
+      RemovedItems& removedItems);
+
+  // Inserts the keys @hks[i] for i in @idxs, which all belong to @bid, and
+  // sets their status in @statuses[i].
+  void insertIntoBucket(BucketId bid,
+                        folly::Range<const HashedKey*> hks,
+                        folly::Range<const BufferView*> values,
+                        folly::Range<const uint32_t*> idxs,
+                        folly::Range<Status*> statuses);
+
+  // Writes the staged items of all buckets
+  void writeAllStaged();
+
+  // Calls the destructor callback on @removedItems, without bucket locks held
+  void callDestructor(const RemovedItems& removedItems);
+
+  // Rebuilds all bloom filters from the buckets on device, splitting the
+  // buckets over recoveryThreads_ threads. Called on recovery.
+  void rebuildBloomFilters();
+
+  // Sets the bloom filter bits of the items staged for @bid after the filter
+  // was rebuilt from the bucket on device.
+  void bfSetStaged(BucketId bid);
+
   uint64_t getBucketOffset(BucketId bid) const {
     return cacheBaseOffset_ + bucketSize_ * bid.index();
   }
@@ -201,18 +349,30 @@ class BigHash final : public Engine {
   void bfRebuild(BucketId bid, const Bucket* bucket);
   bool bfReject(BucketId bid, uint64_t keyHash) const;
 
+  // Removes the keys @hks[i] for i in @idxs, which all belong to @bid, and
+  // sets their status in @statuses[i].
+  void removeFromBucket(BucketId bid,
+                        folly::Range<const HashedKey*> hks,
+                        folly::Range<const uint32_t*> idxs,
+                        folly::Range<Status*> statuses);
+
   // Use birthday paradox to estimate number of mutexes given number of parallel
   // queries and desired probability of lock collision.
   static constexpr size_t kNumMutexes = 16 * 1024;
 
   // Serialization format version. Never 0. Versions < 10 reserved for testing.
-  static constexpr uint32_t kFormatVersion = 10;
+  static constexpr uint32_t kFormatVersion = 11;
 
   const ExpiredCheck checkExpired_{};
   const DestructorCallback destructorCb_{};
   const uint64_t bucketSize_{};
   const uint64_t cacheBaseOffset_{};
   const uint64_t numBuckets_{};
+  const bool twoChoiceHashing_{false};
+  const uint32_t writeBatchSize_{0};
+  // a bucket is written once its shard holds more bytes than this
+  const uint64_t stagingShardSize_{0};
+  const uint32_t recoveryThreads_{1};
   std::unique_ptr<BloomFilter> bloomFilter_;
   std::unique_ptr<ValidBucketChecker> validBucketChecker_;
   std::chrono::nanoseconds generationTime_{};
@@ -228,6 +388,9 @@ class BigHash final : public Engine {
   // be a false positive which is ok.
   // Nested lock orders are always mutex-then-spinlock
   std::unique_ptr<folly::SpinLock[]> bfLock_{new folly::SpinLock[kNumMutexes]};
+  // one shard per mutex, only with write batching
+  std::unique_ptr<StagingShard[]> staging_;
+  std::unique_ptr<BucketCache> bucketCache_;
 
   // thread local counters in synchronized path
   mutable TLCounter lookupCount_;
@@ -253,6 +416,8 @@ class BigHash final : public Engine {
   mutable AtomicCounter disabledBucketLookup_;
   mutable AtomicCounter disabledBucketInsert_;
   mutable AtomicCounter disabledBucketRemove_;
+  mutable AtomicCounter stagedItemCount_;
+  mutable AtomicCounter stagedWriteCount_;
   // counters to quantify the expired eviction overhead (temporary)
   // PercentileStats generates outputs in integers, so amplify by 100x
   mutable util::PercentileStats bucketExpirationsDist_x100_;
@@ -29,6 +29,17 @@ namespace {
 const details::BucketEntry* getIteratorEntry(BucketStorage::Allocation itr) {
   return reinterpret_cast<const details::BucketEntry*>(itr.view().data());
 }
+
+// The low bits of the hash pick the bucket, tag the entries with the top ones
+uint8_t getTag(uint64_t keyHash) { return static_cast<uint8_t>(keyHash >> 56); }
+
+BucketStorage::Allocation findEntry(const BucketStorage& storage,
+                                    HashedKey hk) {
+  return storage.find(getTag(hk.keyHash()),
+                      [hk](BucketStorage::Allocation itr) {
+                        return getIteratorEntry(itr)->keyEqualsTo(hk);
+                      });
+}
 } // namespace
 
 BufferView Bucket::Iterator::key() const {
@@ -59,15 +70,11 @@ Bucket& Bucket::initNew(MutableBufferView view, uint64_t generationTime) {
 }
 
 BufferView Bucket::find(HashedKey hk) const {
-  auto itr = storage_.getFirst();
-  while (!itr.done()) {
-    auto* entry = getIteratorEntry(itr);
-    if (entry->keyEqualsTo(hk)) {
-      return entry->value();
-    }
-    itr = storage_.getNext(itr);
+  auto itr = findEntry(storage_, hk);
+  if (itr.done()) {
+    return {};
   }
-  return {};
+  return getIteratorEntry(itr)->value();
 }
 
 std::pair<uint32_t, uint32_t> Bucket::insert(
@@ -80,7 +87,7 @@ std::pair<uint32_t, uint32_t> Bucket::insert(
   XDCHECK_LE(size, storage_.capacity());
 
   auto ret = makeSpace(size, checkExpired, destructorCb);
-  auto alloc = storage_.allocate(size);
+  auto alloc = storage_.allocate(size, getTag(hk.keyHash()));
   XDCHECK(!alloc.done());
   details::BucketEntry::create(alloc.view(), hk, value);
 
@@ -91,7 +98,7 @@ std::pair<uint32_t, uint32_t> Bucket::makeSpace(
     uint32_t size,
     const ExpiredCheck& checkExpired,
     const DestructorCallback& destructorCb) {
-  const auto requiredSize = BucketStorage::slotSize(size);
+  const auto requiredSize = storage_.requiredSpace(size);
   XDCHECK_LE(requiredSize, storage_.capacity());
 
   if (storage_.remainingCapacity() >= requiredSize) {
@@ -117,7 +124,7 @@ std::pair<uint32_t, uint32_t> Bucket::makeSpace(
                    DestructorEvent::Recycled);
     }
 
-    curFreeSpace += BucketStorage::slotSize(itr.view().size());
+    curFreeSpace += storage_.requiredSpace(itr.view().size());
     if (curFreeSpace >= requiredSize) {
       storage_.removeUntil(itr);
       break;
@@ -158,20 +165,16 @@ uint32_t Bucket::removeExpired(BucketStorage::Allocation itr,
 }
 
 uint32_t Bucket::remove(HashedKey hk, const DestructorCallback& destructorCb) {
-  auto itr = storage_.getFirst();
-  while (!itr.done()) {
+  auto itr = findEntry(storage_, hk);
+  if (itr.done()) {
+    return 0;
+  }
+  if (destructorCb) {
     auto* entry = getIteratorEntry(itr);
-    if (entry->keyEqualsTo(hk)) {
-      if (destructorCb) {
-        destructorCb(entry->hashedKey(), entry->value(),
-                     DestructorEvent::Removed);
-      }
-      storage_.remove(itr);
-      return 1;
-    }
-    itr = storage_.getNext(itr);
+    destructorCb(entry->hashedKey(), entry->value(), DestructorEvent::Removed);
   }
-  return 0;
+  storage_.remove(itr);
+  return 1;
 }
 
 std::pair<std::string, BufferView> Bucket::getRandomAlloc() {
@@ -87,7 +87,8 @@ class FOLLY_PACK_ATTR Bucket {
 
   uint32_t remainingBytes() const { return storage_.remainingCapacity(); }
 
-  // Look up for the value corresponding to a key.
+  // Look up for the value corresponding to a key. Only entries whose tag
+  // matches the key hash are compared in large buckets, see BucketStorage.
   // BufferView::isNull() == true if not found.
   BufferView find(HashedKey hk) const;
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/bighash/BucketCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace facebook::cachelib::navy {
+BucketCache::BucketCache(uint32_t bucketSize, uint64_t numBuckets)
+    : bucketSize_{bucketSize}, shards_{std::make_unique<Shard[]>(kNumShards)} {
+  if (numBuckets == 0) {
+    throw std::invalid_argument{"Bucket cache must hold at least 1 bucket"};
+  }
+  const auto slotsPerShard = std::max<uint64_t>(1, numBuckets / kNumShards);
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    auto& shard = shards_[i];
+    shard.slots.resize(slotsPerShard);
+    shard.data = std::make_unique<uint8_t[]>(slotsPerShard * bucketSize_);
+  }
+}
+
+bool BucketCache::lookup(uint32_t bid, MutableBufferView dst) {
+  XDCHECK_EQ(dst.size(), bucketSize_);
+  auto& shard = getShard(bid);
+  std::lock_guard<TimedMutex> lock{shard.mutex};
+  auto it = shard.index.find(bid);
+  if (it == shard.index.end()) {
+    misses_.inc();
+    return false;
+  }
+  shard.slots[it->second].referenced = true;
+  std::memcpy(dst.data(), getSlotData(shard, it->second), bucketSize_);
+  hits_.inc();
+  return true;
+}
+
+void BucketCache::insert(uint32_t bid, BufferView data) {
+  XDCHECK_EQ(data.size(), bucketSize_);
+  auto& shard = getShard(bid);
+  std::lock_guard<TimedMutex> lock{shard.mutex};
+  auto it = shard.index.find(bid);
+  if (it != shard.index.end()) {
+    std::memcpy(getSlotData(shard, it->second), data.data(), bucketSize_);
+    return;
+  }
+
+  // give every referenced bucket another turn of the hand
+  const auto numSlots = static_cast<uint32_t>(shard.slots.size());
+  while (shard.slots[shard.hand].referenced) {
+    shard.slots[shard.hand].referenced = false;
+    shard.hand = (shard.hand + 1) % numSlots;
+  }
+  const auto slot = shard.hand;
+  shard.hand = (shard.hand + 1) % numSlots;
+
+  auto& victim = shard.slots[slot];
+  if (victim.bid != kInvalidBucket) {
+    shard.index.erase(victim.bid);
+  } else {
+    numBuckets_.inc();
+  }
+  victim.bid = bid;
+  victim.referenced = false;
+  shard.index.emplace(bid, slot);
+  std::memcpy(getSlotData(shard, slot), data.data(), bucketSize_);
+}
+
+void BucketCache::update(uint32_t bid, BufferView data) {
+  XDCHECK_EQ(data.size(), bucketSize_);
+  auto& shard = getShard(bid);
+  std::lock_guard<TimedMutex> lock{shard.mutex};
+  auto it = shard.index.find(bid);
+  if (it != shard.index.end()) {
+    std::memcpy(getSlotData(shard, it->second), data.data(), bucketSize_);
+  }
+}
+
+void BucketCache::invalidate(uint32_t bid) {
+  auto& shard = getShard(bid);
+  std::lock_guard<TimedMutex> lock{shard.mutex};
+  auto it = shard.index.find(bid);
+  if (it == shard.index.end()) {
+    return;
+  }
+  // the hand takes the slot without a second chance
+  shard.slots[it->second] = Slot{};
+  shard.index.erase(it);
+  numBuckets_.dec();
+}
+
+void BucketCache::reset() {
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    auto& shard = shards_[i];
+    std::lock_guard<TimedMutex> lock{shard.mutex};
+    numBuckets_.sub(shard.index.size());
+    std::fill(shard.slots.begin(), shard.slots.end(), Slot{});
+    shard.index.clear();
+    shard.hand = 0;
+  }
+}
+
+void BucketCache::getCounters(const CounterVisitor& visitor) const {
+  visitor("navy_bh_bucket_cache_hits", hits_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bh_bucket_cache_misses", misses_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bh_bucket_cache_buckets", numBuckets_.get());
+}
+} // namespace facebook::cachelib::navy
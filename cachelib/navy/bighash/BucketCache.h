@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/fibers/TimedMutex.h>
+
+#include <memory>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/navy/common/Buffer.h"
+#include "cachelib/navy/common/Types.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+using folly::fibers::TimedMutex;
+
+// CLOCK cache of recently read BigHash buckets. Small hot keys keep hitting
+// the same few buckets, and every miss in DRAM would otherwise read the full
+// bucket from the device again.
+//
+// Buckets are cached by index. The caller holds the lock of a bucket while
+// reading or writing it, so a cached copy is never older than the bucket on
+// the device as long as every write updates or invalidates it. Thread safe.
+class BucketCache {
+ public:
+  // @param bucketSize  size of a bucket
+  // @param numBuckets  number of buckets to cache
+  //
+  // @throw std::invalid_argument if @numBuckets is 0
+  BucketCache(uint32_t bucketSize, uint64_t numBuckets);
+  BucketCache(const BucketCache&) = delete;
+  BucketCache& operator=(const BucketCache&) = delete;
+
+  // Copies bucket @bid into @dst, which is a bucket in size, if cached.
+  //
+  // @return true on a hit
+  bool lookup(uint32_t bid, MutableBufferView dst);
+
+  // Caches the bucket @bid read from the device, evicting the first bucket
+  // not referenced since the clock hand passed it.
+  void insert(uint32_t bid, BufferView data);
+
+  // Replaces the cached copy of @bid, if any, with @data written to the
+  // device. Buckets are not cached on writes alone.
+  void update(uint32_t bid, BufferView data);
+
+  // Drops the cached copy of @bid
+  void invalidate(uint32_t bid);
+
+  // Drops all buckets
+  void reset();
+
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  static constexpr uint32_t kNumShards{32};
+  static constexpr uint32_t kInvalidBucket{0xffffffffu};
+
+  struct Slot {
+    uint32_t bid{kInvalidBucket};
+    bool referenced{false};
+  };
+
+  struct Shard {
+    TimedMutex mutex;
+    std::vector<Slot> slots;
+    // bucket data of the slots, one after the other
+    std::unique_ptr<uint8_t[]> data;
+    folly::F14FastMap<uint32_t, uint32_t> index;
+    uint32_t hand{0};
+  };
+
+  Shard& getShard(uint32_t bid) const { return shards_[bid % kNumShards]; }
+
+  uint8_t* getSlotData(Shard& shard, uint32_t slot) const {
+    return shard.data.get() + uint64_t{slot} * bucketSize_;
+  }
+
+  const uint32_t bucketSize_{};
+  std::unique_ptr<Shard[]> shards_;
+
+  mutable AtomicCounter hits_;
+  mutable AtomicCounter misses_;
+  mutable AtomicCounter numBuckets_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -16,6 +16,12 @@
 
 #include "cachelib/navy/bighash/BucketStorage.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+
 namespace facebook::cachelib::navy {
 static_assert(sizeof(BucketStorage) == 12,
               "BucketStorage overhead. Changing this may require changing "
@@ -25,11 +31,15 @@ const uint32_t BucketStorage::kAllocationOverhead = sizeof(BucketStorage::Slot);
 
 // This is very simple as it only tries to allocate starting from the
 // tail of the storage. Returns null view() if we don't have any more space.
-BucketStorage::Allocation BucketStorage::allocate(uint32_t size) {
+BucketStorage::Allocation BucketStorage::allocate(uint32_t size,
+                                                  uint8_t tag) {
   if (!canAllocate(size)) {
     return {};
   }
 
+  if (tagSize(capacity_) != 0) {
+    *tagAt(numAllocations_) = tag;
+  }
   auto* slot = new (data_ + endOffset_) Slot(size);
   endOffset_ += slotSize(size);
   numAllocations_++;
@@ -79,6 +89,20 @@ void BucketStorage::remove(const std::vector<Allocation>& allocs) {
   }
   // update end offset to point the right next byte of the data copied
   endOffset_ = dstOffset;
+
+  if (tagSize(capacity_) != 0) {
+    // compact the tags the same way, allocations are in position order
+    const uint32_t oldNumAllocations = numAllocations_ + allocs.size();
+    uint32_t dst = 0;
+    size_t next = 0;
+    for (uint32_t src = 0; src < oldNumAllocations; src++) {
+      if (next < allocs.size() && allocs[next].position() == src) {
+        next++;
+        continue;
+      }
+      *tagAt(dst++) = *tagAt(src);
+    }
+  }
 }
 
 void BucketStorage::removeUntil(Allocation alloc) {
@@ -104,6 +128,13 @@ void BucketStorage::removeUntil(Allocation alloc) {
   std::memmove(data_, data_ + offset, endOffset_ - offset);
   endOffset_ -= offset;
   numAllocations_ -= alloc.position() + 1;
+
+  if (tagSize(capacity_) != 0 && numAllocations_ > 0) {
+    // the tags of the remaining allocations move up to the end
+    std::memmove(tagAt(numAllocations_ - 1),
+                 tagAt(numAllocations_ + alloc.position()),
+                 numAllocations_);
+  }
 }
 
 BucketStorage::Allocation BucketStorage::getFirst() const {
@@ -127,4 +158,29 @@ BucketStorage::Allocation BucketStorage::getNext(
   }
   return {MutableBufferView{next->size, next->data}, alloc.position() + 1};
 }
+
+uint32_t BucketStorage::matchTags(uint8_t tag, uint32_t position) const {
+  // The group ends at the tag of @position. Tags past the last allocation
+  // are free space or slots and are masked out below.
+  const uint8_t* group = tagAt(position) - (kTagGroupSize - 1);
+  uint32_t reversed = 0;
+#if defined(__SSE2__)
+  const auto tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  reversed = static_cast<uint32_t>(_mm_movemask_epi8(
+      _mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+  for (uint32_t i = 0; i < kTagGroupSize; i++) {
+    reversed |= static_cast<uint32_t>(group[i] == tag) << i;
+  }
+#endif
+  // bit i of @reversed is the allocation at @position + kTagGroupSize - 1 - i
+  uint32_t mask = 0;
+  while (reversed != 0) {
+    const uint32_t i = folly::findFirstSet(reversed) - 1;
+    reversed &= reversed - 1;
+    mask |= 1u << (kTagGroupSize - 1 - i);
+  }
+  const auto count = std::min(kTagGroupSize, numAllocations_ - position);
+  return mask & ((1u << count) - 1);
+}
 } // namespace facebook::cachelib::navy
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <folly/lang/Bits.h>
+
 #include "cachelib/navy/common/Buffer.h"
 #include "cachelib/navy/common/CompilerUtils.h"
 
@@ -27,6 +29,11 @@ namespace navy {
 // This is a very simple FIFO allocator that once full the only
 // way to free up more space is by removing entries at the
 // front. It is used for managing alloactions inside a bucket.
+//
+// Storages of at least kMinTaggedCapacity also keep a one byte tag of every
+// allocation in an array growing down from the end of the storage. find()
+// compares the tags of a group of allocations at once and only looks at the
+// allocations whose tag matches.
 class FOLLY_PACK_ATTR BucketStorage {
  public:
   // This is an allocation that is returned to user when they
@@ -61,18 +68,33 @@ class FOLLY_PACK_ATTR BucketStorage {
 
   static uint32_t slotSize(uint32_t size) { return kAllocationOverhead + size; }
 
+  static constexpr uint32_t kMinTaggedCapacity{1024};
+
+  // return the bytes an allocation tag takes in a storage of @capacity
+  static uint32_t tagSize(uint32_t capacity) {
+    return capacity >= kMinTaggedCapacity ? 1 : 0;
+  }
+
   // construct a BucketStorage with given capacity, a placement new is required.
   explicit BucketStorage(uint32_t capacity) : capacity_{capacity} {}
 
   // allocate a space under this bucket storage
   // @param size  the required size for the space
+  // @param tag   the tag find() looks the allocation up by
   // @return      an Allocation for the allocated space, empty Allocation is
   //              returned if remaining space is not enough
-  Allocation allocate(uint32_t size);
+  Allocation allocate(uint32_t size, uint8_t tag = 0);
 
   uint32_t capacity() const { return capacity_; }
 
-  uint32_t remainingCapacity() const { return capacity_ - endOffset_; }
+  uint32_t remainingCapacity() const {
+    return capacity_ - endOffset_ - numAllocations_ * tagSize(capacity_);
+  }
+
+  // return the remaining capacity an allocation of @size takes
+  uint32_t requiredSpace(uint32_t size) const {
+    return slotSize(size) + tagSize(capacity_);
+  }
 
   uint32_t numAllocations() const { return numAllocations_; }
 
@@ -89,6 +111,35 @@ class FOLLY_PACK_ATTR BucketStorage {
   Allocation getFirst() const;
   Allocation getNext(Allocation alloc) const;
 
+  // return the first allocation with @tag that @matches, or an empty
+  // Allocation. Without tags every allocation is passed to @matches.
+  template <typename F>
+  Allocation find(uint8_t tag, F&& matches) const {
+    auto alloc = getFirst();
+    if (tagSize(capacity_) == 0) {
+      for (; !alloc.done(); alloc = getNext(alloc)) {
+        if (matches(alloc)) {
+          return alloc;
+        }
+      }
+      return {};
+    }
+    for (uint32_t group = 0; group < numAllocations_; group += kTagGroupSize) {
+      auto mask = matchTags(tag, group);
+      while (mask != 0) {
+        const uint32_t position = group + folly::findFirstSet(mask) - 1;
+        mask &= mask - 1;
+        while (alloc.position() < position) {
+          alloc = getNext(alloc);
+        }
+        if (matches(alloc)) {
+          return alloc;
+        }
+      }
+    }
+    return {};
+  }
+
   // offset of the Allocation within the Bucket
   uint32_t getOffset(Allocation& alloc) { return alloc.view().data() - data_; }
 
@@ -102,9 +153,22 @@ class FOLLY_PACK_ATTR BucketStorage {
   };
 
   bool canAllocate(uint32_t size) const {
-    return static_cast<uint64_t>(endOffset_) + slotSize(size) <= capacity_;
+    return static_cast<uint64_t>(endOffset_) + requiredSpace(size) +
+               numAllocations_ * tagSize(capacity_) <=
+           capacity_;
   }
 
+  // Tags are kept in reverse order, the one of position 0 is the last byte
+  // of the storage.
+  uint8_t* tagAt(uint32_t position) const {
+    return data_ + capacity_ - 1 - position;
+  }
+
+  // return a mask whose bit i is set if the allocation at @position + i has
+  // @tag, for the kTagGroupSize allocations from @position
+  uint32_t matchTags(uint8_t tag, uint32_t position) const;
+
+  static constexpr uint32_t kTagGroupSize{16};
   static const uint32_t kAllocationOverhead;
 
   const uint32_t capacity_{};
@@ -15,6 +15,7 @@
  */
 
 #include <folly/Random.h>
+#include <folly/ScopeGuard.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -392,6 +393,107 @@ TEST(BigHash, RemoveNotFound) {
   bh.remove(makeHK("key"));
 }
 
+TEST(BigHash, RemoveBatch) {
+  // A, C and D share the first bucket and B is in the second one, see
+  // WriteInTwoBuckets. The keys of the first bucket are removed with a
+  // single read and write.
+  BigHash::Config config;
+  setLayout(config, 128, 2);
+  auto device = std::make_unique<StrictMock<MockDevice>>(config.cacheSize, 128);
+  {
+    InSequence inSeq;
+    EXPECT_CALL(*device, allocatePlacementHandle());
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+    EXPECT_CALL(*device, readImpl(128, 128, _));
+    EXPECT_CALL(*device, writeImpl(128, 128, _, _));
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+    EXPECT_CALL(*device, readImpl(128, 128, _));
+    EXPECT_CALL(*device, writeImpl(128, 128, _, _));
+
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, readImpl(128, 128, _));
+  }
+  config.device = device.get();
+
+  BigHash bh(std::move(config));
+
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("12345")));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("B"), makeView("45678")));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("C"), makeView("67890")));
+
+  std::vector<HashedKey> keys{makeHK("A"), makeHK("B"), makeHK("D"),
+                              makeHK("C")};
+  std::vector<Status> statuses(keys.size(), Status::Retry);
+  bh.removeBatch(folly::range(keys), folly::range(statuses));
+  EXPECT_EQ(Status::Ok, statuses[0]);
+  EXPECT_EQ(Status::Ok, statuses[1]);
+  EXPECT_EQ(Status::NotFound, statuses[2]);
+  EXPECT_EQ(Status::Ok, statuses[3]);
+
+  Buffer value;
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("C"), value));
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("B"), value));
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_items"), 0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_removes"), 4));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_succ_removes"), 3));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_used_size_bytes"), 0));
+  bh.getCounters({toCallback(helper)});
+}
+
+TEST(BigHash, InsertBatch) {
+  // A and C share the first bucket and are written with a single read and
+  // write. B is alone in the second bucket and below the batch threshold.
+  BigHash::Config config;
+  setLayout(config, 128, 2);
+  auto device = std::make_unique<StrictMock<MockDevice>>(config.cacheSize, 128);
+  {
+    InSequence inSeq;
+    EXPECT_CALL(*device, allocatePlacementHandle());
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, readImpl(128, 128, _));
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+  }
+  config.device = device.get();
+
+  BigHash bh(std::move(config));
+
+  std::vector<HashedKey> keys{makeHK("A"), makeHK("B"), makeHK("C")};
+  std::vector<BufferView> values{makeView("12345"), makeView("45678"),
+                                 makeView("67890")};
+  std::vector<Status> statuses(keys.size(), Status::Retry);
+  bh.insertBatch(folly::range(keys), folly::range(values), 2,
+                 folly::range(statuses));
+  EXPECT_EQ(Status::Ok, statuses[0]);
+  EXPECT_EQ(Status::Rejected, statuses[1]);
+  EXPECT_EQ(Status::Ok, statuses[2]);
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("12345"), value.view());
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("B"), value));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("C"), value));
+  EXPECT_EQ(makeView("67890"), value.view());
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_items"), 2));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_inserts"), 2));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_succ_inserts"), 2));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_physical_written"), 128));
+  bh.getCounters({toCallback(helper)});
+}
+
 TEST(BigHash, CorruptBucket) {
   // Write a bucket, then corrupt a byte so we won't be able to read it
   BigHash::Config config;
@@ -443,6 +545,54 @@ TEST(BigHash, Recovery) {
   EXPECT_EQ(makeView("12345"), value.view());
 }
 
+TEST(BigHash, RecoveryPreviousVersion) {
+  BigHash::Config config;
+  config.cacheSize = 16 * 1024;
+  auto device = createMemoryDevice(config.cacheSize, nullptr /* encryption */);
+  config.device = device.get();
+
+  BigHash bh(std::move(config));
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("key"), makeView("12345")));
+
+  // Rewrite the persisted data as the previous format version did
+  auto& upgrader = BigHash::formatUpgrader();
+  const auto prevVersion = upgrader.getCurrentVersion() - 1;
+  folly::IOBufQueue queue;
+  {
+    folly::IOBufQueue current;
+    auto rw = createMemoryRecordWriter(current);
+    bh.persist(*rw);
+    auto rr = createMemoryRecordReader(current);
+    auto pd = deserializeProto<serialization::BigHashPersistentData>(*rr);
+    *pd.version() = static_cast<int32_t>(prevVersion);
+    auto prevRw = createMemoryRecordWriter(queue);
+    serializeProto(pd, *prevRw);
+  }
+  auto copy = queue.front()->clone();
+
+  bool upgraded = false;
+  upgrader.addStep(prevVersion,
+                   [&](serialization::BigHashPersistentData&) {
+                     upgraded = true;
+                   });
+  {
+    SCOPE_EXIT { upgrader.removeStep(prevVersion); };
+    auto rr = createMemoryRecordReader(queue);
+    ASSERT_TRUE(bh.recover(*rr));
+    EXPECT_TRUE(upgraded);
+    EXPECT_EQ(Status::Ok, bh.lookup(makeHK("key"), value));
+    EXPECT_EQ(makeView("12345"), value.view());
+  }
+
+  // Without the upgrade step the previous version is not recovered
+  folly::IOBufQueue prevQueue;
+  prevQueue.append(std::move(copy));
+  auto rr = createMemoryRecordReader(prevQueue);
+  ASSERT_FALSE(bh.recover(*rr));
+}
+
 TEST(BigHash, RecoveryBadConfig) {
   folly::IOBufQueue queue;
   {
@@ -689,6 +839,50 @@ TEST(BigHash, BloomFilterRecovery) {
   }
 }
 
+TEST(BigHash, BloomFilterRebuildOnRecovery) {
+  std::unique_ptr<Device> actual;
+  folly::IOBufQueue queue;
+  const uint32_t numBuckets = 16;
+
+  {
+    BigHash::Config config;
+    setLayout(config, 128, numBuckets);
+    auto device =
+        std::make_unique<NiceMock<MockDevice>>(config.cacheSize, 128);
+    config.device = device.get();
+    config.bloomFilter = std::make_unique<BloomFilter>(numBuckets, 1, 4);
+
+    BigHash bh(std::move(config));
+    for (uint32_t i = 0; i < 10; i++) {
+      auto key = "key_" + std::to_string(i);
+      EXPECT_EQ(Status::Ok, bh.insert(makeHK(key.c_str()), makeView("cat")));
+    }
+    auto rw = createMemoryRecordWriter(queue);
+    bh.persist(*rw);
+    actual = device->releaseRealDevice();
+  }
+
+  // the filters are resized and blocked now, they are rebuilt from the
+  // buckets and the items are kept
+  BigHash::Config config;
+  setLayout(config, 128, numBuckets);
+  auto device = std::make_unique<NiceMock<MockDevice>>(0, 128);
+  device->setRealDevice(std::move(actual));
+  EXPECT_CALL(*device, readImpl(_, 128, _)).Times(numBuckets);
+  config.device = device.get();
+  config.bloomFilter = std::make_unique<BloomFilter>(
+      BloomFilter::makeBlockedBloomFilter(numBuckets, 2, 64));
+  config.recoveryThreads = 3;
+
+  BigHash bh(std::move(config));
+  auto rr = createMemoryRecordReader(queue);
+  ASSERT_TRUE(bh.recover(*rr));
+  for (uint32_t i = 0; i < 10; i++) {
+    auto key = "key_" + std::to_string(i);
+    EXPECT_TRUE(bh.couldExist(makeHK(key.c_str())));
+  }
+}
+
 TEST(BigHash, DestructorCallbackOutsideLock) {
   BigHash::Config config;
   setLayout(config, 64, 1);
@@ -766,6 +960,200 @@ TEST(BigHash, RandomAlloc) {
   EXPECT_LT(stddev, avg * 0.2);
 }
 
+TEST(BigHash, TwoChoiceHashing) {
+  // the same keys fill the buckets more evenly when each key can go to the
+  // emptier of two buckets, so fewer of them are evicted
+  auto countFound = [](bool twoChoiceHashing) {
+    BigHash::Config config;
+    setLayout(config, 128, 64);
+    config.twoChoiceHashing = twoChoiceHashing;
+    auto device =
+        std::make_unique<NiceMock<MockDevice>>(config.cacheSize, 128);
+    config.device = device.get();
+    BigHash bh(std::move(config));
+
+    for (uint32_t i = 0; i < 256; i++) {
+      auto key = "key_" + std::to_string(i);
+      EXPECT_EQ(Status::Ok, bh.insert(makeHK(key.c_str()), makeView("12345")));
+    }
+    uint32_t found = 0;
+    Buffer value;
+    for (uint32_t i = 0; i < 256; i++) {
+      auto key = "key_" + std::to_string(i);
+      if (bh.lookup(makeHK(key.c_str()), value) == Status::Ok) {
+        EXPECT_EQ(makeView("12345"), value.view());
+        found++;
+      }
+    }
+    return found;
+  };
+  EXPECT_GT(countFound(true), countFound(false));
+}
+
+TEST(BigHash, TwoChoiceHashingReinsert) {
+  BigHash::Config config;
+  setLayout(config, 128, 32);
+  config.twoChoiceHashing = true;
+  auto device = std::make_unique<NiceMock<MockDevice>>(config.cacheSize, 128);
+  config.device = device.get();
+  config.bloomFilter = std::make_unique<BloomFilter>(32, 2, 4);
+  BigHash bh(std::move(config));
+
+  // inserting a key again drops the copy in the other bucket
+  Buffer value;
+  for (uint32_t i = 0; i < 5; i++) {
+    auto v = "value_" + std::to_string(i);
+    auto other = "other_" + std::to_string(i);
+    EXPECT_EQ(Status::Ok, bh.insert(makeHK("key"), makeView(v.c_str())));
+    EXPECT_EQ(Status::Ok, bh.insert(makeHK(other.c_str()), makeView("1")));
+    EXPECT_EQ(Status::Ok, bh.lookup(makeHK("key"), value));
+    EXPECT_EQ(makeView(v.c_str()), value.view());
+  }
+  EXPECT_TRUE(bh.couldExist(makeHK("key")));
+  EXPECT_EQ(Status::Ok, bh.remove(makeHK("key")));
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("key"), value));
+  EXPECT_EQ(Status::NotFound, bh.remove(makeHK("key")));
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_items"), 5));
+  bh.getCounters({toCallback(helper)});
+}
+
+TEST(BigHash, WriteBatching) {
+  BigHash::Config config;
+  setLayout(config, 128, 1);
+  config.writeBatchSize = 3;
+  config.stagingMemorySize = 1024 * 1024;
+  auto device = std::make_unique<StrictMock<MockDevice>>(config.cacheSize, 128);
+  {
+    InSequence inSeq;
+    EXPECT_CALL(*device, allocatePlacementHandle());
+    // the third staged item writes all of them at once
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+    // lookup of a written item
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    // remove of a staged item looks for an older copy on device
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    // lookup of the removed item
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+  }
+  config.device = device.get();
+
+  BigHash bh(std::move(config));
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("1")));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("B"), makeView("2")));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("1"), value.view());
+  // replaces the staged item
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("3")));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("3"), value.view());
+
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("C"), makeView("4")));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("3"), value.view());
+
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("D"), makeView("5")));
+  EXPECT_EQ(Status::Ok, bh.remove(makeHK("D")));
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("D"), value));
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_items"), 3));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_staged_items"), 0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_staged_bucket_writes"), 1));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_physical_written"), 128));
+  bh.getCounters({toCallback(helper)});
+}
+
+TEST(BigHash, WriteBatchingFlush) {
+  BigHash::Config config;
+  setLayout(config, 128, 2);
+  config.writeBatchSize = 4;
+  config.stagingMemorySize = 1024 * 1024;
+  auto device = std::make_unique<NiceMock<MockDevice>>(config.cacheSize, 128);
+  config.device = device.get();
+
+  MockDestructor helper;
+  EXPECT_CALL(helper,
+              call(makeHK("A"), makeView("1"), DestructorEvent::Removed));
+  config.destructorCb = toCallback(helper);
+
+  BigHash bh(std::move(config));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("1")));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("B"), makeView("2")));
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("3")));
+  bh.flush();
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("3"), value.view());
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("B"), value));
+  EXPECT_EQ(makeView("2"), value.view());
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(visitor, call(strPiece("navy_bh_items"), 2));
+  EXPECT_CALL(visitor, call(strPiece("navy_bh_staged_items"), 0));
+  bh.getCounters({toCallback(visitor)});
+}
+
+TEST(BigHash, WriteBatchingBadConfig) {
+  BigHash::Config config;
+  setLayout(config, 128, 2);
+  auto device = std::make_unique<NiceMock<MockDevice>>(config.cacheSize, 128);
+  config.device = device.get();
+  config.writeBatchSize = 4;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+
+  config.stagingMemorySize = 1024;
+  config.twoChoiceHashing = true;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+
+  config.twoChoiceHashing = false;
+  EXPECT_NO_THROW(config.validate());
+}
+
+TEST(BigHash, BucketCache) {
+  BigHash::Config config;
+  setLayout(config, 128, 2);
+  config.bucketCacheSize = 2 * 128;
+  auto device = std::make_unique<StrictMock<MockDevice>>(config.cacheSize, 128);
+  {
+    InSequence inSeq;
+    EXPECT_CALL(*device, allocatePlacementHandle());
+    // the bucket is read once and then served from the cache, which is
+    // refreshed by the writes
+    EXPECT_CALL(*device, readImpl(0, 128, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+    EXPECT_CALL(*device, writeImpl(0, 128, _, _));
+  }
+  config.device = device.get();
+
+  BigHash bh(std::move(config));
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("12345")));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("12345"), value.view());
+  EXPECT_EQ(Status::Ok, bh.insert(makeHK("A"), makeView("67890")));
+  EXPECT_EQ(Status::Ok, bh.lookup(makeHK("A"), value));
+  EXPECT_EQ(makeView("67890"), value.view());
+  EXPECT_EQ(Status::Ok, bh.remove(makeHK("A")));
+  EXPECT_EQ(Status::NotFound, bh.lookup(makeHK("A"), value));
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_bucket_cache_hits"), 5));
+  EXPECT_CALL(helper, call(strPiece("navy_bh_bucket_cache_misses"), 1));
+  bh.getCounters({toCallback(helper)});
+}
+
 // Make sure estimate write size always returns the bucket size.
 // Modify this test if we change the implementation.
 TEST(BigHash, EstimateWriteSize) {
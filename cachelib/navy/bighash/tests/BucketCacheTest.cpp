@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/navy/bighash/BucketCache.h"
+#include "cachelib/navy/testing/BufferGen.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+constexpr uint32_t kBucketSize = 256;
+} // namespace
+
+TEST(BucketCache, InvalidConfig) {
+  EXPECT_THROW(BucketCache(kBucketSize, 0), std::invalid_argument);
+}
+
+TEST(BucketCache, InsertLookup) {
+  BucketCache cache{kBucketSize, 64};
+  BufferGen bg;
+  auto data = bg.gen(kBucketSize);
+
+  Buffer buf{kBucketSize};
+  EXPECT_FALSE(cache.lookup(1, buf.mutableView()));
+  cache.insert(1, data.view());
+  EXPECT_TRUE(cache.lookup(1, buf.mutableView()));
+  EXPECT_EQ(data.view(), buf.view());
+  EXPECT_FALSE(cache.lookup(2, buf.mutableView()));
+
+  // updates replace cached buckets only
+  auto newData = bg.gen(kBucketSize);
+  cache.update(1, newData.view());
+  cache.update(2, newData.view());
+  EXPECT_TRUE(cache.lookup(1, buf.mutableView()));
+  EXPECT_EQ(newData.view(), buf.view());
+  EXPECT_FALSE(cache.lookup(2, buf.mutableView()));
+
+  cache.invalidate(1);
+  EXPECT_FALSE(cache.lookup(1, buf.mutableView()));
+
+  cache.insert(3, data.view());
+  cache.reset();
+  EXPECT_FALSE(cache.lookup(3, buf.mutableView()));
+}
+
+TEST(BucketCache, ClockEviction) {
+  // a single slot per shard, buckets 0 and 32 share a shard
+  BucketCache cache{kBucketSize, 32};
+  BufferGen bg;
+  auto data = bg.gen(kBucketSize);
+  Buffer buf{kBucketSize};
+
+  cache.insert(0, data.view());
+  cache.insert(32, data.view());
+  EXPECT_FALSE(cache.lookup(0, buf.mutableView()));
+  EXPECT_TRUE(cache.lookup(32, buf.mutableView()));
+
+  // two slots per shard: a referenced bucket survives the next insert
+  BucketCache cache2{kBucketSize, 64};
+  cache2.insert(0, data.view());
+  cache2.insert(32, data.view());
+  EXPECT_TRUE(cache2.lookup(0, buf.mutableView()));
+  cache2.insert(64, data.view());
+  EXPECT_TRUE(cache2.lookup(0, buf.mutableView()));
+  EXPECT_FALSE(cache2.lookup(32, buf.mutableView()));
+  EXPECT_TRUE(cache2.lookup(64, buf.mutableView()));
+}
+
+TEST(BucketCache, Counters) {
+  BucketCache cache{kBucketSize, 64};
+  BufferGen bg;
+  auto data = bg.gen(kBucketSize);
+  Buffer buf{kBucketSize};
+  cache.insert(1, data.view());
+  cache.insert(2, data.view());
+  cache.lookup(1, buf.mutableView());
+  cache.lookup(3, buf.mutableView());
+  cache.invalidate(2);
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t buckets = 0;
+  cache.getCounters([&](folly::StringPiece name, double val) {
+    if (name == "navy_bh_bucket_cache_hits") {
+      hits = static_cast<uint64_t>(val);
+    } else if (name == "navy_bh_bucket_cache_misses") {
+      misses = static_cast<uint64_t>(val);
+    } else if (name == "navy_bh_bucket_cache_buckets") {
+      buckets = static_cast<uint64_t>(val);
+    }
+  });
+  EXPECT_EQ(1, hits);
+  EXPECT_EQ(1, misses);
+  EXPECT_EQ(1, buckets);
+}
+} // namespace facebook::cachelib::navy::tests
@@ -196,4 +196,62 @@ TEST(BucketStorage, RemoveUntil) {
   EXPECT_TRUE(checkContent(itr1.view(), '4'));
   EXPECT_TRUE(itr2.done());
 }
+
+TEST(BucketStorage, Tags) {
+  const uint32_t capacity = BucketStorage::kMinTaggedCapacity;
+  Buffer buf(capacity + sizeof(BucketStorage));
+  auto* allocator = new (buf.data()) BucketStorage(capacity);
+
+  // 40 allocations span three tag groups, tag i % 4
+  const uint32_t numAllocs = 40;
+  for (uint32_t i = 0; i < numAllocs; i++) {
+    auto v = allocator->allocate(4, static_cast<uint8_t>(i % 4));
+    ASSERT_FALSE(v.done());
+    std::fill(v.view().data(), v.view().dataEnd(), static_cast<uint8_t>(i));
+  }
+  EXPECT_EQ(capacity - numAllocs * allocator->requiredSpace(4),
+            allocator->remainingCapacity());
+
+  auto findValue = [allocator](uint8_t tag, uint8_t value) {
+    uint32_t compared = 0;
+    auto alloc = allocator->find(tag, [&](BucketStorage::Allocation a) {
+      compared++;
+      return a.view().data()[0] == value;
+    });
+    return std::make_pair(alloc, compared);
+  };
+  // only the allocations with the tag are compared
+  auto [alloc, compared] = findValue(3, 39);
+  ASSERT_FALSE(alloc.done());
+  EXPECT_EQ(39, alloc.position());
+  EXPECT_EQ(10, compared);
+  std::tie(alloc, compared) = findValue(4, 0);
+  EXPECT_TRUE(alloc.done());
+  EXPECT_EQ(0, compared);
+
+  // removing keeps the tags of the remaining allocations in order
+  allocator->remove({allocator->getFirst(),
+                     allocator->getNext(allocator->getFirst())});
+  std::tie(alloc, compared) = findValue(2, 2);
+  ASSERT_FALSE(alloc.done());
+  EXPECT_EQ(0, alloc.position());
+  EXPECT_TRUE(checkContent(alloc.view(), 2));
+  std::tie(alloc, compared) = findValue(1, 37);
+  ASSERT_FALSE(alloc.done());
+  EXPECT_EQ(35, alloc.position());
+  EXPECT_TRUE(findValue(0, 0).first.done());
+
+  // drop everything up to and including the allocation with value 20
+  std::tie(alloc, compared) = findValue(0, 20);
+  allocator->removeUntil(alloc);
+  EXPECT_EQ(numAllocs - 21, allocator->numAllocations());
+  for (uint32_t i = 21; i < numAllocs; i++) {
+    std::tie(alloc, compared) = findValue(i % 4, i);
+    ASSERT_FALSE(alloc.done());
+    EXPECT_EQ(i - 21, alloc.position());
+    EXPECT_TRUE(checkContent(alloc.view(), i));
+  }
+  EXPECT_EQ(capacity - (numAllocs - 21) * allocator->requiredSpace(4),
+            allocator->remainingCapacity());
+}
 } // namespace facebook::cachelib::navy::tests
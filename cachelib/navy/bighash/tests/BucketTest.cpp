@@ -386,4 +386,48 @@ TEST(Bucket, EvictionExpired) {
     }
   }
 }
+
+TEST(Bucket, TaggedFind) {
+  // large enough for the entries to be tagged
+  Buffer buf(4096);
+  auto& bucket = Bucket::initNew(buf.mutableView(), 0);
+
+  char keyStr[64];
+  char valueStr[64];
+  uint32_t numItems = 0;
+  uint32_t numEvicted = 0;
+  while (numEvicted == 0) {
+    sprintf(keyStr, "key %d", numItems);
+    sprintf(valueStr, "value %d", numItems);
+    numEvicted =
+        bucket.insert(makeHK(keyStr), makeView(valueStr), nullptr, nullptr)
+            .first;
+    numItems++;
+  }
+  // the first keys were evicted to make space for the last one
+  EXPECT_EQ(numItems - numEvicted, bucket.size());
+  for (uint32_t i = 0; i < numItems; i++) {
+    sprintf(keyStr, "key %d", i);
+    sprintf(valueStr, "value %d", i);
+    if (i < numEvicted) {
+      EXPECT_TRUE(bucket.find(makeHK(keyStr)).isNull());
+    } else {
+      EXPECT_EQ(makeView(valueStr), bucket.find(makeHK(keyStr)));
+    }
+  }
+
+  for (uint32_t i = numEvicted; i < numItems; i += 2) {
+    sprintf(keyStr, "key %d", i);
+    EXPECT_EQ(1, bucket.remove(makeHK(keyStr), nullptr));
+  }
+  for (uint32_t i = numEvicted; i < numItems; i++) {
+    sprintf(keyStr, "key %d", i);
+    sprintf(valueStr, "value %d", i);
+    if ((i - numEvicted) % 2 == 0) {
+      EXPECT_TRUE(bucket.find(makeHK(keyStr)).isNull());
+    } else {
+      EXPECT_EQ(makeView(valueStr), bucket.find(makeHK(keyStr)));
+    }
+  }
+}
 } // namespace facebook::cachelib::navy::tests
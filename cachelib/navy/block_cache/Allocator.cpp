@@ -19,6 +19,7 @@
 #include <folly/Format.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
 #include <cassert>
 #include <utility>
 
@@ -34,27 +35,49 @@ void RegionAllocator::setAllocationRegion(RegionId rid) {
 
 void RegionAllocator::reset() { rid_ = RegionId{}; }
 
-Allocator::Allocator(RegionManager& regionManager, uint16_t numPriorities)
-    : regionManager_{regionManager} {
+Allocator::Allocator(RegionManager& regionManager,
+                     uint16_t numPriorities,
+                     std::vector<uint32_t> streamSizeLimits)
+    : regionManager_{regionManager},
+      streamSizeLimits_{std::move(streamSizeLimits)},
+      numStreams_{static_cast<uint32_t>(streamSizeLimits_.size()) + 1} {
+  for (size_t i = 0; i < streamSizeLimits_.size(); i++) {
+    if (streamSizeLimits_[i] == 0 ||
+        (i > 0 && streamSizeLimits_[i] <= streamSizeLimits_[i - 1])) {
+      throw std::invalid_argument(folly::sformat(
+          "Stream size limits must be positive and ascending, got {} after {}",
+          streamSizeLimits_[i], i > 0 ? streamSizeLimits_[i - 1] : 0));
+    }
+  }
   XLOGF(INFO,
         "Enable priority-based allocation for Allocator. Number of "
-        "priorities: {}",
-        numPriorities);
+        "priorities: {}, number of size streams: {}",
+        numPriorities,
+        numStreams_);
   for (uint16_t i = 0; i < numPriorities; i++) {
-    allocators_.emplace_back(i /* priority */);
+    for (uint32_t j = 0; j < numStreams_; j++) {
+      allocators_.emplace_back(i /* priority */);
+    }
   }
 }
 
+uint32_t Allocator::getStream(uint32_t size) const {
+  return static_cast<uint32_t>(std::lower_bound(streamSizeLimits_.begin(),
+                                                streamSizeLimits_.end(),
+                                                size) -
+                               streamSizeLimits_.begin());
+}
+
 std::tuple<RegionDescriptor, uint32_t, RelAddress> Allocator::allocate(
     uint32_t size, uint16_t priority, bool canWait) {
-  XDCHECK_LT(priority, allocators_.size());
-  RegionAllocator* ra = &allocators_[priority];
+  XDCHECK_LT(priority * numStreams_, allocators_.size());
+  RegionAllocator* ra = &allocators_[priority * numStreams_ + getStream(size)];
   if (size == 0 || size > regionManager_.regionSize()) {
     return std::make_tuple(RegionDescriptor{OpenStatus::Error}, size,
                            RelAddress());
   }
   return allocateWith(*ra, size, canWait);
-} // namespace cachelib
+}
 
 // Allocates using region allocator @ra. If region is full, we take another
 // from the clean list (regions ready for allocation) If the clean list is
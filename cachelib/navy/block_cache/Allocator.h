@@ -22,6 +22,7 @@
 #include <functional>
 #include <memory>
 #include <stdexcept>
+#include <tuple>
 #include <vector>
 
 #include "cachelib/common/AtomicCounter.h"
@@ -81,8 +82,15 @@ class Allocator {
   //                          locking regions
   // @param numPriorities     Specifies how many priorities this allocator
   //                          supports
+  // @param streamSizeLimits  Ascending item size limits of the allocation
+  //                          streams. Allocations up to streamSizeLimits[i]
+  //                          bytes, and above the previous limit, go to
+  //                          stream i, larger ones to a last stream. Every
+  //                          stream of every priority writes its own region.
   // Throws std::exception if invalid arguments
-  explicit Allocator(RegionManager& regionManager, uint16_t numPriorities);
+  Allocator(RegionManager& regionManager,
+            uint16_t numPriorities,
+            std::vector<uint32_t> streamSizeLimits = {});
 
   // Allocates and opens for writing.
   //
@@ -130,8 +138,14 @@ class Allocator {
   std::tuple<RegionDescriptor, uint32_t, RelAddress> allocateWith(
       RegionAllocator& ra, uint32_t size, bool wait);
 
+  // Returns the index of the stream allocations of @size go to.
+  uint32_t getStream(uint32_t size) const;
+
   RegionManager& regionManager_;
-  // Multiple allocators when we use priority-based allocation
+  const std::vector<uint32_t> streamSizeLimits_;
+  const uint32_t numStreams_{};
+  // One allocator per priority and stream, streams of a priority next to
+  // each other
   std::vector<RegionAllocator> allocators_;
 
   mutable AtomicCounter allocRetryWaits_;
@@ -16,16 +16,23 @@
 
 #include "cachelib/navy/block_cache/BlockCache.h"
 
+#include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/logging/xlog.h>
 
 #include <algorithm>
 #include <cstring>
 #include <numeric>
+#include <tuple>
 #include <utility>
 
+#include "cachelib/common/Time.h"
+#include "cachelib/common/Tracepoints.h"
 #include "cachelib/common/inject_pause.h"
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
 #include "cachelib/navy/common/Hash.h"
+#include "cachelib/navy/common/LookupTrace.h"
 #include "cachelib/navy/common/Types.h"
 #include "folly/Range.h"
 
@@ -60,20 +67,104 @@ BlockCache::Config& BlockCache::Config::validate() {
   if (getNumRegions() < cleanRegionsPool) {
     throw std::invalid_argument("not enough space on device");
   }
+  if (maxCleanRegionsPool != 0 && (maxCleanRegionsPool < cleanRegionsPool ||
+                                   maxCleanRegionsPool > getNumRegions())) {
+    throw std::invalid_argument(folly::sformat(
+        "Max clean regions pool {} should be in the range of [{}, {}]",
+        maxCleanRegionsPool,
+        cleanRegionsPool,
+        getNumRegions()));
+  }
+  if (readPageCacheSize != 0 &&
+      readPageCacheSize < device->getIOAlignmentSize()) {
+    throw std::invalid_argument(folly::sformat(
+        "Read page cache size {} is smaller than a device page of {} bytes",
+        readPageCacheSize,
+        device->getIOAlignmentSize()));
+  }
+  if (flushedRegionCacheSize != 0 && flushedRegionCacheSize < regionSize) {
+    throw std::invalid_argument(folly::sformat(
+        "Flushed region cache size {} is smaller than a region of {} bytes",
+        flushedRegionCacheSize,
+        regionSize));
+  }
   if (numInMemBuffers == 0) {
     throw std::invalid_argument("there must be at least one in-mem buffers");
   }
   if (numPriorities == 0) {
     throw std::invalid_argument("allocator must have at least one priority");
   }
+  if (lookupChecksumPct > 100) {
+    throw std::invalid_argument(folly::sformat(
+        "lookup checksum percentage should be between 0 and 100, but {} is "
+        "set",
+        lookupChecksumPct));
+  }
+  if (!streamSizeLimits.empty()) {
+    if (streamSizeLimits.back() >= regionSize) {
+      throw std::invalid_argument(folly::sformat(
+          "stream size limit {} should be less than the region size {}",
+          streamSizeLimits.back(),
+          regionSize));
+    }
+    // every stream of every priority keeps a region with a buffer open
+    const auto numOpenRegions =
+        numPriorities * (streamSizeLimits.size() + 1);
+    if (numInMemBuffers <= numOpenRegions) {
+      throw std::invalid_argument(folly::sformat(
+          "{} in-mem buffers are not enough for {} open regions",
+          numInMemBuffers,
+          numOpenRegions));
+    }
+  }
 
   reinsertionConfig.validate();
+  if (fixedSizeIndexItems > 0 &&
+      reinsertionConfig.getHitsThreshold() > FixedSizeIndex::kMaxHits) {
+    throw std::invalid_argument(folly::sformat(
+        "hits based reinsertion threshold {} is above the {} hits the fixed "
+        "size index can count",
+        reinsertionConfig.getHitsThreshold(),
+        FixedSizeIndex::kMaxHits));
+  }
+  if (packedEntryAlignSize != 0 &&
+      (!folly::isPowTwo(packedEntryAlignSize) ||
+       packedEntryAlignSize < folly::nextPowTwo(sizeof(EntryDesc)) ||
+       packedEntryAlignSize >= kMinAllocAlignSize)) {
+    throw std::invalid_argument(folly::sformat(
+        "packed entry alignment {} should be a power of two in [{}, {})",
+        packedEntryAlignSize,
+        folly::nextPowTwo(sizeof(EntryDesc)),
+        kMinAllocAlignSize));
+  }
+  if (fixedSizeIndexItems > 0 &&
+      reinsertionConfig.getReuseThreshold() > FixedSizeIndex::kMaxHits) {
+    throw std::invalid_argument(folly::sformat(
+        "reuse based reinsertion threshold {} is above the {} hits the fixed "
+        "size index can count",
+        reinsertionConfig.getReuseThreshold(),
+        FixedSizeIndex::kMaxHits));
+  }
+  if (!indexCheckpointFile.empty() && fixedSizeIndexItems > 0) {
+    throw std::invalid_argument(
+        "index checkpoints are not supported with the fixed size index");
+  }
+  if (flatIndexPersistence && fixedSizeIndexItems > 0) {
+    throw std::invalid_argument(
+        "flat index persistence is not supported with the fixed size index");
+  }
+  if (indexCheckpointFile.empty() &&
+      (lazyIndexRecovery || indexCheckpointInterval.count() > 0)) {
+    throw std::invalid_argument(
+        "lazy index recovery and periodic index checkpoints need an index "
+        "checkpoint file");
+  }
 
   return *this;
 }
 
 void BlockCache::validate(BlockCache::Config& config) const {
-  uint32_t allocAlignSize = calcAllocAlignSize();
+  uint32_t allocAlignSize = calcAllocAlignSize(config.packedEntryAlignSize);
   if (!folly::isPowTwo(allocAlignSize)) {
     throw std::invalid_argument("invalid block size");
   }
@@ -88,7 +179,7 @@ void BlockCache::validate(BlockCache::Config& config) const {
   }
 }
 
-uint32_t BlockCache::calcAllocAlignSize() const {
+uint32_t BlockCache::calcAllocAlignSize(uint32_t minAllocAlignSize) const {
   // Shift the total device size by <RelAddressWidth-in-bits>,
   // to determine the size of the alloc alignment the device can support
   auto shiftWidth =
@@ -96,8 +187,11 @@ uint32_t BlockCache::calcAllocAlignSize() const {
 
   uint32_t allocAlignSize =
       static_cast<uint32_t>(device_.getSize() >> shiftWidth);
-  if (allocAlignSize == 0 || allocAlignSize <= kMinAllocAlignSize) {
-    return kMinAllocAlignSize;
+  if (minAllocAlignSize == 0) {
+    minAllocAlignSize = kMinAllocAlignSize;
+  }
+  if (allocAlignSize == 0 || allocAlignSize <= minAllocAlignSize) {
+    return minAllocAlignSize;
   }
   if (folly::isPowTwo(allocAlignSize)) { // already power of 2
     return allocAlignSize;
@@ -115,17 +209,27 @@ BlockCache::BlockCache(Config&& config)
 BlockCache::BlockCache(Config&& config, ValidConfigTag)
     : config_{serializeConfig(config)},
       numPriorities_{config.numPriorities},
+      minReinsertionPriority_{static_cast<uint16_t>(
+          config.placementByPriority && config.numPriorities > 1 ? 1 : 0)},
       checkExpired_{std::move(config.checkExpired)},
+      getExpiryTime_{std::move(config.getExpiryTime)},
       destructorCb_{std::move(config.destructorCb)},
       checksumData_{config.checksum},
+      lookupChecksumPct_{config.lookupChecksumPct},
       device_{*config.device},
-      allocAlignSize_{calcAllocAlignSize()},
+      allocAlignSize_{calcAllocAlignSize(config.packedEntryAlignSize)},
       readBufferSize_{config.readBufferSize < kDefReadBufferSize
                           ? kDefReadBufferSize
                           : config.readBufferSize},
       regionSize_{config.regionSize},
       itemDestructorEnabled_{config.itemDestructorEnabled},
       preciseRemove_{config.preciseRemove},
+      index_{makeIndex(config)},
+      indexCheckpointer_{config.indexCheckpointFile.empty()
+                             ? nullptr
+                             : std::make_unique<IndexCheckpointer>(
+                                   *index_, config.indexCheckpointFile)},
+      lazyIndexRecovery_{config.lazyIndexRecovery},
       regionManager_{config.getNumRegions(),
                      config.regionSize,
                      config.cacheBaseOffset,
@@ -138,25 +242,55 @@ BlockCache::BlockCache(Config&& config, ValidConfigTag)
                      std::move(config.evictionPolicy),
                      config.numInMemBuffers,
                      config.numPriorities,
-                     config.inMemBufFlushRetryLimit},
-      allocator_{regionManager_, config.numPriorities},
-      reinsertionPolicy_{makeReinsertionPolicy(config.reinsertionConfig)} {
+                     config.inMemBufFlushRetryLimit,
+                     config.maxCleanRegionsPool,
+                     config.readPageCacheSize /
+                         config.device->getIOAlignmentSize(),
+                     static_cast<uint32_t>(config.flushedRegionCacheSize /
+                                           config.regionSize),
+                     config.placementByPriority},
+      allocator_{regionManager_, config.numPriorities,
+                 config.streamSizeLimits},
+      reinsertionPolicy_{makeReinsertionPolicy(config.reinsertionConfig)},
+      expiryRanges_{getExpiryTime_ ? std::make_unique<ExpiryRange[]>(
+                                         config.getNumRegions())
+                                   : nullptr} {
   validate(config);
+  if (indexCheckpointer_ && config.indexCheckpointInterval.count() > 0) {
+    indexCheckpointer_->start(config.indexCheckpointInterval,
+                              "navy_bc_index_checkpoint");
+  }
   XLOG(INFO, "Block cache created");
   XDCHECK_NE(readBufferSize_, 0u);
 }
+
+std::unique_ptr<Index> BlockCache::makeIndex(const Config& config) {
+  if (config.fixedSizeIndexItems > 0) {
+    return std::make_unique<FixedSizeIndex>(
+        FixedSizeIndex::numBucketsFor(config.fixedSizeIndexItems));
+  }
+  return std::make_unique<SparseMapIndex>(config.indexRecoveryThreads,
+                                          config.flatIndexPersistence);
+}
+
 std::shared_ptr<BlockCacheReinsertionPolicy> BlockCache::makeReinsertionPolicy(
     const BlockCacheReinsertionConfig& reinsertionConfig) {
   auto hitsThreshold = reinsertionConfig.getHitsThreshold();
   if (hitsThreshold) {
-    return std::make_shared<HitsReinsertionPolicy>(hitsThreshold, index_);
+    return std::make_shared<HitsReinsertionPolicy>(hitsThreshold, *index_);
   }
 
   auto pctThreshold = reinsertionConfig.getPctThreshold();
   if (pctThreshold) {
     return std::make_shared<PercentageReinsertionPolicy>(pctThreshold);
   }
-  return reinsertionConfig.getCustomPolicy(index_);
+
+  auto reuseThreshold = reinsertionConfig.getReuseThreshold();
+  if (reuseThreshold) {
+    return std::make_shared<ReuseReinsertionPolicy>(
+        reuseThreshold, reinsertionConfig.getReuseMaxBytesPerSec(), *index_);
+  }
+  return reinsertionConfig.getCustomPolicy(*index_);
 }
 
 uint32_t BlockCache::serializedSize(uint32_t keySize,
@@ -197,7 +331,7 @@ Status BlockCache::insert(HashedKey hk, BufferView value) {
   const auto status = writeEntry(addr, slotSize, hk, value);
   auto newObjSizeHint = encodeSizeHint(slotSize);
   if (status == Status::Ok) {
-    const auto lr = index_.insert(
+    const auto lr = index_->insert(
         hk.keyHash(), encodeRelAddress(addr.add(slotSize)), newObjSizeHint);
     // We replaced an existing key in the index
     uint64_t newObjSize = decodeSizeHint(newObjSizeHint);
@@ -221,7 +355,7 @@ Status BlockCache::insert(HashedKey hk, BufferView value) {
 }
 
 bool BlockCache::couldExist(HashedKey hk) {
-  const auto lr = index_.lookup(hk.keyHash());
+  const auto lr = index_->lookup(hk.keyHash());
   if (!lr.found()) {
     lookupCount_.inc();
     return false;
@@ -234,8 +368,14 @@ uint64_t BlockCache::estimateWriteSize(HashedKey hk, BufferView value) const {
 }
 
 Status BlockCache::lookup(HashedKey hk, Buffer& value) {
+  // the fiber can be suspended while opening the region, so the trace is
+  // made current again afterwards
+  auto* trace = LookupTrace::current();
   const auto seqNumber = regionManager_.getSeqNumber();
-  const auto lr = index_.lookup(hk.keyHash());
+  const auto lr = index_->lookup(hk.keyHash());
+  if (trace) {
+    trace->stamp(LookupTrace::kIndexed);
+  }
   if (!lr.found()) {
     lookupCount_.inc();
     return Status::NotFound;
@@ -244,6 +384,10 @@ Status BlockCache::lookup(HashedKey hk, Buffer& value) {
   // previous region (this is address of its end). To compensate for this, we
   // subtract 1 before conversion and add after to relative address.
   auto addrEnd = decodeRelAddress(lr.address());
+  if (dropIfRegionExpired(hk, lr, addrEnd.rid(), seqNumber)) {
+    lookupCount_.inc();
+    return Status::NotFound;
+  }
   // Between acquring @seqNumber and @openForRead reclamation may start. There
   // are two options what can happen in @openForRead:
   //  - Reclamation in progress and open will fail because access mask disables
@@ -254,35 +398,14 @@ Status BlockCache::lookup(HashedKey hk, Buffer& value) {
   RegionDescriptor desc = regionManager_.openForRead(addrEnd.rid(), seqNumber);
   switch (desc.status()) {
   case OpenStatus::Ready: {
-    auto status =
-        readEntry(desc, addrEnd, decodeSizeHint(lr.sizeHint()), hk, value);
-
-    if (FOLLY_UNLIKELY(status == Status::DeviceError)) {
-      // In case we are getting transient checksum error, we will retry to read
-      // the entry (S421120)
-      status =
-          readEntry(desc, addrEnd, decodeSizeHint(lr.sizeHint()), hk, value);
-      XLOGF(ERR,
-            "Retry reading an entry after checksum error. Return code: "
-            "{}",
-            status);
-      retryReadCount_.inc();
-
-      if (status != Status::Ok) {
-        // Still failing. Remove this item from index so no future lookup will
-        // ever attempt to read this key. Reclaim will also not be
-        // able to re-insert this item as it does not exist in index.
-        index_.remove(hk.keyHash());
-      }
+    LookupTrace::setCurrent(trace);
+    const auto approxSize = decodeSizeHint(lr.sizeHint());
+    auto status = readEntry(desc, addrEnd, approxSize, hk, value);
+    if (trace) {
+      trace->stamp(LookupTrace::kChecksummed);
     }
-
-    if (status == Status::Ok) {
-      regionManager_.touch(addrEnd.rid());
-      succLookupCount_.inc();
-    }
-    regionManager_.close(std::move(desc));
-    lookupCount_.inc();
-    return status;
+    return completeLookup(std::move(desc), addrEnd, approxSize, hk, value,
+                          status);
   }
   case OpenStatus::Retry:
     return Status::Retry;
@@ -293,6 +416,149 @@ Status BlockCache::lookup(HashedKey hk, Buffer& value) {
   }
 }
 
+void BlockCache::lookupBatch(folly::Range<const HashedKey*> hks,
+                             folly::Range<Buffer*> values,
+                             folly::Range<Status*> statuses) {
+  XDCHECK_EQ(hks.size(), values.size());
+  XDCHECK_EQ(hks.size(), statuses.size());
+
+  // An entry found in the index whose region is open for read
+  struct PendingEntry {
+    size_t idx;
+    RelAddress addrEnd;
+    uint32_t approxSize;
+    RegionDescriptor desc;
+    // offset of the first byte to read within the region
+    uint32_t begin() const { return addrEnd.offset() - approxSize; }
+  };
+
+  // Resolve all the keys against the index first. See @lookup about the
+  // sequence number.
+  const auto seqNumber = regionManager_.getSeqNumber();
+  std::vector<PendingEntry> entries;
+  entries.reserve(hks.size());
+  for (size_t i = 0; i < hks.size(); i++) {
+    const auto lr = index_->lookup(hks[i].keyHash());
+    if (!lr.found()) {
+      lookupCount_.inc();
+      statuses[i] = Status::NotFound;
+      continue;
+    }
+    auto addrEnd = decodeRelAddress(lr.address());
+    if (dropIfRegionExpired(hks[i], lr, addrEnd.rid(), seqNumber)) {
+      lookupCount_.inc();
+      statuses[i] = Status::NotFound;
+      continue;
+    }
+    RegionDescriptor desc =
+        regionManager_.openForRead(addrEnd.rid(), seqNumber);
+    if (desc.status() != OpenStatus::Ready) {
+      // Open region never returns other statuses than Ready and Retry
+      XDCHECK(desc.status() == OpenStatus::Retry);
+      statuses[i] = Status::Retry;
+      continue;
+    }
+    // Same as in @readEntry, never read past the region's beginning
+    const auto approxSize =
+        std::min(decodeSizeHint(lr.sizeHint()), addrEnd.offset());
+    entries.push_back(PendingEntry{i, addrEnd, approxSize, std::move(desc)});
+  }
+
+  // Order the entries by their position on the device so that the entries
+  // whose device reads touch in the same region can be read at once. Entries
+  // read from an in memory buffer are only copied, so they are never merged.
+  std::sort(entries.begin(), entries.end(),
+            [](const PendingEntry& a, const PendingEntry& b) {
+              return std::make_tuple(a.addrEnd.rid().index(), a.begin()) <
+                     std::make_tuple(b.addrEnd.rid().index(), b.begin());
+            });
+  std::vector<RegionManager::BatchRead> reads;
+  // number of entries served from each read
+  std::vector<uint32_t> readNumEntries;
+  // index of the read each entry is served from
+  std::vector<size_t> entryRead(entries.size());
+  // the device reads whole blocks of this size, so merging reads within a
+  // block apart costs no extra device bytes
+  const uint32_t readAlignSize = device_.getReadAlignmentSize();
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto& entry = entries[i];
+    if (!reads.empty() && reads.back().desc->isPhysReadMode() &&
+        entry.desc.isPhysReadMode() &&
+        reads.back().addr.rid() == entry.addrEnd.rid() &&
+        powTwoAlign(reads.back().addr.offset() + reads.back().size,
+                    readAlignSize) >=
+            (entry.begin() & ~(readAlignSize - 1))) {
+      auto& read = reads.back();
+      read.size = std::max<size_t>(read.size,
+                                   entry.addrEnd.offset() - read.addr.offset());
+      readNumEntries.back()++;
+      entryRead[i] = reads.size() - 1;
+      continue;
+    }
+    reads.push_back(RegionManager::BatchRead{
+        &entry.desc, entry.addrEnd.sub(entry.approxSize), entry.approxSize});
+    readNumEntries.push_back(1);
+    entryRead[i] = reads.size() - 1;
+  }
+
+  regionManager_.readBatch(folly::range(reads));
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto& entry = entries[i];
+    auto& read = reads[entryRead[i]];
+    // A failed read leaves the buffer null, which fails the entry with a
+    // device error and has it read again on its own by completeLookup.
+    Buffer buffer;
+    if (!read.buffer.isNull()) {
+      buffer = readNumEntries[entryRead[i]] == 1
+                   ? std::move(read.buffer)
+                   : Buffer{BufferView{entry.approxSize,
+                                       read.buffer.data() +
+                                           (entry.begin() -
+                                            read.addr.offset())}};
+    }
+    const auto& hk = hks[entry.idx];
+    auto status = decodeEntry(entry.desc, entry.addrEnd, hk, std::move(buffer),
+                              values[entry.idx]);
+    statuses[entry.idx] =
+        completeLookup(std::move(entry.desc), entry.addrEnd, entry.approxSize,
+                       hk, values[entry.idx], status);
+  }
+}
+
+Status BlockCache::completeLookup(RegionDescriptor readDesc,
+                                  RelAddress addrEnd,
+                                  uint32_t approxSize,
+                                  HashedKey hk,
+                                  Buffer& value,
+                                  Status status) {
+  if (FOLLY_UNLIKELY(status == Status::DeviceError)) {
+    // In case we are getting transient checksum error, we will retry to read
+    // the entry (S421120)
+    status = readEntry(readDesc, addrEnd, approxSize, hk, value);
+    XLOGF(ERR,
+          "Retry reading an entry after checksum error. Return code: "
+          "{}",
+          status);
+    retryReadCount_.inc();
+
+    if (status != Status::Ok) {
+      // Still failing. Remove this item from index so no future lookup will
+      // ever attempt to read this key. Reclaim will also not be
+      // able to re-insert this item as it does not exist in index.
+      index_->remove(hk.keyHash());
+    }
+  }
+
+  if (status == Status::Ok) {
+    regionManager_.touch(addrEnd.rid());
+    succLookupCount_.inc();
+  }
+  regionManager_.close(std::move(readDesc));
+  lookupCount_.inc();
+  return status;
+}
+
 std::pair<Status, std::string> BlockCache::getRandomAlloc(Buffer& value) {
   // Get rendom region and offset within the region
   auto rid = regionManager_.getRandomRegion();
@@ -368,7 +634,7 @@ std::pair<Status, std::string> BlockCache::getRandomAlloc(Buffer& value) {
     // confirm that the chosen NvmItem is still being mapped with the key
     HashedKey hk =
         makeHK(entryEnd - sizeof(EntryDesc) - desc.keySize, desc.keySize);
-    const auto lr = index_.lookup(hk.keyHash());
+    const auto lr = index_->lookup(hk.keyHash());
     if (!lr.found() || addrEnd != decodeRelAddress(lr.address())) {
       // overwritten
       break;
@@ -408,7 +674,7 @@ Status BlockCache::remove(HashedKey hk) {
     }
   }
 
-  auto lr = index_.remove(hk.keyHash());
+  auto lr = index_->remove(hk.keyHash());
   if (lr.found()) {
     uint64_t removedObjectSize = decodeSizeHint(lr.sizeHint());
     holeSizeTotal_.add(removedObjectSize);
@@ -437,6 +703,14 @@ uint32_t BlockCache::onRegionReclaim(RegionId rid, BufferView buffer) {
   uint32_t evictionCount = 0; // item that was evicted during reclaim
   auto& region = regionManager_.getRegion(rid);
   auto offset = region.getLastEntryEndOffset();
+  const auto regionExpiry = getRegionExpiry(rid);
+  if (regionExpiry == RegionExpiry::kAllExpired && offset > 0) {
+    reclaimExpiredRegionCount_.inc();
+  }
+  // Values of expired entries are neither reinserted nor passed to anyone
+  const bool verifyValues =
+      checksumData_ &&
+      (regionExpiry != RegionExpiry::kAllExpired || destructorCb_);
   while (offset > 0) {
     RelAddress addrEnd(rid, offset);
     auto entryEnd = buffer.data() + offset;
@@ -467,7 +741,7 @@ uint32_t BlockCache::onRegionReclaim(RegionId rid, BufferView buffer) {
     BufferView value{desc.valueSize, entryEnd - entrySize};
 
     BlockCache::ReinsertionRes reinsertionRes = ReinsertionRes::kRemoved;
-    if (checksumData_ && desc.cs != checksum(value)) {
+    if (verifyValues && desc.cs != checksum(value)) {
       // We do not need to abort here since the EntryDesc checksum was good, so
       // we can safely proceed to read the next entry.
       XLOGF(ERR,
@@ -490,8 +764,8 @@ uint32_t BlockCache::onRegionReclaim(RegionId rid, BufferView buffer) {
       // Reset the value to nullptr to avoid the destructor doing wrong thing
       value = BufferView();
     } else {
-      reinsertionRes =
-          reinsertOrRemoveItem(hk, value, entrySize, RelAddress{rid, offset});
+      reinsertionRes = reinsertOrRemoveItem(
+          hk, value, entrySize, RelAddress{rid, offset}, regionExpiry);
       switch (reinsertionRes) {
       case ReinsertionRes::kEvicted:
         evictionCount++;
@@ -513,7 +787,9 @@ uint32_t BlockCache::onRegionReclaim(RegionId rid, BufferView buffer) {
     offset -= entrySize;
   }
 
+  resetExpiryRange(rid);
   XDCHECK_GE(region.getNumItems(), evictionCount);
+  CACHELIB_TRACEPOINT(bc_region_reclaim, rid.index(), evictionCount);
   return evictionCount;
 }
 
@@ -569,21 +845,93 @@ void BlockCache::onRegionCleanup(RegionId rid, BufferView buffer) {
     offset -= entrySize;
   }
 
+  resetExpiryRange(rid);
   XDCHECK_GE(region.getNumItems(), evictionCount);
 }
 
 bool BlockCache::removeItem(HashedKey hk, RelAddress currAddr) {
-  if (index_.removeIfMatch(hk.keyHash(), encodeRelAddress(currAddr))) {
+  if (index_->removeIfMatch(hk.keyHash(), encodeRelAddress(currAddr))) {
     return true;
   }
   evictionLookupMissCounter_.inc();
   return false;
 }
 
+void BlockCache::trackExpiry(RegionId rid, BufferView value) {
+  if (!expiryRanges_) {
+    return;
+  }
+  auto expiryTime = getExpiryTime_(value);
+  if (expiryTime == 0) {
+    expiryTime = kNeverExpires;
+  }
+  auto& range = expiryRanges_[rid.index()];
+  // Concurrent inserts into the same region only ever widen the range
+  auto cur = range.min.load(std::memory_order_relaxed);
+  while (expiryTime < cur &&
+         !range.min.compare_exchange_weak(cur, expiryTime,
+                                          std::memory_order_relaxed)) {
+  }
+  cur = range.max.load(std::memory_order_relaxed);
+  while (expiryTime > cur &&
+         !range.max.compare_exchange_weak(cur, expiryTime,
+                                          std::memory_order_relaxed)) {
+  }
+}
+
+BlockCache::RegionExpiry BlockCache::getRegionExpiry(RegionId rid) const {
+  if (!expiryRanges_) {
+    return RegionExpiry::kUnknown;
+  }
+  // Same as NvmItem::isExpired(), an entry expires after its expiry second
+  const auto now = static_cast<uint32_t>(util::getCurrentTimeSec());
+  const auto& range = expiryRanges_[rid.index()];
+  if (range.max.load(std::memory_order_relaxed) < now) {
+    return RegionExpiry::kAllExpired;
+  }
+  if (range.min.load(std::memory_order_relaxed) >= now) {
+    return RegionExpiry::kNoneExpired;
+  }
+  return RegionExpiry::kUnknown;
+}
+
+bool BlockCache::dropIfRegionExpired(HashedKey hk,
+                                     const Index::LookupResult& lr,
+                                     RegionId rid,
+                                     uint64_t seqNumber) {
+  if ((itemDestructorEnabled_ && destructorCb_) ||
+      getRegionExpiry(rid) != RegionExpiry::kAllExpired ||
+      regionManager_.getSeqNumber() != seqNumber) {
+    return false;
+  }
+  lookupExpiredRegionCount_.inc();
+  if (index_->removeIfMatch(hk.keyHash(), lr.address())) {
+    const uint64_t size = decodeSizeHint(lr.sizeHint());
+    holeSizeTotal_.add(size);
+    holeCount_.inc();
+    usedSizeBytes_.sub(size);
+  }
+  return true;
+}
+
+void BlockCache::resetExpiryRange(RegionId rid) {
+  if (!expiryRanges_) {
+    return;
+  }
+  // The region is not open for writes while it is reclaimed
+  expiryRanges_[rid.index()].min.store(kNeverExpires,
+                                       std::memory_order_relaxed);
+  expiryRanges_[rid.index()].max.store(0, std::memory_order_relaxed);
+}
+
 BlockCache::ReinsertionRes BlockCache::reinsertOrRemoveItem(
-    HashedKey hk, BufferView value, uint32_t entrySize, RelAddress currAddr) {
+    HashedKey hk,
+    BufferView value,
+    uint32_t entrySize,
+    RelAddress currAddr,
+    RegionExpiry regionExpiry) {
   auto removeItem = [this, hk, currAddr](bool expired) {
-    if (index_.removeIfMatch(hk.keyHash(), encodeRelAddress(currAddr))) {
+    if (index_->removeIfMatch(hk.keyHash(), encodeRelAddress(currAddr))) {
       if (expired) {
         evictionExpiredCount_.inc();
       }
@@ -592,13 +940,17 @@ BlockCache::ReinsertionRes BlockCache::reinsertOrRemoveItem(
     return ReinsertionRes::kRemoved;
   };
 
-  const auto lr = index_.peek(hk.keyHash());
+  const auto lr = index_->peek(hk.keyHash());
   if (!lr.found() || decodeRelAddress(lr.address()) != currAddr) {
     evictionLookupMissCounter_.inc();
     return ReinsertionRes::kRemoved;
   }
 
-  if (checkExpired_ && checkExpired_(value)) {
+  if (regionExpiry == RegionExpiry::kAllExpired) {
+    return removeItem(true);
+  }
+  if (regionExpiry == RegionExpiry::kUnknown && checkExpired_ &&
+      checkExpired_(value)) {
     return removeItem(true);
   }
 
@@ -614,9 +966,15 @@ BlockCache::ReinsertionRes BlockCache::reinsertOrRemoveItem(
   uint16_t priority =
       numPriorities_ == 0
           ? kDefaultItemPriority
-          : std::min<uint16_t>(lr.currentHits(), numPriorities_ - 1);
+          : std::min<uint16_t>(
+                std::max<uint32_t>(lr.currentHits(), minReinsertionPriority_),
+                numPriorities_ - 1);
 
   uint32_t size = serializedSize(hk.key().size(), value.size());
+  if (!regionManager_.tryChargeIo(IoClass::kReinsertion, size)) {
+    reinsertionIoBudgetRejections_.inc();
+    return removeItem(false);
+  }
   auto [desc, slotSize, addr] =
       allocator_.allocate(size, priority, false /* canWait */);
 
@@ -645,7 +1003,7 @@ BlockCache::ReinsertionRes BlockCache::reinsertOrRemoveItem(
   }
 
   const auto replaced =
-      index_.replaceIfMatch(hk.keyHash(),
+      index_->replaceIfMatch(hk.keyHash(),
                             encodeRelAddress(addr.add(slotSize)),
                             encodeRelAddress(currAddr));
   if (!replaced) {
@@ -654,6 +1012,7 @@ BlockCache::ReinsertionRes BlockCache::reinsertOrRemoveItem(
   }
   reinsertionCount_.inc();
   reinsertionBytes_.add(entrySize);
+  CACHELIB_TRACEPOINT(bc_reinsertion, hk.keyHash(), entrySize);
   return ReinsertionRes::kReinserted;
 }
 
@@ -664,20 +1023,21 @@ Status BlockCache::writeEntry(RelAddress addr,
   XDCHECK_LE(addr.offset() + slotSize, regionManager_.regionSize());
   XDCHECK_EQ(slotSize % allocAlignSize_, 0ULL)
       << folly::sformat(" alignSize={}, size={}", allocAlignSize_, slotSize);
-  auto buffer = Buffer(slotSize);
-
-  // Copy descriptor and the key to the end
-  size_t descOffset = buffer.size() - sizeof(EntryDesc);
-  auto desc = new (buffer.data() + descOffset)
-      EntryDesc(hk.key().size(), value.size(), hk.keyHash());
+  EntryDesc desc(hk.key().size(), value.size(), hk.keyHash());
   if (checksumData_) {
-    desc->cs = checksum(value);
+    desc.cs = checksum(value);
   }
 
-  buffer.copyFrom(descOffset - hk.key().size(), makeView(hk.key()));
-  buffer.copyFrom(0, value);
-
-  regionManager_.write(addr, std::move(buffer));
+  // Lay the entry out directly in the region's buffer rather than building
+  // it in a temporary buffer first. Copy descriptor and the key to the end.
+  regionManager_.write(addr, slotSize, [&](MutableBufferView buffer) {
+    const size_t descOffset = buffer.size() - sizeof(EntryDesc);
+    std::memcpy(buffer.data() + descOffset, &desc, sizeof(EntryDesc));
+    std::memcpy(buffer.data() + descOffset - hk.key().size(), hk.key().data(),
+                hk.key().size());
+    value.copyTo(buffer.data());
+  });
+  trackExpiry(addr.rid(), value);
   logicalWrittenCount_.add(hk.key().size() + value.size());
   return Status::Ok;
 }
@@ -708,7 +1068,15 @@ Status BlockCache::readEntry(const RegionDescriptor& readDesc,
   XDCHECK_GE(approxSize, folly::nextPowTwo(sizeof(EntryDesc)));
 
   auto buffer =
-      regionManager_.read(readDesc, addrEnd.sub(approxSize), approxSize);
+      regionManager_.readCached(readDesc, addrEnd.sub(approxSize), approxSize);
+  return decodeEntry(readDesc, addrEnd, expected, std::move(buffer), value);
+}
+
+Status BlockCache::decodeEntry(const RegionDescriptor& readDesc,
+                               RelAddress addrEnd,
+                               HashedKey expected,
+                               Buffer buffer,
+                               Buffer& value) {
   if (buffer.isNull()) {
     return Status::DeviceError;
   }
@@ -744,7 +1112,7 @@ Status BlockCache::readEntry(const RegionDescriptor& readDesc,
     buffer.trimStart(buffer.size() - size);
   } else if (buffer.size() < size) {
     // Read less than actual size. Read again with proper buffer.
-    buffer = regionManager_.read(readDesc, addrEnd.sub(size), size);
+    buffer = regionManager_.readCached(readDesc, addrEnd.sub(size), size);
     if (buffer.isNull()) {
       return Status::DeviceError;
     }
@@ -752,7 +1120,9 @@ Status BlockCache::readEntry(const RegionDescriptor& readDesc,
 
   value = std::move(buffer);
   value.shrink(desc.valueSize);
-  if (checksumData_ && desc.cs != checksum(value.view())) {
+  if (checksumData_ && !shouldVerifyLookupChecksum(readDesc)) {
+    lookupValueChecksumSkipCount_.inc();
+  } else if (checksumData_ && desc.cs != checksum(value.view())) {
     XLOG_N_PER_MS(ERR, 10, 10'000) << folly::sformat(
         "Item value checksum mismatch in readEntry() looking up key {} in "
         "Region {}. Expected: {}, Actual: {}, Offset: {}, Physical-offset: {}, "
@@ -769,6 +1139,15 @@ Status BlockCache::readEntry(const RegionDescriptor& readDesc,
   return Status::Ok;
 }
 
+bool BlockCache::shouldVerifyLookupChecksum(
+    const RegionDescriptor& readDesc) const {
+  if (!readDesc.isPhysReadMode()) {
+    return false;
+  }
+  return lookupChecksumPct_ == 100 ||
+         folly::Random::rand32() % 100 < lookupChecksumPct_;
+}
+
 void BlockCache::drain() { regionManager_.drain(); }
 
 void BlockCache::flush() {
@@ -779,7 +1158,13 @@ void BlockCache::flush() {
 
 void BlockCache::reset() {
   XLOG(INFO, "Reset block cache");
-  index_.reset();
+  if (indexCheckpointer_) {
+    indexCheckpointer_->cancelLoad();
+  }
+  index_->reset();
+  if (indexCheckpointer_) {
+    indexCheckpointer_->invalidate();
+  }
   // Allocator resets region manager
   allocator_.reset();
 
@@ -793,11 +1178,17 @@ void BlockCache::reset() {
   holeCount_.set(0);
   holeSizeTotal_.set(0);
   usedSizeBytes_.set(0);
+
+  if (expiryRanges_) {
+    for (uint32_t i = 0; i < regionManager_.numRegions(); i++) {
+      resetExpiryRange(RegionId{i});
+    }
+  }
 }
 
 void BlockCache::getCounters(const CounterVisitor& visitor) const {
   visitor("navy_bc_size", getSize());
-  visitor("navy_bc_items", index_.computeSize());
+  visitor("navy_bc_items", index_->computeSize());
   visitor("navy_bc_inserts", insertCount_.get(),
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_insert_hash_collisions", insertHashCollisionCount_.get(),
@@ -814,6 +1205,9 @@ void BlockCache::getCounters(const CounterVisitor& visitor) const {
   visitor("navy_bc_lookup_value_checksum_errors",
           lookupValueChecksumErrorCount_.get(),
           CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_lookup_value_checksum_skips",
+          lookupValueChecksumSkipCount_.get(),
+          CounterVisitor::CounterType::RATE);
   visitor("navy_bc_reclaim_entry_header_checksum_errors",
           reclaimEntryHeaderChecksumErrorCount_.get(),
           CounterVisitor::CounterType::RATE);
@@ -836,8 +1230,12 @@ void BlockCache::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_eviction_lookup_misses", evictionLookupMissCounter_.get(),
           CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_reclaim_expired_regions", reclaimExpiredRegionCount_.get(),
+          CounterVisitor::CounterType::RATE);
   visitor("navy_bc_evictions_expired", evictionExpiredCount_.get(),
           CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_lookups_expired_region", lookupExpiredRegionCount_.get(),
+          CounterVisitor::CounterType::RATE);
   visitor("navy_bc_alloc_errors", allocErrorCount_.get(),
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_alloc_retries", allocRetryCount_.get(),
@@ -853,6 +1251,9 @@ void BlockCache::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_reinsertion_errors", reinsertionErrorCount_.get(),
           CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_reinsertion_io_budget_rejections",
+          reinsertionIoBudgetRejections_.get(),
+          CounterVisitor::CounterType::RATE);
   visitor("navy_bc_lookup_for_item_destructor_errors",
           lookupForItemDestructorErrorCount_.get(),
           CounterVisitor::CounterType::RATE);
@@ -860,7 +1261,10 @@ void BlockCache::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   // Allocator visits region manager
   allocator_.getCounters(visitor);
-  index_.getCounters(visitor);
+  index_->getCounters(visitor);
+  if (indexCheckpointer_) {
+    indexCheckpointer_->getCounters(visitor);
+  }
 
   if (reinsertionPolicy_) {
     reinsertionPolicy_->getCounters(visitor);
@@ -875,9 +1279,16 @@ void BlockCache::persist(RecordWriter& rw) {
   config.holeSizeTotal() = holeSizeTotal_.get();
   *config.usedSizeBytes() = usedSizeBytes_.get();
   *config.reinsertionPolicyEnabled() = (reinsertionPolicy_ != nullptr);
+  if (indexCheckpointer_) {
+    // Only the buckets changed since the last checkpoint are written
+    *config.indexCheckpointGeneration() =
+        static_cast<int64_t>(indexCheckpointer_->checkpoint());
+  }
   serializeProto(config, rw);
   regionManager_.persist(rw);
-  index_.persist(rw);
+  if (!indexCheckpointer_) {
+    index_->persist(rw);
+  }
 
   XLOG(INFO, "Finished block cache persist");
 }
@@ -897,8 +1308,22 @@ bool BlockCache::recover(RecordReader& rr) {
   return true;
 }
 
+FormatUpgrader<serialization::BlockCacheConfig>&
+BlockCache::formatUpgrader() {
+  static auto* upgrader =
+      new FormatUpgrader<serialization::BlockCacheConfig>(kFormatVersion);
+  return *upgrader;
+}
+
 void BlockCache::tryRecover(RecordReader& rr) {
   auto config = deserializeProto<serialization::BlockCacheConfig>(rr);
+  const auto version = static_cast<uint64_t>(*config.version());
+  if (version != kFormatVersion && formatUpgrader().canUpgrade(version)) {
+    formatUpgrader().upgrade(version, config);
+    *config.version() = kFormatVersion;
+    XLOGF(INFO, "Upgraded block cache format version {} to {}", version,
+          kFormatVersion);
+  }
   if (!isValidRecoveryData(config)) {
     auto configStr = serializeToJson(config);
     XLOGF(ERR, "Recovery config: {}", configStr.c_str());
@@ -908,7 +1333,25 @@ void BlockCache::tryRecover(RecordReader& rr) {
   holeSizeTotal_.set(*config.holeSizeTotal());
   usedSizeBytes_.set(*config.usedSizeBytes());
   regionManager_.recover(rr);
-  index_.recover(rr);
+  if (*config.indexCheckpointGeneration() != 0) {
+    if (!indexCheckpointer_) {
+      throw std::invalid_argument(
+          "Index was checkpointed but no checkpoint file is configured");
+    }
+    indexCheckpointer_->recover(
+        static_cast<uint64_t>(*config.indexCheckpointGeneration()),
+        lazyIndexRecovery_);
+  } else {
+    index_->recover(rr);
+  }
+
+  // Expiry times of the recovered entries are not known
+  if (expiryRanges_) {
+    for (uint32_t i = 0; i < regionManager_.numRegions(); i++) {
+      expiryRanges_[i].min.store(0, std::memory_order_relaxed);
+      expiryRanges_[i].max.store(kNeverExpires, std::memory_order_relaxed);
+    }
+  }
 }
 
 bool BlockCache::isValidRecoveryData(
@@ -919,7 +1362,9 @@ bool BlockCache::isValidRecoveryData(
          static_cast<int32_t>(allocAlignSize_) ==
              *recoveredConfig.allocAlignSize_ref() &&
          *config_.checksum_ref() == *recoveredConfig.checksum_ref() &&
-         *config_.version_ref() == *recoveredConfig.version_ref();
+         *config_.version_ref() == *recoveredConfig.version_ref() &&
+         *config_.fixedSizeIndexBuckets_ref() ==
+             *recoveredConfig.fixedSizeIndexBuckets_ref();
 }
 
 serialization::BlockCacheConfig BlockCache::serializeConfig(
@@ -929,6 +1374,10 @@ serialization::BlockCacheConfig BlockCache::serializeConfig(
   *serializedConfig.cacheSize() = config.cacheSize;
   *serializedConfig.checksum() = config.checksum;
   *serializedConfig.version() = kFormatVersion;
+  if (config.fixedSizeIndexItems > 0) {
+    serializedConfig.fixedSizeIndexBuckets() =
+        FixedSizeIndex::numBucketsFor(config.fixedSizeIndexItems);
+  }
   return serializedConfig;
 }
 } // namespace facebook::cachelib::navy
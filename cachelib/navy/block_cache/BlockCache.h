@@ -20,17 +20,21 @@
 #include <chrono>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/CompilerUtils.h"
+#include "cachelib/common/FormatUpgrader.h"
 #include "cachelib/navy/block_cache/Allocator.h"
 #include "cachelib/navy/block_cache/EvictionPolicy.h"
 #include "cachelib/navy/block_cache/HitsReinsertionPolicy.h"
 #include "cachelib/navy/block_cache/Index.h"
+#include "cachelib/navy/block_cache/IndexCheckpointer.h"
 #include "cachelib/navy/block_cache/PercentageReinsertionPolicy.h"
 #include "cachelib/navy/block_cache/RegionManager.h"
+#include "cachelib/navy/block_cache/ReuseReinsertionPolicy.h"
 #include "cachelib/navy/common/Device.h"
 #include "cachelib/navy/common/SizeDistribution.h"
 #include "cachelib/navy/engine/Engine.h"
@@ -49,9 +53,16 @@ class BlockCache final : public Engine {
   struct Config {
     Device* device{};
     ExpiredCheck checkExpired;
+    // (Optional) Expiry time of an entry, used to track the expiry range of
+    // every region and skip per entry expiry checks on reclaim
+    ExpiryTimeGetter getExpiryTime;
     DestructorCallback destructorCb;
     // Checksum data read/written
     bool checksum{};
+    // Percent of the lookups reading from the device that verify the value
+    // checksum, when checksum is enabled. Values read from an in-mem buffer
+    // never went through the device and are not verified.
+    uint32_t lookupChecksumPct{100};
     // Base offset and size (in bytes) of cache on the device
     uint64_t cacheBaseOffset{};
     uint64_t cacheSize{};
@@ -66,6 +77,16 @@ class BlockCache final : public Engine {
     JobScheduler* scheduler{};
     // Clean region pool size
     uint32_t cleanRegionsPool{1};
+    // If larger than cleanRegionsPool, the clean region pool grows up to this
+    // size when reclaim can not keep up with the write rate
+    uint32_t maxCleanRegionsPool{0};
+    // Bytes of DRAM to cache recently read device pages in, so that lookups
+    // of small items next to each other read the device once. 0 to disable.
+    uint64_t readPageCacheSize{0};
+    // Bytes of DRAM to keep the buffers of the most recently flushed regions
+    // in, on top of the in-mem buffers, so that newly written items are read
+    // from memory. Rounded down to whole regions. 0 to disable.
+    uint64_t flushedRegionCacheSize{0};
     // The number of region_manager threads for reclaim and flush
     uint32_t cleanRegionThreads{1};
     // The fiber stack size of region_manager threads
@@ -86,9 +107,52 @@ class BlockCache final : public Engine {
     // eviction policy. There must be at least one priority.
     uint16_t numPriorities{1};
 
+    // Ascending item size limits splitting writes into streams: items up to
+    // streamSizeLimits[i] bytes go to stream i, larger ones to a last stream.
+    // Every stream writes its own regions, so reclaiming a region of large
+    // items does not evict many small ones with it. Empty for one stream.
+    std::vector<uint32_t> streamSizeLimits;
+
     // whether to remove an item by checking the full key.
     bool preciseRemove{false};
 
+    // If non-zero, index the items with a FixedSizeIndex sized for this many
+    // items instead of the default SparseMapIndex. It takes less memory per
+    // item but is allocated up front, and drops items once full.
+    uint64_t fixedSizeIndexItems{0};
+
+    // If non-zero, pack the entries of a region at this alignment (a power of
+    // two below kMinAllocAlignSize) instead of kMinAllocAlignSize, so that
+    // small entries waste less of the region. Lookups still read only the
+    // device pages covering the entry. The alignment grows with the device
+    // size when the addresses can't cover the device otherwise.
+    uint32_t packedEntryAlignSize{0};
+
+    // If true, regions of every priority are written with their own device
+    // placement handle (e.g. an FDP reclaim unit handle), so that items of
+    // similar lifetime land in the same erase units: newly admitted items in
+    // priority 0, reinserted ones in the higher priorities. Reinserted items
+    // skip priority 0 then, when there is more than one priority.
+    bool placementByPriority{false};
+
+    // If set, the index is checkpointed to this file instead of being
+    // persisted with the rest of the metadata: fully at first, then only the
+    // buckets changed since the previous checkpoint, every
+    // indexCheckpointInterval and on persist(). Requires the SparseMapIndex.
+    std::string indexCheckpointFile;
+    // Interval of the periodic checkpoints, 0 to only checkpoint on persist()
+    std::chrono::seconds indexCheckpointInterval{0};
+    // With indexCheckpointFile, recover() returns before the index is loaded.
+    // The buckets of the index are loaded in the background, and on first
+    // access.
+    bool lazyIndexRecovery{false};
+    // Number of threads decoding the persisted index on recovery.
+    uint32_t indexRecoveryThreads{4};
+    // If true, the index is persisted as flat arrays of entries rather than
+    // thrift objects, which recover several times faster. Both formats are
+    // recovered regardless. Requires the SparseMapIndex.
+    bool flatIndexPersistence{false};
+
     // Calculates the total region number.
     uint32_t getNumRegions() const {
       XDCHECK_EQ(0ul, cacheSize % regionSize);
@@ -145,6 +209,14 @@ class BlockCache final : public Engine {
   //          Status::DeviceError otherwise.
   Status lookup(HashedKey hk, Buffer& value) override;
 
+  // Looks up a batch of keys. All keys are resolved against the index first
+  // and the entries that have to be read from the device are read together,
+  // with entries adjacent in the same region merged into a single read.
+  // Statuses are the same as for lookup.
+  void lookupBatch(folly::Range<const HashedKey*> hks,
+                   folly::Range<Buffer*> values,
+                   folly::Range<Status*> statuses) override;
+
   // Removes a key from BlockCache.
   //
   // @param hk           key to be removed
@@ -173,6 +245,11 @@ class BlockCache final : public Engine {
   // @return  true if recovery succeeds, false otherwise.
   bool recover(RecordReader& rr) override;
 
+  // Upgrades the config persisted by older format versions on recovery. A
+  // step may only translate the persisted config, the regions and the index
+  // must still be readable by the current version.
+  static FormatUpgrader<serialization::BlockCacheConfig>& formatUpgrader();
+
   // Exports BlockCache stats via CounterVisitor.
   //
   // @param visitor   CounterVisitor to export stats
@@ -267,6 +344,29 @@ class BlockCache final : public Engine {
                    HashedKey expected,
                    Buffer& value);
 
+  // Decodes the entry ending at @addrEnd from @buffer, which was read from
+  // the region opened by @readDesc and holds at least the end of the entry.
+  // Reads the entry again if @buffer does not hold all of it.
+  Status decodeEntry(const RegionDescriptor& readDesc,
+                     RelAddress addrEnd,
+                     HashedKey expected,
+                     Buffer buffer,
+                     Buffer& value);
+
+  // Whether a lookup reading from the region opened by @readDesc verifies
+  // the value checksum: only device reads, sampled by lookupChecksumPct_.
+  bool shouldVerifyLookupChecksum(const RegionDescriptor& readDesc) const;
+
+  // Completes the lookup of @hk after its entry was read with @status:
+  // retries a failed read once, touches the region on a hit and closes
+  // @readDesc.
+  Status completeLookup(RegionDescriptor readDesc,
+                        RelAddress addrEnd,
+                        uint32_t approxSize,
+                        HashedKey hk,
+                        Buffer& value,
+                        Status status);
+
   // Allocator reclaim callback
   // Returns number of slots that were successfully evicted
   uint32_t onRegionReclaim(RegionId rid, BufferView buffer);
@@ -284,8 +384,9 @@ class BlockCache final : public Engine {
 
   // The alloc alignment indicates the granularity of read/write. This
   // granuality is less than the device io alignment size because we buffer
-  // writes in memory until we fill up a region.
-  uint32_t calcAllocAlignSize() const;
+  // writes in memory until we fill up a region. It is at least
+  // @minAllocAlignSize.
+  uint32_t calcAllocAlignSize(uint32_t minAllocAlignSize) const;
 
   // Size hint is computed by aligning size up to kMinAllocAlignSize,
   // and then divide by it. It is loosely compressing the size as
@@ -322,10 +423,42 @@ class BlockCache final : public Engine {
     // Item wasn't eligible for re-insertion and was evicted
     kEvicted,
   };
+  // Expiry of the entries of a region being reclaimed, as far as the expiry
+  // range of the region tells
+  enum class RegionExpiry {
+    // some entries may be expired, check each of them
+    kUnknown,
+    // no entry is expired
+    kNoneExpired,
+    // all entries are expired
+    kAllExpired,
+  };
   ReinsertionRes reinsertOrRemoveItem(HashedKey hk,
                                       BufferView value,
                                       uint32_t entrySize,
-                                      RelAddress currAddr);
+                                      RelAddress currAddr,
+                                      RegionExpiry regionExpiry);
+
+  // Widens the expiry range of region @rid to @value's expiry time
+  void trackExpiry(RegionId rid, BufferView value);
+
+  // Tells the expiry of the entries of region @rid from its expiry range
+  RegionExpiry getRegionExpiry(RegionId rid) const;
+
+  // Empties the expiry range of region @rid once its entries are gone
+  void resetExpiryRange(RegionId rid);
+
+  // Drops the entry of @hk found at @lr from the index without reading it if
+  // all the entries of its region @rid expired, unless the destructor
+  // callback needs the value. @seqNumber is the region manager sequence
+  // number from before the index lookup; the entry is kept if a reclaim
+  // finished since, as the region may hold other entries by now.
+  //
+  // @return true if the entry was dropped
+  bool dropIfRegionExpired(HashedKey hk,
+                           const Index::LookupResult& lr,
+                           RegionId rid,
+                           uint64_t seqNumber);
 
   // Removes an entry key from the index.
   // @return true if the item is successfully removed; false if the item cannot
@@ -334,6 +467,9 @@ class BlockCache final : public Engine {
 
   void validate(Config& config) const;
 
+  // Creates the index selected by @config
+  static std::unique_ptr<Index> makeIndex(const Config& config);
+
   // Create the reinsertion policy from config.
   // This function may need a reference to index and should be called the last
   // in the initialization order.
@@ -342,14 +478,19 @@ class BlockCache final : public Engine {
 
   const serialization::BlockCacheConfig config_;
   const uint16_t numPriorities_{};
+  // Lowest priority reinserted items are written with
+  const uint16_t minReinsertionPriority_{};
   const ExpiredCheck checkExpired_;
+  const ExpiryTimeGetter getExpiryTime_;
   const DestructorCallback destructorCb_;
   const bool checksumData_{};
+  const uint32_t lookupChecksumPct_{};
   // reference to the under-lying device.
   const Device& device_;
   // alloc alignment size indicates the granularity of entry sizes on device.
-  // this is at least kMinAllocAlignSize and is determined by the size of the
-  // device and size of the address (which is 32-bits).
+  // this is at least kMinAllocAlignSize, or the packed entry alignment if
+  // set, and is determined by the size of the device and size of the address
+  // (which is 32-bits).
   const uint32_t allocAlignSize_{};
   const uint32_t readBufferSize_{};
   // number of bytes in a region
@@ -369,13 +510,29 @@ class BlockCache final : public Engine {
   // ^                                         ^
   // |                                         |
   // Buffer*                          Index points here
-  Index index_;
+  std::unique_ptr<Index> index_;
+  // Checkpoints the index if Config::indexCheckpointFile is set, nullptr
+  // otherwise
+  std::unique_ptr<IndexCheckpointer> indexCheckpointer_;
+  const bool lazyIndexRecovery_{false};
   RegionManager regionManager_;
   Allocator allocator_;
   // It is vital that the reinsertion policy is initialized after index_.
   // Make sure that this class member is defined after index_.
   std::shared_ptr<BlockCacheReinsertionPolicy> reinsertionPolicy_;
 
+  // Expiry time in seconds since epoch of the entries never expiring
+  static constexpr uint32_t kNeverExpires{0xffffffffu};
+  // Smallest and largest expiry time of the entries written to a region since
+  // it was last reclaimed. An empty range (min > max) means no entries.
+  // Not persisted, after recovery the ranges span all times.
+  struct ExpiryRange {
+    std::atomic<uint32_t> min{kNeverExpires};
+    std::atomic<uint32_t> max{0};
+  };
+  // one per region, only when getExpiryTime_ is set
+  std::unique_ptr<ExpiryRange[]> expiryRanges_;
+
   // thread local counters in synchronized/critical path
   mutable TLCounter lookupCount_;
   mutable TLCounter succLookupCount_;
@@ -388,10 +545,13 @@ class BlockCache final : public Engine {
   mutable AtomicCounter lookupFalsePositiveCount_;
   mutable AtomicCounter lookupEntryHeaderChecksumErrorCount_;
   mutable AtomicCounter lookupValueChecksumErrorCount_;
+  mutable AtomicCounter lookupValueChecksumSkipCount_;
   mutable AtomicCounter removeCount_;
   mutable AtomicCounter succRemoveCount_;
   mutable AtomicCounter evictionLookupMissCounter_;
   mutable AtomicCounter evictionExpiredCount_;
+  mutable AtomicCounter reclaimExpiredRegionCount_;
+  mutable AtomicCounter lookupExpiredRegionCount_;
   mutable AtomicCounter allocErrorCount_;
   mutable AtomicCounter allocRetryCount_;
   mutable AtomicCounter logicalWrittenCount_;
@@ -403,6 +563,8 @@ class BlockCache final : public Engine {
   mutable AtomicCounter reinsertionErrorCount_;
   mutable AtomicCounter reinsertionCount_;
   mutable AtomicCounter reinsertionBytes_;
+  // reinsertions dropped for being over the reinsertion IO budget
+  mutable AtomicCounter reinsertionIoBudgetRejections_;
   mutable AtomicCounter reclaimEntryHeaderChecksumErrorCount_;
   mutable AtomicCounter reclaimValueChecksumErrorCount_;
   mutable AtomicCounter removeAttemptCollisions_;
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
+
+#include <folly/Format.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "cachelib/navy/serialization/Serialization.h"
+
+namespace facebook::cachelib::navy {
+constexpr uint32_t FixedSizeIndex::kEntriesPerBucket;
+constexpr uint8_t FixedSizeIndex::kMaxHits;
+
+namespace {
+// increase val if it stays within the hits bits, otherwise do nothing
+uint8_t safeInc(uint8_t val) {
+  if (val < FixedSizeIndex::kMaxHits) {
+    return val + 1;
+  }
+  return val;
+}
+} // namespace
+
+FixedSizeIndex::Entry::Entry(uint16_t tag, const ItemRecord& record)
+    : bits_{static_cast<uint64_t>(record.address) |
+            static_cast<uint64_t>(record.sizeHint) << 32 |
+            static_cast<uint64_t>(tag) << 48} {
+  XDCHECK_NE(tag, 0);
+  XDCHECK_LT(tag, 1u << kTagBits);
+  setHits(record.currentHits, record.totalHits);
+}
+
+Index::ItemRecord FixedSizeIndex::Entry::record() const {
+  return ItemRecord{address(), static_cast<uint16_t>(bits_ >> 32),
+                    totalHits(), currentHits()};
+}
+
+void FixedSizeIndex::Entry::setAddress(uint32_t address) {
+  bits_ = (bits_ & ~0xffffffffull) | address;
+}
+
+void FixedSizeIndex::Entry::setHits(uint8_t currentHits, uint8_t totalHits) {
+  bits_ &= (1ull << 58) - 1;
+  bits_ |= static_cast<uint64_t>(std::min(totalHits, kMaxHits)) << 58 |
+           static_cast<uint64_t>(std::min(currentHits, kMaxHits)) << 61;
+}
+
+FixedSizeIndex::FixedSizeIndex(uint64_t numBuckets) : numBuckets_{numBuckets} {
+  if (numBuckets_ == 0 || numBuckets_ > (1ull << 32)) {
+    throw std::invalid_argument{
+        folly::sformat("Invalid number of index buckets: {}", numBuckets_)};
+  }
+  buckets_.reset(new Bucket[numBuckets_]);
+}
+
+uint64_t FixedSizeIndex::numBucketsFor(uint64_t maxNumItems) {
+  constexpr uint64_t kItemsPerBucket = kEntriesPerBucket * kTargetLoadPct;
+  return std::max<uint64_t>(
+      1, (maxNumItems * 100 + kItemsPerBucket - 1) / kItemsPerBucket);
+}
+
+std::pair<std::unique_lock<SharedMutex>, std::unique_lock<SharedMutex>>
+FixedSizeIndex::lockBuckets(const BucketPair& bp) const {
+  auto* first = &getMutexOfBucket(bp.first);
+  auto* second = &getMutexOfBucket(bp.second);
+  if (first > second) {
+    std::swap(first, second);
+  }
+  std::unique_lock<SharedMutex> firstLock{*first};
+  if (first == second) {
+    return {std::move(firstLock), std::unique_lock<SharedMutex>{}};
+  }
+  return {std::move(firstLock), std::unique_lock<SharedMutex>{*second}};
+}
+
+FixedSizeIndex::Slot* FixedSizeIndex::findSlot(const BucketPair& bp,
+                                               uint16_t tag,
+                                               Entry& entry) const {
+  for (auto b : {bp.first, bp.second}) {
+    for (auto& slot : buckets_[b].slots) {
+      entry = Entry{slot.load(std::memory_order_acquire)};
+      if (entry.tag() == tag) {
+        return &slot;
+      }
+    }
+    if (bp.second == bp.first) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+template <typename Fn>
+bool FixedSizeIndex::updateEntry(Slot& slot, uint16_t tag, Fn fn) {
+  auto bits = slot.load(std::memory_order_acquire);
+  while (true) {
+    Entry e{bits};
+    if (e.tag() != tag || !fn(e)) {
+      return false;
+    }
+    if (slot.compare_exchange_weak(bits, e.bits(), std::memory_order_acq_rel,
+                                   std::memory_order_acquire)) {
+      return true;
+    }
+  }
+}
+
+FixedSizeIndex::Slot* FixedSizeIndex::allocateSlot(const BucketPair& bp) const {
+  // Writers own both buckets, so the tags can not change under us. Lookups
+  // only update the hits.
+  auto countEmpty = [](const Bucket& bucket) {
+    return std::count_if(
+        std::begin(bucket.slots), std::end(bucket.slots), [](const Slot& s) {
+          return Entry{s.load(std::memory_order_relaxed)}.empty();
+        });
+  };
+  auto& first = buckets_[bp.first];
+  auto& second = buckets_[bp.second];
+  auto& emptier = countEmpty(second) > countEmpty(first) ? second : first;
+  for (auto& slot : emptier.slots) {
+    if (Entry{slot.load(std::memory_order_relaxed)}.empty()) {
+      return &slot;
+    }
+  }
+
+  // no room in either bucket, drop the least accessed entry
+  Slot* victim = nullptr;
+  uint8_t victimHits = 0;
+  for (auto* bucket : {&first, &second}) {
+    for (auto& slot : bucket->slots) {
+      const auto hits = Entry{slot.load(std::memory_order_relaxed)}.totalHits();
+      if (!victim || hits < victimHits) {
+        victim = &slot;
+        victimHits = hits;
+      }
+    }
+  }
+  return victim;
+}
+
+void FixedSizeIndex::trackRemove(uint8_t totalHits) {
+  hitsEstimator_.trackValue(totalHits);
+  if (totalHits == 0) {
+    unAccessedItems_.inc();
+  }
+}
+
+void FixedSizeIndex::setHits(uint64_t key,
+                             uint8_t currentHits,
+                             uint8_t totalHits) {
+  const auto bp = buckets(key);
+  const auto t = tag(key);
+  auto locks = lockBuckets(bp);
+
+  Entry e;
+  if (auto* slot = findSlot(bp, t, e)) {
+    updateEntry(*slot, t, [&](Entry& entry) {
+      entry.setHits(currentHits, totalHits);
+      return true;
+    });
+  }
+}
+
+Index::LookupResult FixedSizeIndex::lookup(uint64_t key) {
+  const auto bp = buckets(key);
+  const auto t = tag(key);
+
+  // Lock free: count the hit only if the entry is unchanged since it was
+  // read, otherwise look again.
+  while (true) {
+    Entry e;
+    auto* slot = findSlot(bp, t, e);
+    if (!slot) {
+      return LookupResult{};
+    }
+    Entry hit{e};
+    hit.setHits(safeInc(e.currentHits()), safeInc(e.totalHits()));
+    auto expected = e.bits();
+    if (hit.bits() == expected ||
+        slot->compare_exchange_strong(expected, hit.bits(),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      return LookupResult{e.record()};
+    }
+  }
+}
+
+Index::LookupResult FixedSizeIndex::peek(uint64_t key) const {
+  Entry e;
+  if (findSlot(buckets(key), tag(key), e)) {
+    return LookupResult{e.record()};
+  }
+  return LookupResult{};
+}
+
+Index::LookupResult FixedSizeIndex::insert(uint64_t key,
+                                           uint32_t address,
+                                           uint16_t sizeHint) {
+  LookupResult lr;
+  const auto bp = buckets(key);
+  const auto t = tag(key);
+  auto locks = lockBuckets(bp);
+
+  Entry e;
+  auto* slot = findSlot(bp, t, e);
+  if (!slot) {
+    slot = allocateSlot(bp);
+  }
+  // exchange to get the exact hits of the entry we replace
+  const Entry old{slot->exchange(Entry{t, ItemRecord{address, sizeHint}}.bits(),
+                                 std::memory_order_acq_rel)};
+  if (old.empty()) {
+    numEntries_.inc();
+  } else {
+    if (old.tag() != t) {
+      displacedItems_.inc();
+    }
+    lr = LookupResult{old.record()};
+    trackRemove(old.totalHits());
+  }
+  return lr;
+}
+
+bool FixedSizeIndex::replaceIfMatch(uint64_t key,
+                                    uint32_t newAddress,
+                                    uint32_t oldAddress) {
+  const auto bp = buckets(key);
+  const auto t = tag(key);
+  auto locks = lockBuckets(bp);
+
+  Entry e;
+  auto* slot = findSlot(bp, t, e);
+  return slot && updateEntry(*slot, t, [&](Entry& entry) {
+           if (entry.address() != oldAddress) {
+             return false;
+           }
+           entry.setAddress(newAddress);
+           entry.setHits(0, entry.totalHits());
+           return true;
+         });
+}
+
+Index::LookupResult FixedSizeIndex::remove(uint64_t key) {
+  LookupResult lr;
+  const auto bp = buckets(key);
+  auto locks = lockBuckets(bp);
+
+  Entry e;
+  if (auto* slot = findSlot(bp, tag(key), e)) {
+    const Entry old{slot->exchange(0, std::memory_order_acq_rel)};
+    lr = LookupResult{old.record()};
+
+    trackRemove(old.totalHits());
+    numEntries_.dec();
+  }
+  return lr;
+}
+
+bool FixedSizeIndex::removeIfMatch(uint64_t key, uint32_t address) {
+  const auto bp = buckets(key);
+  auto locks = lockBuckets(bp);
+
+  Entry e;
+  auto* slot = findSlot(bp, tag(key), e);
+  // only lookups race with us, and they do not change the address
+  if (slot && e.address() == address) {
+    const Entry old{slot->exchange(0, std::memory_order_acq_rel)};
+    trackRemove(old.totalHits());
+    numEntries_.dec();
+    return true;
+  }
+  return false;
+}
+
+void FixedSizeIndex::reset() {
+  for (uint32_t i = 0; i < kNumMutexes; i++) {
+    auto lock = std::lock_guard{mutex_[i]};
+    for (uint64_t b = i; b < numBuckets_; b += kNumMutexes) {
+      for (auto& slot : buckets_[b].slots) {
+        slot.store(0, std::memory_order_release);
+      }
+    }
+  }
+  numEntries_.set(0);
+  unAccessedItems_.set(0);
+}
+
+size_t FixedSizeIndex::computeSize() const { return numEntries_.get(); }
+
+void FixedSizeIndex::persist(RecordWriter& rw) const {
+  // Each record holds a chunk of buckets. An entry is keyed by its bucket
+  // within the chunk and its tag.
+  serialization::IndexBucket chunk;
+  for (uint64_t start = 0; start < numBuckets_; start += kBucketsPerChunk) {
+    *chunk.bucketId() = static_cast<int32_t>(start / kBucketsPerChunk);
+    const auto end = std::min<uint64_t>(start + kBucketsPerChunk, numBuckets_);
+    for (uint64_t b = start; b < end; b++) {
+      for (const auto& slot : buckets_[b].slots) {
+        const Entry e{slot.load(std::memory_order_acquire)};
+        if (e.empty()) {
+          continue;
+        }
+        const auto record = e.record();
+        serialization::IndexEntry entry;
+        entry.key() = static_cast<int32_t>((b - start) << kTagBits | e.tag());
+        entry.address() = record.address;
+        entry.sizeHint() = record.sizeHint;
+        entry.totalHits() = record.totalHits;
+        entry.currentHits() = record.currentHits;
+        chunk.entries()->push_back(entry);
+      }
+    }
+    // Serialize chunk then clear contents to reuse memory.
+    serializeProto(chunk, rw);
+    chunk.entries()->clear();
+  }
+}
+
+void FixedSizeIndex::recover(RecordReader& rr) {
+  const uint64_t numChunks =
+      (numBuckets_ + kBucketsPerChunk - 1) / kBucketsPerChunk;
+  for (uint64_t i = 0; i < numChunks; i++) {
+    auto chunk = deserializeProto<serialization::IndexBucket>(rr);
+    const uint32_t id = *chunk.bucketId();
+    if (id >= numChunks) {
+      throw std::invalid_argument{
+          folly::sformat("Invalid bucket chunk id. Max chunks: {}, id: {}",
+                         numChunks,
+                         id)};
+    }
+    for (auto& entry : *chunk.entries()) {
+      const uint32_t key = *entry.key();
+      const uint64_t offset = key >> kTagBits;
+      const uint64_t b = id * static_cast<uint64_t>(kBucketsPerChunk) + offset;
+      const uint16_t t = key & ((1u << kTagBits) - 1);
+      if (offset >= kBucketsPerChunk || b >= numBuckets_ || t == 0) {
+        throw std::invalid_argument{folly::sformat(
+            "Invalid index entry. Chunk id: {}, key: {}", id, key)};
+      }
+
+      auto& bucket = buckets_[b];
+      auto* slot = std::find_if(
+          std::begin(bucket.slots), std::end(bucket.slots), [](const Slot& s) {
+            return Entry{s.load(std::memory_order_relaxed)}.empty();
+          });
+      if (slot == std::end(bucket.slots)) {
+        throw std::invalid_argument{
+            folly::sformat("Too many entries in index bucket {}", b)};
+      }
+      const Entry e{t, ItemRecord{static_cast<uint32_t>(*entry.address()),
+                                  static_cast<uint16_t>(*entry.sizeHint()),
+                                  static_cast<uint8_t>(*entry.totalHits()),
+                                  static_cast<uint8_t>(*entry.currentHits())}};
+      slot->store(e.bits(), std::memory_order_release);
+      numEntries_.inc();
+    }
+  }
+}
+
+void FixedSizeIndex::getCounters(const CounterVisitor& visitor) const {
+  hitsEstimator_.visitQuantileEstimator(visitor, "navy_bc_item_hits");
+  visitor("navy_bc_item_removed_with_no_access", unAccessedItems_.get());
+  visitor("navy_bc_index_displaced", displacedItems_.get());
+}
+} // namespace facebook::cachelib::navy
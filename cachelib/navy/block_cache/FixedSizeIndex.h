@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/common/PercentileStats.h"
+#include "cachelib/navy/block_cache/Index.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+// Index implementation with a packed, open-addressed table that is allocated
+// up front. Every entry takes 8 bytes: the 4 byte address, the 2 byte size
+// hint, a 10 bit tag taken from the key hash and saturating 3 bit hit
+// counters. Keys are not stored otherwise, so two keys with the same buckets
+// and tag collide the same way as with the SparseMapIndex.
+//
+// Buckets have 8 entries and fill one cache line. Every key has two candidate
+// buckets and is inserted in the emptier one, which keeps the table working
+// at a high load. When both are full, the entry with the fewest hits is
+// dropped to make room and returned from insert() like an overwritten one.
+//
+// Entries are atomic and never move once written, so lookup() and peek() do
+// not take any lock and never wait for the writers (e.g. region reclaim).
+// Writers serialize on striped mutexes. lookup() counts its hit with a
+// compare-and-swap of the whole entry, so the hit is only recorded if the
+// entry did not change since it was read, and retries otherwise.
+//
+// See Index for the API documentation.
+class FixedSizeIndex : public Index {
+ public:
+  static constexpr uint32_t kEntriesPerBucket{8};
+  // Hits saturate at this value.
+  static constexpr uint8_t kMaxHits{7};
+
+  // @param numBuckets  table size, see numBucketsFor()
+  //
+  // @throw std::invalid_argument if numBuckets is 0 or larger than 2^32
+  explicit FixedSizeIndex(uint64_t numBuckets);
+
+  // @return the number of buckets to hold @maxNumItems entries with few of
+  //         them dropped for lack of room
+  static uint64_t numBucketsFor(uint64_t maxNumItems);
+
+  uint64_t getNumBuckets() const { return numBuckets_; }
+
+  void persist(RecordWriter& rw) const override;
+
+  void recover(RecordReader& rr) override;
+
+  LookupResult lookup(uint64_t key) override;
+
+  LookupResult peek(uint64_t key) const override;
+
+  LookupResult insert(uint64_t key,
+                      uint32_t address,
+                      uint16_t sizeHint) override;
+
+  bool replaceIfMatch(uint64_t key,
+                      uint32_t newAddress,
+                      uint32_t oldAddress) override;
+
+  LookupResult remove(uint64_t key) override;
+
+  bool removeIfMatch(uint64_t key, uint32_t address) override;
+
+  void setHits(uint64_t key, uint8_t currentHits, uint8_t totalHits) override;
+
+  void reset() override;
+
+  size_t computeSize() const override;
+
+  void getCounters(const CounterVisitor& visitor) const override;
+
+ private:
+  static constexpr uint32_t kTagBits{10};
+  static constexpr uint32_t kNumMutexes{16 * 1024};
+  // Buckets are persisted in chunks of this many buckets, one record each
+  static constexpr uint32_t kBucketsPerChunk{64 * 1024};
+  // Target load used by numBucketsFor(), in percent
+  static constexpr uint64_t kTargetLoadPct{85};
+
+  // An entry packed into 8 bytes:
+  //   [0, 32)  address
+  //   [32, 48) size hint
+  //   [48, 58) tag, 0 if the entry is empty
+  //   [58, 61) total hits
+  //   [61, 64) current hits
+  class Entry {
+   public:
+    Entry() = default;
+    explicit Entry(uint64_t bits) : bits_{bits} {}
+    Entry(uint16_t tag, const ItemRecord& record);
+
+    uint64_t bits() const { return bits_; }
+    bool empty() const { return tag() == 0; }
+    uint16_t tag() const {
+      return static_cast<uint16_t>((bits_ >> 48) & ((1u << kTagBits) - 1));
+    }
+    uint32_t address() const { return static_cast<uint32_t>(bits_); }
+    uint8_t totalHits() const {
+      return static_cast<uint8_t>((bits_ >> 58) & kMaxHits);
+    }
+    uint8_t currentHits() const {
+      return static_cast<uint8_t>((bits_ >> 61) & kMaxHits);
+    }
+    ItemRecord record() const;
+
+    void setAddress(uint32_t address);
+    void setHits(uint8_t currentHits, uint8_t totalHits);
+
+   private:
+    uint64_t bits_{0};
+  };
+  static_assert(8 == sizeof(Entry), "Entry size is 8 bytes");
+
+  using Slot = std::atomic<uint64_t>;
+  static_assert(Slot::is_always_lock_free, "Entries are loaded lock free");
+
+  struct alignas(64) Bucket {
+    Slot slots[kEntriesPerBucket]{};
+  };
+  static_assert(64 == sizeof(Bucket), "Bucket fills a cache line");
+
+  // The two candidate buckets of a key. They may be the same.
+  using BucketPair = std::pair<uint64_t, uint64_t>;
+
+  static uint16_t tag(uint64_t hash) {
+    auto t = static_cast<uint16_t>(hash >> (64 - kTagBits));
+    return t == 0 ? 1 : t;
+  }
+
+  BucketPair buckets(uint64_t hash) const {
+    // The first bucket comes from the low 32 bits of the hash and the second
+    // from a remix of all of them, so that neither follows the tag bits.
+    // Multiply-shift then maps 32 bits onto [0, numBuckets_).
+    const uint64_t remixed = (hash * 0x9e3779b97f4a7c15ull) >> 32;
+    return {((hash & 0xffffffffu) * numBuckets_) >> 32,
+            (remixed * numBuckets_) >> 32};
+  }
+
+  SharedMutex& getMutexOfBucket(uint64_t bucket) const {
+    return mutex_[bucket & (kNumMutexes - 1)];
+  }
+
+  // Locks the mutexes of both buckets for writing, in address order to avoid
+  // deadlocks.
+  std::pair<std::unique_lock<SharedMutex>, std::unique_lock<SharedMutex>>
+  lockBuckets(const BucketPair& bp) const;
+
+  // @return the slot holding @tag in either bucket, nullptr if there is none.
+  //         @entry is set to the entry loaded from the slot.
+  Slot* findSlot(const BucketPair& bp, uint16_t tag, Entry& entry) const;
+
+  // Applies @fn to the entry of @slot as long as it still holds @tag. @fn
+  // modifies the entry it is passed and returns false to leave it as is. Only
+  // called by writers, but lookups may update the hits concurrently.
+  //
+  // @return true if the entry was updated
+  template <typename Fn>
+  static bool updateEntry(Slot& slot, uint16_t tag, Fn fn);
+
+  // @return a slot to store a new key in, preferring an empty one in the
+  //         emptier bucket. If both buckets are full, returns the slot with
+  //         the fewest hits.
+  Slot* allocateSlot(const BucketPair& bp) const;
+
+  void trackRemove(uint8_t totalHits);
+
+  const uint64_t numBuckets_{};
+  std::unique_ptr<SharedMutex[]> mutex_{new SharedMutex[kNumMutexes]};
+  std::unique_ptr<Bucket[]> buckets_;
+
+  AtomicCounter numEntries_;
+  mutable util::PercentileStats hitsEstimator_{kQuantileWindowSize};
+  mutable AtomicCounter unAccessedItems_;
+  mutable AtomicCounter displacedItems_;
+
+  static_assert((kNumMutexes & (kNumMutexes - 1)) == 0,
+                "number of mutexes must be power of two");
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
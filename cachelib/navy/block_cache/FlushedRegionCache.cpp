@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/FlushedRegionCache.h"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace facebook::cachelib::navy {
+FlushedRegionCache::FlushedRegionCache(uint32_t numRegions, uint32_t capacity)
+    : capacity_{capacity}, buffers_(numRegions) {
+  if (capacity_ == 0) {
+    throw std::invalid_argument{
+        "Flushed region cache must hold at least 1 region"};
+  }
+}
+
+std::unique_ptr<Buffer> FlushedRegionCache::insert(
+    RegionId rid, std::unique_ptr<Buffer> buf) {
+  XDCHECK(buf);
+  std::lock_guard<TimedMutex> lock{mutex_};
+  auto& slot = buffers_[rid.index()];
+  if (slot) {
+    // replaced before being reclaimed, keep the newest content
+    auto old = std::move(slot);
+    slot = std::move(buf);
+    order_.erase(std::find(order_.begin(), order_.end(), rid));
+    order_.push_back(rid);
+    return old;
+  }
+  slot = std::move(buf);
+  order_.push_back(rid);
+  if (order_.size() <= capacity_) {
+    return nullptr;
+  }
+  auto oldest = order_.front();
+  order_.pop_front();
+  return std::move(buffers_[oldest.index()]);
+}
+
+std::unique_ptr<Buffer> FlushedRegionCache::remove(RegionId rid) {
+  std::lock_guard<TimedMutex> lock{mutex_};
+  auto& slot = buffers_[rid.index()];
+  if (!slot) {
+    return nullptr;
+  }
+  order_.erase(std::find(order_.begin(), order_.end(), rid));
+  return std::move(slot);
+}
+
+bool FlushedRegionCache::read(RegionId rid,
+                              uint32_t offset,
+                              MutableBufferView dst) const {
+  std::lock_guard<TimedMutex> lock{mutex_};
+  const auto& slot = buffers_[rid.index()];
+  if (!slot) {
+    return false;
+  }
+  XDCHECK_LE(offset + dst.size(), slot->size());
+  std::memcpy(dst.data(), slot->data() + offset, dst.size());
+  hits_.inc();
+  return true;
+}
+
+std::vector<std::unique_ptr<Buffer>> FlushedRegionCache::reset() {
+  std::vector<std::unique_ptr<Buffer>> bufs;
+  std::lock_guard<TimedMutex> lock{mutex_};
+  for (auto rid : order_) {
+    bufs.push_back(std::move(buffers_[rid.index()]));
+  }
+  order_.clear();
+  return bufs;
+}
+
+void FlushedRegionCache::getCounters(const CounterVisitor& visitor) const {
+  visitor("navy_bc_flushed_region_cache_hits", hits_.get(),
+          CounterVisitor::CounterType::RATE);
+  size_t numRegions = 0;
+  {
+    std::lock_guard<TimedMutex> lock{mutex_};
+    numRegions = order_.size();
+  }
+  visitor("navy_bc_flushed_region_cache_regions", numRegions);
+}
+} // namespace facebook::cachelib::navy
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/fibers/TimedMutex.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/navy/block_cache/Types.h"
+#include "cachelib/navy/common/Buffer.h"
+#include "cachelib/navy/common/Types.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+using folly::fibers::TimedMutex;
+
+// Keeps the in-mem buffers of the most recently flushed regions, so that
+// lookups of newly written items, the most likely to be read again, are
+// served from memory after the flush.
+//
+// Owns up to @capacity buffers. Inserting into a full cache hands back the
+// buffer of the oldest region. A region must be removed before it is
+// reclaimed; readers keep the region open, so the buffer of a region they
+// read is never removed under them, but it may be replaced by a newer
+// region, which the lock guards against. Thread safe.
+class FlushedRegionCache {
+ public:
+  // @param numRegions  number of regions on the device
+  // @param capacity    number of region buffers to keep, greater than 0
+  FlushedRegionCache(uint32_t numRegions, uint32_t capacity);
+  FlushedRegionCache(const FlushedRegionCache&) = delete;
+  FlushedRegionCache& operator=(const FlushedRegionCache&) = delete;
+
+  // Keeps @buf, holding the content of the just flushed region @rid.
+  //
+  // @return the buffer of the oldest region if the cache was full, nullptr
+  //         otherwise
+  std::unique_ptr<Buffer> insert(RegionId rid, std::unique_ptr<Buffer> buf);
+
+  // Drops region @rid.
+  //
+  // @return its buffer, nullptr if it was not cached
+  std::unique_ptr<Buffer> remove(RegionId rid);
+
+  // Copies the bytes at @offset in region @rid into @dst if the region is
+  // cached.
+  //
+  // @return true on a hit
+  bool read(RegionId rid, uint32_t offset, MutableBufferView dst) const;
+
+  // Drops all regions and returns their buffers.
+  std::vector<std::unique_ptr<Buffer>> reset();
+
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  const uint32_t capacity_{};
+
+  mutable TimedMutex mutex_;
+  // cached regions, the oldest first
+  std::deque<RegionId> order_;
+  // buffer of each region, nullptr if not cached
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  mutable AtomicCounter hits_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/HitDensityPolicy.h"
+
+#include <folly/Format.h>
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace facebook::cachelib::navy {
+
+constexpr std::chrono::seconds HitDensityPolicy::kEstimatorWindow;
+constexpr uint32_t HitDensityPolicy::kDefaultCandidatesPct;
+constexpr uint32_t HitDensityPolicy::kMaxCandidates;
+
+HitDensityPolicy::HitDensityPolicy(uint32_t expectedNumRegions,
+                                   uint32_t candidatesPct)
+    : candidatesPct_{candidatesPct},
+      secSinceInsertionEstimator_{kEstimatorWindow},
+      hitsEstimator_{kEstimatorWindow},
+      skippedEstimator_{kEstimatorWindow} {
+  if (candidatesPct_ == 0 || candidatesPct_ > 100) {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid hit density eviction candidates percent: {}", candidatesPct_));
+  }
+  array_.reserve(expectedNumRegions);
+  XLOGF(INFO,
+        "Hit density policy: expected {} regions, {}% eviction candidates",
+        expectedNumRegions,
+        candidatesPct_);
+}
+
+void HitDensityPolicy::touch(RegionId rid) {
+  XDCHECK(rid.valid());
+  auto i = rid.index();
+  std::lock_guard<TimedMutex> lock{mutex_};
+  if (i >= array_.size() || !array_[i].tracked) {
+    return;
+  }
+  auto& node = array_[i];
+  node.hits = decayedHitsLocked(node);
+  if (node.hits < std::numeric_limits<uint32_t>::max()) {
+    node.hits++;
+  }
+}
+
+void HitDensityPolicy::track(const Region& region) {
+  auto rid = region.id();
+  XDCHECK(rid.valid());
+  auto i = rid.index();
+  std::lock_guard<TimedMutex> lock{mutex_};
+  if (i >= array_.size()) {
+    array_.resize(i + 1);
+  }
+  auto& node = array_[i];
+  node.bytes = std::max(1u, region.getLastEntryEndOffset());
+  node.hits = 0;
+  node.epoch = epoch_;
+  node.trackTime = getSteadyClockSeconds();
+  if (!node.tracked) {
+    node.tracked = true;
+    numTracked_++;
+    linkAtHead(i);
+  }
+}
+
+RegionId HitDensityPolicy::evict() {
+  uint32_t victim{kInvalidIndex};
+  uint32_t victimHits{0};
+  uint32_t skipped{0};
+  std::chrono::seconds trackTime{};
+
+  {
+    std::lock_guard<TimedMutex> lock{mutex_};
+    if (tail_ == kInvalidIndex) {
+      return RegionId{};
+    }
+    const uint32_t numCandidates = std::clamp<uint32_t>(
+        static_cast<uint32_t>(static_cast<uint64_t>(numTracked_) *
+                              candidatesPct_ / 100),
+        1,
+        kMaxCandidates);
+
+    // Walk from the oldest region. A younger region has to be strictly less
+    // dense to be picked, so ties go to the oldest one.
+    uint32_t pos = 0;
+    for (uint32_t i = tail_; i != kInvalidIndex && pos < numCandidates;
+         i = array_[i].prev, pos++) {
+      auto& node = array_[i];
+      const uint32_t hits = decayedHitsLocked(node);
+      if (victim == kInvalidIndex ||
+          static_cast<uint64_t>(hits) * array_[victim].bytes <
+              static_cast<uint64_t>(victimHits) * node.bytes) {
+        victim = i;
+        victimHits = hits;
+        skipped = pos;
+      }
+    }
+
+    trackTime = array_[victim].trackTime;
+    unlink(victim);
+    array_[victim].tracked = false;
+    numTracked_--;
+
+    // After a cache turnover, halve the hits of all regions
+    if (++evictionsInEpoch_ >= std::max(1u, numTracked_)) {
+      epoch_++;
+      evictionsInEpoch_ = 0;
+    }
+  }
+
+  secSinceInsertionEstimator_.trackValue(
+      (getSteadyClockSeconds() - trackTime).count());
+  hitsEstimator_.trackValue(victimHits);
+  skippedEstimator_.trackValue(skipped);
+  return RegionId{victim};
+}
+
+uint32_t HitDensityPolicy::decayedHitsLocked(Node& node) const {
+  const auto elapsed = epoch_ - node.epoch;
+  node.epoch = epoch_;
+  node.hits = elapsed >= 32 ? 0 : node.hits >> elapsed;
+  return node.hits;
+}
+
+void HitDensityPolicy::reset() {
+  std::lock_guard<TimedMutex> lock{mutex_};
+  array_.clear();
+  head_ = kInvalidIndex;
+  tail_ = kInvalidIndex;
+  numTracked_ = 0;
+  epoch_ = 0;
+  evictionsInEpoch_ = 0;
+}
+
+void HitDensityPolicy::unlink(uint32_t i) {
+  auto& node = array_[i];
+  XDCHECK_NE(tail_, kInvalidIndex);
+  if (tail_ == i) {
+    tail_ = node.prev;
+  } else {
+    XDCHECK_NE(node.next, kInvalidIndex);
+    array_[node.next].prev = node.prev;
+  }
+  XDCHECK_NE(head_, kInvalidIndex);
+  if (head_ == i) {
+    head_ = node.next;
+  } else {
+    XDCHECK_NE(node.prev, kInvalidIndex);
+    array_[node.prev].next = node.next;
+  }
+  node.next = kInvalidIndex;
+  node.prev = kInvalidIndex;
+}
+
+void HitDensityPolicy::linkAtHead(uint32_t i) {
+  if (head_ != kInvalidIndex) {
+    array_[head_].prev = i;
+  }
+  array_[i].next = head_;
+  head_ = i;
+  if (tail_ == kInvalidIndex) {
+    tail_ = i;
+  }
+}
+
+size_t HitDensityPolicy::memorySize() const {
+  std::lock_guard<TimedMutex> lock{mutex_};
+  return sizeof(*this) + sizeof(Node) * array_.capacity();
+}
+
+void HitDensityPolicy::getCounters(const CounterVisitor& v) const {
+  secSinceInsertionEstimator_.visitQuantileEstimator(
+      v, "navy_bc_hit_density_secs_since_insertion");
+  hitsEstimator_.visitQuantileEstimator(
+      v, "navy_bc_hit_density_region_hits_estimate");
+  skippedEstimator_.visitQuantileEstimator(
+      v, "navy_bc_hit_density_older_regions_kept");
+}
+
+void HitDensityPolicy::persist(RecordWriter& rw) const {
+  std::ignore = rw;
+  throw std::runtime_error("Not Implemented.");
+}
+
+void HitDensityPolicy::recover(RecordReader& rr) {
+  std::ignore = rr;
+  throw std::runtime_error("Not Implemented.");
+}
+
+} // namespace facebook::cachelib::navy
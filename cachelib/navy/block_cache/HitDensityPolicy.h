@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/fibers/TimedMutex.h>
+
+#include <chrono>
+#include <vector>
+
+#include "cachelib/common/PercentileStats.h"
+#include "cachelib/navy/block_cache/EvictionPolicy.h"
+#include "cachelib/navy/common/Utils.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+using folly::fibers::TimedMutex;
+
+// Cost-benefit policy evicting the region with the fewest recent hits per
+// byte among the oldest regions.
+//
+// Regions are kept in the order they were tracked. Eviction looks at the
+// oldest regions, a fraction of all of them but no more than kMaxCandidates,
+// and evicts the one with the lowest hit density, the oldest one on a tie.
+// Regions that are still hit often survive at the tail, while new regions get
+// most of a cache turnover to collect hits. Without any hits this is FIFO.
+//
+// Hits are halved after every cache turnover, that is once as many regions
+// were evicted as are tracked, so past popularity fades out.
+class HitDensityPolicy final : public EvictionPolicy {
+ public:
+  // @param expectedNumRegions  hint how many regions to expect
+  // @param candidatesPct       percent of the oldest regions evict() picks
+  //                            its victim from, in (0, 100]
+  //
+  // @throw std::invalid_argument if @candidatesPct is out of range
+  explicit HitDensityPolicy(uint32_t expectedNumRegions,
+                            uint32_t candidatesPct = kDefaultCandidatesPct);
+
+  HitDensityPolicy(const HitDensityPolicy&) = delete;
+  HitDensityPolicy& operator=(const HitDensityPolicy&) = delete;
+
+  ~HitDensityPolicy() override {}
+
+  // Records the hit of the region.
+  void touch(RegionId rid) override;
+
+  // Adds a new region as the youngest one.
+  void track(const Region& region) override;
+
+  // Evicts the least hit region per byte among the oldest and stops tracking.
+  RegionId evict() override;
+
+  // Resets the policy to the initial state.
+  void reset() override;
+
+  // Gets memory used by the policy.
+  size_t memorySize() const override;
+
+  // Exports policy stats via CounterVisitor.
+  void getCounters(const CounterVisitor& v) const override;
+
+  // Persists metadata associated with the policy.
+  void persist(RecordWriter& rw) const override;
+
+  // Recovers from previously persisted metadata associated with the policy.
+  void recover(RecordReader& rr) override;
+
+  static constexpr uint32_t kDefaultCandidatesPct{25};
+  // Bounds the work done by evict() while holding the lock touch() takes.
+  static constexpr uint32_t kMaxCandidates{256};
+
+ private:
+  static constexpr uint32_t kInvalidIndex = 0xffffffffu;
+
+  // Double linked list with index as a pointer and kInvalidIndex as nullptr
+  struct Node {
+    uint32_t prev{kInvalidIndex};
+    uint32_t next{kInvalidIndex};
+    bool tracked{false};
+    // bytes used in the region, at least 1
+    uint32_t bytes{1};
+    uint32_t hits{};
+    // turnover in which @hits was last decayed
+    uint64_t epoch{};
+    std::chrono::seconds trackTime{};
+  };
+
+  // Decays the hits of @node to the current epoch.
+  uint32_t decayedHitsLocked(Node& node) const;
+  void unlink(uint32_t i);
+  void linkAtHead(uint32_t i);
+
+  static constexpr std::chrono::seconds kEstimatorWindow{5};
+
+  const uint32_t candidatesPct_{};
+  std::vector<Node> array_;
+  // youngest and oldest tracked regions
+  uint32_t head_{kInvalidIndex};
+  uint32_t tail_{kInvalidIndex};
+  uint32_t numTracked_{0};
+  uint64_t epoch_{0};
+  uint32_t evictionsInEpoch_{0};
+  mutable TimedMutex mutex_;
+
+  // populated when we evict a region
+  mutable util::PercentileStats secSinceInsertionEstimator_;
+  mutable util::PercentileStats hitsEstimator_;
+  mutable util::PercentileStats skippedEstimator_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -18,17 +18,17 @@
 
 #include <folly/Portability.h>
 #include <folly/fibers/TimedMutex.h>
-#include <folly/stats/QuantileEstimator.h>
-#include <tsl/sparse_map.h>
+#include <folly/logging/xlog.h>
 
 #include <cassert>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
-#include "cachelib/common/AtomicCounter.h"
-#include "cachelib/common/PercentileStats.h"
+#include "cachelib/navy/common/Types.h"
 #include "cachelib/navy/serialization/RecordIO.h"
 
 namespace facebook {
@@ -41,23 +41,29 @@ using SharedMutex =
 // NVM index: map from key to value. Under the hood, stores key hash to value
 // map. If collision happened, returns undefined value (last inserted actually,
 // but we do not want people to rely on that).
+//
+// This is the interface BlockCache talks to. Implementations:
+//  - SparseMapIndex: a sparse hash map per bucket, sized on demand.
+//  - FixedSizeIndex: a packed open-addressed table sized up front.
+// All implementations are thread safe.
 class Index {
  public:
   // Specify 1 second window size for quantile estimator.
   static constexpr std::chrono::seconds kQuantileWindowSize{1};
 
   Index() = default;
+  virtual ~Index() = default;
   Index(const Index&) = delete;
   Index& operator=(const Index&) = delete;
 
   // Writes index to a Thrift object one bucket at a time and passes each bucket
   // to @persistCb. The reason for this is because the index can be very large
   // and serializing everything at once uses a lot of RAM.
-  void persist(RecordWriter& rw) const;
+  virtual void persist(RecordWriter& rw) const = 0;
 
   // Resets index then inserts entries read from @deserializer. Throws
   // std::exception on failure.
-  void recover(RecordReader& rr);
+  virtual void recover(RecordReader& rr) = 0;
 
   struct FOLLY_PACK_ATTR ItemRecord {
     // encoded address
@@ -82,7 +88,9 @@ class Index {
   static_assert(8 == sizeof(ItemRecord), "ItemRecord size is 8 bytes");
 
   struct LookupResult {
-    friend class Index;
+    LookupResult() = default;
+    explicit LookupResult(const ItemRecord& record)
+        : record_(record), found_(true) {}
 
     bool found() const { return found_; }
 
@@ -117,85 +125,97 @@ class Index {
   };
 
   // Gets value and update tracking counters
-  LookupResult lookup(uint64_t key);
+  virtual LookupResult lookup(uint64_t key) = 0;
 
   // Gets value without updating tracking counters
-  LookupResult peek(uint64_t key) const;
+  virtual LookupResult peek(uint64_t key) const = 0;
 
   // Overwrites existing key if exists with new address and size, and it also
   // will reset hits counting. If the entry was successfully overwritten,
   // LookupResult.found() returns true and LookupResult.record() returns the old
-  // record.
-  LookupResult insert(uint64_t key, uint32_t address, uint16_t sizeHint);
+  // record. An index with a bounded capacity may also return a record of
+  // another key that it dropped to make room; the caller accounts for it the
+  // same way as an overwritten one.
+  virtual LookupResult insert(uint64_t key,
+                              uint32_t address,
+                              uint16_t sizeHint) = 0;
 
   // Replaces old address with new address if there exists the key with the
   // identical old address. Current hits will be reset after successful replace.
   // All other fields in the record is retained.
   //
   // @return true if replaced.
-  bool replaceIfMatch(uint64_t key, uint32_t newAddress, uint32_t oldAddress);
+  virtual bool replaceIfMatch(uint64_t key,
+                              uint32_t newAddress,
+                              uint32_t oldAddress) = 0;
 
   // If the entry was successfully removed, LookupResult.found() returns true
   // and LookupResult.record() returns the record that was just found.
   // If the entry wasn't found, then LookupResult.found() returns false.
-  LookupResult remove(uint64_t key);
+  virtual LookupResult remove(uint64_t key) = 0;
 
   // Removes only if both key and address match.
   //
   // @return true if removed successfully, false otherwise.
-  bool removeIfMatch(uint64_t key, uint32_t address);
+  virtual bool removeIfMatch(uint64_t key, uint32_t address) = 0;
 
   // Updates hits information of a key.
-  void setHits(uint64_t key, uint8_t currentHits, uint8_t totalHits);
+  virtual void setHits(uint64_t key, uint8_t currentHits, uint8_t totalHits) = 0;
 
   // Resets all the buckets to the initial state.
-  void reset();
+  virtual void reset() = 0;
 
   // Walks buckets and computes total index entry count
-  size_t computeSize() const;
+  virtual size_t computeSize() const = 0;
 
   // Exports index stats via CounterVisitor.
-  void getCounters(const CounterVisitor& visitor) const;
+  virtual void getCounters(const CounterVisitor& visitor) const = 0;
 
- private:
-  static constexpr uint32_t kNumBuckets{64 * 1024};
-  static constexpr uint32_t kNumMutexes{1024};
+  // Incremental checkpoints, see IndexCheckpointer. An index supporting them
+  // is made of getNumBuckets() buckets persisted one record each, tracks the
+  // buckets changed since they were last checkpointed, and can load its
+  // buckets lazily after a restart.
+  virtual bool supportsCheckpoints() const { return false; }
 
-  using Map = tsl::sparse_map<uint32_t, ItemRecord>;
-
-  static uint32_t bucket(uint64_t hash) {
-    return (hash >> 32) & (kNumBuckets - 1);
-  }
-
-  static uint32_t subkey(uint64_t hash) { return hash & 0xffffffffu; }
-
-  SharedMutex& getMutexOfBucket(uint32_t bucket) const {
-    XDCHECK(folly::isPowTwo(kNumMutexes));
-    return mutex_[bucket & (kNumMutexes - 1)];
+  virtual uint32_t getNumBuckets() const {
+    throw std::logic_error("index does not support checkpoints");
   }
 
-  SharedMutex& getMutex(uint64_t hash) const {
-    auto b = bucket(hash);
-    return getMutexOfBucket(b);
+  // Returns the ids of the buckets inserted into or removed from since the
+  // previous call, in ascending order, and clears their dirty mark. Hit
+  // counter updates do not dirty a bucket. With @all, returns every bucket.
+  virtual std::vector<uint32_t> takeDirtyBuckets(bool /* all */) {
+    throw std::logic_error("index does not support checkpoints");
   }
 
-  Map& getMap(uint64_t hash) const {
-    auto b = bucket(hash);
-    return buckets_[b];
+  // Writes bucket @bucketId to @rw as a single record. Safe to call while
+  // the index is in use.
+  virtual void persistBucket(uint32_t /* bucketId */,
+                             RecordWriter& /* rw */) const {
+    throw std::logic_error("index does not support checkpoints");
   }
 
-  void trackRemove(uint8_t totalHits);
+  // Returns the record written by persistBucket() for a bucket, or nullptr
+  // if the bucket is empty.
+  using BucketLoader =
+      std::function<std::unique_ptr<folly::IOBuf>(uint32_t bucketId)>;
 
-  // Experiments with 64 byte alignment didn't show any throughput test
-  // performance improvement.
-  std::unique_ptr<SharedMutex[]> mutex_{new SharedMutex[kNumMutexes]};
-  std::unique_ptr<Map[]> buckets_{new Map[kNumBuckets]};
+  // Resets the index and marks every bucket as not loaded. A bucket is
+  // filled from @loader on the first access to it, or by loadBucket().
+  // @loader must stay valid until endLazyLoad() or reset().
+  virtual void beginLazyLoad(BucketLoader /* loader */) {
+    throw std::logic_error("index does not support checkpoints");
+  }
 
-  mutable util::PercentileStats hitsEstimator_{kQuantileWindowSize};
-  mutable AtomicCounter unAccessedItems_;
+  // Loads bucket @bucketId if it was not loaded yet.
+  virtual void loadBucket(uint32_t /* bucketId */) {
+    throw std::logic_error("index does not support checkpoints");
+  }
 
-  static_assert((kNumMutexes & (kNumMutexes - 1)) == 0,
-                "number of mutexes must be power of two");
+  // Drops the loader once every bucket is loaded.
+  virtual void endLazyLoad() {
+    throw std::logic_error("index does not support checkpoints");
+  }
 };
 } // namespace navy
 } // namespace cachelib
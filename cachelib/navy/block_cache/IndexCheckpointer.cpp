@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/IndexCheckpointer.h"
+
+#include <fcntl.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/ScopeGuard.h>
+#include <folly/logging/xlog.h>
+
+#include "cachelib/navy/serialization/RecordIO.h"
+#include "cachelib/navy/serialization/Serialization.h"
+
+namespace facebook::cachelib::navy {
+IndexCheckpointer::IndexCheckpointer(Index& index, std::string path)
+    : index_{index}, path_{std::move(path)} {
+  if (!index_.supportsCheckpoints()) {
+    throw std::invalid_argument("index does not support checkpoints");
+  }
+}
+
+IndexCheckpointer::~IndexCheckpointer() {
+  stop();
+  cancelLoad();
+}
+
+void IndexCheckpointer::work() {
+  try {
+    checkpoint();
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "Index checkpoint to {} failed: {}", path_, e.what());
+  }
+}
+
+uint64_t IndexCheckpointer::checkpoint(bool full) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  full = full || needFull_ || deltaBuckets_ > index_.getNumBuckets();
+  if (full) {
+    // Truncating the file would pull the records from under the lazy load
+    waitForLoad();
+  }
+  auto ids = index_.takeDirtyBuckets(full);
+  if (ids.empty()) {
+    return generation_;
+  }
+  // The dirty marks are gone, only a full checkpoint makes up for a failure
+  auto failGuard = folly::makeGuard([this] {
+    needFull_ = true;
+    checkpointErrors_.inc();
+  });
+
+  serialization::IndexCheckpointHeader header;
+  *header.generation() = static_cast<int64_t>(generation_ + 1);
+  *header.full() = full;
+  header.bucketIds()->assign(ids.begin(), ids.end());
+
+  folly::File file{path_, O_RDWR | O_CREAT | (full ? O_TRUNC : 0), 0644};
+  {
+    auto rw = createFileRecordWriter(file.dup());
+    serializeProto(header, *rw);
+    for (auto id : ids) {
+      index_.persistBucket(id, *rw);
+    }
+  }
+  folly::checkUnixError(folly::fsyncNoInt(file.fd()),
+                        "fsync of index checkpoint failed");
+  failGuard.dismiss();
+
+  generation_++;
+  needFull_ = false;
+  if (full) {
+    deltaBuckets_ = 0;
+    numFullCheckpoints_.inc();
+  } else {
+    deltaBuckets_ += ids.size();
+  }
+  numCheckpoints_.inc();
+  lastCheckpointBuckets_.set(ids.size());
+  XLOGF(DBG1,
+        "Index checkpoint {} wrote {} buckets ({})",
+        generation_,
+        ids.size(),
+        full ? "full" : "delta");
+  return generation_;
+}
+
+void IndexCheckpointer::invalidate() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  XDCHECK(!loader_.joinable());
+  releaseRecords();
+  needFull_ = true;
+  deltaBuckets_ = 0;
+}
+
+void IndexCheckpointer::recover(uint64_t generation, bool lazy) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  cancelLoad();
+  auto reader = std::make_unique<folly::RecordIOReader>(
+      folly::File{path_, O_RDONLY});
+
+  const uint32_t numBuckets = index_.getNumBuckets();
+  std::vector<folly::ByteRange> records(numBuckets);
+  uint64_t lastGeneration = 0;
+  uint64_t deltaBuckets = 0;
+  for (auto it = reader->begin(); it != reader->end();) {
+    serialization::IndexCheckpointHeader header;
+    ProtoSerializer::deserialize(it->first, header);
+    ++it;
+    const auto gen = static_cast<uint64_t>(*header.generation());
+    if (lastGeneration == 0 ? !*header.full() : gen != lastGeneration + 1) {
+      throw std::invalid_argument(folly::sformat(
+          "Unexpected index checkpoint {} after {}", gen, lastGeneration));
+    }
+    if (*header.full()) {
+      deltaBuckets = 0;
+    } else {
+      deltaBuckets += header.bucketIds()->size();
+    }
+    // Only the record ranges are kept, the buckets are deserialized when
+    // they are loaded
+    for (auto id : *header.bucketIds()) {
+      if (it == reader->end()) {
+        throw std::invalid_argument(
+            folly::sformat("Index checkpoint {} is truncated", gen));
+      }
+      if (id < 0 || static_cast<uint32_t>(id) >= numBuckets) {
+        throw std::invalid_argument(folly::sformat(
+            "Invalid bucket id. Max buckets: {}, bucket id: {}",
+            numBuckets,
+            id));
+      }
+      records[id] = it->first;
+      ++it;
+    }
+    lastGeneration = gen;
+  }
+  if (lastGeneration != generation) {
+    throw std::invalid_argument(folly::sformat(
+        "Index checkpoint file is at generation {}, expected {}",
+        lastGeneration,
+        generation));
+  }
+
+  reader_ = std::move(reader);
+  records_ = std::move(records);
+  generation_ = lastGeneration;
+  deltaBuckets_ = deltaBuckets;
+  needFull_ = false;
+  index_.beginLazyLoad([this](uint32_t bucketId) {
+    const auto& record = records_[bucketId];
+    return record.empty() ? nullptr : folly::IOBuf::wrapBuffer(record);
+  });
+  stopLoad_ = false;
+  loading_ = true;
+  if (lazy) {
+    loader_ = std::thread{[this] { loadAll(); }};
+  } else {
+    loadAll();
+  }
+}
+
+void IndexCheckpointer::loadAll() {
+  const uint32_t numBuckets = index_.getNumBuckets();
+  for (uint32_t i = 0; i < numBuckets; i++) {
+    if (stopLoad_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    index_.loadBucket(i);
+  }
+  index_.endLazyLoad();
+  releaseRecords();
+  loading_ = false;
+  XLOGF(INFO, "Loaded {} index buckets from {}", numBuckets, path_);
+}
+
+void IndexCheckpointer::releaseRecords() {
+  records_.clear();
+  records_.shrink_to_fit();
+  reader_.reset();
+}
+
+void IndexCheckpointer::waitForLoad() {
+  if (loader_.joinable()) {
+    loader_.join();
+  }
+}
+
+void IndexCheckpointer::cancelLoad() {
+  stopLoad_ = true;
+  waitForLoad();
+  loading_ = false;
+}
+
+void IndexCheckpointer::getCounters(const CounterVisitor& visitor) const {
+  visitor("navy_bc_index_checkpoints", numCheckpoints_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_index_full_checkpoints", numFullCheckpoints_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_index_checkpoint_errors", checkpointErrors_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_index_last_checkpoint_buckets",
+          lastCheckpointBuckets_.get());
+  visitor("navy_bc_index_lazy_loading", loading_ ? 1 : 0);
+}
+} // namespace facebook::cachelib::navy
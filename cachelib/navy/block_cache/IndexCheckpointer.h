@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/RecordIO.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/common/PeriodicWorker.h"
+#include "cachelib/navy/block_cache/Index.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+// Keeps a copy of an Index in a file, written incrementally so that the
+// shutdown only has to write what changed since the last checkpoint.
+//
+// The file is a sequence of checkpoints. Each is an IndexCheckpointHeader
+// record followed by one IndexBucket record per bucket it lists. The first
+// checkpoint of the file is a full one, holding every bucket; the following
+// ones are deltas holding the buckets changed since the previous checkpoint,
+// and the last record of a bucket wins. A full checkpoint truncates the file
+// once the deltas add up to more buckets than a full one.
+//
+// On recovery the file is scanned for the last record of every bucket
+// without deserializing them; the buckets are then loaded on first access
+// and by a background thread, so the cache can serve before the whole index
+// is loaded.
+//
+// Runs checkpoint() periodically once started as a PeriodicWorker. Thread
+// safe.
+class IndexCheckpointer : public PeriodicWorker {
+ public:
+  // @param index  index to checkpoint, must support checkpoints
+  // @param path   checkpoint file, created if missing
+  //
+  // @throw std::invalid_argument if @index does not support checkpoints
+  IndexCheckpointer(Index& index, std::string path);
+  ~IndexCheckpointer() override;
+
+  // Appends the buckets changed since the previous checkpoint to the file.
+  // Writes a full checkpoint instead if @full, if the file content is not
+  // known to match the index or if the deltas grew larger than the index.
+  // Nothing is written if no bucket changed.
+  //
+  // @return the generation of the last checkpoint in the file
+  // @throw std::system_error on IO errors; the next checkpoint is full then
+  uint64_t checkpoint(bool full = false);
+
+  // Forgets the content of the file, so the next checkpoint is full. Called
+  // once the index is reset, after cancelLoad().
+  void invalidate();
+
+  // Resets the index and recovers it from the file, whose last checkpoint
+  // must be of @generation. With @lazy, returns once the file is scanned and
+  // loads the buckets in the background; they are also loaded on first
+  // access. Otherwise returns once all of them are loaded.
+  //
+  // @throw std::exception if the file is missing or does not match
+  void recover(uint64_t generation, bool lazy);
+
+  // Waits for the background load, if any, to finish.
+  void waitForLoad();
+
+  // Stops the background load, if any. The index must be reset before the
+  // next call to invalidate() or recover().
+  void cancelLoad();
+
+  // Exports checkpoint stats via CounterVisitor.
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  void work() override;
+
+  // Loads every bucket still pending, then releases the file
+  void loadAll();
+
+  // Drops the mapping of the file used by the lazy load
+  void releaseRecords();
+
+  Index& index_;
+  const std::string path_;
+
+  // Serializes the checkpoints
+  std::mutex mutex_;
+  // Generation of the last checkpoint in the file
+  uint64_t generation_{0};
+  // Buckets written by the deltas since the last full checkpoint
+  uint64_t deltaBuckets_{0};
+  // Whether the next checkpoint has to be a full one
+  bool needFull_{true};
+
+  // The mapped file and the last record of every bucket in it, while the
+  // buckets are loaded lazily
+  std::unique_ptr<folly::RecordIOReader> reader_;
+  std::vector<folly::ByteRange> records_;
+  std::thread loader_;
+  std::atomic<bool> stopLoad_{false};
+  std::atomic<bool> loading_{false};
+
+  mutable AtomicCounter numCheckpoints_;
+  mutable AtomicCounter numFullCheckpoints_;
+  mutable AtomicCounter lastCheckpointBuckets_;
+  mutable AtomicCounter checkpointErrors_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/ReadPageCache.h"
+
+#include <folly/Format.h>
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace facebook::cachelib::navy {
+constexpr uint32_t ReadPageCache::kMaxPagesPerRead;
+
+ReadPageCache::ReadPageCache(uint32_t numRegions,
+                             uint32_t pageSize,
+                             uint64_t numPages)
+    : numRegions_{numRegions},
+      pageSize_{pageSize},
+      pagesPerShard_{std::max<uint64_t>(1, numPages / kNumShards)},
+      generations_{std::make_unique<std::atomic<uint32_t>[]>(numRegions)},
+      shards_{std::make_unique<Shard[]>(kNumShards)} {
+  if (!folly::isPowTwo(pageSize_)) {
+    throw std::invalid_argument{
+        folly::sformat("Invalid read page cache page size: {}", pageSize_)};
+  }
+  if (numPages == 0) {
+    throw std::invalid_argument{"Read page cache must hold at least 1 page"};
+  }
+}
+
+bool ReadPageCache::read(RegionId rid, uint32_t offset, MutableBufferView dst) {
+  const auto generation = getGeneration(rid);
+  size_t pos = 0;
+  while (pos < dst.size()) {
+    const uint32_t cur = offset + static_cast<uint32_t>(pos);
+    const uint32_t pageOffset = cur & ~(pageSize_ - 1);
+    const uint32_t inPage = cur - pageOffset;
+    const size_t len = std::min<size_t>(pageSize_ - inPage, dst.size() - pos);
+
+    const auto key = makeKey(rid, pageOffset);
+    auto& shard = getShard(key);
+    std::lock_guard<TimedMutex> lock{shard.mutex};
+    auto it = shard.pages.find(key);
+    if (it == shard.pages.end()) {
+      misses_.inc();
+      return false;
+    }
+    auto& page = *it->second;
+    if (page.generation != generation) {
+      // the region was reclaimed since the page was read
+      shard.lru.erase(it->second);
+      shard.pages.erase(it);
+      numPages_.dec();
+      misses_.inc();
+      return false;
+    }
+    if (page.data.size() < inPage + len) {
+      misses_.inc();
+      return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    std::memcpy(dst.data() + pos, page.data.data() + inPage, len);
+    pos += len;
+  }
+  hits_.inc();
+  return true;
+}
+
+void ReadPageCache::insert(RegionId rid, uint32_t offset, BufferView data) {
+  XDCHECK_EQ(offset % pageSize_, 0u);
+  const auto generation = getGeneration(rid);
+  for (size_t pos = 0; pos < data.size(); pos += pageSize_) {
+    const auto key = makeKey(rid, offset + static_cast<uint32_t>(pos));
+    const auto len = std::min<size_t>(pageSize_, data.size() - pos);
+    Buffer pageData{BufferView{len, data.data() + pos}};
+
+    auto& shard = getShard(key);
+    std::lock_guard<TimedMutex> lock{shard.mutex};
+    auto it = shard.pages.find(key);
+    if (it != shard.pages.end()) {
+      it->second->generation = generation;
+      it->second->data = std::move(pageData);
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      continue;
+    }
+    shard.lru.push_front(Page{key, generation, std::move(pageData)});
+    shard.pages.emplace(key, shard.lru.begin());
+    numPages_.inc();
+    if (shard.lru.size() > pagesPerShard_) {
+      shard.pages.erase(shard.lru.back().key);
+      shard.lru.pop_back();
+      numPages_.dec();
+    }
+  }
+}
+
+void ReadPageCache::invalidateRegion(RegionId rid) {
+  XDCHECK_LT(rid.index(), numRegions_);
+  generations_[rid.index()].fetch_add(1, std::memory_order_acq_rel);
+}
+
+void ReadPageCache::reset() {
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    auto& shard = shards_[i];
+    std::lock_guard<TimedMutex> lock{shard.mutex};
+    numPages_.sub(shard.lru.size());
+    shard.pages.clear();
+    shard.lru.clear();
+  }
+}
+
+void ReadPageCache::getCounters(const CounterVisitor& visitor) const {
+  visitor("navy_bc_read_page_cache_hits", hits_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_read_page_cache_misses", misses_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_bc_read_page_cache_pages", numPages_.get());
+}
+} // namespace facebook::cachelib::navy
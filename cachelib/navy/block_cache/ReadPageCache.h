@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/fibers/TimedMutex.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/navy/block_cache/Types.h"
+#include "cachelib/navy/common/Buffer.h"
+#include "cachelib/navy/common/Types.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+using folly::fibers::TimedMutex;
+
+// LRU cache of device pages recently read from flushed regions. Small items
+// share their pages with their neighbors in the region, so keeping the pages
+// of a lookup around serves the lookups of the neighbors from memory instead
+// of reading the same page again.
+//
+// Pages are keyed by region and offset. Every region has a generation that
+// is bumped when the region is reclaimed, which drops all its pages at once.
+// Thread safe.
+class ReadPageCache {
+ public:
+  // Reads touching more pages than this are not cached.
+  static constexpr uint32_t kMaxPagesPerRead{2};
+
+  // @param numRegions  number of regions on the device
+  // @param pageSize    size of a page, a power of two multiple of the device
+  //                    IO alignment
+  // @param numPages    number of pages to cache
+  //
+  // @throw std::invalid_argument if @pageSize is not a power of two or
+  //        @numPages is 0
+  ReadPageCache(uint32_t numRegions, uint32_t pageSize, uint64_t numPages);
+  ReadPageCache(const ReadPageCache&) = delete;
+  ReadPageCache& operator=(const ReadPageCache&) = delete;
+
+  uint32_t getPageSize() const { return pageSize_; }
+
+  // Copies the bytes at @offset in region @rid into @dst if all the pages
+  // they are in are cached.
+  //
+  // @return true on a hit
+  bool read(RegionId rid, uint32_t offset, MutableBufferView dst);
+
+  // Caches the pages in @data, read at @offset in region @rid. @offset is
+  // page aligned. The last page may be partial.
+  void insert(RegionId rid, uint32_t offset, BufferView data);
+
+  // Drops the pages of @rid. Called when the region is reclaimed, while no
+  // one reads it.
+  void invalidateRegion(RegionId rid);
+
+  // Drops all pages
+  void reset();
+
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  static constexpr uint32_t kNumShards{32};
+
+  struct Page {
+    uint64_t key{};
+    // generation of the region when the page was read
+    uint32_t generation{};
+    Buffer data;
+  };
+
+  struct Shard {
+    TimedMutex mutex;
+    // most recently used page first
+    std::list<Page> lru;
+    folly::F14FastMap<uint64_t, std::list<Page>::iterator> pages;
+  };
+
+  static uint64_t makeKey(RegionId rid, uint32_t pageOffset) {
+    return static_cast<uint64_t>(rid.index()) << 32 | pageOffset;
+  }
+
+  Shard& getShard(uint64_t key) {
+    // page offsets are aligned, mix the page number with the region
+    const auto page = (key >> 32) ^ ((key & 0xffffffffu) / pageSize_);
+    return shards_[page % kNumShards];
+  }
+
+  uint32_t getGeneration(RegionId rid) const {
+    return generations_[rid.index()].load(std::memory_order_acquire);
+  }
+
+  const uint32_t numRegions_{};
+  const uint32_t pageSize_{};
+  const uint64_t pagesPerShard_{};
+  std::unique_ptr<std::atomic<uint32_t>[]> generations_;
+  std::unique_ptr<Shard[]> shards_;
+
+  mutable AtomicCounter hits_;
+  mutable AtomicCounter misses_;
+  mutable AtomicCounter numPages_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
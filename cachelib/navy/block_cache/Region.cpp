@@ -23,6 +23,18 @@ namespace facebook::cachelib::navy {
 bool Region::readyForReclaim(bool wait) {
   std::unique_lock<TimedMutex> l{lock_};
   flags_ |= kBlockAccess;
+  readBlocked_.store(true);
+  if (readEpochs_) {
+    // readers that enter from now on see the block
+    l.unlock();
+    if (wait) {
+      readEpochs_->synchronize();
+    } else if (readEpochs_->getNumReaders() != 0) {
+      // readers of other regions can not be told apart without waiting
+      return false;
+    }
+    l.lock();
+  }
   bool ready = false;
   while (!(ready = (activeOpenLocked() == 0UL)) && wait) {
     cond_.wait(l);
@@ -49,6 +61,16 @@ std::tuple<RegionDescriptor, RelAddress> Region::openAndAllocate(
 }
 
 RegionDescriptor Region::openForRead() {
+  if (readEpochs_ && physReadOnly_.load()) {
+    // check the region after entering the epoch, so that reclaim either
+    // waits for this reader or the reader sees the block
+    const auto ticket = readEpochs_->enter();
+    if (!readBlocked_.load() && physReadOnly_.load()) {
+      return RegionDescriptor::makeEpochReadDescriptor(regionId_, ticket);
+    }
+    readEpochs_->exit(ticket);
+  }
+
   std::unique_lock<TimedMutex> l{lock_};
   if (flags_ & kBlockAccess) {
     // Region is currently in reclaim, retry later
@@ -79,6 +101,7 @@ std::unique_ptr<Buffer> Region::detachBuffer() {
   XDCHECK_EQ(activeWriters_, 0UL);
   auto retBuf = std::move(buffer_);
   buffer_ = nullptr;
+  updatePhysReadOnlyLocked();
   return retBuf;
 }
 
@@ -97,6 +120,7 @@ Region::FlushRes Region::flushBuffer(
     if (callBack(RelAddress{regionId_, 0}, buffer_->view())) {
       lock.lock();
       flags_ |= kFlushed;
+      updatePhysReadOnlyLocked();
       return FlushRes::kSuccess;
     }
     return FlushRes::kRetryDeviceFailure;
@@ -127,10 +151,16 @@ void Region::reset() {
   activeInMemReaders_ = 0;
   lastEntryEndOffset_ = 0;
   numItems_ = 0;
+  updatePhysReadOnlyLocked();
+  readBlocked_.store(false);
   cond_.notifyAll();
 }
 
 void Region::close(RegionDescriptor&& desc) {
+  if (desc.isEpochRead()) {
+    readEpochs_->exit(desc.epochTicket());
+    return;
+  }
   std::lock_guard<TimedMutex> l{lock_};
   switch (desc.mode()) {
   case OpenMode::Write:
@@ -18,7 +18,10 @@
 
 #include <folly/fibers/TimedMutex.h>
 
+#include <atomic>
+
 #include "cachelib/common/ConditionVariable.h"
+#include "cachelib/navy/block_cache/RegionReadEpochs.h"
 #include "cachelib/navy/block_cache/Types.h"
 #include "cachelib/navy/common/Types.h"
 #include "cachelib/navy/serialization/Serialization.h"
@@ -54,18 +57,29 @@ class RegionDescriptor;
 
 // Region. Responsible for open/lock synchronization and keeps count of active
 // readers/writers.
+//
+// With read epochs, the readers of a region without a buffer, or whose buffer
+// is flushed, are tracked by the epochs instead of the region: they do not
+// take the region lock.
 class Region {
  public:
   // @param id         unique id for the region
   // @param regionSize region size
-  Region(RegionId id, uint64_t regionSize)
-      : regionId_{id}, regionSize_{regionSize} {}
+  // @param readEpochs optional read epochs shared by the regions
+  Region(RegionId id,
+         uint64_t regionSize,
+         RegionReadEpochs* readEpochs = nullptr)
+      : regionId_{id}, regionSize_{regionSize}, readEpochs_{readEpochs} {}
 
   // @param d          previously serialized state of Region.
   // @param regionSize size of the region.
-  Region(const serialization::Region& d, uint64_t regionSize)
+  // @param readEpochs optional read epochs shared by the regions
+  Region(const serialization::Region& d,
+         uint64_t regionSize,
+         RegionReadEpochs* readEpochs = nullptr)
       : regionId_{static_cast<uint32_t>(*d.regionId())},
         regionSize_{regionSize},
+        readEpochs_{readEpochs},
         priority_{static_cast<uint16_t>(*d.priority())},
         lastEntryEndOffset_{static_cast<uint32_t>(*d.lastEntryEndOffset())},
         numItems_{static_cast<uint32_t>(*d.numItems())} {}
@@ -135,6 +149,17 @@ class Region {
   // Writes buf to attached buffer at offset 'offset'.
   void writeToBuffer(uint32_t offset, BufferView buf);
 
+  // Writes 'size' bytes to attached buffer at offset 'offset' in place:
+  // fillFn is called with a mutable view of those bytes and must fill all
+  // of them that are meant to be read back.
+  template <typename F>
+  void writeToBuffer(uint32_t offset, uint32_t size, F&& fillFn) {
+    std::lock_guard l{lock_};
+    XDCHECK_NE(buffer_, nullptr);
+    XDCHECK_LE(offset + size, buffer_->size());
+    fillFn(MutableBufferView{size, buffer_->data() + offset});
+  }
+
   // Reads from attached buffer from 'fromOffset' into 'outBuf'.
   void readFromBuffer(uint32_t fromOffset, MutableBufferView outBuf) const;
 
@@ -143,6 +168,7 @@ class Region {
     std::lock_guard l{lock_};
     XDCHECK_EQ(buffer_, nullptr);
     buffer_ = std::move(buf);
+    updatePhysReadOnlyLocked();
   }
 
   // Checks if the region has buffer attached.
@@ -190,7 +216,7 @@ class Region {
     return activeWriters_;
   }
 
-  // Returns the number of active readers using the region.
+  // Returns the number of active in memory readers using the region.
   uint32_t getActiveInMemReaders() const {
     std::lock_guard l{lock_};
     return activeInMemReaders_;
@@ -202,6 +228,12 @@ class Region {
  private:
   uint32_t activeOpenLocked();
 
+  // Reads of the region go to the device once it has no buffer or its buffer
+  // is flushed, which lets readers skip the lock with read epochs.
+  void updatePhysReadOnlyLocked() {
+    physReadOnly_.store(isFlushedLocked() || !buffer_);
+  }
+
   // Checks to see if there is enough space in the region for a new write of
   // size 'size'.
   bool canAllocateLocked(uint32_t size) const {
@@ -220,6 +252,12 @@ class Region {
 
   const RegionId regionId_{};
   const uint64_t regionSize_{0};
+  RegionReadEpochs* const readEpochs_{nullptr};
+
+  // kBlockAccess and updatePhysReadOnlyLocked() as seen by the readers that
+  // do not take the lock
+  std::atomic<bool> readBlocked_{false};
+  std::atomic<bool> physReadOnly_{true};
 
   uint16_t priority_{0};
   uint16_t flags_{0};
@@ -251,6 +289,14 @@ class RegionDescriptor {
                                              bool physReadMode) {
     return RegionDescriptor{status, regionId, OpenMode::Read, physReadMode};
   }
+  // physical read tracked by the read epochs rather than the region
+  static RegionDescriptor makeEpochReadDescriptor(
+      RegionId regionId, RegionReadEpochs::Ticket ticket) {
+    RegionDescriptor desc{OpenStatus::Ready, regionId, OpenMode::Read, true};
+    desc.epochRead_ = true;
+    desc.ticket_ = ticket;
+    return desc;
+  }
   RegionDescriptor(const RegionDescriptor&) = delete;
   RegionDescriptor& operator=(const RegionDescriptor&) = delete;
 
@@ -258,11 +304,14 @@ class RegionDescriptor {
       : status_{o.status_},
         regionId_{o.regionId_},
         mode_{o.mode_},
-        physReadMode_{o.physReadMode_} {
+        physReadMode_{o.physReadMode_},
+        epochRead_{o.epochRead_},
+        ticket_{o.ticket_} {
     o.mode_ = OpenMode::None;
     o.regionId_ = RegionId{};
     o.status_ = OpenStatus::Retry;
     o.physReadMode_ = false;
+    o.epochRead_ = false;
   }
 
   RegionDescriptor& operator=(RegionDescriptor&& o) noexcept {
@@ -290,6 +339,12 @@ class RegionDescriptor {
   // Returns the unique region ID.
   RegionId id() const { return regionId_; }
 
+  // Checks whether the read is tracked by the read epochs.
+  bool isEpochRead() const { return epochRead_; }
+
+  // Returns the ticket of the read epoch, if isEpochRead()
+  RegionReadEpochs::Ticket epochTicket() const { return ticket_; }
+
  private:
   RegionDescriptor(OpenStatus status,
                    RegionId regionId,
@@ -305,6 +360,8 @@ class RegionDescriptor {
   OpenMode mode_{OpenMode::None};
   // physReadMode_ is applicable only in read mode
   bool physReadMode_{false};
+  bool epochRead_{false};
+  RegionReadEpochs::Ticket ticket_{};
 };
 } // namespace navy
 } // namespace cachelib
@@ -16,11 +16,21 @@
 
 #include "cachelib/navy/block_cache/RegionManager.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "cachelib/common/inject_pause.h"
 #include "cachelib/navy/common/Utils.h"
 #include "cachelib/navy/scheduler/JobScheduler.h"
 
 namespace facebook::cachelib::navy {
+namespace {
+// Exponential moving average giving the latest sample a weight of 1/8
+double movingAverage(double avg, double sample) {
+  return avg == 0 ? sample : avg + (sample - avg) / 8;
+}
+} // namespace
+
 RegionManager::RegionManager(uint32_t numRegions,
                              uint64_t regionSize,
                              uint64_t baseOffset,
@@ -33,7 +43,11 @@ RegionManager::RegionManager(uint32_t numRegions,
                              std::unique_ptr<EvictionPolicy> policy,
                              uint32_t numInMemBuffers,
                              uint16_t numPriorities,
-                             uint16_t inMemBufFlushRetryLimit)
+                             uint16_t inMemBufFlushRetryLimit,
+                             uint32_t maxCleanRegions,
+                             uint64_t readPageCachePages,
+                             uint32_t flushedRegionCacheRegions,
+                             bool placementByPriority)
     : numPriorities_{numPriorities},
       inMemBufFlushRetryLimit_{inMemBufFlushRetryLimit},
       numRegions_{numRegions},
@@ -43,18 +57,35 @@ RegionManager::RegionManager(uint32_t numRegions,
       policy_{std::move(policy)},
       regions_{std::make_unique<std::unique_ptr<Region>[]>(numRegions)},
       numCleanRegions_{numCleanRegions},
+      maxCleanRegions_{std::max(numCleanRegions, maxCleanRegions)},
+      cleanRegionsTarget_{numCleanRegions},
       evictCb_{evictCb},
       cleanupCb_{cleanupCb},
       numInMemBuffers_{numInMemBuffers},
-      placementHandle_{device_.allocatePlacementHandle()} {
+      readPageCache_{readPageCachePages == 0
+                         ? nullptr
+                         : std::make_unique<ReadPageCache>(
+                               numRegions, device_.getIOAlignmentSize(),
+                               readPageCachePages)},
+      flushedRegionCache_{flushedRegionCacheRegions == 0
+                              ? nullptr
+                              : std::make_unique<FlushedRegionCache>(
+                                    numRegions, flushedRegionCacheRegions)} {
   XLOGF(INFO, "{} regions, {} bytes each", numRegions_, regionSize_);
   for (uint32_t i = 0; i < numRegions; i++) {
-    regions_[i] = std::make_unique<Region>(RegionId{i}, regionSize_);
+    regions_[i] =
+        std::make_unique<Region>(RegionId{i}, regionSize_, &readEpochs_);
   }
 
   XDCHECK_LT(0u, numInMemBuffers_);
 
-  for (uint32_t i = 0; i < numInMemBuffers_; i++) {
+  const uint16_t numHandles =
+      placementByPriority ? std::max<uint16_t>(numPriorities_, 1) : 1;
+  for (uint16_t i = 0; i < numHandles; i++) {
+    placementHandles_.push_back(device_.allocatePlacementHandle());
+  }
+
+  for (uint32_t i = 0; i < numInMemBuffers_ + flushedRegionCacheRegions; i++) {
     buffers_.push_back(
         std::make_unique<Buffer>(device.makeIOBuffer(regionSize_)));
   }
@@ -104,11 +135,20 @@ void RegionManager::reset() {
     // reclaims, have to be finished first.
     XDCHECK_EQ(reclaimsOutstanding_, 0u);
     cleanRegions_.clear();
+    degradedRegions_.clear();
     if (cleanRegionsCond_.numWaiters() > 0) {
       cleanRegionsCond_.notifyAll();
     }
   }
   seqNumber_.store(0, std::memory_order_release);
+  if (readPageCache_) {
+    readPageCache_->reset();
+  }
+  if (flushedRegionCache_) {
+    for (auto& buf : flushedRegionCache_->reset()) {
+      addBufferToPool(std::move(buf));
+    }
+  }
 
   // Reset eviction policy
   resetEvictionPolicy();
@@ -130,11 +170,20 @@ Region::FlushRes RegionManager::flushBuffer(const RegionId& rid) {
   return region.flushBuffer(std::move(callBack));
 }
 
-void RegionManager::detachBuffer(const RegionId& rid) {
+void RegionManager::detachBuffer(const RegionId& rid, bool retain) {
   auto& region = getRegion(rid);
   // detach buffer can return nullptr if there are active readers
   auto buf = region.detachBuffer();
   XDCHECK(!!buf);
+  if (retain && flushedRegionCache_) {
+    // the cache hands back the buffer of the oldest region it keeps
+    buf = flushedRegionCache_->insert(rid, std::move(buf));
+    numInMemBufActive_.dec();
+    if (buf) {
+      addBufferToPool(std::move(buf));
+    }
+    return;
+  }
   returnBufferToPool(std::move(buf));
 }
 
@@ -221,16 +270,19 @@ RegionManager::getCleanRegion(RegionId& rid, bool addWaiter) {
       cleanRegions_.pop_back();
       INJECT_PAUSE(pause_blockcache_clean_alloc_locked);
       status = OpenStatus::Ready;
+      updateCleanRegionsTarget(getSteadyClock());
     } else {
       if (addWaiter) {
         waiter = std::make_unique<CondWaiter>();
         cleanRegionsCond_.addWaiter(waiter.get());
       }
       status = OpenStatus::Retry;
+      cleanRegionsStalled_ = true;
     }
+    const auto target = cleanRegionsTarget_.load(std::memory_order_relaxed);
     auto plannedClean = cleanRegions_.size() + reclaimsOutstanding_;
-    if (plannedClean < numCleanRegions_) {
-      newSched = numCleanRegions_ - plannedClean;
+    if (plannedClean < target) {
+      newSched = target - plannedClean;
       reclaimsOutstanding_ += newSched;
     }
   }
@@ -257,6 +309,34 @@ RegionManager::getCleanRegion(RegionId& rid, bool addWaiter) {
   return {status, std::move(waiter)};
 }
 
+void RegionManager::updateCleanRegionsTarget(std::chrono::nanoseconds now) {
+  if (maxCleanRegions_ == numCleanRegions_) {
+    return;
+  }
+  if (lastCleanRegionAlloc_.count() != 0) {
+    allocIntervalNsAvg_ = movingAverage(
+        allocIntervalNsAvg_,
+        static_cast<double>((now - lastCleanRegionAlloc_).count()));
+  }
+  lastCleanRegionAlloc_ = now;
+
+  auto target = cleanRegionsTarget_.load(std::memory_order_relaxed);
+  if (cleanRegionsStalled_) {
+    // reclaim did not keep up, keep one more region clean
+    cleanRegionsStalled_ = false;
+    target = std::min(target + 1, maxCleanRegions_);
+  } else if (allocIntervalNsAvg_ > 0 && reclaimTimeNsAvg_ > 0) {
+    // writes slowed down, keep as many as get allocated during a reclaim and
+    // one to spare
+    const double needed =
+        std::ceil(reclaimTimeNsAvg_ / allocIntervalNsAvg_) + 1;
+    if (needed < target) {
+      target = std::max(numCleanRegions_, static_cast<uint32_t>(needed));
+    }
+  }
+  cleanRegionsTarget_.store(target, std::memory_order_relaxed);
+}
+
 void RegionManager::doFlush(RegionId rid, bool async) {
   // We're wasting the remaining bytes of a region, so track it for stats
   externalFragmentation_.add(getRegion(rid).getFragmentationSize());
@@ -299,7 +379,7 @@ void RegionManager::doFlushInternal(RegionId rid) {
   }
 
   INJECT_PAUSE(pause_flush_detach_buffer);
-  detachBuffer(rid);
+  detachBuffer(rid, true /* retain */);
 
   // Flush completed, track the region
   track(rid);
@@ -336,7 +416,12 @@ void RegionManager::doReclaim() {
     auto desc = RegionDescriptor::makeReadDescriptor(
         OpenStatus::Ready, RegionId{rid}, true /* physRead */);
     auto sizeToRead = region.getLastEntryEndOffset();
-    auto buffer = read(desc, RelAddress{rid, 0}, sizeToRead);
+    Buffer buffer{sizeToRead};
+    if (!flushedRegionCache_ ||
+        !flushedRegionCache_->read(rid, 0, buffer.mutableView())) {
+      buffer = read(desc, RelAddress{rid, 0}, sizeToRead,
+                    IoClass::kReclaimRead);
+    }
     if (buffer.size() != sizeToRead) {
       // TODO: remove when we fix T95777575
       XLOGF(ERR,
@@ -413,6 +498,14 @@ void RegionManager::releaseEvictedRegion(RegionId rid,
   auto& region = getRegion(rid);
   // Subtract the wasted bytes in the end since we're reclaiming this region now
   externalFragmentation_.sub(getRegion(rid).getFragmentationSize());
+  if (flushedRegionCache_) {
+    if (auto buf = flushedRegionCache_->remove(rid)) {
+      addBufferToPool(std::move(buf));
+    }
+  }
+  if (readPageCache_) {
+    readPageCache_->invalidateRegion(rid);
+  }
 
   // Full barrier because we cannot have seqNumber_.fetch_add() re-ordered
   // below region.reset(). If it is re-ordered then, we can end up with a data
@@ -422,16 +515,38 @@ void RegionManager::releaseEvictedRegion(RegionId rid,
   // Reset all region internal state, making it ready to be
   // used by a region allocator.
   region.reset();
+  const auto reclaimTime = getSteadyClock() - startTime;
+  bool reclaimAnother = false;
   {
     std::lock_guard<TimedMutex> lock{cleanRegionsMutex_};
-    reclaimsOutstanding_--;
-    cleanRegions_.push_back(rid);
+    reclaimTimeNsAvg_ = movingAverage(
+        reclaimTimeNsAvg_, static_cast<double>(reclaimTime.count()));
+    // Regions set aside on a degraded device are clean once it is healthy
+    auto healthy =
+        std::partition(degradedRegions_.begin(), degradedRegions_.end(),
+                       [this](RegionId r) { return isOnDegradedDevice(r); });
+    cleanRegions_.insert(cleanRegions_.end(), healthy, degradedRegions_.end());
+    degradedRegions_.erase(healthy, degradedRegions_.end());
+
+    // Set the region aside instead of writing to the degraded device, and
+    // reclaim another one in its place. At most half of the regions are set
+    // aside so that reclaim always finds regions elsewhere.
+    if (isOnDegradedDevice(rid) && degradedRegions_.size() < numRegions_ / 2) {
+      degradedRegions_.push_back(rid);
+      reclaimAnother = true;
+    } else {
+      reclaimsOutstanding_--;
+      cleanRegions_.push_back(rid);
+    }
     INJECT_PAUSE(pause_blockcache_clean_free_locked);
     if (cleanRegionsCond_.numWaiters() > 0) {
       cleanRegionsCond_.notifyAll();
     }
   }
-  reclaimTimeCountUs_.add(toMicros(getSteadyClock() - startTime).count());
+  if (reclaimAnother) {
+    startReclaim();
+  }
+  reclaimTimeCountUs_.add(toMicros(reclaimTime).count());
   reclaimCount_.inc();
 }
 
@@ -488,8 +603,8 @@ void RegionManager::recover(RecordReader& rr) {
     if (numPriorities_ > 0 && regionProto.priority() >= numPriorities_) {
       regionProto.priority() = numPriorities_ - 1;
     }
-    regions_[index] =
-        std::make_unique<Region>(regionProto, *regionData.regionSize());
+    regions_[index] = std::make_unique<Region>(
+        regionProto, *regionData.regionSize(), &readEpochs_);
   }
 
   // Reset policy and reinitialize it per the recovered state
@@ -527,8 +642,10 @@ bool RegionManager::isValidIORange(uint32_t offset, uint32_t size) const {
 bool RegionManager::deviceWrite(RelAddress addr, Buffer buf) {
   const auto bufSize = buf.size();
   XDCHECK(isValidIORange(addr.offset(), bufSize));
+  chargeIo(IoClass::kFlush, bufSize);
   auto physOffset = physicalOffset(addr);
-  if (!device_.write(physOffset, std::move(buf), placementHandle_)) {
+  if (!device_.write(physOffset, std::move(buf),
+                     getPlacementHandle(addr.rid()))) {
     return false;
   }
   physicalWrittenCount_.add(bufSize);
@@ -538,14 +655,24 @@ bool RegionManager::deviceWrite(RelAddress addr, Buffer buf) {
 bool RegionManager::deviceWrite(RelAddress addr, BufferView view) {
   const auto bufSize = view.size();
   XDCHECK(isValidIORange(addr.offset(), bufSize));
+  chargeIo(IoClass::kFlush, bufSize);
   auto physOffset = physicalOffset(addr);
-  if (!device_.write(physOffset, view, placementHandle_)) {
+  if (!device_.write(physOffset, view, getPlacementHandle(addr.rid()))) {
     return false;
   }
   physicalWrittenCount_.add(bufSize);
   return true;
 }
 
+int RegionManager::getPlacementHandle(RegionId rid) const {
+  if (placementHandles_.size() == 1) {
+    return placementHandles_[0];
+  }
+  const auto priority = getRegion(rid).getPriority();
+  XDCHECK_LT(priority, placementHandles_.size());
+  return placementHandles_[priority];
+}
+
 void RegionManager::write(RelAddress addr, Buffer buf) {
   auto rid = addr.rid();
   auto& region = getRegion(rid);
@@ -554,7 +681,8 @@ void RegionManager::write(RelAddress addr, Buffer buf) {
 
 Buffer RegionManager::read(const RegionDescriptor& desc,
                            RelAddress addr,
-                           size_t size) const {
+                           size_t size,
+                           IoClass ioClass) const {
   auto rid = addr.rid();
   auto& region = getRegion(rid);
   // Do not expect to read beyond what was already written
@@ -567,9 +695,98 @@ Buffer RegionManager::read(const RegionDescriptor& desc,
   }
   XDCHECK(isValidIORange(addr.offset(), size));
 
+  chargeIo(ioClass, size);
   return device_.read(physicalOffset(addr), size);
 }
 
+void RegionManager::chargeIo(IoClass ioClass, uint64_t bytes) const {
+  if (auto* ioBudget = device_.getIoBudget()) {
+    ioBudget->acquire(ioClass, bytes);
+  }
+}
+
+bool RegionManager::tryChargeIo(IoClass ioClass, uint64_t bytes) const {
+  auto* ioBudget = device_.getIoBudget();
+  return !ioBudget || ioBudget->tryAcquire(ioClass, bytes);
+}
+
+Buffer RegionManager::readCached(const RegionDescriptor& desc,
+                                 RelAddress addr,
+                                 size_t size) const {
+  if (flushedRegionCache_ && desc.isPhysReadMode()) {
+    Buffer buffer{size};
+    if (flushedRegionCache_->read(addr.rid(), addr.offset(),
+                                  buffer.mutableView())) {
+      return buffer;
+    }
+  }
+  if (!readPageCache_ || !desc.isPhysReadMode()) {
+    return read(desc, addr, size);
+  }
+  const auto rid = addr.rid();
+  const uint32_t pageSize = readPageCache_->getPageSize();
+  const uint32_t begin = addr.offset() & ~(pageSize - 1);
+  const uint64_t end = powTwoAlign(addr.offset() + size, pageSize);
+  if (end - begin > ReadPageCache::kMaxPagesPerRead * pageSize) {
+    return read(desc, addr, size);
+  }
+
+  Buffer buffer{size};
+  if (readPageCache_->read(rid, addr.offset(), buffer.mutableView())) {
+    return buffer;
+  }
+  // the end of the last page may not be written yet
+  const auto readEnd = std::min<uint64_t>(
+      end, getRegion(rid).getLastEntryEndOffset());
+  auto pages = read(desc, RelAddress{rid, begin}, readEnd - begin);
+  if (pages.size() != readEnd - begin) {
+    return Buffer{};
+  }
+  readPageCache_->insert(rid, begin, pages.view());
+  pages.trimStart(addr.offset() - begin);
+  pages.shrink(size);
+  return pages;
+}
+
+void RegionManager::readBatch(folly::Range<BatchRead*> reads) const {
+  std::vector<Device::BatchRead> deviceReads;
+  std::vector<size_t> deviceReadIdx;
+  for (size_t i = 0; i < reads.size(); i++) {
+    auto& r = reads[i];
+    if (!r.desc->isPhysReadMode()) {
+      r.buffer = read(*r.desc, r.addr, r.size);
+      continue;
+    }
+    if (flushedRegionCache_) {
+      Buffer buffer{r.size};
+      if (flushedRegionCache_->read(r.addr.rid(), r.addr.offset(),
+                                    buffer.mutableView())) {
+        r.buffer = std::move(buffer);
+        continue;
+      }
+    }
+    XDCHECK_LE(r.addr.offset() + r.size,
+               getRegion(r.addr.rid()).getLastEntryEndOffset());
+    XDCHECK(isValidIORange(r.addr.offset(), r.size));
+    deviceReads.push_back(Device::BatchRead{
+        physicalOffset(r.addr), static_cast<uint32_t>(r.size)});
+    deviceReadIdx.push_back(i);
+  }
+  if (deviceReads.empty()) {
+    return;
+  }
+
+  uint64_t bytes = 0;
+  for (const auto& r : deviceReads) {
+    bytes += r.size;
+  }
+  chargeIo(IoClass::kUserRead, bytes);
+  device_.readBatch(folly::range(deviceReads));
+  for (size_t i = 0; i < deviceReads.size(); i++) {
+    reads[deviceReadIdx[i]].buffer = std::move(deviceReads[i].buffer);
+  }
+}
+
 void RegionManager::drain() {
   for (auto& worker : workers_) {
     worker->drain();
@@ -594,6 +811,9 @@ void RegionManager::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_num_regions", numRegions_);
   visitor("navy_bc_num_clean_regions", cleanRegions_.size());
+  visitor("navy_bc_num_degraded_regions", degradedRegions_.size());
+  visitor("navy_bc_clean_regions_target",
+          cleanRegionsTarget_.load(std::memory_order_relaxed));
   visitor("navy_bc_num_clean_region_retries", cleanRegionRetries_.get(),
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_external_fragmentation", externalFragmentation_.get());
@@ -605,6 +825,12 @@ void RegionManager::getCounters(const CounterVisitor& visitor) const {
           CounterVisitor::CounterType::RATE);
   visitor("navy_bc_inmem_flush_failures", numInMemBufFlushFailures_.get(),
           CounterVisitor::CounterType::RATE);
+  if (flushedRegionCache_) {
+    flushedRegionCache_->getCounters(visitor);
+  }
+  if (readPageCache_) {
+    readPageCache_->getCounters(visitor);
+  }
   policy_->getCounters(visitor);
 }
 } // namespace facebook::cachelib::navy
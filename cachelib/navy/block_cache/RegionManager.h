@@ -27,6 +27,8 @@
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/ConditionVariable.h"
 #include "cachelib/navy/block_cache/EvictionPolicy.h"
+#include "cachelib/navy/block_cache/FlushedRegionCache.h"
+#include "cachelib/navy/block_cache/ReadPageCache.h"
 #include "cachelib/navy/block_cache/Region.h"
 #include "cachelib/navy/block_cache/Types.h"
 #include "cachelib/navy/common/Buffer.h"
@@ -81,6 +83,17 @@ class RegionManager {
   //                                  regions
   // @param inMemBufFlushRetryLimit   max number of flushing retry times for
   //                                  in-mem buffer
+  // @param maxCleanRegions           if larger than @numCleanRegions, the
+  //                                  clean pool adapts to the write rate and
+  //                                  may grow up to this many regions
+  // @param readPageCachePages        number of device pages to keep in the
+  //                                  ReadPageCache, 0 to disable it
+  // @param flushedRegionCacheRegions number of flushed region buffers to keep
+  //                                  in the FlushedRegionCache, on top of
+  //                                  @numInMemBuffers, 0 to disable it
+  // @param placementByPriority       allocate a device placement handle for
+  //                                  every priority instead of one for all
+  //                                  regions
   RegionManager(uint32_t numRegions,
                 uint64_t regionSize,
                 uint64_t baseOffset,
@@ -93,7 +106,11 @@ class RegionManager {
                 std::unique_ptr<EvictionPolicy> policy,
                 uint32_t numInMemBuffers,
                 uint16_t numPriorities,
-                uint16_t inMemBufFlushRetryLimit);
+                uint16_t inMemBufFlushRetryLimit,
+                uint32_t maxCleanRegions = 0,
+                uint64_t readPageCachePages = 0,
+                uint32_t flushedRegionCacheRegions = 0,
+                bool placementByPriority = false);
   RegionManager(const RegionManager&) = delete;
   RegionManager& operator=(const RegionManager&) = delete;
 
@@ -105,6 +122,9 @@ class RegionManager {
     return static_cast<uint64_t>(numRegions_) * regionSize_;
   }
 
+  // return the number of regions
+  uint32_t numRegions() const { return numRegions_; }
+
   // Gets a region from a valid region ID.
   Region& getRegion(RegionId rid) {
     XDCHECK(rid.valid());
@@ -169,13 +189,7 @@ class RegionManager {
 
   // Returns the buffer to the pool.
   void returnBufferToPool(std::unique_ptr<Buffer> buf) {
-    {
-      std::lock_guard<TimedMutex> bufLock{bufferMutex_};
-      buffers_.push_back(std::move(buf));
-      if (bufferCond_.numWaiters() > 0) {
-        bufferCond_.notifyAll();
-      }
-    }
+    addBufferToPool(std::move(buf));
     numInMemBufActive_.dec();
   }
 
@@ -184,6 +198,15 @@ class RegionManager {
   // @buf may be mutated and will be de-allocated at the end of this
   void write(RelAddress addr, Buffer buf);
 
+  // Writes @size bytes at the @addr by letting @fillFn fill them directly in
+  // the region's buffer. This saves the copy through an intermediate buffer.
+  // @addr must be the address returned by Region::open(OpenMode::Write)
+  template <typename F>
+  void write(RelAddress addr, uint32_t size, F&& fillFn) {
+    getRegion(addr.rid())
+        .writeToBuffer(addr.offset(), size, std::forward<F>(fillFn));
+  }
+
   bool deviceWrite(RelAddress addr, Buffer buf);
 
   // Returns a buffer with data read from the device the @addr of size bytes
@@ -191,8 +214,40 @@ class RegionManager {
   //
   // On success the returned buffer will have same size as "size" argument.
   // Caller must check the size of the buffer returned to determine if this
-  // succeeded or not.
-  Buffer read(const RegionDescriptor& desc, RelAddress addr, size_t size) const;
+  // succeeded or not. A read from the device is charged to @ioClass of the
+  // IO budget of the device, if it has one.
+  Buffer read(const RegionDescriptor& desc,
+              RelAddress addr,
+              size_t size,
+              IoClass ioClass = IoClass::kUserRead) const;
+
+  // Same as read(), but serves reads of recently flushed regions from the
+  // FlushedRegionCache and small reads of other flushed regions from the
+  // ReadPageCache, if enabled. On a ReadPageCache miss, all the pages the
+  // read touches are read and cached.
+  Buffer readCached(const RegionDescriptor& desc,
+                    RelAddress addr,
+                    size_t size) const;
+
+  // A read in a batch passed to readBatch
+  struct BatchRead {
+    const RegionDescriptor* desc{nullptr};
+    RelAddress addr;
+    size_t size{0};
+    // Filled by readBatch. Null if the read failed.
+    Buffer buffer;
+  };
+
+  // Reads every entry of @reads as read(desc, addr, size) would. The reads
+  // from regions without an in memory buffer are submitted to the device
+  // together.
+  void readBatch(folly::Range<BatchRead*> reads) const;
+
+  // Charges @bytes of IO to @ioClass of the IO budget of the device if it is
+  // within the budget, without waiting
+  //
+  // @return false if it is not. True if the device has no budget.
+  bool tryChargeIo(IoClass ioClass, uint64_t bytes) const;
 
   // Flushes all in memory buffers to the device and then issues device flush.
   void flush();
@@ -208,7 +263,9 @@ class RegionManager {
 
   // Detaches the buffer from the region and returns the buffer to pool.
   // This could block if there are active readers
-  void detachBuffer(const RegionId& rid);
+  // @param retain  keep the buffer in the FlushedRegionCache if enabled, and
+  //                return the buffer it drops instead
+  void detachBuffer(const RegionId& rid, bool retain = false);
 
   // Cleans up the in memory buffer when flushing failure reach the retry limit.
   // This could block if there are active readers or writers
@@ -260,6 +317,12 @@ class RegionManager {
   //                   it is used to count the reclamation time duration
   void releaseEvictedRegion(RegionId rid, std::chrono::nanoseconds startTime);
 
+  // Whether region @rid is on a degraded member of the device
+  bool isOnDegradedDevice(RegionId rid) const {
+    return device_.isDegraded(physicalOffset(RelAddress{rid, 0}),
+                              static_cast<uint32_t>(regionSize_));
+  }
+
   // Evicts a region by calling @evictCb_ during region reclamation.
   void doEviction(RegionId rid, BufferView buffer) const;
 
@@ -285,11 +348,36 @@ class RegionManager {
   }
 
   void doReclaim();
+
+  // Adapts the clean pool size to the write rate. The pool grows by one
+  // region after a writer found it empty. Otherwise it shrinks to one more
+  // than the regions allocated while a reclaim runs, from the average time
+  // between allocations and the average reclaim time. Called with
+  // @cleanRegionsMutex_ held when a region is allocated.
+  void updateCleanRegionsTarget(std::chrono::nanoseconds now);
+
   void doFlushInternal(RegionId rid);
 
+  // Puts @buf into the pool and wakes up the waiters, without accounting it
+  // as released by a region.
+  void addBufferToPool(std::unique_ptr<Buffer> buf) {
+    std::lock_guard<TimedMutex> bufLock{bufferMutex_};
+    buffers_.push_back(std::move(buf));
+    if (bufferCond_.numWaiters() > 0) {
+      bufferCond_.notifyAll();
+    }
+  }
+
   bool deviceWrite(RelAddress addr, BufferView buf);
 
+  // Returns the device placement handle region @rid is written with
+  int getPlacementHandle(RegionId rid) const;
+
   bool isValidIORange(uint32_t offset, uint32_t size) const;
+
+  // Charges @bytes of IO to @ioClass of the IO budget of the device, waiting
+  // until it is within the budget. No-op if the device has no budget.
+  void chargeIo(IoClass ioClass, uint64_t bytes) const;
   std::pair<OpenStatus, std::unique_ptr<CondWaiter>> assignBufferToRegion(
       RegionId rid, bool addWaiter);
 
@@ -305,6 +393,8 @@ class RegionManager {
   const uint64_t baseOffset_{};
   Device& device_;
   const std::unique_ptr<EvictionPolicy> policy_;
+  // tracks the readers of flushed regions, which skip the region lock
+  RegionReadEpochs readEpochs_;
   std::unique_ptr<std::unique_ptr<Region>[]> regions_;
   mutable AtomicCounter externalFragmentation_;
 
@@ -314,9 +404,25 @@ class RegionManager {
   mutable TimedMutex cleanRegionsMutex_;
   mutable util::ConditionVariable cleanRegionsCond_;
   std::vector<RegionId> cleanRegions_;
+  // Reclaimed regions on degraded device members, kept out of use until the
+  // members are healthy again. Guarded by @cleanRegionsMutex_.
+  std::vector<RegionId> degradedRegions_;
   const uint32_t numCleanRegions_{};
+  const uint32_t maxCleanRegions_{};
   mutable AtomicCounter cleanRegionRetries_;
 
+  // Number of clean regions reclaim currently maintains, between
+  // @numCleanRegions_ and @maxCleanRegions_. Written with
+  // @cleanRegionsMutex_ held, read without it for stats.
+  std::atomic<uint32_t> cleanRegionsTarget_{0};
+  // Whether a writer found no clean region since the last allocation, and
+  // moving averages of the time between clean region allocations and of the
+  // reclaim time. Guarded by @cleanRegionsMutex_.
+  bool cleanRegionsStalled_{false};
+  std::chrono::nanoseconds lastCleanRegionAlloc_{0};
+  double allocIntervalNsAvg_{0};
+  double reclaimTimeNsAvg_{0};
+
   std::atomic<uint64_t> seqNumber_{0};
 
   uint32_t reclaimsOutstanding_{0};
@@ -350,7 +456,14 @@ class RegionManager {
   mutable TimedMutex bufferMutex_;
   mutable util::ConditionVariable bufferCond_;
   std::vector<std::unique_ptr<Buffer>> buffers_;
-  int placementHandle_;
+  // Device placement handles of the region priorities, a single one shared
+  // by all of them unless placement by priority is enabled
+  std::vector<int> placementHandles_;
+
+  // nullptr if disabled
+  std::unique_ptr<ReadPageCache> readPageCache_;
+  // nullptr if disabled. Owns buffers allocated on top of numInMemBuffers_.
+  std::unique_ptr<FlushedRegionCache> flushedRegionCache_;
 };
 } // namespace navy
 } // namespace cachelib
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cachelib/common/ReadEpochs.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+
+// Tracks the physical readers of the regions of a region manager without a
+// counter per region. A reader enters the current epoch on the stripe of its
+// cpu and exits it when it closes the region, so readers of a hot region on
+// different cpus do not share a cacheline or take the region lock.
+//
+// Reclaim first blocks the region, then advances the epoch and waits until
+// every reader of the previous epoch has exited. A reader that entered after
+// the region was blocked sees the block and exits right away, so the readers
+// of the region are all gone once synchronize() returns. Readers of other
+// regions that entered the previous epoch are waited for as well, which only
+// lasts as long as a read.
+//
+// Readers on fibers may be suspended while they read, hence readers are
+// counted per stripe rather than tracked per thread.
+using RegionReadEpochs = ReadEpochs;
+
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
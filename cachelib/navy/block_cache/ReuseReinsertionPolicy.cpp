@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/ReuseReinsertionPolicy.h"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "cachelib/navy/common/Hash.h"
+#include "cachelib/navy/common/Utils.h"
+
+namespace facebook::cachelib::navy {
+ReuseReinsertionPolicy::ReuseReinsertionPolicy(uint8_t reuseThreshold,
+                                               uint64_t maxBytesPerSec,
+                                               const Index& index)
+    : reuseThreshold_{reuseThreshold},
+      maxBytesPerSec_{maxBytesPerSec},
+      index_(index),
+      budgetBytes_{maxBytesPerSec},
+      lastRefill_{getSteadyClock()} {}
+
+bool ReuseReinsertionPolicy::shouldReinsert(folly::StringPiece key,
+                                            folly::StringPiece value) {
+  const auto lr = index_.peek(
+      makeHK(
+          BufferView{key.size(), reinterpret_cast<const uint8_t*>(key.data())})
+          .keyHash());
+  if (!lr.found()) {
+    return false;
+  }
+  const auto score = doubledScore(lr);
+  if (score < 2u * reuseThreshold_) {
+    return false;
+  }
+  if (!consumeBudget(key.size() + value.size())) {
+    budgetRejections_.inc();
+    return false;
+  }
+
+  scoreOnReinsertionEstimator_.trackValue(score / 2);
+  return true;
+}
+
+bool ReuseReinsertionPolicy::consumeBudget(uint64_t bytes) {
+  if (maxBytesPerSec_ == 0) {
+    return true;
+  }
+  std::lock_guard<TimedMutex> l{budgetMutex_};
+  const auto now = getSteadyClock();
+  const auto elapsedNs = static_cast<uint64_t>((now - lastRefill_).count());
+  // refill in whole bytes, keeping the remainder of the elapsed time
+  const auto refill = static_cast<uint64_t>(
+      static_cast<double>(elapsedNs) * maxBytesPerSec_ / 1'000'000'000);
+  if (refill > 0) {
+    budgetBytes_ = std::min(maxBytesPerSec_, budgetBytes_ + refill);
+    lastRefill_ = now;
+  }
+  if (budgetBytes_ < bytes) {
+    return false;
+  }
+  budgetBytes_ -= bytes;
+  return true;
+}
+
+void ReuseReinsertionPolicy::getCounters(
+    const util::CounterVisitor& visitor) const {
+  visitor("navy_bc_reinsertion_budget_rejections", budgetRejections_.get(),
+          util::CounterVisitor::CounterType::RATE);
+  scoreOnReinsertionEstimator_.visitQuantileEstimator(
+      visitor, "navy_bc_item_reinsertion_reuse_score");
+}
+
+} // namespace facebook::cachelib::navy
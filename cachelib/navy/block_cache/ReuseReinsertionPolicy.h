@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/fibers/TimedMutex.h>
+
+#include <chrono>
+#include <cstdint>
+
+#include "cachelib/allocator/nvmcache/BlockCacheReinsertionPolicy.h"
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/common/PercentileStats.h"
+#include "cachelib/navy/block_cache/Index.h"
+#include "folly/Range.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+using folly::fibers::TimedMutex;
+
+// Reuse based reinsertion policy.
+// Predicts whether an evicted item will be hit again from its hits: the hits
+// since it was last written count fully, the hits of its earlier stays in
+// block cache count half, so an item that stopped being read loses its chance
+// after one more eviction. Items scoring at least the threshold are
+// reinserted as long as the reinsertion write budget allows, which bounds the
+// extra device writes reinsertions cost.
+class ReuseReinsertionPolicy : public BlockCacheReinsertionPolicy {
+ public:
+  // @param reuseThreshold      minimum reuse score to reinsert an item
+  // @param maxBytesPerSec      reinsertion write budget, 0 for unlimited
+  // @param index               index to read the item hits from
+  ReuseReinsertionPolicy(uint8_t reuseThreshold,
+                         uint64_t maxBytesPerSec,
+                         const Index& index);
+
+  // Reinserts the item if its reuse score reaches the threshold and the
+  // write budget has room for it.
+  bool shouldReinsert(folly::StringPiece key,
+                      folly::StringPiece value) override;
+
+  // Exports reuse based reinsertion policy stats via CounterVisitor.
+  void getCounters(const util::CounterVisitor& visitor) const override;
+
+  // Reuse score scaled by 2 to stay in integers.
+  static uint32_t doubledScore(const Index::LookupResult& lr) {
+    return 2u * lr.currentHits() + (lr.totalHits() - lr.currentHits());
+  }
+
+ private:
+  // Takes @bytes from the write budget if there is enough left.
+  bool consumeBudget(uint64_t bytes);
+
+  const uint8_t reuseThreshold_{};
+  const uint64_t maxBytesPerSec_{};
+
+  const Index& index_;
+
+  // write budget left, refilled at @maxBytesPerSec_ up to one second's worth
+  TimedMutex budgetMutex_;
+  uint64_t budgetBytes_{};
+  std::chrono::nanoseconds lastRefill_{};
+
+  mutable AtomicCounter budgetRejections_;
+  mutable util::PercentileStats scoreOnReinsertionEstimator_{
+      Index::kQuantileWindowSize};
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
+
+#include <folly/Format.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/lang/Bits.h>
+
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "cachelib/navy/serialization/Serialization.h"
+
+namespace facebook::cachelib::navy {
+constexpr uint32_t SparseMapIndex::kNumBuckets; // Link error otherwise
+
+namespace {
+// increase val if no overflow, otherwise do nothing
+uint8_t safeInc(uint8_t val) {
+  if (val < std::numeric_limits<uint8_t>::max()) {
+    return val + 1;
+  }
+  return val;
+}
+
+// The flat format of a persisted bucket: a header followed by an array of
+// entries, in the native byte order. The first byte of the magic is not a
+// valid thrift field type, so that a flat bucket is never mistaken for a
+// thrift IndexBucket.
+constexpr uint32_t kFlatBucketMagic{0x584449ff};
+constexpr uint32_t kFlatBucketVersion{1};
+
+struct FOLLY_PACK_ATTR FlatBucketHeader {
+  uint32_t magic{kFlatBucketMagic};
+  uint32_t version{kFlatBucketVersion};
+  uint32_t bucketId{0};
+  uint32_t numEntries{0};
+};
+
+struct FOLLY_PACK_ATTR FlatEntry {
+  uint32_t key{0};
+  Index::ItemRecord record;
+};
+static_assert(12 == sizeof(FlatEntry), "FlatEntry size is 12 bytes");
+
+// Decodes a persisted bucket of either format and calls @fn with its id and
+// its entries
+template <typename Fn>
+void decodeBucket(const folly::IOBuf& buf, Fn&& fn) {
+  folly::io::Cursor cursor{&buf};
+  FlatBucketHeader header;
+  if (cursor.tryPull(&header, sizeof(header)) &&
+      header.magic == kFlatBucketMagic) {
+    if (header.version != kFlatBucketVersion) {
+      throw std::invalid_argument{folly::sformat(
+          "Unknown flat index bucket version {}", header.version)};
+    }
+    const size_t size = header.numEntries * sizeof(FlatEntry);
+    if (cursor.length() >= size) {
+      // contiguous, read in place
+      fn(header.bucketId,
+         folly::Range<const FlatEntry*>{
+             reinterpret_cast<const FlatEntry*>(cursor.data()),
+             header.numEntries});
+    } else {
+      std::vector<FlatEntry> entries(header.numEntries);
+      cursor.pull(entries.data(), size);
+      fn(header.bucketId, folly::range(entries));
+    }
+    return;
+  }
+
+  serialization::IndexBucket bucket;
+  ProtoSerializer::deserialize<serialization::IndexBucket>(&buf, bucket);
+  std::vector<FlatEntry> entries;
+  entries.reserve(bucket.entries()->size());
+  for (const auto& entry : *bucket.entries()) {
+    entries.push_back(FlatEntry{
+        static_cast<uint32_t>(*entry.key()),
+        Index::ItemRecord{static_cast<uint32_t>(*entry.address()),
+                          static_cast<uint16_t>(*entry.sizeHint()),
+                          static_cast<uint8_t>(*entry.totalHits()),
+                          static_cast<uint8_t>(*entry.currentHits())}});
+  }
+  fn(static_cast<uint32_t>(*bucket.bucketId()), folly::range(entries));
+}
+
+// Inserts the decoded entries of a bucket into its map
+void insertEntries(tsl::sparse_map<uint32_t, Index::ItemRecord>& map,
+                   folly::Range<const FlatEntry*> entries) {
+  map.reserve(map.size() + entries.size());
+  for (const auto& entry : entries) {
+    // copied out, the fields of a packed struct can't be bound to references
+    const uint32_t key = entry.key;
+    const Index::ItemRecord record = entry.record;
+    map.try_emplace(key, record);
+  }
+}
+} // namespace
+
+void SparseMapIndex::setHits(uint64_t key,
+                             uint8_t currentHits,
+                             uint8_t totalHits) {
+  ensureLoaded(bucket(key));
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end()) {
+    it.value().currentHits = currentHits;
+    it.value().totalHits = totalHits;
+  }
+}
+
+Index::LookupResult SparseMapIndex::lookup(uint64_t key) {
+  ensureLoaded(bucket(key));
+  LookupResult lr;
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end()) {
+    lr = LookupResult{it->second};
+    it.value().totalHits = safeInc(it->second.totalHits);
+    it.value().currentHits = safeInc(it->second.currentHits);
+  }
+  return lr;
+}
+
+Index::LookupResult SparseMapIndex::peek(uint64_t key) const {
+  ensureLoaded(bucket(key));
+  LookupResult lr;
+  const auto& map = getMap(key);
+  auto lock = std::shared_lock{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end()) {
+    lr = LookupResult{it->second};
+  }
+  return lr;
+}
+
+Index::LookupResult SparseMapIndex::insert(uint64_t key,
+                                           uint32_t address,
+                                           uint16_t sizeHint) {
+  ensureLoaded(bucket(key));
+  LookupResult lr;
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+  auto it = map.find(subkey(key));
+  if (it != map.end()) {
+    lr = LookupResult{it->second};
+    trackRemove(it->second.totalHits);
+    // tsl::sparse_map's `it->second` is immutable, while it.value() is mutable
+    it.value().address = address;
+    it.value().currentHits = 0;
+    it.value().totalHits = 0;
+    it.value().sizeHint = sizeHint;
+  } else {
+    map.try_emplace(key, address, sizeHint);
+  }
+  markDirty(bucket(key));
+  return lr;
+}
+
+bool SparseMapIndex::replaceIfMatch(uint64_t key,
+                                    uint32_t newAddress,
+                                    uint32_t oldAddress) {
+  ensureLoaded(bucket(key));
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end() && it->second.address == oldAddress) {
+    // tsl::sparse_map's `it->second` is immutable, while it.value() is mutable
+    it.value().address = newAddress;
+    it.value().currentHits = 0;
+    markDirty(bucket(key));
+    return true;
+  }
+  return false;
+}
+
+void SparseMapIndex::trackRemove(uint8_t totalHits) {
+  hitsEstimator_.trackValue(totalHits);
+  if (totalHits == 0) {
+    unAccessedItems_.inc();
+  }
+}
+
+Index::LookupResult SparseMapIndex::remove(uint64_t key) {
+  ensureLoaded(bucket(key));
+  LookupResult lr;
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end()) {
+    lr = LookupResult{it->second};
+
+    trackRemove(it->second.totalHits);
+    map.erase(it);
+    markDirty(bucket(key));
+  }
+  return lr;
+}
+
+bool SparseMapIndex::removeIfMatch(uint64_t key, uint32_t address) {
+  ensureLoaded(bucket(key));
+  auto& map = getMap(key);
+  auto lock = std::lock_guard{getMutex(key)};
+
+  auto it = map.find(subkey(key));
+  if (it != map.end() && it->second.address == address) {
+    trackRemove(it->second.totalHits);
+    map.erase(it);
+    markDirty(bucket(key));
+    return true;
+  }
+  return false;
+}
+
+void SparseMapIndex::reset() {
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    auto lock = std::lock_guard{getMutexOfBucket(i)};
+    buckets_[i].clear();
+    if (pending_) {
+      pending_[i].store(false, std::memory_order_release);
+    }
+  }
+  endLazyLoad();
+  unAccessedItems_.set(0);
+}
+
+size_t SparseMapIndex::computeSize() const {
+  size_t size = 0;
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    ensureLoaded(i);
+    auto lock = std::lock_guard{getMutexOfBucket(i)};
+    size += buckets_[i].size();
+  }
+  return size;
+}
+
+void SparseMapIndex::persist(RecordWriter& rw) const {
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    ensureLoaded(i);
+    // Serialized one bucket at a time to bound the memory used
+    rw.writeRecord(serializeBucket(i));
+  }
+}
+
+std::unique_ptr<folly::IOBuf> SparseMapIndex::serializeBucket(
+    uint32_t bucketId) const {
+  const auto& map = buckets_[bucketId];
+  if (flatPersistence_) {
+    FlatBucketHeader header;
+    header.bucketId = bucketId;
+    header.numEntries = static_cast<uint32_t>(map.size());
+    auto buf =
+        folly::IOBuf::create(sizeof(header) + map.size() * sizeof(FlatEntry));
+    folly::io::Appender appender{buf.get(), 0};
+    appender.push(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    for (const auto& [key, record] : map) {
+      FlatEntry entry{key, record};
+      appender.push(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry));
+    }
+    return buf;
+  }
+
+  // Convert index entries to thrift objects
+  serialization::IndexBucket bucket;
+  *bucket.bucketId() = bucketId;
+  bucket.entries()->reserve(map.size());
+  for (const auto& [key, record] : map) {
+    serialization::IndexEntry entry;
+    entry.key() = key;
+    entry.address() = record.address;
+    entry.sizeHint() = record.sizeHint;
+    entry.totalHits() = record.totalHits;
+    entry.currentHits() = record.currentHits;
+    bucket.entries()->push_back(entry);
+  }
+  folly::IOBufQueue queue;
+  ProtoSerializer::serialize(bucket, &queue);
+  return queue.move();
+}
+
+void SparseMapIndex::recover(RecordReader& rr) {
+  const uint32_t numThreads = std::min(recoveryThreads_, kRecoveryBatchBuckets);
+  std::vector<std::unique_ptr<folly::IOBuf>> batch;
+  batch.reserve(kRecoveryBatchBuckets);
+  for (uint32_t i = 0; i < kNumBuckets; i += kRecoveryBatchBuckets) {
+    // The records are read in order, only the decoding is parallel
+    batch.clear();
+    for (uint32_t j = i; j < i + kRecoveryBatchBuckets && j < kNumBuckets;
+         j++) {
+      batch.push_back(rr.readRecord());
+    }
+
+    std::vector<std::exception_ptr> errors(numThreads);
+    auto recoverRange = [this, &batch, &errors, numThreads](uint32_t t) {
+      try {
+        for (size_t j = t; j < batch.size(); j += numThreads) {
+          recoverBucket(*batch[j]);
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < numThreads; t++) {
+      threads.emplace_back(recoverRange, t);
+    }
+    recoverRange(0);
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (auto& e : errors) {
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    }
+  }
+}
+
+void SparseMapIndex::recoverBucket(const folly::IOBuf& buf) {
+  decodeBucket(
+      buf, [this](uint32_t id, folly::Range<const FlatEntry*> entries) {
+        if (id >= kNumBuckets) {
+          throw std::invalid_argument{folly::sformat(
+              "Invalid bucket id. Max buckets: {}, bucket id: {}",
+              kNumBuckets,
+              id)};
+        }
+        auto lock = std::lock_guard{getMutexOfBucket(id)};
+        insertEntries(buckets_[id], entries);
+      });
+}
+
+std::vector<uint32_t> SparseMapIndex::takeDirtyBuckets(bool all) {
+  std::vector<uint32_t> ids;
+  for (uint32_t w = 0; w < kNumBuckets / 64; w++) {
+    uint64_t bits = dirty_[w].exchange(0, std::memory_order_relaxed);
+    if (all) {
+      bits = ~0ull;
+    }
+    while (bits != 0) {
+      ids.push_back(w * 64 + folly::findFirstSet(bits) - 1);
+      bits &= bits - 1;
+    }
+  }
+  return ids;
+}
+
+void SparseMapIndex::persistBucket(uint32_t bucketId, RecordWriter& rw) const {
+  XDCHECK_LT(bucketId, kNumBuckets);
+  ensureLoaded(bucketId);
+  std::unique_ptr<folly::IOBuf> buf;
+  {
+    auto lock = std::shared_lock{getMutexOfBucket(bucketId)};
+    buf = serializeBucket(bucketId);
+  }
+  rw.writeRecord(std::move(buf));
+}
+
+void SparseMapIndex::beginLazyLoad(BucketLoader loader) {
+  reset();
+  if (!pending_) {
+    pending_.reset(new std::atomic<bool>[kNumBuckets]());
+  }
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    pending_[i].store(true, std::memory_order_relaxed);
+  }
+  loader_ = std::move(loader);
+  lazyLoading_.store(true, std::memory_order_release);
+}
+
+void SparseMapIndex::loadLocked(uint32_t bucketId) const {
+  if (!pending_[bucketId].load(std::memory_order_relaxed)) {
+    return;
+  }
+  // The bucket is served even if it can't be loaded: it is left empty, the
+  // same as the items of the bucket were evicted.
+  try {
+    if (auto buf = loader_(bucketId)) {
+      decodeBucket(
+          *buf, [this, bucketId](uint32_t id,
+                                 folly::Range<const FlatEntry*> entries) {
+            if (id != bucketId) {
+              throw std::invalid_argument{folly::sformat(
+                  "Loaded bucket {} instead of bucket {}", id, bucketId)};
+            }
+            insertEntries(buckets_[bucketId], entries);
+          });
+    }
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "Failed to load index bucket {}: {}", bucketId, e.what());
+    buckets_[bucketId].clear();
+  }
+  pending_[bucketId].store(false, std::memory_order_release);
+}
+
+void SparseMapIndex::endLazyLoad() {
+  if (!lazyLoading_.load(std::memory_order_acquire)) {
+    return;
+  }
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    XDCHECK(!pending_[i].load(std::memory_order_acquire));
+  }
+  lazyLoading_.store(false, std::memory_order_release);
+  loader_ = nullptr;
+}
+
+void SparseMapIndex::getCounters(const CounterVisitor& visitor) const {
+  hitsEstimator_.visitQuantileEstimator(visitor, "navy_bc_item_hits");
+  visitor("navy_bc_item_removed_with_no_access", unAccessedItems_.get());
+}
+} // namespace facebook::cachelib::navy
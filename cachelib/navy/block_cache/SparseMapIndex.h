@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/io/IOBuf.h>
+#include <folly/stats/QuantileEstimator.h>
+#include <tsl/sparse_map.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/common/PercentileStats.h"
+#include "cachelib/navy/block_cache/Index.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+// Index implementation storing a tsl::sparse_map per bucket. Memory grows
+// with the number of entries. See Index for the API documentation.
+class SparseMapIndex : public Index {
+ public:
+  SparseMapIndex() = default;
+
+  // @param recoveryThreads  number of threads decoding the buckets on
+  //                         recovery
+  // @param flatPersistence  persist the buckets in the flat format (see
+  //                         encodeFlatBucket) instead of as thrift objects.
+  //                         Both formats are recovered either way.
+  explicit SparseMapIndex(uint32_t recoveryThreads,
+                          bool flatPersistence = false)
+      : recoveryThreads_{std::max<uint32_t>(1, recoveryThreads)},
+        flatPersistence_{flatPersistence} {}
+
+  void persist(RecordWriter& rw) const override;
+
+  // Reads the buckets sequentially and decodes them on recoveryThreads_
+  // threads, a batch of kRecoveryBatchBuckets at a time.
+  void recover(RecordReader& rr) override;
+
+  LookupResult lookup(uint64_t key) override;
+
+  LookupResult peek(uint64_t key) const override;
+
+  LookupResult insert(uint64_t key,
+                      uint32_t address,
+                      uint16_t sizeHint) override;
+
+  bool replaceIfMatch(uint64_t key,
+                      uint32_t newAddress,
+                      uint32_t oldAddress) override;
+
+  LookupResult remove(uint64_t key) override;
+
+  bool removeIfMatch(uint64_t key, uint32_t address) override;
+
+  void setHits(uint64_t key, uint8_t currentHits, uint8_t totalHits) override;
+
+  void reset() override;
+
+  size_t computeSize() const override;
+
+  void getCounters(const CounterVisitor& visitor) const override;
+
+  bool supportsCheckpoints() const override { return true; }
+
+  uint32_t getNumBuckets() const override { return kNumBuckets; }
+
+  std::vector<uint32_t> takeDirtyBuckets(bool all) override;
+
+  void persistBucket(uint32_t bucketId, RecordWriter& rw) const override;
+
+  void beginLazyLoad(BucketLoader loader) override;
+
+  void loadBucket(uint32_t bucketId) override { ensureLoaded(bucketId); }
+
+  void endLazyLoad() override;
+
+ private:
+  static constexpr uint32_t kNumBuckets{64 * 1024};
+  static constexpr uint32_t kNumMutexes{1024};
+  static constexpr uint32_t kRecoveryBatchBuckets{4096};
+
+  using Map = tsl::sparse_map<uint32_t, ItemRecord>;
+
+  static uint32_t bucket(uint64_t hash) {
+    return (hash >> 32) & (kNumBuckets - 1);
+  }
+
+  static uint32_t subkey(uint64_t hash) { return hash & 0xffffffffu; }
+
+  SharedMutex& getMutexOfBucket(uint32_t bucket) const {
+    XDCHECK(folly::isPowTwo(kNumMutexes));
+    return mutex_[bucket & (kNumMutexes - 1)];
+  }
+
+  SharedMutex& getMutex(uint64_t hash) const {
+    auto b = bucket(hash);
+    return getMutexOfBucket(b);
+  }
+
+  Map& getMap(uint64_t hash) const {
+    auto b = bucket(hash);
+    return buckets_[b];
+  }
+
+  void trackRemove(uint8_t totalHits);
+
+  // Called with the lock of @bucket held after changing its entries
+  void markDirty(uint32_t bucket) {
+    auto& word = dirty_[bucket / 64];
+    const uint64_t bit = 1ull << (bucket % 64);
+    if (!(word.load(std::memory_order_relaxed) & bit)) {
+      word.fetch_or(bit, std::memory_order_relaxed);
+    }
+  }
+
+  // Loads @bucket from the lazy loader if it is not loaded yet. Called
+  // without holding the lock of the bucket.
+  void ensureLoaded(uint32_t bucket) const {
+    if (FOLLY_LIKELY(!lazyLoading_.load(std::memory_order_acquire))) {
+      return;
+    }
+    if (pending_[bucket].load(std::memory_order_acquire)) {
+      auto lock = std::lock_guard{getMutexOfBucket(bucket)};
+      loadLocked(bucket);
+    }
+  }
+
+  // Same as ensureLoaded() with the lock of @bucket held
+  void loadLocked(uint32_t bucket) const;
+
+  // Decodes a persisted bucket and inserts its entries
+  void recoverBucket(const folly::IOBuf& buf);
+
+  // Serializes a bucket in the persistence format of the index. Called with
+  // the lock of @bucketId held, or while the index is not used.
+  std::unique_ptr<folly::IOBuf> serializeBucket(uint32_t bucketId) const;
+
+  const uint32_t recoveryThreads_{1};
+  const bool flatPersistence_{false};
+
+  // Experiments with 64 byte alignment didn't show any throughput test
+  // performance improvement.
+  std::unique_ptr<SharedMutex[]> mutex_{new SharedMutex[kNumMutexes]};
+  std::unique_ptr<Map[]> buckets_{new Map[kNumBuckets]};
+
+  // One bit per bucket changed since the last takeDirtyBuckets()
+  std::unique_ptr<std::atomic<uint64_t>[]> dirty_{
+      new std::atomic<uint64_t>[kNumBuckets / 64]()};
+
+  // Lazy load state, see beginLazyLoad(). A pending bucket is only cleared
+  // with its lock held.
+  std::atomic<bool> lazyLoading_{false};
+  std::unique_ptr<std::atomic<bool>[]> pending_;
+  BucketLoader loader_;
+
+  mutable util::PercentileStats hitsEstimator_{kQuantileWindowSize};
+  mutable AtomicCounter unAccessedItems_;
+
+  static_assert((kNumMutexes & (kNumMutexes - 1)) == 0,
+                "number of mutexes must be power of two");
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <memory>
 #include <random>
+#include <thread>
 
 #include "cachelib/common/inject_pause.h"
 #include "cachelib/navy/block_cache/Allocator.h"
@@ -262,4 +263,48 @@ TEST(Allocator, UsePriorities) {
   }
 }
 
+TEST(Allocator, SizeStreams) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<MockPolicy>(&hits);
+  constexpr uint32_t kNumRegions = 4;
+  constexpr uint32_t kRegionSize = 16 * 1024;
+  auto device =
+      createMemoryDevice(kNumRegions * kRegionSize, nullptr /* encryption */);
+  RegionEvictCallback evictCb{[](RegionId, BufferView) { return 0; }};
+  RegionCleanupCallback cleanupCb{[](RegionId, BufferView) {}};
+  auto rm = std::make_unique<RegionManager>(
+      kNumRegions, kRegionSize, 0, *device, 1, 1, 0, std::move(evictCb),
+      std::move(cleanupCb), std::move(policy), 3, 0, kFlushRetryLimit);
+  Allocator allocator{*rm, kNumPriorities, {1024}};
+
+  auto allocate = [&](uint32_t size) {
+    while (true) {
+      auto [desc, slotSize, addr] =
+          allocator.allocate(size, kNoPriority, false);
+      if (desc.status() != OpenStatus::Retry) {
+        EXPECT_TRUE(desc.isReady());
+        rm->close(std::move(desc));
+        return addr;
+      }
+      // wait for the reclaim to refill the clean region pool
+      std::this_thread::yield();
+    }
+  };
+
+  // small and large items fill regions of their own
+  const auto small1 = allocate(512);
+  const auto large1 = allocate(4096);
+  const auto small2 = allocate(1024);
+  const auto large2 = allocate(1025);
+  EXPECT_NE(small1.rid(), large1.rid());
+  EXPECT_EQ(small1.rid(), small2.rid());
+  EXPECT_EQ(512, small2.offset());
+  EXPECT_EQ(large1.rid(), large2.rid());
+  EXPECT_EQ(4096, large2.offset());
+
+  EXPECT_THROW((Allocator{*rm, kNumPriorities, {1024, 1024}}),
+               std::invalid_argument);
+  EXPECT_THROW((Allocator{*rm, kNumPriorities, {0}}), std::invalid_argument);
+}
+
 } // namespace facebook::cachelib::navy::tests
@@ -15,8 +15,11 @@
  */
 
 #include <folly/File.h>
+#include <folly/Format.h>
+#include <folly/ScopeGuard.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 #include <future>
 #include <vector>
@@ -24,9 +27,11 @@
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
 #include "cachelib/common/ConditionVariable.h"
 #include "cachelib/common/Hash.h"
+#include "cachelib/common/Time.h"
 #include "cachelib/common/Utils.h"
 #include "cachelib/common/inject_pause.h"
 #include "cachelib/navy/block_cache/BlockCache.h"
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
 #include "cachelib/navy/block_cache/HitsReinsertionPolicy.h"
 #include "cachelib/navy/block_cache/tests/TestHelpers.h"
 #include "cachelib/navy/common/Buffer.h"
@@ -725,6 +730,172 @@ TEST(BlockCache, RegionUnderflow) {
   EXPECT_EQ(e.value(), value.view());
 }
 
+TEST(BlockCache, LookupBatch) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = std::make_unique<NiceMock<MockDevice>>(kDeviceSize, 1024);
+  // Entries 0 to 3 are adjacent and read at once. Entry 8 is read by itself.
+  EXPECT_CALL(*device, readImpl(0, 4096, _));
+  EXPECT_CALL(*device, readImpl(8192, 1024, _));
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 4;
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  // 1k entries fill up the first region
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (size_t i = 0; i < 16; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(800)};
+    EXPECT_EQ(Status::Ok, driver->insertAsync(e.key(), e.value(), nullptr));
+    log.push_back(std::move(e));
+  }
+  driver->flush();
+
+  CacheEntry missing{bg.gen(8), bg.gen(800)};
+  std::vector<HashedKey> keys{log[3].key(), log[0].key(),   log[8].key(),
+                              log[2].key(), missing.key(), log[1].key()};
+  std::vector<size_t> entryIdx{3, 0, 8, 2, 0, 1};
+  std::vector<Status> statuses(keys.size(), Status::Retry);
+  std::vector<Buffer> values(keys.size());
+  std::vector<LookupCallback> cbs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    cbs.emplace_back([&statuses, &values, i](Status status, HashedKey,
+                                             Buffer value) {
+      statuses[i] = status;
+      values[i] = std::move(value);
+    });
+  }
+  driver->lookupBatchAsync(keys, std::move(cbs));
+  driver->flush();
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (keys[i] == missing.key()) {
+      EXPECT_EQ(Status::NotFound, statuses[i]);
+      continue;
+    }
+    EXPECT_EQ(Status::Ok, statuses[i]);
+    EXPECT_EQ(log[entryIdx[i]].value(), values[i].view());
+  }
+}
+
+TEST(BlockCache, ReadPageCache) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = std::make_unique<NiceMock<MockDevice>>(kDeviceSize, 4096);
+  // Every page holds 4 entries and is read once
+  EXPECT_CALL(*device, readImpl(0, 4096, _));
+  EXPECT_CALL(*device, readImpl(4096, 4096, _));
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 4;
+  config.readPageCacheSize = 16 * 4096;
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (size_t i = 0; i < 8; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(800)};
+    EXPECT_EQ(Status::Ok, driver->insert(e.key(), e.value()));
+    log.push_back(std::move(e));
+  }
+  driver->flush();
+
+  for (int round = 0; round < 2; round++) {
+    for (auto& entry : log) {
+      Buffer value;
+      EXPECT_EQ(Status::Ok, driver->lookup(entry.key(), value));
+      EXPECT_EQ(entry.value(), value.view());
+    }
+  }
+  driver->getCounters({[](folly::StringPiece name, double count) {
+    if (name == "navy_bc_read_page_cache_hits") {
+      EXPECT_EQ(14, count);
+    } else if (name == "navy_bc_read_page_cache_misses") {
+      EXPECT_EQ(2, count);
+    }
+  }});
+}
+
+TEST(BlockCache, FlushedRegionCache) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = std::make_unique<NiceMock<MockDevice>>(kDeviceSize, 1024);
+  // The flushed regions stay in memory
+  EXPECT_CALL(*device, readImpl(_, _, _)).Times(0);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 4;
+  config.flushedRegionCacheSize = 2 * kRegionSize;
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (size_t i = 0; i < 8; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(800)};
+    EXPECT_EQ(Status::Ok, driver->insert(e.key(), e.value()));
+    log.push_back(std::move(e));
+  }
+  driver->flush();
+
+  for (auto& entry : log) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, driver->lookup(entry.key(), value));
+    EXPECT_EQ(entry.value(), value.view());
+  }
+  driver->getCounters({[](folly::StringPiece name, double count) {
+    if (name == "navy_bc_flushed_region_cache_hits") {
+      EXPECT_EQ(8, count);
+    }
+  }});
+}
+
+TEST(BlockCache, RemoveBatch) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = std::make_unique<NiceMock<MockDevice>>(kDeviceSize, 1024);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 4;
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (size_t i = 0; i < 8; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(800)};
+    EXPECT_EQ(Status::Ok, driver->insertAsync(e.key(), e.value(), nullptr));
+    log.push_back(std::move(e));
+  }
+  driver->flush();
+
+  CacheEntry missing{bg.gen(8), bg.gen(800)};
+  std::vector<HashedKey> keys{log[3].key(), missing.key(), log[0].key(),
+                              log[5].key()};
+  std::vector<Status> statuses(keys.size(), Status::Retry);
+  std::vector<RemoveCallback> cbs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    cbs.emplace_back(
+        [&statuses, i](Status status, HashedKey) { statuses[i] = status; });
+  }
+  driver->removeBatchAsync(keys, std::move(cbs));
+  driver->flush();
+
+  EXPECT_EQ(Status::Ok, statuses[0]);
+  EXPECT_EQ(Status::NotFound, statuses[1]);
+  EXPECT_EQ(Status::Ok, statuses[2]);
+  EXPECT_EQ(Status::Ok, statuses[3]);
+  for (size_t i = 0; i < log.size(); i++) {
+    Buffer value;
+    const bool removed = i == 0 || i == 3 || i == 5;
+    EXPECT_EQ(removed ? Status::NotFound : Status::Ok,
+              driver->lookup(log[i].key(), value));
+  }
+}
+
 TEST(BlockCache, SmallReadBuffer) {
   std::vector<uint32_t> hits(4);
   auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
@@ -856,6 +1027,54 @@ TEST(BlockCache, MultipleAllocAlignmentSizeItems) {
   }
 }
 
+// Items of 48 bytes take 128 bytes packed at 64 byte alignment instead of
+// 512 bytes, so a 16K region holds 128 of them instead of 32. Fill two regions
+// with them and read them back from the in-mem buffers and, after flushing,
+// from the device.
+TEST(BlockCache, PackedEntries) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = std::make_unique<NiceMock<MockDevice>>(kDeviceSize, 1024);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 4;
+  config.packedEntryAlignSize = 64;
+  auto engine = makeEngine(std::move(config));
+  EXPECT_EQ(64, dynamic_cast<BlockCache&>(*engine).getAllocAlignSize());
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  std::vector<CacheEntry> log;
+  BufferGen bg;
+  for (size_t i = 0; i < 2 * 128; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(40)};
+    EXPECT_EQ(Status::Ok, driver->insert(e.key(), e.value()));
+    log.push_back(std::move(e));
+  }
+  for (size_t i = 0; i < log.size(); i++) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, driver->lookup(log[i].key(), value));
+    EXPECT_EQ(log[i].value(), value.view());
+  }
+  driver->flush();
+  for (size_t i = 0; i < log.size(); i++) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, driver->lookup(log[i].key(), value));
+    EXPECT_EQ(log[i].value(), value.view());
+  }
+}
+
+TEST(BlockCache, PackedEntriesBadConfig) {
+  std::vector<uint32_t> hits(4);
+  auto device = createMemoryDevice(kDeviceSize, nullptr /* encryption */);
+  auto ex = makeJobScheduler();
+  for (uint32_t alignSize : {16, 96, 512}) {
+    auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+    auto config = makeConfig(*ex, std::move(policy), *device);
+    config.packedEntryAlignSize = alignSize;
+    EXPECT_THROW(config.validate(), std::invalid_argument);
+  }
+}
+
 TEST(BlockCache, StackAllocReclaim) {
   std::vector<CacheEntry> log;
 
@@ -1427,6 +1646,113 @@ TEST(BlockCache, Recovery) {
   }
 }
 
+TEST(BlockCache, FixedSizeIndexRecovery) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  size_t metadataSize = 3 * 1024 * 1024;
+  auto deviceSize = metadataSize + kDeviceSize;
+  auto device = createMemoryDevice(deviceSize, nullptr /* encryption */, 4096);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.numInMemBuffers = 2;
+  config.fixedSizeIndexItems = 1024;
+  auto engine = makeEngine(std::move(config), metadataSize);
+  auto driver = makeDriver(std::move(engine), std::move(ex), std::move(device),
+                           metadataSize);
+
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (size_t i = 0; i < 12; i++) {
+    CacheEntry e{bg.gen(8), bg.gen(3200)};
+    EXPECT_EQ(Status::Ok, driver->insert(e.key(), e.value()));
+    log.push_back(std::move(e));
+  }
+  driver->flush();
+  for (auto& entry : log) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, driver->lookup(entry.key(), value));
+    EXPECT_EQ(entry.value(), value.view());
+  }
+
+  driver->persist();
+  EXPECT_TRUE(driver->recover());
+  for (auto& entry : log) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, driver->lookup(entry.key(), value));
+    EXPECT_EQ(entry.value(), value.view());
+  }
+}
+
+TEST(BlockCache, IndexCheckpointRecovery) {
+  auto path = folly::sformat("/tmp/BLOCK_CACHE_INDEX_CHECKPOINT-{}", ::getpid());
+  SCOPE_EXIT { ::unlink(path.c_str()); };
+  for (bool lazy : {false, true}) {
+    std::vector<uint32_t> hits(4);
+    auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+    size_t metadataSize = 3 * 1024 * 1024;
+    auto deviceSize = metadataSize + kDeviceSize;
+    auto device =
+        createMemoryDevice(deviceSize, nullptr /* encryption */, 4096);
+    auto ex = makeJobScheduler();
+    auto config = makeConfig(*ex, std::move(policy), *device);
+    config.numInMemBuffers = 2;
+    config.indexCheckpointFile = path;
+    config.lazyIndexRecovery = lazy;
+    auto engine = makeEngine(std::move(config), metadataSize);
+    auto driver = makeDriver(std::move(engine), std::move(ex),
+                             std::move(device), metadataSize);
+
+    BufferGen bg;
+    std::vector<CacheEntry> log;
+    for (size_t i = 0; i < 12; i++) {
+      CacheEntry e{bg.gen(8), bg.gen(3200)};
+      EXPECT_EQ(Status::Ok, driver->insert(e.key(), e.value()));
+      log.push_back(std::move(e));
+    }
+    driver->flush();
+
+    // The first persist writes the whole index to the checkpoint file, the
+    // second one only what changed since.
+    driver->persist();
+    EXPECT_TRUE(driver->recover());
+    EXPECT_EQ(Status::Ok, driver->remove(log.back().key()));
+    driver->persist();
+    EXPECT_TRUE(driver->recover());
+    for (size_t i = 0; i + 1 < log.size(); i++) {
+      Buffer value;
+      EXPECT_EQ(Status::Ok, driver->lookup(log[i].key(), value));
+      EXPECT_EQ(log[i].value(), value.view());
+    }
+    Buffer value;
+    EXPECT_EQ(Status::NotFound, driver->lookup(log.back().key(), value));
+  }
+}
+
+TEST(BlockCache, IndexCheckpointBadConfig) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = createMemoryDevice(kDeviceSize, nullptr /* encryption */);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.lazyIndexRecovery = true;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+  config.indexCheckpointFile = "/tmp/BLOCK_CACHE_INDEX_CHECKPOINT";
+  config.fixedSizeIndexItems = 1024;
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+}
+
+TEST(BlockCache, FixedSizeIndexBadConfig) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = createMemoryDevice(kDeviceSize, nullptr /* encryption */);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.fixedSizeIndexItems = 1024;
+  config.reinsertionConfig =
+      makeHitsReinsertionConfig(FixedSizeIndex::kMaxHits + 1);
+  EXPECT_THROW(config.validate(), std::invalid_argument);
+}
+
 TEST(BlockCache, RecoveryWithDifferentCacheSize) {
   std::vector<uint32_t> hits(4);
   size_t metadataSize = 3 * 1024 * 1024;
@@ -1815,6 +2141,144 @@ TEST(BlockCache, Checksum) {
   EXPECT_EQ(0, exPtr->getQueueSize());
 }
 
+TEST(BlockCache, LookupChecksumSampling) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  constexpr uint32_t kIOAlignSize = 1024;
+  auto device =
+      createMemoryDevice(kDeviceSize, nullptr /* encryption */, kIOAlignSize);
+  auto ex = std::make_unique<MockSingleThreadJobScheduler>();
+  auto exPtr = ex.get();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  config.checksum = true;
+  config.lookupChecksumPct = 0;
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  BufferGen bg;
+  CacheEntry e1{bg.gen(8), bg.gen(3000)};
+  EXPECT_EQ(Status::Ok, driver->insertAsync(e1.key(), e1.value(), nullptr));
+  exPtr->finish();
+  driver->flush();
+
+  // The corrupted value goes unnoticed without verification
+  const char corruption[kIOAlignSize]{"hack"};
+  EXPECT_TRUE(device->write(
+      0,
+      Buffer{BufferView{1024, reinterpret_cast<const uint8_t*>(corruption)},
+             kIOAlignSize}));
+  Buffer value;
+  EXPECT_EQ(Status::Ok, driver->lookup(e1.key(), value));
+  EXPECT_NE(e1.value(), value.view());
+
+  driver->getCounters({[](folly::StringPiece name, double count) {
+    if (name == "navy_bc_lookup_value_checksum_skips") {
+      EXPECT_EQ(1, count);
+    } else if (name == "navy_bc_lookup_value_checksum_errors") {
+      EXPECT_EQ(0, count);
+    }
+  }});
+  EXPECT_EQ(0, exPtr->getQueueSize());
+}
+
+TEST(BlockCache, ExpiryRangeReclaim) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = createMemoryDevice(kDeviceSize, nullptr /* encryption */);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  std::atomic<uint32_t> expiryChecks{0};
+  config.checkExpired = [&expiryChecks](BufferView) {
+    expiryChecks++;
+    return false;
+  };
+  std::atomic<uint32_t> expiryTime{0};
+  config.getExpiryTime = [&expiryTime](BufferView) {
+    return expiryTime.load();
+  };
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  // Allocator region fills every 16 inserts. The first region expired, the
+  // second never expires and the others expire later.
+  const auto now = static_cast<uint32_t>(util::getCurrentTimeSec());
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  const std::vector<uint32_t> regionExpiries{now - 10, 0, now + 1000,
+                                             now + 1000, now + 1000};
+  for (auto regionExpiry : regionExpiries) {
+    expiryTime = regionExpiry;
+    for (size_t i = 0; i < 16; i++) {
+      CacheEntry e{bg.gen(8), bg.gen(800)};
+      EXPECT_EQ(Status::Ok, driver->insertAsync(e.key(), e.value(), nullptr));
+      log.push_back(std::move(e));
+    }
+    driver->flush();
+  }
+
+  // The first two regions were reclaimed without checking any entry
+  for (size_t i = 0; i < 32; i++) {
+    Buffer value;
+    EXPECT_EQ(Status::NotFound, driver->lookup(log[i].key(), value));
+  }
+  EXPECT_EQ(0, expiryChecks);
+  driver->getCounters({[](folly::StringPiece name, double count) {
+    if (name == "navy_bc_reclaim_expired_regions") {
+      EXPECT_EQ(1, count);
+    } else if (name == "navy_bc_evictions_expired") {
+      EXPECT_EQ(16, count);
+    }
+  }});
+}
+
+TEST(BlockCache, ExpiredRegionLookup) {
+  std::vector<uint32_t> hits(4);
+  auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
+  auto device = createMemoryDevice(kDeviceSize, nullptr /* encryption */);
+  auto ex = makeJobScheduler();
+  auto config = makeConfig(*ex, std::move(policy), *device);
+  std::atomic<uint32_t> expiryTime{0};
+  config.getExpiryTime = [&expiryTime](BufferView) {
+    return expiryTime.load();
+  };
+  auto engine = makeEngine(std::move(config));
+  auto driver = makeDriver(std::move(engine), std::move(ex));
+
+  // The first region expired, the second never expires
+  const auto now = static_cast<uint32_t>(util::getCurrentTimeSec());
+  BufferGen bg;
+  std::vector<CacheEntry> log;
+  for (auto regionExpiry : {now - 10, 0u}) {
+    expiryTime = regionExpiry;
+    for (size_t i = 0; i < 16; i++) {
+      CacheEntry e{bg.gen(8), bg.gen(800)};
+      EXPECT_EQ(Status::Ok, driver->insertAsync(e.key(), e.value(), nullptr));
+      log.push_back(std::move(e));
+    }
+    driver->flush();
+  }
+
+  // The entries of the expired region are dropped without being read
+  for (size_t i = 0; i < 32; i++) {
+    Buffer value;
+    if (i < 16) {
+      EXPECT_EQ(Status::NotFound, driver->lookup(log[i].key(), value));
+      EXPECT_FALSE(driver->couldExist(log[i].key()));
+    } else {
+      EXPECT_EQ(Status::Ok, driver->lookup(log[i].key(), value));
+    }
+  }
+  driver->getCounters({[](folly::StringPiece name, double count) {
+    if (name == "navy_bc_lookups_expired_region") {
+      EXPECT_EQ(16, count);
+    } else if (name == "navy_bc_succ_lookups") {
+      EXPECT_EQ(16, count);
+    } else if (name == "navy_bc_items") {
+      EXPECT_EQ(16, count);
+    }
+  }});
+}
+
 TEST(BlockCache, HitsReinsertionPolicy) {
   std::vector<uint32_t> hits(4);
   auto policy = std::make_unique<NiceMock<MockPolicy>>(&hits);
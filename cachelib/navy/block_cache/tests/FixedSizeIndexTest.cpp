@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cachelib/common/Hash.h"
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+uint64_t makeKey(uint64_t i) { return HashedKey{std::to_string(i)}.keyHash(); }
+} // namespace
+
+TEST(FixedSizeIndex, InvalidSize) {
+  EXPECT_THROW(FixedSizeIndex{0}, std::invalid_argument);
+  EXPECT_THROW(FixedSizeIndex{(1ull << 32) + 1}, std::invalid_argument);
+}
+
+TEST(FixedSizeIndex, InsertLookup) {
+  FixedSizeIndex index{16};
+  const auto key = makeKey(1);
+  EXPECT_FALSE(index.lookup(key).found());
+
+  EXPECT_FALSE(index.insert(key, 4444, 123).found());
+  EXPECT_EQ(4444, index.lookup(key).address());
+  EXPECT_EQ(123, index.peek(key).sizeHint());
+  EXPECT_EQ(1, index.computeSize());
+
+  // overwrite returns the old record
+  auto lr = index.insert(key, 5555, 303);
+  EXPECT_TRUE(lr.found());
+  EXPECT_EQ(4444, lr.address());
+  EXPECT_EQ(123, lr.sizeHint());
+  EXPECT_EQ(5555, index.peek(key).address());
+  EXPECT_EQ(1, index.computeSize());
+
+  lr = index.remove(key);
+  EXPECT_TRUE(lr.found());
+  EXPECT_EQ(5555, lr.address());
+  EXPECT_FALSE(index.lookup(key).found());
+  EXPECT_FALSE(index.remove(key).found());
+  EXPECT_EQ(0, index.computeSize());
+}
+
+TEST(FixedSizeIndex, ReplaceAndRemoveExact) {
+  FixedSizeIndex index{16};
+  const auto key = makeKey(1);
+  EXPECT_FALSE(index.replaceIfMatch(key, 3333, 2222));
+  EXPECT_FALSE(index.removeIfMatch(key, 2222));
+
+  index.insert(key, 4444, 123);
+  index.lookup(key);
+  EXPECT_FALSE(index.replaceIfMatch(key, 3333, 2222));
+  EXPECT_EQ(4444, index.peek(key).address());
+
+  // replacing keeps total hits and clears current hits
+  EXPECT_TRUE(index.replaceIfMatch(key, 3333, 4444));
+  EXPECT_EQ(3333, index.peek(key).address());
+  EXPECT_EQ(123, index.peek(key).sizeHint());
+  EXPECT_EQ(1, index.peek(key).totalHits());
+  EXPECT_EQ(0, index.peek(key).currentHits());
+
+  EXPECT_FALSE(index.removeIfMatch(key, 4444));
+  EXPECT_TRUE(index.removeIfMatch(key, 3333));
+  EXPECT_FALSE(index.peek(key).found());
+}
+
+TEST(FixedSizeIndex, HitsSaturate) {
+  FixedSizeIndex index{16};
+  const auto key = makeKey(1);
+  index.insert(key, 0, 0);
+  for (int i = 0; i < 1000; i++) {
+    index.lookup(key);
+  }
+  EXPECT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).totalHits());
+  EXPECT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).currentHits());
+
+  index.setHits(key, 2, 5);
+  EXPECT_EQ(5, index.peek(key).totalHits());
+  EXPECT_EQ(2, index.peek(key).currentHits());
+
+  index.setHits(key, 100, 200);
+  EXPECT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).totalHits());
+  EXPECT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).currentHits());
+}
+
+TEST(FixedSizeIndex, Capacity) {
+  const uint64_t numItems = 100 * 1000;
+  FixedSizeIndex index{FixedSizeIndex::numBucketsFor(numItems)};
+  EXPECT_GE(index.getNumBuckets() * FixedSizeIndex::kEntriesPerBucket,
+            numItems);
+
+  uint64_t numFound = 0;
+  for (uint64_t i = 0; i < numItems; i++) {
+    if (!index.insert(makeKey(i), static_cast<uint32_t>(i + 1), 1).found()) {
+      numFound++;
+    }
+  }
+  // an insert returns a record only when a key with the same tag shares a
+  // bucket or when both buckets are full
+  EXPECT_GT(numFound, numItems * 97 / 100);
+  EXPECT_LE(index.computeSize(), numItems);
+
+  uint64_t displaced = 0;
+  index.getCounters([&](folly::StringPiece name, double val) {
+    if (name == "navy_bc_index_displaced") {
+      displaced = static_cast<uint64_t>(val);
+    }
+  });
+  EXPECT_LT(displaced, numItems / 100);
+
+  numFound = 0;
+  for (uint64_t i = 0; i < numItems; i++) {
+    auto lr = index.peek(makeKey(i));
+    if (lr.found() && lr.address() == i + 1) {
+      numFound++;
+    }
+  }
+  EXPECT_GT(numFound, numItems * 97 / 100);
+
+  index.reset();
+  EXPECT_EQ(0, index.computeSize());
+  EXPECT_FALSE(index.peek(makeKey(0)).found());
+}
+
+TEST(FixedSizeIndex, Recovery) {
+  // more buckets than fit in a single persisted chunk
+  const uint64_t numBuckets = 100 * 1000;
+  FixedSizeIndex index{numBuckets};
+  for (uint64_t i = 0; i < 10000; i++) {
+    index.insert(makeKey(i), static_cast<uint32_t>(i + 1), i % 100);
+    if (i % 3 == 0) {
+      index.lookup(makeKey(i));
+    }
+  }
+
+  folly::IOBufQueue ioq;
+  auto rw = createMemoryRecordWriter(ioq);
+  index.persist(*rw);
+
+  auto rr = createMemoryRecordReader(ioq);
+  FixedSizeIndex newIndex{numBuckets};
+  newIndex.recover(*rr);
+  EXPECT_EQ(index.computeSize(), newIndex.computeSize());
+  for (uint64_t i = 0; i < 10000; i++) {
+    auto lr = index.peek(makeKey(i));
+    auto newLr = newIndex.peek(makeKey(i));
+    ASSERT_EQ(lr.found(), newLr.found());
+    if (lr.found()) {
+      EXPECT_EQ(lr.address(), newLr.address());
+      EXPECT_EQ(lr.sizeHint(), newLr.sizeHint());
+      EXPECT_EQ(lr.totalHits(), newLr.totalHits());
+      EXPECT_EQ(lr.currentHits(), newLr.currentHits());
+    }
+  }
+}
+
+TEST(FixedSizeIndex, ThreadSafe) {
+  FixedSizeIndex index{4096};
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 8; t++) {
+    threads.emplace_back([&index, t]() {
+      for (uint64_t i = t * 1000; i < (t + 1) * 1000; i++) {
+        index.insert(makeKey(i), static_cast<uint32_t>(i + 1), 0);
+        index.lookup(makeKey(i));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // a few keys may collide with each other on their tags
+  EXPECT_GT(index.computeSize(), 7900);
+  uint64_t numFound = 0;
+  for (uint64_t i = 0; i < 8000; i++) {
+    auto lr = index.peek(makeKey(i));
+    if (lr.found() && lr.address() == i + 1) {
+      EXPECT_GE(lr.totalHits(), 1);
+      numFound++;
+    }
+  }
+  EXPECT_GT(numFound, 7900);
+}
+
+TEST(FixedSizeIndex, LookupDuringReplace) {
+  // lookups go on without locks while a writer keeps moving the entries
+  FixedSizeIndex index{64};
+  const uint64_t numKeys = 100;
+  for (uint64_t i = 0; i < numKeys; i++) {
+    index.insert(makeKey(i), 2 * i, 1);
+  }
+  std::atomic<bool> stop{false};
+  std::thread writer{[&]() {
+    for (int round = 0; round < 200; round++) {
+      for (uint64_t i = 0; i < numKeys; i++) {
+        const uint32_t addr = 2 * i + round % 2;
+        index.replaceIfMatch(makeKey(i), addr ^ 1, addr);
+      }
+    }
+    stop = true;
+  }};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      while (!stop) {
+        for (uint64_t i = 0; i < numKeys; i++) {
+          auto lr = index.lookup(makeKey(i));
+          ASSERT_TRUE(lr.found());
+          EXPECT_EQ(i, lr.address() / 2);
+          EXPECT_EQ(1, lr.sizeHint());
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(numKeys, index.computeSize());
+}
+
+TEST(FixedSizeIndex, ConcurrentHitsNotLost) {
+  FixedSizeIndex index{16};
+  const auto key = makeKey(1);
+  index.insert(key, 1, 1);
+  for (int round = 0; round < 100; round++) {
+    index.setHits(key, 0, 0);
+    std::vector<std::thread> threads;
+    for (uint8_t t = 0; t < FixedSizeIndex::kMaxHits; t++) {
+      threads.emplace_back([&]() { index.lookup(key); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    ASSERT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).totalHits());
+    ASSERT_EQ(FixedSizeIndex::kMaxHits, index.peek(key).currentHits());
+  }
+}
+} // namespace facebook::cachelib::navy::tests
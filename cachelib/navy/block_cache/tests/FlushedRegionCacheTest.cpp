@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/navy/block_cache/FlushedRegionCache.h"
+#include "cachelib/navy/testing/BufferGen.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+constexpr uint32_t kRegionSize = 4096;
+
+std::unique_ptr<Buffer> makeRegionBuffer(BufferGen& bg) {
+  return std::make_unique<Buffer>(bg.gen(kRegionSize));
+}
+} // namespace
+
+TEST(FlushedRegionCache, InvalidConfig) {
+  EXPECT_THROW(FlushedRegionCache(4, 0), std::invalid_argument);
+}
+
+TEST(FlushedRegionCache, KeepsNewestRegions) {
+  FlushedRegionCache cache{4, 2};
+  BufferGen bg;
+  auto buf0 = makeRegionBuffer(bg);
+  auto* data0 = buf0.get();
+  EXPECT_EQ(nullptr, cache.insert(RegionId{0}, std::move(buf0)));
+  auto buf1 = makeRegionBuffer(bg);
+  const Buffer copy1{buf1->view()};
+  EXPECT_EQ(nullptr, cache.insert(RegionId{1}, std::move(buf1)));
+
+  Buffer out{100};
+  EXPECT_TRUE(cache.read(RegionId{1}, 200, out.mutableView()));
+  EXPECT_EQ(BufferView(100, copy1.data() + 200), out.view());
+  EXPECT_FALSE(cache.read(RegionId{2}, 200, out.mutableView()));
+
+  // a full cache hands back the buffer of the oldest region
+  EXPECT_EQ(data0, cache.insert(RegionId{2}, makeRegionBuffer(bg)).get());
+  EXPECT_FALSE(cache.read(RegionId{0}, 200, out.mutableView()));
+  EXPECT_TRUE(cache.read(RegionId{1}, 200, out.mutableView()));
+  EXPECT_TRUE(cache.read(RegionId{2}, 200, out.mutableView()));
+}
+
+TEST(FlushedRegionCache, RemoveAndReset) {
+  FlushedRegionCache cache{4, 3};
+  BufferGen bg;
+  cache.insert(RegionId{0}, makeRegionBuffer(bg));
+  cache.insert(RegionId{1}, makeRegionBuffer(bg));
+  cache.insert(RegionId{2}, makeRegionBuffer(bg));
+
+  // a reclaimed region gives its buffer back and makes room
+  EXPECT_NE(nullptr, cache.remove(RegionId{1}));
+  EXPECT_EQ(nullptr, cache.remove(RegionId{1}));
+  Buffer out{100};
+  EXPECT_FALSE(cache.read(RegionId{1}, 0, out.mutableView()));
+  EXPECT_EQ(nullptr, cache.insert(RegionId{3}, makeRegionBuffer(bg)));
+
+  EXPECT_EQ(3, cache.reset().size());
+  EXPECT_FALSE(cache.read(RegionId{0}, 0, out.mutableView()));
+  EXPECT_TRUE(cache.reset().empty());
+}
+} // namespace facebook::cachelib::navy::tests
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/navy/block_cache/HitDensityPolicy.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+const RegionId kNone{};
+const RegionId kR0{0};
+const RegionId kR1{1};
+const RegionId kR2{2};
+const RegionId kR3{3};
+const Region kRegion0{RegionId{0}, 100};
+const Region kRegion1{RegionId{1}, 100};
+const Region kRegion2{RegionId{2}, 100};
+const Region kRegion3{RegionId{3}, 100};
+} // namespace
+
+TEST(EvictionPolicy, HitDensityInvalidPct) {
+  EXPECT_THROW(HitDensityPolicy(0, 0), std::invalid_argument);
+  EXPECT_THROW(HitDensityPolicy(0, 101), std::invalid_argument);
+}
+
+TEST(EvictionPolicy, HitDensityFifoWithoutHits) {
+  HitDensityPolicy policy{0, 100};
+  policy.track(kRegion0);
+  policy.track(kRegion1);
+  policy.track(kRegion2);
+  EXPECT_EQ(kR0, policy.evict());
+  EXPECT_EQ(kR1, policy.evict());
+  EXPECT_EQ(kR2, policy.evict());
+  EXPECT_EQ(kNone, policy.evict());
+}
+
+TEST(EvictionPolicy, HitDensityHotRegionSurvives) {
+  HitDensityPolicy policy{0, 100};
+  policy.track(kRegion0);
+  policy.track(kRegion1);
+  policy.track(kRegion2);
+  policy.track(kRegion3);
+  policy.touch(kR0);
+  policy.touch(kR0);
+  policy.touch(kR1);
+  policy.touch(kR3);
+  EXPECT_EQ(kR2, policy.evict());
+  // R1 and R3 tie, the older one goes first
+  EXPECT_EQ(kR1, policy.evict());
+  EXPECT_EQ(kR3, policy.evict());
+  EXPECT_EQ(kR0, policy.evict());
+  EXPECT_EQ(kNone, policy.evict());
+}
+
+TEST(EvictionPolicy, HitDensityCandidates) {
+  // only the oldest half is looked at
+  HitDensityPolicy policy{0, 50};
+  policy.track(kRegion0);
+  policy.track(kRegion1);
+  policy.track(kRegion2);
+  policy.track(kRegion3);
+  policy.touch(kR0);
+  policy.touch(kR1);
+  EXPECT_EQ(kR0, policy.evict());
+}
+
+TEST(EvictionPolicy, HitDensityRetrackForgetsHits) {
+  HitDensityPolicy policy{0, 100};
+  policy.track(kRegion0);
+  policy.track(kRegion1);
+  policy.touch(kR0);
+  EXPECT_EQ(kR1, policy.evict());
+  policy.track(kRegion1);
+  policy.touch(kR1);
+  policy.touch(kR1);
+  // R0 is tracked again: its hits were for the old content
+  EXPECT_EQ(kR0, policy.evict());
+  policy.track(kRegion0);
+  EXPECT_EQ(kR0, policy.evict());
+  EXPECT_EQ(kR1, policy.evict());
+  EXPECT_EQ(kNone, policy.evict());
+}
+
+TEST(EvictionPolicy, HitDensityDecay) {
+  HitDensityPolicy policy{0, 100};
+  policy.track(kRegion0);
+  policy.track(kRegion2);
+  for (int i = 0; i < 4; i++) {
+    policy.touch(kR0);
+  }
+  // as many evictions as tracked regions: a turnover halves the hits
+  EXPECT_EQ(kR2, policy.evict());
+  policy.track(kRegion1);
+  for (int i = 0; i < 3; i++) {
+    policy.touch(kR1);
+  }
+  // R0 is down to 2 hits
+  EXPECT_EQ(kR0, policy.evict());
+  EXPECT_EQ(kR1, policy.evict());
+  EXPECT_EQ(kNone, policy.evict());
+}
+
+TEST(EvictionPolicy, HitDensityReset) {
+  HitDensityPolicy policy{0};
+  policy.track(kRegion0);
+  policy.track(kRegion1);
+  policy.reset();
+  EXPECT_EQ(kNone, policy.evict());
+  policy.touch(kR0);
+  policy.track(kRegion1);
+  EXPECT_EQ(kR1, policy.evict());
+  EXPECT_EQ(kNone, policy.evict());
+}
+} // namespace facebook::cachelib::navy::tests
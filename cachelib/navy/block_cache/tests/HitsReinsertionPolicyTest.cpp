@@ -19,13 +19,14 @@
 #include <thread>
 
 #include "cachelib/navy/block_cache/HitsReinsertionPolicy.h"
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
 #include "cachelib/navy/common/Hash.h"
 #include "cachelib/navy/serialization/RecordIO.h"
 
 namespace facebook::cachelib::navy::tests {
 
 TEST(HitsReinsertionPolicy, Simple) {
-  Index index;
+  SparseMapIndex index;
   HitsReinsertionPolicy tracker{1, index};
 
   auto hk1 = makeHK("test_key_1");
@@ -79,7 +80,7 @@ TEST(HitsReinsertionPolicy, Simple) {
 }
 
 TEST(HitsReinsertionPolicy, UpperBound) {
-  Index index;
+  SparseMapIndex index;
   auto hk1 = makeHK("test_key_1");
 
   index.insert(hk1.keyHash(), 0, 0);
@@ -94,7 +95,7 @@ TEST(HitsReinsertionPolicy, UpperBound) {
 }
 
 TEST(HitsReinsertionPolicy, ThreadSafe) {
-  Index index;
+  SparseMapIndex index;
 
   auto hk1 = makeHK("test_key_1");
 
@@ -120,7 +121,7 @@ TEST(HitsReinsertionPolicy, ThreadSafe) {
 }
 
 TEST(HitsReinsertionPolicy, Recovery) {
-  Index index;
+  SparseMapIndex index;
   auto hk1 = makeHK("test_key_1");
 
   index.insert(hk1.keyHash(), 0, 0);
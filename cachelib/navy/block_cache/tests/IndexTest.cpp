@@ -14,15 +14,20 @@
  * limitations under the License.
  */
 
+#include <folly/Format.h>
+#include <folly/ScopeGuard.h>
+#include <folly/hash/Hash.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 #include <thread>
 
-#include "cachelib/navy/block_cache/Index.h"
+#include "cachelib/navy/block_cache/IndexCheckpointer.h"
+#include "cachelib/navy/block_cache/SparseMapIndex.h"
 
 namespace facebook::cachelib::navy::tests {
 TEST(Index, Recovery) {
-  Index index;
+  SparseMapIndex index;
   std::vector<std::pair<uint64_t, uint32_t>> log;
   // Write to 16 buckets
   for (uint64_t i = 0; i < 16; i++) {
@@ -40,7 +45,7 @@ TEST(Index, Recovery) {
   index.persist(*rw);
 
   auto rr = createMemoryRecordReader(ioq);
-  Index newIndex;
+  SparseMapIndex newIndex;
   newIndex.recover(*rr);
   for (auto& entry : log) {
     auto lookupResult = newIndex.lookup(entry.first);
@@ -48,8 +53,72 @@ TEST(Index, Recovery) {
   }
 }
 
+TEST(Index, RecoveryThreads) {
+  SparseMapIndex index;
+  std::vector<std::pair<uint64_t, uint32_t>> log;
+  for (uint64_t i = 0; i < 100000; i++) {
+    uint64_t key = folly::hash::twang_mix64(i);
+    uint32_t val = static_cast<uint32_t>(i);
+    index.insert(key, val, 0);
+    log.emplace_back(key, val);
+  }
+
+  folly::IOBufQueue ioq;
+  auto rw = createMemoryRecordWriter(ioq);
+  index.persist(*rw);
+
+  auto rr = createMemoryRecordReader(ioq);
+  SparseMapIndex newIndex{8 /* recoveryThreads */};
+  newIndex.recover(*rr);
+  EXPECT_EQ(index.computeSize(), newIndex.computeSize());
+  for (auto& entry : log) {
+    EXPECT_EQ(entry.second, newIndex.lookup(entry.first).address());
+  }
+}
+
+TEST(Index, FlatRecovery) {
+  SparseMapIndex flatIndex{1 /* recoveryThreads */, true /* flat */};
+  SparseMapIndex thriftIndex;
+  std::vector<std::pair<uint64_t, uint32_t>> log;
+  for (uint64_t i = 0; i < 10000; i++) {
+    uint64_t key = folly::hash::twang_mix64(i);
+    uint32_t val = static_cast<uint32_t>(i);
+    flatIndex.insert(key, val, static_cast<uint16_t>(i));
+    thriftIndex.insert(key, val, static_cast<uint16_t>(i));
+    log.emplace_back(key, val);
+  }
+  flatIndex.lookup(log[0].first);
+
+  folly::IOBufQueue flatQueue;
+  folly::IOBufQueue thriftQueue;
+  flatIndex.persist(*createMemoryRecordWriter(flatQueue));
+  thriftIndex.persist(*createMemoryRecordWriter(thriftQueue));
+  // flat entries take less space than thrift ones
+  EXPECT_LT(flatQueue.chainLength(), thriftQueue.chainLength());
+
+  // either format is recovered by either index
+  for (auto* queue : {&flatQueue, &thriftQueue}) {
+    for (bool flat : {false, true}) {
+      auto copy = queue->front()->clone();
+      folly::IOBufQueue ioq;
+      ioq.append(std::move(copy));
+      SparseMapIndex newIndex{4 /* recoveryThreads */, flat};
+      newIndex.recover(*createMemoryRecordReader(ioq));
+      EXPECT_EQ(flatIndex.computeSize(), newIndex.computeSize());
+      for (auto& entry : log) {
+        auto lr = newIndex.peek(entry.first);
+        EXPECT_EQ(entry.second, lr.address());
+        EXPECT_EQ(static_cast<uint16_t>(entry.second), lr.sizeHint());
+      }
+    }
+  }
+  SparseMapIndex newIndex{1 /* recoveryThreads */, true /* flat */};
+  newIndex.recover(*createMemoryRecordReader(flatQueue));
+  EXPECT_EQ(1, newIndex.peek(log[0].first).totalHits());
+}
+
 TEST(Index, EntrySize) {
-  Index index;
+  SparseMapIndex index;
   index.insert(111, 0, 11);
   EXPECT_EQ(11, index.lookup(111).sizeHint());
   index.insert(222, 0, 150);
@@ -59,7 +128,7 @@ TEST(Index, EntrySize) {
 }
 
 TEST(Index, ReplaceExact) {
-  Index index;
+  SparseMapIndex index;
   // Empty value should fail in replace
   EXPECT_FALSE(index.replaceIfMatch(111, 3333, 2222));
   EXPECT_FALSE(index.lookup(111).found());
@@ -79,7 +148,7 @@ TEST(Index, ReplaceExact) {
 }
 
 TEST(Index, RemoveExact) {
-  Index index;
+  SparseMapIndex index;
   // Empty value should fail in replace
   EXPECT_FALSE(index.removeIfMatch(111, 4444));
 
@@ -96,7 +165,7 @@ TEST(Index, RemoveExact) {
 }
 
 TEST(Index, Hits) {
-  Index index;
+  SparseMapIndex index;
   const uint64_t key = 9527;
 
   // Hits after inserting should be 0
@@ -126,7 +195,7 @@ TEST(Index, Hits) {
 }
 
 TEST(Index, HitsAfterUpdate) {
-  Index index;
+  SparseMapIndex index;
   const uint64_t key = 9527;
 
   // Hits after inserting should be 0
@@ -162,7 +231,7 @@ TEST(Index, HitsAfterUpdate) {
 }
 
 TEST(Index, HitsUpperBound) {
-  Index index;
+  SparseMapIndex index;
   const uint64_t key = 8341;
 
   index.insert(key, 0, 0);
@@ -175,7 +244,7 @@ TEST(Index, HitsUpperBound) {
 }
 
 TEST(Index, ThreadSafe) {
-  Index index;
+  SparseMapIndex index;
   const uint64_t key = 1314;
   index.insert(key, 0, 0);
 
@@ -194,4 +263,65 @@ TEST(Index, ThreadSafe) {
   EXPECT_EQ(200, index.peek(key).currentHits());
 }
 
+TEST(Index, DirtyBuckets) {
+  SparseMapIndex index;
+  EXPECT_TRUE(index.takeDirtyBuckets(false).empty());
+  EXPECT_EQ(index.getNumBuckets(), index.takeDirtyBuckets(true).size());
+
+  index.insert(3ull << 32 | 1, 10, 0);
+  index.insert(7ull << 32 | 1, 10, 0);
+  // lookups only update the hits and do not dirty a bucket
+  index.lookup(3ull << 32 | 1);
+  EXPECT_EQ((std::vector<uint32_t>{3, 7}), index.takeDirtyBuckets(false));
+  EXPECT_TRUE(index.takeDirtyBuckets(false).empty());
+
+  EXPECT_FALSE(index.removeIfMatch(7ull << 32 | 1, 11));
+  EXPECT_TRUE(index.takeDirtyBuckets(false).empty());
+  EXPECT_TRUE(index.removeIfMatch(7ull << 32 | 1, 10));
+  EXPECT_EQ((std::vector<uint32_t>{7}), index.takeDirtyBuckets(false));
+}
+
+TEST(Index, CheckpointRecovery) {
+  auto path = folly::sformat("/tmp/INDEX_CHECKPOINT_TEST-{}", ::getpid());
+  SCOPE_EXIT { ::unlink(path.c_str()); };
+
+  SparseMapIndex index;
+  IndexCheckpointer checkpointer{index, path};
+  for (uint64_t i = 0; i < 16; i++) {
+    index.insert(i << 32 | i, i, 0);
+  }
+  // The first checkpoint is a full one
+  EXPECT_EQ(1, checkpointer.checkpoint());
+  // Nothing changed, nothing is written
+  EXPECT_EQ(1, checkpointer.checkpoint());
+
+  // The delta holds the changed buckets only
+  index.insert(1ull << 32 | 1, 100, 0);
+  index.remove(2ull << 32 | 2);
+  index.insert(100ull << 32 | 100, 100, 0);
+  EXPECT_EQ(2, checkpointer.checkpoint());
+
+  for (bool lazy : {false, true}) {
+    SparseMapIndex newIndex;
+    IndexCheckpointer newCheckpointer{newIndex, path};
+    EXPECT_THROW(newCheckpointer.recover(1, lazy), std::invalid_argument);
+    newCheckpointer.recover(2, lazy);
+    // Buckets are loaded on first access if the background load did not get
+    // to them yet
+    EXPECT_EQ(100, newIndex.lookup(1ull << 32 | 1).address());
+    EXPECT_FALSE(newIndex.lookup(2ull << 32 | 2).found());
+    EXPECT_EQ(3, newIndex.lookup(3ull << 32 | 3).address());
+    EXPECT_EQ(100, newIndex.lookup(100ull << 32 | 100).address());
+    newCheckpointer.waitForLoad();
+    EXPECT_EQ(16, newIndex.computeSize());
+  }
+}
+
+TEST(Index, CheckpointRecoveryMissingFile) {
+  SparseMapIndex index;
+  IndexCheckpointer checkpointer{
+      index, folly::sformat("/tmp/INDEX_CHECKPOINT_MISSING-{}", ::getpid())};
+  EXPECT_THROW(checkpointer.recover(1, false), std::system_error);
+}
+
 } // namespace facebook::cachelib::navy::tests
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "cachelib/navy/block_cache/ReadPageCache.h"
+#include "cachelib/navy/testing/BufferGen.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+constexpr uint32_t kPageSize = 1024;
+const RegionId kRid{1};
+} // namespace
+
+TEST(ReadPageCache, InvalidConfig) {
+  EXPECT_THROW(ReadPageCache(4, 1000, 16), std::invalid_argument);
+  EXPECT_THROW(ReadPageCache(4, kPageSize, 0), std::invalid_argument);
+}
+
+TEST(ReadPageCache, ReadAcrossPages) {
+  ReadPageCache cache{4, kPageSize, 64};
+  BufferGen bg;
+  auto pages = bg.gen(2 * kPageSize);
+
+  Buffer buf{300};
+  EXPECT_FALSE(cache.read(kRid, 900, buf.mutableView()));
+  cache.insert(kRid, 0, pages.view());
+
+  // within a page and spanning both
+  EXPECT_TRUE(cache.read(kRid, 100, buf.mutableView()));
+  EXPECT_EQ(BufferView(300, pages.data() + 100), buf.view());
+  EXPECT_TRUE(cache.read(kRid, 900, buf.mutableView()));
+  EXPECT_EQ(BufferView(300, pages.data() + 900), buf.view());
+
+  // the next page and other regions are not cached
+  EXPECT_FALSE(cache.read(kRid, 2 * kPageSize - 100, buf.mutableView()));
+  EXPECT_FALSE(cache.read(RegionId{2}, 100, buf.mutableView()));
+}
+
+TEST(ReadPageCache, PartialPage) {
+  ReadPageCache cache{4, kPageSize, 64};
+  BufferGen bg;
+  auto data = bg.gen(kPageSize + 200);
+  cache.insert(kRid, kPageSize, data.view());
+
+  Buffer buf{100};
+  EXPECT_TRUE(cache.read(kRid, 2 * kPageSize + 100, buf.mutableView()));
+  EXPECT_EQ(BufferView(100, data.data() + kPageSize + 100), buf.view());
+  // past what was read
+  EXPECT_FALSE(cache.read(kRid, 2 * kPageSize + 150, buf.mutableView()));
+}
+
+TEST(ReadPageCache, InvalidateRegion) {
+  ReadPageCache cache{4, kPageSize, 64};
+  BufferGen bg;
+  auto data = bg.gen(kPageSize);
+  cache.insert(kRid, 0, data.view());
+  cache.insert(RegionId{2}, 0, data.view());
+
+  Buffer buf{100};
+  cache.invalidateRegion(kRid);
+  EXPECT_FALSE(cache.read(kRid, 0, buf.mutableView()));
+  EXPECT_TRUE(cache.read(RegionId{2}, 0, buf.mutableView()));
+
+  // pages read after the reclaim are cached again
+  auto newData = bg.gen(kPageSize);
+  cache.insert(kRid, 0, newData.view());
+  EXPECT_TRUE(cache.read(kRid, 0, buf.mutableView()));
+  EXPECT_EQ(BufferView(100, newData.data()), buf.view());
+
+  cache.reset();
+  EXPECT_FALSE(cache.read(kRid, 0, buf.mutableView()));
+  EXPECT_FALSE(cache.read(RegionId{2}, 0, buf.mutableView()));
+}
+
+TEST(ReadPageCache, Eviction) {
+  // one page per shard
+  ReadPageCache cache{4, kPageSize, 32};
+  BufferGen bg;
+  auto data = bg.gen(64 * kPageSize);
+  cache.insert(kRid, 0, data.view());
+
+  uint64_t numCached = 0;
+  Buffer buf{100};
+  for (uint32_t i = 0; i < 64; i++) {
+    if (cache.read(kRid, i * kPageSize, buf.mutableView())) {
+      numCached++;
+    }
+  }
+  EXPECT_LE(numCached, 32);
+  // the most recently inserted pages are kept
+  EXPECT_TRUE(cache.read(kRid, 63 * kPageSize, buf.mutableView()));
+
+  uint64_t numPages = 0;
+  cache.getCounters([&numPages](folly::StringPiece name, double count) {
+    if (name == "navy_bc_read_page_cache_pages") {
+      numPages = static_cast<uint64_t>(count);
+    }
+  });
+  EXPECT_EQ(numCached, numPages);
+}
+} // namespace facebook::cachelib::navy::tests
@@ -26,6 +26,7 @@
 #include "cachelib/navy/block_cache/tests/TestHelpers.h"
 #include "cachelib/navy/scheduler/JobScheduler.h"
 #include "cachelib/navy/testing/BufferGen.h"
+#include "cachelib/navy/testing/Callbacks.h"
 #include "cachelib/navy/testing/MockDevice.h"
 #include "cachelib/navy/testing/MockJobScheduler.h"
 #include "cachelib/navy/testing/SeqPoints.h"
@@ -219,6 +220,97 @@ TEST(RegionManager, ReadWrite) {
   EXPECT_EQ(buf.view(), bufReadDirect.view());
 }
 
+TEST(RegionManager, PlacementByPriority) {
+  constexpr uint32_t kNumRegions = 4;
+  constexpr uint32_t kRegionSize = 4 * 1024;
+  constexpr uint16_t kNumPriorities = 3;
+
+  MockDevice device{kNumRegions * kRegionSize, 1024};
+  int nextHandle = 10;
+  EXPECT_CALL(device, allocatePlacementHandle())
+      .Times(kNumPriorities)
+      .WillRepeatedly(
+          testing::Invoke([&nextHandle]() { return nextHandle++; }));
+  // the region of priority 2 is written with the third handle
+  EXPECT_CALL(device, writeImpl(testing::_, testing::_, testing::_, 12));
+
+  RegionEvictCallback evictCb{[](RegionId, BufferView) { return 0; }};
+  RegionCleanupCallback cleanupCb{[](RegionId, BufferView) {}};
+  auto rm = std::make_unique<RegionManager>(
+      kNumRegions, kRegionSize, 0, device, 1, 1, 0, std::move(evictCb),
+      std::move(cleanupCb), std::make_unique<LruPolicy>(kNumRegions),
+      kNumRegions /* numInMemBuffers */, kNumPriorities, kFlushRetryLimit,
+      0 /* maxCleanRegions */, 0 /* readPageCachePages */,
+      0 /* flushedRegionCacheRegions */, true /* placementByPriority */);
+
+  ENABLE_INJECT_PAUSE_IN_SCOPE();
+  injectPauseSet("pause_reclaim_done");
+
+  RegionId rid;
+  rm->startReclaim();
+  EXPECT_TRUE(injectPauseWait("pause_reclaim_done"));
+  ASSERT_EQ(OpenStatus::Ready, rm->getCleanRegion(rid, false).first);
+
+  auto& region = rm->getRegion(rid);
+  region.setPriority(2);
+  auto [wDesc, addr] = region.openAndAllocate(1024);
+  EXPECT_EQ(OpenStatus::Ready, wDesc.status());
+  BufferGen bg;
+  rm->write(addr, bg.gen(1024));
+  region.close(std::move(wDesc));
+  EXPECT_EQ(Region::FlushRes::kSuccess, rm->flushBuffer(rid));
+}
+
+// Reclaimed regions on a degraded device are set aside instead of becoming
+// clean, until the device is healthy again
+TEST(RegionManager, DegradedDevice) {
+  constexpr uint32_t kNumRegions = 4;
+  constexpr uint32_t kRegionSize = 4 * 1024;
+
+  MockDevice device{kNumRegions * kRegionSize, 1024};
+  // region 0 is on a degraded device
+  std::atomic<bool> degraded{true};
+  EXPECT_CALL(device, isDegraded(testing::_, testing::_))
+      .WillRepeatedly(testing::Invoke([&degraded](uint64_t offset, uint32_t) {
+        return degraded.load() && offset < kRegionSize;
+      }));
+
+  RegionEvictCallback evictCb{[](RegionId, BufferView) { return 0; }};
+  RegionCleanupCallback cleanupCb{[](RegionId, BufferView) {}};
+  auto rm = std::make_unique<RegionManager>(
+      kNumRegions, kRegionSize, 0, device, 1, 1, 0, std::move(evictCb),
+      std::move(cleanupCb), std::make_unique<LruPolicy>(kNumRegions),
+      kNumRegions /* numInMemBuffers */, 0, kFlushRetryLimit);
+
+  ENABLE_INJECT_PAUSE_IN_SCOPE();
+  injectPauseSet("pause_reclaim_done");
+
+  // region 0 is set aside and region 1 reclaimed in its place
+  RegionId rid;
+  rm->startReclaim();
+  EXPECT_TRUE(injectPauseWait("pause_reclaim_done"));
+  EXPECT_TRUE(injectPauseWait("pause_reclaim_done"));
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(testing::_, testing::_))
+      .WillRepeatedly(testing::Return());
+  EXPECT_CALL(visitor, call(strPiece("navy_bc_num_degraded_regions"), 1));
+  rm->getCounters({toCallback(visitor)});
+
+  // region 0 is clean again with the reclaim of region 2
+  degraded = false;
+  ASSERT_EQ(OpenStatus::Ready, rm->getCleanRegion(rid, false).first);
+  EXPECT_EQ(1, rid.index());
+  EXPECT_TRUE(injectPauseWait("pause_reclaim_done"));
+  ASSERT_EQ(OpenStatus::Ready, rm->getCleanRegion(rid, false).first);
+  EXPECT_EQ(2, rid.index());
+  ASSERT_EQ(OpenStatus::Ready, rm->getCleanRegion(rid, false).first);
+  EXPECT_EQ(0, rid.index());
+
+  injectPauseClear("pause_reclaim_done");
+  rm->drain();
+}
+
 TEST(RegionManager, RecoveryLRUOrder) {
   constexpr uint32_t kNumRegions = 4;
   constexpr uint32_t kRegionSize = 4 * 1024;
@@ -562,4 +654,49 @@ TEST(RegionManager, cleanupRegionFailureAsync) {
     }
   }});
 }
+
+TEST(RegionManager, AdaptiveCleanRegions) {
+  constexpr uint32_t kNumRegions = 8;
+  constexpr uint32_t kRegionSize = 4 * 1024;
+  auto device =
+      createMemoryDevice(kNumRegions * kRegionSize, nullptr /* encryption */);
+  auto makeRegionManager = [&](uint32_t maxCleanRegions) {
+    RegionEvictCallback evictCb{[](RegionId, BufferView) { return 0; }};
+    RegionCleanupCallback cleanupCb{[](RegionId, BufferView) {}};
+    return std::make_unique<RegionManager>(
+        kNumRegions, kRegionSize, 0, *device, 1, 2, 0, std::move(evictCb),
+        std::move(cleanupCb), std::make_unique<LruPolicy>(kNumRegions),
+        kNumRegions /* numInMemBuffers */, 0, kFlushRetryLimit,
+        maxCleanRegions);
+  };
+  auto getTarget = [](const RegionManager& rm) {
+    double target = 0;
+    rm.getCounters({[&target](folly::StringPiece name, double count) {
+      if (name == "navy_bc_clean_regions_target") {
+        target = count;
+      }
+    }});
+    return target;
+  };
+
+  ENABLE_INJECT_PAUSE_IN_SCOPE();
+  injectPauseSet("pause_reclaim_done");
+
+  for (uint32_t maxCleanRegions : {0, 4}) {
+    auto rm = makeRegionManager(maxCleanRegions);
+    EXPECT_EQ(1, getTarget(*rm));
+
+    // the pool starts empty, the writer has to wait for the first reclaim
+    RegionId rid;
+    ASSERT_EQ(OpenStatus::Retry, rm->getCleanRegion(rid, false).first);
+    EXPECT_TRUE(injectPauseWait("pause_reclaim_done"));
+    ASSERT_EQ(OpenStatus::Ready, rm->getCleanRegion(rid, false).first);
+
+    // an adaptive pool keeps one more region clean after the stall
+    const uint32_t expected = maxCleanRegions == 0 ? 1 : 2;
+    EXPECT_EQ(expected, getTarget(*rm));
+    EXPECT_TRUE(injectPauseWait("pause_reclaim_done", expected));
+    rm->drain();
+  }
+}
 } // namespace facebook::cachelib::navy::tests
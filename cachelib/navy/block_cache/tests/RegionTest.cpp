@@ -16,6 +16,10 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "cachelib/navy/block_cache/Region.h"
 
 namespace facebook::cachelib::navy::tests {
@@ -36,6 +40,54 @@ TEST(Region, ReadAndBlock) {
   EXPECT_EQ(r.openForRead().status(), OpenStatus::Ready);
 }
 
+TEST(Region, EpochReadAndBlock) {
+  RegionReadEpochs epochs;
+  Region r{RegionId(0), 1024, &epochs};
+
+  // without a buffer, reads are tracked by the epochs
+  auto desc = r.openForRead();
+  EXPECT_EQ(desc.status(), OpenStatus::Ready);
+  EXPECT_TRUE(desc.isEpochRead());
+  EXPECT_TRUE(desc.isPhysReadMode());
+  EXPECT_EQ(1, epochs.getNumReaders());
+
+  EXPECT_FALSE(r.readyForReclaim(false));
+  EXPECT_EQ(r.openForRead().status(), OpenStatus::Retry);
+  EXPECT_EQ(1, epochs.getNumReaders());
+
+  // reclaim waits for the reader
+  std::atomic<bool> reclaimed{false};
+  std::thread reclaimer{[&] {
+    EXPECT_TRUE(r.readyForReclaim(true));
+    reclaimed = true;
+  }};
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(reclaimed);
+  r.close(std::move(desc));
+  reclaimer.join();
+  EXPECT_TRUE(reclaimed);
+  EXPECT_EQ(0, epochs.getNumReaders());
+
+  // reads of an unflushed buffer take the region lock
+  r.reset();
+  r.attachBuffer(std::make_unique<Buffer>(1024));
+  auto inMemDesc = r.openForRead();
+  EXPECT_EQ(inMemDesc.status(), OpenStatus::Ready);
+  EXPECT_FALSE(inMemDesc.isEpochRead());
+  EXPECT_EQ(1, r.getActiveInMemReaders());
+  r.close(std::move(inMemDesc));
+
+  // and the epochs again once it is flushed
+  r.setPendingFlush();
+  EXPECT_EQ(Region::FlushRes::kSuccess,
+            r.flushBuffer([](RelAddress, BufferView) { return true; }));
+  auto flushedDesc = r.openForRead();
+  EXPECT_TRUE(flushedDesc.isEpochRead());
+  r.close(std::move(flushedDesc));
+  EXPECT_EQ(0, epochs.getNumReaders());
+}
+
 TEST(Region, WriteAndBlock) {
   Region r{RegionId(0), 1024};
 
@@ -68,6 +120,20 @@ TEST(Region, BufferAttachDetach) {
   EXPECT_FALSE(r.hasBuffer());
 }
 
+TEST(Region, BufferWriteInPlace) {
+  Region r{RegionId(0), 1024};
+  r.attachBuffer(std::make_unique<Buffer>(1024));
+  r.writeToBuffer(512, 256, [](MutableBufferView view) {
+    EXPECT_EQ(256, view.size());
+    memset(view.data(), 'B', view.size());
+  });
+  Buffer expected(256);
+  memset(expected.data(), 'B', 256);
+  Buffer readBuf(256);
+  r.readFromBuffer(512, readBuf.mutableView());
+  EXPECT_TRUE(expected.view() == readBuf.view());
+}
+
 TEST(Region, BufferFlush) {
   auto b = std::make_unique<Buffer>(1024);
   Region r{RegionId(0), 1024};
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "cachelib/navy/block_cache/FixedSizeIndex.h"
+#include "cachelib/navy/block_cache/ReuseReinsertionPolicy.h"
+#include "cachelib/navy/common/Hash.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+folly::StringPiece toKey(const HashedKey& hk) {
+  return {reinterpret_cast<const char*>(hk.key().data()), hk.key().size()};
+}
+} // namespace
+
+TEST(ReuseReinsertionPolicy, Score) {
+  FixedSizeIndex index{16};
+  ReuseReinsertionPolicy policy{2, 0, index};
+
+  auto hk = makeHK("test_key_1");
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), ""));
+
+  index.insert(hk.keyHash(), 10, 0);
+  index.lookup(hk.keyHash());
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), ""));
+  index.lookup(hk.keyHash());
+  EXPECT_TRUE(policy.shouldReinsert(toKey(hk), ""));
+
+  // after the reinsertion its past hits count half
+  EXPECT_TRUE(index.replaceIfMatch(hk.keyHash(), 20, 10));
+  EXPECT_EQ(2, index.peek(hk.keyHash()).totalHits());
+  EXPECT_EQ(0, index.peek(hk.keyHash()).currentHits());
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), ""));
+  index.lookup(hk.keyHash());
+  EXPECT_TRUE(policy.shouldReinsert(toKey(hk), ""));
+
+  // an item no longer read falls out after one more stay
+  EXPECT_TRUE(index.replaceIfMatch(hk.keyHash(), 30, 20));
+  EXPECT_EQ(3, index.peek(hk.keyHash()).totalHits());
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), ""));
+}
+
+TEST(ReuseReinsertionPolicy, WriteBudget) {
+  FixedSizeIndex index{16};
+  // far below a byte per millisecond, so the budget does not refill during
+  // the test
+  ReuseReinsertionPolicy policy{1, 100, index};
+
+  auto hk = makeHK("key");
+  index.insert(hk.keyHash(), 10, 0);
+  index.lookup(hk.keyHash());
+  const std::string value(30, 'a');
+  EXPECT_TRUE(policy.shouldReinsert(toKey(hk), value));
+  EXPECT_TRUE(policy.shouldReinsert(toKey(hk), value));
+  EXPECT_TRUE(policy.shouldReinsert(toKey(hk), value));
+  // 3 * 33 bytes used, 1 byte left
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), value));
+  EXPECT_FALSE(policy.shouldReinsert(toKey(hk), ""));
+
+  uint64_t rejections = 0;
+  policy.getCounters({[&](folly::StringPiece name, double val) {
+    if (name == "navy_bc_reinsertion_budget_rejections") {
+      rejections = static_cast<uint64_t>(val);
+    }
+  }});
+  EXPECT_EQ(2, rejections);
+}
+} // namespace facebook::cachelib::navy::tests
@@ -26,6 +26,7 @@
 #include <stdexcept>
 #include <string>
 
+#include "cachelib/navy/common/BufferPool.h"
 #include "cachelib/navy/common/Utils.h"
 #include "folly/Range.h"
 
@@ -106,8 +107,18 @@ class BufferViewT {
 using BufferView = BufferViewT<const uint8_t>;
 using MutableBufferView = BufferViewT<uint8_t>;
 
+// Frees the memory of a buffer, or releases it to the BufferPool if it was
+// allocated from there
 struct BufferDeleter {
-  void operator()(void* ptr) const { std::free(ptr); }
+  void operator()(uint8_t* ptr) const {
+    if (sizeClass == BufferPool::kUnpooled) {
+      std::free(ptr);
+    } else {
+      BufferPool::release(ptr, sizeClass);
+    }
+  }
+
+  uint8_t sizeClass{BufferPool::kUnpooled};
 };
 
 // Byte buffer. Manages buffer lifetime.
@@ -136,8 +147,13 @@ class Buffer {
   // @param size        size of bytes of the buffer, it must be a
   //                    multiple of the alignment
   // @param alignment   alignment of the buffer
-  Buffer(size_t size, size_t alignment)
-      : size_{size}, data_{allocate(size, alignment)} {}
+  Buffer(size_t size, size_t alignment) : size_{size} {
+    XDCHECK(folly::isPowTwo(alignment)); // Also ensures @alignment > 0
+    XDCHECK_EQ(size % alignment, 0u);
+    BufferDeleter deleter;
+    auto ptr = BufferPool::allocate(size, alignment, deleter.sizeClass);
+    data_ = std::unique_ptr<uint8_t[], BufferDeleter>{ptr, deleter};
+  }
 
   // Use @copy instead to make it explicit and visible
   Buffer(const Buffer&) = delete;
@@ -225,16 +241,6 @@ class Buffer {
     return ptr;
   }
 
-  static uint8_t* allocate(size_t size, size_t alignment) {
-    XDCHECK(folly::isPowTwo(alignment)); // Also ensures @alignment > 0
-    XDCHECK_EQ(size % alignment, 0u);
-    auto ptr = reinterpret_cast<uint8_t*>(::aligned_alloc(alignment, size));
-    if (!ptr) {
-      throw std::bad_alloc();
-    }
-    return ptr;
-  }
-
   // size_ represents the size of valid data in the data_, i.e., "size_" number
   // of bytes from startOffset in data_ are considered valid in the Buffer
   size_t size_{};
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "cachelib/navy/common/BufferPool.h"
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+
+namespace facebook::cachelib::navy {
+namespace {
+TLCounter numHits;
+TLCounter numMisses;
+TLCounter numUnpooled;
+TLCounter numOverflows;
+
+// freed buffers of every class kept by a thread
+struct ThreadCache {
+  std::array<std::vector<uint8_t*>, BufferPool::kNumClasses> buffers;
+
+  ~ThreadCache();
+};
+
+// buffers released by thread local destructors that run after the cache of
+// the thread is gone are freed
+thread_local bool threadCacheDestroyed{false};
+thread_local ThreadCache threadCache;
+
+ThreadCache::~ThreadCache() {
+  threadCacheDestroyed = true;
+  for (auto& classBuffers : buffers) {
+    for (auto* ptr : classBuffers) {
+      std::free(ptr);
+    }
+  }
+}
+
+uint8_t* alignedAlloc(size_t size, size_t alignment) {
+  auto ptr = reinterpret_cast<uint8_t*>(::aligned_alloc(alignment, size));
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+} // namespace
+
+uint8_t BufferPool::getSizeClass(size_t size, size_t alignment) noexcept {
+  if (alignment > kAlignment || size > (size_t{1} << kMaxSizeBits)) {
+    return kUnpooled;
+  }
+  const auto bits = std::max<uint32_t>(
+      kMinSizeBits, size <= 1 ? 0 : folly::findLastSet(size - 1));
+  return static_cast<uint8_t>(bits - kMinSizeBits);
+}
+
+size_t BufferPool::getMaxCachedBuffers(uint8_t sizeClass) noexcept {
+  return std::clamp<size_t>(kMaxCachedBytesPerClass / getClassSize(sizeClass),
+                            1, kMaxCachedBuffersPerClass);
+}
+
+uint8_t* BufferPool::allocate(size_t size,
+                              size_t alignment,
+                              uint8_t& sizeClass) {
+  sizeClass = getSizeClass(size, alignment);
+  if (sizeClass == kUnpooled) {
+    numUnpooled.inc();
+    return alignedAlloc(size, alignment);
+  }
+  if (!threadCacheDestroyed) {
+    auto& classBuffers = threadCache.buffers[sizeClass];
+    if (!classBuffers.empty()) {
+      auto* ptr = classBuffers.back();
+      classBuffers.pop_back();
+      numHits.inc();
+      return ptr;
+    }
+  }
+  numMisses.inc();
+  return alignedAlloc(getClassSize(sizeClass), kAlignment);
+}
+
+void BufferPool::release(uint8_t* ptr, uint8_t sizeClass) noexcept {
+  if (sizeClass == kUnpooled || threadCacheDestroyed) {
+    std::free(ptr);
+    return;
+  }
+  auto& classBuffers = threadCache.buffers[sizeClass];
+  if (classBuffers.size() >= getMaxCachedBuffers(sizeClass)) {
+    numOverflows.inc();
+    std::free(ptr);
+    return;
+  }
+  if (classBuffers.capacity() == 0) {
+    // reserve up front so that releasing never allocates
+    try {
+      classBuffers.reserve(getMaxCachedBuffers(sizeClass));
+    } catch (const std::bad_alloc&) {
+      std::free(ptr);
+      return;
+    }
+  }
+  classBuffers.push_back(ptr);
+}
+
+void BufferPool::getCounters(const CounterVisitor& visitor) {
+  visitor("navy_buffer_pool_hits", numHits.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_buffer_pool_misses", numMisses.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_buffer_pool_unpooled", numUnpooled.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_buffer_pool_overflows", numOverflows.get(),
+          CounterVisitor::CounterType::RATE);
+}
+
+} // namespace facebook::cachelib::navy
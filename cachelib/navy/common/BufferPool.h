@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cachelib/common/Utils.h"
+
+namespace facebook::cachelib::navy {
+
+// Size classed pool of the aligned buffers that navy reads and writes the
+// device through. Every thread caches a few freed buffers of every class, so
+// the short lived buffers of lookups and inserts are reused by the next
+// operation of the thread instead of going through aligned_alloc and free.
+// Reused buffers were last used by the same thread, so their memory stays
+// local to the node the thread runs on.
+//
+// Classes are the powers of two from 2^kMinSizeBits to 2^kMaxSizeBits bytes,
+// aligned to kAlignment. Larger buffers, such as region buffers, and buffers
+// with a larger alignment are not pooled.
+class BufferPool {
+ public:
+  static constexpr size_t kAlignment{4096};
+  static constexpr uint32_t kMinSizeBits{12};
+  static constexpr uint32_t kMaxSizeBits{20};
+  static constexpr uint8_t kNumClasses{kMaxSizeBits - kMinSizeBits + 1};
+  // class of the buffers that are not pooled
+  static constexpr uint8_t kUnpooled{0xff};
+
+  // bytes of the freed buffers of a class each thread keeps, and the most
+  // buffers of a class it keeps. At least one buffer of every class is kept.
+  static constexpr size_t kMaxCachedBytesPerClass{1024 * 1024};
+  static constexpr size_t kMaxCachedBuffersPerClass{32};
+
+  // Allocate a buffer of at least @size bytes aligned to @alignment, from the
+  // cache of the calling thread if it has one of the class.
+  //
+  // @param sizeClass   set to the class to release the buffer with
+  //
+  // @throw std::bad_alloc if out of memory
+  static uint8_t* allocate(size_t size, size_t alignment, uint8_t& sizeClass);
+
+  // Release a buffer into the cache of the calling thread, or free it if the
+  // cache of its class is full or the buffer is not pooled.
+  static void release(uint8_t* ptr, uint8_t sizeClass) noexcept;
+
+  // @return the class of the buffers of the size and alignment, or kUnpooled
+  static uint8_t getSizeClass(size_t size, size_t alignment) noexcept;
+
+  static size_t getClassSize(uint8_t sizeClass) noexcept {
+    return size_t{1} << (kMinSizeBits + sizeClass);
+  }
+
+  // @return the number of freed buffers of the class every thread keeps
+  static size_t getMaxCachedBuffers(uint8_t sizeClass) noexcept;
+
+  // Visit the counters of the pool, shared by all the navy instances of the
+  // process.
+  static void getCounters(const CounterVisitor& visitor);
+};
+
+} // namespace facebook::cachelib::navy
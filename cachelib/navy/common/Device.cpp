@@ -16,22 +16,33 @@
 
 #include "cachelib/navy/common/Device.h"
 
+#include <fcntl.h>
 #include <folly/File.h>
 #include <folly/Format.h>
 #include <folly/Function.h>
+#include <folly/Random.h>
 #include <folly/ThreadLocal.h>
 #include <folly/experimental/io/AsyncIO.h>
 #include <folly/experimental/io/IoUring.h>
+#include <folly/fibers/Baton.h>
+#include <folly/fibers/Semaphore.h>
 #include <folly/fibers/TimedMutex.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/io/async/EventHandler.h>
+#include <linux/fs.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 #include <numeric>
 
 #include "cachelib/navy/common/FdpNvme.h"
+#include "cachelib/navy/common/LookupTrace.h"
 #include "cachelib/navy/common/Utils.h"
 
 namespace facebook::cachelib::navy {
@@ -40,6 +51,10 @@ namespace {
 using IOOperation =
     std::function<ssize_t(int fd, void* buf, size_t count, off_t offset)>;
 
+// Called on the completion of an IOOp with the index of its file, whether it
+// succeeded and its device latency in microseconds
+using IOOpDoneCallback = std::function<void(uint32_t, bool, double)>;
+
 // Forward declarations
 struct IOReq;
 class IoContext;
@@ -55,19 +70,21 @@ enum OpType : uint8_t { INVALID = 0, READ, WRITE };
 struct IOOp {
   explicit IOOp(IOReq& parent,
                 int idx,
+                uint32_t fileIdx,
                 int fd,
                 uint64_t offset,
                 uint32_t size,
                 void* data,
-                std::function<void(double)> trackIOOpDeviceLatency,
+                IOOpDoneCallback onIOOpDone,
                 std::optional<int> placeHandle = std::nullopt)
       : parent_(parent),
         idx_(idx),
+        fileIdx_(fileIdx),
         fd_(fd),
         offset_(offset),
         size_(size),
         data_(data),
-        trackIOOpDeviceLatency_(std::move(trackIOOpDeviceLatency)),
+        onIOOpDone_(std::move(onIOOpDone)),
         placeHandle_(placeHandle) {}
 
   std::string toString() const;
@@ -79,17 +96,22 @@ struct IOOp {
   const uint32_t idx_;
 
   // Params for read/write
+  // Index of the file in the file vector of the device
+  const uint32_t fileIdx_;
   const int fd_;
   const uint64_t offset_ = 0;
   const uint32_t size_ = 0;
   void* const data_;
   // Completion - Submit
-  std::function<void(double)> trackIOOpDeviceLatency_;
+  IOOpDoneCallback onIOOpDone_;
   std::optional<int> placeHandle_;
 
   // The number of resubmission on EAGAIN error
   uint8_t resubmitted_ = 0;
 
+  // Index of the registered buffer the op is submitted with, -1 if none
+  int registeredBufferIdx_ = -1;
+
   // Time when the processing of this op started
   std::chrono::nanoseconds startTime_;
   // Time when the op has been submitted
@@ -106,7 +128,7 @@ struct IOReq {
                  uint64_t offset,
                  uint32_t size,
                  void* data,
-                 std::function<void(double)> trackIOOpDeviceLatency,
+                 IOOpDoneCallback onIOOpDone,
                  std::optional<int> placeHandle = std::nullopt);
 
   const char* getOpName() const {
@@ -175,7 +197,7 @@ class IoContext {
       uint64_t offset,
       uint32_t size,
       void* data,
-      std::function<void(double)> trackIOOpDeviceLatency);
+      IOOpDoneCallback onIOOpDone);
 
   // Create and submit write req
   std::shared_ptr<IOReq> submitWrite(
@@ -184,12 +206,23 @@ class IoContext {
       uint64_t offset,
       uint32_t size,
       const void* data,
-      std::function<void(double)> trackIOOpDeviceLatency,
+      IOOpDoneCallback onIOOpDone,
       int placeHandle);
 
+  // Submit all IOOps of the reqs before waiting for any of them
+  void submitReqBatch(const std::vector<std::shared_ptr<IOReq>>& reqs);
+
   // Submit a IOOp to the device; should not fail for AsyncIoContext
   virtual bool submitIo(IOOp& op) = 0;
 
+  // Submit a batch of IOOps to the device. By default, they are submitted
+  // one at a time through submitIo.
+  virtual void submitIoBatch(folly::Range<IOOp**> ops);
+
+  // Called before waiting on @baton for an async IO to complete. Contexts
+  // that poll for completions do so here for a while. No-op by default.
+  virtual void pollBeforeWait(folly::fibers::Baton& /* baton */) {}
+
  protected:
   void submitReq(std::shared_ptr<IOReq> req);
 };
@@ -228,17 +261,31 @@ class CompletionHandler : public folly::EventHandler {
   AsyncIoContext& ioContext_;
 };
 
+// Stats of the qdepths the async IO contexts of a device adapt to the IO
+// latency target
+struct AdaptiveQDepthStats {
+  // Sum of the qdepths in effect over the contexts
+  std::atomic<uint64_t> totalQDepth{0};
+  std::atomic<uint64_t> numContexts{0};
+  AtomicCounter increases;
+  AtomicCounter decreases;
+};
+
 // Per-thread context for AsyncIO like libaio or io_uring
 class AsyncIoContext : public IoContext {
  public:
+  // @param qDepthStats  stats to report the adapted qdepth to, if there is an
+  //                     IO latency target
   AsyncIoContext(std::unique_ptr<folly::AsyncBase>&& asyncBase,
                  size_t id,
                  folly::EventBase* evb,
                  size_t capacity,
                  bool useIoUring,
-                 std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec);
+                 std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec,
+                 const AsyncIoOptions& options = {},
+                 AdaptiveQDepthStats* qDepthStats = nullptr);
 
-  ~AsyncIoContext() override = default;
+  ~AsyncIoContext() override;
 
   std::string getName() override { return fmt::format("ctx_{}", id_); }
   // IO is completed sync if compHandler_ is not available
@@ -246,18 +293,66 @@ class AsyncIoContext : public IoContext {
 
   bool submitIo(IOOp& op) override;
 
+  // Submits up to the free qdepth worth of ops with a single call into
+  // io_uring or libaio
+  void submitIoBatch(folly::Range<IOOp**> ops) override;
+
   // Invoked by event loop handler whenever AIO signals that one or more
   // operation have finished
   void pollCompletion();
 
+  // Polls for completions until @baton is posted or completionPollUs_ is up
+  void pollBeforeWait(folly::fibers::Baton& baton) override;
+
  private:
   void handleCompletion(folly::Range<folly::AsyncBaseOp**>& completed);
 
+  // Wait for an outstanding IO to complete if the qdepth, or the qdepth per
+  // file of file @fileIdx, is reached. Waiters for low priority requests are
+  // only woken up when no high priority ones are waiting.
+  void waitForQueueSpace(uint32_t fileIdx);
+
+  // Wake up the next fiber waiting for queue space, if any, after an IO on
+  // file @fileIdx completed
+  void wakeUpWaiter(uint32_t fileIdx);
+
+  // Wake up the next fiber waiting for the qdepth, if any
+  void wakeUpQDepthWaiter();
+
+  // Adapts the qdepth to an IO completed @latency after its submission. Every
+  // window of qdepth IOs, the qdepth is halved if their average latency is
+  // above the target, or grown by one if it is within the target and IOs had
+  // to wait for the qdepth.
+  void adaptQDepth(std::chrono::nanoseconds latency);
+
+  void setQDepth(size_t qDepth);
+
+  // Whether file @fileIdx has its qdepth per file outstanding
+  bool isFileQueueFull(uint32_t fileIdx) const {
+    return qDepthPerFile_ > 0 && fileIdx < fileQueues_.size() &&
+           fileQueues_[fileIdx]->numOutstanding >= qDepthPerFile_;
+  }
+
+  // Counts an IO submitted on file @fileIdx against its qdepth per file. The
+  // completion handler uncounts it.
+  void addFileOutstanding(uint32_t fileIdx);
+
   std::unique_ptr<folly::AsyncBaseOp> prepAsyncIo(IOOp& op);
 
   // Prepare an Nvme CMD IO through IOUring
   std::unique_ptr<folly::AsyncBaseOp> prepNvmeIo(IOOp& op);
 
+  // Registers @bufferSize byte buffers, one per qdepth, with the io_uring
+  // instance. Leaves them unregistered if the kernel refuses.
+  void registerBuffers(uint32_t bufferSize);
+
+  // Prepare a read or write through a free registered buffer, or returns
+  // nullptr if the op does not fit one or all of them are in use
+  std::unique_ptr<folly::AsyncBaseOp> prepFixedIo(IOOp& op);
+
+  // Copies the data read into the registered buffer of @op out and frees it
+  void releaseRegisteredBuffer(IOOp& op, ssize_t len);
+
   // The maximum number of retries when IO failed with EBUSY.
   // For now, this could happen only for io_uring when combined with md
   // devices due to, suspectedly, a different way the partial EAGAINs for
@@ -274,12 +369,38 @@ class AsyncIoContext : public IoContext {
 
   using WaiterList = folly::SafeIntrusiveList<Waiter, &Waiter::hook_>;
 
+  // IOs outstanding on a file and the fibers waiting for them to drop below
+  // the qdepth per file
+  struct FileQueue {
+    size_t numOutstanding{0};
+    WaiterList waitList;
+  };
+
   std::unique_ptr<folly::AsyncBase> asyncBase_;
   // Sequential id assigned to this context
   const size_t id_;
+  // The capacity of the queue, the qdepth is adapted up to it
   const size_t qDepth_;
-  // Waiter list for enforcing the qdepth
+  // Average latency in microseconds of the IOs to adapt the qdepth to, 0 for
+  // the fixed qDepth_
+  const uint32_t targetLatencyUs_;
+  // The qdepth in effect
+  size_t curQDepth_;
+  // Sum of the latencies and the number of IOs of the current window
+  uint64_t windowLatencyNs_{0};
+  size_t windowNumIos_{0};
+  // Whether an IO waited for the qdepth in the current window
+  bool windowQDepthLimited_{false};
+  AdaptiveQDepthStats* const qDepthStats_;
+  // Microseconds to poll for completions before waiting for the event loop
+  const uint32_t completionPollUs_;
+  // Max outstanding IOs per file, 0 for no limit
+  const size_t qDepthPerFile_;
+  // Indexed by file, created as the files are first used
+  std::vector<std::unique_ptr<FileQueue>> fileQueues_;
+  // Waiter lists for enforcing the qdepth, per request priority
   WaiterList waitList_;
+  WaiterList lowPriWaitList_;
   std::unique_ptr<CompletionHandler> compHandler_;
   // Use io_uring or libaio
   bool useIoUring_;
@@ -294,6 +415,13 @@ class AsyncIoContext : public IoContext {
   const std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec_{};
   // As of now, only one FDP enabled Device is supported
   static constexpr uint16_t kDefaultFdpIdx = 0u;
+
+  // Buffers registered with io_uring, so that the IOs through them skip
+  // pinning the pages of the buffer in the kernel. Small IOs are bounced
+  // through these.
+  std::vector<Buffer> registeredBuffers_;
+  // Indexes of the registered buffers not used by an outstanding IO
+  std::vector<uint32_t> freeRegisteredBuffers_;
 };
 
 // An FileDevice manages direct I/O to either a single or multiple (RAID0)
@@ -309,18 +437,50 @@ class FileDevice : public Device {
              uint32_t maxDeviceWriteSize,
              IoEngine ioEngine,
              uint32_t qDepthPerContext,
-             std::shared_ptr<DeviceEncryptor> encryptor);
+             std::shared_ptr<DeviceEncryptor> encryptor,
+             uint32_t readAlignSize,
+             AsyncIoOptions asyncIoOptions);
 
   FileDevice(const FileDevice&) = delete;
   FileDevice& operator=(const FileDevice&) = delete;
 
+  // A member is one of the files of a RAID0 device
+  bool setMemberDegraded(uint32_t idx, bool degraded) override;
+
+  bool isDegraded(uint64_t offset, uint32_t size) const override;
+
  private:
+  // Stats and state of one file of a RAID0 device
+  struct FileState {
+    mutable util::PercentileStats readLatency;
+    mutable util::PercentileStats writeLatency;
+    mutable AtomicCounter ioErrors;
+    std::atomic<bool> degraded{false};
+  };
+
   IoContext* getIoContext();
 
+  // Tracks the completion of an IOOp on file @fileIdx
+  void trackIOOp(OpType opType,
+                 uint32_t fileIdx,
+                 bool result,
+                 double latencyUs);
+
+  // Exports the adapted qdepth and the per file stats of a RAID0 device
+  void getCountersImpl(const CounterVisitor& visitor) const override;
+
   bool writeImpl(uint64_t, uint32_t, const void*, int) override;
 
   bool readImpl(uint64_t, uint32_t, void*) override;
 
+  void readBatchImpl(folly::Range<IORead*> reads) override;
+
+  bool batchesWriteChunks() const override {
+    return asyncIoOptions_.batchWriteChunks && ioEngine_ != IoEngine::Sync;
+  }
+
+  void writeBatchImpl(folly::Range<IOWrite*> writes, int placeHandle) override;
+
   void flushImpl() override;
 
   int allocatePlacementHandle() override;
@@ -334,6 +494,14 @@ class FileDevice : public Device {
   // RAID stripe size when multiple devices are used
   const uint32_t stripeSize_;
 
+  // Per file stats and state, one per file of fvec_
+  const std::unique_ptr<FileState[]> fileStates_;
+  // Number of files marked degraded
+  std::atomic<uint32_t> numDegraded_{0};
+
+  // Reported to by the async IO contexts if there is an IO latency target.
+  AdaptiveQDepthStats qDepthStats_;
+
   // SyncIoContext is the IoContext used when async IO is not enabled.
   std::unique_ptr<SyncIoContext> syncIoContext_;
 
@@ -350,21 +518,161 @@ class FileDevice : public Device {
   // The max number of outstanding requests per IO context. This is used to
   // determine the capacity of an io_uring/libaio queue
   const uint32_t qDepthPerContext_;
+  // Options of the async IO contexts
+  const AsyncIoOptions asyncIoOptions_;
 
   AtomicCounter numProcessed_{0};
 
   friend class IoContext;
 };
 
+// Pins the calling thread to @cpu. Logs the failure and leaves the thread
+// unpinned if it is not allowed.
+void pinCurrentThread(uint32_t cpu) {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  auto ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+  if (ret != 0) {
+    XLOGF(ERR, "Failed to pin IO thread to cpu {}: {}", cpu, ret);
+    return;
+  }
+  XLOGF(INFO, "Pinned IO thread to cpu {}", cpu);
+}
+
+// Delays the IOs of a memory device like the device described by the
+// emulation config would. Waits suspend the fiber of the IO when there is
+// one and block the thread otherwise.
+class DeviceEmulator {
+ public:
+  explicit DeviceEmulator(const MemoryDeviceEmulationConfig& config)
+      : config_{config} {
+    if (config_.queueDepth > 0) {
+      queueSlots_ =
+          std::make_unique<folly::fibers::Semaphore>(config_.queueDepth);
+    }
+  }
+
+  // wait until an IO of @size bytes would have completed on the device
+  void emulate(bool read, uint32_t size) {
+    const auto begin = std::chrono::steady_clock::now();
+    if (queueSlots_) {
+      queueSlots_->wait();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto end = transfer(read ? readChannelNs_ : writeChannelNs_,
+                        read ? config_.readBandwidthMBps
+                             : config_.writeBandwidthMBps,
+                        size, start);
+    end += sampleLatency(read ? config_.readLatencyUs : config_.writeLatencyUs);
+    const auto now = std::chrono::steady_clock::now();
+    if (end > now) {
+      folly::fibers::Baton baton;
+      baton.try_wait_for(end - now);
+    }
+    if (queueSlots_) {
+      queueSlots_->signal();
+    }
+
+    queueWaitEstimator_.trackValue(toMicros(start - begin).count());
+    (read ? readLatencyEstimator_ : writeLatencyEstimator_)
+        .trackValue(toMicros(std::chrono::steady_clock::now() - begin).count());
+  }
+
+  void getCounters(const CounterVisitor& visitor) const {
+    readLatencyEstimator_.visitQuantileEstimator(
+        visitor, "navy_device_emulated_read_latency_us");
+    writeLatencyEstimator_.visitQuantileEstimator(
+        visitor, "navy_device_emulated_write_latency_us");
+    queueWaitEstimator_.visitQuantileEstimator(
+        visitor, "navy_device_emulated_queue_wait_us");
+  }
+
+ private:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  // @return when the transfer of the IO that is ready at @now ends on a
+  //         channel of @mbps shared by all the IOs of its kind
+  static TimePoint transfer(std::atomic<int64_t>& channelNs,
+                            uint32_t mbps,
+                            uint32_t size,
+                            TimePoint now) {
+    if (mbps == 0) {
+      return now;
+    }
+    // 1 MB/s transfers a byte per microsecond
+    const int64_t transferNs = static_cast<int64_t>(size) * 1000 / mbps;
+    const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              now.time_since_epoch())
+                              .count();
+    auto freeNs = channelNs.load(std::memory_order_relaxed);
+    int64_t startNs;
+    do {
+      startNs = std::max(freeNs, nowNs);
+    } while (!channelNs.compare_exchange_weak(freeNs, startNs + transferNs,
+                                              std::memory_order_relaxed));
+    return TimePoint{std::chrono::nanoseconds{startNs + transferNs}};
+  }
+
+  // @return a latency interpolated between the percentiles for a uniformly
+  //         sampled percentile
+  static std::chrono::microseconds sampleLatency(
+      const std::vector<std::pair<double, uint32_t>>& latencies) {
+    if (latencies.empty()) {
+      return std::chrono::microseconds{0};
+    }
+    const double sample = folly::Random::randDouble(0, 100);
+    double lastPct = 0;
+    double lastLatency = latencies.front().second;
+    for (const auto& [pct, latency] : latencies) {
+      if (sample <= pct) {
+        const double ratio = (sample - lastPct) / (pct - lastPct);
+        return std::chrono::microseconds{static_cast<int64_t>(
+            lastLatency + ratio * (latency - lastLatency))};
+      }
+      lastPct = pct;
+      lastLatency = latency;
+    }
+    return std::chrono::microseconds{latencies.back().second};
+  }
+
+  template <typename Duration>
+  static std::chrono::microseconds toMicros(Duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d);
+  }
+
+  const MemoryDeviceEmulationConfig config_;
+
+  // slots of the IOs the device serves at a time, if limited
+  std::unique_ptr<folly::fibers::Semaphore> queueSlots_;
+
+  // time in nanoseconds at which the transfers booked so far end
+  std::atomic<int64_t> readChannelNs_{0};
+  std::atomic<int64_t> writeChannelNs_{0};
+
+  mutable util::PercentileStats readLatencyEstimator_;
+  mutable util::PercentileStats writeLatencyEstimator_;
+  mutable util::PercentileStats queueWaitEstimator_;
+};
+
 // Device on memory buffer
 class MemoryDevice final : public Device {
  public:
   explicit MemoryDevice(uint64_t size,
                         std::shared_ptr<DeviceEncryptor> encryptor,
-                        uint32_t ioAlignSize)
-      : Device{size, std::move(encryptor), ioAlignSize, 0 /* max IO size */,
-               0 /* max device write size */},
-        buffer_{std::make_unique<uint8_t[]>(size)} {}
+                        uint32_t ioAlignSize,
+                        uint32_t readAlignSize,
+                        const MemoryDeviceEmulationConfig& emulation)
+      : Device{size,
+               std::move(encryptor),
+               ioAlignSize,
+               0 /* max IO size */,
+               0 /* max device write size */,
+               readAlignSize},
+        buffer_{std::make_unique<uint8_t[]>(size)},
+        emulator_{emulation.isEnabled()
+                      ? std::make_unique<DeviceEmulator>(emulation)
+                      : nullptr} {}
   MemoryDevice(const MemoryDevice&) = delete;
   MemoryDevice& operator=(const MemoryDevice&) = delete;
   ~MemoryDevice() override = default;
@@ -376,12 +684,18 @@ class MemoryDevice final : public Device {
                  int /* unused */) noexcept override {
     XDCHECK_LE(offset + size, getSize());
     std::memcpy(buffer_.get() + offset, value, size);
+    if (emulator_) {
+      emulator_->emulate(false /* read */, size);
+    }
     return true;
   }
 
   bool readImpl(uint64_t offset, uint32_t size, void* value) override {
     XDCHECK_LE(offset + size, getSize());
     std::memcpy(value, buffer_.get() + offset, size);
+    if (emulator_) {
+      emulator_->emulate(true /* read */, size);
+    }
     return true;
   }
 
@@ -391,7 +705,14 @@ class MemoryDevice final : public Device {
     // Noop
   }
 
+  void getCountersImpl(const CounterVisitor& visitor) const override {
+    if (emulator_) {
+      emulator_->getCounters(visitor);
+    }
+  }
+
   std::unique_ptr<uint8_t[]> buffer_;
+  std::unique_ptr<DeviceEmulator> emulator_;
 };
 } // namespace
 
@@ -415,8 +736,20 @@ bool Device::write(uint64_t offset, Buffer buffer, int placeHandle) {
   XDCHECK_EQ(reinterpret_cast<uint64_t>(data) % ioAlignmentSize_, 0ul);
   if (encryptor_) {
     XCHECK_EQ(offset % encryptor_->encryptionBlockSize(), 0ul);
-    auto res = encryptor_->encrypt(folly::MutableByteRange{data, size}, offset);
-    if (!res) {
+    // Encrypted in the chunks it is written in, so that the encryptor can
+    // process them together
+    const size_t chunkSize = maxWriteSize_ == 0 ? size : maxWriteSize_;
+    std::vector<DeviceEncryptor::Payload> payloads;
+    payloads.reserve((size + chunkSize - 1) / chunkSize);
+    for (size_t pos = 0; pos < size; pos += chunkSize) {
+      payloads.push_back(DeviceEncryptor::Payload{
+          folly::MutableByteRange{data + pos,
+                                  std::min<size_t>(chunkSize, size - pos)},
+          offset + pos});
+    }
+    encryptor_->encryptBatch(folly::range(payloads));
+    if (std::any_of(payloads.begin(), payloads.end(),
+                    [](const auto& payload) { return !payload.result; })) {
       encryptionErrors_.inc();
       return false;
     }
@@ -430,6 +763,9 @@ bool Device::writeInternal(uint64_t offset,
                            int placeHandle) {
   auto remainingSize = size;
   auto maxWriteSize = (maxWriteSize_ == 0) ? remainingSize : maxWriteSize_;
+  if (remainingSize > maxWriteSize && batchesWriteChunks()) {
+    return writeChunksBatched(offset, data, size, maxWriteSize, placeHandle);
+  }
   bool result = true;
   while (remainingSize > 0) {
     auto writeSize = std::min<size_t>(maxWriteSize, remainingSize);
@@ -457,6 +793,47 @@ bool Device::writeInternal(uint64_t offset,
   return result;
 }
 
+bool Device::writeChunksBatched(uint64_t offset,
+                                const uint8_t* data,
+                                size_t size,
+                                size_t chunkSize,
+                                int placeHandle) {
+  std::vector<IOWrite> writes;
+  writes.reserve((size + chunkSize - 1) / chunkSize);
+  for (size_t pos = 0; pos < size; pos += chunkSize) {
+    auto writeSize = std::min<size_t>(chunkSize, size - pos);
+    XDCHECK_EQ((offset + pos) % ioAlignmentSize_, 0ul);
+    XDCHECK_EQ(writeSize % ioAlignmentSize_, 0ul);
+    writes.push_back(
+        IOWrite{offset + pos, static_cast<uint32_t>(writeSize), data + pos});
+  }
+
+  auto timeBegin = getSteadyClock();
+  writeBatchImpl(folly::range(writes), placeHandle);
+  auto latency = toMicros(getSteadyClock() - timeBegin).count();
+
+  bool result = true;
+  for (const auto& write : writes) {
+    writeLatencyEstimator_.trackValue(latency);
+    if (write.result) {
+      bytesWritten_.add(write.size);
+    } else {
+      result = false;
+    }
+  }
+  if (!result) {
+    writeIOErrors_.inc();
+  }
+  return result;
+}
+
+void Device::writeBatchImpl(folly::Range<IOWrite*> writes, int placeHandle) {
+  for (auto& write : writes) {
+    write.result =
+        writeImpl(write.offset, write.size, write.value, placeHandle);
+  }
+}
+
 // reads size number of bytes from the device from the offset into value.
 // Both offset and size are expected to be aligned for device IO operations.
 // If successful and encryptor_ is defined, size bytes from
@@ -464,7 +841,7 @@ bool Device::writeInternal(uint64_t offset,
 //
 // returns true if successful, false otherwise.
 bool Device::readInternal(uint64_t offset, uint32_t size, void* value) {
-  XDCHECK_EQ(reinterpret_cast<uint64_t>(value) % ioAlignmentSize_, 0ul);
+  XDCHECK_EQ(reinterpret_cast<uint64_t>(value) % readAlignmentSize_, 0ul);
   XDCHECK_LE(offset + size, size_);
   uint8_t* data = reinterpret_cast<uint8_t*>(value);
   auto remainingSize = size;
@@ -473,8 +850,8 @@ bool Device::readInternal(uint64_t offset, uint32_t size, void* value) {
   uint64_t curOffset = offset;
   while (remainingSize > 0) {
     auto readSize = std::min<size_t>(maxReadSize, remainingSize);
-    XDCHECK_EQ(curOffset % ioAlignmentSize_, 0ul);
-    XDCHECK_EQ(size % ioAlignmentSize_, 0ul);
+    XDCHECK_EQ(curOffset % readAlignmentSize_, 0ul);
+    XDCHECK_EQ(size % readAlignmentSize_, 0ul);
 
     auto timeBegin = getSteadyClock();
     result = readImpl(curOffset, readSize, data);
@@ -505,8 +882,8 @@ bool Device::readInternal(uint64_t offset, uint32_t size, void* value) {
 
 // This API reads size bytes from the Device from offset into a Buffer and
 // returns the Buffer. If offset and size are not aligned to device's
-// ioAlignmentSize_, IO aligned offset and IO aligned size are determined
-// and passed to device read. Upon successful read from the device, the
+// readAlignmentSize_, read aligned offset and read aligned size are
+// determined and passed to device read. Upon successful read from the device, the
 // buffer is adjusted to return the intended data by trimming the data in
 // the front and back.
 // An empty buffer is returned in case of error and the caller must check
@@ -514,11 +891,11 @@ bool Device::readInternal(uint64_t offset, uint32_t size, void* value) {
 Buffer Device::read(uint64_t offset, uint32_t size) {
   XDCHECK_LE(offset + size, size_);
   uint64_t readOffset =
-      offset & ~(static_cast<uint64_t>(ioAlignmentSize_) - 1ul);
+      offset & ~(static_cast<uint64_t>(readAlignmentSize_) - 1ul);
   uint64_t readPrefixSize =
-      offset & (static_cast<uint64_t>(ioAlignmentSize_) - 1ul);
-  auto readSize = getIOAlignedSize(readPrefixSize + size);
-  auto buffer = makeIOBuffer(readSize);
+      offset & (static_cast<uint64_t>(readAlignmentSize_) - 1ul);
+  auto readSize = powTwoAlign(readPrefixSize + size, readAlignmentSize_);
+  auto buffer = Buffer{readSize, readAlignmentSize_};
   bool result = readInternal(readOffset, readSize, buffer.data());
   if (!result) {
     return Buffer{};
@@ -534,6 +911,107 @@ bool Device::read(uint64_t offset, uint32_t size, void* value) {
   return readInternal(offset, size, value);
 }
 
+// Same as read(offset, size) for each entry of the batch, except that the
+// aligned reads are all handed to the device at once.
+void Device::readBatch(folly::Range<BatchRead*> reads) {
+  std::vector<IORead> ioReads;
+  ioReads.reserve(reads.size());
+  for (auto& read : reads) {
+    XDCHECK_LE(read.offset + read.size, size_);
+    uint64_t readOffset =
+        read.offset & ~(static_cast<uint64_t>(readAlignmentSize_) - 1ul);
+    uint64_t readPrefixSize =
+        read.offset & (static_cast<uint64_t>(readAlignmentSize_) - 1ul);
+    auto readSize = powTwoAlign(readPrefixSize + read.size, readAlignmentSize_);
+    read.buffer = Buffer{readSize, readAlignmentSize_};
+    ioReads.push_back(IORead{readOffset, static_cast<uint32_t>(readSize),
+                             read.buffer.data()});
+  }
+
+  readBatchInternal(folly::range(ioReads));
+
+  for (size_t i = 0; i < reads.size(); i++) {
+    auto& read = reads[i];
+    if (!ioReads[i].result) {
+      read.buffer = Buffer{};
+      continue;
+    }
+    read.buffer.trimStart(read.offset - ioReads[i].offset);
+    read.buffer.shrink(read.size);
+  }
+}
+
+void Device::readBatchInternal(folly::Range<IORead*> reads) {
+  // Reads larger than the max IO size are split up by readInternal
+  if (maxIOSize_ != 0 &&
+      std::any_of(reads.begin(), reads.end(), [this](const IORead& read) {
+        return read.size > maxIOSize_;
+      })) {
+    for (auto& read : reads) {
+      read.result = readInternal(read.offset, read.size, read.value);
+    }
+    return;
+  }
+
+  auto timeBegin = getSteadyClock();
+  readBatchImpl(reads);
+  auto latency = toMicros(getSteadyClock() - timeBegin).count();
+
+  // The reads to decrypt and their index in @reads
+  std::vector<DeviceEncryptor::Payload> payloads;
+  std::vector<size_t> payloadReads;
+  for (size_t i = 0; i < reads.size(); i++) {
+    auto& read = reads[i];
+    XDCHECK_EQ(reinterpret_cast<uint64_t>(read.value) % readAlignmentSize_,
+               0ul);
+    XDCHECK_EQ(read.offset % readAlignmentSize_, 0ul);
+    XDCHECK_EQ(read.size % readAlignmentSize_, 0ul);
+    readLatencyEstimator_.trackValue(latency);
+    if (!read.result) {
+      readIOErrors_.inc();
+      continue;
+    }
+    bytesRead_.add(read.size);
+    if (encryptor_) {
+      XCHECK_EQ(read.offset % encryptor_->encryptionBlockSize(), 0ul);
+      payloads.push_back(DeviceEncryptor::Payload{
+          folly::MutableByteRange{reinterpret_cast<uint8_t*>(read.value),
+                                  read.size},
+          read.offset});
+      payloadReads.push_back(i);
+    }
+  }
+  if (payloads.empty()) {
+    return;
+  }
+
+  encryptor_->decryptBatch(folly::range(payloads));
+  for (size_t i = 0; i < payloads.size(); i++) {
+    if (!payloads[i].result) {
+      decryptionErrors_.inc();
+      reads[payloadReads[i]].result = false;
+    }
+  }
+}
+
+void DeviceEncryptor::encryptBatch(folly::Range<Payload*> payloads) {
+  for (auto& payload : payloads) {
+    payload.result = encrypt(payload.value, payload.salt);
+  }
+}
+
+void DeviceEncryptor::decryptBatch(folly::Range<Payload*> payloads) {
+  for (auto& payload : payloads) {
+    payload.result = decrypt(payload.value, payload.salt);
+  }
+}
+
+void Device::readBatchImpl(folly::Range<IORead*> reads) {
+  for (auto& read : reads) {
+    read.result = readImpl(read.offset, read.size, read.value);
+  }
+}
+
 void Device::getCounters(const CounterVisitor& visitor) const {
   visitor("navy_device_bytes_written", getBytesWritten(),
           CounterVisitor::CounterType::RATE);
@@ -556,6 +1034,10 @@ void Device::getCounters(const CounterVisitor& visitor) const {
                                                "navy_device_read_latency_us");
   writeLatencyEstimator_.visitQuantileEstimator(visitor,
                                                 "navy_device_write_latency_us");
+  if (ioBudget_) {
+    ioBudget_->getCounters(visitor);
+  }
+  getCountersImpl(visitor);
 }
 
 namespace {
@@ -591,7 +1073,7 @@ bool IOOp::done(ssize_t len) {
                        toMillis(curTime - submitTime_).count(), toString());
   }
 
-  trackIOOpDeviceLatency_(toMicros(curTime - submitTime_).count());
+  onIOOpDone_(fileIdx_, result, toMicros(curTime - submitTime_).count());
 
   parent_.notifyOpResult(result);
   return result;
@@ -608,7 +1090,7 @@ IOReq::IOReq(IoContext& context,
              uint64_t offset,
              uint32_t size,
              void* data,
-             std::function<void(double)> trackIOOpDeviceLatency,
+             IOOpDoneCallback onIOOpDone,
              std::optional<int> placeHandle)
     : context_(context),
       opType_(opType),
@@ -627,17 +1109,17 @@ IOReq::IOReq(IoContext& context,
       uint32_t ioOffsetInStripe = offset % stripeSize;
       uint32_t allowedIOSize = std::min(size, stripeSize - ioOffsetInStripe);
 
-      ops_.emplace_back(*this, idx++, fvec[fdIdx].fd(),
+      ops_.emplace_back(*this, idx++, fdIdx, fvec[fdIdx].fd(),
                         stripeStartOffset + ioOffsetInStripe, allowedIOSize,
-                        buf, trackIOOpDeviceLatency, placeHandle_);
+                        buf, onIOOpDone, placeHandle_);
 
       size -= allowedIOSize;
       offset += allowedIOSize;
       buf += allowedIOSize;
     }
   } else {
-    ops_.emplace_back(*this, idx++, fvec[0].fd(), offset_, size_, data_,
-                      trackIOOpDeviceLatency, placeHandle_);
+    ops_.emplace_back(*this, idx++, 0, fvec[0].fd(), offset_, size_, data_,
+                      onIOOpDone, placeHandle_);
   }
 
   numRemaining_ = ops_.size();
@@ -646,7 +1128,14 @@ IOReq::IOReq(IoContext& context,
 bool IOReq::waitCompletion() {
   // Need to wait for Baton only for async io completion
   if (context_.isAsyncIoCompletion()) {
+    // other fibers can run lookups of their own while this one waits
+    auto* trace = opType_ == OpType::READ ? LookupTrace::current() : nullptr;
+    context_.pollBeforeWait(baton_);
     baton_.wait();
+    if (trace) {
+      LookupTrace::setCurrent(trace);
+      trace->stamp(LookupTrace::kIoCompleted);
+    }
   }
 
   // Check for timeout
@@ -702,10 +1191,9 @@ std::shared_ptr<IOReq> IoContext::submitRead(
     uint64_t offset,
     uint32_t size,
     void* data,
-    std::function<void(double)> trackIOOpDeviceLatency) {
-  auto req =
-      std::make_shared<IOReq>(*this, fvec, stripeSize, OpType::READ, offset,
-                              size, data, trackIOOpDeviceLatency);
+    IOOpDoneCallback onIOOpDone) {
+  auto req = std::make_shared<IOReq>(*this, fvec, stripeSize, OpType::READ,
+                                     offset, size, data, onIOOpDone);
   submitReq(req);
   return req;
 }
@@ -716,16 +1204,23 @@ std::shared_ptr<IOReq> IoContext::submitWrite(
     uint64_t offset,
     uint32_t size,
     const void* data,
-    std::function<void(double)> trackIOOpDeviceLatency,
+    IOOpDoneCallback onIOOpDone,
     int placeHandle) {
   auto req = std::make_shared<IOReq>(*this, fvec, stripeSize, OpType::WRITE,
                                      offset, size, const_cast<void*>(data),
-                                     trackIOOpDeviceLatency, placeHandle);
+                                     onIOOpDone, placeHandle);
   submitReq(req);
   return req;
 }
 
 void IoContext::submitReq(std::shared_ptr<IOReq> req) {
+  // A sync IO completes while being submitted, so its device time is
+  // accounted to the submission.
+  auto* trace =
+      req->opType_ == OpType::READ ? LookupTrace::current() : nullptr;
+  if (trace) {
+    trace->stamp(LookupTrace::kIoStarted);
+  }
   // Now submit IOOp
   req->startTime_ = getSteadyClock();
   for (auto& op : req->ops_) {
@@ -735,6 +1230,31 @@ void IoContext::submitReq(std::shared_ptr<IOReq> req) {
       break;
     }
   }
+  if (trace) {
+    trace->stamp(LookupTrace::kIoSubmitted);
+  }
+}
+
+void IoContext::submitReqBatch(
+    const std::vector<std::shared_ptr<IOReq>>& reqs) {
+  std::vector<IOOp*> ops;
+  for (auto& req : reqs) {
+    req->startTime_ = getSteadyClock();
+    for (auto& op : req->ops_) {
+      ops.push_back(&op);
+    }
+  }
+  submitIoBatch(folly::range(ops));
+}
+
+void IoContext::submitIoBatch(folly::Range<IOOp**> ops) {
+  for (auto* op : ops) {
+    if (!submitIo(*op)) {
+      // Async IO submit should not fail. A failed sync op fails its req, but
+      // the other reqs of the batch are still submitted.
+      XCHECK(!isAsyncIoCompletion());
+    }
+  }
 }
 
 /*
@@ -777,10 +1297,19 @@ AsyncIoContext::AsyncIoContext(std::unique_ptr<folly::AsyncBase>&& asyncBase,
                                folly::EventBase* evb,
                                size_t capacity,
                                bool useIoUring,
-                               std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec)
+                               std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec,
+                               const AsyncIoOptions& options,
+                               AdaptiveQDepthStats* qDepthStats)
     : asyncBase_(std::move(asyncBase)),
       id_(id),
       qDepth_(capacity),
+      targetLatencyUs_(evb && capacity > 1 && qDepthStats
+                           ? options.qDepthTargetLatencyUs
+                           : 0),
+      curQDepth_(capacity),
+      qDepthStats_(targetLatencyUs_ ? qDepthStats : nullptr),
+      completionPollUs_(options.completionPollUs),
+      qDepthPerFile_(options.qDepthPerFile),
       useIoUring_(useIoUring),
       fdpNvmeVec_(fdpNvmeVec) {
 #ifdef CACHELIB_IOURING_DISABLE
@@ -798,12 +1327,91 @@ AsyncIoContext::AsyncIoContext(std::unique_ptr<folly::AsyncBase>&& asyncBase,
     // Retry is not supported without epoll for now
     retryLimit_ = 0;
   }
+  if (useIoUring_ && fdpNvmeVec_.empty() && options.registeredBufferSize > 0) {
+    registerBuffers(options.registeredBufferSize);
+  }
+  if (qDepthStats_) {
+    qDepthStats_->totalQDepth += curQDepth_;
+    qDepthStats_->numContexts++;
+  }
 
+  folly::StringPiece nvmeMode;
+#ifndef CACHELIB_IOURING_DISABLE
+  if (!fdpNvmeVec_.empty()) {
+    nvmeMode = fdpNvmeVec_[kDefaultFdpIdx]->isFdpEnabled() ? "FDP enabled"
+                                                           : "NVMe passthrough";
+  }
+#endif
   XLOGF(INFO,
-        "[{}] Created new async io context with qdepth {}{} io_engine {} {}",
+        "[{}] Created new async io context with qdepth {}{} io_engine {} {}{}"
+        "{}",
         getName(), qDepth_, qDepth_ == 1 ? " (sync wait)" : "",
-        useIoUring_ ? "io_uring" : "libaio",
-        (fdpNvmeVec_.size() > 0) ? "FDP enabled" : "");
+        useIoUring_ ? "io_uring" : "libaio", nvmeMode,
+        registeredBuffers_.empty() ? "" : " registered buffers",
+        targetLatencyUs_
+            ? fmt::format(" latency target {}us", targetLatencyUs_)
+            : "");
+}
+
+AsyncIoContext::~AsyncIoContext() {
+  if (qDepthStats_) {
+    qDepthStats_->totalQDepth -= curQDepth_;
+    qDepthStats_->numContexts--;
+  }
+}
+
+void AsyncIoContext::adaptQDepth(std::chrono::nanoseconds latency) {
+  if (targetLatencyUs_ == 0) {
+    return;
+  }
+  windowLatencyNs_ += latency.count();
+  if (++windowNumIos_ < curQDepth_) {
+    return;
+  }
+  const auto avgLatencyUs = windowLatencyNs_ / windowNumIos_ / 1000;
+  if (avgLatencyUs > targetLatencyUs_) {
+    if (curQDepth_ > 1) {
+      setQDepth(curQDepth_ / 2);
+      qDepthStats_->decreases.inc();
+    }
+  } else if (windowQDepthLimited_ && curQDepth_ < qDepth_) {
+    setQDepth(curQDepth_ + 1);
+    qDepthStats_->increases.inc();
+    // The new slot is free now
+    wakeUpQDepthWaiter();
+  }
+  windowLatencyNs_ = 0;
+  windowNumIos_ = 0;
+  windowQDepthLimited_ = false;
+}
+
+void AsyncIoContext::setQDepth(size_t qDepth) {
+  qDepthStats_->totalQDepth += qDepth;
+  qDepthStats_->totalQDepth -= curQDepth_;
+  curQDepth_ = qDepth;
+}
+
+void AsyncIoContext::registerBuffers(uint32_t bufferSize) {
+#ifndef CACHELIB_IOURING_DISABLE
+  std::vector<struct iovec> iovecs;
+  registeredBuffers_.reserve(qDepth_);
+  for (size_t i = 0; i < qDepth_; i++) {
+    // Page aligned, since the kernel pins whole pages
+    registeredBuffers_.emplace_back(bufferSize, 4096);
+    iovecs.push_back({registeredBuffers_.back().data(), bufferSize});
+  }
+  auto ret = static_cast<folly::IoUring*>(asyncBase_.get())
+                 ->register_buffers(iovecs.data(), iovecs.size());
+  if (ret < 0) {
+    XLOGF(ERR, "[{}] Failed to register {} buffers of {} bytes: {}", getName(),
+          iovecs.size(), bufferSize, ret);
+    registeredBuffers_.clear();
+    return;
+  }
+  for (uint32_t i = 0; i < registeredBuffers_.size(); i++) {
+    freeRegisteredBuffers_.push_back(i);
+  }
+#endif
 }
 
 void AsyncIoContext::pollCompletion() {
@@ -811,6 +1419,19 @@ void AsyncIoContext::pollCompletion() {
   handleCompletion(completed);
 }
 
+void AsyncIoContext::pollBeforeWait(folly::fibers::Baton& baton) {
+  if (completionPollUs_ == 0 || !compHandler_) {
+    return;
+  }
+  // The completions reaped here post the batons of the other fibers of this
+  // thread too, so they don't wait for the event loop either
+  const auto deadline =
+      getSteadyClock() + std::chrono::microseconds(completionPollUs_);
+  while (!baton.ready() && getSteadyClock() < deadline) {
+    pollCompletion();
+  }
+}
+
 void AsyncIoContext::handleCompletion(
     folly::Range<folly::AsyncBaseOp**>& completed) {
   for (auto op : completed) {
@@ -824,6 +1445,12 @@ void AsyncIoContext::handleCompletion(
     XDCHECK_GE(numOutstanding_, 0u);
     numOutstanding_--;
     numCompleted_++;
+    if (qDepthPerFile_ > 0) {
+      XDCHECK_GT(fileQueues_[iop->fileIdx_]->numOutstanding, 0u);
+      fileQueues_[iop->fileIdx_]->numOutstanding--;
+    }
+
+    releaseRegisteredBuffer(*iop, aop->result());
 
     // handle retry
     if (aop->result() == -EAGAIN && iop->resubmitted_ < retryLimit_) {
@@ -846,29 +1473,78 @@ void AsyncIoContext::handleCompletion(
       // 0 means success here, so get the completed size from iop
       len = !len ? iop->size_ : 0;
     }
+    const auto fileIdx = iop->fileIdx_;
+    adaptQDepth(getSteadyClock() - iop->submitTime_);
     iop->done(len);
 
-    if (!waitList_.empty()) {
-      auto& waiter = waitList_.front();
-      waitList_.pop_front();
+    wakeUpWaiter(fileIdx);
+  }
+}
+
+void AsyncIoContext::wakeUpWaiter(uint32_t fileIdx) {
+  if (qDepthPerFile_ > 0) {
+    auto& fileQueue = *fileQueues_[fileIdx];
+    if (!fileQueue.waitList.empty()) {
+      auto& waiter = fileQueue.waitList.front();
+      fileQueue.waitList.pop_front();
       waiter.baton_.post();
     }
   }
+
+  wakeUpQDepthWaiter();
 }
 
-bool AsyncIoContext::submitIo(IOOp& op) {
-  op.startTime_ = getSteadyClock();
+void AsyncIoContext::wakeUpQDepthWaiter() {
+  auto& waitList = waitList_.empty() ? lowPriWaitList_ : waitList_;
+  if (!waitList.empty()) {
+    auto& waiter = waitList.front();
+    waitList.pop_front();
+    waiter.baton_.post();
+  }
+}
 
-  while (numOutstanding_ >= qDepth_) {
-    if (qDepth_ > 1) {
+void AsyncIoContext::addFileOutstanding(uint32_t fileIdx) {
+  if (qDepthPerFile_ == 0) {
+    return;
+  }
+  while (fileQueues_.size() <= fileIdx) {
+    fileQueues_.push_back(std::make_unique<FileQueue>());
+  }
+  fileQueues_[fileIdx]->numOutstanding++;
+}
+
+void AsyncIoContext::waitForQueueSpace(uint32_t fileIdx) {
+  const bool lowPri = getCurrentRequestPriority() == RequestPriority::Low;
+  while (true) {
+    if (isFileQueueFull(fileIdx)) {
+      // Only the IOs on this file wait, the others go ahead of them
+      Waiter waiter;
+      fileQueues_[fileIdx]->waitList.push_back(waiter);
+      waiter.baton_.wait();
+      continue;
+    }
+    // A low priority IO also yields the free space to the high priority ones
+    // that have been woken up but did not submit yet
+    if (numOutstanding_ < curQDepth_ && !(lowPri && !waitList_.empty())) {
+      break;
+    }
+    windowQDepthLimited_ = true;
+    // Below the capacity the adapted qdepth is expected to be reached
+    if (qDepth_ > 1 && !lowPri && curQDepth_ == qDepth_) {
       XLOG_EVERY_MS(ERR, 10000) << fmt::format(
           "[{}] the number of outstanding requests {} exceeds the limit {}",
           getName(), numOutstanding_, qDepth_);
     }
     Waiter waiter;
-    waitList_.push_back(waiter);
+    (lowPri ? lowPriWaitList_ : waitList_).push_back(waiter);
     waiter.baton_.wait();
   }
+}
+
+bool AsyncIoContext::submitIo(IOOp& op) {
+  op.startTime_ = getSteadyClock();
+
+  waitForQueueSpace(op.fileIdx_);
 
   op.submitTime_ = getSteadyClock();
   std::unique_ptr<folly::AsyncBaseOp> asyncOp;
@@ -878,6 +1554,7 @@ bool AsyncIoContext::submitIo(IOOp& op) {
 
   numOutstanding_++;
   numSubmitted_++;
+  addFileOutstanding(op.fileIdx_);
 
   if (!compHandler_) {
     // Wait completion synchronously if completion handler is not available.
@@ -889,10 +1566,55 @@ bool AsyncIoContext::submitIo(IOOp& op) {
   return true;
 }
 
+void AsyncIoContext::submitIoBatch(folly::Range<IOOp**> ops) {
+  if (!compHandler_ || ops.size() == 1) {
+    // Without the completion handler, each IO is waited for synchronously
+    IoContext::submitIoBatch(ops);
+    return;
+  }
+
+  for (auto* op : ops) {
+    op->startTime_ = getSteadyClock();
+  }
+
+  while (!ops.empty()) {
+    waitForQueueSpace(ops[0]->fileIdx_);
+
+    // Submit up to the free qdepth, stopping at an op whose file is full
+    const auto maxOps = std::min(ops.size(), curQDepth_ - numOutstanding_);
+    std::vector<folly::AsyncBaseOp*> asyncOps;
+    asyncOps.reserve(maxOps);
+    for (auto* op : ops.subpiece(0, maxOps)) {
+      if (!asyncOps.empty() && isFileQueueFull(op->fileIdx_)) {
+        break;
+      }
+      op->submitTime_ = getSteadyClock();
+      auto asyncOp = prepAsyncIo(*op);
+      asyncOp->setUserData(op);
+      asyncOps.push_back(asyncOp.release());
+      addFileOutstanding(op->fileIdx_);
+    }
+    const auto numOps = asyncOps.size();
+    // There is room in the queue for all of them, so the submission should
+    // not come up short
+    auto numSubmitted = asyncBase_->submit(folly::range(asyncOps));
+    XCHECK_EQ(numSubmitted, numOps);
+
+    numOutstanding_ += numOps;
+    numSubmitted_ += numOps;
+    ops.advance(numOps);
+  }
+}
+
 std::unique_ptr<folly::AsyncBaseOp> AsyncIoContext::prepAsyncIo(IOOp& op) {
   if (fdpNvmeVec_.size() > 0) {
     return prepNvmeIo(op);
   }
+  if (!freeRegisteredBuffers_.empty()) {
+    if (auto asyncOp = prepFixedIo(op)) {
+      return asyncOp;
+    }
+  }
 
   std::unique_ptr<folly::AsyncBaseOp> asyncOp;
   IOReq& req = op.parent_;
@@ -939,6 +1661,53 @@ std::unique_ptr<folly::AsyncBaseOp> AsyncIoContext::prepNvmeIo(IOOp& op) {
 #endif
 }
 
+std::unique_ptr<folly::AsyncBaseOp> AsyncIoContext::prepFixedIo(IOOp& op) {
+#ifndef CACHELIB_IOURING_DISABLE
+  XDCHECK(!freeRegisteredBuffers_.empty());
+  XDCHECK_EQ(op.registeredBufferIdx_, -1);
+  const auto idx = freeRegisteredBuffers_.back();
+  auto& buffer = registeredBuffers_[idx];
+  if (op.size_ > buffer.size()) {
+    return nullptr;
+  }
+  freeRegisteredBuffers_.pop_back();
+  op.registeredBufferIdx_ = static_cast<int>(idx);
+
+  IOReq& req = op.parent_;
+  auto& options = static_cast<folly::IoUring*>(asyncBase_.get())->getOptions();
+  auto iouringOp = std::make_unique<folly::IoUringOp>(
+      folly::AsyncBaseOp::NotificationCallback(), options);
+  iouringOp->initBase();
+  struct io_uring_sqe& sqe = iouringOp->getSqe();
+  if (req.opType_ == OpType::READ) {
+    io_uring_prep_read_fixed(&sqe, op.fd_, buffer.data(), op.size_,
+                             op.offset_, static_cast<int>(idx));
+  } else {
+    XDCHECK_EQ(req.opType_, OpType::WRITE);
+    std::memcpy(buffer.data(), op.data_, op.size_);
+    io_uring_prep_write_fixed(&sqe, op.fd_, buffer.data(), op.size_,
+                              op.offset_, static_cast<int>(idx));
+  }
+  io_uring_sqe_set_data(&sqe, iouringOp.get());
+  return std::move(iouringOp);
+#else
+  return nullptr;
+#endif
+}
+
+void AsyncIoContext::releaseRegisteredBuffer(IOOp& op, ssize_t len) {
+  if (op.registeredBufferIdx_ < 0) {
+    return;
+  }
+  const auto idx = static_cast<uint32_t>(op.registeredBufferIdx_);
+  if (op.parent_.opType_ == OpType::READ && len > 0) {
+    std::memcpy(op.data_, registeredBuffers_[idx].data(),
+                std::min<size_t>(len, op.size_));
+  }
+  op.registeredBufferIdx_ = -1;
+  freeRegisteredBuffers_.push_back(idx);
+}
+
 /*
  * FileDevice
  */
@@ -951,17 +1720,22 @@ FileDevice::FileDevice(std::vector<folly::File>&& fvec,
                        uint32_t maxDeviceWriteSize,
                        IoEngine ioEngine,
                        uint32_t qDepthPerContext,
-                       std::shared_ptr<DeviceEncryptor> encryptor)
+                       std::shared_ptr<DeviceEncryptor> encryptor,
+                       uint32_t readAlignSize,
+                       AsyncIoOptions asyncIoOptions)
     : Device(fileSize * fvec.size(),
              std::move(encryptor),
              blockSize,
              maxIOSize,
-             maxDeviceWriteSize),
+             maxDeviceWriteSize,
+             readAlignSize),
       fvec_(std::move(fvec)),
       fdpNvmeVec_(std::move(fdpNvmeVec)),
       stripeSize_(stripeSize),
+      fileStates_(std::make_unique<FileState[]>(fvec_.size())),
       ioEngine_(ioEngine),
-      qDepthPerContext_(qDepthPerContext) {
+      qDepthPerContext_(qDepthPerContext),
+      asyncIoOptions_(std::move(asyncIoOptions)) {
   XDCHECK_GT(blockSize, 0u);
   if (fvec_.size() > 1) {
     XDCHECK_GT(stripeSize_, 0u);
@@ -998,28 +1772,139 @@ FileDevice::FileDevice(std::vector<folly::File>&& fvec,
       fdpNvmeVec_.size());
 }
 
+void FileDevice::trackIOOp(OpType opType,
+                           uint32_t fileIdx,
+                           bool result,
+                           double latencyUs) {
+  const bool isRead = opType == OpType::READ;
+  (isRead ? readIOOpDeviceLatencyEstimator_ : writeIOOpDeviceLatencyEstimator_)
+      .trackValue(latencyUs);
+  if (fvec_.size() <= 1) {
+    return;
+  }
+  auto& state = fileStates_[fileIdx];
+  (isRead ? state.readLatency : state.writeLatency).trackValue(latencyUs);
+  if (!result) {
+    state.ioErrors.inc();
+  }
+}
+
+bool FileDevice::setMemberDegraded(uint32_t idx, bool degraded) {
+  if (fvec_.size() <= 1 || idx >= fvec_.size()) {
+    return false;
+  }
+  if (fileStates_[idx].degraded.exchange(degraded) != degraded) {
+    numDegraded_.fetch_add(degraded ? 1 : -1);
+    XLOGF(INFO, "File {} of the device marked {}", idx,
+          degraded ? "degraded" : "healthy");
+  }
+  return true;
+}
+
+bool FileDevice::isDegraded(uint64_t offset, uint32_t size) const {
+  if (numDegraded_.load() == 0 || size == 0) {
+    return false;
+  }
+  const uint64_t firstStripe = offset / stripeSize_;
+  const uint64_t lastStripe = (offset + size - 1) / stripeSize_;
+  const uint64_t numStripes =
+      std::min<uint64_t>(lastStripe - firstStripe + 1, fvec_.size());
+  for (uint64_t i = 0; i < numStripes; i++) {
+    if (fileStates_[(firstStripe + i) % fvec_.size()].degraded.load()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FileDevice::getCountersImpl(const CounterVisitor& visitor) const {
+  if (asyncIoOptions_.qDepthTargetLatencyUs > 0) {
+    const auto numContexts = qDepthStats_.numContexts.load();
+    visitor("navy_device_adaptive_qdepth",
+            numContexts
+                ? static_cast<double>(qDepthStats_.totalQDepth.load()) /
+                      numContexts
+                : qDepthPerContext_);
+    visitor("navy_device_qdepth_increases", qDepthStats_.increases.get(),
+            CounterVisitor::CounterType::RATE);
+    visitor("navy_device_qdepth_decreases", qDepthStats_.decreases.get(),
+            CounterVisitor::CounterType::RATE);
+  }
+  if (fvec_.size() <= 1) {
+    return;
+  }
+  for (uint32_t i = 0; i < fvec_.size(); i++) {
+    const auto prefix = fmt::format("navy_device_file{}_", i);
+    auto& state = fileStates_[i];
+    state.readLatency.visitQuantileEstimator(visitor,
+                                             prefix + "read_latency_us");
+    state.writeLatency.visitQuantileEstimator(visitor,
+                                              prefix + "write_latency_us");
+    visitor(prefix + "io_errors", state.ioErrors.get(),
+            CounterVisitor::CounterType::RATE);
+    visitor(prefix + "degraded", state.degraded.load() ? 1 : 0);
+  }
+}
+
 bool FileDevice::readImpl(uint64_t offset, uint32_t size, void* value) {
-  auto trackIOOpDeviceLatency = [this](double value) {
-    readIOOpDeviceLatencyEstimator_.trackValue(value);
+  auto onIOOpDone = [this](uint32_t fileIdx, bool result, double latencyUs) {
+    trackIOOp(OpType::READ, fileIdx, result, latencyUs);
   };
   auto req = getIoContext()->submitRead(fvec_, stripeSize_, offset, size, value,
-                                        std::move(trackIOOpDeviceLatency));
+                                        std::move(onIOOpDone));
   return req->waitCompletion();
 }
 
+void FileDevice::readBatchImpl(folly::Range<IORead*> reads) {
+  auto onIOOpDone = [this](uint32_t fileIdx, bool result, double latencyUs) {
+    trackIOOp(OpType::READ, fileIdx, result, latencyUs);
+  };
+  auto* ioContext = getIoContext();
+  std::vector<std::shared_ptr<IOReq>> reqs;
+  reqs.reserve(reads.size());
+  for (const auto& read : reads) {
+    reqs.push_back(std::make_shared<IOReq>(
+        *ioContext, fvec_, stripeSize_, OpType::READ, read.offset, read.size,
+        read.value, onIOOpDone));
+  }
+  ioContext->submitReqBatch(reqs);
+  for (size_t i = 0; i < reads.size(); i++) {
+    reads[i].result = reqs[i]->waitCompletion();
+  }
+}
+
 bool FileDevice::writeImpl(uint64_t offset,
                            uint32_t size,
                            const void* value,
                            int placeHandle) {
-  auto trackIOOpDeviceLatency = [this](double value) {
-    writeIOOpDeviceLatencyEstimator_.trackValue(value);
+  auto onIOOpDone = [this](uint32_t fileIdx, bool result, double latencyUs) {
+    trackIOOp(OpType::WRITE, fileIdx, result, latencyUs);
   };
-  auto req = getIoContext()->submitWrite(
-      fvec_, stripeSize_, offset, size, value,
-      std::move(trackIOOpDeviceLatency), placeHandle);
+  auto req =
+      getIoContext()->submitWrite(fvec_, stripeSize_, offset, size, value,
+                                  std::move(onIOOpDone), placeHandle);
   return req->waitCompletion();
 }
 
+void FileDevice::writeBatchImpl(folly::Range<IOWrite*> writes,
+                                int placeHandle) {
+  auto onIOOpDone = [this](uint32_t fileIdx, bool result, double latencyUs) {
+    trackIOOp(OpType::WRITE, fileIdx, result, latencyUs);
+  };
+  auto* ioContext = getIoContext();
+  std::vector<std::shared_ptr<IOReq>> reqs;
+  reqs.reserve(writes.size());
+  for (const auto& write : writes) {
+    reqs.push_back(std::make_shared<IOReq>(
+        *ioContext, fvec_, stripeSize_, OpType::WRITE, write.offset,
+        write.size, const_cast<void*>(write.value), onIOOpDone, placeHandle));
+  }
+  ioContext->submitReqBatch(reqs);
+  for (size_t i = 0; i < writes.size(); i++) {
+    writes[i].result = reqs[i]->waitCompletion();
+  }
+}
+
 void FileDevice::flushImpl() {
   for (const auto& f : fvec_) {
     ::fsync(f.fd());
@@ -1077,9 +1962,14 @@ IoContext* FileDevice::getIoContext() {
     }
 
     auto idx = incrementalIdx_++;
+    if (onFiber && !asyncIoOptions_.cpus.empty()) {
+      pinCurrentThread(
+          asyncIoOptions_.cpus[idx % asyncIoOptions_.cpus.size()]);
+    }
     tlContext_.reset(new AsyncIoContext(std::move(asyncBase), idx, evb,
                                         qDepthPerContext_, useIoUring,
-                                        fdpNvmeVec_));
+                                        fdpNvmeVec_, asyncIoOptions_,
+                                        &qDepthStats_));
 
     {
       // Keep pointers in a vector to ease the gdb debugging
@@ -1190,14 +2080,54 @@ folly::File openCacheFile(const std::string& fileName,
 
   return f;
 }
+
+// Returns the smallest alignment all of @fVec can be read at with direct IO,
+// at most @blockSize. That's the logical block size of a block device, or the
+// direct IO offset alignment of a regular file where the kernel reports it.
+// Falls back to @blockSize when it can't be detected.
+uint32_t detectReadAlignSize(const std::vector<folly::File>& fVec,
+                             uint32_t blockSize) {
+  uint32_t readAlignSize = 0;
+  for (const auto& f : fVec) {
+    uint32_t fileAlignSize = blockSize;
+    struct stat fileStat;
+    if (fstat(f.fd(), &fileStat) == 0 && S_ISBLK(fileStat.st_mode)) {
+#ifdef BLKSSZGET
+      int logicalBlockSize = 0;
+      if (::ioctl(f.fd(), BLKSSZGET, &logicalBlockSize) == 0 &&
+          logicalBlockSize > 0) {
+        fileAlignSize = static_cast<uint32_t>(logicalBlockSize);
+      }
+#endif
+    } else {
+#ifdef STATX_DIOALIGN
+      struct statx fileStatx;
+      if (::statx(f.fd(), "", AT_EMPTY_PATH, STATX_DIOALIGN, &fileStatx) ==
+              0 &&
+          (fileStatx.stx_mask & STATX_DIOALIGN) &&
+          fileStatx.stx_dio_offset_align > 0) {
+        fileAlignSize = fileStatx.stx_dio_offset_align;
+      }
+#endif
+    }
+    readAlignSize = std::max(readAlignSize, fileAlignSize);
+  }
+  if (readAlignSize == 0 || !folly::isPowTwo(readAlignSize) ||
+      readAlignSize > blockSize) {
+    return blockSize;
+  }
+  return readAlignSize;
+}
 } // namespace
 
 std::unique_ptr<Device> createMemoryDevice(
     uint64_t size,
     std::shared_ptr<DeviceEncryptor> encryptor,
-    uint32_t ioAlignSize) {
+    uint32_t ioAlignSize,
+    uint32_t readAlignSize,
+    const MemoryDeviceEmulationConfig& emulation) {
   return std::make_unique<MemoryDevice>(size, std::move(encryptor),
-                                        ioAlignSize);
+                                        ioAlignSize, readAlignSize, emulation);
 }
 
 std::unique_ptr<Device> createDirectIoFileDevice(
@@ -1210,22 +2140,32 @@ std::unique_ptr<Device> createDirectIoFileDevice(
     IoEngine ioEngine,
     uint32_t qDepthPerContext,
     bool isFDPEnabled,
-    std::shared_ptr<DeviceEncryptor> encryptor) {
+    std::shared_ptr<DeviceEncryptor> encryptor,
+    bool subPageReads,
+    AsyncIoOptions asyncIoOptions) {
   XDCHECK(folly::isPowTwo(blockSize));
 
   uint32_t maxIOSize = maxDeviceWriteSize;
   std::vector<std::shared_ptr<FdpNvme>> fdpNvmeVec{};
 #ifndef CACHELIB_IOURING_DISABLE
-  if (isFDPEnabled) {
+  // NVMe passthrough IO is submitted as io_uring commands
+  const bool nvmePassthrough = asyncIoOptions.nvmePassthrough &&
+                               ioEngine == IoEngine::IoUring &&
+                               qDepthPerContext > 0;
+  if (asyncIoOptions.nvmePassthrough && !nvmePassthrough) {
+    XLOG(ERR) << "NVMe passthrough needs async io_uring IO; ignored";
+  }
+  if (isFDPEnabled || nvmePassthrough) {
     try {
       if (filePaths.size() > 1) {
         throw std::invalid_argument(folly::sformat(
-            "{} input files; but FDP mode does not support RAID files yet",
+            "{} input files; but FDP and NVMe passthrough modes do not "
+            "support RAID files yet",
             filePaths.size()));
       }
 
       for (const auto& path : filePaths) {
-        auto fdpNvme = std::make_shared<FdpNvme>(path);
+        auto fdpNvme = std::make_shared<FdpNvme>(path, isFDPEnabled);
 
         auto maxDevIOSize = fdpNvme->getMaxIOSize();
         if (maxDevIOSize != 0u &&
@@ -1236,8 +2176,8 @@ std::unique_ptr<Device> createDirectIoFileDevice(
         fdpNvmeVec.push_back(std::move(fdpNvme));
       }
     } catch (const std::exception& e) {
-      XLOGF(ERR, "NVMe FDP mode could not be enabled {}, Errno: {}", e.what(),
-            errno);
+      XLOGF(ERR, "NVMe {} mode could not be enabled {}, Errno: {}",
+            isFDPEnabled ? "FDP" : "passthrough", e.what(), errno);
       fdpNvmeVec.clear();
       maxIOSize = 0u;
     }
@@ -1248,6 +2188,14 @@ std::unique_ptr<Device> createDirectIoFileDevice(
     maxDeviceWriteSize = std::min<size_t>(maxDeviceWriteSize, maxIOSize);
   }
 
+  // Encrypted blocks can only be decrypted as a whole
+  uint32_t readAlignSize = blockSize;
+  if (subPageReads && !encryptor) {
+    readAlignSize = detectReadAlignSize(fVec, blockSize);
+    XLOGF(INFO, "Reading at {} byte alignment, block size {}", readAlignSize,
+          blockSize);
+  }
+
   return std::make_unique<FileDevice>(std::move(fVec),
                                       std::move(fdpNvmeVec),
                                       fileSize,
@@ -1257,7 +2205,9 @@ std::unique_ptr<Device> createDirectIoFileDevice(
                                       maxDeviceWriteSize,
                                       ioEngine,
                                       qDepthPerContext,
-                                      encryptor);
+                                      encryptor,
+                                      readAlignSize,
+                                      std::move(asyncIoOptions));
 }
 
 std::unique_ptr<Device> createDirectIoFileDevice(
@@ -1290,7 +2240,9 @@ std::unique_ptr<Device> createFileDevice(
     uint32_t qDepth,
     bool isFDPEnabled,
     std::shared_ptr<navy::DeviceEncryptor> encryptor,
-    bool isExclusiveOwner) {
+    bool isExclusiveOwner,
+    bool subPageReads,
+    AsyncIoOptions asyncIoOptions) {
   // File paths are opened in the increasing order of the
   // path string. This ensures that RAID0 stripes aren't
   // out of order even if the caller changes the order of
@@ -1321,6 +2273,8 @@ std::unique_ptr<Device> createFileDevice(
                                   ioEngine,
                                   qDepth,
                                   isFDPEnabled,
-                                  std::move(encryptor));
+                                  std::move(encryptor),
+                                  subPageReads,
+                                  std::move(asyncIoOptions));
 }
 } // namespace facebook::cachelib::navy
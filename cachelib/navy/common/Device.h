@@ -17,12 +17,14 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Range.h>
 #include <folly/io/IOBuf.h>
 
 #include "cachelib/allocator/nvmcache/NavyConfig.h"
 #include "cachelib/common/AtomicCounter.h"
 #include "cachelib/common/PercentileStats.h"
 #include "cachelib/navy/common/Buffer.h"
+#include "cachelib/navy/common/IoBudget.h"
 #include "cachelib/navy/common/Types.h"
 #include "cachelib/navy/common/Utils.h"
 
@@ -51,6 +53,24 @@ class DeviceEncryptor {
   // @param salt    this must be the same earlier used for encryption
   // @return        true if success, false otherwise
   virtual bool decrypt(folly::MutableByteRange value, uint64_t salt) = 0;
+
+  // A payload of a batch passed to encryptBatch or decryptBatch
+  struct Payload {
+    folly::MutableByteRange value;
+    uint64_t salt{0};
+    // Set by encryptBatch or decryptBatch
+    bool result{false};
+  };
+
+  // Encrypts all of @payloads as encrypt would, setting their results.
+  // Implementations can process them together, e.g. with multi-buffer
+  // kernels or an offload engine. By default, they are encrypted one after
+  // another.
+  virtual void encryptBatch(folly::Range<Payload*> payloads);
+
+  // Decrypts all of @payloads as decrypt would, setting their results. By
+  // default, they are decrypted one after another.
+  virtual void decryptBatch(folly::Range<Payload*> payloads);
 };
 
 // Device abstraction
@@ -93,13 +113,17 @@ class Device {
   // @param ioAlignSize   alignment size for IO operations
   // @param maxIOSize     max device IO size
   // @param maxWriteSize  max device write size
+  // @param readAlignSize alignment size for reads, a power of two dividing
+  //                      @ioAlignSize. 0 to read at @ioAlignSize.
   Device(uint64_t size,
          std::shared_ptr<DeviceEncryptor> encryptor,
          uint32_t ioAlignSize,
          uint32_t maxIOSize,
-         uint32_t maxWriteSize)
+         uint32_t maxWriteSize,
+         uint32_t readAlignSize = 0)
       : size_(size),
         ioAlignmentSize_{ioAlignSize},
+        readAlignmentSize_{readAlignSize == 0 ? ioAlignSize : readAlignSize},
         maxIOSize_(maxIOSize),
         maxWriteSize_(maxWriteSize),
         encryptor_{std::move(encryptor)} {
@@ -121,6 +145,17 @@ class Device {
           folly::sformat("Invalid max io size {} ioAlignSize {}", maxIOSize_,
                          ioAlignmentSize_));
     }
+    if (!folly::isPowTwo(readAlignmentSize_) ||
+        ioAlignmentSize_ % readAlignmentSize_ != 0) {
+      throw std::invalid_argument(
+          folly::sformat("Invalid readAlignSize {} ioAlignSize {}",
+                         readAlignmentSize_, ioAlignmentSize_));
+    }
+    if (encryptor_ && readAlignmentSize_ != ioAlignmentSize_) {
+      throw std::invalid_argument(folly::sformat(
+          "Invalid readAlignSize {} encryption block size {}",
+          readAlignmentSize_, encryptor_->encryptionBlockSize()));
+    }
   }
   virtual ~Device() = default;
 
@@ -150,6 +185,19 @@ class Device {
   // Allocate a new stream and return the handle for Placement capable devices.
   virtual int allocatePlacementHandle() = 0;
 
+  // Marks member @idx of a device made of several, e.g. the files of a RAID0
+  // device, degraded or healthy again. Engines move their writes away from
+  // degraded members where they can, the data on them is still read.
+  // Returns false if the device has no such member.
+  virtual bool setMemberDegraded(uint32_t /* idx */, bool /* degraded */) {
+    return false;
+  }
+
+  // Returns whether any of [@offset, @offset + @size) is on a degraded member
+  virtual bool isDegraded(uint64_t /* offset */, uint32_t /* size */) const {
+    return false;
+  }
+
   // Reads @size bytes from device at @deviceOffset and copys to @value
   // There must be sufficient space allocated already in the mutableView.
   // @offset and @size must be ioAligmentSize_ aligned
@@ -158,12 +206,26 @@ class Device {
   bool read(uint64_t offset, uint32_t size, void* value);
 
   // Reads @size bytes from device at @deviceOffset into a Buffer allocated
-  // If the offset is not aligned or size is not aligned for device IO
+  // If the offset is not aligned or size is not aligned for device read
   // alignment, they both are aligned to do the read operation successfully
   // from the device and then Buffer is adjusted to return only the size
   // bytes from offset.
   Buffer read(uint64_t offset, uint32_t size);
 
+  // A read in a batch passed to readBatch. @offset and @size do not need to
+  // be aligned, same as for read(offset, size).
+  struct BatchRead {
+    uint64_t offset{0};
+    uint32_t size{0};
+    // Filled by readBatch. Null if the read failed.
+    Buffer buffer;
+  };
+
+  // Reads every entry of @reads into its buffer as read(offset, size) would.
+  // Devices that can keep multiple IOs in flight submit all the reads before
+  // waiting for any of them to complete.
+  void readBatch(folly::Range<BatchRead*> reads);
+
   // Everything should be on device after this call returns.
   void flush() { flushImpl(); }
 
@@ -173,6 +235,15 @@ class Device {
   // Return bytes read since device start
   uint64_t getBytesRead() const { return bytesRead_.get(); }
 
+  // Share the bandwidth of the device between the classes of IO. The engines
+  // charge their IOs to the budget before issuing them.
+  void setIoBudget(std::shared_ptr<IoBudget> ioBudget) {
+    ioBudget_ = std::move(ioBudget);
+  }
+
+  // Returns the IO budget of the device, null if it has none
+  IoBudget* getIoBudget() const { return ioBudget_.get(); }
+
   // Export device stats via CounterVisitor
   void getCounters(const CounterVisitor& visitor) const;
 
@@ -182,6 +253,11 @@ class Device {
   // Returns the alignment size for device io operations
   uint32_t getIOAlignmentSize() const { return ioAlignmentSize_; }
 
+  // Returns the alignment size of the reads through read(offset, size) and
+  // readBatch. It divides the IO alignment size and may be smaller than it,
+  // e.g. the 512 byte logical block size of a device written in 4KB blocks.
+  uint32_t getReadAlignmentSize() const { return readAlignmentSize_; }
+
  protected:
   virtual bool writeImpl(uint64_t offset,
                          uint32_t size,
@@ -190,6 +266,40 @@ class Device {
   virtual bool readImpl(uint64_t offset, uint32_t size, void* value) = 0;
   virtual void flushImpl() = 0;
 
+  // An aligned read in a batch passed to readBatchImpl
+  struct IORead {
+    uint64_t offset{0};
+    uint32_t size{0};
+    void* value{nullptr};
+    // Set by readBatchImpl
+    bool result{false};
+  };
+
+  // Reads all of @reads, setting their results. By default, they are read
+  // one after another through readImpl.
+  virtual void readBatchImpl(folly::Range<IORead*> reads);
+
+  // An aligned chunk of a write passed to writeBatchImpl
+  struct IOWrite {
+    uint64_t offset{0};
+    uint32_t size{0};
+    const void* value{nullptr};
+    // Set by writeBatchImpl
+    bool result{false};
+  };
+
+  // Whether the chunks a write is split into by the max write size are
+  // passed to writeBatchImpl together instead of written one after another
+  virtual bool batchesWriteChunks() const { return false; }
+
+  // Writes all of @writes with @placeHandle, setting their results. By
+  // default, they are written one after another through writeImpl.
+  virtual void writeBatchImpl(folly::Range<IOWrite*> writes, int placeHandle);
+
+  // Exports the stats of the device implementation on top of the common ones.
+  // None by default.
+  virtual void getCountersImpl(const CounterVisitor& /* visitor */) const {}
+
   // This measures the latency of an individual read or write iop between its
   // submission and completion. Slowdowns in the kernel and the boundary between
   // kernel and userspace will negatively affect this latency metric. For
@@ -215,11 +325,20 @@ class Device {
 
   bool readInternal(uint64_t offset, uint32_t size, void* value);
 
+  void readBatchInternal(folly::Range<IORead*> reads);
+
   bool writeInternal(uint64_t offset,
                      const uint8_t* data,
                      size_t size,
                      int placeHandle = -1);
 
+  // Writes the chunks of a write through writeBatchImpl
+  bool writeChunksBatched(uint64_t offset,
+                          const uint8_t* data,
+                          size_t size,
+                          size_t chunkSize,
+                          int placeHandle);
+
   // size of the device. All offsets for write/read should be contained
   // below this.
   const uint64_t size_{0};
@@ -227,6 +346,9 @@ class Device {
   // alignment granularity for the offsets and size to read/write calls.
   const uint32_t ioAlignmentSize_{kDefaultAlignmentSize};
 
+  // alignment granularity of the reads that don't need to be IO aligned.
+  const uint32_t readAlignmentSize_{kDefaultAlignmentSize};
+
   // Some devices have this transfer size limit due to DMA size limitations.
   // This limit is applicable for both writes and reads.
   const uint32_t maxIOSize_{0};
@@ -240,16 +362,50 @@ class Device {
 
   std::shared_ptr<DeviceEncryptor> encryptor_;
 
+  std::shared_ptr<IoBudget> ioBudget_;
+
   static constexpr uint32_t kDefaultAlignmentSize{1};
 };
 
 // Default ioAlignSize size for Memory Device is 1. In our tests, we create
 // Devices with different ioAlignSize sizes using memory device. So we need
 // a way to set a different ioAlignSize size for memory devices.
+// @emulation makes the IOs of the memory device as slow as the ones of the
+// device it describes.
 std::unique_ptr<Device> createMemoryDevice(
     uint64_t size,
     std::shared_ptr<DeviceEncryptor> encryptor,
-    uint32_t ioAlignSize = 1);
+    uint32_t ioAlignSize = 1,
+    uint32_t readAlignSize = 0,
+    const MemoryDeviceEmulationConfig& emulation = {});
+
+// Options of the per thread async IO contexts of a file device
+struct AsyncIoOptions {
+  // Size of the buffers every io_uring context registers, one per queue
+  // depth. IOs up to this size are copied through them. 0 for none.
+  uint32_t registeredBufferSize{0};
+  // Microseconds a fiber waiting for its IO polls for completions before it
+  // yields to the event loop, saving the wakeup through the event loop for
+  // IOs completing within it. 0 to never poll.
+  uint32_t completionPollUs{0};
+  // CPUs to pin the threads running async IO contexts to, the context
+  // created i-th to cpus[i % cpus.size()]. Empty to leave them unpinned.
+  std::vector<uint32_t> cpus;
+  // Submit all reads and writes as NVMe commands through the NVMe character
+  // device of the file, bypassing the block layer. Needs io_uring and a
+  // single NVMe block device; ignored otherwise. Implied by FDP.
+  bool nvmePassthrough{false};
+  // Max IOs a context keeps outstanding on any one file of a RAID0 device,
+  // so that a slow file does not take up its whole qdepth. 0 for no limit.
+  uint32_t qDepthPerFile{0};
+  // Average IO latency in microseconds every context adapts its qdepth to,
+  // between 1 and the qdepth: halving it when the latency is above the target
+  // and growing it by one while it is within. 0 for the fixed qdepth.
+  uint32_t qDepthTargetLatencyUs{0};
+  // Submit the chunks a write is split into by the max device write size
+  // together and wait for all of them, rather than one chunk at a time.
+  bool batchWriteChunks{false};
+};
 
 // Creates a direct IO file device supporting RAID if multiple files are
 // provided. If qDepth = 0, sync IO will be used all the time
@@ -267,6 +423,9 @@ std::unique_ptr<Device> createMemoryDevice(
 //                              If 0, sync IO will be used
 // @param isFDPEnabled          Whether FDP placement mode is enabled or not.
 // @param encryptor             encryption object
+// @param subPageReads          read at the logical block size detected for
+//                              the file(s) if smaller than @blockSize
+// @param asyncIoOptions        options of the async IO contexts
 std::unique_ptr<Device> createDirectIoFileDevice(
     std::vector<folly::File> fVec,
     std::vector<std::string> filePaths,
@@ -277,7 +436,9 @@ std::unique_ptr<Device> createDirectIoFileDevice(
     IoEngine ioEngine,
     uint32_t qDepth,
     bool isFDPEnabled,
-    std::shared_ptr<DeviceEncryptor> encryptor);
+    std::shared_ptr<DeviceEncryptor> encryptor,
+    bool subPageReads = false,
+    AsyncIoOptions asyncIoOptions = {});
 
 // A convenient wrapper for creating Device with a sync IO
 //
@@ -309,6 +470,9 @@ std::unique_ptr<Device> createDirectIoFileDevice(
 // @param isFDPEnabled          whether FDP placement mode enabled or not
 // @param encryptor             encryption object
 // @param isExclusiveOwner      fail if not sole owner of the file
+// @param subPageReads          read at the logical block size detected for
+//                              the file(s) if smaller than @blockSize
+// @param asyncIoOptions        options of the async IO contexts
 std::unique_ptr<Device> createFileDevice(
     std::vector<std::string> filePaths,
     uint64_t fileSize,
@@ -320,7 +484,9 @@ std::unique_ptr<Device> createFileDevice(
     uint32_t qDepth,
     bool isFDPEnabled,
     std::shared_ptr<navy::DeviceEncryptor> encryptor,
-    bool isExclusiveOwner);
+    bool isExclusiveOwner,
+    bool subPageReads = false,
+    AsyncIoOptions asyncIoOptions = {});
 } // namespace navy
 } // namespace cachelib
 } // namespace facebook
@@ -29,9 +29,13 @@ namespace facebook {
 namespace cachelib {
 namespace navy {
 
-FdpNvme::FdpNvme(const std::string& bdevName)
-    : file_(openNvmeCharFile(bdevName)) {
+FdpNvme::FdpNvme(const std::string& bdevName, bool enableFdp)
+    : fdpEnabled_(enableFdp), file_(openNvmeCharFile(bdevName)) {
   nvmeData_ = readNvmeInfo(bdevName);
+  if (!fdpEnabled_) {
+    XLOGF(INFO, "Initialized NVMe passthrough Device on file: {}", bdevName);
+    return;
+  }
   Buffer buffer = nvmeFdpStatus();
   struct nvme_fdp_ruh_status* ruh_status =
       reinterpret_cast<struct nvme_fdp_ruh_status*>(buffer.data());
@@ -46,6 +50,9 @@ FdpNvme::FdpNvme(NvmeData& data, struct nvme_fdp_ruh_status* ruh_status)
 }
 
 int FdpNvme::allocateFdpHandle() {
+  if (!fdpEnabled_) {
+    return -1;
+  }
   uint16_t phndl;
 
   // Get NS specific Fdp Placement Handle(PHNDL)
@@ -187,6 +194,10 @@ void FdpNvme::prepWriteUringCmdSqe(
   static constexpr uint8_t kPlacementMode = 2;
   uint16_t pid;
 
+  if (!fdpEnabled_) {
+    prepFdpUringCmdSqe(sqe, buf, size, start, nvme_cmd_write, 0, 0);
+    return;
+  }
   if (handle == -1) {
     pid = getFdpPID(kDefaultPIDIdx); // Use the default stream
   } else if (handle >= 0 && handle <= maxPIDIdx_) {
@@ -136,7 +136,10 @@ class NvmeData {
 // as of now; and not supported through conventional block interfaces.
 class FdpNvme {
  public:
-  explicit FdpNvme(const std::string& fileName);
+  // @param enableFdp  whether to place writes with FDP directives. Without
+  //                   them, IO still goes through the NVMe character device
+  //                   (plain passthrough), bypassing the block layer.
+  explicit FdpNvme(const std::string& fileName, bool enableFdp = true);
 
   // This constructor allows user to experiment with FdpNvme without having the
   // actual FDP device. Ex: FDP Unit Tests
@@ -147,9 +150,13 @@ class FdpNvme {
 
 #ifndef CACHELIB_IOURING_DISABLE
   // Allocates an FDP specific placement handle. This handle will be
-  // interpreted by the device for data placement.
+  // interpreted by the device for data placement. Returns -1 if FDP is not
+  // enabled.
   int allocateFdpHandle();
 
+  // Whether writes are placed with FDP directives
+  bool isFdpEnabled() const { return fdpEnabled_; }
+
   // Get the max IO transfer size of NVMe device.
   uint32_t getMaxIOSize() { return nvmeData_.getMaxTfrSize(); }
 
@@ -165,7 +172,8 @@ class FdpNvme {
                            size_t size,
                            off_t start);
 
-  // Prepares the Uring_Cmd sqe for write command with FDP handle.
+  // Prepares the Uring_Cmd sqe for write command with FDP handle. The handle
+  // is ignored if FDP is not enabled.
   void prepWriteUringCmdSqe(struct io_uring_sqe& sqe,
                             void* buf,
                             size_t size,
@@ -207,6 +215,7 @@ class FdpNvme {
   // The mapping table of PHNDL: PID in a Namespace
   std::vector<uint16_t> placementIDs_{};
 
+  bool fdpEnabled_{true};
   uint16_t maxPIDIdx_{0};
   uint16_t nextPIDIdx_{kDefaultPIDIdx + 1};
   NvmeData nvmeData_{};
@@ -27,7 +27,9 @@ namespace navy {
 // Default hash function
 uint64_t hashBuffer(BufferView key, uint64_t seed = 0);
 
-// Default checksumming function
+// Default checksumming function: CRC32, computed with folly's hardware
+// accelerated implementation when the CPU supports it. Checksums are
+// persisted with the data, so the polynomial must not change.
 uint32_t checksum(BufferView data, uint32_t startingChecksum = 0);
 
 // Convenience utils to convert a piece of buffer to a hashed key
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/common/IoBudget.h"
+
+#include <folly/Format.h>
+#include <folly/fibers/Baton.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace facebook::cachelib::navy {
+namespace {
+const char* getIoClassName(size_t idx) {
+  static constexpr std::array<const char*, kNumIoClasses> kNames{
+      "user_read", "flush", "reclaim_read", "reinsertion"};
+  return kNames[idx];
+}
+} // namespace
+
+IoBudget::IoBudget(const IoBudgetConfig& config, std::chrono::nanoseconds now)
+    : lastRefill_{now} {
+  config.validate();
+  const std::array<uint32_t, kNumIoClasses> shares{
+      config.userReadShare, config.flushShare, config.reclaimReadShare,
+      config.reinsertionShare};
+  uint64_t totalShares = 0;
+  for (auto share : shares) {
+    totalShares += share;
+  }
+  const double bytesPerNs = static_cast<double>(config.bytesPerSec) / 1e9;
+  const double burstNs = static_cast<double>(config.burstMs) * 1e6;
+  for (size_t i = 0; i < kNumIoClasses; i++) {
+    auto& budget = classes_[i];
+    budget.rate = bytesPerNs * shares[i] / static_cast<double>(totalShares);
+    budget.capacity = budget.rate * burstNs;
+    budget.tokens = budget.capacity;
+  }
+  spareCapacity_ = bytesPerNs * burstNs;
+}
+
+void IoBudget::refillLocked(std::chrono::nanoseconds now) {
+  if (now <= lastRefill_) {
+    return;
+  }
+  const auto elapsedNs = static_cast<double>((now - lastRefill_).count());
+  lastRefill_ = now;
+  for (auto& budget : classes_) {
+    budget.tokens += budget.rate * elapsedNs;
+    if (budget.tokens > budget.capacity) {
+      spareTokens_ += budget.tokens - budget.capacity;
+      budget.tokens = budget.capacity;
+    }
+  }
+  spareTokens_ = std::min(spareTokens_, spareCapacity_);
+}
+
+double IoBudget::takeLocked(ClassBudget& budget, double bytes) {
+  if (budget.tokens > 0) {
+    const auto own = std::min(budget.tokens, bytes);
+    budget.tokens -= own;
+    bytes -= own;
+  }
+  const auto spare = std::min(spareTokens_, bytes);
+  spareTokens_ -= spare;
+  return bytes - spare;
+}
+
+std::chrono::nanoseconds IoBudget::reserve(IoClass ioClass,
+                                           uint64_t bytes,
+                                           std::chrono::nanoseconds now) {
+  auto& budget = classes_[static_cast<size_t>(ioClass)];
+  budget.bytes.add(bytes);
+  std::lock_guard<folly::fibers::TimedMutex> l{mutex_};
+  refillLocked(now);
+  const auto missing = takeLocked(budget, static_cast<double>(bytes));
+  if (missing <= 0) {
+    return std::chrono::nanoseconds{0};
+  }
+  // the class goes into debt and waits for its share to repay it
+  budget.tokens -= missing;
+  return std::chrono::nanoseconds{
+      static_cast<int64_t>(-budget.tokens / budget.rate)};
+}
+
+void IoBudget::acquire(IoClass ioClass, uint64_t bytes) {
+  const auto wait = reserve(ioClass, bytes, getSteadyClock());
+  if (wait.count() <= 0) {
+    return;
+  }
+  auto& budget = classes_[static_cast<size_t>(ioClass)];
+  budget.waits.inc();
+  budget.waitUs.add(
+      std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+  folly::fibers::Baton b;
+  b.try_wait_for(wait);
+}
+
+bool IoBudget::tryAcquire(IoClass ioClass,
+                          uint64_t bytes,
+                          std::chrono::nanoseconds now) {
+  auto& budget = classes_[static_cast<size_t>(ioClass)];
+  {
+    std::lock_guard<folly::fibers::TimedMutex> l{mutex_};
+    refillLocked(now);
+    if (std::max(budget.tokens, 0.0) + spareTokens_ <
+        static_cast<double>(bytes)) {
+      budget.rejections.inc();
+      return false;
+    }
+    takeLocked(budget, static_cast<double>(bytes));
+  }
+  budget.bytes.add(bytes);
+  return true;
+}
+
+void IoBudget::getCounters(const CounterVisitor& visitor) const {
+  for (size_t i = 0; i < kNumIoClasses; i++) {
+    const auto& budget = classes_[i];
+    const auto* name = getIoClassName(i);
+    visitor(folly::sformat("navy_io_budget_{}_bytes", name),
+            budget.bytes.get(), CounterVisitor::CounterType::RATE);
+    visitor(folly::sformat("navy_io_budget_{}_waits", name),
+            budget.waits.get(), CounterVisitor::CounterType::RATE);
+    visitor(folly::sformat("navy_io_budget_{}_wait_us", name),
+            budget.waitUs.get(), CounterVisitor::CounterType::RATE);
+    visitor(folly::sformat("navy_io_budget_{}_rejections", name),
+            budget.rejections.get(), CounterVisitor::CounterType::RATE);
+  }
+}
+} // namespace facebook::cachelib::navy
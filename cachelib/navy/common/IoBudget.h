@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/fibers/TimedMutex.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "cachelib/allocator/nvmcache/NavyConfig.h"
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/navy/common/Types.h"
+#include "cachelib/navy/common/Utils.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+
+// Classes of the IO Navy issues to the device
+enum class IoClass : uint8_t {
+  kUserRead = 0,
+  kFlush,
+  kReclaimRead,
+  kReinsertion,
+};
+constexpr size_t kNumIoClasses = 4;
+
+// Splits the bandwidth of a device between the classes of IO by their
+// shares. Every class is refilled at its share of the bandwidth into a bucket
+// holding up to burstMs of it. What overflows the bucket of a class that
+// does not use its share goes to a spare bucket that any class draws from
+// once its own is empty, so a class can use all the bandwidth the others
+// leave idle.
+//
+// A class over its budget goes into debt and its IO waits until its share
+// repays it, which queues the later IOs of the class behind it.
+class IoBudget {
+ public:
+  // @throw std::invalid_argument if the config is invalid
+  explicit IoBudget(const IoBudgetConfig& config,
+                    std::chrono::nanoseconds now = getSteadyClock());
+
+  // Charge @bytes of IO to @ioClass, waiting until the class is within its
+  // budget. Waits on a baton, so it only blocks the fiber on a fiber.
+  void acquire(IoClass ioClass, uint64_t bytes);
+
+  // Charge @bytes of IO to @ioClass if it is within its budget
+  //
+  // @return false if it is not, in which case nothing is charged
+  bool tryAcquire(IoClass ioClass,
+                  uint64_t bytes,
+                  std::chrono::nanoseconds now = getSteadyClock());
+
+  // Charge @bytes of IO to @ioClass at @now
+  //
+  // @return how long the IO needs to wait to stay within the budget
+  std::chrono::nanoseconds reserve(IoClass ioClass,
+                                   uint64_t bytes,
+                                   std::chrono::nanoseconds now);
+
+  // Exports the bytes, waits and rejections of every class
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  struct ClassBudget {
+    // refill rate in bytes per nanosecond
+    double rate{0};
+    double capacity{0};
+    // negative while the class is in debt
+    double tokens{0};
+
+    mutable AtomicCounter bytes;
+    mutable AtomicCounter waits;
+    mutable AtomicCounter waitUs;
+    mutable AtomicCounter rejections;
+  };
+
+  void refillLocked(std::chrono::nanoseconds now);
+
+  // Takes @bytes from the bucket of the class and then from the spare one
+  //
+  // @return bytes that could not be taken
+  double takeLocked(ClassBudget& budget, double bytes);
+
+  folly::fibers::TimedMutex mutex_;
+  std::array<ClassBudget, kNumIoClasses> classes_;
+  double spareTokens_{0};
+  double spareCapacity_{0};
+  std::chrono::nanoseconds lastRefill_{};
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
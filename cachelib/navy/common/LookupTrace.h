@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "cachelib/common/Time.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+
+// Timestamps of the stages of one sampled lookup, from the find that missed
+// DRAM to the item being inserted back into DRAM. The latency of a stage is
+// the time since the latest stage before it that the lookup went through, so
+// a lookup that is not found in the index or is served from memory only
+// skips the IO stages.
+//
+// The trace is passed along without changing the interfaces of the layers
+// it goes through: it is the current trace of the thread while NvmCache
+// enqueues the lookup and while the navy job runs it. A fiber running the
+// job can be suspended while it waits for a lock or an IO, and other jobs
+// make their own trace current meanwhile, so whoever stamps after a wait
+// makes its trace current again first (see setCurrent).
+class LookupTrace {
+ public:
+  enum Stage : uint8_t {
+    kStarted = 0,   // NvmCache started the find
+    kEnqueued,      // the lookup was enqueued to the navy scheduler
+    kDequeued,      // a navy worker started the lookup job
+    kIndexed,       // the block cache index was looked up
+    kIoStarted,     // the region was opened and the IO is being submitted
+    kIoSubmitted,   // the IO was submitted. Sync IO completes here.
+    kIoCompleted,   // the worker resumed after the IO completed
+    kChecksummed,   // the entry was verified and copied out
+    kCallback,      // NvmCache got the result of the lookup
+    kFilled,        // the item was inserted into DRAM
+    kNumStages
+  };
+
+  LookupTrace() { stamp(kStarted); }
+
+  void stamp(Stage stage) noexcept { times_[stage] = util::getCurrentTimeNs(); }
+
+  // @return the latency of the stage in nanoseconds, or 0 if the lookup did
+  //         not go through it
+  uint64_t getStageLatencyNs(Stage stage) const noexcept {
+    if (stage == kStarted || times_[stage] == 0) {
+      return 0;
+    }
+    for (int prev = stage - 1; prev >= 0; prev--) {
+      if (times_[prev] != 0) {
+        return times_[stage] > times_[prev] ? times_[stage] - times_[prev] : 0;
+      }
+    }
+    return 0;
+  }
+
+  // @return the name of the stage in stats
+  static const char* getStageName(Stage stage) noexcept {
+    static constexpr std::array<const char*, kNumStages> kNames{
+        "started",  "fill_map",  "queue",    "index",    "io_prepare",
+        "io_submit", "device",   "checksum", "callback", "dram_insert"};
+    return kNames[stage];
+  }
+
+  // @return the trace of the lookup the calling thread works on, nullptr if
+  //         it is not traced
+  static LookupTrace* current() noexcept { return current_; }
+
+  static void setCurrent(LookupTrace* trace) noexcept { current_ = trace; }
+
+  // stamp the trace of the calling thread, if any
+  static void stampCurrent(Stage stage) noexcept {
+    if (current_) {
+      current_->stamp(stage);
+    }
+  }
+
+ private:
+  static inline thread_local LookupTrace* current_{nullptr};
+
+  std::array<uint64_t, kNumStages> times_{};
+};
+
+// Makes a trace, possibly nullptr, the current one of the calling thread for
+// a scope
+class ScopedLookupTrace {
+ public:
+  explicit ScopedLookupTrace(LookupTrace* trace) {
+    LookupTrace::setCurrent(trace);
+  }
+  ~ScopedLookupTrace() { LookupTrace::setCurrent(nullptr); }
+
+  ScopedLookupTrace(const ScopedLookupTrace&) = delete;
+  ScopedLookupTrace& operator=(const ScopedLookupTrace&) = delete;
+};
+
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
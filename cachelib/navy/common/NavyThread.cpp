@@ -16,22 +16,68 @@
 
 #include "cachelib/navy/common/NavyThread.h"
 
+#include <folly/logging/xlog.h>
+#include <pthread.h>
+#include <sched.h>
+
 namespace facebook::cachelib::navy {
 
 static thread_local NavyThread* currentNavyThread_ = nullptr;
 
+namespace {
+// Fiber local data of the fibers run by NavyThread
+struct NavyFiberLocal {
+  RequestPriority priority{RequestPriority::High};
+};
+
+// Pins the calling thread to @cpu. Logs the failure and leaves the thread
+// unpinned if it is not allowed.
+void pinCurrentThread(int32_t cpu) {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  auto ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+  if (ret != 0) {
+    XLOGF(ERR, "Failed to pin navy thread to cpu {}: {}", cpu, ret);
+    return;
+  }
+  XLOGF(INFO, "Pinned navy thread to cpu {}", cpu);
+}
+} // namespace
+
 NavyThread* getCurrentNavyThread() { return currentNavyThread_; }
 
+RequestPriority getCurrentRequestPriority() {
+  if (!currentNavyThread_ || !folly::fibers::onFiber()) {
+    return RequestPriority::High;
+  }
+  return folly::fibers::local<NavyFiberLocal>().priority;
+}
+
+void setCurrentRequestPriority(RequestPriority priority) {
+  if (currentNavyThread_ && folly::fibers::onFiber()) {
+    folly::fibers::local<NavyFiberLocal>().priority = priority;
+  }
+}
+
 NavyThread::NavyThread(folly::StringPiece name, Options options) {
   th_ = std::make_unique<folly::ScopedEventBaseThread>(name.str());
 
   folly::fibers::FiberManager::Options opts;
   opts.stackSize =
       options.stackSize ? options.stackSize : Options::kDefaultStackSize;
+  if (options.maxFibersPoolSize) {
+    opts.maxFibersPoolSize = options.maxFibersPoolSize;
+  }
   auto& eb = *th_->getEventBase();
-  fm_ = &folly::fibers::getFiberManager(eb, opts);
+  fm_ = &folly::fibers::getFiberManagerT<NavyFiberLocal>(eb, opts);
 
-  eb.runInEventBaseThreadAndWait([this]() { currentNavyThread_ = this; });
+  eb.runInEventBaseThreadAndWait([this, cpu = options.cpu]() {
+    currentNavyThread_ = this;
+    if (cpu >= 0) {
+      pinCurrentThread(cpu);
+    }
+  });
 }
 
 NavyThread::~NavyThread() { th_.reset(); }
@@ -26,6 +26,7 @@
 #include <memory>
 
 #include "cachelib/common/ConditionVariable.h"
+#include "cachelib/navy/common/Types.h"
 
 namespace facebook {
 namespace cachelib {
@@ -37,6 +38,15 @@ class NavyThread;
 // otherwise.
 NavyThread* getCurrentNavyThread();
 
+// @return the priority of the request the current fiber runs. High if not
+// running on a NavyThread or never set.
+RequestPriority getCurrentRequestPriority();
+
+// Sets the priority of the request the current fiber runs, so that the device
+// IOs it issues are queued accordingly. It is inherited by the tasks the fiber
+// adds with addTask. No-op if not running on a fiber of a NavyThread.
+void setCurrentRequestPriority(RequestPriority priority);
+
 /**
  * NavyThread is a wrapper class that wraps folly::ScopedEventBaseThread and
  * FiberManager. The purpose of NavyThread is to start a new thread running
@@ -59,6 +69,19 @@ class NavyThread {
      * tasks.
      */
     size_t stackSize{kDefaultStackSize};
+
+    /**
+     * Maximum number of finished fibers, with their stacks, kept for reuse.
+     * The stacks of the fibers finishing beyond this are freed right away,
+     * so that a burst of in-flight requests doesn't pin their stacks. 0 for
+     * the FiberManager default.
+     */
+    size_t maxFibersPoolSize{0};
+
+    /**
+     * Cpu to pin the thread to, -1 to leave it unpinned.
+     */
+    int32_t cpu{-1};
   };
 
   /**
@@ -68,6 +91,12 @@ class NavyThread {
 
   ~NavyThread();
 
+  /**
+   * @return true if called on this thread, where tasks can be added with
+   *         addTask.
+   */
+  bool isCurrent() const { return getCurrentNavyThread() == this; }
+
   /**
    * Add the passed-in task to the FiberManager.
    *
@@ -61,7 +61,7 @@ void SizeDistribution::addSize(uint64_t size) {
         return itr1.first < s;
       });
   XDCHECK_NE(res, dist_.end());
-  res->second.add(size);
+  res->second.inc();
 }
 
 void SizeDistribution::removeSize(uint64_t size) {
@@ -76,7 +76,7 @@ void SizeDistribution::removeSize(uint64_t size) {
         return itr1.first < s;
       });
   XDCHECK_NE(res, dist_.end());
-  res->second.sub(size);
+  res->second.dec();
 }
 
 std::map<int64_t, int64_t> SizeDistribution::getSnapshot() const {
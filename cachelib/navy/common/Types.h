@@ -49,6 +49,11 @@ enum class Status {
   BadState,
 };
 
+// Priority class of an async request. Low priority requests, such as
+// prefetches, are dispatched and submitted to the device only after the high
+// priority ones waiting with them.
+enum class RequestPriority : uint8_t { High, Low };
+
 enum class DestructorEvent {
   // space is recycled (item evicted)
   Recycled,
@@ -65,6 +70,9 @@ using DestructorCallback =
 // Checking NvmItem expired
 using ExpiredCheck = std::function<bool(BufferView value)>;
 
+// Getting NvmItem expiry time in seconds since epoch, 0 if it never expires
+using ExpiryTimeGetter = std::function<uint32_t(BufferView value)>;
+
 // Get CounterVisitor into navy namespace.
 using CounterVisitor = util::CounterVisitor;
 
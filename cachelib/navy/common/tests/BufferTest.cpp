@@ -169,4 +169,43 @@ TEST(Buffer, CopyTo) {
   view.copyTo(dst + 6);
   EXPECT_STREQ("hello 12345.", dst);
 }
+
+TEST(BufferPool, SizeClasses) {
+  EXPECT_EQ(0, BufferPool::getSizeClass(512, 512));
+  EXPECT_EQ(0, BufferPool::getSizeClass(4096, 4096));
+  EXPECT_EQ(1, BufferPool::getSizeClass(4608, 512));
+  EXPECT_EQ(1, BufferPool::getSizeClass(8192, 4096));
+  EXPECT_EQ(BufferPool::kNumClasses - 1,
+            BufferPool::getSizeClass(1024 * 1024, 4096));
+  EXPECT_EQ(BufferPool::kUnpooled,
+            BufferPool::getSizeClass(1024 * 1024 + 4096, 4096));
+  EXPECT_EQ(BufferPool::kUnpooled, BufferPool::getSizeClass(8192, 8192));
+
+  EXPECT_EQ(BufferPool::kMaxCachedBuffersPerClass,
+            BufferPool::getMaxCachedBuffers(0));
+  EXPECT_EQ(1, BufferPool::getMaxCachedBuffers(BufferPool::kNumClasses - 1));
+}
+
+TEST(BufferPool, Reuse) {
+  const uint8_t* data = nullptr;
+  {
+    Buffer buf{8192, 4096};
+    data = buf.data();
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(data) % 4096);
+  }
+  // the next buffer of the class on this thread reuses the memory, while a
+  // buffer of another class does not
+  Buffer other{4096, 4096};
+  EXPECT_NE(data, other.data());
+  Buffer buf{7680, 512};
+  EXPECT_EQ(data, buf.data());
+  EXPECT_EQ(7680, buf.size());
+
+  // moving a buffer moves the memory back to the pool with it
+  Buffer moved = std::move(buf);
+  moved.trimStart(512);
+  moved = Buffer{};
+  Buffer again{8192, 4096};
+  EXPECT_EQ(data, again.data());
+}
 } // namespace facebook::cachelib::navy::tests
@@ -27,6 +27,7 @@
 #include "cachelib/common/Utils.h"
 #include "cachelib/navy/common/Device.h"
 #include "cachelib/navy/common/FdpNvme.h"
+#include "cachelib/navy/common/NavyThread.h"
 #include "cachelib/navy/testing/BufferGen.h"
 #include "cachelib/navy/testing/Callbacks.h"
 #include "cachelib/navy/testing/MockDevice.h"
@@ -164,6 +165,67 @@ TEST(Device, Encryptor) {
   device.getRealDeviceRef().getCounters({toCallback(visitor)});
 }
 
+// Writes are encrypted in their chunks of max write size and the reads of a
+// batch are decrypted together
+TEST(Device, EncryptorBatch) {
+  class MockEncryptor : public DeviceEncryptor {
+   public:
+    uint32_t encryptionBlockSize() const override { return 1024; }
+
+    bool encrypt(folly::MutableByteRange /* value */, uint64_t salt) override {
+      return salt != 10 * 1024;
+    }
+
+    bool decrypt(folly::MutableByteRange /* value */, uint64_t salt) override {
+      return salt != 2 * 1024;
+    }
+
+    void encryptBatch(folly::Range<Payload*> payloads) override {
+      encryptBatchSizes.push_back(payloads.size());
+      DeviceEncryptor::encryptBatch(payloads);
+    }
+
+    void decryptBatch(folly::Range<Payload*> payloads) override {
+      decryptBatchSizes.push_back(payloads.size());
+      DeviceEncryptor::decryptBatch(payloads);
+    }
+
+    std::vector<size_t> encryptBatchSizes;
+    std::vector<size_t> decryptBatchSizes;
+  };
+
+  auto filePath = folly::sformat("/tmp/DEVICE_ENCRYPTOR_BATCH-{}", ::getpid());
+  std::vector<std::string> filePaths{filePath};
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  const uint32_t ioAlignSize = 1024;
+  auto encryptor = std::make_shared<MockEncryptor>();
+  auto device = createFileDevice(
+      filePaths, 16 * ioAlignSize, false /* truncateFile */, ioAlignSize,
+      0 /* stripe size */, 2 * ioAlignSize /* max device write size */,
+      IoEngine::Sync, 0 /* qDepth */, false /* isFDPEnabled */, encryptor,
+      false /* isExclusiveOwner */);
+
+  BufferGen bufGen;
+  Buffer testBuffer = bufGen.gen(4 * ioAlignSize);
+  EXPECT_TRUE(device->write(0, testBuffer.copy(ioAlignSize)));
+  // its second chunk is at 10KB
+  EXPECT_FALSE(device->write(8 * ioAlignSize, testBuffer.copy(ioAlignSize)));
+  EXPECT_EQ((std::vector<size_t>{2, 2}), encryptor->encryptBatchSizes);
+
+  std::vector<Device::BatchRead> reads(3);
+  for (uint32_t i = 0; i < reads.size(); i++) {
+    reads[i].offset = i * ioAlignSize;
+    reads[i].size = ioAlignSize;
+  }
+  device->readBatch(folly::range(reads));
+  EXPECT_EQ((std::vector<size_t>{3}), encryptor->decryptBatchSizes);
+  EXPECT_FALSE(reads[0].buffer.isNull());
+  EXPECT_FALSE(reads[1].buffer.isNull());
+  // decrypting the read at 2KB fails
+  EXPECT_TRUE(reads[2].buffer.isNull());
+}
+
 TEST(Device, EncryptorFail) {
   class MockEncryptor : public DeviceEncryptor {
    public:
@@ -187,6 +249,33 @@ TEST(Device, EncryptorFail) {
   }
 }
 
+// Reads of a device written in 4KB blocks read only the 512 byte blocks
+// covering the range
+TEST(Device, SubPageReads) {
+  auto device = createMemoryDevice(16 * 1024, nullptr /* encryptor */,
+                                   4096 /* ioAlignSize */,
+                                   512 /* readAlignSize */);
+  EXPECT_EQ(4096, device->getIOAlignmentSize());
+  EXPECT_EQ(512, device->getReadAlignmentSize());
+
+  BufferGen bufGen;
+  Buffer data = bufGen.gen(8192);
+  EXPECT_TRUE(device->write(0, data.copy(4096)));
+
+  auto buffer = device->read(1000, 100);
+  EXPECT_EQ(data.view().slice(1000, 100), buffer.view());
+  EXPECT_EQ(512, device->getBytesRead());
+
+  // crosses a 512 byte block boundary
+  buffer = device->read(5000, 200);
+  EXPECT_EQ(data.view().slice(5000, 200), buffer.view());
+  EXPECT_EQ(512 + 1024, device->getBytesRead());
+
+  EXPECT_THROW(createMemoryDevice(16 * 1024, nullptr /* encryptor */, 4096,
+                                  768 /* readAlignSize */),
+               std::invalid_argument);
+}
+
 TEST(Device, Latency) {
   // Device size must be at least 1 because we try to write 1 byte to it
   MockDevice device{1, 1};
@@ -216,6 +305,52 @@ TEST(Device, Latency) {
   device.getCounters(toCallback(visitor));
 }
 
+TEST(Device, MemoryDeviceEmulation) {
+  MemoryDeviceEmulationConfig emulation;
+  emulation.readLatencyUs = {{100, 20'000}};
+  emulation.writeBandwidthMBps = 1;
+  emulation.queueDepth = 1;
+  auto device = createMemoryDevice(16 * 1024, nullptr /* encryptor */,
+                                   4096 /* ioAlignSize */, 0, emulation);
+
+  BufferGen bufGen;
+  Buffer data = bufGen.gen(4096);
+  auto begin = std::chrono::steady_clock::now();
+  EXPECT_TRUE(device->write(0, data.copy(4096)));
+  // 4KB at 1 MB/s
+  EXPECT_GE(std::chrono::steady_clock::now() - begin,
+            std::chrono::microseconds{4096});
+
+  // the reads queue up behind each other with a queue depth of 1
+  begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.emplace_back([&] {
+      auto buffer = device->read(0, 4096);
+      EXPECT_EQ(data.view(), buffer.view());
+    });
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - begin,
+            std::chrono::milliseconds{40});
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(_, _)).WillRepeatedly(testing::Return());
+  EXPECT_CALL(visitor,
+              call(strPiece("navy_device_emulated_read_latency_us_max"),
+                   testing::Ge(40'000)));
+  EXPECT_CALL(visitor,
+              call(strPiece("navy_device_emulated_queue_wait_us_max"),
+                   testing::Ge(20'000)));
+  device->getCounters(toCallback(visitor));
+
+  MemoryDeviceEmulationConfig invalid;
+  invalid.readLatencyUs = {{99, 400}, {50, 80}};
+  EXPECT_THROW(invalid.validate(), std::invalid_argument);
+}
+
 TEST(Device, IOError) {
   // Device size must be at least 1 because we try to write 1 byte to it
   MockDevice device{1, 1};
@@ -379,6 +514,42 @@ TEST(Device, Stats) {
   device.getCounters({toCallback(visitor)});
 }
 
+// IOs never make the 1us latency target, so the qdepth of the context of the
+// IO thread is halved down to 1
+TEST(Device, AdaptiveQDepth) {
+  auto filePath =
+      folly::sformat("/tmp/DEVICE_ADAPTIVE_QDEPTH_TEST-{}", ::getpid());
+  std::vector<std::string> filePaths{filePath};
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  int size = 1024 * 1024;
+  int ioAlignSize = 4096;
+  AsyncIoOptions options;
+  options.qDepthTargetLatencyUs = 1;
+  auto device = createFileDevice(
+      filePaths, size, false /* truncateFile */, ioAlignSize,
+      0 /* stripe size */, 0 /* max device write size */, IoEngine::LibAio,
+      4 /* qDepth */, false /* isFDPEnabled */, nullptr /* encryptor */,
+      false /* isExclusiveOwner */, false /* subPageReads */, options);
+
+  NavyThread thread{"adaptive_qdepth"};
+  thread.addTaskRemote([&device, ioAlignSize] {
+    Buffer wbuf = device->makeIOBuffer(ioAlignSize);
+    std::memset(wbuf.data(), 'a', ioAlignSize);
+    for (int i = 0; i < 16; i++) {
+      EXPECT_TRUE(device->write(i * ioAlignSize, wbuf.copy(ioAlignSize)));
+    }
+  });
+  thread.drain();
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(_, _)).WillRepeatedly(testing::Return());
+  EXPECT_CALL(visitor, call(strPiece("navy_device_adaptive_qdepth"), 1));
+  EXPECT_CALL(visitor, call(strPiece("navy_device_qdepth_decreases"), 2));
+  EXPECT_CALL(visitor, call(strPiece("navy_device_qdepth_increases"), 0));
+  device->getCounters({toCallback(visitor)});
+}
+
 struct DeviceParamTest
     : public testing::TestWithParam<std::tuple<IoEngine, int>> {
   DeviceParamTest()
@@ -453,6 +624,42 @@ TEST_P(DeviceParamTest, MaxWriteSize) {
   device->getCounters({toCallback(visitor)});
 }
 
+// The chunks of max write size of a write are submitted together
+TEST_P(DeviceParamTest, BatchWriteChunks) {
+  auto filePath =
+      folly::sformat("/tmp/DEVICE_BATCH_WRITE_CHUNKS_TEST-{}", ::getpid());
+  std::vector<std::string> filePaths{filePath};
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  int deviceSize = 64 * 1024;
+  int ioAlignSize = 1024;
+
+  AsyncIoOptions options;
+  options.batchWriteChunks = true;
+  auto device = createFileDevice(
+      filePaths, deviceSize, false /* truncateFile */, ioAlignSize,
+      0 /* stripe size */, 4 * ioAlignSize /* max device write size */,
+      ioEngine_, qDepth_, false /* isFDPEnabled */, nullptr /* encryptor */,
+      false /* isExclusiveOwner */, false /* subPageReads */, options);
+  // the last chunk is smaller than the max write size
+  uint32_t bufSize = 18 * ioAlignSize;
+  Buffer wbuf = device->makeIOBuffer(bufSize);
+  for (uint32_t i = 0; i < bufSize; i++) {
+    wbuf.data()[i] = folly::Random::rand32() % 256;
+  }
+  ASSERT_TRUE(device->write(2 * ioAlignSize, wbuf.copy(ioAlignSize)));
+
+  Buffer rbuf = device->makeIOBuffer(bufSize);
+  ASSERT_TRUE(device->read(2 * ioAlignSize, bufSize, rbuf.data()));
+  EXPECT_EQ(0, std::memcmp(wbuf.data(), rbuf.data(), bufSize));
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(_, _)).WillRepeatedly(testing::Return());
+  EXPECT_CALL(visitor, call(strPiece("navy_device_bytes_written"), bufSize));
+  EXPECT_CALL(visitor, call(strPiece("navy_device_write_errors"), 0));
+  device->getCounters({toCallback(visitor)});
+}
+
 TEST_P(DeviceParamTest, RAID0IO) {
   auto filePath = folly::sformat("/tmp/DEVICE_RAID0IO_TEST-{}", ::getpid());
   util::makeDir(filePath);
@@ -528,6 +735,156 @@ TEST_P(DeviceParamTest, RAID0IO) {
   }
 }
 
+TEST_P(DeviceParamTest, RAID0ReadBatch) {
+  auto filePath =
+      folly::sformat("/tmp/DEVICE_RAID0READBATCH_TEST-{}", ::getpid());
+  util::makeDir(filePath);
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  std::vector<std::string> filePaths = {filePath + "/CACHE0",
+                                        filePath + "/CACHE1"};
+
+  int size = 1024 * 1024;
+  int ioAlignSize = 4096;
+  int stripeSize = 8192;
+
+  auto device =
+      createFileDevice(filePaths, size, false /* truncateFile */, ioAlignSize,
+                       stripeSize, 0 /* max device write size */, ioEngine_,
+                       qDepth_, false /* isFDPEnabled */,
+                       nullptr /* encryptor */, false /* isExclusiveOwner */);
+
+  const uint32_t writeSize = 8 * stripeSize;
+  Buffer wbuf = device->makeIOBuffer(writeSize);
+  for (uint32_t i = 0; i < writeSize; i++) {
+    wbuf.data()[i] = folly::Random::rand32() % 256;
+  }
+  ASSERT_TRUE(device->write(0, wbuf.copy(ioAlignSize)));
+
+  // aligned, unaligned and spanning multiple stripes
+  std::vector<Device::BatchRead> reads(4);
+  reads[0].offset = 0;
+  reads[0].size = ioAlignSize;
+  reads[1].offset = 100;
+  reads[1].size = 300;
+  reads[2].offset = stripeSize - 10;
+  reads[2].size = 3 * stripeSize;
+  reads[3].offset = 5 * stripeSize;
+  reads[3].size = stripeSize;
+  device->readBatch(folly::range(reads));
+  for (const auto& read : reads) {
+    ASSERT_FALSE(read.buffer.isNull());
+    ASSERT_EQ(read.size, read.buffer.size());
+    EXPECT_EQ(0,
+              std::memcmp(wbuf.data() + read.offset, read.buffer.data(),
+                          read.size));
+  }
+}
+
+// Each file of a RAID0 device keeps at most one IO of a context outstanding,
+// and can be marked degraded
+TEST_P(DeviceParamTest, RAID0DegradedFile) {
+  auto filePath =
+      folly::sformat("/tmp/DEVICE_RAID0DEGRADED_TEST-{}", ::getpid());
+  util::makeDir(filePath);
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  std::vector<std::string> filePaths = {filePath + "/CACHE0",
+                                        filePath + "/CACHE1"};
+
+  int size = 1024 * 1024;
+  int ioAlignSize = 4096;
+  int stripeSize = 8192;
+
+  AsyncIoOptions options;
+  options.qDepthPerFile = 1;
+  auto device = createFileDevice(
+      filePaths, size, false /* truncateFile */, ioAlignSize, stripeSize,
+      0 /* max device write size */, ioEngine_, qDepth_,
+      false /* isFDPEnabled */, nullptr /* encryptor */,
+      false /* isExclusiveOwner */, false /* subPageReads */, options);
+
+  const uint32_t writeSize = 8 * stripeSize;
+  Buffer wbuf = device->makeIOBuffer(writeSize);
+  for (uint32_t i = 0; i < writeSize; i++) {
+    wbuf.data()[i] = folly::Random::rand32() % 256;
+  }
+  ASSERT_TRUE(device->write(0, wbuf.copy(ioAlignSize)));
+  std::vector<Device::BatchRead> reads(4);
+  for (uint32_t i = 0; i < reads.size(); i++) {
+    reads[i].offset = i * stripeSize + 100;
+    reads[i].size = 300;
+  }
+  device->readBatch(folly::range(reads));
+  for (const auto& read : reads) {
+    ASSERT_EQ(read.size, read.buffer.size());
+    EXPECT_EQ(0,
+              std::memcmp(wbuf.data() + read.offset, read.buffer.data(),
+                          read.size));
+  }
+
+  EXPECT_FALSE(device->isDegraded(0, writeSize));
+  EXPECT_TRUE(device->setMemberDegraded(1, true));
+  EXPECT_FALSE(device->setMemberDegraded(2, true));
+  EXPECT_FALSE(device->isDegraded(0, stripeSize));
+  EXPECT_TRUE(device->isDegraded(stripeSize, 100));
+  EXPECT_TRUE(device->isDegraded(stripeSize - 100, 200));
+  EXPECT_FALSE(device->isDegraded(2 * stripeSize, stripeSize));
+
+  // degraded files are still read
+  auto buffer = device->read(stripeSize + 100, 200);
+  ASSERT_EQ(200, buffer.size());
+  EXPECT_EQ(0, std::memcmp(wbuf.data() + stripeSize + 100, buffer.data(), 200));
+
+  MockCounterVisitor visitor;
+  EXPECT_CALL(visitor, call(_, _)).WillRepeatedly(testing::Return());
+  EXPECT_CALL(visitor, call(strPiece("navy_device_file0_degraded"), 0));
+  EXPECT_CALL(visitor, call(strPiece("navy_device_file1_degraded"), 1));
+  EXPECT_CALL(visitor, call(strPiece("navy_device_file1_io_errors"), 0));
+  device->getCounters({toCallback(visitor)});
+
+  EXPECT_TRUE(device->setMemberDegraded(1, false));
+  EXPECT_FALSE(device->isDegraded(0, writeSize));
+}
+
+// IOs up to the registered buffer size go through the registered buffers
+// with io_uring, larger ones are submitted as they are. Other engines ignore
+// the registered buffers.
+TEST_P(DeviceParamTest, RegisteredBuffers) {
+  auto filePath =
+      folly::sformat("/tmp/DEVICE_REGISTERED_BUFFERS_TEST-{}", ::getpid());
+  std::vector<std::string> filePaths{filePath};
+  SCOPE_EXIT { util::removePath(filePath); };
+
+  int size = 1024 * 1024;
+  int ioAlignSize = 4096;
+
+  auto device = createFileDevice(
+      filePaths, size, false /* truncateFile */, ioAlignSize,
+      0 /* stripe size */, 0 /* max device write size */, ioEngine_, qDepth_,
+      false /* isFDPEnabled */, nullptr /* encryptor */,
+      false /* isExclusiveOwner */, false /* subPageReads */,
+      AsyncIoOptions{2 * static_cast<uint32_t>(ioAlignSize),
+                     100 /* completionPollUs */});
+
+  for (uint32_t ioSize : {ioAlignSize, 2 * ioAlignSize, 8 * ioAlignSize}) {
+    Buffer wbuf = device->makeIOBuffer(ioSize);
+    for (uint32_t i = 0; i < ioSize; i++) {
+      wbuf.data()[i] = folly::Random::rand32() % 256;
+    }
+    const uint64_t offset = 4 * ioSize;
+    ASSERT_TRUE(device->write(offset, wbuf.copy(ioAlignSize)));
+
+    Buffer rbuf = device->makeIOBuffer(ioSize);
+    ASSERT_TRUE(device->read(offset, ioSize, rbuf.data()));
+    EXPECT_EQ(0, std::memcmp(wbuf.data(), rbuf.data(), ioSize));
+
+    auto buffer = device->read(offset + 100, 200);
+    ASSERT_EQ(200, buffer.size());
+    EXPECT_EQ(0, std::memcmp(wbuf.data() + 100, buffer.data(), 200));
+  }
+}
+
 TEST_P(DeviceParamTest, RAID0IOAlignment) {
   // The goal of this test is to ensure we cannot create a RAID0 device
   // if each individual device is not aligned to stripe size. This is to
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "cachelib/navy/common/IoBudget.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+using namespace std::chrono_literals;
+
+// 1 byte per nanosecond shared 4:2:1:1, so reclaim reads and reinsertions
+// get 1/8th byte per nanosecond and a burst of 1.25MB each.
+IoBudgetConfig makeConfig() {
+  IoBudgetConfig config;
+  config.bytesPerSec = 1'000'000'000;
+  config.burstMs = 10;
+  return config;
+}
+constexpr uint64_t kReclaimBurst = 1'250'000;
+} // namespace
+
+TEST(IoBudget, InvalidConfig) {
+  auto config = makeConfig();
+  config.flushShare = 0;
+  EXPECT_THROW(IoBudget(config, 0ns), std::invalid_argument);
+  config = makeConfig();
+  config.burstMs = 0;
+  EXPECT_THROW(IoBudget(config, 0ns), std::invalid_argument);
+}
+
+TEST(IoBudget, WaitForShare) {
+  IoBudget budget{makeConfig(), 0ns};
+  EXPECT_EQ(0ns, budget.reserve(IoClass::kReclaimRead, kReclaimBurst, 0ns));
+  // nothing is spare yet, so the class waits for its own share
+  EXPECT_EQ(10ms, budget.reserve(IoClass::kReclaimRead, kReclaimBurst, 0ns));
+  // the next IO of the class queues behind the debt
+  EXPECT_EQ(20ms, budget.reserve(IoClass::kReclaimRead, kReclaimBurst, 0ns));
+  // other classes are not affected
+  EXPECT_EQ(0ns, budget.reserve(IoClass::kUserRead, 1'000'000, 0ns));
+}
+
+TEST(IoBudget, WorkConserving) {
+  IoBudget budget{makeConfig(), 0ns};
+  // while the other classes are idle, their shares overflow into the spare
+  // bucket, which holds up to 10ms of the whole bandwidth
+  const uint64_t spare = 10'000'000;
+  EXPECT_EQ(0ns, budget.reserve(IoClass::kReclaimRead, kReclaimBurst + spare,
+                                100ms));
+  EXPECT_LT(0ns, budget.reserve(IoClass::kReclaimRead, 1, 100ms));
+
+  // user reads still have their own share
+  EXPECT_EQ(0ns, budget.reserve(IoClass::kUserRead, 5'000'000, 100ms));
+  EXPECT_LT(0ns, budget.reserve(IoClass::kUserRead, 1, 100ms));
+}
+
+TEST(IoBudget, TryAcquire) {
+  IoBudget budget{makeConfig(), 0ns};
+  EXPECT_FALSE(
+      budget.tryAcquire(IoClass::kReinsertion, kReclaimBurst + 1, 0ns));
+  // a rejection charges nothing
+  EXPECT_TRUE(budget.tryAcquire(IoClass::kReinsertion, kReclaimBurst, 0ns));
+  EXPECT_FALSE(budget.tryAcquire(IoClass::kReinsertion, 1, 0ns));
+  // refilled at 1/8th byte per nanosecond
+  EXPECT_TRUE(budget.tryAcquire(IoClass::kReinsertion, 1'000, 8us));
+
+  uint64_t rejections = 0;
+  budget.getCounters({[&](folly::StringPiece name, double val) {
+    if (name == "navy_io_budget_reinsertion_rejections") {
+      rejections = static_cast<uint64_t>(val);
+    }
+  }});
+  EXPECT_EQ(2, rejections);
+}
+} // namespace facebook::cachelib::navy::tests
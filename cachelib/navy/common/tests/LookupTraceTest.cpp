@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "cachelib/navy/common/LookupTrace.h"
+
+namespace facebook::cachelib::navy::tests {
+TEST(LookupTrace, StageLatency) {
+  LookupTrace trace;
+  EXPECT_EQ(0u, trace.getStageLatencyNs(LookupTrace::kStarted));
+  EXPECT_EQ(0u, trace.getStageLatencyNs(LookupTrace::kIndexed));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  trace.stamp(LookupTrace::kEnqueued);
+  EXPECT_GE(trace.getStageLatencyNs(LookupTrace::kEnqueued), 1'000'000u);
+
+  // stages that were skipped are measured from the latest one before
+  trace.stamp(LookupTrace::kIndexed);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  trace.stamp(LookupTrace::kCallback);
+  EXPECT_EQ(0u, trace.getStageLatencyNs(LookupTrace::kIoStarted));
+  EXPECT_GE(trace.getStageLatencyNs(LookupTrace::kCallback), 1'000'000u);
+}
+
+TEST(LookupTrace, Current) {
+  LookupTrace trace;
+  EXPECT_EQ(nullptr, LookupTrace::current());
+  LookupTrace::stampCurrent(LookupTrace::kDequeued);
+  {
+    ScopedLookupTrace scoped{&trace};
+    EXPECT_EQ(&trace, LookupTrace::current());
+    std::thread other{[] { EXPECT_EQ(nullptr, LookupTrace::current()); }};
+    other.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    LookupTrace::stampCurrent(LookupTrace::kDequeued);
+  }
+  EXPECT_EQ(nullptr, LookupTrace::current());
+  EXPECT_EQ(0u, trace.getStageLatencyNs(LookupTrace::kEnqueued));
+  EXPECT_GE(trace.getStageLatencyNs(LookupTrace::kDequeued), 1'000'000u);
+}
+} // namespace facebook::cachelib::navy::tests
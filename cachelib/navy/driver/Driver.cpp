@@ -21,6 +21,7 @@
 #include <folly/fibers/Baton.h>
 
 #include "cachelib/common/Serialization.h"
+#include "cachelib/common/Tracepoints.h"
 #include "cachelib/navy/admission_policy/DynamicRandomAP.h"
 #include "cachelib/navy/common/Hash.h"
 #include "cachelib/navy/scheduler/JobScheduler.h"
@@ -67,6 +68,15 @@ Driver::Driver(Config&& config, ValidConfigTag)
       enginePairs_{std::move(config.enginePairs)},
       admissionPolicy_{std::move(config.admissionPolicy)} {
   getRandomAllocDist = getDist(enginePairs_);
+  // Can be nullptr in driver tests
+  if (config.sizeAdvisorSampleRate > 0 && device_) {
+    SizeAdvisor::Config advisorConfig;
+    advisorConfig.sampleRate = config.sizeAdvisorSampleRate;
+    advisorConfig.ioAlignSize = device_->getIOAlignmentSize();
+    advisorConfig.deviceSize = device_->getSize();
+    advisorConfig.bigHashBucketSize = config.sizeAdvisorBigHashBucketSize;
+    sizeAdvisor_ = std::make_unique<SizeAdvisor>(advisorConfig);
+  }
   XLOGF(INFO, "Max concurrent inserts: {}", maxConcurrentInserts_);
   XLOGF(INFO, "Max parcel memory: {}", maxParcelMemory_);
   XLOGF(INFO, "Use Write Estimated Size: {}", useEstimatedWriteSize_);
@@ -142,6 +152,8 @@ bool Driver::admissionTest(HashedKey hk, BufferView value) const {
   }
   rejectedCount_.inc();
   rejectedBytes_.add(parcelSize);
+  CACHELIB_TRACEPOINT(nvm_admission_reject, hk.keyHash(), hk.key().size(),
+                      value.size());
 
   // Revert counter modifications. Remember, can't assign back atomic.
   concurrentInserts_.dec();
@@ -160,6 +172,9 @@ Status Driver::insertAsync(HashedKey hk, BufferView value, InsertCallback cb) {
   if (!admissionTest(hk, value)) {
     return Status::Rejected;
   }
+  if (sizeAdvisor_) {
+    sizeAdvisor_->recordInsert(hk.keyHash(), hk.key().size() + value.size());
+  }
 
   enginePairs_[selectEnginePair(hk)].scheduleInsert(
       hk, value,
@@ -183,6 +198,34 @@ void Driver::lookupAsync(HashedKey hk, LookupCallback cb) {
   enginePairs_[selectEnginePair(hk)].scheduleLookup(hk, std::move(cb));
 }
 
+void Driver::lookupAsync(HashedKey hk,
+                         LookupCallback cb,
+                         RequestPriority priority,
+                         uint64_t deadlineNs) {
+  XDCHECK(cb);
+  enginePairs_[selectEnginePair(hk)].scheduleLookup(hk, std::move(cb),
+                                                    priority, deadlineNs);
+}
+
+void Driver::lookupBatchAsync(std::vector<HashedKey> keys,
+                              std::vector<LookupCallback> cbs) {
+  XDCHECK_EQ(keys.size(), cbs.size());
+  std::vector<std::vector<HashedKey>> pairKeys(enginePairs_.size());
+  std::vector<std::vector<LookupCallback>> pairCbs(enginePairs_.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    XDCHECK(cbs[i]);
+    const auto idx = selectEnginePair(keys[i]);
+    pairKeys[idx].push_back(keys[i]);
+    pairCbs[idx].push_back(std::move(cbs[i]));
+  }
+  for (size_t idx = 0; idx < enginePairs_.size(); idx++) {
+    if (!pairKeys[idx].empty()) {
+      enginePairs_[idx].scheduleLookupBatch(std::move(pairKeys[idx]),
+                                            std::move(pairCbs[idx]));
+    }
+  }
+}
+
 Status Driver::remove(HashedKey hk) {
   return enginePairs_[selectEnginePair(hk)].removeSync(hk);
 }
@@ -191,6 +234,24 @@ void Driver::removeAsync(HashedKey hk, RemoveCallback cb) {
   enginePairs_[selectEnginePair(hk)].scheduleRemove(hk, std::move(cb));
 }
 
+void Driver::removeBatchAsync(std::vector<HashedKey> keys,
+                              std::vector<RemoveCallback> cbs) {
+  XDCHECK_EQ(keys.size(), cbs.size());
+  std::vector<std::vector<HashedKey>> pairKeys(enginePairs_.size());
+  std::vector<std::vector<RemoveCallback>> pairCbs(enginePairs_.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    const auto idx = selectEnginePair(keys[i]);
+    pairKeys[idx].push_back(keys[i]);
+    pairCbs[idx].push_back(std::move(cbs[i]));
+  }
+  for (size_t idx = 0; idx < enginePairs_.size(); idx++) {
+    if (!pairKeys[idx].empty()) {
+      enginePairs_[idx].scheduleRemoveBatch(std::move(pairKeys[idx]),
+                                            std::move(pairCbs[idx]));
+    }
+  }
+}
+
 void Driver::drain() {
   scheduler_->finish();
   for (size_t idx = 0; idx < enginePairs_.size(); idx++) {
@@ -316,6 +377,10 @@ void Driver::getCounters(const CounterVisitor& visitor) const {
   if (device_) {
     device_->getCounters(visitor);
   }
+  if (sizeAdvisor_) {
+    sizeAdvisor_->getCounters(visitor);
+  }
+  BufferPool::getCounters(visitor);
 }
 
 std::pair<Status, std::string> Driver::getRandomAlloc(Buffer& value) {
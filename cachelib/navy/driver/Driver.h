@@ -28,6 +28,7 @@
 #include "cachelib/navy/admission_policy/AdmissionPolicy.h"
 #include "cachelib/navy/common/Buffer.h"
 #include "cachelib/navy/common/Device.h"
+#include "cachelib/navy/driver/SizeAdvisor.h"
 #include "cachelib/navy/engine/Engine.h"
 #include "cachelib/navy/engine/EnginePair.h"
 #include "cachelib/navy/scheduler/JobScheduler.h"
@@ -55,6 +56,11 @@ class Driver final : public AbstractCache {
 
     bool useEstimatedWriteSize{false};
 
+    // 1 in this many inserts is sampled by the size advisor. 0 disables it.
+    uint32_t sizeAdvisorSampleRate{0};
+    // bucket size of BigHash the size advisor models
+    uint32_t sizeAdvisorBigHashBucketSize{4096};
+
     EnginePairSelector selector{};
 
     Config& validate();
@@ -109,6 +115,27 @@ class Driver final : public AbstractCache {
   //             the result will be provided to the function.
   void lookupAsync(HashedKey key, LookupCallback cb) override;
 
+  // lookup a key in the cache asynchronously with a priority class.
+  // @param key         the item key to lookup
+  // @param cb          a callback function be triggered when the lookup
+  //                    complete, or with Status::Rejected when cancelled.
+  // @param priority    low priority lookups are dispatched after the high
+  //                    priority ones
+  // @param deadlineNs  steady clock time after which the lookup is cancelled
+  //                    if it has not started yet. 0 for no deadline.
+  void lookupAsync(HashedKey key,
+                   LookupCallback cb,
+                   RequestPriority priority,
+                   uint64_t deadlineNs) override;
+
+  // lookup a batch of keys in the cache asynchronously. The keys of each
+  // engine pair are looked up as a single job.
+  // @param keys  the item keys to lookup
+  // @param cbs   callback functions, triggered with the result of the key at
+  //              the same index when its lookup completes.
+  void lookupBatchAsync(std::vector<HashedKey> keys,
+                        std::vector<LookupCallback> cbs) override;
+
   // remove the key from cache
   // @param key  the item key to be removed
   // @return a status indicates success or failure, and the reason for failure
@@ -119,6 +146,14 @@ class Driver final : public AbstractCache {
   // @param cb   a callback function be triggered when the remove complete.
   void removeAsync(HashedKey key, RemoveCallback cb) override;
 
+  // remove a batch of keys from cache asynchronously. The keys of each
+  // engine pair are removed as a single job.
+  // @param keys  the item keys to be removed
+  // @param cbs   callback functions, triggered with the result of the key at
+  //              the same index when its remove completes. Can be empty.
+  void removeBatchAsync(std::vector<HashedKey> keys,
+                        std::vector<RemoveCallback> cbs) override;
+
   // ensure all pending job have been completed
   void drain() override;
 
@@ -178,6 +213,8 @@ class Driver final : public AbstractCache {
   const EnginePairSelector selector_{};
   std::vector<EnginePair> enginePairs_;
   std::unique_ptr<AdmissionPolicy> admissionPolicy_;
+  // recommends the layout of the engines from the sizes inserted, if enabled
+  std::unique_ptr<SizeAdvisor> sizeAdvisor_;
   mutable std::discrete_distribution<size_t> getRandomAllocDist;
   std::mt19937 getRandomAllocGen{folly::Random::rand64()};
 
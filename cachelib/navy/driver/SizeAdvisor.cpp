@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "cachelib/navy/driver/SizeAdvisor.h"
+
+#include <folly/lang/Bits.h>
+
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace facebook::cachelib::navy {
+namespace {
+// sizes of the entry headers of the engines
+constexpr uint64_t kBlockCacheEntryOverhead{24};
+constexpr uint64_t kBigHashEntryOverhead{16};
+constexpr uint64_t kBigHashBucketOverhead{24};
+
+constexpr uint32_t kEntryAlignSizes[] = {64, 128, 256, 512};
+constexpr uint32_t kSmallItemMaxSizes[] = {0, 128, 256, 512, 1024, 2048};
+constexpr uint64_t kRegionSizesMB[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+// regions closed before the waste of a region size is estimated, and the
+// most entries packed for it
+constexpr uint64_t kMinClosedRegions{8};
+constexpr uint64_t kMaxPackedEntries{4'000'000};
+
+uint64_t alignUp(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+SizeAdvisor::SizeAdvisor(const Config& config)
+    : config_{config}, dist_{kMinSize, kMaxSize, 1.25} {
+  if (config_.sampleRate == 0) {
+    throw std::invalid_argument("Size advisor sample rate must be positive");
+  }
+}
+
+SizeAdvisor::Bytes SizeAdvisor::simulateEngines(
+    const Config& config,
+    const std::vector<uint64_t>& items,
+    uint32_t entryAlignSize,
+    uint32_t smallItemMaxSize) {
+  const uint64_t bucketCapacity =
+      config.bigHashBucketSize - kBigHashBucketOverhead;
+  Bytes bytes;
+  // offset of the next BlockCache entry within a device page and of the next
+  // BigHash entry within a bucket
+  uint64_t pageOffset = 0;
+  uint64_t bucketUsed = 0;
+  for (auto size : items) {
+    bytes.items += size;
+    if (size <= smallItemMaxSize) {
+      const auto entrySize = kBigHashEntryOverhead + size;
+      if (bucketUsed + entrySize > bucketCapacity) {
+        bytes.bigHashSpace += config.bigHashBucketSize;
+        bucketUsed = 0;
+      }
+      bucketUsed += entrySize;
+      // every insert rewrites the bucket and every lookup reads it
+      bytes.bigHashWritten += config.bigHashBucketSize;
+      bytes.read += config.bigHashBucketSize;
+      continue;
+    }
+    const auto entrySize =
+        alignUp(kBlockCacheEntryOverhead + size, entryAlignSize);
+    bytes.blockCacheSpace += entrySize;
+    // a lookup reads the device pages the entry spans
+    bytes.read += alignUp(pageOffset + entrySize, config.ioAlignSize);
+    pageOffset = (pageOffset + entrySize) % config.ioAlignSize;
+  }
+  // the bucket being filled counts for the space it is filled with
+  bytes.bigHashSpace += bucketUsed;
+  return bytes;
+}
+
+double SizeAdvisor::simulateRegionWaste(
+    const std::vector<uint64_t>& entrySizes, uint64_t regionSize) {
+  if (entrySizes.empty()) {
+    return 0;
+  }
+  uint64_t used = 0;
+  uint64_t waste = 0;
+  uint64_t closedRegions = 0;
+  // the entries are packed over and over until enough regions are closed
+  for (uint64_t i = 0;
+       closedRegions < kMinClosedRegions && i < kMaxPackedEntries; i++) {
+    const auto entrySize = entrySizes[i % entrySizes.size()];
+    if (entrySize > regionSize) {
+      return 1;
+    }
+    if (used + entrySize > regionSize) {
+      waste += regionSize - used;
+      used = 0;
+      closedRegions++;
+    }
+    used += entrySize;
+  }
+  // entries too small to close enough regions waste next to nothing
+  return closedRegions == 0
+             ? 0
+             : static_cast<double>(waste) / (closedRegions * regionSize);
+}
+
+SizeAdvisor::Recommendation SizeAdvisor::recommend(
+    const Config& config, const std::map<int64_t, int64_t>& snapshot) {
+  int64_t total = 0;
+  for (const auto& [size, count] : snapshot) {
+    total += std::max<int64_t>(count, 0);
+  }
+  if (total == 0) {
+    return Recommendation{};
+  }
+
+  // a mix of items in the proportions of the distribution, inserted in a
+  // random but reproducible order. A bucket counts sizes up to its own.
+  std::vector<uint64_t> items;
+  for (const auto& [size, count] : snapshot) {
+    if (count <= 0) {
+      continue;
+    }
+    const auto n = std::max<uint64_t>(
+        1, static_cast<uint64_t>(count) * kSimulatedItems / total);
+    items.insert(items.end(), n, static_cast<uint64_t>(size));
+  }
+  std::shuffle(items.begin(), items.end(), std::mt19937{0});
+
+  // BlockCache addresses entries by a 32 bit offset in units of the
+  // alignment, so a large device needs a large enough alignment
+  const uint64_t minEntryAlignSize =
+      config.deviceSize >> 32 == 0
+          ? 0
+          : folly::nextPowTwo(config.deviceSize >> 32);
+  std::vector<uint32_t> entryAlignSizes;
+  for (auto alignSize : kEntryAlignSizes) {
+    if (alignSize >= minEntryAlignSize) {
+      entryAlignSizes.push_back(alignSize);
+    }
+  }
+  if (entryAlignSizes.empty()) {
+    entryAlignSizes.push_back(static_cast<uint32_t>(minEntryAlignSize));
+  }
+
+  // pick the layout that writes the least among the ones that take close to
+  // the least space
+  struct Candidate {
+    uint32_t entryAlignSize;
+    uint32_t smallItemMaxSize;
+    Bytes bytes;
+  };
+  std::vector<Candidate> candidates;
+  double bestSpace = std::numeric_limits<double>::max();
+  for (auto alignSize : entryAlignSizes) {
+    for (auto smallItemMaxSize : kSmallItemMaxSizes) {
+      if (kBigHashEntryOverhead + smallItemMaxSize >
+          config.bigHashBucketSize - kBigHashBucketOverhead) {
+        continue;
+      }
+      auto bytes = simulateEngines(config, items, alignSize, smallItemMaxSize);
+      bestSpace =
+          std::min(bestSpace, bytes.blockCacheSpace + bytes.bigHashSpace);
+      candidates.push_back(Candidate{alignSize, smallItemMaxSize, bytes});
+    }
+  }
+  const Candidate* best = nullptr;
+  for (const auto& candidate : candidates) {
+    const auto& bytes = candidate.bytes;
+    if (bytes.blockCacheSpace + bytes.bigHashSpace >
+        bestSpace * (1 + config.spaceAmpTolerance)) {
+      continue;
+    }
+    if (!best || bytes.blockCacheSpace + bytes.bigHashWritten <
+                     best->bytes.blockCacheSpace + best->bytes.bigHashWritten) {
+      best = &candidate;
+    }
+  }
+
+  // the smallest region that wastes little of its tail, which evicts at the
+  // finest granularity
+  std::vector<uint64_t> entrySizes;
+  for (auto size : items) {
+    if (size > best->smallItemMaxSize) {
+      entrySizes.push_back(
+          alignUp(kBlockCacheEntryOverhead + size, best->entryAlignSize));
+    }
+  }
+  uint64_t regionSize = 0;
+  double regionWaste = 1;
+  for (auto regionSizeMB : kRegionSizesMB) {
+    const uint64_t size = regionSizeMB * 1024 * 1024;
+    const auto waste = simulateRegionWaste(entrySizes, size);
+    if (waste < regionWaste) {
+      regionSize = size;
+      regionWaste = waste;
+    }
+    if (waste <= config.maxRegionWaste) {
+      break;
+    }
+  }
+
+  const auto& bytes = best->bytes;
+  const double blockCacheSpace = bytes.blockCacheSpace / (1 - regionWaste);
+  Recommendation rec;
+  rec.regionSize = regionSize;
+  rec.entryAlignSize = best->entryAlignSize;
+  rec.smallItemMaxSize = best->smallItemMaxSize;
+  rec.spaceAmp = (blockCacheSpace + bytes.bigHashSpace) / bytes.items;
+  // regions are written whole
+  rec.writeAmp = (blockCacheSpace + bytes.bigHashWritten) / bytes.items;
+  rec.readAmp = bytes.read / bytes.items;
+  return rec;
+}
+
+void SizeAdvisor::getCounters(const CounterVisitor& visitor) const {
+  const auto rec = recommend();
+  if (rec.regionSize == 0) {
+    return;
+  }
+  visitor("navy_size_advisor_region_size", rec.regionSize);
+  visitor("navy_size_advisor_entry_align_size", rec.entryAlignSize);
+  visitor("navy_size_advisor_small_item_max_size", rec.smallItemMaxSize);
+  visitor("navy_size_advisor_space_amp", rec.spaceAmp);
+  visitor("navy_size_advisor_write_amp", rec.writeAmp);
+  visitor("navy_size_advisor_read_amp", rec.readAmp);
+}
+
+} // namespace facebook::cachelib::navy
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "cachelib/common/Utils.h"
+#include "cachelib/navy/common/SizeDistribution.h"
+
+namespace facebook::cachelib::navy {
+
+// Recommends the layout of the engines for the sizes of the items inserted
+// into navy: the region size of BlockCache, the alignment BlockCache packs
+// its entries at, and the item size under which items are better kept in
+// BigHash.
+//
+// A sample of the inserted sizes is kept in a SizeDistribution. The
+// recommendation replays a mix of items drawn from it through a model of
+// the candidate layouts: BlockCache entries are packed into regions at the
+// alignment, with the region tail left unused, and BigHash entries are
+// packed into buckets, each insert rewriting its bucket. The amplifications
+// of the recommended layout are reported next to it.
+class SizeAdvisor {
+ public:
+  struct Config {
+    // 1 in this many inserts is sampled, by key hash
+    uint32_t sampleRate{64};
+
+    // IO alignment of the device, which lookups read at
+    uint32_t ioAlignSize{4096};
+
+    // size of the device, which bounds the smallest entry alignment
+    // BlockCache can address
+    uint64_t deviceSize{0};
+
+    // bucket size of BigHash
+    uint32_t bigHashBucketSize{4096};
+
+    // layouts whose space amplification is within this ratio of the best one
+    // are picked from by their write amplification
+    double spaceAmpTolerance{0.05};
+
+    // share of a region that may be left unused at its tail
+    double maxRegionWaste{0.01};
+  };
+
+  // Layout and its amplifications, as ratios of device bytes to item bytes
+  struct Recommendation {
+    uint64_t regionSize{0};
+    uint32_t entryAlignSize{0};
+    uint32_t smallItemMaxSize{0};
+    // device space taken per byte of the items
+    double spaceAmp{0};
+    // device bytes written per byte inserted
+    double writeAmp{0};
+    // device bytes read per byte looked up
+    double readAmp{0};
+  };
+
+  static constexpr uint64_t kMinSize{64};
+  static constexpr uint64_t kMaxSize{16 * 1024 * 1024};
+  static constexpr size_t kSimulatedItems{10000};
+
+  explicit SizeAdvisor(const Config& config);
+
+  // track the size of an inserted item, if its key is sampled
+  void recordInsert(uint64_t keyHash, uint64_t size) {
+    if (keyHash % config_.sampleRate == 0) {
+      dist_.addSize(std::clamp(size, kMinSize, kMaxSize));
+    }
+  }
+
+  // @return the recommendation for the sizes sampled so far, or an empty
+  //         recommendation (region size 0) if none were
+  Recommendation recommend() const {
+    return recommend(config_, dist_.getSnapshot());
+  }
+
+  // @param snapshot  number of items by size
+  static Recommendation recommend(const Config& config,
+                                  const std::map<int64_t, int64_t>& snapshot);
+
+  void getCounters(const CounterVisitor& visitor) const;
+
+ private:
+  // bytes of the items and of the device for a layout
+  struct Bytes {
+    double items{0};
+    // space taken by BlockCache entries, without the region tails
+    double blockCacheSpace{0};
+    // space taken by BigHash buckets
+    double bigHashSpace{0};
+    double bigHashWritten{0};
+    double read{0};
+  };
+
+  // simulate the engines on the items with the entry alignment and small
+  // item threshold
+  static Bytes simulateEngines(const Config& config,
+                               const std::vector<uint64_t>& items,
+                               uint32_t entryAlignSize,
+                               uint32_t smallItemMaxSize);
+
+  // @return the share of the regions of the size left unused at their tail
+  //         when the BlockCache entries of the sizes are packed into them
+  static double simulateRegionWaste(const std::vector<uint64_t>& entrySizes,
+                                    uint64_t regionSize);
+
+  const Config config_;
+  SizeDistribution dist_;
+};
+
+} // namespace facebook::cachelib::navy
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "cachelib/navy/driver/SizeAdvisor.h"
+
+namespace facebook::cachelib::navy {
+namespace {
+constexpr uint64_t kMB{1024 * 1024};
+} // namespace
+
+TEST(SizeAdvisor, Empty) {
+  SizeAdvisor advisor{SizeAdvisor::Config{}};
+  EXPECT_EQ(0, advisor.recommend().regionSize);
+
+  size_t numCounters = 0;
+  advisor.getCounters({[&numCounters](folly::StringPiece, double) {
+    numCounters++;
+  }});
+  EXPECT_EQ(0, numCounters);
+}
+
+TEST(SizeAdvisor, SmallItems) {
+  // small items take less space packed into BigHash buckets than aligned in
+  // BlockCache
+  auto rec = SizeAdvisor::recommend(SizeAdvisor::Config{}, {{120, 1000}});
+  EXPECT_GE(rec.smallItemMaxSize, 120);
+  EXPECT_LT(rec.spaceAmp, 1.25);
+  // every insert rewrites a bucket
+  EXPECT_GT(rec.writeAmp, 30);
+  EXPECT_GT(rec.readAmp, 30);
+}
+
+TEST(SizeAdvisor, LargeItems) {
+  auto rec = SizeAdvisor::recommend(SizeAdvisor::Config{}, {{100'000, 1000}});
+  EXPECT_EQ(0, rec.smallItemMaxSize);
+  EXPECT_EQ(64, rec.entryAlignSize);
+  // the smallest region that leaves at most 1% of it unused at its tail
+  EXPECT_EQ(16 * kMB, rec.regionSize);
+  EXPECT_GT(rec.spaceAmp, 1.0);
+  EXPECT_LT(rec.spaceAmp, 1.01);
+  EXPECT_GE(rec.readAmp, 1.0);
+
+  SizeAdvisor::Config config;
+  config.maxRegionWaste = 0.05;
+  rec = SizeAdvisor::recommend(config, {{100'000, 1000}});
+  EXPECT_EQ(1 * kMB, rec.regionSize);
+}
+
+TEST(SizeAdvisor, LargeDevice) {
+  // 32 bit offsets address a 1TB device at 256 byte units
+  SizeAdvisor::Config config;
+  config.deviceSize = 1ULL << 40;
+  auto rec = SizeAdvisor::recommend(config, {{100'000, 1000}});
+  EXPECT_EQ(256, rec.entryAlignSize);
+}
+
+TEST(SizeAdvisor, Mixed) {
+  SizeAdvisor::Config config;
+  config.sampleRate = 1;
+  // the small items are a sliver of the bytes, so only the layout that takes
+  // the least space keeps them in BigHash
+  config.spaceAmpTolerance = 0;
+  SizeAdvisor advisor{config};
+  for (uint64_t i = 0; i < 10'000; i++) {
+    advisor.recordInsert(i, i % 2 == 0 ? 100 : 20'000);
+  }
+  auto rec = advisor.recommend();
+  EXPECT_GE(rec.smallItemMaxSize, 100);
+  EXPECT_LT(rec.smallItemMaxSize, 20'000);
+  EXPECT_NE(0, rec.regionSize);
+
+  std::map<std::string, double> counters;
+  advisor.getCounters({[&counters](folly::StringPiece name, double value) {
+    counters[name.str()] = value;
+  }});
+  EXPECT_EQ(rec.regionSize, counters["navy_size_advisor_region_size"]);
+  EXPECT_EQ(rec.smallItemMaxSize,
+            counters["navy_size_advisor_small_item_max_size"]);
+  EXPECT_EQ(6, counters.size());
+
+  // with the default tolerance they stay in BlockCache, which writes less
+  EXPECT_EQ(0, SizeAdvisor::recommend(SizeAdvisor::Config{},
+                                      {{100, 5000}, {20'000, 5000}})
+                   .smallItemMaxSize);
+}
+
+TEST(SizeAdvisor, Sampling) {
+  SizeAdvisor::Config config;
+  config.sampleRate = 4;
+  SizeAdvisor advisor{config};
+  advisor.recordInsert(1, 100'000);
+  advisor.recordInsert(2, 100'000);
+  EXPECT_EQ(0, advisor.recommend().regionSize);
+  advisor.recordInsert(4, 100'000);
+  EXPECT_NE(0, advisor.recommend().regionSize);
+}
+} // namespace facebook::cachelib::navy
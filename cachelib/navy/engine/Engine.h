@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <folly/Range.h>
+#include <folly/logging/xlog.h>
+
 #include "cachelib/navy/AbstractCache.h"
 #include "cachelib/navy/common/Hash.h"
 
@@ -45,9 +48,35 @@ class Engine {
   // Looks up a key in the engine.
   virtual Status lookup(HashedKey hk, Buffer& value) = 0;
 
+  // Looks up a batch of keys in the engine, setting the status and value of
+  // each key at the same index as the key. Engines that can resolve the keys
+  // together and batch their device reads override this. By default, keys are
+  // looked up one at a time.
+  virtual void lookupBatch(folly::Range<const HashedKey*> hks,
+                           folly::Range<Buffer*> values,
+                           folly::Range<Status*> statuses) {
+    XDCHECK_EQ(hks.size(), values.size());
+    XDCHECK_EQ(hks.size(), statuses.size());
+    for (size_t i = 0; i < hks.size(); i++) {
+      statuses[i] = lookup(hks[i], values[i]);
+    }
+  }
+
   // Remove must not return Status::Retry.
   virtual Status remove(HashedKey hk) = 0;
 
+  // Removes a batch of keys from the engine, setting the status of each key
+  // at the same index as the key. Engines that can remove keys sharing an
+  // index bucket together override this. By default, keys are removed one
+  // at a time.
+  virtual void removeBatch(folly::Range<const HashedKey*> hks,
+                           folly::Range<Status*> statuses) {
+    XDCHECK_EQ(hks.size(), statuses.size());
+    for (size_t i = 0; i < hks.size(); i++) {
+      statuses[i] = remove(hks[i]);
+    }
+  }
+
   // Finish any pending jobs
   virtual void drain() {}
 
@@ -16,6 +16,7 @@
 
 #include "cachelib/navy/engine/EnginePair.h"
 
+#include "cachelib/navy/common/LookupTrace.h"
 #include "cachelib/navy/engine/NoopEngine.h"
 
 namespace facebook::cachelib::navy {
@@ -164,10 +165,22 @@ Status EnginePair::lookupInternal(HashedKey hk,
 }
 
 void EnginePair::scheduleLookup(HashedKey hk, LookupCallback cb) {
+  auto* trace = LookupTrace::current();
+  if (trace) {
+    trace->stamp(LookupTrace::kEnqueued);
+  }
   scheduler_->enqueueWithKey(
-      [this, cb = std::move(cb), hk, skipLargeItemCache = false]() mutable {
+      [this, cb = std::move(cb), hk, skipLargeItemCache = false,
+       trace]() mutable {
         Buffer value;
-        Status status = lookupInternal(hk, value, skipLargeItemCache);
+        Status status;
+        {
+          if (trace) {
+            trace->stamp(LookupTrace::kDequeued);
+          }
+          ScopedLookupTrace scopedTrace{trace};
+          status = lookupInternal(hk, value, skipLargeItemCache);
+        }
         if (status == Status::Retry) {
           return JobExitCode::Reschedule;
         }
@@ -182,6 +195,118 @@ void EnginePair::scheduleLookup(HashedKey hk, LookupCallback cb) {
       hk.keyHash());
 }
 
+void EnginePair::scheduleLookup(HashedKey hk,
+                                LookupCallback cb,
+                                RequestPriority priority,
+                                uint64_t deadlineNs) {
+  auto* trace = LookupTrace::current();
+  if (trace) {
+    trace->stamp(LookupTrace::kEnqueued);
+  }
+  scheduler_->enqueueWithPriority(
+      [this, cb = std::move(cb), hk, skipLargeItemCache = false,
+       trace](bool cancelled) mutable {
+        if (cancelled) {
+          cb(Status::Rejected, hk, Buffer{});
+          return JobExitCode::Done;
+        }
+
+        Buffer value;
+        Status status;
+        {
+          if (trace) {
+            trace->stamp(LookupTrace::kDequeued);
+          }
+          ScopedLookupTrace scopedTrace{trace};
+          status = lookupInternal(hk, value, skipLargeItemCache);
+        }
+        if (status == Status::Retry) {
+          return JobExitCode::Reschedule;
+        }
+        cb(status, hk, std::move(value));
+
+        return JobExitCode::Done;
+      },
+      "lookup",
+      JobType::Read,
+      hk.keyHash(),
+      priority,
+      deadlineNs);
+}
+
+bool EnginePair::lookupBatchInternal(folly::Range<const HashedKey*> hks,
+                                     folly::Range<LookupCallback*> cbs,
+                                     std::vector<LookupStage>& stages) const {
+  bool done = true;
+  std::vector<HashedKey> keys;
+  std::vector<size_t> keyIdx;
+  std::vector<Buffer> values;
+  std::vector<Status> statuses;
+  for (auto stage :
+       {LookupStage::LargeItemCache, LookupStage::SmallItemCache}) {
+    keys.clear();
+    keyIdx.clear();
+    for (size_t i = 0; i < hks.size(); i++) {
+      if (stages[i] == stage) {
+        keys.push_back(hks[i]);
+        keyIdx.push_back(i);
+      }
+    }
+    if (keys.empty()) {
+      continue;
+    }
+
+    values.clear();
+    values.resize(keys.size());
+    statuses.assign(keys.size(), Status::NotFound);
+    auto& engine = stage == LookupStage::LargeItemCache ? *largeItemCache_
+                                                        : *smallItemCache_;
+    engine.lookupBatch(folly::range(keys), folly::range(values),
+                       folly::range(statuses));
+
+    for (size_t j = 0; j < keys.size(); j++) {
+      const auto i = keyIdx[j];
+      if (statuses[j] == Status::Retry) {
+        done = false;
+        continue;
+      }
+      if (stage == LookupStage::LargeItemCache &&
+          statuses[j] == Status::NotFound) {
+        stages[i] = LookupStage::SmallItemCache;
+        continue;
+      }
+      stages[i] = LookupStage::Done;
+      updateLookupStats(statuses[j]);
+      if (cbs[i]) {
+        cbs[i](statuses[j], hks[i], std::move(values[j]));
+      }
+    }
+  }
+  return done;
+}
+
+void EnginePair::scheduleLookupBatch(std::vector<HashedKey> hks,
+                                     std::vector<LookupCallback> cbs) {
+  XDCHECK_EQ(hks.size(), cbs.size());
+  if (hks.empty()) {
+    return;
+  }
+  const auto key = hks.front().keyHash();
+  std::vector<LookupStage> stages(hks.size(), LookupStage::LargeItemCache);
+  scheduler_->enqueueWithKey(
+      [this, hks = std::move(hks), cbs = std::move(cbs),
+       stages = std::move(stages)]() mutable {
+        if (!lookupBatchInternal(folly::range(hks), folly::range(cbs),
+                                 stages)) {
+          return JobExitCode::Reschedule;
+        }
+        return JobExitCode::Done;
+      },
+      "lookupBatch",
+      JobType::Read,
+      key);
+}
+
 Status EnginePair::removeSync(HashedKey hk) {
   Status status{Status::Ok};
   bool skipSmallItemCache = false;
@@ -235,6 +360,86 @@ void EnginePair::scheduleRemove(HashedKey hk, RemoveCallback cb) {
       hk.keyHash());
 }
 
+bool EnginePair::removeBatchInternal(folly::Range<const HashedKey*> hks,
+                                     folly::Range<RemoveCallback*> cbs,
+                                     std::vector<RemoveStage>& stages) {
+  bool done = true;
+  std::vector<HashedKey> keys;
+  std::vector<size_t> keyIdx;
+  std::vector<Status> statuses;
+  for (auto stage :
+       {RemoveStage::SmallItemCache, RemoveStage::LargeItemCache}) {
+    keys.clear();
+    keyIdx.clear();
+    for (size_t i = 0; i < hks.size(); i++) {
+      if (stages[i] == stage) {
+        keys.push_back(hks[i]);
+        keyIdx.push_back(i);
+      }
+    }
+    if (keys.empty()) {
+      continue;
+    }
+
+    if (stage == RemoveStage::SmallItemCache) {
+      removeCount_.add(keys.size());
+    }
+    statuses.assign(keys.size(), Status::NotFound);
+    auto& engine = stage == RemoveStage::SmallItemCache ? *smallItemCache_
+                                                        : *largeItemCache_;
+    engine.removeBatch(folly::range(keys), folly::range(statuses));
+
+    for (size_t j = 0; j < keys.size(); j++) {
+      const auto i = keyIdx[j];
+      if (statuses[j] == Status::Retry) {
+        done = false;
+        continue;
+      }
+      if (stage == RemoveStage::SmallItemCache &&
+          statuses[j] == Status::NotFound) {
+        stages[i] = RemoveStage::LargeItemCache;
+        continue;
+      }
+      stages[i] = RemoveStage::Done;
+      switch (statuses[j]) {
+      case Status::Ok:
+        succRemoveCount_.inc();
+        break;
+      case Status::DeviceError:
+        ioErrorCount_.inc();
+        break;
+      default:;
+      }
+      if (cbs[i]) {
+        cbs[i](statuses[j], hks[i]);
+      }
+    }
+  }
+  return done;
+}
+
+void EnginePair::scheduleRemoveBatch(std::vector<HashedKey> hks,
+                                     std::vector<RemoveCallback> cbs) {
+  XDCHECK_EQ(hks.size(), cbs.size());
+  if (hks.empty()) {
+    return;
+  }
+  const auto key = hks.front().keyHash();
+  std::vector<RemoveStage> stages(hks.size(), RemoveStage::SmallItemCache);
+  scheduler_->enqueueWithKey(
+      [this, hks = std::move(hks), cbs = std::move(cbs),
+       stages = std::move(stages)]() mutable {
+        if (!removeBatchInternal(folly::range(hks), folly::range(cbs),
+                                 stages)) {
+          return JobExitCode::Reschedule;
+        }
+        return JobExitCode::Done;
+      },
+      "removeBatch",
+      JobType::Write,
+      key);
+}
+
 void EnginePair::drain() {
   smallItemCache_->drain();
   largeItemCache_->drain();
@@ -78,9 +78,29 @@ class EnginePair {
   // Schedule a lookup.
   void scheduleLookup(HashedKey hk, LookupCallback cb);
 
+  // Schedule a lookup with a priority class. If it is cancelled because
+  // @deadlineNs passed before it started, @cb is invoked with
+  // Status::Rejected.
+  void scheduleLookup(HashedKey hk,
+                      LookupCallback cb,
+                      RequestPriority priority,
+                      uint64_t deadlineNs);
+
+  // Schedule the lookup of a batch of keys as a single job. @cbs[i] is
+  // invoked with the result of @hks[i]. The job is ordered by the first key
+  // of the batch only.
+  void scheduleLookupBatch(std::vector<HashedKey> hks,
+                           std::vector<LookupCallback> cbs);
+
   // Schedule a remove.
   void scheduleRemove(HashedKey hk, RemoveCallback cb);
 
+  // Schedule the remove of a batch of keys as a single job. @cbs[i] is
+  // invoked with the result of @hks[i]. The job is ordered by the first key
+  // of the batch only.
+  void scheduleRemoveBatch(std::vector<HashedKey> hks,
+                           std::vector<RemoveCallback> cbs);
+
   // Drain any pending jobs for both engines
   void drain();
 
@@ -119,6 +139,20 @@ class EnginePair {
                         Buffer& value,
                         bool& skipLargeItemCache) const;
 
+  // Where a key of a batch lookup is at
+  enum class LookupStage : uint8_t { LargeItemCache, SmallItemCache, Done };
+
+  // Perform a batch lookup in a retry friendly manner. Keys are looked up in
+  // the large item cache first, then in the small item cache if not found,
+  // the same as lookupInternal. Callbacks are invoked as soon as their key
+  // has a result.
+  //
+  // @return true if every key of the batch has a result, false if some of
+  //         them have to be retried.
+  bool lookupBatchInternal(folly::Range<const HashedKey*> hks,
+                           folly::Range<LookupCallback*> cbs,
+                           std::vector<LookupStage>& stages) const;
+
   // insert an item to one of the engine and remove it from the other.
   // An option can be specified to skip insertion on retry.
   Status insertInternal(HashedKey key, BufferView value, bool& skipInsertion);
@@ -126,6 +160,20 @@ class EnginePair {
   // Performa a remove by hashed key in a retry friendly manner.
   Status removeHashedKeyInternal(HashedKey hk, bool& skipSmallItemCache);
 
+  // Where a key of a batch remove is at
+  enum class RemoveStage : uint8_t { SmallItemCache, LargeItemCache, Done };
+
+  // Perform a batch remove in a retry friendly manner. Keys are removed from
+  // the small item cache first, then from the large item cache if not found,
+  // the same as removeHashedKeyInternal. Callbacks are invoked as soon as
+  // their key has a result.
+  //
+  // @return true if every key of the batch has a result, false if some of
+  //         them have to be retried.
+  bool removeBatchInternal(folly::Range<const HashedKey*> hks,
+                           folly::Range<RemoveCallback*> cbs,
+                           std::vector<RemoveStage>& stages);
+
   const uint32_t smallItemMaxSize_{};
   // Large item cache assumed to have fast response in case entry doesn't
   // exists (check metadata only).
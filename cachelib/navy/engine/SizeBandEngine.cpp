@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/engine/SizeBandEngine.h"
+
+#include <folly/Conv.h>
+#include <folly/Format.h>
+#include <folly/Random.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace facebook::cachelib::navy {
+SizeBandEngine::SizeBandEngine(std::vector<Band> bands)
+    : bands_{std::move(bands)} {
+  if (bands_.empty()) {
+    throw std::invalid_argument("size band engine needs at least one band");
+  }
+  for (size_t i = 0; i < bands_.size(); i++) {
+    if (!bands_[i].engine) {
+      throw std::invalid_argument(
+          folly::sformat("size band {} has no engine", i));
+    }
+    if (i > 0 && bands_[i].maxItemSize <= bands_[i - 1].maxItemSize) {
+      throw std::invalid_argument(folly::sformat(
+          "size band {} max item size: {} must be larger than the previous "
+          "one: {}",
+          i,
+          bands_[i].maxItemSize,
+          bands_[i - 1].maxItemSize));
+    }
+  }
+}
+
+size_t SizeBandEngine::select(HashedKey hk, BufferView value) const {
+  const uint64_t size = hk.key().size() + value.size();
+  for (size_t i = 0; i + 1 < bands_.size(); i++) {
+    if (size <= bands_[i].maxItemSize) {
+      return i;
+    }
+  }
+  return bands_.size() - 1;
+}
+
+Status SizeBandEngine::removeSync(Engine& engine, HashedKey hk) {
+  Status status;
+  // We do busy wait because we don't expect many retries.
+  while ((status = engine.remove(hk)) == Status::Retry) {
+    std::this_thread::yield();
+  }
+  return status;
+}
+
+uint64_t SizeBandEngine::getSize() const {
+  uint64_t size = 0;
+  for (const auto& band : bands_) {
+    size += band.engine->getSize();
+  }
+  return size;
+}
+
+bool SizeBandEngine::couldExist(HashedKey hk) {
+  return std::any_of(bands_.begin(), bands_.end(), [hk](const Band& band) {
+    return band.engine->couldExist(hk);
+  });
+}
+
+uint64_t SizeBandEngine::estimateWriteSize(HashedKey hk,
+                                           BufferView value) const {
+  return bands_[select(hk, value)].engine->estimateWriteSize(hk, value);
+}
+
+Status SizeBandEngine::insert(HashedKey hk, BufferView value) {
+  const auto idx = select(hk, value);
+  auto status = bands_[idx].engine->insert(hk, value);
+  if (status == Status::Retry || status == Status::DeviceError) {
+    return status;
+  }
+  for (size_t i = 0; i < bands_.size(); i++) {
+    if (i == idx) {
+      continue;
+    }
+    auto rs = removeSync(*bands_[i].engine, hk);
+    if (rs != Status::Ok && rs != Status::NotFound) {
+      XLOGF(ERR, "Insert failed to remove from size band {}: {}", i,
+            toString(rs));
+      status = Status::BadState;
+    }
+  }
+  return status;
+}
+
+Status SizeBandEngine::lookup(HashedKey hk, Buffer& value) {
+  for (auto& band : bands_) {
+    auto status = band.engine->lookup(hk, value);
+    if (status != Status::NotFound) {
+      return status;
+    }
+  }
+  return Status::NotFound;
+}
+
+void SizeBandEngine::lookupBatch(folly::Range<const HashedKey*> hks,
+                                 folly::Range<Buffer*> values,
+                                 folly::Range<Status*> statuses) {
+  XDCHECK_EQ(hks.size(), values.size());
+  XDCHECK_EQ(hks.size(), statuses.size());
+  std::fill(statuses.begin(), statuses.end(), Status::NotFound);
+
+  std::vector<size_t> pending(hks.size());
+  for (size_t i = 0; i < hks.size(); i++) {
+    pending[i] = i;
+  }
+  std::vector<HashedKey> keys;
+  std::vector<Buffer> bandValues;
+  std::vector<Status> bandStatuses;
+  for (auto& band : bands_) {
+    if (pending.empty()) {
+      break;
+    }
+    keys.clear();
+    for (auto i : pending) {
+      keys.push_back(hks[i]);
+    }
+    bandValues.clear();
+    bandValues.resize(keys.size());
+    bandStatuses.assign(keys.size(), Status::NotFound);
+    band.engine->lookupBatch(folly::range(keys), folly::range(bandValues),
+                             folly::range(bandStatuses));
+
+    size_t stillPending = 0;
+    for (size_t j = 0; j < pending.size(); j++) {
+      const auto i = pending[j];
+      if (bandStatuses[j] == Status::NotFound) {
+        pending[stillPending++] = i;
+        continue;
+      }
+      statuses[i] = bandStatuses[j];
+      values[i] = std::move(bandValues[j]);
+    }
+    pending.resize(stillPending);
+  }
+}
+
+Status SizeBandEngine::remove(HashedKey hk) {
+  bool removed = false;
+  for (auto& band : bands_) {
+    auto status = removeSync(*band.engine, hk);
+    if (status == Status::Ok) {
+      removed = true;
+    } else if (status != Status::NotFound) {
+      return status;
+    }
+  }
+  return removed ? Status::Ok : Status::NotFound;
+}
+
+void SizeBandEngine::drain() {
+  for (auto& band : bands_) {
+    band.engine->drain();
+  }
+}
+
+void SizeBandEngine::flush() {
+  for (auto& band : bands_) {
+    band.engine->flush();
+  }
+}
+
+void SizeBandEngine::reset() {
+  for (auto& band : bands_) {
+    band.engine->reset();
+  }
+}
+
+void SizeBandEngine::persist(RecordWriter& rw) {
+  for (auto& band : bands_) {
+    band.engine->persist(rw);
+  }
+}
+
+bool SizeBandEngine::recover(RecordReader& rr) {
+  for (auto& band : bands_) {
+    if (!band.engine->recover(rr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SizeBandEngine::getCounters(const CounterVisitor& visitor) const {
+  constexpr folly::StringPiece kPrefix{"navy_"};
+  for (size_t i = 0; i + 1 < bands_.size(); i++) {
+    const auto prefix = folly::sformat("navy_band{}_", i);
+    bands_[i].engine->getCounters(CounterVisitor{
+        [&visitor, &prefix, kPrefix](folly::StringPiece name, double count,
+                                     CounterVisitor::CounterType type) {
+          if (name.startsWith(kPrefix)) {
+            name.advance(kPrefix.size());
+          }
+          visitor(folly::to<std::string>(prefix, name), count, type);
+        }});
+  }
+  bands_.back().engine->getCounters(visitor);
+}
+
+uint64_t SizeBandEngine::getMaxItemSize() const {
+  return std::min<uint64_t>(bands_.back().maxItemSize,
+                            bands_.back().engine->getMaxItemSize());
+}
+
+std::pair<Status, std::string> SizeBandEngine::getRandomAlloc(Buffer& value) {
+  const auto totalSize = getSize();
+  if (totalSize == 0) {
+    return std::make_pair(Status::NotFound, "");
+  }
+  // pick a band in proportion to its size
+  auto pick = folly::Random::rand64(0, totalSize);
+  for (auto& band : bands_) {
+    const auto size = band.engine->getSize();
+    if (pick < size) {
+      return band.engine->getRandomAlloc(value);
+    }
+    pick -= size;
+  }
+  return bands_.back().engine->getRandomAlloc(value);
+}
+} // namespace facebook::cachelib::navy
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "cachelib/navy/engine/Engine.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+// Engine that routes items to one of several engines, the size bands, by the
+// size of key and value. Every band takes the items up to its max item size
+// that are too large for the band before it. This lets engines, e.g. block
+// caches with different region sizes, be tuned for the items they get.
+//
+// An item lives in at most one band: inserts remove the key from the other
+// bands, lookups and removes go through the bands in order.
+class SizeBandEngine final : public Engine {
+ public:
+  struct Band {
+    // largest key and value size routed to this band
+    uint32_t maxItemSize{};
+    std::unique_ptr<Engine> engine;
+  };
+
+  // @param bands  bands in increasing max item size
+  //
+  // @throw std::invalid_argument if there are no bands, an engine is missing
+  //        or the bands are not in increasing max item size
+  explicit SizeBandEngine(std::vector<Band> bands);
+  SizeBandEngine(const SizeBandEngine&) = delete;
+  SizeBandEngine& operator=(const SizeBandEngine&) = delete;
+  ~SizeBandEngine() override = default;
+
+  // sum of the usable space of the bands
+  uint64_t getSize() const override;
+
+  bool couldExist(HashedKey hk) override;
+
+  uint64_t estimateWriteSize(HashedKey hk, BufferView value) const override;
+
+  // Inserts into the band of the item size and removes the key from the
+  // others.
+  Status insert(HashedKey hk, BufferView value) override;
+
+  Status lookup(HashedKey hk, Buffer& value) override;
+
+  // Looks the keys up band by band, passing each band the keys not found in
+  // the previous ones as a batch.
+  void lookupBatch(folly::Range<const HashedKey*> hks,
+                   folly::Range<Buffer*> values,
+                   folly::Range<Status*> statuses) override;
+
+  Status remove(HashedKey hk) override;
+
+  void drain() override;
+
+  void flush() override;
+
+  void reset() override;
+
+  void persist(RecordWriter& rw) override;
+
+  bool recover(RecordReader& rr) override;
+
+  // Counters of the last band keep their names. The counters of band i
+  // before it are prefixed with "navy_band<i>_" instead of "navy_".
+  void getCounters(const CounterVisitor& visitor) const override;
+
+  uint64_t getMaxItemSize() const override;
+
+  std::pair<Status, std::string> getRandomAlloc(Buffer& value) override;
+
+ private:
+  // index of the band of @hk and @value
+  size_t select(HashedKey hk, BufferView value) const;
+
+  // Removes @hk from @engine, retrying while it is busy
+  static Status removeSync(Engine& engine, HashedKey hk);
+
+  std::vector<Band> bands_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
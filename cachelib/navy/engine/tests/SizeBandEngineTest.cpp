@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "cachelib/navy/engine/SizeBandEngine.h"
+#include "cachelib/navy/testing/Callbacks.h"
+
+using testing::_;
+using testing::AtLeast;
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+// Engine keeping the items in a map
+class MapEngine final : public Engine {
+ public:
+  uint64_t getSize() const override { return 1024; }
+  bool couldExist(HashedKey hk) override {
+    return items_.count(hk.key().str()) > 0;
+  }
+  uint64_t estimateWriteSize(HashedKey hk, BufferView value) const override {
+    return hk.key().size() + value.size();
+  }
+  Status insert(HashedKey hk, BufferView value) override {
+    items_[hk.key().str()] = Buffer{value};
+    return Status::Ok;
+  }
+  Status lookup(HashedKey hk, Buffer& value) override {
+    auto it = items_.find(hk.key().str());
+    if (it == items_.end()) {
+      return Status::NotFound;
+    }
+    value = it->second.copy();
+    return Status::Ok;
+  }
+  Status remove(HashedKey hk) override {
+    return items_.erase(hk.key().str()) > 0 ? Status::Ok : Status::NotFound;
+  }
+  void flush() override {}
+  void reset() override { items_.clear(); }
+  void persist(RecordWriter&) override {}
+  bool recover(RecordReader&) override { return true; }
+  void getCounters(const CounterVisitor& visitor) const override {
+    visitor("navy_map_items", items_.size());
+  }
+  uint64_t getMaxItemSize() const override { return UINT32_MAX; }
+  std::pair<Status, std::string> getRandomAlloc(Buffer&) override {
+    return std::make_pair(Status::NotFound, "");
+  }
+
+  size_t numItems() const { return items_.size(); }
+
+ private:
+  std::map<std::string, Buffer> items_;
+};
+
+struct Bands {
+  MapEngine* small{};
+  MapEngine* medium{};
+  MapEngine* large{};
+  std::unique_ptr<SizeBandEngine> engine;
+};
+
+// Bands for items up to 16 bytes, up to 64 bytes and larger ones
+Bands makeBands() {
+  Bands bands;
+  auto small = std::make_unique<MapEngine>();
+  auto medium = std::make_unique<MapEngine>();
+  auto large = std::make_unique<MapEngine>();
+  bands.small = small.get();
+  bands.medium = medium.get();
+  bands.large = large.get();
+  std::vector<SizeBandEngine::Band> v;
+  v.push_back({16, std::move(small)});
+  v.push_back({64, std::move(medium)});
+  v.push_back({UINT32_MAX, std::move(large)});
+  bands.engine = std::make_unique<SizeBandEngine>(std::move(v));
+  return bands;
+}
+} // namespace
+
+TEST(SizeBandEngine, Routing) {
+  auto bands = makeBands();
+  auto& engine = *bands.engine;
+
+  const std::string medium(32, 'm');
+  const std::string large(128, 'l');
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("a"), makeView("small")));
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("b"), makeView(medium.c_str())));
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("c"), makeView(large.c_str())));
+  EXPECT_EQ(1u, bands.small->numItems());
+  EXPECT_EQ(1u, bands.medium->numItems());
+  EXPECT_EQ(1u, bands.large->numItems());
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, engine.lookup(makeHK("a"), value));
+  EXPECT_EQ(makeView("small"), value.view());
+  EXPECT_EQ(Status::Ok, engine.lookup(makeHK("c"), value));
+  EXPECT_EQ(makeView(large.c_str()), value.view());
+  EXPECT_TRUE(engine.couldExist(makeHK("b")));
+  EXPECT_FALSE(engine.couldExist(makeHK("d")));
+
+  // a larger value moves the key to another band
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("a"), makeView(large.c_str())));
+  EXPECT_EQ(0u, bands.small->numItems());
+  EXPECT_EQ(2u, bands.large->numItems());
+  EXPECT_EQ(Status::Ok, engine.lookup(makeHK("a"), value));
+  EXPECT_EQ(makeView(large.c_str()), value.view());
+
+  EXPECT_EQ(Status::Ok, engine.remove(makeHK("b")));
+  EXPECT_EQ(Status::NotFound, engine.remove(makeHK("b")));
+  EXPECT_EQ(Status::NotFound, engine.lookup(makeHK("b"), value));
+}
+
+TEST(SizeBandEngine, LookupBatch) {
+  auto bands = makeBands();
+  auto& engine = *bands.engine;
+
+  const std::string large(128, 'l');
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("a"), makeView("small")));
+  EXPECT_EQ(Status::Ok, engine.insert(makeHK("c"), makeView(large.c_str())));
+
+  std::vector<HashedKey> keys{makeHK("c"), makeHK("b"), makeHK("a")};
+  std::vector<Buffer> values(keys.size());
+  std::vector<Status> statuses(keys.size(), Status::Retry);
+  engine.lookupBatch(folly::range(keys), folly::range(values),
+                     folly::range(statuses));
+  EXPECT_EQ(Status::Ok, statuses[0]);
+  EXPECT_EQ(makeView(large.c_str()), values[0].view());
+  EXPECT_EQ(Status::NotFound, statuses[1]);
+  EXPECT_EQ(Status::Ok, statuses[2]);
+  EXPECT_EQ(makeView("small"), values[2].view());
+}
+
+TEST(SizeBandEngine, Counters) {
+  auto bands = makeBands();
+  EXPECT_EQ(Status::Ok, bands.engine->insert(makeHK("a"), makeView("small")));
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_band0_map_items"), 1));
+  EXPECT_CALL(helper, call(strPiece("navy_band1_map_items"), 0));
+  EXPECT_CALL(helper, call(strPiece("navy_map_items"), 0));
+  bands.engine->getCounters({toCallback(helper)});
+}
+
+TEST(SizeBandEngine, BadBands) {
+  EXPECT_THROW(SizeBandEngine{std::vector<SizeBandEngine::Band>{}},
+               std::invalid_argument);
+
+  std::vector<SizeBandEngine::Band> v;
+  v.push_back({64, std::make_unique<MapEngine>()});
+  v.push_back({16, std::make_unique<MapEngine>()});
+  EXPECT_THROW(SizeBandEngine{std::move(v)}, std::invalid_argument);
+}
+} // namespace facebook::cachelib::navy::tests
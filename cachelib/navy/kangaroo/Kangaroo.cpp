@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cachelib/navy/kangaroo/Kangaroo.h"
+
+#include <folly/Format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+
+#include "cachelib/navy/common/Utils.h"
+
+namespace facebook::cachelib::navy {
+Kangaroo::Config& Kangaroo::Config::validate() {
+  if (device == nullptr) {
+    throw std::invalid_argument("device cannot be null");
+  }
+
+  const auto alignment = device->getIOAlignmentSize();
+  if (segmentSize == 0 || segmentSize % alignment != 0 ||
+      logBaseOffset % alignment != 0) {
+    throw std::invalid_argument(folly::sformat(
+        "logBaseOffset and segmentSize need to be a multiple of the device io "
+        "alignment. logBaseOffset: {}, segmentSize: {}, alignment: {}.",
+        logBaseOffset,
+        segmentSize,
+        alignment));
+  }
+
+  // one segment is filled while the others are on the log
+  if (numSegments() < 2) {
+    throw std::invalid_argument(folly::sformat(
+        "log size: {} must hold at least two segments of size: {}",
+        logSize,
+        segmentSize));
+  }
+
+  const auto logEnd = logBaseOffset + uint64_t{segmentSize} * numSegments();
+  if (logEnd > bigHash.cacheBaseOffset &&
+      bigHash.cacheBaseOffset + bigHash.cacheSize > logBaseOffset) {
+    throw std::invalid_argument(
+        folly::sformat("log [{}, {}) overlaps with bighash [{}, {})",
+                       logBaseOffset,
+                       logEnd,
+                       bigHash.cacheBaseOffset,
+                       bigHash.cacheBaseOffset + bigHash.cacheSize));
+  }
+
+  if (moveThreshold == 0) {
+    throw std::invalid_argument("move threshold cannot be 0");
+  }
+  // Without bloom filters every dropped item may have an older copy in
+  // BigHash, so all of them would have to be moved anyway.
+  if (moveThreshold > 1 && !bigHash.bloomFilter) {
+    throw std::invalid_argument(
+        "move threshold needs the bighash bloom filter");
+  }
+
+  if (bigHash.device == nullptr) {
+    bigHash.device = device;
+  }
+  bigHash.validate();
+  return *this;
+}
+
+Kangaroo::Kangaroo(Config&& config)
+    : Kangaroo{std::move(config.validate()), ValidConfigTag{}} {}
+
+Kangaroo::Kangaroo(Config&& config, ValidConfigTag)
+    : destructorCb_{std::move(config.destructorCb)},
+      logBaseOffset_{config.logBaseOffset},
+      segmentSize_{config.segmentSize},
+      numSegments_{config.numSegments()},
+      moveThreshold_{config.moveThreshold},
+      device_{*config.device},
+      placementHandle_{device_.allocatePlacementHandle()},
+      bigHash_{std::make_unique<BigHash>(std::move(config.bigHash))},
+      segmentBuffer_{device_.makeIOBuffer(segmentSize_)} {
+  XLOGF(INFO,
+        "Kangaroo created: segments: {}, segment size: {}, log base offset: "
+        "{}, move threshold: {}",
+        numSegments_,
+        segmentSize_,
+        logBaseOffset_,
+        moveThreshold_);
+  resetLogLocked();
+}
+
+uint64_t Kangaroo::getSize() const {
+  return uint64_t{segmentSize_} * numSegments_ + bigHash_->getSize();
+}
+
+uint64_t Kangaroo::getMaxItemSize() const {
+  return std::min<uint64_t>(bigHash_->getMaxItemSize(),
+                            segmentSize_ - sizeof(LogEntryHeader));
+}
+
+uint64_t Kangaroo::estimateWriteSize(HashedKey hk, BufferView value) const {
+  return entrySize(hk, value);
+}
+
+std::pair<Status, std::string> Kangaroo::getRandomAlloc(Buffer& value) {
+  return bigHash_->getRandomAlloc(value);
+}
+
+bool Kangaroo::couldExist(HashedKey hk) {
+  {
+    std::shared_lock<SharedMutex> lock{mutex_};
+    if (index_.find(hk.keyHash()) != index_.end()) {
+      return true;
+    }
+  }
+  return bigHash_->couldExist(hk);
+}
+
+Status Kangaroo::readEntryLocked(const LogLocation& loc,
+                                 HashedKey hk,
+                                 Buffer& value) {
+  Buffer buffer;
+  const uint8_t* entry{nullptr};
+  if (loc.segment == currentSegment_) {
+    entry = segmentBuffer_.data() + loc.offset;
+  } else {
+    const uint64_t alignment = device_.getIOAlignmentSize();
+    const uint64_t begin = loc.offset / alignment * alignment;
+    const uint64_t end = powTwoAlign(loc.offset + loc.size, alignment);
+    buffer = device_.read(getSegmentOffset(loc.segment) + begin, end - begin);
+    if (buffer.isNull()) {
+      ioErrorCount_.inc();
+      return Status::DeviceError;
+    }
+    entry = buffer.data() + (loc.offset - begin);
+  }
+
+  LogEntryHeader header;
+  std::memcpy(&header, entry, sizeof(header));
+  const BufferView key{header.keySize, entry + sizeof(header)};
+  if (key != makeView(hk.key())) {
+    // a different key with the same hash
+    return Status::NotFound;
+  }
+  value = Buffer{BufferView{header.valueSize, key.data() + key.size()}};
+  return Status::Ok;
+}
+
+Status Kangaroo::lookup(HashedKey hk, Buffer& value) {
+  lookupCount_.inc();
+  {
+    std::shared_lock<SharedMutex> lock{mutex_};
+    auto it = index_.find(hk.keyHash());
+    if (it != index_.end()) {
+      const auto status = readEntryLocked(it->second, hk, value);
+      if (status != Status::NotFound) {
+        if (status == Status::Ok) {
+          succLookupCount_.inc();
+        }
+        return status;
+      }
+    }
+  }
+  // Moving items to BigHash holds the log lock exclusively, so an item missed
+  // in the log was moved before the lock was taken.
+  return bigHash_->lookup(hk, value);
+}
+
+Status Kangaroo::insert(HashedKey hk, BufferView value) {
+  const uint32_t size = entrySize(hk, value);
+  if (size > segmentSize_) {
+    return Status::Rejected;
+  }
+  insertCount_.inc();
+
+  DroppedItems dropped;
+  Status status = Status::Ok;
+  {
+    std::unique_lock<SharedMutex> lock{mutex_};
+    if (segmentFill_ + size > segmentSize_) {
+      status = writeSegmentLocked(dropped);
+    }
+    if (status == Status::Ok) {
+      const LogEntryHeader header{static_cast<uint32_t>(hk.key().size()),
+                                  static_cast<uint32_t>(value.size())};
+      auto* entry = segmentBuffer_.data() + segmentFill_;
+      std::memcpy(entry, &header, sizeof(header));
+      std::memcpy(entry + sizeof(header), hk.key().data(), hk.key().size());
+      std::memcpy(entry + sizeof(header) + hk.key().size(), value.data(),
+                  value.size());
+      // an older entry of the key stays in the log as garbage
+      auto res = index_.insert_or_assign(
+          hk.keyHash(), LogLocation{currentSegment_, segmentFill_, size});
+      if (res.second) {
+        itemCount_.inc();
+      }
+      segmentFill_ += size;
+    }
+  }
+  callDestructor(dropped);
+
+  if (status == Status::Ok) {
+    succInsertCount_.inc();
+    logicalWrittenCount_.add(hk.key().size() + value.size());
+  }
+  return status;
+}
+
+Status Kangaroo::remove(HashedKey hk) {
+  removeCount_.inc();
+
+  Buffer value;
+  bool removed = false;
+  {
+    std::unique_lock<SharedMutex> lock{mutex_};
+    auto it = index_.find(hk.keyHash());
+    if (it != index_.end()) {
+      const auto status = readEntryLocked(it->second, hk, value);
+      if (status == Status::DeviceError) {
+        return status;
+      }
+      if (status == Status::Ok) {
+        index_.erase(it);
+        itemCount_.dec();
+        removed = true;
+      }
+    }
+  }
+  if (removed && destructorCb_) {
+    destructorCb_(hk, value.view(), DestructorEvent::Removed);
+  }
+
+  // BigHash may still hold an older copy
+  const auto status = bigHash_->remove(hk);
+  if (status == Status::DeviceError) {
+    return status;
+  }
+  if (removed || status == Status::Ok) {
+    succRemoveCount_.inc();
+    return Status::Ok;
+  }
+  return Status::NotFound;
+}
+
+Status Kangaroo::writeSegmentLocked(DroppedItems& dropped) {
+  segmentWriteCount_.inc();
+  if (!device_.write(getSegmentOffset(currentSegment_), segmentBuffer_.view(),
+                     placementHandle_)) {
+    ioErrorCount_.inc();
+    // keep the items by moving them to BigHash right away
+    moveSegmentLocked(currentSegment_, segmentBuffer_.view(), 1, dropped);
+    std::memset(segmentBuffer_.data(), 0, segmentBuffer_.size());
+    segmentFill_ = 0;
+    return Status::DeviceError;
+  }
+
+  numFullSegments_++;
+  currentSegment_ = (currentSegment_ + 1) % numSegments_;
+  if (numFullSegments_ == numSegments_) {
+    // the next segment is the oldest one, move its items out before reusing
+    // it. The buffer is cleared below anyway.
+    if (device_.read(getSegmentOffset(oldestSegment_), segmentSize_,
+                     segmentBuffer_.data())) {
+      moveSegmentLocked(oldestSegment_, segmentBuffer_.view(), moveThreshold_,
+                        dropped);
+    } else {
+      ioErrorCount_.inc();
+      // the values are lost, only drop the keys
+      for (auto it = index_.begin(); it != index_.end();) {
+        if (it->second.segment == oldestSegment_) {
+          it = index_.erase(it);
+          itemCount_.dec();
+          droppedItemCount_.inc();
+        } else {
+          ++it;
+        }
+      }
+    }
+    oldestSegment_ = (oldestSegment_ + 1) % numSegments_;
+    numFullSegments_--;
+  }
+  std::memset(segmentBuffer_.data(), 0, segmentBuffer_.size());
+  segmentFill_ = 0;
+  return Status::Ok;
+}
+
+void Kangaroo::moveSegmentLocked(uint32_t segment,
+                                 BufferView data,
+                                 uint32_t moveThreshold,
+                                 DroppedItems& dropped) {
+  segmentMoveCount_.inc();
+
+  std::vector<HashedKey> hks;
+  std::vector<BufferView> values;
+  for (uint32_t offset = 0; offset + sizeof(LogEntryHeader) <= data.size();) {
+    LogEntryHeader header;
+    std::memcpy(&header, data.data() + offset, sizeof(header));
+    if (header.keySize == 0) {
+      break;
+    }
+    const auto* key = data.data() + offset + sizeof(header);
+    const auto hk = makeHK(key, header.keySize);
+    // only the latest entry of a key is live
+    auto it = index_.find(hk.keyHash());
+    if (it != index_.end() && it->second.segment == segment &&
+        it->second.offset == offset) {
+      index_.erase(it);
+      hks.push_back(hk);
+      values.emplace_back(header.valueSize, key + header.keySize);
+    }
+    offset += sizeof(header) + header.keySize + header.valueSize;
+  }
+  itemCount_.sub(hks.size());
+
+  std::vector<Status> statuses(hks.size());
+  bigHash_->insertBatch(folly::range(hks), folly::range(values), moveThreshold,
+                        folly::range(statuses));
+  for (size_t i = 0; i < hks.size(); i++) {
+    if (statuses[i] == Status::Rejected && bigHash_->couldExist(hks[i])) {
+      // dropping it would make an older value in BigHash visible again
+      statuses[i] = bigHash_->insert(hks[i], values[i]);
+    }
+    if (statuses[i] == Status::Ok) {
+      movedItemCount_.inc();
+    } else {
+      droppedItemCount_.inc();
+      if (destructorCb_) {
+        dropped.emplace_back(Buffer{makeView(hks[i].key())}, Buffer{values[i]});
+      }
+    }
+  }
+}
+
+void Kangaroo::moveAllLocked(DroppedItems& dropped) {
+  auto buffer = device_.makeIOBuffer(segmentSize_);
+  for (uint32_t i = 0; i < numFullSegments_; i++) {
+    const auto segment = (oldestSegment_ + i) % numSegments_;
+    if (!device_.read(getSegmentOffset(segment), segmentSize_,
+                      buffer.data())) {
+      ioErrorCount_.inc();
+      continue;
+    }
+    moveSegmentLocked(segment, buffer.view(), 1, dropped);
+  }
+  moveSegmentLocked(currentSegment_, segmentBuffer_.view(), 1, dropped);
+  resetLogLocked();
+}
+
+void Kangaroo::resetLogLocked() {
+  index_.clear();
+  itemCount_.set(0);
+  std::memset(segmentBuffer_.data(), 0, segmentBuffer_.size());
+  segmentFill_ = 0;
+  currentSegment_ = 0;
+  oldestSegment_ = 0;
+  numFullSegments_ = 0;
+}
+
+void Kangaroo::callDestructor(const DroppedItems& dropped) {
+  for (const auto& [key, value] : dropped) {
+    destructorCb_(makeHK(key), value.view(), DestructorEvent::Recycled);
+  }
+}
+
+void Kangaroo::flush() {
+  XLOG(INFO, "Flush kangaroo");
+  bigHash_->flush();
+}
+
+void Kangaroo::reset() {
+  XLOG(INFO, "Reset kangaroo");
+  {
+    std::unique_lock<SharedMutex> lock{mutex_};
+    resetLogLocked();
+  }
+  bigHash_->reset();
+
+  insertCount_.set(0);
+  succInsertCount_.set(0);
+  lookupCount_.set(0);
+  succLookupCount_.set(0);
+  removeCount_.set(0);
+  succRemoveCount_.set(0);
+  segmentWriteCount_.set(0);
+  segmentMoveCount_.set(0);
+  movedItemCount_.set(0);
+  droppedItemCount_.set(0);
+  logicalWrittenCount_.set(0);
+  ioErrorCount_.set(0);
+}
+
+void Kangaroo::persist(RecordWriter& rw) {
+  XLOG(INFO, "Starting kangaroo persist");
+  DroppedItems dropped;
+  {
+    std::unique_lock<SharedMutex> lock{mutex_};
+    moveAllLocked(dropped);
+  }
+  callDestructor(dropped);
+  bigHash_->persist(rw);
+  XLOG(INFO, "Finished kangaroo persist");
+}
+
+bool Kangaroo::recover(RecordReader& rr) {
+  XLOG(INFO, "Starting kangaroo recovery");
+  {
+    std::unique_lock<SharedMutex> lock{mutex_};
+    resetLogLocked();
+  }
+  if (!bigHash_->recover(rr)) {
+    XLOG(ERR, "Failed to recover kangaroo");
+    return false;
+  }
+  XLOG(INFO, "Finished kangaroo recovery");
+  return true;
+}
+
+void Kangaroo::getCounters(const CounterVisitor& visitor) const {
+  visitor("navy_kl_items", itemCount_.get());
+  visitor("navy_kl_inserts", insertCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_succ_inserts", succInsertCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_lookups", lookupCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_succ_lookups", succLookupCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_removes", removeCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_succ_removes", succRemoveCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_segment_writes", segmentWriteCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_segment_moves", segmentMoveCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_moved_items", movedItemCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_dropped_items", droppedItemCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_logical_written", logicalWrittenCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  visitor("navy_kl_io_errors", ioErrorCount_.get(),
+          CounterVisitor::CounterType::RATE);
+  bigHash_->getCounters(visitor);
+}
+} // namespace facebook::cachelib::navy
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cachelib/common/AtomicCounter.h"
+#include "cachelib/navy/bighash/BigHash.h"
+#include "cachelib/navy/common/Buffer.h"
+#include "cachelib/navy/common/Device.h"
+#include "cachelib/navy/common/Hash.h"
+#include "cachelib/navy/common/Types.h"
+#include "cachelib/navy/engine/Engine.h"
+
+namespace facebook {
+namespace cachelib {
+namespace navy {
+// Kangaroo is a small item engine that puts a log in front of BigHash.
+//
+// BigHash writes a whole bucket for every insert. Kangaroo appends inserts to
+// a segment in DRAM instead and writes full segments to a circular log on the
+// device, so every item is written sequentially once. When the log wraps
+// around, the items still live in the oldest segment are moved to BigHash
+// grouped by bucket. A bucket is only written when at least `moveThreshold`
+// items of the segment map to it, which spreads one bucket write over several
+// items. Items of buckets below the threshold are dropped, unless BigHash may
+// hold an older copy of them.
+//
+// An in-memory index maps the key hash of every live log item to its location
+// in the log. Lookups check the log first and then BigHash.
+//
+// The log is not recovered. Persisting moves all the log items to BigHash and
+// recovery starts with an empty log.
+class Kangaroo final : public Engine {
+ public:
+  struct Config {
+    // The range of device that the log will access is guaranteed to be
+    // within [logBaseOffset, logBaseOffset + logSize). It must not overlap
+    // with the range of BigHash.
+    uint64_t logBaseOffset{};
+    uint64_t logSize{};
+    uint32_t segmentSize{256 * 1024};
+
+    // Minimum number of items of a segment that map to the same BigHash bucket
+    // for them to be moved to it. 1 moves every item.
+    uint32_t moveThreshold{1};
+
+    Device* device{nullptr};
+    DestructorCallback destructorCb;
+
+    // BigHash the log items are moved to
+    BigHash::Config bigHash;
+
+    uint32_t numSegments() const { return logSize / segmentSize; }
+
+    Config& validate();
+  };
+
+  // Constructor can throw std::exception if config is invalid.
+  //
+  // @param config  config that was validated with Config::validate
+  //
+  // @throw std::invalid_argument on bad config
+  explicit Kangaroo(Config&& config);
+  Kangaroo(const Kangaroo&) = delete;
+  Kangaroo& operator=(const Kangaroo&) = delete;
+  ~Kangaroo() override = default;
+
+  // Return the size of usable space, the log and BigHash together
+  uint64_t getSize() const override;
+
+  // Check if the key could exist in the log or in BigHash
+  bool couldExist(HashedKey hk) override;
+
+  // Return the bytes appended to the log for the item
+  uint64_t estimateWriteSize(HashedKey hk, BufferView value) const override;
+
+  // Look up a key in the log and then in BigHash.
+  Status lookup(HashedKey hk, Buffer& value) override;
+
+  // Appends the key and value to the log. This replaces an existing key.
+  // Writing a full segment can move the items of the oldest one to BigHash.
+  // Returns DeviceError if that failed.
+  Status insert(HashedKey hk, BufferView value) override;
+
+  // Removes an entry from the log and BigHash. Ok on success, NotFound on
+  // miss, and DeviceError on error.
+  Status remove(HashedKey hk) override;
+
+  // flush BigHash and the device
+  void flush() override;
+
+  // reset the log and BigHash to the initial state
+  void reset() override;
+
+  // moves all log items to BigHash and serializes BigHash state
+  void persist(RecordWriter& rw) override;
+
+  // deserialize BigHash state, the log starts empty
+  // @return true if recovery succeed, false o/w.
+  bool recover(RecordReader& rr) override;
+
+  // returns log and BigHash stats to the visitor
+  void getCounters(const CounterVisitor& visitor) const override;
+
+  // return the maximum allowed item size
+  uint64_t getMaxItemSize() const override;
+
+  // return a Buffer containing NvmItem randomly sampled in BigHash
+  std::pair<Status, std::string /* key */> getRandomAlloc(
+      Buffer& value) override;
+
+ private:
+  // Log entries are the header followed by the key and the value. A header
+  // with a zero key size marks the end of a segment.
+  struct LogEntryHeader {
+    uint32_t keySize{};
+    uint32_t valueSize{};
+  };
+
+  struct LogLocation {
+    uint32_t segment{};
+    // of the header within the segment
+    uint32_t offset{};
+    // entry size including the header
+    uint32_t size{};
+  };
+
+  // Items dropped from the log, to call the destructor for once the log lock
+  // is released
+  using DroppedItems = std::vector<std::pair<Buffer, Buffer>>;
+
+  struct ValidConfigTag {};
+  Kangaroo(Config&& config, ValidConfigTag);
+
+  static uint32_t entrySize(HashedKey hk, BufferView value) {
+    return sizeof(LogEntryHeader) + hk.key().size() + value.size();
+  }
+
+  uint64_t getSegmentOffset(uint32_t segment) const {
+    return logBaseOffset_ + uint64_t{segmentSize_} * segment;
+  }
+
+  // Reads the entry at @loc and sets @value if it belongs to @hk. The log lock
+  // must be held.
+  Status readEntryLocked(const LogLocation& loc, HashedKey hk, Buffer& value);
+
+  // Writes the current segment to the log and starts the next one, moving
+  // the oldest segment to BigHash first if the log is full. The log lock
+  // must be held.
+  Status writeSegmentLocked(DroppedItems& dropped);
+
+  // Moves the live items of @data, the contents of @segment, to BigHash. The
+  // items of buckets below @moveThreshold are dropped. The log lock must be
+  // held.
+  void moveSegmentLocked(uint32_t segment,
+                         BufferView data,
+                         uint32_t moveThreshold,
+                         DroppedItems& dropped);
+
+  // Moves all log items to BigHash and clears the log. The log lock must be
+  // held.
+  void moveAllLocked(DroppedItems& dropped);
+
+  void resetLogLocked();
+
+  void callDestructor(const DroppedItems& dropped);
+
+  const DestructorCallback destructorCb_{};
+  const uint64_t logBaseOffset_{};
+  const uint32_t segmentSize_{};
+  const uint32_t numSegments_{};
+  const uint32_t moveThreshold_{};
+  Device& device_;
+  const int placementHandle_;
+  std::unique_ptr<BigHash> bigHash_;
+
+  // guards the index and the segments
+  mutable SharedMutex mutex_;
+  folly::F14FastMap<uint64_t, LogLocation> index_;
+  // segment being filled in DRAM
+  Buffer segmentBuffer_;
+  uint32_t segmentFill_{0};
+  uint32_t currentSegment_{0};
+  // segments written to the log, starting with the oldest one
+  uint32_t oldestSegment_{0};
+  uint32_t numFullSegments_{0};
+
+  mutable AtomicCounter itemCount_;
+  mutable AtomicCounter insertCount_;
+  mutable AtomicCounter succInsertCount_;
+  mutable AtomicCounter lookupCount_;
+  mutable AtomicCounter succLookupCount_;
+  mutable AtomicCounter removeCount_;
+  mutable AtomicCounter succRemoveCount_;
+  mutable AtomicCounter segmentWriteCount_;
+  mutable AtomicCounter segmentMoveCount_;
+  mutable AtomicCounter movedItemCount_;
+  mutable AtomicCounter droppedItemCount_;
+  mutable AtomicCounter logicalWrittenCount_;
+  mutable AtomicCounter ioErrorCount_;
+};
+} // namespace navy
+} // namespace cachelib
+} // namespace facebook
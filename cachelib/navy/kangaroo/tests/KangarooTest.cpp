@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/IOBufQueue.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "cachelib/navy/kangaroo/Kangaroo.h"
+#include "cachelib/navy/testing/Callbacks.h"
+
+using testing::_;
+using testing::AtLeast;
+using testing::Gt;
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+constexpr uint32_t kSegmentSize = 1024;
+constexpr uint32_t kNumSegments = 4;
+constexpr uint32_t kBucketSize = 1024;
+constexpr uint32_t kNumBuckets = 32;
+
+// Log of 4 segments followed by BigHash
+void setLayout(Kangaroo::Config& config) {
+  config.segmentSize = kSegmentSize;
+  config.logBaseOffset = 0;
+  config.logSize = uint64_t{kSegmentSize} * kNumSegments;
+  config.bigHash.bucketSize = kBucketSize;
+  config.bigHash.cacheBaseOffset = config.logSize;
+  config.bigHash.cacheSize = uint64_t{kBucketSize} * kNumBuckets;
+}
+
+uint64_t deviceSize(const Kangaroo::Config& config) {
+  return config.logSize + config.bigHash.cacheSize;
+}
+
+std::string genKey(uint32_t i) { return "key_" + std::to_string(i); }
+std::string genValue(uint32_t i) {
+  return std::string(32, static_cast<char>('a' + i % 26));
+}
+} // namespace
+
+TEST(Kangaroo, InsertAndRemove) {
+  Kangaroo::Config config;
+  setLayout(config);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  Kangaroo kangaroo(std::move(config));
+
+  Buffer value;
+  EXPECT_EQ(Status::NotFound, kangaroo.lookup(makeHK("key"), value));
+
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("12345")));
+  EXPECT_TRUE(kangaroo.couldExist(makeHK("key")));
+  EXPECT_EQ(Status::Ok, kangaroo.lookup(makeHK("key"), value));
+  EXPECT_EQ(makeView("12345"), value.view());
+
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("67890")));
+  EXPECT_EQ(Status::Ok, kangaroo.lookup(makeHK("key"), value));
+  EXPECT_EQ(makeView("67890"), value.view());
+
+  EXPECT_EQ(Status::Ok, kangaroo.remove(makeHK("key")));
+  EXPECT_EQ(Status::NotFound, kangaroo.lookup(makeHK("key"), value));
+  EXPECT_EQ(Status::NotFound, kangaroo.remove(makeHK("key")));
+}
+
+TEST(Kangaroo, MoveToBigHash) {
+  Kangaroo::Config config;
+  setLayout(config);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  Kangaroo kangaroo(std::move(config));
+
+  // more than the log holds, so the oldest segments are moved
+  constexpr uint32_t kNumItems = 100;
+  for (uint32_t i = 0; i < kNumItems; i++) {
+    EXPECT_EQ(Status::Ok,
+              kangaroo.insert(makeHK(genKey(i).c_str()),
+                              makeView(genValue(i).c_str())));
+  }
+  for (uint32_t i = 0; i < kNumItems; i++) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, kangaroo.lookup(makeHK(genKey(i).c_str()), value));
+    EXPECT_EQ(makeView(genValue(i).c_str()), value.view());
+  }
+
+  MockCounterVisitor helper;
+  EXPECT_CALL(helper, call(_, _)).Times(AtLeast(0));
+  EXPECT_CALL(helper, call(strPiece("navy_kl_segment_moves"), Gt(0)));
+  EXPECT_CALL(helper, call(strPiece("navy_kl_moved_items"), Gt(0)));
+  EXPECT_CALL(helper, call(strPiece("navy_kl_dropped_items"), 0));
+  kangaroo.getCounters({toCallback(helper)});
+}
+
+TEST(Kangaroo, MoveThreshold) {
+  Kangaroo::Config config;
+  setLayout(config);
+  // no bucket gets this many items of a segment
+  config.moveThreshold = 100;
+  config.bigHash.bloomFilter =
+      std::make_unique<BloomFilter>(kNumBuckets, 4, 128);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  MockDestructor helper;
+  EXPECT_CALL(helper, call(_, _, DestructorEvent::Recycled))
+      .Times(AtLeast(1));
+  config.destructorCb = toCallback(helper);
+
+  Kangaroo kangaroo(std::move(config));
+
+  constexpr uint32_t kNumItems = 100;
+  for (uint32_t i = 0; i < kNumItems; i++) {
+    EXPECT_EQ(Status::Ok,
+              kangaroo.insert(makeHK(genKey(i).c_str()),
+                              makeView(genValue(i).c_str())));
+  }
+
+  // the first segment was dropped, the last one is still in DRAM
+  Buffer value;
+  EXPECT_EQ(Status::NotFound, kangaroo.lookup(makeHK(genKey(0).c_str()), value));
+  EXPECT_EQ(Status::Ok,
+            kangaroo.lookup(makeHK(genKey(kNumItems - 1).c_str()), value));
+  EXPECT_EQ(makeView(genValue(kNumItems - 1).c_str()), value.view());
+}
+
+TEST(Kangaroo, MoveThresholdReplacesOldCopy) {
+  Kangaroo::Config config;
+  setLayout(config);
+  config.moveThreshold = 100;
+  config.bigHash.bloomFilter =
+      std::make_unique<BloomFilter>(kNumBuckets, 4, 128);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  Kangaroo kangaroo(std::move(config));
+
+  // persist moves everything to BigHash
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("12345")));
+  folly::IOBufQueue queue;
+  auto rw = createMemoryRecordWriter(queue);
+  kangaroo.persist(*rw);
+
+  // the new value is below the threshold, but must not be dropped in favor of
+  // the old one
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("67890")));
+  for (uint32_t i = 0; i < 100; i++) {
+    EXPECT_EQ(Status::Ok,
+              kangaroo.insert(makeHK(genKey(i).c_str()),
+                              makeView(genValue(i).c_str())));
+  }
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, kangaroo.lookup(makeHK("key"), value));
+  EXPECT_EQ(makeView("67890"), value.view());
+}
+
+TEST(Kangaroo, RemoveOldCopy) {
+  Kangaroo::Config config;
+  setLayout(config);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  Kangaroo kangaroo(std::move(config));
+
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("12345")));
+  folly::IOBufQueue queue;
+  auto rw = createMemoryRecordWriter(queue);
+  kangaroo.persist(*rw);
+  EXPECT_EQ(Status::Ok, kangaroo.insert(makeHK("key"), makeView("67890")));
+
+  Buffer value;
+  EXPECT_EQ(Status::Ok, kangaroo.remove(makeHK("key")));
+  EXPECT_EQ(Status::NotFound, kangaroo.lookup(makeHK("key"), value));
+}
+
+TEST(Kangaroo, PersistRecovery) {
+  Kangaroo::Config config;
+  setLayout(config);
+  auto device = createMemoryDevice(deviceSize(config), nullptr);
+  config.device = device.get();
+
+  Kangaroo kangaroo(std::move(config));
+
+  constexpr uint32_t kNumItems = 50;
+  for (uint32_t i = 0; i < kNumItems; i++) {
+    EXPECT_EQ(Status::Ok,
+              kangaroo.insert(makeHK(genKey(i).c_str()),
+                              makeView(genValue(i).c_str())));
+  }
+
+  folly::IOBufQueue queue;
+  auto rw = createMemoryRecordWriter(queue);
+  kangaroo.persist(*rw);
+
+  auto rr = createMemoryRecordReader(queue);
+  ASSERT_TRUE(kangaroo.recover(*rr));
+
+  for (uint32_t i = 0; i < kNumItems; i++) {
+    Buffer value;
+    EXPECT_EQ(Status::Ok, kangaroo.lookup(makeHK(genKey(i).c_str()), value));
+    EXPECT_EQ(makeView(genValue(i).c_str()), value.view());
+  }
+}
+
+TEST(Kangaroo, BadConfig) {
+  auto device = createMemoryDevice(64 * 1024, nullptr);
+  {
+    // a single segment
+    Kangaroo::Config config;
+    setLayout(config);
+    config.logSize = kSegmentSize;
+    config.device = device.get();
+    EXPECT_THROW(Kangaroo{std::move(config)}, std::invalid_argument);
+  }
+  {
+    // the log overlaps with BigHash
+    Kangaroo::Config config;
+    setLayout(config);
+    config.bigHash.cacheBaseOffset = kSegmentSize;
+    config.device = device.get();
+    EXPECT_THROW(Kangaroo{std::move(config)}, std::invalid_argument);
+  }
+  {
+    // dropping items needs the bloom filter
+    Kangaroo::Config config;
+    setLayout(config);
+    config.moveThreshold = 2;
+    config.device = device.get();
+    EXPECT_THROW(Kangaroo{std::move(config)}, std::invalid_argument);
+  }
+}
+} // namespace facebook::cachelib::navy::tests
@@ -19,6 +19,7 @@
 #include <folly/Function.h>
 
 #include <memory>
+#include <vector>
 
 #include "cachelib/navy/common/CompilerUtils.h"
 #include "cachelib/navy/common/Types.h"
@@ -32,6 +33,8 @@
 // JobScheduler has the following members:
 //   - enqueueWithKey(Job, key)   Enqueues a job with a key. Can be used to hash
 //                                jobs.
+//   - enqueueWithPriority(...)   Enqueues a job with a priority class and an
+//                                optional deadline.
 //   - finish()                   Waits for all the scheduled jobs to finish
 
 namespace facebook {
@@ -47,6 +50,10 @@ using Job = folly::Function<JobExitCode()>;
 
 enum class JobType { Read, Write };
 
+// Job that can be cancelled before it starts. It is called with true, once,
+// instead of being run when it is cancelled, and with false otherwise.
+using CancellableJob = folly::Function<JobExitCode(bool cancelled)>;
+
 class JobScheduler {
  public:
   virtual ~JobScheduler() = default;
@@ -59,6 +66,18 @@ class JobScheduler {
                               JobType type,
                               uint64_t key) = 0;
 
+  // Same as enqueueWithKey, but the job is dispatched after the jobs of higher
+  // @priority waiting with it. If @deadlineNs (steady clock, see
+  // util::getCurrentTimeNs) is not 0 and passes before the job starts, it is
+  // cancelled. The priority is only honored by NavyRequestScheduler, the
+  // others run the job as a regular one.
+  virtual void enqueueWithPriority(CancellableJob job,
+                                   folly::StringPiece name,
+                                   JobType type,
+                                   uint64_t key,
+                                   RequestPriority priority,
+                                   uint64_t deadlineNs);
+
   // Notify the completion of the job (only for NavyRequestScheduler)
   virtual void notifyCompletion(uint64_t key) = 0;
 
@@ -70,11 +89,13 @@ class JobScheduler {
 };
 
 // Create a thread pool job scheduler that ensures ordering of requests by
-// key. This is the default job scheduler for use in Navy.
+// key. This is the default job scheduler for use in Navy. With
+// @workStealing, idle threads take jobs queued on busy threads.
 std::unique_ptr<JobScheduler> createOrderedThreadPoolJobScheduler(
     uint32_t readerThreads,
     uint32_t writerThreads,
-    uint32_t reqOrderShardPower);
+    uint32_t reqOrderShardPower,
+    bool workStealing = false);
 
 // Create a scheduler which runs jobs on fiber. The jobs for the same key
 // are serialized and guaranteed not to be run concurrently
@@ -84,13 +105,20 @@ std::unique_ptr<JobScheduler> createOrderedThreadPoolJobScheduler(
 // @param maxNumWrites        Max number of outstanding writes
 // @param stackSize           Size of fiber stack
 // @param reqOrderShardPower  The number of shards (in power of 2) for ordering
+// @param maxPooledFibers     Max number of idle fibers every thread keeps for
+//                            reuse, 0 for the default
+// @param keyAffinityCpus     Cpus to pin one reader and one writer thread to
+//                            each, so that the jobs of a key run on one cpu.
+//                            Empty for no pinning.
 std::unique_ptr<JobScheduler> createNavyRequestScheduler(
     size_t numReaderThreads,
     size_t numWriterThreads_,
     size_t maxNumReads,
     size_t maxNumWrites,
     size_t stackSize,
-    size_t reqOrderShardPower);
+    size_t reqOrderShardPower,
+    size_t maxPooledFibers = 0,
+    std::vector<uint32_t> keyAffinityCpus = {});
 
 } // namespace navy
 } // namespace cachelib
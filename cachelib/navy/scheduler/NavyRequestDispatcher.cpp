@@ -16,20 +16,36 @@
 
 #include "cachelib/navy/scheduler/NavyRequestDispatcher.h"
 
+#include <algorithm>
+
 #include "JobScheduler.h"
 
 namespace facebook {
 namespace cachelib {
 namespace navy {
 
+namespace {
+NavyThread::Options makeThreadOptions(size_t stackSize,
+                                      size_t maxPooledFibers,
+                                      int32_t cpu) {
+  NavyThread::Options options(stackSize);
+  options.maxFibersPoolSize = maxPooledFibers;
+  options.cpu = cpu;
+  return options;
+}
+} // namespace
+
 NavyRequestDispatcher::NavyRequestDispatcher(JobScheduler& scheduler,
                                              folly::StringPiece name,
                                              size_t maxOutstanding,
-                                             size_t stackSize)
+                                             size_t stackSize,
+                                             size_t maxPooledFibers,
+                                             int32_t cpu)
     : scheduler_(scheduler),
       name_(name),
       maxOutstanding_(maxOutstanding),
-      worker_{name_, NavyThread::Options(stackSize)} {
+      maxLowPriOutstanding_(std::max<size_t>(maxOutstanding / 2, 1)),
+      worker_{name_, makeThreadOptions(stackSize, maxPooledFibers, cpu)} {
   worker_.addTaskRemote([this]() {
     XLOGF(INFO, "[{}] Starting with max outstanding {}", getName(),
           maxOutstanding_);
@@ -53,6 +69,10 @@ NavyRequestDispatcher::NavyRequestDispatcher(JobScheduler& scheduler,
  * The loop can pause processing if the outstanding requests reached the limit.
  * Once paused, the loop will wait for the completion of any of the current
  * outstanding requests before resuming dispatches.
+ *
+ * Low priority requests are moved to lowPriReqs_ instead, and dispatched
+ * after the high priority ones, here or when a request completes, as long as
+ * the outstanding requests are below maxLowPriOutstanding_.
  */
 void NavyRequestDispatcher::processLoop() {
   numPolled_.inc();
@@ -78,21 +98,31 @@ void NavyRequestDispatcher::processLoop() {
       std::unique_ptr<NavyRequest> req(pending);
       pending = pending->next_;
       req->next_ = nullptr;
+
+      if (req->getPriority() == RequestPriority::Low) {
+        numLowPriQueued_.inc();
+        lowPriReqs_.push_back(std::move(req));
+        continue;
+      }
       numDispatched_.inc();
 
       // Enforce the maximum concurrent requests outstanding
-      if (numOutstanding_.get() == maxOutstanding_) {
+      if (numOutstanding_.get() >= maxOutstanding_) {
         // We are reusing the baton, so needs to be reset before use.
         // Note that we are supposed to be woken up by another fiber
         // running on the same thread
+        waitingForSlot_ = true;
         baton_.reset();
         baton_.wait();
+        waitingForSlot_ = false;
         XDCHECK_LT(numOutstanding_.get(), maxOutstanding_);
       }
       // Dispatch the Request
       scheduleReq(std::move(req));
     }
 
+    dispatchLowPriReqs();
+
     // Try to unclaim the incomingReqs_ queue
     // If the head is not sentinel as expected, it means that some new requests
     // have been arrived while dispatching previous ones
@@ -106,8 +136,15 @@ void NavyRequestDispatcher::scheduleReq(std::unique_ptr<NavyRequest> req) {
   // Start a new fiber running the given request
   numOutstanding_.inc();
   worker_.addTask([this, rq = std::move(req)]() mutable {
-    while (rq->execute() == JobExitCode::Reschedule) {
-      folly::fibers::yield();
+    if (rq->isExpired(util::getCurrentTimeNs())) {
+      numCancelled_.inc();
+      rq->cancel();
+    } else {
+      // The device IOs of the request are queued by its priority
+      setCurrentRequestPriority(rq->getPriority());
+      while (rq->execute() == JobExitCode::Reschedule) {
+        folly::fibers::yield();
+      }
     }
 
     auto key = rq->getKey();
@@ -120,9 +157,36 @@ void NavyRequestDispatcher::scheduleReq(std::unique_ptr<NavyRequest> req) {
     if (numOutstanding_.get() + 1 == maxOutstanding_) {
       baton_.post();
     }
+    dispatchLowPriReqs();
   });
 }
 
+void NavyRequestDispatcher::dispatchLowPriReqs() {
+  while (!lowPriReqs_.empty() && !waitingForSlot_ &&
+         numOutstanding_.get() < maxLowPriOutstanding_) {
+    auto req = std::move(lowPriReqs_.front());
+    lowPriReqs_.pop_front();
+    numLowPriQueued_.dec();
+    numDispatched_.inc();
+    if (req->isExpired(util::getCurrentTimeNs())) {
+      // No need to take up a slot only to be cancelled
+      cancelReq(std::move(req));
+    } else {
+      scheduleReq(std::move(req));
+    }
+  }
+}
+
+void NavyRequestDispatcher::cancelReq(std::unique_ptr<NavyRequest> req) {
+  numCancelled_.inc();
+  req->cancel();
+  auto key = req->getKey();
+  req.reset();
+
+  scheduler_.notifyCompletion(key);
+  numCompleted_.inc();
+}
+
 void NavyRequestDispatcher::submitReq(std::unique_ptr<NavyRequest> navyReq) {
   XDCHECK(!!navyReq);
   numSubmitted_.inc();
@@ -144,7 +208,11 @@ void NavyRequestDispatcher::submitReq(std::unique_ptr<NavyRequest> navyReq) {
   if (!oldValue) {
     // We were the first one submitting to the queue, so start a fiber
     // running the dispatch loop
-    worker_.addTaskRemote([this]() { processLoop(); });
+    if (worker_.isCurrent()) {
+      worker_.addTask([this]() { processLoop(); });
+    } else {
+      worker_.addTaskRemote([this]() { processLoop(); });
+    }
   }
 }
 
@@ -155,6 +223,8 @@ NavyRequestDispatcher::Stats NavyRequestDispatcher::getStats() {
   stat.numDispatched = numDispatched_.get();
   stat.numCompleted = numCompleted_.get();
   stat.curOutstanding = numOutstanding_.get();
+  stat.numCancelled = numCancelled_.get();
+  stat.curLowPriQueued = numLowPriQueued_.get();
 
   return stat;
 }
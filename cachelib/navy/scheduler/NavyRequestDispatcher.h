@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 
 #include "cachelib/common/AtomicCounter.h"
@@ -41,6 +42,22 @@ class NavyRequest {
         key_(key),
         beginTime_(util::getCurrentTimeNs()) {}
 
+  // @param deadlineNs  steady clock time after which the request is cancelled
+  //                    if it did not start yet. 0 for no deadline.
+  explicit NavyRequest(CancellableJob&& job,
+                       folly::StringPiece name,
+                       JobType type,
+                       uint64_t key,
+                       RequestPriority priority,
+                       uint64_t deadlineNs)
+      : cancellableJob_(std::move(job)),
+        name_(name),
+        type_(type),
+        priority_(priority),
+        key_(key),
+        deadlineNs_(deadlineNs),
+        beginTime_(util::getCurrentTimeNs()) {}
+
   virtual ~NavyRequest() = default;
 
   // Return the type of the job
@@ -49,22 +66,45 @@ class NavyRequest {
   // Return the key of the job
   uint64_t getKey() const { return key_; }
 
+  // Return the priority class of the job
+  RequestPriority getPriority() const { return priority_; }
+
+  // Return true if the deadline of the request passed at @nowNs
+  bool isExpired(uint64_t nowNs) const {
+    return deadlineNs_ != 0 && nowNs > deadlineNs_;
+  }
+
   // Main function to run the request
-  JobExitCode execute() { return job_(); }
+  JobExitCode execute() {
+    return job_ ? job_() : cancellableJob_(false /* cancelled */);
+  }
+
+  // Notify the job that it is cancelled instead of being run
+  void cancel() {
+    XDCHECK(cancellableJob_);
+    cancellableJob_(true /* cancelled */);
+  }
 
   // next_ is a hook used to implement the atomic singly linked list
   NavyRequest* next_ = nullptr;
 
  protected:
+  // Only one of job_ and cancellableJob_ is set
   Job job_;
+  CancellableJob cancellableJob_;
 
   const folly::StringPiece name_;
 
   const JobType type_;
 
+  const RequestPriority priority_{RequestPriority::High};
+
   // Key of the Request
   const uint64_t key_;
 
+  // Steady clock time in ns after which the request is cancelled. 0 for none.
+  const uint64_t deadlineNs_{0};
+
   // Time when the request was scheduled to track the timings
   uint64_t beginTime_;
 };
@@ -79,6 +119,12 @@ class NavyRequest {
 // claims the submission queue by replacing the head of the list with the
 // sentinel value while dispatching. For actual dispatch, the dispatcher task
 // needs to reverse the linked list to submit in FIFO order.
+//
+// Low priority requests are held back in a separate queue and only dispatched
+// while no high priority request is waiting and fewer than half of the
+// maximum outstanding requests are running, so that they can not use up the
+// concurrency high priority requests need. A request whose deadline passed
+// before it was started is cancelled instead.
 class NavyRequestDispatcher {
  public:
   struct Stats {
@@ -92,20 +138,32 @@ class NavyRequestDispatcher {
     uint64_t numCompleted = 0;
     // The number of requests completed
     uint64_t curOutstanding = 0;
+    // The number of requests cancelled because of their deadline
+    uint64_t numCancelled = 0;
+    // The number of low priority requests currently held back
+    uint64_t curLowPriQueued = 0;
   };
 
   // @param scheduler       the parent scheduler to get completion
   // notification
   // @param name            name of the dispatcher
   // @param maxOutstanding  maximum number of concurrently running requests
+  // @param stackSize       size of the fiber stack of a request
+  // @param maxPooledFibers maximum number of idle fibers kept for reuse, 0 for
+  //                        the default
+  // @param cpu             cpu to pin the worker thread to, -1 for none
   NavyRequestDispatcher(JobScheduler& scheduler,
                         folly::StringPiece name,
                         size_t maxOutstanding,
-                        size_t stackSize);
+                        size_t stackSize,
+                        size_t maxPooledFibers = 0,
+                        int32_t cpu = -1);
 
   folly::StringPiece getName() { return name_; }
 
-  // Add a new request to the dispatch queue
+  // Add a new request to the dispatch queue. Submitted from the worker
+  // thread itself, e.g. on the completion of a request, the dispatch loop is
+  // started without waking up the thread through its remote queue.
   void submitReq(std::unique_ptr<NavyRequest> req);
 
   // Wrapper to add task to the worker thread of this dispatcher
@@ -126,6 +184,12 @@ class NavyRequestDispatcher {
   // Actually submit the req to the worker thread
   void scheduleReq(std::unique_ptr<NavyRequest> req);
 
+  // Dispatch the held back low priority requests there is room for
+  void dispatchLowPriReqs();
+
+  // Cancel the req and notify its completion
+  void cancelReq(std::unique_ptr<NavyRequest> req);
+
   // The parent scheduler to get completion notification
   JobScheduler& scheduler_;
   // Name of the dispatcher
@@ -134,6 +198,13 @@ class NavyRequestDispatcher {
   NavyRequest* incomingReqs_{nullptr};
   // Maximum number of outstanding requests
   size_t maxOutstanding_;
+  // Maximum number of outstanding requests to dispatch low priority ones
+  size_t maxLowPriOutstanding_;
+  // Low priority requests waiting to be dispatched. Only accessed by the
+  // fibers of worker_.
+  std::deque<std::unique_ptr<NavyRequest>> lowPriReqs_;
+  // True while the dispatch loop waits for a high priority request slot
+  bool waitingForSlot_{false};
   // Baton used for waiting when limited by maxOutstanding_
   folly::fibers::Baton baton_;
   // Worker thread
@@ -145,6 +216,8 @@ class NavyRequestDispatcher {
   AtomicCounter numDispatched_{0};
   AtomicCounter numOutstanding_{0};
   AtomicCounter numCompleted_{0};
+  AtomicCounter numCancelled_{0};
+  AtomicCounter numLowPriQueued_{0};
 };
 
 } // namespace navy
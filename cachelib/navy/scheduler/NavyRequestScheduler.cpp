@@ -18,6 +18,8 @@
 
 #include <folly/fibers/ForEach.h>
 
+#include <stdexcept>
+
 namespace facebook {
 namespace cachelib {
 namespace navy {
@@ -28,27 +30,46 @@ std::unique_ptr<JobScheduler> createNavyRequestScheduler(
     size_t maxNumReads,
     size_t maxNumWrites,
     size_t stackSize,
-    size_t reqOrderShardPower) {
+    size_t reqOrderShardPower,
+    size_t maxPooledFibers,
+    std::vector<uint32_t> keyAffinityCpus) {
   return std::make_unique<NavyRequestScheduler>(numReaderThreads,
                                                 numWriterThreads,
                                                 maxNumReads,
                                                 maxNumWrites,
                                                 stackSize,
-                                                reqOrderShardPower);
+                                                reqOrderShardPower,
+                                                maxPooledFibers,
+                                                std::move(keyAffinityCpus));
 }
 
-NavyRequestScheduler::NavyRequestScheduler(size_t numReaderThreads,
-                                           size_t numWriterThreads,
-                                           size_t maxNumReads,
-                                           size_t maxNumWrites,
-                                           size_t stackSize,
-                                           size_t numShardsPower)
+NavyRequestScheduler::NavyRequestScheduler(
+    size_t numReaderThreads,
+    size_t numWriterThreads,
+    size_t maxNumReads,
+    size_t maxNumWrites,
+    size_t stackSize,
+    size_t numShardsPower,
+    size_t maxPooledFibers,
+    std::vector<uint32_t> keyAffinityCpus)
     : numReaderThreads_(numReaderThreads),
       numWriterThreads_(numWriterThreads),
       numShards_(1ULL << numShardsPower),
       mutexes_(numShards_),
       pendingReqs_(numShards_),
       shouldSpool_(numShards_, false) {
+  if (!keyAffinityCpus.empty() &&
+      (numReaderThreads_ != keyAffinityCpus.size() ||
+       numWriterThreads_ != keyAffinityCpus.size())) {
+    throw std::invalid_argument(fmt::format(
+        "{} reader and {} writer threads do not match {} key affinity cpus",
+        numReaderThreads_, numWriterThreads_, keyAffinityCpus.size()));
+  }
+  auto getCpu = [&keyAffinityCpus](size_t i) {
+    return keyAffinityCpus.empty() ? -1
+                                   : static_cast<int32_t>(keyAffinityCpus[i]);
+  };
+
   // Adjust the max number of reads and writes if needed
   maxNumReads = std::max(maxNumReads, numReaderThreads);
   maxNumWrites = std::max(maxNumWrites, numWriterThreads);
@@ -56,14 +77,16 @@ NavyRequestScheduler::NavyRequestScheduler(size_t numReaderThreads,
   for (size_t i = 0; i < numReaderThreads_; i++) {
     auto dispatcher = std::make_shared<NavyRequestDispatcher>(
         *this, fmt::format("navy_reader_{}", i),
-        maxNumReads / numReaderThreads_, stackSize);
+        maxNumReads / numReaderThreads_, stackSize, maxPooledFibers,
+        getCpu(i));
     readerDispatchers_.emplace_back(std::move(dispatcher));
   }
 
   for (size_t i = 0; i < numWriterThreads_; i++) {
     auto dispatcher = std::make_shared<NavyRequestDispatcher>(
         *this, fmt::format("navy_writer_{}", i),
-        maxNumWrites / numWriterThreads_, stackSize);
+        maxNumWrites / numWriterThreads_, stackSize, maxPooledFibers,
+        getCpu(i));
     writerDispatchers_.emplace_back(std::move(dispatcher));
   }
 
@@ -105,7 +128,24 @@ void NavyRequestScheduler::enqueueWithKey(Job job,
     return;
   }
 
-  auto req = std::make_unique<NavyRequest>(std::move(job), name, type, key);
+  enqueueReq(std::make_unique<NavyRequest>(std::move(job), name, type, key));
+}
+
+void NavyRequestScheduler::enqueueWithPriority(CancellableJob job,
+                                               folly::StringPiece name,
+                                               JobType type,
+                                               uint64_t key,
+                                               RequestPriority priority,
+                                               uint64_t deadlineNs) {
+  if (stopped_) {
+    return;
+  }
+
+  enqueueReq(std::make_unique<NavyRequest>(std::move(job), name, type, key,
+                                           priority, deadlineNs));
+}
+
+void NavyRequestScheduler::enqueueReq(std::unique_ptr<NavyRequest> req) {
   // Allow one request can be outstanding per shard by spooling requests
   // if there is another request already running
   const auto shard = req->getKey() % numShards_;
@@ -158,6 +198,8 @@ void NavyRequestScheduler::getCounters(const CounterVisitor& visitor) const {
         uint64_t numDispatched = 0;
         uint64_t numCompleted = 0;
         uint64_t curOutstanding = 0;
+        uint64_t numCancelled = 0;
+        uint64_t curLowPriQueued = 0;
 
         for (const auto& dispatcher : dispatchers) {
           auto stat = dispatcher->getStats();
@@ -166,6 +208,8 @@ void NavyRequestScheduler::getCounters(const CounterVisitor& visitor) const {
           numDispatched += stat.numDispatched;
           numCompleted += stat.numCompleted;
           curOutstanding += stat.curOutstanding;
+          numCancelled += stat.numCancelled;
+          curLowPriQueued += stat.curLowPriQueued;
         }
 
         auto prefix = fmt::format("navy_jobs.{}_", name);
@@ -178,6 +222,9 @@ void NavyRequestScheduler::getCounters(const CounterVisitor& visitor) const {
         visitor(prefix + "completed", numCompleted,
                 CounterVisitor::CounterType::RATE);
         visitor(prefix + "outstanding", curOutstanding);
+        visitor(prefix + "cancelled", numCancelled,
+                CounterVisitor::CounterType::RATE);
+        visitor(prefix + "low_pri_queued", curLowPriQueued);
       };
 
   visitdispatcherStats(readerDispatchers_, "reader");
@@ -48,12 +48,23 @@ class NavyRequestScheduler : public JobScheduler {
   // @param writerThreads   number of threads for the write scheduler
   // @param numShardsPower  power of two specification for sharding internally
   //                        to avoid contention and queueing
+  // @param maxPooledFibers maximum number of idle fibers every dispatcher
+  //                        keeps for reuse, 0 for the default
+  // @param keyAffinityCpus cpus owning the keys, one reader and one writer
+  //                        thread pinned to each. The reads and writes of a
+  //                        key then run on the same cpu. Empty for no
+  //                        pinning.
+  //
+  // @throw std::invalid_argument if keyAffinityCpus is set and the number
+  //        of reader or writer threads is not its size
   explicit NavyRequestScheduler(size_t numReaderThreads,
                                 size_t numWriterThreads,
                                 size_t maxNumReads,
                                 size_t maxNumWrites,
                                 size_t stackSize,
-                                size_t reqOrderShardPower);
+                                size_t reqOrderShardPower,
+                                size_t maxPooledFibers = 0,
+                                std::vector<uint32_t> keyAffinityCpus = {});
   NavyRequestScheduler(const NavyRequestScheduler&) = delete;
   NavyRequestScheduler& operator=(const NavyRequestScheduler&) = delete;
   ~NavyRequestScheduler() override;
@@ -65,6 +76,16 @@ class NavyRequestScheduler : public JobScheduler {
                       JobType type,
                       uint64_t key) override;
 
+  // Put a job into the queue based on the key hash, with a priority class and
+  // an optional deadline. Ordering with the other jobs of the key is still
+  // guaranteed; the priority applies once the job is dispatched.
+  void enqueueWithPriority(CancellableJob job,
+                           folly::StringPiece name,
+                           JobType type,
+                           uint64_t key,
+                           RequestPriority priority,
+                           uint64_t deadlineNs) override;
+
   // Notify the completion of the request
   void notifyCompletion(uint64_t key) override;
 
@@ -77,12 +98,17 @@ class NavyRequestScheduler : public JobScheduler {
  private:
   void submitSpooledReq(size_t shard);
 
+  // Spool the req or submit it to its dispatcher
+  void enqueueReq(std::unique_ptr<NavyRequest> req);
+
   // check if the contexts are healthy, i.e., the response time is reasonable
   void checkHealth(
       std::vector<std::shared_ptr<NavyRequestDispatcher>>& dispatchers,
       std::vector<NavyRequestDispatcher::Stats>& lastStats);
 
-  // Return the context for the key and type
+  // Return the context for the key and type. With key affinity cpus, the
+  // reader and the writer of a key are on the same cpu since their numbers
+  // are the same.
   NavyRequestDispatcher& getDispatcher(uint64_t keyHash, JobType type) {
     if (type == JobType::Read) {
       return *readerDispatchers_[keyHash % numReaderThreads_];
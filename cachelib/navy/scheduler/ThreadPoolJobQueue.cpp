@@ -16,12 +16,17 @@
 
 #include "cachelib/navy/scheduler/ThreadPoolJobQueue.h"
 
+#include <chrono>
+
 #include "cachelib/common/Utils.h"
 namespace facebook::cachelib::navy {
 
 namespace {
 constexpr uint64_t kHighRescheduleCount = 250;
 constexpr uint64_t kHighRescheduleReportRate = 100;
+// How often an idle worker looks for jobs to steal. Jobs enqueued to a busy
+// queue don't wake up other workers.
+constexpr std::chrono::milliseconds kStealPollInterval{1};
 
 // A scoped unlock, it unlocks the given lock and lock it back when out of scope
 // (destructor).
@@ -70,11 +75,23 @@ void JobQueue::requestStop() {
   }
 }
 
-void JobQueue::process() {
+void JobQueue::process(folly::Range<JobQueue* const*> victims) {
   std::unique_lock<std::mutex> lock{mutex_};
   while (!stop_) {
     if (queue_.empty()) {
-      cv_.wait(lock);
+      if (victims.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      {
+        ScopedUnlock<std::mutex> unlock{lock};
+        if (stealAndRun(victims)) {
+          continue;
+        }
+      }
+      if (queue_.empty() && !stop_) {
+        cv_.wait_for(lock, kStealPollInterval);
+      }
     } else {
       auto entry = std::move(queue_.front());
       queue_.pop_front();
@@ -97,11 +114,7 @@ void JobQueue::process() {
         break;
       }
       case JobExitCode::Done: {
-        jobsDone_++;
-        if (entry.rescheduleCount > 100) {
-          jobsHighReschedule_++;
-        }
-        reschedules_ += entry.rescheduleCount;
+        recordDoneLocked(entry);
         break;
       }
       }
@@ -109,6 +122,67 @@ void JobQueue::process() {
   }
 }
 
+void JobQueue::recordDoneLocked(const QueueEntry& entry) {
+  jobsDone_++;
+  if (entry.rescheduleCount > 100) {
+    jobsHighReschedule_++;
+  }
+  reschedules_ += entry.rescheduleCount;
+}
+
+bool JobQueue::stealAndRun(folly::Range<JobQueue* const*> victims) {
+  // Start from a different victim every time to spread the stealing
+  const auto start = stealCursor_++;
+  for (size_t i = 0; i < victims.size(); i++) {
+    auto* victim = victims[(start + i) % victims.size()];
+    if (victim == this) {
+      continue;
+    }
+    auto entry = victim->steal();
+    if (entry) {
+      auto exitCode = runJob(*entry);
+      victim->finishStolen(std::move(*entry), exitCode);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::optional<JobQueue::QueueEntry> JobQueue::steal() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  // An idle worker gets to its own jobs soon enough
+  if (stop_ || queue_.empty() || processing_ == 0) {
+    return std::nullopt;
+  }
+  auto entry = std::move(queue_.front());
+  queue_.pop_front();
+  stolen_++;
+  jobsStolen_++;
+  return entry;
+}
+
+void JobQueue::finishStolen(QueueEntry entry, JobExitCode exitCode) {
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stolen_--;
+    switch (exitCode) {
+    case JobExitCode::Reschedule: {
+      notify = queue_.empty() && processing_ == 0;
+      queue_.emplace_back(std::move(entry));
+      break;
+    }
+    case JobExitCode::Done: {
+      recordDoneLocked(entry);
+      break;
+    }
+    }
+  }
+  if (notify) {
+    cv_.notify_one();
+  }
+}
+
 JobExitCode JobQueue::runJob(QueueEntry& entry) {
   auto safeJob = [&entry] {
     try {
@@ -149,7 +223,7 @@ JobExitCode JobQueue::runJob(QueueEntry& entry) {
 uint64_t JobQueue::finish() {
   // Busy wait, but used only in tests
   std::unique_lock<std::mutex> lock{mutex_};
-  while (processing_ != 0 || !queue_.empty()) {
+  while (processing_ != 0 || stolen_ != 0 || !queue_.empty()) {
     ScopedUnlock<std::mutex> unlock{lock};
     std::this_thread::yield();
   }
@@ -163,6 +237,7 @@ JobQueue::Stats JobQueue::getStats() const {
   stats.jobsHighReschedule = jobsHighReschedule_;
   stats.reschedules = reschedules_;
   stats.maxQueueLen = maxQueueLen_;
+  stats.jobsStolen = jobsStolen_;
   maxQueueLen_ = queue_.size();
   return stats;
 }
@@ -22,6 +22,7 @@
 #include <condition_variable>
 #include <deque>
 #include <mutex>
+#include <optional>
 
 #include "cachelib/navy/scheduler/JobScheduler.h"
 
@@ -32,6 +33,12 @@ namespace navy {
 // A double ended job queue, job can be pushed in to the beginning or end of
 // queue. The process() function will keep executing the head job (pop it before
 // process) until stop signal received.
+//
+// With victims given to process(), an idle worker steals jobs from the head of
+// the victim queues whose own worker is busy, so that jobs hashed to a busy
+// queue don't wait while other workers are idle. A stolen job still belongs
+// to the victim queue: it is rescheduled there and finish() of the victim
+// waits for it.
 class JobQueue {
  public:
   struct Stats {
@@ -39,6 +46,7 @@ class JobQueue {
     uint64_t jobsHighReschedule{};
     uint64_t reschedules{};
     uint64_t maxQueueLen{};
+    uint64_t jobsStolen{};
   };
 
   enum class QueuePos {
@@ -62,7 +70,9 @@ class JobQueue {
   uint64_t finish();
 
   // Processes queue until stop signal is received
-  void process();
+  // @param victims  queues to steal jobs from when this queue is empty, may
+  //                 contain this queue
+  void process(folly::Range<JobQueue* const*> victims = {});
 
   // Raises stop signal. You can join worker threads after. No more new jobs
   // are admitted to the queue.
@@ -83,6 +93,18 @@ class JobQueue {
 
   JobExitCode runJob(QueueEntry& entry);
 
+  void recordDoneLocked(const QueueEntry& entry);
+
+  // Steals and runs a job from one of the @victims. Returns false if there
+  // was nothing to steal.
+  bool stealAndRun(folly::Range<JobQueue* const*> victims);
+
+  // Takes the head job if the worker of this queue is busy with another one.
+  std::optional<QueueEntry> steal();
+
+  // Called by the thief after running a job taken by steal()
+  void finishStolen(QueueEntry entry, JobExitCode exitCode);
+
   mutable std::mutex mutex_;
   mutable std::condition_variable cv_;
   // Can have several queues and round robin between them to reduce contention
@@ -92,7 +114,12 @@ class JobQueue {
   mutable uint64_t jobsDone_{};
   mutable uint64_t jobsHighReschedule_{};
   mutable uint64_t reschedules_{};
+  mutable uint64_t jobsStolen_{};
   int processing_{};
+  // stolen jobs currently run by other workers
+  int stolen_{};
+  // victim to start the next steal attempt from, only used by the worker
+  size_t stealCursor_{};
   bool stop_{false};
 };
 
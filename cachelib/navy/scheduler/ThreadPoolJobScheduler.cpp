@@ -22,6 +22,7 @@
 
 #include <cassert>
 
+#include "cachelib/common/Time.h"
 #include "cachelib/common/Utils.h"
 
 namespace facebook::cachelib::navy {
@@ -29,23 +30,50 @@ namespace facebook::cachelib::navy {
 std::unique_ptr<JobScheduler> createOrderedThreadPoolJobScheduler(
     unsigned int readerThreads,
     unsigned int writerThreads,
-    unsigned int reqOrderShardPower) {
+    unsigned int reqOrderShardPower,
+    bool workStealing) {
   return std::make_unique<OrderedThreadPoolJobScheduler>(
-      readerThreads, writerThreads, reqOrderShardPower);
+      readerThreads, writerThreads, reqOrderShardPower, workStealing);
+}
+
+void JobScheduler::enqueueWithPriority(CancellableJob job,
+                                       folly::StringPiece name,
+                                       JobType type,
+                                       uint64_t key,
+                                       RequestPriority /* priority */,
+                                       uint64_t deadlineNs) {
+  enqueueWithKey(
+      [job = std::move(job), deadlineNs, started = false]() mutable {
+        if (!started) {
+          started = true;
+          if (deadlineNs && util::getCurrentTimeNs() > deadlineNs) {
+            return job(true /* cancelled */);
+          }
+        }
+        return job(false /* cancelled */);
+      },
+      name, type, key);
 }
 
 ThreadPoolExecutor::ThreadPoolExecutor(uint32_t numThreads,
-                                       folly::StringPiece name)
+                                       folly::StringPiece name,
+                                       bool workStealing)
     : name_{name}, queues_(numThreads) {
   XDCHECK_GT(numThreads, 0u);
-  workers_.reserve(numThreads);
   for (uint32_t i = 0; i < numThreads; i++) {
     queues_[i] = std::make_unique<JobQueue>();
+    if (workStealing && numThreads > 1) {
+      victims_.push_back(queues_[i].get());
+    }
+  }
+  workers_.reserve(numThreads);
+  for (uint32_t i = 0; i < numThreads; i++) {
     workers_.emplace_back(
         [&q = queues_[i],
+         victims = folly::range(victims_),
          threadName = folly::sformat("navy_{}_{}", name.subpiece(0, 6), i)] {
           folly::setThreadName(threadName);
-          q->process();
+          q->process(victims);
         });
   }
 }
@@ -86,14 +114,16 @@ ThreadPoolExecutor::Stats ThreadPoolExecutor::getStats() const {
     stats.reschedules += js.reschedules;
     stats.maxQueueLen = std::max(stats.maxQueueLen, js.maxQueueLen);
     stats.maxPendingJobs += js.maxQueueLen;
+    stats.jobsStolen += js.jobsStolen;
   }
   return stats;
 }
 
 ThreadPoolJobScheduler::ThreadPoolJobScheduler(uint32_t readerThreads,
-                                               uint32_t writerThreads)
-    : reader_(readerThreads, "reader_pool"),
-      writer_(writerThreads, "writer_pool") {}
+                                               uint32_t writerThreads,
+                                               bool workStealing)
+    : reader_(readerThreads, "reader_pool", workStealing),
+      writer_(writerThreads, "writer_pool", workStealing) {}
 
 void ThreadPoolJobScheduler::enqueueWithKey(Job job,
                                             folly::StringPiece name,
@@ -145,11 +175,13 @@ void ThreadPoolJobScheduler::getCounters(const CounterVisitor& visitor) const {
     const std::string jobsDone = folly::sformat("navy_{}_jobs_done", name);
     const std::string maxPendingJobs =
         folly::sformat("navy_max_{}_pending_jobs", name);
+    const std::string jobsStolen = folly::sformat("navy_{}_jobs_stolen", name);
     visitor(maxQueueLen, stats.maxQueueLen);
     visitor(reschedules, stats.reschedules, CounterVisitor::CounterType::RATE);
     visitor(highReschedules, stats.jobsHighReschedule);
     visitor(jobsDone, stats.jobsDone, CounterVisitor::CounterType::RATE);
     visitor(maxPendingJobs, stats.maxPendingJobs);
+    visitor(jobsStolen, stats.jobsStolen, CounterVisitor::CounterType::RATE);
   };
   getStats(reader_.getStats(), reader_.getName());
   getStats(writer_.getStats(), writer_.getName());
@@ -160,12 +192,15 @@ constexpr size_t numShards(size_t power) { return 1ULL << power; }
 } // namespace
 
 OrderedThreadPoolJobScheduler::OrderedThreadPoolJobScheduler(
-    size_t readerThreads, size_t writerThreads, size_t numShardsPower)
+    size_t readerThreads,
+    size_t writerThreads,
+    size_t numShardsPower,
+    bool workStealing)
     : mutexes_(numShards(numShardsPower)),
       pendingJobs_(numShards(numShardsPower)),
       shouldSpool_(numShards(numShardsPower), false),
       numShardsPower_(numShardsPower),
-      scheduler_(readerThreads, writerThreads) {}
+      scheduler_(readerThreads, writerThreads, workStealing) {}
 
 void OrderedThreadPoolJobScheduler::enqueueWithKey(Job job,
                                                    folly::StringPiece name,
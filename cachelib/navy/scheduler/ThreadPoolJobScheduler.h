@@ -38,11 +38,16 @@ class ThreadPoolExecutor {
     uint64_t reschedules{};
     uint64_t maxQueueLen{};
     uint64_t maxPendingJobs{};
+    uint64_t jobsStolen{};
   };
 
-  // @param numThreads  number of threads for the executor
-  // @param name        name for debugging
-  ThreadPoolExecutor(uint32_t numThreads, folly::StringPiece name);
+  // @param numThreads    number of threads for the executor
+  // @param name          name for debugging
+  // @param workStealing  whether idle threads steal jobs from the queues of
+  //                      busy ones. Jobs of a key may then run on any thread.
+  ThreadPoolExecutor(uint32_t numThreads,
+                     folly::StringPiece name,
+                     bool workStealing = false);
 
   // put a job into the a specific queue in pool based on the key hash
   // @param job   the job to be executed
@@ -69,6 +74,8 @@ class ThreadPoolExecutor {
  private:
   const folly::StringPiece name_{};
   std::vector<std::unique_ptr<JobQueue>> queues_;
+  // the queues workers steal from, empty without work stealing
+  std::vector<JobQueue*> victims_;
   std::vector<std::thread> workers_;
 };
 
@@ -77,8 +84,10 @@ class ThreadPoolJobScheduler final : public JobScheduler {
  public:
   // @param readerThreads   number of threads for the read scheduler
   // @param writerThreads   number of threads for the write scheduler
+  // @param workStealing    whether idle threads steal jobs of busy ones
   explicit ThreadPoolJobScheduler(uint32_t readerThreads,
-                                  uint32_t writerThreads);
+                                  uint32_t writerThreads,
+                                  bool workStealing = false);
   ThreadPoolJobScheduler(const ThreadPoolJobScheduler&) = delete;
   ThreadPoolJobScheduler& operator=(const ThreadPoolJobScheduler&) = delete;
   ~ThreadPoolJobScheduler() override { join(); }
@@ -116,9 +125,13 @@ class OrderedThreadPoolJobScheduler final : public JobScheduler {
   // @param writerThreads   number of threads for the write scheduler
   // @param numShardsPower  power of two specification for sharding internally
   //                        to avoid contention and queueing
+  // @param workStealing    whether idle threads steal jobs of busy ones. This
+  //                        keeps the ordering since at most one job of a shard
+  //                        is in the thread pool at a time.
   explicit OrderedThreadPoolJobScheduler(size_t readerThreads,
                                          size_t writerThreads,
-                                         size_t numShardsPower);
+                                         size_t numShardsPower,
+                                         bool workStealing = false);
   OrderedThreadPoolJobScheduler(const OrderedThreadPoolJobScheduler&) = delete;
   OrderedThreadPoolJobScheduler& operator=(
       const OrderedThreadPoolJobScheduler&) = delete;
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sched.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cachelib/common/Time.h"
+#include "cachelib/navy/common/NavyThread.h"
+#include "cachelib/navy/scheduler/NavyRequestScheduler.h"
+
+namespace facebook::cachelib::navy::tests {
+namespace {
+void spinWait(std::atomic<int>& ai, int target) {
+  while (ai.load(std::memory_order_acquire) != target) {
+    std::this_thread::yield();
+  }
+}
+} // namespace
+
+TEST(NavyRequestScheduler, PriorityOrder) {
+  // a single reader with a single outstanding request
+  NavyRequestScheduler scheduler{1, 1, 1, 1, 64 * 1024, 10};
+
+  std::atomic<int> ai{0};
+  std::mutex m;
+  std::vector<uint64_t> order;
+  std::vector<RequestPriority> priorities;
+  auto job = [&](uint64_t key) {
+    return [&, key](bool cancelled) {
+      EXPECT_FALSE(cancelled);
+      std::lock_guard<std::mutex> l(m);
+      order.push_back(key);
+      priorities.push_back(getCurrentRequestPriority());
+      return JobExitCode::Done;
+    };
+  };
+
+  // block the reader so that the next requests are dispatched together
+  scheduler.enqueueWithKey(
+      [&ai]() {
+        ai.store(1, std::memory_order_release);
+        spinWait(ai, 2);
+        return JobExitCode::Done;
+      },
+      "block",
+      JobType::Read,
+      0);
+  spinWait(ai, 1);
+  scheduler.enqueueWithPriority(job(1), "low", JobType::Read, 1,
+                                RequestPriority::Low, 0);
+  scheduler.enqueueWithPriority(job(2), "high", JobType::Read, 2,
+                                RequestPriority::High, 0);
+  ai.store(2, std::memory_order_release);
+  scheduler.finish();
+
+  // the high priority request went first even though it was enqueued last
+  std::lock_guard<std::mutex> l(m);
+  EXPECT_EQ((std::vector<uint64_t>{2, 1}), order);
+  EXPECT_EQ((std::vector<RequestPriority>{RequestPriority::High,
+                                          RequestPriority::Low}),
+            priorities);
+}
+
+TEST(NavyRequestScheduler, Deadline) {
+  NavyRequestScheduler scheduler{1, 1, 1, 1, 64 * 1024, 10};
+
+  std::atomic<int> numCancelled{0};
+  std::atomic<int> numRun{0};
+  auto job = [&](bool cancelled) {
+    (cancelled ? numCancelled : numRun)++;
+    return JobExitCode::Done;
+  };
+
+  const auto expired = util::getCurrentTimeNs() - 1;
+  const auto future = util::getCurrentTimeNs() + 3600'000'000'000ULL;
+  for (auto priority : {RequestPriority::High, RequestPriority::Low}) {
+    scheduler.enqueueWithPriority(job, "expired", JobType::Read, 1, priority,
+                                  expired);
+    scheduler.enqueueWithPriority(job, "future", JobType::Read, 2, priority,
+                                  future);
+    scheduler.enqueueWithPriority(job, "none", JobType::Read, 3, priority, 0);
+  }
+  scheduler.finish();
+  EXPECT_EQ(2, numCancelled);
+  EXPECT_EQ(4, numRun);
+
+  uint64_t cancelled = 0;
+  scheduler.getCounters({[&](folly::StringPiece name, double stat) {
+    if (name == "navy_jobs.reader_cancelled") {
+      cancelled = static_cast<uint64_t>(stat);
+    }
+  }});
+  EXPECT_EQ(2, cancelled);
+}
+
+TEST(NavyRequestScheduler, KeyAffinity) {
+  // the reader and the writer threads must be one per cpu
+  EXPECT_THROW(NavyRequestScheduler(2, 1, 2, 2, 64 * 1024, 10, 0, {0, 0}),
+               std::invalid_argument);
+
+  NavyRequestScheduler scheduler{2, 2, 4, 4, 64 * 1024, 10, 0, {0, 0}};
+  std::atomic<int> numRun{0};
+  std::atomic<int> numOffCpu{0};
+  auto job = [&]() {
+    if (sched_getcpu() != 0) {
+      numOffCpu++;
+    }
+    numRun++;
+    return JobExitCode::Done;
+  };
+
+  // reads and writes of the same keys, some spooled behind each other
+  for (uint64_t key = 0; key < 100; key++) {
+    scheduler.enqueueWithKey(job, "read", JobType::Read, key);
+    scheduler.enqueueWithKey(job, "write", JobType::Write, key);
+  }
+  spinWait(numRun, 200);
+  EXPECT_EQ(0, numOffCpu);
+}
+} // namespace facebook::cachelib::navy::tests
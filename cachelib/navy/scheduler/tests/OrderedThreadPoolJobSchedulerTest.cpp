@@ -291,4 +291,34 @@ TEST(OrderedThreadPoolJobScheduler, OrderedEnqueueMaxLen) {
   EXPECT_EQ(numCompleted, numKeys);
 }
 
+// jobs of a key keep their order while jobs of other keys are stolen from
+// behind them.
+TEST(OrderedThreadPoolJobScheduler, OrderedWorkStealing) {
+  SeqPoints sp;
+  sp.setName(0, "other key done");
+  std::vector<int> order;
+  OrderedThreadPoolJobScheduler scheduler{2, 1, 2, true /* workStealing */};
+  // keys 0 and 2 are on the same thread, but in different ordering shards
+  for (int i = 0; i < 3; i++) {
+    scheduler.enqueueWithKey(
+        [&sp, &order, i]() {
+          if (i == 0) {
+            sp.wait(0);
+          }
+          order.push_back(i);
+          return JobExitCode::Done;
+        },
+        "", JobType::Read, 0);
+  }
+  scheduler.enqueueWithKey(
+      [&sp]() {
+        sp.reached(0);
+        return JobExitCode::Done;
+      },
+      "", JobType::Read, 2);
+
+  scheduler.finish();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
 } // namespace facebook::cachelib::navy::tests
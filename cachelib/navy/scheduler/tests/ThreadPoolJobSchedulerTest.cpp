@@ -232,4 +232,57 @@ TEST(ThreadPoolJobScheduler, MaxQueueLen) {
   EXPECT_EQ(jobsDone, numToQueue);
 }
 
+TEST(ThreadPoolJobScheduler, EnqueueWithPriority) {
+  ThreadPoolJobScheduler scheduler{1, 1};
+  std::atomic<int> numCancelled{0};
+  std::atomic<int> numRun{0};
+  auto job = [&](bool cancelled) {
+    (cancelled ? numCancelled : numRun)++;
+    return JobExitCode::Done;
+  };
+
+  // the priority is ignored, but an expired job is still cancelled
+  scheduler.enqueueWithPriority(job, "expired", JobType::Read, 0,
+                                RequestPriority::Low, 1);
+  scheduler.enqueueWithPriority(job, "none", JobType::Read, 0,
+                                RequestPriority::Low, 0);
+  scheduler.finish();
+  EXPECT_EQ(1, numCancelled);
+  EXPECT_EQ(1, numRun);
+}
+
+// A job queued behind a blocked job is run by the idle thread
+TEST(ThreadPoolJobScheduler, WorkStealing) {
+  SeqPoints sp;
+  sp.setName(0, "stolen job done");
+  ThreadPoolJobScheduler scheduler{2, 1, true /* workStealing */};
+  std::atomic<int> numDone{0};
+  scheduler.enqueueWithKey(
+      [&] {
+        sp.wait(0);
+        ++numDone;
+        return JobExitCode::Done;
+      },
+      "blocked", JobType::Read, 0);
+  scheduler.enqueueWithKey(
+      [&] {
+        ++numDone;
+        sp.reached(0);
+        return JobExitCode::Done;
+      },
+      "stolen", JobType::Read, 0);
+
+  scheduler.finish();
+  EXPECT_EQ(2, numDone);
+
+  bool checked = false;
+  scheduler.getCounters({[&](folly::StringPiece name, double stat) {
+    if (name == "navy_reader_pool_jobs_stolen") {
+      EXPECT_EQ(1, stat);
+      checked = true;
+    }
+  }});
+  EXPECT_TRUE(checked);
+}
+
 } // namespace facebook::cachelib::navy::tests
@@ -40,24 +40,39 @@ class FileRecordWriter final : public RecordWriter {
   folly::RecordIOWriter writer_;
 };
 
+// Returns the records as views of the mapped file instead of copies. Every
+// record keeps the file mapped until it is released.
 class FileRecordReader final : public RecordReader {
  public:
   explicit FileRecordReader(int fd)
-      : reader_{folly::File(fd)}, curr_{reader_.seek(0)} {}
+      : reader_{std::make_shared<folly::RecordIOReader>(folly::File(fd))},
+        curr_{reader_->seek(0)} {}
   explicit FileRecordReader(folly::File file)
-      : reader_{std::move(file)}, curr_{reader_.seek(0)} {}
+      : reader_{std::make_shared<folly::RecordIOReader>(std::move(file))},
+        curr_{reader_->seek(0)} {}
   ~FileRecordReader() override = default;
 
   std::unique_ptr<folly::IOBuf> readRecord() override {
-    auto buf = folly::IOBuf::copyBuffer(curr_->first);
+    auto record = curr_->first;
     ++curr_;
+    auto buf = folly::IOBuf::takeOwnership(
+        const_cast<uint8_t*>(record.data()),
+        record.size(),
+        [](void*, void* userData) {
+          delete static_cast<std::shared_ptr<folly::RecordIOReader>*>(
+              userData);
+        },
+        new std::shared_ptr<folly::RecordIOReader>(reader_));
+    // The mapping is read-only: whoever wants to modify the record has to
+    // unshare it first.
+    buf->markExternallySharedOne();
     return buf;
   }
 
-  bool isEnd() const override { return curr_ == reader_.end(); }
+  bool isEnd() const override { return curr_ == reader_->end(); }
 
  private:
-  folly::RecordIOReader reader_;
+  std::shared_ptr<folly::RecordIOReader> reader_;
   folly::RecordIOReader::Iterator curr_;
 };
 
@@ -166,110 +181,115 @@ class DeviceMetaDataWriter final : public RecordWriter {
   Buffer buffer_{blockSize_, blockSize_};
 };
 
+// Reads the metadata in windows of kReadWindowSize bytes instead of one block
+// at a time. The records that fit in a window are returned as views of it;
+// a window is only freed once all of its records are released.
 class DeviceMetaDataReader final : public RecordReader {
  public:
   explicit DeviceMetaDataReader(Device& dev, size_t metadataSize)
       : dev_{dev},
-        metadataSize_{metadataSize},
         blockSize_{dev_.getIOAlignmentSize() >= kBlockSizeDefault
                        ? dev_.getIOAlignmentSize()
-                       : kBlockSizeDefault} {}
+                       : kBlockSizeDefault},
+        // the writer only writes whole blocks
+        readableSize_{metadataSize / blockSize_ * blockSize_} {}
   ~DeviceMetaDataReader() override = default;
 
   std::unique_ptr<folly::IOBuf> readRecord() override {
-    bool readHeader = true;
-    std::unique_ptr<folly::IOBuf> buf = nullptr;
-    uint8_t* bufferData = buffer_.data();
-    uint64_t size = 0;
-    uint8_t* data = nullptr;
-    auto dataOffset = 0;
-
-    do {
-      // This is true when we have to read a header and there are not
-      // enough bytes in the buffer OR we have to read the next block
-      // in the multi-block read
-      if (bufIndex_ + headerSize() > blockSize_) {
-        // read new block from the device if the number of bytes left from
-        // previous read are less than header size.
-        if (offset_ + blockSize_ > metadataSize_) {
-          throw std::logic_error("exceeding metadata limit");
-        }
-        // read from device to the middle of the buffer 'kReadOffset'
-        if (!dev_.read(offset_, blockSize_, bufferData)) {
-          throw std::invalid_argument(
-              folly::sformat("read failed: offset = {}", offset_));
-        }
-        offset_ += blockSize_;
-        bufIndex_ = 0;
-      }
-
-      // Parse the header if we are expecting header
-      if (readHeader) {
-        readHeader = false;
-        auto valid = validateRecordHeader(
-            folly::Range<unsigned char*>(&bufferData[bufIndex_],
-                                         blockSize_ - bufIndex_),
-            kMetadataHeaderFileId);
-        if (!valid) {
-          throw std::logic_error("Invalid record header");
-        }
+    skipToHeader();
+    const auto* header = readHeader();
+    if (header == nullptr) {
+      throw std::logic_error("Invalid record header");
+    }
+    const uint64_t size = headerSize() + header->dataLength;
+    const uint8_t* data = view(offset_, size);
 
-        recordio_detail::Header* h =
-            reinterpret_cast<recordio_detail::Header*>(&bufferData[bufIndex_]);
-        size = headerSize() + h->dataLength;
-        // copy the header also to IOBuf so that we can do validation
-        buf = folly::IOBuf::create(size);
-        if (buf == nullptr) {
-          return nullptr;
-        }
-        buf->append(size);
-        data = buf->writableData();
-        dataOffset = 0;
-      }
-      auto cpSize =
-          std::min(static_cast<uint64_t>(blockSize_ - bufIndex_), size);
-      memcpy(data + dataOffset, &bufferData[bufIndex_], cpSize);
-      bufIndex_ += cpSize;
-      dataOffset += cpSize;
-      size -= cpSize;
-    } while (size > 0);
-    // Validate the what we just read from the device
-    auto record =
-        validateRecordData(folly::Range<unsigned char*>(data, buf->length()));
+    auto record = validateRecordData(folly::ByteRange(data, size));
     if (record.fileId == 0) {
       throw std::invalid_argument(folly::sformat(
-          "Invalid record : offset = {}, length = {}", offset_, buf->length()));
+          "Invalid record : offset = {}, length = {}", offset_, size));
     }
-    // skip the header part and return
-    buf->trimStart(headerSize());
-
+    auto buf = window_->cloneOne();
+    buf->trimStart(offset_ - windowOffset_ + headerSize());
+    buf->trimEnd(buf->length() - header->dataLength);
+    offset_ += size;
     return buf;
   }
 
   bool isEnd() const override {
-    Buffer headerBuf{blockSize_, blockSize_};
-    if (offset_ + blockSize_ > metadataSize_) {
+    skipToHeader();
+    try {
+      return readHeader() == nullptr;
+    } catch (const std::exception&) {
       return true;
     }
-    auto res = dev_.read(offset_, blockSize_, headerBuf.data());
-    if (!res) {
-      return true;
+  }
+
+ private:
+  static constexpr size_t kBlockSizeDefault = 4096;
+  static constexpr size_t kReadWindowSize = 1024 * 1024;
+
+  // A header never straddles blocks, the writer moves it to the next block
+  void skipToHeader() const {
+    const auto inBlock = offset_ % blockSize_;
+    if (inBlock + headerSize() > blockSize_) {
+      offset_ += blockSize_ - inBlock;
     }
+  }
+
+  // @return the header at offset_, or nullptr if there is no valid one
+  const recordio_detail::Header* readHeader() const {
+    const auto* data = view(offset_, headerSize());
     auto valid = validateRecordHeader(
-        folly::Range<unsigned char*>(headerBuf.data(), blockSize_),
+        folly::ByteRange(data, windowOffset_ + window_->length() - offset_),
         kMetadataHeaderFileId);
+    return valid ? reinterpret_cast<const recordio_detail::Header*>(data)
+                 : nullptr;
+  }
 
-    return !valid;
+  // Reads a new window if [@offset, @offset + @size) is not in the current
+  // one.
+  //
+  // @return the address of @offset in the window
+  // @throw std::logic_error if the range goes beyond the metadata
+  const uint8_t* view(uint64_t offset, uint64_t size) const {
+    if (window_ && offset >= windowOffset_ &&
+        offset + size <= windowOffset_ + window_->length()) {
+      return window_->data() + (offset - windowOffset_);
+    }
+    const uint64_t start = offset / blockSize_ * blockSize_;
+    const uint64_t needed =
+        (offset + size - start + blockSize_ - 1) / blockSize_ * blockSize_;
+    if (start + needed > readableSize_) {
+      throw std::logic_error("exceeding metadata limit");
+    }
+    const uint64_t length = std::min<uint64_t>(
+        std::max<uint64_t>(needed, kReadWindowSize), readableSize_ - start);
+
+    auto* buffer = new Buffer{dev_.makeIOBuffer(length)};
+    auto window = folly::IOBuf::takeOwnership(
+        buffer->data(),
+        buffer->size(),
+        [](void*, void* userData) { delete static_cast<Buffer*>(userData); },
+        buffer);
+    if (!dev_.read(start, static_cast<uint32_t>(length),
+                   window->writableData())) {
+      throw std::invalid_argument(
+          folly::sformat("read failed: offset = {}", start));
+    }
+    window_ = std::move(window);
+    windowOffset_ = start;
+    return window_->data() + (offset - windowOffset_);
   }
 
- private:
-  static constexpr size_t kBlockSizeDefault = 4096;
   Device& dev_;
-  size_t metadataSize_;
   const size_t blockSize_;
-  uint64_t offset_{0};
-  uint64_t bufIndex_{blockSize_};
-  Buffer buffer_{blockSize_, blockSize_};
+  const uint64_t readableSize_;
+  // device offset of the next record
+  mutable uint64_t offset_{0};
+  // the last window read and its device offset
+  mutable std::unique_ptr<folly::IOBuf> window_;
+  mutable uint64_t windowOffset_{0};
 };
 
 } // namespace
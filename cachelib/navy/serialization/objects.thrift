@@ -29,6 +29,15 @@ struct IndexBucket {
   2: list<IndexEntry> entries;
 }
 
+// Precedes the IndexBucket records of a checkpoint in the index checkpoint
+// file, one record per bucket in bucketIds.
+struct IndexCheckpointHeader {
+  1: i64 generation = 0;
+  // A full checkpoint holds every bucket, a delta only the changed ones
+  2: bool full = false;
+  3: list<i32> bucketIds;
+}
+
 struct Region {
   1: i32 regionId = 0;
   2: i32 lastEntryEndOffset = 0;
@@ -80,6 +89,10 @@ struct BlockCacheConfig {
   9: i64 holeSizeTotal = 0;
   10: bool reinsertionPolicyEnabled = false;
   11: i64 usedSizeBytes = 0;
+  12: i64 fixedSizeIndexBuckets = 0;
+  // Generation of the last checkpoint of the index file, 0 if the index is
+  // persisted with the rest of the metadata
+  13: i64 indexCheckpointGeneration = 0;
 }
 
 struct ValidBucketCheckerState {
@@ -99,4 +112,5 @@ struct BigHashPersistentData {
   7: map<i64, i64> deprecated_sizeDist;
   8: i64 usedSizeBytes = 0;
   9: ValidBucketCheckerState validBucketCheckerState;
+  10: bool twoChoiceHashing = false;
 }
@@ -72,6 +72,18 @@ TEST(RecordIO, File) {
   checkRecords(*rr);
 }
 
+TEST(RecordIO, FileRecordOutlivesReader) {
+  folly::File tmp = folly::File::temporary();
+  auto rw = createFileRecordWriter(tmp.dup());
+  writeRecords(*rw);
+  auto rr = createFileRecordReader(tmp.dup());
+  auto rec = rr->readRecord();
+  rr.reset();
+  // the record is a view of the file, kept mapped by the record
+  EXPECT_TRUE(rec->isShared());
+  EXPECT_TRUE(ioBufEquals(*rec, "cat"));
+}
+
 TEST(RecordIO, Memory) {
   folly::IOBufQueue ioq;
   auto rw = createMemoryRecordWriter(ioq);
@@ -207,4 +219,38 @@ TEST(RecordIO, MemoryDeviceVariousPayloads) {
   }
 }
 
+// Many records spanning several read windows of the reader, with isEnd()
+// checked between records in the middle of blocks
+TEST(RecordIO, MemoryDeviceManyRecords) {
+  constexpr uint32_t metadataSize = 16 * 1024 * 1024;
+  constexpr uint32_t nRecords = 10000;
+  auto dev = createMemoryDevice(metadataSize, nullptr /* encryption */, 4096);
+  auto recordSize = [](uint32_t i) { return 1 + (i * 7919) % 1500; };
+  {
+    auto rw = createMetadataRecordWriter(*dev, metadataSize);
+    for (uint32_t i = 0; i < nRecords; i++) {
+      auto wbuf = folly::IOBuf::create(recordSize(i));
+      wbuf->append(recordSize(i));
+      memset(wbuf->writableData(), 'A' + i % 26, recordSize(i));
+      rw->writeRecord(std::move(wbuf));
+    }
+  }
+
+  auto rr = createMetadataRecordReader(*dev, metadataSize);
+  std::vector<std::unique_ptr<folly::IOBuf>> records;
+  for (uint32_t i = 0; i < nRecords; i++) {
+    ASSERT_FALSE(rr->isEnd());
+    records.push_back(rr->readRecord());
+  }
+  EXPECT_TRUE(rr->isEnd());
+  rr.reset();
+  // the records stay valid after the reader and its windows are gone
+  for (uint32_t i = 0; i < nRecords; i++) {
+    ASSERT_EQ(recordSize(i), records[i]->length());
+    for (uint32_t k = 0; k < recordSize(i); k++) {
+      ASSERT_EQ('A' + i % 26, records[i]->data()[k]);
+    }
+  }
+}
+
 } // namespace facebook::cachelib::navy::tests
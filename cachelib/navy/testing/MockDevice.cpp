@@ -52,6 +52,9 @@ MockDevice::MockDevice(uint64_t deviceSize,
   ON_CALL(*this, allocatePlacementHandle()).WillByDefault(testing::Invoke([]() {
     return -1;
   }));
+
+  ON_CALL(*this, isDegraded(testing::_, testing::_))
+      .WillByDefault(testing::Return(false));
 }
 } // namespace navy
 } // namespace cachelib
@@ -19,6 +19,7 @@
 #include <folly/ScopeGuard.h>
 #include <folly/logging/xlog.h>
 
+#include <algorithm>
 #include <any>
 #include <atomic>
 #include <memory>
@@ -27,19 +28,25 @@
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/common/EventInterface.h"
+#include "cachelib/common/Mutex.h"
 #include "cachelib/common/Serialization.h"
 #include "cachelib/common/Time.h"
+#include "cachelib/navy/engine/Engine.h"
 #include "cachelib/object_cache/ObjectCacheBase.h"
 #include "cachelib/object_cache/ObjectCacheConfig.h"
 #include "cachelib/object_cache/ObjectCacheSizeController.h"
 #include "cachelib/object_cache/ObjectCacheSizeDistTracker.h"
 #include "cachelib/object_cache/persistence/Persistence.h"
 #include "cachelib/object_cache/persistence/gen-cpp2/persistent_data_types.h"
+#include "cachelib/object_cache/util/ArenaObject.h"
+#include "cachelib/object_cache/util/ObjectMemoryResource.h"
 #include "cachelib/object_cache/util/ThreadMemoryTracker.h"
 
 namespace facebook::cachelib::objcache2 {
@@ -101,6 +108,12 @@ struct ObjectCacheDestructorData {
   uint32_t lastAccessTime;
 };
 
+// The eviction policy is the one of AllocatorT, e.g. ObjectCache<LruAllocator>,
+// ObjectCache<Lru2QAllocator>, ObjectCache<TinyLFUAllocator> or
+// ObjectCache<SieveAllocator>, and is configured through
+// ObjectCacheConfig::setEvictionPolicyConfig. With size-awareness enabled,
+// the size controller bounds the number of entries so that the total object
+// size stays within the limit, and the policy picks the objects to evict.
 template <typename AllocatorT>
 class ObjectCache : public ObjectCacheBase<AllocatorT> {
  private:
@@ -145,6 +158,72 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   };
 
  public:
+  // Move-only handle to a read-only object, returned by findFast. Like the
+  // shared_ptr returned by find, it holds the item handle so the object is
+  // not destroyed while the handle is alive, but it does not allocate.
+  template <typename T>
+  class ObjectHandle {
+   public:
+    using ReadHandle = typename AllocatorT::ReadHandle;
+
+    ObjectHandle() = default;
+    /* implicit */ ObjectHandle(std::nullptr_t) {}
+
+    ObjectHandle(ObjectHandle&& other) noexcept
+        : hdl_(std::move(other.hdl_)),
+          ptr_(std::exchange(other.ptr_, nullptr)) {}
+    ObjectHandle& operator=(ObjectHandle&& other) noexcept {
+      if (this != &other) {
+        hdl_ = std::move(other.hdl_);
+        ptr_ = std::exchange(other.ptr_, nullptr);
+      }
+      return *this;
+    }
+
+    ObjectHandle(const ObjectHandle&) = delete;
+    ObjectHandle& operator=(const ObjectHandle&) = delete;
+
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    const T* get() const noexcept { return ptr_; }
+
+    const T& operator*() const noexcept {
+      XDCHECK(ptr_ != nullptr);
+      return *ptr_;
+    }
+
+    const T* operator->() const noexcept {
+      XDCHECK(ptr_ != nullptr);
+      return ptr_;
+    }
+
+    const ReadHandle& viewReadHandle() const { return hdl_; }
+
+    void reset() {
+      hdl_.reset();
+      ptr_ = nullptr;
+    }
+
+    // Convert to the shared_ptr returned by find, e.g. to use the APIs that
+    // take one. This allocates the control block of the shared_ptr.
+    std::shared_ptr<const T> toSharedPtr() && {
+      if (ptr_ == nullptr) {
+        return nullptr;
+      }
+      auto* ptr = std::exchange(ptr_, nullptr);
+      return std::shared_ptr<const T>(ptr, Deleter<const T>(std::move(hdl_)));
+    }
+
+   private:
+    ObjectHandle(ReadHandle&& hdl, const T* ptr)
+        : hdl_(std::move(hdl)), ptr_(ptr) {}
+
+    ReadHandle hdl_{};
+    const T* ptr_{nullptr};
+
+    friend ObjectCache<AllocatorT>;
+  };
+
   using ItemDestructor = std::function<void(ObjectCacheDestructorData)>;
   using Key = KAllocation::Key;
   using Config = ObjectCacheConfig<ObjectCache<AllocatorT>>;
@@ -159,7 +238,12 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   using EvictionIterator = typename AllocatorT::EvictionIterator;
   using AccessIterator = typename AllocatorT::AccessIterator;
 
-  enum class AllocStatus { kSuccess, kAllocError, kKeyAlreadyExists };
+  enum class AllocStatus {
+    kSuccess,
+    kAllocError,
+    kKeyAlreadyExists,
+    kNotFound
+  };
 
   explicit ObjectCache(InternalConstructor, const Config& config)
       : config_(config.validate()) {}
@@ -181,6 +265,16 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   template <typename T>
   std::shared_ptr<const T> find(folly::StringPiece key);
 
+  // Look up an object in read-only access, without allocating. Prefer this
+  // over find on hot paths that do not need to share the object.
+  // @param key   the key to the object.
+  //
+  // @throw cachelib::exception::RefcountOverflow if the item we are replacing
+  //        is already out of refcounts.
+  // @return handle to a const version of the object, empty if not found
+  template <typename T>
+  ObjectHandle<T> findFast(folly::StringPiece key);
+
   // Look up an object in mutable access
   // @param key   the key to the object
   //
@@ -197,7 +291,8 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   // @param object       unique pointer for the object to be inserted.
   // @param objectSize   size of the object to be inserted.
   //                     if objectSizeTracking is enabled, a non-zero value must
-  //                     be passed.
+  //                     be passed, unless the object is a TrackedObject or an
+  //                     ArenaObject whose exact size is then used.
   // @param ttlSecs      object expiring seconds.
   //
   // @throw cachelib::exception::RefcountOverflow if the item we are replacing
@@ -221,7 +316,8 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   // @param object       unique pointer for the object to be inserted.
   // @param objectSize   size of the object to be inserted.
   //                     if objectSizeTracking is enabled, a non-zero value must
-  //                     be passed.
+  //                     be passed, unless the object is a TrackedObject or an
+  //                     ArenaObject whose exact size is then used.
   // @param ttlSecs      object expiring seconds.
   //
   // @throw cachelib::exception::RefcountOverflow if the item we are replacing
@@ -237,6 +333,57 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
                                                     size_t objectSize = 0,
                                                     uint32_t ttlSecs = 0);
 
+  // An object to be inserted by insertOrReplaceBatch. See insertOrReplace for
+  // objectSize and ttlSecs.
+  template <typename T>
+  struct BatchInsertEntry {
+    std::string key;
+    std::unique_ptr<T> object;
+    size_t objectSize{0};
+    uint32_t ttlSecs{0};
+  };
+
+  // Insert a batch of objects, replacing the ones with the same keys, e.g. to
+  // warm up the cache. The items of all the objects are allocated first, and
+  // then inserted in the order of the locks of the access container, so that
+  // the objects sharing a lock are inserted in a row.
+  //
+  // @param entries   objects to be inserted. The inserted objects are
+  //                  released from their entry, the others are left there.
+  //
+  // @throw cachelib::exception::RefcountOverflow if the item we are replacing
+  //        is already out of refcounts.
+  // @throw std::invalid_argument if objectSizeTracking is enabled but the
+  //        objectSize of an entry is 0. Nothing is inserted then.
+  // @return the allocation status of each entry, in the order of the entries
+  template <typename T>
+  std::vector<AllocStatus> insertOrReplaceBatch(
+      std::vector<BatchInsertEntry<T>>& entries);
+
+  // Update an object by read-copy-update: the object is copied, the copy is
+  // mutated by fn and then replaces the object in the cache. Readers of the
+  // old version keep using it safely through their pointers and handles, and
+  // it is destroyed once they are all released, so readers never wait for an
+  // update. Updates of a key are serialized so that none of them is lost,
+  // but a concurrent insertOrReplace of the key may still overwrite one.
+  //
+  // @param key          the key to the object.
+  // @param fn           callback mutating the copy, as void(T&).
+  // @param objectSize   size of the new version of the object, see
+  //                     insertOrReplace. If 0, the size of the old version
+  //                     is kept.
+  //
+  // The new version keeps the TTL of the old one.
+  //
+  // @throw cachelib::exception::RefcountOverflow if the item we are replacing
+  //        is already out of refcounts.
+  // @return a pair of allocation status and shared_ptr of the new version of
+  //         the object; kNotFound and nullptr if the key is not in the cache
+  template <typename T, typename F>
+  std::pair<AllocStatus, std::shared_ptr<T>> update(folly::StringPiece key,
+                                                    F&& fn,
+                                                    size_t objectSize = 0);
+
   // Remove an object from cache by its key. No-op if object doesn't exist.
   // @param key   the key to the object.
   //
@@ -375,7 +522,10 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
 
   // Mutate object and update the object size
   // When size-awareness is enabled, users must call this API to mutate the
-  // object. Otherwise, we won't be able to track the updated object size
+  // object. Otherwise, we won't be able to track the updated object size.
+  // The size change of a TrackedObject or an ArenaObject is taken from its
+  // memory resource, that of other objects from the memory allocated by the
+  // calling thread.
   //
   // @param  object       shared pointer of the object to be mutated (must be
   //                      fetched from ObjectCache APIs)
@@ -461,13 +611,52 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
                                                   uint32_t ttl,
                                                   uint32_t creationTime);
 
-  // Allocate the placeholder and add it to the placeholder vector.
+  // Allocate a placeholder in the pool of a shard and add it to the
+  // placeholders of the shard.
   //
   // @return true if the allocation is successful
-  bool allocatePlaceholder();
+  bool allocatePlaceholder(PoolId shard);
+
+  // Release a placeholder of a shard.
+  //
+  // @return false if the shard has no placeholder
+  bool releasePlaceholder(PoolId shard);
+
+  // Number of entries of a shard when the cache holds @entriesLimit entries.
+  // The entries are distributed evenly across the shards.
+  size_t getShardEntriesLimit(size_t entriesLimit, PoolId shard) const {
+    return entriesLimit / config_.l1NumShards +
+           (static_cast<size_t>(shard) < entriesLimit % config_.l1NumShards
+                ? 1
+                : 0);
+  }
+
+  // Get the size of an object to be inserted: its exact size if it is a
+  // TrackedObject or an ArenaObject and object size tracking is enabled,
+  // @objectSize otherwise.
+  template <typename T>
+  size_t getTrackedObjectSize(const T* object, size_t objectSize) const {
+    if constexpr (kIsTrackedObject<T>) {
+      if (config_.objectSizeTrackingEnabled && objectSize == 0 &&
+          object != nullptr) {
+        return object->getObjectSize();
+      }
+    }
+    return objectSize;
+  }
+
+  // Report an object size to the sampled size distribution tracking, if
+  // enabled
+  void recordObjectSize(size_t objectSize) noexcept {
+    if (config_.objectSizeDistributionSampleRate > 0 && sizeDistTracker_) {
+      sizeDistTracker_->recordObjectSize(objectSize);
+    }
+  }
 
   // Returns the total number of placeholders
-  size_t getNumPlaceholders() const { return placeholders_.size(); }
+  size_t getNumPlaceholders() const {
+    return numPlaceholders_.load(std::memory_order_relaxed);
+  }
 
   // Get a ReadHandle reference from the object shared_ptr
   template <typename T>
@@ -491,6 +680,27 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
     return hdl;
   }
 
+  // Lock the key against faults in from NVM.
+  // @return an empty lock holder if NVM spill is not enabled
+  std::unique_lock<std::recursive_mutex> lockNvmKey(folly::StringPiece key) {
+    if (!nvmLocks_) {
+      return {};
+    }
+    return nvmLocks_->lock(key.data(), key.size());
+  }
+
+  // Write an evicted object to the NVM spill engine. Errors are counted.
+  void spillToNvm(folly::StringPiece key,
+                  const ObjectCacheItem& item,
+                  uint32_t expiryTime) noexcept;
+
+  // Move the object of a key from the NVM spill engine back to the cache.
+  // @return true if the object was restored to the cache
+  bool faultInFromNvm(folly::StringPiece key);
+
+  // @return true if the key was in the NVM spill engine
+  bool removeFromNvm(folly::StringPiece key);
+
   EvictionIterator getEvictionIterator(PoolId pid) const noexcept {
     auto& mmContainer = this->l1Cache_->getMMContainer(pid, 0 /* classId */);
     return mmContainer.getEvictionIterator();
@@ -499,8 +709,12 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   // Config passed to the cache.
   Config config_{};
 
-  // They take up space so we can control exact number of items in cache
-  std::vector<typename AllocatorT::WriteHandle> placeholders_;
+  // They take up space so we can control exact number of items in cache.
+  // Indexed by shard, i.e. by pool id.
+  std::vector<std::vector<typename AllocatorT::WriteHandle>> placeholders_;
+
+  // Total number of placeholders of all the shards
+  std::atomic<size_t> numPlaceholders_{0};
 
   // A periodic worker that controls the total object size to be limited by
   // cache size limit
@@ -519,7 +733,18 @@ class ObjectCache : public ObjectCacheBase<AllocatorT> {
   TLCounter inserts_;
   TLCounter insertErrors_;
   TLCounter replaces_;
+  TLCounter updates_;
   TLCounter removes_;
+  TLCounter nvmSpills_;
+  TLCounter nvmSpillErrors_;
+  TLCounter nvmHits_;
+
+  // Serialize the faults in from NVM with the inserts and removes of a key.
+  // Recursive since a fault in inserts through the deserialize callback.
+  std::unique_ptr<BucketLocks<std::recursive_mutex>> nvmLocks_;
+
+  // Serialize the updates of a key, see update()
+  std::unique_ptr<BucketLocks<std::mutex>> updateLocks_;
 
   friend class test::ObjectCacheTest<AllocatorT>;
 
@@ -565,6 +790,10 @@ void ObjectCache<AllocatorT>::init() {
         auto& item = data.item;
 
         auto itemPtr = reinterpret_cast<ObjectCacheItem*>(item.getMemory());
+        if (ctx == ObjectCacheDestructorContext::kEvicted &&
+            config_.nvmSpillEngine && !item.isExpired()) {
+          spillToNvm(item.getKey(), *itemPtr, item.getExpiryTime());
+        }
 
         SCOPE_EXIT {
           if (config_.objectSizeTrackingEnabled) {
@@ -583,6 +812,12 @@ void ObjectCache<AllocatorT>::init() {
   }
 
   this->l1Cache_ = std::make_unique<AllocatorT>(l1Config);
+  updateLocks_ = std::make_unique<BucketLocks<std::mutex>>(
+      config_.l1LockPower, std::make_shared<MurmurHash2>());
+  if (config_.nvmSpillEngine) {
+    nvmLocks_ = std::make_unique<BucketLocks<std::recursive_mutex>>(
+        config_.l1LockPower, std::make_shared<MurmurHash2>());
+  }
   // add a pool per shard
   for (size_t i = 0; i < config_.l1NumShards; i++) {
     std::string shardName =
@@ -598,22 +833,20 @@ void ObjectCache<AllocatorT>::init() {
   // Allocate placeholder items such that the cache will fit no more than
   // "l1EntriesLimit" objects. In doing so, placeholders are distributed
   // evenly to each shard/pool, i.e., l1EntriesLimit / l1NumShards
-  const size_t l1PlaceHoldersPerShard =
-      slabsPerShard * allocsPerSlab - allocsPerShard;
-  XDCHECK_GE(slabsPerShard * allocsPerSlab, allocsPerShard);
-  XDCHECK_LT(l1PlaceHoldersPerShard, allocsPerSlab);
-
-  // allocsPerShard is celing of the division by numShards, meaning
-  // additional number (i.e., extraLimit) of placesholders need to be created
-  const size_t extraLimit =
-      allocsPerShard * config_.l1NumShards - config_.l1EntriesLimit;
-  XDCHECK_GE(allocsPerShard * config_.l1NumShards, config_.l1EntriesLimit);
-  const size_t l1PlaceHolders =
-      l1PlaceHoldersPerShard * config_.l1NumShards + extraLimit;
-  for (size_t i = 0; i < l1PlaceHolders; i++) {
-    if (!allocatePlaceholder()) {
-      throw std::runtime_error(
-          fmt::format("Couldn't allocate placeholder {}", i));
+  const size_t allocsPerPool = slabsPerShard * allocsPerSlab;
+  XDCHECK_GE(allocsPerPool, allocsPerShard);
+  XDCHECK_LT(allocsPerPool - allocsPerShard, allocsPerSlab);
+  placeholders_.resize(config_.l1NumShards);
+  for (size_t i = 0; i < config_.l1NumShards; i++) {
+    const auto shard = static_cast<PoolId>(i);
+    const size_t shardEntriesLimit =
+        getShardEntriesLimit(config_.l1EntriesLimit, shard);
+    XDCHECK_GE(allocsPerPool, shardEntriesLimit);
+    for (size_t j = shardEntriesLimit; j < allocsPerPool; j++) {
+      if (!allocatePlaceholder(shard)) {
+        throw std::runtime_error(fmt::format(
+            "Couldn't allocate placeholder {} of shard {}", j, i));
+      }
     }
   }
 
@@ -642,9 +875,9 @@ void ObjectCache<AllocatorT>::initWorkers() {
 
   if (config_.objectSizeTrackingEnabled &&
       config_.objectSizeDistributionTrackingEnabled) {
-    util::startPeriodicWorker(
-        kSizeDistTrackerName, sizeDistTracker_,
-        std::chrono::seconds{60} /*default interval to be 60s*/, *this);
+    util::startPeriodicWorker(kSizeDistTrackerName, sizeDistTracker_,
+                              config_.objectSizeDistributionInterval, *this,
+                              config_.objectSizeDistributionSampleRate);
   }
 }
 
@@ -662,10 +895,14 @@ template <typename T>
 std::shared_ptr<const T> ObjectCache<AllocatorT>::find(folly::StringPiece key) {
   lookups_.inc();
   auto found = this->l1Cache_->find(key);
+  if (found) {
+    succL1Lookups_.inc();
+  } else if (faultInFromNvm(key)) {
+    found = this->l1Cache_->find(key);
+  }
   if (!found) {
     return nullptr;
   }
-  succL1Lookups_.inc();
 
   auto ptr = found->template getMemoryAs<ObjectCacheItem>()->objectPtr;
   // Use custom deleter
@@ -674,16 +911,39 @@ std::shared_ptr<const T> ObjectCache<AllocatorT>::find(folly::StringPiece key) {
                                   std::move(deleter));
 }
 
+template <typename AllocatorT>
+template <typename T>
+typename ObjectCache<AllocatorT>::template ObjectHandle<T>
+ObjectCache<AllocatorT>::findFast(folly::StringPiece key) {
+  lookups_.inc();
+  auto found = this->l1Cache_->find(key);
+  if (found) {
+    succL1Lookups_.inc();
+  } else if (faultInFromNvm(key)) {
+    found = this->l1Cache_->find(key);
+  }
+  if (!found) {
+    return nullptr;
+  }
+
+  auto ptr = found->template getMemoryAs<ObjectCacheItem>()->objectPtr;
+  return ObjectHandle<T>(std::move(found), reinterpret_cast<const T*>(ptr));
+}
+
 template <typename AllocatorT>
 template <typename T>
 std::shared_ptr<T> ObjectCache<AllocatorT>::findToWrite(
     folly::StringPiece key) {
   lookups_.inc();
   auto found = this->l1Cache_->findToWrite(key);
+  if (found) {
+    succL1Lookups_.inc();
+  } else if (faultInFromNvm(key)) {
+    found = this->l1Cache_->findToWrite(key);
+  }
   if (!found) {
     return nullptr;
   }
-  succL1Lookups_.inc();
 
   auto ptr = found->template getMemoryAs<ObjectCacheItem>()->objectPtr;
   // Use custom deleter
@@ -700,6 +960,7 @@ ObjectCache<AllocatorT>::insertOrReplace(folly::StringPiece key,
                                          std::unique_ptr<T> object,
                                          size_t objectSize,
                                          uint32_t ttlSecs) {
+  objectSize = getTrackedObjectSize(object.get(), objectSize);
   if (config_.objectSizeTrackingEnabled && objectSize == 0) {
     throw std::invalid_argument(
         "Object size tracking is enabled but object size is set to be 0.");
@@ -714,6 +975,8 @@ ObjectCache<AllocatorT>::insertOrReplace(folly::StringPiece key,
 
   inserts_.inc();
 
+  // a fault in of the key must not replace the new object
+  auto nvmLock = lockNvmKey(key);
   auto handle =
       allocateFromL1(key, ttlSecs, 0 /* use current time as creationTime */);
   if (!handle) {
@@ -732,9 +995,12 @@ ObjectCache<AllocatorT>::insertOrReplace(folly::StringPiece key,
   // to avoid any race condition with the size controller at start up
   if (config_.objectSizeTrackingEnabled) {
     totalObjectSizeBytes_.fetch_add(objectSize, std::memory_order_relaxed);
+    recordObjectSize(objectSize);
   }
 
   auto replaced = this->l1Cache_->insertOrReplace(handle);
+  // drop the stale copy spilled to NVM, if any
+  removeFromNvm(key);
 
   std::shared_ptr<T> replacedPtr = nullptr;
   if (replaced) {
@@ -763,6 +1029,7 @@ ObjectCache<AllocatorT>::insert(folly::StringPiece key,
                                 std::unique_ptr<T> object,
                                 size_t objectSize,
                                 uint32_t ttlSecs) {
+  objectSize = getTrackedObjectSize(object.get(), objectSize);
   if (config_.objectSizeTrackingEnabled && objectSize == 0) {
     throw std::invalid_argument(
         "Object size tracking is enabled but object size is set to be 0.");
@@ -776,6 +1043,7 @@ ObjectCache<AllocatorT>::insert(folly::StringPiece key,
 
   inserts_.inc();
 
+  auto nvmLock = lockNvmKey(key);
   auto handle =
       allocateFromL1(key, ttlSecs, 0 /* use current time as creationTime */);
   if (!handle) {
@@ -791,10 +1059,12 @@ ObjectCache<AllocatorT>::insert(folly::StringPiece key,
     return {AllocStatus::kKeyAlreadyExists,
             std::shared_ptr<T>(std::move(object))};
   }
+  removeFromNvm(key);
 
   // update total object size
   if (config_.objectSizeTrackingEnabled) {
     totalObjectSizeBytes_.fetch_add(objectSize, std::memory_order_relaxed);
+    recordObjectSize(objectSize);
   }
   // Release the handle now since we have inserted the handle into the cache,
   // and from now the Cache will be responsible for destroying the object
@@ -806,6 +1076,99 @@ ObjectCache<AllocatorT>::insert(folly::StringPiece key,
   return {AllocStatus::kSuccess, std::shared_ptr<T>(ptr, std::move(deleter))};
 }
 
+template <typename AllocatorT>
+template <typename T>
+std::vector<typename ObjectCache<AllocatorT>::AllocStatus>
+ObjectCache<AllocatorT>::insertOrReplaceBatch(
+    std::vector<BatchInsertEntry<T>>& entries) {
+  for (auto& entry : entries) {
+    entry.objectSize =
+        getTrackedObjectSize(entry.object.get(), entry.objectSize);
+    if (config_.objectSizeTrackingEnabled && entry.objectSize == 0) {
+      throw std::invalid_argument(
+          "Object size tracking is enabled but object size is set to be 0.");
+    }
+  }
+
+  // allocate the items of all the objects up front
+  std::vector<AllocStatus> statuses(entries.size(), AllocStatus::kAllocError);
+  std::vector<typename AllocatorT::WriteHandle> handles(entries.size());
+  std::vector<std::pair<size_t, size_t>> order; // lock index, entry index
+  order.reserve(entries.size());
+  const uint64_t lockMask = (1ULL << config_.l1LockPower) - 1;
+  for (size_t i = 0; i < entries.size(); i++) {
+    inserts_.inc();
+    handles[i] = allocateFromL1(entries[i].key, entries[i].ttlSecs,
+                                0 /* use current time as creationTime */);
+    if (!handles[i]) {
+      insertErrors_.inc();
+      continue;
+    }
+    // the access container picks its lock from the low bits of the hash
+    const auto& key = entries[i].key;
+    order.emplace_back(MurmurHash2{}(key.data(), key.size()) & lockMask, i);
+  }
+  std::stable_sort(order.begin(), order.end());
+
+  for (auto [_, i] : order) {
+    auto& entry = entries[i];
+    auto nvmLock = lockNvmKey(entry.key);
+    auto& handle = handles[i];
+    *handle->template getMemoryAs<ObjectCacheItem>() = ObjectCacheItem{
+        reinterpret_cast<uintptr_t>(entry.object.get()), entry.objectSize};
+    if (config_.objectSizeTrackingEnabled) {
+      totalObjectSizeBytes_.fetch_add(entry.objectSize,
+                                      std::memory_order_relaxed);
+      recordObjectSize(entry.objectSize);
+    }
+
+    // the replaced object is destroyed once its readers release it
+    if (this->l1Cache_->insertOrReplace(handle)) {
+      replaces_.inc();
+    }
+    removeFromNvm(entry.key);
+    handle.reset();
+    entry.object.release();
+    statuses[i] = AllocStatus::kSuccess;
+  }
+  return statuses;
+}
+
+template <typename AllocatorT>
+template <typename T, typename F>
+std::pair<typename ObjectCache<AllocatorT>::AllocStatus, std::shared_ptr<T>>
+ObjectCache<AllocatorT>::update(folly::StringPiece key,
+                                F&& fn,
+                                size_t objectSize) {
+  static_assert(std::is_copy_constructible_v<T>,
+                "update() copies the object, so T must be copy constructible");
+
+  auto lock = updateLocks_->lock(key.data(), key.size());
+  auto old = findFast<T>(key);
+  if (!old) {
+    return {AllocStatus::kNotFound, nullptr};
+  }
+
+  auto object = std::make_unique<T>(*old);
+  fn(*object);
+
+  const auto& oldHdl = old.viewReadHandle();
+  if (config_.objectSizeTrackingEnabled && objectSize == 0) {
+    objectSize = oldHdl->template getMemoryAs<ObjectCacheItem>()->objectSize;
+  }
+  const auto ttlSecs =
+      static_cast<uint32_t>(oldHdl->getConfiguredTTL().count());
+  // readers of the old version hold their own handles
+  old.reset();
+
+  auto [status, ptr, replaced] =
+      insertOrReplace(key, std::move(object), objectSize, ttlSecs);
+  if (status == AllocStatus::kSuccess) {
+    updates_.inc();
+  }
+  return {status, std::move(ptr)};
+}
+
 template <typename AllocatorT>
 typename AllocatorT::WriteHandle ObjectCache<AllocatorT>::allocateFromL1(
     folly::StringPiece key, uint32_t ttl, uint32_t creationTime) {
@@ -819,16 +1182,26 @@ typename AllocatorT::WriteHandle ObjectCache<AllocatorT>::allocateFromL1(
 }
 
 template <typename AllocatorT>
-bool ObjectCache<AllocatorT>::allocatePlaceholder() {
-  // rotate pools so that the number of placeholders for each pool is balanced
-  auto poolId = static_cast<PoolId>(getNumPlaceholders() % config_.l1NumShards);
-  auto hdl = this->l1Cache_->allocate(poolId, kPlaceholderKey,
+bool ObjectCache<AllocatorT>::allocatePlaceholder(PoolId shard) {
+  auto hdl = this->l1Cache_->allocate(shard, kPlaceholderKey,
                                       sizeof(ObjectCacheItem), 0 /* no ttl */,
                                       0 /* use current time as creationTime */);
   if (!hdl) {
     return false;
   }
-  placeholders_.push_back(std::move(hdl));
+  placeholders_[shard].push_back(std::move(hdl));
+  numPlaceholders_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename AllocatorT>
+bool ObjectCache<AllocatorT>::releasePlaceholder(PoolId shard) {
+  auto& placeholders = placeholders_[shard];
+  if (placeholders.empty()) {
+    return false;
+  }
+  placeholders.pop_back();
+  numPlaceholders_.fetch_sub(1, std::memory_order_relaxed);
   return true;
 }
 
@@ -856,7 +1229,107 @@ ObjectCache<AllocatorT>::~ObjectCache() {
 template <typename AllocatorT>
 bool ObjectCache<AllocatorT>::remove(folly::StringPiece key) {
   removes_.inc();
-  return this->l1Cache_->remove(key) == AllocatorT::RemoveRes::kSuccess;
+  auto nvmLock = lockNvmKey(key);
+  bool removed =
+      this->l1Cache_->remove(key) == AllocatorT::RemoveRes::kSuccess;
+  removed |= removeFromNvm(key);
+  return removed;
+}
+
+template <typename AllocatorT>
+void ObjectCache<AllocatorT>::spillToNvm(folly::StringPiece key,
+                                         const ObjectCacheItem& item,
+                                         uint32_t expiryTime) noexcept {
+  try {
+    auto payload = config_.serializeCb(Serializer(key, item.objectPtr));
+    if (!payload) {
+      nvmSpillErrors_.inc();
+      return;
+    }
+    persistence::Item nvmItem;
+    nvmItem.key().value() = key.str();
+    nvmItem.objectSize().value() = item.objectSize;
+    nvmItem.expiryTime().value() = expiryTime;
+    nvmItem.payload().value() = payload->moveToFbString().toStdString();
+    auto iobuf = cachelib::Serializer::serializeToIOBuf(nvmItem);
+    iobuf->coalesce();
+
+    navy::Status status;
+    // We do busy wait because we don't expect many retries.
+    while ((status = config_.nvmSpillEngine->insert(
+                HashedKey{key}, navy::BufferView{iobuf->length(),
+                                                 iobuf->data()})) ==
+           navy::Status::Retry) {
+      std::this_thread::yield();
+    }
+    if (status == navy::Status::Ok) {
+      nvmSpills_.inc();
+    } else {
+      nvmSpillErrors_.inc();
+    }
+  } catch (const std::exception& e) {
+    nvmSpillErrors_.inc();
+    XLOGF_EVERY_MS(ERR, 60'000, "Failed to spill object for key = {}: {}", key,
+                   folly::exceptionStr(e));
+  }
+}
+
+template <typename AllocatorT>
+bool ObjectCache<AllocatorT>::faultInFromNvm(folly::StringPiece key) {
+  if (!config_.nvmSpillEngine) {
+    return false;
+  }
+  auto& engine = *config_.nvmSpillEngine;
+  const HashedKey hk{key};
+  auto nvmLock = lockNvmKey(key);
+  navy::Buffer buffer;
+  if (!engine.couldExist(hk) ||
+      engine.lookup(hk, buffer) != navy::Status::Ok) {
+    // the key may have been faulted in while waiting for the lock
+    return this->l1Cache_->peek(key) != nullptr;
+  }
+  // the object is in the cache again, or expired, once restored
+  removeFromNvm(key);
+
+  cachelib::Deserializer deserializer(buffer.data(),
+                                      buffer.data() + buffer.size());
+  auto nvmItem = deserializer.deserialize<persistence::Item>();
+  const uint32_t expiryTime = nvmItem.expiryTime().value();
+  const uint32_t currentTime = util::getCurrentTimeSec();
+  if (expiryTime > 0 && expiryTime <= currentTime) {
+    return false;
+  }
+  const uint32_t ttlSecs = expiryTime == 0 ? 0 : expiryTime - currentTime;
+  try {
+    if (!config_.deserializeCb(Deserializer(key, nvmItem.payload().value(),
+                                            nvmItem.objectSize().value(),
+                                            ttlSecs, *this))) {
+      return false;
+    }
+  } catch (const std::exception& e) {
+    XLOGF_EVERY_MS(ERR, 60'000, "Failed to deserialize object for key = {}: {}",
+                   key, folly::exceptionStr(e));
+    return false;
+  }
+  nvmHits_.inc();
+  return true;
+}
+
+template <typename AllocatorT>
+bool ObjectCache<AllocatorT>::removeFromNvm(folly::StringPiece key) {
+  if (!config_.nvmSpillEngine) {
+    return false;
+  }
+  auto& engine = *config_.nvmSpillEngine;
+  const HashedKey hk{key};
+  if (!engine.couldExist(hk)) {
+    return false;
+  }
+  navy::Status status;
+  while ((status = engine.remove(hk)) == navy::Status::Retry) {
+    std::this_thread::yield();
+  }
+  return status == navy::Status::Ok;
 }
 
 template <typename AllocatorT>
@@ -872,11 +1345,21 @@ void ObjectCache<AllocatorT>::getObjectCacheCounters(
           util::CounterVisitor::CounterType::RATE);
   visitor("objcache.replaces", replaces_.get(),
           util::CounterVisitor::CounterType::RATE);
+  visitor("objcache.updates", updates_.get(),
+          util::CounterVisitor::CounterType::RATE);
   visitor("objcache.removes", removes_.get(),
           util::CounterVisitor::CounterType::RATE);
   visitor("objcache.evictions", evictions_.get(),
           util::CounterVisitor::CounterType::RATE);
   visitor("objcache.object_size_bytes", getTotalObjectSize());
+  if (config_.nvmSpillEngine) {
+    visitor("objcache.nvm_spills", nvmSpills_.get(),
+            util::CounterVisitor::CounterType::RATE);
+    visitor("objcache.nvm_spill_errors", nvmSpillErrors_.get(),
+            util::CounterVisitor::CounterType::RATE);
+    visitor("objcache.lookups.nvm_hits", nvmHits_.get(),
+            util::CounterVisitor::CounterType::RATE);
+  }
   if (sizeController_) {
     sizeController_->getCounters(visitor);
   }
@@ -898,6 +1381,8 @@ ObjectCache<AllocatorT>::serializeConfigParams() const {
         std::to_string(config_.totalObjectSizeLimit);
     config["sizeControllerIntervalMs"] =
         std::to_string(config_.sizeControllerIntervalMs);
+    config["sizeControllerMaxEntriesStep"] =
+        std::to_string(config_.sizeControllerMaxEntriesStep);
   }
   return config;
 }
@@ -914,7 +1399,8 @@ bool ObjectCache<AllocatorT>::persist() {
   }
 
   Persistor persistor(config_.persistThreadCount, config_.persistBaseFilePath,
-                      config_.serializeCb, *this);
+                      config_.serializeCb, *this, config_.persistFrameSizeBytes,
+                      config_.persistCompressionEnabled);
   return persistor.run();
 }
 
@@ -935,10 +1421,19 @@ void ObjectCache<AllocatorT>::mutateObject(const std::shared_ptr<T>& object,
     return;
   }
 
-  cachelib::objcache2::ThreadMemoryTracker tMemTracker;
-  size_t memUsageBefore = tMemTracker.getMemUsageBytes();
-  mutateCb();
-  size_t memUsageAfter = tMemTracker.getMemUsageBytes();
+  size_t memUsageBefore;
+  size_t memUsageAfter;
+  if constexpr (kIsTrackedObject<T>) {
+    // exact size from the memory resource of the object
+    memUsageBefore = object->getObjectSize();
+    mutateCb();
+    memUsageAfter = object->getObjectSize();
+  } else {
+    cachelib::objcache2::ThreadMemoryTracker tMemTracker;
+    memUsageBefore = tMemTracker.getMemUsageBytes();
+    mutateCb();
+    memUsageAfter = tMemTracker.getMemUsageBytes();
+  }
 
   auto& hdl = getWriteHandleRefInternal<T>(object);
   size_t memUsageDiff = 0;
@@ -993,6 +1488,7 @@ bool ObjectCache<AllocatorT>::updateObjectSize(const std::shared_ptr<T>& object,
     totalObjectSizeBytes_.fetch_sub(oldSize - newSize,
                                     std::memory_order_relaxed);
   }
+  recordObjectSize(newSize);
   return true;
 }
 } // namespace facebook::cachelib::objcache2
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
 #include <string>
 
 #include "cachelib/allocator/KAllocation.h"
@@ -25,6 +26,10 @@
 
 namespace facebook {
 namespace cachelib {
+namespace navy {
+class Engine;
+}
+
 namespace objcache2 {
 
 template <typename ObjectCache>
@@ -74,6 +79,11 @@ struct ObjectCacheConfig {
   ObjectCacheConfig& setSizeControllerThrottlerConfig(
       util::Throttler::Config config);
 
+  // Set the maximum number of entries by which the size controller shrinks
+  // or expands each shard in one run. A large adjustment is then spread over
+  // several runs instead of evicting all the entries at once.
+  ObjectCacheConfig& setSizeControllerMaxEntriesStep(size_t maxEntriesStep);
+
   // Enable event tracker. This will log all relevant cache events.
   ObjectCacheConfig& setEventTracker(EventTrackerSharedPtr&& ptr);
 
@@ -130,11 +140,29 @@ struct ObjectCacheConfig {
       SerializeCb serializeCallback,
       DeserializeCb deserializeCallback);
 
+  // Persist the objects in frames written straight to the persistence files
+  // instead of one record per object. Each persist thread batches objects
+  // until the frame reaches frameSizeBytes, which bounds its memory usage.
+  // Cache persistence must be enabled first.
+  // @param frameSizeBytes       size in bytes after which a frame is written
+  // @param compressed           compress the frames with zstd
+  ObjectCacheConfig& enableStreamingPersistence(size_t frameSizeBytes,
+                                                bool compressed = false);
+
   // Enable tracking Jemalloc external fragmentation.
   ObjectCacheConfig& enableFragmentationTracking();
 
+  // Track the object size distribution from one out of @sampleRate inserted
+  // or resized objects, merged every @interval, instead of scanning the
+  // cache. Object size tracking must be enabled as well.
+  ObjectCacheConfig& enableSampledObjectSizeDistributionTracking(
+      uint32_t sampleRate,
+      std::chrono::milliseconds interval = std::chrono::seconds{60});
+
   ObjectCacheConfig& setItemReaperInterval(std::chrono::milliseconds interval);
 
+  // Config of the eviction policy, i.e. the MMType::Config of the allocator
+  // of the cache, e.g. MMTinyLFU::Config for ObjectCache<TinyLFUAllocator>.
   ObjectCacheConfig& setEvictionPolicyConfig(
       EvictionPolicyConfig _evictionPolicyConfig);
 
@@ -144,6 +172,20 @@ struct ObjectCacheConfig {
   // ObjectCache::startCacheWorkers()
   ObjectCacheConfig& setDelayCacheWorkersStart();
 
+  // Spill the objects evicted from the cache to a navy engine, e.g. a
+  // BigHash. Spilled objects are serialized with serializeCallback and, when
+  // a lookup misses in memory, deserialized back into the cache with
+  // deserializeCallback. The callbacks are the same as the ones of cache
+  // persistence, so enabling both uses the last ones set.
+  // Give the engine a bloom filter: inserts and removes check whether the
+  // key could be in it.
+  // @param engine               the engine that takes the evicted objects
+  // @param serializeCallback    callback to serialize an object
+  // @param deserializeCallback  callback to deserialize an object
+  ObjectCacheConfig& enableNvmSpill(std::shared_ptr<navy::Engine> engine,
+                                    SerializeCb serializeCallback,
+                                    DeserializeCb deserializeCallback);
+
   // With size controller disabled, above this many entries, L1 will start
   // evicting.
   // With size controller enabled, this is only a hint used for initialization.
@@ -179,6 +221,15 @@ struct ObjectCacheConfig {
   // the stats to ods.
   bool objectSizeDistributionTrackingEnabled{false};
 
+  // If non-zero, the object size distribution is built from one out of
+  // objectSizeDistributionSampleRate inserted or resized objects instead of
+  // scanning the cache.
+  uint32_t objectSizeDistributionSampleRate{0};
+
+  // Period to update the object size distribution
+  std::chrono::milliseconds objectSizeDistributionInterval{
+      std::chrono::seconds{60}};
+
   // Period to fire size controller in milliseconds. 0 means size controller is
   // disabled.
   int sizeControllerIntervalMs{0};
@@ -190,6 +241,10 @@ struct ObjectCacheConfig {
   // Throttler config of size controller
   util::Throttler::Config sizeControllerThrottlerConfig{};
 
+  // Maximum number of entries by which the size controller changes the limit
+  // of each shard in one run
+  size_t sizeControllerMaxEntriesStep{10'000};
+
   // Callback for initializing the eventTracker on CacheAllocator construction
   EventTrackerSharedPtr eventTracker{nullptr};
 
@@ -215,12 +270,23 @@ struct ObjectCacheConfig {
   // Empty means cache persistence is not enabled.
   std::string persistBaseFilePath{};
 
+  // Size in bytes of the frames in which objects are persisted. 0 means each
+  // object is persisted as a record.
+  size_t persistFrameSizeBytes{0};
+
+  // Whether the persisted frames are compressed with zstd
+  bool persistCompressionEnabled{false};
+
   // Serialize callback for cache persistence
   SerializeCb serializeCb{};
 
   // Deserialize callback for cache persistence
   DeserializeCb deserializeCb{};
 
+  // Engine the evicted objects spill to. nullptr means NVM spill is not
+  // enabled.
+  std::shared_ptr<navy::Engine> nvmSpillEngine{};
+
   // Config of the eviction policy
   EvictionPolicyConfig evictionPolicyConfig{};
 
@@ -297,12 +363,38 @@ ObjectCacheConfig<T>& ObjectCacheConfig<T>::setSizeControllerThrottlerConfig(
   return *this;
 }
 
+template <typename T>
+ObjectCacheConfig<T>& ObjectCacheConfig<T>::setSizeControllerMaxEntriesStep(
+    size_t maxEntriesStep) {
+  if (maxEntriesStep == 0) {
+    throw std::invalid_argument(
+        "The max entries step of the size controller must be positive.");
+  }
+  sizeControllerMaxEntriesStep = maxEntriesStep;
+  return *this;
+}
+
 template <typename T>
 ObjectCacheConfig<T>& ObjectCacheConfig<T>::enableFragmentationTracking() {
   fragmentationTrackingEnabled = true;
   return *this;
 }
 
+template <typename T>
+ObjectCacheConfig<T>&
+ObjectCacheConfig<T>::enableSampledObjectSizeDistributionTracking(
+    uint32_t sampleRate, std::chrono::milliseconds interval) {
+  if (sampleRate == 0 || interval.count() <= 0) {
+    throw std::invalid_argument(
+        "Sample rate and interval of the object size distribution tracking "
+        "must be positive.");
+  }
+  objectSizeDistributionTrackingEnabled = true;
+  objectSizeDistributionSampleRate = sampleRate;
+  objectSizeDistributionInterval = interval;
+  return *this;
+}
+
 template <typename T>
 ObjectCacheConfig<T>& ObjectCacheConfig<T>::setEventTracker(
     EventTrackerSharedPtr&& ptr) {
@@ -375,6 +467,42 @@ ObjectCacheConfig<T>& ObjectCacheConfig<T>::enablePersistenceWithEvictionOrder(
   return *this;
 }
 
+template <typename T>
+ObjectCacheConfig<T>& ObjectCacheConfig<T>::enableStreamingPersistence(
+    size_t frameSizeBytes, bool compressed) {
+  if (persistBaseFilePath.empty()) {
+    throw std::invalid_argument(
+        "cache persistence must be enabled before streaming persistence");
+  }
+
+  if (frameSizeBytes == 0) {
+    throw std::invalid_argument(
+        "A non-zero frame size must be set to enable streaming persistence");
+  }
+  persistFrameSizeBytes = frameSizeBytes;
+  persistCompressionEnabled = compressed;
+  return *this;
+}
+
+template <typename T>
+ObjectCacheConfig<T>& ObjectCacheConfig<T>::enableNvmSpill(
+    std::shared_ptr<navy::Engine> engine,
+    SerializeCb serializeCallback,
+    DeserializeCb deserializeCallback) {
+  if (!engine) {
+    throw std::invalid_argument("An engine must be set to enable NVM spill");
+  }
+
+  if (!serializeCallback || !deserializeCallback) {
+    throw std::invalid_argument(
+        "Serialize and deserialize callback must be set to enable NVM spill");
+  }
+  nvmSpillEngine = std::move(engine);
+  serializeCb = std::move(serializeCallback);
+  deserializeCb = std::move(deserializeCallback);
+  return *this;
+}
+
 template <typename T>
 ObjectCacheConfig<T>& ObjectCacheConfig<T>::setItemReaperInterval(
     std::chrono::milliseconds _reaperInterval) {
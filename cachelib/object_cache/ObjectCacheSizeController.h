@@ -18,6 +18,10 @@
 
 #include <folly/memory/Malloc.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "cachelib/allocator/memory/Slab.h"
 #include "cachelib/common/PeriodicWorker.h"
 
 namespace facebook::cachelib::objcache2 {
@@ -25,6 +29,12 @@ template <typename AllocatorT>
 class ObjectCache;
 
 // Dynamically adjust the entriesLimit to limit the cache size for object-cache.
+//
+// The limit is kept per shard, i.e. per pool, and each run moves the limit of
+// every shard by at most sizeControllerMaxEntriesStep entries towards its
+// share of the new limit. The placeholders of the shards are allocated or
+// released in turns and throttled, so that no pool is kept busy evicting and
+// a large adjustment is spread over several runs.
 template <typename AllocatorT>
 class ObjectCacheSizeController : public PeriodicWorker {
  public:
@@ -40,8 +50,13 @@ class ObjectCacheSizeController : public PeriodicWorker {
  private:
   void work() override final;
 
-  void shrinkCacheByEntriesNum(size_t entries);
-  void expandCacheByEntriesNum(size_t entries);
+  // Shrink the shards towards their share of @entriesLimit, by at most
+  // sizeControllerMaxEntriesStep entries each.
+  void shrinkCacheToEntriesLimit(size_t entriesLimit);
+
+  // Expand the shards towards their share of @entriesLimit, by at most
+  // sizeControllerMaxEntriesStep entries each.
+  void expandCacheToEntriesLimit(size_t entriesLimit);
 
   std::pair<size_t, size_t> trackJemallocMemStats() const {
     size_t jemallocAllocatedBytes;
@@ -66,6 +81,10 @@ class ObjectCacheSizeController : public PeriodicWorker {
 
   // will be adjusted to control the cache size limit
   std::atomic<size_t> currentEntriesLimit_;
+
+  // entries limit of each shard, only accessed by the worker. They add up to
+  // currentEntriesLimit_
+  std::vector<size_t> shardEntriesLimits_;
 };
 
 template <typename AllocatorT>
@@ -110,12 +129,12 @@ void ObjectCacheSizeController<AllocatorT>::work() {
         currentNumEntries >= newEntriesLimit) {
       // shrink cache when getting a lower new limit and current entries num
       // reaches the new limit
-      shrinkCacheByEntriesNum(currentEntriesLimit_ - newEntriesLimit);
+      shrinkCacheToEntriesLimit(newEntriesLimit);
     } else if (newEntriesLimit > currentEntriesLimit_ &&
                currentNumEntries == currentEntriesLimit_) {
       // expand cache when getting a higher new limit and current entries num
       // reaches the old limit
-      expandCacheByEntriesNum(newEntriesLimit - currentEntriesLimit_);
+      expandCacheToEntriesLimit(newEntriesLimit);
     }
 
     XLOGF_EVERY_MS(INFO, 60'000,
@@ -128,46 +147,93 @@ void ObjectCacheSizeController<AllocatorT>::work() {
 }
 
 template <typename AllocatorT>
-void ObjectCacheSizeController<AllocatorT>::shrinkCacheByEntriesNum(
-    size_t entries) {
+void ObjectCacheSizeController<AllocatorT>::shrinkCacheToEntriesLimit(
+    size_t entriesLimit) {
+  const size_t numShards = shardEntriesLimits_.size();
+  std::vector<size_t> steps(numShards, 0);
+  for (size_t i = 0; i < numShards; i++) {
+    const auto target =
+        objCache_.getShardEntriesLimit(entriesLimit, static_cast<PoolId>(i));
+    if (shardEntriesLimits_[i] > target) {
+      steps[i] = std::min(shardEntriesLimits_[i] - target,
+                          objCache_.config_.sizeControllerMaxEntriesStep);
+    }
+  }
+
   util::Throttler t(throttlerConfig_);
   auto before = objCache_.getNumPlaceholders();
-  for (size_t i = 0; i < entries; i++) {
-    if (!objCache_.allocatePlaceholder()) {
-      XLOGF(ERR, "Couldn't allocate placeholder {}",
-            objCache_.getNumPlaceholders());
-    } else {
+  // take turns between the shards, one placeholder at a time
+  for (bool pending = true; pending;) {
+    pending = false;
+    for (size_t i = 0; i < numShards; i++) {
+      if (steps[i] == 0) {
+        continue;
+      }
+      if (!objCache_.allocatePlaceholder(static_cast<PoolId>(i))) {
+        XLOGF(ERR, "Couldn't allocate placeholder {} of shard {}",
+              objCache_.placeholders_[i].size(), i);
+        steps[i] = 0;
+        continue;
+      }
+      steps[i]--;
+      shardEntriesLimits_[i]--;
       currentEntriesLimit_--;
+      pending = pending || steps[i] > 0;
+      // throttle to slow down the allocation speed
+      t.throttle();
     }
-    // throttle to slow down the allocation speed
-    t.throttle();
   }
 
   XLOGF_EVERY_MS(
       INFO, 60'000,
-      "CacheLib size-controller: request to shrink cache by {} entries. "
+      "CacheLib size-controller: request to shrink cache to {} entries. "
       "Placeholders num before: {}, after: {}. currentEntriesLimit: {}",
-      entries, before, objCache_.getNumPlaceholders(), currentEntriesLimit_);
+      entriesLimit, before, objCache_.getNumPlaceholders(),
+      currentEntriesLimit_);
 }
 
 template <typename AllocatorT>
-void ObjectCacheSizeController<AllocatorT>::expandCacheByEntriesNum(
-    size_t entries) {
+void ObjectCacheSizeController<AllocatorT>::expandCacheToEntriesLimit(
+    size_t entriesLimit) {
+  const size_t numShards = shardEntriesLimits_.size();
+  std::vector<size_t> steps(numShards, 0);
+  for (size_t i = 0; i < numShards; i++) {
+    const auto target =
+        objCache_.getShardEntriesLimit(entriesLimit, static_cast<PoolId>(i));
+    if (shardEntriesLimits_[i] < target) {
+      steps[i] = std::min(target - shardEntriesLimits_[i],
+                          objCache_.config_.sizeControllerMaxEntriesStep);
+    }
+  }
+
   util::Throttler t(throttlerConfig_);
   auto before = objCache_.getNumPlaceholders();
-  entries = std::min<size_t>(entries, before);
-  for (size_t i = 0; i < entries; i++) {
-    objCache_.placeholders_.pop_back();
-    currentEntriesLimit_++;
-    // throttle to slow down the release speed
-    t.throttle();
+  // take turns between the shards, one placeholder at a time
+  for (bool pending = true; pending;) {
+    pending = false;
+    for (size_t i = 0; i < numShards; i++) {
+      if (steps[i] == 0) {
+        continue;
+      }
+      if (!objCache_.releasePlaceholder(static_cast<PoolId>(i))) {
+        steps[i] = 0;
+        continue;
+      }
+      steps[i]--;
+      shardEntriesLimits_[i]++;
+      currentEntriesLimit_++;
+      pending = pending || steps[i] > 0;
+      // throttle to slow down the release speed
+      t.throttle();
+    }
   }
 
   XLOGF_EVERY_MS(
       INFO, 60'000,
-      "CacheLib size-controller: request to expand cache by {} entries. "
+      "CacheLib size-controller: request to expand cache to {} entries. "
       "Placeholders num before: {}, after: {}. currentEntriesLimit: {}",
-      entries, before, objCache_.getNumPlaceholders(), currentEntriesLimit_);
+      entriesLimit, before, objCache_.getNumPlaceholders(),
+      currentEntriesLimit_);
 }
 
 template <typename AllocatorT>
@@ -187,5 +253,10 @@ ObjectCacheSizeController<AllocatorT>::ObjectCacheSizeController(
     ObjectCache& objCache, const util::Throttler::Config& throttlerConfig)
     : throttlerConfig_(throttlerConfig),
       objCache_(objCache),
-      currentEntriesLimit_(objCache_.config_.l1EntriesLimit) {}
+      currentEntriesLimit_(objCache_.config_.l1EntriesLimit) {
+  for (size_t i = 0; i < objCache_.config_.l1NumShards; i++) {
+    shardEntriesLimits_.push_back(objCache_.getShardEntriesLimit(
+        objCache_.config_.l1EntriesLimit, static_cast<PoolId>(i)));
+  }
+}
 } // namespace facebook::cachelib::objcache2
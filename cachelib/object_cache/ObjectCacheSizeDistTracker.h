@@ -16,8 +16,12 @@
 
 #pragma once
 
+#include <folly/ThreadLocal.h>
 #include <folly/stats/QuantileHistogram.h>
 
+#include <array>
+#include <mutex>
+
 #include "cachelib/common/PeriodicWorker.h"
 #include "cachelib/common/Time.h"
 
@@ -25,13 +29,43 @@ namespace facebook {
 namespace cachelib {
 namespace objcache2 {
 
+// Tracks the distribution of the object sizes.
+//
+// By default, each run scans the whole cache. In sampled mode, i.e. with a
+// non-zero sample rate, one out of sampleRate object sizes reported through
+// recordObjectSize() is buffered by the reporting thread, and each run
+// merges the samples of all the threads instead of scanning the cache.
 template <typename ObjectCache>
 class ObjectCacheSizeDistTracker : public PeriodicWorker {
  public:
-  explicit ObjectCacheSizeDistTracker(ObjectCache& objCache)
+  // Maximum number of samples a thread buffers between two runs. Further
+  // samples are dropped until the next run.
+  static constexpr size_t kMaxSamplesPerThread = 1024;
+
+  // @param sampleRate   record one out of sampleRate object sizes, 0 to scan
+  //                     the cache instead
+  explicit ObjectCacheSizeDistTracker(ObjectCache& objCache,
+                                      uint32_t sampleRate = 0)
       : objCache_(objCache),
+        sampleRate_(sampleRate),
         objectSizeBytesHist_{std::make_shared<folly::QuantileHistogram<>>()} {}
 
+  // Report the size of an inserted or resized object. Only used in sampled
+  // mode; cheap unless the size is sampled.
+  void recordObjectSize(size_t objectSize) noexcept {
+    if (sampleRate_ == 0) {
+      return;
+    }
+    auto& samples = *samples_;
+    if (++samples.numRecorded % sampleRate_ != 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> l(samples.mutex);
+    if (samples.size < kMaxSamplesPerThread) {
+      samples.sizes[samples.size++] = objectSize;
+    }
+  }
+
   void getCounters(const util::CounterVisitor& visitor) const {
     std::shared_ptr<folly::QuantileHistogram<>> curHist;
     {
@@ -45,17 +79,51 @@ class ObjectCacheSizeDistTracker : public PeriodicWorker {
                           static_cast<uint32_t>(quantile * 100)),
               curHist->estimateQuantile(quantile));
     }
-    visitor("objcache.size_distribution.traverse_time_ms",
-            traverseTimeMs_.load());
+    if (sampleRate_ == 0) {
+      visitor("objcache.size_distribution.traverse_time_ms",
+              traverseTimeMs_.load());
+    } else {
+      visitor("objcache.size_distribution.num_samples",
+              numSamples_.load(std::memory_order_relaxed));
+    }
   }
 
  private:
+  // samples buffered by a thread
+  struct Samples {
+    // taken by the thread when it buffers a sample and by the worker
+    std::mutex mutex;
+    std::array<size_t, kMaxSamplesPerThread> sizes;
+    size_t size{0};
+    // number of object sizes reported by the thread, only accessed by it
+    uint64_t numRecorded{0};
+  };
+  struct SamplesTag {};
+
   void work() override final {
     auto beginTime = util::getCurrentTimeMs();
     auto newHist = std::make_shared<folly::QuantileHistogram<>>();
-    // scan the cache to get the object size
-    for (auto itr = objCache_.begin(); itr != objCache_.end(); ++itr) {
-      newHist->addValue(objCache_.getObjectSize(itr));
+    if (sampleRate_ == 0) {
+      // scan the cache to get the object size
+      for (auto itr = objCache_.begin(); itr != objCache_.end(); ++itr) {
+        newHist->addValue(objCache_.getObjectSize(itr));
+      }
+    } else {
+      // merge the samples of all the threads since the last run
+      size_t numSamples = 0;
+      for (auto& samples : samples_.accessAllThreads()) {
+        std::lock_guard<std::mutex> l(samples.mutex);
+        for (size_t i = 0; i < samples.size; i++) {
+          newHist->addValue(samples.sizes[i]);
+        }
+        numSamples += samples.size;
+        samples.size = 0;
+      }
+      numSamples_.store(numSamples, std::memory_order_relaxed);
+      if (numSamples == 0) {
+        // keep the last distribution until new objects are sampled
+        return;
+      }
     }
     {
       // lock the mutex before updating objectSizeBytesHist_
@@ -68,6 +136,10 @@ class ObjectCacheSizeDistTracker : public PeriodicWorker {
   }
 
   ObjectCache& objCache_;
+  const uint32_t sampleRate_;
+  folly::ThreadLocal<Samples, SamplesTag> samples_;
+  // number of samples merged by the last run
+  std::atomic<size_t> numSamples_{0};
   mutable std::mutex mutex_;
   std::shared_ptr<folly::QuantileHistogram<>> objectSizeBytesHist_{};
   //  time taken to scan the cache and build a new histogram
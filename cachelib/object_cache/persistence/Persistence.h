@@ -18,8 +18,13 @@
 
 #include <folly/File.h>
 #include <folly/MPMCQueue.h>
+#include <folly/compression/Compression.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/lang/Bits.h>
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <thread>
 
@@ -42,25 +47,47 @@ class PersistWorker : public PeriodicWorker {
   };
 
   using SerializeCb = typename ObjectCache::SerializeCb;
+
+  // @param frameSize   0 to write each object as a record, otherwise objects
+  //                    are batched in frames of about this many bytes
+  // @param compressed  whether to compress the frames with zstd
   explicit PersistWorker(uint32_t id,
                          folly::File file,
                          SerializeCb& serializeCb,
-                         folly::MPMCQueue<WorkUnit>& queue)
+                         folly::MPMCQueue<WorkUnit>& queue,
+                         size_t frameSize = 0,
+                         bool compressed = false)
       : id_(id),
         serializeCb_(serializeCb),
         queue_(queue),
-        recordWriter_(navy::createFileRecordWriter(std::move(file))) {}
+        recordWriter_(navy::createFileRecordWriter(std::move(file))),
+        frameSize_(frameSize),
+        codec_(compressed ? folly::io::getCodec(folly::io::CodecType::ZSTD)
+                          : nullptr) {}
 
   // Consume the MPMC queue to persist objects.
   void work() override;
 
+  // Write the objects batched in the current frame, if any. Must be called
+  // once the worker is stopped.
+  void flush();
+
   std::string getName() { return folly::sformat("PersistWorker_{}", id_); }
 
  private:
+  // Append an object to the current frame as
+  //   <header size><header><payload size><payload>
+  // where the header is a persistence::Item without payload.
+  void appendToFrame(const WorkUnit& workUnit,
+                     std::unique_ptr<folly::IOBuf> payload);
+
   uint32_t id_;
   SerializeCb& serializeCb_;
   folly::MPMCQueue<WorkUnit>& queue_;
   std::unique_ptr<RecordWriter> recordWriter_;
+  const size_t frameSize_;
+  std::unique_ptr<folly::io::Codec> codec_;
+  folly::IOBufQueue frame_{folly::IOBufQueue::cacheChainLength()};
 };
 
 template <typename ObjectCache>
@@ -70,10 +97,16 @@ class Persistor {
   using WorkUnit = typename PersistWorker::WorkUnit;
   using SerializeCb = typename PersistWorker::SerializeCb;
 
+  // @param frameSize   0 to write each object as a record, otherwise objects
+  //                    are batched in frames of about this many bytes, which
+  //                    bounds the memory used by each worker
+  // @param compressed  whether to compress the frames with zstd
   explicit Persistor(uint32_t threadCount,
                      std::string baseFilePath,
                      SerializeCb& serializeCb,
-                     ObjectCache& objCache)
+                     ObjectCache& objCache,
+                     size_t frameSize = 0,
+                     bool compressed = false)
       : queue_(folly::MPMCQueue<WorkUnit>(kQueueSize_)), objCache_(objCache) {
     // persist metadata
     try {
@@ -82,6 +115,8 @@ class Persistor {
       auto rw = navy::createFileRecordWriter(std::move(basefile));
       persistence::Metadata metadata;
       metadata.threadCount().value() = threadCount;
+      metadata.frameSizeBytes().value() = frameSize;
+      metadata.compressed().value() = frameSize > 0 && compressed;
       auto iobuf = Serializer::serializeToIOBuf(metadata);
       rw->writeRecord(std::move(iobuf));
     } catch (const std::exception& e) {
@@ -100,7 +135,7 @@ class Persistor {
         auto file = folly::File(getPersistFilePath(baseFilePath, i),
                                 O_CREAT | O_WRONLY | O_TRUNC);
         workers_.emplace_back(std::make_unique<PersistWorker>(
-            i, std::move(file), serializeCb, queue_));
+            i, std::move(file), serializeCb, queue_, frameSize, compressed));
       } catch (const std::exception& e) {
         XLOGF(ERR,
               "Persistor initialization failed: Failed to create persist "
@@ -146,11 +181,20 @@ class RestoreWorker {
  public:
   using DeserializeCb = typename ObjectCache::DeserializeCb;
 
+  // @param framed      whether the objects are batched in frames
+  // @param compressed  whether the frames are compressed with zstd
   explicit RestoreWorker(uint32_t id,
                          folly::File file,
                          DeserializeCb& deserializeCb,
-                         ObjectCache& objCache)
-      : id_(id), deserializeCb_(deserializeCb), objCache_(objCache) {
+                         ObjectCache& objCache,
+                         bool framed = false,
+                         bool compressed = false)
+      : id_(id),
+        deserializeCb_(deserializeCb),
+        objCache_(objCache),
+        framed_(framed),
+        codec_(compressed ? folly::io::getCodec(folly::io::CodecType::ZSTD)
+                          : nullptr) {
     recordReader_ = navy::createFileRecordReader(std::move(file));
   }
 
@@ -163,10 +207,20 @@ class RestoreWorker {
   std::string getName() { return folly::sformat("RestoreWorker_{}", id_); }
 
  private:
+  // Restore the objects of a frame.
+  void restoreFrame(std::unique_ptr<folly::IOBuf> frame, uint32_t currentTime);
+
+  // Insert an object into the cache unless it is expired.
+  void restoreObject(const persistence::Item& persistentItem,
+                     folly::StringPiece payload,
+                     uint32_t currentTime);
+
   uint32_t id_;
   DeserializeCb& deserializeCb_;
   ObjectCache& objCache_;
   std::unique_ptr<RecordReader> recordReader_;
+  const bool framed_;
+  std::unique_ptr<folly::io::Codec> codec_;
   uint32_t numExpired_{0};
 };
 
@@ -206,6 +260,14 @@ void PersistWorker<ObjectCache>::work() {
       continue;
     }
 
+    if (frameSize_ > 0) {
+      appendToFrame(workUnit, std::move(payloadIobuf));
+      if (frame_.chainLength() >= frameSize_) {
+        flush();
+      }
+      continue;
+    }
+
     // serialize persistentItem
     persistence::Item persistentItem;
     persistentItem.key().value() = workUnit.key;
@@ -219,6 +281,35 @@ void PersistWorker<ObjectCache>::work() {
   }
 }
 
+template <typename ObjectCache>
+void PersistWorker<ObjectCache>::appendToFrame(
+    const WorkUnit& workUnit, std::unique_ptr<folly::IOBuf> payload) {
+  persistence::Item header;
+  header.key().value() = workUnit.key;
+  header.objectSize().value() = workUnit.objectSize;
+  header.expiryTime().value() = workUnit.expiryTime;
+  auto headerIobuf = Serializer::serializeToIOBuf(header);
+
+  folly::io::QueueAppender appender(&frame_, 4096);
+  appender.writeLE<uint32_t>(headerIobuf->computeChainDataLength());
+  appender.insert(std::move(headerIobuf));
+  appender.writeLE<uint32_t>(payload->computeChainDataLength());
+  // the payload is linked, not copied, unless the frame is compressed
+  appender.insert(std::move(payload));
+}
+
+template <typename ObjectCache>
+void PersistWorker<ObjectCache>::flush() {
+  if (frame_.empty()) {
+    return;
+  }
+  auto frame = frame_.move();
+  if (codec_) {
+    frame = codec_->compress(frame.get());
+  }
+  recordWriter_->writeRecord(std::move(frame));
+}
+
 template <typename ObjectCache>
 bool Persistor<ObjectCache>::run() {
   if (!initSuccess_) {
@@ -273,6 +364,16 @@ bool Persistor<ObjectCache>::run() {
       XLOG(ERR) << folly::sformat("{} failed to stop", worker->getName());
     }
   }
+  // write the last frames
+  for (auto& worker : workers_) {
+    try {
+      worker->flush();
+    } catch (const std::exception& e) {
+      XLOGF(ERR, "{} failed to flush, reason = {}", worker->getName(),
+            folly::exceptionStr(e));
+      return false;
+    }
+  }
   return true;
 }
 
@@ -282,6 +383,8 @@ Restorer<ObjectCache>::Restorer(std::string& baseFilePath,
                                 ObjectCache& objCache) {
   // restore metadata
   uint32_t threadCount = 0;
+  bool framed = false;
+  bool compressed = false;
   try {
     auto basefile = folly::File(baseFilePath, O_RDONLY);
     auto rr = navy::createFileRecordReader(std::move(basefile));
@@ -290,6 +393,8 @@ Restorer<ObjectCache>::Restorer(std::string& baseFilePath,
       Deserializer deserializer(iobuf->data(), iobuf->data() + iobuf->length());
       auto metadata = deserializer.deserialize<persistence::Metadata>();
       threadCount = metadata.threadCount().value();
+      framed = metadata.frameSizeBytes().value() > 0;
+      compressed = metadata.compressed().value();
     }
   } catch (const std::exception& e) {
     XLOGF(ERR,
@@ -307,7 +412,7 @@ Restorer<ObjectCache>::Restorer(std::string& baseFilePath,
           ObjectCache::Persistor::getPersistFilePath(baseFilePath, i),
           O_RDONLY);
       workers_.emplace_back(std::make_unique<RestoreWorker>(
-          i, std::move(file), deserializeCb, objCache));
+          i, std::move(file), deserializeCb, objCache, framed, compressed));
     } catch (const std::exception& e) {
       XLOGF(ERR,
             "Restorer initialization failed: Failed to create restore worker "
@@ -324,34 +429,94 @@ void RestoreWorker<ObjectCache>::work() {
   uint32_t currentTime = util::getCurrentTimeSec();
   while (!recordReader_->isEnd()) {
     auto iobuf = recordReader_->readRecord();
+    if (framed_) {
+      restoreFrame(std::move(iobuf), currentTime);
+      continue;
+    }
     // deserialize persistentItem
     Deserializer deserializer(iobuf->data(), iobuf->data() + iobuf->length());
     auto persistentItem = deserializer.deserialize<persistence::Item>();
-    uint32_t expiryTime = persistentItem.expiryTime().value();
-    // no need to recover if object is already expired
-    if (expiryTime > 0 && expiryTime <= currentTime) {
-      numExpired_++;
-      continue;
+    restoreObject(persistentItem, persistentItem.payload().value(),
+                  currentTime);
+  }
+}
+
+template <typename ObjectCache>
+void RestoreWorker<ObjectCache>::restoreFrame(
+    std::unique_ptr<folly::IOBuf> frame, uint32_t currentTime) {
+  try {
+    if (codec_) {
+      frame = codec_->uncompress(frame.get());
     }
-    // deserialize and insert object
-    uint32_t ttlSecs = (expiryTime == 0) ? 0 : expiryTime - currentTime;
-    try {
-      bool success = deserializeCb_(typename ObjectCache::Deserializer(
-          persistentItem.key().value(), persistentItem.payload().value(),
-          persistentItem.objectSize().value(), ttlSecs, objCache_));
-      if (!success) {
-        XLOG_EVERY_N(ERR, 1000)
-            << folly::sformat("{} failed to deserialize object for key = {}",
-                              getName(), persistentItem.key().value());
-      }
-    } catch (const std::exception& e) {
-      XLOG_EVERY_N(ERR, 1000) << folly::sformat(
-          "{} failed to deserialize object for key = {}, exception "
-          "= {}",
-          getName(),
-          persistentItem.key().value(),
+  } catch (const std::exception& e) {
+    XLOGF(ERR, "{} failed to uncompress a frame, reason = {}", getName(),
           folly::exceptionStr(e));
+    return;
+  }
+
+  auto range = frame->coalesce();
+  // @return the next part of an object in the frame, none if truncated
+  auto readPart = [&range]() -> folly::Optional<folly::ByteRange> {
+    uint32_t size;
+    if (range.size() < sizeof(size)) {
+      return folly::none;
+    }
+    std::memcpy(&size, range.data(), sizeof(size));
+    size = folly::Endian::little(size);
+    range.advance(sizeof(size));
+    if (range.size() < size) {
+      return folly::none;
     }
+    auto part = range.subpiece(0, size);
+    range.advance(size);
+    return part;
+  };
+
+  while (!range.empty()) {
+    auto header = readPart();
+    folly::Optional<folly::ByteRange> payload;
+    if (header) {
+      payload = readPart();
+    }
+    if (!payload) {
+      XLOGF(ERR, "{} found a truncated frame", getName());
+      return;
+    }
+    Deserializer deserializer(header->begin(), header->end());
+    auto persistentItem = deserializer.deserialize<persistence::Item>();
+    restoreObject(persistentItem, folly::StringPiece(*payload), currentTime);
+  }
+}
+
+template <typename ObjectCache>
+void RestoreWorker<ObjectCache>::restoreObject(
+    const persistence::Item& persistentItem,
+    folly::StringPiece payload,
+    uint32_t currentTime) {
+  uint32_t expiryTime = persistentItem.expiryTime().value();
+  // no need to recover if object is already expired
+  if (expiryTime > 0 && expiryTime <= currentTime) {
+    numExpired_++;
+    return;
+  }
+  // deserialize and insert object
+  uint32_t ttlSecs = (expiryTime == 0) ? 0 : expiryTime - currentTime;
+  try {
+    bool success = deserializeCb_(typename ObjectCache::Deserializer(
+        persistentItem.key().value(), payload,
+        persistentItem.objectSize().value(), ttlSecs, objCache_));
+    if (!success) {
+      XLOG_EVERY_N(ERR, 1000)
+          << folly::sformat("{} failed to deserialize object for key = {}",
+                            getName(), persistentItem.key().value());
+    }
+  } catch (const std::exception& e) {
+    XLOG_EVERY_N(ERR, 1000) << folly::sformat(
+        "{} failed to deserialize object for key = {}, exception "
+        "= {}",
+        getName(),
+        persistentItem.key().value(),
+        folly::exceptionStr(e));
   }
 }
 
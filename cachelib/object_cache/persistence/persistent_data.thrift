@@ -25,4 +25,9 @@ struct Item {
 
 struct Metadata {
   1: i32 threadCount;
+  // 0 if each item is a record, otherwise the items are batched in frames
+  // of about this many bytes
+  2: i64 frameSizeBytes = 0;
+  // whether the frames are compressed with zstd
+  3: bool compressed = false;
 }
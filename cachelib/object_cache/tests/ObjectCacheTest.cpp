@@ -18,8 +18,14 @@
 #include <folly/Random.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstddef>
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "cachelib/allocator/CacheAllocator.h"
 #include "cachelib/object_cache/ObjectCache.h"
@@ -61,6 +67,58 @@ struct Foo5 : FooBase {
   int e{};
   int f{};
 };
+
+// Engine keeping the items in a map
+class MapEngine final : public navy::Engine {
+ public:
+  uint64_t getSize() const override { return 1024 * 1024; }
+  bool couldExist(HashedKey hk) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    return items_.count(hk.key().str()) > 0;
+  }
+  uint64_t estimateWriteSize(HashedKey hk,
+                             navy::BufferView value) const override {
+    return hk.key().size() + value.size();
+  }
+  navy::Status insert(HashedKey hk, navy::BufferView value) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    items_[hk.key().str()] = navy::Buffer{value};
+    return navy::Status::Ok;
+  }
+  navy::Status lookup(HashedKey hk, navy::Buffer& value) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    auto it = items_.find(hk.key().str());
+    if (it == items_.end()) {
+      return navy::Status::NotFound;
+    }
+    value = it->second.copy();
+    return navy::Status::Ok;
+  }
+  navy::Status remove(HashedKey hk) override {
+    std::lock_guard<std::mutex> l(mutex_);
+    return items_.erase(hk.key().str()) > 0 ? navy::Status::Ok
+                                            : navy::Status::NotFound;
+  }
+  void flush() override {}
+  void reset() override { items_.clear(); }
+  void persist(navy::RecordWriter&) override {}
+  bool recover(navy::RecordReader&) override { return true; }
+  void getCounters(const navy::CounterVisitor&) const override {}
+  uint64_t getMaxItemSize() const override { return UINT32_MAX; }
+  std::pair<navy::Status, std::string> getRandomAlloc(
+      navy::Buffer&) override {
+    return std::make_pair(navy::Status::NotFound, "");
+  }
+
+  size_t numItems() const {
+    std::lock_guard<std::mutex> l(mutex_);
+    return items_.size();
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, navy::Buffer> items_;
+};
 } // namespace
 
 template <typename AllocatorT>
@@ -277,6 +335,61 @@ class ObjectCacheTest : public ::testing::Test {
     EXPECT_EQ(3, found2->c);
   }
 
+  void testFindFast() {
+    int numDtors = 0;
+    ObjectCacheConfig config;
+    config.setCacheName("test").setCacheCapacity(10'000).setItemDestructor(
+        [&](ObjectCacheDestructorData data) {
+          if (data.key == "Foo3") {
+            data.deleteObject<Foo3>();
+          } else {
+            data.deleteObject<Foo>();
+          }
+        });
+    auto objcache = ObjectCache::create(config);
+
+    auto found1 = objcache->template findFast<Foo>("Foo");
+    EXPECT_FALSE(found1);
+    EXPECT_EQ(nullptr, found1.get());
+
+    auto foo = std::make_unique<Foo>();
+    foo->a = 1;
+    foo->b = 2;
+    foo->c = 3;
+    objcache->insertOrReplace("Foo", std::move(foo));
+
+    auto found2 = objcache->template findFast<Foo>("Foo");
+    ASSERT_TRUE(found2);
+    EXPECT_EQ(1, found2->a);
+    EXPECT_EQ(2, found2->b);
+    EXPECT_EQ(3, (*found2).c);
+    EXPECT_EQ(objcache->template find<Foo>("Foo").get(), found2.get());
+
+    // moving transfers the pin
+    auto found3 = std::move(found2);
+    EXPECT_FALSE(found2);
+    ASSERT_TRUE(found3);
+    EXPECT_EQ(1, found3->a);
+
+    // converting to a shared_ptr keeps the pin
+    auto shared = std::move(found3).toSharedPtr();
+    EXPECT_FALSE(found3);
+    ASSERT_NE(nullptr, shared);
+    EXPECT_EQ(1, shared->a);
+    EXPECT_EQ(0, objcache->getExpiryTimeSec(shared));
+
+    // the object outlives its removal while a handle pins it
+    objcache->insertOrReplace("Foo3", std::make_unique<Foo3>(numDtors));
+    auto found4 = objcache->template findFast<Foo3>("Foo3");
+    ASSERT_TRUE(found4);
+    ASSERT_TRUE(objcache->remove("Foo3"));
+    EXPECT_EQ(0, numDtors);
+    EXPECT_FALSE(objcache->template findFast<Foo3>("Foo3"));
+    found4.reset();
+    EXPECT_FALSE(found4);
+    EXPECT_EQ(1, numDtors);
+  }
+
   void testMultiType() {
     ObjectCacheConfig config;
     config.setCacheName("test").setCacheCapacity(10'000).setItemDestructor(
@@ -475,6 +588,167 @@ class ObjectCacheTest : public ::testing::Test {
     EXPECT_EQ(30, found2->c);
   }
 
+  void testInsertOrReplaceBatch() {
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setCacheCapacity(10'000)
+        .setNumShards(2)
+        .setItemDestructor(
+            [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    auto objcache = ObjectCache::create(config);
+
+    auto old = std::make_unique<Foo>();
+    old->a = -1;
+    objcache->insertOrReplace("key_0", std::move(old));
+
+    const int objectNum = 1000;
+    std::vector<typename ObjectCache::template BatchInsertEntry<Foo>> entries;
+    for (int i = 0; i < objectNum; i++) {
+      auto foo = std::make_unique<Foo>();
+      foo->a = i;
+      entries.push_back({folly::sformat("key_{}", i), std::move(foo)});
+    }
+    auto statuses = objcache->insertOrReplaceBatch(entries);
+    ASSERT_EQ(objectNum, statuses.size());
+    for (int i = 0; i < objectNum; i++) {
+      EXPECT_EQ(ObjectCache::AllocStatus::kSuccess, statuses[i]);
+      // the cache owns the inserted objects
+      EXPECT_EQ(nullptr, entries[i].object);
+      auto found = objcache->template find<Foo>(folly::sformat("key_{}", i));
+      ASSERT_NE(nullptr, found);
+      EXPECT_EQ(i, found->a);
+    }
+    EXPECT_EQ(objectNum, objcache->getNumEntries());
+
+    std::map<std::string, double> counters;
+    objcache->getObjectCacheCounters(
+        {[&](folly::StringPiece name, double value,
+             util::CounterVisitor::CounterType) {
+          counters[name.str()] = value;
+        }});
+    EXPECT_EQ(objectNum + 1, counters["objcache.inserts"]);
+    EXPECT_EQ(1, counters["objcache.replaces"]);
+
+    // objects must have a size when size tracking is enabled
+    ObjectCacheConfig sizeConfig;
+    sizeConfig.setCacheName("test")
+        .setCacheCapacity(10'000 /* l1EntriesLimit*/,
+                          10'000'000 /* totalObjectSizeLimit */,
+                          100 /* sizeControllerIntervalMs */)
+        .setItemDestructor(
+            [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    auto sizedcache = ObjectCache::create(sizeConfig);
+    std::vector<typename ObjectCache::template BatchInsertEntry<Foo>> sized;
+    sized.push_back({"key_0", std::make_unique<Foo>(), 100});
+    sized.push_back({"key_1", std::make_unique<Foo>()});
+    ASSERT_THROW(sizedcache->insertOrReplaceBatch(sized),
+                 std::invalid_argument);
+    EXPECT_EQ(0, sizedcache->getNumEntries());
+    EXPECT_NE(nullptr, sized[0].object);
+
+    sized[1].objectSize = 200;
+    statuses = sizedcache->insertOrReplaceBatch(sized);
+    EXPECT_EQ(ObjectCache::AllocStatus::kSuccess, statuses[0]);
+    EXPECT_EQ(ObjectCache::AllocStatus::kSuccess, statuses[1]);
+    EXPECT_EQ(300, sizedcache->getTotalObjectSize());
+  }
+
+  void testUpdate() {
+    ObjectCacheConfig config;
+    config.setCacheName("test").setCacheCapacity(10'000).setItemDestructor(
+        [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    auto objcache = ObjectCache::create(config);
+
+    auto [status, _] = objcache->template update<Foo>(
+        "Foo", [](Foo& foo) { foo.a = 1; });
+    EXPECT_EQ(ObjectCache::AllocStatus::kNotFound, status);
+    EXPECT_EQ(nullptr, objcache->template find<Foo>("Foo"));
+
+    auto foo = std::make_unique<Foo>();
+    foo->a = 1;
+    foo->b = 2;
+    objcache->insertOrReplace("Foo", std::move(foo), 0 /* objectSize */,
+                              100 /* ttlSecs */);
+    auto old = objcache->template find<Foo>("Foo");
+    ASSERT_NE(nullptr, old);
+
+    auto [res, updated] = objcache->template update<Foo>(
+        "Foo", [](Foo& copy) { copy.a = 10; });
+    EXPECT_EQ(ObjectCache::AllocStatus::kSuccess, res);
+    ASSERT_NE(nullptr, updated);
+    EXPECT_EQ(10, updated->a);
+    EXPECT_EQ(2, updated->b);
+    EXPECT_EQ(std::chrono::seconds{100}, objcache->getConfiguredTtl(updated));
+
+    // the old version is still valid for its reader
+    EXPECT_NE(old.get(), updated.get());
+    EXPECT_EQ(1, old->a);
+    EXPECT_EQ(2, old->b);
+
+    auto found = objcache->template find<Foo>("Foo");
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(10, found->a);
+    EXPECT_EQ(1, objcache->getNumEntries());
+  }
+
+  void testMultithreadUpdate() {
+    ObjectCacheConfig config;
+    config.setCacheName("test").setCacheCapacity(10'000).setItemDestructor(
+        [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    auto objcache = ObjectCache::create(config);
+    objcache->insertOrReplace("Foo", std::make_unique<Foo>());
+
+    const int numUpdaters = 4;
+    const int numUpdates = 1000;
+    std::atomic<bool> done{false};
+    auto runReads = [&] {
+      while (!done) {
+        // a reader always sees a consistent version
+        auto found = objcache->template find<Foo>("Foo");
+        ASSERT_NE(nullptr, found);
+        ASSERT_EQ(found->a, found->b);
+      }
+    };
+    auto runUpdates = [&] {
+      for (int i = 0; i < numUpdates; i++) {
+        auto [res, _] = objcache->template update<Foo>("Foo", [](Foo& foo) {
+          foo.a++;
+          foo.b++;
+        });
+        ASSERT_EQ(ObjectCache::AllocStatus::kSuccess, res);
+      }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; i++) {
+      readers.push_back(std::thread{runReads});
+    }
+    std::vector<std::thread> updaters;
+    for (int i = 0; i < numUpdaters; i++) {
+      updaters.push_back(std::thread{runUpdates});
+    }
+    for (auto& t : updaters) {
+      t.join();
+    }
+    done = true;
+    for (auto& t : readers) {
+      t.join();
+    }
+
+    // no update was lost
+    auto found = objcache->template find<Foo>("Foo");
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(numUpdaters * numUpdates, found->a);
+
+    std::map<std::string, double> counters;
+    objcache->getObjectCacheCounters(
+        {[&](folly::StringPiece name, double value,
+             util::CounterVisitor::CounterType) {
+          counters[name.str()] = value;
+        }});
+    EXPECT_EQ(numUpdaters * numUpdates, counters["objcache.updates"]);
+  }
+
   void testUniqueInsert() {
     ObjectCacheConfig config;
     config.setCacheName("test").setCacheCapacity(10'000).setItemDestructor(
@@ -836,6 +1110,94 @@ class ObjectCacheTest : public ::testing::Test {
     EXPECT_EQ(newSize, objcache->getTotalObjectSize());
   }
 
+  void testObjectSizeTrackingWithTrackedObject() {
+    using ObjectType = TrackedObject<std::pmr::vector<int>>;
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setCacheCapacity(10'000 /* l1EntriesLimit*/)
+        .setItemDestructor([&](ObjectCacheDestructorData data) {
+          data.deleteObject<ObjectType>();
+        });
+    config.objectSizeTrackingEnabled = true;
+    auto objcache = ObjectCache::create(config);
+
+    // the size is taken from the object when it is not passed
+    auto obj = ObjectType::create();
+    obj->get().resize(100);
+    const auto initSize = obj->getObjectSize();
+    EXPECT_EQ(sizeof(ObjectType) + 100 * sizeof(int), initSize);
+    auto [_, ptr, __] = objcache->insertOrReplace("foo", std::move(obj));
+    EXPECT_EQ(initSize, objcache->template getObjectSize(ptr));
+    EXPECT_EQ(initSize, objcache->getTotalObjectSize());
+
+    // mutations are accounted from the memory resource of the object
+    auto found = objcache->template findToWrite<ObjectType>("foo");
+    ASSERT_NE(nullptr, found);
+    objcache->mutateObject(found, [&] {
+      found->get().clear();
+      found->get().shrink_to_fit();
+    });
+    EXPECT_EQ(sizeof(ObjectType), objcache->template getObjectSize(found));
+    EXPECT_EQ(sizeof(ObjectType), objcache->getTotalObjectSize());
+
+    objcache->mutateObject(found, [&] { found->get().resize(1000); });
+    const auto newSize = sizeof(ObjectType) + 1000 * sizeof(int);
+    EXPECT_EQ(newSize, found->getObjectSize());
+    EXPECT_EQ(newSize, objcache->template getObjectSize(found));
+    EXPECT_EQ(newSize, objcache->getTotalObjectSize());
+
+    // an explicit size takes precedence
+    auto res = objcache->insert("bar", ObjectType::create(), 10);
+    EXPECT_EQ(ObjectCache::AllocStatus::kSuccess, res.first);
+    EXPECT_EQ(10, objcache->template getObjectSize(res.second));
+    EXPECT_EQ(newSize + 10, objcache->getTotalObjectSize());
+
+    ASSERT_TRUE(objcache->remove("foo"));
+    ASSERT_TRUE(objcache->remove("bar"));
+    ptr.reset();
+    found.reset();
+    res.second.reset();
+    EXPECT_EQ(0, objcache->getTotalObjectSize());
+  }
+
+  void testObjectSizeTrackingWithArenaObject() {
+    using ObjectType =
+        ArenaObject<std::pmr::vector<std::pmr::string>, false /* destroy */>;
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setCacheCapacity(10 /* l1EntriesLimit*/)
+        .setItemDestructor([&](ObjectCacheDestructorData data) {
+          data.deleteObject<ObjectType>();
+        });
+    config.objectSizeTrackingEnabled = true;
+    auto objcache = ObjectCache::create(config);
+
+    size_t lastSize = 0;
+    for (int i = 0; i < 20; i++) {
+      auto obj = ObjectType::create();
+      for (int j = 0; j < 10; j++) {
+        obj->get().emplace_back(100, 'a');
+      }
+      lastSize = obj->getObjectSize();
+      objcache->insertOrReplace(folly::sformat("key_{}", i), std::move(obj));
+    }
+    // evicted objects release their arenas and their size
+    EXPECT_EQ(10, objcache->getNumEntries());
+    EXPECT_EQ(10 * lastSize, objcache->getTotalObjectSize());
+
+    auto found = objcache->template find<ObjectType>("key_19");
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(10, found->get().size());
+    EXPECT_EQ(std::string(100, 'a'), found->get().back());
+    EXPECT_EQ(lastSize, objcache->template getObjectSize(found));
+
+    for (int i = 10; i < 20; i++) {
+      objcache->remove(folly::sformat("key_{}", i));
+    }
+    found.reset();
+    EXPECT_EQ(0, objcache->getTotalObjectSize());
+  }
+
   void testMultithreadObjectSizeTrackingWithMutation() {
     if (!folly::usingJEMalloc()) {
       return;
@@ -1199,6 +1561,163 @@ class ObjectCacheTest : public ::testing::Test {
     }
   }
 
+  void testPersistenceStreaming(bool compressed) {
+    ObjectCacheConfig config;
+    auto persistBaseFilePath = std::tmpnam(nullptr);
+    size_t threadsCount = 4;
+    int objectNum = 1000;
+    size_t totalObjectSize = 0;
+
+    // persistence must be enabled first
+    ASSERT_THROW(config.enableStreamingPersistence(4096),
+                 std::invalid_argument);
+
+    config.setCacheName("test")
+        .setCacheCapacity(10'000 /*l1EntriesLimit*/)
+        .setItemDestructor([&](ObjectCacheDestructorData data) {
+          data.deleteObject<ThriftFoo>();
+        })
+        .enablePersistence(
+            threadsCount, persistBaseFilePath,
+            [&](typename ObjectCache::Serializer serializer) {
+              return serializer.template serialize<ThriftFoo>();
+            },
+            [&](typename ObjectCache::Deserializer deserializer) {
+              return deserializer.template deserialize<ThriftFoo>();
+            });
+    ASSERT_THROW(config.enableStreamingPersistence(0), std::invalid_argument);
+    // small frames so that every worker writes several of them
+    config.enableStreamingPersistence(1024, compressed);
+    config.objectSizeTrackingEnabled = true;
+
+    {
+      auto objcache = ObjectCache::create(config);
+      for (int i = 0; i < objectNum; i++) {
+        int objectSize = i + 10;
+        auto object = std::make_unique<ThriftFoo>();
+        object->a().value() = i;
+        object->b().value() = i + 1;
+        object->c().value() = i + 2;
+        // the first objects expire before recovery
+        objcache->insertOrReplace(folly::sformat("key_{}", i),
+                                  std::move(object), objectSize,
+                                  i < 10 ? 1 : 0);
+        totalObjectSize += i < 10 ? 0 : objectSize;
+      }
+      ASSERT_EQ(objcache->persist(), true);
+    }
+
+    // Let the first objects expire
+    std::this_thread::sleep_for(std::chrono::seconds{2});
+    {
+      auto objcache = ObjectCache::create(config);
+      ASSERT_EQ(objcache->recover(), true);
+      for (int i = 0; i < objectNum; i++) {
+        auto found =
+            objcache->template find<ThriftFoo>(folly::sformat("key_{}", i));
+        if (i < 10) {
+          EXPECT_EQ(nullptr, found);
+          continue;
+        }
+        ASSERT_NE(nullptr, found);
+        EXPECT_EQ(i, found->a_ref());
+        EXPECT_EQ(i + 1, found->b_ref());
+        EXPECT_EQ(i + 2, found->c_ref());
+        EXPECT_EQ(i + 10, objcache->getObjectSize(found));
+      }
+      EXPECT_EQ(objcache->getNumEntries(), objectNum - 10);
+      EXPECT_EQ(objcache->getTotalObjectSize(), totalObjectSize);
+    }
+  }
+
+  void testNvmSpill() {
+    auto engine = std::make_shared<MapEngine>();
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setCacheCapacity(10 /*l1EntriesLimit*/)
+        .setItemDestructor([&](ObjectCacheDestructorData data) {
+          data.deleteObject<ThriftFoo>();
+        })
+        .enableNvmSpill(
+            engine,
+            [&](typename ObjectCache::Serializer serializer) {
+              return serializer.template serialize<ThriftFoo>();
+            },
+            [&](typename ObjectCache::Deserializer deserializer) {
+              return deserializer.template deserialize<ThriftFoo>();
+            });
+    ASSERT_THROW(ObjectCacheConfig{}.enableNvmSpill(
+                     nullptr,
+                     [&](typename ObjectCache::Serializer serializer) {
+                       return serializer.template serialize<ThriftFoo>();
+                     },
+                     [&](typename ObjectCache::Deserializer deserializer) {
+                       return deserializer.template deserialize<ThriftFoo>();
+                     }),
+                 std::invalid_argument);
+    auto objcache = ObjectCache::create(config);
+
+    const int objectNum = 100;
+    for (int i = 0; i < objectNum; i++) {
+      auto object = std::make_unique<ThriftFoo>();
+      object->a().value() = i;
+      object->b().value() = i + 1;
+      object->c().value() = i + 2;
+      objcache->insertOrReplace(folly::sformat("key_{}", i), std::move(object));
+    }
+    // the evicted objects spilled to the engine
+    EXPECT_EQ(10, objcache->getNumEntries());
+    EXPECT_EQ(objectNum - 10, engine->numItems());
+
+    // every object is found, faulting in the spilled ones
+    for (int i = 0; i < objectNum; i++) {
+      auto found =
+          objcache->template find<ThriftFoo>(folly::sformat("key_{}", i));
+      ASSERT_NE(nullptr, found);
+      EXPECT_EQ(i, found->a_ref());
+      EXPECT_EQ(i + 1, found->b_ref());
+      EXPECT_EQ(i + 2, found->c_ref());
+    }
+    EXPECT_EQ(objectNum - 10, engine->numItems());
+
+    std::map<std::string, double> counters;
+    objcache->getObjectCacheCounters(
+        {[&](folly::StringPiece name, double value,
+             util::CounterVisitor::CounterType) {
+          counters[name.str()] = value;
+        }});
+    // each fault in evicted another object, which depends on the eviction
+    // policy. With LRU, the objects in memory at first were spilled and
+    // faulted in as well
+    const auto nvmHits = counters["objcache.lookups.nvm_hits"];
+    EXPECT_LE(objectNum - 10, nvmHits);
+    EXPECT_GE(objectNum, nvmHits);
+    if (std::is_same_v<AllocatorT, LruAllocator>) {
+      EXPECT_EQ(objectNum, nvmHits);
+    }
+    EXPECT_EQ(objectNum - 10 + nvmHits, counters["objcache.nvm_spills"]);
+    EXPECT_EQ(0, counters["objcache.nvm_spill_errors"]);
+
+    // an insert drops the stale copy in the engine
+    auto object = std::make_unique<ThriftFoo>();
+    object->a().value() = -1;
+    objcache->insertOrReplace("key_0", std::move(object));
+    auto found = objcache->template find<ThriftFoo>("key_0");
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(-1, found->a_ref());
+    found.reset();
+
+    // a remove drops the key from both tiers
+    for (int i = 0; i < objectNum; i++) {
+      EXPECT_TRUE(objcache->remove(folly::sformat("key_{}", i)));
+    }
+    EXPECT_EQ(0, engine->numItems());
+    for (int i = 0; i < objectNum; i++) {
+      EXPECT_EQ(nullptr, objcache->template findFast<ThriftFoo>(
+                             folly::sformat("key_{}", i)));
+    }
+  }
+
   void testPersistenceWithEvictionOrder() {
     auto persistBaseFilePath = std::tmpnam(nullptr);
     uint8_t numShards = 3;
@@ -1664,6 +2183,88 @@ class ObjectCacheTest : public ::testing::Test {
     EXPECT_EQ(objcache->getCurrentEntriesLimit(), 100);
   }
 
+  void testShardedSizeControl() {
+    const size_t numShards = 4;
+    const size_t maxEntriesStep = 50;
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setNumShards(numShards)
+        .setCacheCapacity(1000 /* l1EntriesLimit*/,
+                          100'000 /* totalObjectSizeLimit */,
+                          100 /* sizeControllerIntervalMs */)
+        .setSizeControllerMaxEntriesStep(maxEntriesStep)
+        .setItemDestructor(
+            [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    ASSERT_THROW(ObjectCacheConfig{}.setSizeControllerMaxEntriesStep(0),
+                 std::invalid_argument);
+
+    auto objcache = ObjectCache::create(config);
+    for (int i = 0; i < 1000; i++) {
+      objcache->insertOrReplace(folly::sformat("key_{}", i),
+                                std::make_unique<Foo>(), 1000);
+    }
+
+    // each run shrinks every shard by at most maxEntriesStep
+    std::this_thread::sleep_for(std::chrono::milliseconds{150});
+    EXPECT_GT(objcache->getCurrentEntriesLimit(), 100);
+    EXPECT_GE(objcache->getCurrentEntriesLimit(),
+              1000 - 4 * numShards * maxEntriesStep);
+
+    // the cache eventually holds 100'000 / 1000 entries, evenly sharded
+    std::this_thread::sleep_for(std::chrono::seconds{2});
+    EXPECT_EQ(100, objcache->getCurrentEntriesLimit());
+    EXPECT_EQ(100, objcache->getNumEntries());
+    EXPECT_EQ(100'000, objcache->getTotalObjectSize());
+    ASSERT_EQ(numShards, objcache->placeholders_.size());
+    for (size_t i = 1; i < numShards; i++) {
+      EXPECT_EQ(objcache->placeholders_[0].size(),
+                objcache->placeholders_[i].size());
+    }
+  }
+
+  void testSampledObjectSizeDistribution() {
+    ObjectCacheConfig config;
+    config.setCacheName("test")
+        .setCacheCapacity(10'000 /* l1EntriesLimit*/,
+                          10'000'000 /* totalObjectSizeLimit */,
+                          100 /* sizeControllerIntervalMs */)
+        .enableSampledObjectSizeDistributionTracking(
+            2 /* sampleRate */, std::chrono::milliseconds{100})
+        .setItemDestructor(
+            [&](ObjectCacheDestructorData data) { data.deleteObject<Foo>(); });
+    ASSERT_THROW(
+        ObjectCacheConfig{}.enableSampledObjectSizeDistributionTracking(0),
+        std::invalid_argument);
+
+    auto objcache = ObjectCache::create(config);
+    for (int i = 0; i < 1000; i++) {
+      objcache->insertOrReplace(folly::sformat("key_{}", i),
+                                std::make_unique<Foo>(), 100 + i);
+    }
+    // wait for the samples to be merged
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+
+    std::map<std::string, double> counters;
+    objcache->getObjectCacheCounters(
+        {[&](folly::StringPiece name, double value,
+             util::CounterVisitor::CounterType) {
+          counters[name.str()] = value;
+        }});
+    EXPECT_EQ(0, counters.count("objcache.size_distribution.traverse_time_ms"));
+    EXPECT_EQ(1, counters.count("objcache.size_distribution.num_samples"));
+    size_t numQuantiles = 0;
+    for (const auto& [name, value] : counters) {
+      if (folly::StringPiece{name}.startsWith(
+              "objcache.size_distribution.object_size_bytes_p")) {
+        // the distribution is kept after the run that merged the samples
+        EXPECT_LE(100, value) << name;
+        EXPECT_GE(1099, value) << name;
+        numQuantiles++;
+      }
+    }
+    EXPECT_LT(0, numQuantiles);
+  }
+
   void testMultithreadFindAndReplace() {
     // Sanity test to see if find and insertions at the same time
     // across mutliple threads are safe.
@@ -1806,17 +2407,20 @@ class ObjectCacheTest : public ::testing::Test {
 using AllocatorTypes = ::testing::Types<LruAllocator,
                                         Lru2QAllocator,
                                         TinyLFUAllocator,
-                                        LruAllocatorSpinBuckets>;
+                                        LruAllocatorSpinBuckets,
+                                        SieveAllocator>;
 TYPED_TEST_CASE(ObjectCacheTest, AllocatorTypes);
 TYPED_TEST(ObjectCacheTest, GetAllocSize) { this->testGetAllocSize(); }
 TYPED_TEST(ObjectCacheTest, ConfigValidation) { this->testConfigValidation(); }
 TYPED_TEST(ObjectCacheTest, SetShardName) { this->testSetShardName(); }
 TYPED_TEST(ObjectCacheTest, SetEvictionPolicyConfig) {
-  if (std::is_same_v<TypeParam, LruAllocator>) {
+  if (std::is_same_v<TypeParam, LruAllocator> ||
+      std::is_same_v<TypeParam, SieveAllocator>) {
     this->testSetEvictionPolicyConfig();
   }
 }
 TYPED_TEST(ObjectCacheTest, Simple) { this->testSimple(); }
+TYPED_TEST(ObjectCacheTest, FindFast) { this->testFindFast(); }
 TYPED_TEST(ObjectCacheTest, MultiType) { this->testMultiType(); }
 TYPED_TEST(ObjectCacheTest, testMultiTypePolymorphism) {
   this->testMultiTypePolymorphism();
@@ -1829,6 +2433,13 @@ TYPED_TEST(ObjectCacheTest, ExpirationWithCustomizedReaper) {
   this->testExpirationWithCustomizedReaper();
 }
 TYPED_TEST(ObjectCacheTest, Replace) { this->testReplace(); }
+TYPED_TEST(ObjectCacheTest, InsertOrReplaceBatch) {
+  this->testInsertOrReplaceBatch();
+}
+TYPED_TEST(ObjectCacheTest, Update) { this->testUpdate(); }
+TYPED_TEST(ObjectCacheTest, MultithreadUpdate) {
+  this->testMultithreadUpdate();
+}
 TYPED_TEST(ObjectCacheTest, UniqueInsert) { this->testUniqueInsert(); }
 TYPED_TEST(ObjectCacheTest, ObjectSizeTrackingBasics) {
   this->testObjectSizeTrackingBasics();
@@ -1842,6 +2453,12 @@ TYPED_TEST(ObjectCacheTest, ObjectSizeTrackingWithMutation) {
 TYPED_TEST(ObjectCacheTest, ObjectSizeTrackingWithSizeUpdate) {
   this->testObjectSizeTrackingWithSizeUpdate();
 }
+TYPED_TEST(ObjectCacheTest, ObjectSizeTrackingWithTrackedObject) {
+  this->testObjectSizeTrackingWithTrackedObject();
+}
+TYPED_TEST(ObjectCacheTest, ObjectSizeTrackingWithArenaObject) {
+  this->testObjectSizeTrackingWithArenaObject();
+}
 TYPED_TEST(ObjectCacheTest, MultithreadObjectSizeTrackingWithMutation) {
   this->testMultithreadObjectSizeTrackingWithMutation();
 }
@@ -1853,8 +2470,18 @@ TYPED_TEST(ObjectCacheTest, PersistenceMultiType) {
 TYPED_TEST(ObjectCacheTest, PersistenceHighLoad) {
   this->testPersistenceHighLoad();
 }
+TYPED_TEST(ObjectCacheTest, PersistenceStreaming) {
+  this->testPersistenceStreaming(false /* compressed */);
+}
+TYPED_TEST(ObjectCacheTest, PersistenceStreamingCompressed) {
+  this->testPersistenceStreaming(true /* compressed */);
+}
+TYPED_TEST(ObjectCacheTest, NvmSpill) { this->testNvmSpill(); }
 TYPED_TEST(ObjectCacheTest, PersistenceWithEvictionOrder) {
-  if (!std::is_same_v<TypeParam, TinyLFUAllocator>) {
+  // the eviction order of TinyLFU and SIEVE depends on state that is not
+  // persisted, i.e. the frequencies and the hand and visited bits
+  if (!std::is_same_v<TypeParam, TinyLFUAllocator> &&
+      !std::is_same_v<TypeParam, SieveAllocator>) {
     this->testPersistenceWithEvictionOrder();
   }
 }
@@ -1883,6 +2510,12 @@ TYPED_TEST(ObjectCacheTest, MultithreadEviction) {
 TYPED_TEST(ObjectCacheTest, MultithreadSizeControl) {
   this->testMultithreadSizeControl();
 }
+TYPED_TEST(ObjectCacheTest, ShardedSizeControl) {
+  this->testShardedSizeControl();
+}
+TYPED_TEST(ObjectCacheTest, SampledObjectSizeDistribution) {
+  this->testSampledObjectSizeDistribution();
+}
 TYPED_TEST(ObjectCacheTest, MultithreadFindAndReplace) {
   this->testMultithreadFindAndReplace();
 }
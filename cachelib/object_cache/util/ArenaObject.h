@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "cachelib/object_cache/util/ObjectMemoryResource.h"
+
+namespace facebook {
+namespace cachelib {
+namespace objcache2 {
+
+// An object of type T built inside its own arena: T and all the memory it
+// allocates through getAllocator() come from a monotonic buffer, which is
+// released in one go when the ArenaObject is deleted, e.g. by
+// `data.deleteObject<ArenaObject<T>>()` in the item destructor. Like for a
+// TrackedObject, the arena blocks are counted so that ObjectCache knows the
+// exact size of the object.
+//
+// Memory released by the object is not reused until the arena is released,
+// so this suits objects that are built once, e.g. deeply nested graphs of
+// std::pmr containers, rather than objects that are mutated a lot.
+//
+// If kDestroyObject is false, the destructor of T is not run at all and
+// deleting the object only releases the arena, which saves walking the
+// object graph. Only use it for types whose members own no resources other
+// than memory from the arena.
+// Example:
+//      using Graph =
+//          std::pmr::unordered_map<std::pmr::string,
+//                                  std::pmr::vector<std::pmr::string>>;
+//      using Object = ArenaObject<Graph, false /* kDestroyObject */>;
+//      auto obj = Object::createWithArenaSize(64 * 1024);
+//      obj->get().try_emplace("key");
+//      objcache->insertOrReplace("key", std::move(obj));
+template <typename T, bool kDestroyObject = true>
+class ArenaObject {
+ public:
+  using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+  // Default size in bytes of the first block of the arena
+  static constexpr size_t kDefaultArenaSize = 1024;
+
+  template <typename... Args>
+  static std::unique_ptr<ArenaObject> create(Args&&... args) {
+    return createWithArenaSize(kDefaultArenaSize,
+                               std::forward<Args>(args)...);
+  }
+
+  // @param arenaSize   size in bytes of the first block of the arena. Sizing
+  //                    it to fit the whole object avoids growing the arena.
+  template <typename... Args>
+  static std::unique_ptr<ArenaObject> createWithArenaSize(size_t arenaSize,
+                                                          Args&&... args) {
+    auto obj = std::unique_ptr<ArenaObject>(new ArenaObject(arenaSize));
+    obj->construct(std::uses_allocator<T, Allocator>{},
+                   std::forward<Args>(args)...);
+    return obj;
+  }
+
+  ~ArenaObject() {
+    if constexpr (kDestroyObject) {
+      if (object_ != nullptr) {
+        object_->~T();
+      }
+    }
+    // the arena releases all its blocks when destroyed
+  }
+
+  ArenaObject(const ArenaObject&) = delete;
+  ArenaObject& operator=(const ArenaObject&) = delete;
+
+  T& get() noexcept { return *object_; }
+  const T& get() const noexcept { return *object_; }
+
+  T* operator->() noexcept { return object_; }
+  const T* operator->() const noexcept { return object_; }
+
+  Allocator getAllocator() noexcept { return Allocator(&arena_); }
+
+  // Size of the object in bytes, including all the blocks of its arena
+  size_t getObjectSize() const noexcept {
+    return sizeof(ArenaObject) + blocks_.getAllocatedBytes();
+  }
+
+ private:
+  explicit ArenaObject(size_t arenaSize) : arena_(arenaSize, &blocks_) {}
+
+  template <typename... Args>
+  void construct(std::true_type, Args&&... args) {
+    void* mem = arena_.allocate(sizeof(T), alignof(T));
+    object_ = new (mem) T(std::forward<Args>(args)..., getAllocator());
+  }
+
+  template <typename... Args>
+  void construct(std::false_type, Args&&... args) {
+    void* mem = arena_.allocate(sizeof(T), alignof(T));
+    object_ = new (mem) T(std::forward<Args>(args)...);
+  }
+
+  // counts the blocks of the arena, so must be declared before it
+  ObjectMemoryResource blocks_;
+  std::pmr::monotonic_buffer_resource arena_;
+  T* object_{nullptr};
+};
+
+namespace detail {
+template <typename T, bool kDestroyObject>
+struct IsTrackedObject<ArenaObject<T, kDestroyObject>> : std::true_type {};
+} // namespace detail
+} // namespace objcache2
+} // namespace cachelib
+} // namespace facebook
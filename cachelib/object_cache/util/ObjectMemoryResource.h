@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+namespace facebook {
+namespace cachelib {
+namespace objcache2 {
+
+// Memory resource that counts the bytes allocated through it and not yet
+// deallocated. The allocations are forwarded to the upstream resource.
+class ObjectMemoryResource : public std::pmr::memory_resource {
+ public:
+  explicit ObjectMemoryResource(
+      std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream) {}
+
+  ObjectMemoryResource(const ObjectMemoryResource&) = delete;
+  ObjectMemoryResource& operator=(const ObjectMemoryResource&) = delete;
+
+  // Number of bytes currently allocated through this resource
+  size_t getAllocatedBytes() const noexcept {
+    return allocatedBytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    auto* ptr = upstream_->allocate(bytes, alignment);
+    allocatedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    upstream_->deallocate(ptr, bytes, alignment);
+    allocatedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_;
+  std::atomic<size_t> allocatedBytes_{0};
+};
+
+// An object of type T that allocates its memory from its own
+// ObjectMemoryResource, so that its exact size is known without polling
+// jemalloc. T is constructed with a trailing allocator argument if it is
+// allocator-aware, e.g. a std::pmr container or a struct of them; its
+// members must allocate from getAllocator().
+//
+// ObjectCache takes the size of a TrackedObject from its resource, on insert
+// and in mutateObject, when size-awareness is enabled.
+// Example:
+//      using Tracked = TrackedObject<std::pmr::vector<int>>;
+//      auto obj = Tracked::create();
+//      obj->get().resize(100);
+//      objcache->insertOrReplace("key", std::move(obj));
+//      ...
+//      objcache->mutateObject(ptr, [&] { ptr->get().push_back(1); });
+template <typename T>
+class TrackedObject {
+ public:
+  using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+  template <typename... Args>
+  static std::unique_ptr<TrackedObject> create(Args&&... args) {
+    return std::unique_ptr<TrackedObject>(new TrackedObject(
+        std::uses_allocator<T, Allocator>{}, std::forward<Args>(args)...));
+  }
+
+  TrackedObject(const TrackedObject&) = delete;
+  TrackedObject& operator=(const TrackedObject&) = delete;
+
+  T& get() noexcept { return object_; }
+  const T& get() const noexcept { return object_; }
+
+  T* operator->() noexcept { return &object_; }
+  const T* operator->() const noexcept { return &object_; }
+
+  Allocator getAllocator() noexcept { return Allocator(&resource_); }
+
+  ObjectMemoryResource& getMemoryResource() noexcept { return resource_; }
+
+  // Size of the object in bytes, including the memory it allocated
+  size_t getObjectSize() const noexcept {
+    return sizeof(TrackedObject) + resource_.getAllocatedBytes();
+  }
+
+ private:
+  template <typename... Args>
+  explicit TrackedObject(std::true_type, Args&&... args)
+      : object_(std::forward<Args>(args)..., Allocator(&resource_)) {}
+
+  template <typename... Args>
+  explicit TrackedObject(std::false_type, Args&&... args)
+      : object_(std::forward<Args>(args)...) {}
+
+  // must be declared before the object, which allocates from it
+  ObjectMemoryResource resource_;
+  T object_;
+};
+
+// Whether T reports its exact size through getObjectSize(), see also
+// ArenaObject.
+namespace detail {
+template <typename T>
+struct IsTrackedObject : std::false_type {};
+
+template <typename T>
+struct IsTrackedObject<TrackedObject<T>> : std::true_type {};
+} // namespace detail
+
+template <typename T>
+constexpr bool kIsTrackedObject =
+    detail::IsTrackedObject<std::remove_const_t<T>>::value;
+} // namespace objcache2
+} // namespace cachelib
+} // namespace facebook
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cachelib/object_cache/util/ArenaObject.h"
+
+namespace facebook::cachelib::objcache2::test {
+namespace {
+using Graph = std::pmr::unordered_map<std::pmr::string,
+                                      std::pmr::vector<std::pmr::string>>;
+
+struct Counted {
+  explicit Counted(int& n) : numDtors(n) {}
+  ~Counted() { numDtors++; }
+  int& numDtors;
+};
+
+void fill(Graph& graph, int numKeys) {
+  for (int i = 0; i < numKeys; i++) {
+    auto& strs = graph[std::pmr::string(std::to_string(i))];
+    for (int j = 0; j < 10; j++) {
+      strs.emplace_back(100, 'a');
+    }
+  }
+}
+} // namespace
+
+TEST(ArenaObjectTest, Basic) {
+  auto obj = ArenaObject<Graph>::createWithArenaSize(4096);
+  const auto emptySize = obj->getObjectSize();
+  EXPECT_LE(sizeof(ArenaObject<Graph>) + 4096, emptySize);
+
+  // the whole graph is allocated from the arena
+  const std::pmr::memory_resource* arena = obj->getAllocator().resource();
+  fill(obj->get(), 100);
+  EXPECT_EQ(100, obj->get().size());
+  EXPECT_EQ(arena, obj->get().get_allocator().resource());
+  for (const auto& [key, strs] : obj->get()) {
+    EXPECT_EQ(arena, key.get_allocator().resource());
+    for (const auto& str : strs) {
+      EXPECT_EQ(arena, str.get_allocator().resource());
+    }
+  }
+  // at least the strings themselves
+  EXPECT_LE(emptySize + 100 * 10 * 100, obj->getObjectSize());
+
+  // memory is not reused until the arena is released
+  const auto fullSize = obj->getObjectSize();
+  obj->get().clear();
+  EXPECT_EQ(fullSize, obj->getObjectSize());
+}
+
+TEST(ArenaObjectTest, DestroyObject) {
+  int numDtors = 0;
+  ArenaObject<Counted>::create(numDtors).reset();
+  EXPECT_EQ(1, numDtors);
+
+  // only the arena is released
+  ArenaObject<Counted, false /* kDestroyObject */>::create(numDtors).reset();
+  EXPECT_EQ(1, numDtors);
+
+  EXPECT_TRUE(kIsTrackedObject<ArenaObject<Graph>>);
+  EXPECT_TRUE((kIsTrackedObject<const ArenaObject<Graph, false>>));
+}
+} // namespace facebook::cachelib::objcache2::test
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "cachelib/object_cache/util/ObjectMemoryResource.h"
+
+namespace facebook::cachelib::objcache2::test {
+namespace {
+struct Foo {
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  Foo(size_t n, const allocator_type& alloc) : ints(n, alloc), str(alloc) {}
+
+  std::pmr::vector<int> ints;
+  std::pmr::string str;
+};
+
+struct Bar {
+  int a{};
+};
+} // namespace
+
+TEST(ObjectMemoryResourceTest, Basic) {
+  ObjectMemoryResource resource;
+  EXPECT_EQ(0, resource.getAllocatedBytes());
+  {
+    std::pmr::vector<int> v(&resource);
+    v.reserve(10);
+    EXPECT_EQ(10 * sizeof(int), resource.getAllocatedBytes());
+    v.reserve(100);
+    EXPECT_EQ(100 * sizeof(int), resource.getAllocatedBytes());
+  }
+  EXPECT_EQ(0, resource.getAllocatedBytes());
+}
+
+TEST(ObjectMemoryResourceTest, TrackedObject) {
+  auto foo = TrackedObject<Foo>::create(10);
+  EXPECT_EQ(10, foo->get().ints.size());
+  EXPECT_EQ(sizeof(TrackedObject<Foo>) + 10 * sizeof(int),
+            foo->getObjectSize());
+
+  // allocations of the members are counted
+  const auto before = foo->getObjectSize();
+  foo->get().str.assign(1000, 'a');
+  EXPECT_LE(before + 1000, foo->getObjectSize());
+  foo->get().str.clear();
+  foo->get().str.shrink_to_fit();
+  EXPECT_EQ(before, foo->getObjectSize());
+
+  // objects that are not allocator-aware are constructed without allocator
+  auto bar = TrackedObject<Bar>::create(Bar{5});
+  EXPECT_EQ(5, bar->get().a);
+  EXPECT_EQ(sizeof(TrackedObject<Bar>), bar->getObjectSize());
+
+  EXPECT_TRUE(kIsTrackedObject<TrackedObject<Foo>>);
+  EXPECT_TRUE(kIsTrackedObject<const TrackedObject<Foo>>);
+  EXPECT_FALSE(kIsTrackedObject<Foo>);
+}
+} // namespace facebook::cachelib::objcache2::test
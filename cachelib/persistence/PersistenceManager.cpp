@@ -18,9 +18,16 @@
 
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/Optional.h>
+#include <folly/compression/Compression.h>
 #include <folly/hash/Checksum.h>
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
+#include <thread>
+
+#include <unistd.h>
 
 #include "cachelib/allocator/CacheAllocatorConfig.h"
 #include "cachelib/common/Utils.h"
@@ -71,12 +78,67 @@ struct FOLLY_PACK_ATTR DataBlock {
   }
 };
 
-void PersistenceManager::saveCache(PersistenceStreamWriter& writer) {
-  util::Timer timer;
-  timer.startOrResume();
+/**
+ * The multi-stream saveCache splits the data blocks of each shm segment and
+ * navy file in contiguous ranges, one per stream. Its blocks have a variable
+ * length: a StreamBlockHeader followed by storedLength bytes of data, which
+ * are absent for a block of zeros and compressed if that makes them smaller.
+ */
+enum class StreamBlockEncoding : uint8_t { kRaw = 0, kZero = 1, kLz4 = 2 };
 
-  XLOGF(INFO, "Start saving cache: cacheName {}, cacheDir {}",
-        *config_.cacheName(), cacheDir_);
+struct FOLLY_PACK_ATTR StreamBlockHeader {
+  uint32_t checksum; // of the uncompressed data
+  uint32_t length;   // uncompressed length, less or equal than kDataBlockSize
+  uint32_t storedLength;
+  StreamBlockEncoding encoding;
+};
+
+namespace {
+bool isZero(const uint8_t* data, size_t length) {
+  return length == 0 ||
+         (data[0] == 0 && ::memcmp(data, data + 1, length - 1) == 0);
+}
+
+// Range of blocks of a stream when numBlocks are split across numStreams.
+std::pair<size_t, size_t> getStreamBlocks(size_t numBlocks,
+                                          size_t stream,
+                                          size_t numStreams) {
+  return {numBlocks * stream / numStreams,
+          numBlocks * (stream + 1) / numStreams};
+}
+
+// Run fn(i) for every stream i in its own thread and rethrow the first
+// exception thrown by any of them once they are all done.
+void runOnStreams(size_t numStreams, const std::function<void(size_t)>& fn) {
+  if (numStreams == 1) {
+    fn(0);
+    return;
+  }
+  std::vector<std::exception_ptr> errors(numStreams);
+  std::vector<std::thread> threads;
+  threads.reserve(numStreams);
+  for (size_t i = 0; i < numStreams; ++i) {
+    threads.emplace_back([&fn, &errors, i] {
+      try {
+        fn(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+} // namespace
+
+void PersistenceManager::saveVersionsAndConfigs(
+    PersistenceStreamWriter& writer) {
   writer.write(DATA_BEGIN_CHAR);
 
   // save versions
@@ -109,6 +171,15 @@ void PersistenceManager::saveCache(PersistenceStreamWriter& writer) {
     writer.write(makeHeader(PersistenceType::Configs, buf->length()));
     writer.write(*buf);
   }
+}
+
+void PersistenceManager::saveCache(PersistenceStreamWriter& writer) {
+  util::Timer timer;
+  timer.startOrResume();
+
+  XLOGF(INFO, "Start saving cache: cacheName {}, cacheDir {}",
+        *config_.cacheName(), cacheDir_);
+  saveVersionsAndConfigs(writer);
 
   // save meta data file (cache_dir/NvmCacheState)
   saveFile(writer, PersistenceType::NvmCacheState,
@@ -160,12 +231,87 @@ void PersistenceManager::saveCache(PersistenceStreamWriter& writer) {
   XLOGF(INFO, "saveCache finish, spent {} seconds", timer.getDurationSec());
 }
 
+void PersistenceManager::saveCache(
+    const std::vector<PersistenceStreamWriter*>& writers, bool compress) {
+  CACHELIB_CHECK_THROW(!writers.empty(), "no stream to save the cache to");
+  util::Timer timer;
+  timer.startOrResume();
+
+  XLOGF(INFO, "Start saving cache: cacheName {}, cacheDir {}, streams {}",
+        *config_.cacheName(), cacheDir_, writers.size());
+  auto& writer = *writers[0];
+  saveVersionsAndConfigs(writer);
+
+  // save the stream config, which tells how the data blocks are written
+  {
+    PersistenceStreamConfig streamConfig;
+    streamConfig.numStreams() = static_cast<int32_t>(writers.size());
+    streamConfig.compressed() = compress;
+    writer.write(DATA_MARK_CHAR);
+    auto buf = Serializer::serializeToIOBuf(streamConfig);
+    writer.write(makeHeader(PersistenceType::StreamConfig, buf->length()));
+    writer.write(*buf);
+  }
+
+  // save meta data file (cache_dir/NvmCacheState)
+  saveFile(writer, PersistenceType::NvmCacheState,
+           NvmCacheState::getNvmCacheStateFilePath(cacheDir_));
+
+  // the segments must be kept until the writers are flushed
+  auto shmInfo = saveShm(writers, PersistenceType::ShmInfo,
+                         detail::kShmInfoName, compress);
+  auto shmHT = saveShm(writers, PersistenceType::ShmHT,
+                       detail::kShmHashTableName, compress);
+  auto shmChainedHT =
+      saveShm(writers, PersistenceType::ShmChainedItemHT,
+              detail::kShmChainedItemHashTableName, compress);
+  auto shmCache = saveShm(writers, PersistenceType::ShmData,
+                          detail::kShmCacheName, compress);
+
+  // save navy data
+  writer.write(DATA_MARK_CHAR);
+  writer.write(makeHeader(PersistenceType::NavyPartition, navyFileSize_));
+  for (const std::string& file : navyFiles_) {
+    folly::File f(file);
+    saveDataInStreams(
+        writers, navyFileSize_, compress, false /* inPlace */,
+        [&](size_t offset, size_t length, uint8_t* buf) {
+          auto res = folly::preadFull(f.fd(), buf, length, offset);
+          CACHELIB_CHECK_THROWF(res != -1, "fail to read file {}, errno: {}",
+                                file, errno);
+          // zero the rest of the block if the file is shorter
+          std::fill(buf + res, buf + length, 0);
+          return buf;
+        });
+  }
+
+  writer.write(DATA_END_CHAR);
+  for (auto* w : writers) {
+    w->flush();
+  }
+
+  timer.pause();
+  XLOGF(INFO, "saveCache finish, spent {} seconds", timer.getDurationSec());
+}
+
 void PersistenceManager::restoreCache(PersistenceStreamReader& reader) {
+  restoreCacheImpl({&reader});
+}
+
+void PersistenceManager::restoreCache(
+    const std::vector<PersistenceStreamReader*>& readers) {
+  CACHELIB_CHECK_THROW(!readers.empty(), "no stream to restore the cache from");
+  restoreCacheImpl(readers);
+}
+
+void PersistenceManager::restoreCacheImpl(
+    const std::vector<PersistenceStreamReader*>& readers) {
   util::Timer timer;
   timer.startOrResume();
 
   XLOGF(INFO, "Start restoring cache: cacheName {}, cacheDir {}",
         *config_.cacheName(), cacheDir_);
+  auto& reader = *readers[0];
 
   CACHELIB_CHECK_THROW(reader.read() == DATA_BEGIN_CHAR,
                        "invalid beginning character");
@@ -177,6 +323,22 @@ void PersistenceManager::restoreCache(PersistenceStreamReader& reader) {
   ShmManager shmManager(cacheDir_, true);
   SCOPE_SUCCESS { shmManager.shutDown(); };
 
+  // set if the cache was saved by the multi-stream saveCache
+  folly::Optional<PersistenceStreamConfig> streamConfig;
+  auto restoreShmData = [&](uint8_t* ptr, size_t size) {
+    if (!streamConfig) {
+      CACHELIB_CHECK_THROW(readers.size() == 1,
+                           "the cache was saved to a single stream");
+      restoreDataFromBlocks(reader, ptr, size);
+      return;
+    }
+    // a new shm segment is zeroed
+    restoreDataFromStreams(
+        readers, size, [ptr](size_t offset, const uint8_t* data, size_t len) {
+          ::memcpy(ptr + offset, data, len);
+        });
+  };
+
   while (true) {
     auto headerBuf = reader.read(headerLength);
     CACHELIB_CHECK_THROW(headerBuf.length() == headerLength, "invalid data");
@@ -202,6 +364,16 @@ void PersistenceManager::restoreCache(PersistenceStreamReader& reader) {
                             *config.cacheName(), *config_.cacheName());
       break;
     }
+    case PersistenceType::StreamConfig: {
+      auto buf = reader.read(dataLen);
+      CACHELIB_CHECK_THROW(buf.length() == dataLen, "invalid data");
+      streamConfig = deserialize<PersistenceStreamConfig>(buf);
+      CACHELIB_CHECK_THROWF(
+          static_cast<size_t>(*streamConfig->numStreams()) == readers.size(),
+          "the cache was saved to {} streams, {} given",
+          *streamConfig->numStreams(), readers.size());
+      break;
+    }
     case PersistenceType::NvmCacheState: {
       auto buf = reader.read(dataLen);
       CACHELIB_CHECK_THROW(buf.length() == dataLen, "invalid data");
@@ -210,18 +382,18 @@ void PersistenceManager::restoreCache(PersistenceStreamReader& reader) {
     }
     case PersistenceType::ShmInfo: {
       auto shm = shmManager.createShm(detail::kShmInfoName, dataLen);
-      restoreDataFromBlocks(reader, static_cast<uint8_t*>(shm.addr), dataLen);
+      restoreShmData(static_cast<uint8_t*>(shm.addr), dataLen);
       break;
     }
     case PersistenceType::ShmHT: {
       auto shm = shmManager.createShm(detail::kShmHashTableName, dataLen);
-      restoreDataFromBlocks(reader, static_cast<uint8_t*>(shm.addr), dataLen);
+      restoreShmData(static_cast<uint8_t*>(shm.addr), dataLen);
       break;
     }
     case PersistenceType::ShmChainedItemHT: {
       auto shm =
           shmManager.createShm(detail::kShmChainedItemHashTableName, dataLen);
-      restoreDataFromBlocks(reader, static_cast<uint8_t*>(shm.addr), dataLen);
+      restoreShmData(static_cast<uint8_t*>(shm.addr), dataLen);
       break;
     }
     case PersistenceType::ShmData: {
@@ -229,11 +401,28 @@ void PersistenceManager::restoreCache(PersistenceStreamReader& reader) {
       opts.alignment = sizeof(Slab); // 4MB
       auto shm = shmManager.createShm(detail::kShmCacheName, *header.length(),
                                       nullptr, opts);
-      restoreDataFromBlocks(reader, static_cast<uint8_t*>(shm.addr),
-                            *header.length());
+      restoreShmData(static_cast<uint8_t*>(shm.addr), dataLen);
       break;
     }
     case PersistenceType::NavyPartition: {
+      if (streamConfig) {
+        for (const auto& file : navyFiles_) {
+          folly::File f(file, O_CREAT | O_WRONLY | O_TRUNC);
+          // blocks of zeros are left as holes
+          CACHELIB_CHECK_THROWF(::ftruncate(f.fd(), dataLen) == 0,
+                                "fail to resize file {}, errno: {}", file,
+                                errno);
+          restoreDataFromStreams(
+              readers, dataLen,
+              [&](size_t offset, const uint8_t* data, size_t len) {
+                auto res = folly::pwriteFull(f.fd(), data, len, offset);
+                CACHELIB_CHECK_THROWF(res != -1,
+                                      "fail to write file {}, errno: {}", file,
+                                      errno);
+              });
+        }
+        break;
+      }
       int32_t navyFileSize = *header.length();
       int32_t numBlock =
           util::getAlignedSize(navyFileSize, kDataBlockSize) / kDataBlockSize;
@@ -381,6 +570,137 @@ void PersistenceManager::restoreDataFromBlocks(PersistenceStreamReader& reader,
   }
 }
 
+std::unique_ptr<ShmSegment> PersistenceManager::saveShm(
+    const std::vector<PersistenceStreamWriter*>& writers,
+    PersistenceType type,
+    const std::string& name,
+    bool compress) {
+  auto segment = ShmManager::attachShmReadOnly(cacheDir_, name, true);
+  auto shm = segment->getCurrentMapping();
+  CACHELIB_CHECK_THROWF(shm.size > 0, "shm {} is empty.", name);
+
+  writers[0]->write(DATA_MARK_CHAR);
+  writers[0]->write(makeHeader(type, shm.size));
+  const uint8_t* ptr = static_cast<uint8_t*>(shm.addr);
+  // we will trigger flush before shm dropped, so the data is kept in place
+  saveDataInStreams(writers, shm.size, compress, true /* inPlace */,
+                    [ptr](size_t offset, size_t, uint8_t*) {
+                      return ptr + offset;
+                    });
+  return segment;
+}
+
+void PersistenceManager::saveDataInStreams(
+    const std::vector<PersistenceStreamWriter*>& writers,
+    size_t size,
+    bool compress,
+    bool inPlace,
+    const GetDataFn& getData) {
+  const size_t numBlocks =
+      util::getAlignedSize(size, kDataBlockSize) / kDataBlockSize;
+  runOnStreams(writers.size(), [&](size_t stream) {
+    auto& writer = *writers[stream];
+    // codecs are not thread safe
+    auto codec =
+        compress ? folly::io::getCodec(folly::io::CodecType::LZ4) : nullptr;
+    std::unique_ptr<uint8_t[]> buffer;
+    if (!inPlace) {
+      buffer = std::make_unique<uint8_t[]>(kDataBlockSize);
+    }
+
+    auto [begin, end] = getStreamBlocks(numBlocks, stream, writers.size());
+    for (size_t i = begin; i < end; ++i) {
+      const size_t offset = i * kDataBlockSize;
+      const size_t length = std::min<size_t>(kDataBlockSize, size - offset);
+      const uint8_t* data = getData(offset, length, buffer.get());
+
+      StreamBlockHeader header{};
+      header.length = length;
+      if (isZero(data, length)) {
+        header.encoding = StreamBlockEncoding::kZero;
+        writer.write(folly::IOBuf(CopyBufferOp::COPY_BUFFER, &header,
+                                  sizeof(StreamBlockHeader)));
+        continue;
+      }
+
+      header.checksum = folly::crc32(data, length);
+      std::unique_ptr<folly::IOBuf> stored;
+      if (codec) {
+        auto raw = folly::IOBuf::wrapBuffer(data, length);
+        stored = codec->compress(raw.get());
+        if (stored->computeChainDataLength() >= length) {
+          // not worth it
+          stored.reset();
+        }
+      }
+      if (stored) {
+        header.encoding = StreamBlockEncoding::kLz4;
+      } else {
+        header.encoding = StreamBlockEncoding::kRaw;
+        stored = inPlace ? folly::IOBuf::wrapBuffer(data, length)
+                         : folly::IOBuf::copyBuffer(data, length);
+      }
+      header.storedLength = stored->computeChainDataLength();
+
+      // chained header and data to make a single write
+      auto buf = folly::IOBuf(CopyBufferOp::COPY_BUFFER, &header,
+                              sizeof(StreamBlockHeader));
+      buf.appendToChain(std::move(stored));
+      writer.write(std::move(buf));
+    }
+  });
+}
+
+void PersistenceManager::restoreDataFromStreams(
+    const std::vector<PersistenceStreamReader*>& readers,
+    size_t size,
+    const PutDataFn& putData) {
+  const size_t numBlocks =
+      util::getAlignedSize(size, kDataBlockSize) / kDataBlockSize;
+  runOnStreams(readers.size(), [&](size_t stream) {
+    auto& reader = *readers[stream];
+    auto codec = folly::io::getCodec(folly::io::CodecType::LZ4);
+
+    auto [begin, end] = getStreamBlocks(numBlocks, stream, readers.size());
+    for (size_t i = begin; i < end; ++i) {
+      const size_t offset = i * kDataBlockSize;
+      const size_t length = std::min<size_t>(kDataBlockSize, size - offset);
+
+      auto headerBuf = reader.read(sizeof(StreamBlockHeader));
+      CACHELIB_CHECK_THROW(headerBuf.length() == sizeof(StreamBlockHeader),
+                           "invalid data");
+      // copied since the next read invalidates the buffer
+      const auto header = cast<StreamBlockHeader>(headerBuf.data());
+      CACHELIB_CHECK_THROW(header.length == length, "invalid block length");
+      if (header.encoding == StreamBlockEncoding::kZero) {
+        continue;
+      }
+
+      auto buf = reader.read(header.storedLength);
+      CACHELIB_CHECK_THROW(buf.length() == header.storedLength,
+                           "invalid data");
+      std::unique_ptr<folly::IOBuf> uncompressed;
+      const uint8_t* data = buf.data();
+      if (header.encoding == StreamBlockEncoding::kLz4) {
+        uncompressed = codec->uncompress(&buf, length);
+        uncompressed->coalesce();
+        CACHELIB_CHECK_THROW(uncompressed->length() == length,
+                             "invalid compressed data");
+        data = uncompressed->data();
+      } else {
+        CACHELIB_CHECK_THROWF(header.encoding == StreamBlockEncoding::kRaw,
+                              "unknown block encoding {}",
+                              static_cast<int>(header.encoding));
+        CACHELIB_CHECK_THROW(header.storedLength == length,
+                             "invalid block length");
+      }
+      CACHELIB_CHECK_THROW(header.checksum == folly::crc32(data, length),
+                           "invalid checksum");
+      putData(offset, data, length);
+    }
+  });
+}
+
 void PersistenceManager::deserializeAndValidateVersions(
     const folly::IOBuf& buf) {
   auto versions = deserialize<CacheLibVersions>(buf);
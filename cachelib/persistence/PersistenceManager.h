@@ -18,6 +18,9 @@
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
 
+#include <functional>
+#include <vector>
+
 #include "cachelib/allocator/CacheVersion.h"
 #include "cachelib/allocator/NvmCacheState.h"
 #include "cachelib/allocator/nvmcache/NavySetup.h"
@@ -41,7 +44,8 @@ constexpr uint32_t kDataBlockSize = 1 * 1024 * 1024; // 1MB
 
 /**
  * Stream reader and writer APIs for PersistenceManager use.
- * read/write functions are called in a single thread.
+ * read/write functions of a stream are called in a single thread at a time.
+ * With multiple streams, different streams are used concurrently.
  * Users should implement read/write functions with their
  * own storage backend, e.g. file, manifold, AWS.
  * Users should throw exception if any error happens during read/write,
@@ -132,6 +136,21 @@ class PersistenceManager {
   /* call reader.read(), restore cache metadata/data to memory/disk */
   void restoreCache(PersistenceStreamReader& reader);
 
+  /*
+   * Save cache metadata/data to multiple streams concurrently. The metadata
+   * goes to the first writer, and the data blocks of each shm segment and
+   * navy file are split across all the writers, each written by its own
+   * thread. Blocks of zeros are written without data, and the other blocks
+   * are compressed if compress is true.
+   */
+  void saveCache(const std::vector<PersistenceStreamWriter*>& writers,
+                 bool compress);
+  /*
+   * Restore a cache saved by the multi-stream saveCache. The readers must be
+   * given in the order of the writers.
+   */
+  void restoreCache(const std::vector<PersistenceStreamReader*>& readers);
+
   const static char DATA_BEGIN_CHAR;
   const static char DATA_MARK_CHAR;
   const static char DATA_END_CHAR;
@@ -139,6 +158,9 @@ class PersistenceManager {
  private:
   folly::IOBuf makeHeader(PersistenceType, size_t);
 
+  // write the beginning character, the versions and the configs
+  void saveVersionsAndConfigs(PersistenceStreamWriter&);
+
   void saveFile(PersistenceStreamWriter&,
                 PersistenceType,
                 const folly::StringPiece);
@@ -150,10 +172,39 @@ class PersistenceManager {
   std::unique_ptr<ShmSegment> saveShm(PersistenceStreamWriter&,
                                       PersistenceType,
                                       const std::string&);
+  // same as above, with the data split across the writers
+  std::unique_ptr<ShmSegment> saveShm(
+      const std::vector<PersistenceStreamWriter*>&,
+      PersistenceType,
+      const std::string&,
+      bool compress);
 
   void saveDataInBlocks(PersistenceStreamWriter&, const ShmAddr&);
   void restoreDataFromBlocks(PersistenceStreamReader&, uint8_t*, size_t);
 
+  // Returns the data of [offset, offset + length) of a source, either in
+  // place or copied to the given buffer of kDataBlockSize bytes.
+  using GetDataFn =
+      std::function<const uint8_t*(size_t offset, size_t length, uint8_t*)>;
+  // Writes length bytes of data at offset of a destination.
+  using PutDataFn =
+      std::function<void(size_t offset, const uint8_t* data, size_t length)>;
+
+  // Save size bytes of data split across the writers. inPlace tells whether
+  // getData returns data that remains valid until the writers are flushed.
+  void saveDataInStreams(const std::vector<PersistenceStreamWriter*>&,
+                         size_t size,
+                         bool compress,
+                         bool inPlace,
+                         const GetDataFn& getData);
+  // Restore size bytes of data saved by saveDataInStreams. Blocks of zeros
+  // are skipped, so the destination must be zeroed.
+  void restoreDataFromStreams(const std::vector<PersistenceStreamReader*>&,
+                              size_t size,
+                              const PutDataFn& putData);
+
+  void restoreCacheImpl(const std::vector<PersistenceStreamReader*>&);
+
   void deserializeAndValidateVersions(const folly::IOBuf&);
 
   template <typename T>
@@ -25,6 +25,7 @@ enum PersistenceType {
   ShmChainedItemHT = 5,
   ShmData = 6,
   NavyPartition = 7,
+  StreamConfig = 8,
 }
 
 struct CacheLibVersions {
@@ -38,6 +39,14 @@ struct PersistCacheLibConfig {
   1: required string cacheName;
 }
 
+// Written after the configs by the multi-stream saveCache.
+struct PersistenceStreamConfig {
+  // number of streams the data blocks are split across
+  1: required i32 numStreams;
+  // whether the data blocks may be compressed
+  2: required bool compressed;
+}
+
 struct PersistenceHeader {
   1: required PersistenceType type;
   // total length of data, if the data is split
@@ -197,6 +197,46 @@ class PersistenceCache {
     cacheVerify(items, numChained, evictedKeys);
   }
 
+  // Same as test(), saving the cache to numStreams streams.
+  // @return the total size of the streams
+  size_t testStreams(std::vector<std::pair<std::string, std::string>> items,
+                     uint32_t numPools,
+                     uint32_t numChained,
+                     bool testNvm,
+                     size_t numStreams,
+                     bool compress) {
+    PersistenceManager manager(config_);
+    auto evictedKeys = cacheSetup(items, numPools, numChained, testNvm);
+    EXPECT_LE(evictedKeys.size(), items.size() / 2);
+
+    std::vector<std::unique_ptr<folly::IOBuf>> buffers;
+    std::vector<std::unique_ptr<MockPersistenceStreamWriter>> writers;
+    std::vector<PersistenceStreamWriter*> writerPtrs;
+    for (size_t i = 0; i < numStreams; ++i) {
+      buffers.push_back(folly::IOBuf::create(kCapacity));
+      writers.push_back(
+          std::make_unique<MockPersistenceStreamWriter>(buffers.back().get()));
+      writerPtrs.push_back(writers.back().get());
+    }
+    manager.saveCache(writerPtrs, compress);
+
+    cacheCleanup();
+
+    std::vector<std::unique_ptr<MockPersistenceStreamReader>> readers;
+    std::vector<PersistenceStreamReader*> readerPtrs;
+    size_t totalSize = 0;
+    for (auto& buffer : buffers) {
+      readers.push_back(std::make_unique<MockPersistenceStreamReader>(
+          buffer->data(), buffer->length()));
+      readerPtrs.push_back(readers.back().get());
+      totalSize += buffer->length();
+    }
+    manager.restoreCache(readerPtrs);
+
+    cacheVerify(items, numChained, evictedKeys);
+    return totalSize;
+  }
+
   std::vector<std::pair<std::string, std::string>> getKeyValuePairs(
       uint32_t numKeys) {
     std::vector<std::pair<std::string, std::string>> keys;
@@ -164,6 +164,54 @@ TEST_F(PersistenceManagerTest, testNvmRaidLarge) {
   cache_.test(cache_.getKeyValuePairs(100 * 1000), 1, 0, true);
 }
 
+TEST_F(PersistenceManagerTest, testStreams) {
+  // test three items, two pools, four streams
+  auto totalSize =
+      cache_.testStreams(cache_.getKeyValuePairs(3), 2, 0, false, 4, false);
+  // blocks of zeros are not saved
+  EXPECT_LT(totalSize, cache_.kCacheSize);
+}
+
+TEST_F(PersistenceManagerTest, testStreamsCompressed) {
+  // test 10k items, three chained item, three streams
+  cache_.testStreams(cache_.getKeyValuePairs(10 * 1000), 1, 3, false, 3, true);
+}
+
+TEST_F(PersistenceManagerTest, testStreamsNvmRaid) {
+  LruAllocator::NvmCacheConfig nvmConfig;
+  nvmConfig.navyConfig = utils::getNvmTestConfig(cache_.cacheDir_);
+  util::makeDir(cache_.cacheDir_ + "/navy");
+
+  // 100MB - 1 byte to test non-fullMB navy file size
+  nvmConfig.navyConfig.setSimpleFile("", 0);
+  nvmConfig.navyConfig.setRaidFiles(
+      {cache_.cacheDir_ + "/navy/CACHE0", cache_.cacheDir_ + "/navy/CACHE1"},
+      100 * 1024ULL * 1024ULL - 1, true);
+  nvmConfig.navyConfig.setDeviceMetadataSize(10 * 1024ULL * 1024ULL);
+  cache_.config_.enableNvmCache(nvmConfig);
+
+  // test 10k items, nvm, four streams
+  cache_.testStreams(cache_.getKeyValuePairs(10 * 1000), 1, 0, true, 4, true);
+}
+
+TEST_F(PersistenceManagerTest, testStreamsMismatch) {
+  auto items = cache_.getKeyValuePairs(3);
+  cache_.cacheSetup(items, 1, 0, false);
+  PersistenceManager manager(cache_.config_);
+  auto buffer = folly::IOBuf::create(cache_.kCapacity);
+  {
+    MockPersistenceStreamWriter writer0(cache_.buffer_.get());
+    MockPersistenceStreamWriter writer1(buffer.get());
+    manager.saveCache({&writer0, &writer1}, false);
+  }
+  cache_.cacheCleanup();
+
+  MockPersistenceStreamReader reader(cache_.buffer_->data(),
+                                     cache_.buffer_->length());
+  ASSERT_THROW_WITH_MSG(manager.restoreCache(reader), std::invalid_argument,
+                        "the cache was saved to 2 streams, 1 given");
+}
+
 TEST_F(PersistenceManagerTest, testCompactCache) {
   cache_.config_.enableCompactCache();
 
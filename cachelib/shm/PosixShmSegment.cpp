@@ -109,6 +109,23 @@ void ftruncateImpl(int fd, size_t size) {
   }
 }
 
+void fallocateImpl(int fd, size_t size) {
+  const int ret = fallocate(fd, 0, 0, size);
+  if (ret == 0) {
+    return;
+  }
+  switch (errno) {
+  case ENOSPC:
+  case ENOMEM:
+  case EOPNOTSUPP:
+    util::throwSystemError(errno, "fallocate() of shared memory failed");
+    break;
+  default:
+    XDCHECK(false);
+    util::throwSystemError(errno, "Invalid errno");
+  }
+}
+
 void fstatImpl(int fd, stat_t* buf) {
   const int ret = fstat(fd, buf);
   if (ret == 0) {
@@ -214,6 +231,9 @@ PosixShmSegment::PosixShmSegment(ShmNewT,
       fd_(createNewSegment(getName())) {
   markActive();
   resize(size);
+  if (opts_.preallocate && opts_.populateThreads == 0) {
+    detail::fallocateImpl(fd_, getSize());
+  }
   XDCHECK(isActive());
   XDCHECK_NE(fd_, kInvalidFD);
   // this ensures that the segment lives while the object lives.
@@ -340,7 +360,7 @@ void* PosixShmSegment::mapAddress(void* addr) const {
     util::throwSystemError(EINVAL, "Address already mapped");
   }
   XDCHECK(retAddr == addr || addr == nullptr);
-  memBind(addr);
+  memBind(retAddr);
   return retAddr;
 }
 
@@ -358,7 +378,9 @@ static void forcePageAllocation(void* addr, size_t size, size_t pageSize) {
 }
 
 void PosixShmSegment::memBind(void* addr) const {
-  if (opts_.memBindNumaNodes.empty()) {
+  // with populateThreads, the threads populating a new segment bind
+  // themselves instead
+  if (opts_.memBindNumaNodes.empty() || opts_.populateThreads > 0) {
     return;
   }
 
@@ -23,6 +23,13 @@
 #include <folly/logging/xlog.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace facebook {
 namespace cachelib {
 
@@ -157,6 +164,83 @@ PageSizeT getPageSizeInSMap(void* addr) {
   throw std::invalid_argument("address mapping not found in /proc/self/smaps");
 }
 
+void prefaultPages(void* addr,
+                   size_t size,
+                   PageSizeT p,
+                   uint32_t numThreads,
+                   const NumaBitMask& memBindNumaNodes) {
+  constexpr size_t kChunkSize = 64 * 1024 * 1024;
+  const size_t pageSize = getPageSize(p);
+  auto* start = reinterpret_cast<uint8_t*>(addr);
+  const size_t numChunks = (size + kChunkSize - 1) / kChunkSize;
+  std::atomic<size_t> nextChunk{0};
+  // cleared by the first thread to find MADV_POPULATE_WRITE unsupported
+  std::atomic<bool> canPopulate{true};
+  // first failure of a thread, such as the memory running out
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto setError = [&](int err, const char* msg) {
+    std::lock_guard<std::mutex> l{errorMutex};
+    if (!error) {
+      error = std::make_exception_ptr(
+          std::system_error(err, std::system_category(), msg));
+    }
+  };
+
+  auto prefaultChunks = [&]() {
+    for (size_t i = nextChunk++; i < numChunks; i = nextChunk++) {
+      auto* chunk = start + i * kChunkSize;
+      const size_t len = std::min(kChunkSize, size - i * kChunkSize);
+      if (canPopulate.load(std::memory_order_relaxed)) {
+        if (madvise(chunk, len, MADV_POPULATE_WRITE) == 0) {
+          continue;
+        }
+        if (errno != EINVAL) {
+          setError(errno, "madvise(MADV_POPULATE_WRITE) failed");
+          return;
+        }
+        canPopulate = false;
+      }
+      // a read fault maps the existing shm page without changing it
+      for (size_t off = 0; off < len; off += pageSize) {
+        (void)*reinterpret_cast<volatile const uint8_t*>(chunk + off);
+      }
+    }
+  };
+
+  numThreads = static_cast<uint32_t>(
+      std::max<size_t>(1, std::min<size_t>(numThreads, numChunks)));
+  // the memory policy is per thread, so the bound pages are only allocated
+  // by threads of our own
+  const bool bind = !memBindNumaNodes.empty();
+  auto bindAndPrefault = [&]() {
+    auto nodeMask = memBindNumaNodes.getNativeBitmask();
+    if (set_mempolicy(MPOL_BIND, nodeMask->maskp, nodeMask->size) != 0) {
+      setError(errno, "set_mempolicy() failed");
+      return;
+    }
+    prefaultChunks();
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = bind ? 0 : 1; t < numThreads; t++) {
+    if (bind) {
+      threads.emplace_back(bindAndPrefault);
+    } else {
+      threads.emplace_back(prefaultChunks);
+    }
+  }
+  if (!bind) {
+    prefaultChunks();
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 } // namespace detail
 } // namespace cachelib
 } // namespace facebook
@@ -56,6 +56,10 @@
 #define SHM_LOCK 0
 #endif
 
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
 #ifndef SHM_REMAP
 #define SHM_REMAP 0
 #endif
@@ -128,6 +132,16 @@ struct ShmSegmentOpts {
   bool readOnly{false};
   size_t alignment{1}; // alignment for mapping.
   NumaBitMask memBindNumaNodes;
+  // threads allocating and zeroing the pages of a new segment when it is
+  // created, instead of on first touch. 0 disables it. The threads are
+  // bound to memBindNumaNodes if set.
+  uint32_t populateThreads{0};
+  // reserve the memory of a new posix segment with fallocate() when it is
+  // created, so that a shortage of memory fails the creation instead of
+  // raising SIGBUS on first touch. The kernel zeroes the pages serially.
+  // Not needed with populateThreads, whose threads fail the creation on a
+  // shortage as well.
+  bool preallocate{false};
 
   explicit ShmSegmentOpts(PageSizeT p) : pageSize(p) {}
   explicit ShmSegmentOpts(PageSizeT p, bool ro) : pageSize(p), readOnly(ro) {}
@@ -207,6 +221,26 @@ bool isPageAlignedAddr(void* addr, PageSizeT p = PageSizeT::NORMAL);
 //
 // @throw  std::invalid_argument if the address mapping is not found.
 PageSizeT getPageSizeInSMap(void* addr);
+
+// Faults in the pages of a writable mapping so that the first accesses to
+// them don't, using MADV_POPULATE_WRITE or touching every page on kernels
+// without it. The memory is split in chunks taken in address order by
+// @numThreads threads, so the start of the mapping is populated first.
+// Returns once all the pages are populated.
+//
+// @throw std::system_error if the pages could not be allocated
+//
+// @param addr        start of the mapping, page aligned
+// @param size        bytes to populate
+// @param p           page size of the mapping
+// @param numThreads  number of threads populating the mapping, at least 1
+// @param memBindNumaNodes  if not empty, the threads allocate the pages with
+//                          their memory policy bound to these nodes
+void prefaultPages(void* addr,
+                   size_t size,
+                   PageSizeT p,
+                   uint32_t numThreads,
+                   const NumaBitMask& memBindNumaNodes = NumaBitMask{});
 } // namespace detail
 } // namespace cachelib
 } // namespace facebook
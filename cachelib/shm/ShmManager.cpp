@@ -305,6 +305,16 @@ ShmAddr ShmManager::createShm(const std::string& shmName,
   }
 
   auto ret = newSeg->getCurrentMapping();
+  if (opts.populateThreads > 0 && !opts.readOnly) {
+    // zero the pages now rather than one fault at a time once serving
+    try {
+      detail::prefaultPages(ret.addr, ret.size, opts.pageSize,
+                            opts.populateThreads, opts.memBindNumaNodes);
+    } catch (const std::system_error&) {
+      newSeg->markForRemoval();
+      throw;
+    }
+  }
   nameToKey_.emplace(shmName, newSeg->getKeyStr());
   segments_.emplace(shmName, std::move(newSeg));
   return ret;
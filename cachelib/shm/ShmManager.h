@@ -70,10 +70,13 @@ class ShmManager {
   //                  if nullptr, the segment will be mapped to a random
   //                  address chosen by the kernel. If an address collides with
   //                  an existing mapping, the mapping will fail.
+  // @param opts      options for the segment. With opts.populateThreads, the
+  //                  pages are allocated before this returns.
   //
   // @return ShmAddr for the segment
   //
   // @throw   std::invalid_argument if unable to create or map shared memory
+  // @throw   std::system_error if unable to populate the shared memory
   ShmAddr createShm(const std::string& shmName,
                     size_t size,
                     void* addr = nullptr,
@@ -93,6 +93,7 @@ class ShmTest : public ShmTestBase {
   void testMappingAlignment(bool posix);
   void testLifetime(bool posix);
   void testPageSize(PageSizeT, bool posix);
+  void testPrefault(bool posix);
 };
 
 class ShmTestPosix : public ShmTest {
@@ -27,6 +27,7 @@ using namespace facebook::cachelib::tests;
 using facebook::cachelib::detail::getPageSize;
 using facebook::cachelib::detail::getPageSizeInSMap;
 using facebook::cachelib::detail::isPageAlignedSize;
+using facebook::cachelib::detail::prefaultPages;
 
 void ShmTest::testCreateAttach(bool posix) {
   const unsigned char magicVal = 'd';
@@ -220,3 +221,35 @@ void ShmTest::testLifetime(bool posix) {
 
 TEST_F(ShmTestPosix, Lifetime) { testLifetime(true); }
 TEST_F(ShmTestSysV, Lifetime) { testLifetime(false); }
+
+void ShmTest::testPrefault(bool posix) {
+  const size_t pageSize = getPageSize();
+  const size_t size = 150 * 1024 * 1024 + 3 * pageSize;
+  {
+    ShmSegment s(ShmNew, segmentName, size, posix);
+    ASSERT_TRUE(s.mapAddress(nullptr));
+    auto* addr = reinterpret_cast<uint8_t*>(s.getCurrentMapping().addr);
+    for (size_t off = 0; off < size; off += 101 * pageSize) {
+      addr[off] = static_cast<uint8_t>(off / pageSize);
+    }
+  }
+
+  ShmSegment s(ShmAttach, segmentName, posix);
+  ASSERT_TRUE(s.mapAddress(nullptr));
+  auto* addr = reinterpret_cast<uint8_t*>(s.getCurrentMapping().addr);
+  prefaultPages(addr, size, PageSizeT::NORMAL, 4 /* numThreads */);
+
+  // every page is mapped, and the content is unchanged
+  std::vector<unsigned char> resident(size / pageSize);
+  ASSERT_EQ(0, ::mincore(addr, size, resident.data()));
+  for (size_t i = 0; i < resident.size(); i++) {
+    ASSERT_TRUE(resident[i] & 1) << i;
+  }
+  for (size_t off = 0; off < size; off += 101 * pageSize) {
+    ASSERT_EQ(static_cast<uint8_t>(off / pageSize), addr[off]);
+  }
+  s.markForRemoval();
+}
+
+TEST_F(ShmTestPosix, Prefault) { testPrefault(true); }
+TEST_F(ShmTestSysV, Prefault) { testPrefault(false); }
@@ -19,6 +19,7 @@
 #include <sys/time.h>
 
 #include <fstream>
+#include <vector>
 
 #include "cachelib/common/Utils.h"
 #include "cachelib/shm/PosixShmSegment.h"
@@ -81,6 +82,7 @@ class ShmManagerTest : public ShmTestBase {
   void testCleanup(bool posix);
   void testAttachReadOnly(bool posix);
   void testMetaFileDeletion(bool posix);
+  void testPopulate(bool posix);
 
  private:
   const static std::string dirPrefix;
@@ -928,3 +930,43 @@ TEST_F(ShmManagerTestPosix, TestMappingAlignment) {
 TEST_F(ShmManagerTestSysV, TestMappingAlignment) {
   testMappingAlignment(false);
 }
+
+// segments created with populate threads have all their pages allocated and
+// zeroed, and can still be used as usual.
+void ShmManagerTest::testPopulate(bool posix) {
+  int num = 0;
+  const std::string segmentPrefix = std::to_string(::getpid());
+  const std::string seg1 = segmentPrefix + "-" + std::to_string(num++);
+  const std::string seg2 = segmentPrefix + "-" + std::to_string(num++);
+  const size_t pageSize = facebook::cachelib::detail::getPageSize();
+  const size_t size = 130 * 1024 * 1024 + 5 * pageSize;
+
+  ShmManager s(cacheDir, posix);
+  facebook::cachelib::ShmSegmentOpts opts;
+  opts.populateThreads = 4;
+  segmentsToDestroy.push_back(seg1);
+  auto m1 = s.createShm(seg1, size, nullptr, opts);
+  ASSERT_EQ(size, m1.size);
+  std::vector<unsigned char> resident(size / pageSize);
+  ASSERT_EQ(0, ::mincore(m1.addr, size, resident.data()));
+  for (size_t i = 0; i < resident.size(); i++) {
+    ASSERT_TRUE(resident[i] & 1) << i;
+  }
+  checkMemory(m1.addr, size, 0);
+  writeToMemory(m1.addr, size, 'p');
+  checkMemory(m1.addr, size, 'p');
+
+  // the memory of a posix segment can be reserved upfront
+  opts.populateThreads = 0;
+  opts.preallocate = true;
+  segmentsToDestroy.push_back(seg2);
+  auto m2 = s.createShm(seg2, size, nullptr, opts);
+  ASSERT_EQ(size, m2.size);
+  writeToMemory(m2.addr, size, 'f');
+  checkMemory(m2.addr, size, 'f');
+  s.shutDown();
+}
+
+TEST_F(ShmManagerTestPosix, Populate) { testPopulate(true); }
+
+TEST_F(ShmManagerTestSysV, Populate) { testPopulate(false); }